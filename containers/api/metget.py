@@ -217,12 +217,36 @@ class MetGetCredits(Resource):
             return AccessControl.unauthorized_response()
 
 
+class MetGetRegister(Resource):
+    """
+    Allows users to register domains they request every forecast cycle, so
+    the interpolation weights are built before their requests arrive
+
+    This is found at the /register path
+    """
+
+    decorators = [limiter.limit("10/second", on_breach=ratelimit_error_responder)]
+
+    @staticmethod
+    def post():
+        authorized = AccessControl.check_authorization_token(request.headers)
+        if authorized:
+            from metget_api.register_domain import RegisterDomain
+
+            r = RegisterDomain()
+            message, status = r.post(request)
+            return message, status
+        else:
+            return AccessControl.unauthorized_response()
+
+
 # ...Add the resources to the API
 api.add_resource(MetGetStatus, "/status")
 api.add_resource(MetGetBuild, "/build")
 api.add_resource(MetGetCheckRequest, "/check")
 api.add_resource(MetGetTrack, "/stormtrack")
 api.add_resource(MetGetCredits, "/credits")
+api.add_resource(MetGetRegister, "/register")
 
 if __name__ == "__main__":
     """
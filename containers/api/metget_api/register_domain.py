@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+###################################################################################################
+# MIT License
+#
+# Copyright (c) 2023 The Water Institute
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+# Author: Zach Cobell
+# Contact: zcobell@thewaterinstitute.org
+# Organization: The Water Institute
+#
+###################################################################################################
+from typing import Tuple
+
+# ...Services whose weights are built ahead of time when a registration does
+# not list its own. Storm following sources move every cycle, so they are not
+# registered
+DEFAULT_SERVICES = ["gfs-ncep", "gefs-ncep", "nam-ncep", "hrrr-ncep"]
+
+REGISTERED_SERVICES = DEFAULT_SERVICES + ["hrrr-alaska-ncep", "wpc-ncep"]
+
+
+class RegisterDomain:
+    """
+    Registers domains which are requested every cycle, so their
+    interpolation weights are built ahead of time for each of their services
+    and forecast cycle requests on them skip that setup
+    """
+
+    def __init__(self):
+        pass
+
+    def post(self, request) -> Tuple[dict, int]:
+        """
+        This method is used to register the domains of a request body. The
+        body holds a "domains" list, each entry defined as in a build request
+        with an optional "services" list, and an optional "epsg"
+
+        Args:
+            request: A flask request object
+
+        Returns:
+            A tuple containing the response message and status code
+        """
+        from metbuild.domain import Domain
+        from metbuild.tables import RegisteredDomainTable
+
+        api_key = request.headers.get("x-api-key")
+        request_json = request.get_json()
+        if not isinstance(request_json, dict) or "domains" not in request_json:
+            return RegisterDomain.__error("No domains were provided")
+        if not isinstance(request_json["domains"], list):
+            return RegisterDomain.__error("The domains must be a list")
+        try:
+            epsg = int(request_json.get("epsg", 4326))
+        except (TypeError, ValueError):
+            return RegisterDomain.__error("The epsg must be an integer")
+
+        registrations = []
+        for domain in request_json["domains"]:
+            if not isinstance(domain, dict):
+                return RegisterDomain.__error("Every domain must be an object")
+            name = domain.get("name")
+            if not name or not isinstance(name, str):
+                return RegisterDomain.__error("Every domain needs a name")
+            services = domain.get("services")
+            if services is None:
+                services = [domain["service"]] if "service" in domain else []
+            if not isinstance(services, list):
+                return RegisterDomain.__error(
+                    "The services of domain '{:s}' must be a list".format(name)
+                )
+            if not services:
+                services = DEFAULT_SERVICES
+            for service in services:
+                if not isinstance(service, str):
+                    return RegisterDomain.__error(
+                        "The services of domain '{:s}' must be names".format(name)
+                    )
+                if service not in REGISTERED_SERVICES:
+                    return RegisterDomain.__error(
+                        "Service '{:s}' cannot be registered".format(service)
+                    )
+            try:
+                valid = Domain(name, services[0], domain, True).valid()
+            except Exception as e:
+                return RegisterDomain.__error(
+                    "Domain '{:s}' could not be parsed: {:s}".format(name, str(e))
+                )
+            if not valid:
+                return RegisterDomain.__error(
+                    "Domain '{:s}' is not valid".format(name)
+                )
+            registrations.append((name, domain, services))
+
+        ids = [
+            RegisteredDomainTable.register(api_key, name, domain, services, epsg)
+            for name, domain, services in registrations
+        ]
+        return {
+            "statusCode": 200,
+            "body": {
+                "status": "success",
+                "message": "Registered {:d} domains".format(len(ids)),
+                "registration_id": ids,
+            },
+        }, 200
+
+    @staticmethod
+    def __error(message: str) -> Tuple[dict, int]:
+        return {
+            "statusCode": 400,
+            "body": {"status": "error", "message": "ERROR: " + message},
+        }, 400
@@ -27,18 +27,25 @@
 # Organization: The Water Institute
 #
 ###################################################################################################
+import asyncio
 import logging
+import math
 import os
+import shutil
 from datetime import datetime, timedelta
 from typing import Tuple
 
 import pymetbuild
 from metbuild.domain import Domain
+from metbuild.filecache import FileCache
 from metbuild.filelist import Filelist
 from metbuild.input import Input
+from metbuild.resultcache import ResultCache
 from metbuild.s3file import S3file
 from metbuild.tables import RequestTable
+from metbuild.windgrid import WindGrid
 from metbuild.s3gribio import S3GribIO
+from metbuild.weightcache import WeightCache
 
 
 class MessageHandler:
@@ -47,9 +54,103 @@ class MessageHandler:
     and process them into met fields
     """
 
-    def __init__(self, message: dict) -> None:
+    # ...Number of grib files downloaded from s3 at the same time
+    FETCH_THREADS = 8
+
+    # ...Chrome trace of the request, written when METGET_TRACE is set
+    TRACE_FILENAME = "trace.json"
+
+    # ...Formats written front to back, uploaded in parts while they are
+    # generated unless METGET_STREAM_UPLOAD is set to 0
+    STREAMED_FORMATS = (
+        "ascii",
+        "owi-ascii",
+        "adcirc-ascii",
+        "owi-binary",
+        "adcirc-binary",
+        "delft3d",
+        "grib2",
+    )
+
+    # ...Records written by each domain between checkpoints when
+    # METGET_CHECKPOINT_DIR is set
+    CHECKPOINT_INTERVAL = 24
+
+    # ...Manifest of the part of the output published while the build runs,
+    # written every METGET_PUBLISH_HOURS of forcing for the streamed formats
+    MANIFEST_FILENAME = "manifest.json"
+
+    # ...Manifest listing the files of an output split by time with the
+    # shard_hours or shard_bytes request options
+    SHARD_MANIFEST_FILENAME = "shards.json"
+
+    # ...Number of output files uploaded to s3 at the same time
+    UPLOAD_THREADS = 8
+
+    # ...Request settings which are keyed separately, or do not change the
+    # output, when identical requests are matched
+    UNKEYED_OPTIONS = (
+        "request_id",
+        "api_key",
+        "source_ip",
+        "creator",
+        "version",
+        "start_date",
+        "end_date",
+        "time_step",
+        "filename",
+        "format",
+        "compression",
+        "domains",
+        "dry_run",
+    )
+
+    # ...Domain settings which define its grid, keyed by the grid fingerprint
+    GRID_OPTIONS = (
+        "x_init",
+        "y_init",
+        "x_end",
+        "y_end",
+        "rotation",
+        "di",
+        "dj",
+        "ni",
+        "nj",
+        "predefined_domain",
+    )
+
+    # ...Output formats whose files can be cut to a window of their grid and
+    # a range of their records, see pymetbuild.OutputStitch.netcdf_window
+    WINDOW_FORMATS = ("owi-netcdf", "hec-netcdf")
+
+    def __init__(self, message: dict, progress=None) -> None:
+        """
+        Args:
+            message (dict): The request message
+            progress (callable): Called with the fraction of the build done,
+                0 to 1, about every tenth of the build. It runs on a worker
+                thread and may block, e.g. on the database
+        """
         self.__message = message
+        self.__progress = progress
         self.__input = Input(self.__message)
+        self.__statistics = {}
+        self.__field_statistics = {}
+        self.__met_field = None
+        self.__checkpoint = None
+        self.__publishing = False
+        self.__sharded = False
+        self.__data_type_key = None
+        self.__domain_data = []
+        self.__fetches = []
+        self.__fetch_pool = None
+        self.__upload_stream = None
+        self.__output_file_list = []
+        self.__files_used_list = {}
+        self.__request_key = None
+        self.__family_key = None
+        self.__family_files = []
+        self.__reused = False
 
     def input(self) -> Input:
         """
@@ -60,6 +161,25 @@ class MessageHandler:
         """
         return self.__input
 
+    def statistics(self) -> dict:
+        """
+        Returns the stage timings and counters of the last interpolation
+
+        Returns:
+            dict: Calls, seconds and items of each stage, keyed by stage name
+        """
+        return self.__statistics
+
+    def field_statistics(self) -> dict:
+        """
+        Returns the per time step field statistics of the last interpolation
+
+        Returns:
+            dict: List of steps with the minimum, maximum, mean and invalid
+            fraction of each field, keyed by domain name
+        """
+        return self.__field_statistics
+
     def process_message(self) -> bool:
         """
         Process a message from the queue of available messages
@@ -67,9 +187,116 @@ class MessageHandler:
         Returns:
             True if the message was processed successfully, False otherwise
         """
-        import json
+        if not self.__prepare(batched=False):
+            return False
+        if self.__reused:
+            return True
+        if self.__met_field:
+            MessageHandler.__build([self], self.__progress)
+        else:
+            self.__process_raw()
+        self.__finish()
+        return True
 
-        filelist_name = "filelist.json"
+    @staticmethod
+    def process_batch(handlers: list) -> list:
+        """
+        Processes several requests sharing source files in one build, so each
+        file is downloaded and decoded once for all of them. Each request
+        keeps its own output files, checkpoint and uploads. Requests must be
+        compatible, see MessageHandler.compatible, and are not published in
+        chunks while they are built
+
+        Args:
+            handlers (list): The handlers of the requests
+
+        Returns:
+            list: For each handler, True if the request was processed, False if
+            it is waiting on an archive restore
+        """
+        log = logging.getLogger(__name__)
+
+        status = [False] * len(handlers)
+        batch = []
+        for k, handler in enumerate(handlers):
+            if not handler.__prepare(batched=True):
+                continue
+            status[k] = True
+            if handler.__reused:
+                continue
+            if handler.__met_field:
+                batch.append(handler)
+            else:
+                handler.__process_raw()
+                handler.__finish()
+
+        if batch:
+            log.info("Building {:d} requests together".format(len(batch)))
+            reporters = [h.__progress for h in batch if h.__progress]
+
+            def progress(fraction: float) -> None:
+                for report in reporters:
+                    report(fraction)
+
+            MessageHandler.__build(batch, progress if reporters else None)
+            for handler in batch:
+                handler.__finish()
+        return status
+
+    @staticmethod
+    def compatible(first: Input, second: Input) -> bool:
+        """
+        Whether two requests can be built together. They must read the same
+        type of data from at least one common service, at the same time step,
+        with spans on each other's steps that overlap or meet, and write files
+        of different names. Previews are only built with other previews
+
+        Args:
+            first (Input): The first request
+            second (Input): The second request
+
+        Returns:
+            bool: True if the requests can share a build
+        """
+        if first.data_type() != second.data_type():
+            return False
+        if first.time_step() != second.time_step():
+            return False
+        if first.filename() == second.filename():
+            return False
+        if first.preview() != second.preview():
+            return False
+        step = timedelta(seconds=first.time_step())
+        if (
+            first.start_date() > second.end_date() + step
+            or second.start_date() > first.end_date() + step
+        ):
+            return False
+        offset = (first.start_date() - second.start_date()).total_seconds()
+        if offset % first.time_step() != 0:
+            return False
+
+        def services(input_data: Input) -> set:
+            return {
+                input_data.domain(i).service()
+                for i in range(input_data.num_domains())
+            }
+
+        return bool((services(first) & services(second)) - {"nhc"})
+
+    def __prepare(self, batched: bool) -> bool:
+        """
+        Generates the output of the request, finds its files and starts
+        downloading them
+
+        Args:
+            batched (bool): True if the request is built with others, in which
+                case it is not published in chunks
+
+        Returns:
+            bool: False if the request is waiting on an archive restore
+        """
+        import json
 
         log = logging.getLogger(__name__)
 
@@ -80,9 +307,7 @@ class MessageHandler:
             "Found {:d} domains in input request".format(self.__input.num_domains())
         )
 
-        start_date = self.__input.start_date()
         start_date_pmb = self.__input.start_date_pmb()
-        end_date = self.__input.end_date()
         end_date_pmb = self.__input.end_date_pmb()
         time_step = self.__input.time_step()
 
@@ -92,7 +317,26 @@ class MessageHandler:
             end_date_pmb,
             time_step,
             self.__input.filename(),
-            self.__input.compression(),
+            self.__input.compression_codec(),
+        )
+
+        # ...Sharded outputs are neither checkpointed nor published in chunks
+        sharded = MessageHandler.__shard_output(self.__input, met_field)
+        if sharded:
+            met_field = sharded
+
+        checkpoint = (
+            None if sharded else MessageHandler.__checkpoint_path(self.__input)
+        )
+        if met_field and checkpoint:
+            if os.path.exists(checkpoint) and met_field.resume(checkpoint):
+                log.info("Resuming request from checkpoint " + checkpoint)
+            met_field.set_checkpoint(checkpoint, MessageHandler.CHECKPOINT_INTERVAL)
+
+        publishing = (
+            not batched
+            and not sharded
+            and MessageHandler.__start_publication(self.__input, met_field)
         )
 
         log.info("Generating type key for {:s}".format(self.__input.data_type()))
@@ -111,21 +355,7 @@ class MessageHandler:
             d = self.__input.domain(i)
 
             log.info("Querying database for available data")
-            filelist = Filelist(
-                d.service(),
-                self.__input.data_type(),
-                start_date,
-                end_date,
-                d.tau(),
-                d.storm_year(),
-                d.storm(),
-                d.basin(),
-                d.advisory(),
-                self.__input.nowcast(),
-                self.__input.multiple_forecasts(),
-                d.ensemble_member(),
-            )
-            f = filelist.files()
+            f = MessageHandler.__domain_files(self.__input, d)
             log.info("Selected {:d} files for interpolation".format(len(f)))
 
             if d.service() == "nhc":
@@ -137,6 +367,27 @@ class MessageHandler:
                     raise RuntimeError("No data found for domain")
                 ongoing_restore = MessageHandler.__check_glacier_restore(d, f)
 
+        self.__met_field = met_field
+        self.__checkpoint = checkpoint
+        self.__publishing = publishing
+        self.__sharded = sharded is not None
+        self.__data_type_key = data_type_key
+        self.__domain_data = domain_data
+
+        # ...A request identical to one built earlier, on the same files, is
+        # answered with a copy of its output
+        result_cache = MessageHandler.__shared_result_cache()
+        if met_field and result_cache:
+            self.__request_key = MessageHandler.__request_key(
+                self.__input, data_type_key, db_files, nhc_data
+            )
+            if self.__reuse_result(result_cache) or self.__extract_result(
+                result_cache, db_files
+            ):
+                self.__discard()
+                self.__reused = True
+                return True
+
         # ...If restore ongoing, this is where we stop
         if ongoing_restore:
             log.info("Request is currently in restore status")
@@ -148,51 +399,243 @@ class MessageHandler:
                 self.__message,
                 "Job is in archive restore status",
             )
-            if met_field:
-                ff = met_field.filenames()
-                for f in ff:
-                    os.remove(f)
-                MessageHandler.__cleanup_temp_files(domain_data)
+            self.__discard()
             return False
 
-        # ...Begin downloading data from s3
-        MessageHandler.__download_files_from_s3(
+        # ...Begin downloading data from s3. Grib files that are read
+        # directly from memory keep downloading in the background while the
+        # request is interpolated, each one decoded as soon as it lands
+        self.__fetches = MessageHandler.__download_files_from_s3(
             db_files, domain_data, self.__input, met_field, nhc_data
         )
+        # ...Requests built together start one set of downloads between them
+        if not batched:
+            self.__fetch_pool = MessageHandler.__start_fetches(self.__fetches)
+        return True
 
-        if not met_field:
-            (
-                output_file_list,
-                files_used_list,
-            ) = MessageHandler.__generate_raw_files_list(domain_data, self.__input)
-        else:
-            (
-                output_file_list,
-                files_used_list,
-            ) = MessageHandler.__interpolate_wind_fields(
-                self.__input,
-                met_field,
-                data_type_key,
-                domain_data,
-                start_date,
-                end_date,
-                time_step,
+    @staticmethod
+    def __domain_files(input_data: Input, d) -> list:
+        """
+        Queries the database for the files a domain of a request reads
+
+        Args:
+            input_data (Input): The input data
+            d (Domain): The domain
+
+        Returns:
+            list: The files, each with its path and forecast time
+        """
+        return Filelist(
+            d.service(),
+            input_data.data_type(),
+            input_data.start_date(),
+            input_data.end_date(),
+            d.tau(),
+            d.storm_year(),
+            d.storm(),
+            d.basin(),
+            d.advisory(),
+            input_data.nowcast(),
+            input_data.multiple_forecasts(),
+            d.ensemble_member(),
+        ).files()
+
+    @staticmethod
+    def prefetch(message: dict) -> int:
+        """
+        Pulls the source files of a request still waiting on the queue into
+        the node-local file cache, so that most of them are local by the time
+        it is built. The files are found as the build finds them, and the
+        grib files are fetched as the same byte ranges. Storm tracks and
+        COAMPS files read by byte range are left to the build. Nothing is
+        fetched when the file cache is disabled, and failures are only logged
+
+        Args:
+            message (dict): The request message
+
+        Returns:
+            int: Number of files downloaded into the cache
+        """
+        log = logging.getLogger(__name__)
+        if not FileCache().enabled():
+            return 0
+
+        count = 0
+        try:
+            input_data = Input(message)
+            s3 = S3file(os.environ["METGET_S3_BUCKET"])
+            raw = input_data.format() == "raw"
+            for i in range(input_data.num_domains()):
+                d = input_data.domain(i)
+                coamps = d.service() in ("coamps-tc", "coamps-ctcx")
+                if d.service() == "nhc":
+                    continue
+                if coamps and not raw and MessageHandler.__coamps_byte_range():
+                    continue
+                s3_remote = MessageHandler.__generate_noaa_s3_remote_instance(
+                    d.service()
+                )
+                for item in MessageHandler.__domain_files(input_data, d):
+                    paths = [item["filepath"]]
+                    if coamps:
+                        paths = item["filepath"].split(",")
+                    for path in paths:
+                        try:
+                            if "s3://" in path:
+                                success, _, byte_ranges = s3_remote.plan(
+                                    path, input_data.data_type()
+                                )
+                                fetched = success and s3_remote.prefetch(
+                                    path, byte_ranges
+                                )
+                            else:
+                                if not raw and not coamps:
+                                    path = MessageHandler.__archived_source_path(
+                                        s3, path, d
+                                    )
+                                fetched = s3.prefetch(path)
+                        except Exception as e:
+                            log.warning(
+                                "Could not prefetch {:s}: {:s}".format(path, str(e))
+                            )
+                            continue
+                        if fetched:
+                            count += 1
+        except Exception as e:
+            log.warning("Could not prefetch request: " + str(e))
+        return count
+
+    def __process_raw(self) -> None:
+        """
+        Lists the downloaded files of a request for raw output
+        """
+        fetch_pool = self.__fetch_pool or MessageHandler.__start_fetches(
+            self.__fetches
+        )
+        (
+            self.__output_file_list,
+            self.__files_used_list,
+        ) = MessageHandler.__generate_raw_files_list(self.__domain_data, self.__input)
+        fetch_pool.shutdown(wait=True)
+
+    def __discard(self) -> None:
+        """
+        Removes the output files, temporary files and checkpoint of a request
+        which is not built now
+        """
+        if self.__met_field:
+            for f in self.__met_field.filenames():
+                if os.path.exists(f):
+                    os.remove(f)
+            MessageHandler.__cleanup_temp_files(self.__domain_data)
+        self.__met_field = None
+        if self.__checkpoint and os.path.exists(self.__checkpoint):
+            os.remove(self.__checkpoint)
+
+    @staticmethod
+    def __build(handlers: list, progress=None) -> None:
+        """
+        Interpolates the requests of the handlers in one build, uploading the
+        output of each one while it is written when its format allows
+
+        Args:
+            handlers (list): The prepared handlers
+            progress (callable): Called with the fraction of the build done
+        """
+        fetches = list(
+            {f["name"]: f for h in handlers for f in h.__fetches}.values()
+        )
+        fetch_pool = handlers[0].__fetch_pool or MessageHandler.__start_fetches(
+            fetches
+        )
+
+        for handler in handlers:
+            handler.__upload_stream = MessageHandler.__start_upload_stream(
+                handler.__input, handler.__met_field
+            )
+        try:
+            results, statistics = MessageHandler.__interpolate_wind_fields(
+                [
+                    (h.__input, h.__met_field, h.__data_type_key, h.__domain_data)
+                    for h in handlers
+                ],
+                progress,
             )
+        except Exception:
+            for handler in handlers:
+                if handler.__upload_stream:
+                    handler.__upload_stream.abort()
+            raise
+        finally:
+            fetch_pool.shutdown(wait=True)
+            for fetch in fetches:
+                pymetbuild.remove_file_buffer(fetch["name"])
+
+        for handler, result in zip(handlers, results):
+            (
+                handler.__output_file_list,
+                handler.__files_used_list,
+                handler.__field_statistics,
+            ) = result
+            handler.__statistics = statistics
+
+    def __finish(self) -> None:
+        """
+        Uploads the output and file list of a built request and removes its
+        local files
+        """
+        import json
+
+        filelist_name = "filelist.json"
+
+        log = logging.getLogger(__name__)
 
         output_file_dict = {
             "input": self.__input.json(),
-            "input_files": files_used_list,
-            "output_files": output_file_list,
+            "input_files": self.__files_used_list,
+            "output_files": self.__output_file_list,
         }
-
-        met_field = None  # ... This assignment closes all open files
+        if self.__statistics:
+            output_file_dict["statistics"] = self.__statistics
+        if self.__field_statistics:
+            output_file_dict["field_statistics"] = self.__field_statistics
+
+        shard_count = self.__met_field.shard_count() if self.__sharded else 0
+        self.__met_field = None  # ... This assignment closes all open files
+
+        # ...Checksums computed while the files were written, used to check
+        # the uploads and recorded so the files can be verified once fetched
+        checksums = MessageHandler.__output_checksums(self.__output_file_list)
+        if checksums:
+            output_file_dict["output_checksums"] = {
+                f: {"size": c["size"], "md5": c["md5"], "etag": c["etag"]}
+                for f, c in checksums.items()
+            }
 
         # ...Posts the data out to the correct S3 location
         s3up = S3file(os.environ["METGET_S3_BUCKET_UPLOAD"])
-        for f in output_file_list:
-            path = os.path.join(self.__input.request_id(), f)
-            s3up.upload_file(f, path)
+        streamed = self.__upload_stream.finish() if self.__upload_stream else []
+        uploads = [f for f in self.__output_file_list if f not in streamed]
+        if self.__sharded:
+            uploads.append(MessageHandler.SHARD_MANIFEST_FILENAME)
+        MessageHandler.__upload_files(
+            s3up, self.__input.request_id(), uploads, checksums
+        )
+        for f in self.__output_file_list:
             os.remove(f)
+        if self.__sharded:
+            os.remove(MessageHandler.SHARD_MANIFEST_FILENAME)
+
+        # ...Zarr stores leave their now empty group and array directories
+        if self.__input.format() == "zarr":
+            stores = [self.__input.filename()]
+            if self.__sharded:
+                stores = [
+                    pymetbuild.ShardedOutput.shard_name(self.__input.filename(), k)
+                    for k in range(shard_count)
+                ]
+            for store in stores:
+                shutil.rmtree(store, ignore_errors=True)
 
         with open(filelist_name, "w") as of:
             of.write(json.dumps(output_file_dict, indent=2))
@@ -202,9 +645,39 @@ class MessageHandler:
         log.info("Finished processing message with id")
         os.remove(filelist_name)
 
-        MessageHandler.__cleanup_temp_files(domain_data)
+        result_cache = MessageHandler.__shared_result_cache()
+        if self.__request_key and result_cache:
+            outputs = list(self.__output_file_list)
+            if self.__sharded:
+                outputs.append(MessageHandler.SHARD_MANIFEST_FILENAME)
+            result_cache.record(self.__request_key, self.__input.request_id(), outputs)
+            if self.__family_key and not self.__sharded and len(outputs) == 1:
+                result_cache.record_build(
+                    self.__family_key,
+                    {
+                        "request_id": self.__input.request_id(),
+                        "output_files": outputs,
+                        "domain": self.__input.domain(0).json(),
+                        "start": self.__input.start_date().isoformat(),
+                        "end": self.__input.end_date().isoformat(),
+                        "files": self.__family_files,
+                    },
+                )
+
+        if os.path.exists(MessageHandler.TRACE_FILENAME):
+            trace_path = os.path.join(
+                self.__input.request_id(), MessageHandler.TRACE_FILENAME
+            )
+            s3up.upload_file(MessageHandler.TRACE_FILENAME, trace_path)
+            os.remove(MessageHandler.TRACE_FILENAME)
 
-        return True
+        if self.__publishing and os.path.exists(MessageHandler.MANIFEST_FILENAME):
+            os.remove(MessageHandler.MANIFEST_FILENAME)
+
+        MessageHandler.__cleanup_temp_files(self.__domain_data)
+
+        if self.__checkpoint and os.path.exists(self.__checkpoint):
+            os.remove(self.__checkpoint)
 
     @staticmethod
     def __date_span(start_date: datetime, end_date: datetime, delta: timedelta):
@@ -289,7 +762,7 @@ class MessageHandler:
         end: datetime,
         time_step: int,
         filename: str,
-        compression: bool,
+        compression: str,
     ):
         """
         Generate the met field object from the pymetbuild library
@@ -300,21 +773,33 @@ class MessageHandler:
             end: The end date
             time_step: The time step in seconds
             filename: The filename to write to
-            compression: Whether to compress the output
+            compression: Codec used to compress the ascii and binary output,
+                "none", "gzip", "zstd" or "lz4"
         """
+        codec = pymetbuild.StreamCompression.fromName(compression)
 
         if (
             output_format == "ascii"
             or output_format == "owi-ascii"
             or output_format == "adcirc-ascii"
         ):
-            return pymetbuild.OwiAscii(start, end, time_step, compression)
+            met_field = pymetbuild.OwiAscii(start, end, time_step)
+            met_field.set_compression(codec)
+            return met_field
+        elif output_format == "owi-binary" or output_format == "adcirc-binary":
+            met_field = pymetbuild.OwiBinary(start, end, time_step)
+            met_field.set_compression(codec)
+            return met_field
         elif output_format == "owi-netcdf" or output_format == "adcirc-netcdf":
             return pymetbuild.OwiNetcdf(start, end, time_step, filename)
         elif output_format == "hec-netcdf":
             return pymetbuild.RasNetcdf(start, end, time_step, filename)
         elif output_format == "delft3d":
             return pymetbuild.DelftOutput(start, end, time_step, filename)
+        elif output_format == "zarr":
+            return pymetbuild.ZarrOutput(start, end, time_step, filename)
+        elif output_format == "grib2":
+            return pymetbuild.GribOutput(start, end, time_step)
         elif output_format == "raw":
             return None
         else:
@@ -338,10 +823,14 @@ class MessageHandler:
 
         d = input_data.domain(index)
         output_format = input_data.format()
+        is_binary = (
+            output_format == "owi-binary" or output_format == "adcirc-binary"
+        )
         if (
             output_format == "ascii"
             or output_format == "owi-ascii"
             or output_format == "adcirc-ascii"
+            or is_binary
         ):
             if input_data.data_type() == "wind_pressure":
                 fn1 = input_data.filename() + "_" + "{:02d}".format(index) + ".pre"
@@ -355,15 +844,18 @@ class MessageHandler:
                 fns = [input_data.filename() + ".ice"]
             else:
                 raise RuntimeError("Invalid variable requested")
-            if input_data.compression():
-                for i, s in enumerate(fns):
-                    fns[i] = s + ".gz"
+            if is_binary:
+                fns = [s + ".bin" for s in fns]
+            extension = pymetbuild.StreamCompression.extension(
+                pymetbuild.StreamCompression.fromName(input_data.compression_codec())
+            )
+            fns = [s + extension for s in fns]
 
             met_object.addDomain(d.grid().grid_object(), fns)
         elif output_format == "owi-netcdf":
             group = d.name()
             met_object.addDomain(d.grid().grid_object(), [group])
-        elif output_format == "hec-netcdf":
+        elif output_format == "hec-netcdf" or output_format == "zarr":
             if input_data.data_type() == "wind_pressure":
                 variables = ["wind_u", "wind_v", "mslp"]
             elif input_data.data_type() == "wind":
@@ -391,6 +883,13 @@ class MessageHandler:
             else:
                 raise RuntimeError("Invalid variable requested")
             met_object.addDomain(d.grid().grid_object(), variables)
+        elif output_format == "grib2":
+            fns = [input_data.filename() + "_" + "{:02d}".format(index) + ".grib2"]
+            if input_data.data_type() in ["rain", "humidity", "ice"]:
+                fns.append(input_data.data_type())
+            elif input_data.data_type() != "wind_pressure":
+                raise RuntimeError("Invalid variable requested")
+            met_object.addDomain(d.grid().grid_object(), fns)
         else:
             raise RuntimeError("Invalid output format selected: " + output_format)
 
@@ -466,219 +965,1192 @@ class MessageHandler:
         return output_file
 
     @staticmethod
-    def __interpolate_wind_fields(
-        input_data,
-        met_field,
-        data_type_key,
-        domain_data,
-        start_date,
-        end_date,
-        time_step,
-    ) -> Tuple[list, dict]:
+    def __interpolate_wind_fields(jobs: list, progress=None) -> Tuple[list, dict]:
         """
-        Interpolates the wind fields for the given domains
+        Interpolates the wind fields of one or more requests in one build.
+        The outputs of several requests are written through an output group,
+        with the domains of each request numbered after those of the requests
+        before it, so files and decoded sources shared between the requests
+        are only read once
 
         Args:
-            input_data (Input): The input data
-            met_field (Meteorology): The meteorology object
-            data_type_key (int): The data type key
-            domain_data (list): The list of domain data
-            start_date (datetime): The start date
-            end_date (datetime): The end date
-            time_step (int): The time step
+            jobs (list): The input data, output file, data type key and
+                domain data of each request
+            progress (callable): Called with the fraction of the build done
 
         Returns:
-            Tuple[list, dict]: The list of output files and the list of files used
+            Tuple[list, dict]: The list of output files, files used and field
+            statistics of each request, and the stage statistics of the build
         """
-        from datetime import timedelta
-
         log = logging.getLogger(__name__)
 
-        files_used_list = {}
-
-        for i in range(input_data.num_domains()):
-            d = input_data.domain(i)
-
-            if d.service() == "nhc":
-                log.error("NHC to gridded data not implemented")
-                raise RuntimeError("NHC to gridded data no implemented")
+        start_date = min(job[0].start_date() for job in jobs)
+        end_date = max(job[0].end_date() for job in jobs)
+        time_step = jobs[0][0].time_step()
 
-            source_key = MessageHandler.__generate_data_source_key(d.service())
-            met = pymetbuild.Meteorology(
-                d.grid().grid_object(),
-                source_key,
-                data_type_key,
-                input_data.backfill(),
-                input_data.epsg(),
+        if len(jobs) == 1:
+            met_field = jobs[0][1]
+            offsets = [0]
+        else:
+            met_field = pymetbuild.OutputGroup(
+                Input.date_to_pmb(start_date), Input.date_to_pmb(end_date), time_step
             )
+            offsets = [met_field.add(job[1]) for job in jobs]
+
+        # The whole request is run natively: every domain is decoded,
+        # interpolated and written by its own pipeline, all running at the
+        # same time, and the GIL is released until they finish
+        request = pymetbuild.BuildRequest(
+            met_field,
+            Input.date_to_pmb(start_date),
+            Input.date_to_pmb(end_date),
+            time_step,
+        )
 
-            t0 = domain_data[i][0]["time"]
-
-            domain_files_used = []
-            next_time = start_date + timedelta(seconds=time_step)
-            index = MessageHandler.__get_next_file_index(next_time, domain_data[i])
+        # Each output step is reduced to the range, mean and invalid fraction
+        # of its fields as it is interpolated, for sanity checks downstream
+        request.set_step_statistics(True)
 
-            t1 = domain_data[i][index]["time"]
-            ff = domain_data[i][0]["filepath"]
-            MessageHandler.__print_file_status(ff, t0)
+        # Previews give every point the value of the nearest source point,
+        # which is much cheaper to set up than the triangular weights
+        if jobs[0][0].preview():
+            request.set_interpolation_method(
+                pymetbuild.Meteorology.NEAREST_NEIGHBOUR
+            )
 
-            met.set_next_file(ff)
-            if d.service() == "coamps-tc" or d.service() == "coamps-ctcx":
-                for ff in domain_data[i][0]["filepath"]:
-                    domain_files_used.append(os.path.basename(ff))
-            else:
-                domain_files_used.append(
-                    os.path.basename(domain_data[i][0]["filepath"])
-                )
+        # Interpolation weights built by earlier requests on any worker are
+        # fetched before the run, and new ones are published after it, along
+        # with the triangulations of the source grids they were built on
+        weight_cache = MessageHandler.__shared_weight_cache()
+        weight_domains = {}
+        weight_services = set()
+
+        for (input_data, _, data_type_key, domain_data), offset in zip(jobs, offsets):
+            for i in range(input_data.num_domains()):
+                d = input_data.domain(i)
+
+                # Storm tracks are gridded with a parametric vortex, using the
+                # merged track when both a best track and forecast are present
+                if d.service() == "nhc":
+                    if input_data.data_type() != "wind_pressure":
+                        log.error("NHC tracks only provide wind and pressure")
+                        raise RuntimeError("NHC tracks only provide wind and pressure")
+                    request.add_vortex_domain(
+                        offset + i,
+                        d.grid().grid_object(),
+                        domain_data[i][-1]["filepath"],
+                    )
+                    continue
 
-            met.set_next_file(domain_data[i][index]["filepath"])
-            ff = domain_data[i][index]["filepath"]
-            MessageHandler.__print_file_status(ff, t1)
-            met.process_data()
-            if d.service() == "coamps-tc" or d.service() == "coamps-ctcx":
-                for ff in domain_data[i][index]["filepath"]:
-                    domain_files_used.append(os.path.basename(ff))
-            else:
-                domain_files_used.append(
-                    os.path.basename(domain_data[i][index]["filepath"])
+                if weight_cache:
+                    weight_domains[offset + i] = WeightCache.domain_key(
+                        d.service(), d.grid().grid_object(), input_data.epsg()
+                    )
+                    weight_cache.fetch(weight_domains[offset + i])
+                    if d.service() not in weight_services:
+                        weight_services.add(d.service())
+                        weight_cache.fetch_locators(d.service())
+
+                source_key = MessageHandler.__generate_data_source_key(d.service())
+                request.add_domain(
+                    offset + i,
+                    d.grid().grid_object(),
+                    source_key,
+                    data_type_key,
+                    input_data.backfill(),
+                    input_data.epsg(),
                 )
+                for entry in domain_data[i]:
+                    request.add_file(
+                        offset + i, entry["filepath"], Input.date_to_pmb(entry["time"])
+                    )
 
-            for t in MessageHandler.__date_span(
-                start_date, end_date, timedelta(seconds=time_step)
-            ):
-                if t > t1:
-                    index = MessageHandler.__get_next_file_index(t, domain_data[i])
-                    t0 = t1
-                    t1 = domain_data[i][index]["time"]
-                    ff = domain_data[i][index]["filepath"]
-                    MessageHandler.__print_file_status(ff, t1)
-                    met.set_next_file(domain_data[i][index]["filepath"])
-                    if t0 != t1:
-                        if d.service() == "coamps-tc" or d.service() == "coamps-ctcx":
-                            for ff in domain_data[i][index]["filepath"]:
-                                domain_files_used.append(os.path.basename(ff))
-                        else:
-                            domain_files_used.append(
-                                os.path.basename(domain_data[i][index]["filepath"])
-                            )
-                    met.process_data()
+        # Performance settings come from the METBUILD_ environment of the
+        # deployment, see ExecutionPolicy, and are planned for the request
+        # unless METGET_EXECUTION_PLANNER is 0. Both are logged
+        policy = pymetbuild.ExecutionPolicy()
+        log.info("Execution policy: {:s}".format(policy.describe()))
+        if os.environ.get("METGET_EXECUTION_PLANNER", "1") != "0":
+            weights_cached = bool(weight_domains) and all(
+                weight_cache.cached(k) for k in weight_domains.values()
+            )
+            plan = MessageHandler.__execution_plan(jobs, policy, weights_cached)
+            log.info("Execution plan: {:s}".format(plan.describe()))
+            policy = plan.policy()
+        request.set_execution_policy(policy)
 
-                if t < t0 or t > t1:
-                    weight = -1.0
-                elif t0 == t1:
-                    weight = 0.0
-                else:
-                    weight = met.generate_time_weight(
-                        Input.date_to_pmb(t0),
-                        Input.date_to_pmb(t1),
-                        Input.date_to_pmb(t),
-                    )
+        # Very large grids are interpolated in bands of rows so that the
+        # memory used stays within the budget, given in bytes
+        memory_budget = os.environ.get("METGET_MEMORY_BUDGET")
+        if memory_budget:
+            request.set_memory_budget(int(memory_budget))
 
+        log.info(
+            "Processing {:d} domains of {:d} requests from {:s} to {:s}".format(
+                sum(job[0].num_domains() for job in jobs),
+                len(jobs),
+                start_date.strftime("%Y-%m-%d %H:%M"),
+                end_date.strftime("%Y-%m-%d %H:%M"),
+            )
+        )
+        # Chunks are only published for a request built on its own
+        publish = None
+        if len(jobs) == 1:
+            publish = MessageHandler.__publication_reporter(jobs[0][0], met_field)
+        # A timeline of every stage on every thread is recorded on request
+        # so that stalls between decoding, writing and downloads can be seen
+        trace = os.environ.get("METGET_TRACE")
+        if trace:
+            pymetbuild.Instrumentation.start_trace()
+        pymetbuild.LocatorCache.clear_used_keys()
+        # The build runs on its own thread while the event loop reports its
+        # progress, so slow database updates never hold up the build
+        try:
+            files_used = asyncio.run(
+                request.run_async(
+                    progress=MessageHandler.__progress_reporter(progress),
+                    publish=publish,
+                )
+            )
+        finally:
+            if trace:
+                pymetbuild.Instrumentation.stop_trace()
+                pymetbuild.Instrumentation.write_trace(MessageHandler.TRACE_FILENAME)
+        for i, domain_key in weight_domains.items():
+            weight_cache.publish(domain_key, list(request.weight_keys(i)))
+        # ...Triangulations are not tracked per domain, so each service lists
+        # every one this build used. A key of another service is never
+        # requested by its grids and only costs a lookup on the next fetch
+        locator_keys = list(pymetbuild.LocatorCache.used_keys())
+        for service in weight_services:
+            weight_cache.publish_locators(service, locator_keys)
+        report = request.statistics()
+        statistics = MessageHandler.__statistics_to_dict(report)
+        memory = MessageHandler.__memory_to_dict(report)
+
+        results = []
+        for (input_data, output, _, _), offset in zip(jobs, offsets):
+            field_statistics = {}
+            files_used_list = {}
+            for i in range(input_data.num_domains()):
+                steps = MessageHandler.__field_statistics_to_list(
+                    request.step_statistics(offset + i)
+                )
+                if steps:
+                    field_statistics[input_data.domain(i).name()] = steps
+                # ...Presigned urls keep their credentials out of the record
+                files_used_list[input_data.domain(i).name()] = [
+                    os.path.basename(ff.split("?")[0]) for ff in files_used[offset + i]
+                ]
+            results.append((output.filenames(), files_used_list, field_statistics))
+        del request
+
+        for stage, values in statistics.items():
+            if values["calls"] > 0:
                 log.info(
-                    "Processing time {:s}, weight = {:f}".format(
-                        t.strftime("%Y-%m-%d %H:%M"), weight
+                    "Stage {:s}: {:d} calls, {:.3f} s, {:d} items".format(
+                        stage, values["calls"], values["seconds"], values["items"]
                     )
                 )
-
+            if "counters" in values:
                 log.info(
-                    "Interpolating domain {:d}, snap {:s} to grid".format(
-                        i, t.strftime("%Y-%m-%d %H:%M")
+                    "Stage {:s}: {:.2f} IPC, {:.2f} LLC MPKI, "
+                    "{:.2f} branch MPKI".format(
+                        stage,
+                        values["counters"]["ipc"],
+                        values["counters"]["llc_mpki"],
+                        values["counters"]["branch_mpki"],
                     )
                 )
-                if input_data.data_type() == "wind_pressure":
-                    values = met.to_wind_grid(weight)
-                else:
-                    values = met.to_grid(weight)
-
+        for category, peak in memory["peak_bytes"].items():
+            if peak > 0:
                 log.info(
-                    "Writing domain {:d}, snap {:s} to disk".format(
-                        i, t.strftime("%Y-%m-%d %H:%M")
-                    )
+                    "Memory {:s}: peak {:.1f} MiB".format(category, peak / 1048576.0)
                 )
-                met_field.write(Input.date_to_pmb(t), i, values)
-
-            files_used_list[input_data.domain(i).name()] = domain_files_used
-
-        output_file_list = met_field.filenames()
+        log.info(
+            "Peak resident set size: {:.1f} MiB".format(
+                memory["peak_rss_bytes"] / 1048576.0
+            )
+        )
 
-        return output_file_list, files_used_list
+        return results, statistics
 
-    @staticmethod
-    def __generate_raw_files_list(domain_data, input_data) -> Tuple[list, dict]:
+    def __reuse_result(self, result_cache: ResultCache) -> bool:
         """
-        Generates the list of raw files used for the given domains
+        Copies the output of an earlier request with the same key as this one
+        to the location of this request and writes its file list
 
         Args:
-            domain_data (list): The list of domain data
-            input_data (Input): The input data
+            result_cache (ResultCache): The index of built requests
 
         Returns:
-            Tuple[list, dict]: The list of raw files and the list of files used
+            bool: True if the output was reused, False if it must be built
         """
-        output_file_list = []
-        files_used_list = {}
-        for i in range(input_data.num_domains()):
-            for pr in domain_data[i]:
-                output_file_list.append(pr["filepath"])
-            files_used_list[input_data.domain(i).name()] = output_file_list
-        return output_file_list, files_used_list
+        import json
 
-    @staticmethod
-    def __download_files_from_s3(
-        db_files, domain_data, input_data, met_field, nhc_data
-    ) -> None:
+        log = logging.getLogger(__name__)
+
+        entry = result_cache.lookup(self.__request_key)
+        if not entry or entry["request_id"] == self.__input.request_id():
+            return False
+
+        s3up = S3file(os.environ["METGET_S3_BUCKET_UPLOAD"])
+        filelist_name = "filelist.json"
+        filelist_path = os.path.join(entry["request_id"], filelist_name)
+        if not s3up.exists(filelist_path):
+            return False
+        if not result_cache.reuse(entry, self.__input.request_id()):
+            return False
+
+        # ...The file list of the earlier request gives the files used, only
+        # the input and origin are replaced
+        local_file = s3up.download(filelist_path, "result")
+        with open(local_file) as f:
+            output_file_dict = json.load(f)
+        os.remove(local_file)
+        output_file_dict["input"] = self.__input.json()
+        output_file_dict["reused_from"] = entry["request_id"]
+        output_file_dict.pop("statistics", None)
+        with open(filelist_name, "w") as of:
+            of.write(json.dumps(output_file_dict, indent=2))
+        s3up.upload_file(
+            filelist_name, os.path.join(self.__input.request_id(), filelist_name)
+        )
+        os.remove(filelist_name)
+
+        log.info(
+            "Reused the output of request {:s}, key {:s}".format(
+                entry["request_id"], self.__request_key
+            )
+        )
+        return True
+
+    def __extract_result(self, result_cache: ResultCache, db_files: list) -> bool:
         """
-        Downloads the files from S3 and generates the list of files used
+        Cuts the output of this request from that of an earlier build of the
+        same family, see __family_key, whose grid holds the grid of this
+        request at the same spacing and alignment, whose dates cover those of
+        this request and whose files include the files of this request
 
         Args:
-            db_files (list): The list of files from the database
-            domain_data (list): The list of domain data
-            input_data (Input): The input data
-            met_field (MeteorologyField): The meteorology field
-            nhc_data (dict): The list of NHC data
+            result_cache (ResultCache): The index of built requests
+            db_files (list): The files of each gridded domain, in order
 
         Returns:
-            None
+            bool: True if the output was cut, False if it must be built
         """
-        for i in range(input_data.num_domains()):
-            d = input_data.domain(i)
-            domain_data.append([])
-
-            if d.service() == "nhc":
-                MessageHandler.__generate_merged_nhc_files(
-                    d, domain_data, i, met_field, nhc_data
-                )
-            else:
-                MessageHandler.__get_2d_forcing_files(
-                    input_data.data_type(), d, db_files, domain_data, i, met_field
-                )
-
-    @staticmethod
-    def __generate_noaa_s3_remote_instance(data_type: str) -> S3GribIO:
+        self.__family_key = MessageHandler.__family_key(
+            self.__input, self.__data_type_key
+        )
+        if not self.__family_key or len(self.__met_field.filenames()) != 1:
+            self.__family_key = None
+            return False
+        self.__family_files = [
+            "{:s}@{:s}".format(item["filepath"], str(item["forecasttime"]))
+            for item in db_files[0]
+        ]
+
+        grid = self.__input.domain(0).grid().grid_object()
+        start = self.__input.start_date()
+        end = self.__input.end_date()
+        files = set(self.__family_files)
+        for build in result_cache.builds(self.__family_key):
+            try:
+                if (
+                    build["request_id"] == self.__input.request_id()
+                    or datetime.fromisoformat(build["start"]) > start
+                    or datetime.fromisoformat(build["end"]) < end
+                    or not files.issubset(build["files"])
+                ):
+                    continue
+                window = WindGrid(build["domain"]).grid_object().window(grid)
+            except (KeyError, TypeError, ValueError, RuntimeError):
+                continue
+            if window is not None and self.__cut_result(build, window, db_files):
+                return True
+        return False
+
+    def __cut_result(self, build: dict, window: tuple, db_files: list) -> bool:
         """
-        Generates the remote s3 grib instance for NOAA S3 archived files
+        Writes the output of this request from the output of a larger build
+        and uploads it with its file list
 
         Args:
-            data_type (str): The data type
+            build (dict): The build, as recorded by ResultCache.record_build
+            window (tuple): Nodes of the grid of the build holding the grid of
+                this request, as (i0, j0, ni, nj)
+            db_files (list): The files of each gridded domain, in order
 
         Returns:
-            S3GribIO: The remote s3 grib instance
+            bool: False if the output of the build could not be read or cut
         """
-        from metbuild.gribdataattributes import (
-            NCEP_NAM,
-            NCEP_GFS,
-            NCEP_GEFS,
-            NCEP_HRRR,
-            NCEP_HRRR_ALASKA,
-            NCEP_WPC,
-        )
+        import json
 
-        remote = None
+        log = logging.getLogger(__name__)
 
-        if data_type == "gfs-ncep":
-            grib_attrs = NCEP_GFS
-        elif data_type == "nam-ncep":
-            grib_attrs = NCEP_NAM
+        s3up = S3file(os.environ["METGET_S3_BUCKET_UPLOAD"])
+        source = os.path.join(build["request_id"], build["output_files"][0])
+        if not s3up.exists(source):
+            return False
+
+        output = self.__met_field.filenames()[0]
+        cut = "window_" + os.path.basename(output)
+        local_file = s3up.download(source, "result")
+        try:
+            pymetbuild.OutputStitch.netcdf_window(
+                local_file,
+                cut,
+                list(window),
+                self.__input.start_date_pmb(),
+                self.__input.end_date_pmb(),
+            )
+        except RuntimeError as e:
+            log.warning(
+                "Could not cut the output of request {:s}: {:s}".format(
+                    build["request_id"], str(e)
+                )
+            )
+            if os.path.exists(cut):
+                os.remove(cut)
+            return False
+        finally:
+            os.remove(local_file)
+
+        s3up.upload_file(cut, os.path.join(self.__input.request_id(), output))
+        os.remove(cut)
+
+        filelist_name = "filelist.json"
+        output_file_dict = {
+            "input": self.__input.json(),
+            "input_files": {
+                self.__input.domain(0).name(): [
+                    os.path.basename(item["filepath"].split("?")[0])
+                    for item in db_files[0]
+                ]
+            },
+            "output_files": [output],
+            "extracted_from": build["request_id"],
+        }
+        with open(filelist_name, "w") as of:
+            of.write(json.dumps(output_file_dict, indent=2))
+        s3up.upload_file(
+            filelist_name, os.path.join(self.__input.request_id(), filelist_name)
+        )
+        os.remove(filelist_name)
+
+        log.info(
+            "Cut the output of request {:s} to window {:s}".format(
+                build["request_id"], str(window)
+            )
+        )
+        return True
+
+    @staticmethod
+    def __family_key(input_data: Input, data_type_key: int):
+        """
+        Generates the key of the family of a request, its settings other than
+        the grid, dates and filename, for requests on a single gridded domain
+        in one of the WINDOW_FORMATS
+
+        Args:
+            input_data (Input): The request
+            data_type_key (int): The type of data interpolated
+
+        Returns:
+            str: The key, or None if the request cannot be cut from another
+        """
+        import hashlib
+        import json
+
+        if (
+            input_data.format() not in MessageHandler.WINDOW_FORMATS
+            or input_data.num_domains() != 1
+            or input_data.domain(0).service() == "nhc"
+        ):
+            return None
+
+        d = input_data.domain(0)
+        family = {
+            "format": input_data.format(),
+            "time_step": input_data.time_step(),
+            "compression": input_data.compression_codec(),
+            "data_type": data_type_key,
+            "service": MessageHandler.__generate_data_source_key(d.service()),
+            "backfill": input_data.backfill(),
+            "epsg": input_data.epsg(),
+            "name": d.name(),
+            "options": {
+                name: value
+                for name, value in input_data.json().items()
+                if name not in MessageHandler.UNKEYED_OPTIONS
+            },
+            "domain": {
+                name: value
+                for name, value in d.json().items()
+                if name not in MessageHandler.GRID_OPTIONS
+            },
+        }
+        return hashlib.sha256(
+            json.dumps(family, sort_keys=True, default=str).encode()
+        ).hexdigest()
+
+    @staticmethod
+    def __request_key(
+        input_data: Input, data_type_key: int, db_files: list, nhc_data: dict
+    ) -> str:
+        """
+        Generates the key of a request over its normalized settings and the
+        files resolved for each of its domains
+
+        Args:
+            input_data (Input): The request
+            data_type_key (int): The type of data interpolated
+            db_files (list): The files of each gridded domain, in order
+            nhc_data (dict): The storm tracks of each nhc domain, by index
+
+        Returns:
+            str: The key, see pymetbuild.RequestKey
+        """
+        import json
+
+        def canonical(value) -> str:
+            return json.dumps(value, sort_keys=True, default=str)
+
+        key = pymetbuild.RequestKey(
+            input_data.start_date_pmb(),
+            input_data.end_date_pmb(),
+            input_data.time_step(),
+            input_data.format(),
+            input_data.filename(),
+            input_data.compression_codec(),
+        )
+        for name, value in input_data.json().items():
+            if name not in MessageHandler.UNKEYED_OPTIONS:
+                key.add_option(name, canonical(value))
+
+        files = iter(db_files)
+        for i in range(input_data.num_domains()):
+            d = input_data.domain(i)
+            for name, value in d.json().items():
+                if name not in MessageHandler.GRID_OPTIONS:
+                    key.add_option(
+                        "domains.{:d}.{:s}".format(i, name), canonical(value)
+                    )
+
+            if d.service() == "nhc":
+                key.add_vortex_domain(d.grid().grid_object())
+                # ...Tracks are updated in place, so their end is keyed too
+                for track in nhc_data[i].values():
+                    if track:
+                        key.add_file(
+                            "{:s}@{:s}".format(track["filepath"], str(track["end"])),
+                            Input.date_to_pmb(track["start"]),
+                        )
+                continue
+
+            key.add_domain(
+                d.grid().grid_object(),
+                MessageHandler.__generate_data_source_key(d.service()),
+                data_type_key,
+                input_data.backfill(),
+                input_data.epsg(),
+            )
+            for item in next(files):
+                key.add_file(item["filepath"], Input.date_to_pmb(item["forecasttime"]))
+        return key.key()
+
+    @staticmethod
+    def __execution_plan(jobs: list, policy, weights_cached: bool):
+        """
+        Plans the build of one or more requests from their estimate and the
+        limits of the container, see pymetbuild.ExecutionPlan. The requests
+        are estimated with the output format of the first. The number of
+        shards is chosen over METGET_SHARD_WORKERS workers, for requests
+        longer than METGET_SHARD_SECONDS, and only reported since the shards
+        are fanned out by the workflow
+
+        Args:
+            jobs (list): The input data, output file, data type key and
+                domain data of each request
+            policy (ExecutionPolicy): The settings the plan starts from
+            weights_cached (bool): True if the weights of every domain are
+                in the local weight cache
+
+        Returns:
+            ExecutionPlan: The plan
+        """
+        first = jobs[0][0]
+        estimate = pymetbuild.RequestEstimate(
+            Input.date_to_pmb(min(job[0].start_date() for job in jobs)),
+            Input.date_to_pmb(max(job[0].end_date() for job in jobs)),
+            first.time_step(),
+            first.format(),
+            first.compression_codec() != "none",
+        )
+        for input_data, _, data_type_key, _ in jobs:
+            for i in range(input_data.num_domains()):
+                d = input_data.domain(i)
+                if d.service() == "nhc":
+                    estimate.add_vortex_domain(d.grid().grid_object())
+                else:
+                    estimate.add_domain(
+                        d.grid().grid_object(),
+                        MessageHandler.__generate_data_source_key(d.service()),
+                        data_type_key,
+                    )
+        estimate.set_weights_cached(weights_cached)
+
+        plan = pymetbuild.ExecutionPlan(estimate, policy)
+        plan.set_workers(int(os.environ.get("METGET_SHARD_WORKERS", "1")))
+        plan.set_shard_seconds(float(os.environ.get("METGET_SHARD_SECONDS", "0")))
+        return plan
+
+    @staticmethod
+    def __shared_result_cache():
+        """
+        Index of the outputs of earlier requests in METGET_S3_BUCKET_UPLOAD,
+        unless METGET_SHARED_RESULTS is set to 0
+
+        Returns:
+            ResultCache: The index, or None when it is disabled
+        """
+        bucket = os.environ.get("METGET_S3_BUCKET_UPLOAD")
+        if not bucket or os.environ.get("METGET_SHARED_RESULTS", "1") == "0":
+            return None
+        return ResultCache(bucket)
+
+    @staticmethod
+    def __shared_weight_cache():
+        """
+        Weight cache shared between workers through METGET_S3_BUCKET, unless
+        METGET_SHARED_WEIGHTS is set to 0. Weights are kept locally in
+        METBUILD_WEIGHT_CACHE, or a temporary directory when it is not set
+
+        Returns:
+            WeightCache: The shared cache, or None when it is disabled
+        """
+        import tempfile
+
+        bucket = os.environ.get("METGET_S3_BUCKET")
+        if not bucket or os.environ.get("METGET_SHARED_WEIGHTS", "1") == "0":
+            return None
+        directory = os.environ.get("METBUILD_WEIGHT_CACHE")
+        if not directory:
+            directory = os.path.join(tempfile.gettempdir(), "metbuild_weights")
+        return WeightCache(bucket, directory)
+
+    @staticmethod
+    def prepare_registered_weights() -> int:
+        """
+        Builds the interpolation weights of every registered domain from the
+        latest file of each of its services and publishes them to the shared
+        weight cache, so the forecast cycle requests on the domain find them
+        ready. Weights that are already shared are only fetched
+
+        Returns:
+            int: The number of domain and service pairs prepared
+        """
+        from metbuild.tables import RegisteredDomainTable
+
+        log = logging.getLogger(__name__)
+
+        weight_cache = MessageHandler.__shared_weight_cache()
+        if not weight_cache:
+            log.warning("The shared weight cache is disabled, nothing to prepare")
+            return 0
+
+        count = 0
+        for registration in RegisteredDomainTable.registered():
+            prepared = True
+            for service in registration["services"]:
+                try:
+                    MessageHandler.__prepare_weights(
+                        weight_cache, registration, service
+                    )
+                    count += 1
+                except Exception as e:
+                    prepared = False
+                    log.error(
+                        "Could not prepare weights of domain {:s} from {:s}: {:s}".format(
+                            registration["name"], service, str(e)
+                        )
+                    )
+            if prepared:
+                RegisteredDomainTable.set_prepared(registration["id"])
+        return count
+
+    @staticmethod
+    def __prepare_weights(weight_cache, registration: dict, service: str) -> None:
+        """
+        Builds the weights of a registered domain from the latest file of a
+        service, unless the shared cache already holds them
+
+        Args:
+            weight_cache (WeightCache): The shared weight cache
+            registration (dict): The registered domain
+            service (str): The service the weights are built from
+        """
+        log = logging.getLogger(__name__)
+
+        domain = Domain(registration["name"], service, registration["domain"])
+        if not domain.valid():
+            raise RuntimeError("Invalid domain")
+        grid = domain.grid().grid_object()
+        domain_key = WeightCache.domain_key(service, grid, registration["epsg"])
+        weight_cache.fetch(domain_key)
+        weight_cache.fetch_locators(service)
+
+        local_file = MessageHandler.__latest_source_file(service)
+        try:
+            met = pymetbuild.Meteorology(
+                grid,
+                MessageHandler.__generate_data_source_key(service),
+                pymetbuild.WIND_PRESSURE,
+                False,
+                registration["epsg"],
+            )
+            pymetbuild.LocatorCache.clear_used_keys()
+            key = met.prepare_weights(local_file)
+            weight_cache.publish(domain_key, [key])
+            weight_cache.publish_locators(
+                service, list(pymetbuild.LocatorCache.used_keys())
+            )
+            log.info(
+                "Prepared weights {:s} of domain {:s} from {:s}".format(
+                    key, registration["name"], service
+                )
+            )
+        finally:
+            if os.path.exists(local_file):
+                os.remove(local_file)
+
+    @staticmethod
+    def __latest_source_file(service: str) -> str:
+        """
+        Downloads the most recent file of a service, which is on the source
+        grid used by the coming forecast cycles
+
+        Args:
+            service (str): The service
+
+        Returns:
+            str: The path of the downloaded file
+        """
+        import tempfile
+
+        from metbuild.database import Database
+        from metbuild.tables import (
+            GefsTable,
+            GfsTable,
+            HrrrAlaskaTable,
+            HrrrTable,
+            NamTable,
+            WpcTable,
+        )
+
+        tables = {
+            "gfs-ncep": GfsTable,
+            "gefs-ncep": GefsTable,
+            "nam-ncep": NamTable,
+            "hrrr-ncep": HrrrTable,
+            "hrrr-alaska-ncep": HrrrAlaskaTable,
+            "wpc-ncep": WpcTable,
+        }
+        if service not in tables:
+            raise RuntimeError("Weights cannot be prepared for " + service)
+        table = tables[service]
+
+        with Database() as db, db.session() as session:
+            latest = (
+                session.query(table.filepath, table.forecasttime)
+                .order_by(table.forecastcycle.desc(), table.tau)
+                .first()
+            )
+        if latest is None:
+            raise RuntimeError("No data found for " + service)
+
+        if "s3://" in latest.filepath:
+            local_file = os.path.join(
+                tempfile.gettempdir(),
+                "{:s}.weights.{:s}".format(
+                    service, os.path.split(latest.filepath)[1]
+                ),
+            )
+            s3_remote = MessageHandler.__generate_noaa_s3_remote_instance(service)
+            success, _ = s3_remote.download(
+                latest.filepath, local_file, "wind_pressure"
+            )
+            if not success:
+                raise RuntimeError("Unable to download " + latest.filepath)
+            return local_file
+
+        s3 = S3file(os.environ["METGET_S3_BUCKET"])
+        return s3.download(latest.filepath, service, latest.forecasttime)
+
+    @staticmethod
+    def __shard_output(input_data, met_field):
+        """
+        Splits the output into files covering consecutive spans of time when
+        the request sets shard_hours or shard_bytes, so the files can be
+        transferred in parallel. The files are listed in time order in the
+        shard manifest
+
+        Args:
+            input_data (Input): The input data
+            met_field (OutputFile): The output file object
+
+        Returns:
+            ShardedOutput: The sharded output, or None when the output is not
+            split
+        """
+        if not met_field:
+            return None
+        if input_data.shard_hours() is None and input_data.shard_bytes() is None:
+            return None
+        sharded = pymetbuild.ShardedOutput(
+            input_data.start_date_pmb(),
+            input_data.end_date_pmb(),
+            input_data.time_step(),
+            input_data.format(),
+            input_data.filename(),
+            pymetbuild.StreamCompression.fromName(input_data.compression_codec()),
+        )
+        if input_data.shard_hours() is not None:
+            sharded.set_shard_hours(input_data.shard_hours())
+        else:
+            sharded.set_shard_bytes(input_data.shard_bytes())
+        sharded.set_manifest(MessageHandler.SHARD_MANIFEST_FILENAME)
+        return sharded
+
+    @staticmethod
+    def __upload_files(
+        s3up, request_id: str, files: list, checksums: dict = None
+    ) -> None:
+        """
+        Uploads files to the request's s3 location, several at a time
+
+        Args:
+            s3up (S3file): The upload bucket
+            request_id (str): The request id, used as the s3 prefix
+            files (list): The local files to upload
+            checksums (dict): Checksum of the files written with one, keyed
+                by local file
+        """
+        from concurrent.futures import ThreadPoolExecutor
+
+        checksums = checksums or {}
+        if len(files) < 2:
+            for f in files:
+                s3up.upload_file(f, os.path.join(request_id, f), checksums.get(f))
+            return
+
+        with ThreadPoolExecutor(max_workers=MessageHandler.UPLOAD_THREADS) as pool:
+            uploads = [
+                pool.submit(
+                    s3up.upload_file,
+                    f,
+                    os.path.join(request_id, f),
+                    checksums.get(f),
+                )
+                for f in files
+            ]
+            for u in uploads:
+                u.result()
+
+    @staticmethod
+    def __output_checksums(files: list) -> dict:
+        """
+        Takes the checksums the output writers computed for the files once
+        they are closed. Files written by libraries which write their own
+        files, such as netCDF, have none
+
+        Args:
+            files (list): The local output files
+
+        Returns:
+            dict: Size, md5, S3 etag and part md5s of each file, keyed by file
+        """
+        checksums = {}
+        for f in files:
+            c = pymetbuild.FileChecksums.take(f)
+            if not c.valid():
+                continue
+            checksums[f] = {
+                "size": c.size,
+                "md5": c.md5,
+                "etag": c.etag(),
+                "part_size": c.part_size,
+                "part_md5": list(c.part_md5),
+            }
+        return checksums
+
+    @staticmethod
+    def __start_upload_stream(input_data, met_field):
+        """
+        Starts uploading the output files while they are written, for the
+        formats which write their files front to back
+
+        Args:
+            input_data (Input): The input data
+            met_field (OutputFile): The output file object
+
+        Returns:
+            S3UploadStream: The running uploads, or None when the output is
+            uploaded once it is complete
+        """
+        if input_data.format() not in MessageHandler.STREAMED_FORMATS:
+            return None
+        # ...Shards are uploaded once they are complete
+        if isinstance(met_field, pymetbuild.ShardedOutput):
+            return None
+        if os.environ.get("METGET_STREAM_UPLOAD", "1") == "0":
+            return None
+        s3up = S3file(os.environ["METGET_S3_BUCKET_UPLOAD"])
+        return s3up.upload_stream(
+            {
+                f: os.path.join(input_data.request_id(), f)
+                for f in met_field.filenames()
+            }
+        )
+
+    @staticmethod
+    def __start_publication(input_data, met_field) -> bool:
+        """
+        Publishes the output in time chunks while it is built when
+        METGET_PUBLISH_HOURS is set, so the first hours of forcing can be
+        used before the full build finishes. Only the formats written front
+        to back are published
+
+        Args:
+            input_data (Input): The input data
+            met_field (OutputFile): The output file object
+
+        Returns:
+            bool: True if the output is published in chunks
+        """
+        hours = os.environ.get("METGET_PUBLISH_HOURS")
+        if not met_field or not hours:
+            return False
+        if input_data.format() not in MessageHandler.STREAMED_FORMATS:
+            return False
+        records = max(1, int(float(hours) * 3600.0 / input_data.time_step()))
+        met_field.set_publication(MessageHandler.MANIFEST_FILENAME, records)
+        return True
+
+    @staticmethod
+    def __publication_reporter(input_data, met_field):
+        """
+        Generates the callback run each time the published part of the output
+        grows. The published leading bytes of each output file are uploaded
+        under the partial folder of the request, then the manifest listing
+        them, so readers of the manifest always find the bytes it lists
+
+        Args:
+            input_data (Input): The input data
+            met_field (OutputFile): The output file object
+
+        Returns:
+            coroutine function: The callback given to run_async, or None when
+            the output is not published in chunks
+        """
+        import json
+        import tempfile
+
+        log = logging.getLogger(__name__)
+
+        if input_data.format() not in MessageHandler.STREAMED_FORMATS:
+            return None
+        if not os.environ.get("METGET_PUBLISH_HOURS") or not met_field:
+            return None
+
+        def upload() -> None:
+            with open(MessageHandler.MANIFEST_FILENAME) as f:
+                manifest = json.load(f)
+            s3up = S3file(os.environ["METGET_S3_BUCKET_UPLOAD"])
+            for domain in manifest["domains"]:
+                for entry in domain["files"]:
+                    with tempfile.NamedTemporaryFile() as part:
+                        with open(entry["name"], "rb") as src:
+                            remaining = entry["bytes"]
+                            while remaining > 0:
+                                chunk = src.read(min(remaining, 1 << 24))
+                                if not chunk:
+                                    break
+                                part.write(chunk)
+                                remaining -= len(chunk)
+                        part.flush()
+                        s3up.upload_file(
+                            part.name,
+                            os.path.join(
+                                input_data.request_id(), "partial", entry["name"]
+                            ),
+                        )
+            s3up.upload_file(
+                MessageHandler.MANIFEST_FILENAME,
+                os.path.join(
+                    input_data.request_id(), MessageHandler.MANIFEST_FILENAME
+                ),
+            )
+            log.info(
+                "Published the output through {:s}".format(
+                    str(manifest["published_through"])
+                )
+            )
+
+        async def publish(through) -> None:
+            await asyncio.get_running_loop().run_in_executor(None, upload)
+
+        return publish
+
+    @staticmethod
+    def __checkpoint_path(input_data):
+        """
+        Checkpoint file of the request when METGET_CHECKPOINT_DIR is set. A
+        request stopped part way resumes from it the next time it is
+        processed, provided its output files are still in place
+
+        Args:
+            input_data: The input data object
+
+        Returns:
+            Path of the checkpoint file or None
+        """
+        directory = os.environ.get("METGET_CHECKPOINT_DIR")
+        if not directory:
+            return None
+        os.makedirs(directory, exist_ok=True)
+        return os.path.join(directory, input_data.request_id() + ".checkpoint")
+
+    @staticmethod
+    def __progress_reporter(callback):
+        """
+        Generates the progress callback of a running build, which logs every
+        tenth of the build and passes it on to the callback on a worker thread
+
+        Args:
+            callback (callable): Called with the fraction done, or None
+
+        Returns:
+            coroutine function: The callback given to run_async
+        """
+        log = logging.getLogger(__name__)
+        reported = [-1]
+
+        async def report(fraction: float) -> None:
+            tenth = int(fraction * 10.0)
+            if tenth <= reported[0]:
+                return
+            reported[0] = tenth
+            log.info("Build is {:.0f}% complete".format(fraction * 100.0))
+            if callback is not None:
+                await asyncio.get_running_loop().run_in_executor(
+                    None, callback, fraction
+                )
+
+        return report
+
+    @staticmethod
+    def __statistics_to_dict(report) -> dict:
+        """
+        Converts the stage report of a build request to a dictionary
+
+        Args:
+            report (InstrumentationReport): The report of the request
+
+        Returns:
+            dict: Calls, seconds and items of each stage, keyed by stage name,
+            with the hardware counters of the stages which sampled them
+        """
+        counters = pymetbuild.Instrumentation.counter_names()
+        statistics = {}
+        for i, name in enumerate(pymetbuild.Instrumentation.names()):
+            statistics[name] = {
+                "calls": report.calls(i),
+                "seconds": report.seconds(i),
+                "items": report.items(i),
+                "peak_rss_bytes": report.peak_rss(i),
+            }
+            if report.counter(i, pymetbuild.Instrumentation.CYCLES) == 0:
+                continue
+            values = {c: report.counter(i, k) for k, c in enumerate(counters)}
+            values["ipc"] = report.instructions_per_cycle(i)
+            values["llc_mpki"] = report.misses_per_kilo_instruction(
+                i, pymetbuild.Instrumentation.LLC_MISSES
+            )
+            values["branch_mpki"] = report.misses_per_kilo_instruction(
+                i, pymetbuild.Instrumentation.BRANCH_MISSES
+            )
+            statistics[name]["counters"] = values
+        return statistics
+
+    @staticmethod
+    def __memory_to_dict(report) -> dict:
+        """
+        Converts the memory accounting of a build request to a dictionary
+
+        Args:
+            report (InstrumentationReport): The report of the request
+
+        Returns:
+            dict: Peak bytes held by each subsystem and the peak resident set
+            size of the process
+        """
+        return {
+            "peak_bytes": {
+                name: report.peak_bytes(i)
+                for i, name in enumerate(pymetbuild.Instrumentation.memory_names())
+            },
+            "peak_rss_bytes": report.process_peak_rss(),
+        }
+
+    @staticmethod
+    def __field_statistics_to_list(steps) -> list:
+        """
+        Converts the step statistics of a domain to a list of dictionaries
+
+        Args:
+            steps (StepStatisticsVector): The statistics of each output step
+
+        Returns:
+            list: Time and the minimum, maximum, mean and invalid fraction of
+            each field for each step. Fields without a valid cell have None
+            in place of the minimum, maximum and mean
+        """
+
+        def finite(value):
+            return value if math.isfinite(value) else None
+
+        result = []
+        for step in steps:
+            fields = {}
+            for name, field in zip(step.names, step.fields):
+                fields[name] = {
+                    "min": finite(field.min),
+                    "max": finite(field.max),
+                    "mean": finite(field.mean()),
+                    "invalid_fraction": field.invalid_fraction(),
+                }
+            result.append({"time": step.time.toString(), "fields": fields})
+        return result
+
+    @staticmethod
+    def __generate_raw_files_list(domain_data, input_data) -> Tuple[list, dict]:
+        """
+        Generates the list of raw files used for the given domains
+
+        Args:
+            domain_data (list): The list of domain data
+            input_data (Input): The input data
+
+        Returns:
+            Tuple[list, dict]: The list of raw files and the list of files used
+        """
+        output_file_list = []
+        files_used_list = {}
+        for i in range(input_data.num_domains()):
+            for pr in domain_data[i]:
+                output_file_list.append(pr["filepath"])
+            files_used_list[input_data.domain(i).name()] = output_file_list
+        return output_file_list, files_used_list
+
+    @staticmethod
+    def __download_files_from_s3(
+        db_files, domain_data, input_data, met_field, nhc_data
+    ) -> list:
+        """
+        Downloads the files from S3 and generates the list of files used
+
+        Args:
+            db_files (list): The list of files from the database
+            domain_data (list): The list of domain data
+            input_data (Input): The input data
+            met_field (MeteorologyField): The meteorology field
+            nhc_data (dict): The list of NHC data
+
+        Returns:
+            list: The grib downloads deferred to __start_fetches
+        """
+        fetches = []
+        for i in range(input_data.num_domains()):
+            d = input_data.domain(i)
+            domain_data.append([])
+
+            if d.service() == "nhc":
+                MessageHandler.__generate_merged_nhc_files(
+                    d, domain_data, i, met_field, nhc_data
+                )
+            else:
+                MessageHandler.__get_2d_forcing_files(
+                    input_data.data_type(),
+                    d,
+                    db_files,
+                    domain_data,
+                    i,
+                    met_field,
+                    fetches,
+                )
+        return fetches
+
+    @staticmethod
+    def __start_fetches(fetches: list):
+        """
+        Starts downloading the deferred grib files concurrently. Each file is
+        registered with pymetbuild as an in-memory buffer once it arrives, and
+        readers of a file that has not arrived yet wait for it
+
+        Args:
+            fetches (list): The deferred downloads
+
+        Returns:
+            ThreadPoolExecutor: The pool running the downloads
+        """
+        from concurrent.futures import ThreadPoolExecutor
+
+        log = logging.getLogger(__name__)
+
+        def fetch_to_buffer(fetch: dict) -> None:
+            try:
+                parts = fetch["remote"].fetch(fetch["s3_file"], fetch["byte_ranges"])
+                pymetbuild.add_file_buffer(fetch["name"], parts)
+            except Exception as e:
+                log.error(
+                    "Unable to download file {:s}: {:s}".format(
+                        fetch["s3_file"], str(e)
+                    )
+                )
+                pymetbuild.fail_file_buffer(fetch["name"], str(e))
+
+        pool = ThreadPoolExecutor(max_workers=MessageHandler.FETCH_THREADS)
+        for fetch in fetches:
+            pool.submit(fetch_to_buffer, fetch)
+        return pool
+
+    @staticmethod
+    def __generate_noaa_s3_remote_instance(data_type: str) -> S3GribIO:
+        """
+        Generates the remote s3 grib instance for NOAA S3 archived files
+
+        Args:
+            data_type (str): The data type
+
+        Returns:
+            S3GribIO: The remote s3 grib instance
+        """
+        from metbuild.gribdataattributes import (
+            NCEP_NAM,
+            NCEP_GFS,
+            NCEP_GEFS,
+            NCEP_HRRR,
+            NCEP_HRRR_ALASKA,
+            NCEP_WPC,
+        )
+
+        remote = None
+
+        if data_type == "gfs-ncep":
+            grib_attrs = NCEP_GFS
+        elif data_type == "nam-ncep":
+            grib_attrs = NCEP_NAM
         elif data_type == "gefs-ncep":
             grib_attrs = NCEP_GEFS
         elif data_type == "hrrr-ncep":
@@ -703,6 +2175,7 @@ class MessageHandler:
         domain_data: list,
         index: int,
         met_field,
+        fetches: list,
     ) -> None:
         """
         Gets the 2D forcing files from s3
@@ -714,6 +2187,8 @@ class MessageHandler:
             domain_data (list): The list of domain data
             index (int): The index of the domain
             met_field (MeteorologyField): The meteorology field
+            fetches (list): Receives the grib downloads that are deferred
+                and read from memory
 
         Returns:
             None
@@ -737,6 +2212,10 @@ class MessageHandler:
                 files = item["filepath"].split(",")
                 local_file_list = []
                 for ff in files:
+                    if met_field and MessageHandler.__coamps_byte_range():
+                        # ...Only the chunks of the variables read are fetched
+                        local_file_list.append(s3.remote_url(ff))
+                        continue
                     local_file = s3.download(ff, domain.service(), item["forecasttime"])
                     if not met_field:
                         new_file = os.path.basename(local_file)
@@ -756,17 +2235,44 @@ class MessageHandler:
                         fn,
                     )
                     local_file = os.path.join(tempdir, fname)
-                    success, fatal = s3_remote.download(
-                        item["filepath"], local_file, data_type
-                    )
+                    if met_field:
+                        # ...Only the byte ranges are resolved here, the
+                        # download itself overlaps with the interpolation
+                        success, fatal, byte_ranges = s3_remote.plan(
+                            item["filepath"], data_type
+                        )
+                        if success:
+                            pymetbuild.expect_file_buffer(local_file)
+                            fetches.append(
+                                {
+                                    "remote": s3_remote,
+                                    "s3_file": item["filepath"],
+                                    "byte_ranges": byte_ranges,
+                                    "name": local_file,
+                                }
+                            )
+                    else:
+                        success, fatal = s3_remote.download(
+                            item["filepath"], local_file, data_type
+                        )
                     if not success and fatal:
                         raise RuntimeError(
                             "Unable to download file {:s}".format(item["filepath"])
                         )
                 else:
+                    # ...Raw requests return the grib files themselves
+                    remote_path = item["filepath"]
+                    if met_field:
+                        remote_path = MessageHandler.__archived_source_path(
+                            s3, remote_path, domain
+                        )
                     local_file = s3.download(
-                        item["filepath"], domain.service(), item["forecasttime"]
+                        remote_path, domain.service(), item["forecasttime"]
                     )
+                    if met_field and remote_path == item["filepath"]:
+                        MessageHandler.__download_index_file(
+                            s3, remote_path, domain.service(), item["forecasttime"]
+                        )
                     success = True
                 if not met_field:
                     new_file = os.path.basename(local_file)
@@ -778,6 +2284,83 @@ class MessageHandler:
                         {"time": item["forecasttime"], "filepath": local_file}
                     )
 
+    @staticmethod
+    def __coamps_byte_range() -> bool:
+        """
+        Whether COAMPS files are read from s3 by byte range instead of being
+        downloaded, which needs a netCDF library built with byte range reads.
+        Disabled by setting METGET_COAMPS_BYTE_RANGE to 0
+
+        Returns:
+            bool: True when COAMPS files are opened by url
+        """
+        if os.environ.get("METGET_COAMPS_BYTE_RANGE", "1") == "0":
+            return False
+        return pymetbuild.netcdf_byte_range()
+
+    @staticmethod
+    def __archived_source_path(s3: S3file, filepath: str, domain) -> str:
+        """
+        Returns the path of the field file archived next to a grib file when
+        field files are in use and one exists, otherwise the grib file itself.
+        Field files cropped to a region are only used for domains inside it
+
+        Args:
+            s3 (S3file): The archive bucket
+            filepath (str): The path of the archived grib file
+            domain (Domain): The domain the file is read for
+
+        Returns:
+            str: The path to download
+        """
+        from metbuild.gribdataattributes import FIELD_FILE_SUFFIX, field_file_region
+
+        if not os.environ.get("METGET_FIELD_FILES"):
+            return filepath
+
+        region = field_file_region()
+        if region is not None:
+            grid = domain.grid()
+            for p in (
+                grid.bottom_left(),
+                grid.bottom_right(),
+                grid.top_left(),
+                grid.top_right(),
+            ):
+                x = (p.x() + 180.0) % 360.0 - 180.0
+                if not (
+                    region[0] <= x <= region[2] and region[1] <= p.y() <= region[3]
+                ):
+                    return filepath
+
+        field_file = filepath + FIELD_FILE_SUFFIX
+        if s3.exists(field_file):
+            return field_file
+        return filepath
+
+    @staticmethod
+    def __download_index_file(
+        s3: S3file, filepath: str, service: str, time: datetime
+    ) -> None:
+        """
+        Downloads the message index archived next to a grib file when index
+        files are in use and one exists. It is stored next to the local grib
+        file, where libmetbuild reads it in place of scanning the file
+
+        Args:
+            s3 (S3file): The archive bucket
+            filepath (str): The path of the archived grib file
+            service (str): The service the file belongs to
+            time (datetime): The forecast time of the file
+        """
+        from metbuild.gribdataattributes import INDEX_FILE_SUFFIX
+
+        if not os.environ.get("METGET_GRIB_INDEX_FILES"):
+            return
+        index_file = filepath + INDEX_FILE_SUFFIX
+        if s3.exists(index_file):
+            s3.download(index_file, service, time)
+
     @staticmethod
     def __print_file_status(filepath: any, time: datetime) -> None:
         """
@@ -932,13 +2515,21 @@ class MessageHandler:
             data (list): List of dictionaries containing the filepaths of the
         """
         from os.path import exists
+        from metbuild.gribdataattributes import INDEX_FILE_SUFFIX
 
         for domain in data:
             for f in domain:
+                # ...Mappings kept warm by a resident worker would otherwise
+                # hold on to the space of the deleted files
                 if type(f["filepath"]) == list:
                     for ff in f["filepath"]:
+                        pymetbuild.release_file(ff)
                         if exists(ff):
                             os.remove(ff)
                 else:
+                    pymetbuild.release_file(f["filepath"])
                     if exists(f["filepath"]):
                         os.remove(f["filepath"])
+                    index_file = f["filepath"] + INDEX_FILE_SUFFIX
+                    if exists(index_file):
+                        os.remove(index_file)
@@ -30,42 +30,70 @@
 
 import logging
 import os
+import sys
 from datetime import datetime, timedelta
 
+from metbuild.input import Input
 from metbuild.tables import RequestTable
 from message_handler import MessageHandler
 
 MAX_REQUEST_TIME = timedelta(hours=48)
 REQUEST_SLEEP_TIME = timedelta(minutes=10)
 
+# ...Memory a resident worker keeps warm between requests, in megabytes,
+# unless METGET_WARM_CACHE_MB is set
+WARM_CACHE_MB = 4096
 
-def main():
+# ...Memory a resident worker holds interpolated snapshots in, in megabytes,
+# unless METGET_SNAPSHOT_MEMORY_MB is set. Zero keeps snapshots on disk only
+SNAPSHOT_MEMORY_MB = 2048
+
+# ...Queue shared by the resident workers, bound to the request exchange
+WORKER_QUEUE = "metget-build-worker"
+
+# ...Requests a resident worker builds together when they share source files,
+# unless METGET_BATCH_SIZE is set. One builds each request on its own
+BATCH_SIZE = 1
+
+# ...Requests a resident worker takes off the queue ahead of the ones it
+# builds, unless METGET_PREFETCH_DEPTH is set, so that their source files are
+# pulled into the node-local file cache while it builds. Requests taken ahead
+# are built by this worker next and are not seen by the others. Nothing is
+# taken ahead unless the file cache is enabled with METGET_FILE_CACHE
+PREFETCH_DEPTH = 1
+
+# ...Path the resident worker serves its Prometheus metrics on, when
+# METGET_METRICS_PORT is set
+METRICS_PATH = "/metrics"
+
+
+def process_request(json_data: dict) -> None:
     """
-    Main entry point for the script
+    Processes one build request and records its status in the request table
+
+    Args:
+        json_data: The request message
     """
-    import json
     import time
     import traceback
 
-    logging.basicConfig(
-        level=logging.INFO,
-        format="%(asctime)s :: %(levelname)s :: %(filename)s :: %(funcName)s :: %(message)s",
-        datefmt="%Y-%m-%dT%H:%M:%S%Z",
-    )
-
     log = logging.getLogger(__name__)
-    log.info("Beginning execution")
 
     try:
-        # ...Get the input data from the environment.
-        # This variable is set by the argo template
-        # and comes from rabbitmq
-        message = os.environ["METGET_REQUEST_JSON"]
-        json_data = json.loads(message)
-
         credit_cost = 0
 
-        handler = MessageHandler(json_data)
+        def report_progress(fraction: float) -> None:
+            RequestTable.update_request(
+                json_data["request_id"],
+                "running",
+                json_data["api_key"],
+                json_data["source_ip"],
+                json_data,
+                "Job is running ({:.0f}% complete)".format(fraction * 100.0),
+                credit_cost,
+            )
+
+        handler = MessageHandler(json_data, progress=report_progress)
         credit_cost = handler.input().credit_usage()
 
         RequestTable.update_request(
@@ -104,6 +132,7 @@ def main():
             json_data,
             "Job completed successfully",
             credit_cost,
+            statistics=handler.statistics(),
         )
     except RuntimeError as e:
         log.error("Encountered error during processing: " + str(e))
@@ -143,6 +172,325 @@ def main():
         )
         raise
 
+
+def process_batch(messages: list) -> None:
+    """
+    Processes compatible build requests in one build, so the source files
+    they share are downloaded and decoded once. Requests waiting on an
+    archive restore, or all of them if the shared build fails, are processed
+    on their own afterwards
+
+    Args:
+        messages: The request messages
+    """
+    import traceback
+
+    log = logging.getLogger(__name__)
+
+    if len(messages) == 1:
+        process_request(messages[0])
+        return
+
+    def progress_reporter(json_data: dict, credit_cost: int):
+        def report_progress(fraction: float) -> None:
+            RequestTable.update_request(
+                json_data["request_id"],
+                "running",
+                json_data["api_key"],
+                json_data["source_ip"],
+                json_data,
+                "Job is running ({:.0f}% complete)".format(fraction * 100.0),
+                credit_cost,
+            )
+
+        return report_progress
+
+    handlers = []
+    for json_data in messages:
+        credit_cost = Input(json_data).credit_usage()
+        handler = MessageHandler(
+            json_data, progress=progress_reporter(json_data, credit_cost)
+        )
+        RequestTable.update_request(
+            json_data["request_id"],
+            "running",
+            json_data["api_key"],
+            json_data["source_ip"],
+            json_data,
+            "Job is running",
+            credit_cost,
+        )
+        handlers.append(handler)
+
+    try:
+        status = MessageHandler.process_batch(handlers)
+    except Exception as e:
+        log.error("Shared build failed, building each request on its own: " + str(e))
+        log.error(traceback.format_exc())
+        status = [False] * len(handlers)
+
+    for json_data, handler, done in zip(messages, handlers, status):
+        if not done:
+            try:
+                process_request(json_data)
+            except Exception as e:
+                log.error("Request failed, continuing with the next one: " + str(e))
+            continue
+        RequestTable.update_request(
+            json_data["request_id"],
+            "completed",
+            json_data["api_key"],
+            json_data["source_ip"],
+            json_data,
+            "Job completed successfully",
+            handler.input().credit_usage(),
+            statistics=handler.statistics(),
+        )
+
+
+def start_metrics_server(port: int) -> None:
+    """
+    Serves the metrics of the process in the Prometheus text format from a
+    background thread. The metrics are rendered by the library on each
+    scrape, so they are current even while a request is being built
+
+    Args:
+        port: The port to listen on
+    """
+    import threading
+    from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+    import pymetbuild
+
+    class MetricsHandler(BaseHTTPRequestHandler):
+        def do_GET(self) -> None:
+            if self.path.split("?")[0] != METRICS_PATH:
+                self.send_error(404)
+                return
+            body = pymetbuild.Metrics.render().encode("utf-8")
+            self.send_response(200)
+            self.send_header("Content-Type", "text/plain; version=0.0.4")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+        def log_message(self, format, *args) -> None:
+            # ...Scrapes are too frequent to log
+            pass
+
+    server = ThreadingHTTPServer(("", port), MetricsHandler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+
+
+def serve() -> None:
+    """
+    Runs as a resident worker which takes build requests from the queue one
+    after another in the same process. Grid definitions, interpolation weights
+    and file mappings are kept warm between requests up to METGET_WARM_CACHE_MB
+    megabytes, least recently used first out, and proj transformers live as
+    long as the process. Interpolated snapshots are held in memory, the colder
+    ones compressed, up to METGET_SNAPSHOT_MEMORY_MB megabytes before they
+    spill to the snapshot cache directory. Workers started this way share one
+    queue, so the argo sensor should not also be consuming the requests. With
+    METGET_BATCH_SIZE above one, requests waiting on the queue which read the
+    same source files are built together with the one taken. Up to
+    METGET_PREFETCH_DEPTH further requests are taken ahead, and their source
+    files are downloaded into the node-local file cache during the build
+
+    Metrics of the worker are served for Prometheus on METGET_METRICS_PORT,
+    and written after each request to METGET_METRICS_FILE for a textfile
+    collector, when either is set
+    """
+    import json
+
+    from concurrent.futures import ThreadPoolExecutor
+
+    import pika
+    import pymetbuild
+    from metbuild.filecache import FileCache
+
+    log = logging.getLogger(__name__)
+
+    budget = int(os.environ.get("METGET_WARM_CACHE_MB", WARM_CACHE_MB))
+    pymetbuild.WarmCache.setBudget(budget * 1024 * 1024)
+    snapshots = int(os.environ.get("METGET_SNAPSHOT_MEMORY_MB", SNAPSHOT_MEMORY_MB))
+    pymetbuild.SnapshotStore.setBudget(snapshots * 1024 * 1024)
+
+    host = os.environ["METGET_RABBITMQ_SERVICE_SERVICE_HOST"]
+    routing_key = os.environ["METGET_RABBITMQ_QUEUE"]
+    queue = os.environ.get("METGET_BUILD_QUEUE", WORKER_QUEUE)
+
+    # ...The connection is not serviced while a request is built, which takes
+    # far longer than the heartbeat interval, so heartbeats are turned off
+    params = pika.ConnectionParameters(host, 5672, heartbeat=0)
+    connection = pika.BlockingConnection(params)
+    channel = connection.channel()
+    channel.exchange_declare(exchange="metget", exchange_type="fanout", durable=True)
+    channel.queue_declare(queue=queue, durable=True)
+    channel.queue_bind(queue=queue, exchange="metget", routing_key=routing_key)
+
+    # ...One request at a time, so the workers on the queue share the load
+    channel.basic_qos(prefetch_count=1)
+
+    batch_size = int(os.environ.get("METGET_BATCH_SIZE", BATCH_SIZE))
+    prefetch_depth = int(os.environ.get("METGET_PREFETCH_DEPTH", PREFETCH_DEPTH))
+    if not FileCache().enabled():
+        prefetch_depth = 0
+    prefetcher = ThreadPoolExecutor(max_workers=1)
+    held = []
+
+    metrics_port = os.environ.get("METGET_METRICS_PORT")
+    metrics_file = os.environ.get("METGET_METRICS_FILE")
+    if metrics_port:
+        start_metrics_server(int(metrics_port))
+        log.info("Serving metrics on port {:s}".format(metrics_port))
+
+    def update_metrics(ch, batch: int) -> None:
+        """
+        Updates the gauges of the worker, then writes the metrics file
+        """
+        try:
+            depth = ch.queue_declare(
+                queue=queue, durable=True, passive=True
+            ).method.message_count
+            pymetbuild.Metrics.set_gauge(
+                "metget_queue_depth", "Requests waiting on the build queue", depth
+            )
+        except Exception as e:
+            log.warning("Could not read the depth of the queue: " + str(e))
+        pymetbuild.Metrics.set_gauge(
+            "metget_last_batch_size", "Requests built in the last build", batch
+        )
+        if metrics_file:
+            pymetbuild.Metrics.write_textfile(metrics_file)
+
+    def take_batch(ch, message: dict, tag: int) -> list:
+        """
+        Takes the requests waiting on the queue which can be built with the
+        first one, up to the batch size. The first request that cannot is
+        put back and ends the batch
+        """
+        messages = [(message, tag)]
+        while len(messages) < batch_size:
+            method, _, body = ch.basic_get(queue=queue)
+            if method is None:
+                break
+            try:
+                candidate = json.loads(body)
+                compatible = all(
+                    MessageHandler.compatible(Input(m), Input(candidate))
+                    for m, _ in messages
+                )
+            except Exception:
+                compatible = False
+            if not compatible:
+                ch.basic_nack(delivery_tag=method.delivery_tag, requeue=True)
+                break
+            messages.append((candidate, method.delivery_tag))
+        return messages
+
+    def prefetch(body: bytes) -> None:
+        """
+        Pulls the source files of a request taken ahead into the file cache
+        """
+        try:
+            message = json.loads(body)
+            count = MessageHandler.prefetch(message)
+            log.info(
+                "Prefetched {:d} files for request {:s}".format(
+                    count, str(message.get("request_id"))
+                )
+            )
+        except Exception as e:
+            log.warning("Could not prefetch a queued request: " + str(e))
+
+    def look_ahead(ch) -> None:
+        """
+        Takes requests off the queue up to the prefetch depth and starts
+        prefetching their files
+        """
+        while len(held) < prefetch_depth:
+            method, _, body = ch.basic_get(queue=queue)
+            if method is None:
+                break
+            held.append((body, method.delivery_tag))
+            prefetcher.submit(prefetch, body)
+
+    def build(ch, body: bytes, tag: int) -> None:
+        messages = [(None, tag)]
+        try:
+            messages = take_batch(ch, json.loads(body), tag)
+            look_ahead(ch)
+            process_batch([m for m, _ in messages])
+        except Exception as e:
+            log.error("Request failed, continuing with the next one: " + str(e))
+        finally:
+            for _, t in messages:
+                ch.basic_ack(delivery_tag=t)
+            update_metrics(ch, len(messages))
+        log.info(
+            "Warm cache holds {:d} objects using {:.1f} MB".format(
+                pymetbuild.WarmCache.count(),
+                pymetbuild.WarmCache.size() / (1024 * 1024),
+            )
+        )
+        log.info(
+            "Snapshot store holds {:d} snapshots ({:d} compressed) in {:.1f} MB".format(
+                pymetbuild.SnapshotStore.count(),
+                pymetbuild.SnapshotStore.compressedCount(),
+                pymetbuild.SnapshotStore.size() / (1024 * 1024),
+            )
+        )
+
+    def on_message(ch, method, properties, body) -> None:
+        build(ch, body, method.delivery_tag)
+        # ...Requests taken ahead are built in the order they were queued
+        while held:
+            body, tag = held.pop(0)
+            build(ch, body, tag)
+
+    update_metrics(channel, 0)
+    channel.basic_consume(queue=queue, on_message_callback=on_message)
+    log.info("Waiting for build requests on queue {:s}".format(queue))
+    channel.start_consuming()
+
+
+def main():
+    """
+    Main entry point for the script. By default the request given in
+    METGET_REQUEST_JSON is processed. With --server, or METGET_BUILD_SERVER
+    set to 1, the process stays resident and consumes requests from the queue.
+    With --prepare-weights, the interpolation weights of the registered
+    domains are built and shared, which is meant to run on a schedule
+    """
+    import json
+
+    logging.basicConfig(
+        level=logging.INFO,
+        format="%(asctime)s :: %(levelname)s :: %(filename)s :: %(funcName)s :: %(message)s",
+        datefmt="%Y-%m-%dT%H:%M:%S%Z",
+    )
+
+    log = logging.getLogger(__name__)
+    log.info("Beginning execution")
+
+    if "--server" in sys.argv[1:] or os.environ.get("METGET_BUILD_SERVER") == "1":
+        serve()
+        return
+
+    if "--prepare-weights" in sys.argv[1:]:
+        count = MessageHandler.prepare_registered_weights()
+        log.info("Prepared weights for {:d} registered domain sources".format(count))
+        exit(0)
+
+    # ...Get the input data from the environment.
+    # This variable is set by the argo template
+    # and comes from rabbitmq
+    message = os.environ["METGET_REQUEST_JSON"]
+    json_data = json.loads(message)
+
+    process_request(json_data)
+
     log.info("Exiting script with status 0")
     exit(0)
 
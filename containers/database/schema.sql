@@ -145,6 +145,20 @@ CREATE TABLE requests(
   message JSON NOT NULL
 );
 --
+--Domains registered for recurring requests, whose interpolation weights
+--are built ahead of time for each of their sources
+--
+CREATE TABLE registered_domains(
+  id SERIAL PRIMARY KEY, 
+  api_key VARCHAR(128) NOT NULL, 
+  name VARCHAR(256) NOT NULL, 
+  domain JSON NOT NULL, 
+  services JSON NOT NULL, 
+  epsg INTEGER NOT NULL, 
+  registered TIMESTAMP NOT NULL, 
+  prepared TIMESTAMP
+);
+--
 --Create Brin Indexes on forecastcycle for the various tables
 --
 CREATE INDEX gfs_ncep_forecastcycle_idx ON gfs_ncep USING brin (forecastcycle);
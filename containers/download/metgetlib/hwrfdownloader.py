@@ -43,7 +43,7 @@ class HwrfDownloader(NoaaDownloader):
         )
         self.set_cycles(NCEP_HWRF.cycles())
         for v in NCEP_HWRF.variables():
-            self.add_download_variable(v["long_name"], v["name"])
+            self.add_download_variable(v["long_name"], v["name"], v.get("step_type"))
 
     def download(self):
         from .spyder import Spyder
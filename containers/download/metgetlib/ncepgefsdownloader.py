@@ -46,7 +46,7 @@ class NcepGefsdownloader(NoaaDownloader):
             do_archive=False,
         )
         for v in NCEP_GEFS.variables():
-            self.add_download_variable(v["long_name"], v["name"])
+            self.add_download_variable(v["long_name"], v["name"], v.get("step_type"))
         self.set_big_data_bucket(NCEP_GEFS.bucket())
         self.set_cycles(NCEP_GEFS.cycles())
         self.__members = NCEP_GEFS.ensemble_members()
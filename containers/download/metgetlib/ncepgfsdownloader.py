@@ -48,7 +48,7 @@ class NcepGfsdownloader(NoaaDownloader):
         self.set_big_data_bucket(NCEP_GFS.bucket())
         self.set_cycles(NCEP_GFS.cycles())
         for v in NCEP_GFS.variables():
-            self.add_download_variable(v["long_name"], v["name"])
+            self.add_download_variable(v["long_name"], v["name"], v.get("step_type"))
 
     @staticmethod
     def _generate_prefix(date, hour) -> str:
@@ -47,7 +47,7 @@ class NcepHrrrAlaskadownloader(NoaaDownloader):
         )
 
         for v in NCEP_HRRR_ALASKA.variables():
-            self.add_download_variable(v["long_name"], v["name"])
+            self.add_download_variable(v["long_name"], v["name"], v.get("step_type"))
         self.set_big_data_bucket(NCEP_HRRR_ALASKA.bucket())
         self.set_cycles(NCEP_HRRR_ALASKA.cycles())
 
@@ -48,7 +48,7 @@ class NcepHrrrdownloader(NoaaDownloader):
         self.set_big_data_bucket(NCEP_HRRR.bucket())
         self.set_cycles(NCEP_HRRR.cycles())
         for v in NCEP_HRRR.variables():
-            self.add_download_variable(v["long_name"], v["name"])
+            self.add_download_variable(v["long_name"], v["name"], v.get("step_type"))
 
     @staticmethod
     def _generate_prefix(date, hour) -> str:
@@ -139,18 +139,25 @@ class NoaaDownloader:
         """
         return self.__use_aws_big_data
 
-    def add_download_variable(self, long_name: str, name: str) -> None:
+    def add_download_variable(
+        self, long_name: str, name: str, step_type: str = None
+    ) -> None:
         """
         Adds a variable to the list of variables to download
 
         Args:
             long_name (str): The long name of the variable
             name (str): The name of the variable
+            step_type (str): The step type of the grib message, when the
+                variable comes from the libmetbuild manifest
 
         Returns:
             None
         """
-        self.__variables.append({"long_name": long_name, "name": name})
+        variable = {"long_name": long_name, "name": name}
+        if step_type is not None:
+            variable["step_type"] = step_type
+        self.__variables.append(variable)
 
     def variables(self) -> List[dict]:
         """
@@ -273,15 +280,9 @@ class NoaaDownloader:
         Returns:
             dict: The byte list for the variable
         """
-        for i in range(len(inventory_data)):
-            if variable["long_name"] in inventory_data[i]:
-                start_bits = inventory_data[i].split(":")[1]
-                if i + 1 == len(inventory_data):
-                    end_bits = ""
-                else:
-                    end_bits = inventory_data[i + 1].split(":")[1]
-                return {"name": variable["name"], "start": start_bits, "end": end_bits}
-        return None
+        from metbuild.gribdataattributes import find_inventory_message
+
+        return find_inventory_message(inventory_data, variable)
 
     @staticmethod
     def __try_get_object(
@@ -414,6 +415,8 @@ class NoaaDownloader:
 
             if file_size > 0:
                 self.s3file().upload_file(local_file, remote_file)
+                self._archive_field_file(local_file, remote_file)
+                self._archive_index_file(local_file, remote_file)
             else:
                 remote_file = None
             os.remove(local_file)
@@ -538,6 +541,8 @@ class NoaaDownloader:
 
                     if file_size > 0:
                         self.__s3file.upload_file(floc, remote_file)
+                        self._archive_field_file(floc, remote_file)
+                        self._archive_index_file(floc, remote_file)
                     else:
                         remote_file = None
                     os.remove(floc)
@@ -581,6 +586,108 @@ class NoaaDownloader:
         """
         raise RuntimeError("Override method not implemented")
 
+    def _archive_field_file(self, local_file: str, remote_file: str) -> None:
+        """
+        Decodes a downloaded grib file into a MetGet field file and archives
+        it next to the grib file, so the build jobs reading the file skip the
+        grib unpacking. This is only done when METGET_FIELD_FILES is set and
+        pymetbuild is available. Set METGET_FIELD_FILE_COMPRESS to store the
+        fields compressed, and METGET_FIELD_FILE_REGION to store only the part
+        of the grid around the region served
+
+        Args:
+            local_file (str): The downloaded grib file
+            remote_file (str): The path the grib file was archived to
+        """
+        import os
+        import logging
+        from metbuild.gribdataattributes import FIELD_FILE_SUFFIX, field_file_region
+
+        logger = logging.getLogger(__name__)
+
+        if not os.environ.get("METGET_FIELD_FILES"):
+            return
+
+        sources = {
+            "gfs_ncep": "GFS",
+            "gefs_ncep": "GEFS",
+            "nam_ncep": "NAM",
+            "hwrf": "HWRF",
+            "hrrr_ncep": "HRRR_CONUS",
+            "hrrr_alaska_ncep": "HRRR_ALASKA",
+            "wpc_ncep": "WPC",
+        }
+        if self.mettype() not in sources:
+            return
+
+        try:
+            import pymetbuild
+        except ImportError:
+            logger.warning("pymetbuild is not available, field files are not written")
+            return
+
+        field_file = local_file + FIELD_FILE_SUFFIX
+        try:
+            pymetbuild.Meteorology.write_field_file(
+                local_file,
+                getattr(pymetbuild.Meteorology, sources[self.mettype()]),
+                field_file,
+                bool(os.environ.get("METGET_FIELD_FILE_COMPRESS")),
+                field_file_region() or [],
+            )
+            self.s3file().upload_file(field_file, remote_file + FIELD_FILE_SUFFIX)
+        except RuntimeError as e:
+            # ...The grib file is still archived, so requests fall back to it
+            logger.warning(
+                "Could not write the field file for {:s}: {:s}".format(
+                    remote_file, str(e)
+                )
+            )
+        finally:
+            if os.path.exists(field_file):
+                os.remove(field_file)
+
+    def _archive_index_file(self, local_file: str, remote_file: str) -> None:
+        """
+        Writes the message index of a downloaded grib file and archives it
+        next to the grib file, so the build jobs reading the file skip the
+        message scan. This is only done when METGET_GRIB_INDEX_FILES is set
+        and pymetbuild is available
+
+        Args:
+            local_file (str): The downloaded grib file
+            remote_file (str): The path the grib file was archived to
+        """
+        import os
+        import logging
+        from metbuild.gribdataattributes import INDEX_FILE_SUFFIX
+
+        logger = logging.getLogger(__name__)
+
+        if not os.environ.get("METGET_GRIB_INDEX_FILES"):
+            return
+
+        try:
+            import pymetbuild
+        except ImportError:
+            logger.warning("pymetbuild is not available, index files are not written")
+            return
+
+        index_file = local_file + INDEX_FILE_SUFFIX
+        try:
+            pymetbuild.Meteorology.write_grib_index(local_file, index_file)
+            self.s3file().upload_file(index_file, remote_file + INDEX_FILE_SUFFIX)
+        except RuntimeError as e:
+            # ...The grib file is still archived, so requests scan it instead
+            logger.warning(
+                "Could not write the index file for {:s}: {:s}".format(
+                    remote_file, str(e)
+                )
+            )
+        finally:
+            if os.path.exists(index_file):
+                os.remove(index_file)
+
     def _download_aws_big_data(self) -> int:
         """
         Downloads data from the AWS big data service
@@ -0,0 +1,570 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+// Native entry point of the build: runs a request described by the same JSON
+// the build service receives, on source files already on local disk, so that
+// builds can be profiled without the Python stack and weight caches can be
+// filled ahead of the forecast cycles
+//
+//   metbuild_cli --request request.json --manifest files.json
+//
+// The manifest lists the source files of each domain of the request, keyed
+// by domain name, in the form the service reads them from its database:
+//
+//   {"gfs": [{"time": "2023-06-01 00:00:00", "filepath": "gfs.f000"}, ...],
+//    "coamps": [{"time": "...", "filepath": ["d01.nc", "d02.nc"]}, ...]}
+//
+// Relative paths are taken from the directory of the manifest. A storm track
+// domain, service nhc, is gridded from the last file of its list
+//
+// A request with "preview": true, or {"stride": 4, "time_stride": 3}, is
+// built quickly for a visual check: nearest neighbour weights on every
+// stride-th grid node and every time_stride-th time step, written to netcdf
+//
+// Options:
+//   --request <file>           request JSON (required)
+//   --manifest <file>          source file manifest (required)
+//   --output <directory>       directory the output is written to (default .)
+//   --threads <n>              size of the thread pool (default processors
+//                              available, within the cgroup cpu quota)
+//   --weight-cache <directory> interpolation weight cache, which otherwise
+//                              comes from METBUILD_WEIGHT_CACHE
+//   --memory-budget <bytes>    memory budget of the build, see BuildRequest
+//   --weights-only             only build and cache the weights of every
+//                              gridded domain from its first file
+//   --trace <file>             write a timeline of every stage
+//   --counters                 sample the hardware counters of each stage
+//                              on Linux, into the report and the trace
+//   --report <file>            write the report to a file instead of stdout
+//
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BuildRequest.h"
+#include "Date.h"
+#include "Grid.h"
+#include "Instrumentation.h"
+#include "InterpolationCache.h"
+#include "Logging.h"
+#include "Meteorology.h"
+#include "ResourceLimits.h"
+#include "ThreadPool.h"
+#include "boost/filesystem.hpp"
+#include "boost/property_tree/json_parser.hpp"
+#include "boost/property_tree/ptree.hpp"
+#include "output/DelftOutput.h"
+#include "output/GribOutput.h"
+#include "output/OutputFile.h"
+#include "output/OwiAscii.h"
+#include "output/OwiBinary.h"
+#include "output/OwiNetcdf.h"
+#include "output/RasNetcdf.h"
+#include "output/StreamCompression.h"
+#include "output/ZarrOutput.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Tree = boost::property_tree::ptree;
+
+struct Options {
+  std::string request;
+  std::string manifest;
+  std::string output = ".";
+  size_t threads = 0;
+  std::string weight_cache;
+  size_t memory_budget = 0;
+  bool weights_only = false;
+  std::string trace;
+  bool counters = false;
+  std::string report;
+};
+
+struct SourceFile {
+  std::vector<std::string> filenames;
+  MetBuild::Date time;
+};
+
+struct Domain {
+  std::string name;
+  std::string service;
+  std::unique_ptr<MetBuild::Grid> grid;
+  std::vector<SourceFile> files;
+};
+
+struct Request {
+  MetBuild::Date start;
+  MetBuild::Date end;
+  int time_step = 0;
+  std::string format;
+  std::string data_type = "wind_pressure";
+  std::string filename;
+  std::string compression = "none";
+  bool backfill = false;
+  int epsg = 4326;
+  bool preview = false;
+  std::vector<Domain> domains;
+};
+
+//...Defaults of a preview request
+constexpr size_t c_preview_stride = 4;
+constexpr int c_preview_time_stride = 3;
+
+[[noreturn]] void fail(const std::string &message) {
+  std::cerr << "[ERROR]: " << message << std::endl;
+  std::exit(1);
+}
+
+//...Accepts the forms the service is sent, with or without seconds and in
+// ISO 8601 with a trailing UTC designator
+MetBuild::Date parse_date(std::string value) {
+  std::replace(value.begin(), value.end(), 'T', ' ');
+  if (!value.empty() && value.back() == 'Z') value.pop_back();
+  const auto colons = std::count(value.begin(), value.end(), ':');
+  MetBuild::Date date;
+  date.fromString(value, colons == 1 ? "%Y-%m-%d %H:%M" : "%Y-%m-%d %H:%M:%S");
+  return date;
+}
+
+MetBuild::Meteorology::SOURCE source_key(const std::string &service) {
+  if (service == "gfs-ncep") return MetBuild::Meteorology::GFS;
+  if (service == "gefs-ncep") return MetBuild::Meteorology::GEFS;
+  if (service == "nam-ncep") return MetBuild::Meteorology::NAM;
+  if (service == "hwrf") return MetBuild::Meteorology::HWRF;
+  if (service == "hrrr-ncep") return MetBuild::Meteorology::HRRR_CONUS;
+  if (service == "hrrr-alaska-ncep") return MetBuild::Meteorology::HRRR_ALASKA;
+  if (service == "wpc-ncep") return MetBuild::Meteorology::WPC;
+  if (service == "coamps-tc" || service == "coamps-ctcx") {
+    return MetBuild::Meteorology::COAMPS;
+  }
+  fail("Invalid data source " + service);
+}
+
+MetBuild::GriddedDataTypes::TYPE type_key(const std::string &data_type) {
+  if (data_type == "wind_pressure") {
+    return MetBuild::GriddedDataTypes::WIND_PRESSURE;
+  }
+  if (data_type == "rain") return MetBuild::GriddedDataTypes::RAINFALL;
+  if (data_type == "humidity") return MetBuild::GriddedDataTypes::HUMIDITY;
+  if (data_type == "temperature") {
+    return MetBuild::GriddedDataTypes::TEMPERATURE;
+  }
+  if (data_type == "ice") return MetBuild::GriddedDataTypes::ICE;
+  fail("Invalid data type " + data_type);
+}
+
+//...Same two forms of grid as the service, by corners or by cell count
+std::unique_ptr<MetBuild::Grid> parse_grid(const Tree &t, const int epsg) {
+  const auto x0 = t.get<double>("x_init");
+  const auto y0 = t.get<double>("y_init");
+  const auto dx = t.get<double>("di");
+  const auto dy = t.get<double>("dj");
+  if (t.count("ni") != 0) {
+    return std::make_unique<MetBuild::Grid>(
+        x0, y0, t.get<size_t>("ni"), t.get<size_t>("nj"), dx, dy,
+        t.get<double>("rotation", 0.0), epsg);
+  }
+  return std::make_unique<MetBuild::Grid>(
+      x0, y0, t.get<double>("x_end"), t.get<double>("y_end"), dx, dy, epsg);
+}
+
+std::vector<SourceFile> parse_files(const Tree &entries,
+                                    const boost::filesystem::path &base) {
+  const auto resolve = [&](const std::string &f) {
+    const boost::filesystem::path p(f);
+    return (p.is_absolute() ? p : base / p).string();
+  };
+  std::vector<SourceFile> files;
+  for (const auto &e : entries) {
+    SourceFile f{{}, parse_date(e.second.get<std::string>("time"))};
+    const auto &path = e.second.get_child("filepath");
+    if (path.empty()) {
+      f.filenames.push_back(resolve(path.data()));
+    } else {
+      for (const auto &p : path) {
+        f.filenames.push_back(resolve(p.second.data()));
+      }
+    }
+    files.push_back(std::move(f));
+  }
+  std::sort(files.begin(), files.end(),
+            [](const SourceFile &a, const SourceFile &b) {
+              return a.time < b.time;
+            });
+  return files;
+}
+
+Request parse_request(const Options &o) {
+  Tree request, manifest;
+  boost::property_tree::read_json(o.request, request);
+  boost::property_tree::read_json(o.manifest, manifest);
+  const auto base = boost::filesystem::absolute(o.manifest).parent_path();
+
+  Request r;
+  r.start = parse_date(request.get<std::string>("start_date"));
+  r.end = parse_date(request.get<std::string>("end_date"));
+  r.time_step = request.get<int>("time_step");
+  r.format = request.get<std::string>("format");
+  r.filename = request.get<std::string>("filename");
+  r.data_type = request.get<std::string>("data_type", r.data_type);
+  r.backfill = request.get<bool>("backfill", false);
+  r.epsg = request.get<int>("epsg", 4326);
+
+  //...Given either as a codec name or as a flag selecting gzip
+  const auto compression = request.get<std::string>("compression", "false");
+  if (compression == "true") {
+    r.compression = "gzip";
+  } else if (compression != "false") {
+    r.compression = compression;
+  }
+
+  //...Given either as a flag or as an object with the strides
+  size_t stride = 1;
+  const auto preview = request.get_child_optional("preview");
+  if (preview && (preview->data() == "true" || !preview->empty())) {
+    r.preview = true;
+    r.format = "owi-netcdf";
+    r.compression = "none";
+    stride = preview->get<size_t>("stride", c_preview_stride);
+    r.time_step *= preview->get<int>("time_stride", c_preview_time_stride);
+    if (stride == 0 || r.time_step <= 0) {
+      fail("Preview strides must be positive");
+    }
+  }
+  if (r.format == "owi-netcdf" || r.format == "adcirc-netcdf" ||
+      r.format == "hec-netcdf") {
+    if (boost::filesystem::path(r.filename).extension() != ".nc") {
+      r.filename += ".nc";
+    }
+  } else if (r.format == "zarr") {
+    if (boost::filesystem::path(r.filename).extension() != ".zarr") {
+      r.filename += ".zarr";
+    }
+  }
+  r.filename = (boost::filesystem::path(o.output) / r.filename).string();
+  if (!(r.start < r.end) || r.time_step <= 0) fail("Request dates are not valid");
+
+  for (const auto &d : request.get_child("domains")) {
+    Domain domain;
+    domain.name = d.second.get<std::string>("name");
+    domain.service = d.second.get<std::string>("service");
+    domain.grid = parse_grid(d.second, r.epsg);
+    if (stride > 1) {
+      domain.grid = std::make_unique<MetBuild::Grid>(
+          domain.grid->strided(stride));
+    }
+    const auto files = manifest.get_child_optional(
+        Tree::path_type(domain.name, '\0'));
+    if (!files || files->empty()) {
+      fail("No files are listed for domain " + domain.name);
+    }
+    domain.files = parse_files(*files, base);
+    r.domains.push_back(std::move(domain));
+  }
+  if (r.domains.empty()) fail("You must specify one or more domains");
+  return r;
+}
+
+std::vector<std::string> variables(const std::string &data_type) {
+  if (data_type == "wind_pressure") return {"wind_u", "wind_v", "mslp"};
+  return {data_type};
+}
+
+//...Output files are named as the service names them
+std::unique_ptr<MetBuild::OutputFile> make_output(const Request &r) {
+  const auto &f = r.format;
+  const bool ascii = f == "ascii" || f == "owi-ascii" || f == "adcirc-ascii";
+  const bool binary = f == "owi-binary" || f == "adcirc-binary";
+  const auto codec = MetBuild::StreamCompression::fromName(r.compression);
+
+  std::unique_ptr<MetBuild::OutputFile> output;
+  if (ascii) {
+    auto owi = std::make_unique<MetBuild::OwiAscii>(r.start, r.end,
+                                                    r.time_step);
+    owi->set_compression(codec);
+    output = std::move(owi);
+  } else if (binary) {
+    auto owi = std::make_unique<MetBuild::OwiBinary>(r.start, r.end,
+                                                     r.time_step);
+    owi->set_compression(codec);
+    output = std::move(owi);
+  } else if (f == "owi-netcdf" || f == "adcirc-netcdf") {
+    output = std::make_unique<MetBuild::OwiNetcdf>(r.start, r.end,
+                                                   r.time_step, r.filename);
+  } else if (f == "hec-netcdf") {
+    output = std::make_unique<MetBuild::RasNetcdf>(r.start, r.end,
+                                                   r.time_step, r.filename);
+  } else if (f == "delft3d") {
+    output = std::make_unique<MetBuild::DelftOutput>(r.start, r.end,
+                                                     r.time_step, r.filename);
+  } else if (f == "zarr") {
+    output = std::make_unique<MetBuild::ZarrOutput>(r.start, r.end,
+                                                    r.time_step, r.filename);
+  } else if (f == "grib2") {
+    output = std::make_unique<MetBuild::GribOutput>(r.start, r.end,
+                                                    r.time_step);
+  } else {
+    fail("Invalid output format selected: " + f);
+  }
+
+  for (size_t i = 0; i < r.domains.size(); ++i) {
+    const auto &d = r.domains[i];
+    char suffix[8];
+    std::snprintf(suffix, sizeof(suffix), "_%02zu", i);
+    const auto prefix = r.filename + suffix;
+    if (ascii || binary) {
+      std::vector<std::string> fns;
+      if (r.data_type == "wind_pressure") {
+        fns = {prefix + ".pre", prefix + ".wnd"};
+      } else if (r.data_type == "rain") {
+        fns = {r.filename + ".precip"};
+      } else if (r.data_type == "humidity") {
+        fns = {r.filename + ".humid"};
+      } else if (r.data_type == "ice") {
+        fns = {r.filename + ".ice"};
+      } else {
+        fail("Invalid variable requested");
+      }
+      for (auto &fn : fns) {
+        if (binary) fn += ".bin";
+        fn += MetBuild::StreamCompression::extension(codec);
+      }
+      output->addDomain(*d.grid, fns);
+    } else if (f == "owi-netcdf" || f == "adcirc-netcdf") {
+      output->addDomain(*d.grid, {d.name});
+    } else if (f == "grib2") {
+      std::vector<std::string> fns = {prefix + ".grib2"};
+      if (r.data_type != "wind_pressure") fns.push_back(r.data_type);
+      output->addDomain(*d.grid, fns);
+    } else {
+      output->addDomain(*d.grid, variables(r.data_type));
+    }
+  }
+  return output;
+}
+
+std::string quote(const std::string &value) {
+  std::string s = "\"";
+  for (const char c : value) {
+    if (c == '"' || c == '\\') s += '\\';
+    s += c;
+  }
+  return s + "\"";
+}
+
+void write_report(std::ostream &os, const Request &r,
+                  const std::vector<std::string> &outputs,
+                  const std::vector<std::vector<std::string>> &files_used,
+                  const MetBuild::InstrumentationReport &report,
+                  const size_t memory_budget, const double wall) {
+  os << "{\n  \"wall_seconds\": " << wall << ",\n  \"output_files\": [";
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    os << (i == 0 ? "" : ", ") << quote(outputs[i]);
+  }
+  os << "],\n  \"files_used\": {";
+  for (size_t i = 0; i < files_used.size() && i < r.domains.size(); ++i) {
+    os << (i == 0 ? "\n" : ",\n") << "    " << quote(r.domains[i].name)
+       << ": [";
+    for (size_t k = 0; k < files_used[i].size(); ++k) {
+      os << (k == 0 ? "" : ", ") << quote(files_used[i][k]);
+    }
+    os << "]";
+  }
+  os << "\n  },\n  \"stages\": {";
+  const auto names = MetBuild::Instrumentation::names();
+  size_t n = 0;
+  for (size_t i = 0; i < names.size(); ++i) {
+    const int stage = static_cast<int>(i);
+    if (report.calls(stage) == 0) continue;
+    os << (n++ == 0 ? "\n" : ",\n") << "    " << quote(names[i])
+       << ": {\"calls\": " << report.calls(stage)
+       << ", \"seconds\": " << report.seconds(stage)
+       << ", \"items\": " << report.items(stage);
+    if (report.counter(stage, MetBuild::Instrumentation::CYCLES) != 0) {
+      const auto counters = MetBuild::Instrumentation::counter_names();
+      os << ", \"counters\": {";
+      for (size_t k = 0; k < counters.size(); ++k) {
+        os << quote(counters[k]) << ": "
+           << report.counter(stage, static_cast<int>(k)) << ", ";
+      }
+      os << "\"ipc\": " << report.instructions_per_cycle(stage)
+         << ", \"llc_mpki\": "
+         << report.misses_per_kilo_instruction(
+                stage, MetBuild::Instrumentation::LLC_MISSES)
+         << ", \"branch_mpki\": "
+         << report.misses_per_kilo_instruction(
+                stage, MetBuild::Instrumentation::BRANCH_MISSES)
+         << "}";
+    }
+    os << "}";
+  }
+  os << "\n  },\n  \"peak_rss_bytes\": " << report.process_peak_rss()
+     << ",\n  \"resources\": {\"threads\": "
+     << MetBuild::ThreadPool::defaultThreadCount()
+     << ", \"cpu_quota\": " << MetBuild::ResourceLimits::cpuQuota()
+     << ", \"memory_limit_bytes\": "
+     << MetBuild::ResourceLimits::memoryLimit()
+     << ", \"memory_budget_bytes\": " << memory_budget << "}\n}\n";
+}
+
+//...Each gridded domain builds its weights from its first file, which the
+// weight cache then holds for the builds that follow
+int prepare_weights(const Request &r) {
+  if (!MetBuild::InterpolationCache::enabled()) {
+    fail("The weight cache is disabled, set --weight-cache");
+  }
+  for (const auto &d : r.domains) {
+    if (d.service == "nhc") continue;
+    MetBuild::Meteorology m(d.grid.get(), source_key(d.service),
+                            type_key(r.data_type), r.backfill, r.epsg);
+    const auto key = m.prepare_weights(d.files.front().filenames);
+    std::cout << quote(d.name) << ": " << quote(key) << std::endl;
+  }
+  return 0;
+}
+
+int build(const Options &o, const Request &r) {
+  boost::filesystem::create_directories(o.output);
+  const auto t = Clock::now();
+  std::vector<std::string> outputs;
+  std::vector<std::vector<std::string>> files_used;
+  MetBuild::InstrumentationReport report;
+  size_t memory_budget = 0;
+  {
+    auto output = make_output(r);
+    MetBuild::BuildRequest request(output.get(), r.start, r.end, r.time_step);
+    if (o.memory_budget != 0) request.set_memory_budget(o.memory_budget);
+    if (r.preview) {
+      request.set_interpolation_method(
+          MetBuild::Meteorology::NEAREST_NEIGHBOUR);
+    }
+    for (size_t i = 0; i < r.domains.size(); ++i) {
+      const auto &d = r.domains[i];
+      if (d.service == "nhc") {
+        if (r.data_type != "wind_pressure") {
+          fail("NHC tracks only provide wind and pressure");
+        }
+        request.add_vortex_domain(i, d.grid.get(),
+                                  d.files.back().filenames.front());
+        continue;
+      }
+      request.add_domain(i, d.grid.get(), source_key(d.service),
+                         type_key(r.data_type), r.backfill, r.epsg);
+      for (const auto &f : d.files) request.add_file(i, f.filenames, f.time);
+    }
+
+    if (!o.trace.empty()) MetBuild::Instrumentation::start_trace();
+    files_used = request.run();
+    if (!o.trace.empty()) {
+      MetBuild::Instrumentation::stop_trace();
+      MetBuild::Instrumentation::write_trace(o.trace);
+    }
+    report = request.statistics();
+    memory_budget = request.memory_budget();
+    outputs = output->filenames();
+    //...Closing the files flushes any buffered or asynchronous writes
+  }
+  const auto wall =
+      std::chrono::duration<double>(Clock::now() - t).count();
+
+  if (o.report.empty()) {
+    write_report(std::cout, r, outputs, files_used, report, memory_budget,
+                 wall);
+  } else {
+    std::ofstream f(o.report);
+    write_report(f, r, outputs, files_used, report, memory_budget, wall);
+  }
+  return 0;
+}
+
+Options parse(int argc, char **argv) {
+  Options o;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc) fail("Missing value for " + arg);
+      return argv[++i];
+    };
+    if (arg == "--request") {
+      o.request = value();
+    } else if (arg == "--manifest") {
+      o.manifest = value();
+    } else if (arg == "--output") {
+      o.output = value();
+    } else if (arg == "--threads") {
+      o.threads = std::stoul(value());
+    } else if (arg == "--weight-cache") {
+      o.weight_cache = value();
+    } else if (arg == "--memory-budget") {
+      o.memory_budget = std::stoull(value());
+    } else if (arg == "--weights-only") {
+      o.weights_only = true;
+    } else if (arg == "--trace") {
+      o.trace = value();
+    } else if (arg == "--counters") {
+      o.counters = true;
+    } else if (arg == "--report") {
+      o.report = value();
+    } else {
+      fail("Unknown option " + arg);
+    }
+  }
+  if (o.request.empty() || o.manifest.empty()) {
+    fail("Both --request and --manifest are required");
+  }
+  return o;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const auto options = parse(argc, argv);
+  if (options.threads != 0) {
+    MetBuild::ThreadPool::setDefaultThreadCount(options.threads);
+  }
+  if (!options.weight_cache.empty()) {
+    MetBuild::InterpolationCache::setDirectory(options.weight_cache);
+  }
+  if (options.counters) MetBuild::Instrumentation::set_counter_sampling(true);
+
+  try {
+    const auto request = parse_request(options);
+    if (options.weights_only) return prepare_weights(request);
+    return build(options, request);
+  } catch (const std::exception &e) {
+    fail(e.what());
+  }
+}
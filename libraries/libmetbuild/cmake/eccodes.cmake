@@ -41,6 +41,11 @@ set(ENABLE_PRODUCT_BUFR
 set(BUILD_SHARED_LIBS
     OFF
     CACHE BOOL "Enable building shared libraries")
+# ...Handles are created and decoded on several threads at once, which
+# requires the eccodes context to lock its shared state
+set(ENABLE_ECCODES_THREADS
+    ON
+    CACHE BOOL "Enable POSIX threads in eccodes")
 set(ENABLE_TESTS OFF CACHE BOOL "Enable ecCodes tests")
 set(ENABLE_TESTING OFF CACHE BOOL "Enable ecCodes tests")
 set(ENABLE_EXAMPLES OFF CACHE BOOL "Disable ecCodes examples")
@@ -67,6 +72,7 @@ mark_as_advanced(
   ENABLE_INSTALL_ECCODES_DEFINIT
   ENABLE_INSTALL_ECCODES_SAMPLES
   ENABLE_FORTRAN
+  ENABLE_ECCODES_THREADS
   ENABLE_EXAMPLES
   ENABLE_AEC
   ECMWF_USER
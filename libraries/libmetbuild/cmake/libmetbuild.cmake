@@ -32,39 +32,129 @@
 set(METBUILD_SOURCES
     ${CMAKE_CURRENT_SOURCE_DIR}/src/Date.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/Meteorology.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/MeteorologyPipeline.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/BuildRequest.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/BuildRequest.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/RequestEstimate.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/RequestEstimate.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/RequestKey.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/RequestKey.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/CompositeMeteorology.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/CompositeMeteorology.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/CellOrder.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/CellOrder.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/EnsembleReduction.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/EnsembleReduction.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/ExecutionPlan.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/ExecutionPlan.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/ExecutionPolicy.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/ExecutionPolicy.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/TemporalEnvelope.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/TemporalEnvelope.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/Geometry.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/Geometry.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/Grid.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/LocatorCache.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/LocatorCache.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/Logging.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/DerivedWind.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/NetcdfCompression.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/NetcdfParallel.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/NetcdfWriteBuffer.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/output/OwiNcFile.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/output/OwiAscii.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/output/OwiNetcdf.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/output/OwiAsciiDomain.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/OwiBinary.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/OwiBinaryDomain.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/output/OwiNetcdfDomain.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/output/RasNetcdf.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/output/RasNetcdfDomain.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/PointNetcdf.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/PointNetcdfDomain.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/OutputStitch.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/output/DelftOutput.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/output/DelftDomain.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/ZarrOutput.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/ZarrDomain.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/EnvelopeOutput.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/EnvelopeDomain.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/GribOutput.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/GribDomain.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/OutputGroup.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/OutputFanout.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/ShardedOutput.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/Overview.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/ParallelCompressionBuffer.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/StreamCompression.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/AsyncWriter.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/Checkpoint.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/PublicationManifest.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/FileSink.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/output/FileChecksum.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/vortex/AtcfTrack.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/vortex/AtcfTrack.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/vortex/HollandVortex.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/vortex/HollandVortex.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/MovingGrid.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/MovingGrid.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/NestedDomain.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/NestedDomain.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/Utilities.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/Projection.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/FileWrapper.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/FileWrapper.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/GribHandle.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/GribHandle.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/GribIndex.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/GribIndex.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/GribUnpacker.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/GribUnpacker.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/MappedFile.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/MappedFile.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/VariableNames.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/Triangulation.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/Triangulation.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/PointLocator.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/StructuredLocator.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/StructuredLocator.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/CurvilinearLocator.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/CurvilinearLocator.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/CroppedLocator.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/CroppedLocator.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/ConnectivityLocator.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/ConnectivityLocator.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/InverseDistanceLocator.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/InverseDistanceLocator.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/NestLocator.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/NestLocator.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/NearestLocator.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/NearestLocator.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/TiledLocator.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/TiledLocator.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/TriangulationPrivate.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/TriangulationPrivate.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/TriangleBuckets.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/TriangleBuckets.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/InterpolationWeights.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/InterpolationWeights.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/SparseWeights.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/SparseWeights.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/DeviceRemap.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/DeviceRemap.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/InterpolationWeight.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/Grib.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/GriddedData.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/GriddedData.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/SourceProbe.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/GribMessage.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/GfsData.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/GefsData.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/HrrrConusData.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/NamData.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/HwrfData.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/GribSource.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/SourceTraits.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/CoampsData.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/CoampsData.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/CoampsDomain.cpp
@@ -72,8 +162,55 @@ set(METBUILD_SOURCES
     ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/NetcdfFile.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/NetcdfFile.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/GriddedDataTypes.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/FieldFile.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/FieldFile.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/ArrayData.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/data_sources/ArrayData.h
     ${CMAKE_CURRENT_SOURCE_DIR}/src/InterpolationData.cpp
-    ${CMAKE_CURRENT_SOURCE_DIR}/src/InterpolationData.h)
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/InterpolationData.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/InterpolationCache.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/InterpolationCache.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/WeightFile.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/WeightFile.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/SharedFieldStore.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/SharedFieldStore.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/SnapshotCache.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/SnapshotCache.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/SnapshotStore.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/SnapshotStore.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/SharedCache.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/WarmCache.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/WarmCache.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/Metrics.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/Metrics.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/BufferPool.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/Instrumentation.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/Instrumentation.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/InterpolationKernel.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/InterpolationKernel.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/StepStatistics.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/StepStatistics.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/PointSeries.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/PointSeries.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/Coupler.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/Coupler.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/CouplingRing.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/CouplingRing.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/MetBuildCoupling.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/MetBuildCoupling.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/Hash.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/Md5.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/Md5.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/GridFingerprint.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/Span.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/AlignedAllocator.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/LargeBufferAllocator.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/MemoryPolicy.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/MemoryPolicy.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/ResourceLimits.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/ResourceLimits.h
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/ThreadPool.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/ThreadPool.h)
 
 add_library(metbuild_interface INTERFACE)
 add_library(metbuild_objectlib OBJECT ${METBUILD_SOURCES})
@@ -85,7 +222,8 @@ find_package(PROJ REQUIRED)
 find_package(SQLite3 REQUIRED)
 find_package(TIFF REQUIRED)
 find_package(GMP REQUIRED)
-find_package(Boost REQUIRED COMPONENTS iostreams system)
+find_package(Boost REQUIRED COMPONENTS iostreams system filesystem)
+find_package(Threads REQUIRED)
 
 set_property(TARGET metbuild_objectlib PROPERTY POSITION_INDEPENDENT_CODE 1)
 target_link_libraries(metbuild_static metbuild_interface)
@@ -113,12 +251,97 @@ set(metbuild_include_list
     ${GMP_INCLUDE_DIRS})
 
 target_compile_definitions(metbuild_objectlib PRIVATE CGAL_DISABLE_ROUNDING_MATH_CHECK)
+
+# ...Keeps decoded source fields and interpolation weights in single precision.
+# The definition changes the library's types, so it is also passed to everything
+# linking against it
+option(METBUILD_SOURCE_FLOAT "Use single precision source data and weights" OFF)
+if(METBUILD_SOURCE_FLOAT)
+  target_compile_definitions(metbuild_objectlib PRIVATE METBUILD_SOURCE_FLOAT)
+  target_compile_definitions(metbuild_interface INTERFACE METBUILD_SOURCE_FLOAT)
+endif()
+
+# ...Runs the device remapping kernels through OpenMP target offload. The
+# compiler flags selecting the device, such as -fopenmp-targets=nvptx64, are
+# taken from METBUILD_OFFLOAD_FLAGS
+option(METBUILD_ENABLE_OFFLOAD "Offload weight application to a device" OFF)
+if(METBUILD_ENABLE_OFFLOAD)
+  find_package(OpenMP REQUIRED)
+  set(METBUILD_OFFLOAD_FLAGS
+      ""
+      CACHE STRING "Compiler and linker flags selecting the offload device")
+  separate_arguments(metbuild_offload_flags UNIX_COMMAND
+                     "${METBUILD_OFFLOAD_FLAGS}")
+  set_source_files_properties(
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/DeviceRemap.cpp
+    PROPERTIES COMPILE_DEFINITIONS METBUILD_OFFLOAD COMPILE_OPTIONS
+                                                    "${metbuild_offload_flags}")
+  target_link_libraries(metbuild_interface INTERFACE OpenMP::OpenMP_CXX
+                                                     ${metbuild_offload_flags})
+  target_link_libraries(metbuild_objectlib PRIVATE OpenMP::OpenMP_CXX)
+endif()
+
+# ...Lets the ranks of an MPI job write their time shards of a request into
+# one shared netCDF file. The netCDF library must be built with parallel I/O.
+# The definition changes the library's headers, so it is also passed to
+# everything linking against it
+option(METBUILD_ENABLE_PARALLEL_NETCDF "Write shared netCDF files over MPI"
+       OFF)
+if(METBUILD_ENABLE_PARALLEL_NETCDF)
+  find_package(MPI REQUIRED COMPONENTS C)
+  include(CheckCSourceCompiles)
+  set(CMAKE_REQUIRED_INCLUDES ${NETCDF_INCLUDE_DIRS} ${MPI_C_INCLUDE_DIRS})
+  check_c_source_compiles(
+    "#include <netcdf_meta.h>
+    #if !NC_HAS_PARALLEL4
+    #error netCDF without parallel I/O
+    #endif
+    int main(void) { return 0; }"
+    METBUILD_NC_PARALLEL4)
+  unset(CMAKE_REQUIRED_INCLUDES)
+  if(NOT METBUILD_NC_PARALLEL4)
+    message(FATAL_ERROR "The netCDF library was built without parallel I/O")
+  endif()
+  target_compile_definitions(metbuild_objectlib
+                             PRIVATE METBUILD_PARALLEL_NETCDF)
+  target_compile_definitions(metbuild_interface
+                             INTERFACE METBUILD_PARALLEL_NETCDF)
+  target_link_libraries(metbuild_objectlib PRIVATE MPI::MPI_C)
+  target_link_libraries(metbuild_interface INTERFACE MPI::MPI_C)
+endif()
+
+# ...Adds zstd and lz4 as codecs for the compressed text and binary outputs,
+# alongside gzip which is always available
+option(METBUILD_ENABLE_ZSTD "Allow zstd compressed text outputs" OFF)
+if(METBUILD_ENABLE_ZSTD)
+  find_path(ZSTD_INCLUDE_DIR zstd.h)
+  find_library(ZSTD_LIBRARY NAMES zstd)
+  if(NOT ZSTD_INCLUDE_DIR OR NOT ZSTD_LIBRARY)
+    message(FATAL_ERROR "The zstd library was not found")
+  endif()
+  target_compile_definitions(metbuild_objectlib PRIVATE METBUILD_ZSTD)
+  target_include_directories(metbuild_objectlib PRIVATE ${ZSTD_INCLUDE_DIR})
+  target_link_libraries(metbuild_interface INTERFACE ${ZSTD_LIBRARY})
+endif()
+
+option(METBUILD_ENABLE_LZ4 "Allow lz4 compressed text outputs" OFF)
+if(METBUILD_ENABLE_LZ4)
+  find_path(LZ4_INCLUDE_DIR lz4frame.h)
+  find_library(LZ4_LIBRARY NAMES lz4)
+  if(NOT LZ4_INCLUDE_DIR OR NOT LZ4_LIBRARY)
+    message(FATAL_ERROR "The lz4 library was not found")
+  endif()
+  target_compile_definitions(metbuild_objectlib PRIVATE METBUILD_LZ4)
+  target_include_directories(metbuild_objectlib PRIVATE ${LZ4_INCLUDE_DIR})
+  target_link_libraries(metbuild_interface INTERFACE ${LZ4_LIBRARY})
+endif()
 target_include_directories(metbuild_objectlib PRIVATE ${metbuild_include_list})
 
 target_link_libraries(
   metbuild_interface
   INTERFACE ${NETCDF_LIBRARIES} ${PROJ_LIBRARY} ${SQLite3_LIBRARIES}
-            ${Boost_LIBRARIES} eccodes ${TIFF_LIBRARY_RELEASE} ${GMP_LIBRARIES})
+            ${Boost_LIBRARIES} eccodes ${TIFF_LIBRARY_RELEASE} ${GMP_LIBRARIES}
+            Threads::Threads)
 target_link_libraries(metbuild_static metbuild_interface)
 target_link_libraries(metbuild metbuild_interface)
 
@@ -0,0 +1,42 @@
+# ##############################################################################
+# MetBuild Cmake Build System
+#
+# MIT License
+#
+# Copyright (c) 2020 ADCIRC Development Group
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+# Author: Zach Cobell
+# Contact: zcobell@thewaterinstitute.org
+#
+# ##############################################################################
+
+# ...Native entry point running a request JSON on local files, for profiling
+# without the Python stack and for filling the weight cache ahead of builds
+option(METBUILD_BUILD_CLI "Build the metbuild_cli executable" ON)
+if(METBUILD_BUILD_CLI)
+  add_executable(metbuild_cli ${CMAKE_CURRENT_SOURCE_DIR}/cli/metbuild_cli.cpp)
+  add_dependencies(metbuild_cli metbuild_static)
+  target_link_libraries(metbuild_cli metbuild_static metbuild_interface)
+  target_include_directories(metbuild_cli PRIVATE ${metbuild_include_list})
+  target_compile_features(metbuild_cli PRIVATE cxx_std_17)
+  install(TARGETS metbuild_cli RUNTIME DESTINATION ${CMAKE_INSTALL_BINDIR}
+                                       COMPONENT METGET_RUNTIME)
+endif()
@@ -38,17 +38,32 @@ if(UNIX OR CYGWIN)
     add_library(catch_boilerplate ${CMAKE_CURRENT_SOURCE_DIR}/testing/cxx_tests/catch_boilerplate.cpp)
     target_include_directories(catch_boilerplate PRIVATE ${CMAKE_CURRENT_SOURCE_DIR}/thirdparty/catch2)
 
-    set(TEST_LIST cxx_test_windgrid.cpp cxx_test_gfs.cpp cxx_test_coamps.cpp)
+    set(TEST_LIST cxx_test_windgrid.cpp cxx_test_gfs.cpp cxx_test_coamps.cpp
+                  cxx_test_locators.cpp cxx_test_meteorologicaldata.cpp
+                  cxx_test_gzip.cpp cxx_test_asyncwriter.cpp
+                  cxx_test_owibinary.cpp cxx_test_zarr.cpp
+                  cxx_test_snapshotcache.cpp cxx_test_vortex.cpp
+                  cxx_test_composite.cpp cxx_test_geometry.cpp
+                  cxx_test_estimate.cpp cxx_test_stitch.cpp
+                  cxx_test_threadpool.cpp cxx_test_derivedwind.cpp
+                  cxx_test_statistics.cpp cxx_test_filesink.cpp
+                  cxx_test_warmcache.cpp cxx_test_grib.cpp
+                  cxx_test_cellorder.cpp cxx_test_coupling.cpp)
 
     foreach(TESTFILE ${TEST_LIST})
       get_filename_component(TESTNAME ${TESTFILE} NAME_WE)
-      add_executable(${TESTNAME}
-                     ${CMAKE_SOURCE_DIR}/testing/cxx_tests/${TESTFILE})
+      # ...Every test links the allocation counter so that any of them can
+      # check a steady state
+      add_executable(
+        ${TESTNAME} ${CMAKE_SOURCE_DIR}/testing/cxx_tests/${TESTFILE}
+                    ${CMAKE_SOURCE_DIR}/testing/cxx_tests/allocation_counter.cpp)
       add_dependencies(${TESTNAME} metbuild_static catch_boilerplate)
       target_link_libraries(${TESTNAME} metbuild_static metbuild_interface catch_boilerplate)
       target_include_directories(
         ${TESTNAME} PRIVATE ${CMAKE_CURRENT_SOURCE_DIR}/src
-                            ${CMAKE_CURRENT_SOURCE_DIR}/thirdparty/catch2)
+                            ${CMAKE_CURRENT_SOURCE_DIR}/thirdparty/catch2
+                            ${CMAKE_CURRENT_SOURCE_DIR}/testing/cxx_tests
+                            ${Boost_INCLUDE_DIRS})
       set_target_properties(
         ${TESTNAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY
                                ${CMAKE_BINARY_DIR}/cxx_testcases)
@@ -60,4 +75,64 @@ if(UNIX OR CYGWIN)
     endforeach()
 
   endif()
+
+  # ...Benchmarks are run by hand and are not registered with ctest
+  option(METBUILD_BUILD_BENCHMARKS OFF "Build the metbuild_bench benchmarks")
+  if(METBUILD_BUILD_BENCHMARKS)
+    file(MAKE_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}/cxx_testcases)
+    add_executable(
+      metbuild_bench
+      ${CMAKE_SOURCE_DIR}/testing/cxx_benchmarks/bench_main.cpp
+      ${CMAKE_SOURCE_DIR}/testing/cxx_benchmarks/bench_metbuild.cpp
+      ${CMAKE_SOURCE_DIR}/testing/cxx_tests/allocation_counter.cpp)
+    add_dependencies(metbuild_bench metbuild_static)
+    target_link_libraries(metbuild_bench metbuild_static metbuild_interface)
+    target_compile_definitions(metbuild_bench
+                               PRIVATE CATCH_CONFIG_ENABLE_BENCHMARKING)
+    target_include_directories(
+      metbuild_bench PRIVATE ${CMAKE_CURRENT_SOURCE_DIR}/src
+                             ${CMAKE_CURRENT_SOURCE_DIR}/thirdparty/catch2
+                             ${CMAKE_CURRENT_SOURCE_DIR}/testing/cxx_tests
+                             ${Boost_INCLUDE_DIRS})
+    set_target_properties(
+      metbuild_bench PROPERTIES RUNTIME_OUTPUT_DIRECTORY
+                                ${CMAKE_BINARY_DIR}/cxx_testcases)
+
+    # ...End-to-end replay of full builds, reported as JSON
+    add_executable(metbuild_replay
+                   ${CMAKE_SOURCE_DIR}/testing/cxx_benchmarks/replay.cpp)
+    add_dependencies(metbuild_replay metbuild_static)
+    target_link_libraries(metbuild_replay metbuild_static metbuild_interface)
+    target_include_directories(
+      metbuild_replay PRIVATE ${CMAKE_CURRENT_SOURCE_DIR}/src
+                              ${Boost_INCLUDE_DIRS})
+    set_target_properties(
+      metbuild_replay PROPERTIES RUNTIME_OUTPUT_DIRECTORY
+                                 ${CMAKE_BINARY_DIR}/cxx_testcases)
+
+    # ...Compares the fast paths against the reference path
+    add_executable(metbuild_equivalence
+                   ${CMAKE_SOURCE_DIR}/testing/cxx_benchmarks/equivalence.cpp)
+    add_dependencies(metbuild_equivalence metbuild_static)
+    target_link_libraries(metbuild_equivalence metbuild_static
+                          metbuild_interface)
+    target_include_directories(
+      metbuild_equivalence PRIVATE ${CMAKE_CURRENT_SOURCE_DIR}/src
+                                   ${Boost_INCLUDE_DIRS})
+    set_target_properties(
+      metbuild_equivalence PROPERTIES RUNTIME_OUTPUT_DIRECTORY
+                                      ${CMAKE_BINARY_DIR}/cxx_testcases)
+
+    # ...Scaling runs on synthetic grib and COAMPS sources, which are written
+    # directly so it also needs the eccodes and netCDF headers
+    add_executable(metbuild_synthetic
+                   ${CMAKE_SOURCE_DIR}/testing/cxx_benchmarks/synthetic.cpp)
+    add_dependencies(metbuild_synthetic metbuild_static)
+    target_link_libraries(metbuild_synthetic metbuild_static metbuild_interface)
+    target_include_directories(metbuild_synthetic
+                               PRIVATE ${metbuild_include_list})
+    set_target_properties(
+      metbuild_synthetic PROPERTIES RUNTIME_OUTPUT_DIRECTORY
+                                    ${CMAKE_BINARY_DIR}/cxx_testcases)
+  endif()
 endif()
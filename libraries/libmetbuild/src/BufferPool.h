@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_BUFFERPOOL_H_
+#define METBUILD_SRC_BUFFERPOOL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace MetBuild {
+
+/**
+ * @brief Recycles the value buffers of decoded source files
+ *
+ * Buffers released when a snapshot is dropped keep their capacity and are
+ * handed to the next snapshot decoded, so a long run reuses the same few
+ * allocations instead of returning large blocks to the allocator for every
+ * file. The pool holds at most a fixed number of buffers of each type and is
+ * safe to use from several threads
+ */
+class BufferPool {
+ public:
+  explicit BufferPool(const size_t capacity = 16) : m_capacity(capacity) {}
+
+  /**
+   * @brief Takes an empty buffer, reusing the largest one available
+   * @return buffer, empty but possibly with capacity reserved
+   */
+  template <typename T>
+  std::vector<T> acquire() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &slots = this->slots<T>();
+    if (slots.empty()) return {};
+    auto it = std::max_element(slots.begin(), slots.end(),
+                               [](const auto &a, const auto &b) {
+                                 return a.capacity() < b.capacity();
+                               });
+    auto buffer = std::move(*it);
+    *it = std::move(slots.back());
+    slots.pop_back();
+    return buffer;
+  }
+
+  /**
+   * @brief Returns a buffer to the pool. Buffers beyond the pool capacity
+   * are freed
+   * @param buffer buffer no longer used
+   */
+  template <typename T>
+  void release(std::vector<T> &&buffer) {
+    if (buffer.capacity() == 0) return;
+    buffer.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &slots = this->slots<T>();
+    if (slots.size() < m_capacity) slots.push_back(std::move(buffer));
+  }
+
+  /**
+   * @brief Number of buffers of a type held by the pool
+   */
+  template <typename T>
+  size_t size() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return this->slots<T>().size();
+  }
+
+ private:
+  template <typename T>
+  std::vector<std::vector<T>> &slots() {
+    static_assert(std::is_same_v<T, double> || std::is_same_v<T, float>,
+                  "Buffers are pooled for float and double values only");
+    if constexpr (std::is_same_v<T, double>) {
+      return m_double;
+    } else {
+      return m_float;
+    }
+  }
+
+  const size_t m_capacity;
+  std::mutex m_mutex;
+  std::vector<std::vector<double>> m_double;
+  std::vector<std::vector<float>> m_float;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_BUFFERPOOL_H_
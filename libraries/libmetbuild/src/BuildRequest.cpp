@@ -0,0 +1,1141 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "BuildRequest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+
+#include "GribIndex.h"
+#include "Instrumentation.h"
+#include "Logging.h"
+#include "Metrics.h"
+#include "RequestEstimate.h"
+#include "ResourceLimits.h"
+#include "fmt/core.h"
+#include "output/OutputFile.h"
+#include "vortex/AtcfTrack.h"
+#include "vortex/HollandVortex.h"
+
+using namespace MetBuild;
+
+namespace {
+//...Steps a finer domain may run ahead of a coarser one, two batches of the
+// pipelines so that neither waits while the other interpolates a batch
+constexpr size_t c_nest_queue_depth = 8;
+
+void seek(FILE *file, const uint64_t offset) {
+#ifdef _WIN32
+  const int status = _fseeki64(file, static_cast<__int64>(offset), SEEK_SET);
+#else
+  const int status = fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+  if (status != 0) {
+    metbuild_throw_exception("Could not seek in the band scratch file");
+  }
+}
+
+/**
+ * @brief Appends one step of a band to the scratch file, parameter by
+ * parameter
+ */
+template <unsigned parameters>
+void stage_band(FILE *scratch,
+                const MeteorologicalData<parameters, MeteorologicalDataType>
+                    &data) {
+  for (size_t p = 0; p < parameters; ++p) {
+    const auto v = data.parameter(p);
+    if (std::fwrite(v.data(), sizeof(MeteorologicalDataType), v.size(),
+                    scratch) != v.size()) {
+      metbuild_throw_exception("Could not write the band scratch file");
+    }
+  }
+}
+
+/**
+ * @brief Reassembles every record from the bands staged in the scratch file
+ * and writes it to the output
+ *
+ * Bands are stored one after the other, each holding all of its steps, so
+ * row j0 of step t and parameter p of a band of nb rows starts at
+ * (j0 * steps * parameters + (t * parameters + p) * nb) * ni values
+ */
+template <unsigned parameters>
+void write_records(FILE *scratch, OutputFile *output, const size_t domain_index,
+                   const Grid &grid, const size_t rows,
+                   const std::vector<Date> &times) {
+  MeteorologicalData<parameters, MeteorologicalDataType> record(grid.ni(),
+                                                                grid.nj());
+  const uint64_t steps = times.size();
+  for (size_t t = 0; t < times.size(); ++t) {
+    for (size_t j0 = 0; j0 < grid.nj(); j0 += rows) {
+      const size_t nb = std::min(rows, grid.nj() - j0);
+      const size_t count = nb * grid.ni();
+      for (size_t p = 0; p < parameters; ++p) {
+        const uint64_t cell =
+            (j0 * steps * parameters + (t * parameters + p) * nb) * grid.ni();
+        seek(scratch, cell * sizeof(MeteorologicalDataType));
+        if (std::fread(record.row(p, j0).data(), sizeof(MeteorologicalDataType),
+                       count, scratch) != count) {
+          metbuild_throw_exception("Could not read the band scratch file");
+        }
+      }
+    }
+    output->write(times[t], domain_index, record);
+  }
+}
+
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param output output file with one domain per domain of the request. It
+ * must outlive the request
+ * @param start_date first output time
+ * @param end_date last output time
+ * @param time_step output time step in seconds
+ */
+BuildRequest::BuildRequest(MetBuild::OutputFile *output,
+                           const MetBuild::Date &start_date,
+                           const MetBuild::Date &end_date, int time_step)
+    : m_output(output),
+      m_start_date(start_date),
+      m_end_date(end_date),
+      m_time_step(time_step),
+      m_memory_budget(0),
+      m_step_statistics(false),
+      m_derive_nested(true),
+      m_interpolation_method(Meteorology::TRIANGULAR),
+      m_idw_radius(0.5),
+      m_steps_done(0),
+      m_steps_total(0),
+      m_cancelled(false),
+      m_done(false) {
+  if (m_output == nullptr) {
+    metbuild_throw_exception("An output file must be provided");
+  }
+  if (m_time_step <= 0) {
+    metbuild_throw_exception("The time step must be positive");
+  }
+}
+
+//...The pipelines are stopped before the meteorology objects they drive
+BuildRequest::~BuildRequest() {
+  if (m_thread.joinable()) {
+    this->cancel();
+    m_thread.join();
+  }
+  for (auto &d : m_domains) {
+    d.pipeline.reset();
+    d.member_pipelines.clear();
+  }
+}
+
+/**
+ * @brief Adds a domain interpolated from gridded source files
+ * @param domain_index domain of the output file written
+ * @param grid output grid, which must outlive the request
+ * @param source source model of the files
+ * @param type data type generated
+ * @param backfill fill points outside the source with background values
+ * @param epsg_output coordinate system of the output grid
+ */
+void BuildRequest::add_domain(size_t domain_index, const MetBuild::Grid *grid,
+                              Meteorology::SOURCE source,
+                              MetBuild::GriddedDataTypes::TYPE type,
+                              bool backfill, int epsg_output) {
+  m_domains.emplace_back(domain_index, grid, source, type, backfill,
+                         epsg_output);
+}
+
+/**
+ * @brief Adds a domain following a storm. The sources are interpolated onto
+ * the envelope of the grid, one box of cells per output time, and the
+ * domain of the output file must have been added with the same grid, such
+ * as with OwiNetcdf::addMovingDomain
+ * @param domain_index domain of the output file written
+ * @param grid moving grid, which must outlive the request
+ * @param source data source
+ * @param type data type
+ * @param backfill fill cells outside the source with the flag value
+ */
+void BuildRequest::add_moving_domain(size_t domain_index,
+                                     const MetBuild::MovingGrid *grid,
+                                     Meteorology::SOURCE source,
+                                     MetBuild::GriddedDataTypes::TYPE type,
+                                     bool backfill) {
+  m_domains.emplace_back(domain_index, &grid->envelope(), source, type,
+                         backfill, 4326);
+  m_domains.back().moving = grid;
+}
+
+/**
+ * @brief Adds a domain gridded from a storm track with the parametric vortex
+ * @param domain_index domain of the output file written
+ * @param grid output grid, which must outlive the request
+ * @param track_file ATCF formatted track
+ */
+void BuildRequest::add_vortex_domain(size_t domain_index,
+                                     const MetBuild::Grid *grid,
+                                     const std::string &track_file) {
+  m_domains.emplace_back(domain_index, grid, Meteorology::SOURCE{},
+                         GriddedDataTypes::TYPE{}, false, 4326);
+  m_domains.back().vortex = true;
+  m_domains.back().track_file = track_file;
+}
+
+/**
+ * @brief Adds a domain written with a reduction of the members of an
+ * ensemble. The files of each member are added with add_member_file
+ * @param domain_index domain of the output file written. Means and spreads
+ * of wind and pressure have three fields and exceedance probabilities one
+ * @param grid output grid, which must outlive the request
+ * @param source source model of the files
+ * @param type data type generated
+ * @param statistic reduction written
+ * @param threshold value the exceedance probability is counted above, in
+ * m/s for the wind speed
+ * @param backfill fill points outside the source with background values
+ * @param epsg_output coordinate system of the output grid
+ */
+void BuildRequest::add_ensemble_domain(
+    size_t domain_index, const MetBuild::Grid *grid,
+    Meteorology::SOURCE source, MetBuild::GriddedDataTypes::TYPE type,
+    EnsembleReduction::STATISTIC statistic, double threshold, bool backfill,
+    int epsg_output) {
+  m_domains.emplace_back(domain_index, grid, source, type, backfill,
+                         epsg_output);
+  m_domains.back().ensemble = true;
+  m_domains.back().statistic = statistic;
+  m_domains.back().threshold = threshold;
+}
+
+/**
+ * @brief Registers the next source file of a gridded domain. Files must be
+ * added in time order
+ * @param domain_index domain of the output file
+ * @param filenames files making up the snapshot
+ * @param time valid time of the snapshot
+ */
+void BuildRequest::add_file(size_t domain_index,
+                            const std::vector<std::string> &filenames,
+                            const MetBuild::Date &time) {
+  auto &d = this->domain(domain_index);
+  if (d.vortex) {
+    metbuild_throw_exception("Files can only be added to gridded domains");
+  }
+  if (d.ensemble) {
+    metbuild_throw_exception(
+        "Files of an ensemble domain are added to its members");
+  }
+  if (!d.files.empty() && time < d.files.back().time) {
+    metbuild_throw_exception("Files must be added in time order");
+  }
+  d.files.push_back({filenames, time});
+}
+
+void BuildRequest::add_file(size_t domain_index, const std::string &filename,
+                            const MetBuild::Date &time) {
+  this->add_file(domain_index, std::vector<std::string>{filename}, time);
+}
+
+/**
+ * @brief Registers the next source file of a member of an ensemble domain.
+ * Files must be added in time order
+ * @param domain_index domain of the output file
+ * @param member index of the member, counted from zero
+ * @param filenames files making up the snapshot
+ * @param time valid time of the snapshot
+ */
+void BuildRequest::add_member_file(size_t domain_index, size_t member,
+                                   const std::vector<std::string> &filenames,
+                                   const MetBuild::Date &time) {
+  auto &d = this->domain(domain_index);
+  if (!d.ensemble) {
+    metbuild_throw_exception("Domain " + std::to_string(domain_index) +
+                             " is not an ensemble domain");
+  }
+  if (member >= d.members.size()) d.members.resize(member + 1);
+  auto &files = d.members[member];
+  if (!files.empty() && time < files.back().time) {
+    metbuild_throw_exception("Files must be added in time order");
+  }
+  files.push_back({filenames, time});
+}
+
+void BuildRequest::add_member_file(size_t domain_index, size_t member,
+                                   const std::string &filename,
+                                   const MetBuild::Date &time) {
+  this->add_member_file(domain_index, member,
+                        std::vector<std::string>{filename}, time);
+}
+
+/**
+ * @brief Registers every forecast step of a grib file holding several, such
+ * as the HRRR sub-hourly files, as a snapshot of its own. The steps share
+ * the mapping, message index and coordinates of the file, so it is read and
+ * located once whatever the number of steps
+ * @param domain_index domain of the output file
+ * @param filename grib file
+ * @param cycle start of the forecast the steps are counted from
+ * @return number of snapshots added
+ */
+size_t BuildRequest::add_steps(size_t domain_index,
+                               const std::string &filename,
+                               const MetBuild::Date &cycle) {
+  const auto &d = this->domain(domain_index);
+  const auto probe = Meteorology::probe(filename, d.source);
+  if (probe.steps.empty()) {
+    metbuild_throw_exception("No forecast steps were found in " + filename);
+  }
+  for (const auto step : probe.steps) {
+    this->add_file(domain_index, GribIndex::stepReference(filename, step),
+                   cycle + Date::minutes(step));
+  }
+  return probe.steps.size();
+}
+
+/**
+ * @brief Bounds the memory used by run. Domains are then run one at a time
+ * and those too large for the budget are processed in bands of rows
+ *
+ * The budget covers the interpolation of a band. Every record is still
+ * assembled whole before it is written, so the budget should leave room for
+ * the few records held by the output writers
+ *
+ * @param bytes memory budget, or 0 to run every domain at once in full
+ * unless they would exceed ResourceLimits::defaultMemoryBudget()
+ */
+void BuildRequest::set_memory_budget(const size_t bytes) {
+  m_memory_budget = bytes;
+}
+
+size_t BuildRequest::memory_budget() const { return m_memory_budget; }
+
+/**
+ * @brief Sets the execution policy passed to the Meteorology objects and
+ * output of the request. A request starts with the default policy
+ *
+ * Its memory budget replaces the budget of the request unless it is zero.
+ * The output is always written asynchronously, with at least one record
+ * queued. The shared settings are installed with ExecutionPolicy::apply
+ *
+ * @param policy execution policy
+ */
+void BuildRequest::set_execution_policy(const ExecutionPolicy &policy) {
+  m_policy = policy;
+  if (policy.memory_budget() != 0) m_memory_budget = policy.memory_budget();
+}
+
+const ExecutionPolicy &BuildRequest::execution_policy() const {
+  return m_policy;
+}
+
+/**
+ * @brief Takes the default memory budget of ResourceLimits when none is set
+ * and the domains interpolated at once would not fit in it, so that a
+ * request too large for the memory limit of its container is banded instead
+ * of failing
+ */
+void BuildRequest::apply_default_budget() {
+  const auto budget = ResourceLimits::defaultMemoryBudget();
+  if (m_memory_budget != 0 || budget == 0) return;
+  size_t bytes = 0;
+  for (const auto &d : m_domains) {
+    if (d.vortex) continue;
+    bytes += d.grid->ni() * d.grid->nj() * RequestEstimate::bytes_per_cell;
+  }
+  if (bytes <= budget) return;
+  Logging::log(fmt::format(
+      "Request needs an estimated {:.0f} MiB, using the default memory "
+      "budget of {:.0f} MiB",
+      bytes / 1048576.0, budget / 1048576.0));
+  m_memory_budget = budget;
+}
+
+/**
+ * @brief Number of rows of a grid interpolated at once under the memory
+ * budget
+ * @param grid output grid
+ * @return rows per band, nj when the grid is processed in one piece
+ */
+size_t BuildRequest::band_rows(const MetBuild::Grid &grid) const {
+  if (m_memory_budget == 0) return grid.nj();
+  const size_t row_bytes = grid.ni() * RequestEstimate::bytes_per_cell;
+  return std::clamp<size_t>(m_memory_budget / row_bytes, 1, grid.nj());
+}
+
+/**
+ * @brief Takes the cells of a domain over a finer aligned domain from its
+ * steps instead of interpolating them again. Only used when every domain
+ * runs at once, the values match those interpolated independently up to
+ * rounding
+ * @param enabled true to derive the nested cells
+ */
+void BuildRequest::set_derive_nested(const bool enabled) {
+  m_derive_nested = enabled;
+}
+
+bool BuildRequest::derive_nested() const { return m_derive_nested; }
+
+/**
+ * @brief Selects how the output points of every domain are weighted onto
+ * the source grids, such as nearest neighbour weights for a quick preview
+ * @param method interpolation method
+ * @param idw_radius largest distance from an output point to the source
+ * points weighted by inverse distance, in degrees
+ */
+void BuildRequest::set_interpolation_method(
+    const Meteorology::INTERPOLATION_METHOD method, const double idw_radius) {
+  const bool weighted = method == Meteorology::TRIANGULAR_IDW ||
+                        method == Meteorology::INVERSE_DISTANCE;
+  if (weighted && !(idw_radius > 0.0)) {
+    metbuild_throw_exception(
+        "The inverse distance search radius must be positive");
+  }
+  m_interpolation_method = method;
+  m_idw_radius = idw_radius;
+}
+
+Meteorology::INTERPOLATION_METHOD BuildRequest::interpolation_method() const {
+  return m_interpolation_method;
+}
+
+/**
+ * @brief Generates and writes every domain
+ * @return files used by each domain, indexed by domain of the output file
+ */
+std::vector<std::vector<std::string>> BuildRequest::run() {
+  if (m_thread.joinable()) {
+    metbuild_throw_exception("The request has already been started");
+  }
+  m_cancelled = false;
+  return this->run_request();
+}
+
+/**
+ * @brief Starts generating and writing every domain on a background thread
+ */
+void BuildRequest::start() {
+  if (m_thread.joinable()) {
+    metbuild_throw_exception("The request has already been started");
+  }
+  m_cancelled = false;
+  m_done = false;
+  m_error = nullptr;
+  m_steps_done = 0;
+  m_thread = std::thread([this]() {
+    try {
+      m_files_used = this->run_request();
+    } catch (...) {
+      m_error = std::current_exception();
+    }
+    m_done = true;
+  });
+}
+
+/**
+ * @brief Whether a request started with start has finished, successfully or
+ * not. wait then returns without blocking
+ */
+bool BuildRequest::done() const { return m_done; }
+
+/**
+ * @brief Fraction of the output steps of every domain interpolated so far.
+ * Steps of domains processed in bands are counted once per band
+ */
+double BuildRequest::progress() const {
+  const size_t total = m_steps_total;
+  if (total == 0) return m_done ? 1.0 : 0.0;
+  return std::min(1.0, static_cast<double>(m_steps_done) /
+                           static_cast<double>(total));
+}
+
+/**
+ * @brief Time up to which every domain of the output has been published
+ * when the output publishes its records in chunks, see
+ * OutputFile::set_publication
+ */
+MetBuild::Date BuildRequest::published_through() const {
+  return m_output->published_through();
+}
+
+/**
+ * @brief Stops a running request within one row band of the steps being
+ * interpolated. Records still queued for the writers are dropped, so the
+ * output files end on the last whole record written, and the run then fails
+ * with a Cancelled error
+ */
+void BuildRequest::cancel() {
+  m_cancelled = true;
+  std::lock_guard<std::mutex> lock(m_pipeline_mutex);
+  for (auto &d : m_domains) {
+    if (d.pipeline) d.pipeline->cancel();
+    for (auto &p : d.member_pipelines) p->cancel();
+  }
+}
+
+bool BuildRequest::cancelled() const { return m_cancelled; }
+
+/**
+ * @brief Waits for a request started with start to finish
+ * @return files used by each domain, indexed by domain of the output file
+ */
+std::vector<std::vector<std::string>> BuildRequest::wait() {
+  if (!m_thread.joinable()) {
+    metbuild_throw_exception("The request has not been started");
+  }
+  m_thread.join();
+  if (m_error) std::rethrow_exception(m_error);
+  return std::move(m_files_used);
+}
+
+void BuildRequest::check_cancelled() const {
+  if (!m_cancelled) return;
+  m_output->discard();
+  throw Cancelled();
+}
+
+std::vector<std::vector<std::string>> BuildRequest::run_request() {
+  size_t n_domains = 0;
+  for (const auto &d : m_domains) {
+    n_domains = std::max(n_domains, d.index + 1);
+  }
+  std::vector<std::vector<std::string>> files_used(n_domains);
+  const auto before = Instrumentation::report();
+  const auto wall_start = std::chrono::steady_clock::now();
+
+  m_output->set_async(true,
+                      std::max<size_t>(m_policy.output_queue_depth(), 1));
+
+  //...An output resumed from a checkpoint with every record written has
+  // nothing left to generate
+  const auto start = this->first_date();
+  m_steps_done = 0;
+  m_steps_total = 0;
+  if (m_end_date < start) {
+    m_statistics = Instrumentation::report().since(before);
+    return files_used;
+  }
+
+  this->apply_default_budget();
+
+  const auto records = static_cast<size_t>(
+      (m_end_date.toSeconds() - start.toSeconds()) / m_time_step + 1);
+  size_t total = 0;
+  for (const auto &d : m_domains) {
+    if (d.vortex || d.ensemble) {
+      total += records;
+    } else if (d.moving) {
+      total += records;
+    } else {
+      const auto rows = this->band_rows(*d.grid);
+      total += records * ((d.grid->nj() + rows - 1) / rows);
+    }
+  }
+  m_steps_total = total;
+
+  for (auto &d : m_domains) {
+    if (!d.vortex) continue;
+    this->check_cancelled();
+    const HollandVortex vortex(d.grid, AtcfTrack(d.track_file));
+    vortex.write(m_output, d.index, start, m_end_date, m_time_step);
+    files_used[d.index] = {d.track_file};
+    m_steps_done += records;
+  }
+
+  this->plan_nesting();
+  if (m_memory_budget == 0) {
+    for (auto &d : m_domains) {
+      if (!d.vortex && !d.ensemble) this->start_pipeline(d, d.grid, true);
+    }
+    this->run_ensembles(&files_used);
+    for (auto &d : m_domains) {
+      if (d.vortex || d.ensemble) continue;
+      d.pipeline->wait();
+      files_used[d.index] = d.pipeline->files_used();
+      collect_statistics(d, true);
+    }
+    this->check_cancelled();
+  } else {
+    for (auto &d : m_domains) {
+      if (d.vortex || d.ensemble) continue;
+      this->check_cancelled();
+      //...The box of a moving domain crosses the bands, so it is never banded
+      const auto rows = this->band_rows(*d.grid);
+      if (!d.moving && rows < d.grid->nj()) {
+        files_used[d.index] = this->run_banded(d, rows);
+        continue;
+      }
+      this->start_pipeline(d, d.grid, true);
+      d.pipeline->wait();
+      files_used[d.index] = d.pipeline->files_used();
+      collect_statistics(d, true);
+      this->release_pipeline(d);
+    }
+    this->run_ensembles(&files_used);
+    this->check_cancelled();
+  }
+
+  m_output->flush();
+  m_statistics = Instrumentation::report().since(before);
+  Metrics::record_build(
+      m_statistics, std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - wall_start)
+                        .count());
+  return files_used;
+}
+
+/**
+ * @brief Stage timings and counters of the last run. Stages are counted
+ * process wide, so requests run at the same time in one process see each
+ * other's work
+ */
+InstrumentationReport BuildRequest::statistics() const { return m_statistics; }
+
+/**
+ * @brief Makes run reduce every output step of the gridded domains to the
+ * minimum, maximum, mean and fraction of invalid cells of each field
+ * @param enabled true to collect the statistics
+ */
+void BuildRequest::set_step_statistics(const bool enabled) {
+  m_step_statistics = enabled;
+}
+
+/**
+ * @brief Statistics of every output step of a domain from the last run
+ * @param domain_index domain of the output file
+ * @return statistics in time order, empty for vortex domains or when they
+ * were not requested
+ */
+std::vector<MetBuild::StepStatistics> BuildRequest::step_statistics(
+    const size_t domain_index) const {
+  for (const auto &d : m_domains) {
+    if (d.index == domain_index) return d.step_statistics;
+  }
+  metbuild_throw_exception("Domain " + std::to_string(domain_index) +
+                           " has not been added to the request");
+  return {};
+}
+
+/**
+ * @brief Keys of the interpolation weights a domain used in the last run,
+ * for sharing the weight cache files between machines
+ * @param domain_index domain of the output file
+ * @return keys, empty for vortex domains
+ */
+std::vector<std::string> BuildRequest::weight_keys(
+    const size_t domain_index) const {
+  for (const auto &d : m_domains) {
+    if (d.index == domain_index) return d.weight_keys;
+  }
+  metbuild_throw_exception("Domain " + std::to_string(domain_index) +
+                           " has not been added to the request");
+  return {};
+}
+
+/**
+ * @brief Takes the statistics and weight keys of the pipeline of a domain
+ * once it has run. The statistics of later bands are merged into those of
+ * the first band
+ * @param d domain
+ * @param first_band true for a domain run whole or for its first band
+ */
+void BuildRequest::collect_statistics(Domain &d, const bool first_band) {
+  if (first_band) d.weight_keys.clear();
+  for (auto &key : d.meteorology->weight_keys()) {
+    d.weight_keys.push_back(std::move(key));
+  }
+
+  auto statistics = d.pipeline->statistics();
+  if (first_band) {
+    d.step_statistics = std::move(statistics);
+    return;
+  }
+  if (statistics.size() != d.step_statistics.size()) {
+    metbuild_throw_exception("Bands of domain " + std::to_string(d.index) +
+                             " produced different numbers of statistics");
+  }
+  for (size_t i = 0; i < statistics.size(); ++i) {
+    d.step_statistics[i].merge(statistics[i]);
+  }
+}
+
+/**
+ * @brief Creates the meteorology object and pipeline of a gridded domain and
+ * starts interpolating its files
+ * @param d domain
+ * @param grid grid interpolated, the domain grid or a band of it
+ * @param write write the steps to the output file instead of queueing them
+ */
+void BuildRequest::start_pipeline(Domain &d, const MetBuild::Grid *grid,
+                                  const bool write) {
+  if (d.files.empty()) {
+    metbuild_throw_exception("No files have been added to domain " +
+                             std::to_string(d.index));
+  }
+  //...The cells over a finer domain are left out of the weights
+  if (d.nest && grid == d.grid) grid = d.remainder.get();
+  auto meteorology = std::make_unique<Meteorology>(grid, d.source, d.type,
+                                                   d.backfill, d.epsg_output);
+  //...Gridding whole snapshots would cover the envelope of a moving domain
+  meteorology->set_snapshot_interpolation(d.moving == nullptr);
+  meteorology->set_interpolation_method(m_interpolation_method, m_idw_radius);
+  meteorology->set_execution_policy(m_policy);
+  auto pipeline = std::make_unique<MeteorologyPipeline>(meteorology.get());
+  if (d.moving) pipeline->set_moving_grid(d.moving);
+  if (d.nest && grid == d.remainder.get()) {
+    pipeline->set_nest_source(d.nest.get());
+  }
+  for (auto &c : m_domains) {
+    if (c.nest && &m_domains[c.nest_fine] == &d) {
+      pipeline->add_nest(c.nest.get());
+    }
+  }
+  if (write) pipeline->set_output(m_output, d.index);
+  pipeline->set_statistics(m_step_statistics);
+  pipeline->set_progress(&m_steps_done);
+  {
+    //...cancel may be called from another thread at any time
+    std::lock_guard<std::mutex> lock(m_pipeline_mutex);
+    d.meteorology = std::move(meteorology);
+    d.pipeline = std::move(pipeline);
+    if (m_cancelled) d.pipeline->cancel();
+  }
+
+  this->add_span_files(d.pipeline.get(), d.files);
+  d.pipeline->start(this->first_date(), m_end_date, m_time_step);
+}
+
+/**
+ * @brief Gives a pipeline the files covering the span of the request
+ *
+ * The pipeline blends from the first file it is given, so files before the
+ * last one at or before the start, and past the first one at or after the
+ * end, are left out. A shard given the file list of the whole request then
+ * reads only the files of its own span
+ * @param pipeline pipeline not yet started
+ * @param files files of the domain or member in time order
+ */
+void BuildRequest::add_span_files(MeteorologyPipeline *pipeline,
+                                  const std::vector<SourceFile> &files) const {
+  const auto start = this->first_date();
+  size_t first = 0;
+  size_t last = files.size() - 1;
+  for (size_t i = 0; i < files.size(); ++i) {
+    if (files[i].time <= start) first = i;
+    if (!(files[i].time < m_end_date)) {
+      last = i;
+      break;
+    }
+  }
+  for (size_t i = first; i <= last; ++i) {
+    pipeline->add_file(files[i].filenames, files[i].time);
+  }
+}
+
+bool BuildRequest::same_files(const std::vector<SourceFile> &a,
+                              const std::vector<SourceFile> &b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                    [](const SourceFile &x, const SourceFile &y) {
+                      return x.filenames == y.filenames && x.time == y.time;
+                    });
+}
+
+/**
+ * @brief Runs the ensemble domains, those on the same grid, source, type and
+ * member files as one group so every member is only interpolated once
+ * @param files_used files used by each domain, filled for the ensemble
+ * domains
+ */
+void BuildRequest::run_ensembles(
+    std::vector<std::vector<std::string>> *files_used) {
+  auto same_ensemble = [](const Domain &a, const Domain &b) {
+    return a.grid == b.grid && a.source == b.source && a.type == b.type &&
+           a.backfill == b.backfill && a.epsg_output == b.epsg_output &&
+           std::equal(a.members.begin(), a.members.end(), b.members.begin(),
+                      b.members.end(), &BuildRequest::same_files);
+  };
+
+  std::vector<bool> grouped(m_domains.size(), false);
+  for (size_t a = 0; a < m_domains.size(); ++a) {
+    if (!m_domains[a].ensemble || grouped[a]) continue;
+    std::vector<Domain *> group;
+    for (size_t b = a; b < m_domains.size(); ++b) {
+      if (!m_domains[b].ensemble || grouped[b] ||
+          !same_ensemble(m_domains[a], m_domains[b])) {
+        continue;
+      }
+      grouped[b] = true;
+      group.push_back(&m_domains[b]);
+    }
+    if (m_cancelled) return;
+    this->run_ensemble(group, files_used);
+  }
+}
+
+/**
+ * @brief Interpolates the members of an ensemble in lockstep and writes the
+ * reductions of each step to the domains of the group
+ * @param group ensemble domains sharing their grid, source and members
+ * @param files_used files used by each domain, filled for the group
+ */
+void BuildRequest::run_ensemble(
+    const std::vector<Domain *> &group,
+    std::vector<std::vector<std::string>> *files_used) {
+  auto &lead = *group.front();
+  if (lead.members.empty()) {
+    metbuild_throw_exception("No members have been added to domain " +
+                             std::to_string(lead.index));
+  }
+
+  //...Every member interpolates onto the same grid from the same source, so
+  // the weights are built once and shared by all of them
+  for (size_t m = 0; m < lead.members.size(); ++m) {
+    if (lead.members[m].empty()) {
+      metbuild_throw_exception("No files have been added to member " +
+                               std::to_string(m) + " of domain " +
+                               std::to_string(lead.index));
+    }
+    auto meteorology = std::make_unique<Meteorology>(
+        lead.grid, lead.source, lead.type, lead.backfill, lead.epsg_output);
+    meteorology->set_snapshot_interpolation(true);
+    meteorology->set_interpolation_method(m_interpolation_method, m_idw_radius);
+    meteorology->set_execution_policy(m_policy);
+    auto pipeline = std::make_unique<MeteorologyPipeline>(meteorology.get());
+    this->add_span_files(pipeline.get(), lead.members[m]);
+    auto *p = pipeline.get();
+    {
+      std::lock_guard<std::mutex> lock(m_pipeline_mutex);
+      lead.member_meteorology.push_back(std::move(meteorology));
+      lead.member_pipelines.push_back(std::move(pipeline));
+      if (m_cancelled) p->cancel();
+    }
+    p->start(this->first_date(), m_end_date, m_time_step);
+  }
+
+  const bool wind = lead.member_meteorology.front()->has_type(
+      GriddedDataTypes::WIND_PRESSURE);
+  std::vector<double> thresholds;
+  std::vector<size_t> threshold_index(group.size(), 0);
+  for (size_t k = 0; k < group.size(); ++k) {
+    if (group[k]->statistic != EnsembleReduction::EXCEEDANCE) continue;
+    threshold_index[k] = thresholds.size();
+    thresholds.push_back(group[k]->threshold);
+  }
+
+  const auto &grid = *lead.grid;
+  EnsembleReduction reduction(grid.ni(), grid.nj(), wind ? 3 : 1,
+                              thresholds);
+  MeteorologicalData<3, MeteorologicalDataType> wind_record;
+  MeteorologicalData<1, MeteorologicalDataType> scalar_record(grid.ni(),
+                                                              grid.nj());
+  if (wind) wind_record.resize(grid.ni(), grid.nj());
+
+  const auto &pipelines = lead.member_pipelines;
+  while (!m_cancelled) {
+    reduction.reset();
+    size_t finished = 0;
+    Date time;
+    for (size_t m = 0; m < pipelines.size(); ++m) {
+      if (!pipelines[m]->next()) {
+        finished++;
+        continue;
+      }
+      if (reduction.members() == 0) {
+        time = pipelines[m]->time();
+      } else if (pipelines[m]->time() != time) {
+        metbuild_throw_exception("The members of domain " +
+                                 std::to_string(lead.index) +
+                                 " are out of step");
+      }
+      if (wind) {
+        reduction.add(pipelines[m]->wind_grid());
+      } else {
+        reduction.add(pipelines[m]->grid());
+      }
+    }
+    if (finished == pipelines.size()) break;
+    if (finished != 0) {
+      metbuild_throw_exception("The members of domain " +
+                               std::to_string(lead.index) +
+                               " produced different numbers of steps");
+    }
+
+    for (size_t k = 0; k < group.size(); ++k) {
+      const auto &d = *group[k];
+      if (d.statistic == EnsembleReduction::EXCEEDANCE) {
+        reduction.exceedance(threshold_index[k], scalar_record.parameter(0));
+        m_output->write(time, d.index, scalar_record);
+      } else if (wind) {
+        for (unsigned p = 0; p < 3; ++p) {
+          if (d.statistic == EnsembleReduction::MEAN) {
+            reduction.mean(p, wind_record.parameter(p));
+          } else {
+            reduction.spread(p, wind_record.parameter(p));
+          }
+        }
+        m_output->write(time, d.index, wind_record);
+      } else {
+        if (d.statistic == EnsembleReduction::MEAN) {
+          reduction.mean(0, scalar_record.parameter(0));
+        } else {
+          reduction.spread(0, scalar_record.parameter(0));
+        }
+        m_output->write(time, d.index, scalar_record);
+      }
+      ++m_steps_done;
+    }
+  }
+
+  std::vector<std::string> used;
+  for (const auto &p : pipelines) {
+    for (auto &f : p->files_used()) {
+      if (std::find(used.begin(), used.end(), f) == used.end()) {
+        used.push_back(std::move(f));
+      }
+    }
+  }
+  const auto keys = lead.member_meteorology.front()->weight_keys();
+  for (auto *d : group) {
+    (*files_used)[d->index] = used;
+    d->weight_keys = keys;
+    d->step_statistics.clear();
+  }
+
+  std::lock_guard<std::mutex> lock(m_pipeline_mutex);
+  lead.member_pipelines.clear();
+  lead.member_meteorology.clear();
+}
+
+/**
+ * @brief Pairs every gridded domain with the finest domain it is aligned
+ * with, among those of the same source, type and files. Masked grids are
+ * left alone, since the cells of either domain would not match
+ */
+void BuildRequest::plan_nesting() {
+  for (auto &d : m_domains) {
+    d.nest.reset();
+    d.remainder.reset();
+  }
+  if (!m_derive_nested || m_memory_budget != 0) return;
+
+  auto eligible = [](const Domain &d) {
+    return !d.vortex && !d.ensemble && !d.moving &&
+           !d.grid->is_point_list() && !d.grid->has_mask();
+  };
+
+  for (size_t c = 0; c < m_domains.size(); ++c) {
+    auto &coarse = m_domains[c];
+    if (!eligible(coarse)) continue;
+    size_t best = 0;
+    size_t best_cells = 1;
+    for (size_t f = 0; f < m_domains.size(); ++f) {
+      const auto &fine = m_domains[f];
+      if (f == c || !eligible(fine) || fine.source != coarse.source ||
+          fine.type != coarse.type || fine.backfill != coarse.backfill ||
+          fine.epsg_output != coarse.epsg_output ||
+          !same_files(coarse.files, fine.files)) {
+        continue;
+      }
+      //...The finest grid aligned gives the most cells, and a stride above
+      // one means a domain is never nested in one of its own nests
+      const auto w = NestedDomain::align(*coarse.grid, *fine.grid);
+      if (w && w->si * w->sj > best_cells) {
+        best = f;
+        best_cells = w->si * w->sj;
+      }
+    }
+    if (best_cells == 1) continue;
+
+    coarse.nest = std::make_unique<NestedDomain>(
+        *coarse.grid, *m_domains[best].grid, c_nest_queue_depth);
+    coarse.remainder = std::make_unique<Grid>(*coarse.grid);
+    coarse.remainder->set_mask(coarse.nest->remainder_mask());
+    coarse.nest_fine = best;
+    const auto &w = coarse.nest->window();
+    Logging::log("Domain " + std::to_string(coarse.index) + " takes " +
+                 std::to_string(w.ni * w.nj) + " cells from domain " +
+                 std::to_string(m_domains[best].index));
+  }
+}
+
+/**
+ * @brief Stops and drops the pipeline and meteorology object of a domain
+ * @param d domain
+ */
+void BuildRequest::release_pipeline(Domain &d) {
+  std::lock_guard<std::mutex> lock(m_pipeline_mutex);
+  d.pipeline.reset();
+  d.meteorology.reset();
+}
+
+/**
+ * @brief First date generated by run. An output resumed from a checkpoint
+ * starts after the last record every domain has already written
+ */
+MetBuild::Date BuildRequest::first_date() const {
+  const auto resumed = m_output->resume_date();
+  return m_start_date < resumed ? resumed : m_start_date;
+}
+
+/**
+ * @brief Index of the first output record of a shard, or the number of
+ * records when shard == shards. Records are split as evenly as possible, the
+ * first shards taking one more when they do not divide evenly
+ */
+size_t BuildRequest::shard_record(const MetBuild::Date &start_date,
+                                  const MetBuild::Date &end_date,
+                                  const int time_step, const size_t shard,
+                                  const size_t shards) {
+  if (time_step <= 0 || end_date < start_date) {
+    metbuild_throw_exception("Invalid request time span");
+  }
+  const auto records = static_cast<size_t>(
+      (end_date.toSeconds() - start_date.toSeconds()) / time_step + 1);
+  if (shards == 0 || shards > records || shard > shards) {
+    metbuild_throw_exception("Invalid shard " + std::to_string(shard) +
+                             " of " + std::to_string(shards));
+  }
+  const auto base = records / shards;
+  const auto extra = records % shards;
+  return shard * base + std::min(shard, extra);
+}
+
+/**
+ * @brief First output time of a shard of a request
+ * @param start_date first output time of the request
+ * @param end_date last output time of the request
+ * @param time_step output time step in seconds
+ * @param shard index of the shard
+ * @param shards number of shards the request is split into
+ * @return first output time of the shard
+ */
+Date BuildRequest::shard_start(const MetBuild::Date &start_date,
+                               const MetBuild::Date &end_date,
+                               const int time_step, const size_t shard,
+                               const size_t shards) {
+  if (shard >= shards) {
+    metbuild_throw_exception("Invalid shard " + std::to_string(shard) +
+                             " of " + std::to_string(shards));
+  }
+  const auto record =
+      shard_record(start_date, end_date, time_step, shard, shards);
+  return start_date + static_cast<long>(record) * time_step;
+}
+
+/**
+ * @brief Last output time of a shard of a request. Shards do not overlap, the
+ * next shard starts one time step later
+ * @param start_date first output time of the request
+ * @param end_date last output time of the request
+ * @param time_step output time step in seconds
+ * @param shard index of the shard
+ * @param shards number of shards the request is split into
+ * @return last output time of the shard
+ */
+Date BuildRequest::shard_end(const MetBuild::Date &start_date,
+                             const MetBuild::Date &end_date,
+                             const int time_step, const size_t shard,
+                             const size_t shards) {
+  if (shard >= shards) {
+    metbuild_throw_exception("Invalid shard " + std::to_string(shard) +
+                             " of " + std::to_string(shards));
+  }
+  const auto next =
+      shard_record(start_date, end_date, time_step, shard + 1, shards);
+  return start_date + static_cast<long>(next - 1) * time_step;
+}
+
+/**
+ * @brief Interpolates a domain band by band, staging each band in a scratch
+ * file, then writes the reassembled records
+ * @param d domain
+ * @param rows rows per band
+ * @return files used by the domain
+ */
+std::vector<std::string> BuildRequest::run_banded(Domain &d,
+                                                  const size_t rows) {
+  const size_t n_bands = (d.grid->nj() + rows - 1) / rows;
+  Logging::log("Processing domain " + std::to_string(d.index) + " in " +
+               std::to_string(n_bands) + " bands of " + std::to_string(rows) +
+               " rows");
+
+  std::unique_ptr<FILE, int (*)(FILE *)> scratch(std::tmpfile(), &std::fclose);
+  if (!scratch) {
+    metbuild_throw_exception("Could not create the band scratch file");
+  }
+
+  bool wind = false;
+  std::vector<Date> times;
+  std::vector<std::string> files_used;
+  for (size_t j0 = 0; j0 < d.grid->nj(); j0 += rows) {
+    const auto band = d.grid->band(j0, std::min(rows, d.grid->nj() - j0));
+    this->start_pipeline(d, &band, false);
+    wind = d.meteorology->has_type(GriddedDataTypes::WIND_PRESSURE);
+    size_t steps = 0;
+    while (!m_cancelled && d.pipeline->next()) {
+      if (j0 == 0) times.push_back(d.pipeline->time());
+      if (wind) {
+        stage_band(scratch.get(), d.pipeline->wind_grid());
+      } else {
+        stage_band(scratch.get(), d.pipeline->grid());
+      }
+      steps++;
+    }
+    if (j0 == 0) files_used = d.pipeline->files_used();
+    collect_statistics(d, j0 == 0);
+    this->release_pipeline(d);
+    this->check_cancelled();
+    if (steps != times.size()) {
+      metbuild_throw_exception("Bands of domain " + std::to_string(d.index) +
+                               " produced different numbers of steps");
+    }
+  }
+
+  if (wind) {
+    write_records<3>(scratch.get(), m_output, d.index, *d.grid, rows, times);
+  } else {
+    write_records<1>(scratch.get(), m_output, d.index, *d.grid, rows, times);
+  }
+  return files_used;
+}
+
+BuildRequest::Domain &BuildRequest::domain(size_t domain_index) {
+  auto it = std::find_if(
+      m_domains.begin(), m_domains.end(),
+      [domain_index](const Domain &d) { return d.index == domain_index; });
+  if (it == m_domains.end()) {
+    metbuild_throw_exception("No domain has been added with index " +
+                             std::to_string(domain_index));
+  }
+  return *it;
+}
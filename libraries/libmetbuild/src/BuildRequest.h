@@ -0,0 +1,310 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_BUILDREQUEST_H_
+#define METBUILD_SRC_BUILDREQUEST_H_
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Date.h"
+#include "EnsembleReduction.h"
+#include "ExecutionPolicy.h"
+#include "Grid.h"
+#include "Instrumentation.h"
+#include "MetBuild_Global.h"
+#include "Meteorology.h"
+#include "MeteorologyPipeline.h"
+#include "MovingGrid.h"
+#include "NestedDomain.h"
+#include "StepStatistics.h"
+#include "data_sources/GriddedDataTypes.h"
+
+namespace MetBuild {
+
+class OutputFile;
+
+/**
+ * @brief Runs a complete request, interpolating every domain of an output
+ * file over its time span and writing it
+ *
+ * Domains are described with their grid, source and ordered file list. run
+ * then grids any storm track domains with the parametric vortex, starts one
+ * pipeline per gridded domain so that all domains decode, interpolate and
+ * write at the same time, and waits for them to finish
+ *
+ * A domain whose grid is aligned with a finer domain of the same source,
+ * type and files, its nodes falling on nodes of the finer grid, takes the
+ * cells over the finer grid from its steps and only interpolates the others.
+ * This is done when every domain runs at once, set_derive_nested turns it
+ * off
+ *
+ * An ensemble domain writes a reduction of the members of an ensemble, its
+ * mean, spread or probability of exceeding a threshold, instead of a single
+ * member. Its files are registered per member with add_member_file. The
+ * ensemble domains on the same grid, source, type and member files are run
+ * together: one pipeline per member, all on the same shared weights, is
+ * stepped in lockstep and every step of the members is folded into an
+ * EnsembleReduction as it arrives, so only the reduced fields are ever
+ * written. Ensemble domains are never banded or nested
+ *
+ * When a memory budget is set the domains are run one after the other and a
+ * domain too large for the budget is processed in bands of rows, each band
+ * interpolated over the whole time span with its own weights. The bands are
+ * staged row-major in a scratch file and every record is then written whole,
+ * since the output formats store each variable of a record contiguously
+ *
+ * A long request can be split in time into shards, each run as its own
+ * request over the span given by shard_start and shard_end and written to
+ * its own file. Only the source files bracketing the span of a request are
+ * read, so each shard is given the whole file list. OutputStitch then joins
+ * the shard files into the output of the full request
+ *
+ * start runs the request on a background thread instead. Its progress is
+ * read with progress, cancel stops it within one row band of the steps in
+ * progress, and wait joins it, returning what run would have returned or
+ * rethrowing its error, which is Cancelled for a cancelled request
+ */
+class BuildRequest {
+ public:
+  METBUILD_EXPORT BuildRequest(MetBuild::OutputFile *output,
+                               const MetBuild::Date &start_date,
+                               const MetBuild::Date &end_date, int time_step);
+
+  METBUILD_EXPORT ~BuildRequest();
+
+  BuildRequest(const BuildRequest &) = delete;
+  BuildRequest &operator=(const BuildRequest &) = delete;
+
+  void METBUILD_EXPORT add_domain(size_t domain_index,
+                                  const MetBuild::Grid *grid,
+                                  Meteorology::SOURCE source,
+                                  MetBuild::GriddedDataTypes::TYPE type,
+                                  bool backfill = false,
+                                  int epsg_output = 4326);
+
+  void METBUILD_EXPORT add_moving_domain(size_t domain_index,
+                                         const MetBuild::MovingGrid *grid,
+                                         Meteorology::SOURCE source,
+                                         MetBuild::GriddedDataTypes::TYPE type,
+                                         bool backfill = false);
+
+  void METBUILD_EXPORT add_vortex_domain(size_t domain_index,
+                                         const MetBuild::Grid *grid,
+                                         const std::string &track_file);
+
+  void METBUILD_EXPORT add_ensemble_domain(
+      size_t domain_index, const MetBuild::Grid *grid,
+      Meteorology::SOURCE source, MetBuild::GriddedDataTypes::TYPE type,
+      EnsembleReduction::STATISTIC statistic, double threshold = 0.0,
+      bool backfill = false, int epsg_output = 4326);
+
+  void METBUILD_EXPORT add_file(size_t domain_index,
+                                const std::vector<std::string> &filenames,
+                                const MetBuild::Date &time);
+  void METBUILD_EXPORT add_file(size_t domain_index,
+                                const std::string &filename,
+                                const MetBuild::Date &time);
+
+  void METBUILD_EXPORT add_member_file(
+      size_t domain_index, size_t member,
+      const std::vector<std::string> &filenames, const MetBuild::Date &time);
+  void METBUILD_EXPORT add_member_file(size_t domain_index, size_t member,
+                                       const std::string &filename,
+                                       const MetBuild::Date &time);
+
+  size_t METBUILD_EXPORT add_steps(size_t domain_index,
+                                   const std::string &filename,
+                                   const MetBuild::Date &cycle);
+
+  void METBUILD_EXPORT set_memory_budget(size_t bytes);
+
+  size_t METBUILD_EXPORT memory_budget() const;
+
+  void METBUILD_EXPORT
+  set_execution_policy(const MetBuild::ExecutionPolicy &policy);
+
+  NODISCARD const MetBuild::ExecutionPolicy METBUILD_EXPORT &
+  execution_policy() const;
+
+  size_t METBUILD_EXPORT band_rows(const MetBuild::Grid &grid) const;
+
+  void METBUILD_EXPORT set_derive_nested(bool enabled);
+
+  bool METBUILD_EXPORT derive_nested() const;
+
+  void METBUILD_EXPORT set_interpolation_method(
+      Meteorology::INTERPOLATION_METHOD method, double idw_radius = 0.5);
+
+  Meteorology::INTERPOLATION_METHOD METBUILD_EXPORT
+  interpolation_method() const;
+
+  std::vector<std::vector<std::string>> METBUILD_EXPORT run();
+
+  void METBUILD_EXPORT start();
+
+  bool METBUILD_EXPORT done() const;
+
+  double METBUILD_EXPORT progress() const;
+
+  MetBuild::Date METBUILD_EXPORT published_through() const;
+
+  void METBUILD_EXPORT cancel();
+
+  bool METBUILD_EXPORT cancelled() const;
+
+  std::vector<std::vector<std::string>> METBUILD_EXPORT wait();
+
+  static MetBuild::Date METBUILD_EXPORT shard_start(
+      const MetBuild::Date &start_date, const MetBuild::Date &end_date,
+      int time_step, size_t shard, size_t shards);
+
+  static MetBuild::Date METBUILD_EXPORT shard_end(
+      const MetBuild::Date &start_date, const MetBuild::Date &end_date,
+      int time_step, size_t shard, size_t shards);
+
+  InstrumentationReport METBUILD_EXPORT statistics() const;
+
+  void METBUILD_EXPORT set_step_statistics(bool enabled);
+
+  std::vector<MetBuild::StepStatistics> METBUILD_EXPORT
+  step_statistics(size_t domain_index) const;
+
+  std::vector<std::string> METBUILD_EXPORT
+  weight_keys(size_t domain_index) const;
+
+ private:
+  struct SourceFile {
+    std::vector<std::string> filenames;
+    MetBuild::Date time;
+  };
+
+  struct Domain {
+    Domain(size_t domain_index, const MetBuild::Grid *domain_grid,
+           Meteorology::SOURCE domain_source,
+           MetBuild::GriddedDataTypes::TYPE domain_type, bool domain_backfill,
+           int domain_epsg)
+        : index(domain_index),
+          grid(domain_grid),
+          source(domain_source),
+          type(domain_type),
+          backfill(domain_backfill),
+          epsg_output(domain_epsg) {}
+
+    size_t index = 0;
+    const MetBuild::Grid *grid = nullptr;
+    bool vortex = false;
+    std::string track_file;
+    Meteorology::SOURCE source{};
+    MetBuild::GriddedDataTypes::TYPE type{};
+    bool backfill = false;
+    int epsg_output = 4326;
+    std::vector<SourceFile> files;
+    std::unique_ptr<Meteorology> meteorology;
+    std::unique_ptr<MeteorologyPipeline> pipeline;
+    std::vector<MetBuild::StepStatistics> step_statistics;
+    std::vector<std::string> weight_keys;
+    const MetBuild::MovingGrid *moving = nullptr;
+    std::unique_ptr<MetBuild::NestedDomain> nest;
+    std::unique_ptr<MetBuild::Grid> remainder;
+    size_t nest_fine = 0;
+    bool ensemble = false;
+    EnsembleReduction::STATISTIC statistic = EnsembleReduction::MEAN;
+    double threshold = 0.0;
+    std::vector<std::vector<SourceFile>> members;
+    std::vector<std::unique_ptr<Meteorology>> member_meteorology;
+    std::vector<std::unique_ptr<MeteorologyPipeline>> member_pipelines;
+  };
+
+  Domain &domain(size_t domain_index);
+
+  std::vector<std::vector<std::string>> run_request();
+
+  void apply_default_budget();
+
+  void start_pipeline(Domain &d, const MetBuild::Grid *grid, bool write);
+
+  void add_span_files(MeteorologyPipeline *pipeline,
+                      const std::vector<SourceFile> &files) const;
+
+  void run_ensembles(std::vector<std::vector<std::string>> *files_used);
+
+  void run_ensemble(const std::vector<Domain *> &group,
+                    std::vector<std::vector<std::string>> *files_used);
+
+  static bool same_files(const std::vector<SourceFile> &a,
+                         const std::vector<SourceFile> &b);
+
+  void release_pipeline(Domain &d);
+
+  void plan_nesting();
+
+  void check_cancelled() const;
+
+  NODISCARD MetBuild::Date first_date() const;
+
+  static size_t shard_record(const MetBuild::Date &start_date,
+                             const MetBuild::Date &end_date, int time_step,
+                             size_t shard, size_t shards);
+
+  std::vector<std::string> run_banded(Domain &d, size_t rows);
+
+  static void collect_statistics(Domain &d, bool first_band);
+
+  MetBuild::OutputFile *m_output;
+  MetBuild::Date m_start_date;
+  MetBuild::Date m_end_date;
+  int m_time_step;
+  size_t m_memory_budget;
+  bool m_step_statistics;
+  bool m_derive_nested;
+  Meteorology::INTERPOLATION_METHOD m_interpolation_method;
+  double m_idw_radius;
+  MetBuild::ExecutionPolicy m_policy;
+  std::vector<Domain> m_domains;
+  InstrumentationReport m_statistics;
+
+  std::thread m_thread;
+  std::mutex m_pipeline_mutex;
+  std::atomic<size_t> m_steps_done;
+  std::atomic<size_t> m_steps_total;
+  std::atomic<bool> m_cancelled;
+  std::atomic<bool> m_done;
+  std::exception_ptr m_error;
+  std::vector<std::vector<std::string>> m_files_used;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_BUILDREQUEST_H_
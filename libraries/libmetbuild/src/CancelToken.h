@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_CANCELTOKEN_H_
+#define METBUILD_SRC_CANCELTOKEN_H_
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+namespace MetBuild {
+
+/**
+ * @brief Error thrown by work stopped through a CancelToken, so that callers
+ * can tell a cancelled build from a failed one
+ */
+class Cancelled : public std::runtime_error {
+ public:
+  explicit Cancelled(const std::string &message = "The request was cancelled")
+      : std::runtime_error(message) {}
+};
+
+/**
+ * @brief Flag shared between a running build and the thread cancelling it
+ *
+ * Long loops, such as the row bands of an interpolation or the rows located
+ * while building weights, call check between iterations so that a cancelled
+ * build stops within one band instead of at the end of its time step
+ */
+class CancelToken {
+ public:
+  CancelToken() = default;
+
+  CancelToken(const CancelToken &) = delete;
+  CancelToken &operator=(const CancelToken &) = delete;
+
+  void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+
+  void reset() { m_cancelled.store(false, std::memory_order_relaxed); }
+
+  bool cancelled() const {
+    return m_cancelled.load(std::memory_order_relaxed);
+  }
+
+  void check() const {
+    if (this->cancelled()) throw MetBuild::Cancelled();
+  }
+
+  /**
+   * @brief Throws Cancelled if a token is given and has been cancelled
+   * @param token token, or nullptr for work that cannot be cancelled
+   */
+  static void check(const CancelToken *token) {
+    if (token != nullptr) token->check();
+  }
+
+ private:
+  std::atomic<bool> m_cancelled{false};
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_CANCELTOKEN_H_
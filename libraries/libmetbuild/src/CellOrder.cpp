@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "CellOrder.h"
+
+#include <atomic>
+#include <cstdlib>
+
+using namespace MetBuild;
+
+namespace {
+//...Selected once when the library is loaded. METBUILD_CELL_ORDER=tiles
+// hands the cells over in tile order
+CellOrder::ORDER default_order() {
+  const char *env = std::getenv("METBUILD_CELL_ORDER");
+  return env != nullptr && std::string(env) == "tiles" ? CellOrder::TILES
+                                                       : CellOrder::ROWS;
+}
+
+std::atomic<CellOrder::ORDER> s_order(default_order());
+}  // namespace
+
+CellOrder::ORDER CellOrder::order() {
+  return s_order.load(std::memory_order_relaxed);
+}
+
+void CellOrder::setOrder(const ORDER order) { s_order = order; }
+
+/**
+ * @brief Selects the order used from now on
+ * @param name "rows" or "tiles"
+ * @return false if the name is unknown, in which case the order is
+ * unchanged
+ */
+bool CellOrder::setOrder(const std::string &name) {
+  if (name == "rows") {
+    s_order = ROWS;
+  } else if (name == "tiles") {
+    s_order = TILES;
+  } else {
+    return false;
+  }
+  return true;
+}
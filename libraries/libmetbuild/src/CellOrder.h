@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_CELLORDER_H_
+#define METBUILD_SRC_CELLORDER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "InterpolationWeights.h"
+#include "MetBuild_Global.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Order in which the cells of a band of output rows are handed to
+ * the interpolation kernels
+ *
+ * In row order each output row is gathered from end to end, so when a row
+ * crosses many source rows the stencils of the next output row are evicted
+ * before they are used again. In tile order the band is cut into square
+ * tiles visited along a Morton curve and each tile is handed over one row
+ * segment at a time, so consecutive runs gather from the same few source
+ * rows. The kernels index their outputs by cell, so the values land in the
+ * row-major output whatever the order
+ */
+class CellOrder {
+ public:
+  enum ORDER { ROWS, TILES };
+
+  static ORDER METBUILD_EXPORT order();
+
+  static void METBUILD_EXPORT setOrder(ORDER order);
+
+  static bool METBUILD_EXPORT setOrder(const std::string &name);
+
+  NODISCARD static constexpr uint64_t morton(uint32_t x, uint32_t y) {
+    return spread(x) | (spread(y) << 1U);
+  }
+
+  /**
+   * @brief Runs f(begin, count) over the parts of ranges inside the band of
+   * cells [b0, b1), in the selected order
+   * @param ranges ordered, non-overlapping runs of cells
+   * @param ni cells per row
+   * @param b0 first cell of the band, on a row boundary
+   * @param b1 end of the band, on a row boundary
+   * @param f function run on each part
+   */
+  template <typename F>
+  static void for_each(const InterpolationWeights::CellRanges &ranges,
+                       const size_t ni, const size_t b0, const size_t b1,
+                       F &&f) {
+    if (order() == ROWS || ni <= c_tile_cells || ranges.empty()) {
+      clip(ranges, b0, b1, f);
+      return;
+    }
+    //...The last band of the grid may extend past its last row
+    const size_t end = std::min(b1, ranges.back().end);
+    if (end <= b0) return;
+    const size_t rows = (end - b0 + ni - 1) / ni;
+    const size_t tiles_i = (ni + c_tile_cells - 1) / c_tile_cells;
+    const size_t tiles_j = (rows + c_tile_cells - 1) / c_tile_cells;
+    std::vector<std::pair<uint64_t, size_t>> tiles;
+    tiles.reserve(tiles_i * tiles_j);
+    for (size_t tj = 0; tj < tiles_j; ++tj) {
+      for (size_t ti = 0; ti < tiles_i; ++ti) {
+        tiles.emplace_back(morton(static_cast<uint32_t>(ti),
+                                  static_cast<uint32_t>(tj)),
+                           tj * tiles_i + ti);
+      }
+    }
+    std::sort(tiles.begin(), tiles.end());
+    for (const auto &tile : tiles) {
+      const size_t i0 = (tile.second % tiles_i) * c_tile_cells;
+      const size_t j0 = (tile.second / tiles_i) * c_tile_cells;
+      const size_t i1 = std::min(i0 + c_tile_cells, ni);
+      const size_t j1 = std::min(j0 + c_tile_cells, rows);
+      for (size_t j = j0; j < j1; ++j) {
+        const size_t row = b0 + j * ni;
+        clip(ranges, row + i0, row + i1, f);
+      }
+    }
+  }
+
+  //...Cells per side of a tile, a multiple of every vector width
+  static constexpr size_t c_tile_cells = 64;
+
+ private:
+  static constexpr uint64_t spread(uint64_t v) {
+    v &= 0xffffffffULL;
+    v = (v | (v << 16U)) & 0x0000ffff0000ffffULL;
+    v = (v | (v << 8U)) & 0x00ff00ff00ff00ffULL;
+    v = (v | (v << 4U)) & 0x0f0f0f0f0f0f0f0fULL;
+    v = (v | (v << 2U)) & 0x3333333333333333ULL;
+    v = (v | (v << 1U)) & 0x5555555555555555ULL;
+    return v;
+  }
+
+  template <typename F>
+  static void clip(const InterpolationWeights::CellRanges &ranges,
+                   const size_t c0, const size_t c1, F &f) {
+    auto it = std::upper_bound(
+        ranges.begin(), ranges.end(), c0,
+        [](const size_t c, const InterpolationWeights::CellRange &r) {
+          return c < r.end;
+        });
+    for (; it != ranges.end() && it->begin < c1; ++it) {
+      const size_t begin = std::max(it->begin, c0);
+      const size_t end = std::min(it->end, c1);
+      if (end > begin) f(begin, end - begin);
+    }
+  }
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_CELLORDER_H_
@@ -0,0 +1,280 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "CompositeMeteorology.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Logging.h"
+
+using namespace MetBuild;
+
+/**
+ * @brief Constructor
+ * @param grid output grid shared by every source
+ * @param transition_cells width, in output cells, over which a source is
+ * blended into the sources behind it
+ */
+CompositeMeteorology::CompositeMeteorology(const MetBuild::Grid *grid,
+                                           double transition_cells)
+    : m_grid(grid), m_transition(std::max(transition_cells, 0.0)) {}
+
+/**
+ * @brief Adds the next source in priority order. The composite sets the
+ * region of the source on every call, so the source must not be used on its
+ * own while it is part of the composite
+ * @param source source interpolated onto the same output grid
+ */
+void CompositeMeteorology::add_source(MetBuild::Meteorology *source) {
+  if (source->grid()->ni() != m_grid->ni() ||
+      source->grid()->nj() != m_grid->nj()) {
+    metbuild_throw_exception(
+        "Composite sources must share the output grid dimensions");
+  }
+  m_sources.push_back({source, {}, {}});
+}
+
+size_t CompositeMeteorology::size() const { return m_sources.size(); }
+
+/**
+ * @brief Blends wind and pressure from every source into a caller owned
+ * buffer
+ * @param time_weights weight of the second snapshot of each source, negative
+ * when a source has no data at this time
+ * @param w output buffer
+ */
+void CompositeMeteorology::to_wind_grid(
+    const std::vector<double> &time_weights,
+    MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType> &w) {
+  this->composite(
+      time_weights, m_wind_buffer, w,
+      [](Meteorology *m, const double time_weight,
+         MeteorologicalData<3, MeteorologicalDataType> &b) {
+        m->to_wind_grid(b, time_weight);
+      });
+}
+
+/**
+ * @brief Blends a scalar type from every source into a caller owned buffer
+ * @param type scalar data type, which every source must provide
+ * @param time_weights weight of the second snapshot of each source, negative
+ * when a source has no data at this time
+ * @param r output buffer
+ */
+void CompositeMeteorology::to_grid(
+    MetBuild::GriddedDataTypes::TYPE type,
+    const std::vector<double> &time_weights,
+    MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType> &r) {
+  this->composite(
+      time_weights, m_scalar_buffer, r,
+      [type](Meteorology *m, const double time_weight,
+             MeteorologicalData<1, MeteorologicalDataType> &b) {
+        m->to_grid(type, b, time_weight);
+      });
+}
+
+template <unsigned N, typename Interpolate>
+void CompositeMeteorology::composite(
+    const std::vector<double> &time_weights,
+    MetBuild::MeteorologicalData<N, MeteorologicalDataType> &buffer,
+    MetBuild::MeteorologicalData<N, MeteorologicalDataType> &out,
+    Interpolate interpolate) {
+  if (m_sources.empty()) {
+    metbuild_throw_exception("No sources added to the composite");
+  }
+  if (time_weights.size() != m_sources.size()) {
+    metbuild_throw_exception(
+        "One time weight is required for each composite source");
+  }
+
+  const size_t n = m_grid->ni() * m_grid->nj();
+  if (out.ni() != m_grid->ni() || out.nj() != m_grid->nj()) {
+    out.resize(m_grid->ni(), m_grid->nj());
+  }
+  out.fill(0.0);
+  m_remaining.assign(n, 1.0F);
+  float *remaining = m_remaining.data();
+
+  //...Cells still missing part of their weight
+  InterpolationWeights::CellRanges region = {{0, n}};
+
+  for (size_t k = 0; k < m_sources.size() && !region.empty(); ++k) {
+    auto &source = m_sources[k];
+    const bool background = k + 1 == m_sources.size();
+    if (!background && time_weights[k] < 0.0) continue;
+
+    source.meteorology->set_region(region);
+    interpolate(source.meteorology, time_weights[k], buffer);
+
+    if (!background) {
+      const float *alpha = this->source_weights(source).data();
+      for (size_t p = 0; p < N; ++p) {
+        const auto *b = buffer.parameter(p).data();
+        auto *o = out.parameter(p).data();
+        for (const auto &range : region) {
+          for (size_t c = range.begin; c < range.end; ++c) {
+            o[c] += alpha[c] * remaining[c] * b[c];
+          }
+        }
+      }
+
+      InterpolationWeights::CellRanges next;
+      for (const auto &range : region) {
+        for (size_t c = range.begin; c < range.end; ++c) {
+          remaining[c] -= alpha[c] * remaining[c];
+          if (remaining[c] > 0.0F) {
+            if (!next.empty() && next.back().end == c) {
+              next.back().end = c + 1;
+            } else {
+              next.push_back({c, c + 1});
+            }
+          }
+        }
+      }
+      region = std::move(next);
+      continue;
+    }
+
+    //...The background takes the remaining weight where it has data.
+    //   Elsewhere the sources ahead of it are renormalized, and cells no
+    //   source reaches keep the background fill
+    const auto covered =
+        time_weights[k] < 0.0
+            ? InterpolationWeights::CellRanges{}
+            : InterpolationWeights::intersect(
+                  region, source.meteorology->valid_ranges());
+    const auto uncovered = InterpolationWeights::intersect(
+        region, InterpolationWeights::complement(covered, n));
+    for (size_t p = 0; p < N; ++p) {
+      const auto *b = buffer.parameter(p).data();
+      auto *o = out.parameter(p).data();
+      for (const auto &range : covered) {
+        for (size_t c = range.begin; c < range.end; ++c) {
+          o[c] += remaining[c] * b[c];
+        }
+      }
+      for (const auto &range : uncovered) {
+        for (size_t c = range.begin; c < range.end; ++c) {
+          const float used = 1.0F - remaining[c];
+          o[c] = used > 0.0F ? o[c] / used : b[c];
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Blend weights of a source, rebuilt only when its coverage changes
+ * @param source composite source
+ * @return weight of each output cell
+ */
+const std::vector<float> &CompositeMeteorology::source_weights(
+    Source &source) {
+  const auto &ranges = source.meteorology->valid_ranges();
+  const bool same =
+      !source.weights.empty() && ranges.size() == source.ranges.size() &&
+      std::equal(ranges.begin(), ranges.end(), source.ranges.begin(),
+                 [](const InterpolationWeights::CellRange &a,
+                    const InterpolationWeights::CellRange &b) {
+                   return a.begin == b.begin && a.end == b.end;
+                 });
+  if (!same) {
+    source.ranges = ranges;
+    source.weights = CompositeMeteorology::blend_weights(
+        m_grid->ni(), m_grid->nj(), ranges, m_transition);
+  }
+  return source.weights;
+}
+
+/**
+ * @brief Weight of a source in each output cell, from zero outside its
+ * coverage to one at the transition width inside it
+ *
+ * Distances to the nearest uncovered cell come from a two pass chamfer
+ * transform. The edge of the output grid is not treated as the edge of the
+ * coverage
+ *
+ * @param ni number of cells in the i direction
+ * @param nj number of cells in the j direction
+ * @param valid ordered runs of covered cells, indexed j * ni + i
+ * @param transition_cells transition width in cells
+ * @return weight of each output cell
+ */
+std::vector<float> CompositeMeteorology::blend_weights(
+    const size_t ni, const size_t nj,
+    const MetBuild::InterpolationWeights::CellRanges &valid,
+    const double transition_cells) {
+  const size_t n = ni * nj;
+  std::vector<float> weights(n, 0.0F);
+  for (const auto &range : valid) {
+    std::fill(weights.begin() + range.begin, weights.begin() + range.end,
+              1.0F);
+  }
+  if (transition_cells <= 0.0 || n == 0) return weights;
+
+  constexpr float diagonal = 1.41421356F;
+  std::vector<float> d(n);
+  for (size_t c = 0; c < n; ++c) {
+    d[c] = weights[c] > 0.0F ? std::numeric_limits<float>::max() : 0.0F;
+  }
+  auto relax = [&](size_t c, size_t i2, size_t j2, float step) {
+    const float candidate = d[j2 * ni + i2] + step;
+    if (candidate < d[c]) d[c] = candidate;
+  };
+
+  for (size_t j = 0; j < nj; ++j) {
+    for (size_t i = 0; i < ni; ++i) {
+      const size_t c = j * ni + i;
+      if (i > 0) relax(c, i - 1, j, 1.0F);
+      if (j > 0) {
+        relax(c, i, j - 1, 1.0F);
+        if (i > 0) relax(c, i - 1, j - 1, diagonal);
+        if (i + 1 < ni) relax(c, i + 1, j - 1, diagonal);
+      }
+    }
+  }
+  for (size_t j = nj; j-- > 0;) {
+    for (size_t i = ni; i-- > 0;) {
+      const size_t c = j * ni + i;
+      if (i + 1 < ni) relax(c, i + 1, j, 1.0F);
+      if (j + 1 < nj) {
+        relax(c, i, j + 1, 1.0F);
+        if (i + 1 < ni) relax(c, i + 1, j + 1, diagonal);
+        if (i > 0) relax(c, i - 1, j + 1, diagonal);
+      }
+    }
+  }
+
+  const auto width = static_cast<float>(transition_cells);
+  for (size_t c = 0; c < n; ++c) {
+    weights[c] = std::min(d[c] / width, 1.0F);
+  }
+  return weights;
+}
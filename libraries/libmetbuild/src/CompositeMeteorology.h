@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_COMPOSITEMETEOROLOGY_H_
+#define METBUILD_SRC_COMPOSITEMETEOROLOGY_H_
+
+#include <vector>
+
+#include "CppAttributes.h"
+#include "Grid.h"
+#include "InterpolationWeights.h"
+#include "MetBuild_Global.h"
+#include "MeteorologicalData.h"
+#include "Meteorology.h"
+#include "data_sources/GriddedDataTypes.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Blends several sources interpolated onto the same output grid, e.g.
+ * a nested hurricane model over a global background
+ *
+ * Sources are added highest priority first. Each source is only interpolated
+ * over the cells not already fully covered by the sources ahead of it, and
+ * its weight ramps from zero at the edge of its coverage to one at the
+ * transition width inside it. The last source is the background and also
+ * supplies the fill for cells no source covers
+ */
+class CompositeMeteorology {
+ public:
+  METBUILD_EXPORT explicit CompositeMeteorology(const MetBuild::Grid *grid,
+                                                double transition_cells = 0.0);
+
+  void METBUILD_EXPORT add_source(MetBuild::Meteorology *source);
+
+  NODISCARD size_t METBUILD_EXPORT size() const;
+
+  void METBUILD_EXPORT to_wind_grid(
+      const std::vector<double> &time_weights,
+      MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType> &w);
+
+  void METBUILD_EXPORT
+  to_grid(MetBuild::GriddedDataTypes::TYPE type,
+          const std::vector<double> &time_weights,
+          MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType> &r);
+
+  static std::vector<float> METBUILD_EXPORT
+  blend_weights(size_t ni, size_t nj,
+                const MetBuild::InterpolationWeights::CellRanges &valid,
+                double transition_cells);
+
+ private:
+  struct Source {
+    MetBuild::Meteorology *meteorology;
+    MetBuild::InterpolationWeights::CellRanges ranges;
+    std::vector<float> weights;
+  };
+
+  template <unsigned N, typename Interpolate>
+  void composite(
+      const std::vector<double> &time_weights,
+      MetBuild::MeteorologicalData<N, MeteorologicalDataType> &buffer,
+      MetBuild::MeteorologicalData<N, MeteorologicalDataType> &out,
+      Interpolate interpolate);
+
+  const std::vector<float> &source_weights(Source &source);
+
+  const MetBuild::Grid *m_grid;
+  double m_transition;
+  std::vector<Source> m_sources;
+  std::vector<float> m_remaining;
+  MetBuild::MeteorologicalData<3, MeteorologicalDataType> m_wind_buffer;
+  MetBuild::MeteorologicalData<1, MeteorologicalDataType> m_scalar_buffer;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_COMPOSITEMETEOROLOGY_H_
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "ConnectivityLocator.h"
+
+#include <cmath>
+#include <utility>
+
+#include "Logging.h"
+
+using namespace MetBuild::Private;
+
+/**
+ * @brief Builds the mesh of a window of a logically rectangular grid
+ * @param x source longitudes, i varying fastest
+ * @param y source latitudes, i varying fastest
+ * @param ni number of points in the i direction
+ * @param nj number of points in the j direction
+ * @param i0 first column of the window
+ * @param j0 first row of the window
+ * @param window_ni number of columns in the window
+ * @param window_nj number of rows in the window
+ */
+ConnectivityLocator::ConnectivityLocator(const std::vector<double> &x,
+                                         const std::vector<double> &y,
+                                         size_t ni, size_t nj, size_t i0,
+                                         size_t j0, size_t window_ni,
+                                         size_t window_nj) {
+  if (ni < 2 || nj < 2 || x.size() != ni * nj || y.size() != ni * nj ||
+      i0 + window_ni > ni || j0 + window_nj > nj || window_ni < 2 ||
+      window_nj < 2) {
+    metbuild_throw_exception(
+        "The source grid is not logically rectangular and cannot use the "
+        "connectivity locator");
+  }
+
+  //...The seam only closes the mesh when every column is present
+  const bool seam =
+      window_ni == ni && ConnectivityLocator::isPeriodic(x, ni, nj);
+  const size_t n_columns = seam ? window_ni : window_ni - 1;
+
+  std::vector<TriangleBuckets::Triangle> triangles;
+  triangles.reserve(2 * n_columns * (window_nj - 1));
+  for (size_t j = j0; j < j0 + window_nj - 1; ++j) {
+    for (size_t c = 0; c < n_columns; ++c) {
+      const size_t i = i0 + c;
+      const size_t inext = (i + 1) % ni;
+      const double shift = inext < i ? 360.0 : 0.0;
+
+      const size_t n00 = j * ni + i;
+      const size_t n10 = j * ni + inext;
+      const size_t n01 = (j + 1) * ni + i;
+      const size_t n11 = (j + 1) * ni + inext;
+
+      triangles.push_back({{n00, n10, n11},
+                           {x[n00], x[n10] + shift, x[n11] + shift},
+                           {y[n00], y[n10], y[n11]}});
+      triangles.push_back({{n00, n11, n01},
+                           {x[n00], x[n11] + shift, x[n01]},
+                           {y[n00], y[n11], y[n01]}});
+    }
+  }
+  m_buckets = std::make_shared<const TriangleBuckets>(std::move(triangles));
+}
+
+/**
+ * @brief Checks whether the rows of a grid wrap around the globe, with the
+ * last column one step short of the first
+ * @param x source longitudes, i varying fastest
+ * @param ni number of points in the i direction
+ * @param nj number of points in the j direction
+ * @return true if a cell column closes the seam
+ */
+bool ConnectivityLocator::isPeriodic(const std::vector<double> &x, size_t ni,
+                                     size_t nj) {
+  if (ni < 3 || x.size() != ni * nj) return false;
+  for (size_t j = 0; j < nj; ++j) {
+    const auto row = x.begin() + static_cast<std::ptrdiff_t>(j * ni);
+    const double step = row[1] - row[0];
+    const double gap = row[0] + 360.0 - row[ni - 1];
+    if (step <= 0.0 || std::abs(gap - step) > 0.5 * step) return false;
+  }
+  return true;
+}
+
+std::unique_ptr<PointLocator> ConnectivityLocator::clone() const {
+  return std::make_unique<ConnectivityLocator>(*this);
+}
+
+MetBuild::InterpolationWeight ConnectivityLocator::getInterpolationFactors(
+    double x, double y) const {
+  return m_buckets->locate(x, y);
+}
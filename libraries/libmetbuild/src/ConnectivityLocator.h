@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_CONNECTIVITYLOCATOR_H_
+#define METBUILD_SRC_CONNECTIVITYLOCATOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "PointLocator.h"
+#include "TriangleBuckets.h"
+
+namespace MetBuild::Private {
+
+/**
+ * @brief Point locator for logically rectangular source grids
+ *
+ * The mesh is taken from the index space of the grid: each cell is split
+ * along its diagonal into two triangles, so no Delaunay triangulation is
+ * needed and the mesh is built in linear time. Grids spanning the globe in
+ * longitude are closed with a column of cells across the seam. Points are
+ * located through a bucket grid of the triangles
+ */
+class ConnectivityLocator : public PointLocator {
+ public:
+  ConnectivityLocator(const std::vector<double> &x,
+                      const std::vector<double> &y, size_t ni, size_t nj,
+                      size_t i0, size_t j0, size_t window_ni,
+                      size_t window_nj);
+
+  static bool isPeriodic(const std::vector<double> &x, size_t ni, size_t nj);
+
+  using PointLocator::getInterpolationFactors;
+
+  [[nodiscard]] std::unique_ptr<PointLocator> clone() const override;
+
+  [[nodiscard]] MetBuild::InterpolationWeight getInterpolationFactors(
+      double x, double y) const override;
+
+ private:
+  std::shared_ptr<const TriangleBuckets> m_buckets;
+};
+
+}  // namespace MetBuild::Private
+
+#endif  // METBUILD_SRC_CONNECTIVITYLOCATOR_H_
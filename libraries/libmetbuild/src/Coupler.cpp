@@ -0,0 +1,285 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "Coupler.h"
+
+#include <utility>
+
+#include "CouplingRing.h"
+#include "Logging.h"
+#include "PointSeries.h"
+
+using namespace MetBuild;
+
+/**
+ * @brief Constructor
+ * @param nodes positions of the model nodes
+ * @param source source of the files added to the coupler
+ * @param type data type handed to the model
+ * @param time_step seconds between the interpolated steps, usually the
+ * interval of the source or of the forcing the model would otherwise read
+ * @param epsg projection of the node positions
+ */
+Coupler::Coupler(std::vector<MetBuild::Point> nodes,
+                 const Meteorology::SOURCE source,
+                 const MetBuild::GriddedDataTypes::TYPE type,
+                 const int time_step, const int epsg)
+    : m_grid(Grid::from_points(std::move(nodes), epsg)),
+      m_source(source),
+      m_type(type),
+      m_time_step(time_step),
+      m_names(PointSeries::variable_names(type)),
+      m_end_time(0.0),
+      m_time(0.0) {
+  if (time_step <= 0) {
+    metbuild_throw_exception("The coupling time step must be positive");
+  }
+}
+
+Coupler::~Coupler() = default;
+
+/**
+ * @brief Registers the files of the next source time, in time order
+ * @param filenames files making up the snapshot
+ * @param time valid time of the snapshot
+ */
+void Coupler::add_file(const std::vector<std::string> &filenames,
+                       const MetBuild::Date &time) {
+  if (m_pipeline) {
+    metbuild_throw_exception("Files must be added before initialize");
+  }
+  if (!m_files.empty() && time < m_files.back().time) {
+    metbuild_throw_exception(
+        "Files must be added to the coupler in time order");
+  }
+  m_files.push_back({filenames, time});
+}
+
+void Coupler::add_file(const std::string &filename,
+                       const MetBuild::Date &time) {
+  this->add_file(std::vector<std::string>{filename}, time);
+}
+
+/**
+ * @brief Starts interpolating the steps between two dates and waits for the
+ * first of them, so that the fields are available at time zero
+ * @param start_date date of model time zero
+ * @param end_date last date the model will ask for
+ */
+void Coupler::initialize(const MetBuild::Date &start_date,
+                         const MetBuild::Date &end_date) {
+  if (m_files.empty()) {
+    metbuild_throw_exception("No files have been added to the coupler");
+  }
+  if (end_date < start_date) {
+    metbuild_throw_exception("The coupling end date is before its start");
+  }
+  this->finalize();
+  m_start_date = start_date;
+  m_end_time = static_cast<double>(end_date.toSeconds() -
+                                   start_date.toSeconds());
+  m_time = 0.0;
+
+  m_meteorology = std::make_unique<Meteorology>(&m_grid, m_source, m_type);
+  m_pipeline = std::make_unique<MeteorologyPipeline>(m_meteorology.get());
+  for (const auto &f : m_files) {
+    m_pipeline->add_file(f.filenames, f.time);
+  }
+  m_pipeline->start(start_date, end_date, m_time_step);
+
+  if (!this->advance()) {
+    metbuild_throw_exception("The coupling period has no steps");
+  }
+  m_previous = m_next;
+  this->advance();
+}
+
+/**
+ * @brief Takes the next step of the pipeline. The step after the current
+ * time becomes the one before it
+ * @return false once the pipeline has no steps left
+ */
+bool Coupler::advance() {
+  if (!m_pipeline->next()) return false;
+  std::swap(m_previous, m_next);
+  m_next.time = static_cast<double>(m_pipeline->time().toSeconds() -
+                                    m_start_date.toSeconds());
+  m_next.values.resize(m_names.size());
+  const bool wind = m_type == MetBuild::GriddedDataTypes::WIND_PRESSURE;
+  for (size_t k = 0; k < m_names.size(); ++k) {
+    const auto values = wind ? m_pipeline->wind_grid().parameter(k)
+                             : m_pipeline->grid().parameter(0);
+    m_next.values[k].assign(values.begin(), values.end());
+  }
+  return true;
+}
+
+/**
+ * @brief Moves the coupler to a model time, interpolating the steps up to
+ * it. Times must not go backwards
+ * @param time seconds since the start date
+ */
+void Coupler::update_until(const double time) {
+  if (!m_pipeline) {
+    metbuild_throw_exception("The coupler has not been initialized");
+  }
+  if (time < m_previous.time) {
+    metbuild_throw_exception(
+        "The coupler cannot go back to a time before its previous step");
+  }
+  while (time > m_next.time) {
+    if (!this->advance()) {
+      metbuild_throw_exception(
+          "The coupling time is after the end date of the coupler");
+    }
+  }
+  m_time = time;
+}
+
+/**
+ * @brief Copies a field at the current time to the model, interpolated
+ * linearly between the steps around it
+ * @param variable index of the field in names()
+ * @param dest array of size() values
+ */
+void Coupler::get_value(const size_t variable,
+                        MetBuild::MeteorologicalDataType *dest) const {
+  if (!m_pipeline) {
+    metbuild_throw_exception("The coupler has not been initialized");
+  }
+  if (variable >= m_names.size()) {
+    metbuild_throw_exception("Coupling variable index out of range");
+  }
+  const double span = m_next.time - m_previous.time;
+  const double weight = span > 0.0 ? (m_time - m_previous.time) / span : 0.0;
+  Coupler::interpolate(m_previous.values[variable].data(),
+                       m_next.values[variable].data(), weight, this->size(),
+                       dest);
+}
+
+/**
+ * @brief Interpolates linearly between two fields. Cells flagged in either
+ * field are flagged in the result
+ * @param before field at the earlier time
+ * @param after field at the later time
+ * @param weight weight of the later field
+ * @param n number of values
+ * @param dest array of n values
+ */
+void Coupler::interpolate(const MetBuild::MeteorologicalDataType *before,
+                          const MetBuild::MeteorologicalDataType *after,
+                          const double weight, const size_t n,
+                          MetBuild::MeteorologicalDataType *dest) {
+  constexpr auto flag = MeteorologicalData<1>::flag_value();
+  const auto w = static_cast<MeteorologicalDataType>(weight);
+  for (size_t i = 0; i < n; ++i) {
+    dest[i] = before[i] == flag || after[i] == flag
+                  ? flag
+                  : before[i] + w * (after[i] - before[i]);
+  }
+}
+
+/**
+ * @brief Writes every step from the current one to the end date to a ring
+ * read by a model in another process. Blocks while the ring is full and
+ * marks the ring finished once the last step is written
+ * @param ring ring created for size() points and the variables of names()
+ */
+void Coupler::publish(MetBuild::CouplingRing *ring) {
+  if (!m_pipeline) {
+    metbuild_throw_exception("The coupler has not been initialized");
+  }
+  if (ring->size() != this->size() || ring->names() != m_names) {
+    metbuild_throw_exception("The ring does not match the coupled fields");
+  }
+  std::vector<const MeteorologicalDataType *> fields(m_names.size());
+  const auto write = [&](const Step &step) {
+    for (size_t k = 0; k < fields.size(); ++k) {
+      fields[k] = step.values[k].data();
+    }
+    ring->write(step.time, fields);
+  };
+  write(m_previous);
+  if (m_next.time > m_previous.time) {
+    write(m_next);
+    while (this->advance()) write(m_next);
+  }
+  ring->finish();
+}
+
+/**
+ * @brief Creates a ring and writes every step from the current one to the
+ * end date to it
+ * @param filename file holding the ring, e.g. under /dev/shm
+ * @param slots number of steps the ring holds at once
+ */
+void Coupler::publish(const std::string &filename, const size_t slots) {
+  if (!m_pipeline) {
+    metbuild_throw_exception("The coupler has not been initialized");
+  }
+  m_ring.reset();
+  auto ring = CouplingRing::create(filename, this->size(), m_names, slots,
+                                   m_start_date);
+  this->publish(ring.get());
+  m_ring = std::move(ring);
+}
+
+/**
+ * @brief Stops the pipeline and removes any ring published to. The coupler
+ * can be initialized again
+ */
+void Coupler::finalize() {
+  m_pipeline.reset();
+  m_meteorology.reset();
+  m_ring.reset();
+}
+
+size_t Coupler::size() const { return m_grid.ni(); }
+
+const std::vector<std::string> &Coupler::names() const { return m_names; }
+
+/**
+ * @brief Index of a field by name
+ * @param name field name, one of names()
+ * @return index of the field
+ */
+size_t Coupler::variable(const std::string &name) const {
+  for (size_t k = 0; k < m_names.size(); ++k) {
+    if (m_names[k] == name) return k;
+  }
+  metbuild_throw_exception("Unknown coupling variable " + name);
+  return 0;
+}
+
+MetBuild::Date Coupler::start_date() const { return m_start_date; }
+
+double Coupler::current_time() const { return m_time; }
+
+double Coupler::end_time() const { return m_end_time; }
+
+int Coupler::time_step() const { return m_time_step; }
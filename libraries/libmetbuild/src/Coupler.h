@@ -0,0 +1,149 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_COUPLER_H_
+#define METBUILD_SRC_COUPLER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "Date.h"
+#include "Grid.h"
+#include "MetBuild_Global.h"
+#include "MeteorologicalData.h"
+#include "Meteorology.h"
+#include "MeteorologyPipeline.h"
+#include "Point.h"
+#include "data_sources/GriddedDataTypes.h"
+
+namespace MetBuild {
+
+class CouplingRing;
+
+/**
+ * @brief Hands the meteorology at the nodes of an ocean model to the model
+ * as it runs, without writing and parsing forcing files
+ *
+ * The nodes are interpolated as a point list grid, so the weights onto the
+ * source grid are computed once and each source snapshot only contributes
+ * the values around the nodes. Steps are interpolated every time_step
+ * seconds on a background pipeline and the model takes the fields at its own
+ * times, which are interpolated linearly between the two steps around them
+ *
+ * Times are seconds since the start date given to initialize. A model in
+ * the same process calls update_until and get_value, through the C
+ * interface in MetBuildCoupling.h if need be, while a model in another
+ * process reads the steps published by publish from a CouplingRing, which
+ * the coupler keeps until it is finalized
+ */
+class Coupler {
+ public:
+  METBUILD_EXPORT Coupler(std::vector<MetBuild::Point> nodes,
+                          Meteorology::SOURCE source,
+                          MetBuild::GriddedDataTypes::TYPE type,
+                          int time_step, int epsg = 4326);
+
+  METBUILD_EXPORT ~Coupler();
+
+  Coupler(const Coupler &) = delete;
+  Coupler &operator=(const Coupler &) = delete;
+
+  void METBUILD_EXPORT add_file(const std::vector<std::string> &filenames,
+                                const MetBuild::Date &time);
+  void METBUILD_EXPORT add_file(const std::string &filename,
+                                const MetBuild::Date &time);
+
+  void METBUILD_EXPORT initialize(const MetBuild::Date &start_date,
+                                  const MetBuild::Date &end_date);
+
+  void METBUILD_EXPORT update_until(double time);
+
+  void METBUILD_EXPORT get_value(size_t variable,
+                                 MetBuild::MeteorologicalDataType *dest) const;
+
+  void METBUILD_EXPORT publish(MetBuild::CouplingRing *ring);
+  void METBUILD_EXPORT publish(const std::string &filename, size_t slots = 4);
+
+  void METBUILD_EXPORT finalize();
+
+  NODISCARD size_t METBUILD_EXPORT size() const;
+
+  NODISCARD const std::vector<std::string> METBUILD_EXPORT &names() const;
+
+  NODISCARD size_t METBUILD_EXPORT variable(const std::string &name) const;
+
+  NODISCARD MetBuild::Date METBUILD_EXPORT start_date() const;
+
+  NODISCARD double METBUILD_EXPORT current_time() const;
+
+  NODISCARD double METBUILD_EXPORT end_time() const;
+
+  NODISCARD int METBUILD_EXPORT time_step() const;
+
+  static void METBUILD_EXPORT
+  interpolate(const MetBuild::MeteorologicalDataType *before,
+              const MetBuild::MeteorologicalDataType *after, double weight,
+              size_t n, MetBuild::MeteorologicalDataType *dest);
+
+ private:
+  struct SourceFile {
+    std::vector<std::string> filenames;
+    MetBuild::Date time;
+  };
+
+  struct Step {
+    double time = 0.0;
+    std::vector<std::vector<MetBuild::MeteorologicalDataType>> values;
+  };
+
+  bool advance();
+
+  MetBuild::Grid m_grid;
+  Meteorology::SOURCE m_source;
+  MetBuild::GriddedDataTypes::TYPE m_type;
+  int m_time_step;
+  std::vector<SourceFile> m_files;
+  std::vector<std::string> m_names;
+  MetBuild::Date m_start_date;
+  double m_end_time;
+  double m_time;
+
+  //...Steps before and after the current time
+  Step m_previous;
+  Step m_next;
+
+  std::unique_ptr<Meteorology> m_meteorology;
+  std::unique_ptr<MeteorologyPipeline> m_pipeline;
+  std::unique_ptr<MetBuild::CouplingRing> m_ring;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_COUPLER_H_
@@ -0,0 +1,365 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "CouplingRing.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <utility>
+
+#include "Coupler.h"
+#include "Logging.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace MetBuild;
+
+namespace {
+constexpr char c_magic[4] = {'M', 'B', 'C', 'R'};
+constexpr uint32_t c_version = 1;
+constexpr size_t c_name_size = 32;
+constexpr size_t c_header_size = 64;
+
+//...Polling interval of a reader waiting for a step or a writer waiting for
+// a free slot. The two sides are in different processes, so there is no
+// condition variable to wait on
+constexpr auto c_poll = std::chrono::microseconds(200);
+
+//...Each slot holds the time of its step followed by its fields
+constexpr size_t slot_size(const size_t points, const size_t variables) {
+  return (sizeof(double) + variables * points * sizeof(MeteorologicalDataType) +
+          7) /
+         8 * 8;
+}
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "The coupling ring needs lock free 64 bit atomics");
+}  // namespace
+
+struct CouplingRing::Header {
+  char magic[4];
+  uint32_t version;
+  uint64_t points;
+  uint32_t variables;
+  uint32_t slots;
+  int64_t start;
+  uint32_t value_size;
+  std::atomic<uint32_t> finished;
+  //...Steps ever written, and index of the oldest step the reader still
+  // needs. Slots before it may be reused
+  std::atomic<uint64_t> written;
+  std::atomic<uint64_t> released;
+};
+
+CouplingRing::CouplingRing(std::string filename, const bool owner)
+    : m_filename(std::move(filename)),
+      m_owner(owner),
+      m_data(nullptr),
+      m_size(0) {}
+
+CouplingRing::~CouplingRing() {
+#ifndef _WIN32
+  if (m_data) munmap(m_data, m_size);
+  if (m_owner) ::unlink(m_filename.c_str());
+#endif
+}
+
+/**
+ * @brief Creates a ring, replacing any file of the same name
+ * @param filename file holding the ring, e.g. under /dev/shm
+ * @param points number of values of each field
+ * @param names names of the fields of each step
+ * @param slots number of steps held at once, at least two so that the reader
+ * always has the steps on both sides of its time
+ * @param start_date date of time zero
+ * @return ring, open for writing
+ */
+std::unique_ptr<CouplingRing> CouplingRing::create(
+    const std::string &filename, const size_t points,
+    const std::vector<std::string> &names, const size_t slots,
+    const MetBuild::Date &start_date) {
+#ifdef _WIN32
+  metbuild_throw_exception("Coupling rings are not supported on Windows");
+  return nullptr;
+#else
+  if (points == 0 || names.empty() || slots < 2) {
+    metbuild_throw_exception(
+        "A coupling ring needs points, fields and at least two slots");
+  }
+  for (const auto &name : names) {
+    if (name.size() >= c_name_size) {
+      metbuild_throw_exception("Coupling field name too long: " + name);
+    }
+  }
+  static_assert(sizeof(Header) <= c_header_size,
+                "The coupling ring header does not fit in its space");
+  std::unique_ptr<CouplingRing> ring(new CouplingRing(filename, true));
+  ring->m_size = c_header_size + names.size() * c_name_size +
+                 slots * slot_size(points, names.size());
+
+  const int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) {
+    metbuild_throw_exception("Could not create coupling ring '" + filename +
+                             "'");
+  }
+  if (ftruncate(fd, static_cast<off_t>(ring->m_size)) != 0) {
+    ::close(fd);
+    metbuild_throw_exception("Could not size coupling ring '" + filename +
+                             "'");
+  }
+  void *ptr =
+      mmap(nullptr, ring->m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (ptr == MAP_FAILED) {
+    metbuild_throw_exception("Could not memory map coupling ring '" +
+                             filename + "'");
+  }
+  ring->m_data = static_cast<char *>(ptr);
+
+  auto *header = new (ring->m_data) Header();
+  header->version = c_version;
+  header->points = points;
+  header->variables = static_cast<uint32_t>(names.size());
+  header->slots = static_cast<uint32_t>(slots);
+  header->start = start_date.toSeconds();
+  header->value_size = sizeof(MeteorologicalDataType);
+  for (size_t k = 0; k < names.size(); ++k) {
+    std::strncpy(ring->m_data + c_header_size + k * c_name_size,
+                 names[k].c_str(), c_name_size);
+  }
+  //...The magic goes in last, so a reader opening the file early sees a
+  // ring that is not ready rather than a partial header
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header->magic, c_magic, sizeof(c_magic));
+  return ring;
+#endif
+}
+
+/**
+ * @brief Opens a ring created by another process
+ * @param filename file holding the ring
+ * @return ring, open for reading
+ */
+std::unique_ptr<CouplingRing> CouplingRing::open(const std::string &filename) {
+#ifdef _WIN32
+  metbuild_throw_exception("Coupling rings are not supported on Windows");
+  return nullptr;
+#else
+  const int fd = ::open(filename.c_str(), O_RDWR);
+  if (fd < 0) {
+    metbuild_throw_exception("Could not open coupling ring '" + filename +
+                             "'");
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < c_header_size) {
+    ::close(fd);
+    metbuild_throw_exception("Coupling ring '" + filename + "' is not ready");
+  }
+  std::unique_ptr<CouplingRing> ring(new CouplingRing(filename, false));
+  ring->m_size = static_cast<size_t>(st.st_size);
+  void *ptr =
+      mmap(nullptr, ring->m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (ptr == MAP_FAILED) {
+    metbuild_throw_exception("Could not memory map coupling ring '" +
+                             filename + "'");
+  }
+  ring->m_data = static_cast<char *>(ptr);
+
+  const auto *header = ring->header();
+  if (std::memcmp(header->magic, c_magic, sizeof(c_magic)) != 0) {
+    metbuild_throw_exception("Coupling ring '" + filename + "' is not ready");
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (header->version != c_version ||
+      header->value_size != sizeof(MeteorologicalDataType)) {
+    metbuild_throw_exception("Coupling ring '" + filename +
+                             "' was written by an incompatible version");
+  }
+  return ring;
+#endif
+}
+
+CouplingRing::Header *CouplingRing::header() const {
+  return reinterpret_cast<Header *>(m_data);
+}
+
+char *CouplingRing::slot(const size_t index) const {
+  const auto *h = this->header();
+  return m_data + c_header_size + h->variables * c_name_size +
+         (index % h->slots) * slot_size(h->points, h->variables);
+}
+
+double CouplingRing::slot_time(const size_t index) const {
+  double time;
+  std::memcpy(&time, this->slot(index), sizeof(double));
+  return time;
+}
+
+MeteorologicalDataType *CouplingRing::slot_values(const size_t index,
+                                                  const size_t variable) const {
+  return reinterpret_cast<MeteorologicalDataType *>(this->slot(index) +
+                                                    sizeof(double)) +
+         variable * this->header()->points;
+}
+
+/**
+ * @brief Writes the next step. Blocks while every slot holds a step the
+ * reader still needs
+ * @param time seconds since the start date, after the time of the previous
+ * step
+ * @param fields values of each field, in the order of names()
+ */
+void CouplingRing::write(
+    const double time,
+    const std::vector<const MetBuild::MeteorologicalDataType *> &fields) {
+  if (!m_owner) {
+    metbuild_throw_exception("Only the creator of a coupling ring writes it");
+  }
+  auto *h = this->header();
+  if (fields.size() != h->variables) {
+    metbuild_throw_exception("Wrong number of fields for the coupling ring");
+  }
+  if (h->finished.load(std::memory_order_relaxed) != 0) {
+    metbuild_throw_exception("The coupling ring has been finished");
+  }
+  const uint64_t written = h->written.load(std::memory_order_relaxed);
+  if (written > 0 && time <= this->slot_time(written - 1)) {
+    metbuild_throw_exception(
+        "Steps must be written to the coupling ring in time order");
+  }
+  while (written - h->released.load(std::memory_order_acquire) >= h->slots) {
+    std::this_thread::sleep_for(c_poll);
+  }
+  std::memcpy(this->slot(written), &time, sizeof(double));
+  for (size_t k = 0; k < fields.size(); ++k) {
+    std::memcpy(this->slot_values(written, k), fields[k],
+                h->points * sizeof(MeteorologicalDataType));
+  }
+  h->written.store(written + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Marks the ring finished, after which a reader asking for a time
+ * past the last step fails instead of waiting
+ */
+void CouplingRing::finish() {
+  this->header()->finished.store(1, std::memory_order_release);
+}
+
+/**
+ * @brief Reads a field at a time, interpolated linearly between the steps
+ * around it. Waits until the ring holds the step at or after the time
+ * @param time seconds since the start date, not before the time of a
+ * previous read
+ * @param variable index of the field in names()
+ * @param dest array of size() values
+ * @param timeout seconds to wait for the step, negative to wait for as long
+ * as it takes
+ * @return false if the step was not written within the timeout
+ */
+bool CouplingRing::read(const double time, const size_t variable,
+                        MetBuild::MeteorologicalDataType *dest,
+                        const double timeout) {
+  auto *h = this->header();
+  if (variable >= h->variables) {
+    metbuild_throw_exception("Coupling variable index out of range");
+  }
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::duration<double>(timeout);
+  while (true) {
+    const bool finished = h->finished.load(std::memory_order_acquire) != 0;
+    const uint64_t released = h->released.load(std::memory_order_relaxed);
+    const uint64_t written = h->written.load(std::memory_order_acquire);
+    uint64_t before = released;
+    for (uint64_t k = released; k < written; ++k) {
+      const double t = this->slot_time(k);
+      if (t < time) {
+        before = k;
+        continue;
+      }
+      if (t == time) {
+        std::memcpy(dest, this->slot_values(k, variable),
+                    h->points * sizeof(MeteorologicalDataType));
+        h->released.store(k, std::memory_order_release);
+        return true;
+      }
+      if (k == released) {
+        metbuild_throw_exception(
+            "The coupling time is before the steps held by the ring");
+      }
+      const double t0 = this->slot_time(k - 1);
+      Coupler::interpolate(this->slot_values(k - 1, variable),
+                           this->slot_values(k, variable),
+                           (time - t0) / (t - t0), h->points, dest);
+      h->released.store(k - 1, std::memory_order_release);
+      return true;
+    }
+    if (finished) {
+      metbuild_throw_exception(
+          "The coupling time is after the last step of the ring");
+    }
+    //...Only the latest step before the time is needed while waiting for the
+    // one after it, which may need the slots of the others
+    if (before > released) {
+      h->released.store(before, std::memory_order_release);
+    }
+    if (timeout >= 0.0 && std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(c_poll);
+  }
+}
+
+size_t CouplingRing::size() const { return this->header()->points; }
+
+size_t CouplingRing::slots() const { return this->header()->slots; }
+
+std::vector<std::string> CouplingRing::names() const {
+  const auto *h = this->header();
+  std::vector<std::string> names;
+  for (size_t k = 0; k < h->variables; ++k) {
+    const char *name = m_data + c_header_size + k * c_name_size;
+    names.emplace_back(name, strnlen(name, c_name_size));
+  }
+  return names;
+}
+
+MetBuild::Date CouplingRing::start_date() const {
+  return MetBuild::Date(static_cast<long long>(this->header()->start));
+}
@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_COUPLINGRING_H_
+#define METBUILD_SRC_COUPLINGRING_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "Date.h"
+#include "MetBuild_Global.h"
+#include "MeteorologicalData.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Ring of interpolated steps in a memory mapped file, through which
+ * a Coupler in one process hands the meteorology to a model in another
+ *
+ * The file is best placed on a memory file system such as /dev/shm, where
+ * it never reaches a disk. One process creates the ring and writes steps in
+ * time order, one process opens it and reads the fields at its own times,
+ * which must not go backwards. The reader releases the slots of steps it no
+ * longer needs as it moves forward and the writer waits for a free slot
+ * when the ring is full, so neither side ever sees a partially written step
+ *
+ * The creator removes the file when the ring is destroyed. A reader that
+ * has already opened it keeps its mapping
+ */
+class CouplingRing {
+ public:
+  METBUILD_EXPORT ~CouplingRing();
+
+  CouplingRing(const CouplingRing &) = delete;
+  CouplingRing &operator=(const CouplingRing &) = delete;
+
+  NODISCARD static std::unique_ptr<CouplingRing> METBUILD_EXPORT
+  create(const std::string &filename, size_t points,
+         const std::vector<std::string> &names, size_t slots,
+         const MetBuild::Date &start_date);
+
+  NODISCARD static std::unique_ptr<CouplingRing> METBUILD_EXPORT
+  open(const std::string &filename);
+
+  void METBUILD_EXPORT
+  write(double time,
+        const std::vector<const MetBuild::MeteorologicalDataType *> &fields);
+
+  void METBUILD_EXPORT finish();
+
+  NODISCARD bool METBUILD_EXPORT read(double time, size_t variable,
+                                      MetBuild::MeteorologicalDataType *dest,
+                                      double timeout = -1.0);
+
+  NODISCARD size_t METBUILD_EXPORT size() const;
+
+  NODISCARD size_t METBUILD_EXPORT slots() const;
+
+  NODISCARD std::vector<std::string> METBUILD_EXPORT names() const;
+
+  NODISCARD MetBuild::Date METBUILD_EXPORT start_date() const;
+
+ private:
+  struct Header;
+
+  CouplingRing(std::string filename, bool owner);
+
+  Header *header() const;
+
+  NODISCARD char *slot(size_t index) const;
+
+  NODISCARD double slot_time(size_t index) const;
+
+  NODISCARD MetBuild::MeteorologicalDataType *slot_values(
+      size_t index, size_t variable) const;
+
+  std::string m_filename;
+  bool m_owner;
+  char *m_data;
+  size_t m_size;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_COUPLINGRING_H_
@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "CroppedLocator.h"
+
+#include <utility>
+
+#include "Triangulation.h"
+
+using namespace MetBuild::Private;
+
+/**
+ * @brief Constructor
+ * @param locator locator built on the subset of the source points
+ * @param index position in the full source arrays of each subset point
+ */
+CroppedLocator::CroppedLocator(std::unique_ptr<PointLocator> locator,
+                               std::vector<size_t> index)
+    : m_locator(std::move(locator)), m_index(std::move(index)) {
+  this->track_memory(m_index.size() * sizeof(size_t));
+}
+
+CroppedLocator::CroppedLocator(const CroppedLocator &other)
+    : PointLocator(other),
+      m_locator(other.m_locator->clone()),
+      m_index(other.m_index) {}
+
+std::unique_ptr<PointLocator> CroppedLocator::clone() const {
+  return std::make_unique<CroppedLocator>(*this);
+}
+
+MetBuild::InterpolationWeight CroppedLocator::getInterpolationFactors(
+    double x, double y) const {
+  return this->remap(m_locator->getInterpolationFactors(x, y));
+}
+
+void CroppedLocator::getInterpolationFactors(
+    const std::vector<MetBuild::Point> &points,
+    std::vector<MetBuild::InterpolationWeight> &weights) const {
+  m_locator->getInterpolationFactors(points, weights);
+  for (auto &w : weights) {
+    w = this->remap(w);
+  }
+}
+
+MetBuild::InterpolationWeight CroppedLocator::remap(
+    const MetBuild::InterpolationWeight &w) const {
+  if (!MetBuild::InterpolationWeight::valid(
+          w, MetBuild::Triangulation::invalid_point())) {
+    return w;
+  }
+  return {{m_index[w.index()[0]], m_index[w.index()[1]],
+           m_index[w.index()[2]]},
+          w.weight()};
+}
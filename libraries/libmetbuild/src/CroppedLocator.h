@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_CROPPEDLOCATOR_H_
+#define METBUILD_SRC_CROPPEDLOCATOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "PointLocator.h"
+
+namespace MetBuild::Private {
+
+/**
+ * @brief Locator built on a subset of the source points, reporting indices
+ * into the full source arrays
+ */
+class CroppedLocator : public PointLocator {
+ public:
+  CroppedLocator(std::unique_ptr<PointLocator> locator,
+                 std::vector<size_t> index);
+
+  CroppedLocator(const CroppedLocator &other);
+
+  [[nodiscard]] std::unique_ptr<PointLocator> clone() const override;
+
+  [[nodiscard]] MetBuild::InterpolationWeight getInterpolationFactors(
+      double x, double y) const override;
+
+  void getInterpolationFactors(
+      const std::vector<MetBuild::Point> &points,
+      std::vector<MetBuild::InterpolationWeight> &weights) const override;
+
+ private:
+  [[nodiscard]] MetBuild::InterpolationWeight remap(
+      const MetBuild::InterpolationWeight &w) const;
+
+  std::unique_ptr<PointLocator> m_locator;
+  std::vector<size_t> m_index;
+};
+
+}  // namespace MetBuild::Private
+
+#endif  // METBUILD_SRC_CROPPEDLOCATOR_H_
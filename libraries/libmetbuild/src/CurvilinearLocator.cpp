@@ -0,0 +1,200 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "CurvilinearLocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "Logging.h"
+#include "Triangulation.h"
+
+using namespace MetBuild::Private;
+
+namespace {
+constexpr double c_tolerance = 1e-9;
+constexpr long c_search_radius = 2;
+}  // namespace
+
+CurvilinearLocator::CurvilinearLocator(const std::vector<double> &x,
+                                       const std::vector<double> &y, size_t ni,
+                                       size_t nj, std::string geographic_crs,
+                                       std::string projected_crs)
+    : m_ni(ni),
+      m_nj(nj),
+      m_geographic_crs(std::move(geographic_crs)),
+      m_projected_crs(std::move(projected_crs)),
+      m_px(x),
+      m_py(y),
+      m_inverse{0.0, 0.0, 0.0, 0.0} {
+  if (ni < 2 || nj < 2 || x.size() != ni * nj || y.size() != ni * nj) {
+    metbuild_throw_exception("Invalid dimensions for the curvilinear locator");
+  }
+  this->track_memory((m_px.size() + m_py.size()) * sizeof(double));
+
+  auto transformer = this->acquire_transformer();
+  transformer->transform(m_px, m_py);
+  this->release_transformer(std::move(transformer));
+
+  //...Grid increment vectors in the projected plane
+  const double a = (m_px[ni - 1] - m_px[0]) / static_cast<double>(ni - 1);
+  const double b = (m_px[(nj - 1) * ni] - m_px[0]) / static_cast<double>(nj - 1);
+  const double c = (m_py[ni - 1] - m_py[0]) / static_cast<double>(ni - 1);
+  const double d = (m_py[(nj - 1) * ni] - m_py[0]) / static_cast<double>(nj - 1);
+  const double det = a * d - b * c;
+  if (std::abs(det) < c_tolerance) {
+    metbuild_throw_exception(
+        "The source grid is degenerate in its native projection");
+  }
+  m_inverse[0] = d / det;
+  m_inverse[1] = -b / det;
+  m_inverse[2] = -c / det;
+  m_inverse[3] = a / det;
+}
+
+CurvilinearLocator::CurvilinearLocator(const CurvilinearLocator &other)
+    : PointLocator(other),
+      m_ni(other.m_ni),
+      m_nj(other.m_nj),
+      m_geographic_crs(other.m_geographic_crs),
+      m_projected_crs(other.m_projected_crs),
+      m_px(other.m_px),
+      m_py(other.m_py),
+      m_inverse{other.m_inverse[0], other.m_inverse[1], other.m_inverse[2],
+                other.m_inverse[3]} {}
+
+std::unique_ptr<PointLocator> CurvilinearLocator::clone() const {
+  return std::make_unique<CurvilinearLocator>(*this);
+}
+
+std::unique_ptr<MetBuild::Projection::Transformer>
+CurvilinearLocator::acquire_transformer() const {
+  {
+    std::lock_guard<std::mutex> lock(m_transformer_mutex);
+    if (!m_transformers.empty()) {
+      auto t = std::move(m_transformers.back());
+      m_transformers.pop_back();
+      return t;
+    }
+  }
+  return std::make_unique<Projection::Transformer>(m_geographic_crs,
+                                                   m_projected_crs);
+}
+
+void CurvilinearLocator::release_transformer(
+    std::unique_ptr<Projection::Transformer> transformer) const {
+  std::lock_guard<std::mutex> lock(m_transformer_mutex);
+  m_transformers.push_back(std::move(transformer));
+}
+
+MetBuild::InterpolationWeight CurvilinearLocator::getInterpolationFactors(
+    double x, double y) const {
+  auto transformer = this->acquire_transformer();
+  transformer->transform(x, y);
+  this->release_transformer(std::move(transformer));
+  return this->locate_projected(x, y);
+}
+
+void CurvilinearLocator::getInterpolationFactors(
+    const std::vector<MetBuild::Point> &points,
+    std::vector<MetBuild::InterpolationWeight> &weights) const {
+  std::vector<double> px(points.size());
+  std::vector<double> py(points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    px[i] = points[i].x();
+    py[i] = points[i].y();
+  }
+  auto transformer = this->acquire_transformer();
+  transformer->transform(px, py);
+  this->release_transformer(std::move(transformer));
+
+  weights.resize(points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    weights[i] = this->locate_projected(px[i], py[i]);
+  }
+}
+
+bool CurvilinearLocator::triangle_weights(
+    size_t n0, size_t n1, size_t n2, double px, double py,
+    MetBuild::InterpolationWeight &weight) const {
+  const double x0 = m_px[n0], y0 = m_py[n0];
+  const double x1 = m_px[n1], y1 = m_py[n1];
+  const double x2 = m_px[n2], y2 = m_py[n2];
+  const double det = (y1 - y2) * (x0 - x2) + (x2 - x1) * (y0 - y2);
+  if (std::abs(det) < c_tolerance) return false;
+  const double w0 = ((y1 - y2) * (px - x2) + (x2 - x1) * (py - y2)) / det;
+  const double w1 = ((y2 - y0) * (px - x2) + (x0 - x2) * (py - y2)) / det;
+  const double w2 = 1.0 - w0 - w1;
+  const double eps = -1e-9;
+  if (w0 < eps || w1 < eps || w2 < eps) return false;
+  weight = MetBuild::InterpolationWeight({n0, n1, n2}, {w0, w1, w2});
+  return true;
+}
+
+MetBuild::InterpolationWeight CurvilinearLocator::locate_projected(
+    double px, double py) const {
+  const double dx = px - m_px[0];
+  const double dy = py - m_py[0];
+  const double fi = m_inverse[0] * dx + m_inverse[1] * dy;
+  const double fj = m_inverse[2] * dx + m_inverse[3] * dy;
+
+  const MetBuild::InterpolationWeight invalid = {
+      {Triangulation::invalid_point(), Triangulation::invalid_point(),
+       Triangulation::invalid_point()},
+      {0.0, 0.0, 0.0}};
+
+  const auto max_i = static_cast<long>(m_ni) - 2;
+  const auto max_j = static_cast<long>(m_nj) - 2;
+  if (fi < -c_search_radius || fj < -c_search_radius ||
+      fi > max_i + 1 + c_search_radius || fj > max_j + 1 + c_search_radius) {
+    return invalid;
+  }
+
+  const auto ci = static_cast<long>(std::floor(fi));
+  const auto cj = static_cast<long>(std::floor(fj));
+
+  //...Search outward from the estimated cell
+  MetBuild::InterpolationWeight w;
+  for (long r = 0; r <= c_search_radius; ++r) {
+    for (long j = cj - r; j <= cj + r; ++j) {
+      if (j < 0 || j > max_j) continue;
+      for (long i = ci - r; i <= ci + r; ++i) {
+        if (i < 0 || i > max_i) continue;
+        if (std::max(std::abs(i - ci), std::abs(j - cj)) != r) continue;
+        const auto n00 = static_cast<size_t>(j) * m_ni + static_cast<size_t>(i);
+        const auto n10 = n00 + 1;
+        const auto n01 = n00 + m_ni;
+        const auto n11 = n01 + 1;
+        if (this->triangle_weights(n00, n10, n11, px, py, w)) return w;
+        if (this->triangle_weights(n00, n11, n01, px, py, w)) return w;
+      }
+    }
+  }
+  return invalid;
+}
@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_CURVILINEARLOCATOR_H_
+#define METBUILD_SRC_CURVILINEARLOCATOR_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "PointLocator.h"
+#include "Projection.h"
+
+namespace MetBuild::Private {
+
+/**
+ * @brief Point locator for curvilinear grids that are regular in a map
+ * projection, such as the Lambert conformal and polar stereographic grids
+ *
+ * Query points are projected into the native projection of the source grid
+ * where the fractional (i, j) position follows directly from the grid
+ * origin and increments. The containing triangle is then found with a short
+ * search of the neighbouring cells
+ */
+class CurvilinearLocator : public PointLocator {
+ public:
+  CurvilinearLocator(const std::vector<double> &x, const std::vector<double> &y,
+                     size_t ni, size_t nj, std::string geographic_crs,
+                     std::string projected_crs);
+
+  CurvilinearLocator(const CurvilinearLocator &other);
+
+  [[nodiscard]] std::unique_ptr<PointLocator> clone() const override;
+
+  [[nodiscard]] MetBuild::InterpolationWeight getInterpolationFactors(
+      double x, double y) const override;
+
+  void getInterpolationFactors(
+      const std::vector<MetBuild::Point> &points,
+      std::vector<MetBuild::InterpolationWeight> &weights) const override;
+
+ private:
+  std::unique_ptr<Projection::Transformer> acquire_transformer() const;
+
+  void release_transformer(
+      std::unique_ptr<Projection::Transformer> transformer) const;
+
+  [[nodiscard]] MetBuild::InterpolationWeight locate_projected(
+      double px, double py) const;
+
+  bool triangle_weights(size_t n0, size_t n1, size_t n2, double px, double py,
+                        MetBuild::InterpolationWeight &weight) const;
+
+  size_t m_ni;
+  size_t m_nj;
+  std::string m_geographic_crs;
+  std::string m_projected_crs;
+  std::vector<double> m_px;
+  std::vector<double> m_py;
+  double m_inverse[4];
+
+  mutable std::mutex m_transformer_mutex;
+  mutable std::vector<std::unique_ptr<Projection::Transformer>> m_transformers;
+};
+
+}  // namespace MetBuild::Private
+
+#endif  // METBUILD_SRC_CURVILINEARLOCATOR_H_
@@ -91,7 +91,7 @@ Date::Date(const std::chrono::system_clock::time_point &t) { this->set(t); }
 
 Date::Date(const std::vector<int> &v) { this->set(v); }
 
-Date::Date(const Date &d) { this->set(d.get()); }
+Date::Date(const Date &d) : m_datetime(d.m_datetime) {}
 
 Date::Date(int year, unsigned month, unsigned day, unsigned hour,
            unsigned minute, unsigned second, unsigned millisecond) {
@@ -201,9 +201,6 @@ std::vector<int> Date::get() const {
 }
 
 void Date::set(const std::vector<int> &v) {
-  std::vector<int> v2(7);
-  std::copy(v.begin(), v.end(), v2.begin());
-
   this->set(v[0], v[1], v[2], v[3], v[4], v[5], v[6]);
 }
 
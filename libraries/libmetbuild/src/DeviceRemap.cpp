@@ -0,0 +1,156 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "DeviceRemap.h"
+
+#include "InterpolationKernel.h"
+#include "Logging.h"
+
+//...Offload directives are only emitted when the build asks for them, so
+// the same loops otherwise compile as ordinary host code
+#if defined(METBUILD_OFFLOAD) && defined(_OPENMP)
+#define METBUILD_OFFLOAD_ENABLED 1
+#define METBUILD_OFFLOAD_PRAGMA(x) _Pragma(#x)
+#define METBUILD_OMP(x) METBUILD_OFFLOAD_PRAGMA(omp x)
+#else
+#define METBUILD_OFFLOAD_ENABLED 0
+#define METBUILD_OMP(x)
+#endif
+
+using namespace MetBuild;
+
+/**
+ * @brief Copies a set of sparse weights to the device
+ * @param weights weights of every output cell
+ */
+DeviceWeights::DeviceWeights(const SparseWeights &weights)
+    : m_rows(weights.rows()),
+      m_offset(weights.offset(), weights.offset() + weights.rows() + 1),
+      m_index(weights.index(), weights.index() + weights.entries()),
+      m_weight(weights.weight(), weights.weight() + weights.entries()) {
+#if METBUILD_OFFLOAD_ENABLED
+  const size_t *offset = m_offset.data();
+  const auto *index = m_index.data();
+  const auto *weight = m_weight.data();
+  const size_t n_offset = m_offset.size();
+  const size_t n_entries = m_index.size();
+  METBUILD_OMP(target enter data map(to : offset[0 : n_offset],
+                                     index[0 : n_entries],
+                                     weight[0 : n_entries]))
+#endif
+}
+
+DeviceWeights::~DeviceWeights() {
+#if METBUILD_OFFLOAD_ENABLED
+  const size_t *offset = m_offset.data();
+  const auto *index = m_index.data();
+  const auto *weight = m_weight.data();
+  const size_t n_offset = m_offset.size();
+  const size_t n_entries = m_index.size();
+  METBUILD_OMP(target exit data map(delete : offset[0 : n_offset],
+                                    index[0 : n_entries],
+                                    weight[0 : n_entries]))
+#endif
+}
+
+/**
+ * @brief Whether the library was built with device offload
+ */
+bool DeviceWeights::offload_enabled() { return METBUILD_OFFLOAD_ENABLED; }
+
+/**
+ * @brief Uploads a snapshot of a field and interpolates it on the device
+ * @param weights device resident weights
+ * @param field source values and scaling
+ * @param n_source number of source values
+ */
+DeviceField::DeviceField(const DeviceWeights &weights,
+                         const Kernel::SourceField &field,
+                         [[maybe_unused]] size_t n_source)
+    : m_values(weights.rows()), m_valid(weights.rows()) {
+  const size_t n = weights.rows();
+  const size_t *offset = weights.m_offset.data();
+  const auto *index = weights.m_index.data();
+  const auto *weight = weights.m_weight.data();
+  const SourceDataType *source = field.values;
+  const auto scale = static_cast<SourceDataType>(field.scale);
+  auto *values = m_values.data();
+  auto *valid = m_valid.data();
+
+  METBUILD_OMP(target enter data map(alloc : values[0 : n], valid[0 : n]))
+  METBUILD_OMP(target teams distribute parallel for map(
+      to : source[0 : n_source]))
+  for (size_t r = 0; r < n; ++r) {
+    SourceDataType sum = 0;
+    for (size_t e = offset[r]; e < offset[r + 1]; ++e) {
+      sum += weight[e] * source[index[e]];
+    }
+    values[r] = static_cast<MeteorologicalDataType>(sum * scale);
+    valid[r] = offset[r + 1] > offset[r] ? 1 : 0;
+  }
+}
+
+DeviceField::~DeviceField() {
+#if METBUILD_OFFLOAD_ENABLED
+  const size_t n = m_values.size();
+  auto *values = m_values.data();
+  auto *valid = m_valid.data();
+  METBUILD_OMP(target exit data map(delete : values[0 : n], valid[0 : n]))
+#endif
+}
+
+/**
+ * @brief Blends two interpolated snapshots on the device and copies the
+ * result back
+ * @param a first snapshot
+ * @param b second snapshot, on the same output grid
+ * @param time_weight weight of the second snapshot
+ * @param fill value used for cells without a valid weight in either
+ * snapshot
+ * @param out output values, one per cell
+ */
+void DeviceField::blend(const DeviceField &a, const DeviceField &b,
+                        double time_weight, MeteorologicalDataType fill,
+                        MeteorologicalDataType *out) {
+  if (a.size() != b.size()) {
+    metbuild_throw_exception(
+        "Device fields must be on the same output grid to be blended");
+  }
+  const size_t n = a.size();
+  const auto *va = a.m_values.data();
+  const auto *vb = b.m_values.data();
+  const auto *ka = a.m_valid.data();
+  const auto *kb = b.m_valid.data();
+  const auto tw2 = static_cast<MeteorologicalDataType>(time_weight);
+  const auto tw1 = static_cast<MeteorologicalDataType>(1.0 - time_weight);
+
+  METBUILD_OMP(target teams distribute parallel for map(from : out[0 : n]))
+  for (size_t r = 0; r < n; ++r) {
+    out[r] = ka[r] && kb[r] ? tw1 * va[r] + tw2 * vb[r] : fill;
+  }
+}
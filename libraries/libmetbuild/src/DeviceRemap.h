@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_DEVICEREMAP_H_
+#define METBUILD_SRC_DEVICEREMAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeteorologicalData.h"
+#include "SparseWeights.h"
+
+namespace MetBuild {
+
+namespace Kernel {
+struct SourceField;
+}
+
+/**
+ * @brief Sparse weights kept resident on an offload device
+ *
+ * With the METBUILD_ENABLE_OFFLOAD build option the weight matrix is mapped
+ * to the default OpenMP target device once, and snapshots interpolated with
+ * it stay on the device until they are blended. Without the option, or when
+ * no device is present, the same code runs on the host
+ */
+class DeviceWeights {
+ public:
+  explicit DeviceWeights(const SparseWeights &weights);
+
+  ~DeviceWeights();
+
+  DeviceWeights(const DeviceWeights &) = delete;
+  DeviceWeights &operator=(const DeviceWeights &) = delete;
+
+  [[nodiscard]] size_t rows() const { return m_rows; }
+
+  static bool offload_enabled();
+
+ private:
+  friend class DeviceField;
+
+  size_t m_rows;
+  std::vector<size_t> m_offset;
+  std::vector<SparseWeights::index_type> m_index;
+  std::vector<SparseWeights::weight_type> m_weight;
+};
+
+/**
+ * @brief A source field interpolated onto the output grid, resident on the
+ * offload device
+ *
+ * The source values are uploaded once while the field is interpolated. Every
+ * output step between two snapshots is then blended on the device and only
+ * the blended result is copied back
+ */
+class DeviceField {
+ public:
+  DeviceField(const DeviceWeights &weights, const Kernel::SourceField &field,
+              size_t n_source);
+
+  ~DeviceField();
+
+  DeviceField(const DeviceField &) = delete;
+  DeviceField &operator=(const DeviceField &) = delete;
+
+  [[nodiscard]] size_t size() const { return m_values.size(); }
+
+  static void blend(const DeviceField &a, const DeviceField &b,
+                    double time_weight, MeteorologicalDataType fill,
+                    MeteorologicalDataType *out);
+
+ private:
+  std::vector<MeteorologicalDataType> m_values;
+  std::vector<uint8_t> m_valid;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_DEVICEREMAP_H_
@@ -0,0 +1,216 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "EnsembleReduction.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "Logging.h"
+#include "ThreadPool.h"
+
+using namespace MetBuild;
+
+namespace {
+//...Rows handed to a thread at once when folding in a member
+constexpr size_t c_row_grain = 16;
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param ni number of columns of the output grid
+ * @param nj number of rows of the output grid
+ * @param parameters parameters of each member, three for wind and pressure
+ * or one for a scalar
+ * @param thresholds values the exceedance probabilities are counted above,
+ * in the units of the output, m/s for wind
+ */
+EnsembleReduction::EnsembleReduction(const size_t ni, const size_t nj,
+                                     const unsigned parameters,
+                                     std::vector<double> thresholds)
+    : m_ni(ni),
+      m_nj(nj),
+      m_parameters(parameters),
+      m_thresholds(std::move(thresholds)),
+      m_members(0),
+      m_count(ni * nj, 0),
+      m_mean(parameters * ni * nj, 0.0),
+      m_m2(parameters * ni * nj, 0.0),
+      m_exceed(m_thresholds.size() * ni * nj, 0) {
+  if (parameters != 1 && parameters != 3) {
+    metbuild_throw_exception("Ensemble members have one or three parameters");
+  }
+}
+
+/**
+ * @brief Clears the members folded in so far, for the next output time
+ */
+void EnsembleReduction::reset() {
+  m_members = 0;
+  std::fill(m_count.begin(), m_count.end(), 0);
+  std::fill(m_mean.begin(), m_mean.end(), 0.0);
+  std::fill(m_m2.begin(), m_m2.end(), 0.0);
+  std::fill(m_exceed.begin(), m_exceed.end(), 0);
+}
+
+/**
+ * @brief Folds in a wind and pressure member
+ * @param member wind components and pressure of the member
+ */
+void EnsembleReduction::add(
+    const MeteorologicalData<3, MeteorologicalDataType> &member) {
+  if (m_parameters != 3 || member.ni() != m_ni || member.nj() != m_nj) {
+    metbuild_throw_exception("The member does not match the ensemble");
+  }
+  this->accumulate({member.parameter(0).data(), member.parameter(1).data(),
+                    member.parameter(2).data()});
+}
+
+/**
+ * @brief Folds in a scalar member
+ * @param member values of the member
+ */
+void EnsembleReduction::add(
+    const MeteorologicalData<1, MeteorologicalDataType> &member) {
+  if (m_parameters != 1 || member.ni() != m_ni || member.nj() != m_nj) {
+    metbuild_throw_exception("The member does not match the ensemble");
+  }
+  this->accumulate({member.parameter(0).data()});
+}
+
+void EnsembleReduction::accumulate(
+    const std::vector<const MeteorologicalDataType *> &planes) {
+  constexpr auto flag = MeteorologicalData<1>::flag_value();
+  const size_t n = m_ni * m_nj;
+  ThreadPool::global().parallel_for(
+      0, m_nj,
+      [&](const size_t j) {
+        for (size_t c = j * m_ni; c < (j + 1) * m_ni; ++c) {
+          bool valid = true;
+          for (unsigned p = 0; p < m_parameters; ++p) {
+            valid = valid && planes[p][c] != flag;
+          }
+          if (!valid) continue;
+
+          const double count = ++m_count[c];
+          for (unsigned p = 0; p < m_parameters; ++p) {
+            const double x = planes[p][c];
+            double &mean = m_mean[p * n + c];
+            const double delta = x - mean;
+            mean += delta / count;
+            m_m2[p * n + c] += delta * (x - mean);
+          }
+
+          const double value =
+              m_parameters == 3 ? std::hypot(static_cast<double>(planes[0][c]),
+                                             static_cast<double>(planes[1][c]))
+                                : static_cast<double>(planes[0][c]);
+          for (size_t t = 0; t < m_thresholds.size(); ++t) {
+            if (value > m_thresholds[t]) ++m_exceed[t * n + c];
+          }
+        }
+      },
+      c_row_grain);
+  m_members++;
+}
+
+void EnsembleReduction::check_output(
+    const Span<MeteorologicalDataType> out) const {
+  if (out.size() != m_ni * m_nj) {
+    metbuild_throw_exception("The output does not match the ensemble grid");
+  }
+}
+
+/**
+ * @brief Ensemble mean of one parameter. Cells no member has a value for
+ * are set to the flag value
+ * @param parameter parameter of the members
+ * @param out values of the grid in row-major order
+ */
+void EnsembleReduction::mean(const unsigned parameter,
+                             const Span<MeteorologicalDataType> out) const {
+  this->check_output(out);
+  if (parameter >= m_parameters) {
+    metbuild_throw_exception("Invalid ensemble parameter");
+  }
+  const size_t n = m_ni * m_nj;
+  for (size_t c = 0; c < n; ++c) {
+    out[c] = m_count[c] == 0 ? MeteorologicalData<1>::flag_value()
+                             : static_cast<MeteorologicalDataType>(
+                                   m_mean[parameter * n + c]);
+  }
+}
+
+/**
+ * @brief Ensemble spread of one parameter, the sample standard deviation of
+ * the members. Cells no member has a value for are set to the flag value
+ * and cells with a single member to zero
+ * @param parameter parameter of the members
+ * @param out values of the grid in row-major order
+ */
+void EnsembleReduction::spread(const unsigned parameter,
+                               const Span<MeteorologicalDataType> out) const {
+  this->check_output(out);
+  if (parameter >= m_parameters) {
+    metbuild_throw_exception("Invalid ensemble parameter");
+  }
+  const size_t n = m_ni * m_nj;
+  for (size_t c = 0; c < n; ++c) {
+    if (m_count[c] == 0) {
+      out[c] = MeteorologicalData<1>::flag_value();
+    } else if (m_count[c] == 1) {
+      out[c] = 0;
+    } else {
+      out[c] = static_cast<MeteorologicalDataType>(
+          std::sqrt(m_m2[parameter * n + c] / (m_count[c] - 1)));
+    }
+  }
+}
+
+/**
+ * @brief Fraction of the members with a value above a threshold. Cells no
+ * member has a value for are set to the flag value
+ * @param threshold index of the threshold given to the constructor
+ * @param out values of the grid in row-major order
+ */
+void EnsembleReduction::exceedance(
+    const size_t threshold, const Span<MeteorologicalDataType> out) const {
+  this->check_output(out);
+  if (threshold >= m_thresholds.size()) {
+    metbuild_throw_exception("Invalid ensemble threshold");
+  }
+  const size_t n = m_ni * m_nj;
+  for (size_t c = 0; c < n; ++c) {
+    out[c] = m_count[c] == 0
+                 ? MeteorologicalData<1>::flag_value()
+                 : static_cast<MeteorologicalDataType>(
+                       static_cast<double>(m_exceed[threshold * n + c]) /
+                       m_count[c]);
+  }
+}
@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_ENSEMBLEREDUCTION_H_
+#define METBUILD_SRC_ENSEMBLEREDUCTION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "MetBuild_Global.h"
+#include "MeteorologicalData.h"
+#include "Span.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Reduces the members of an ensemble at one output time to their
+ * mean, spread and exceedance probabilities, one member at a time
+ *
+ * Each member is folded into a running mean and sum of squared deviations
+ * with Welford's update, and into a count of members above each threshold,
+ * so a step of the ensemble never holds more than one member. The exceedance
+ * is evaluated on the wind speed for wind and pressure members and on the
+ * value itself for scalar members. Cells where a member has no value, any of
+ * its parameters at the flag value, do not count that member
+ */
+class EnsembleReduction {
+ public:
+  enum STATISTIC { MEAN, SPREAD, EXCEEDANCE };
+
+  METBUILD_EXPORT EnsembleReduction(size_t ni, size_t nj, unsigned parameters,
+                                    std::vector<double> thresholds = {});
+
+  void METBUILD_EXPORT reset();
+
+  void METBUILD_EXPORT
+  add(const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+          &member);
+
+  void METBUILD_EXPORT
+  add(const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+          &member);
+
+  NODISCARD size_t METBUILD_EXPORT members() const { return m_members; }
+
+  NODISCARD unsigned METBUILD_EXPORT parameters() const {
+    return m_parameters;
+  }
+
+  NODISCARD const std::vector<double> METBUILD_EXPORT &thresholds() const {
+    return m_thresholds;
+  }
+
+  void METBUILD_EXPORT mean(unsigned parameter,
+                            MetBuild::Span<MeteorologicalDataType> out) const;
+
+  void METBUILD_EXPORT spread(unsigned parameter,
+                              MetBuild::Span<MeteorologicalDataType> out) const;
+
+  void METBUILD_EXPORT
+  exceedance(size_t threshold,
+             MetBuild::Span<MeteorologicalDataType> out) const;
+
+ private:
+  void accumulate(const std::vector<const MeteorologicalDataType *> &planes);
+
+  void check_output(MetBuild::Span<MeteorologicalDataType> out) const;
+
+  const size_t m_ni;
+  const size_t m_nj;
+  const unsigned m_parameters;
+  const std::vector<double> m_thresholds;
+  size_t m_members;
+  std::vector<uint32_t> m_count;
+  std::vector<double> m_mean;
+  std::vector<double> m_m2;
+  std::vector<uint32_t> m_exceed;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_ENSEMBLEREDUCTION_H_
@@ -0,0 +1,265 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "ExecutionPlan.h"
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+
+#include "DeviceRemap.h"
+#include "Instrumentation.h"
+#include "Logging.h"
+#include "ResourceLimits.h"
+#include "WarmCache.h"
+#include "fmt/core.h"
+
+using namespace MetBuild;
+
+namespace {
+//...Share of the cpu time above which decoding gets a deeper ring, and
+// writing a deeper output queue
+constexpr double c_decode_bound = 0.5;
+constexpr double c_output_bound = 0.3;
+
+//...Records queued per domain when the output is the bottleneck
+constexpr size_t c_deep_output_queue = 4;
+
+double stage_sum(const RequestEstimate &estimate,
+                 const std::initializer_list<Instrumentation::STAGE> stages) {
+  double seconds = 0.0;
+  for (const auto s : stages) seconds += estimate.stage_seconds(s);
+  return seconds;
+}
+}  // namespace
+
+/**
+ * @brief Plans a request with the processors and memory limit of the
+ * process, on a single worker
+ * @param estimate estimate of the request, with its domains added
+ * @param policy settings the plan starts from
+ */
+ExecutionPlan::ExecutionPlan(const RequestEstimate &estimate,
+                             const ExecutionPolicy &policy)
+    : m_estimate(estimate),
+      m_base(policy),
+      m_policy(policy),
+      m_processors(ResourceLimits::processors()),
+      m_memory_limit(ResourceLimits::memoryLimit()),
+      m_workers(1),
+      m_shard_seconds(0.0),
+      m_mode(IN_MEMORY),
+      m_available(0),
+      m_band_rows(0),
+      m_shards(1),
+      m_peak_memory(0),
+      m_cpu_seconds(0.0),
+      m_decode_share(0.0),
+      m_kernel_share(0.0),
+      m_output_share(0.0) {
+  this->plan();
+}
+
+/**
+ * @brief Sets the number of processors the request may use
+ * @param count processors
+ */
+void ExecutionPlan::set_processors(const size_t count) {
+  if (count == 0) {
+    metbuild_throw_exception("The processor count must be positive");
+  }
+  m_processors = count;
+  this->plan();
+}
+
+/**
+ * @brief Sets the memory the request may use
+ * @param bytes memory limit, 0 for none
+ */
+void ExecutionPlan::set_memory_limit(const size_t bytes) {
+  m_memory_limit = bytes;
+  this->plan();
+}
+
+/**
+ * @brief Sets the number of workers the shards of the request can run on
+ * @param count workers, 1 to never shard
+ */
+void ExecutionPlan::set_workers(const size_t count) {
+  m_workers = std::max<size_t>(count, 1);
+  this->plan();
+}
+
+/**
+ * @brief Sets the wall time above which the request is sharded
+ * @param seconds wall time of a shard, 0 to never shard
+ */
+void ExecutionPlan::set_shard_seconds(const double seconds) {
+  m_shard_seconds = std::max(seconds, 0.0);
+  this->plan();
+}
+
+void ExecutionPlan::plan() {
+  m_policy = m_base;
+  m_policy.set_threads(std::min(m_base.threads(), m_processors));
+
+  //...What the warm cache holds stays resident, up to half of the limit
+  m_available = 0;
+  if (m_memory_limit != 0) {
+    const auto held = std::min(WarmCache::size(), m_memory_limit / 2);
+    m_available = m_memory_limit - held;
+  }
+
+  m_estimate.set_memory_budget(0);
+  const auto in_memory = m_estimate.peak_memory();
+  size_t budget = m_base.memory_budget();
+  if (budget == 0 && m_available != 0 && in_memory > m_available) {
+    budget = m_available / 2;
+  }
+  m_mode = budget == 0 ? IN_MEMORY : BANDED;
+  m_policy.set_memory_budget(budget);
+  m_estimate.set_memory_budget(budget);
+  m_peak_memory = m_estimate.peak_memory();
+  m_band_rows = m_estimate.band_rows();
+
+  m_cpu_seconds = m_estimate.cpu_seconds();
+  if (m_cpu_seconds > 0.0) {
+    m_decode_share = stage_sum(m_estimate, {Instrumentation::FILE_OPEN,
+                                            Instrumentation::MESSAGE_INDEX,
+                                            Instrumentation::DECODE}) /
+                     m_cpu_seconds;
+    m_kernel_share = stage_sum(m_estimate, {Instrumentation::TRIANGULATE,
+                                            Instrumentation::LOCATE,
+                                            Instrumentation::INTERPOLATE}) /
+                     m_cpu_seconds;
+    m_output_share = stage_sum(m_estimate, {Instrumentation::FORMAT,
+                                            Instrumentation::COMPRESS,
+                                            Instrumentation::NETCDF_WRITE}) /
+                     m_cpu_seconds;
+  } else {
+    m_decode_share = m_kernel_share = m_output_share = 0.0;
+  }
+
+  //...Banded requests hold the fewest snapshots. Otherwise a request bound
+  // by decoding reads one more file ahead
+  if (m_mode == BANDED) {
+    m_policy.set_ring_depth(2);
+  } else if (m_decode_share > c_decode_bound) {
+    m_policy.set_ring_depth(m_base.ring_depth() + 1);
+  }
+  if (m_output_share > c_output_bound && m_base.output_queue_depth() != 0) {
+    m_policy.set_output_queue_depth(
+        std::max(m_base.output_queue_depth(), c_deep_output_queue));
+  }
+
+  m_shards = 1;
+  const auto wall = this->wall_seconds();
+  if (m_workers > 1 && m_shard_seconds > 0.0 && wall > m_shard_seconds) {
+    m_shards = std::min<size_t>(
+        {m_workers, static_cast<size_t>(std::ceil(wall / m_shard_seconds)),
+         m_estimate.records()});
+  }
+}
+
+ExecutionPlan::MODE ExecutionPlan::mode() const { return m_mode; }
+
+/**
+ * @brief Settings of the plan, for BuildRequest::set_execution_policy
+ */
+const ExecutionPolicy &ExecutionPlan::policy() const { return m_policy; }
+
+/**
+ * @brief Rows interpolated at once in the widest domain
+ */
+size_t ExecutionPlan::band_rows() const { return m_band_rows; }
+
+/**
+ * @brief Number of time shards the request is split into, 1 when it runs
+ * on one worker
+ */
+size_t ExecutionPlan::shards() const { return m_shards; }
+
+/**
+ * @brief Estimated peak memory in bytes under the planned budget
+ */
+size_t ExecutionPlan::peak_memory() const { return m_peak_memory; }
+
+/**
+ * @brief Estimated cpu time in seconds, summed over threads
+ */
+double ExecutionPlan::cpu_seconds() const { return m_cpu_seconds; }
+
+/**
+ * @brief Estimated wall time in seconds on the planned threads, before
+ * sharding
+ */
+double ExecutionPlan::wall_seconds() const {
+  return m_cpu_seconds / static_cast<double>(m_policy.threads());
+}
+
+/**
+ * @brief Share of the cpu time spent opening, indexing and decoding files
+ */
+double ExecutionPlan::decode_share() const { return m_decode_share; }
+
+/**
+ * @brief Share of the cpu time spent locating and interpolating
+ */
+double ExecutionPlan::kernel_share() const { return m_kernel_share; }
+
+/**
+ * @brief Share of the cpu time spent formatting, compressing and writing
+ */
+double ExecutionPlan::output_share() const { return m_output_share; }
+
+/**
+ * @brief Whether interpolation runs on an offload device
+ */
+bool ExecutionPlan::offload() const { return DeviceWeights::offload_enabled(); }
+
+/**
+ * @brief One line summary of the plan and the estimates behind it, for the
+ * log
+ */
+std::string ExecutionPlan::describe() const {
+  const auto mib = [](size_t bytes) {
+    return bytes == 0 ? std::string("none")
+                      : fmt::format("{:.0f} MiB", bytes / 1048576.0);
+  };
+  return fmt::format(
+      "{} ({} rows), {} threads, ring depth {}, output queue {}, memory "
+      "budget {}, peak {} of {} available, cpu {:.1f} s (decode {:.0f}%, "
+      "kernels {:.0f}%, output {:.0f}%), wall {:.1f} s, {} shard{}, offload "
+      "{}",
+      m_mode == IN_MEMORY ? "in memory" : "banded", m_band_rows,
+      m_policy.threads(), m_policy.ring_depth(), m_policy.output_queue_depth(),
+      mib(m_policy.memory_budget()), mib(m_peak_memory), mib(m_available),
+      m_cpu_seconds, 100.0 * m_decode_share, 100.0 * m_kernel_share,
+      100.0 * m_output_share, this->wall_seconds(), m_shards,
+      m_shards == 1 ? "" : "s", this->offload() ? "on" : "off");
+}
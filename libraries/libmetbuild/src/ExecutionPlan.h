@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_EXECUTIONPLAN_H_
+#define METBUILD_SRC_EXECUTIONPLAN_H_
+
+#include <cstddef>
+#include <string>
+
+#include "CppAttributes.h"
+#include "ExecutionPolicy.h"
+#include "MetBuild_Global.h"
+#include "RequestEstimate.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Chooses how a request is run from its estimate and the resources
+ * of the process, so that deployments do not pick the modes by hand
+ *
+ * The request is interpolated in memory when its estimated peak fits in the
+ * memory limit of the cgroup, less what the warm cache holds, and in bands
+ * of rows under half of that memory otherwise. The ring depth and output
+ * queue follow the share of the cpu time spent decoding and writing. When
+ * several workers are available and the estimated wall time exceeds the
+ * shard time, the request is split into time shards, see
+ * BuildRequest::shard_start, one per worker at most
+ *
+ * The chosen settings are held in a copy of the policy the plan starts
+ * from, to be given to BuildRequest::set_execution_policy. Stages share the
+ * thread pool, so the split of the cpu time between decoding, the kernels
+ * and the output is reported rather than applied
+ */
+class ExecutionPlan {
+ public:
+  enum MODE { IN_MEMORY, BANDED };
+
+  METBUILD_EXPORT explicit ExecutionPlan(
+      const MetBuild::RequestEstimate &estimate,
+      const MetBuild::ExecutionPolicy &policy = MetBuild::ExecutionPolicy());
+
+  void METBUILD_EXPORT set_processors(size_t count);
+
+  void METBUILD_EXPORT set_memory_limit(size_t bytes);
+
+  void METBUILD_EXPORT set_workers(size_t count);
+
+  void METBUILD_EXPORT set_shard_seconds(double seconds);
+
+  NODISCARD MODE METBUILD_EXPORT mode() const;
+
+  NODISCARD const MetBuild::ExecutionPolicy METBUILD_EXPORT &policy() const;
+
+  NODISCARD size_t METBUILD_EXPORT band_rows() const;
+
+  NODISCARD size_t METBUILD_EXPORT shards() const;
+
+  NODISCARD size_t METBUILD_EXPORT peak_memory() const;
+
+  NODISCARD double METBUILD_EXPORT cpu_seconds() const;
+
+  NODISCARD double METBUILD_EXPORT wall_seconds() const;
+
+  NODISCARD double METBUILD_EXPORT decode_share() const;
+
+  NODISCARD double METBUILD_EXPORT kernel_share() const;
+
+  NODISCARD double METBUILD_EXPORT output_share() const;
+
+  NODISCARD bool METBUILD_EXPORT offload() const;
+
+  NODISCARD std::string METBUILD_EXPORT describe() const;
+
+ private:
+  void plan();
+
+  MetBuild::RequestEstimate m_estimate;
+  const MetBuild::ExecutionPolicy m_base;
+  MetBuild::ExecutionPolicy m_policy;
+  size_t m_processors;
+  size_t m_memory_limit;
+  size_t m_workers;
+  double m_shard_seconds;
+
+  MODE m_mode;
+  size_t m_available;
+  size_t m_band_rows;
+  size_t m_shards;
+  size_t m_peak_memory;
+  double m_cpu_seconds;
+  double m_decode_share;
+  double m_kernel_share;
+  double m_output_share;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_EXECUTIONPLAN_H_
@@ -0,0 +1,196 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "ExecutionPolicy.h"
+
+#include <cstdlib>
+#include <exception>
+
+#include "InterpolationCache.h"
+#include "InterpolationKernel.h"
+#include "Logging.h"
+#include "SnapshotCache.h"
+#include "ThreadPool.h"
+#include "Triangulation.h"
+
+using namespace MetBuild;
+
+namespace {
+size_t environment_size(const char *name, const size_t fallback) {
+  const char *env = std::getenv(name);
+  if (env == nullptr) return fallback;
+  try {
+    return std::stoul(env);
+  } catch (const std::exception &) {
+    Logging::warning(std::string("Ignoring invalid value of ") + name);
+    return fallback;
+  }
+}
+
+//...Kernels built for single precision sources report themselves as
+// "avx2-float" but are selected as "avx2"
+std::string selected_instruction_set() {
+  const std::string name = Kernel::instruction_set();
+  return name.rfind("avx2", 0) == 0 ? "avx2" : name;
+}
+}  // namespace
+
+/**
+ * @brief Policy holding the settings in effect
+ */
+ExecutionPolicy::ExecutionPolicy()
+    : m_threads(ThreadPool::defaultThreadCount()),
+      m_memory_budget(0),
+      m_instruction_set(selected_instruction_set()),
+      m_weight_cache(InterpolationCache::directory()),
+      m_snapshot_cache(SnapshotCache::directory()),
+      m_fast_locators(Triangulation::useFastLocators()),
+      m_ring_depth(environment_size("METBUILD_RING_DEPTH", 3)),
+      m_output_queue_depth(environment_size("METBUILD_OUTPUT_QUEUE_DEPTH", 2)) {
+}
+
+/**
+ * @brief Installs the settings shared by the whole process
+ */
+void ExecutionPolicy::apply() const {
+  ThreadPool::setDefaultThreadCount(m_threads);
+  if (!Kernel::set_instruction_set(m_instruction_set)) {
+    metbuild_throw_exception("The instruction set '" + m_instruction_set +
+                             "' is not supported");
+  }
+  InterpolationCache::setDirectory(m_weight_cache);
+  SnapshotCache::setDirectory(m_snapshot_cache);
+  Triangulation::setUseFastLocators(m_fast_locators);
+}
+
+/**
+ * @brief Size of the thread pool
+ */
+size_t ExecutionPolicy::threads() const { return m_threads; }
+
+void ExecutionPolicy::set_threads(const size_t value) {
+  if (value == 0) {
+    metbuild_throw_exception("The thread count must be positive");
+  }
+  m_threads = value;
+}
+
+/**
+ * @brief Memory budget of a BuildRequest, zero to size it from the memory
+ * limit of the process
+ */
+size_t ExecutionPolicy::memory_budget() const { return m_memory_budget; }
+
+void ExecutionPolicy::set_memory_budget(const size_t bytes) {
+  m_memory_budget = bytes;
+}
+
+/**
+ * @brief Interpolation kernels, "generic" or "avx2"
+ */
+std::string ExecutionPolicy::instruction_set() const {
+  return m_instruction_set;
+}
+
+void ExecutionPolicy::set_instruction_set(const std::string &name) {
+  if (name != "generic" && name != "avx2") {
+    metbuild_throw_exception("Unknown instruction set '" + name + "'");
+  }
+  m_instruction_set = name;
+}
+
+/**
+ * @brief Directory of the weight cache, empty when disabled
+ */
+std::string ExecutionPolicy::weight_cache() const { return m_weight_cache; }
+
+void ExecutionPolicy::set_weight_cache(const std::string &directory) {
+  m_weight_cache = directory;
+}
+
+/**
+ * @brief Directory of the snapshot cache, empty when disabled
+ */
+std::string ExecutionPolicy::snapshot_cache() const {
+  return m_snapshot_cache;
+}
+
+void ExecutionPolicy::set_snapshot_cache(const std::string &directory) {
+  m_snapshot_cache = directory;
+}
+
+/**
+ * @brief Whether structured and curvilinear sources are located without a
+ * triangulation
+ */
+bool ExecutionPolicy::fast_locators() const { return m_fast_locators; }
+
+void ExecutionPolicy::set_fast_locators(const bool value) {
+  m_fast_locators = value;
+}
+
+/**
+ * @brief Source files held by a Meteorology, see Meteorology::set_ring_depth
+ */
+size_t ExecutionPolicy::ring_depth() const { return m_ring_depth; }
+
+void ExecutionPolicy::set_ring_depth(const size_t depth) {
+  if (depth < 2) {
+    metbuild_throw_exception("The ring depth must be at least 2");
+  }
+  m_ring_depth = depth;
+}
+
+/**
+ * @brief Records queued per domain of an asynchronous OutputFile, zero to
+ * write in the calling thread
+ */
+size_t ExecutionPolicy::output_queue_depth() const {
+  return m_output_queue_depth;
+}
+
+void ExecutionPolicy::set_output_queue_depth(const size_t depth) {
+  m_output_queue_depth = depth;
+}
+
+/**
+ * @brief One line summary of the policy for logging
+ */
+std::string ExecutionPolicy::describe() const {
+  return "threads " + std::to_string(m_threads) + ", kernels " +
+         m_instruction_set + ", " + std::to_string(8 * value_bytes()) +
+         " bit values, ring depth " + std::to_string(m_ring_depth) +
+         ", output queue " + std::to_string(m_output_queue_depth) +
+         ", memory budget " +
+         (m_memory_budget == 0 ? std::string("automatic")
+                               : std::to_string(m_memory_budget)) +
+         ", weight cache " +
+         (m_weight_cache.empty() ? std::string("off") : m_weight_cache) +
+         ", snapshot cache " +
+         (m_snapshot_cache.empty() ? std::string("off") : m_snapshot_cache);
+}
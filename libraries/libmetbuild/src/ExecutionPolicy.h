@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_EXECUTIONPOLICY_H_
+#define METBUILD_SRC_EXECUTIONPOLICY_H_
+
+#include <cstddef>
+#include <string>
+
+#include "CppAttributes.h"
+#include "MetBuild_Global.h"
+#include "MeteorologicalData.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Performance settings of a deployment, gathered in one object
+ *
+ * A default constructed policy holds the settings in effect, which come from
+ * the environment unless they have been changed
+ *   threads             METBUILD_NUM_THREADS
+ *   instruction_set     METBUILD_KERNEL_ISA
+ *   weight_cache        METBUILD_WEIGHT_CACHE
+ *   snapshot_cache      METBUILD_SNAPSHOT_CACHE
+ *   fast_locators       METBUILD_FAST_LOCATORS
+ *   ring_depth          METBUILD_RING_DEPTH
+ *   output_queue_depth  METBUILD_OUTPUT_QUEUE_DEPTH
+ *   memory_budget       METBUILD_MEMORY_BUDGET, through BuildRequest
+ *
+ * The thread pool, kernels, caches and locators are shared by every object
+ * of the process, since weights built under one setting are reused by
+ * others through the weight cache. apply() installs them. The thread count
+ * only takes effect before the first build starts the pool. The remaining
+ * settings belong to the objects the policy is passed to, a Meteorology,
+ * OutputFile or BuildRequest. Precision is chosen when the library is built
+ * and only reported
+ */
+class ExecutionPolicy {
+ public:
+  METBUILD_EXPORT ExecutionPolicy();
+
+  void METBUILD_EXPORT apply() const;
+
+  NODISCARD size_t METBUILD_EXPORT threads() const;
+  void METBUILD_EXPORT set_threads(size_t value);
+
+  NODISCARD size_t METBUILD_EXPORT memory_budget() const;
+  void METBUILD_EXPORT set_memory_budget(size_t bytes);
+
+  NODISCARD std::string METBUILD_EXPORT instruction_set() const;
+  void METBUILD_EXPORT set_instruction_set(const std::string &name);
+
+  NODISCARD std::string METBUILD_EXPORT weight_cache() const;
+  void METBUILD_EXPORT set_weight_cache(const std::string &directory);
+
+  NODISCARD std::string METBUILD_EXPORT snapshot_cache() const;
+  void METBUILD_EXPORT set_snapshot_cache(const std::string &directory);
+
+  NODISCARD bool METBUILD_EXPORT fast_locators() const;
+  void METBUILD_EXPORT set_fast_locators(bool value);
+
+  NODISCARD size_t METBUILD_EXPORT ring_depth() const;
+  void METBUILD_EXPORT set_ring_depth(size_t depth);
+
+  NODISCARD size_t METBUILD_EXPORT output_queue_depth() const;
+  void METBUILD_EXPORT set_output_queue_depth(size_t depth);
+
+  /**
+   * @brief Bytes of each interpolated value, 4 for single precision builds
+   */
+  NODISCARD static constexpr size_t value_bytes() {
+    return sizeof(MetBuild::MeteorologicalDataType);
+  }
+
+  NODISCARD std::string METBUILD_EXPORT describe() const;
+
+ private:
+  size_t m_threads;
+  size_t m_memory_budget;
+  std::string m_instruction_set;
+  std::string m_weight_cache;
+  std::string m_snapshot_cache;
+  bool m_fast_locators;
+  size_t m_ring_depth;
+  size_t m_output_queue_depth;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_EXECUTIONPOLICY_H_
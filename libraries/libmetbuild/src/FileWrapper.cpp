@@ -28,11 +28,37 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "FileWrapper.h"
 
+#include "MappedFile.h"
+
 using namespace MetBuild;
 
 FileWrapper::FileWrapper(const std::string &filename, const char *mode)
-    : m_ptr(fopen(filename.c_str(), mode)) {}
+    : m_buffer(mode[0] == 'r' ? MappedFile::buffer(filename) : nullptr),
+      m_ptr(nullptr) {
+  if (!m_buffer) {
+    m_ptr = fopen(filename.c_str(), mode);
+    return;
+  }
+  if (m_buffer->size() == 0) {
+    m_ptr = std::tmpfile();
+    return;
+  }
+#ifdef _WIN32
+  //...No memory streams on Windows, so the buffer is copied to a temporary
+  // file which is deleted when closed
+  m_ptr = std::tmpfile();
+  if (m_ptr) {
+    std::fwrite(m_buffer->data(), 1, m_buffer->size(), m_ptr);
+    std::rewind(m_ptr);
+  }
+#else
+  m_ptr = fmemopen(const_cast<unsigned char *>(m_buffer->data()),
+                   m_buffer->size(), "r");
+#endif
+}
 
-FileWrapper::~FileWrapper() { fclose(m_ptr); }
+FileWrapper::~FileWrapper() {
+  if (m_ptr) fclose(m_ptr);
+}
 
 FILE *FileWrapper::ptr() { return m_ptr; }
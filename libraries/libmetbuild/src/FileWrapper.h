@@ -29,10 +29,18 @@
 #ifndef METGET_SRC_FILEWRAPPER_H_
 #define METGET_SRC_FILEWRAPPER_H_
 
+#include <cstdio>
+#include <memory>
 #include <string>
 
 namespace MetBuild {
 
+class MappedFile;
+
+/**
+ * @brief Owns a C file handle. Files registered in memory with
+ * MappedFile::add_buffer are opened as streams over the buffer when read
+ */
 class FileWrapper {
  public:
   FileWrapper(const std::string& filename, const char* mode);
@@ -42,6 +50,7 @@ class FileWrapper {
   FILE* ptr();
 
  private:
+  std::shared_ptr<const MappedFile> m_buffer;
   FILE* m_ptr;
 };
 
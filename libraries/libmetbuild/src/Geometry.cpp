@@ -0,0 +1,202 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "Geometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+using namespace MetBuild;
+
+/**
+ * @brief Constructor
+ * @param points polygon vertices in order, without repeating the first one
+ * at the end
+ */
+Geometry::Geometry(const std::vector<Point> &points)
+    : m_points(points),
+      m_xmin(std::numeric_limits<double>::max()),
+      m_xmax(std::numeric_limits<double>::lowest()),
+      m_ymin(std::numeric_limits<double>::max()),
+      m_ymax(std::numeric_limits<double>::lowest()),
+      m_parallelogram(false),
+      m_inverse{0.0, 0.0, 0.0, 0.0},
+      m_tolerance(0.0),
+      m_slab_height(0.0) {
+  if (m_points.size() > 1 && m_points.front().x() == m_points.back().x() &&
+      m_points.front().y() == m_points.back().y()) {
+    m_points.pop_back();
+  }
+  for (const auto &p : m_points) {
+    m_xmin = std::min(m_xmin, p.x());
+    m_xmax = std::max(m_xmax, p.x());
+    m_ymin = std::min(m_ymin, p.y());
+    m_ymax = std::max(m_ymax, p.y());
+  }
+  if (m_points.size() < 3) return;
+
+  for (size_t k = 0; k < m_points.size(); ++k) {
+    const auto &a = m_points[k];
+    const auto &b = m_points[(k + 1) % m_points.size()];
+    m_edges.push_back({a.x(), a.y(), b.x(), b.y()});
+  }
+
+  //...Slack for rounding in the vertices, relative to the polygon size
+  m_tolerance = 1e-9 * std::max({m_xmax - m_xmin, m_ymax - m_ymin, 1.0});
+
+  if (!this->detect_parallelogram()) this->build_index();
+}
+
+/**
+ * @brief Sets up the analytic test when the polygon is a parallelogram
+ * @return true when it is one
+ */
+bool Geometry::detect_parallelogram() {
+  if (m_points.size() != 4) return false;
+  const auto &p0 = m_points[0];
+  const auto &p1 = m_points[1];
+  const auto &p2 = m_points[2];
+  const auto &p3 = m_points[3];
+  if (std::abs(p0.x() + p2.x() - p1.x() - p3.x()) > m_tolerance ||
+      std::abs(p0.y() + p2.y() - p1.y() - p3.y()) > m_tolerance) {
+    return false;
+  }
+  const double ax = p1.x() - p0.x();
+  const double ay = p1.y() - p0.y();
+  const double bx = p3.x() - p0.x();
+  const double by = p3.y() - p0.y();
+  const double det = ax * by - ay * bx;
+  if (std::abs(det) <= m_tolerance * m_tolerance) return false;
+  m_origin = p0;
+  m_inverse = {by / det, -bx / det, -ay / det, ax / det};
+  m_parallelogram = true;
+  return true;
+}
+
+/**
+ * @brief Bins the edges into horizontal slabs, about one per edge up to the
+ * square root of the edge count
+ */
+void Geometry::build_index() {
+  const size_t nslab = std::max<size_t>(
+      1, static_cast<size_t>(std::sqrt(static_cast<double>(m_edges.size()))));
+  m_slab_height = (m_ymax - m_ymin) / static_cast<double>(nslab);
+  if (m_slab_height <= 0.0) m_slab_height = 1.0;
+
+  auto slab = [&](const double y) {
+    const auto s = static_cast<long>(std::floor((y - m_ymin) / m_slab_height));
+    return static_cast<size_t>(
+        std::clamp<long>(s, 0, static_cast<long>(nslab) - 1));
+  };
+
+  std::vector<size_t> count(nslab + 1, 0);
+  for (const auto &e : m_edges) {
+    const auto lo = slab(std::min(e.y0, e.y1) - m_tolerance);
+    const auto hi = slab(std::max(e.y0, e.y1) + m_tolerance);
+    for (size_t s = lo; s <= hi; ++s) count[s + 1]++;
+  }
+  for (size_t s = 0; s < nslab; ++s) count[s + 1] += count[s];
+  m_slab_offset = count;
+
+  m_slab_edges.resize(m_slab_offset.back());
+  for (size_t k = 0; k < m_edges.size(); ++k) {
+    const auto &e = m_edges[k];
+    const auto lo = slab(std::min(e.y0, e.y1) - m_tolerance);
+    const auto hi = slab(std::max(e.y0, e.y1) + m_tolerance);
+    for (size_t s = lo; s <= hi; ++s) m_slab_edges[count[s]++] = k;
+  }
+}
+
+bool Geometry::is_inside(const Point &p) const {
+  if (m_points.size() < 3) return false;
+  if (p.x() < m_xmin - m_tolerance || p.x() > m_xmax + m_tolerance ||
+      p.y() < m_ymin - m_tolerance || p.y() > m_ymax + m_tolerance) {
+    return false;
+  }
+  return m_parallelogram ? this->inside_parallelogram(p)
+                         : this->inside_polygon(p);
+}
+
+bool Geometry::is_parallelogram() const { return m_parallelogram; }
+
+bool Geometry::inside_parallelogram(const Point &p) const {
+  const double dx = p.x() - m_origin.x();
+  const double dy = p.y() - m_origin.y();
+  const double s = m_inverse[0] * dx + m_inverse[1] * dy;
+  const double t = m_inverse[2] * dx + m_inverse[3] * dy;
+  constexpr double eps = 1e-12;
+  return s >= -eps && s <= 1.0 + eps && t >= -eps && t <= 1.0 + eps;
+}
+
+/**
+ * @brief Crossing number test over the edges of the slab holding the point,
+ * with points on an edge counted as inside
+ */
+bool Geometry::inside_polygon(const Point &p) const {
+  const double x = p.x();
+  const double y = p.y();
+  const auto nslab = m_slab_offset.size() - 1;
+  const auto s = static_cast<size_t>(std::clamp<long>(
+      static_cast<long>(std::floor((y - m_ymin) / m_slab_height)), 0,
+      static_cast<long>(nslab) - 1));
+
+  bool inside = false;
+  for (size_t k = m_slab_offset[s]; k < m_slab_offset[s + 1]; ++k) {
+    const auto &e = m_edges[m_slab_edges[k]];
+
+    const double cross =
+        (e.x1 - e.x0) * (y - e.y0) - (e.y1 - e.y0) * (x - e.x0);
+    const double length = std::hypot(e.x1 - e.x0, e.y1 - e.y0);
+    if (std::abs(cross) <= m_tolerance * std::max(length, 1.0) &&
+        x >= std::min(e.x0, e.x1) - m_tolerance &&
+        x <= std::max(e.x0, e.x1) + m_tolerance &&
+        y >= std::min(e.y0, e.y1) - m_tolerance &&
+        y <= std::max(e.y0, e.y1) + m_tolerance) {
+      return true;
+    }
+
+    if ((e.y0 > y) != (e.y1 > y)) {
+      const double xc = e.x0 + (y - e.y0) * (e.x1 - e.x0) / (e.y1 - e.y0);
+      if (x < xc) inside = !inside;
+    }
+  }
+  return inside;
+}
+
+void Geometry::print() const {
+  std::cout << "POLYGON((";
+  for (const auto &p : m_points) {
+    std::cout << p.x() << " " << p.y() << ",";
+  }
+  if (!m_points.empty()) {
+    std::cout << m_points.front().x() << " " << m_points.front().y();
+  }
+  std::cout << "))" << std::endl;
+}
@@ -29,38 +29,69 @@
 #ifndef METGET_LIBRARY_GEOMETRY_H_
 #define METGET_LIBRARY_GEOMETRY_H_
 
-#include <iostream>
+#include <array>
+#include <cstddef>
+#include <vector>
 
+#include "CppAttributes.h"
 #include "Point.h"
-#include "boost/geometry.hpp"
 
 namespace MetBuild {
 
+/**
+ * @brief Closed polygon used for point inclusion tests. Points on the
+ * boundary count as inside
+ *
+ * Parallelograms, which covers every rotated or unrotated rectangle, are
+ * tested analytically. Other polygons keep their edges binned into
+ * horizontal slabs so a test only visits the edges crossing the slab of the
+ * point
+ */
 class Geometry {
  public:
   template <size_t s>
-  explicit Geometry(const std::array<Point, s> &points) {
-    for (const auto &p : points) {
-      boost::geometry::append(m_polygon, geom_point_t(p.x(), p.y()));
-    }
-    boost::geometry::append(m_polygon,
-                            geom_point_t(points[0].x(), points[0].y()));
-    boost::geometry::correct(m_polygon);
-  }
+  explicit Geometry(const std::array<Point, s> &points)
+      : Geometry(std::vector<Point>(points.begin(), points.end())) {}
 
-  [[nodiscard]] bool is_inside(const Point &p) const {
-    return boost::geometry::covered_by(geom_point_t(p.x(), p.y()), m_polygon);
-  }
+  explicit Geometry(const std::vector<Point> &points);
 
-  void print() { std::cout << boost::geometry::wkt(m_polygon) << std::endl; }
+  NODISCARD bool is_inside(const Point &p) const;
+
+  NODISCARD bool is_parallelogram() const;
+
+  void print() const;
 
  private:
-  typedef boost::geometry::model::point<double, 2,
-                                        boost::geometry::cs::cartesian>
-      geom_point_t;
-  typedef boost::geometry::model::polygon<geom_point_t> geom_polygon_t;
+  struct Edge {
+    double x0;
+    double y0;
+    double x1;
+    double y1;
+  };
+
+  bool detect_parallelogram();
+  void build_index();
+
+  NODISCARD bool inside_parallelogram(const Point &p) const;
+  NODISCARD bool inside_polygon(const Point &p) const;
+
+  std::vector<Point> m_points;
+  std::vector<Edge> m_edges;
+  double m_xmin;
+  double m_xmax;
+  double m_ymin;
+  double m_ymax;
+
+  //...Parallelogram as origin + s * a + t * b with s, t in [0, 1]
+  bool m_parallelogram;
+  Point m_origin;
+  std::array<double, 4> m_inverse;
+  double m_tolerance;
 
-  geom_polygon_t m_polygon;
+  //...Edges of each slab, stored contiguously
+  double m_slab_height;
+  std::vector<size_t> m_slab_offset;
+  std::vector<size_t> m_slab_edges;
 };
 
 }  // namespace MetBuild
@@ -28,19 +28,85 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "GribHandle.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+#include "Instrumentation.h"
 #include "Utilities.h"
 #include "eccodes.h"
 
 using namespace MetBuild;
 
+namespace {
+bool memoryMapDefault() {
+  const char *env = std::getenv("METBUILD_GRIB_MMAP");
+  return env != nullptr && std::strcmp(env, "0") != 0;
+}
+std::atomic<bool> s_use_memory_map(memoryMapDefault());
+}  // namespace
+
+GribHandle::GribHandle(const std::string &filename,
+                       const std::string &parameter, bool quiet,
+                       codes_context *context)
+    : m_ptr(make_handle(filename, parameter, quiet,
+                        context ? context : GribHandle::context())) {}
+
 GribHandle::GribHandle(const std::string &filename,
-                       const std::string &parameter, bool quiet)
-    : m_ptr(make_handle(filename, parameter, quiet)) {}
+                       const GribIndex::Entry &entry, codes_context *context)
+    : m_mapping(s_use_memory_map ? MappedFile::get(filename)
+                                 : MappedFile::buffer(filename)),
+      m_ptr(m_mapping
+                ? make_handle(m_mapping.get(), entry,
+                              context ? context : GribHandle::context())
+                : make_handle(filename, entry,
+                              context ? context : GribHandle::context())) {}
+
+GribHandle::GribHandle(std::shared_ptr<const MappedFile> file,
+                       const GribIndex::Entry &entry, codes_context *context)
+    : m_mapping(std::move(file)),
+      m_ptr(make_handle(m_mapping.get(), entry,
+                        context ? context : GribHandle::context())) {}
+
+GribHandle::GribHandle(FILE *file, const GribIndex::Entry &entry,
+                       codes_context *context)
+    : m_ptr(make_handle(file, entry,
+                        context ? context : GribHandle::context())) {}
 
 GribHandle::~GribHandle() { close_handle(m_ptr); }
 
 codes_handle *GribHandle::ptr() { return m_ptr; }
 
+/**
+ * @brief Selects whether messages are decoded from a shared memory mapping
+ * of the file instead of buffered reads. The default is taken from the
+ * METBUILD_GRIB_MMAP environment variable
+ * @param value true to decode from memory mapped files
+ */
+void GribHandle::setUseMemoryMap(bool value) { s_use_memory_map = value; }
+
+bool GribHandle::useMemoryMap() { return s_use_memory_map; }
+
+/**
+ * @brief Context in which the library creates its eccodes handles
+ *
+ * This is the eccodes default context. ecCodes has no public way to make an
+ * independent context, so the library is built with eccodes thread support
+ * and the context locks its own shared state. Multi-field support is
+ * switched on once here rather than by every reader, so readers on other
+ * threads never see the setting change under them
+ */
+codes_context *GribHandle::context() {
+  static std::once_flag once;
+  std::call_once(once, []() {
+    codes_grib_multi_support_on(codes_context_get_default());
+  });
+  return codes_context_get_default();
+}
+
 void GribHandle::close_handle(grib_handle *ptr) {
   auto err = codes_handle_delete(ptr);
   if (err != GRIB_SUCCESS) {
@@ -50,28 +116,81 @@ void GribHandle::close_handle(grib_handle *ptr) {
 }
 
 grib_handle *GribHandle::make_handle(const std::string &filename,
-                                     const std::string &name, bool quiet) {
+                                     const std::string &name, bool quiet,
+                                     codes_context *context) {
+  //...A step reference selects the message of the variable at that step
+  const auto reference = GribIndex::splitReference(filename);
+  auto index = GribIndex::get(reference.first);
+  auto entry = index->find(name, reference.second);
+  if (entry) return make_handle(reference.first, *entry, context);
+  if (!quiet)
+    metbuild_throw_exception(
+        "Could not generate the eccodes handle for variable: '" + name + "'");
+  return nullptr;
+}
+
+grib_handle *GribHandle::make_handle(const std::string &filename,
+                                     const GribIndex::Entry &entry,
+                                     codes_context *context) {
+  const auto t0 = std::chrono::steady_clock::now();
   auto f = FileWrapper(filename, "r");
-  int ierr = 0;
+  Instrumentation::record(Instrumentation::FILE_OPEN,
+                          std::chrono::steady_clock::now() - t0);
+  if (!f.ptr()) {
+    metbuild_throw_exception("Could not open the grib file '" + filename +
+                             "'");
+  }
+  return make_handle(f.ptr(), entry, context);
+}
 
-  while (auto h = codes_handle_new_from_file(codes_context_get_default(),
-                                             f.ptr(), PRODUCT_GRIB, &ierr)) {
+grib_handle *GribHandle::make_handle(FILE *file,
+                                     const GribIndex::Entry &entry,
+                                     codes_context *context) {
+  Instrumentation::ScopedTimer timer(Instrumentation::FILE_OPEN, 1);
+  if (fseek(file, entry.offset, SEEK_SET) != 0) {
+    metbuild_throw_exception("Could not seek to the grib message for '" +
+                             entry.shortName + "'");
+  }
+
+  int ierr = 0;
+  grib_handle *h = nullptr;
+  for (size_t i = 0; i <= entry.field; ++i) {
+    if (h) close_handle(h);
+    h = codes_handle_new_from_file(context, file, PRODUCT_GRIB, &ierr);
+    if (!h) break;
     CODES_CHECK(ierr, nullptr);
-    std::string pname;
-    std::string p2name;
-    size_t plen = 0;
-    CODES_CHECK(codes_get_length(h, "shortName", &plen), nullptr);
-    pname.resize(plen, ' ');
-    CODES_CHECK(codes_get_string(h, "shortName", &pname[0], &plen), nullptr);
-    boost::trim_if(pname, Utilities::isNotAlpha);
-    if (pname == name) {
-      return h;
-    } else {
-      close_handle(h);
-    }
   }
-  if (!quiet)
+  codes_grib_multi_support_reset_file(context, file);
+
+  if (!h) {
     metbuild_throw_exception(
-        "Could not generate the eccodes handle for variable: '" + name + "'");
-  return nullptr;
-}
\ No newline at end of file
+        "Could not generate the eccodes handle for variable: '" +
+        entry.shortName + "'");
+  }
+  return h;
+}
+
+grib_handle *GribHandle::make_handle(const MappedFile *file,
+                                     const GribIndex::Entry &entry,
+                                     codes_context *context) {
+  //...Secondary fields of a multi-field message are unpacked by the
+  // file-based reader
+  if (entry.field != 0) return make_handle(file->filename(), entry, context);
+
+  Instrumentation::ScopedTimer timer(Instrumentation::FILE_OPEN, 1);
+
+  if (entry.offset < 0 ||
+      static_cast<size_t>(entry.offset) + entry.length > file->size()) {
+    metbuild_throw_exception("The indexed grib message for '" +
+                             entry.shortName +
+                             "' lies outside of the mapped file");
+  }
+  auto h = codes_handle_new_from_message(
+      context, file->data() + entry.offset, entry.length);
+  if (!h) {
+    metbuild_throw_exception(
+        "Could not generate the eccodes handle for variable: '" +
+        entry.shortName + "'");
+  }
+  return h;
+}
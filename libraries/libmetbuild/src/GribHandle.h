@@ -29,32 +29,76 @@
 #ifndef METBUILD_SRC_GRIBHANDLE_H_
 #define METBUILD_SRC_GRIBHANDLE_H_
 
+#include <memory>
 #include <string>
 
 #include "FileWrapper.h"
+#include "GribIndex.h"
 #include "Logging.h"
+#include "MappedFile.h"
 #include "boost/algorithm/string.hpp"
 
 struct grib_handle;
+struct grib_context;
 typedef struct grib_handle codes_handle;
+typedef struct grib_context codes_context;
 
 namespace MetBuild {
 
+/**
+ * @brief Owns an eccodes handle to one message of a grib file
+ *
+ * Handles are created in an explicit eccodes context, the shared context()
+ * unless one is given. Handles made from separate files or memory mapped
+ * messages share nothing else, so they can be created and decoded on
+ * several threads at once
+ */
 class GribHandle {
  public:
   GribHandle(const std::string &filename, const std::string &parameter,
-             bool quiet = false);
+             bool quiet = false, codes_context *context = nullptr);
+
+  GribHandle(const std::string &filename, const GribIndex::Entry &entry,
+             codes_context *context = nullptr);
+
+  GribHandle(FILE *file, const GribIndex::Entry &entry,
+             codes_context *context = nullptr);
+
+  GribHandle(std::shared_ptr<const MappedFile> file,
+             const GribIndex::Entry &entry, codes_context *context = nullptr);
 
   ~GribHandle();
 
+  GribHandle(const GribHandle &) = delete;
+  GribHandle &operator=(const GribHandle &) = delete;
+
   codes_handle *ptr();
 
+  static void setUseMemoryMap(bool value);
+
+  static bool useMemoryMap();
+
+  static codes_context *context();
+
  private:
   static void close_handle(grib_handle *ptr);
 
   static grib_handle *make_handle(const std::string &filename,
-                                  const std::string &name, bool quiet);
+                                  const std::string &name, bool quiet,
+                                  codes_context *context);
+
+  static grib_handle *make_handle(const std::string &filename,
+                                  const GribIndex::Entry &entry,
+                                  codes_context *context);
+
+  static grib_handle *make_handle(FILE *file, const GribIndex::Entry &entry,
+                                  codes_context *context);
+
+  static grib_handle *make_handle(const MappedFile *file,
+                                  const GribIndex::Entry &entry,
+                                  codes_context *context);
 
+  std::shared_ptr<const MappedFile> m_mapping;
   codes_handle *m_ptr;
 };
 }  // namespace MetBuild
@@ -0,0 +1,423 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "GribIndex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "FileWrapper.h"
+#include "GribHandle.h"
+#include "Instrumentation.h"
+#include "Logging.h"
+#include "MappedFile.h"
+#include "Utilities.h"
+#include "boost/algorithm/string/trim.hpp"
+#include "boost/filesystem.hpp"
+#include "eccodes.h"
+
+using namespace MetBuild;
+
+namespace {
+constexpr char c_magic[4] = {'M', 'B', 'G', 'I'};
+constexpr uint32_t c_version = 1;
+
+struct IndexHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t file_size;
+  uint64_t n_entries;
+};
+
+struct EntryHeader {
+  int64_t level;
+  int64_t step;
+  int64_t offset;
+  uint64_t length;
+  uint64_t field;
+};
+
+/**
+ * @brief Sequential reader of an index file which fails, rather than reading
+ * past the end, on a truncated file
+ */
+class IndexReader {
+ public:
+  IndexReader(const unsigned char *data, size_t size)
+      : m_ptr(data), m_end(data + size) {}
+
+  template <typename T>
+  bool read(T &value) {
+    if (static_cast<size_t>(m_end - m_ptr) < sizeof(T)) return false;
+    std::memcpy(&value, m_ptr, sizeof(T));
+    m_ptr += sizeof(T);
+    return true;
+  }
+
+  bool read(std::string &value) {
+    uint32_t length = 0;
+    if (!this->read(length)) return false;
+    if (static_cast<size_t>(m_end - m_ptr) < length) return false;
+    value.assign(reinterpret_cast<const char *>(m_ptr), length);
+    m_ptr += length;
+    return true;
+  }
+
+  NODISCARD bool done() const { return m_ptr == m_end; }
+
+ private:
+  const unsigned char *m_ptr;
+  const unsigned char *m_end;
+};
+
+void writeString(std::ofstream &f, const std::string &value) {
+  const auto length = static_cast<uint32_t>(value.size());
+  f.write(reinterpret_cast<const char *>(&length), sizeof(length));
+  f.write(value.data(), length);
+}
+
+struct IndexCacheEntry {
+  std::string identity;
+  std::weak_ptr<const MappedFile> buffer;
+  std::shared_ptr<const GribIndex> index;
+};
+
+std::mutex s_index_mutex;
+std::unordered_map<std::string, IndexCacheEntry> s_index_cache;
+
+std::string readString(codes_handle *h, const char *key) {
+  size_t len = 0;
+  if (codes_get_length(h, key, &len) != GRIB_SUCCESS) return {};
+  std::string value(len, ' ');
+  if (codes_get_string(h, key, &value[0], &len) != GRIB_SUCCESS) return {};
+  boost::trim_if(value, Utilities::isNotAlpha);
+  boost::trim_if(value, boost::is_any_of(" "));
+  return value;
+}
+
+/**
+ * @brief End of the forecast step of a message in minutes, so that sub-hourly
+ * steps are told apart whatever unit the message is stored in
+ */
+long readStepMinutes(codes_handle *h) {
+  size_t len = 2;
+  if (codes_set_string(h, "stepUnits", "m", &len) != GRIB_SUCCESS) return -1;
+  long step = -1;
+  if (codes_get_long(h, "endStep", &step) != GRIB_SUCCESS) return -1;
+  return step;
+}
+}  // namespace
+
+GribIndex::GribIndex(std::string filename) : m_filename(std::move(filename)) {
+  this->build();
+}
+
+/**
+ * @brief Returns the index for a file, generating it on first use
+ *
+ * Indexes are cached for the life of the process and regenerated when the
+ * file is rewritten or replaced, as told by MappedFile::identity, or for
+ * files held in memory, when a different buffer is registered under the
+ * name
+ *
+ * @param filename grib file to index
+ * @return shared index object
+ */
+std::shared_ptr<const GribIndex> GribIndex::get(const std::string &filename) {
+  if (auto buffer = MappedFile::buffer(filename)) {
+    std::lock_guard<std::mutex> lock(s_index_mutex);
+    auto it = s_index_cache.find(filename);
+    if (it != s_index_cache.end() && it->second.buffer.lock() == buffer) {
+      return it->second.index;
+    }
+    auto index = std::make_shared<const GribIndex>(filename);
+    s_index_cache[filename] = {{}, buffer, index};
+    return index;
+  }
+
+  const auto identity = MappedFile::identity(filename);
+  if (identity.empty()) {
+    metbuild_throw_exception("The grib file '" + filename +
+                             "' does not exist");
+  }
+
+  std::lock_guard<std::mutex> lock(s_index_mutex);
+  auto it = s_index_cache.find(filename);
+  if (it != s_index_cache.end() && it->second.identity == identity) {
+    return it->second.index;
+  }
+  auto index = std::make_shared<const GribIndex>(filename);
+  s_index_cache[filename] = {identity, {}, index};
+  return index;
+}
+
+void GribIndex::clear() {
+  std::lock_guard<std::mutex> lock(s_index_mutex);
+  s_index_cache.clear();
+}
+
+const std::string &GribIndex::filename() const { return m_filename; }
+
+const std::vector<GribIndex::Entry> &GribIndex::entries() const {
+  return m_entries;
+}
+
+const GribIndex::Entry *GribIndex::find(const std::string &shortName) const {
+  for (const auto &e : m_entries) {
+    if (e.shortName == shortName) return &e;
+  }
+  return nullptr;
+}
+
+const GribIndex::Entry *GribIndex::find(const std::string &shortName,
+                                        const std::string &typeOfLevel,
+                                        long level) const {
+  for (const auto &e : m_entries) {
+    if (e.shortName == shortName && e.typeOfLevel == typeOfLevel &&
+        e.level == level) {
+      return &e;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Message of a variable at one forecast step
+ * @param shortName grib short name
+ * @param step end of the forecast step in minutes, or -1 for the first
+ * message of the variable
+ */
+const GribIndex::Entry *GribIndex::find(const std::string &shortName,
+                                        const long step) const {
+  if (step < 0) return this->find(shortName);
+  for (const auto &e : m_entries) {
+    if (e.shortName == shortName && e.step == step) return &e;
+  }
+  return nullptr;
+}
+
+bool GribIndex::contains(const std::string &shortName) const {
+  return this->find(shortName) != nullptr;
+}
+
+/**
+ * @brief Forecast steps a variable is found at, in minutes and in order
+ * @param shortName grib short name
+ * @return steps, a single one for files holding one step
+ */
+std::vector<long> GribIndex::steps(const std::string &shortName) const {
+  std::vector<long> steps;
+  for (const auto &e : m_entries) {
+    if (e.shortName == shortName && e.step >= 0) steps.push_back(e.step);
+  }
+  std::sort(steps.begin(), steps.end());
+  steps.erase(std::unique(steps.begin(), steps.end()), steps.end());
+  return steps;
+}
+
+/**
+ * @brief Name under which one forecast step of a file is read as a source
+ * @param filename grib file
+ * @param step end of the forecast step in minutes
+ * @return step reference
+ */
+std::string GribIndex::stepReference(const std::string &filename,
+                                     const long step) {
+  return filename + "#" + std::to_string(step);
+}
+
+/**
+ * @brief Splits a step reference into its file and step
+ * @param name step reference or plain file name
+ * @return file name, and the step in minutes or -1 for a plain file name
+ */
+std::pair<std::string, long> GribIndex::splitReference(
+    const std::string &name) {
+  const auto hash = name.rfind('#');
+  if (hash == std::string::npos || hash + 1 == name.size()) return {name, -1};
+  const bool digits =
+      std::all_of(name.begin() + hash + 1, name.end(),
+                  [](const char c) { return std::isdigit(c) != 0; });
+  if (!digits) return {name, -1};
+  return {name.substr(0, hash), std::stol(name.substr(hash + 1))};
+}
+
+/**
+ * @brief Name of the index file stored next to a grib file
+ * @param filename grib file
+ * @return index file name
+ */
+std::string GribIndex::indexFilename(const std::string &filename) {
+  return filename + ".mbi";
+}
+
+/**
+ * @brief Writes the index to a file, read back when the grib file is opened
+ * under the name given by indexFilename. The file is written under a
+ * temporary name and renamed so that concurrent readers never see a partial
+ * file
+ * @param filename index file
+ */
+void GribIndex::write(const std::string &filename) const {
+  const auto grib = MappedFile::get(m_filename);
+  const auto tmp = filename + "." + boost::filesystem::unique_path().string();
+  {
+    std::ofstream f(tmp, std::ios::binary);
+    if (!f.is_open()) {
+      metbuild_throw_exception("Could not write the grib index file '" +
+                               filename + "'");
+    }
+    IndexHeader header{};
+    std::memcpy(header.magic, c_magic, sizeof(c_magic));
+    header.version = c_version;
+    header.file_size = grib->size();
+    header.n_entries = m_entries.size();
+    f.write(reinterpret_cast<const char *>(&header), sizeof(IndexHeader));
+    for (const auto &e : m_entries) {
+      const EntryHeader eh{e.level, e.step, e.offset, e.length, e.field};
+      f.write(reinterpret_cast<const char *>(&eh), sizeof(EntryHeader));
+      writeString(f, e.shortName);
+      writeString(f, e.typeOfLevel);
+      writeString(f, e.stepRange);
+    }
+  }
+  boost::system::error_code ec;
+  boost::filesystem::rename(tmp, filename, ec);
+  if (ec) {
+    boost::filesystem::remove(tmp, ec);
+    metbuild_throw_exception("Could not write the grib index file '" +
+                             filename + "'");
+  }
+}
+
+/**
+ * @brief Reads the entries from the index file of the grib file, either a
+ * registered buffer or a file on disk
+ * @return true if the index file exists and matches the grib file
+ */
+bool GribIndex::load() {
+  const auto fn = GribIndex::indexFilename(m_filename);
+  auto file = MappedFile::buffer(fn);
+  if (!file) {
+    if (!Utilities::exists(fn)) return false;
+    file = std::make_shared<const MappedFile>(fn);
+  }
+
+  IndexReader reader(file->data(), file->size());
+  IndexHeader header{};
+  if (!reader.read(header) ||
+      std::memcmp(header.magic, c_magic, sizeof(c_magic)) != 0 ||
+      header.version != c_version) {
+    Logging::warning("Ignoring invalid grib index file " + fn);
+    return false;
+  }
+
+  //...The offsets must still point at the start of messages of the same file
+  const auto grib = MappedFile::get(m_filename);
+  if (header.file_size != grib->size()) {
+    Logging::warning("Ignoring stale grib index file " + fn);
+    return false;
+  }
+
+  std::vector<Entry> entries;
+  entries.reserve(header.n_entries);
+  for (uint64_t k = 0; k < header.n_entries; ++k) {
+    EntryHeader eh{};
+    Entry e{};
+    if (!reader.read(eh) || !reader.read(e.shortName) ||
+        !reader.read(e.typeOfLevel) || !reader.read(e.stepRange)) {
+      Logging::warning("Ignoring truncated grib index file " + fn);
+      return false;
+    }
+    if (eh.offset < 0 || eh.length < 4 ||
+        eh.offset + eh.length > grib->size() ||
+        std::memcmp(grib->data() + eh.offset, "GRIB", 4) != 0) {
+      Logging::warning("Ignoring stale grib index file " + fn);
+      return false;
+    }
+    e.level = eh.level;
+    e.step = eh.step;
+    e.offset = eh.offset;
+    e.length = eh.length;
+    e.field = eh.field;
+    entries.push_back(std::move(e));
+  }
+  if (!reader.done()) {
+    Logging::warning("Ignoring invalid grib index file " + fn);
+    return false;
+  }
+  m_entries = std::move(entries);
+  return true;
+}
+
+void GribIndex::build() {
+  Instrumentation::ScopedTimer timer(Instrumentation::MESSAGE_INDEX);
+  if (this->load()) {
+    timer.add_items(m_entries.size());
+    return;
+  }
+
+  auto context = GribHandle::context();
+  auto f = FileWrapper(m_filename, "r");
+  if (!f.ptr()) {
+    metbuild_throw_exception("Could not open the grib file '" + m_filename +
+                             "'");
+  }
+
+  int ierr = 0;
+  off_t last_offset = -1;
+  size_t field = 0;
+  while (auto h = codes_handle_new_from_file(context, f.ptr(), PRODUCT_GRIB,
+                                             &ierr)) {
+    CODES_CHECK(ierr, nullptr);
+    off_t offset = 0;
+    size_t length = 0;
+    CODES_CHECK(codes_get_message_offset(h, &offset), nullptr);
+    CODES_CHECK(codes_get_message_size(h, &length), nullptr);
+    field = offset == last_offset ? field + 1 : 0;
+    last_offset = offset;
+
+    long level = 0;
+    if (codes_get_long(h, "level", &level) != GRIB_SUCCESS) level = 0;
+
+    auto stepRange = readString(h, "stepRange");
+    m_entries.push_back({readString(h, "shortName"),
+                         readString(h, "typeOfLevel"), level,
+                         std::move(stepRange), readStepMinutes(h),
+                         static_cast<long>(offset), length, field});
+    codes_handle_delete(h);
+  }
+  codes_grib_multi_support_reset_file(context, f.ptr());
+  timer.add_items(m_entries.size());
+}
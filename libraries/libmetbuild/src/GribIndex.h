@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_GRIBINDEX_H_
+#define METBUILD_SRC_GRIBINDEX_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CppAttributes.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Byte-offset index of the messages contained in a grib file
+ *
+ * The index is generated with a single pass over the file and then shared
+ * by every reader of the same file so that a variable can be read by seeking
+ * directly to its message rather than scanning the file again
+ *
+ * Files holding several forecast steps of each variable, such as the HRRR
+ * sub-hourly files, are read one step at a time through a step reference,
+ * "<file>#<minutes>". A source opened on a reference only sees the messages
+ * of that step, while the mapping, index and coordinates of the file are
+ * shared by the sources of every step
+ *
+ * An index file written next to the grib file when it is downloaded, named
+ * by indexFilename, is read in place of scanning the messages. It is only
+ * used when its offsets still point at the messages of the file
+ */
+class GribIndex {
+ public:
+  struct Entry {
+    std::string shortName;
+    std::string typeOfLevel;
+    long level;
+    std::string stepRange;
+    long step;  // end of the forecast step in minutes, -1 if unknown
+    long offset;
+    size_t length;
+    size_t field;
+  };
+
+  explicit GribIndex(std::string filename);
+
+  static std::shared_ptr<const GribIndex> get(const std::string &filename);
+
+  static void clear();
+
+  NODISCARD const std::string &filename() const;
+
+  NODISCARD const std::vector<Entry> &entries() const;
+
+  NODISCARD const Entry *find(const std::string &shortName) const;
+
+  NODISCARD const Entry *find(const std::string &shortName,
+                              const std::string &typeOfLevel,
+                              long level) const;
+
+  NODISCARD const Entry *find(const std::string &shortName, long step) const;
+
+  NODISCARD bool contains(const std::string &shortName) const;
+
+  NODISCARD std::vector<long> steps(const std::string &shortName) const;
+
+  NODISCARD static std::string stepReference(const std::string &filename,
+                                             long step);
+
+  NODISCARD static std::pair<std::string, long> splitReference(
+      const std::string &name);
+
+  NODISCARD static std::string indexFilename(const std::string &filename);
+
+  void write(const std::string &filename) const;
+
+ private:
+  void build();
+
+  bool load();
+
+  std::string m_filename;
+  std::vector<Entry> m_entries;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_GRIBINDEX_H_
@@ -0,0 +1,416 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "GribUnpacker.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#include "ThreadPool.h"
+
+using namespace MetBuild;
+
+namespace {
+bool environmentFlag(const char *name) {
+  const char *env = std::getenv(name);
+  return env != nullptr && std::strcmp(env, "0") != 0;
+}
+
+std::atomic<bool> s_enabled(environmentFlag("METBUILD_NATIVE_GRIB"));
+std::atomic<bool> s_validate(environmentFlag("METBUILD_VALIDATE_GRIB"));
+
+//...Values handed to each task when a field is split across the pool
+constexpr size_t c_chunk = 1 << 16;
+
+/**
+ * @brief Layout of the packed values of a message, read from its data
+ * representation and data sections
+ */
+struct Packing {
+  unsigned drt = 0;
+  size_t points = 0;
+  double reference = 0.0;
+  long binary_scale = 0;
+  long decimal_scale = 0;
+  unsigned bits = 0;
+  size_t groups = 0;
+  unsigned width_reference = 0;
+  unsigned width_bits = 0;
+  uint64_t length_reference = 0;
+  unsigned length_increment = 0;
+  uint64_t last_length = 0;
+  unsigned length_bits = 0;
+  unsigned order = 0;
+  unsigned extra_octets = 0;
+  const unsigned char *data = nullptr;
+  size_t data_size = 0;
+};
+
+uint64_t read_unsigned(const unsigned char *p, const size_t n) {
+  uint64_t value = 0;
+  for (size_t k = 0; k < n; ++k) value = (value << 8) | p[k];
+  return value;
+}
+
+//...Grib2 stores signed integers as a sign bit followed by the magnitude
+int64_t read_signed(const unsigned char *p, const size_t n) {
+  const uint64_t value = read_unsigned(p, n);
+  const uint64_t sign = uint64_t(1) << (8 * n - 1);
+  const auto magnitude = static_cast<int64_t>(value & (sign - 1));
+  return (value & sign) != 0 ? -magnitude : magnitude;
+}
+
+/**
+ * @brief Reads width bits, at most 32, starting at bit pos of a big endian
+ * bit stream
+ */
+uint64_t read_bits(const unsigned char *data, const size_t size,
+                   const uint64_t pos, const unsigned width) {
+  if (width == 0) return 0;
+  const size_t byte = pos >> 3;
+  uint64_t word = 0;
+  if (byte + 8 <= size) {
+    for (size_t k = 0; k < 8; ++k) word = (word << 8) | data[byte + k];
+  } else {
+    for (size_t k = 0; k < 8; ++k) {
+      word = (word << 8) | (byte + k < size ? data[byte + k] : 0);
+    }
+  }
+  return (word << (pos & 7)) >> (64 - width);
+}
+
+/**
+ * @brief Integer power by repeated multiplication or division, as eccodes
+ * computes its scale factors, so the scaled values round the same way
+ */
+double power(long s, const long n) {
+  double value = 1.0;
+  if (s == 0) return 1.0;
+  if (s == 1) return static_cast<double>(n);
+  while (s < 0) {
+    value /= static_cast<double>(n);
+    ++s;
+  }
+  while (s > 0) {
+    value *= static_cast<double>(n);
+    --s;
+  }
+  return value;
+}
+
+bool read_representation(const unsigned char *s, const uint64_t length,
+                         Packing &p) {
+  if (length < 21) return false;
+  p.points = read_unsigned(s + 5, 4);
+  p.drt = static_cast<unsigned>(read_unsigned(s + 9, 2));
+  const auto reference = static_cast<uint32_t>(read_unsigned(s + 11, 4));
+  float r;
+  static_assert(sizeof(r) == sizeof(reference), "IEEE single precision");
+  std::memcpy(&r, &reference, sizeof(r));
+  p.reference = static_cast<double>(r);
+  p.binary_scale = static_cast<long>(read_signed(s + 15, 2));
+  p.decimal_scale = static_cast<long>(read_signed(s + 17, 2));
+  p.bits = s[19];
+  if (p.bits == 0 || p.bits > 32) return false;
+  if (p.drt == 0) return true;
+  if (p.drt != 2 && p.drt != 3) return false;
+  if (length < (p.drt == 3 ? 49U : 47U)) return false;
+
+  //...Only the general group splitting without missing values is unpacked
+  if (s[21] != 1 || s[22] != 0) return false;
+  p.groups = read_unsigned(s + 31, 4);
+  p.width_reference = s[35];
+  p.width_bits = s[36];
+  p.length_reference = read_unsigned(s + 37, 4);
+  p.length_increment = s[41];
+  p.last_length = read_unsigned(s + 42, 4);
+  p.length_bits = s[46];
+  if (p.groups == 0 || p.width_bits > 32 || p.length_bits > 32) return false;
+  if (p.drt == 3) {
+    p.order = s[47];
+    p.extra_octets = s[48];
+    if ((p.order != 1 && p.order != 2) || p.extra_octets == 0 ||
+        p.extra_octets > 4 || p.points < p.order) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Finds the data representation and data sections of a message
+ * holding a single field without a bitmap
+ */
+bool read_sections(const unsigned char *message, const size_t length,
+                   Packing &p) {
+  if (length < 16 || std::memcmp(message, "GRIB", 4) != 0 ||
+      message[7] != 2) {
+    return false;
+  }
+  const uint64_t total = read_unsigned(message + 8, 8);
+  if (total > length) return false;
+
+  bool representation = false;
+  bool bitmap = false;
+  size_t fields = 0;
+  uint64_t pos = 16;
+  while (pos + 4 <= total && std::memcmp(message + pos, "7777", 4) != 0) {
+    if (pos + 5 > total) return false;
+    const auto *s = message + pos;
+    const uint64_t section = read_unsigned(s, 4);
+    if (section < 5 || pos + section > total) return false;
+    switch (s[4]) {
+      case 5:
+        representation = read_representation(s, section, p);
+        if (!representation) return false;
+        break;
+      case 6:
+        bitmap = section >= 6 && s[5] == 255;
+        if (!bitmap) return false;
+        break;
+      case 7:
+        p.data = s + 5;
+        p.data_size = section - 5;
+        ++fields;
+        break;
+      default:
+        break;
+    }
+    pos += section;
+  }
+  return representation && bitmap && fields == 1;
+}
+
+template <typename T>
+void scale(const int64_t *x, const size_t n, const Packing &p, T *values) {
+  const double bscale = power(p.binary_scale, 2);
+  const double dscale = power(-p.decimal_scale, 10);
+  ThreadPool::global().parallel_for(
+      0, (n + c_chunk - 1) / c_chunk, [&](const size_t c) {
+        const size_t end = std::min(n, (c + 1) * c_chunk);
+        for (size_t i = c * c_chunk; i < end; ++i) {
+          values[i] = static_cast<T>(
+              ((static_cast<double>(x[i]) * bscale) + p.reference) * dscale);
+        }
+      });
+}
+
+template <typename T>
+bool unpack_simple(const Packing &p, T *values) {
+  if (static_cast<uint64_t>(p.points) * p.bits > p.data_size * 8ULL) {
+    return false;
+  }
+  const double bscale = power(p.binary_scale, 2);
+  const double dscale = power(-p.decimal_scale, 10);
+  ThreadPool::global().parallel_for(
+      0, (p.points + c_chunk - 1) / c_chunk, [&](const size_t c) {
+        const size_t end = std::min(p.points, (c + 1) * c_chunk);
+        uint64_t pos = static_cast<uint64_t>(c * c_chunk) * p.bits;
+        for (size_t i = c * c_chunk; i < end; ++i, pos += p.bits) {
+          const auto x = read_bits(p.data, p.data_size, pos, p.bits);
+          values[i] = static_cast<T>(
+              ((static_cast<double>(x) * bscale) + p.reference) * dscale);
+        }
+      });
+  return true;
+}
+
+/**
+ * @brief Replaces x with its running sum, summing each chunk in parallel
+ * and then adding the totals of the chunks before it
+ */
+void running_sum(int64_t *x, const size_t n) {
+  const size_t chunks = (n + c_chunk - 1) / c_chunk;
+  if (chunks <= 1) {
+    std::partial_sum(x, x + n, x);
+    return;
+  }
+  std::vector<int64_t> totals(chunks);
+  auto &pool = ThreadPool::global();
+  pool.parallel_for(0, chunks, [&](const size_t c) {
+    const size_t end = std::min(n, (c + 1) * c_chunk);
+    std::partial_sum(x + c * c_chunk, x + end, x + c * c_chunk);
+    totals[c] = x[end - 1];
+  });
+  std::partial_sum(totals.begin(), totals.end(), totals.begin());
+  pool.parallel_for(1, chunks, [&](const size_t c) {
+    const size_t end = std::min(n, (c + 1) * c_chunk);
+    for (size_t i = c * c_chunk; i < end; ++i) x[i] += totals[c - 1];
+  });
+}
+
+template <typename T>
+bool unpack_complex(const Packing &p, T *values) {
+  const auto *data = p.data;
+  const size_t size = p.data_size;
+  const size_t ndescriptors = p.drt == 3 ? p.order + 1 : 0;
+  if (ndescriptors * p.extra_octets > size) return false;
+
+  int64_t ival1 = 0;
+  int64_t ival2 = 0;
+  int64_t minsd = 0;
+  if (p.drt == 3) {
+    const auto n = p.extra_octets;
+    ival1 = read_signed(data, n);
+    if (p.order == 2) ival2 = read_signed(data + n, n);
+    minsd = read_signed(data + p.order * n, n);
+  }
+
+  //...Group references, widths and lengths each start on an octet
+  auto octet = [](const uint64_t bits) { return (bits + 7) / 8 * 8; };
+  const uint64_t refs_pos = ndescriptors * p.extra_octets * 8ULL;
+  const uint64_t widths_pos = refs_pos + octet(p.groups * p.bits);
+  const uint64_t lengths_pos = widths_pos + octet(p.groups * p.width_bits);
+  const uint64_t values_pos = lengths_pos + octet(p.groups * p.length_bits);
+  if (values_pos > size * 8ULL) return false;
+
+  //...Bit offset and first value of every group
+  std::vector<uint64_t> group_pos(p.groups + 1);
+  std::vector<size_t> group_start(p.groups + 1);
+  group_pos[0] = values_pos;
+  group_start[0] = 0;
+  for (size_t g = 0; g < p.groups; ++g) {
+    const auto width =
+        p.width_reference +
+        read_bits(data, size, widths_pos + g * p.width_bits, p.width_bits);
+    const auto length =
+        g + 1 == p.groups
+            ? p.last_length
+            : p.length_reference +
+                  read_bits(data, size, lengths_pos + g * p.length_bits,
+                            p.length_bits) *
+                      p.length_increment;
+    if (width > 32) return false;
+    group_pos[g + 1] = group_pos[g] + width * length;
+    group_start[g + 1] = group_start[g] + length;
+    if (group_start[g + 1] > p.points) return false;
+  }
+  if (group_start[p.groups] != p.points || group_pos[p.groups] > size * 8ULL) {
+    return false;
+  }
+
+  //...Groups are split into runs of about a chunk of values for the pool
+  std::vector<size_t> runs = {0};
+  for (size_t g = 0; g < p.groups; ++g) {
+    if (group_start[g + 1] - group_start[runs.back()] >= c_chunk) {
+      runs.push_back(g + 1);
+    }
+  }
+  if (runs.back() != p.groups) runs.push_back(p.groups);
+
+  //...The smallest difference is added to every value after the first
+  // order values here rather than in a separate pass
+  std::vector<int64_t> x(p.points);
+  ThreadPool::global().parallel_for(0, runs.size() - 1, [&](const size_t r) {
+    for (size_t g = runs[r]; g < runs[r + 1]; ++g) {
+      const auto reference = static_cast<int64_t>(
+          read_bits(data, size, refs_pos + g * p.bits, p.bits));
+      const size_t length = group_start[g + 1] - group_start[g];
+      const auto width =
+          length == 0
+              ? 0U
+              : static_cast<unsigned>((group_pos[g + 1] - group_pos[g]) /
+                                      length);
+      uint64_t pos = group_pos[g];
+      for (size_t k = group_start[g]; k < group_start[g + 1];
+           ++k, pos += width) {
+        x[k] = reference +
+               static_cast<int64_t>(read_bits(data, size, pos, width)) +
+               (k >= p.order ? minsd : 0);
+      }
+    }
+  });
+
+  //...Undoes the spatial differencing. Second order differences are summed
+  // twice, once into the first differences and once into the values
+  if (p.drt == 3) {
+    if (p.order == 1) {
+      x[0] = ival1;
+    } else {
+      x[1] = ival2 - ival1;
+      running_sum(x.data() + 1, p.points - 1);
+      x[0] = ival1;
+    }
+    running_sum(x.data(), p.points);
+  }
+
+  scale(x.data(), p.points, p, values);
+  return true;
+}
+
+template <typename T>
+bool unpack_values(const unsigned char *message, const size_t length,
+                   T *values, const size_t size) {
+  Packing p;
+  if (!read_sections(message, length, p) || p.points != size) return false;
+  if (p.drt == 0) return unpack_simple(p, values);
+  return unpack_complex(p, values);
+}
+}  // namespace
+
+void GribUnpacker::setEnabled(const bool value) { s_enabled = value; }
+
+bool GribUnpacker::enabled() { return s_enabled; }
+
+void GribUnpacker::setValidate(const bool value) { s_validate = value; }
+
+bool GribUnpacker::validate() { return s_validate; }
+
+/**
+ * @brief True when the values of a message can be unpacked natively
+ * @param message grib2 message
+ * @param length length of the message in bytes
+ */
+bool GribUnpacker::supported(const unsigned char *message,
+                             const size_t length) {
+  Packing p;
+  return read_sections(message, length, p);
+}
+
+/**
+ * @brief Unpacks the values of a message
+ * @param message grib2 message
+ * @param length length of the message in bytes
+ * @param values receives the values, one per point
+ * @param size number of values the field is expected to hold
+ * @return false, with the values untouched, when the message is not
+ * supported, not the expected size or damaged
+ */
+bool GribUnpacker::unpack(const unsigned char *message, const size_t length,
+                          double *values, const size_t size) {
+  return unpack_values(message, length, values, size);
+}
+
+bool GribUnpacker::unpack(const unsigned char *message, const size_t length,
+                          float *values, const size_t size) {
+  return unpack_values(message, length, values, size);
+}
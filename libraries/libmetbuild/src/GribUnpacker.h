@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_GRIBUNPACKER_H_
+#define METBUILD_SRC_GRIBUNPACKER_H_
+
+#include <cstddef>
+
+#include "CppAttributes.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Native unpacker for the grib2 data representations used by the
+ * forecast sources
+ *
+ * Simple packing (template 5.0), complex packing (5.2) and complex packing
+ * with first or second order spatial differencing (5.3) are unpacked
+ * directly from the message, splitting each field across the thread pool.
+ * The values are computed with the same arithmetic as eccodes, so they
+ * match codes_get_double_array bit for bit. Messages using anything else,
+ * such as a bitmap, missing value management or a constant field, are left
+ * to eccodes
+ *
+ * The unpacker is disabled unless enabled with setEnabled() or the
+ * METBUILD_NATIVE_GRIB environment variable. With setValidate(), or
+ * METBUILD_VALIDATE_GRIB, every field is also decoded by eccodes and the
+ * eccodes values are used when the two differ
+ */
+class GribUnpacker {
+ public:
+  static void setEnabled(bool value);
+
+  NODISCARD static bool enabled();
+
+  static void setValidate(bool value);
+
+  NODISCARD static bool validate();
+
+  NODISCARD static bool supported(const unsigned char *message, size_t length);
+
+  static bool unpack(const unsigned char *message, size_t length,
+                     double *values, size_t size);
+
+  static bool unpack(const unsigned char *message, size_t length,
+                     float *values, size_t size);
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_GRIBUNPACKER_H_
@@ -30,8 +30,14 @@
 
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <sstream>
 
 #include "Geometry.h"
+#include "Hash.h"
+#include "Logging.h"
+#include "Projection.h"
+#include "ThreadPool.h"
 #include "boost/geometry.hpp"
 
 using namespace MetBuild;
@@ -64,7 +70,7 @@ Grid::Grid(double llx, double lly, double urx, double ury, double dx, double dy,
   assert(m_nj > 0);
   assert(m_width > 0);
   assert(m_height > 0);
-  this->generateGrid();
+  m_fingerprint = this->generateFingerprint();
 }
 
 Grid::Grid(double xinit, double yinit, size_t ni, size_t nj, double di,
@@ -89,7 +95,7 @@ Grid::Grid(double xinit, double yinit, size_t ni, size_t nj, double di,
   assert(m_rotation >= -M_PI || m_rotation <= M_PI);
   assert(m_ni > 0);
   assert(m_nj > 0);
-  this->generateGrid();
+  m_fingerprint = this->generateFingerprint();
 }
 
 Grid::~Grid() = default;
@@ -104,42 +110,348 @@ Grid::Grid(const Grid &w)
       m_dyy(m_dj * std::cos(m_rotation)),
       m_ni(w.ni()),
       m_nj(w.nj()),
-      m_width(static_cast<double>(m_ni - 1) * m_dxx),
-      m_height(static_cast<double>(m_nj - 1) * m_dyy),
+      m_width(w.m_points ? w.m_width
+                         : static_cast<double>(m_ni - 1) * m_dxx),
+      m_height(w.m_points ? w.m_height
+                          : static_cast<double>(m_nj - 1) * m_dyy),
       m_center((w.bottom_left().x() + m_width / 2.0),
                (w.bottom_left().y() + m_height / 2.0)),
       m_epsg(w.epsg()),
       m_corners(generateCorners(m_center.x(), m_center.y(), m_width, m_height)),
-      m_geometry(std::make_unique<Geometry>(m_corners)) {}
+      m_points(w.m_points),
+      m_fingerprint(w.m_fingerprint),
+      m_geometry(std::make_unique<Geometry>(m_corners)),
+      m_mask(w.m_mask),
+      m_mask_hash(w.m_mask_hash) {}
+
+Grid::Grid(std::shared_ptr<const std::vector<Point>> points,
+           const std::array<double, 4> &extent, int epsg)
+    : m_di(0.0),
+      m_dj(0.0),
+      m_rotation(0.0),
+      m_dxx(0.0),
+      m_dxy(0.0),
+      m_dyx(0.0),
+      m_dyy(0.0),
+      m_ni(points->size()),
+      m_nj(1),
+      m_width(extent[2] - extent[0]),
+      m_height(extent[3] - extent[1]),
+      m_center((extent[0] + m_width / 2.0), (extent[1] + m_height / 2.0)),
+      m_epsg(epsg),
+      m_corners(generateCorners(m_center.x(), m_center.y(), m_width, m_height)),
+      m_points(std::move(points)),
+      m_geometry(std::make_unique<Geometry>(m_corners)) {
+  m_fingerprint = this->generateFingerprint();
+  //...Copies share the points, so only the grid that made them counts them
+  m_grid_memory.set(m_points->size() * sizeof(Point));
+}
+
+/**
+ * @brief Grid made of a list of arbitrary points, such as the nodes of an
+ * unstructured mesh. The points form a single row, so weights and output
+ * fields are indexed by point and interpolation goes straight from the
+ * source to each point
+ * @param points positions in the grid projection
+ * @param epsg projection of the positions
+ * @return point list grid with ni() == points.size() and nj() == 1
+ */
+Grid Grid::from_points(std::vector<MetBuild::Point> points, int epsg) {
+  if (points.empty()) {
+    metbuild_throw_exception("A point list grid needs at least one point");
+  }
+  std::array<double, 4> extent = {std::numeric_limits<double>::max(),
+                                  std::numeric_limits<double>::max(),
+                                  std::numeric_limits<double>::lowest(),
+                                  std::numeric_limits<double>::lowest()};
+  for (const auto &p : points) {
+    extent[0] = std::min(extent[0], p.x());
+    extent[1] = std::min(extent[1], p.y());
+    extent[2] = std::max(extent[2], p.x());
+    extent[3] = std::max(extent[3], p.y());
+  }
+  return {std::make_shared<const std::vector<Point>>(std::move(points)),
+          extent, epsg};
+}
+
+/**
+ * @brief Point list grid made of the nodes of an ADCIRC mesh (fort.14). Only
+ * the node table is read, the elements and boundaries are ignored
+ * @param filename mesh file
+ * @param epsg projection of the node coordinates
+ * @return point list grid with one point per mesh node, in file order
+ */
+Grid Grid::from_adcirc_mesh(const std::string &filename, int epsg) {
+  std::ifstream fin(filename);
+  if (!fin.is_open()) {
+    metbuild_throw_exception("Could not open mesh file " + filename);
+  }
 
-void Grid::generateGrid() {
-  m_grid = std::vector<std::vector<Point>>(nj(), std::vector<Point>(ni()));
+  std::string line;
+  size_t n_elements = 0;
+  size_t n_nodes = 0;
+  std::getline(fin, line);
+  if (!std::getline(fin, line) ||
+      !(std::istringstream(line) >> n_elements >> n_nodes)) {
+    metbuild_throw_exception("Invalid header in mesh file " + filename);
+  }
+
+  std::vector<Point> points;
+  points.reserve(n_nodes);
+  for (size_t n = 0; n < n_nodes; ++n) {
+    size_t id = 0;
+    double x = 0.0;
+    double y = 0.0;
+    double depth = 0.0;
+    if (!(fin >> id >> x >> y >> depth)) {
+      metbuild_throw_exception("Mesh file " + filename + " ends after " +
+                               std::to_string(n) + " of " +
+                               std::to_string(n_nodes) + " nodes");
+    }
+    points.emplace_back(x, y);
+  }
+  return Grid::from_points(std::move(points), epsg);
+}
+
+Grid::grid Grid::generateGrid() const {
+  grid g(nj(), std::vector<Point>(ni()));
   for (size_t j = 0; j < nj(); ++j) {
     for (size_t i = 0; i < ni(); ++i) {
-      m_grid[j][i] = {bottom_left().x() + i * m_dxx - j * m_dyx,
-                      bottom_left().y() + j * m_dyy + i * m_dyx};
+      g[j][i] = this->position(i, j);
     }
   }
+  return g;
+}
+
+/**
+ * @brief Hashes the parameters the positions are generated from, or the
+ * points themselves for a point list grid
+ */
+GridFingerprint Grid::generateFingerprint() const {
+  Hash h;
+  h.add(m_ni).add(m_nj).add(m_epsg);
+  if (m_points) return h.add(*m_points).value();
+  return h.add(bottom_left())
+      .add(m_dxx)
+      .add(m_dyx)
+      .add(m_dyy)
+      .value();
+}
+
+/**
+ * @brief Every grid position as a matrix indexed [j][i]. The matrix is
+ * built on the first call and kept for the life of the grid, so callers that
+ * only need some positions should use position() instead
+ * @return grid positions
+ */
+const Grid::grid &Grid::grid_positions() const {
+  std::call_once(m_grid_once, [this]() {
+    m_grid = std::make_unique<const grid>(this->generateGrid());
+    m_grid_memory.set(m_grid_memory.bytes() + m_ni * m_nj * sizeof(Point));
+  });
+  return *m_grid;
+}
+
+/**
+ * @brief Grid positions converted to WGS84, computed once per source
+ * projection and kept for the life of the grid
+ *
+ * Rows are converted in parallel, each thread using its own proj context
+ *
+ * @param epsg projection the grid positions are defined in
+ * @return positions as longitude and latitude
+ */
+const Grid::grid &Grid::geographic_positions(int epsg) const {
+  std::lock_guard<std::mutex> lock(m_projection_mutex);
+  auto &g = m_geographic[epsg];
+  if (g) return *g;
+
+  auto out = std::make_unique<grid>(this->generateGrid());
+  ThreadPool::global().parallel_for(0, out->size(), [&](const size_t j) {
+    auto &row = (*out)[j];
+    std::vector<double> x(row.size());
+    std::vector<double> y(row.size());
+    for (size_t i = 0; i < row.size(); ++i) {
+      x[i] = row[i].x();
+      y[i] = row[i].y();
+    }
+    std::vector<double> xout;
+    std::vector<double> yout;
+    bool latlon = true;
+    const int ierr =
+        Projection::transform(epsg, 4326, x, y, xout, yout, latlon);
+    if (ierr != 0) {
+      metbuild_throw_exception(
+          "Error while converting coordinates within proj. Code = " +
+          std::to_string(ierr));
+    }
+    for (size_t i = 0; i < row.size(); ++i) {
+      row[i] = {xout[i], yout[i]};
+    }
+  });
+  g = std::move(out);
+  m_geographic_memory.set(m_geographic_memory.bytes() +
+                          m_ni * m_nj * sizeof(Point));
+  return *g;
 }
 
 void Grid::write(const std::string &filename) const {
   std::ofstream fout;
   fout.open(filename);
   size_t count = 0;
-  size_t count_i = 0;
-  for (auto &i : m_grid) {
-    size_t count_j = 0;
-    for (auto &j : i) {
-      fout << j.x() << " " << j.y() << " " << count << " " << count_i << " "
-           << count_j << "\n";
+  for (size_t j = 0; j < nj(); ++j) {
+    for (size_t i = 0; i < ni(); ++i) {
+      const auto p = this->position(i, j);
+      fout << p.x() << " " << p.y() << " " << count << " " << j << " " << i
+           << "\n";
       count++;
-      count_j++;
     }
-    count_i++;
   }
   fout.close();
 }
 
+/**
+ * @brief Sub-grid made of a band of consecutive rows of this grid, with the
+ * same spacing, rotation and projection
+ * @param j0 first row of the band
+ * @param nj number of rows in the band
+ * @return grid whose row j is row j0 + j of this grid
+ */
+Grid Grid::band(const size_t j0, const size_t nj) const {
+  if (nj == 0 || j0 + nj > m_nj) {
+    metbuild_throw_exception("Band exceeds the grid extent");
+  }
+  if (m_points) return *this;
+  const auto origin = this->position(0, j0);
+  Grid g(origin.x(), origin.y(), m_ni, nj, m_di, m_dj, this->rotation(),
+         m_epsg);
+  if (m_mask) {
+    g.set_mask(std::vector<uint8_t>(m_mask->begin() + j0 * m_ni,
+                                    m_mask->begin() + (j0 + nj) * m_ni));
+  }
+  return g;
+}
+
+/**
+ * @brief Locates a grid whose nodes are nodes of this grid, such as a domain
+ * cut from a larger one with the same spacing, rotation and projection
+ * @param sub grid to locate
+ * @return window of this grid holding the nodes of sub, or nothing when sub
+ * is not aligned with this grid or not inside it. Masked grids and point
+ * lists are never located
+ */
+std::optional<Grid::Window> Grid::window(const Grid &sub) const {
+  //...Misalignment allowed, as a fraction of a cell
+  constexpr double tolerance = 1e-3;
+
+  if (m_points || sub.m_points || m_mask || sub.m_mask) return std::nullopt;
+  if (sub.m_epsg != m_epsg ||
+      std::abs(sub.m_di - m_di) > 1e-9 * std::abs(m_di) ||
+      std::abs(sub.m_dj - m_dj) > 1e-9 * std::abs(m_dj) ||
+      std::abs(sub.m_rotation - m_rotation) > 1e-9) {
+    return std::nullopt;
+  }
+
+  //...Offset of the first node of sub in the i and j directions of this grid
+  const double ox = sub.bottom_left().x() - bottom_left().x();
+  const double oy = sub.bottom_left().y() - bottom_left().y();
+  const double det = m_dxx * m_dyy + m_dyx * m_dyx;
+  const double fi = (ox * m_dyy + oy * m_dyx) / det;
+  const double fj = (oy * m_dxx - ox * m_dyx) / det;
+  const double ri = std::round(fi);
+  const double rj = std::round(fj);
+  if (std::abs(fi - ri) > tolerance || std::abs(fj - rj) > tolerance ||
+      ri < 0.0 || rj < 0.0) {
+    return std::nullopt;
+  }
+
+  const Window w{static_cast<size_t>(ri), static_cast<size_t>(rj), sub.m_ni,
+                 sub.m_nj};
+  if (w.i0 + w.ni > m_ni || w.j0 + w.nj > m_nj) return std::nullopt;
+  return w;
+}
+
+/**
+ * @brief Sub-grid made of every stride-th node of this grid in each
+ * direction, starting from the first, with the same rotation and projection.
+ * A point list keeps every stride-th point
+ * @param stride step between the nodes kept
+ * @return grid whose node (i, j) is node (i * stride, j * stride) of this
+ * grid
+ */
+Grid Grid::strided(const size_t stride) const {
+  if (stride == 0) {
+    metbuild_throw_exception("The grid stride must be positive");
+  }
+  if (stride == 1) return *this;
+  const auto ni = (m_ni + stride - 1) / stride;
+  const auto nj = (m_nj + stride - 1) / stride;
+  auto g = [&]() {
+    if (!m_points) {
+      const auto origin = this->position(0, 0);
+      return Grid(origin.x(), origin.y(), ni, nj,
+                  m_di * static_cast<double>(stride),
+                  m_dj * static_cast<double>(stride), this->rotation(),
+                  m_epsg);
+    }
+    std::vector<Point> points;
+    points.reserve(ni);
+    for (size_t i = 0; i < m_ni; i += stride) points.push_back((*m_points)[i]);
+    return Grid::from_points(std::move(points), m_epsg);
+  }();
+  if (m_mask) {
+    std::vector<uint8_t> mask(ni * nj);
+    for (size_t j = 0; j < nj; ++j) {
+      for (size_t i = 0; i < ni; ++i) {
+        mask[j * ni + i] = (*m_mask)[j * stride * m_ni + i * stride];
+      }
+    }
+    g.set_mask(std::move(mask));
+  }
+  return g;
+}
+
+/**
+ * @brief Restricts the cells computed on this grid, such as to the wet cells
+ * of an ocean model. Cells masked out get no interpolation weight and
+ * receive the fill value in every output
+ * @param mask one entry per cell indexed j * ni() + i, nonzero for the cells
+ * computed
+ */
+void Grid::set_mask(std::vector<uint8_t> mask) {
+  if (mask.size() != m_ni * m_nj) {
+    metbuild_throw_exception("Mask size does not match the grid size");
+  }
+  m_mask_hash = Hash().add(mask).value();
+  m_mask = std::make_shared<const std::vector<uint8_t>>(std::move(mask));
+}
+
+/**
+ * @brief Restricts the cells computed on this grid to those inside a polygon
+ * @param polygon polygon vertices in the grid projection
+ */
+void Grid::set_mask(const std::vector<MetBuild::Point> &polygon) {
+  if (polygon.size() < 3) {
+    metbuild_throw_exception("A mask polygon needs at least three vertices");
+  }
+  const Geometry geometry(polygon);
+  std::vector<uint8_t> mask(m_ni * m_nj);
+  ThreadPool::global().parallel_for(0, m_nj, [&](const size_t j) {
+    for (size_t i = 0; i < m_ni; ++i) {
+      mask[j * m_ni + i] = geometry.is_inside(this->position(i, j)) ? 1 : 0;
+    }
+  });
+  this->set_mask(std::move(mask));
+}
+
+/**
+ * @brief Computes every cell of the grid again
+ */
+void Grid::clear_mask() {
+  m_mask.reset();
+  m_mask_hash = 0;
+}
+
 bool Grid::point_inside(const MetBuild::Point &p) const {
   return this->m_geometry->is_inside(p);
 }
@@ -171,9 +483,9 @@ std::array<MetBuild::Point, 4> Grid::generateCorners(const double cx,
 std::vector<double> Grid::x() const {
   std::vector<double> x;
   x.reserve(ni() * nj());
-  for (const auto &r : m_grid) {
-    for (const auto &c : r) {
-      x.push_back(c.x());
+  for (size_t j = 0; j < nj(); ++j) {
+    for (size_t i = 0; i < ni(); ++i) {
+      x.push_back(this->position(i, j).x());
     }
   }
   return x;
@@ -182,9 +494,9 @@ std::vector<double> Grid::x() const {
 std::vector<double> Grid::y() const {
   std::vector<double> y;
   y.reserve(ni() * nj());
-  for (const auto &r : m_grid) {
-    for (const auto &c : r) {
-      y.push_back(c.y());
+  for (size_t j = 0; j < nj(); ++j) {
+    for (size_t i = 0; i < ni(); ++i) {
+      y.push_back(this->position(i, j).y());
     }
   }
   return y;
@@ -195,7 +507,7 @@ std::vector<double> Grid::xcolumn() const {
   std::vector<double> x;
   x.reserve(ni());
   for (size_t i = 0; i < ni(); ++i) {
-    x.push_back(m_grid[0][i].x());
+    x.push_back(this->position(i, 0).x());
   }
   return x;
 }
@@ -205,7 +517,7 @@ std::vector<double> Grid::ycolumn() const {
   std::vector<double> y;
   y.reserve(nj());
   for (size_t i = 0; i < nj(); ++i) {
-    y.push_back(m_grid[i][0].y());
+    y.push_back(this->position(0, i).y());
   }
   return y;
 }
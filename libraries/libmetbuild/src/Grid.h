@@ -32,11 +32,17 @@
 #include <array>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "CppAttributes.h"
+#include "GridFingerprint.h"
+#include "Instrumentation.h"
 #include "Point.h"
 
 namespace MetBuild {
@@ -47,11 +53,27 @@ class Grid {
  public:
   using grid = std::vector<std::vector<MetBuild::Point>>;
 
+  /**
+   * @brief Placement of a grid inside another, as the index of its first node
+   * and its size
+   */
+  struct Window {
+    size_t i0;
+    size_t j0;
+    size_t ni;
+    size_t nj;
+  };
+
   Grid(double llx, double lly, double urx, double ury, double dx, double dy,
        int epsg = 4326);
   Grid(double xinit, double yinit, size_t ni, size_t nj, double dx, double dy,
        double rotation = 0.0, int epsg = 4326);
 
+  static Grid from_points(std::vector<MetBuild::Point> points,
+                          int epsg = 4326);
+
+  static Grid from_adcirc_mesh(const std::string &filename, int epsg = 4326);
+
   ~Grid();
 
   Grid(const Grid &w);
@@ -75,23 +97,83 @@ class Grid {
   NODISCARD constexpr Point top_right() const { return m_corners[2]; }
   NODISCARD constexpr int epsg() const { return m_epsg; }
 
+  /**
+   * @brief Whether the grid is a list of arbitrary points, such as the nodes
+   * of an unstructured mesh, held as a single row with nj() == 1
+   */
+  NODISCARD bool is_point_list() const { return m_points != nullptr; }
+
+  void set_mask(std::vector<uint8_t> mask);
+
+  void set_mask(const std::vector<MetBuild::Point> &polygon);
+
+  void clear_mask();
+
+  /**
+   * @brief Whether only some cells of the grid are computed
+   */
+  NODISCARD bool has_mask() const { return m_mask != nullptr; }
+
+  /**
+   * @brief Cells computed when the grid has a mask, one entry per cell
+   * indexed j * ni() + i and nonzero for the cells computed. Null when every
+   * cell is computed
+   */
+  NODISCARD const std::vector<uint8_t> *mask() const { return m_mask.get(); }
+
+  /**
+   * @brief Hash of the mask, zero when every cell is computed
+   */
+  NODISCARD uint64_t mask_hash() const { return m_mask_hash; }
+
+  /**
+   * @brief Identity of the grid positions in the grid projection. The mask
+   * is not part of it, see mask_hash()
+   */
+  NODISCARD GridFingerprint fingerprint() const { return m_fingerprint; }
+
+  NODISCARD bool masked_in(const size_t i, const size_t j) const {
+    return !m_mask || (*m_mask)[j * m_ni + i] != 0;
+  }
+
+  /**
+   * @brief Position of a grid node, computed from the grid parameters
+   * @param i index in the i direction
+   * @param j index in the j direction
+   * @return position in the grid projection
+   */
+  NODISCARD Point position(const size_t i, const size_t j) const {
+    if (m_points) return (*m_points)[i];
+    return {bottom_left().x() + i * m_dxx - j * m_dyx,
+            bottom_left().y() + j * m_dyy + i * m_dyx};
+  }
+
   NODISCARD Point center(const size_t i, const size_t j) const {
     assert(i < ni() - 1 && j < nj() - 1);
     if (i > ni() - 1 || j > nj() + 1) return {0, 0};
-    return {(m_grid[j][i].x() + m_grid[j + 1][i + 1].x()) / 2.0,
-            (m_grid[j][i].y() + m_grid[j + 1][i + 1].y()) / 2.0};
+    const auto a = this->position(i, j);
+    const auto b = this->position(i + 1, j + 1);
+    return {(a.x() + b.x()) / 2.0, (a.y() + b.y()) / 2.0};
   }
 
   NODISCARD Point corner(const size_t i, const size_t j) const {
     assert(i < ni() && j < nj());
-    return {m_grid[j][i].x(), m_grid[j][i].y()};
+    return this->position(i, j);
   }
 
   NODISCARD bool point_inside(const MetBuild::Point &p) const;
 
+  NODISCARD Grid band(size_t j0, size_t nj) const;
+
+  NODISCARD Grid strided(size_t stride) const;
+
+  NODISCARD std::optional<Window> window(const Grid &sub) const;
+
   void write(const std::string &filename) const;
 
-  NODISCARD const grid &grid_positions() const { return m_grid; };
+  NODISCARD const grid &grid_positions() const;
+
+  NODISCARD const grid &geographic_positions(int epsg) const;
 
   NODISCARD std::vector<double> x() const;
   NODISCARD std::vector<double> y() const;
@@ -114,12 +196,29 @@ class Grid {
   const Point m_center;
   const int m_epsg;
   const std::array<Point, 4> m_corners;
+  const std::shared_ptr<const std::vector<Point>> m_points;
+  GridFingerprint m_fingerprint = 0;
 
-  grid m_grid;
+  //...Built on first use, since most callers only need single positions
+  mutable std::once_flag m_grid_once;
+  mutable std::unique_ptr<const grid> m_grid;
+  mutable Instrumentation::MemoryTracker m_grid_memory{
+      Instrumentation::GRID_MEMORY};
 
   std::unique_ptr<MetBuild::Geometry> m_geometry;
+  std::shared_ptr<const std::vector<uint8_t>> m_mask;
+  uint64_t m_mask_hash = 0;
+
+  mutable std::mutex m_projection_mutex;
+  mutable std::map<int, std::unique_ptr<const grid>> m_geographic;
+  mutable Instrumentation::MemoryTracker m_geographic_memory{
+      Instrumentation::GRID_MEMORY};
+
+  Grid(std::shared_ptr<const std::vector<Point>> points,
+       const std::array<double, 4> &extent, int epsg);
 
-  void generateGrid();
+  NODISCARD grid generateGrid() const;
+  NODISCARD GridFingerprint generateFingerprint() const;
   static std::array<MetBuild::Point, 4> generateCorners(double cx, double cy,
                                                         double w, double h,
                                                         double rotation = 0.0);
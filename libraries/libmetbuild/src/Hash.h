@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_HASH_H_
+#define METBUILD_SRC_HASH_H_
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+
+#include "Point.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Incremental 64-bit FNV-1a hash used to key cached data
+ */
+class Hash {
+ public:
+  Hash() = default;
+
+  Hash &add(const void *data, size_t length) {
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < length; ++i) {
+      m_hash ^= bytes[i];
+      m_hash *= c_prime;
+    }
+    return *this;
+  }
+
+  template <typename T>
+  Hash &add(const T &value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Only trivially copyable types can be hashed directly");
+    return this->add(&value, sizeof(T));
+  }
+
+  template <typename T>
+  Hash &add(const std::vector<T> &values) {
+    this->add(values.size());
+    for (const auto &v : values) {
+      this->add(v);
+    }
+    return *this;
+  }
+
+  Hash &add(const std::string &value) {
+    this->add(value.size());
+    return this->add(value.data(), value.size());
+  }
+
+  Hash &add(const MetBuild::Point &p) {
+    this->add(p.x());
+    return this->add(p.y());
+  }
+
+  [[nodiscard]] uint64_t value() const { return m_hash; }
+
+  [[nodiscard]] std::string hex() const {
+    return fmt::format("{:016x}", m_hash);
+  }
+
+ private:
+  static constexpr uint64_t c_offset = 14695981039346656037ULL;
+  static constexpr uint64_t c_prime = 1099511628211ULL;
+
+  uint64_t m_hash = c_offset;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_HASH_H_
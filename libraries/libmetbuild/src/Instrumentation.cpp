@@ -0,0 +1,764 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "Instrumentation.h"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#include "Logging.h"
+
+using namespace MetBuild;
+
+namespace {
+constexpr size_t c_stages = Instrumentation::N_STAGES;
+
+constexpr size_t c_counters = Instrumentation::N_COUNTERS;
+
+struct Counter {
+  std::atomic<size_t> calls{0};
+  std::atomic<long long> nanoseconds{0};
+  std::atomic<size_t> items{0};
+  std::array<std::atomic<uint64_t>, c_counters> hardware{};
+};
+
+std::array<Counter, c_stages> s_counters;
+
+constexpr size_t c_memory = Instrumentation::N_MEMORY;
+
+struct MemoryCounter {
+  std::atomic<long long> bytes{0};
+  std::atomic<long long> peak{0};
+};
+
+std::array<MemoryCounter, c_memory> s_memory;
+std::array<std::atomic<size_t>, c_stages> s_stage_rss{};
+
+constexpr size_t c_events = Instrumentation::N_EVENTS;
+std::array<std::atomic<size_t>, c_events> s_events{};
+
+bool rssSamplingDefault() {
+  const char *env = std::getenv("METBUILD_SAMPLE_RSS");
+  return env != nullptr && std::strcmp(env, "0") != 0;
+}
+std::atomic<bool> s_rss_sampling(rssSamplingDefault());
+
+bool counterSamplingDefault() {
+  const char *env = std::getenv("METBUILD_SAMPLE_COUNTERS");
+  return env != nullptr && std::strcmp(env, "0") != 0;
+}
+std::atomic<bool> s_counter_sampling(counterSamplingDefault());
+std::once_flag s_counter_warning;
+
+/**
+ * @brief Hardware counters of one thread, opened as a single perf group so
+ * that one read returns all of them. Counters the processor or the kernel
+ * does not provide are left out of the group and read as zero
+ */
+class CounterGroup {
+ public:
+  CounterGroup() {
+    m_slot.fill(-1);
+#ifdef __linux__
+    constexpr std::array<uint64_t, c_counters> configs = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (size_t k = 0; k < c_counters; ++k) {
+      perf_event_attr attr{};
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(perf_event_attr);
+      attr.config = configs[k];
+      attr.read_format = PERF_FORMAT_GROUP;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      const auto fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0,
+                                               -1, m_leader,
+                                               PERF_FLAG_FD_CLOEXEC));
+      if (fd < 0) continue;
+      if (m_leader < 0) m_leader = fd;
+      m_fds[m_open] = fd;
+      m_slot[k] = static_cast<int>(m_open++);
+    }
+#endif
+  }
+
+  ~CounterGroup() {
+    for (size_t k = 0; k < m_open; ++k) close(m_fds[k]);
+  }
+
+  CounterGroup(const CounterGroup &) = delete;
+  CounterGroup &operator=(const CounterGroup &) = delete;
+
+  NODISCARD bool available() const { return m_leader >= 0; }
+
+  bool read(Instrumentation::Counters &counters) const {
+    if (m_leader < 0) return false;
+    //...Group reads return the number of counters followed by their values
+    std::array<uint64_t, c_counters + 1> values{};
+    const auto n = ::read(m_leader, values.data(), sizeof(values));
+    if (n < static_cast<ssize_t>(sizeof(uint64_t))) return false;
+    for (size_t k = 0; k < c_counters; ++k) {
+      counters[k] = m_slot[k] >= 0 && static_cast<uint64_t>(m_slot[k]) <
+                                          values[0]
+                        ? values[m_slot[k] + 1]
+                        : 0;
+    }
+    return true;
+  }
+
+ private:
+  int m_leader = -1;
+  size_t m_open = 0;
+  std::array<int, c_counters> m_fds{};
+  std::array<int, c_counters> m_slot{};
+};
+
+const CounterGroup &thread_counters() {
+  thread_local const CounterGroup group;
+  return group;
+}
+
+template <typename T>
+void store_max(std::atomic<T> &target, const T value) {
+  T current = target.load(std::memory_order_relaxed);
+  while (value > current &&
+         !target.compare_exchange_weak(current, value,
+                                       std::memory_order_relaxed)) {
+  }
+}
+
+struct TraceEvent {
+  int stage;
+  long long begin;
+  long long duration;
+  bool counted;
+  Instrumentation::Counters counters;
+};
+
+/**
+ * @brief Events of one thread. Only the owning thread appends, so the lock
+ * is uncontended except while the trace is written
+ */
+struct TraceBuffer {
+  size_t thread;
+  std::mutex mutex;
+  std::vector<TraceEvent> events;
+  size_t capacity = 0;
+  size_t next = 0;
+  bool wrapped = false;
+};
+
+std::atomic<bool> s_tracing(false);
+std::mutex s_trace_mutex;
+std::vector<std::shared_ptr<TraceBuffer>> s_trace_buffers;
+size_t s_trace_capacity = 0;
+size_t s_trace_threads = 0;
+std::chrono::steady_clock::time_point s_trace_origin;
+
+TraceBuffer &thread_trace_buffer() {
+  thread_local std::shared_ptr<TraceBuffer> buffer;
+  if (!buffer) {
+    std::unique_lock<std::mutex> lock(s_trace_mutex);
+    buffer = std::make_shared<TraceBuffer>();
+    buffer->thread = s_trace_threads++;
+    buffer->capacity = s_trace_capacity;
+    buffer->events.reserve(s_trace_capacity);
+    s_trace_buffers.push_back(buffer);
+  }
+  return *buffer;
+}
+
+void check_stage(const int stage) {
+  if (stage < 0 || static_cast<size_t>(stage) >= c_stages) {
+    metbuild_throw_exception("Invalid instrumentation stage");
+  }
+}
+
+void check_memory(const int memory) {
+  if (memory < 0 || static_cast<size_t>(memory) >= c_memory) {
+    metbuild_throw_exception("Invalid instrumentation memory category");
+  }
+}
+
+void check_event(const int event) {
+  if (event < 0 || static_cast<size_t>(event) >= c_events) {
+    metbuild_throw_exception("Invalid instrumentation event");
+  }
+}
+
+void check_counter(const int counter) {
+  if (counter < 0 || static_cast<size_t>(counter) >= c_counters) {
+    metbuild_throw_exception("Invalid instrumentation counter");
+  }
+}
+}  // namespace
+
+InstrumentationReport::InstrumentationReport()
+    : m_totals(),
+      m_peak_rss(),
+      m_hardware(),
+      m_memory(),
+      m_events(),
+      m_process_peak_rss(0) {}
+
+const InstrumentationReport::Totals &InstrumentationReport::totals(
+    const int stage) const {
+  check_stage(stage);
+  return m_totals[stage];
+}
+
+/**
+ * @brief Number of timed calls of a stage
+ * @param stage Instrumentation::STAGE
+ */
+size_t InstrumentationReport::calls(const int stage) const {
+  return this->totals(stage).calls;
+}
+
+/**
+ * @brief Time spent in a stage, summed over threads
+ * @param stage Instrumentation::STAGE
+ */
+double InstrumentationReport::seconds(const int stage) const {
+  return static_cast<double>(this->totals(stage).nanoseconds) * 1e-9;
+}
+
+/**
+ * @brief Items processed by a stage
+ * @param stage Instrumentation::STAGE
+ */
+size_t InstrumentationReport::items(const int stage) const {
+  return this->totals(stage).items;
+}
+
+/**
+ * @brief Largest resident size of the process seen at the end of a call of
+ * a stage, zero unless the resident size is sampled
+ * @param stage Instrumentation::STAGE
+ */
+size_t InstrumentationReport::peak_rss(const int stage) const {
+  check_stage(stage);
+  return m_peak_rss[stage];
+}
+
+/**
+ * @brief Hardware counter summed over the calls of a stage, zero unless the
+ * counters are sampled
+ * @param stage Instrumentation::STAGE
+ * @param counter Instrumentation::COUNTER
+ */
+uint64_t InstrumentationReport::counter(const int stage,
+                                        const int counter) const {
+  check_stage(stage);
+  check_counter(counter);
+  return m_hardware[stage][counter];
+}
+
+/**
+ * @brief Instructions retired per cpu cycle in a stage, zero when no cycles
+ * were counted
+ * @param stage Instrumentation::STAGE
+ */
+double InstrumentationReport::instructions_per_cycle(const int stage) const {
+  const auto cycles = this->counter(stage, Instrumentation::CYCLES);
+  if (cycles == 0) return 0.0;
+  return static_cast<double>(
+             this->counter(stage, Instrumentation::INSTRUCTIONS)) /
+         static_cast<double>(cycles);
+}
+
+/**
+ * @brief Cache or branch misses per thousand instructions in a stage, zero
+ * when no instructions were counted
+ * @param stage Instrumentation::STAGE
+ * @param counter Instrumentation::LLC_MISSES or BRANCH_MISSES
+ */
+double InstrumentationReport::misses_per_kilo_instruction(
+    const int stage, const int counter) const {
+  const auto instructions = this->counter(stage, Instrumentation::INSTRUCTIONS);
+  if (instructions == 0) return 0.0;
+  return 1000.0 * static_cast<double>(this->counter(stage, counter)) /
+         static_cast<double>(instructions);
+}
+
+/**
+ * @brief Bytes held in a memory category when the report was taken
+ * @param memory Instrumentation::MEMORY
+ */
+size_t InstrumentationReport::bytes(const int memory) const {
+  check_memory(memory);
+  return m_memory[memory].bytes;
+}
+
+/**
+ * @brief Largest number of bytes held at once in a memory category
+ * @param memory Instrumentation::MEMORY
+ */
+size_t InstrumentationReport::peak_bytes(const int memory) const {
+  check_memory(memory);
+  return m_memory[memory].peak;
+}
+
+/**
+ * @brief Number of times an event happened
+ * @param event Instrumentation::EVENT
+ */
+size_t InstrumentationReport::events(const int event) const {
+  check_event(event);
+  return m_events[event];
+}
+
+/**
+ * @brief Peak resident size of the process since it started, sampled or not
+ */
+size_t InstrumentationReport::process_peak_rss() const {
+  return m_process_peak_rss;
+}
+
+/**
+ * @brief Totals accumulated between an earlier report and this one
+ * @param earlier report taken before this one
+ * @return difference of the two reports. Memory is kept from this report
+ */
+InstrumentationReport InstrumentationReport::since(
+    const InstrumentationReport &earlier) const {
+  InstrumentationReport r = *this;
+  for (size_t i = 0; i < c_stages; ++i) {
+    r.m_totals[i].calls = m_totals[i].calls - earlier.m_totals[i].calls;
+    r.m_totals[i].nanoseconds =
+        m_totals[i].nanoseconds - earlier.m_totals[i].nanoseconds;
+    r.m_totals[i].items = m_totals[i].items - earlier.m_totals[i].items;
+    for (size_t k = 0; k < c_counters; ++k) {
+      r.m_hardware[i][k] = m_hardware[i][k] - earlier.m_hardware[i][k];
+    }
+  }
+  for (size_t i = 0; i < c_events; ++i) {
+    r.m_events[i] = m_events[i] - earlier.m_events[i];
+  }
+  return r;
+}
+
+/**
+ * @brief Names of the stages, in the order of Instrumentation::STAGE
+ */
+std::vector<std::string> Instrumentation::names() {
+  return {"file_open",    "message_index", "decode",      "triangulate",
+          "locate",       "interpolate",   "format",      "compress",
+          "netcdf_write", "file_write",    "source_wait", "decode_wait",
+          "output_wait"};
+}
+
+/**
+ * @brief Names of the memory categories, in the order of
+ * Instrumentation::MEMORY
+ */
+std::vector<std::string> Instrumentation::memory_names() {
+  return {"grid",   "triangulation", "weights",    "source",
+          "output", "compression",   "snapshots"};
+}
+
+/**
+ * @brief Names of the events, in the order of Instrumentation::EVENT
+ */
+std::vector<std::string> Instrumentation::event_names() {
+  return {"weight_shared",    "weight_loaded",  "weight_built",
+          "weight_aligned",   "snapshot_hit",   "snapshot_miss",
+          "snapshot_outside", "locator_loaded", "shared_field_attached"};
+}
+
+/**
+ * @brief Names of the hardware counters, in the order of
+ * Instrumentation::COUNTER
+ */
+std::vector<std::string> Instrumentation::counter_names() {
+  return {"cycles", "instructions", "llc_misses", "branch_misses"};
+}
+
+/**
+ * @brief Adds items to a stage without timing it
+ * @param stage stage to add to
+ * @param items number of items
+ */
+void Instrumentation::count(const STAGE stage, const size_t items) {
+  s_counters[stage].items.fetch_add(items, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Counts occurrences of an event
+ * @param event event that happened
+ * @param n number of occurrences
+ */
+void Instrumentation::count_event(const EVENT event, const size_t n) {
+  s_events[event].fetch_add(n, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Adds one timed call to a stage
+ * @param stage stage to add to
+ * @param elapsed time spent in the call
+ * @param items number of items processed by the call
+ */
+void Instrumentation::record(const STAGE stage,
+                             const std::chrono::nanoseconds elapsed,
+                             const size_t items) {
+  auto &c = s_counters[stage];
+  c.calls.fetch_add(1, std::memory_order_relaxed);
+  c.nanoseconds.fetch_add(elapsed.count(), std::memory_order_relaxed);
+  if (items != 0) c.items.fetch_add(items, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Current totals of every stage since the process started or the
+ * last reset
+ */
+InstrumentationReport Instrumentation::report() {
+  InstrumentationReport r;
+  for (size_t i = 0; i < c_stages; ++i) {
+    r.m_totals[i].calls = s_counters[i].calls.load(std::memory_order_relaxed);
+    r.m_totals[i].nanoseconds =
+        s_counters[i].nanoseconds.load(std::memory_order_relaxed);
+    r.m_totals[i].items = s_counters[i].items.load(std::memory_order_relaxed);
+    r.m_peak_rss[i] = s_stage_rss[i].load(std::memory_order_relaxed);
+    for (size_t k = 0; k < c_counters; ++k) {
+      r.m_hardware[i][k] =
+          s_counters[i].hardware[k].load(std::memory_order_relaxed);
+    }
+  }
+  for (size_t i = 0; i < c_events; ++i) {
+    r.m_events[i] = s_events[i].load(std::memory_order_relaxed);
+  }
+  for (size_t i = 0; i < c_memory; ++i) {
+    //...Transiently negative while another thread moves bytes between
+    // trackers
+    const auto bytes = s_memory[i].bytes.load(std::memory_order_relaxed);
+    r.m_memory[i].bytes = static_cast<size_t>(std::max(bytes, 0LL));
+    r.m_memory[i].peak =
+        static_cast<size_t>(s_memory[i].peak.load(std::memory_order_relaxed));
+  }
+  r.m_process_peak_rss = Instrumentation::peak_rss();
+  return r;
+}
+
+/**
+ * @brief Clears the totals of every stage and the resident size peaks.
+ * Bytes still held are kept, and become the peak of their category
+ */
+void Instrumentation::reset() {
+  for (auto &c : s_counters) {
+    c.calls = 0;
+    c.nanoseconds = 0;
+    c.items = 0;
+    for (auto &h : c.hardware) h = 0;
+  }
+  for (auto &r : s_stage_rss) r = 0;
+  for (auto &e : s_events) e = 0;
+  for (auto &m : s_memory) m.peak = m.bytes.load();
+}
+
+/**
+ * @brief Adds bytes to a memory category, normally through a MemoryTracker
+ * @param memory category
+ * @param bytes bytes allocated
+ */
+void Instrumentation::allocate(const MEMORY memory, const size_t bytes) {
+  if (bytes == 0) return;
+  auto &m = s_memory[memory];
+  const auto held =
+      m.bytes.fetch_add(static_cast<long long>(bytes),
+                        std::memory_order_relaxed) +
+      static_cast<long long>(bytes);
+  store_max(m.peak, held);
+}
+
+/**
+ * @brief Removes bytes from a memory category
+ * @param memory category
+ * @param bytes bytes released
+ */
+void Instrumentation::release(const MEMORY memory, const size_t bytes) {
+  if (bytes == 0) return;
+  s_memory[memory].bytes.fetch_sub(static_cast<long long>(bytes),
+                                   std::memory_order_relaxed);
+}
+
+/**
+ * @brief Selects whether timed scopes sample the resident size of the
+ * process as they end
+ * @param value true to sample
+ */
+void Instrumentation::set_rss_sampling(const bool value) {
+  s_rss_sampling = value;
+}
+
+bool Instrumentation::rss_sampling() {
+  return s_rss_sampling.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Records the current resident size against a stage
+ * @param stage stage that just ended a call
+ */
+void Instrumentation::sample_rss(const STAGE stage) {
+  store_max(s_stage_rss[stage], Instrumentation::current_rss());
+}
+
+/**
+ * @brief Current resident size of the process in bytes. Platforms without
+ * /proc report the peak resident size instead
+ */
+size_t Instrumentation::current_rss() {
+#ifdef __linux__
+  FILE *f = std::fopen("/proc/self/statm", "r");
+  if (f != nullptr) {
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    const int n = std::fscanf(f, "%lu %lu", &size, &resident);
+    std::fclose(f);
+    if (n == 2) {
+      return static_cast<size_t>(resident) *
+             static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+  }
+#endif
+  return Instrumentation::peak_rss();
+}
+
+/**
+ * @brief Peak resident size of the process in bytes since it started
+ */
+size_t Instrumentation::peak_rss() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return static_cast<size_t>(usage.ru_maxrss);
+#else
+  return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+/**
+ * @brief Selects whether timed scopes read the hardware counters of their
+ * thread
+ * @param value true to sample
+ */
+void Instrumentation::set_counter_sampling(const bool value) {
+  s_counter_sampling = value;
+}
+
+bool Instrumentation::counter_sampling() {
+  return s_counter_sampling.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Whether the hardware counters can be opened on the calling thread
+ */
+bool Instrumentation::counters_available() {
+  return thread_counters().available();
+}
+
+/**
+ * @brief Reads the hardware counters of the calling thread. The first
+ * sampling fails with a warning where the counters cannot be opened
+ * @param counters current values, which only their differences give meaning
+ * @return false if the counters are unavailable
+ */
+bool Instrumentation::read_counters(Counters &counters) {
+  if (thread_counters().read(counters)) return true;
+  std::call_once(s_counter_warning, []() {
+    Logging::warning(
+        "Hardware counters are unavailable, stages will count none. See "
+        "/proc/sys/kernel/perf_event_paranoid");
+  });
+  return false;
+}
+
+/**
+ * @brief Adds the hardware counters since an earlier read to a stage
+ * @param stage stage that just ended a call
+ * @param counters values read as the call began, replaced by the counts of
+ * the call
+ * @return false if the counters could not be read
+ */
+bool Instrumentation::record_counters(const STAGE stage, Counters &counters) {
+  Counters end{};
+  if (!Instrumentation::read_counters(end)) return false;
+  auto &c = s_counters[stage];
+  for (size_t k = 0; k < c_counters; ++k) {
+    counters[k] = end[k] - counters[k];
+    c.hardware[k].fetch_add(counters[k], std::memory_order_relaxed);
+  }
+  return true;
+}
+
+/**
+ * @brief Starts recording an event for every timed scope, dropping any
+ * events recorded before
+ * @param events_per_thread events kept per thread. Older events are
+ * overwritten once a thread has recorded more
+ */
+void Instrumentation::start_trace(const size_t events_per_thread) {
+  std::unique_lock<std::mutex> lock(s_trace_mutex);
+  s_trace_capacity = std::max<size_t>(events_per_thread, 1);
+  //...Buffers held only here belong to threads that have exited
+  s_trace_buffers.erase(
+      std::remove_if(s_trace_buffers.begin(), s_trace_buffers.end(),
+                     [](const auto &b) { return b.use_count() == 1; }),
+      s_trace_buffers.end());
+  for (auto &b : s_trace_buffers) {
+    std::unique_lock<std::mutex> buffer_lock(b->mutex);
+    b->events.clear();
+    b->events.shrink_to_fit();
+    b->events.reserve(s_trace_capacity);
+    b->capacity = s_trace_capacity;
+    b->next = 0;
+    b->wrapped = false;
+  }
+  s_trace_origin = std::chrono::steady_clock::now();
+  s_tracing = true;
+}
+
+/**
+ * @brief Stops recording events. Recorded events are kept for write_trace
+ */
+void Instrumentation::stop_trace() { s_tracing = false; }
+
+bool Instrumentation::tracing() {
+  return s_tracing.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Records one event in the ring buffer of the calling thread
+ * @param stage stage of the event
+ * @param begin time the event began
+ * @param end time the event ended
+ * @param counters hardware counts of the event, if they were sampled
+ */
+void Instrumentation::trace(const STAGE stage,
+                            const std::chrono::steady_clock::time_point begin,
+                            const std::chrono::steady_clock::time_point end,
+                            const Counters *counters) {
+  auto &b = thread_trace_buffer();
+  std::unique_lock<std::mutex> lock(b.mutex);
+  const size_t capacity = b.capacity;
+  if (capacity == 0) return;
+  const TraceEvent event{
+      static_cast<int>(stage),
+      std::chrono::duration_cast<std::chrono::nanoseconds>(begin -
+                                                           s_trace_origin)
+          .count(),
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+          .count(),
+      counters != nullptr, counters ? *counters : Counters{}};
+  if (b.events.size() < capacity) {
+    b.events.push_back(event);
+  } else {
+    b.events[b.next] = event;
+    b.wrapped = true;
+  }
+  b.next = (b.next + 1) % capacity;
+}
+
+/**
+ * @brief Writes the recorded events as a Chrome trace
+ *
+ * Each event is a complete ("X") event named after its stage, with one
+ * timeline per thread. Times are in microseconds since start_trace. Events
+ * with sampled hardware counters carry them, and their instructions per
+ * cycle, as arguments
+ *
+ * @param filename output file
+ */
+void Instrumentation::write_trace(const std::string &filename) {
+  FILE *f = std::fopen(filename.c_str(), "w");
+  if (f == nullptr) {
+    metbuild_throw_exception("Could not open the trace file '" + filename +
+                             "'");
+  }
+  const auto stage_names = Instrumentation::names();
+  const auto counter_names = Instrumentation::counter_names();
+
+  std::unique_lock<std::mutex> lock(s_trace_mutex);
+  std::fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+  bool first = true;
+  for (const auto &b : s_trace_buffers) {
+    std::unique_lock<std::mutex> buffer_lock(b->mutex);
+    std::fprintf(f,
+                 "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", "
+                 "\"pid\": 1, \"tid\": %zu, \"args\": {\"name\": "
+                 "\"metbuild %zu\"}}",
+                 first ? "" : ",", b->thread, b->thread);
+    first = false;
+    const size_t n = b->events.size();
+    const size_t oldest = b->wrapped ? b->next : 0;
+    for (size_t k = 0; k < n; ++k) {
+      const auto &e = b->events[(oldest + k) % n];
+      std::fprintf(f,
+                   ",\n{\"name\": \"%s\", \"cat\": \"metbuild\", "
+                   "\"ph\": \"X\", \"pid\": 1, \"tid\": %zu, "
+                   "\"ts\": %.3f, \"dur\": %.3f",
+                   stage_names[e.stage].c_str(), b->thread,
+                   static_cast<double>(e.begin) * 1e-3,
+                   static_cast<double>(e.duration) * 1e-3);
+      if (e.counted) {
+        std::fprintf(f, ", \"args\": {");
+        for (size_t k = 0; k < c_counters; ++k) {
+          std::fprintf(f, "\"%s\": %llu, ", counter_names[k].c_str(),
+                       static_cast<unsigned long long>(e.counters[k]));
+        }
+        const auto cycles = e.counters[Instrumentation::CYCLES];
+        std::fprintf(
+            f, "\"ipc\": %.3f}",
+            cycles == 0 ? 0.0
+                        : static_cast<double>(
+                              e.counters[Instrumentation::INSTRUCTIONS]) /
+                              static_cast<double>(cycles));
+      }
+      std::fprintf(f, "}");
+    }
+  }
+  std::fprintf(f, "\n]}\n");
+  const bool failed = std::ferror(f) != 0;
+  std::fclose(f);
+  if (failed) {
+    metbuild_throw_exception("Could not write the trace file '" + filename +
+                             "'");
+  }
+}
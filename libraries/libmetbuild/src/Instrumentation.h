@@ -0,0 +1,391 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_INSTRUMENTATION_H_
+#define METBUILD_SRC_INSTRUMENTATION_H_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "MetBuild_Global.h"
+
+namespace MetBuild {
+
+class InstrumentationReport;
+
+/**
+ * @brief Process wide timers and counters for the stages of a build
+ *
+ * Stages are timed with ScopedTimer around coarse units of work, a file,
+ * message, field or record, never per point, so the cost is two clock reads
+ * and a few atomic additions per unit. The item counts are
+ *   FILE_OPEN      files and grib message handles opened
+ *   MESSAGE_INDEX  grib messages indexed
+ *   DECODE         source values decoded
+ *   TRIANGULATE    source points triangulated
+ *   LOCATE         output points located in the source
+ *   INTERPOLATE    output values interpolated
+ *   FORMAT         characters formatted for text output
+ *   COMPRESS       bytes compressed
+ *   NETCDF_WRITE   values written to netCDF files
+ *   FILE_WRITE     bytes written to text and binary output files
+ *   SOURCE_WAIT    none, time waiting for in-memory source files to arrive
+ *   DECODE_WAIT    none, time waiting for files decoded in the background
+ *   OUTPUT_WAIT    none, time waiting for room in an asynchronous writer
+ *
+ * Between start_trace and stop_trace every timed scope is also recorded as
+ * an event in a ring buffer owned by its thread, holding the most recent
+ * events. write_trace dumps them as a Chrome trace, which chrome://tracing
+ * and Perfetto display as one timeline per thread
+ *
+ * The large allocations of the library are counted in bytes per memory
+ * category by MemoryTracker members of the objects holding them
+ *   GRID_MEMORY           output grid point matrices
+ *   TRIANGULATION_MEMORY  source triangulations and locator tables
+ *   WEIGHT_MEMORY         interpolation weights
+ *   SOURCE_MEMORY         decoded source values held by grib files
+ *   OUTPUT_MEMORY         interpolated MeteorologicalData buffers
+ *   COMPRESSION_MEMORY    blocks waiting to be compressed
+ *   SNAPSHOT_MEMORY       snapshots held by the SnapshotStore
+ * together with their peaks. With set_rss_sampling, or METBUILD_SAMPLE_RSS
+ * set to 1, each timed scope also reads the resident size of the process as
+ * it ends and keeps the largest seen per stage. The read costs a few
+ * microseconds, so sampling is off by default
+ *
+ * Cache lookups are counted as events
+ *   WEIGHT_SHARED   weights found in use by another object or warm
+ *   WEIGHT_LOADED   weights read from the on-disk weight cache
+ *   WEIGHT_BUILT    weights triangulated, missing from both caches
+ *   WEIGHT_ALIGNED  weights of an output grid on the source nodes, which
+ *                   are built without locating anything
+ *   SNAPSHOT_HIT    snapshots read from the snapshot cache
+ *   SNAPSHOT_MISS   snapshots looked up in the snapshot cache and decoded
+ *   SNAPSHOT_OUTSIDE snapshots of sources not reaching the output grid,
+ *                   which are filled without decoding
+ *   LOCATOR_LOADED  source triangulations read from the locator cache
+ *   SHARED_FIELD_ATTACHED decoded source fields mapped from the
+ *                   SharedFieldStore instead of decoded
+ *
+ * With set_counter_sampling, or METBUILD_SAMPLE_COUNTERS set to 1, each
+ * timed scope on Linux also reads the hardware counters of its thread
+ *   CYCLES         cpu cycles
+ *   INSTRUCTIONS   instructions retired
+ *   LLC_MISSES     last level cache misses
+ *   BRANCH_MISSES  mispredicted branches
+ * as it begins and ends, and adds the difference to its stage and trace
+ * event. Only the calling thread is counted, so a stage which hands its work
+ * to the thread pool counts the waiting thread, not the workers. The
+ * counters are opened per thread through perf_event_open, which the kernel
+ * may refuse, see /proc/sys/kernel/perf_event_paranoid. Stages then count
+ * nothing
+ */
+class Instrumentation {
+ public:
+  enum STAGE {
+    FILE_OPEN,
+    MESSAGE_INDEX,
+    DECODE,
+    TRIANGULATE,
+    LOCATE,
+    INTERPOLATE,
+    FORMAT,
+    COMPRESS,
+    NETCDF_WRITE,
+    FILE_WRITE,
+    SOURCE_WAIT,
+    DECODE_WAIT,
+    OUTPUT_WAIT,
+    N_STAGES
+  };
+
+  enum MEMORY {
+    GRID_MEMORY,
+    TRIANGULATION_MEMORY,
+    WEIGHT_MEMORY,
+    SOURCE_MEMORY,
+    OUTPUT_MEMORY,
+    COMPRESSION_MEMORY,
+    SNAPSHOT_MEMORY,
+    N_MEMORY
+  };
+
+  enum EVENT {
+    WEIGHT_SHARED,
+    WEIGHT_LOADED,
+    WEIGHT_BUILT,
+    WEIGHT_ALIGNED,
+    SNAPSHOT_HIT,
+    SNAPSHOT_MISS,
+    SNAPSHOT_OUTSIDE,
+    LOCATOR_LOADED,
+    SHARED_FIELD_ATTACHED,
+    N_EVENTS
+  };
+
+  enum COUNTER { CYCLES, INSTRUCTIONS, LLC_MISSES, BRANCH_MISSES, N_COUNTERS };
+
+  using Counters = std::array<uint64_t, N_COUNTERS>;
+
+  /**
+   * @brief Adds the time spent in its scope to a stage
+   */
+  class ScopedTimer {
+   public:
+    explicit ScopedTimer(STAGE stage, size_t items = 0)
+        : m_stage(stage),
+          m_items(items),
+          m_counting(Instrumentation::counter_sampling() &&
+                     Instrumentation::read_counters(m_counters)),
+          m_start(std::chrono::steady_clock::now()) {}
+
+    ~ScopedTimer() {
+      const auto end = std::chrono::steady_clock::now();
+      Instrumentation::record(m_stage, end - m_start, m_items);
+      if (m_counting) {
+        m_counting = Instrumentation::record_counters(m_stage, m_counters);
+      }
+      if (Instrumentation::tracing()) {
+        Instrumentation::trace(m_stage, m_start, end,
+                               m_counting ? &m_counters : nullptr);
+      }
+      if (Instrumentation::rss_sampling()) {
+        Instrumentation::sample_rss(m_stage);
+      }
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+    void add_items(size_t n) { m_items += n; }
+
+   private:
+    STAGE m_stage;
+    size_t m_items;
+    Counters m_counters{};
+    bool m_counting;
+    std::chrono::steady_clock::time_point m_start;
+  };
+
+  /**
+   * @brief Adds the bytes held by an object to a memory category for as
+   * long as the object lives. Copies hold the bytes again, moves take them
+   */
+  class MemoryTracker {
+   public:
+    explicit MemoryTracker(MEMORY memory, size_t bytes = 0)
+        : m_memory(memory), m_bytes(bytes) {
+      Instrumentation::allocate(m_memory, m_bytes);
+    }
+
+    MemoryTracker(const MemoryTracker &other)
+        : MemoryTracker(other.m_memory, other.m_bytes) {}
+
+    MemoryTracker(MemoryTracker &&other) noexcept
+        : m_memory(other.m_memory), m_bytes(other.m_bytes) {
+      other.m_bytes = 0;
+    }
+
+    MemoryTracker &operator=(const MemoryTracker &other) {
+      if (this != &other) {
+        Instrumentation::release(m_memory, m_bytes);
+        m_memory = other.m_memory;
+        m_bytes = other.m_bytes;
+        Instrumentation::allocate(m_memory, m_bytes);
+      }
+      return *this;
+    }
+
+    MemoryTracker &operator=(MemoryTracker &&other) noexcept {
+      if (this != &other) {
+        Instrumentation::release(m_memory, m_bytes);
+        m_memory = other.m_memory;
+        m_bytes = other.m_bytes;
+        other.m_bytes = 0;
+      }
+      return *this;
+    }
+
+    ~MemoryTracker() { Instrumentation::release(m_memory, m_bytes); }
+
+    /**
+     * @brief Changes the bytes held
+     * @param bytes bytes now held by the owning object
+     */
+    void set(size_t bytes) {
+      if (bytes > m_bytes) {
+        Instrumentation::allocate(m_memory, bytes - m_bytes);
+      } else {
+        Instrumentation::release(m_memory, m_bytes - bytes);
+      }
+      m_bytes = bytes;
+    }
+
+    NODISCARD size_t bytes() const { return m_bytes; }
+
+   private:
+    MEMORY m_memory;
+    size_t m_bytes;
+  };
+
+  NODISCARD static std::vector<std::string> METBUILD_EXPORT names();
+
+  NODISCARD static std::vector<std::string> METBUILD_EXPORT memory_names();
+
+  NODISCARD static std::vector<std::string> METBUILD_EXPORT event_names();
+
+  NODISCARD static std::vector<std::string> METBUILD_EXPORT counter_names();
+
+  static void METBUILD_EXPORT count(STAGE stage, size_t items);
+
+  static void METBUILD_EXPORT count_event(EVENT event, size_t n = 1);
+
+  static void METBUILD_EXPORT record(STAGE stage,
+                                     std::chrono::nanoseconds elapsed,
+                                     size_t items = 0);
+
+  NODISCARD static InstrumentationReport METBUILD_EXPORT report();
+
+  static void METBUILD_EXPORT reset();
+
+  static void METBUILD_EXPORT start_trace(size_t events_per_thread = 65536);
+
+  static void METBUILD_EXPORT stop_trace();
+
+  NODISCARD static bool METBUILD_EXPORT tracing();
+
+  static void METBUILD_EXPORT
+  trace(STAGE stage, std::chrono::steady_clock::time_point begin,
+        std::chrono::steady_clock::time_point end,
+        const Counters *counters = nullptr);
+
+  static void METBUILD_EXPORT write_trace(const std::string &filename);
+
+  static void METBUILD_EXPORT allocate(MEMORY memory, size_t bytes);
+
+  static void METBUILD_EXPORT release(MEMORY memory, size_t bytes);
+
+  static void METBUILD_EXPORT set_rss_sampling(bool value);
+
+  NODISCARD static bool METBUILD_EXPORT rss_sampling();
+
+  static void METBUILD_EXPORT sample_rss(STAGE stage);
+
+  NODISCARD static size_t METBUILD_EXPORT current_rss();
+
+  NODISCARD static size_t METBUILD_EXPORT peak_rss();
+
+  static void METBUILD_EXPORT set_counter_sampling(bool value);
+
+  NODISCARD static bool METBUILD_EXPORT counter_sampling();
+
+  NODISCARD static bool METBUILD_EXPORT counters_available();
+
+  NODISCARD static bool METBUILD_EXPORT read_counters(Counters &counters);
+
+  NODISCARD static bool METBUILD_EXPORT record_counters(STAGE stage,
+                                                        Counters &counters);
+};
+
+/**
+ * @brief Totals of the instrumented stages, taken with
+ * Instrumentation::report()
+ *
+ * Each stage holds the number of timed calls, the time spent in them and a
+ * stage specific item count. Times are summed over threads, so stages run by
+ * several domains at once can add up to more than the wall time
+ *
+ * Hardware counters are totals like the times, and are zero unless they
+ * were sampled
+ *
+ * Memory is a level, not a total, so a report taken with since() holds the
+ * bytes and peaks of the later report. Peaks cover the time since the
+ * process started or the last Instrumentation::reset()
+ */
+class InstrumentationReport {
+ public:
+  METBUILD_EXPORT InstrumentationReport();
+
+  NODISCARD size_t METBUILD_EXPORT calls(int stage) const;
+
+  NODISCARD double METBUILD_EXPORT seconds(int stage) const;
+
+  NODISCARD size_t METBUILD_EXPORT items(int stage) const;
+
+  NODISCARD size_t METBUILD_EXPORT peak_rss(int stage) const;
+
+  NODISCARD uint64_t METBUILD_EXPORT counter(int stage, int counter) const;
+
+  NODISCARD double METBUILD_EXPORT instructions_per_cycle(int stage) const;
+
+  NODISCARD double METBUILD_EXPORT misses_per_kilo_instruction(
+      int stage, int counter) const;
+
+  NODISCARD size_t METBUILD_EXPORT bytes(int memory) const;
+
+  NODISCARD size_t METBUILD_EXPORT peak_bytes(int memory) const;
+
+  NODISCARD size_t METBUILD_EXPORT events(int event) const;
+
+  NODISCARD size_t METBUILD_EXPORT process_peak_rss() const;
+
+  NODISCARD InstrumentationReport METBUILD_EXPORT
+  since(const InstrumentationReport &earlier) const;
+
+ private:
+  friend class Instrumentation;
+
+  struct Memory {
+    size_t bytes = 0;
+    size_t peak = 0;
+  };
+
+  struct Totals {
+    size_t calls = 0;
+    long long nanoseconds = 0;
+    size_t items = 0;
+  };
+
+  const Totals &totals(int stage) const;
+
+  std::array<Totals, Instrumentation::N_STAGES> m_totals;
+  std::array<size_t, Instrumentation::N_STAGES> m_peak_rss;
+  std::array<Instrumentation::Counters, Instrumentation::N_STAGES>
+      m_hardware;
+  std::array<Memory, Instrumentation::N_MEMORY> m_memory;
+  std::array<size_t, Instrumentation::N_EVENTS> m_events;
+  size_t m_process_peak_rss;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_INSTRUMENTATION_H_
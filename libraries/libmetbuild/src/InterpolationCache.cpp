@@ -0,0 +1,241 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "InterpolationCache.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+
+#include "Hash.h"
+#include "Logging.h"
+#include "SharedCache.h"
+#include "Utilities.h"
+#include "WeightFile.h"
+#include "boost/filesystem.hpp"
+
+using namespace MetBuild;
+
+namespace {
+size_t payload_size(size_t n, size_t mask_words) {
+  return 3 * n * sizeof(InterpolationWeights::index_type) +
+         3 * n * sizeof(InterpolationWeights::weight_type) +
+         mask_words * sizeof(uint64_t);
+}
+
+std::mutex s_directory_mutex;
+std::string s_directory = []() {
+  const char *env = std::getenv("METBUILD_WEIGHT_CACHE");
+  return env ? std::string(env) : std::string();
+}();
+
+std::atomic<unsigned> s_weight_precision = []() {
+  const char *env = std::getenv("METBUILD_WEIGHT_PRECISION");
+  const auto bits = env ? std::strtoul(env, nullptr, 10) : 0;
+  return bits == 16 || bits == 32 ? static_cast<unsigned>(bits) : 0U;
+}();
+
+//...The delta encoded indices compress well and zstd decodes quickly, so
+// the blocks are compressed whenever the library is built with it
+std::atomic<StreamCompression::Codec> s_compression = []() {
+  auto codec = StreamCompression::ZSTD;
+  if (const char *env = std::getenv("METBUILD_WEIGHT_COMPRESSION")) {
+    const std::string name(env);
+    for (const auto c : {StreamCompression::NONE, StreamCompression::GZIP,
+                         StreamCompression::ZSTD, StreamCompression::LZ4}) {
+      if (StreamCompression::name(c) == name) codec = c;
+    }
+  }
+  return StreamCompression::available(codec) ? codec
+                                             : StreamCompression::NONE;
+}();
+
+//...Keys are checked against the one recorded in the file, which catches
+// weights copied or renamed under the wrong name
+uint64_t key_value(const std::string &key) { return Hash().add(key).value(); }
+
+SharedCache<const InterpolationData> s_shared(
+    "weights", [](const InterpolationData &data) {
+      const auto &w = data.interpolation();
+      return payload_size(w.size(), w.mask_size());
+    });
+}  // namespace
+
+void InterpolationCache::setDirectory(const std::string &directory) {
+  std::lock_guard<std::mutex> lock(s_directory_mutex);
+  s_directory = directory;
+}
+
+std::string InterpolationCache::directory() {
+  std::lock_guard<std::mutex> lock(s_directory_mutex);
+  return s_directory;
+}
+
+bool InterpolationCache::enabled() { return !directory().empty(); }
+
+/**
+ * @brief Sets the precision the weights are written to the cache in. Zero,
+ * the default, keeps them exactly so that cached and generated weights give
+ * identical builds. 16 or 32 quantizes them within the range of each band of
+ * rows, to within 1/131070 or 1/8589934590 of that range. The default may
+ * also be set with the METBUILD_WEIGHT_PRECISION environment variable
+ * @param bits 0, 16 or 32
+ */
+void InterpolationCache::setWeightPrecision(const unsigned bits) {
+  if (bits != 0 && bits != 16 && bits != 32) {
+    metbuild_throw_exception("Weights can only be quantized to 16 or 32 bits");
+  }
+  s_weight_precision = bits;
+}
+
+unsigned InterpolationCache::weightPrecision() { return s_weight_precision; }
+
+/**
+ * @brief Sets the codec the weight files are compressed with. Defaults to
+ * zstd when the library is built with it, or with the
+ * METBUILD_WEIGHT_COMPRESSION environment variable
+ * @param codec codec, which must be available
+ */
+void InterpolationCache::setCompression(
+    const StreamCompression::Codec codec) {
+  if (!StreamCompression::available(codec)) {
+    metbuild_throw_exception("The library was built without " +
+                             StreamCompression::name(codec) +
+                             " compression");
+  }
+  s_compression = codec;
+}
+
+StreamCompression::Codec InterpolationCache::compression() {
+  return s_compression;
+}
+
+/**
+ * @brief Generates the key of the weights from a source grid onto an output
+ * grid
+ * @param source fingerprint of the source grid
+ * @param bounding_region boundary of the source grid
+ * @param grid fingerprint of the output grid positions
+ * @param convention coordinate convention of the source grid
+ * @param method hash of any non-default interpolation settings, zero for
+ * triangular weights
+ * @return key
+ */
+std::string InterpolationCache::key(
+    const GridFingerprint source,
+    const std::vector<MetBuild::Point> &bounding_region,
+    const GridFingerprint grid, COORDINATE_CONVENTION convention,
+    uint64_t method) {
+  Hash h;
+  h.add(source).add(bounding_region).add(static_cast<int>(convention));
+  if (method != 0) h.add(method);
+  //...Single and double precision builds keep separate weight files, as do
+  // quantized weights and each version of the file format
+  h.add(sizeof(InterpolationWeights::weight_type));
+  h.add(WeightFile::version());
+  if (weightPrecision() != 0) h.add(weightPrecision());
+  h.add(grid);
+  return h.hex();
+}
+
+std::string InterpolationCache::filename(const std::string &key) {
+  return (boost::filesystem::path(directory()) / ("weights_" + key + ".bin"))
+      .string();
+}
+
+/**
+ * @brief Loads a set of interpolation weights from the cache
+ * @param key key generated by InterpolationCache::key
+ * @return weights, or nullptr if none are cached or the file is unusable
+ */
+std::unique_ptr<InterpolationWeights> InterpolationCache::load(
+    const std::string &key) {
+  if (!enabled()) return nullptr;
+  const auto fn = filename(key);
+  if (!Utilities::exists(fn)) return nullptr;
+
+  const auto file = WeightFile::open(fn);
+  if (!file) return nullptr;
+  if (file->key() != key_value(key)) {
+    Logging::warning("Ignoring interpolation cache file " + fn +
+                     " written for other weights");
+    return nullptr;
+  }
+  auto weights = file->read();
+  if (!weights) {
+    Logging::warning("Ignoring damaged interpolation cache file " + fn);
+  }
+  return weights;
+}
+
+/**
+ * @brief Writes a set of interpolation weights to the cache. The file is
+ * written under a temporary name and renamed so that concurrent readers
+ * never see a partial file
+ * @param key key generated by InterpolationCache::key
+ * @param weights weights to store
+ * @param identity grids and method the weights were built for, recorded in
+ * the file header
+ */
+void InterpolationCache::store(const std::string &key,
+                               const InterpolationWeights &weights,
+                               const WeightFile::Identity &identity) {
+  if (!enabled()) return;
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(directory(), ec);
+
+  const auto fn = filename(key);
+  const auto tmp = fn + "." + boost::filesystem::unique_path().string();
+  WeightFile::Options options;
+  options.weight_bits = weightPrecision();
+  options.codec = compression();
+  if (!WeightFile::write(tmp, weights, key_value(key), identity, options)) {
+    Logging::warning("Could not write interpolation cache file " + fn);
+    boost::filesystem::remove(tmp, ec);
+    return;
+  }
+  boost::filesystem::rename(tmp, fn, ec);
+  if (ec) {
+    boost::filesystem::remove(tmp, ec);
+  }
+}
+
+/**
+ * @brief Returns the weights in use for a key, building them only when no
+ * other object holds them
+ *
+ * @param key key generated by InterpolationCache::key
+ * @param build generates the weights when they are not held
+ * @return shared weights
+ */
+std::shared_ptr<const InterpolationData> InterpolationCache::shared(
+    const std::string &key,
+    const std::function<std::shared_ptr<const InterpolationData>()> &build) {
+  return s_shared.acquire(key, build);
+}
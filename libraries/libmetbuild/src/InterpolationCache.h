@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_INTERPOLATIONCACHE_H_
+#define METBUILD_SRC_INTERPOLATIONCACHE_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CoordinateConvention.h"
+#include "CppAttributes.h"
+#include "GridFingerprint.h"
+#include "InterpolationData.h"
+#include "InterpolationWeights.h"
+#include "Point.h"
+#include "WeightFile.h"
+#include "output/StreamCompression.h"
+
+namespace MetBuild {
+
+/**
+ * @brief On-disk cache of interpolation weights
+ *
+ * Weights are keyed by a hash of the source coordinates, the source
+ * bounding region and the output grid positions so that repeated requests
+ * on the same source and output grids skip the triangulation entirely. The
+ * cache is disabled unless a directory is set, either with setDirectory()
+ * or with the METBUILD_WEIGHT_CACHE environment variable
+ *
+ * Independently of the directory, weights in use are shared in memory so
+ * that every Meteorology object on the same source and output grids, such as
+ * the members of an ensemble, holds a single copy. When the WarmCache is
+ * enabled the weights also stay in memory after their last user, for the
+ * next request on the same grids
+ *
+ * Weights are written in the compact format of WeightFile, exactly by
+ * default or quantized with setWeightPrecision(), and compressed with zstd
+ * when the library is built with it
+ */
+class InterpolationCache {
+ public:
+  static void setDirectory(const std::string &directory);
+
+  NODISCARD static std::string directory();
+
+  NODISCARD static bool enabled();
+
+  static void setWeightPrecision(unsigned bits);
+
+  NODISCARD static unsigned weightPrecision();
+
+  static void setCompression(MetBuild::StreamCompression::Codec codec);
+
+  NODISCARD static MetBuild::StreamCompression::Codec compression();
+
+  NODISCARD static std::string key(
+      MetBuild::GridFingerprint source,
+      const std::vector<MetBuild::Point> &bounding_region,
+      MetBuild::GridFingerprint grid, COORDINATE_CONVENTION convention,
+      uint64_t method = 0);
+
+  NODISCARD static std::unique_ptr<InterpolationWeights> load(
+      const std::string &key);
+
+  static void store(const std::string &key,
+                    const InterpolationWeights &weights,
+                    const WeightFile::Identity &identity = {});
+
+  NODISCARD static std::shared_ptr<const InterpolationData> shared(
+      const std::string &key,
+      const std::function<std::shared_ptr<const InterpolationData>()> &build);
+
+  NODISCARD static std::string filename(const std::string &key);
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_INTERPOLATIONCACHE_H_
@@ -28,45 +28,423 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "InterpolationData.h"
 
+#include <atomic>
+#include <bitset>
+#include <cmath>
+#include <string>
+#include <utility>
+
+#include "Instrumentation.h"
+#include "Logging.h"
+#include "ThreadPool.h"
+
 using namespace MetBuild;
 
+namespace {
+/**
+ * @brief Reports at the debug level how many output cells found a source
+ * stencil. The count is only taken when the message is written
+ * @param weights generated weights
+ * @param located number of cells that were located
+ */
+void log_coverage(const InterpolationWeights& weights, size_t located) {
+  if (!Logging::enabled(Logging::LEVEL_DEBUG)) return;
+  size_t valid = 0;
+  for (size_t k = 0; k < weights.mask_size(); ++k) {
+    valid += std::bitset<64>(weights.mask()[k]).count();
+  }
+  Logging::debug("Interpolation weights: " + std::to_string(valid) + " of " +
+                 std::to_string(weights.size()) + " output cells valid, " +
+                 std::to_string(located) + " located");
+}
+
+//...Distance in degrees within which an output point is taken to be on a
+// source node
+constexpr double c_alignment_tolerance = 1.0e-6;
+
+MetBuild::Point normalize(MetBuild::Point p, COORDINATE_CONVENTION convention) {
+  if (convention == CONVENTION_180) {
+    p.setX((std::fmod(p.x() + 180.0, 360.0)) - 180.0);
+  }
+  return p;
+}
+
+bool on_node(const std::vector<double>& x, const std::vector<double>& y,
+             size_t k, const MetBuild::Point& p) {
+  return std::abs(x[k] - p.x()) <= c_alignment_tolerance &&
+         std::abs(y[k] - p.y()) <= c_alignment_tolerance;
+}
+
+/**
+ * @brief Finds the source node an output point is on
+ * @return index of the node, invalid_point() if the point is on none
+ */
+size_t find_node(const std::vector<double>& x, const std::vector<double>& y,
+                 const MetBuild::Point& p) {
+  for (size_t k = 0; k < x.size(); ++k) {
+    if (on_node(x, y, k, p)) return k;
+  }
+  return Triangulation::invalid_point();
+}
+}  // namespace
+
+/**
+ * @brief Generates weights for every output grid point
+ *
+ * The weights are all that interpolation needs, so the locator is only
+ * kept when requested
+ *
+ * @param triangulation locator for the source grid
+ * @param grid output grid positions
+ * @param convention coordinate convention of the source grid
+ * @param keep_triangulation keep a copy of the locator after the weights are
+ * generated
+ * @param mask cells to compute, indexed like the weights with nonzero for the
+ * cells located. Other cells get no weight. Null to compute every cell
+ * @param cancel token checked before each row is located, may be null
+ */
 InterpolationData::InterpolationData(const Triangulation& triangulation,
                                      const MetBuild::Grid::grid& grid,
+                                     COORDINATE_CONVENTION convention,
+                                     bool keep_triangulation,
+                                     const std::vector<uint8_t>* mask,
+                                     const CancelToken* cancel)
+    : m_triangulation(keep_triangulation
+                          ? std::make_shared<const Triangulation>(triangulation)
+                          : nullptr),
+      m_convention(convention),
+      m_weights(
+          generate_interpolation_weight(triangulation, grid, mask, cancel)) {}
+
+/**
+ * @brief Generates weights for a source grid which is a translation of the
+ * grid an earlier set of weights was located on
+ * @param triangulation locator for the translated source grid
+ * @param grid output grid positions
+ * @param translation earlier weights and the offset of the source grid
+ * @param convention coordinate convention of the source grid
+ * @param keep_triangulation keep a copy of the locator after the weights are
+ * generated
+ * @param mask cells to compute, null to compute every cell
+ * @param cancel token checked before each row is located, may be null
+ */
+InterpolationData::InterpolationData(const Triangulation& triangulation,
+                                     const MetBuild::Grid::grid& grid,
+                                     const Translation& translation,
+                                     COORDINATE_CONVENTION convention,
+                                     bool keep_triangulation,
+                                     const std::vector<uint8_t>* mask,
+                                     const CancelToken* cancel)
+    : m_triangulation(keep_triangulation
+                          ? std::make_shared<const Triangulation>(triangulation)
+                          : nullptr),
+      m_convention(convention),
+      m_weights(generate_translated_weight(triangulation, grid, translation,
+                                           mask, cancel)) {}
+
+/**
+ * @brief Generates weights for an output grid on the nodes of the source
+ * grid. Each cell takes the value of its node, so nothing is located
+ * @param lattice position of the output grid on the source nodes
+ * @param grid output grid positions
+ * @param convention coordinate convention of the source grid
+ * @param mask cells to compute, null to compute every cell
+ */
+InterpolationData::InterpolationData(const Lattice& lattice,
+                                     const MetBuild::Grid::grid& grid,
+                                     COORDINATE_CONVENTION convention,
+                                     const std::vector<uint8_t>* mask)
+    : m_triangulation(nullptr),
+      m_convention(convention),
+      m_weights(generate_lattice_weight(lattice, grid, mask)),
+      m_lattice(lattice) {}
+
+InterpolationData::InterpolationData(InterpolationWeights weights,
                                      COORDINATE_CONVENTION convention)
-    : m_triangulation(triangulation),
-      m_weights(generate_interpolation_weight(grid)),
-      m_convention(convention) {}
+    : m_triangulation(nullptr),
+      m_convention(convention),
+      m_weights(std::move(weights)) {}
 
 const InterpolationWeights& InterpolationData::interpolation() const {
   return m_weights;
 }
 
-InterpolationWeights& InterpolationData::interpolation() { return m_weights; }
-
 const Triangulation& InterpolationData::triangulation() const {
-  return m_triangulation;
+  if (!m_triangulation) {
+    metbuild_throw_exception(
+        "Interpolation data was generated without keeping its "
+        "triangulation");
+  }
+  return *m_triangulation;
+}
+
+bool InterpolationData::hasTriangulation() const {
+  return m_triangulation != nullptr;
 }
 
 COORDINATE_CONVENTION InterpolationData::convention() const {
   return m_convention;
 }
 
+/**
+ * @brief Position of the output grid on the source nodes, set only when the
+ * weights were generated from it
+ */
+const std::optional<InterpolationData::Lattice>& InterpolationData::lattice()
+    const {
+  return m_lattice;
+}
+
+/**
+ * @brief Detects an output grid whose every point is a node of a logically
+ * structured source grid, directly or taking every few nodes
+ *
+ * The first point of the output grid and its two neighbours fix the offset
+ * and the strides, after which every point is checked against the node it
+ * should be on. Output grids which leave the source, or whose points fall
+ * between nodes, are not aligned
+ *
+ * @param x source longitudes, i varying fastest
+ * @param y source latitudes, i varying fastest
+ * @param ni number of points in the i direction
+ * @param nj number of points in the j direction
+ * @param grid output grid positions
+ * @param convention coordinate convention of the source grid
+ * @return position of the output grid on the source nodes, if aligned
+ */
+std::optional<InterpolationData::Lattice> InterpolationData::aligned(
+    const std::vector<double>& x, const std::vector<double>& y, size_t ni,
+    size_t nj, const MetBuild::Grid::grid& grid,
+    COORDINATE_CONVENTION convention) {
+  constexpr auto invalid = Triangulation::invalid_point();
+  if (ni == 0 || nj == 0 || x.size() != ni * nj || y.size() != ni * nj ||
+      grid.empty() || grid[0].empty()) {
+    return std::nullopt;
+  }
+  const size_t rows = grid.size();
+  const size_t cols = grid[0].size();
+
+  const auto origin = find_node(x, y, normalize(grid[0][0], convention));
+  if (origin == invalid) return std::nullopt;
+  Lattice lattice{ni, origin % ni, origin / ni, 0, 0};
+
+  if (cols > 1) {
+    const auto k = find_node(x, y, normalize(grid[0][1], convention));
+    if (k == invalid || k / ni != lattice.j0) return std::nullopt;
+    lattice.di = static_cast<long>(k % ni) - static_cast<long>(lattice.i0);
+  }
+  if (rows > 1) {
+    const auto k = find_node(x, y, normalize(grid[1][0], convention));
+    if (k == invalid || k % ni != lattice.i0) return std::nullopt;
+    lattice.dj = static_cast<long>(k / ni) - static_cast<long>(lattice.j0);
+  }
+
+  //...Both ends of each direction must stay on the source grid
+  const auto last_i = static_cast<long>(lattice.i0) +
+                      static_cast<long>(cols - 1) * lattice.di;
+  const auto last_j = static_cast<long>(lattice.j0) +
+                      static_cast<long>(rows - 1) * lattice.dj;
+  if (last_i < 0 || last_i >= static_cast<long>(ni) || last_j < 0 ||
+      last_j >= static_cast<long>(nj)) {
+    return std::nullopt;
+  }
+
+  for (size_t r = 0; r < rows; ++r) {
+    if (grid[r].size() != cols) return std::nullopt;
+    for (size_t c = 0; c < cols; ++c) {
+      if (!on_node(x, y, lattice.source(r, c),
+                   normalize(grid[r][c], convention))) {
+        return std::nullopt;
+      }
+    }
+  }
+  return lattice;
+}
+
 InterpolationWeights InterpolationData::generate_interpolation_weight(
-    const MetBuild::Grid::grid& grid) {
+    const Triangulation& triangulation, const MetBuild::Grid::grid& grid,
+    const std::vector<uint8_t>* mask, const CancelToken* cancel) {
+  const auto ni = grid.size();
+  const auto nj = grid[0].size();
+  Instrumentation::ScopedTimer timer(Instrumentation::LOCATE);
+  InterpolationWeights weights(nj, ni);
+  std::atomic<size_t> located{0};
+
+  //...Each row is located independently and written to its own slots, so
+  // the rows are generated concurrently
+  ThreadPool::global().parallel_for(0, ni, [&](size_t i) {
+    CancelToken::check(cancel);
+    std::vector<Point> row;
+    std::vector<size_t> columns;
+    if (mask) {
+      row.reserve(nj);
+      for (size_t j = 0; j < nj; ++j) {
+        if ((*mask)[i * nj + j] == 0) continue;
+        row.push_back(grid[i][j]);
+        columns.push_back(j);
+      }
+    } else {
+      row = grid[i];
+    }
+    if (this->convention() == CONVENTION_180) {
+      for (auto &p : row) {
+        p.setX((std::fmod(p.x() + 180.0, 360.0)) - 180.0);
+      }
+    }
+
+    std::vector<InterpolationWeight> located_weights;
+    triangulation.getInterpolationFactors(row, located_weights);
+    located += row.size();
+    if (!mask) {
+      weights.set_row(i, located_weights);
+      return;
+    }
+
+    //...Masked out cells keep no weight and are filled like cells outside
+    // the source
+    std::vector<InterpolationWeight> row_weights(
+        nj, InterpolationWeight({Triangulation::invalid_point(),
+                                 Triangulation::invalid_point(),
+                                 Triangulation::invalid_point()},
+                                {0.0, 0.0, 0.0}));
+    for (size_t k = 0; k < columns.size(); ++k) {
+      row_weights[columns[k]] = located_weights[k];
+    }
+    weights.set_row(i, row_weights);
+  });
+  weights.update_mask();
+  timer.add_items(located.load());
+  log_coverage(weights, located.load());
+  return weights;
+}
+
+/**
+ * @brief Points every cell at its source node with a unit weight. The node
+ * is repeated for the other two vertices so that the kernels only read
+ * values which exist
+ * @param lattice position of the output grid on the source nodes
+ * @param grid output grid positions
+ * @param mask cells to compute, null to compute every cell
+ * @return weights on the source nodes
+ */
+InterpolationWeights InterpolationData::generate_lattice_weight(
+    const Lattice& lattice, const MetBuild::Grid::grid& grid,
+    const std::vector<uint8_t>* mask) {
+  const auto rows = grid.size();
+  const auto cols = grid[0].size();
+  InterpolationWeights weights(cols, rows);
+  for (size_t r = 0; r < rows; ++r) {
+    for (size_t c = 0; c < cols; ++c) {
+      const auto cell = weights.cell(c, r);
+      if (mask && (*mask)[cell] == 0) continue;
+      const auto source =
+          static_cast<InterpolationWeights::index_type>(lattice.source(r, c));
+      for (size_t v = 0; v < 3; ++v) weights.index(v)[cell] = source;
+      weights.weight(0)[cell] = 1;
+    }
+  }
+  weights.update_mask();
+  log_coverage(weights, 0);
+  return weights;
+}
+
+/**
+ * @brief Carries weights over from a source grid the current one is a
+ * translation of
+ *
+ * Cells whose stencil is still inside the source grid keep their weights
+ * with the source indices shifted by the offset. Only the cells that enter
+ * coverage, or whose stencil leaves the grid, are located again
+ *
+ * @param triangulation locator for the translated source grid
+ * @param grid output grid positions
+ * @param translation earlier weights and the offset of the source grid
+ * @param mask cells to compute, null to compute every cell
+ * @param cancel token checked before each row is located, may be null
+ * @return weights on the translated source grid
+ */
+InterpolationWeights InterpolationData::generate_translated_weight(
+    const Triangulation& triangulation, const MetBuild::Grid::grid& grid,
+    const Translation& translation, const std::vector<uint8_t>* mask,
+    const CancelToken* cancel) {
   const auto ni = grid.size();
   const auto nj = grid[0].size();
+  const auto& previous = translation.previous->interpolation();
+  if (previous.ni() != nj || previous.nj() != ni) {
+    metbuild_throw_exception(
+        "Translated weights must be generated on the same output grid");
+  }
+
+  Instrumentation::ScopedTimer timer(Instrumentation::LOCATE);
   InterpolationWeights weights(nj, ni);
-  for (size_t i = 0; i < ni; ++i) {
+  std::atomic<size_t> located{0};
+
+  ThreadPool::global().parallel_for(0, ni, [&](size_t i) {
+    CancelToken::check(cancel);
+    std::vector<InterpolationWeight> row_weights(nj);
+    std::vector<Point> points;
+    std::vector<size_t> columns;
+
     for (size_t j = 0; j < nj; ++j) {
-      auto p = grid[i][j];
+      const auto cell = previous.cell(j, i);
+      if (mask && (*mask)[cell] == 0) {
+        row_weights[j] = InterpolationWeight(
+            {Triangulation::invalid_point(), Triangulation::invalid_point(),
+             Triangulation::invalid_point()},
+            {0.0, 0.0, 0.0});
+        continue;
+      }
+      if (previous.valid(cell)) {
+        std::array<size_t, 3> index{};
+        bool inside = true;
+        for (size_t v = 0; v < 3 && inside; ++v) {
+          const auto source = static_cast<long>(previous.index(v)[cell]);
+          const auto si = source % static_cast<long>(translation.ni) -
+                          translation.offset.di;
+          const auto sj = source / static_cast<long>(translation.ni) -
+                          translation.offset.dj;
+          inside = si >= 0 && si < static_cast<long>(translation.ni) &&
+                   sj >= 0 && sj < static_cast<long>(translation.nj);
+          index[v] = static_cast<size_t>(sj) * translation.ni +
+                     static_cast<size_t>(si);
+        }
+        if (inside) {
+          row_weights[j] = InterpolationWeight(
+              index, {previous.weight(0)[cell], previous.weight(1)[cell],
+                      previous.weight(2)[cell]});
+          continue;
+        }
+      }
 
+      auto p = grid[i][j];
       if (this->convention() == CONVENTION_180) {
         p.setX((std::fmod(p.x() + 180.0, 360.0)) - 180.0);
       }
+      const auto& box = translation.coverage;
+      if (p.x() < box.xmin || p.x() > box.xmax || p.y() < box.ymin ||
+          p.y() > box.ymax) {
+        row_weights[j] = InterpolationWeight(
+            {Triangulation::invalid_point(), Triangulation::invalid_point(),
+             Triangulation::invalid_point()},
+            {0.0, 0.0, 0.0});
+        continue;
+      }
+      points.push_back(p);
+      columns.push_back(j);
+    }
 
-      auto iw = m_triangulation.getInterpolationFactors(p.x(), p.y());
-      weights.set(j, i, iw);
+    if (!points.empty()) {
+      std::vector<InterpolationWeight> located_weights;
+      triangulation.getInterpolationFactors(points, located_weights);
+      for (size_t k = 0; k < columns.size(); ++k) {
+        row_weights[columns[k]] = located_weights[k];
+      }
+      located += points.size();
     }
-  }
+    weights.set_row(i, row_weights);
+  });
+  weights.update_mask();
+  timer.add_items(located.load());
+  log_coverage(weights, located.load());
   return weights;
-}
\ No newline at end of file
+}
@@ -29,6 +29,12 @@
 #ifndef METGET_SRC_INTERPOLATIONDATA_H_
 #define METGET_SRC_INTERPOLATIONDATA_H_
 
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "CancelToken.h"
 #include "CoordinateConvention.h"
 #include "Grid.h"
 #include "InterpolationWeights.h"
@@ -38,24 +44,93 @@ namespace MetBuild {
 
 class InterpolationData {
  public:
+  /**
+   * @brief Weights of an earlier source grid which the current one is a
+   * whole-cell translation of
+   */
+  struct Translation {
+    const InterpolationData *previous;
+    Triangulation::Offset offset;
+    size_t ni;
+    size_t nj;
+    Triangulation::Extent coverage;
+  };
+
+  /**
+   * @brief Position of an output grid whose every point is a node of a
+   * logically structured source grid. Point (r, c) of the output grid is
+   * source node (i0 + c * di, j0 + r * dj), so integer strides describe a
+   * subsampled source
+   */
+  struct Lattice {
+    size_t ni;
+    size_t i0;
+    size_t j0;
+    long di;
+    long dj;
+
+    [[nodiscard]] size_t source(size_t r, size_t c) const {
+      const auto i = static_cast<long>(i0) + static_cast<long>(c) * di;
+      const auto j = static_cast<long>(j0) + static_cast<long>(r) * dj;
+      return static_cast<size_t>(j) * ni + static_cast<size_t>(i);
+    }
+  };
+
   InterpolationData(const Triangulation &triangulation,
                     const MetBuild::Grid::grid &grid,
-                    COORDINATE_CONVENTION convention = CONVENTION_180);
+                    COORDINATE_CONVENTION convention = CONVENTION_180,
+                    bool keep_triangulation = false,
+                    const std::vector<uint8_t> *mask = nullptr,
+                    const MetBuild::CancelToken *cancel = nullptr);
+
+  InterpolationData(const Triangulation &triangulation,
+                    const MetBuild::Grid::grid &grid,
+                    const Translation &translation,
+                    COORDINATE_CONVENTION convention = CONVENTION_180,
+                    bool keep_triangulation = false,
+                    const std::vector<uint8_t> *mask = nullptr,
+                    const MetBuild::CancelToken *cancel = nullptr);
+
+  InterpolationData(const Lattice &lattice, const MetBuild::Grid::grid &grid,
+                    COORDINATE_CONVENTION convention = CONVENTION_180,
+                    const std::vector<uint8_t> *mask = nullptr);
+
+  explicit InterpolationData(InterpolationWeights weights,
+                             COORDINATE_CONVENTION convention = CONVENTION_180);
+
+  static std::optional<Lattice> aligned(
+      const std::vector<double> &x, const std::vector<double> &y, size_t ni,
+      size_t nj, const MetBuild::Grid::grid &grid,
+      COORDINATE_CONVENTION convention = CONVENTION_180);
 
   [[nodiscard]] const InterpolationWeights &interpolation() const;
-  InterpolationWeights &interpolation();
 
   [[nodiscard]] const Triangulation &triangulation() const;
 
+  [[nodiscard]] bool hasTriangulation() const;
+
   [[nodiscard]] COORDINATE_CONVENTION convention() const;
 
+  [[nodiscard]] const std::optional<Lattice> &lattice() const;
+
  private:
   InterpolationWeights generate_interpolation_weight(
-      const MetBuild::Grid::grid &grid);
+      const Triangulation &triangulation, const MetBuild::Grid::grid &grid,
+      const std::vector<uint8_t> *mask, const MetBuild::CancelToken *cancel);
 
-  Triangulation m_triangulation;
-  InterpolationWeights m_weights;
+  InterpolationWeights generate_translated_weight(
+      const Triangulation &triangulation, const MetBuild::Grid::grid &grid,
+      const Translation &translation, const std::vector<uint8_t> *mask,
+      const MetBuild::CancelToken *cancel);
+
+  static InterpolationWeights generate_lattice_weight(
+      const Lattice &lattice, const MetBuild::Grid::grid &grid,
+      const std::vector<uint8_t> *mask);
+
+  std::shared_ptr<const Triangulation> m_triangulation;
   COORDINATE_CONVENTION m_convention;
+  InterpolationWeights m_weights;
+  std::optional<Lattice> m_lattice;
 };
 }  // namespace MetBuild
 #endif  // METGET_SRC_INTERPOLATIONDATA_H_
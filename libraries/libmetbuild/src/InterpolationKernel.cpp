@@ -0,0 +1,611 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "InterpolationKernel.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+//...The vector kernels are compiled for AVX2 whatever the target of the
+// build and are only used when the processor running the library supports
+// it, so one portable library picks the fastest path on every host
+#if defined(__AVX2__)
+#define METBUILD_KERNEL_AVX2 1
+#define METBUILD_TARGET_AVX2
+#elif (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define METBUILD_KERNEL_AVX2 1
+#define METBUILD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define METBUILD_KERNEL_AVX2 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define METBUILD_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define METBUILD_ALWAYS_INLINE inline
+#endif
+
+#if METBUILD_KERNEL_AVX2
+#include <immintrin.h>
+#endif
+
+using namespace MetBuild;
+
+namespace {
+
+bool cpu_has_avx2() {
+#if METBUILD_KERNEL_AVX2 && defined(__AVX2__)
+  return true;
+#elif METBUILD_KERNEL_AVX2
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+//...Selected once when the library is loaded. METBUILD_KERNEL_ISA=generic
+// keeps the portable kernels
+bool default_avx2() {
+  const char *env = std::getenv("METBUILD_KERNEL_ISA");
+  if (env != nullptr && std::strcmp(env, "generic") == 0) return false;
+  return cpu_has_avx2();
+}
+
+std::atomic<bool> s_use_avx2(default_avx2());
+
+inline bool use_avx2() { return s_use_avx2.load(std::memory_order_relaxed); }
+
+using value_t = SourceDataType;
+
+inline bool cell_valid(const Kernel::WeightView &w, size_t c) {
+  return (w.mask[c >> 6] >> (c & 63)) & 1U;
+}
+
+inline value_t interpolate_cell(const Kernel::WeightView &w, size_t c,
+                                const value_t *values) {
+  return w.weight[0][c] * values[w.index[0][c]] +
+         w.weight[1][c] * values[w.index[1][c]] +
+         w.weight[2][c] * values[w.index[2][c]];
+}
+
+template <bool Masked, typename... Policies>
+void fields_generic(size_t cell, size_t n, const Kernel::WeightView &w1,
+                    const Kernel::WeightView &w2,
+                    const Kernel::FieldSet<Policies...> &f,
+                    double time_weight) {
+  constexpr size_t nf = sizeof...(Policies);
+  constexpr std::array<bool, nf> scaled = {Policies::scaled...};
+  const auto tw2 = static_cast<value_t>(time_weight);
+  const auto tw1 = static_cast<value_t>(1.0 - time_weight);
+  for (size_t k = 0; k < n; ++k) {
+    const size_t c = cell + k;
+    if (Masked && (!cell_valid(w1, c) || !cell_valid(w2, c))) {
+      for (size_t v = 0; v < nf; ++v) f.out[v][c] = f.fill[v];
+      continue;
+    }
+    for (size_t v = 0; v < nf; ++v) {
+      value_t a = interpolate_cell(w1, c, f.first[v].values);
+      value_t b = interpolate_cell(w2, c, f.second[v].values);
+      if (scaled[v]) {
+        a *= static_cast<value_t>(f.first[v].scale);
+        b *= static_cast<value_t>(f.second[v].scale);
+      }
+      f.out[v][c] = static_cast<MeteorologicalDataType>(tw1 * a + tw2 * b);
+    }
+  }
+}
+
+#if METBUILD_KERNEL_AVX2
+
+#ifdef METBUILD_SOURCE_FLOAT
+
+//...Single precision sources gather eight cells per instruction
+constexpr size_t c_lanes = 8;
+using vector_t = __m256;
+using lanes_t = __m256i;
+
+METBUILD_TARGET_AVX2 inline vector_t set1(double value) {
+  return _mm256_set1_ps(static_cast<float>(value));
+}
+METBUILD_TARGET_AVX2 inline vector_t add(vector_t a, vector_t b) {
+  return _mm256_add_ps(a, b);
+}
+METBUILD_TARGET_AVX2 inline vector_t mul(vector_t a, vector_t b) {
+  return _mm256_mul_ps(a, b);
+}
+
+METBUILD_TARGET_AVX2 inline vector_t gather_interpolate(
+    const Kernel::WeightView &w, size_t c, const lanes_t &lane_valid,
+    const value_t *values) {
+  vector_t sum = _mm256_setzero_ps();
+  for (int k = 0; k < 3; ++k) {
+    __m256i idx = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(w.index[k] + c));
+    //...Invalid lanes gather from index 0 and are replaced afterwards
+    idx = _mm256_and_si256(idx, lane_valid);
+    const vector_t v = _mm256_i32gather_ps(values, idx, 4);
+    const vector_t wt = _mm256_loadu_ps(w.weight[k] + c);
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(wt, v));
+  }
+  return sum;
+}
+
+METBUILD_TARGET_AVX2 inline lanes_t lane_mask(int bits) {
+  const __m256i bit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+  return _mm256_cmpeq_epi32(
+      _mm256_and_si256(_mm256_set1_epi32(bits), bit), bit);
+}
+
+METBUILD_TARGET_AVX2 inline void store_blend(MeteorologicalDataType *out,
+                                             vector_t value,
+                                             const lanes_t &lanes,
+                                             MeteorologicalDataType fill) {
+  _mm256_storeu_ps(out, _mm256_blendv_ps(_mm256_set1_ps(fill), value,
+                                         _mm256_castsi256_ps(lanes)));
+}
+
+#else
+
+constexpr size_t c_lanes = 4;
+using vector_t = __m256d;
+using lanes_t = __m128i;
+
+METBUILD_TARGET_AVX2 inline vector_t set1(double value) {
+  return _mm256_set1_pd(value);
+}
+METBUILD_TARGET_AVX2 inline vector_t add(vector_t a, vector_t b) {
+  return _mm256_add_pd(a, b);
+}
+METBUILD_TARGET_AVX2 inline vector_t mul(vector_t a, vector_t b) {
+  return _mm256_mul_pd(a, b);
+}
+
+METBUILD_TARGET_AVX2 inline vector_t gather_interpolate(
+    const Kernel::WeightView &w, size_t c, const lanes_t &lane_valid,
+    const value_t *values) {
+  vector_t sum = _mm256_setzero_pd();
+  for (int k = 0; k < 3; ++k) {
+    __m128i idx = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(w.index[k] + c));
+    //...Invalid lanes gather from index 0 and are replaced afterwards
+    idx = _mm_and_si128(idx, lane_valid);
+    const vector_t v = _mm256_i32gather_pd(values, idx, 8);
+    const vector_t wt = _mm256_loadu_pd(w.weight[k] + c);
+    sum = _mm256_add_pd(sum, _mm256_mul_pd(wt, v));
+  }
+  return sum;
+}
+
+METBUILD_TARGET_AVX2 inline lanes_t lane_mask(int bits) {
+  return _mm_set_epi32((bits & 8) ? -1 : 0, (bits & 4) ? -1 : 0,
+                       (bits & 2) ? -1 : 0, (bits & 1) ? -1 : 0);
+}
+
+METBUILD_TARGET_AVX2 inline void store_blend(MeteorologicalDataType *out,
+                                             vector_t value,
+                                             const lanes_t &lanes,
+                                             MeteorologicalDataType fill) {
+#ifdef METBUILD_USE_FLOAT
+  const __m128 f = _mm256_cvtpd_ps(value);
+  const __m128 r =
+      _mm_blendv_ps(_mm_set1_ps(fill), f, _mm_castsi128_ps(lanes));
+  _mm_storeu_ps(out, r);
+#else
+  const __m256d l = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(lanes));
+  _mm256_storeu_pd(out, _mm256_blendv_pd(_mm256_set1_pd(fill), value, l));
+#endif
+}
+
+#endif
+
+//...Validity of c_lanes consecutive cells as a lane mask
+inline int valid_lanes(const Kernel::WeightView &w1,
+                       const Kernel::WeightView &w2, size_t c) {
+  int bits = 0;
+  for (size_t k = 0; k < c_lanes; ++k) {
+    bits |= (cell_valid(w1, c + k) && cell_valid(w2, c + k)) << k;
+  }
+  return bits;
+}
+
+template <bool Masked, typename... Policies>
+METBUILD_TARGET_AVX2 void fields_avx2(size_t cell, size_t n,
+                                      const Kernel::WeightView &w1,
+                                      const Kernel::WeightView &w2,
+                                      const Kernel::FieldSet<Policies...> &f,
+                                      double time_weight) {
+  constexpr size_t nf = sizeof...(Policies);
+  constexpr std::array<bool, nf> scaled = {Policies::scaled...};
+  constexpr int all_lanes = (1 << c_lanes) - 1;
+  const vector_t tw2 = set1(time_weight);
+  const vector_t tw1 = set1(1.0 - time_weight);
+
+  size_t k = 0;
+  for (; k + c_lanes <= n; k += c_lanes) {
+    const size_t c = cell + k;
+    const int bits = Masked ? valid_lanes(w1, w2, c) : all_lanes;
+    if (bits == 0) {
+      for (size_t v = 0; v < nf; ++v) {
+        std::fill(f.out[v] + c, f.out[v] + c + c_lanes, f.fill[v]);
+      }
+      continue;
+    }
+    const lanes_t lanes = lane_mask(bits);
+    for (size_t v = 0; v < nf; ++v) {
+      vector_t a = gather_interpolate(w1, c, lanes, f.first[v].values);
+      vector_t b = gather_interpolate(w2, c, lanes, f.second[v].values);
+      if (scaled[v]) {
+        a = mul(a, set1(f.first[v].scale));
+        b = mul(b, set1(f.second[v].scale));
+      }
+      store_blend(f.out[v] + c, add(mul(tw1, a), mul(tw2, b)), lanes,
+                  f.fill[v]);
+    }
+  }
+  fields_generic<Masked>(cell + k, n - k, w1, w2, f, time_weight);
+}
+
+#endif
+
+template <bool Masked, typename... Policies>
+void fields(size_t cell, size_t n, const Kernel::WeightView &w1,
+            const Kernel::WeightView &w2,
+            const Kernel::FieldSet<Policies...> &f, double time_weight) {
+#if METBUILD_KERNEL_AVX2
+  if (use_avx2()) {
+    fields_avx2<Masked>(cell, n, w1, w2, f, time_weight);
+    return;
+  }
+#endif
+  fields_generic<Masked>(cell, n, w1, w2, f, time_weight);
+}
+
+//...The blends are plain loops. They are inlined into a copy compiled for
+// AVX2 so the compiler vectorizes them at the full width of the host
+METBUILD_ALWAYS_INLINE void blend_cells(size_t n,
+                                        const MeteorologicalDataType *a,
+                                        const MeteorologicalDataType *b,
+                                        double time_weight,
+                                        MeteorologicalDataType *out) {
+  const auto tw2 = static_cast<MeteorologicalDataType>(time_weight);
+  const auto tw1 = static_cast<MeteorologicalDataType>(1.0 - time_weight);
+  for (size_t k = 0; k < n; ++k) {
+    out[k] = tw1 * a[k] + tw2 * b[k];
+  }
+}
+
+#if METBUILD_KERNEL_AVX2
+METBUILD_TARGET_AVX2 void blend_cells_avx2(size_t n,
+                                           const MeteorologicalDataType *a,
+                                           const MeteorologicalDataType *b,
+                                           double time_weight,
+                                           MeteorologicalDataType *out) {
+  blend_cells(n, a, b, time_weight, out);
+}
+#endif
+
+void blend_dispatch(size_t n, const MeteorologicalDataType *a,
+                    const MeteorologicalDataType *b, double time_weight,
+                    MeteorologicalDataType *out) {
+#if METBUILD_KERNEL_AVX2
+  if (use_avx2()) {
+    blend_cells_avx2(n, a, b, time_weight, out);
+    return;
+  }
+#endif
+  blend_cells(n, a, b, time_weight, out);
+}
+
+//...Lanes are kept apart so the reductions vectorize, and the lane sums are
+// folded into the compensated total once per block
+constexpr size_t c_reduce_lanes = 8;
+constexpr size_t c_reduce_block = 4096;
+
+template <typename Value>
+METBUILD_ALWAYS_INLINE void reduce_cells(size_t n, const Value &value,
+                                         FieldStatistics &stats) {
+  using T = MeteorologicalDataType;
+  constexpr size_t L = c_reduce_lanes;
+  for (size_t b0 = 0; b0 < n; b0 += c_reduce_block) {
+    const size_t nb = std::min(c_reduce_block, n - b0);
+    std::array<T, L> lo;
+    std::array<T, L> hi;
+    lo.fill(std::numeric_limits<T>::infinity());
+    hi.fill(-std::numeric_limits<T>::infinity());
+    std::array<double, L> sum{};
+    std::array<size_t, L> count{};
+
+    auto accumulate = [&](const size_t l, const size_t c) {
+      bool valid = false;
+      const T x = value(c, valid);
+      lo[l] = valid && x < lo[l] ? x : lo[l];
+      hi[l] = valid && x > hi[l] ? x : hi[l];
+      sum[l] += valid ? static_cast<double>(x) : 0.0;
+      count[l] += valid ? 1 : 0;
+    };
+
+    size_t k = 0;
+    for (; k + L <= nb; k += L) {
+      for (size_t l = 0; l < L; ++l) accumulate(l, b0 + k + l);
+    }
+    for (; k < nb; ++k) accumulate(0, b0 + k);
+
+    double block_sum = 0.0;
+    size_t block_count = 0;
+    for (size_t l = 0; l < L; ++l) {
+      stats.min = std::min(stats.min, static_cast<double>(lo[l]));
+      stats.max = std::max(stats.max, static_cast<double>(hi[l]));
+      block_sum += sum[l];
+      block_count += count[l];
+    }
+    stats.add(block_sum);
+    stats.valid += block_count;
+    stats.invalid += nb - block_count;
+  }
+}
+
+METBUILD_ALWAYS_INLINE void reduce_values(size_t n,
+                                          const MeteorologicalDataType *values,
+                                          MeteorologicalDataType flag,
+                                          FieldStatistics &stats) {
+  reduce_cells(
+      n,
+      [=](const size_t c, bool &valid) {
+        const auto x = values[c];
+        valid = x != flag;
+        return x;
+      },
+      stats);
+}
+
+METBUILD_ALWAYS_INLINE void reduce_speeds(size_t n,
+                                          const MeteorologicalDataType *u,
+                                          const MeteorologicalDataType *v,
+                                          MeteorologicalDataType flag,
+                                          FieldStatistics &stats) {
+  reduce_cells(
+      n,
+      [=](const size_t c, bool &valid) {
+        const auto a = u[c];
+        const auto b = v[c];
+        valid = a != flag && b != flag;
+        return std::sqrt(a * a + b * b);
+      },
+      stats);
+}
+
+#if METBUILD_KERNEL_AVX2
+METBUILD_TARGET_AVX2 void reduce_values_avx2(
+    size_t n, const MeteorologicalDataType *values,
+    MeteorologicalDataType flag, FieldStatistics &stats) {
+  reduce_values(n, values, flag, stats);
+}
+
+METBUILD_TARGET_AVX2 void reduce_speeds_avx2(size_t n,
+                                             const MeteorologicalDataType *u,
+                                             const MeteorologicalDataType *v,
+                                             MeteorologicalDataType flag,
+                                             FieldStatistics &stats) {
+  reduce_speeds(n, u, v, flag, stats);
+}
+#endif
+
+}  // namespace
+
+template <typename... Policies>
+void Kernel::interpolate_masked(size_t cell, size_t n, const WeightView &w1,
+                                const WeightView &w2,
+                                const FieldSet<Policies...> &fields,
+                                double time_weight) {
+  ::fields<true>(cell, n, w1, w2, fields, time_weight);
+}
+
+template <typename... Policies>
+void Kernel::interpolate_valid(size_t cell, size_t n, const WeightView &w1,
+                               const WeightView &w2,
+                               const FieldSet<Policies...> &fields,
+                               double time_weight) {
+  ::fields<false>(cell, n, w1, w2, fields, time_weight);
+}
+
+//...One instantiation per output type the driver produces
+template void Kernel::interpolate_masked(size_t, size_t, const WeightView &,
+                                         const WeightView &,
+                                         const WindFields &, double);
+template void Kernel::interpolate_valid(size_t, size_t, const WeightView &,
+                                        const WeightView &, const WindFields &,
+                                        double);
+template void Kernel::interpolate_masked(size_t, size_t, const WeightView &,
+                                         const WeightView &,
+                                         const ScalarFields &, double);
+template void Kernel::interpolate_valid(size_t, size_t, const WeightView &,
+                                        const WeightView &,
+                                        const ScalarFields &, double);
+
+void Kernel::interpolate(size_t cell, size_t n, const WeightView &w,
+                         const SourceField &r, MeteorologicalDataType fill,
+                         MeteorologicalDataType *out) {
+  for (size_t k = 0; k < n; ++k) {
+    const size_t c = cell + k;
+    out[k] = cell_valid(w, c)
+                 ? static_cast<MeteorologicalDataType>(
+                       interpolate_cell(w, c, r.values) *
+                       static_cast<value_t>(r.scale))
+                 : fill;
+  }
+}
+
+void Kernel::interpolate_batch(size_t cell, size_t n, const WeightView &w,
+                               const SourceField *fields, size_t m,
+                               const MeteorologicalDataType *fill,
+                               MeteorologicalDataType *const *out) {
+  for (size_t k = 0; k < n; ++k) {
+    const size_t c = cell + k;
+    if (!cell_valid(w, c)) {
+      for (size_t f = 0; f < m; ++f) out[f][k] = fill[f];
+      continue;
+    }
+    const auto i0 = w.index[0][c];
+    const auto i1 = w.index[1][c];
+    const auto i2 = w.index[2][c];
+    const value_t w0 = w.weight[0][c];
+    const value_t w1 = w.weight[1][c];
+    const value_t w2 = w.weight[2][c];
+    for (size_t f = 0; f < m; ++f) {
+      const value_t *v = fields[f].values;
+      out[f][k] = static_cast<MeteorologicalDataType>(
+          (w0 * v[i0] + w1 * v[i1] + w2 * v[i2]) *
+          static_cast<value_t>(fields[f].scale));
+    }
+  }
+}
+
+void Kernel::copy_strided(size_t cell, size_t n, const WeightView &w,
+                          size_t first, long stride, const SourceField *fields,
+                          size_t m, const MeteorologicalDataType *fill,
+                          MeteorologicalDataType *const *out) {
+  //...Each field is copied in turn so the source row is read sequentially
+  for (size_t f = 0; f < m; ++f) {
+    const value_t *v = fields[f].values + first;
+    const auto scale = static_cast<value_t>(fields[f].scale);
+    long offset = 0;
+    for (size_t k = 0; k < n; ++k, offset += stride) {
+      out[f][k] = cell_valid(w, cell + k)
+                      ? static_cast<MeteorologicalDataType>(v[offset] * scale)
+                      : fill[f];
+    }
+  }
+}
+
+void Kernel::interpolate_sparse(size_t row, size_t n, const SparseWeights &w,
+                                const SourceField *fields, size_t m,
+                                const MeteorologicalDataType *fill,
+                                MeteorologicalDataType *const *out) {
+  //...Fields are accumulated a few at a time so the sums stay in registers
+  constexpr size_t c_fields = 4;
+  const size_t *offset = w.offset();
+  const auto *index = w.index();
+  const auto *weight = w.weight();
+  for (size_t f0 = 0; f0 < m; f0 += c_fields) {
+    const size_t nf = std::min(c_fields, m - f0);
+    for (size_t k = 0; k < n; ++k) {
+      const size_t r = row + k;
+      if (offset[r + 1] == offset[r]) {
+        for (size_t f = 0; f < nf; ++f) out[f0 + f][k] = fill[f0 + f];
+        continue;
+      }
+      std::array<value_t, c_fields> sum{};
+      for (size_t e = offset[r]; e < offset[r + 1]; ++e) {
+        const auto i = index[e];
+        const value_t we = weight[e];
+        for (size_t f = 0; f < nf; ++f) {
+          sum[f] += we * fields[f0 + f].values[i];
+        }
+      }
+      for (size_t f = 0; f < nf; ++f) {
+        out[f0 + f][k] = static_cast<MeteorologicalDataType>(
+            sum[f] * static_cast<value_t>(fields[f0 + f].scale));
+      }
+    }
+  }
+}
+
+void Kernel::blend(size_t cell, size_t n, const WeightView &w1,
+                   const WeightView &w2, const MeteorologicalDataType *a,
+                   const MeteorologicalDataType *b, double time_weight,
+                   MeteorologicalDataType fill, MeteorologicalDataType *out) {
+  blend_dispatch(n, a, b, time_weight, out);
+  for (size_t k = 0; k < n; ++k) {
+    const size_t c = cell + k;
+    if (!cell_valid(w1, c) || !cell_valid(w2, c)) out[k] = fill;
+  }
+}
+
+void Kernel::blend_valid(size_t n, const MeteorologicalDataType *a,
+                         const MeteorologicalDataType *b, double time_weight,
+                         MeteorologicalDataType *out) {
+  blend_dispatch(n, a, b, time_weight, out);
+}
+
+void Kernel::reduce(size_t n, const MeteorologicalDataType *values,
+                    MeteorologicalDataType flag, FieldStatistics &stats) {
+#if METBUILD_KERNEL_AVX2
+  if (use_avx2()) {
+    reduce_values_avx2(n, values, flag, stats);
+    return;
+  }
+#endif
+  reduce_values(n, values, flag, stats);
+}
+
+void Kernel::reduce_speed(size_t n, const MeteorologicalDataType *u,
+                          const MeteorologicalDataType *v,
+                          MeteorologicalDataType flag,
+                          FieldStatistics &stats) {
+#if METBUILD_KERNEL_AVX2
+  if (use_avx2()) {
+    reduce_speeds_avx2(n, u, v, flag, stats);
+    return;
+  }
+#endif
+  reduce_speeds(n, u, v, flag, stats);
+}
+
+const char *Kernel::instruction_set() {
+  if (!use_avx2()) return "generic";
+#ifdef METBUILD_SOURCE_FLOAT
+  return "avx2-float";
+#else
+  return "avx2";
+#endif
+}
+
+/**
+ * @brief Selects the kernels used from now on
+ * @param name "generic" for the portable kernels or "avx2"
+ * @return false if the instruction set is unknown or not supported by the
+ * processor, in which case the selection is unchanged
+ */
+bool Kernel::set_instruction_set(const std::string &name) {
+  if (name == "generic") {
+    s_use_avx2 = false;
+    return true;
+  }
+  if (name == "avx2" && cpu_has_avx2()) {
+    s_use_avx2 = true;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,272 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_INTERPOLATIONKERNEL_H_
+#define METBUILD_SRC_INTERPOLATIONKERNEL_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "InterpolationWeights.h"
+#include "MeteorologicalData.h"
+#include "SparseWeights.h"
+#include "StepStatistics.h"
+#include "data_sources/GriddedDataTypes.h"
+
+namespace MetBuild::Kernel {
+
+/**
+ * @brief Raw view of the weight planes used by the interpolation kernels
+ */
+struct WeightView {
+  explicit WeightView(const InterpolationWeights &w)
+      : index{w.index(0), w.index(1), w.index(2)},
+        weight{w.weight(0), w.weight(1), w.weight(2)},
+        mask(w.mask()) {}
+
+  const InterpolationWeights::index_type *index[3];
+  const InterpolationWeights::weight_type *weight[3];
+  const uint64_t *mask;
+};
+
+/**
+ * @brief Source values and scaling for one snapshot of a field. The kernels
+ * compute in the source precision
+ */
+struct SourceField {
+  const SourceDataType *values;
+  double scale;
+};
+
+/**
+ * @brief Scaling policy for fields used as read from the source
+ */
+struct Identity {
+  static constexpr bool scaled = false;
+};
+
+/**
+ * @brief Source fields, outputs and fill values for a set of variables
+ * interpolated together, with one scaling policy per variable
+ *
+ * Output pointers address the start of each output field and are indexed by
+ * cell, so the same set can be used for any run of cells
+ */
+template <typename... Policies>
+struct FieldSet {
+  static constexpr size_t size = sizeof...(Policies);
+  std::array<SourceField, sizeof...(Policies)> first;
+  std::array<SourceField, sizeof...(Policies)> second;
+  std::array<MeteorologicalDataType *, sizeof...(Policies)> out;
+  std::array<MeteorologicalDataType, sizeof...(Policies)> fill;
+};
+
+//...Sources apply the pressure and rate scaling when they are decoded, so
+// the output types use the unscaled sets and the kernels only weight
+using WindFields = FieldSet<Identity, Identity, Identity>;
+using ScalarFields = FieldSet<Identity>;
+
+/**
+ * @brief Field set used for each output data type
+ */
+template <GriddedDataTypes::TYPE type>
+struct OutputFields {
+  using type_t = ScalarFields;
+};
+
+template <>
+struct OutputFields<GriddedDataTypes::WIND_PRESSURE> {
+  using type_t = WindFields;
+};
+
+/**
+ * @brief Interpolates and time blends every field of a set for a run of
+ * consecutive output cells in a single pass
+ *
+ * Cells without a valid weight in either snapshot receive the fill value of
+ * each field
+ *
+ * @param cell first cell to compute
+ * @param n number of cells
+ * @param w1 weights onto the first snapshot
+ * @param w2 weights onto the second snapshot
+ * @param fields sources and outputs
+ * @param time_weight weight of the second snapshot
+ */
+template <typename... Policies>
+void interpolate_masked(size_t cell, size_t n, const WeightView &w1,
+                        const WeightView &w2,
+                        const FieldSet<Policies...> &fields,
+                        double time_weight);
+
+/**
+ * @brief Same as interpolate_masked for a run of cells that are all known to
+ * be valid in both snapshots, without any per cell validity test
+ */
+template <typename... Policies>
+void interpolate_valid(size_t cell, size_t n, const WeightView &w1,
+                       const WeightView &w2,
+                       const FieldSet<Policies...> &fields,
+                       double time_weight);
+
+extern template void interpolate_masked(size_t, size_t, const WeightView &,
+                                        const WeightView &,
+                                        const WindFields &, double);
+extern template void interpolate_valid(size_t, size_t, const WeightView &,
+                                       const WeightView &, const WindFields &,
+                                       double);
+extern template void interpolate_masked(size_t, size_t, const WeightView &,
+                                        const WeightView &,
+                                        const ScalarFields &, double);
+extern template void interpolate_valid(size_t, size_t, const WeightView &,
+                                       const WeightView &,
+                                       const ScalarFields &, double);
+
+/**
+ * @brief Interpolates a single snapshot of a field for a run of consecutive
+ * output cells without any time blending
+ * @param cell first cell to compute
+ * @param n number of cells
+ * @param w weights onto the snapshot
+ * @param r field of the snapshot
+ * @param fill value used for cells without a valid weight
+ * @param out output values for the n cells
+ */
+void interpolate(size_t cell, size_t n, const WeightView &w,
+                 const SourceField &r, MeteorologicalDataType fill,
+                 MeteorologicalDataType *out);
+
+/**
+ * @brief Interpolates several fields sharing one set of weights for a run of
+ * consecutive output cells, loading each stencil once and gathering the
+ * value of every field from it
+ * @param cell first cell to compute
+ * @param n number of cells
+ * @param w weights onto the snapshot
+ * @param fields source fields, m of them
+ * @param m number of fields
+ * @param fill value used for cells without a valid weight, one per field
+ * @param out output values for the n cells, one pointer per field
+ */
+void interpolate_batch(size_t cell, size_t n, const WeightView &w,
+                       const SourceField *fields, size_t m,
+                       const MeteorologicalDataType *fill,
+                       MeteorologicalDataType *const *out);
+
+/**
+ * @brief Copies several fields onto a run of consecutive output cells that
+ * sit on evenly spaced source nodes, such as a row of an output grid on a
+ * lattice of the source, without reading any weights
+ * @param cell first cell to compute
+ * @param n number of cells
+ * @param w weights onto the snapshot, used for the validity mask
+ * @param first source index of the first cell
+ * @param stride distance between the source indices of consecutive cells
+ * @param fields source fields, m of them
+ * @param m number of fields
+ * @param fill value used for cells without a valid weight, one per field
+ * @param out output values for the n cells, one pointer per field
+ */
+void copy_strided(size_t cell, size_t n, const WeightView &w, size_t first,
+                  long stride, const SourceField *fields, size_t m,
+                  const MeteorologicalDataType *fill,
+                  MeteorologicalDataType *const *out);
+
+/**
+ * @brief Applies sparse weights to several fields for a run of consecutive
+ * rows, loading each row once and gathering the value of every field from it
+ * @param row first row to compute
+ * @param n number of rows
+ * @param w sparse weights onto the snapshot
+ * @param fields source fields, m of them
+ * @param m number of fields
+ * @param fill value used for rows without entries, one per field
+ * @param out output values for the n rows, one pointer per field
+ */
+void interpolate_sparse(size_t row, size_t n, const SparseWeights &w,
+                        const SourceField *fields, size_t m,
+                        const MeteorologicalDataType *fill,
+                        MeteorologicalDataType *const *out);
+
+/**
+ * @brief Blends two snapshots that were already interpolated onto the
+ * output grid
+ * @param cell first cell to compute
+ * @param n number of cells
+ * @param w1 weights of the first snapshot, used for the validity mask
+ * @param w2 weights of the second snapshot, used for the validity mask
+ * @param a interpolated values of the first snapshot for the n cells
+ * @param b interpolated values of the second snapshot for the n cells
+ * @param time_weight weight of the second snapshot
+ * @param fill value used for cells without a valid weight
+ * @param out output values for the n cells
+ */
+void blend(size_t cell, size_t n, const WeightView &w1, const WeightView &w2,
+           const MeteorologicalDataType *a, const MeteorologicalDataType *b,
+           double time_weight, MeteorologicalDataType fill,
+           MeteorologicalDataType *out);
+
+/**
+ * @brief Same as blend for a run of cells that are all known to be valid
+ */
+void blend_valid(size_t n, const MeteorologicalDataType *a,
+                 const MeteorologicalDataType *b, double time_weight,
+                 MeteorologicalDataType *out);
+
+/**
+ * @brief Accumulates the minimum, maximum, sum and count of the cells of a
+ * field which hold a value
+ * @param n number of cells
+ * @param values values of the n cells
+ * @param flag value of the cells without data, which are counted as invalid
+ * @param stats statistics updated
+ */
+void reduce(size_t n, const MeteorologicalDataType *values,
+            MeteorologicalDataType flag, FieldStatistics &stats);
+
+/**
+ * @brief Same as reduce for the wind speed, computed from the two components
+ * as they are read
+ */
+void reduce_speed(size_t n, const MeteorologicalDataType *u,
+                  const MeteorologicalDataType *v, MeteorologicalDataType flag,
+                  FieldStatistics &stats);
+
+/**
+ * @brief Name of the instruction set used by the kernels, chosen for the
+ * processor when the library is loaded
+ */
+const char *instruction_set();
+
+bool set_instruction_set(const std::string &name);
+
+}  // namespace MetBuild::Kernel
+
+#endif  // METBUILD_SRC_INTERPOLATIONKERNEL_H_
@@ -28,27 +28,198 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "InterpolationWeights.h"
 
+#include <algorithm>
 #include <cassert>
 
+#include "Logging.h"
+#include "MemoryPolicy.h"
+#include "Triangulation.h"
+
 using namespace MetBuild;
 
 InterpolationWeights::InterpolationWeights(size_t ni, size_t nj)
-    : m_weights(std::vector<std::vector<InterpolationWeight>>(
-          ni, std::vector<InterpolationWeight>(nj))) {
+    : m_ni(ni), m_nj(nj), m_mask((ni * nj + 63) / 64) {
   assert(ni > 0);
   assert(nj > 0);
+  MemoryPolicy::fill(m_mask.data(), m_mask.size(), uint64_t(0));
+  for (size_t k = 0; k < 3; ++k) {
+    m_index[k].resize(ni * nj);
+    m_weight[k].resize(ni * nj);
+    MemoryPolicy::fill(m_index[k].data(), ni * nj, invalid_index());
+    MemoryPolicy::fill(m_weight[k].data(), ni * nj, weight_type(0));
+  }
+  m_memory.set(3 * ni * nj * (sizeof(index_type) + sizeof(weight_type)) +
+               m_mask.size() * sizeof(uint64_t));
 }
 
 void InterpolationWeights::set(size_t i, size_t j,
                                const InterpolationWeight &w) {
-  m_weights[i][j] = w;
+  assert(i < m_ni);
+  assert(j < m_nj);
+  const auto c = this->cell(i, j);
+  const uint64_t bit = uint64_t(1) << (c & 63);
+  if (this->store(c, w)) {
+    m_mask[c >> 6] |= bit;
+  } else {
+    m_mask[c >> 6] &= ~bit;
+  }
+}
+
+/**
+ * @brief Sets the weights for an entire row. Rows may be written
+ * concurrently because the validity mask is not touched here; call
+ * update_mask() once all rows have been written
+ * @param j row index
+ * @param row weights for each cell of the row
+ */
+void InterpolationWeights::set_row(size_t j,
+                                   const std::vector<InterpolationWeight> &row) {
+  assert(j < m_nj);
+  assert(row.size() == m_ni);
+  const auto c0 = this->cell(0, j);
+  for (size_t i = 0; i < m_ni; ++i) {
+    this->store(c0 + i, row[i]);
+  }
+}
+
+void InterpolationWeights::update_mask() {
+  std::fill(m_mask.begin(), m_mask.end(), 0);
+  for (size_t c = 0; c < this->size(); ++c) {
+    if (m_index[0][c] != invalid_index()) {
+      m_mask[c >> 6] |= uint64_t(1) << (c & 63);
+    }
+  }
+}
+
+/**
+ * @brief Runs of cells that are valid in both sets of weights
+ * @param a first set of weights
+ * @param b second set of weights, on the same output grid
+ * @return ordered, non-overlapping runs of valid cells
+ */
+InterpolationWeights::CellRanges InterpolationWeights::valid_ranges(
+    const InterpolationWeights &a, const InterpolationWeights &b) {
+  assert(a.size() == b.size());
+  CellRanges ranges;
+  const size_t n = a.size();
+  bool in_run = false;
+  size_t run_begin = 0;
+  for (size_t w = 0; w < a.mask_size(); ++w) {
+    const uint64_t bits = a.m_mask[w] & b.m_mask[w];
+    const size_t c0 = w << 6;
+    if ((bits == ~uint64_t(0) && in_run) || (bits == 0 && !in_run)) continue;
+    for (size_t k = 0; k < 64 && c0 + k < n; ++k) {
+      const bool v = (bits >> k) & 1U;
+      if (v && !in_run) {
+        run_begin = c0 + k;
+        in_run = true;
+      } else if (!v && in_run) {
+        ranges.push_back({run_begin, c0 + k});
+        in_run = false;
+      }
+    }
+  }
+  if (in_run) ranges.push_back({run_begin, n});
+  return ranges;
+}
+
+/**
+ * @brief Runs of cells not covered by a set of ranges
+ * @param ranges ordered, non-overlapping runs
+ * @param size total number of cells
+ * @return the complementary runs
+ */
+InterpolationWeights::CellRanges InterpolationWeights::complement(
+    const CellRanges &ranges, size_t size) {
+  CellRanges out;
+  size_t position = 0;
+  for (const auto &r : ranges) {
+    if (r.begin > position) out.push_back({position, r.begin});
+    position = r.end;
+  }
+  if (position < size) out.push_back({position, size});
+  return out;
 }
 
-const InterpolationWeight &InterpolationWeights::get(size_t i, size_t j) const {
-  assert(i < m_weights.size());
-  assert(j < m_weights[0].size());
-  return m_weights[i][j];
+/**
+ * @brief Runs of cells covered by both of two sets of ranges
+ * @param a ordered, non-overlapping runs
+ * @param b ordered, non-overlapping runs
+ * @return the common runs
+ */
+InterpolationWeights::CellRanges InterpolationWeights::intersect(
+    const CellRanges &a, const CellRanges &b) {
+  CellRanges out;
+  auto ia = a.begin();
+  auto ib = b.begin();
+  while (ia != a.end() && ib != b.end()) {
+    const size_t begin = std::max(ia->begin, ib->begin);
+    const size_t end = std::min(ia->end, ib->end);
+    if (begin < end) out.push_back({begin, end});
+    if (ia->end < ib->end) {
+      ++ia;
+    } else {
+      ++ib;
+    }
+  }
+  return out;
 }
-size_t InterpolationWeights::ni() const { return m_weights.size(); }
 
-size_t InterpolationWeights::nj() const { return m_weights[0].size(); }
+/**
+ * @brief Runs of cells covered by either of two sets of ranges
+ * @param a ordered, non-overlapping runs
+ * @param b ordered, non-overlapping runs
+ * @return the merged runs
+ */
+InterpolationWeights::CellRanges InterpolationWeights::unite(
+    const CellRanges &a, const CellRanges &b) {
+  CellRanges out;
+  out.reserve(a.size() + b.size());
+  auto ia = a.begin();
+  auto ib = b.begin();
+  while (ia != a.end() || ib != b.end()) {
+    const bool take_a =
+        ib == b.end() || (ia != a.end() && ia->begin < ib->begin);
+    const auto &r = take_a ? *ia++ : *ib++;
+    if (!out.empty() && r.begin <= out.back().end) {
+      out.back().end = std::max(out.back().end, r.end);
+    } else {
+      out.push_back(r);
+    }
+  }
+  return out;
+}
+
+bool InterpolationWeights::store(size_t c, const InterpolationWeight &w) {
+  const bool is_valid =
+      InterpolationWeight::valid(w, Triangulation::invalid_point());
+  for (size_t k = 0; k < 3; ++k) {
+    if (is_valid && w.index()[k] >= invalid_index()) {
+      metbuild_throw_exception(
+          "Source grid is too large for 32-bit interpolation indices");
+    }
+    m_index[k][c] =
+        is_valid ? static_cast<index_type>(w.index()[k]) : invalid_index();
+    m_weight[k][c] = static_cast<weight_type>(is_valid ? w.weight()[k] : 0.0);
+  }
+  return is_valid;
+}
+
+InterpolationWeight InterpolationWeights::get(size_t i, size_t j) const {
+  assert(i < m_ni);
+  assert(j < m_nj);
+  const auto c = this->cell(i, j);
+  if (!this->valid(c)) {
+    return {{Triangulation::invalid_point(), Triangulation::invalid_point(),
+             Triangulation::invalid_point()},
+            {0.0, 0.0, 0.0}};
+  }
+  return {{m_index[0][c], m_index[1][c], m_index[2][c]},
+          {m_weight[0][c], m_weight[1][c], m_weight[2][c]}};
+}
+
+size_t InterpolationWeights::ni() const { return m_ni; }
+
+size_t InterpolationWeights::nj() const { return m_nj; }
+
+size_t InterpolationWeights::size() const { return m_ni * m_nj; }
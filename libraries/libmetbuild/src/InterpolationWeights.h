@@ -30,26 +30,108 @@
 #define METGET_SRC_INTERPOLATIONWEIGHTS_H_
 
 #include <array>
+#include <cstdint>
 #include <cstdlib>
+#include <limits>
 #include <vector>
 
+#include "Instrumentation.h"
 #include "InterpolationWeight.h"
+#include "LargeBufferAllocator.h"
+#include "MeteorologicalData.h"
 
 namespace MetBuild {
+
+/**
+ * @brief Interpolation weights for every cell of an output grid
+ *
+ * The weights are stored as flat structure-of-arrays planes indexed by
+ * cell = j * ni + i: one plane of source indices and one plane of weights
+ * per triangle vertex, plus a bitmask of the cells with a valid weight. The
+ * weight planes are stored in the source precision
+ */
 class InterpolationWeights {
  public:
+  using index_type = uint32_t;
+  using weight_type = MetBuild::SourceDataType;
+
+  template <typename T>
+  using Plane = std::vector<T, LargeBufferAllocator<T>>;
+
+  /**
+   * @brief Half open run [begin, end) of consecutive cells
+   */
+  struct CellRange {
+    size_t begin;
+    size_t end;
+  };
+
+  using CellRanges = std::vector<CellRange>;
+
   explicit InterpolationWeights(size_t ni, size_t nj);
 
+  static constexpr index_type invalid_index() {
+    return std::numeric_limits<index_type>::max();
+  }
+
   void set(size_t i, size_t j, const InterpolationWeight &w);
 
+  void set_row(size_t j, const std::vector<InterpolationWeight> &row);
+
+  void update_mask();
+
   [[nodiscard]] size_t ni() const;
   [[nodiscard]] size_t nj() const;
+  [[nodiscard]] size_t size() const;
+
+  [[nodiscard]] size_t cell(size_t i, size_t j) const { return j * m_ni + i; }
+
+  [[nodiscard]] MetBuild::InterpolationWeight get(size_t i, size_t j) const;
+
+  [[nodiscard]] bool valid(size_t i, size_t j) const {
+    return this->valid(this->cell(i, j));
+  }
+
+  [[nodiscard]] bool valid(size_t cell) const {
+    return (m_mask[cell >> 6] >> (cell & 63)) & 1U;
+  }
 
-  [[nodiscard]] const MetBuild::InterpolationWeight &get(size_t i,
-                                                         size_t j) const;
+  [[nodiscard]] const index_type *index(size_t vertex) const {
+    return m_index[vertex].data();
+  }
+
+  [[nodiscard]] const weight_type *weight(size_t vertex) const {
+    return m_weight[vertex].data();
+  }
+
+  [[nodiscard]] const uint64_t *mask() const { return m_mask.data(); }
+
+  [[nodiscard]] size_t mask_size() const { return m_mask.size(); }
+
+  index_type *index(size_t vertex) { return m_index[vertex].data(); }
+
+  weight_type *weight(size_t vertex) { return m_weight[vertex].data(); }
+
+  uint64_t *mask() { return m_mask.data(); }
+
+  static CellRanges valid_ranges(const InterpolationWeights &a,
+                                 const InterpolationWeights &b);
+
+  static CellRanges complement(const CellRanges &ranges, size_t size);
+
+  static CellRanges intersect(const CellRanges &a, const CellRanges &b);
+
+  static CellRanges unite(const CellRanges &a, const CellRanges &b);
 
  private:
-  std::vector<std::vector<MetBuild::InterpolationWeight>> m_weights;
+  bool store(size_t cell, const InterpolationWeight &w);
+
+  size_t m_ni;
+  size_t m_nj;
+  std::array<Plane<index_type>, 3> m_index;
+  std::array<Plane<weight_type>, 3> m_weight;
+  Plane<uint64_t> m_mask;
+  Instrumentation::MemoryTracker m_memory{Instrumentation::WEIGHT_MEMORY};
 };
 }  // namespace MetBuild
 #endif  // METGET_SRC_INTERPOLATIONWEIGHTS_H_
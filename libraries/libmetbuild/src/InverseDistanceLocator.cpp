@@ -0,0 +1,182 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "InverseDistanceLocator.h"
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "Logging.h"
+#include "nanoflann.hpp"
+
+using namespace MetBuild::Private;
+
+namespace {
+//...Points closer than this to a source point take its value
+constexpr double c_coincident = 1e-12;
+}  // namespace
+
+/**
+ * @brief Source points and the kd-tree over them, shared between copies of
+ * the locator
+ */
+class InverseDistanceLocator::Tree {
+ public:
+  Tree(const std::vector<double> &x, const std::vector<double> &y)
+      : m_x(x), m_y(y), m_index(2, *this) {
+    m_index.buildIndex();
+  }
+
+  [[nodiscard]] size_t kdtree_get_point_count() const { return m_x.size(); }
+
+  [[nodiscard]] double kdtree_get_pt(size_t index, size_t dim) const {
+    return dim == 0 ? m_x[index] : m_y[index];
+  }
+
+  template <class BoundingBox>
+  bool kdtree_get_bbox(BoundingBox & /*box*/) const {
+    return false;
+  }
+
+  size_t search(double x, double y, size_t *index,
+                double *distance_squared) const {
+    const std::array<double, 2> query{x, y};
+    return m_index.knnSearch(query.data(), c_neighbours, index,
+                             distance_squared);
+  }
+
+ private:
+  using Index = nanoflann::KDTreeSingleIndexAdaptor<
+      nanoflann::L2_Simple_Adaptor<double, Tree>, Tree, 2, size_t>;
+
+  std::vector<double> m_x;
+  std::vector<double> m_y;
+  Index m_index;
+};
+
+/**
+ * @brief Constructor
+ * @param x source longitudes
+ * @param y source latitudes
+ * @param radius largest distance to a source point, in source coordinates
+ * @param primary locator tried first, may be null to weight every point by
+ * distance
+ */
+InverseDistanceLocator::InverseDistanceLocator(
+    const std::vector<double> &x, const std::vector<double> &y, double radius,
+    std::unique_ptr<PointLocator> primary)
+    : m_tree(std::make_shared<const Tree>(x, y)),
+      m_radius(radius),
+      m_primary(std::move(primary)) {
+  if (x.size() != y.size() || x.size() < c_neighbours) {
+    metbuild_throw_exception(
+        "Inverse distance weighting needs at least three source points");
+  }
+  if (!(radius > 0.0)) {
+    metbuild_throw_exception(
+        "The inverse distance search radius must be positive");
+  }
+}
+
+InverseDistanceLocator::InverseDistanceLocator(
+    const InverseDistanceLocator &other)
+    : m_tree(other.m_tree),
+      m_radius(other.m_radius),
+      m_primary(other.m_primary ? other.m_primary->clone() : nullptr) {}
+
+InverseDistanceLocator::~InverseDistanceLocator() = default;
+
+std::unique_ptr<PointLocator> InverseDistanceLocator::clone() const {
+  return std::make_unique<InverseDistanceLocator>(*this);
+}
+
+MetBuild::InterpolationWeight InverseDistanceLocator::getInterpolationFactors(
+    double x, double y) const {
+  if (m_primary) {
+    auto w = m_primary->getInterpolationFactors(x, y);
+    if (MetBuild::InterpolationWeight::valid(
+            w, std::numeric_limits<size_t>::max())) {
+      return w;
+    }
+  }
+  return this->nearest(x, y);
+}
+
+void InverseDistanceLocator::getInterpolationFactors(
+    const std::vector<MetBuild::Point> &points,
+    std::vector<MetBuild::InterpolationWeight> &weights) const {
+  if (m_primary) {
+    m_primary->getInterpolationFactors(points, weights);
+  } else {
+    weights.assign(points.size(), {});
+  }
+  for (size_t i = 0; i < points.size(); ++i) {
+    if (m_primary && MetBuild::InterpolationWeight::valid(
+                         weights[i], std::numeric_limits<size_t>::max())) {
+      continue;
+    }
+    weights[i] = this->nearest(points[i].x(), points[i].y());
+  }
+}
+
+/**
+ * @brief Weights the nearest source points by inverse squared distance.
+ * Neighbours beyond the search radius are given no weight
+ */
+MetBuild::InterpolationWeight InverseDistanceLocator::nearest(double x,
+                                                              double y) const {
+  constexpr auto invalid = std::numeric_limits<size_t>::max();
+  std::array<size_t, c_neighbours> index{};
+  std::array<double, c_neighbours> distance_squared{};
+  const auto found =
+      m_tree->search(x, y, index.data(), distance_squared.data());
+
+  const double radius_squared = m_radius * m_radius;
+  if (found == 0 || distance_squared[0] > radius_squared) {
+    return {{invalid, invalid, invalid}, {0.0, 0.0, 0.0}};
+  }
+  if (distance_squared[0] < c_coincident) {
+    return {{index[0], index[0], index[0]}, {1.0, 0.0, 0.0}};
+  }
+
+  //...Slots without a neighbour in range repeat the nearest point with no
+  // weight so that every index stays valid
+  std::array<size_t, 3> n{index[0], index[0], index[0]};
+  std::array<double, 3> w{0.0, 0.0, 0.0};
+  double total = 0.0;
+  for (size_t k = 0; k < found; ++k) {
+    if (distance_squared[k] > radius_squared) break;
+    n[k] = index[k];
+    w[k] = 1.0 / distance_squared[k];
+    total += w[k];
+  }
+  for (auto &v : w) v /= total;
+  return {n, w};
+}
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_INVERSEDISTANCELOCATOR_H_
+#define METBUILD_SRC_INVERSEDISTANCELOCATOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "PointLocator.h"
+
+namespace MetBuild::Private {
+
+/**
+ * @brief Point locator weighting the nearest source points by inverse
+ * distance
+ *
+ * The nearest points are found with a kd-tree built once for the source
+ * grid. When a primary locator is given, only points it cannot locate, such
+ * as those just outside the triangulated hull, are weighted by distance.
+ * Points without a source point within the search radius are invalid
+ */
+class InverseDistanceLocator : public PointLocator {
+ public:
+  static constexpr size_t c_neighbours = 3;
+
+  InverseDistanceLocator(const std::vector<double> &x,
+                         const std::vector<double> &y, double radius,
+                         std::unique_ptr<PointLocator> primary = nullptr);
+
+  InverseDistanceLocator(const InverseDistanceLocator &other);
+
+  ~InverseDistanceLocator() override;
+
+  [[nodiscard]] std::unique_ptr<PointLocator> clone() const override;
+
+  [[nodiscard]] MetBuild::InterpolationWeight getInterpolationFactors(
+      double x, double y) const override;
+
+  void getInterpolationFactors(
+      const std::vector<MetBuild::Point> &points,
+      std::vector<MetBuild::InterpolationWeight> &weights) const override;
+
+ private:
+  class Tree;
+
+  [[nodiscard]] MetBuild::InterpolationWeight nearest(double x,
+                                                      double y) const;
+
+  std::shared_ptr<const Tree> m_tree;
+  double m_radius;
+  std::unique_ptr<PointLocator> m_primary;
+};
+
+}  // namespace MetBuild::Private
+
+#endif  // METBUILD_SRC_INVERSEDISTANCELOCATOR_H_
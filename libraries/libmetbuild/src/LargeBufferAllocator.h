@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_LARGEBUFFERALLOCATOR_H_
+#define METBUILD_SRC_LARGEBUFFERALLOCATOR_H_
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <utility>
+
+#include "MemoryPolicy.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Cache-line aligned allocator placing large buffers according to the
+ * MemoryPolicy
+ *
+ * Values constructed without arguments are default initialized, so resizing
+ * a vector of numbers does not write its pages. The owner fills the buffer
+ * with MemoryPolicy::fill, which lets the worker threads touch the pages
+ * first
+ */
+template <typename T, size_t Alignment = 64>
+class LargeBufferAllocator {
+ public:
+  static_assert(Alignment >= alignof(T), "Alignment is too small for type");
+
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = LargeBufferAllocator<U, Alignment>;
+  };
+
+  LargeBufferAllocator() noexcept = default;
+
+  template <typename U>
+  constexpr LargeBufferAllocator(
+      const LargeBufferAllocator<U, Alignment> &) noexcept {}
+
+  T *allocate(size_t n) {
+    if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T *>(MemoryPolicy::allocate(n * sizeof(T), Alignment));
+  }
+
+  void deallocate(T *p, size_t n) noexcept {
+    MemoryPolicy::deallocate(p, n * sizeof(T), Alignment);
+  }
+
+  template <typename U>
+  void construct(U *p) noexcept(noexcept(::new(static_cast<void *>(p)) U)) {
+    ::new (static_cast<void *>(p)) U;
+  }
+
+  template <typename U, typename... Args>
+  void construct(U *p, Args &&...args) {
+    ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+  }
+
+  template <typename U>
+  bool operator==(const LargeBufferAllocator<U, Alignment> &) const noexcept {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const LargeBufferAllocator<U, Alignment> &) const noexcept {
+    return false;
+  }
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_LARGEBUFFERALLOCATOR_H_
@@ -0,0 +1,193 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "LocatorCache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+#include "Hash.h"
+#include "Instrumentation.h"
+#include "Logging.h"
+#include "MappedFile.h"
+#include "Utilities.h"
+#include "boost/filesystem.hpp"
+
+using namespace MetBuild;
+
+namespace {
+constexpr char c_magic[4] = {'M', 'B', 'L', 'C'};
+constexpr uint32_t c_version = 1;
+
+struct CacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t n_points;
+  uint64_t n_triangles;
+};
+
+std::mutex s_mutex;
+std::string s_directory = []() {
+  const char *env = std::getenv("METBUILD_LOCATOR_CACHE");
+  return env ? std::string(env) : std::string();
+}();
+std::vector<std::string> s_used;
+
+void record_use(const std::string &key) {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  if (std::find(s_used.begin(), s_used.end(), key) == s_used.end()) {
+    s_used.push_back(key);
+  }
+}
+}  // namespace
+
+void LocatorCache::setDirectory(const std::string &directory) {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  s_directory = directory;
+}
+
+std::string LocatorCache::directory() {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  return s_directory;
+}
+
+bool LocatorCache::enabled() { return !directory().empty(); }
+
+/**
+ * @brief Generates the key of the triangulation of a set of source points
+ * @param points source points, in the order their indices refer to
+ * @param bounding_region boundary constraining the triangulation
+ * @return key
+ */
+std::string LocatorCache::key(
+    const std::vector<MetBuild::Point> &points,
+    const std::vector<MetBuild::Point> &bounding_region) {
+  Hash h;
+  h.add(c_version).add(points).add(bounding_region);
+  return h.hex();
+}
+
+std::string LocatorCache::filename(const std::string &key) {
+  return (boost::filesystem::path(directory()) / ("locator_" + key + ".bin"))
+      .string();
+}
+
+/**
+ * @brief Loads the triangles of a source triangulation from the cache
+ * @param key key generated by LocatorCache::key
+ * @param n_points number of source points, which every index must be below
+ * @return triangles, or nothing if none are cached or the file is unusable
+ */
+std::optional<LocatorCache::Triangles> LocatorCache::load(
+    const std::string &key, const size_t n_points) {
+  if (!enabled()) return std::nullopt;
+  const auto fn = filename(key);
+  if (!Utilities::exists(fn)) return std::nullopt;
+
+  auto file = MappedFile(fn);
+  if (file.size() < sizeof(CacheHeader)) return std::nullopt;
+  CacheHeader header{};
+  std::memcpy(&header, file.data(), sizeof(CacheHeader));
+  if (std::memcmp(header.magic, c_magic, sizeof(c_magic)) != 0 ||
+      header.version != c_version || header.n_points != n_points ||
+      file.size() != sizeof(CacheHeader) +
+                         header.n_triangles * sizeof(Triangles::value_type)) {
+    Logging::warning("Ignoring invalid locator cache file " + fn);
+    return std::nullopt;
+  }
+
+  Triangles triangles(header.n_triangles);
+  std::memcpy(triangles.data(), file.data() + sizeof(CacheHeader),
+              triangles.size() * sizeof(Triangles::value_type));
+  for (const auto &t : triangles) {
+    if (t[0] >= n_points || t[1] >= n_points || t[2] >= n_points) {
+      Logging::warning("Ignoring invalid locator cache file " + fn);
+      return std::nullopt;
+    }
+  }
+  Instrumentation::count_event(Instrumentation::LOCATOR_LOADED);
+  record_use(key);
+  return triangles;
+}
+
+/**
+ * @brief Writes the triangles of a source triangulation to the cache. The
+ * file is written under a temporary name and renamed so that concurrent
+ * readers never see a partial file
+ * @param key key generated by LocatorCache::key
+ * @param n_points number of source points
+ * @param triangles source point indices of each triangle
+ */
+void LocatorCache::store(const std::string &key, const size_t n_points,
+                         const Triangles &triangles) {
+  if (!enabled()) return;
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(directory(), ec);
+
+  const auto fn = filename(key);
+  const auto tmp = fn + "." + boost::filesystem::unique_path().string();
+  {
+    std::ofstream f(tmp, std::ios::binary);
+    if (!f.is_open()) {
+      Logging::warning("Could not write locator cache file " + fn);
+      return;
+    }
+    CacheHeader header{};
+    std::memcpy(header.magic, c_magic, sizeof(c_magic));
+    header.version = c_version;
+    header.n_points = n_points;
+    header.n_triangles = triangles.size();
+    f.write(reinterpret_cast<const char *>(&header), sizeof(CacheHeader));
+    f.write(reinterpret_cast<const char *>(triangles.data()),
+            static_cast<std::streamsize>(triangles.size() *
+                                         sizeof(Triangles::value_type)));
+  }
+  boost::filesystem::rename(tmp, fn, ec);
+  if (ec) {
+    boost::filesystem::remove(tmp, ec);
+    return;
+  }
+  record_use(key);
+}
+
+/**
+ * @brief Keys of the triangulations loaded or stored since the process
+ * started or the last clear_used_keys, for sharing them between machines
+ */
+std::vector<std::string> LocatorCache::used_keys() {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  return s_used;
+}
+
+void LocatorCache::clear_used_keys() {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  s_used.clear();
+}
@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_LOCATORCACHE_H_
+#define METBUILD_SRC_LOCATORCACHE_H_
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "Point.h"
+
+namespace MetBuild {
+
+/**
+ * @brief On-disk cache of source triangulations
+ *
+ * The constrained Delaunay triangulation of a source depends only on the
+ * source points and boundary, not on the output grid, so its triangles are
+ * kept on their own, keyed by a hash of the points and boundary. A new
+ * output grid on a known source then only locates its points. The analytic
+ * locators of structured, curvilinear and connected grids are built in
+ * linear time and are not cached
+ *
+ * Triangles are stored as the indices of their three source points. A
+ * triangulation read from the cache locates points through its bucket grid,
+ * since no CGAL triangulation is rebuilt. The cache is disabled unless a
+ * directory is set, either with setDirectory() or with the
+ * METBUILD_LOCATOR_CACHE environment variable
+ */
+class LocatorCache {
+ public:
+  using Triangles = std::vector<std::array<uint32_t, 3>>;
+
+  static void setDirectory(const std::string &directory);
+
+  NODISCARD static std::string directory();
+
+  NODISCARD static bool enabled();
+
+  NODISCARD static std::string key(
+      const std::vector<MetBuild::Point> &points,
+      const std::vector<MetBuild::Point> &bounding_region);
+
+  NODISCARD static std::optional<Triangles> load(const std::string &key,
+                                                 size_t n_points);
+
+  static void store(const std::string &key, size_t n_points,
+                    const Triangles &triangles);
+
+  NODISCARD static std::string filename(const std::string &key);
+
+  NODISCARD static std::vector<std::string> used_keys();
+
+  static void clear_used_keys();
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_LOCATORCACHE_H_
@@ -28,15 +28,155 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "Logging.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
 
 static const std::string c_errorHeading("[MetBuild ERROR]: ");
 static const std::string c_warningHeading("[MetBuild WARNING]: ");
 static const std::string c_logHeading("[MetBuild INFO]: ");
+static const std::string c_debugHeading("[MetBuild DEBUG]: ");
 
 using namespace MetBuild;
 
+namespace {
+//...Messages held before those other than errors are dropped
+constexpr size_t c_max_queued = 4096;
+
+Logging::LEVEL environment_level() {
+  const char *env = std::getenv("METBUILD_LOG_LEVEL");
+  if (env == nullptr) return Logging::LEVEL_INFO;
+  std::string value(env);
+  std::transform(value.begin(), value.end(), value.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  if (value == "debug") return Logging::LEVEL_DEBUG;
+  if (value == "warning") return Logging::LEVEL_WARNING;
+  if (value == "error") return Logging::LEVEL_ERROR;
+  return Logging::LEVEL_INFO;
+}
+
+std::atomic<int> s_level(environment_level());
+
+/**
+ * @brief Writes queued messages to the console from one thread
+ *
+ * The sink is never destroyed. It is stopped when the process exits, after
+ * which messages are written directly by the thread logging them
+ */
+class Sink {
+ public:
+  static Sink &get() {
+    static Sink *sink = []() {
+      auto s = new Sink();
+      std::atexit([]() { Sink::get().stop(); });
+      return s;
+    }();
+    return *sink;
+  }
+
+  void push(bool error, std::string text) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (!m_stopped) {
+        if (!error && m_queue.size() >= c_max_queued) {
+          m_dropped++;
+          return;
+        }
+        m_queue.push_back({error, std::move(text)});
+        m_ready.notify_one();
+        return;
+      }
+    }
+    Sink::write(error, text);
+  }
+
+  void flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_drained.wait(lock, [this]() {
+      return m_stopped || (m_queue.empty() && !m_busy && m_dropped == 0);
+    });
+  }
+
+ private:
+  struct Message {
+    bool error;
+    std::string text;
+  };
+
+  Sink() : m_busy(false), m_stopped(false), m_dropped(0) {
+    m_thread = std::thread(&Sink::run, this);
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_stopped) return;
+      m_stopped = true;
+    }
+    m_ready.notify_all();
+    m_thread.join();
+    m_drained.notify_all();
+  }
+
+  static void write(bool error, const std::string &text) {
+    if (error) {
+      std::cerr << text << std::endl;
+    } else {
+      std::cout << text << std::endl;
+    }
+  }
+
+  void run() {
+    std::deque<Message> batch;
+    while (true) {
+      size_t dropped = 0;
+      bool stopped = false;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_busy = false;
+        m_drained.notify_all();
+        m_ready.wait(lock, [this]() {
+          return m_stopped || !m_queue.empty() || m_dropped != 0;
+        });
+        batch.swap(m_queue);
+        dropped = m_dropped;
+        m_dropped = 0;
+        m_busy = true;
+        stopped = m_stopped;
+      }
+      for (const auto &m : batch) {
+        Sink::write(m.error, m.text);
+      }
+      batch.clear();
+      if (dropped != 0) {
+        Sink::write(false, c_warningHeading + std::to_string(dropped) +
+                               " log messages were dropped");
+      }
+      if (stopped) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queue.empty()) return;
+      }
+    }
+  }
+
+  std::mutex m_mutex;
+  std::condition_variable m_ready;
+  std::condition_variable m_drained;
+  std::deque<Message> m_queue;
+  bool m_busy;
+  bool m_stopped;
+  size_t m_dropped;
+  std::thread m_thread;
+};
+}  // namespace
+
 /**
  * @brief Throws a runtime error
  * @param[in] s error description
@@ -65,7 +205,7 @@ void Logging::logError(const std::string &s, const std::string &heading) {
   if (!heading.empty()) {
     header = heading;
   }
-  Logging::printErrorMessage(heading, s);
+  Logging::printErrorMessage(header, s);
 }
 
 /**
@@ -73,6 +213,7 @@ void Logging::logError(const std::string &s, const std::string &heading) {
  * @param[in] s warning message
  */
 void Logging::warning(const std::string &s, const std::string &heading) {
+  if (!Logging::enabled(LEVEL_WARNING)) return;
   std::string header = c_warningHeading;
   if (!heading.empty()) {
     header = heading;
@@ -85,6 +226,7 @@ void Logging::warning(const std::string &s, const std::string &heading) {
  * @param s message string
  */
 void Logging::log(const std::string &s, const std::string &heading) {
+  if (!Logging::enabled(LEVEL_INFO)) return;
   std::string header = c_logHeading;
   if (!heading.empty()) {
     header = heading;
@@ -93,21 +235,57 @@ void Logging::log(const std::string &s, const std::string &heading) {
 }
 
 /**
- * @brief Prints a message to screen
+ * @brief Diagnostic log message, only written at the debug level. Callers
+ * in hot loops should check enabled(LEVEL_DEBUG) before composing the
+ * message
+ * @param s message string
+ */
+void Logging::debug(const std::string &s, const std::string &heading) {
+  if (!Logging::enabled(LEVEL_DEBUG)) return;
+  std::string header = c_debugHeading;
+  if (!heading.empty()) {
+    header = heading;
+  }
+  Logging::printMessage(header, s);
+}
+
+/**
+ * @brief Sets the lowest level of message written. Errors are always
+ * written
+ * @param level lowest level written
+ */
+void Logging::setLevel(LEVEL level) { s_level = level; }
+
+Logging::LEVEL Logging::level() { return static_cast<LEVEL>(s_level.load()); }
+
+bool Logging::enabled(LEVEL level) {
+  return level == LEVEL_ERROR || static_cast<int>(level) >= s_level.load();
+}
+
+/**
+ * @brief Waits until every message logged so far has been written
+ */
+void Logging::flush() { Sink::get().flush(); }
+
+/**
+ * @brief Queues a message for standard output
  * @param header custom header
  * @param message log message
  */
 void Logging::printMessage(const std::string &header,
                            const std::string &message) {
-  std::cout << header << message << std::endl;
+  Sink::get().push(false, header + message);
 }
 
 /**
- * @brief Prints a message to standard error
+ * @brief Writes a message to standard error, waiting until it is written so
+ * it is not lost if the process ends
  * @param header custom header
  * @param message log message
  */
 void Logging::printErrorMessage(const std::string &header,
                                 const std::string &message) {
-  std::cerr << header << message << std::endl;
+  auto &sink = Sink::get();
+  sink.push(true, header + message);
+  sink.flush();
 }
@@ -36,8 +36,20 @@
 
 namespace MetBuild {
 
+/**
+ * @brief Library messages and errors
+ *
+ * Messages are queued and written by a single sink thread, so threads
+ * logging at the same time neither interleave their output nor wait on the
+ * console. Messages below the level set with setLevel, or the
+ * METBUILD_LOG_LEVEL environment variable (debug, info, warning or error),
+ * are discarded before they are formatted. When the sink falls behind,
+ * messages other than errors are dropped and the number dropped is reported
+ */
 class Logging {
  public:
+  enum LEVEL { LEVEL_DEBUG, LEVEL_INFO, LEVEL_WARNING, LEVEL_ERROR };
+
   METBUILD_EXPORT Logging() = default;
 
   static void METBUILD_EXPORT throwError(const std::string &s);
@@ -50,6 +62,14 @@ class Logging {
   warning(const std::string &s, const std::string &heading = std::string());
   static void METBUILD_EXPORT log(const std::string &s,
                                   const std::string &heading = std::string());
+  static void METBUILD_EXPORT
+  debug(const std::string &s, const std::string &heading = std::string());
+
+  static void METBUILD_EXPORT setLevel(LEVEL level);
+  static LEVEL METBUILD_EXPORT level();
+  static bool METBUILD_EXPORT enabled(LEVEL level);
+
+  static void METBUILD_EXPORT flush();
 
  private:
   static void printMessage(const std::string &header,
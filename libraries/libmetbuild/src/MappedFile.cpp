@@ -0,0 +1,333 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "MappedFile.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "Instrumentation.h"
+#include "Logging.h"
+#include "WarmCache.h"
+
+#ifdef _WIN32
+#include <fstream>
+
+#include "boost/filesystem.hpp"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace MetBuild;
+
+namespace {
+std::mutex s_map_mutex;
+std::unordered_map<std::string, std::weak_ptr<const MappedFile>> s_map_cache;
+std::unordered_map<std::string, std::shared_ptr<const MappedFile>> s_buffers;
+std::unordered_set<std::string> s_pending;
+std::unordered_map<std::string, std::string> s_failed;
+std::condition_variable s_buffer_condition;
+
+/**
+ * @brief Buffer registered under a name, waiting for it when the name has
+ * been announced but its data has not arrived yet
+ * @param lock lock held on s_map_mutex
+ * @param name file name
+ * @return buffer, or null when the name refers to a file on disk
+ */
+std::shared_ptr<const MappedFile> find_buffer(
+    std::unique_lock<std::mutex> &lock, const std::string &name) {
+  if (s_pending.find(name) != s_pending.end()) {
+    Instrumentation::ScopedTimer timer(Instrumentation::SOURCE_WAIT);
+    s_buffer_condition.wait(
+        lock, [&]() { return s_pending.find(name) == s_pending.end(); });
+  }
+  auto failed = s_failed.find(name);
+  if (failed != s_failed.end()) {
+    metbuild_throw_exception("The data for '" + name +
+                             "' could not be obtained: " + failed->second);
+  }
+  auto it = s_buffers.find(name);
+  return it == s_buffers.end() ? nullptr : it->second;
+}
+
+#ifndef _WIN32
+std::string file_identity(const struct stat &st) {
+#ifdef __linux__
+  const auto modified =
+      static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL +
+      st.st_mtim.tv_nsec;
+#else
+  const auto modified = static_cast<long long>(st.st_mtime);
+#endif
+  return std::to_string(st.st_dev) + ":" + std::to_string(st.st_ino) + ":" +
+         std::to_string(st.st_size) + ":" + std::to_string(modified);
+}
+#endif
+
+/**
+ * @brief Identifies the file currently under a name, so a mapping kept
+ * across requests is not reused once the file is replaced
+ * @param filename file name
+ * @return identity, empty when the file cannot be found
+ */
+std::string file_identity(const std::string &filename) {
+#ifdef _WIN32
+  boost::system::error_code ec;
+  const auto size = boost::filesystem::file_size(filename, ec);
+  if (ec) return {};
+  const auto modified = boost::filesystem::last_write_time(filename, ec);
+  if (ec) return {};
+  return std::to_string(size) + ":" + std::to_string(modified);
+#else
+  struct stat st {};
+  if (stat(filename.c_str(), &st) != 0) return {};
+  return file_identity(st);
+#endif
+}
+}  // namespace
+
+MappedFile::MappedFile(std::string filename)
+    : m_filename(std::move(filename)), m_data(nullptr), m_size(0) {
+#ifdef _WIN32
+  std::ifstream f(m_filename, std::ios::binary | std::ios::ate);
+  if (!f.is_open()) {
+    metbuild_throw_exception("Could not open file '" + m_filename + "'");
+  }
+  m_size = static_cast<size_t>(f.tellg());
+  m_buffer.resize(m_size);
+  f.seekg(0);
+  f.read(reinterpret_cast<char *>(m_buffer.data()), m_size);
+  m_data = m_buffer.data();
+  m_identity = file_identity(m_filename);
+#else
+  int fd = open(m_filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    metbuild_throw_exception("Could not open file '" + m_filename + "'");
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    metbuild_throw_exception("Could not stat file '" + m_filename + "'");
+  }
+  m_size = static_cast<size_t>(st.st_size);
+  m_identity = file_identity(st);
+  if (m_size > 0) {
+    void *ptr = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+      close(fd);
+      metbuild_throw_exception("Could not memory map file '" + m_filename +
+                               "'");
+    }
+    m_data = static_cast<const unsigned char *>(ptr);
+  }
+  close(fd);
+#endif
+}
+
+/**
+ * @brief Constructor for data already in memory
+ * @param name name the data stands in for
+ * @param buffer contents
+ */
+MappedFile::MappedFile(std::string name, std::vector<unsigned char> buffer)
+    : m_filename(std::move(name)),
+      m_data(nullptr),
+      m_size(buffer.size()),
+      m_buffer(std::move(buffer)) {
+  m_data = m_buffer.data();
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (m_data && m_buffer.empty()) {
+    munmap(const_cast<unsigned char *>(m_data), m_size);
+  }
+#endif
+}
+
+/**
+ * @brief Returns the shared mapping for a file, mapping it if no other
+ * reader currently holds it or the file has been replaced since it was
+ * mapped
+ *
+ * Mappings are kept in the WarmCache when it is enabled. They count against
+ * its budget by their size, since the pages read stay resident
+ *
+ * @param filename file to map
+ * @return shared mapping
+ */
+std::shared_ptr<const MappedFile> MappedFile::get(const std::string &filename) {
+  std::shared_ptr<const MappedFile> ptr;
+  {
+    std::unique_lock<std::mutex> lock(s_map_mutex);
+    if (auto b = find_buffer(lock, filename)) return b;
+    auto it = s_map_cache.find(filename);
+    if (it != s_map_cache.end()) ptr = it->second.lock();
+    if (ptr && ptr->m_identity != file_identity(filename)) ptr.reset();
+    if (!ptr) {
+      ptr = std::make_shared<const MappedFile>(filename);
+      s_map_cache[filename] = ptr;
+    }
+  }
+  if (WarmCache::enabled()) {
+    WarmCache::retain("file:" + filename, ptr, ptr->m_size);
+  }
+  return ptr;
+}
+
+/**
+ * @brief Identifies the file currently under a name by its device, inode,
+ * size and modification time, so that state derived from a file can tell
+ * when it has been rewritten or replaced
+ * @param filename file name
+ * @return identity, empty when the file cannot be found
+ */
+std::string MappedFile::identity(const std::string &filename) {
+  return file_identity(filename);
+}
+
+/**
+ * @brief Forgets the mapping of a file, e.g. before deleting it, so that a
+ * mapping kept warm does not hold on to its disk space
+ * @param filename file name
+ */
+void MappedFile::release(const std::string &filename) {
+  {
+    std::lock_guard<std::mutex> lock(s_map_mutex);
+    s_map_cache.erase(filename);
+  }
+  WarmCache::erase("file:" + filename);
+}
+
+void MappedFile::clear() {
+  {
+    std::lock_guard<std::mutex> lock(s_map_mutex);
+    s_map_cache.clear();
+    s_buffers.clear();
+    s_pending.clear();
+    s_failed.clear();
+  }
+  s_buffer_condition.notify_all();
+}
+
+/**
+ * @brief Registers data held in memory under a file name, replacing any
+ * buffer already registered under it. Readers holding the previous buffer
+ * keep it until they release it
+ * @param name file name the buffer stands in for
+ * @param buffer contents of the file
+ */
+void MappedFile::add_buffer(const std::string &name,
+                            std::vector<unsigned char> buffer) {
+  auto ptr = std::make_shared<const MappedFile>(name, std::move(buffer));
+  {
+    std::lock_guard<std::mutex> lock(s_map_mutex);
+    s_buffers[name] = std::move(ptr);
+    s_pending.erase(name);
+    s_failed.erase(name);
+  }
+  s_buffer_condition.notify_all();
+}
+
+/**
+ * @brief Registers a file made of several parts, such as grib messages
+ * downloaded separately, concatenated in order
+ * @param name file name the buffer stands in for
+ * @param parts contents of the file in order
+ */
+void MappedFile::add_buffer(
+    const std::string &name,
+    const std::vector<std::vector<unsigned char>> &parts) {
+  size_t size = 0;
+  for (const auto &p : parts) size += p.size();
+  std::vector<unsigned char> buffer;
+  buffer.reserve(size);
+  for (const auto &p : parts) buffer.insert(buffer.end(), p.begin(), p.end());
+  MappedFile::add_buffer(name, std::move(buffer));
+}
+
+void MappedFile::remove_buffer(const std::string &name) {
+  {
+    std::lock_guard<std::mutex> lock(s_map_mutex);
+    s_buffers.erase(name);
+    s_pending.erase(name);
+    s_failed.erase(name);
+  }
+  s_buffer_condition.notify_all();
+}
+
+/**
+ * @brief Announces that the data for a name will be registered later.
+ * Readers of the name wait until add_buffer or fail_buffer is called
+ * @param name file name the buffer will stand in for
+ */
+void MappedFile::expect_buffer(const std::string &name) {
+  std::lock_guard<std::mutex> lock(s_map_mutex);
+  s_buffers.erase(name);
+  s_failed.erase(name);
+  s_pending.insert(name);
+}
+
+/**
+ * @brief Marks an announced name as unavailable. Readers waiting for it,
+ * and later readers, throw with the reason given
+ * @param name file name
+ * @param reason description of the failure
+ */
+void MappedFile::fail_buffer(const std::string &name,
+                             const std::string &reason) {
+  {
+    std::lock_guard<std::mutex> lock(s_map_mutex);
+    s_pending.erase(name);
+    s_failed[name] = reason;
+  }
+  s_buffer_condition.notify_all();
+}
+
+/**
+ * @brief Returns the buffer registered under a name, or null when the name
+ * refers to a file on disk. Announced names are waited for
+ */
+std::shared_ptr<const MappedFile> MappedFile::buffer(const std::string &name) {
+  std::unique_lock<std::mutex> lock(s_map_mutex);
+  return find_buffer(lock, name);
+}
+
+const std::string &MappedFile::filename() const { return m_filename; }
+
+const unsigned char *MappedFile::data() const { return m_data; }
+
+size_t MappedFile::size() const { return m_size; }
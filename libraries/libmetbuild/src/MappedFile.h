@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_MAPPEDFILE_H_
+#define METBUILD_SRC_MAPPEDFILE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CppAttributes.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Read-only memory mapping of a whole file
+ *
+ * Mappings are shared through get() so that every reader of a file in the
+ * process, and through the page cache every process on the node, decodes
+ * from the same pages
+ *
+ * Buffers registered with add_buffer, such as grib messages downloaded by
+ * byte range, stand in for a file of the same name. get() and FileWrapper
+ * return the buffer instead of opening the disk, so such sources are read
+ * without a round trip through a local file. Names announced with
+ * expect_buffer make readers wait until the data arrives, so decoding can
+ * start while later files are still being downloaded
+ */
+class MappedFile {
+ public:
+  explicit MappedFile(std::string filename);
+
+  MappedFile(std::string name, std::vector<unsigned char> buffer);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  static std::shared_ptr<const MappedFile> get(const std::string &filename);
+
+  static void clear();
+
+  static void release(const std::string &filename);
+
+  static void add_buffer(const std::string &name,
+                         std::vector<unsigned char> buffer);
+
+  static void add_buffer(const std::string &name,
+                         const std::vector<std::vector<unsigned char>> &parts);
+
+  static void remove_buffer(const std::string &name);
+
+  static void expect_buffer(const std::string &name);
+
+  static void fail_buffer(const std::string &name, const std::string &reason);
+
+  static std::shared_ptr<const MappedFile> buffer(const std::string &name);
+
+  NODISCARD static std::string identity(const std::string &filename);
+
+  NODISCARD const std::string &filename() const;
+
+  NODISCARD const unsigned char *data() const;
+
+  NODISCARD size_t size() const;
+
+ private:
+  std::string m_filename;
+  const unsigned char *m_data;
+  size_t m_size;
+  std::vector<unsigned char> m_buffer;
+  std::string m_identity;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_MAPPEDFILE_H_
@@ -0,0 +1,174 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "Md5.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace MetBuild;
+
+namespace {
+
+constexpr std::array<uint32_t, 64> c_k = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a,
+    0xa8304613, 0xfd469501, 0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 0xf61e2562, 0xc040b340,
+    0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8,
+    0x676f02d9, 0x8d2a4c8a, 0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70, 0x289b7ec6, 0xeaa127fa,
+    0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92,
+    0xffeff47d, 0x85845dd1, 0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+constexpr std::array<uint32_t, 64> c_shift = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+
+inline uint32_t rotate(uint32_t x, uint32_t n) {
+  return (x << n) | (x >> (32 - n));
+}
+
+}  // namespace
+
+Md5::Md5()
+    : m_state{0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476},
+      m_buffer{},
+      m_length(0) {}
+
+/**
+ * @brief Adds data to the digest
+ * @param data bytes added
+ * @param length number of bytes
+ */
+void Md5::update(const void *data, size_t length) {
+  const auto *bytes = static_cast<const uint8_t *>(data);
+  auto used = static_cast<size_t>(m_length % 64);
+  m_length += length;
+
+  if (used > 0) {
+    const auto n = std::min<size_t>(64 - used, length);
+    std::memcpy(m_buffer.data() + used, bytes, n);
+    bytes += n;
+    length -= n;
+    used += n;
+    if (used < 64) return;
+    this->transform(m_buffer.data());
+  }
+  for (; length >= 64; bytes += 64, length -= 64) {
+    this->transform(bytes);
+  }
+  if (length > 0) std::memcpy(m_buffer.data(), bytes, length);
+}
+
+/**
+ * @brief Digest of the data added so far. The digest can still be updated
+ * afterwards
+ */
+Md5::Digest Md5::digest() const {
+  Md5 last(*this);
+  const uint64_t bits = m_length * 8;
+  const uint8_t pad = 0x80;
+  const uint8_t zero[64] = {};
+  last.update(&pad, 1);
+  const auto used = static_cast<size_t>(last.m_length % 64);
+  last.update(zero, used <= 56 ? 56 - used : 120 - used);
+  uint8_t size[8];
+  for (size_t i = 0; i < 8; ++i) {
+    size[i] = static_cast<uint8_t>(bits >> (8 * i));
+  }
+  last.update(size, 8);
+
+  Digest digest;
+  for (size_t i = 0; i < 4; ++i) {
+    for (size_t j = 0; j < 4; ++j) {
+      digest[4 * i + j] = static_cast<uint8_t>(last.m_state[i] >> (8 * j));
+    }
+  }
+  return digest;
+}
+
+std::string Md5::hexdigest() const { return Md5::hex(this->digest()); }
+
+/**
+ * @brief Lower case hexadecimal form of a digest, as written by md5sum
+ */
+std::string Md5::hex(const Digest &digest) {
+  static constexpr char c_digits[] = "0123456789abcdef";
+  std::string s(32, '0');
+  for (size_t i = 0; i < digest.size(); ++i) {
+    s[2 * i] = c_digits[digest[i] >> 4];
+    s[2 * i + 1] = c_digits[digest[i] & 0xf];
+  }
+  return s;
+}
+
+void Md5::transform(const uint8_t *block) {
+  uint32_t m[16];
+  for (size_t i = 0; i < 16; ++i) {
+    m[i] = static_cast<uint32_t>(block[4 * i]) |
+           static_cast<uint32_t>(block[4 * i + 1]) << 8 |
+           static_cast<uint32_t>(block[4 * i + 2]) << 16 |
+           static_cast<uint32_t>(block[4 * i + 3]) << 24;
+  }
+
+  uint32_t a = m_state[0];
+  uint32_t b = m_state[1];
+  uint32_t c = m_state[2];
+  uint32_t d = m_state[3];
+  for (uint32_t i = 0; i < 64; ++i) {
+    uint32_t f;
+    uint32_t g;
+    if (i < 16) {
+      f = (b & c) | (~b & d);
+      g = i;
+    } else if (i < 32) {
+      f = (d & b) | (~d & c);
+      g = (5 * i + 1) % 16;
+    } else if (i < 48) {
+      f = b ^ c ^ d;
+      g = (3 * i + 5) % 16;
+    } else {
+      f = c ^ (b | ~d);
+      g = (7 * i) % 16;
+    }
+    f += a + c_k[i] + m[g];
+    a = d;
+    d = c;
+    c = b;
+    b += rotate(f, c_shift[i]);
+  }
+  m_state[0] += a;
+  m_state[1] += b;
+  m_state[2] += c;
+  m_state[3] += d;
+}
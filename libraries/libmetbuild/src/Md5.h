@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_MD5_H_
+#define METBUILD_SRC_MD5_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "CppAttributes.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Incremental MD5 digest (RFC 1321) of data written to the outputs
+ *
+ * MD5 is what S3 checks uploads against, so it is computed from the bytes as
+ * they are written rather than by reading the files back
+ */
+class Md5 {
+ public:
+  using Digest = std::array<uint8_t, 16>;
+
+  Md5();
+
+  void update(const void *data, size_t length);
+
+  NODISCARD Digest digest() const;
+
+  NODISCARD std::string hexdigest() const;
+
+  NODISCARD uint64_t length() const { return m_length; }
+
+  static std::string hex(const Digest &digest);
+
+ private:
+  void transform(const uint8_t *block);
+
+  std::array<uint32_t, 4> m_state;
+  std::array<uint8_t, 64> m_buffer;
+  uint64_t m_length;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_MD5_H_
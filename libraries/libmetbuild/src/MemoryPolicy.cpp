@@ -0,0 +1,191 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "MemoryPolicy.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "ThreadPool.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+using namespace MetBuild;
+
+namespace {
+MemoryPolicy::HUGE_PAGES hugePagesDefault() {
+  const char *env = std::getenv("METBUILD_HUGE_PAGES");
+  if (env == nullptr) return MemoryPolicy::HUGE_PAGES_OFF;
+  if (std::strcmp(env, "transparent") == 0 || std::strcmp(env, "1") == 0) {
+    return MemoryPolicy::HUGE_PAGES_TRANSPARENT;
+  }
+  if (std::strcmp(env, "explicit") == 0) {
+    return MemoryPolicy::HUGE_PAGES_EXPLICIT;
+  }
+  return MemoryPolicy::HUGE_PAGES_OFF;
+}
+
+bool firstTouchDefault() {
+  const char *env = std::getenv("METBUILD_FIRST_TOUCH");
+  return env != nullptr && std::strcmp(env, "0") != 0;
+}
+
+std::atomic<MemoryPolicy::HUGE_PAGES> s_huge_pages(hugePagesDefault());
+std::atomic<bool> s_first_touch(firstTouchDefault());
+
+constexpr size_t c_huge_page = MemoryPolicy::largeBufferSize();
+
+constexpr size_t round_up(size_t bytes) {
+  return (bytes + c_huge_page - 1) / c_huge_page * c_huge_page;
+}
+
+#ifdef __linux__
+/**
+ * @brief Maps a large buffer aligned to a huge page. Explicit huge pages are
+ * tried first, then normal pages, over-mapped by one huge page and trimmed
+ * so that transparent huge pages can back the whole buffer
+ * @param bytes size of the buffer
+ * @return start of the mapping
+ */
+void *map_large(size_t bytes) {
+  const size_t length = round_up(bytes);
+  const auto mode = s_huge_pages.load();
+  if (mode == MemoryPolicy::HUGE_PAGES_EXPLICIT) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_2MB
+    flags |= MAP_HUGE_2MB;
+#endif
+    void *p = mmap(nullptr, length, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (p != MAP_FAILED) return p;
+  }
+
+  auto *p = static_cast<char *>(mmap(nullptr, length + c_huge_page,
+                                     PROT_READ | PROT_WRITE,
+                                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  if (p == MAP_FAILED) throw std::bad_alloc();
+  const auto address = reinterpret_cast<uintptr_t>(p);
+  const size_t head = (c_huge_page - address % c_huge_page) % c_huge_page;
+  if (head > 0) munmap(p, head);
+  munmap(p + head + length, c_huge_page - head);
+  p += head;
+  if (mode != MemoryPolicy::HUGE_PAGES_OFF) {
+    madvise(p, length, MADV_HUGEPAGE);
+  }
+  return p;
+}
+#endif
+}  // namespace
+
+void MemoryPolicy::setHugePages(const HUGE_PAGES mode) { s_huge_pages = mode; }
+
+MemoryPolicy::HUGE_PAGES MemoryPolicy::hugePages() { return s_huge_pages; }
+
+void MemoryPolicy::setFirstTouch(const bool enabled) {
+  s_first_touch = enabled;
+}
+
+bool MemoryPolicy::firstTouch() { return s_first_touch; }
+
+/**
+ * @brief Allocates a buffer. Buffers of at least largeBufferSize() bytes are
+ * mapped directly so that they start on a huge page, smaller ones come from
+ * the heap
+ * @param bytes size of the buffer
+ * @param alignment alignment of small buffers
+ * @return buffer, uninitialized
+ */
+void *MemoryPolicy::allocate(const size_t bytes, const size_t alignment) {
+#ifdef __linux__
+  if (bytes >= c_huge_page) return map_large(bytes);
+#endif
+  return ::operator new(bytes, std::align_val_t(alignment));
+}
+
+/**
+ * @brief Frees a buffer from MemoryPolicy::allocate
+ * @param p buffer
+ * @param bytes size the buffer was allocated with
+ * @param alignment alignment the buffer was allocated with
+ */
+void MemoryPolicy::deallocate(void *p, const size_t bytes,
+                              const size_t alignment) noexcept {
+#ifdef __linux__
+  if (bytes >= c_huge_page) {
+    munmap(p, round_up(bytes));
+    return;
+  }
+#endif
+  ::operator delete(p, std::align_val_t(alignment));
+}
+
+/**
+ * @brief Advises the huge pages fully inside a buffer from another allocator
+ * as huge page candidates, when huge pages are enabled
+ * @param p buffer
+ * @param bytes size of the buffer
+ */
+void MemoryPolicy::advise(void *p, const size_t bytes) {
+#ifdef __linux__
+  if (s_huge_pages == HUGE_PAGES_OFF || p == nullptr) return;
+  const auto address = reinterpret_cast<uintptr_t>(p);
+  const uintptr_t begin = round_up(address);
+  const uintptr_t end = (address + bytes) / c_huge_page * c_huge_page;
+  if (end > begin) {
+    madvise(reinterpret_cast<void *>(begin), end - begin, MADV_HUGEPAGE);
+  }
+#else
+  (void)p;
+  (void)bytes;
+#endif
+}
+
+/**
+ * @brief Runs f(begin, end) over blocks of one huge page of values. The
+ * blocks are handed to the worker threads when first touch is enabled
+ * @param n number of values
+ * @param value_size size of one value
+ * @param f function run for each half open block of values
+ */
+void MemoryPolicy::for_each_block(
+    const size_t n, const size_t value_size,
+    const std::function<void(size_t, size_t)> &f) {
+  const size_t block = std::max<size_t>(c_huge_page / value_size, 1);
+  if (!s_first_touch || n <= block) {
+    f(0, n);
+    return;
+  }
+  const size_t n_blocks = (n + block - 1) / block;
+  ThreadPool::global().parallel_for(0, n_blocks, [&](const size_t b) {
+    f(b * block, std::min(n, (b + 1) * block));
+  });
+}
@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_MEMORYPOLICY_H_
+#define METBUILD_SRC_MEMORYPOLICY_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+
+#include "CppAttributes.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Placement and page size policy of the large buffers holding
+ * interpolation weights, decoded fields and output fields
+ *
+ * Buffers of at least largeBufferSize() bytes are mapped directly from the
+ * kernel, aligned to a huge page, instead of coming from the heap. With
+ * transparent huge pages the mapping is advised as a huge page candidate and
+ * with explicit huge pages it is taken from the hugetlb pool, falling back to
+ * normal pages when the pool is empty. When first touch is enabled the pages
+ * are written for the first time by the worker threads rather than by the
+ * allocating thread, so that on a multi-socket node the pages of a buffer are
+ * spread over the memory of the sockets whose threads read them
+ *
+ * The policy is set with METBUILD_HUGE_PAGES (off, transparent or explicit)
+ * and METBUILD_FIRST_TOUCH (0 or 1), both off by default, or with the static
+ * setters. Only the page size advice is available on non-Linux systems
+ */
+class MemoryPolicy {
+ public:
+  enum HUGE_PAGES {
+    HUGE_PAGES_OFF,
+    HUGE_PAGES_TRANSPARENT,
+    HUGE_PAGES_EXPLICIT
+  };
+
+  static void setHugePages(HUGE_PAGES mode);
+
+  NODISCARD static HUGE_PAGES hugePages();
+
+  static void setFirstTouch(bool enabled);
+
+  NODISCARD static bool firstTouch();
+
+  NODISCARD static constexpr size_t largeBufferSize() { return 2097152; }
+
+  NODISCARD static void *allocate(size_t bytes, size_t alignment);
+
+  static void deallocate(void *p, size_t bytes, size_t alignment) noexcept;
+
+  static void advise(void *p, size_t bytes);
+
+  /**
+   * @brief Fills a buffer, splitting the work over the worker threads when
+   * first touch is enabled and the buffer is large
+   * @param data buffer
+   * @param n number of values
+   * @param value value to fill with
+   */
+  template <typename T>
+  static void fill(T *data, size_t n, const T &value) {
+    MemoryPolicy::for_each_block(n, sizeof(T), [&](size_t begin, size_t end) {
+      std::fill(data + begin, data + end, value);
+    });
+  }
+
+ private:
+  static void for_each_block(size_t n, size_t value_size,
+                             const std::function<void(size_t, size_t)> &f);
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_MEMORYPOLICY_H_
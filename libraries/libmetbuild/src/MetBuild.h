@@ -26,22 +26,35 @@
 // Organization: The Water Institute
 //
 ////////////////////////////////////////////////////////////////////////////////////
+#include "CancelToken.h"
 #include "CppAttributes.h"
 #include "Date.h"
 #include "Grid.h"
 #include "MetBuild_Global.h"
 #include "MeteorologicalData.h"
 #include "Meteorology.h"
+#include "MovingGrid.h"
+#include "NestedDomain.h"
 #include "Point.h"
+#include "PointSeries.h"
 #include "Projection.h"
 #include "output/DelftDomain.h"
 #include "output/DelftOutput.h"
+#include "output/EnvelopeDomain.h"
+#include "output/EnvelopeOutput.h"
+#include "output/GribDomain.h"
+#include "output/GribOutput.h"
 #include "output/OutputDomain.h"
 #include "output/OutputFile.h"
+#include "output/OutputStitch.h"
+#include "output/Overview.h"
 #include "output/OwiAscii.h"
 #include "output/OwiAsciiDomain.h"
 #include "output/OwiNcFile.h"
 #include "output/OwiNetcdf.h"
 #include "output/OwiNetcdfDomain.h"
+#include "output/PointNetcdf.h"
+#include "output/PointNetcdfDomain.h"
 #include "output/RasNetcdf.h"
 #include "output/RasNetcdfDomain.h"
+#include "output/StreamCompression.h"
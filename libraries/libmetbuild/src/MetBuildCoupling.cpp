@@ -0,0 +1,287 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "MetBuildCoupling.h"
+
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Coupler.h"
+#include "CouplingRing.h"
+
+using namespace MetBuild;
+
+struct metbuild_coupler {
+  std::unique_ptr<Coupler> coupler;
+  mutable std::vector<MeteorologicalDataType> buffer;
+};
+
+struct metbuild_ring {
+  std::unique_ptr<CouplingRing> ring;
+  std::vector<std::string> names;
+  std::vector<MeteorologicalDataType> buffer;
+};
+
+namespace {
+thread_local std::string t_last_error;
+
+//...Exceptions must not cross into the model, so each call runs its body
+// here and turns any exception into a failure code
+template <typename F>
+int guarded(F &&f) {
+  try {
+    return f();
+  } catch (const std::exception &e) {
+    t_last_error = e.what();
+  } catch (...) {
+    t_last_error = "Unknown error";
+  }
+  return METBUILD_FAILURE;
+}
+
+int check(const void *handle) {
+  if (handle != nullptr) return METBUILD_SUCCESS;
+  t_last_error = "Null coupling handle";
+  return METBUILD_FAILURE;
+}
+
+int copy_name(const std::vector<std::string> &names, const int index,
+              char *name, const size_t length) {
+  if (index < 0 || static_cast<size_t>(index) >= names.size()) {
+    metbuild_throw_exception("Coupling variable index out of range");
+  }
+  if (length == 0) return METBUILD_SUCCESS;
+  std::strncpy(name, names[index].c_str(), length - 1);
+  name[length - 1] = '\0';
+  return METBUILD_SUCCESS;
+}
+
+size_t find_name(const std::vector<std::string> &names, const char *name) {
+  for (size_t k = 0; k < names.size(); ++k) {
+    if (names[k] == name) return k;
+  }
+  metbuild_throw_exception(std::string("Unknown coupling variable ") + name);
+  return 0;
+}
+
+//...The model takes double precision values, which the library may not use
+void widen(const std::vector<MeteorologicalDataType> &values, double *dest) {
+  for (size_t i = 0; i < values.size(); ++i) {
+    dest[i] = static_cast<double>(values[i]);
+  }
+}
+}  // namespace
+
+const char *metbuild_last_error(void) { return t_last_error.c_str(); }
+
+int metbuild_coupler_create(const double *x, const double *y, const size_t n,
+                            const int source, const int type,
+                            const int time_step, const int epsg,
+                            metbuild_coupler **coupler) {
+  if (check(coupler) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  *coupler = nullptr;
+  return guarded([&]() {
+    std::vector<Point> nodes;
+    nodes.reserve(n);
+    for (size_t i = 0; i < n; ++i) nodes.emplace_back(x[i], y[i]);
+    auto handle = std::make_unique<metbuild_coupler>();
+    handle->coupler = std::make_unique<Coupler>(
+        std::move(nodes), static_cast<Meteorology::SOURCE>(source),
+        static_cast<GriddedDataTypes::TYPE>(type), time_step, epsg);
+    handle->buffer.resize(n);
+    *coupler = handle.release();
+    return METBUILD_SUCCESS;
+  });
+}
+
+int metbuild_coupler_add_file(metbuild_coupler *coupler, const char *filename,
+                              const long long time) {
+  if (check(coupler) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  return guarded([&]() {
+    coupler->coupler->add_file(std::string(filename), Date(time));
+    return METBUILD_SUCCESS;
+  });
+}
+
+int metbuild_coupler_initialize(metbuild_coupler *coupler,
+                                const long long start_date,
+                                const long long end_date) {
+  if (check(coupler) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  return guarded([&]() {
+    coupler->coupler->initialize(Date(start_date), Date(end_date));
+    return METBUILD_SUCCESS;
+  });
+}
+
+int metbuild_coupler_update_until(metbuild_coupler *coupler,
+                                  const double time) {
+  if (check(coupler) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  return guarded([&]() {
+    coupler->coupler->update_until(time);
+    return METBUILD_SUCCESS;
+  });
+}
+
+int metbuild_coupler_get_value(const metbuild_coupler *coupler,
+                               const char *name, double *dest) {
+  if (check(coupler) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  return guarded([&]() {
+    coupler->coupler->get_value(coupler->coupler->variable(name),
+                                coupler->buffer.data());
+    widen(coupler->buffer, dest);
+    return METBUILD_SUCCESS;
+  });
+}
+
+int metbuild_coupler_get_var_count(const metbuild_coupler *coupler,
+                                   int *count) {
+  if (check(coupler) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  *count = static_cast<int>(coupler->coupler->names().size());
+  return METBUILD_SUCCESS;
+}
+
+int metbuild_coupler_get_var_name(const metbuild_coupler *coupler,
+                                  const int index, char *name,
+                                  const size_t length) {
+  if (check(coupler) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  return guarded([&]() {
+    return copy_name(coupler->coupler->names(), index, name, length);
+  });
+}
+
+int metbuild_coupler_get_grid_size(const metbuild_coupler *coupler,
+                                   size_t *size) {
+  if (check(coupler) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  *size = coupler->coupler->size();
+  return METBUILD_SUCCESS;
+}
+
+int metbuild_coupler_get_current_time(const metbuild_coupler *coupler,
+                                      double *time) {
+  if (check(coupler) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  *time = coupler->coupler->current_time();
+  return METBUILD_SUCCESS;
+}
+
+int metbuild_coupler_get_end_time(const metbuild_coupler *coupler,
+                                  double *time) {
+  if (check(coupler) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  *time = coupler->coupler->end_time();
+  return METBUILD_SUCCESS;
+}
+
+int metbuild_coupler_get_time_step(const metbuild_coupler *coupler,
+                                   double *time_step) {
+  if (check(coupler) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  *time_step = coupler->coupler->time_step();
+  return METBUILD_SUCCESS;
+}
+
+/**
+ * Creates a ring of the given number of slots and publishes every step of
+ * an initialized coupler to it. Returns once the last step is written, and
+ * the ring stays available to its reader until the coupler is finalized
+ */
+int metbuild_coupler_publish(metbuild_coupler *coupler, const char *filename,
+                             const size_t slots) {
+  if (check(coupler) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  return guarded([&]() {
+    coupler->coupler->publish(std::string(filename), slots);
+    return METBUILD_SUCCESS;
+  });
+}
+
+int metbuild_coupler_finalize(metbuild_coupler *coupler) {
+  if (check(coupler) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  return guarded([&]() {
+    std::unique_ptr<metbuild_coupler> handle(coupler);
+    handle->coupler->finalize();
+    return METBUILD_SUCCESS;
+  });
+}
+
+int metbuild_ring_open(const char *filename, metbuild_ring **ring) {
+  if (check(ring) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  *ring = nullptr;
+  return guarded([&]() {
+    auto handle = std::make_unique<metbuild_ring>();
+    handle->ring = CouplingRing::open(filename);
+    handle->names = handle->ring->names();
+    handle->buffer.resize(handle->ring->size());
+    *ring = handle.release();
+    return METBUILD_SUCCESS;
+  });
+}
+
+/**
+ * Reads a field at a time from a ring, waiting up to timeout seconds for
+ * the step after it, or without limit when timeout is negative. Returns
+ * METBUILD_TIMEOUT when the step was not written in time
+ */
+int metbuild_ring_get_value(metbuild_ring *ring, const char *name,
+                            const double time, double *dest,
+                            const double timeout) {
+  if (check(ring) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  return guarded([&]() {
+    if (!ring->ring->read(time, find_name(ring->names, name),
+                          ring->buffer.data(), timeout)) {
+      t_last_error = "Timed out waiting for the coupling ring";
+      return METBUILD_TIMEOUT;
+    }
+    widen(ring->buffer, dest);
+    return METBUILD_SUCCESS;
+  });
+}
+
+int metbuild_ring_get_var_count(const metbuild_ring *ring, int *count) {
+  if (check(ring) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  *count = static_cast<int>(ring->names.size());
+  return METBUILD_SUCCESS;
+}
+
+int metbuild_ring_get_var_name(const metbuild_ring *ring, const int index,
+                               char *name, const size_t length) {
+  if (check(ring) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  return guarded([&]() { return copy_name(ring->names, index, name, length); });
+}
+
+int metbuild_ring_get_grid_size(const metbuild_ring *ring, size_t *size) {
+  if (check(ring) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  *size = ring->ring->size();
+  return METBUILD_SUCCESS;
+}
+
+int metbuild_ring_close(metbuild_ring *ring) {
+  if (check(ring) != METBUILD_SUCCESS) return METBUILD_FAILURE;
+  delete ring;
+  return METBUILD_SUCCESS;
+}
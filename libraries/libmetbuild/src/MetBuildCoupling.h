@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_METBUILDCOUPLING_H_
+#define METBUILD_SRC_METBUILDCOUPLING_H_
+
+/*
+ * C interface to the coupling of libmetbuild to an ocean model, for models
+ * written in C or in Fortran through iso_c_binding. The calls follow the
+ * Basic Model Interface: the model creates a coupler on its nodes, adds the
+ * source files, initializes it over the run and calls update_until and
+ * get_value at each of its meteorological steps.
+ *
+ * A model in another process opens the ring a coupler publishes to instead
+ * and reads the fields at its own times with metbuild_ring_get_value.
+ *
+ * Times are seconds since the start date given to initialize, dates are
+ * seconds since the epoch. Source and type codes are the values of
+ * MetBuild::Meteorology::SOURCE and MetBuild::GriddedDataTypes::TYPE. Every
+ * call returns METBUILD_SUCCESS or METBUILD_FAILURE, in which case
+ * metbuild_last_error describes the failure
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#include "MetBuild_Global.h"
+#define METBUILD_C_EXPORT METBUILD_EXPORT
+extern "C" {
+#else
+#define METBUILD_C_EXPORT
+#endif
+
+#define METBUILD_SUCCESS 0
+#define METBUILD_FAILURE 1
+#define METBUILD_TIMEOUT 2
+
+typedef struct metbuild_coupler metbuild_coupler;
+typedef struct metbuild_ring metbuild_ring;
+
+METBUILD_C_EXPORT const char *metbuild_last_error(void);
+
+METBUILD_C_EXPORT int metbuild_coupler_create(const double *x,
+                                              const double *y, size_t n,
+                                              int source, int type,
+                                              int time_step, int epsg,
+                                              metbuild_coupler **coupler);
+
+METBUILD_C_EXPORT int metbuild_coupler_add_file(metbuild_coupler *coupler,
+                                                const char *filename,
+                                                long long time);
+
+METBUILD_C_EXPORT int metbuild_coupler_initialize(metbuild_coupler *coupler,
+                                                  long long start_date,
+                                                  long long end_date);
+
+METBUILD_C_EXPORT int metbuild_coupler_update_until(metbuild_coupler *coupler,
+                                                    double time);
+
+METBUILD_C_EXPORT int metbuild_coupler_get_value(
+    const metbuild_coupler *coupler, const char *name, double *dest);
+
+METBUILD_C_EXPORT int metbuild_coupler_get_var_count(
+    const metbuild_coupler *coupler, int *count);
+
+METBUILD_C_EXPORT int metbuild_coupler_get_var_name(
+    const metbuild_coupler *coupler, int index, char *name, size_t length);
+
+METBUILD_C_EXPORT int metbuild_coupler_get_grid_size(
+    const metbuild_coupler *coupler, size_t *size);
+
+METBUILD_C_EXPORT int metbuild_coupler_get_current_time(
+    const metbuild_coupler *coupler, double *time);
+
+METBUILD_C_EXPORT int metbuild_coupler_get_end_time(
+    const metbuild_coupler *coupler, double *time);
+
+METBUILD_C_EXPORT int metbuild_coupler_get_time_step(
+    const metbuild_coupler *coupler, double *time_step);
+
+METBUILD_C_EXPORT int metbuild_coupler_publish(metbuild_coupler *coupler,
+                                               const char *filename,
+                                               size_t slots);
+
+METBUILD_C_EXPORT int metbuild_coupler_finalize(metbuild_coupler *coupler);
+
+METBUILD_C_EXPORT int metbuild_ring_open(const char *filename,
+                                         metbuild_ring **ring);
+
+METBUILD_C_EXPORT int metbuild_ring_get_value(metbuild_ring *ring,
+                                              const char *name, double time,
+                                              double *dest, double timeout);
+
+METBUILD_C_EXPORT int metbuild_ring_get_var_count(const metbuild_ring *ring,
+                                                  int *count);
+
+METBUILD_C_EXPORT int metbuild_ring_get_var_name(const metbuild_ring *ring,
+                                                 int index, char *name,
+                                                 size_t length);
+
+METBUILD_C_EXPORT int metbuild_ring_get_grid_size(const metbuild_ring *ring,
+                                                  size_t *size);
+
+METBUILD_C_EXPORT int metbuild_ring_close(metbuild_ring *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // METBUILD_SRC_METBUILDCOUPLING_H_
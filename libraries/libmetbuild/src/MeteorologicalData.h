@@ -29,12 +29,18 @@
 #ifndef METGET_SRC_METEOROLOGICALDATA_H_
 #define METGET_SRC_METEOROLOGICALDATA_H_
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstddef>
+#include <utility>
 #include <vector>
 
 #include "CppAttributes.h"
+#include "Instrumentation.h"
+#include "LargeBufferAllocator.h"
+#include "MemoryPolicy.h"
+#include "Span.h"
 
 namespace MetBuild {
 
@@ -45,6 +51,18 @@ using MeteorologicalDataType = float;
 using MeteorologicalDataType = double;
 #endif
 
+//...Precision of the decoded source fields and the interpolation weights.
+// Building with METBUILD_SOURCE_FLOAT keeps them in single precision from the
+// source cache through the interpolation kernels
+#ifdef METBUILD_SOURCE_FLOAT
+#ifndef METBUILD_USE_FLOAT
+#error "METBUILD_SOURCE_FLOAT requires single precision output data"
+#endif
+using SourceDataType = float;
+#else
+using SourceDataType = double;
+#endif
+
 template <unsigned parameters, typename T = MeteorologicalDataType>
 class MeteorologicalData {
  public:
@@ -55,6 +73,30 @@ class MeteorologicalData {
 
   virtual ~MeteorologicalData() = default;
 
+  MeteorologicalData(const MeteorologicalData &) = default;
+
+  MeteorologicalData &operator=(const MeteorologicalData &) = default;
+
+#ifndef SWIG
+  //...Declared so that the virtual destructor does not turn moves into
+  // copies of the whole grid
+  MeteorologicalData(MeteorologicalData &&other) noexcept
+      : m_ni(std::exchange(other.m_ni, 0)),
+        m_nj(std::exchange(other.m_nj, 0)),
+        m_data(std::move(other.m_data)),
+        m_memory(std::move(other.m_memory)),
+        m_constant(std::exchange(other.m_constant, {})) {}
+
+  MeteorologicalData &operator=(MeteorologicalData &&other) noexcept {
+    m_ni = std::exchange(other.m_ni, 0);
+    m_nj = std::exchange(other.m_nj, 0);
+    m_data = std::move(other.m_data);
+    m_memory = std::move(other.m_memory);
+    m_constant = std::exchange(other.m_constant, {});
+    return *this;
+  }
+#endif
+
   NODISCARD static constexpr T background_pressure() { return 1013.0; }
 
   NODISCARD static constexpr T flag_value() { return -999.0; }
@@ -66,54 +108,88 @@ class MeteorologicalData {
   void resize(const size_t ni, const size_t nj) {
     m_ni = ni;
     m_nj = nj;
-    for (auto &v : m_data) {
-      v.resize(m_nj);
-      for (auto &vv : v) {
-        vv.resize(m_ni);
-        std::fill(vv.begin(), vv.end(),
-                  MeteorologicalData<parameters, T>::flag_value());
-      }
-    }
+    m_data.resize(parameters * m_ni * m_nj);
+    MemoryPolicy::fill(m_data.data(), m_data.size(),
+                       MeteorologicalData<parameters, T>::flag_value());
+    m_memory.set(m_data.size() * sizeof(T));
+    m_constant.fill(false);
   }
 
-  NODISCARD const std::vector<std::vector<T>> &operator[](
-      const size_t index) const {
+  /**
+   * @brief True when every value of the parameter was set by a single fill
+   * and has not been handed out for writing since, so writers may reuse the
+   * output formatted for an earlier step holding the same value
+   */
+  NODISCARD bool constant(const size_t index) const {
     assert(index < parameters);
-    return m_data[index];
+    return m_constant[index];
   }
 
-  NODISCARD std::vector<T> toVector(const size_t index) const {
+#ifndef SWIG
+  /**
+   * @brief Row-major view of one parameter, indexed as [j][i]
+   */
+  NODISCARD Span2d<const T> operator[](const size_t index) const {
     assert(index < parameters);
-    std::vector<T> v;
-    v.reserve(m_ni * m_nj);
-    for (const auto &r : m_data[index]) {
-      for (const auto c : r) {
-        v.push_back(c);
-      }
-    }
-    return v;
+    return {m_data.data() + index * m_ni * m_nj, m_ni, m_nj};
+  }
+
+  NODISCARD Span2d<T> operator[](const size_t index) {
+    assert(index < parameters);
+    m_constant[index] = false;
+    return {m_data.data() + index * m_ni * m_nj, m_ni, m_nj};
+  }
+
+  /**
+   * @brief Contiguous values of one parameter in row-major order
+   */
+  NODISCARD Span<const T> parameter(const size_t index) const {
+    assert(index < parameters);
+    return {m_data.data() + index * m_ni * m_nj, m_ni * m_nj};
   }
 
-  NODISCARD std::vector<std::vector<T>> &operator[](const size_t index) {
+  NODISCARD Span<T> parameter(const size_t index) {
     assert(index < parameters);
-    return m_data[index];
+    m_constant[index] = false;
+    return {m_data.data() + index * m_ni * m_nj, m_ni * m_nj};
+  }
+
+  /**
+   * @brief Contiguous values of row j of one parameter, so loops that
+   * stream along i write sequentially in memory
+   */
+  NODISCARD Span<const T> row(const size_t parameter, const size_t j) const {
+    assert(parameter < parameters);
+    assert(j < m_nj);
+    return {m_data.data() + this->offset(parameter, j, 0), m_ni};
+  }
+
+  NODISCARD Span<T> row(const size_t parameter, const size_t j) {
+    assert(parameter < parameters);
+    assert(j < m_nj);
+    m_constant[parameter] = false;
+    return {m_data.data() + this->offset(parameter, j, 0), m_ni};
+  }
+#endif
+
+  NODISCARD std::vector<T> toVector(const size_t index) const {
+    assert(index < parameters);
+    const auto v = this->parameter(index);
+    return {v.begin(), v.end()};
   }
 
   virtual void fill(const T value) { this->fill_all(value); }
 
   void fill_parameter(const size_t index, const T value) {
     assert(index < parameters);
-    for (auto &v : m_data[index]) {
-      std::fill(v.begin(), v.end(), value);
-    }
+    const auto v = this->parameter(index);
+    std::fill(v.begin(), v.end(), value);
+    m_constant[index] = true;
   }
 
   void fill_all(const T value = flag_value()) {
-    for (auto &v : m_data) {
-      for (auto &vv : v) {
-        std::fill(vv.begin(), vv.end(), value);
-      }
-    }
+    MemoryPolicy::fill(m_data.data(), m_data.size(), value);
+    m_constant.fill(true);
   }
 
   void set(const size_t parameter, const size_t i, const size_t j,
@@ -121,7 +197,8 @@ class MeteorologicalData {
     assert(parameter < parameters);
     assert(i < m_ni);
     assert(j < m_nj);
-    m_data[parameter][j][i] = value;
+    m_data[this->offset(parameter, j, i)] = value;
+    m_constant[parameter] = false;
   }
 
   NODISCARD T get(const size_t parameter, const size_t i,
@@ -129,7 +206,7 @@ class MeteorologicalData {
     assert(parameter < parameters);
     assert(i < m_ni);
     assert(j < m_nj);
-    return m_data[parameter][i][j];
+    return m_data[this->offset(parameter, j, i)];
   }
 
   NODISCARD std::array<T, parameters> getPack(const size_t i,
@@ -138,7 +215,7 @@ class MeteorologicalData {
     assert(i < m_ni);
     assert(j < m_nj);
     for (size_t p = 0; p < parameters; ++p) {
-      out[p] = m_data[p][i][j];
+      out[p] = m_data[this->offset(p, j, i)];
     }
     return out;
   }
@@ -149,35 +226,27 @@ class MeteorologicalData {
     assert(i < m_ni);
     assert(j < m_nj);
     for (size_t p = 0; p < parameters; ++p) {
-      m_data[p][i][j] = data[p];
+      m_data[this->offset(p, j, i)] = data[p];
     }
+    m_constant.fill(false);
   }
 
   NODISCARD constexpr size_t nParameters() const { return parameters; }
 
- protected:
-#ifndef SWIG
-  template <unsigned size, typename T_in, typename T_out>
-  static auto recast(const MeteorologicalData<size, T_in> &value) {
-    MeteorologicalData<size, T_out> v(value.ni(), value.nj());
-    for (auto i = 0; i < value.ni(); ++i) {
-      for (auto j = 0; j < value.nj(); ++j) {
-        auto f = value.getPack(i, j);
-        std::array<T_out, size> ff;
-        for (auto k = 0; k < size; ++k) {
-          ff[k] = static_cast<T_out>(f[k]);
-        }
-        v.setPack(i, j, ff);
-      }
-    }
-    return v;
+ private:
+  /**
+   * @brief Position of an entry in the parameter-major, row-major buffer
+   */
+  NODISCARD size_t offset(const size_t parameter, const size_t row,
+                          const size_t column) const {
+    return (parameter * m_nj + row) * m_ni + column;
   }
-#endif
 
- private:
   size_t m_ni;
   size_t m_nj;
-  std::array<std::vector<std::vector<T>>, parameters> m_data;
+  std::vector<T, LargeBufferAllocator<T>> m_data;
+  Instrumentation::MemoryTracker m_memory{Instrumentation::OUTPUT_MEMORY};
+  std::array<bool, parameters> m_constant{};
 };
 
 }  // namespace MetBuild
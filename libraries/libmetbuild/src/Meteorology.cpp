@@ -28,16 +28,28 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "Meteorology.h"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <utility>
 
+#include "CellOrder.h"
+#include "GribIndex.h"
+#include "Hash.h"
+#include "Instrumentation.h"
+#include "InterpolationCache.h"
+#include "InterpolationKernel.h"
 #include "Logging.h"
 #include "MetBuild_Status.h"
 #include "Projection.h"
+#include "SharedCache.h"
+#include "ThreadPool.h"
 #include "Triangulation.h"
+#include "data_sources/ArrayData.h"
 #include "data_sources/CoampsData.h"
+#include "data_sources/FieldFile.h"
 #include "data_sources/GefsData.h"
 #include "data_sources/GfsData.h"
 #include "data_sources/Grib.h"
@@ -49,48 +61,303 @@
 
 using namespace MetBuild;
 
+namespace {
+SharedCache<GriddedData> s_sources;
+
+/**
+ * @brief Box around the output grid in the coordinates a source is located
+ * in, padded so that source cells straddling the edge are kept
+ * @param grid output grid positions
+ * @param convention coordinate convention of the source
+ * @return extent, unbounded when the grid wraps the 180 meridian
+ */
+Triangulation::Extent output_extent(const Grid::grid &grid,
+                                    const COORDINATE_CONVENTION convention) {
+  constexpr double inf = std::numeric_limits<double>::infinity();
+  Triangulation::Extent extent{inf, inf, -inf, -inf};
+  for (const auto &row : grid) {
+    for (const auto &p : row) {
+      const double x = convention == CONVENTION_180
+                           ? std::fmod(p.x() + 180.0, 360.0) - 180.0
+                           : p.x();
+      extent.xmin = std::min(extent.xmin, x);
+      extent.xmax = std::max(extent.xmax, x);
+      extent.ymin = std::min(extent.ymin, p.y());
+      extent.ymax = std::max(extent.ymax, p.y());
+    }
+  }
+  if (extent.xmin > extent.xmax || extent.xmax - extent.xmin > 180.0) {
+    return {-inf, -inf, inf, inf};
+  }
+  const double pad = 0.01 * std::max(extent.xmax - extent.xmin,
+                                     extent.ymax - extent.ymin);
+  return {extent.xmin - pad, extent.ymin - pad, extent.xmax + pad,
+          extent.ymax + pad};
+}
+
+/**
+ * @brief Box holding every point of a source, widened by the distance from
+ * the source over which output points may still be weighted
+ */
+Triangulation::Extent source_extent(const GriddedData &data, const double pad) {
+  const auto x =
+      std::minmax_element(data.longitude1d().begin(), data.longitude1d().end());
+  const auto y =
+      std::minmax_element(data.latitude1d().begin(), data.latitude1d().end());
+  return {*x.first - pad, *y.first - pad, *x.second + pad, *y.second + pad};
+}
+
+bool inside(const Triangulation::Extent &e, const double x, const double y) {
+  return x >= e.xmin && x <= e.xmax && y >= e.ymin && y <= e.ymax;
+}
+
+/**
+ * @brief Smallest distance in degrees between neighbouring output points,
+ * measured along whichever of longitude and latitude they differ most in
+ * @param grid output grid positions
+ * @return spacing, or infinity for a grid of a single point
+ */
+double output_spacing(const Grid::grid &grid) {
+  double spacing = std::numeric_limits<double>::infinity();
+  auto distance = [](const Point &a, const Point &b) {
+    double dx = std::fabs(a.x() - b.x());
+    if (dx > 180.0) dx = 360.0 - dx;
+    return std::max(dx, std::fabs(a.y() - b.y()));
+  };
+  for (size_t i = 0; i < grid.size(); ++i) {
+    for (size_t j = 0; j < grid[i].size(); ++j) {
+      if (i + 1 < grid.size()) {
+        spacing = std::min(spacing, distance(grid[i][j], grid[i + 1][j]));
+      }
+      if (j + 1 < grid[i].size()) {
+        spacing = std::min(spacing, distance(grid[i][j], grid[i][j + 1]));
+      }
+    }
+  }
+  return spacing;
+}
+
+//...Cells interpolated by one task of the thread pool, rounded to whole rows
+constexpr size_t c_band_cells = 65536;
+
+/**
+ * @brief Runs f(begin, count) over every run of cells, cut into bands of whole
+ * rows that are run on the thread pool. The bands hold disjoint cells, so each
+ * call writes its own part of the output. Within a band the runs are handed
+ * over in the CellOrder selected
+ * @param ranges ordered, non-overlapping runs of cells
+ * @param ni cells per row
+ * @param cancel token checked before each band, may be null
+ * @param f function run on the part of each run inside a band
+ */
+template <typename F>
+void for_each_band(const InterpolationWeights::CellRanges &ranges,
+                   const size_t ni, const CancelToken *cancel, F &&f) {
+  if (ranges.empty()) return;
+  const size_t band = std::max<size_t>(c_band_cells / ni, 1) * ni;
+  const size_t first = ranges.front().begin / band;
+  const size_t last = (ranges.back().end + band - 1) / band;
+  ThreadPool::global().parallel_for(first, last, [&](const size_t b) {
+    CancelToken::check(cancel);
+    const size_t b0 = b * band;
+    CellOrder::for_each(ranges, ni, b0, b0 + band, f);
+  });
+}
+
+/**
+ * @brief Fields of a batch of output steps blended from the same two
+ * snapshots. Each field is read either from the source snapshots or from
+ * their interpolated grids
+ */
+struct BlendBatch {
+  std::vector<Kernel::SourceField> first;
+  std::vector<Kernel::SourceField> second;
+  std::vector<const MeteorologicalDataType *> interpolated_first;
+  std::vector<const MeteorologicalDataType *> interpolated_second;
+  std::vector<MeteorologicalDataType> fill;
+  std::vector<std::vector<MeteorologicalDataType *>> out;
+};
+
+/**
+ * @brief Writes every step of a batch. The stencils of both snapshots are
+ * gathered once per cell, or read once from the interpolated grids, and
+ * blended once per step
+ * @param valid runs of cells valid in both snapshots
+ * @param invalid runs of the other cells
+ * @param ni cells per row
+ * @param w1 weights onto the first snapshot, unused for interpolated grids
+ * @param w2 weights onto the second snapshot, unused for interpolated grids
+ * @param batch fields and outputs, indexed [field][step]
+ * @param time_weights weight of the second snapshot for each step
+ * @param cancel token checked before each band, may be null
+ */
+void blend_steps(const InterpolationWeights::CellRanges &valid,
+                 const InterpolationWeights::CellRanges &invalid,
+                 const size_t ni, const Kernel::WeightView *w1,
+                 const Kernel::WeightView *w2, const BlendBatch &batch,
+                 const std::vector<double> &time_weights,
+                 const CancelToken *cancel) {
+  const size_t m = batch.fill.size();
+  for_each_band(invalid, ni, cancel, [&](size_t begin, size_t count) {
+    for (size_t f = 0; f < m; ++f) {
+      for (auto *out : batch.out[f]) {
+        std::fill(out + begin, out + begin + count, batch.fill[f]);
+      }
+    }
+  });
+
+  const bool interpolated = batch.first.empty();
+  for_each_band(valid, ni, cancel, [&](size_t begin, size_t count) {
+    std::vector<MeteorologicalDataType> scratch;
+    std::vector<const MeteorologicalDataType *> a(m);
+    std::vector<const MeteorologicalDataType *> b(m);
+    if (interpolated) {
+      for (size_t f = 0; f < m; ++f) {
+        a[f] = batch.interpolated_first[f] + begin;
+        b[f] = batch.interpolated_second[f] + begin;
+      }
+    } else {
+      scratch.resize(2 * m * count);
+      std::vector<MeteorologicalDataType *> out_a(m);
+      std::vector<MeteorologicalDataType *> out_b(m);
+      for (size_t f = 0; f < m; ++f) {
+        out_a[f] = scratch.data() + f * count;
+        out_b[f] = scratch.data() + (m + f) * count;
+        a[f] = out_a[f];
+        b[f] = out_b[f];
+      }
+      Kernel::interpolate_batch(begin, count, *w1, batch.first.data(), m,
+                                batch.fill.data(), out_a.data());
+      Kernel::interpolate_batch(begin, count, *w2, batch.second.data(), m,
+                                batch.fill.data(), out_b.data());
+    }
+    for (size_t f = 0; f < m; ++f) {
+      for (size_t k = 0; k < time_weights.size(); ++k) {
+        Kernel::blend_valid(count, a[f], b[f], time_weights[k],
+                            batch.out[f][k] + begin);
+      }
+    }
+  });
+}
+
+/**
+ * @brief Type of a grib source, passed to the visitor of visit_grib_source
+ */
+template <typename T>
+struct SourceTag {
+  using type = T;
+};
+
+/**
+ * @brief Calls f with the tag of the class of a grib source, so that each
+ * use of a source is instantiated for its class and traits and the source
+ * type is only switched on once
+ * @param source source type
+ * @param error message thrown when the source is not a grib source
+ * @param f visitor taking a SourceTag
+ * @return value returned by f
+ */
+template <typename F>
+auto visit_grib_source(const Meteorology::SOURCE source,
+                       const std::string &error, F &&f) {
+  switch (source) {
+    case Meteorology::GFS:
+      return f(SourceTag<GfsData>{});
+    case Meteorology::GEFS:
+      return f(SourceTag<GefsData>{});
+    case Meteorology::NAM:
+      return f(SourceTag<NamData>{});
+    case Meteorology::HWRF:
+      return f(SourceTag<HwrfData>{});
+    case Meteorology::HRRR_CONUS:
+      return f(SourceTag<HrrrConusData>{});
+    case Meteorology::HRRR_ALASKA:
+      return f(SourceTag<HrrrAlaskaData>{});
+    case Meteorology::WPC:
+      return f(SourceTag<WpcData>{});
+    default:
+      Logging::throwError(error);
+      return decltype(f(SourceTag<GfsData>{})){};
+  }
+}
+}  // namespace
+
 Meteorology::Meteorology(const MetBuild::Grid *windGrid,
                          Meteorology::SOURCE source,
                          MetBuild::GriddedDataTypes::TYPE type, bool backfill,
                          int epsg_output)
-    : m_type(type),
+    : Meteorology(windGrid, source,
+                  std::vector<MetBuild::GriddedDataTypes::TYPE>{type},
+                  backfill, epsg_output) {}
+
+/**
+ * @brief Constructs an object producing several data types from a single
+ * decode of each source file and a single set of interpolation weights
+ * @param windGrid output grid
+ * @param source data source
+ * @param types data types to produce. The first one is reported by type()
+ * @param backfill fill cells outside the source with the flag value
+ * @param epsg_output projection of the output grid
+ */
+Meteorology::Meteorology(
+    const MetBuild::Grid *windGrid, Meteorology::SOURCE source,
+    const std::vector<MetBuild::GriddedDataTypes::TYPE> &types, bool backfill,
+    int epsg_output)
+    : m_types(types),
       m_source(source),
       m_windGrid(windGrid),
-      m_grid_positions(m_windGrid->grid_positions()),
-      m_gridded1(nullptr),
-      m_gridded2(nullptr),
-      m_rate_scaling_1(1.0),
-      m_rate_scaling_2(1.0),
-      m_interpolation_1(nullptr),
-      m_interpolation_2(nullptr),
+      //...Source data is WGS84, so other output projections are converted
+      //   once and kept on the grid
+      m_grid_positions(epsg_output == 4326
+                           ? &m_windGrid->grid_positions()
+                           : &m_windGrid->geographic_positions(epsg_output)),
+      m_grid_fingerprint(
+          Hash().add(m_windGrid->fingerprint()).add(epsg_output).value()),
+      m_output_spacing(output_spacing(*m_grid_positions)),
+      m_snapshot_1(nullptr),
+      m_snapshot_2(nullptr),
+      m_use_region(false),
+      m_region_changed(false),
+      m_ring_depth(3),
+      m_snapshot_interpolation(false),
+      m_interpolation_method(TRIANGULAR),
+      m_idw_radius(0.5),
+      m_cancel(nullptr),
       m_useBackgroundFlag(backfill),
       m_epsg_output(epsg_output),
-      m_variables(generate_variable_list(type)) {
-  // We assume that all data in the database is in WGS84 and the user can
-  // get out other projections if they need to
-  if (m_epsg_output != 4326) {
-    m_grid_positions = Meteorology::reproject_grid(m_grid_positions);
+      m_variables(generate_variable_list(types)),
+      //...Enough buffers for the snapshot rotating out to hand its storage to
+      //   the next one decoded
+      m_buffer_pool(std::make_shared<BufferPool>(2 * m_variables.size())) {
+  if (m_types.empty()) {
+    metbuild_throw_exception("At least one data type must be requested");
   }
+  for (auto it = m_types.begin(); it != m_types.end();) {
+    it = std::find(m_types.begin(), it, *it) != it ? m_types.erase(it)
+                                                   : std::next(it);
+  }
+  m_type = m_types.front();
 }
 
-MetBuild::Grid::grid Meteorology::reproject_grid(MetBuild::Grid::grid g) const {
-  std::vector<Point> pts;
-  pts.reserve(g.size() * g[0].size());
-  for (const auto &row : g) {
-    for (const auto &v : row) {
-      pts.push_back(v);
-    }
-  }
-  bool latlon = true;
-  auto pts_out = Projection::transform(m_epsg_output, 4326, pts, latlon);
-  size_t count = 0;
-  for (auto &row : g) {
-    for (auto &v : row) {
-      v = pts_out[count];
-      count++;
+/**
+ * @brief Union of the variables needed by a set of data types, so each
+ * variable is decoded only once per file
+ * @param types requested data types
+ * @return variables in the order they are first needed
+ */
+std::vector<MetBuild::GriddedDataTypes::VARIABLES>
+Meteorology::generate_variable_list(
+    const std::vector<MetBuild::GriddedDataTypes::TYPE> &types) {
+  std::vector<MetBuild::GriddedDataTypes::VARIABLES> variables;
+  for (const auto &type : types) {
+    for (const auto &v : Meteorology::generate_variable_list(type)) {
+      if (std::find(variables.begin(), variables.end(), v) ==
+          variables.end()) {
+        variables.push_back(v);
+      }
     }
   }
-  return g;
+  return variables;
 }
 
 void Meteorology::set_next_file(const std::string &filename) {
@@ -103,6 +370,364 @@ void Meteorology::set_next_file(const std::vector<std::string> &filenames) {
   m_file2 = filenames;
 }
 
+Meteorology::~Meteorology() {
+  for (auto &pending : m_prefetch) {
+    pending.second.wait();
+  }
+}
+
+/**
+ * @brief Starts decoding a file in the background so that it is ready by the
+ * time it is passed to set_next_file
+ *
+ * At most ring_depth() - 2 files are held ahead of the current interval. When
+ * the ring is full the request is ignored
+ *
+ * @param filenames files making up the snapshot
+ */
+void Meteorology::prefetch_file(const std::vector<std::string> &filenames) {
+  if (filenames.empty()) return;
+  if ((m_snapshot_1 && m_snapshot_1->filenames == filenames) ||
+      (m_snapshot_2 && m_snapshot_2->filenames == filenames)) {
+    return;
+  }
+  for (const auto &pending : m_prefetch) {
+    if (pending.first == filenames) return;
+  }
+  if (m_prefetch.size() + 2 >= m_ring_depth) return;
+
+  //...Chained on the previous snapshot so weights can be shared when the
+  // source grid does not change
+  std::shared_future<std::shared_ptr<Snapshot>> previous;
+  if (!m_prefetch.empty()) {
+    previous = m_prefetch.back().second;
+  } else {
+    std::promise<std::shared_ptr<Snapshot>> ready;
+    ready.set_value(m_snapshot_2);
+    previous = ready.get_future().share();
+  }
+
+  const bool interpolate = m_snapshot_interpolation;
+  m_prefetch.emplace_back(
+      filenames,
+      ThreadPool::global()
+          .async([this, filenames, previous, interpolate]() {
+            std::shared_ptr<const Snapshot> p;
+            try {
+              p = previous.get();
+            } catch (...) {
+              //...A failed predecessor is reported when it is acquired
+            }
+            return this->load_snapshot(filenames, p, interpolate);
+          })
+          .share());
+}
+
+void Meteorology::prefetch_file(const std::string &filename) {
+  this->prefetch_file(std::vector<std::string>{filename});
+}
+
+/**
+ * @brief Generates the interpolation weights from a source file onto the
+ * output grid without interpolating any data, so that later objects on the
+ * same source and output grids find them in the weight cache. Only the
+ * source coordinates are read
+ * @param filenames files making up one source snapshot
+ * @return key of the weights in the InterpolationCache
+ */
+std::string Meteorology::prepare_weights(
+    const std::vector<std::string> &filenames) {
+  const auto data = Meteorology::gridded_data_factory(filenames, m_source);
+  data->setOutputSpacing(m_output_spacing);
+  if (this->covers(*data)) {
+    this->generate_interpolation_data(data.get(), nullptr);
+  }
+  return this->weight_key(data.get());
+}
+
+std::string Meteorology::prepare_weights(const std::string &filename) {
+  return this->prepare_weights(std::vector<std::string>{filename});
+}
+
+/**
+ * @brief Sets the number of snapshots held at once, including the two that
+ * bracket the current output time
+ * @param depth ring depth, at least 2
+ */
+void Meteorology::set_ring_depth(size_t depth) {
+  m_ring_depth = std::max<size_t>(depth, 2);
+}
+
+size_t Meteorology::ring_depth() const { return m_ring_depth; }
+
+/**
+ * @brief Takes the settings of an execution policy which belong to this
+ * object. The shared settings are installed with ExecutionPolicy::apply
+ * @param policy execution policy
+ */
+void Meteorology::set_execution_policy(const ExecutionPolicy &policy) {
+  this->set_ring_depth(policy.ring_depth());
+}
+
+/**
+ * @brief Decodes a snapshot and generates its weights onto the output grid
+ * @param filenames files making up the snapshot
+ * @param previous previously loaded snapshot whose weights are shared when
+ * the source grid is identical, may be null
+ * @param interpolate also interpolate the snapshot onto the output grid
+ * @return decoded snapshot
+ */
+std::shared_ptr<Meteorology::Snapshot> Meteorology::load_snapshot(
+    const std::vector<std::string> &filenames,
+    std::shared_ptr<const Snapshot> previous, bool interpolate) const {
+  CancelToken::check(m_cancel);
+  //...Snapshots interpolated by an earlier run on the same files and grid
+  // are read back without decoding the source
+  //...Arrays held in memory are skipped, since they cannot be told apart
+  // from the arrays of a later run under the same name
+  std::string cache_key;
+  if (interpolate && SnapshotCache::enabled() &&
+      !ArrayData::contains(filenames[0])) {
+    cache_key = SnapshotCache::key(filenames, m_grid_fingerprint,
+                                   this->snapshot_settings());
+    if (auto cached = this->load_cached_snapshot(filenames, cache_key)) {
+      Instrumentation::count_event(Instrumentation::SNAPSHOT_HIT);
+      return cached;
+    }
+    Instrumentation::count_event(Instrumentation::SNAPSHOT_MISS);
+  }
+
+  auto snapshot = std::make_shared<Snapshot>();
+  snapshot->filenames = filenames;
+  snapshot->data = this->load_source(filenames);
+
+  //...Sources which do not reach the output grid, such as storm nests away
+  // from the domain, are neither decoded nor located. The snapshot is used
+  // through its fill values and covers no cell
+  if (!this->covers(*snapshot->data)) {
+    Instrumentation::count_event(Instrumentation::SNAPSHOT_OUTSIDE);
+    std::call_once(m_uncovered_once, [this]() {
+      m_uncovered = std::make_shared<const InterpolationData>(
+          InterpolationWeights(m_windGrid->ni(), m_windGrid->nj()));
+    });
+    snapshot->data = nullptr;
+    snapshot->interpolation = m_uncovered;
+    snapshot->interpolated = this->filled_grid();
+    return snapshot;
+  }
+
+  if (previous && previous->data && previous->interpolation &&
+      previous->data->fingerprint() == snapshot->data->fingerprint()) {
+    snapshot->interpolation = previous->interpolation;
+  } else {
+    snapshot->interpolation = this->generate_interpolation_data(
+        snapshot->data.get(), previous.get());
+  }
+
+  //...Copying a snapshot on the source nodes costs no more than gathering it
+  // once, so it is done here, off the thread writing the output
+  if (interpolate || this->pre_interpolated(*snapshot)) {
+    snapshot->interpolated = this->generate_interpolated_grid(
+        snapshot->data.get(), snapshot->interpolation.get());
+    if (!cache_key.empty()) {
+      SnapshotCache::store(
+          cache_key, snapshot->interpolation->interpolation(),
+          Meteorology::snapshot_fields(*snapshot->interpolated));
+    }
+  }
+  return snapshot;
+}
+
+/**
+ * @brief Decodes the variables of a set of source files
+ *
+ * Sources are shared with every other object reading the same files onto a
+ * grid with the same extent, so each file is decoded once for each footprint
+ * it is interpolated onto. Sources decode only the points needed for that
+ * footprint where their packing allows it, and sources much finer than the
+ * grid may be decimated to its spacing. All variables are decoded before the
+ * data is shared, after which it is only read
+ *
+ * @param filenames files making up the snapshot
+ * @return decoded source
+ */
+std::shared_ptr<GriddedData> Meteorology::load_source(
+    const std::vector<std::string> &filenames) const {
+  std::string key = std::to_string(static_cast<int>(m_source));
+  for (const auto &v : m_variables) {
+    key += ":" + std::to_string(static_cast<int>(v));
+  }
+  for (const auto &f : filenames) {
+    key += "|" + f;
+    if (const auto generation = ArrayData::generation(f)) {
+      key += "@" + std::to_string(generation);
+    }
+  }
+
+  //...Sources may only decode the part of the field around the output grid,
+  // so they are shared between grids with the same extent
+  Hash extent_hash;
+  for (const auto convention : {CONVENTION_180, CONVENTION_360}) {
+    const auto extent = output_extent(*m_grid_positions, convention);
+    extent_hash.add(extent.xmin)
+        .add(extent.ymin)
+        .add(extent.xmax)
+        .add(extent.ymax);
+  }
+  key += "#" + std::to_string(extent_hash.value());
+  //...Decimated sources depend on the spacing of the grid as well
+  if (Grib::sourceDecimation()) {
+    key += "~" + std::to_string(Hash().add(m_output_spacing).value());
+  }
+
+  return s_sources.acquire(key, [&]() {
+    std::shared_ptr<GriddedData> data =
+        Meteorology::gridded_data_factory(filenames, m_source);
+    data->setBufferPool(m_buffer_pool);
+    data->setDecodeExtent(output_extent(*m_grid_positions, data->convention()));
+    data->setOutputSpacing(m_output_spacing);
+    if (!this->covers(*data)) return data;
+    data->preloadVariables(m_variables);
+    for (const auto &v : m_variables) {
+      data->variable1d(v);
+    }
+    return data;
+  });
+}
+
+/**
+ * @brief Hash of the settings which change the weights generated for a
+ * source grid, zero for the default triangular weights on every cell
+ */
+uint64_t Meteorology::interpolation_settings() const {
+  const bool reference = !Triangulation::useFastLocators();
+  if (m_interpolation_method == TRIANGULAR && !m_windGrid->has_mask() &&
+      !reference) {
+    return 0;
+  }
+  Hash h;
+  h.add(static_cast<int>(m_interpolation_method))
+      .add(m_idw_radius)
+      .add(m_windGrid->mask_hash());
+  //...Reference weights are kept apart from those of the fast locators
+  if (reference) h.add(reference);
+  return h.value();
+}
+
+/**
+ * @brief Hash of the settings that change the values of an interpolated
+ * snapshot, used in the snapshot cache key
+ */
+uint64_t Meteorology::snapshot_settings() const {
+  Hash h;
+  h.add(static_cast<int>(m_source))
+      .add(m_useBackgroundFlag)
+      .add(m_epsg_output)
+      .add(sizeof(MeteorologicalDataType))
+      .add(this->interpolation_settings());
+  //...Decimated sources give other values on the same files and grid
+  const bool decimated = Grib::sourceDecimation();
+  if (decimated) h.add(decimated);
+  h.add(m_types.size());
+  for (const auto &type : m_types) {
+    h.add(static_cast<int>(type));
+  }
+  return h.value();
+}
+
+/**
+ * @brief Builds a snapshot from the snapshot cache. The snapshot has no
+ * decoded data, so it can only be used through its interpolated grid
+ * @param filenames files making up the snapshot
+ * @param key key generated by SnapshotCache::key
+ * @return snapshot, or nullptr when the entry is missing or does not hold
+ * every requested type
+ */
+std::shared_ptr<Meteorology::Snapshot> Meteorology::load_cached_snapshot(
+    const std::vector<std::string> &filenames, const std::string &key) const {
+  auto entry = SnapshotCache::load(key);
+  if (!entry) return nullptr;
+  const auto ni = m_windGrid->ni();
+  const auto nj = m_windGrid->nj();
+  if (entry->weights->ni() != ni || entry->weights->nj() != nj) return nullptr;
+
+  auto grid = std::make_unique<InterpolatedGrid>();
+  size_t found = 0;
+  for (const auto &type : m_types) {
+    const auto length = Meteorology::typeLengthMap(type);
+    if (type == MetBuild::GriddedDataTypes::WIND_PRESSURE) {
+      grid->wind.resize(ni, nj);
+    } else {
+      grid->scalar[static_cast<int>(type)].resize(ni, nj);
+    }
+    for (const auto &field : entry->fields) {
+      if (field.type != static_cast<int>(type) ||
+          field.parameter >= static_cast<int>(length)) {
+        continue;
+      }
+      auto plane = type == MetBuild::GriddedDataTypes::WIND_PRESSURE
+                       ? grid->wind.parameter(field.parameter)
+                       : grid->scalar[field.type].parameter(0);
+      std::copy(field.values.begin(), field.values.end(), plane.begin());
+      found++;
+    }
+  }
+
+  size_t expected = 0;
+  for (const auto &type : m_types) {
+    expected += Meteorology::typeLengthMap(type);
+  }
+  if (found != expected) return nullptr;
+
+  auto snapshot = std::make_shared<Snapshot>();
+  snapshot->filenames = filenames;
+  snapshot->interpolation =
+      std::make_shared<InterpolationData>(std::move(*entry->weights));
+  snapshot->interpolated = std::move(grid);
+  return snapshot;
+}
+
+/**
+ * @brief Planes of an interpolated grid in the form stored by the snapshot
+ * cache
+ */
+std::vector<SnapshotCache::Field> Meteorology::snapshot_fields(
+    const InterpolatedGrid &grid) {
+  constexpr auto wind = static_cast<int>(GriddedDataTypes::WIND_PRESSURE);
+  std::vector<SnapshotCache::Field> fields;
+  for (int p = 0; p < 3 && grid.wind.ni() > 0; ++p) {
+    const auto plane = grid.wind.parameter(p);
+    fields.push_back({wind, p, {plane.begin(), plane.end()}});
+  }
+  for (const auto &scalar : grid.scalar) {
+    const auto plane = scalar.second.parameter(0);
+    fields.push_back({scalar.first, 0, {plane.begin(), plane.end()}});
+  }
+  return fields;
+}
+
+/**
+ * @brief Returns the snapshot for a set of files, taking it from the
+ * prefetch ring when available and decoding it otherwise
+ * @param filenames files making up the snapshot
+ * @param previous snapshot whose weights may be shared
+ * @return decoded snapshot
+ */
+std::shared_ptr<Meteorology::Snapshot> Meteorology::acquire_snapshot(
+    const std::vector<std::string> &filenames,
+    const std::shared_ptr<const Snapshot> &previous) {
+  for (auto it = m_prefetch.begin(); it != m_prefetch.end(); ++it) {
+    if (it->first == filenames) {
+      //...Anything queued ahead of the requested file has been skipped
+      auto future = it->second;
+      m_prefetch.erase(m_prefetch.begin(), std::next(it));
+      Instrumentation::ScopedTimer timer(Instrumentation::DECODE_WAIT);
+      return future.get();
+    }
+  }
+  return this->load_snapshot(filenames, previous, m_snapshot_interpolation);
+}
+
 int Meteorology::process_data() {
   assert(!m_file1.empty());
   assert(!m_file2.empty());
@@ -113,145 +738,667 @@ int Meteorology::process_data() {
     return MB_ERROR;
   }
 
-  if (m_gridded1 && m_gridded2) {
-    if (m_file1 == m_gridded1->filenames() &&
-        m_file2 == m_gridded2->filenames()) {
+  if (m_snapshot_1 && m_snapshot_2) {
+    if (m_file1 == m_snapshot_1->filenames &&
+        m_file2 == m_snapshot_2->filenames) {
+      if (m_region_changed) this->update_ranges();
       return MB_NOERROR;
     }
   }
 
-  if (m_gridded2) {
-    if (m_gridded2->filenames() == m_file1) {
-      m_gridded1.reset(nullptr);
-      m_gridded1 = std::move(m_gridded2);
-      m_interpolation_1 = std::move(m_interpolation_2);
-    } else {
-      m_gridded1 =
-          MetBuild::Meteorology::gridded_data_factory(m_file1, m_source);
-      m_interpolation_1 = std::make_shared<InterpolationData>(
-          m_gridded1->generate_triangulation(), m_grid_positions,
-          m_gridded1->convention());
-    }
-  } else {
-    m_gridded1 = MetBuild::Meteorology::gridded_data_factory(m_file1, m_source);
-    m_interpolation_1 = std::make_shared<InterpolationData>(
-        m_gridded1->generate_triangulation(), m_grid_positions,
-        m_gridded1->convention());
+  if (m_snapshot_2 && m_snapshot_2->filenames == m_file1) {
+    m_snapshot_1 = std::move(m_snapshot_2);
+  } else if (!m_snapshot_1 || m_snapshot_1->filenames != m_file1) {
+    m_snapshot_1 = this->acquire_snapshot(m_file1, m_snapshot_2);
   }
 
-  m_gridded2 = MetBuild::Meteorology::gridded_data_factory(m_file2, m_source);
-  if (m_gridded1->latitude1d() == m_gridded2->latitude1d() &&
-      m_gridded1->longitude1d() == m_gridded2->longitude1d()) {
-    m_interpolation_2 = std::make_shared<InterpolationData>(*m_interpolation_1);
-  } else {
-    m_interpolation_2 = std::make_shared<InterpolationData>(
-        m_gridded2->generate_triangulation(), m_grid_positions,
-        m_gridded2->convention());
+  //...Both slots name the same files at the ends of a request, which are
+  // then decoded once
+  if (m_file2 == m_file1) {
+    m_snapshot_2 = m_snapshot_1;
+  } else if (!m_snapshot_2 || m_snapshot_2->filenames != m_file2) {
+    m_snapshot_2 = this->acquire_snapshot(m_file2, m_snapshot_1);
   }
 
+  //...Cells outside either source are fixed until the files change
+  m_source_ranges = InterpolationWeights::valid_ranges(
+      m_snapshot_1->interpolation->interpolation(),
+      m_snapshot_2->interpolation->interpolation());
+  this->update_ranges();
+
   return MB_NOERROR;
 }
 
-MetBuild::MeteorologicalData<1> Meteorology::scalar_value_interpolation(
-    const double time_weight) {
-  MeteorologicalData<1> r(m_windGrid->ni(), m_windGrid->nj());
+/**
+ * @brief Rebuilds the cells interpolated and the cells filled from the source
+ * coverage and the region
+ */
+void Meteorology::update_ranges() {
+  m_valid_ranges = m_use_region ? InterpolationWeights::intersect(
+                                      m_source_ranges, m_region)
+                                : m_source_ranges;
+  m_invalid_ranges = InterpolationWeights::complement(
+      m_valid_ranges, m_windGrid->ni() * m_windGrid->nj());
+  m_region_changed = false;
+}
 
-  if (time_weight < 0.0) {
-    if (this->m_useBackgroundFlag) {
-      r.fill(MeteorologicalData<1>::flag_value());
-    } else {
-      r.fill(0.0);
-    }
-    return r;
+/**
+ * @brief Restricts interpolation to a region of the output grid. Cells
+ * outside the region are filled as if the source did not cover them
+ * @param region ordered, non-overlapping runs of output cells
+ */
+void Meteorology::set_region(
+    const MetBuild::InterpolationWeights::CellRanges &region) {
+  m_region = region;
+  m_use_region = true;
+  m_region_changed = true;
+}
+
+/**
+ * @brief Interpolates over the whole output grid again
+ */
+void Meteorology::clear_region() {
+  if (!m_use_region) return;
+  m_region.clear();
+  m_use_region = false;
+  m_region_changed = true;
+}
+
+/**
+ * @brief Output cells covered by both current snapshots, regardless of the
+ * region. Valid after process_data
+ * @return ordered, non-overlapping runs of output cells
+ */
+const MetBuild::InterpolationWeights::CellRanges &Meteorology::valid_ranges()
+    const {
+  return m_source_ranges;
+}
+
+const MetBuild::Grid *Meteorology::grid() const { return m_windGrid; }
+
+/**
+ * @brief Keys of the interpolation weights used so far, in the order they
+ * were first used. The weights of each key are in the file named by
+ * InterpolationCache::filename when the weight cache is enabled
+ */
+std::vector<std::string> Meteorology::weight_keys() const {
+  std::lock_guard<std::mutex> lock(m_weight_key_mutex);
+  return m_weight_keys;
+}
+
+MetBuild::GriddedDataTypes::TYPE Meteorology::type() const {
+  return m_type;
+}
+
+const std::vector<MetBuild::GriddedDataTypes::TYPE> &Meteorology::types()
+    const {
+  return m_types;
+}
+
+bool Meteorology::has_type(MetBuild::GriddedDataTypes::TYPE type) const {
+  return std::find(m_types.begin(), m_types.end(), type) != m_types.end();
+}
+
+/**
+ * @brief Enables interpolating each source snapshot onto the output grid
+ * once and blending the cached grids at each output time
+ *
+ * Snapshots are stored in single precision, so results may differ from the
+ * default mode in the last bits
+ *
+ * @param value true to enable the snapshot mode
+ */
+void Meteorology::set_snapshot_interpolation(bool value) {
+  m_snapshot_interpolation = value;
+}
+
+bool Meteorology::snapshot_interpolation() const {
+  return m_snapshot_interpolation;
+}
+
+/**
+ * @brief Selects how output points are weighted onto the source grid. Takes
+ * effect for weights generated after the call
+ * @param method interpolation method
+ * @param idw_radius largest distance from an output point to the source
+ * points weighted by inverse distance, in degrees
+ */
+void Meteorology::set_interpolation_method(
+    Meteorology::INTERPOLATION_METHOD method, double idw_radius) {
+  const bool weighted = method == TRIANGULAR_IDW || method == INVERSE_DISTANCE;
+  if (weighted && !(idw_radius > 0.0)) {
+    metbuild_throw_exception(
+        "The inverse distance search radius must be positive");
   }
+  m_interpolation_method = method;
+  m_idw_radius = idw_radius;
+}
 
-  std::tie(m_rate_scaling_1, m_rate_scaling_2) =
-      Meteorology::getScalingRates(m_variables[0]);
+Meteorology::INTERPOLATION_METHOD Meteorology::interpolation_method() const {
+  return m_interpolation_method;
+}
 
-  this->process_data();
+double Meteorology::idw_radius() const { return m_idw_radius; }
 
-  const auto r1 = m_gridded1->getVariable1d(m_variables[0]);
-  const auto r2 = m_gridded2->getVariable1d(m_variables[0]);
+/**
+ * @brief Token checked between the row bands of every interpolation and the
+ * rows located while building weights. A cancelled token makes the call in
+ * progress throw Cancelled, leaving the output buffers partially written
+ * @param token token, which must outlive its use by this object, or nullptr
+ */
+void Meteorology::set_cancel_token(const MetBuild::CancelToken *token) {
+  m_cancel = token;
+}
 
-  for (size_t i = 0; i < m_windGrid->ni(); ++i) {
-    for (size_t j = 0; j < m_windGrid->nj(); ++j) {
-      const auto interp_1 = m_interpolation_1->interpolation().get(i, j);
-      const auto interp_2 = m_interpolation_2->interpolation().get(i, j);
+/**
+ * @brief Runs f(begin, count) over the row bands of the output grid covering
+ * ranges, stopping between bands when the cancel token is set
+ * @param ranges ordered, non-overlapping runs of cells of the output grid
+ * @param f function run on the part of each run inside a band
+ */
+template <typename F>
+void Meteorology::for_each_band(const InterpolationWeights::CellRanges &ranges,
+                                F &&f) const {
+  ::for_each_band(ranges, m_windGrid->ni(), m_cancel, std::forward<F>(f));
+}
+
+/**
+ * @brief Interpolates a source snapshot onto the output grid
+ * @param data source data
+ * @param interpolation weights from the source onto the output grid
+ * @return interpolated grid
+ */
+std::unique_ptr<Meteorology::InterpolatedGrid>
+Meteorology::generate_interpolated_grid(
+    GriddedData *data, const InterpolationData *interpolation) const {
+  auto snapshot = std::make_unique<InterpolatedGrid>();
+  const Kernel::WeightView weights(interpolation->interpolation());
+  const auto ni = m_windGrid->ni();
+  const auto nj = m_windGrid->nj();
+
+  //...Every field shares the same weights, so all of them are gathered
+  // from a single pass over the stencils
+  std::vector<Kernel::SourceField> sources;
+  std::vector<MeteorologicalDataType> fills;
+
+  if (this->has_type(MetBuild::GriddedDataTypes::WIND_PRESSURE)) {
+    using M = MeteorologicalData<3, MeteorologicalDataType>;
+    const MeteorologicalDataType fill_uv =
+        m_useBackgroundFlag ? M::flag_value() : 0.0;
+    const MeteorologicalDataType fill_p =
+        m_useBackgroundFlag ? M::flag_value() : M::background_pressure();
+    const auto &u = data->variable1d(MetBuild::GriddedDataTypes::VAR_U10);
+    const auto &v = data->variable1d(MetBuild::GriddedDataTypes::VAR_V10);
+    const auto &p = data->variable1d(MetBuild::GriddedDataTypes::VAR_PRESSURE);
+    snapshot->wind.resize(ni, nj);
+    sources.push_back({u.data(), 1.0});
+    sources.push_back({v.data(), 1.0});
+    sources.push_back({p.data(), 1.0});
+    fills.insert(fills.end(), {fill_uv, fill_uv, fill_p});
+  }
+  const size_t n_wind = sources.size();
 
-      auto valid1 =
-          InterpolationWeight::valid(interp_1, Triangulation::invalid_point());
-      auto valid2 =
-          InterpolationWeight::valid(interp_2, Triangulation::invalid_point());
+  const MeteorologicalDataType fill =
+      m_useBackgroundFlag ? MeteorologicalData<1>::flag_value() : 0.0;
+  std::vector<MeteorologicalData<1, MeteorologicalDataType> *> scalars;
+  for (const auto &type : m_types) {
+    if (Meteorology::typeLengthMap(type) != 1) continue;
+    const auto &r = data->variable1d(generate_variable_list(type)[0]);
+    auto &scalar = snapshot->scalar[static_cast<int>(type)];
+    scalar.resize(ni, nj);
+    scalars.push_back(&scalar);
+    sources.push_back({r.data(), 1.0});
+    fills.push_back(fill);
+  }
 
-      if (!valid1 || !valid2) {
-        if (this->m_useBackgroundFlag) {
-          r.set(0, i, j, MeteorologicalData<1, float>::flag_value());
+  //...Rows are written independently, so bands of rows run in parallel.
+  // Output grids on the source nodes copy each row straight from the source
+  const auto &lattice = interpolation->lattice();
+  const size_t rows = std::max<size_t>(c_band_cells / ni, 1);
+  ThreadPool::global().parallel_for(
+      0, nj,
+      [&](const size_t j) {
+        CancelToken::check(m_cancel);
+        std::vector<MeteorologicalDataType *> out(sources.size());
+        for (size_t f = 0; f < n_wind; ++f) {
+          out[f] = snapshot->wind.row(f, j).data();
+        }
+        for (size_t f = 0; f < scalars.size(); ++f) {
+          out[n_wind + f] = scalars[f]->row(0, j).data();
+        }
+        if (lattice) {
+          Kernel::copy_strided(j * ni, ni, weights, lattice->source(j, 0),
+                               lattice->di, sources.data(), sources.size(),
+                               fills.data(), out.data());
         } else {
-          r.set(0, i, j, 0.0);
+          Kernel::interpolate_batch(j * ni, ni, weights, sources.data(),
+                                    sources.size(), fills.data(), out.data());
         }
-      } else {
-        const auto w1 = m_interpolation_1->interpolation().get(i, j).weight();
-        const auto i1 = m_interpolation_1->interpolation().get(i, j).index();
+      },
+      rows);
+  return snapshot;
+}
+
+/**
+ * @brief Key of the weights from a source onto the output grid
+ * @param data source data
+ */
+std::string Meteorology::weight_key(const GriddedData *data) const {
+  return InterpolationCache::key(data->fingerprint(), data->bounding_region(),
+                                 m_grid_fingerprint, data->convention(),
+                                 this->interpolation_settings());
+}
+
+/**
+ * @brief Generates the interpolation weights from a source onto the output
+ * grid, reusing weights held by another object or found in the on-disk cache
+ * @param data source data
+ * @param previous previously loaded snapshot whose weights are translated
+ * when the source grid moved by whole cells, may be null
+ * @return interpolation data
+ */
+std::shared_ptr<const InterpolationData>
+Meteorology::generate_interpolation_data(
+    const GriddedData *data, const Snapshot *previous) const {
+  const auto key = this->weight_key(data);
+  {
+    std::lock_guard<std::mutex> lock(m_weight_key_mutex);
+    if (std::find(m_weight_keys.begin(), m_weight_keys.end(), key) ==
+        m_weight_keys.end()) {
+      m_weight_keys.push_back(key);
+    }
+  }
+
+  //...Objects on the same grids, such as ensemble members, share one copy
+  bool built = false;
+  auto shared = InterpolationCache::shared(key, [&]() {
+    built = true;
+    //...An output grid on the source nodes takes the value of each node, so
+    // its weights are written directly rather than located or loaded
+    if (m_interpolation_method != INVERSE_DISTANCE) {
+      if (const auto lattice = InterpolationData::aligned(
+              data->longitude1d(), data->latitude1d(),
+              static_cast<size_t>(data->ni()), static_cast<size_t>(data->nj()),
+              *m_grid_positions, data->convention())) {
+        Instrumentation::count_event(Instrumentation::WEIGHT_ALIGNED);
+        return std::make_shared<InterpolationData>(
+            *lattice, *m_grid_positions, data->convention(),
+            m_windGrid->mask());
+      }
+    }
+    if (auto weights = InterpolationCache::load(key)) {
+      Instrumentation::count_event(Instrumentation::WEIGHT_LOADED);
+      return std::make_shared<InterpolationData>(std::move(*weights),
+                                                 data->convention());
+    }
+    Instrumentation::count_event(Instrumentation::WEIGHT_BUILT);
+    CancelToken::check(m_cancel);
+    const WeightFile::Identity identity{data->fingerprint(),
+                                        m_grid_fingerprint,
+                                        this->interpolation_settings()};
+    const auto triangulation = [&]() {
+      Instrumentation::ScopedTimer timer(Instrumentation::TRIANGULATE,
+                                         data->longitude1d().size());
+      if (m_interpolation_method == INVERSE_DISTANCE) {
+        return Triangulation::inverse_distance(
+            data->longitude1d(), data->latitude1d(), m_idw_radius);
+      }
+      auto t = Triangulation::useFastLocators()
+                   ? data->generate_triangulation(output_extent(
+                         *m_grid_positions, data->convention()))
+                   : Triangulation(data->longitude1d(), data->latitude1d(),
+                                   data->bounding_region());
+      if (m_interpolation_method == TRIANGULAR_IDW) {
+        return Triangulation::with_fallback(t, data->longitude1d(),
+                                            data->latitude1d(), m_idw_radius);
+      } else if (m_interpolation_method == NEAREST_NEIGHBOUR) {
+        return Triangulation::nearest(t);
+      }
+      return t;
+    }();
+
+    //...Moving nests keep their shape and step by whole cells, so the
+    // weights of the previous snapshot only need their indices shifted
+    //...Points filled by distance may be inside the mesh of the moved grid,
+    // so only purely triangular weights are translated
+    const auto translation = m_interpolation_method == TRIANGULAR &&
+                                     Triangulation::useFastLocators()
+                                 ? Meteorology::translation(data, previous)
+                                 : std::nullopt;
+    if (translation) {
+      auto interpolation = std::make_shared<InterpolationData>(
+          triangulation, *m_grid_positions, *translation, data->convention(),
+          false, m_windGrid->mask(), m_cancel);
+      InterpolationCache::store(key, interpolation->interpolation(),
+                                identity);
+      return interpolation;
+    }
+
+    //...Masked out cells are never located, so they have no weight and are
+    // skipped by the kernels along with the cells outside the source. Cells
+    // outside the box of the source cannot be weighted and are masked too
+    const auto mask = this->coverage_mask(*data);
+    auto interpolation = std::make_shared<InterpolationData>(
+        triangulation, *m_grid_positions, data->convention(), false,
+        mask.empty() ? m_windGrid->mask() : &mask, m_cancel);
+    InterpolationCache::store(key, interpolation->interpolation(),
+                                identity);
+    return interpolation;
+  });
+  if (!built) Instrumentation::count_event(Instrumentation::WEIGHT_SHARED);
+  return shared;
+}
 
-        const auto w2 = m_interpolation_2->interpolation().get(i, j).weight();
-        const auto i2 = m_interpolation_2->interpolation().get(i, j).index();
+/**
+ * @brief Detects a source grid which is a whole-cell translation of the grid
+ * of the previous snapshot
+ * @param data source the weights are generated for
+ * @param previous previously loaded snapshot, may be null
+ * @return previous weights and the offset, if the grid was translated
+ */
+std::optional<InterpolationData::Translation> Meteorology::translation(
+    const GriddedData *data, const Snapshot *previous) {
+  if (!previous || !previous->data || !previous->interpolation ||
+      previous->data->ni() != data->ni() ||
+      previous->data->nj() != data->nj() ||
+      previous->interpolation->convention() != data->convention()) {
+    return std::nullopt;
+  }
+  const auto ni = static_cast<size_t>(data->ni());
+  const auto nj = static_cast<size_t>(data->nj());
+  const auto offset = Triangulation::translation(
+      previous->data->longitude1d(), previous->data->latitude1d(),
+      data->longitude1d(), data->latitude1d(), ni, nj);
+  if (!offset) return std::nullopt;
 
-        const std::array<double, 3> v1 = {r1[i1[0]], r1[i1[1]], r1[i1[2]]};
-        const std::array<double, 3> v2 = {r2[i2[0]], r2[i2[1]], r2[i2[2]]};
+  const auto [xmin, xmax] = std::minmax_element(data->longitude1d().begin(),
+                                                data->longitude1d().end());
+  const auto [ymin, ymax] = std::minmax_element(data->latitude1d().begin(),
+                                                data->latitude1d().end());
+  return InterpolationData::Translation{previous->interpolation.get(),
+                                        *offset,
+                                        ni,
+                                        nj,
+                                        {*xmin, *ymin, *xmax, *ymax}};
+}
 
-        const auto r_star1 = InterpolationWeight::interpolate(w1, v1);
-        const auto r_star2 = InterpolationWeight::interpolate(w2, v2);
+/**
+ * @brief Returns the only snapshot contributing at a time weight, when the
+ * weight selects one of the two or both slots hold the same files, so the
+ * other is never gathered
+ * @param time_weight weight of the second snapshot
+ * @return snapshot, null when both snapshots are blended
+ */
+Meteorology::Snapshot *Meteorology::single_snapshot(
+    const double time_weight) const {
+  if (time_weight == 0.0 || m_snapshot_1 == m_snapshot_2) {
+    return m_snapshot_1.get();
+  } else if (time_weight == 1.0) {
+    return m_snapshot_2.get();
+  }
+  return nullptr;
+}
 
-        const auto r_value = (1.0 - time_weight) * r_star1 * m_rate_scaling_1 +
-                             time_weight * r_star2 * m_rate_scaling_2;
+/**
+ * @brief Whether a snapshot is used through its values interpolated onto the
+ * output grid rather than through its weights. Snapshots read from the
+ * snapshot cache carry no source data, and snapshots on an output grid on
+ * the source nodes are copied once and then only blended
+ * @param s snapshot
+ */
+bool Meteorology::pre_interpolated(const Snapshot &s) const {
+  return m_snapshot_interpolation || !s.data ||
+         (s.interpolation && s.interpolation->lattice());
+}
 
-        r.set(0, i, j, r_value);
+/**
+ * @brief Distance outside the source points over which the interpolation
+ * method still weights output points
+ */
+double Meteorology::coverage_pad() const {
+  return m_interpolation_method == TRIANGULAR_IDW ||
+                 m_interpolation_method == INVERSE_DISTANCE
+             ? m_idw_radius
+             : 0.0;
+}
+
+/**
+ * @brief Whether the box of a source overlaps the box of the output grid.
+ * Only the source coordinates are read
+ * @param data source
+ */
+bool Meteorology::covers(const GriddedData &data) const {
+  const auto s = source_extent(data, this->coverage_pad());
+  const auto g = output_extent(*m_grid_positions, data.convention());
+  return s.xmax >= g.xmin && s.xmin <= g.xmax && s.ymax >= g.ymin &&
+         s.ymin <= g.ymax;
+}
+
+/**
+ * @brief Output grid mask extended with the cells outside the box of a
+ * source, which no locator can weight
+ * @param data source
+ * @return mask indexed like Grid::mask, empty when every cell is inside
+ */
+std::vector<uint8_t> Meteorology::coverage_mask(const GriddedData &data) const {
+  const auto extent = source_extent(data, this->coverage_pad());
+  const auto *grid_mask = m_windGrid->mask();
+  const auto &grid = *m_grid_positions;
+  const size_t nj = grid[0].size();
+  std::vector<uint8_t> mask(grid.size() * nj, 1);
+  size_t outside = 0;
+  for (size_t i = 0; i < grid.size(); ++i) {
+    for (size_t j = 0; j < nj; ++j) {
+      const auto k = i * nj + j;
+      if (grid_mask && (*grid_mask)[k] == 0) {
+        mask[k] = 0;
+        continue;
+      }
+      const auto &p = grid[i][j];
+      const double x = data.convention() == CONVENTION_180
+                           ? std::fmod(p.x() + 180.0, 360.0) - 180.0
+                           : p.x();
+      if (!inside(extent, x, p.y())) {
+        mask[k] = 0;
+        outside++;
       }
     }
   }
+  if (outside == 0) return {};
+  return mask;
+}
 
-  return r;
+/**
+ * @brief Interpolated grid holding only fill values, for snapshots of
+ * sources which cover no output cell
+ */
+std::unique_ptr<Meteorology::InterpolatedGrid> Meteorology::filled_grid()
+    const {
+  auto grid = std::make_unique<InterpolatedGrid>();
+  const auto ni = m_windGrid->ni();
+  const auto nj = m_windGrid->nj();
+  for (const auto &type : m_types) {
+    if (type == MetBuild::GriddedDataTypes::WIND_PRESSURE) {
+      using M = MeteorologicalData<3, MeteorologicalDataType>;
+      grid->wind.resize(ni, nj);
+      const MeteorologicalDataType fill_uv =
+          m_useBackgroundFlag ? M::flag_value() : 0.0;
+      grid->wind.fill_parameter(0, fill_uv);
+      grid->wind.fill_parameter(1, fill_uv);
+      grid->wind.fill_parameter(
+          2, m_useBackgroundFlag ? M::flag_value() : M::background_pressure());
+    } else {
+      auto &scalar = grid->scalar[static_cast<int>(type)];
+      scalar.resize(ni, nj);
+      scalar.fill(m_useBackgroundFlag ? MeteorologicalData<1>::flag_value()
+                                      : 0.0);
+    }
+  }
+  return grid;
 }
 
-std::tuple<double, double> Meteorology::getScalingRates(
-    const GriddedDataTypes::VARIABLES &variable) const {
-  const auto scalarVariableName =
-      m_gridded1->variableNames().find_variable(m_variables[0]);
-  if (scalarVariableName == "apcp" || scalarVariableName == "tp") {
-    return {1.0 / static_cast<double>(
-                      Grib::getStepLength(m_file1[0], scalarVariableName)),
-            1.0 / static_cast<double>(
-                      Grib::getStepLength(m_file2[0], scalarVariableName))};
-  } else {
-    return {1.0, 1.0};
+void Meteorology::scalar_value_interpolation(
+    const MetBuild::GriddedDataTypes::TYPE type, const double time_weight,
+    MeteorologicalData<1> &r) {
+  if (r.ni() != m_windGrid->ni() || r.nj() != m_windGrid->nj()) {
+    r.resize(m_windGrid->ni(), m_windGrid->nj());
+  }
+
+  if (time_weight < 0.0) {
+    if (this->m_useBackgroundFlag) {
+      r.fill(MeteorologicalData<1>::flag_value());
+    } else {
+      r.fill(0.0);
+    }
+    return;
+  }
+
+  this->process_data();
+  auto &s1 = *m_snapshot_1;
+  auto &s2 = *m_snapshot_2;
+  Instrumentation::ScopedTimer timer(Instrumentation::INTERPOLATE,
+                                     r.ni() * r.nj());
+
+  const MeteorologicalDataType fill =
+      this->m_useBackgroundFlag ? MeteorologicalData<1>::flag_value() : 0.0;
+
+  //...A grid outside the source is filled in one call so that the writers
+  // see a constant field
+  if (m_valid_ranges.empty()) {
+    r.fill(fill);
+    return;
+  }
+
+  auto *out = r.parameter(0).data();
+  this->for_each_band(m_invalid_ranges, [&](size_t begin, size_t count) {
+    std::fill(out + begin, out + begin + count, fill);
+  });
+
+  if (auto *s = this->single_snapshot(time_weight)) {
+    if (this->pre_interpolated(*s)) {
+      if (!s->interpolated) {
+        s->interpolated = this->generate_interpolated_grid(
+            s->data.get(), s->interpolation.get());
+      }
+      const auto &scalar = s->interpolated->scalar.at(static_cast<int>(type));
+      const auto *a = scalar.parameter(0).data();
+      this->for_each_band(m_valid_ranges, [&](size_t begin, size_t count) {
+        std::copy(a + begin, a + begin + count, out + begin);
+      });
+    } else {
+      const Kernel::WeightView weights(s->interpolation->interpolation());
+      const Kernel::SourceField source{
+          s->data->variable1d(generate_variable_list(type)[0]).data(), 1.0};
+      this->for_each_band(m_valid_ranges, [&](size_t begin, size_t count) {
+        Kernel::interpolate(begin, count, weights, source, fill, out + begin);
+      });
+    }
+    return;
+  }
+
+  //...Snapshots read from the snapshot cache carry no source data
+  if (this->pre_interpolated(s1) || this->pre_interpolated(s2)) {
+    for (auto *s : {&s1, &s2}) {
+      if (!s->interpolated) {
+        s->interpolated = this->generate_interpolated_grid(
+            s->data.get(), s->interpolation.get());
+      }
+    }
+    const auto key = static_cast<int>(type);
+    const auto *a = s1.interpolated->scalar.at(key).parameter(0).data();
+    const auto *b = s2.interpolated->scalar.at(key).parameter(0).data();
+    this->for_each_band(m_valid_ranges, [&](size_t begin, size_t count) {
+      Kernel::blend_valid(count, a + begin, b + begin, time_weight,
+                          out + begin);
+    });
+    return;
   }
+
+  const Kernel::WeightView weights_1(s1.interpolation->interpolation());
+  const Kernel::WeightView weights_2(s2.interpolation->interpolation());
+  const auto variable = generate_variable_list(type)[0];
+  const auto &r1 = s1.data->variable1d(variable);
+  const auto &r2 = s2.data->variable1d(variable);
+
+  //...The rainfall rate is applied when the source is decoded, so every
+  //   scalar uses the unscaled kernel instantiation
+  const Kernel::ScalarFields fields{
+      {{{r1.data(), 1.0}}}, {{{r2.data(), 1.0}}}, {{out}}, {{fill}}};
+  this->for_each_band(m_valid_ranges, [&](size_t begin, size_t count) {
+    Kernel::interpolate_valid(begin, count, weights_1, weights_2, fields,
+                              time_weight);
+  });
 }
 
 MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
 Meteorology::to_grid(const double time_weight) {
-  if (Meteorology::typeLengthMap(this->m_type) == 1) {
-    return {this->scalar_value_interpolation(time_weight)};
-  } else {
+  MetBuild::MeteorologicalData<1, MeteorologicalDataType> r;
+  this->to_grid(r, time_weight);
+  return r;
+}
+
+/**
+ * @brief Interpolates the first scalar type requested into a caller owned
+ * buffer, which is only reallocated when its shape does not match the output
+ * grid
+ * @param r output buffer
+ * @param time_weight weight of the second snapshot
+ */
+void Meteorology::to_grid(
+    MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType> &r,
+    const double time_weight) {
+  for (const auto &type : m_types) {
+    if (Meteorology::typeLengthMap(type) == 1) {
+      this->scalar_value_interpolation(type, time_weight, r);
+      return;
+    }
+  }
+  metbuild_throw_exception("Invalid field type passed to scalar interpolation");
+}
+
+/**
+ * @brief Interpolates one of the requested scalar types into a caller owned
+ * buffer, which is only reallocated when its shape does not match the output
+ * grid
+ * @param type scalar data type, which must have been requested
+ * @param r output buffer
+ * @param time_weight weight of the second snapshot
+ */
+void Meteorology::to_grid(
+    MetBuild::GriddedDataTypes::TYPE type,
+    MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType> &r,
+    const double time_weight) {
+  if (Meteorology::typeLengthMap(type) != 1 || !this->has_type(type)) {
     metbuild_throw_exception(
         "Invalid field type passed to scalar interpolation");
-    return {MetBuild::MeteorologicalData<1, MeteorologicalDataType>()};
   }
+  this->scalar_value_interpolation(type, time_weight, r);
 }
 
 MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
 Meteorology::to_wind_grid(double time_weight) {
-  const auto pressure_scaling_1 =
-      MetBuild::Meteorology::getPressureScaling(m_gridded1.get());
-  const auto pressure_scaling_2 =
-      MetBuild::Meteorology::getPressureScaling(m_gridded2.get());
+  MetBuild::MeteorologicalData<3, MeteorologicalDataType> w;
+  this->to_wind_grid(w, time_weight);
+  return w;
+}
 
-  if (this->m_type != MetBuild::GriddedDataTypes::WIND_PRESSURE) {
+/**
+ * @brief Interpolates wind and pressure into a caller owned buffer, which is
+ * only reallocated when its shape does not match the output grid
+ * @param w output buffer
+ * @param time_weight weight of the second snapshot
+ */
+void Meteorology::to_wind_grid(
+    MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType> &w,
+    double time_weight) {
+  if (!this->has_type(MetBuild::GriddedDataTypes::WIND_PRESSURE)) {
     metbuild_throw_exception(
         "Data type must be wind and pressure to interpolate to a wind grid "
         "object");
   }
-  MeteorologicalData<3, MetBuild::MeteorologicalDataType> w(m_windGrid->ni(),
-                                                            m_windGrid->nj());
+  if (w.ni() != m_windGrid->ni() || w.nj() != m_windGrid->nj()) {
+    w.resize(m_windGrid->ni(), m_windGrid->nj());
+  }
 
   if (time_weight < 0.0) {
     if (this->m_useBackgroundFlag) {
@@ -265,92 +1412,289 @@ Meteorology::to_wind_grid(double time_weight) {
           2, MeteorologicalData<
                  3, MetBuild::MeteorologicalDataType>::background_pressure());
     }
-    return w;
+    return;
   }
 
   this->process_data();
+  auto &s1 = *m_snapshot_1;
+  auto &s2 = *m_snapshot_2;
+  Instrumentation::ScopedTimer timer(Instrumentation::INTERPOLATE,
+                                     3 * w.ni() * w.nj());
 
-  const auto u1 =
-      m_gridded1->getVariable1d(MetBuild::GriddedDataTypes::VAR_U10);
-  const auto v1 =
-      m_gridded1->getVariable1d(MetBuild::GriddedDataTypes::VAR_V10);
-  const auto p1 =
-      m_gridded1->getVariable1d(MetBuild::GriddedDataTypes::VAR_PRESSURE);
-
-  const auto u2 =
-      m_gridded2->getVariable1d(MetBuild::GriddedDataTypes::VAR_U10);
-  const auto v2 =
-      m_gridded2->getVariable1d(MetBuild::GriddedDataTypes::VAR_V10);
-  const auto p2 =
-      m_gridded2->getVariable1d(MetBuild::GriddedDataTypes::VAR_PRESSURE);
-
-  const auto lon = m_gridded1->longitude1d();
-  const auto lat = m_gridded1->latitude1d();
-
-  for (size_t i = 0; i < m_windGrid->ni(); ++i) {
-    for (size_t j = 0; j < m_windGrid->nj(); ++j) {
-      const auto interp_1 = m_interpolation_1->interpolation().get(i, j);
-      const auto interp_2 = m_interpolation_2->interpolation().get(i, j);
-
-      const auto valid1 =
-          InterpolationWeight::valid(interp_1, Triangulation::invalid_point());
-      const auto valid2 =
-          InterpolationWeight::valid(interp_2, Triangulation::invalid_point());
-
-      if (!valid1 || !valid2) {
-        if (this->m_useBackgroundFlag) {
-          w.set(0, i, j,
-                MeteorologicalData<3, MeteorologicalDataType>::flag_value());
-        } else {
-          w.set(0, i, j, 0.0);
-          w.set(1, i, j, 0.0);
-          w.set(2, i, j,
-                MeteorologicalData<
-                    3, MeteorologicalDataType>::background_pressure());
+  using M = MeteorologicalData<3, MeteorologicalDataType>;
+  const MeteorologicalDataType fill_uv =
+      m_useBackgroundFlag ? M::flag_value() : 0.0;
+  const std::array<MeteorologicalDataType, 3> fill = {
+      fill_uv, fill_uv,
+      m_useBackgroundFlag ? M::flag_value() : M::background_pressure()};
+
+  //...A grid outside the source is filled in one call per parameter so that
+  // the writers see constant fields
+  if (m_valid_ranges.empty()) {
+    for (size_t p = 0; p < 3; ++p) w.fill_parameter(p, fill[p]);
+    return;
+  }
+
+  const std::array<MeteorologicalDataType *, 3> out = {
+      w.parameter(0).data(), w.parameter(1).data(), w.parameter(2).data()};
+  this->for_each_band(m_invalid_ranges, [&](size_t begin, size_t count) {
+    for (size_t p = 0; p < 3; ++p) {
+      std::fill(out[p] + begin, out[p] + begin + count, fill[p]);
+    }
+  });
+
+  if (auto *s = this->single_snapshot(time_weight)) {
+    if (this->pre_interpolated(*s)) {
+      if (!s->interpolated) {
+        s->interpolated = this->generate_interpolated_grid(
+            s->data.get(), s->interpolation.get());
+      }
+      const auto &a = s->interpolated->wind;
+      this->for_each_band(m_valid_ranges, [&](size_t begin, size_t count) {
+        for (size_t p = 0; p < 3; ++p) {
+          const auto *v = a.parameter(p).data() + begin;
+          std::copy(v, v + count, out[p] + begin);
         }
-      } else {
-        const auto w1 = m_interpolation_1->interpolation().get(i, j).weight();
-        const auto w2 = m_interpolation_2->interpolation().get(i, j).weight();
-        const auto i1 = m_interpolation_1->interpolation().get(i, j).index();
-        const auto i2 = m_interpolation_2->interpolation().get(i, j).index();
-
-        const std::array<double, 3> uu1 = {u1[i1[0]], u1[i1[1]], u1[i1[2]]};
-        const std::array<double, 3> vv1 = {v1[i1[0]], v1[i1[1]], v1[i1[2]]};
-        const std::array<double, 3> pp1 = {p1[i1[0]], p1[i1[1]], p1[i1[2]]};
-
-        const std::array<double, 3> uu2 = {u2[i2[0]], u2[i2[1]], u2[i2[2]]};
-        const std::array<double, 3> vv2 = {v2[i2[0]], v2[i2[1]], v2[i2[2]]};
-        const std::array<double, 3> pp2 = {p2[i2[0]], p2[i2[1]], p2[i2[2]]};
-
-        const auto u_star1 = InterpolationWeight::interpolate(w1, uu1);
-        const auto u_star2 = InterpolationWeight::interpolate(w2, uu2);
-
-        const auto v_star1 = InterpolationWeight::interpolate(w1, vv1);
-        const auto v_star2 = InterpolationWeight::interpolate(w2, vv2);
-
-        const auto p_star1 =
-            InterpolationWeight::interpolate(w1, pp1) * pressure_scaling_1;
-        const auto p_star2 =
-            InterpolationWeight::interpolate(w2, pp2) * pressure_scaling_2;
-
-        const auto u_value =
-            (1.0 - time_weight) * u_star1 + time_weight * u_star2;
-        const auto v_value =
-            (1.0 - time_weight) * v_star1 + time_weight * v_star2;
-        const auto p_value =
-            (1.0 - time_weight) * p_star1 + time_weight * p_star2;
-
-        w.set(0, i, j, u_value);
-        w.set(1, i, j, v_value);
-        w.set(2, i, j, p_value);
+      });
+    } else {
+      const Kernel::WeightView weights(s->interpolation->interpolation());
+      const std::array<Kernel::SourceField, 3> sources = {
+          {{s->data->variable1d(GriddedDataTypes::VAR_U10).data(), 1.0},
+           {s->data->variable1d(GriddedDataTypes::VAR_V10).data(), 1.0},
+           {s->data->variable1d(GriddedDataTypes::VAR_PRESSURE).data(), 1.0}}};
+      this->for_each_band(m_valid_ranges, [&](size_t begin, size_t count) {
+        const std::array<MeteorologicalDataType *, 3> o = {
+            out[0] + begin, out[1] + begin, out[2] + begin};
+        Kernel::interpolate_batch(begin, count, weights, sources.data(),
+                                  sources.size(), fill.data(), o.data());
+      });
+    }
+    return;
+  }
+
+  //...Snapshots read from the snapshot cache carry no source data
+  if (this->pre_interpolated(s1) || this->pre_interpolated(s2)) {
+    for (auto *s : {&s1, &s2}) {
+      if (!s->interpolated) {
+        s->interpolated = this->generate_interpolated_grid(
+            s->data.get(), s->interpolation.get());
       }
     }
+    const auto &a = s1.interpolated->wind;
+    const auto &b = s2.interpolated->wind;
+    this->for_each_band(m_valid_ranges, [&](size_t begin, size_t count) {
+      for (size_t p = 0; p < 3; ++p) {
+        Kernel::blend_valid(count, a.parameter(p).data() + begin,
+                            b.parameter(p).data() + begin, time_weight,
+                            out[p] + begin);
+      }
+    });
+    return;
   }
-  return w;
+
+  const auto &u1 = s1.data->variable1d(MetBuild::GriddedDataTypes::VAR_U10);
+  const auto &v1 = s1.data->variable1d(MetBuild::GriddedDataTypes::VAR_V10);
+  const auto &p1 =
+      s1.data->variable1d(MetBuild::GriddedDataTypes::VAR_PRESSURE);
+
+  const auto &u2 = s2.data->variable1d(MetBuild::GriddedDataTypes::VAR_U10);
+  const auto &v2 = s2.data->variable1d(MetBuild::GriddedDataTypes::VAR_V10);
+  const auto &p2 =
+      s2.data->variable1d(MetBuild::GriddedDataTypes::VAR_PRESSURE);
+
+  const Kernel::WeightView weights_1(s1.interpolation->interpolation());
+  const Kernel::WeightView weights_2(s2.interpolation->interpolation());
+
+  const Kernel::WindFields fields{
+      {{{u1.data(), 1.0}, {v1.data(), 1.0}, {p1.data(), 1.0}}},
+      {{{u2.data(), 1.0}, {v2.data(), 1.0}, {p2.data(), 1.0}}},
+      out,
+      fill};
+  this->for_each_band(m_valid_ranges, [&](size_t begin, size_t count) {
+    Kernel::interpolate_valid(begin, count, weights_1, weights_2, fields,
+                              time_weight);
+  });
+}
+
+/**
+ * @brief Interpolates wind and pressure for several output times at once
+ *
+ * Steps blended from the same two snapshots share a single gather of the
+ * source stencils, so a batch of the output times between two source files
+ * costs little more than one of them. Other steps are interpolated one by
+ * one as to_wind_grid does. Results match to_wind_grid, up to the rounding
+ * of the gathered values to the output precision when the snapshots are
+ * not interpolated ahead of time
+ *
+ * @param time_weights weight of the second snapshot for each step
+ * @param w output buffers, one per step, reallocated when their shape does
+ * not match the output grid
+ */
+void Meteorology::to_wind_grids(
+    const std::vector<double> &time_weights,
+    const std::vector<
+        MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType> *>
+        &w) {
+  if (!this->has_type(MetBuild::GriddedDataTypes::WIND_PRESSURE)) {
+    metbuild_throw_exception(
+        "Data type must be wind and pressure to interpolate to a wind grid "
+        "object");
+  }
+  if (time_weights.size() != w.size()) {
+    metbuild_throw_exception("One output buffer is needed for each step");
+  }
+  std::vector<size_t> blended;
+  for (size_t k = 0; k < w.size(); ++k) {
+    if (time_weights[k] >= 0.0) this->process_data();
+    if (time_weights[k] < 0.0 || m_valid_ranges.empty() ||
+        this->single_snapshot(time_weights[k])) {
+      this->to_wind_grid(*w[k], time_weights[k]);
+    } else {
+      blended.push_back(k);
+    }
+  }
+  if (blended.empty()) return;
+
+  auto &s1 = *m_snapshot_1;
+  auto &s2 = *m_snapshot_2;
+  using M = MeteorologicalData<3, MeteorologicalDataType>;
+  Instrumentation::ScopedTimer timer(
+      Instrumentation::INTERPOLATE,
+      3 * m_windGrid->ni() * m_windGrid->nj() * blended.size());
+
+  const MeteorologicalDataType fill_uv =
+      m_useBackgroundFlag ? M::flag_value() : 0.0;
+  BlendBatch batch;
+  batch.fill = {
+      fill_uv, fill_uv,
+      m_useBackgroundFlag ? M::flag_value() : M::background_pressure()};
+  batch.out.resize(3);
+  std::vector<double> weights;
+  for (const auto k : blended) {
+    if (w[k]->ni() != m_windGrid->ni() || w[k]->nj() != m_windGrid->nj()) {
+      w[k]->resize(m_windGrid->ni(), m_windGrid->nj());
+    }
+    for (size_t p = 0; p < 3; ++p) {
+      batch.out[p].push_back(w[k]->parameter(p).data());
+    }
+    weights.push_back(time_weights[k]);
+  }
+
+  //...Snapshots read from the snapshot cache carry no source data
+  if (this->pre_interpolated(s1) || this->pre_interpolated(s2)) {
+    for (auto *s : {&s1, &s2}) {
+      if (!s->interpolated) {
+        s->interpolated = this->generate_interpolated_grid(
+            s->data.get(), s->interpolation.get());
+      }
+    }
+    for (size_t p = 0; p < 3; ++p) {
+      batch.interpolated_first.push_back(
+          s1.interpolated->wind.parameter(p).data());
+      batch.interpolated_second.push_back(
+          s2.interpolated->wind.parameter(p).data());
+    }
+    blend_steps(m_valid_ranges, m_invalid_ranges, m_windGrid->ni(), nullptr,
+                nullptr, batch, weights, m_cancel);
+    return;
+  }
+
+  for (const auto *s : {&s1, &s2}) {
+    auto &sources = s == &s1 ? batch.first : batch.second;
+    sources = {
+        {s->data->variable1d(GriddedDataTypes::VAR_U10).data(), 1.0},
+        {s->data->variable1d(GriddedDataTypes::VAR_V10).data(), 1.0},
+        {s->data->variable1d(GriddedDataTypes::VAR_PRESSURE).data(), 1.0}};
+  }
+  const Kernel::WeightView weights_1(s1.interpolation->interpolation());
+  const Kernel::WeightView weights_2(s2.interpolation->interpolation());
+  blend_steps(m_valid_ranges, m_invalid_ranges, m_windGrid->ni(), &weights_1,
+              &weights_2, batch, weights, m_cancel);
+}
+
+/**
+ * @brief Interpolates one of the requested scalar types for several output
+ * times at once, sharing the gather of the source stencils as
+ * to_wind_grids does
+ * @param type scalar data type, which must have been requested
+ * @param time_weights weight of the second snapshot for each step
+ * @param r output buffers, one per step, reallocated when their shape does
+ * not match the output grid
+ */
+void Meteorology::to_grids(
+    const MetBuild::GriddedDataTypes::TYPE type,
+    const std::vector<double> &time_weights,
+    const std::vector<
+        MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType> *>
+        &r) {
+  if (Meteorology::typeLengthMap(type) != 1 || !this->has_type(type)) {
+    metbuild_throw_exception(
+        "Invalid field type passed to scalar interpolation");
+  }
+  if (time_weights.size() != r.size()) {
+    metbuild_throw_exception("One output buffer is needed for each step");
+  }
+  std::vector<size_t> blended;
+  for (size_t k = 0; k < r.size(); ++k) {
+    if (time_weights[k] >= 0.0) this->process_data();
+    if (time_weights[k] < 0.0 || m_valid_ranges.empty() ||
+        this->single_snapshot(time_weights[k])) {
+      this->scalar_value_interpolation(type, time_weights[k], *r[k]);
+    } else {
+      blended.push_back(k);
+    }
+  }
+  if (blended.empty()) return;
+
+  auto &s1 = *m_snapshot_1;
+  auto &s2 = *m_snapshot_2;
+  Instrumentation::ScopedTimer timer(
+      Instrumentation::INTERPOLATE,
+      m_windGrid->ni() * m_windGrid->nj() * blended.size());
+
+  BlendBatch batch;
+  const MeteorologicalDataType fill =
+      m_useBackgroundFlag ? MeteorologicalData<1>::flag_value() : 0.0;
+  batch.fill = {fill};
+  batch.out.resize(1);
+  std::vector<double> weights;
+  for (const auto k : blended) {
+    if (r[k]->ni() != m_windGrid->ni() || r[k]->nj() != m_windGrid->nj()) {
+      r[k]->resize(m_windGrid->ni(), m_windGrid->nj());
+    }
+    batch.out[0].push_back(r[k]->parameter(0).data());
+    weights.push_back(time_weights[k]);
+  }
+
+  if (this->pre_interpolated(s1) || this->pre_interpolated(s2)) {
+    for (auto *s : {&s1, &s2}) {
+      if (!s->interpolated) {
+        s->interpolated = this->generate_interpolated_grid(
+            s->data.get(), s->interpolation.get());
+      }
+    }
+    const auto key = static_cast<int>(type);
+    batch.interpolated_first = {
+        s1.interpolated->scalar.at(key).parameter(0).data()};
+    batch.interpolated_second = {
+        s2.interpolated->scalar.at(key).parameter(0).data()};
+    blend_steps(m_valid_ranges, m_invalid_ranges, m_windGrid->ni(), nullptr,
+                nullptr, batch, weights, m_cancel);
+    return;
+  }
+
+  const auto variable = generate_variable_list(type)[0];
+  batch.first = {{s1.data->variable1d(variable).data(), 1.0}};
+  batch.second = {{s2.data->variable1d(variable).data(), 1.0}};
+  const Kernel::WeightView weights_1(s1.interpolation->interpolation());
+  const Kernel::WeightView weights_2(s2.interpolation->interpolation());
+  blend_steps(m_valid_ranges, m_invalid_ranges, m_windGrid->ni(), &weights_1,
+              &weights_2, batch, weights, m_cancel);
 }
 
 int Meteorology::write_debug_file(int index) const {
-  auto *ptr = index == 0 ? m_gridded1.get() : m_gridded2.get();
+  const auto &snapshot = index == 0 ? m_snapshot_1 : m_snapshot_2;
+  auto *ptr = snapshot ? snapshot->data.get() : nullptr;
 
   if (ptr == nullptr) {
     metbuild_throw_exception(
@@ -363,13 +1707,17 @@ int Meteorology::write_debug_file(int index) const {
   const auto u = ptr->getVariable1d(MetBuild::GriddedDataTypes::VAR_U10);
   const auto v = ptr->getVariable1d(MetBuild::GriddedDataTypes::VAR_V10);
   const auto p = ptr->getVariable1d(MetBuild::GriddedDataTypes::VAR_PRESSURE);
+  //...Pressure is written in the units of the source, undoing the field
+  // scaling applied when it was decoded
+  const double p_scale =
+      1.0 / ptr->fieldScaling(MetBuild::GriddedDataTypes::VAR_PRESSURE);
 
   std::ofstream file;
   file.open(ptr->filenames()[0] += ".out");
   for (size_t i = 0; i < lon.size(); ++i) {
     file << lon[i] << " " << lat[i] << " "
-         << std::sqrt(std::pow(u[i], 2.0) + std::pow(v[i], 2.0)) << " " << p[i]
-         << std::endl;
+         << std::sqrt(std::pow(u[i], 2.0) + std::pow(v[i], 2.0)) << " "
+         << p[i] * p_scale << std::endl;
   }
   file.close();
 
@@ -388,34 +1736,107 @@ double Meteorology::generate_time_weight(const MetBuild::Date &t1,
 std::unique_ptr<GriddedData> Meteorology::gridded_data_factory(
     const std::vector<std::string> &filenames,
     const Meteorology::SOURCE source) {
-  switch (source) {
-    case GFS:
-      return std::make_unique<MetBuild::GfsData>(filenames[0]);
-    case GEFS:
-      return std::make_unique<MetBuild::GefsData>(filenames[0]);
-    case NAM:
-      return std::make_unique<MetBuild::NamData>(filenames[0]);
-    case HWRF:
-      return std::make_unique<MetBuild::HwrfData>(filenames[0]);
-    case COAMPS:
-      return std::make_unique<MetBuild::CoampsData>(filenames);
-    case HRRR_CONUS:
-      return std::make_unique<MetBuild::HrrrConusData>(filenames[0]);
-    case HRRR_ALASKA:
-      return std::make_unique<MetBuild::HrrrAlaskaData>(filenames[0]);
-    case WPC:
-      return std::make_unique<MetBuild::WpcData>(filenames[0]);
-    default:
-      Logging::throwError(
-          "No valid source type defined. Cannot create object.");
-      return nullptr;
+  //...Arrays registered in memory stand in for a file of the same name,
+  // whatever the source type
+  if (ArrayData::contains(filenames[0])) {
+    return std::make_unique<MetBuild::ArrayData>(filenames[0]);
+  }
+  //...Grib files already converted to field files are read from those, in
+  // the place of the original grib file
+  if (source != COAMPS && FieldFile::isFieldFile(filenames[0])) {
+    return std::make_unique<MetBuild::FieldFile>(filenames[0]);
   }
+  if (source == COAMPS) {
+    return std::make_unique<MetBuild::CoampsData>(filenames);
+  }
+  return visit_grib_source(
+      source, "No valid source type defined. Cannot create object.",
+      [&](auto tag) -> std::unique_ptr<GriddedData> {
+        return std::make_unique<typename decltype(tag)::type>(filenames[0]);
+      });
 }
 
-double Meteorology::getPressureScaling(const GriddedData *g) {
-  if (g->sourceSubtype() == MetBuild::GriddedDataTypes::SOURCE_SUBTYPE::GRIB) {
-    return 1.0 / 100.0;
-  } else {
-    return 1.0;
+/**
+ * @brief Describes a source file from its metadata only, so a request can be
+ * checked without decoding the file
+ * @param filename source file, one domain for COAMPS
+ * @param source source type of the file
+ * @return description of the file
+ */
+SourceProbe Meteorology::probe(const std::string &filename,
+                               const Meteorology::SOURCE source) {
+  if (ArrayData::contains(filename)) return ArrayData::probe(filename);
+  if (source == COAMPS) return CoampsData::probe(filename);
+  return visit_grib_source(
+      source, "No valid source type defined. Cannot probe file.",
+      [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        return Grib::probe(filename, T::sourceVariables());
+      });
+}
+
+/**
+ * @brief Selectors of the grib messages decoded for a data type, so that a
+ * downloader can fetch those messages and nothing else. Variables the source
+ * does not provide are left out
+ * @param source grib source type
+ * @param type data type to be generated
+ * @return messages in the order their variables are read
+ */
+std::vector<GribMessage> Meteorology::grib_messages(
+    const Meteorology::SOURCE source, const GriddedDataTypes::TYPE type) {
+  const auto messages = visit_grib_source(
+      source, "Only grib sources have message selectors", [](auto tag) {
+        return decltype(tag)::type::sourceMessages();
+      });
+
+  std::vector<GribMessage> selected;
+  for (const auto &v : Meteorology::generate_variable_list(type)) {
+    for (const auto &m : messages) {
+      if (m.variable == v) selected.push_back(m);
+    }
+  }
+  return selected;
+}
+
+/**
+ * @brief Decodes a grib file into a field file, which later requests read
+ * without unpacking the grib file again
+ * @param filename grib file to convert
+ * @param source source type of the grib file
+ * @param output field file to write
+ * @param compress compress the stored arrays
+ * @param region xmin, ymin, xmax and ymax in degrees, -180 to 180, of the
+ * region served. When given only the part of the grid around it is stored
+ */
+void Meteorology::write_field_file(const std::string &filename,
+                                   Meteorology::SOURCE source,
+                                   const std::string &output, bool compress,
+                                   const std::vector<double> &region) {
+  if (source == COAMPS) {
+    metbuild_throw_exception("Only grib sources can be written to field files");
   }
+  std::optional<Triangulation::Extent> crop;
+  if (!region.empty()) {
+    if (region.size() != 4 || region[0] >= region[2] ||
+        region[1] >= region[3]) {
+      metbuild_throw_exception(
+          "The field file region must be xmin, ymin, xmax and ymax");
+    }
+    crop = Triangulation::Extent{region[0], region[1], region[2], region[3]};
+  }
+  auto data = Meteorology::gridded_data_factory({filename}, source);
+  FieldFile::write(*data, output, compress, crop);
+}
+
+/**
+ * @brief Writes the message index of a grib file, which later requests read
+ * in place of scanning the file when it is stored as
+ * GribIndex::indexFilename of the grib file
+ * @param filename grib file to index
+ * @param output index file to write
+ */
+void Meteorology::write_grib_index(const std::string &filename,
+                                   const std::string &output) {
+  GribIndex::get(filename)->write(output);
 }
@@ -29,16 +29,28 @@
 #ifndef METBUILD_METEOROLOGY_H
 #define METBUILD_METEOROLOGY_H
 
+#include <deque>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "CancelToken.h"
 #include "Date.h"
+#include "ExecutionPolicy.h"
 #include "Grid.h"
 #include "InterpolationData.h"
 #include "MetBuild_Global.h"
 #include "MeteorologicalData.h"
+#include "SnapshotCache.h"
 #include "data_sources/GriddedData.h"
+#include "data_sources/GribMessage.h"
 #include "data_sources/GriddedDataTypes.h"
+#include "data_sources/SourceProbe.h"
 
 namespace MetBuild {
 
@@ -46,15 +58,55 @@ class Meteorology {
  public:
   enum SOURCE { GFS, GEFS, NAM, HWRF, COAMPS, HRRR_CONUS, HRRR_ALASKA, WPC };
 
+  /**
+   * @brief How output points are weighted onto the source grid
+   *
+   * TRIANGULAR uses the source mesh only. TRIANGULAR_IDW also weights points
+   * just outside the mesh by inverse distance to the nearest source points.
+   * INVERSE_DISTANCE weights every point by distance, for scattered sources.
+   * NEAREST_NEIGHBOUR gives every point the value of the nearest corner of
+   * its source triangle, for quick previews
+   */
+  enum INTERPOLATION_METHOD {
+    TRIANGULAR,
+    TRIANGULAR_IDW,
+    INVERSE_DISTANCE,
+    NEAREST_NEIGHBOUR
+  };
+
   METBUILD_EXPORT explicit Meteorology(const MetBuild::Grid *grid,
                                        Meteorology::SOURCE source_type,
                                        MetBuild::GriddedDataTypes::TYPE type,
                                        bool backfill = false,
                                        int epsg_output = 4326);
 
+  METBUILD_EXPORT explicit Meteorology(
+      const MetBuild::Grid *grid, Meteorology::SOURCE source_type,
+      const std::vector<MetBuild::GriddedDataTypes::TYPE> &types,
+      bool backfill = false, int epsg_output = 4326);
+
+  METBUILD_EXPORT ~Meteorology();
+
+  Meteorology(const Meteorology &) = delete;
+  Meteorology &operator=(const Meteorology &) = delete;
+
   void set_next_file(const std::vector<std::string> &filenames);
   void set_next_file(const std::string &filename);
 
+  void METBUILD_EXPORT prefetch_file(const std::vector<std::string> &filenames);
+  void METBUILD_EXPORT prefetch_file(const std::string &filename);
+
+  std::string METBUILD_EXPORT
+  prepare_weights(const std::vector<std::string> &filenames);
+  std::string METBUILD_EXPORT prepare_weights(const std::string &filename);
+
+  void METBUILD_EXPORT set_ring_depth(size_t depth);
+
+  size_t METBUILD_EXPORT ring_depth() const;
+
+  void METBUILD_EXPORT
+  set_execution_policy(const MetBuild::ExecutionPolicy &policy);
+
   int METBUILD_EXPORT process_data();
 
   int METBUILD_EXPORT write_debug_file(int index) const;
@@ -65,11 +117,131 @@ class Meteorology {
   MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
       METBUILD_EXPORT to_grid(double time_weight = 1.0);
 
+  void METBUILD_EXPORT to_wind_grid(
+      MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType> &w,
+      double time_weight = 1.0);
+
+  void METBUILD_EXPORT
+  to_grid(MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType> &r,
+          double time_weight = 1.0);
+
+  void METBUILD_EXPORT
+  to_grid(MetBuild::GriddedDataTypes::TYPE type,
+          MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType> &r,
+          double time_weight = 1.0);
+
+  void METBUILD_EXPORT to_wind_grids(
+      const std::vector<double> &time_weights,
+      const std::vector<
+          MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType> *>
+          &w);
+
+  void METBUILD_EXPORT to_grids(
+      MetBuild::GriddedDataTypes::TYPE type,
+      const std::vector<double> &time_weights,
+      const std::vector<
+          MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType> *>
+          &r);
+
+  MetBuild::GriddedDataTypes::TYPE METBUILD_EXPORT type() const;
+
+  const std::vector<MetBuild::GriddedDataTypes::TYPE> METBUILD_EXPORT &types()
+      const;
+
+  bool METBUILD_EXPORT has_type(MetBuild::GriddedDataTypes::TYPE type) const;
+
+  void METBUILD_EXPORT set_snapshot_interpolation(bool value);
+
+  bool METBUILD_EXPORT snapshot_interpolation() const;
+
+  void METBUILD_EXPORT set_interpolation_method(
+      Meteorology::INTERPOLATION_METHOD method, double idw_radius = 0.5);
+
+  NODISCARD Meteorology::INTERPOLATION_METHOD METBUILD_EXPORT
+  interpolation_method() const;
+
+  NODISCARD double METBUILD_EXPORT idw_radius() const;
+
+  void METBUILD_EXPORT set_cancel_token(const MetBuild::CancelToken *token);
+
+  void METBUILD_EXPORT
+  set_region(const MetBuild::InterpolationWeights::CellRanges &region);
+
+  void METBUILD_EXPORT clear_region();
+
+  const MetBuild::InterpolationWeights::CellRanges METBUILD_EXPORT &
+  valid_ranges() const;
+
+  NODISCARD const MetBuild::Grid METBUILD_EXPORT *grid() const;
+
+  NODISCARD std::vector<std::string> METBUILD_EXPORT weight_keys() const;
+
   static double METBUILD_EXPORT
   generate_time_weight(const MetBuild::Date &t1, const MetBuild::Date &t2,
                        const MetBuild::Date &t_output);
 
+  static void METBUILD_EXPORT write_field_file(
+      const std::string &filename, Meteorology::SOURCE source,
+      const std::string &output, bool compress = false,
+      const std::vector<double> &region = std::vector<double>());
+
+  static void METBUILD_EXPORT write_grib_index(const std::string &filename,
+                                               const std::string &output);
+
+  static MetBuild::SourceProbe METBUILD_EXPORT
+  probe(const std::string &filename, Meteorology::SOURCE source);
+
+  static std::vector<MetBuild::GribMessage> METBUILD_EXPORT
+  grib_messages(Meteorology::SOURCE source,
+                MetBuild::GriddedDataTypes::TYPE type);
+
  private:
+  /**
+   * @brief A source snapshot interpolated onto the output grid, with the
+   * pressure or rate scaling already applied. Scalars are keyed by type
+   */
+  struct InterpolatedGrid {
+    MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType> wind;
+    std::unordered_map<
+        int, MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>>
+        scalar;
+  };
+
+  /**
+   * @brief A decoded source file with its weights onto the output grid
+   */
+  struct Snapshot {
+    std::vector<std::string> filenames;
+    std::shared_ptr<GriddedData> data;
+    std::shared_ptr<const InterpolationData> interpolation;
+    std::unique_ptr<InterpolatedGrid> interpolated;
+  };
+
+  using PendingSnapshot =
+      std::pair<std::vector<std::string>,
+                std::shared_future<std::shared_ptr<Snapshot>>>;
+
+  std::shared_ptr<Snapshot> load_snapshot(
+      const std::vector<std::string> &filenames,
+      std::shared_ptr<const Snapshot> previous, bool interpolate) const;
+
+  std::shared_ptr<Snapshot> acquire_snapshot(
+      const std::vector<std::string> &filenames,
+      const std::shared_ptr<const Snapshot> &previous);
+
+  NODISCARD uint64_t snapshot_settings() const;
+
+  NODISCARD uint64_t interpolation_settings() const;
+
+  std::shared_ptr<Snapshot> load_cached_snapshot(
+      const std::vector<std::string> &filenames, const std::string &key) const;
+
+  static std::vector<SnapshotCache::Field> snapshot_fields(
+      const InterpolatedGrid &grid);
+
+  std::unique_ptr<InterpolatedGrid> generate_interpolated_grid(
+      GriddedData *data, const InterpolationData *interpolation) const;
+
   constexpr static double epsilon_squared() {
     return std::numeric_limits<double>::epsilon() *
            std::numeric_limits<double>::epsilon();
@@ -79,22 +251,36 @@ class Meteorology {
       const std::vector<std::string> &filenames,
       Meteorology::SOURCE source);
 
-  MetBuild::Grid::grid reproject_grid(
-      MetBuild::Grid::grid g) const;
+  std::shared_ptr<GriddedData> load_source(
+      const std::vector<std::string> &filenames) const;
+
+  NODISCARD std::string weight_key(const GriddedData *data) const;
 
-  std::tuple<double, double> getScalingRates(
-      const GriddedDataTypes::VARIABLES &variable) const;
+  std::shared_ptr<const InterpolationData> generate_interpolation_data(
+      const GriddedData *data, const Snapshot *previous = nullptr) const;
 
-  constexpr static size_t c_idw_depth = 6;
+  static std::optional<InterpolationData::Translation> translation(
+      const GriddedData *data, const Snapshot *previous);
 
   static InterpolationWeights generate_interpolation_weight(
       const MetBuild::Triangulation *triangulation,
       const MetBuild::Grid::grid *grid);
 
-  MetBuild::MeteorologicalData<1> scalar_value_interpolation(
-      double time_weight);
+  void scalar_value_interpolation(MetBuild::GriddedDataTypes::TYPE type,
+                                  double time_weight,
+                                  MetBuild::MeteorologicalData<1> &r);
+
+  Snapshot *single_snapshot(double time_weight) const;
+
+  NODISCARD bool pre_interpolated(const Snapshot &s) const;
+
+  NODISCARD bool covers(const GriddedData &data) const;
 
-  static double getPressureScaling(const GriddedData *g);
+  NODISCARD std::vector<uint8_t> coverage_mask(const GriddedData &data) const;
+
+  NODISCARD double coverage_pad() const;
+
+  std::unique_ptr<InterpolatedGrid> filled_grid() const;
 
   static constexpr unsigned typeLengthMap(
       MetBuild::GriddedDataTypes::TYPE type) {
@@ -131,21 +317,47 @@ class Meteorology {
     }
   }
 
+  static std::vector<MetBuild::GriddedDataTypes::VARIABLES>
+  generate_variable_list(
+      const std::vector<MetBuild::GriddedDataTypes::TYPE> &types);
+
+  void update_ranges();
+
+  template <typename F>
+  void for_each_band(const InterpolationWeights::CellRanges &ranges,
+                     F &&f) const;
+
   MetBuild::GriddedDataTypes::TYPE m_type;
+  std::vector<MetBuild::GriddedDataTypes::TYPE> m_types;
   SOURCE m_source;
   const Grid *m_windGrid;
-  Grid::grid m_grid_positions;
-  std::unique_ptr<GriddedData> m_gridded1;
-  std::unique_ptr<GriddedData> m_gridded2;
-  double m_rate_scaling_1;
-  double m_rate_scaling_2;
-  std::shared_ptr<InterpolationData> m_interpolation_1;
-  std::shared_ptr<InterpolationData> m_interpolation_2;
+  const Grid::grid *m_grid_positions;
+  GridFingerprint m_grid_fingerprint;
+  double m_output_spacing;
+  std::shared_ptr<Snapshot> m_snapshot_1;
+  std::shared_ptr<Snapshot> m_snapshot_2;
+  std::deque<PendingSnapshot> m_prefetch;
+  InterpolationWeights::CellRanges m_source_ranges;
+  InterpolationWeights::CellRanges m_region;
+  InterpolationWeights::CellRanges m_valid_ranges;
+  InterpolationWeights::CellRanges m_invalid_ranges;
+  bool m_use_region;
+  bool m_region_changed;
+  size_t m_ring_depth;
+  bool m_snapshot_interpolation;
+  INTERPOLATION_METHOD m_interpolation_method;
+  double m_idw_radius;
+  const MetBuild::CancelToken *m_cancel;
   bool m_useBackgroundFlag;
   int m_epsg_output;
   std::vector<MetBuild::GriddedDataTypes::VARIABLES> m_variables;
+  std::shared_ptr<BufferPool> m_buffer_pool;
   std::vector<std::string> m_file1;
   std::vector<std::string> m_file2;
+  mutable std::mutex m_weight_key_mutex;
+  mutable std::vector<std::string> m_weight_keys;
+  mutable std::once_flag m_uncovered_once;
+  mutable std::shared_ptr<const InterpolationData> m_uncovered;
 };
 }  // namespace MetBuild
 #endif  // METBUILD_METEOROLOGY_H
@@ -0,0 +1,602 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "MeteorologyPipeline.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "InterpolationKernel.h"
+#include "Logging.h"
+#include "MovingGrid.h"
+#include "NestedDomain.h"
+#include "output/OutputFile.h"
+
+using namespace MetBuild;
+
+namespace {
+//...Output steps interpolated together from the same two source files
+constexpr size_t c_batch_steps = 4;
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param meteorology interpolation object driven by the pipeline. It must
+ * outlive the pipeline and must not be used elsewhere while it runs
+ * @param queue_depth number of interpolated steps held ahead of the consumer
+ */
+MeteorologyPipeline::MeteorologyPipeline(Meteorology *meteorology,
+                                         size_t queue_depth)
+    : m_meteorology(meteorology),
+      m_output(nullptr),
+      m_output_domain(0),
+      m_queue_depth(std::max<size_t>(queue_depth, 1)),
+      m_statistics_enabled(false),
+      m_progress(nullptr),
+      m_moving(nullptr),
+      m_nest_source(nullptr),
+      m_started(false),
+      m_finished(false),
+      m_stop(false) {
+  if (m_meteorology == nullptr) {
+    metbuild_throw_exception("A meteorology object must be provided");
+  }
+  for (const auto &type : m_meteorology->types()) {
+    if (type != MetBuild::GriddedDataTypes::WIND_PRESSURE) {
+      m_scalar_types.push_back(type);
+    }
+  }
+  m_meteorology->set_cancel_token(&m_cancel);
+}
+
+MeteorologyPipeline::~MeteorologyPipeline() {
+  this->cancel();
+  if (m_thread.joinable()) m_thread.join();
+  m_meteorology->set_cancel_token(nullptr);
+}
+
+/**
+ * @brief Registers the next source file. Files must be added in time order
+ * @param filenames files making up the snapshot
+ * @param time valid time of the snapshot
+ */
+void MeteorologyPipeline::add_file(const std::vector<std::string> &filenames,
+                                   const MetBuild::Date &time) {
+  if (m_started) {
+    metbuild_throw_exception("Files cannot be added once the pipeline starts");
+  }
+  if (!m_files.empty() && time < m_files.back().time) {
+    metbuild_throw_exception("Files must be added in time order");
+  }
+  m_files.push_back({filenames, time});
+}
+
+void MeteorologyPipeline::add_file(const std::string &filename,
+                                   const MetBuild::Date &time) {
+  this->add_file(std::vector<std::string>{filename}, time);
+}
+
+/**
+ * @brief Makes the pipeline write every step to a domain of an output file
+ * from its background thread instead of returning it through next
+ *
+ * Pipelines writing to different domains of the same file may run at the
+ * same time. The output file must outlive the pipeline
+ *
+ * @param output output file
+ * @param domain_index domain written by this pipeline
+ */
+void MeteorologyPipeline::set_output(MetBuild::OutputFile *output,
+                                     size_t domain_index) {
+  if (m_started) {
+    metbuild_throw_exception(
+        "The output cannot be changed once the pipeline starts");
+  }
+  m_output = output;
+  m_output_domain = domain_index;
+}
+
+/**
+ * @brief Starts interpolating the output times from start_date to end_date,
+ * inclusive, on a background thread
+ * @param start_date first output time
+ * @param end_date last output time
+ * @param time_step output time step in seconds
+ */
+void MeteorologyPipeline::start(const MetBuild::Date &start_date,
+                                const MetBuild::Date &end_date,
+                                int time_step) {
+  if (m_started) {
+    metbuild_throw_exception("The pipeline has already been started");
+  }
+  if (m_files.empty()) {
+    metbuild_throw_exception("No files have been added to the pipeline");
+  }
+  if (time_step <= 0) {
+    metbuild_throw_exception("The time step must be positive");
+  }
+  m_started = true;
+  m_meteorology->set_ring_depth(
+      std::max<size_t>(m_meteorology->ring_depth(), 3));
+  m_thread = std::thread(&MeteorologyPipeline::run, this, start_date,
+                         end_date, time_step);
+}
+
+/**
+ * @brief Waits for the next interpolated step
+ * @return false once every output time has been returned
+ */
+bool MeteorologyPipeline::next() {
+  if (!m_started) {
+    metbuild_throw_exception("The pipeline has not been started");
+  }
+  if (m_output != nullptr) {
+    metbuild_throw_exception(
+        "Steps are written to the output file, use wait instead of next");
+  }
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_condition.wait(lock, [this]() {
+    return !m_queue.empty() || m_finished || m_error;
+  });
+  if (m_queue.empty()) {
+    if (m_error) std::rethrow_exception(m_error);
+    return false;
+  }
+  //...The buffers of the step being replaced are recycled by the producer
+  m_free.push_back(std::move(m_current));
+  m_current = std::move(m_queue.front());
+  m_queue.pop_front();
+  lock.unlock();
+  m_condition.notify_all();
+  return true;
+}
+
+/**
+ * @brief Waits until every step has been written to the output file and
+ * rethrows any error raised while interpolating or writing
+ */
+void MeteorologyPipeline::wait() {
+  if (!m_started) {
+    metbuild_throw_exception("The pipeline has not been started");
+  }
+  if (m_output == nullptr) {
+    metbuild_throw_exception("No output file has been set for the pipeline");
+  }
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]() { return m_finished; });
+  }
+  if (m_thread.joinable()) m_thread.join();
+  if (m_error) std::rethrow_exception(m_error);
+}
+
+/**
+ * @brief Stops the background thread, interrupting the step it is
+ * interpolating or the weights it is building between two row bands. Steps
+ * already written or queued are kept
+ */
+void MeteorologyPipeline::cancel() {
+  m_cancel.cancel();
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_condition.notify_all();
+  this->close_nests();
+}
+
+/**
+ * @brief Counter incremented by the background thread for every step it
+ * writes or queues, so that a caller can follow a running pipeline
+ * @param steps counter, which must outlive the pipeline, or nullptr
+ */
+void MeteorologyPipeline::set_progress(std::atomic<size_t> *steps) {
+  if (m_started) {
+    metbuild_throw_exception(
+        "The progress counter cannot be changed once the pipeline starts");
+  }
+  m_progress = steps;
+}
+
+/**
+ * @brief Restricts each step to the cells of a storm-following grid at its
+ * time. The Meteorology object must be on the envelope of the grid
+ * @param grid moving grid, which must outlive the pipeline, or nullptr
+ */
+void MeteorologyPipeline::set_moving_grid(const MetBuild::MovingGrid *grid) {
+  if (m_started) {
+    metbuild_throw_exception(
+        "The moving grid cannot be changed once the pipeline starts");
+  }
+  if (grid != nullptr &&
+      grid->envelope().fingerprint() != m_meteorology->grid()->fingerprint()) {
+    metbuild_throw_exception(
+        "The meteorology must be on the envelope of the moving grid");
+  }
+  m_moving = grid;
+}
+
+/**
+ * @brief Publishes every step to a coarser domain aligned with this one
+ * @param nest exchange with the coarser domain, which must outlive the
+ * pipeline
+ */
+void MeteorologyPipeline::add_nest(MetBuild::NestedDomain *nest) {
+  if (m_started) {
+    metbuild_throw_exception(
+        "Nested domains cannot be added once the pipeline starts");
+  }
+  if (nest != nullptr) m_nests.push_back(nest);
+}
+
+/**
+ * @brief Takes the cells of each step over a finer aligned domain from the
+ * steps it publishes. The Meteorology object should be on a grid masked with
+ * NestedDomain::remainder_mask so that it only computes the other cells
+ * @param nest exchange with the finer domain, which must outlive the
+ * pipeline, or nullptr
+ */
+void MeteorologyPipeline::set_nest_source(MetBuild::NestedDomain *nest) {
+  if (m_started) {
+    metbuild_throw_exception(
+        "The nest source cannot be changed once the pipeline starts");
+  }
+  m_nest_source = nest;
+}
+
+MetBuild::Date MeteorologyPipeline::time() const { return m_current.time; }
+
+double MeteorologyPipeline::weight() const { return m_current.weight; }
+
+/**
+ * @brief Wind and pressure of the current step, valid until next is called
+ */
+const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+    &MeteorologyPipeline::wind_grid() const {
+  return m_current.wind;
+}
+
+/**
+ * @brief First scalar field of the current step, valid until next is called
+ */
+const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+    &MeteorologyPipeline::grid() const {
+  if (m_current.scalar.empty()) {
+    metbuild_throw_exception("No scalar data type is interpolated");
+  }
+  return m_current.scalar.front();
+}
+
+/**
+ * @brief Scalar field of a given type for the current step, valid until next
+ * is called
+ * @param type one of the scalar types requested from the meteorology object
+ */
+const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+    &MeteorologyPipeline::grid(MetBuild::GriddedDataTypes::TYPE type) const {
+  const auto it = std::find(m_scalar_types.begin(), m_scalar_types.end(), type);
+  if (it == m_scalar_types.end() || m_current.scalar.empty()) {
+    metbuild_throw_exception("The data type is not interpolated");
+  }
+  return m_current.scalar[std::distance(m_scalar_types.begin(), it)];
+}
+
+/**
+ * @brief Files that contributed to the steps interpolated so far
+ */
+std::vector<std::string> MeteorologyPipeline::files_used() const {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_files_used;
+}
+
+/**
+ * @brief Makes the pipeline reduce every interpolated step to the minimum,
+ * maximum, mean and fraction of invalid cells of each field
+ *
+ * The reduction runs on the background thread right after a step is
+ * interpolated, while its values are still in cache
+ *
+ * @param enabled true to collect the statistics
+ */
+void MeteorologyPipeline::set_statistics(bool enabled) {
+  if (m_started) {
+    metbuild_throw_exception(
+        "Statistics cannot be changed once the pipeline starts");
+  }
+  m_statistics_enabled = enabled;
+}
+
+/**
+ * @brief Statistics of the steps interpolated so far, in time order
+ */
+std::vector<MetBuild::StepStatistics> MeteorologyPipeline::statistics() const {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_statistics;
+}
+
+size_t MeteorologyPipeline::next_file_index(const MetBuild::Date &t) const {
+  for (size_t i = 0; i < m_files.size(); ++i) {
+    if (t <= m_files[i].time) return i;
+  }
+  return m_files.size() - 1;
+}
+
+void MeteorologyPipeline::use_file(size_t index) {
+  m_meteorology->set_next_file(m_files[index].filenames);
+  if (index + 1 < m_files.size()) {
+    m_meteorology->prefetch_file(m_files[index + 1].filenames);
+  }
+}
+
+MeteorologyPipeline::Step MeteorologyPipeline::take_free_step() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_free.empty()) return Step();
+  auto step = std::move(m_free.back());
+  m_free.pop_back();
+  return step;
+}
+
+bool MeteorologyPipeline::write(Step step) {
+  if (!step.scalar.empty() &&
+      !m_meteorology->has_type(MetBuild::GriddedDataTypes::WIND_PRESSURE)) {
+    m_output->write(step.time, m_output_domain, step.scalar.front());
+  } else {
+    m_output->write(step.time, m_output_domain, step.wind);
+  }
+  if (m_progress) ++(*m_progress);
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_free.push_back(std::move(step));
+  return !m_stop;
+}
+
+/**
+ * @brief Planes of a step, the wind and pressure first then the scalars in
+ * the order of m_scalar_types
+ */
+std::vector<MetBuild::MeteorologicalDataType *> MeteorologyPipeline::fields(
+    Step &step) const {
+  std::vector<MeteorologicalDataType *> out;
+  if (m_meteorology->has_type(MetBuild::GriddedDataTypes::WIND_PRESSURE)) {
+    for (size_t k = 0; k < 3; ++k) {
+      out.push_back(step.wind.parameter(k).data());
+    }
+  }
+  for (auto &s : step.scalar) out.push_back(s.parameter(0).data());
+  return out;
+}
+
+void MeteorologyPipeline::close_nests() {
+  for (auto *nest : m_nests) nest->close();
+  if (m_nest_source) m_nest_source->close();
+}
+
+void MeteorologyPipeline::reduce(
+    const Step &step, const InterpolationWeights::CellRanges &ranges) {
+  using M = MeteorologicalData<1, MeteorologicalDataType>;
+  constexpr auto flag = M::flag_value();
+
+  //...Cells outside the source coverage, or every cell of a step outside
+  // the source times, hold fill values and are counted as invalid
+  auto reduce_field = [&](size_t n, auto &&reduce_range) {
+    FieldStatistics stats;
+    if (step.weight < 0.0) {
+      stats.invalid = n;
+      return stats;
+    }
+    size_t covered = 0;
+    for (const auto &range : ranges) {
+      reduce_range(range.begin, range.end - range.begin, stats);
+      covered += range.end - range.begin;
+    }
+    stats.invalid += n - covered;
+    return stats;
+  };
+
+  StepStatistics result;
+  result.time = step.time;
+
+  if (m_meteorology->has_type(MetBuild::GriddedDataTypes::WIND_PRESSURE)) {
+    const auto &w = step.wind;
+    const size_t n = w.ni() * w.nj();
+    const auto *u = w.parameter(0).data();
+    const auto *v = w.parameter(1).data();
+    const auto *p = w.parameter(2).data();
+    const std::pair<const char *, const MeteorologicalDataType *> fields[] = {
+        {"wind_u", u}, {"wind_v", v}, {"mslp", p}};
+    for (const auto &field : fields) {
+      result.names.emplace_back(field.first);
+      result.fields.push_back(
+          reduce_field(n, [&](size_t begin, size_t count, auto &stats) {
+            Kernel::reduce(count, field.second + begin, flag, stats);
+          }));
+    }
+    result.names.emplace_back("wind_speed");
+    result.fields.push_back(
+        reduce_field(n, [&](size_t begin, size_t count, auto &stats) {
+          Kernel::reduce_speed(count, u + begin, v + begin, flag, stats);
+        }));
+  }
+
+  for (size_t k = 0; k < m_scalar_types.size(); ++k) {
+    const auto &g = step.scalar[k];
+    switch (m_scalar_types[k]) {
+      case MetBuild::GriddedDataTypes::TEMPERATURE:
+        result.names.emplace_back("temperature");
+        break;
+      case MetBuild::GriddedDataTypes::HUMIDITY:
+        result.names.emplace_back("humidity");
+        break;
+      case MetBuild::GriddedDataTypes::RAINFALL:
+        result.names.emplace_back("rain");
+        break;
+      case MetBuild::GriddedDataTypes::ICE:
+        result.names.emplace_back("ice");
+        break;
+      default:
+        result.names.emplace_back("unknown");
+        break;
+    }
+    const auto *values = g.parameter(0).data();
+    result.fields.push_back(reduce_field(
+        g.ni() * g.nj(), [&](size_t begin, size_t count, auto &stats) {
+          Kernel::reduce(count, values + begin, flag, stats);
+        }));
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_statistics.push_back(std::move(result));
+}
+
+bool MeteorologyPipeline::push(Step step) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_condition.wait(lock, [this]() {
+    return m_stop || m_queue.size() < m_queue_depth;
+  });
+  if (m_stop) return false;
+  m_queue.push_back(std::move(step));
+  if (m_progress) ++(*m_progress);
+  lock.unlock();
+  m_condition.notify_all();
+  return true;
+}
+
+void MeteorologyPipeline::run(MetBuild::Date start_date,
+                              MetBuild::Date end_date, int time_step) {
+  auto record = [this](size_t index) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_files_used.insert(m_files_used.end(), m_files[index].filenames.begin(),
+                        m_files[index].filenames.end());
+  };
+
+  try {
+    const bool wind =
+        m_meteorology->has_type(MetBuild::GriddedDataTypes::WIND_PRESSURE);
+
+    size_t index = this->next_file_index(start_date + time_step);
+    auto t0 = m_files[0].time;
+    auto t1 = m_files[index].time;
+
+    m_meteorology->set_next_file(m_files[0].filenames);
+    record(0);
+    this->use_file(index);
+    m_meteorology->process_data();
+    record(index);
+
+    auto weight = [&](const MetBuild::Date &t) {
+      if (t < t0 || t > t1) return -1.0;
+      if (t0 == t1) return 0.0;
+      return Meteorology::generate_time_weight(t0, t1, t);
+    };
+
+    //...Cells holding values, including those taken from a finer domain
+    auto valid = [this](const Step &step) {
+      if (!m_nest_source) return m_meteorology->valid_ranges();
+      return InterpolationWeights::unite(m_meteorology->valid_ranges(),
+                                         step.nested);
+    };
+
+    auto t = start_date;
+    while (t <= end_date) {
+      if (t > t1) {
+        index = this->next_file_index(t);
+        t0 = t1;
+        t1 = m_files[index].time;
+        this->use_file(index);
+        if (t0 != t1) record(index);
+        m_meteorology->process_data();
+      }
+
+      //...Steps between the same two files are interpolated together so
+      //   that the source stencils are gathered once for all of them
+      std::vector<Step> batch;
+      do {
+        auto step = this->take_free_step();
+        step.time = t;
+        step.weight = weight(t);
+        step.scalar.resize(m_scalar_types.size());
+        batch.push_back(std::move(step));
+        t += time_step;
+      } while (batch.size() < (m_moving ? 1 : c_batch_steps) &&
+               t <= end_date && t <= t1);
+
+      //...Cells outside the box are filled without being interpolated
+      if (m_moving) {
+        m_meteorology->set_region(m_moving->region(batch.front().time));
+      }
+
+      std::vector<double> weights;
+      for (const auto &step : batch) weights.push_back(step.weight);
+      if (wind) {
+        std::vector<MeteorologicalData<3, MeteorologicalDataType> *> w;
+        for (auto &step : batch) w.push_back(&step.wind);
+        m_meteorology->to_wind_grids(weights, w);
+      }
+      for (size_t k = 0; k < m_scalar_types.size(); ++k) {
+        std::vector<MeteorologicalData<1, MeteorologicalDataType> *> r;
+        for (auto &step : batch) r.push_back(&step.scalar[k]);
+        m_meteorology->to_grids(m_scalar_types[k], weights, r);
+      }
+
+      //...Cells over a finer domain come from its steps, which are passed on
+      // to the coarser domains once complete
+      for (auto &step : batch) {
+        auto planes = this->fields(step);
+        if (m_nest_source) {
+          m_nest_source->take(step.time, planes, step.nested);
+        }
+        if (m_nests.empty()) continue;
+        const auto ranges = valid(step);
+        const std::vector<const MeteorologicalDataType *> published(
+            planes.begin(), planes.end());
+        for (auto *nest : m_nests) nest->publish(step.time, published, ranges);
+      }
+
+      bool running = true;
+      for (auto &step : batch) {
+        if (m_statistics_enabled) this->reduce(step, valid(step));
+        running = m_output != nullptr ? this->write(std::move(step))
+                                      : this->push(std::move(step));
+        if (!running) break;
+      }
+      if (!running) break;
+    }
+  } catch (const MetBuild::Cancelled &) {
+    //...A cancelled step is dropped, like the steps after it
+  } catch (...) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_error = std::current_exception();
+  }
+  this->close_nests();
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished = true;
+  }
+  m_condition.notify_all();
+}
@@ -0,0 +1,200 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_METEOROLOGYPIPELINE_H_
+#define METBUILD_SRC_METEOROLOGYPIPELINE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CancelToken.h"
+#include "Date.h"
+#include "MetBuild_Global.h"
+#include "MeteorologicalData.h"
+#include "Meteorology.h"
+#include "StepStatistics.h"
+
+namespace MetBuild {
+
+class MovingGrid;
+class NestedDomain;
+class OutputFile;
+
+/**
+ * @brief Runs the interpolation for a full list of source files and output
+ * times on a background thread
+ *
+ * Files are registered in time order with add_file and the output times are
+ * given to start. From then on the pipeline owns the Meteorology object:
+ * files are decoded ahead of time through its prefetch ring and interpolated
+ * steps are handed back through a bounded queue by next
+ *
+ * Alternatively set_output makes the background thread write each step to a
+ * domain of an output file itself, so the pipelines of several domains run
+ * and write concurrently and the caller only waits for them to finish
+ *
+ * With set_moving_grid the Meteorology object is on the envelope of a
+ * storm-following grid and each step only computes the cells under the box
+ * at its time
+ *
+ * Nested domains on aligned grids share their common cells: a pipeline
+ * given add_nest publishes every step to the coarser domain, whose pipeline,
+ * given set_nest_source, only interpolates the cells outside the finer grid
+ * and takes the others from the published steps
+ *
+ * cancel stops the background thread within one row band of the step in
+ * progress, which is dropped, after which wait returns and next returns
+ * false once the queued steps are taken
+ */
+class MeteorologyPipeline {
+ public:
+  METBUILD_EXPORT explicit MeteorologyPipeline(Meteorology *meteorology,
+                                               size_t queue_depth = 2);
+
+  METBUILD_EXPORT ~MeteorologyPipeline();
+
+  MeteorologyPipeline(const MeteorologyPipeline &) = delete;
+  MeteorologyPipeline &operator=(const MeteorologyPipeline &) = delete;
+
+  void METBUILD_EXPORT add_file(const std::vector<std::string> &filenames,
+                                const MetBuild::Date &time);
+  void METBUILD_EXPORT add_file(const std::string &filename,
+                                const MetBuild::Date &time);
+
+  void METBUILD_EXPORT set_output(MetBuild::OutputFile *output,
+                                  size_t domain_index);
+
+  void METBUILD_EXPORT start(const MetBuild::Date &start_date,
+                             const MetBuild::Date &end_date, int time_step);
+
+  void METBUILD_EXPORT wait();
+
+  void METBUILD_EXPORT cancel();
+
+  void METBUILD_EXPORT set_progress(std::atomic<size_t> *steps);
+
+  void METBUILD_EXPORT set_moving_grid(const MetBuild::MovingGrid *grid);
+
+  void METBUILD_EXPORT add_nest(MetBuild::NestedDomain *nest);
+
+  void METBUILD_EXPORT set_nest_source(MetBuild::NestedDomain *nest);
+
+  bool METBUILD_EXPORT next();
+
+  MetBuild::Date METBUILD_EXPORT time() const;
+
+  double METBUILD_EXPORT weight() const;
+
+  const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+      METBUILD_EXPORT &wind_grid() const;
+
+  const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+      METBUILD_EXPORT &grid() const;
+
+  const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+      METBUILD_EXPORT &grid(MetBuild::GriddedDataTypes::TYPE type) const;
+
+  std::vector<std::string> METBUILD_EXPORT files_used() const;
+
+  void METBUILD_EXPORT set_statistics(bool enabled);
+
+  std::vector<MetBuild::StepStatistics> METBUILD_EXPORT statistics() const;
+
+ private:
+  struct SourceFile {
+    std::vector<std::string> filenames;
+    MetBuild::Date time;
+  };
+
+  struct Step {
+    MetBuild::Date time;
+    double weight = 0.0;
+    MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType> wind;
+    std::vector<
+        MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>>
+        scalar;
+    InterpolationWeights::CellRanges nested;
+  };
+
+  void run(MetBuild::Date start_date, MetBuild::Date end_date,
+           int time_step);
+
+  size_t next_file_index(const MetBuild::Date &t) const;
+
+  void use_file(size_t index);
+
+  Step take_free_step();
+
+  bool push(Step step);
+
+  bool write(Step step);
+
+  void reduce(const Step &step,
+              const InterpolationWeights::CellRanges &ranges);
+
+  std::vector<MetBuild::MeteorologicalDataType *> fields(Step &step) const;
+
+  void close_nests();
+
+  Meteorology *m_meteorology;
+  MetBuild::OutputFile *m_output;
+  size_t m_output_domain;
+  std::vector<MetBuild::GriddedDataTypes::TYPE> m_scalar_types;
+  size_t m_queue_depth;
+  std::vector<SourceFile> m_files;
+  std::vector<std::string> m_files_used;
+  bool m_statistics_enabled;
+  std::vector<MetBuild::StepStatistics> m_statistics;
+  std::atomic<size_t> *m_progress;
+  const MetBuild::MovingGrid *m_moving;
+  std::vector<MetBuild::NestedDomain *> m_nests;
+  MetBuild::NestedDomain *m_nest_source;
+
+  std::thread m_thread;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::deque<Step> m_queue;
+  std::vector<Step> m_free;
+  Step m_current;
+  std::exception_ptr m_error;
+  bool m_started;
+  bool m_finished;
+  bool m_stop;
+  MetBuild::CancelToken m_cancel;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_METEOROLOGYPIPELINE_H_
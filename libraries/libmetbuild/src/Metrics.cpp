@@ -0,0 +1,296 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "Metrics.h"
+
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+
+#define FMT_HEADER_ONLY
+
+#include "Logging.h"
+#include "MeteorologicalData.h"
+#include "ResourceLimits.h"
+#include "SnapshotStore.h"
+#include "ThreadPool.h"
+#include "WarmCache.h"
+#include "boost/filesystem.hpp"
+#include "fmt/core.h"
+
+using namespace MetBuild;
+
+namespace {
+struct Gauge {
+  std::string help;
+  double value;
+};
+
+struct Build {
+  size_t count = 0;
+  double seconds = 0.0;
+  double last_seconds = 0.0;
+  double interpolated_per_second = 0.0;
+  double decoded_per_second = 0.0;
+  double output_per_second = 0.0;
+};
+
+std::mutex s_mutex;
+std::map<std::string, Gauge> s_gauges;
+Build s_build;
+
+//...Values written to netCDF are counted in the output precision, which is
+// how the domains store them
+size_t decoded_bytes(const InstrumentationReport &r) {
+  return r.items(Instrumentation::DECODE) * sizeof(SourceDataType);
+}
+
+size_t output_bytes(const InstrumentationReport &r) {
+  return r.items(Instrumentation::FILE_WRITE) +
+         r.items(Instrumentation::NETCDF_WRITE) *
+             sizeof(MeteorologicalDataType);
+}
+
+class Writer {
+ public:
+  void header(const char *name, const char *help, const char *type) {
+    fmt::format_to(std::back_inserter(m_text), "# HELP {} {}\n# TYPE {} {}\n",
+                   name, help, name, type);
+  }
+
+  template <typename T>
+  void value(const char *name, const T value) {
+    fmt::format_to(std::back_inserter(m_text), "{} {}\n", name, value);
+  }
+
+  template <typename T>
+  void value(const char *name, const char *label, const std::string &key,
+             const T value) {
+    fmt::format_to(std::back_inserter(m_text), "{}{{{}=\"{}\"}} {}\n", name,
+                   label, key, value);
+  }
+
+  template <typename T>
+  void metric(const char *name, const char *help, const char *type,
+              const T value) {
+    this->header(name, help, type);
+    this->value(name, value);
+  }
+
+  NODISCARD const std::string &text() const { return m_text; }
+
+ private:
+  std::string m_text;
+};
+}  // namespace
+
+/**
+ * @brief Current metrics of the process in the Prometheus text format
+ */
+std::string Metrics::render() {
+  const auto r = Instrumentation::report();
+  const auto stages = Instrumentation::names();
+  const auto memory = Instrumentation::memory_names();
+  const auto events = Instrumentation::event_names();
+
+  Writer w;
+  w.header("metbuild_stage_calls_total", "Timed calls of each build stage",
+           "counter");
+  for (size_t i = 0; i < stages.size(); ++i) {
+    w.value("metbuild_stage_calls_total", "stage", stages[i],
+            r.calls(static_cast<int>(i)));
+  }
+  w.header("metbuild_stage_seconds_total",
+           "Time spent in each build stage, summed over threads", "counter");
+  for (size_t i = 0; i < stages.size(); ++i) {
+    w.value("metbuild_stage_seconds_total", "stage", stages[i],
+            r.seconds(static_cast<int>(i)));
+  }
+  w.header("metbuild_stage_items_total",
+           "Items processed by each build stage", "counter");
+  for (size_t i = 0; i < stages.size(); ++i) {
+    w.value("metbuild_stage_items_total", "stage", stages[i],
+            r.items(static_cast<int>(i)));
+  }
+
+  w.metric("metbuild_decoded_bytes_total", "Bytes of source values decoded",
+           "counter", decoded_bytes(r));
+  w.metric("metbuild_interpolated_values_total",
+           "Output values interpolated", "counter",
+           r.items(Instrumentation::INTERPOLATE));
+  w.metric("metbuild_output_bytes_total", "Bytes written to output files",
+           "counter", output_bytes(r));
+
+  w.header("metbuild_weight_cache_requests_total",
+           "Interpolation weights by where they were found", "counter");
+  const std::map<int, std::string> weights = {
+      {Instrumentation::WEIGHT_SHARED, "shared"},
+      {Instrumentation::WEIGHT_LOADED, "loaded"},
+      {Instrumentation::WEIGHT_BUILT, "built"},
+      {Instrumentation::WEIGHT_ALIGNED, "aligned"}};
+  for (const auto &e : weights) {
+    w.value("metbuild_weight_cache_requests_total", "result", e.second,
+            r.events(e.first));
+  }
+  w.header("metbuild_snapshot_cache_requests_total",
+           "Snapshot cache lookups by result", "counter");
+  w.value("metbuild_snapshot_cache_requests_total", "result", "hit",
+          r.events(Instrumentation::SNAPSHOT_HIT));
+  w.value("metbuild_snapshot_cache_requests_total", "result", "miss",
+          r.events(Instrumentation::SNAPSHOT_MISS));
+  w.metric("metbuild_snapshots_outside_total",
+           "Snapshots not reaching the output grid, filled without decoding",
+           "counter", r.events(Instrumentation::SNAPSHOT_OUTSIDE));
+  w.metric("metbuild_locators_loaded_total",
+           "Source triangulations read from the locator cache", "counter",
+           r.events(Instrumentation::LOCATOR_LOADED));
+  w.metric("metbuild_shared_fields_attached_total",
+           "Decoded source fields mapped from shared memory", "counter",
+           r.events(Instrumentation::SHARED_FIELD_ATTACHED));
+
+  w.header("metbuild_memory_bytes", "Bytes held in each memory category",
+           "gauge");
+  for (size_t i = 0; i < memory.size(); ++i) {
+    w.value("metbuild_memory_bytes", "category", memory[i],
+            r.bytes(static_cast<int>(i)));
+  }
+  w.header("metbuild_memory_peak_bytes",
+           "Largest number of bytes held at once in each memory category",
+           "gauge");
+  for (size_t i = 0; i < memory.size(); ++i) {
+    w.value("metbuild_memory_peak_bytes", "category", memory[i],
+            r.peak_bytes(static_cast<int>(i)));
+  }
+  w.metric("metbuild_resident_bytes", "Resident size of the process",
+           "gauge", Instrumentation::current_rss());
+  w.metric("metbuild_resident_peak_bytes",
+           "Peak resident size of the process", "gauge",
+           r.process_peak_rss());
+  w.metric("metbuild_warm_cache_bytes",
+           "Estimated bytes held by the warm cache", "gauge",
+           WarmCache::size());
+  w.metric("metbuild_warm_cache_objects", "Objects held by the warm cache",
+           "gauge", WarmCache::count());
+  w.metric("metbuild_snapshot_store_bytes",
+           "Bytes of snapshots held in memory by the snapshot store", "gauge",
+           SnapshotStore::size());
+  w.metric("metbuild_snapshot_store_snapshots",
+           "Snapshots held in memory by the snapshot store", "gauge",
+           SnapshotStore::count());
+  w.metric("metbuild_snapshot_store_compressed_snapshots",
+           "Snapshots held compressed by the snapshot store", "gauge",
+           SnapshotStore::compressedCount());
+
+  w.metric("metbuild_threads", "Threads of the global pool", "gauge",
+           ThreadPool::defaultThreadCount());
+  w.metric("metbuild_cpu_quota", "Processors allowed by the cgroup cpu quota",
+           "gauge", ResourceLimits::cpuQuota());
+  w.metric("metbuild_memory_limit_bytes", "Memory limit of the cgroup",
+           "gauge", ResourceLimits::memoryLimit());
+  w.metric("metbuild_default_memory_budget_bytes",
+           "Memory budget taken by requests too large for the memory limit",
+           "gauge", ResourceLimits::defaultMemoryBudget());
+
+  std::lock_guard<std::mutex> lock(s_mutex);
+  w.metric("metbuild_builds_total", "Build requests run to completion",
+           "counter", s_build.count);
+  w.metric("metbuild_build_seconds_total", "Wall time of completed builds",
+           "counter", s_build.seconds);
+  w.metric("metbuild_last_build_seconds", "Wall time of the last build",
+           "gauge", s_build.last_seconds);
+  w.metric("metbuild_last_build_interpolated_values_per_second",
+           "Output values interpolated per second by the last build", "gauge",
+           s_build.interpolated_per_second);
+  w.metric("metbuild_last_build_decoded_bytes_per_second",
+           "Source bytes decoded per second by the last build", "gauge",
+           s_build.decoded_per_second);
+  w.metric("metbuild_last_build_output_bytes_per_second",
+           "Output bytes written per second by the last build", "gauge",
+           s_build.output_per_second);
+  for (const auto &g : s_gauges) {
+    w.metric(g.first.c_str(), g.second.help.c_str(), "gauge", g.second.value);
+  }
+  return w.text();
+}
+
+/**
+ * @brief Writes the metrics for a textfile collector. The file is written
+ * under a temporary name and renamed so that the collector never reads a
+ * partial file
+ * @param filename file to write, normally ending in .prom
+ */
+void Metrics::write_textfile(const std::string &filename) {
+  const auto tmp = filename + "." + boost::filesystem::unique_path().string();
+  {
+    std::ofstream f(tmp);
+    if (!f.is_open()) {
+      Logging::warning("Could not write metrics file " + filename);
+      return;
+    }
+    f << Metrics::render();
+  }
+  boost::system::error_code ec;
+  boost::filesystem::rename(tmp, filename, ec);
+  if (ec) {
+    boost::filesystem::remove(tmp, ec);
+    Logging::warning("Could not write metrics file " + filename);
+  }
+}
+
+/**
+ * @brief Sets a gauge exported with the library metrics
+ * @param name metric name, which must be a valid Prometheus name
+ * @param help description of the metric
+ * @param value current value
+ */
+void Metrics::set_gauge(const std::string &name, const std::string &help,
+                        const double value) {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  s_gauges[name] = {help, value};
+}
+
+/**
+ * @brief Records a completed build for the build totals and the throughput
+ * of the last build
+ * @param report stage totals of the build
+ * @param seconds wall time of the build
+ */
+void Metrics::record_build(const InstrumentationReport &report,
+                           const double seconds) {
+  const double scale = seconds > 0.0 ? 1.0 / seconds : 0.0;
+  std::lock_guard<std::mutex> lock(s_mutex);
+  s_build.count++;
+  s_build.seconds += seconds;
+  s_build.last_seconds = seconds;
+  s_build.interpolated_per_second =
+      static_cast<double>(report.items(Instrumentation::INTERPOLATE)) * scale;
+  s_build.decoded_per_second =
+      static_cast<double>(decoded_bytes(report)) * scale;
+  s_build.output_per_second = static_cast<double>(output_bytes(report)) * scale;
+}
@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_METRICS_H_
+#define METBUILD_SRC_METRICS_H_
+
+#include <string>
+
+#include "CppAttributes.h"
+#include "Instrumentation.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Renders the process wide instrumentation in the Prometheus text
+ * exposition format, for a resident build worker to serve or to leave for
+ * a textfile collector
+ *
+ * The stage, event and memory counters of Instrumentation are exported as
+ * they stand, along with the decoded and output bytes derived from them and
+ * the throughput of the last build run by a BuildRequest. A worker adds its
+ * own values, such as the depth of the queue it consumes, with set_gauge.
+ * Rates are meant to be taken by the monitoring from the counters
+ */
+class Metrics {
+ public:
+  NODISCARD static std::string render();
+
+  static void write_textfile(const std::string &filename);
+
+  static void set_gauge(const std::string &name, const std::string &help,
+                        double value);
+
+  static void record_build(const MetBuild::InstrumentationReport &report,
+                           double seconds);
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_METRICS_H_
@@ -0,0 +1,152 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "MovingGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "Logging.h"
+
+using namespace MetBuild;
+
+namespace {
+/**
+ * @brief Lattice index of the first cell of a box centered on a position
+ */
+long first_cell(const double center, const double size, const double step) {
+  return std::lround((center - size / 2.0) / step);
+}
+
+size_t cells(const double size, const double step) {
+  return static_cast<size_t>(std::lround(size / step)) + 1;
+}
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param track storm track the box follows. Before and after the track the
+ * box stays at its first and last position
+ * @param width width of the box, in degrees
+ * @param height height of the box, in degrees
+ * @param dx cell size in x, in degrees
+ * @param dy cell size in y, in degrees
+ */
+MovingGrid::MovingGrid(MetBuild::AtcfTrack track, const double width,
+                       const double height, const double dx, const double dy)
+    : m_track(std::move(track)),
+      m_width(width),
+      m_height(height),
+      m_envelope(generate_envelope(m_track, width, height, dx, dy)),
+      m_box(m_envelope.bottom_left().x(), m_envelope.bottom_left().y(),
+            cells(width, dx), cells(height, dy), dx, dy, 0.0) {}
+
+Grid MovingGrid::generate_envelope(const MetBuild::AtcfTrack &track,
+                                   const double width, const double height,
+                                   const double dx, const double dy) {
+  if (width <= 0.0 || height <= 0.0 || dx <= 0.0 || dy <= 0.0) {
+    metbuild_throw_exception("The moving grid size and spacing must be "
+                             "positive");
+  }
+
+  //...Centers between track times are interpolated linearly, so the box
+  // never goes past its positions at the track times
+  long i0 = std::numeric_limits<long>::max();
+  long j0 = std::numeric_limits<long>::max();
+  long i1 = std::numeric_limits<long>::lowest();
+  long j1 = std::numeric_limits<long>::lowest();
+  for (const auto &r : track.records()) {
+    const auto i = first_cell(r.longitude, width, dx);
+    const auto j = first_cell(r.latitude, height, dy);
+    i0 = std::min(i0, i);
+    j0 = std::min(j0, j);
+    i1 = std::max(i1, i);
+    j1 = std::max(j1, j);
+  }
+  return {static_cast<double>(i0) * dx,
+          static_cast<double>(j0) * dy,
+          static_cast<size_t>(i1 - i0) + cells(width, dx),
+          static_cast<size_t>(j1 - j0) + cells(height, dy),
+          dx,
+          dy,
+          0.0};
+}
+
+/**
+ * @brief Static grid covering every position of the box, which sources are
+ * interpolated onto
+ */
+const Grid &MovingGrid::envelope() const { return m_envelope; }
+
+/**
+ * @brief Grid of the shape of the box, at the first cell of the envelope
+ */
+const Grid &MovingGrid::box() const { return m_box; }
+
+size_t MovingGrid::ni() const { return m_box.ni(); }
+
+size_t MovingGrid::nj() const { return m_box.nj(); }
+
+/**
+ * @brief Position of the box in the envelope at a time
+ * @param date time
+ * @return column and row of the envelope cell at the first cell of the box
+ */
+std::array<size_t, 2> MovingGrid::origin(const MetBuild::Date &date) const {
+  const auto center = m_track.at(date);
+  const auto base = m_envelope.bottom_left();
+  const auto i = first_cell(center.longitude, m_width, m_envelope.di()) -
+                 std::lround(base.x() / m_envelope.di());
+  const auto j = first_cell(center.latitude, m_height, m_envelope.dj()) -
+                 std::lround(base.y() / m_envelope.dj());
+  const auto clamp = [](long v, size_t limit) {
+    return static_cast<size_t>(
+        std::min<long>(std::max<long>(v, 0), static_cast<long>(limit)));
+  };
+  return {clamp(i, m_envelope.ni() - this->ni()),
+          clamp(j, m_envelope.nj() - this->nj())};
+}
+
+/**
+ * @brief Cells of the envelope under the box at a time
+ * @param date time
+ * @return one run of cells per row of the box
+ */
+InterpolationWeights::CellRanges MovingGrid::region(
+    const MetBuild::Date &date) const {
+  const auto o = this->origin(date);
+  InterpolationWeights::CellRanges ranges;
+  ranges.reserve(this->nj());
+  for (size_t j = 0; j < this->nj(); ++j) {
+    const size_t begin = (o[1] + j) * m_envelope.ni() + o[0];
+    ranges.push_back({begin, begin + this->ni()});
+  }
+  return ranges;
+}
@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_MOVINGGRID_H_
+#define METBUILD_SRC_MOVINGGRID_H_
+
+#include <array>
+#include <cstddef>
+
+#include "CppAttributes.h"
+#include "Date.h"
+#include "Grid.h"
+#include "InterpolationWeights.h"
+#include "MetBuild_Global.h"
+#include "MeteorologicalData.h"
+#include "vortex/AtcfTrack.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Output grid of fixed shape centered on a storm track
+ *
+ * The box steps by whole cells on a lattice of the grid spacing, so every
+ * position of the box is a window of a single static envelope grid covering
+ * the whole track. Sources are interpolated onto the envelope with one set
+ * of weights and only the cells under the box are computed at each time,
+ * after which the box is cut out of the envelope and written with its own
+ * coordinates
+ */
+class MovingGrid {
+ public:
+  METBUILD_EXPORT MovingGrid(MetBuild::AtcfTrack track, double width,
+                             double height, double dx, double dy);
+
+  NODISCARD const MetBuild::Grid METBUILD_EXPORT &envelope() const;
+
+  NODISCARD const MetBuild::Grid METBUILD_EXPORT &box() const;
+
+  NODISCARD size_t METBUILD_EXPORT ni() const;
+
+  NODISCARD size_t METBUILD_EXPORT nj() const;
+
+  NODISCARD std::array<size_t, 2> METBUILD_EXPORT
+  origin(const MetBuild::Date &date) const;
+
+  NODISCARD MetBuild::InterpolationWeights::CellRanges METBUILD_EXPORT
+  region(const MetBuild::Date &date) const;
+
+  template <unsigned N, typename T>
+  void window(
+      const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<N, MetBuild::MeteorologicalDataType>
+          &field,
+      MetBuild::MeteorologicalData<N, T> &out) const;
+
+  template <typename T>
+  void positions(const MetBuild::Date &date, T *x, T *y) const;
+
+ private:
+  static MetBuild::Grid generate_envelope(const MetBuild::AtcfTrack &track,
+                                          double width, double height,
+                                          double dx, double dy);
+
+  MetBuild::AtcfTrack m_track;
+  double m_width;
+  double m_height;
+  MetBuild::Grid m_envelope;
+  MetBuild::Grid m_box;
+};
+
+/**
+ * @brief Cuts the box at a time out of a field on the envelope
+ * @param date time of the box
+ * @param field field on the envelope grid
+ * @param out box sized field, resized if needed
+ */
+template <unsigned N, typename T>
+void MovingGrid::window(
+    const MetBuild::Date &date,
+    const MetBuild::MeteorologicalData<N, MetBuild::MeteorologicalDataType>
+        &field,
+    MetBuild::MeteorologicalData<N, T> &out) const {
+  if (out.ni() != this->ni() || out.nj() != this->nj()) {
+    out.resize(this->ni(), this->nj());
+  }
+  const auto o = this->origin(date);
+  const size_t ni = m_envelope.ni();
+  for (size_t k = 0; k < N; ++k) {
+    const auto *in = field.parameter(k).data();
+    auto *o_k = out.parameter(k).data();
+    for (size_t j = 0; j < this->nj(); ++j) {
+      const auto *row = in + (o[1] + j) * ni + o[0];
+      std::copy(row, row + this->ni(), o_k + j * this->ni());
+    }
+  }
+}
+
+/**
+ * @brief Coordinates of the cells of the box at a time, row by row
+ * @param date time of the box
+ * @param x longitudes, ni() * nj() of them
+ * @param y latitudes, ni() * nj() of them
+ */
+template <typename T>
+void MovingGrid::positions(const MetBuild::Date &date, T *x, T *y) const {
+  const auto o = this->origin(date);
+  for (size_t j = 0; j < this->nj(); ++j) {
+    for (size_t i = 0; i < this->ni(); ++i) {
+      const auto p = m_envelope.position(o[0] + i, o[1] + j);
+      x[j * this->ni() + i] = static_cast<T>(p.x());
+      y[j * this->ni() + i] = static_cast<T>(p.y());
+    }
+  }
+}
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_MOVINGGRID_H_
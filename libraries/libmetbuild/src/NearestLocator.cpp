@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "NearestLocator.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "Triangulation.h"
+
+using namespace MetBuild::Private;
+
+/**
+ * @brief Constructor
+ * @param locator locator finding the triangle around each point
+ */
+NearestLocator::NearestLocator(std::unique_ptr<PointLocator> locator)
+    : m_locator(std::move(locator)) {}
+
+NearestLocator::NearestLocator(const NearestLocator &other)
+    : PointLocator(other), m_locator(other.m_locator->clone()) {}
+
+std::unique_ptr<PointLocator> NearestLocator::clone() const {
+  return std::make_unique<NearestLocator>(*this);
+}
+
+MetBuild::InterpolationWeight NearestLocator::getInterpolationFactors(
+    double x, double y) const {
+  return NearestLocator::nearest(m_locator->getInterpolationFactors(x, y));
+}
+
+void NearestLocator::getInterpolationFactors(
+    const std::vector<MetBuild::Point> &points,
+    std::vector<MetBuild::InterpolationWeight> &weights) const {
+  m_locator->getInterpolationFactors(points, weights);
+  for (auto &w : weights) {
+    w = NearestLocator::nearest(w);
+  }
+}
+
+/**
+ * @brief Puts the whole weight on the corner with the largest barycentric
+ * weight, which is the corner nearest to the point in the triangle
+ */
+MetBuild::InterpolationWeight NearestLocator::nearest(
+    const MetBuild::InterpolationWeight &w) {
+  if (!MetBuild::InterpolationWeight::valid(
+          w, MetBuild::Triangulation::invalid_point())) {
+    return w;
+  }
+  const auto &weight = w.weight();
+  const auto k = static_cast<size_t>(
+      std::max_element(weight.begin(), weight.end()) - weight.begin());
+  const auto index = w.index()[k];
+  return {{index, index, index}, {1.0, 0.0, 0.0}};
+}
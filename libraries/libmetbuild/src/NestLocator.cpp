@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "NestLocator.h"
+
+#include <utility>
+
+#include "Triangulation.h"
+
+using namespace MetBuild::Private;
+
+/**
+ * @brief Constructor
+ * @param nests locators of the nests, finest first
+ * @param seam locator of the points between nests, reporting source
+ * indices, or nullptr when no point was dropped
+ */
+NestLocator::NestLocator(std::vector<Nest> nests,
+                         std::unique_ptr<PointLocator> seam)
+    : m_nests(std::move(nests)), m_seam(std::move(seam)) {
+  size_t bytes = 0;
+  for (const auto &n : m_nests) bytes += n.index.size() * sizeof(size_t);
+  this->track_memory(bytes);
+}
+
+NestLocator::NestLocator(const NestLocator &other)
+    : PointLocator(other),
+      m_seam(other.m_seam ? other.m_seam->clone() : nullptr) {
+  m_nests.reserve(other.m_nests.size());
+  for (const auto &n : other.m_nests) {
+    m_nests.push_back({n.locator->clone(), n.index});
+  }
+}
+
+std::unique_ptr<PointLocator> NestLocator::clone() const {
+  return std::make_unique<NestLocator>(*this);
+}
+
+MetBuild::InterpolationWeight NestLocator::getInterpolationFactors(
+    double x, double y) const {
+  constexpr auto invalid = MetBuild::Triangulation::invalid_point();
+  for (const auto &n : m_nests) {
+    const auto w = n.locator->getInterpolationFactors(x, y);
+    if (!MetBuild::InterpolationWeight::valid(w, invalid)) continue;
+    const MetBuild::InterpolationWeight remapped(
+        {n.index[w.index()[0]], n.index[w.index()[1]], n.index[w.index()[2]]},
+        w.weight());
+    if (MetBuild::InterpolationWeight::valid(remapped, invalid)) {
+      return remapped;
+    }
+    //...The cell reaches into a finer nest without the point being inside it
+    break;
+  }
+  if (m_seam) return m_seam->getInterpolationFactors(x, y);
+  return {{invalid, invalid, invalid}, {0.0, 0.0, 0.0}};
+}
@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_NESTLOCATOR_H_
+#define METBUILD_SRC_NESTLOCATOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "PointLocator.h"
+
+namespace MetBuild::Private {
+
+/**
+ * @brief Locator for a source made of nested regular grids, such as the
+ * domains of COAMPS-TC, whose points covered by an inner nest are dropped
+ *
+ * Each nest keeps its own locator in its index space. A point is taken from
+ * the finest nest covering it with a triangle of source points, falling back
+ * to the coarser ones. A point in a nest whose triangle uses dropped points
+ * lies between two nests and is located in a small triangulation of the
+ * points along the seams
+ */
+class NestLocator : public PointLocator {
+ public:
+  /**
+   * @brief Locator of one nest and the source index of each of its points,
+   * Triangulation::invalid_point() for the points dropped
+   */
+  struct Nest {
+    std::unique_ptr<PointLocator> locator;
+    std::vector<size_t> index;
+  };
+
+  NestLocator(std::vector<Nest> nests, std::unique_ptr<PointLocator> seam);
+
+  NestLocator(const NestLocator &other);
+
+  using PointLocator::getInterpolationFactors;
+
+  [[nodiscard]] std::unique_ptr<PointLocator> clone() const override;
+
+  [[nodiscard]] MetBuild::InterpolationWeight getInterpolationFactors(
+      double x, double y) const override;
+
+ private:
+  std::vector<Nest> m_nests;
+  std::unique_ptr<PointLocator> m_seam;
+};
+
+}  // namespace MetBuild::Private
+
+#endif  // METBUILD_SRC_NESTLOCATOR_H_
@@ -0,0 +1,270 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "NestedDomain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "CancelToken.h"
+#include "Logging.h"
+
+using namespace MetBuild;
+
+namespace {
+//...Largest distance from a whole number of fine cells, in fine cells, for
+// nodes to be taken as coinciding
+constexpr double c_tolerance = 1e-6;
+
+/**
+ * @brief Coordinates of a vector in the basis of the two axes of a grid
+ */
+std::pair<double, double> in_cells(const double x, const double y,
+                                   const Point &ex, const Point &ey) {
+  const double det = ex.x() * ey.y() - ex.y() * ey.x();
+  return {(x * ey.y() - y * ey.x()) / det, (ex.x() * y - ex.y() * x) / det};
+}
+
+bool whole(const double v) {
+  return std::abs(v - std::round(v)) < c_tolerance;
+}
+
+bool is_valid(const InterpolationWeights::CellRanges &ranges,
+              const size_t cell) {
+  auto it = std::upper_bound(
+      ranges.begin(), ranges.end(), cell,
+      [](const size_t c, const InterpolationWeights::CellRange &r) {
+        return c < r.end;
+      });
+  return it != ranges.end() && it->begin <= cell;
+}
+}  // namespace
+
+/**
+ * @brief Finds the coarse cells which coincide with nodes of a finer grid
+ * @param coarse coarse grid
+ * @param fine fine grid
+ * @return window of coinciding cells, none when the axes are not whole
+ * multiples of the fine spacing, the nodes do not coincide or the grids do
+ * not overlap
+ */
+std::optional<NestedDomain::Window> NestedDomain::align(
+    const MetBuild::Grid &coarse, const MetBuild::Grid &fine) {
+  if (coarse.is_point_list() || fine.is_point_list() ||
+      coarse.epsg() != fine.epsg() || coarse.ni() < 2 || coarse.nj() < 2 ||
+      fine.ni() < 2 || fine.nj() < 2) {
+    return std::nullopt;
+  }
+
+  const auto f0 = fine.position(0, 0);
+  const auto f1 = fine.position(1, 0);
+  const auto f2 = fine.position(0, 1);
+  const Point ex(f1.x() - f0.x(), f1.y() - f0.y());
+  const Point ey(f2.x() - f0.x(), f2.y() - f0.y());
+  if (ex.x() * ey.y() - ex.y() * ey.x() == 0.0) return std::nullopt;
+
+  const auto c0 = coarse.position(0, 0);
+  const auto c1 = coarse.position(1, 0);
+  const auto c2 = coarse.position(0, 1);
+  const auto step_i = in_cells(c1.x() - c0.x(), c1.y() - c0.y(), ex, ey);
+  const auto step_j = in_cells(c2.x() - c0.x(), c2.y() - c0.y(), ex, ey);
+  const auto offset = in_cells(c0.x() - f0.x(), c0.y() - f0.y(), ex, ey);
+  if (!whole(step_i.first) || !whole(step_i.second) ||
+      !whole(step_j.first) || !whole(step_j.second) ||
+      !whole(offset.first) || !whole(offset.second)) {
+    return std::nullopt;
+  }
+  const auto si = std::lround(step_i.first);
+  const auto sj = std::lround(step_j.second);
+  if (std::lround(step_i.second) != 0 || std::lround(step_j.first) != 0 ||
+      si < 1 || sj < 1 || si * sj == 1) {
+    return std::nullopt;
+  }
+
+  //...First and one past the last coarse index over the fine grid
+  auto span = [](const long origin, const long stride, const long n_fine,
+                 const long n_coarse) -> std::pair<long, long> {
+    const long first = origin >= 0 ? 0 : (-origin + stride - 1) / stride;
+    if (origin > n_fine - 1) return {0, 0};
+    const long last = std::min(n_coarse, (n_fine - 1 - origin) / stride + 1);
+    return {first, std::max(first, last)};
+  };
+  const auto oi = std::lround(offset.first);
+  const auto oj = std::lround(offset.second);
+  const auto range_i = span(oi, si, static_cast<long>(fine.ni()),
+                            static_cast<long>(coarse.ni()));
+  const auto range_j = span(oj, sj, static_cast<long>(fine.nj()),
+                            static_cast<long>(coarse.nj()));
+  if (range_i.first == range_i.second || range_j.first == range_j.second) {
+    return std::nullopt;
+  }
+
+  return Window{static_cast<size_t>(range_i.first),
+                static_cast<size_t>(range_j.first),
+                static_cast<size_t>(range_i.second - range_i.first),
+                static_cast<size_t>(range_j.second - range_j.first),
+                static_cast<size_t>(oi + range_i.first * si),
+                static_cast<size_t>(oj + range_j.first * sj),
+                static_cast<size_t>(si),
+                static_cast<size_t>(sj)};
+}
+
+/**
+ * @brief Constructor
+ * @param coarse coarse grid
+ * @param fine fine grid, which must be aligned with the coarse grid
+ * @param queue_depth number of steps the fine domain may run ahead
+ */
+NestedDomain::NestedDomain(const MetBuild::Grid &coarse,
+                           const MetBuild::Grid &fine,
+                           const size_t queue_depth)
+    : m_window([&]() {
+        const auto w = NestedDomain::align(coarse, fine);
+        if (!w) metbuild_throw_exception("The grids are not nested");
+        return *w;
+      }()),
+      m_coarse_ni(coarse.ni()),
+      m_coarse_nj(coarse.nj()),
+      m_fine_ni(fine.ni()),
+      m_queue_depth(std::max<size_t>(queue_depth, 1)),
+      m_closed(false) {}
+
+const NestedDomain::Window &NestedDomain::window() const { return m_window; }
+
+/**
+ * @brief Mask of the coarse grid computing only the cells outside the window
+ */
+std::vector<uint8_t> NestedDomain::remainder_mask() const {
+  std::vector<uint8_t> mask(m_coarse_ni * m_coarse_nj, 1);
+  for (size_t j = 0; j < m_window.nj; ++j) {
+    auto *row = mask.data() + (m_window.cj0 + j) * m_coarse_ni;
+    std::fill(row + m_window.ci0, row + m_window.ci0 + m_window.ni, 0);
+  }
+  return mask;
+}
+
+/**
+ * @brief Queues the window of a fine step, waiting while the queue is full.
+ * Called by the fine pipeline. Steps published after close are dropped
+ * @param time time of the step
+ * @param fields planes of the fine step, in the order the coarse step uses
+ * @param valid runs of fine cells holding values
+ */
+void NestedDomain::publish(
+    const MetBuild::Date &time,
+    const std::vector<const MetBuild::MeteorologicalDataType *> &fields,
+    const MetBuild::InterpolationWeights::CellRanges &valid) {
+  const auto &w = m_window;
+  Step step;
+  step.time = time;
+  step.fields.resize(fields.size());
+  for (size_t f = 0; f < fields.size(); ++f) {
+    auto &out = step.fields[f];
+    out.resize(w.ni * w.nj);
+    for (size_t j = 0; j < w.nj; ++j) {
+      const auto *row = fields[f] + (w.fj0 + j * w.sj) * m_fine_ni + w.fi0;
+      for (size_t i = 0; i < w.ni; ++i) {
+        out[j * w.ni + i] = row[i * w.si];
+      }
+    }
+  }
+
+  //...Runs of valid cells, in coarse cell numbering
+  for (size_t j = 0; j < w.nj; ++j) {
+    const size_t fine_row = (w.fj0 + j * w.sj) * m_fine_ni + w.fi0;
+    const size_t coarse_row = (w.cj0 + j) * m_coarse_ni + w.ci0;
+    for (size_t i = 0; i < w.ni; ++i) {
+      if (!is_valid(valid, fine_row + i * w.si)) continue;
+      const size_t cell = coarse_row + i;
+      if (!step.valid.empty() && step.valid.back().end == cell) {
+        step.valid.back().end++;
+      } else {
+        step.valid.push_back({cell, cell + 1});
+      }
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_condition.wait(lock, [this]() {
+    return m_closed || m_queue.size() < m_queue_depth;
+  });
+  if (m_closed) return;
+  m_queue.push_back(std::move(step));
+  lock.unlock();
+  m_condition.notify_all();
+}
+
+/**
+ * @brief Writes the window of the next fine step into a coarse step. Called
+ * by the coarse pipeline. Throws Cancelled when the queue has been closed
+ * before the step was published
+ * @param time time of the coarse step
+ * @param fields planes of the coarse step
+ * @param valid set to the runs of coarse cells of the window holding values
+ */
+void NestedDomain::take(
+    const MetBuild::Date &time,
+    const std::vector<MetBuild::MeteorologicalDataType *> &fields,
+    MetBuild::InterpolationWeights::CellRanges &valid) {
+  Step step;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]() { return m_closed || !m_queue.empty(); });
+    if (m_queue.empty()) {
+      throw MetBuild::Cancelled("The finer nested domain stopped");
+    }
+    step = std::move(m_queue.front());
+    m_queue.pop_front();
+  }
+  m_condition.notify_all();
+
+  if (step.time != time || step.fields.size() != fields.size()) {
+    metbuild_throw_exception("The nested domains are out of step");
+  }
+  const auto &w = m_window;
+  for (size_t f = 0; f < fields.size(); ++f) {
+    const auto &in = step.fields[f];
+    for (size_t j = 0; j < w.nj; ++j) {
+      std::copy(in.begin() + j * w.ni, in.begin() + (j + 1) * w.ni,
+                fields[f] + (w.cj0 + j) * m_coarse_ni + w.ci0);
+    }
+  }
+  valid = std::move(step.valid);
+}
+
+/**
+ * @brief Stops the exchange. Called by either pipeline when it stops
+ */
+void NestedDomain::close() {
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_closed = true;
+  }
+  m_condition.notify_all();
+}
@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_NESTEDDOMAIN_H_
+#define METBUILD_SRC_NESTEDDOMAIN_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "Date.h"
+#include "Grid.h"
+#include "InterpolationWeights.h"
+#include "MetBuild_Global.h"
+#include "MeteorologicalData.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Hands the steps of a fine domain to a coarser domain whose nodes
+ * coincide with nodes of the fine one
+ *
+ * When the spacing of the coarse grid is a whole multiple of the fine one
+ * and a coarse node falls on a fine node, every coarse node over the fine
+ * grid is interpolated at the same position as a fine node. Those cells are
+ * then taken from the fine steps instead of being located and interpolated
+ * again, and the coarse domain only computes the cells outside the fine
+ * grid, given by remainder_mask
+ *
+ * The fine pipeline publishes each step and the coarse pipeline takes it,
+ * through a queue of bounded depth. Closing the queue from either side wakes
+ * the other, so neither waits on a pipeline that has stopped
+ */
+class NestedDomain {
+ public:
+  /**
+   * @brief Coarse cells [ci0, ci0 + ni) x [cj0, cj0 + nj) over the fine
+   * grid. Coarse cell (ci0 + i, cj0 + j) is fine cell (fi0 + i * si,
+   * fj0 + j * sj)
+   */
+  struct Window {
+    size_t ci0;
+    size_t cj0;
+    size_t ni;
+    size_t nj;
+    size_t fi0;
+    size_t fj0;
+    size_t si;
+    size_t sj;
+  };
+
+  static std::optional<Window> METBUILD_EXPORT
+  align(const MetBuild::Grid &coarse, const MetBuild::Grid &fine);
+
+  METBUILD_EXPORT NestedDomain(const MetBuild::Grid &coarse,
+                               const MetBuild::Grid &fine,
+                               size_t queue_depth = 2);
+
+  NestedDomain(const NestedDomain &) = delete;
+  NestedDomain &operator=(const NestedDomain &) = delete;
+
+  NODISCARD const Window METBUILD_EXPORT &window() const;
+
+  NODISCARD std::vector<uint8_t> METBUILD_EXPORT remainder_mask() const;
+
+  void METBUILD_EXPORT
+  publish(const MetBuild::Date &time,
+          const std::vector<const MetBuild::MeteorologicalDataType *> &fields,
+          const MetBuild::InterpolationWeights::CellRanges &valid);
+
+  void METBUILD_EXPORT
+  take(const MetBuild::Date &time,
+       const std::vector<MetBuild::MeteorologicalDataType *> &fields,
+       MetBuild::InterpolationWeights::CellRanges &valid);
+
+  void METBUILD_EXPORT close();
+
+ private:
+  struct Step {
+    MetBuild::Date time;
+    std::vector<std::vector<MetBuild::MeteorologicalDataType>> fields;
+    MetBuild::InterpolationWeights::CellRanges valid;
+  };
+
+  const Window m_window;
+  const size_t m_coarse_ni;
+  const size_t m_coarse_nj;
+  const size_t m_fine_ni;
+  const size_t m_queue_depth;
+
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::deque<Step> m_queue;
+  bool m_closed;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_NESTEDDOMAIN_H_
@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_POINTLOCATOR_H_
+#define METBUILD_SRC_POINTLOCATOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "Instrumentation.h"
+#include "InterpolationWeight.h"
+#include "Point.h"
+
+namespace MetBuild::Private {
+
+/**
+ * @brief Interface for objects that locate a point within a source grid and
+ * generate the barycentric weights of the three source points around it
+ */
+class PointLocator {
+ public:
+  virtual ~PointLocator() = default;
+
+  [[nodiscard]] virtual std::unique_ptr<PointLocator> clone() const = 0;
+
+  [[nodiscard]] virtual MetBuild::InterpolationWeight getInterpolationFactors(
+      double x, double y) const = 0;
+
+  /**
+   * @brief Locates a sequence of points, such as a row of the output grid.
+   * Implementations use each result as the starting point for the next
+   * search, which is much cheaper when neighbouring points are close
+   * @param points points to locate
+   * @param weights output weights, one per point
+   */
+  virtual void getInterpolationFactors(
+      const std::vector<MetBuild::Point> &points,
+      std::vector<MetBuild::InterpolationWeight> &weights) const {
+    weights.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+      weights[i] = this->getInterpolationFactors(points[i].x(), points[i].y());
+    }
+  }
+
+ protected:
+  /**
+   * @brief Sets the bytes of the tables held by the locator, counted as
+   * triangulation memory
+   * @param bytes bytes held
+   */
+  void track_memory(size_t bytes) { m_memory.set(bytes); }
+
+ private:
+  Instrumentation::MemoryTracker m_memory{
+      Instrumentation::TRIANGULATION_MEMORY};
+};
+
+}  // namespace MetBuild::Private
+
+#endif  // METBUILD_SRC_POINTLOCATOR_H_
@@ -0,0 +1,231 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "PointSeries.h"
+
+#include <utility>
+
+#include "Logging.h"
+#include "MeteorologyPipeline.h"
+
+#define FMT_HEADER_ONLY
+#include "fmt/core.h"
+
+using namespace MetBuild;
+
+namespace {
+std::string json_string(const std::string &value) {
+  std::string s = "\"";
+  for (const char c : value) {
+    if (c == '"' || c == '\\') s += '\\';
+    s += c;
+  }
+  return s + "\"";
+}
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param points positions of the series
+ * @param source source of the files added to the series
+ * @param type data type extracted at each point
+ * @param epsg projection of the positions
+ */
+PointSeries::PointSeries(std::vector<MetBuild::Point> points,
+                         const Meteorology::SOURCE source,
+                         const MetBuild::GriddedDataTypes::TYPE type,
+                         const int epsg)
+    : m_grid(Grid::from_points(std::move(points), epsg)),
+      m_source(source),
+      m_type(type),
+      m_names(variable_names(type)) {}
+
+/**
+ * @brief Registers the files of the next source time, in time order
+ * @param filenames files making up the snapshot
+ * @param time valid time of the snapshot
+ */
+void PointSeries::add_file(const std::vector<std::string> &filenames,
+                           const MetBuild::Date &time) {
+  if (!m_files.empty() && time < m_files.back().time) {
+    metbuild_throw_exception("Files must be added to the series in time order");
+  }
+  m_files.push_back({filenames, time});
+}
+
+void PointSeries::add_file(const std::string &filename,
+                           const MetBuild::Date &time) {
+  this->add_file(std::vector<std::string>{filename}, time);
+}
+
+/**
+ * @brief Interpolates the series at every output time, replacing any series
+ * extracted before
+ * @param start_date first output time
+ * @param end_date last output time
+ * @param time_step seconds between output times
+ */
+void PointSeries::extract(const MetBuild::Date &start_date,
+                          const MetBuild::Date &end_date,
+                          const int time_step) {
+  if (m_files.empty()) {
+    metbuild_throw_exception("No files have been added to the series");
+  }
+  m_times.clear();
+  m_values.assign(m_names.size(), {});
+
+  //...Direct interpolation reads only the source values around the points,
+  // where snapshot interpolation would first grid every source value
+  Meteorology meteorology(&m_grid, m_source, m_type);
+  MeteorologyPipeline pipeline(&meteorology);
+  for (const auto &f : m_files) {
+    pipeline.add_file(f.filenames, f.time);
+  }
+  pipeline.start(start_date, end_date, time_step);
+
+  const bool wind = m_type == MetBuild::GriddedDataTypes::WIND_PRESSURE;
+  while (pipeline.next()) {
+    m_times.push_back(pipeline.time());
+    for (size_t k = 0; k < m_names.size(); ++k) {
+      const auto values = wind ? pipeline.wind_grid().parameter(k)
+                               : pipeline.grid().parameter(0);
+      m_values[k].insert(m_values[k].end(), values.begin(), values.end());
+    }
+  }
+}
+
+/**
+ * @brief Names of the variables of a data type, in the order of its fields
+ * @param type data type
+ * @return variable names
+ */
+std::vector<std::string> PointSeries::variable_names(
+    const MetBuild::GriddedDataTypes::TYPE type) {
+  switch (type) {
+    case MetBuild::GriddedDataTypes::WIND_PRESSURE:
+      return {"wind_u", "wind_v", "mslp"};
+    case MetBuild::GriddedDataTypes::TEMPERATURE:
+      return {"temperature"};
+    case MetBuild::GriddedDataTypes::HUMIDITY:
+      return {"humidity"};
+    case MetBuild::GriddedDataTypes::RAINFALL:
+      return {"rain"};
+    case MetBuild::GriddedDataTypes::ICE:
+      return {"ice"};
+    default:
+      metbuild_throw_exception("Invalid data type for a point series");
+      return {};
+  }
+}
+
+size_t PointSeries::size() const { return m_grid.ni(); }
+
+const std::vector<MetBuild::Date> &PointSeries::times() const {
+  return m_times;
+}
+
+const std::vector<std::string> &PointSeries::names() const { return m_names; }
+
+/**
+ * @brief Value of a variable at one point and time
+ * @param variable index of the variable in names()
+ * @param time index of the time in times()
+ * @param point index of the point
+ * @return value, or the flag value where the point has no data
+ */
+MeteorologicalDataType PointSeries::value(const size_t variable,
+                                          const size_t time,
+                                          const size_t point) const {
+  if (variable >= m_values.size() || time >= m_times.size() ||
+      point >= this->size()) {
+    metbuild_throw_exception("Point series index out of range");
+  }
+  return m_values[variable][time * this->size() + point];
+}
+
+bool PointSeries::missing(const MetBuild::MeteorologicalDataType value) const {
+  return value == MeteorologicalData<1>::flag_value();
+}
+
+/**
+ * @brief Formats the series with one row per time and point. Points without
+ * data are left empty
+ * @return CSV text with a header row
+ */
+std::string PointSeries::to_csv() const {
+  std::string s = "time,point,x,y";
+  for (const auto &name : m_names) s += "," + name;
+  s += "\n";
+  for (size_t t = 0; t < m_times.size(); ++t) {
+    const auto time = m_times[t].toString("%Y-%m-%dT%H:%M:%SZ");
+    for (size_t p = 0; p < this->size(); ++p) {
+      const auto position = m_grid.position(p, 0);
+      s += fmt::format("{},{},{},{}", time, p, position.x(), position.y());
+      for (size_t k = 0; k < m_names.size(); ++k) {
+        const auto v = m_values[k][t * this->size() + p];
+        s += this->missing(v) ? "," : fmt::format(",{}", v);
+      }
+      s += "\n";
+    }
+  }
+  return s;
+}
+
+/**
+ * @brief Formats the series as one object holding the times, the points and
+ * one array per variable and point. Points without data are null
+ * @return JSON text
+ */
+std::string PointSeries::to_json() const {
+  std::string s = "{\"time\": [";
+  for (size_t t = 0; t < m_times.size(); ++t) {
+    if (t > 0) s += ", ";
+    s += json_string(m_times[t].toString("%Y-%m-%dT%H:%M:%SZ"));
+  }
+  s += "], \"points\": [";
+  for (size_t p = 0; p < this->size(); ++p) {
+    const auto position = m_grid.position(p, 0);
+    s += fmt::format("{}{{\"x\": {}, \"y\": {}}}", p > 0 ? ", " : "",
+                     position.x(), position.y());
+  }
+  s += "], \"values\": {";
+  for (size_t k = 0; k < m_names.size(); ++k) {
+    s += fmt::format("{}{}: [", k > 0 ? ", " : "", json_string(m_names[k]));
+    for (size_t p = 0; p < this->size(); ++p) {
+      s += p > 0 ? ", [" : "[";
+      for (size_t t = 0; t < m_times.size(); ++t) {
+        const auto v = m_values[k][t * this->size() + p];
+        if (t > 0) s += ", ";
+        s += this->missing(v) ? "null" : fmt::format("{}", v);
+      }
+      s += "]";
+    }
+    s += "]";
+  }
+  return s + "}}";
+}
@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_POINTSERIES_H_
+#define METBUILD_SRC_POINTSERIES_H_
+
+#include <string>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "Date.h"
+#include "Grid.h"
+#include "MetBuild_Global.h"
+#include "MeteorologicalData.h"
+#include "Meteorology.h"
+#include "Point.h"
+#include "data_sources/GriddedDataTypes.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Time series of the meteorology at a short list of points, such as
+ * the gauges of a forecast
+ *
+ * The points are interpolated as a point list grid, so the weights onto the
+ * source grid are computed once for the whole series and each snapshot only
+ * contributes the source values around the points. The series is held in
+ * memory and returned as CSV or JSON, which keeps a request for a few points
+ * small enough to answer directly rather than through a gridded product
+ */
+class PointSeries {
+ public:
+  METBUILD_EXPORT PointSeries(std::vector<MetBuild::Point> points,
+                              Meteorology::SOURCE source,
+                              MetBuild::GriddedDataTypes::TYPE type,
+                              int epsg = 4326);
+
+  void METBUILD_EXPORT add_file(const std::vector<std::string> &filenames,
+                                const MetBuild::Date &time);
+  void METBUILD_EXPORT add_file(const std::string &filename,
+                                const MetBuild::Date &time);
+
+  void METBUILD_EXPORT extract(const MetBuild::Date &start_date,
+                               const MetBuild::Date &end_date, int time_step);
+
+  NODISCARD size_t METBUILD_EXPORT size() const;
+
+  NODISCARD const std::vector<MetBuild::Date> METBUILD_EXPORT &times() const;
+
+  NODISCARD const std::vector<std::string> METBUILD_EXPORT &names() const;
+
+  NODISCARD MetBuild::MeteorologicalDataType METBUILD_EXPORT
+  value(size_t variable, size_t time, size_t point) const;
+
+  NODISCARD std::string METBUILD_EXPORT to_csv() const;
+
+  NODISCARD std::string METBUILD_EXPORT to_json() const;
+
+  NODISCARD static std::vector<std::string> METBUILD_EXPORT
+  variable_names(MetBuild::GriddedDataTypes::TYPE type);
+
+ private:
+  struct SourceFile {
+    std::vector<std::string> filenames;
+    MetBuild::Date time;
+  };
+
+  NODISCARD bool missing(MetBuild::MeteorologicalDataType value) const;
+
+  MetBuild::Grid m_grid;
+  Meteorology::SOURCE m_source;
+  MetBuild::GriddedDataTypes::TYPE m_type;
+  std::vector<SourceFile> m_files;
+  std::vector<std::string> m_names;
+  std::vector<MetBuild::Date> m_times;
+
+  //...Values of each variable, indexed by time and then by point
+  std::vector<std::vector<MetBuild::MeteorologicalDataType>> m_values;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_POINTSERIES_H_
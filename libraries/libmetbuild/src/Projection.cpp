@@ -29,8 +29,12 @@
 #include "Projection.h"
 
 #include <cassert>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <tuple>
+#include <utility>
 
 #include "Logging.h"
 #include "proj.h"
@@ -38,11 +42,118 @@
 
 using namespace MetBuild;
 
+namespace {
+
+class EpsgCache {
+ public:
+  static EpsgCache &instance() {
+    static EpsgCache cache;
+    return cache;
+  }
+
+  ~EpsgCache() { this->close(); }
+
+  Projection::projection_epsg_result lookup(const int epsg) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_known.find(epsg);
+    if (it != m_known.end()) return it->second;
+    if (!this->open()) return {false, 0, ""};
+    return m_known[epsg] = this->query(epsg);
+  }
+
+  void reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_known.clear();
+    this->close();
+  }
+
+ private:
+  EpsgCache() = default;
+
+  bool open() {
+    if (m_statement != nullptr) return true;
+    const char *path = proj_context_get_database_path(PJ_DEFAULT_CTX);
+    if (path == nullptr ||
+        sqlite3_open_v2(path, &m_db, SQLITE_OPEN_READONLY, nullptr) !=
+            SQLITE_OK) {
+      Logging::warning("Could not open the proj database");
+      this->close();
+      return false;
+    }
+    constexpr const char *query =
+        "select code,name from crs_view where auth_name == 'EPSG' and "
+        "code == ?1 limit 1;";
+    if (sqlite3_prepare_v2(m_db, query, -1, &m_statement, nullptr) !=
+        SQLITE_OK) {
+      Logging::warning("Could not query the proj database");
+      this->close();
+      return false;
+    }
+    return true;
+  }
+
+  void close() {
+    sqlite3_finalize(m_statement);
+    sqlite3_close(m_db);
+    m_statement = nullptr;
+    m_db = nullptr;
+  }
+
+  Projection::projection_epsg_result query(const int epsg) {
+    Projection::projection_epsg_result result = {false, 0, ""};
+    const auto code = std::to_string(epsg);
+    sqlite3_bind_text(m_statement, 1, code.c_str(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(m_statement) == SQLITE_ROW) {
+      const auto *name = reinterpret_cast<const char *>(
+          sqlite3_column_text(m_statement, 1));
+      result = {true, sqlite3_column_int(m_statement, 0),
+                name != nullptr ? name : ""};
+    }
+    sqlite3_reset(m_statement);
+    sqlite3_clear_bindings(m_statement);
+    return result;
+  }
+
+  std::mutex m_mutex;
+  std::map<int, Projection::projection_epsg_result> m_known;
+  sqlite3 *m_db = nullptr;
+  sqlite3_stmt *m_statement = nullptr;
+};
+
+}  // namespace
+
+/**
+ * @brief Whether the proj database knows an EPSG code
+ * @param epsg EPSG code
+ * @return true when the code exists
+ */
 bool Projection::containsEpsg(int epsg) {
   projection_epsg_result result = {false, 0, ""};
   return Projection::queryProjDatabase(epsg, result) == 0;
 }
 
+/**
+ * @brief Transformer between two EPSG codes, created once per thread
+ *
+ * A transformer owns a proj context that may only be used by one thread at a
+ * time, so each thread keeps its own set
+ *
+ * @param epsgInput input EPSG code
+ * @param epsgOutput output EPSG code
+ * @return transformer owned by the calling thread
+ */
+const Projection::Transformer &Projection::cachedTransformer(int epsgInput,
+                                                             int epsgOutput) {
+  thread_local std::map<std::pair<int, int>, std::unique_ptr<Transformer>>
+      t_transformers;
+  auto &t = t_transformers[{epsgInput, epsgOutput}];
+  if (!t) {
+    t = std::make_unique<Transformer>("EPSG:" + std::to_string(epsgInput),
+                                      "EPSG:" + std::to_string(epsgOutput));
+  }
+  return *t;
+}
+
 std::string Projection::epsgDescription(int epsg) {
   projection_epsg_result result = {false, 0, ""};
   int ierr = Projection::queryProjDatabase(epsg, result);
@@ -53,46 +164,34 @@ std::string Projection::epsgDescription(int epsg) {
   }
 }
 
-static int projection_sqlite_callback(void *data, int argc, char **argv,
-                                      char **azColName) {
-  (void)(azColName);  //...Silence warning, unused
-  auto *v = static_cast<Projection::projection_epsg_result *>(data);
-  if (argc < 1) {
-    std::get<0>(*(v)) = false;
-    return 1;
-  }
-  std::get<0>(*(v)) = true;
-  std::get<1>(*(v)) = std::stoi(argv[1]);
-  std::get<2>(*(v)) = argv[2];
-  return 0;
-}
-
+/**
+ * @brief Looks up EPSG codes in the proj database
+ *
+ * One read only connection and prepared statement are kept open for the
+ * life of the process, and every answer, found or not, is kept since the
+ * database does not change underneath it. Pointing proj at another database
+ * closes the connection and forgets the answers
+ */
 int Projection::queryProjDatabase(int epsg, projection_epsg_result &result) {
-  sqlite3 *db;
-  sqlite3_open(proj_context_get_database_path(PJ_DEFAULT_CTX), &db);
-  std::string queryString =
-      "select distinct auth_name,code,name from crs_view where auth_name == "
-      "'EPSG' and code == " +
-      std::to_string(epsg) + ";";
-  char *errString;
-  sqlite3_exec(db, queryString.c_str(), projection_sqlite_callback, &result,
-               &errString);
-  sqlite3_close(db);
-  if (std::get<0>(result)) return 0;
-  return 1;
+  result = EpsgCache::instance().lookup(epsg);
+  return std::get<0>(result) ? 0 : 1;
 }
 
 int Projection::transform(int epsgInput, int epsgOutput, double x, double y,
                           double &outx, double &outy, bool &isLatLon) {
-  std::vector<double> xv = {x};
-  std::vector<double> yv = {y};
-  std::vector<double> outxv;
-  std::vector<double> outyv;
-  if (Projection::transform(epsgInput, epsgOutput, xv, yv, outxv, outyv,
-                            isLatLon))
+  isLatLon = false;
+  if (!Projection::containsEpsg(epsgInput)) return 1;
+  if (!Projection::containsEpsg(epsgOutput)) return 1;
+  const Transformer *transformer;
+  try {
+    transformer = &Projection::cachedTransformer(epsgInput, epsgOutput);
+  } catch (const std::exception &) {
     return 1;
-  outx = outxv[0];
-  outy = outyv[0];
+  }
+  outx = x;
+  outy = y;
+  if (transformer->transform(outx, outy) != 0) return 1;
+  isLatLon = transformer->angularOutput();
   return 0;
 }
 
@@ -108,43 +207,17 @@ int Projection::transform(int epsgInput, int epsgOutput,
   if (!Projection::containsEpsg(epsgInput)) return 3;
   if (!Projection::containsEpsg(epsgOutput)) return 4;
 
-  std::string p1 = "EPSG:" + std::to_string(epsgInput);
-  std::string p2 = "EPSG:" + std::to_string(epsgOutput);
-  PJ *pj1 =
-      proj_create_crs_to_crs(PJ_DEFAULT_CTX, p1.c_str(), p2.c_str(), NULL);
-  if (pj1 == nullptr) return 5;
-  PJ *pj2 = proj_normalize_for_visualization(PJ_DEFAULT_CTX, pj1);
-  if (pj2 == nullptr) return 6;
-  proj_destroy(pj1);
-
-  outx.clear();
-  outy.clear();
-  outx.reserve(x.size());
-  outy.reserve(y.size());
-
-  for (size_t i = 0; i < x.size(); ++i) {
-    PJ_COORD cin;
-    if (proj_angular_input(pj2, PJ_INV)) {
-      cin.lp.lam = proj_torad(x[i]);
-      cin.lp.phi = proj_torad(y[i]);
-    } else {
-      cin.xy.x = x[i];
-      cin.xy.y = y[i];
-    }
-
-    PJ_COORD cout = proj_trans(pj2, PJ_FWD, cin);
-
-    if (proj_angular_output(pj2, PJ_FWD)) {
-      outx.push_back(proj_todeg(cout.lp.lam));
-      outy.push_back(proj_todeg(cout.lp.phi));
-      isLatLon = true;
-    } else {
-      outx.push_back(cout.xy.x);
-      outy.push_back(cout.xy.y);
-      isLatLon = false;
-    }
+  const Transformer *transformer;
+  try {
+    transformer = &Projection::cachedTransformer(epsgInput, epsgOutput);
+  } catch (const std::exception &) {
+    return 5;
   }
-  proj_destroy(pj2);
+
+  outx = x;
+  outy = y;
+  if (transformer->transform(outx, outy) != 0) return 6;
+  isLatLon = transformer->angularOutput();
   return 0;
 }
 
@@ -177,6 +250,85 @@ std::vector<Point> Projection::transform(int epsgInput, int epsgOutput,
   return output;
 }
 
+Projection::Transformer::Transformer(const std::string &crsInput,
+                                     const std::string &crsOutput)
+    : m_context(proj_context_create()),
+      m_pj(nullptr),
+      m_angularInput(false),
+      m_angularOutput(false) {
+  PJ *pj1 = proj_create_crs_to_crs(m_context, crsInput.c_str(),
+                                   crsOutput.c_str(), nullptr);
+  if (pj1 == nullptr) {
+    proj_context_destroy(m_context);
+    metbuild_throw_exception("Could not create the transformation from '" +
+                             crsInput + "' to '" + crsOutput + "'");
+  }
+  m_pj = proj_normalize_for_visualization(m_context, pj1);
+  proj_destroy(pj1);
+  if (m_pj == nullptr) {
+    proj_context_destroy(m_context);
+    metbuild_throw_exception("Could not normalize the transformation from '" +
+                             crsInput + "' to '" + crsOutput + "'");
+  }
+  m_angularInput = proj_angular_input(m_pj, PJ_FWD);
+  m_angularOutput = proj_angular_output(m_pj, PJ_FWD);
+}
+
+Projection::Transformer::~Transformer() {
+  proj_destroy(m_pj);
+  proj_context_destroy(m_context);
+}
+
+/**
+ * @brief Transforms a set of coordinates in place
+ * @param x x-coordinates (longitude when geographic)
+ * @param y y-coordinates (latitude when geographic)
+ * @return 0 on success
+ */
+int Projection::Transformer::transform(std::vector<double> &x,
+                                       std::vector<double> &y) const {
+  if (x.size() != y.size()) return 1;
+  if (x.empty()) return 0;
+  if (m_angularInput) {
+    for (size_t i = 0; i < x.size(); ++i) {
+      x[i] = proj_torad(x[i]);
+      y[i] = proj_torad(y[i]);
+    }
+  }
+  proj_trans_generic(m_pj, PJ_FWD, x.data(), sizeof(double), x.size(),
+                     y.data(), sizeof(double), y.size(), nullptr, 0, 0,
+                     nullptr, 0, 0);
+  if (m_angularOutput) {
+    for (size_t i = 0; i < x.size(); ++i) {
+      x[i] = proj_todeg(x[i]);
+      y[i] = proj_todeg(y[i]);
+    }
+  }
+  return 0;
+}
+
+bool Projection::Transformer::angularOutput() const { return m_angularOutput; }
+
+int Projection::Transformer::transform(double &x, double &y) const {
+  PJ_COORD cin;
+  if (m_angularInput) {
+    cin.lp.lam = proj_torad(x);
+    cin.lp.phi = proj_torad(y);
+  } else {
+    cin.xy.x = x;
+    cin.xy.y = y;
+  }
+  PJ_COORD cout = proj_trans(m_pj, PJ_FWD, cin);
+  if (m_angularOutput) {
+    x = proj_todeg(cout.lp.lam);
+    y = proj_todeg(cout.lp.phi);
+  } else {
+    x = cout.xy.x;
+    y = cout.xy.y;
+  }
+  return 0;
+}
+
 std::string Projection::projVersion() {
   return std::to_string(static_cast<unsigned long long>(PROJ_VERSION_MAJOR)) +
          "." +
@@ -188,6 +340,7 @@ std::string Projection::projVersion() {
 void Projection::setProjDatabaseLocation(const std::string &dblocation) {
   proj_context_set_database_path(PJ_DEFAULT_CTX, dblocation.c_str(), nullptr,
                                  nullptr);
+  EpsgCache::instance().reset();
 }
 
 std::string Projection::projDatabaseLocation() {
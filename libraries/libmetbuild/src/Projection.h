@@ -33,12 +33,43 @@
 
 #include "Point.h"
 
+struct PJconsts;
+struct pj_ctx;
+
 namespace MetBuild {
 
 class Projection {
  public:
   using projection_epsg_result = std::tuple<bool, int, std::string>;
 
+  /**
+   * @brief Reusable transformation between two coordinate reference systems
+   *
+   * Each transformer owns its own proj context, so separate transformers can
+   * be used concurrently from different threads
+   */
+  class Transformer {
+   public:
+    Transformer(const std::string &crsInput, const std::string &crsOutput);
+
+    ~Transformer();
+
+    Transformer(const Transformer &) = delete;
+    Transformer &operator=(const Transformer &) = delete;
+
+    int transform(std::vector<double> &x, std::vector<double> &y) const;
+
+    int transform(double &x, double &y) const;
+
+    bool angularOutput() const;
+
+   private:
+    pj_ctx *m_context;
+    PJconsts *m_pj;
+    bool m_angularInput;
+    bool m_angularOutput;
+  };
+
   static std::string projVersion();
 
   static bool containsEpsg(int epsg);
@@ -63,6 +94,8 @@ class Projection {
 
  private:
   static int queryProjDatabase(int epsg, projection_epsg_result &result);
+
+  static const Transformer &cachedTransformer(int epsgInput, int epsgOutput);
 };
 }  // namespace MetBuild
 #endif  // METBUILD_PROJECTION_H
@@ -0,0 +1,370 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "RequestEstimate.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Logging.h"
+#include "MeteorologicalData.h"
+
+using namespace MetBuild;
+
+namespace {
+
+//...Memory of the process before any domain is added: the interpreter, the
+// libraries and the eccodes definitions
+constexpr size_t c_base_memory = 256 * 1024 * 1024;
+
+//...Bytes held per source point for the coordinates and the locator built
+// on them
+constexpr size_t c_bytes_per_source_point = 96;
+
+//...Decoded snapshots held at once by a pipeline
+constexpr size_t c_snapshots_held = 3;
+
+/**
+ * @brief Nominal grid of a source. Moving grids are located again for
+ * every file
+ */
+struct SourceGrid {
+  size_t points;
+  long interval;
+  size_t messages;
+  bool moving;
+};
+
+SourceGrid source_grid(const Meteorology::SOURCE source) {
+  switch (source) {
+    case Meteorology::GFS:
+      return {1440 * 721, 3600, 600, false};
+    case Meteorology::GEFS:
+      return {720 * 361, 10800, 80, false};
+    case Meteorology::NAM:
+      return {614 * 428, 3600, 400, false};
+    case Meteorology::HWRF:
+      return {1201 * 1201, 10800, 500, true};
+    case Meteorology::COAMPS:
+      return {3 * 301 * 301, 3600, 0, true};
+    case Meteorology::HRRR_CONUS:
+      return {1799 * 1059, 3600, 170, false};
+    case Meteorology::HRRR_ALASKA:
+      return {1299 * 919, 3600, 170, false};
+    case Meteorology::WPC:
+      return {2145 * 1377, 21600, 1, false};
+  }
+  metbuild_throw_exception("Unknown meteorological source");
+}
+
+size_t variables(const GriddedDataTypes::TYPE type) {
+  return type == GriddedDataTypes::WIND_PRESSURE ? 3 : 1;
+}
+
+/**
+ * @brief Size of each value written by an output format. Text formats are
+ * formatted character by character, netCDF formats are compressed by the
+ * writer and the others are gzipped when compression is requested
+ */
+struct OutputModel {
+  double bytes_per_value;
+  double compressed_ratio;
+  bool text;
+  bool netcdf;
+};
+
+OutputModel output_model(const std::string &format) {
+  if (format == "ascii" || format == "owi-ascii" || format == "adcirc-ascii") {
+    //...Ten characters per value and a newline every eight values
+    return {10.125, 0.35, true, false};
+  } else if (format == "owi-binary" || format == "adcirc-binary") {
+    return {4.0, 0.7, false, false};
+  } else if (format == "owi-netcdf" || format == "adcirc-netcdf" ||
+             format == "hec-netcdf") {
+    return {4.0, 0.5, false, true};
+  } else if (format == "delft3d") {
+    return {12.0, 1.0, true, false};
+  } else if (format == "zarr") {
+    return {4.0, 0.5, false, false};
+  } else if (format == "raw") {
+    return {0.0, 1.0, false, false};
+  }
+  metbuild_throw_exception("Invalid output format selected: " + format);
+}
+
+//...Nominal cost of one item of each stage in seconds, in the order of
+// Instrumentation::STAGE
+constexpr std::array<double, Instrumentation::N_STAGES> c_default_rates = {
+    2e-4,    // FILE_OPEN
+    2e-5,    // MESSAGE_INDEX
+    4e-9,    // DECODE
+    1.5e-6,  // TRIANGULATE
+    4e-7,    // LOCATE
+    2e-9,    // INTERPOLATE
+    1.5e-9,  // FORMAT
+    8e-9,    // COMPRESS
+    6e-9,    // NETCDF_WRITE
+    0.0,     // SOURCE_WAIT
+    0.0,     // DECODE_WAIT
+    0.0};    // OUTPUT_WAIT
+
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param start_date first output time
+ * @param end_date last output time
+ * @param time_step output time step in seconds
+ * @param format output format, named as in a request
+ * @param compression output is compressed
+ */
+RequestEstimate::RequestEstimate(const MetBuild::Date &start_date,
+                                 const MetBuild::Date &end_date,
+                                 const int time_step,
+                                 const std::string &format,
+                                 const bool compression)
+    : m_start_date(start_date),
+      m_end_date(end_date),
+      m_time_step(time_step),
+      m_format(format),
+      m_compression(compression),
+      m_memory_budget(0),
+      m_weights_cached(false),
+      m_seconds_per_item(c_default_rates) {
+  if (time_step <= 0 || end_date < start_date) {
+    metbuild_throw_exception("Invalid request time span");
+  }
+  output_model(format);
+}
+
+/**
+ * @brief Adds a domain gridded from a meteorological source
+ * @param grid output grid
+ * @param source meteorological source
+ * @param type data type interpolated
+ */
+void RequestEstimate::add_domain(const MetBuild::Grid *grid,
+                                 const Meteorology::SOURCE source,
+                                 const MetBuild::GriddedDataTypes::TYPE type) {
+  source_grid(source);
+  m_domains.push_back({grid->ni(), grid->nj(), false, source, type});
+}
+
+/**
+ * @brief Adds a domain gridded from a storm track with the parametric
+ * vortex
+ * @param grid output grid
+ */
+void RequestEstimate::add_vortex_domain(const MetBuild::Grid *grid) {
+  m_domains.push_back({grid->ni(), grid->nj(), true, Meteorology::GFS,
+                       GriddedDataTypes::WIND_PRESSURE});
+}
+
+/**
+ * @brief Sets the memory budget the request will be run with, see
+ * BuildRequest::set_memory_budget
+ * @param bytes budget in bytes, 0 for none
+ */
+void RequestEstimate::set_memory_budget(const size_t bytes) {
+  m_memory_budget = bytes;
+}
+
+/**
+ * @brief Sets whether the interpolation weights of every domain are held in
+ * the weight cache, in which case no source is triangulated or located
+ * @param cached weights are cached
+ */
+void RequestEstimate::set_weights_cached(const bool cached) {
+  m_weights_cached = cached;
+}
+
+/**
+ * @brief Replaces the cost per item of every stage the report has timed
+ * with the cost it measured
+ * @param report statistics of a build, e.g. BuildRequest::statistics
+ */
+void RequestEstimate::calibrate(const InstrumentationReport &report) {
+  for (int s = 0; s < Instrumentation::N_STAGES; ++s) {
+    if (report.items(s) > 0 && report.seconds(s) > 0.0) {
+      m_seconds_per_item[s] =
+          report.seconds(s) / static_cast<double>(report.items(s));
+    }
+  }
+}
+
+size_t RequestEstimate::records() const {
+  return static_cast<size_t>(
+      (m_end_date.toSeconds() - m_start_date.toSeconds()) / m_time_step + 1);
+}
+
+/**
+ * @brief Rows interpolated at once in the widest domain under the memory
+ * budget, the height of its grid when there is none
+ */
+size_t RequestEstimate::band_rows() const {
+  size_t ni = 0;
+  size_t nj = 0;
+  for (const auto &d : m_domains) {
+    if (d.ni > ni) {
+      ni = d.ni;
+      nj = d.nj;
+    }
+  }
+  if (ni == 0 || m_memory_budget == 0) return nj;
+  return std::clamp<size_t>(m_memory_budget / (ni * bytes_per_cell), 1, nj);
+}
+
+/**
+ * @brief Nominal number of points in a grid of a source
+ */
+size_t RequestEstimate::source_points(const Meteorology::SOURCE source) {
+  return source_grid(source).points;
+}
+
+/**
+ * @brief Largest memory in use while the request runs, in bytes. Domains run
+ * at the same time unless a memory budget is set, in which case they run one
+ * after the other in bands
+ */
+size_t RequestEstimate::peak_memory() const {
+  size_t domains = 0;
+  for (const auto &d : m_domains) {
+    const auto bytes = this->domain_memory(d);
+    domains = m_memory_budget == 0 ? domains + bytes : std::max(domains, bytes);
+  }
+  return c_base_memory + domains;
+}
+
+size_t RequestEstimate::domain_memory(const Domain &d) const {
+  size_t rows = d.nj;
+  if (m_memory_budget != 0) {
+    rows = std::clamp<size_t>(m_memory_budget / (d.ni * bytes_per_cell), 1,
+                              d.nj);
+  }
+  size_t bytes = d.ni * rows * bytes_per_cell;
+  if (!d.vortex) {
+    const auto points = source_grid(d.source).points;
+    bytes += points * (c_snapshots_held * variables(d.type) *
+                           sizeof(SourceDataType) +
+                       c_bytes_per_source_point);
+  }
+  return bytes;
+}
+
+/**
+ * @brief Cpu time of the request in seconds, summed over threads
+ */
+double RequestEstimate::cpu_seconds() const {
+  double seconds = 0.0;
+  for (int s = 0; s < Instrumentation::N_STAGES; ++s) {
+    seconds += this->stage_seconds(s);
+  }
+  return seconds;
+}
+
+/**
+ * @brief Cpu time of one instrumented stage in seconds
+ * @param stage Instrumentation::STAGE
+ */
+double RequestEstimate::stage_seconds(const int stage) const {
+  if (stage < 0 || stage >= Instrumentation::N_STAGES) {
+    metbuild_throw_exception("Invalid stage " + std::to_string(stage));
+  }
+  return this->stage_items()[stage] * m_seconds_per_item[stage];
+}
+
+/**
+ * @brief Size of the output files in bytes
+ */
+size_t RequestEstimate::output_bytes() const {
+  const auto per_value = value_bytes(m_format, m_compression);
+  double bytes = 0.0;
+  for (const auto &d : m_domains) {
+    bytes += static_cast<double>(this->records()) *
+             static_cast<double>(d.ni * d.nj * variables(d.type)) * per_value;
+  }
+  return static_cast<size_t>(bytes);
+}
+
+/**
+ * @brief Expected size of each value of an output format once written
+ * @param format output format, named as in a request
+ * @param compression true if the ascii and binary formats are compressed
+ * @return bytes per value
+ */
+double RequestEstimate::value_bytes(const std::string &format,
+                                    const bool compression) {
+  const auto model = output_model(format);
+  const bool compressed = model.netcdf || format == "zarr" || compression;
+  return model.bytes_per_value * (compressed ? model.compressed_ratio : 1.0);
+}
+
+/**
+ * @brief Number of items each stage is expected to process, counted as
+ * Instrumentation counts them
+ */
+std::array<double, Instrumentation::N_STAGES> RequestEstimate::stage_items()
+    const {
+  std::array<double, Instrumentation::N_STAGES> items{};
+  const auto model = output_model(m_format);
+  const auto span =
+      static_cast<double>(m_end_date.toSeconds() - m_start_date.toSeconds());
+  const auto records = static_cast<double>(this->records());
+
+  for (const auto &d : m_domains) {
+    const auto cells = static_cast<double>(d.ni * d.nj);
+    const auto nv = static_cast<double>(variables(d.type));
+    const auto values = records * cells * nv;
+    items[Instrumentation::INTERPOLATE] += values;
+
+    if (!d.vortex) {
+      const auto source = source_grid(d.source);
+      const auto points = static_cast<double>(source.points);
+      //...The files bracketing the span of the request
+      const double files =
+          std::ceil(span / static_cast<double>(source.interval)) + 1.0;
+      const double locates = source.moving ? files : 1.0;
+      items[Instrumentation::FILE_OPEN] += files * nv;
+      items[Instrumentation::MESSAGE_INDEX] +=
+          files * static_cast<double>(source.messages);
+      items[Instrumentation::DECODE] += files * nv * points;
+      if (!m_weights_cached) {
+        items[Instrumentation::TRIANGULATE] += locates * points;
+        items[Instrumentation::LOCATE] += locates * cells;
+      }
+    }
+
+    const double bytes = values * model.bytes_per_value;
+    if (model.text) items[Instrumentation::FORMAT] += bytes;
+    if (model.netcdf) items[Instrumentation::NETCDF_WRITE] += values;
+    if (m_compression && !model.netcdf) {
+      items[Instrumentation::COMPRESS] += bytes;
+    }
+  }
+  return items;
+}
@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_REQUESTESTIMATE_H_
+#define METBUILD_SRC_REQUESTESTIMATE_H_
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "Date.h"
+#include "Grid.h"
+#include "Instrumentation.h"
+#include "MetBuild_Global.h"
+#include "Meteorology.h"
+#include "data_sources/GriddedDataTypes.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Predicts the peak memory, cpu time and output size of a request
+ * before it is run, so a build can be sized or refused up front
+ *
+ * Domains are described as they are to BuildRequest. Each source is taken
+ * at its nominal grid size and file interval. Memory follows the model
+ * BuildRequest uses to band large grids, plus the decoded snapshots and
+ * locator of each source. The cpu time is the number of items each
+ * instrumented stage is expected to process times a cost per item. The
+ * costs are nominal defaults until calibrate is given the statistics of a
+ * build, or of the replay benchmark, run on the same hosts
+ */
+class RequestEstimate {
+ public:
+  //...Bytes held per output cell while a band is interpolated: the weights,
+  // the grid positions, the interpolated snapshots of the prefetch ring and
+  // the steps queued by the pipeline
+  static constexpr size_t bytes_per_cell = 160;
+
+  METBUILD_EXPORT RequestEstimate(const MetBuild::Date &start_date,
+                                  const MetBuild::Date &end_date,
+                                  int time_step, const std::string &format,
+                                  bool compression = false);
+
+  void METBUILD_EXPORT add_domain(const MetBuild::Grid *grid,
+                                  Meteorology::SOURCE source,
+                                  MetBuild::GriddedDataTypes::TYPE type);
+
+  void METBUILD_EXPORT add_vortex_domain(const MetBuild::Grid *grid);
+
+  void METBUILD_EXPORT set_memory_budget(size_t bytes);
+
+  void METBUILD_EXPORT set_weights_cached(bool cached);
+
+  void METBUILD_EXPORT calibrate(const InstrumentationReport &report);
+
+  NODISCARD size_t METBUILD_EXPORT peak_memory() const;
+
+  NODISCARD double METBUILD_EXPORT cpu_seconds() const;
+
+  NODISCARD double METBUILD_EXPORT stage_seconds(int stage) const;
+
+  NODISCARD size_t METBUILD_EXPORT output_bytes() const;
+
+  NODISCARD size_t METBUILD_EXPORT records() const;
+
+  NODISCARD size_t METBUILD_EXPORT band_rows() const;
+
+  NODISCARD static size_t METBUILD_EXPORT
+  source_points(Meteorology::SOURCE source);
+
+  NODISCARD static double METBUILD_EXPORT
+  value_bytes(const std::string &format, bool compression = false);
+
+ private:
+  struct Domain {
+    size_t ni;
+    size_t nj;
+    bool vortex;
+    Meteorology::SOURCE source;
+    MetBuild::GriddedDataTypes::TYPE type;
+  };
+
+  NODISCARD std::array<double, Instrumentation::N_STAGES> stage_items() const;
+
+  NODISCARD size_t domain_memory(const Domain &d) const;
+
+  MetBuild::Date m_start_date;
+  MetBuild::Date m_end_date;
+  int m_time_step;
+  std::string m_format;
+  bool m_compression;
+  size_t m_memory_budget;
+  bool m_weights_cached;
+  std::vector<Domain> m_domains;
+  std::array<double, Instrumentation::N_STAGES> m_seconds_per_item;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_REQUESTESTIMATE_H_
@@ -0,0 +1,149 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "RequestKey.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "Hash.h"
+#include "Logging.h"
+
+using namespace MetBuild;
+
+namespace {
+//...Changed whenever the output of an unchanged request may change, so the
+// results of older builds are not returned
+constexpr uint32_t c_version = 1;
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param start_date first output time
+ * @param end_date last output time
+ * @param time_step output time step in seconds
+ * @param format output format, named as in a request
+ * @param filename output filename
+ * @param compression codec the output is compressed with
+ */
+RequestKey::RequestKey(const MetBuild::Date &start_date,
+                       const MetBuild::Date &end_date, const int time_step,
+                       const std::string &format, const std::string &filename,
+                       const std::string &compression)
+    : m_start_date(start_date),
+      m_end_date(end_date),
+      m_time_step(time_step),
+      m_format(format),
+      m_filename(filename),
+      m_compression(compression) {
+  if (time_step <= 0 || end_date < start_date) {
+    metbuild_throw_exception("Invalid request time span");
+  }
+}
+
+/**
+ * @brief Adds a domain gridded from a meteorological source. Its files are
+ * added next with add_file
+ * @param grid output grid
+ * @param source meteorological source
+ * @param type data type interpolated
+ * @param backfill values outside the source are filled
+ * @param epsg_output projection of the output grid
+ */
+void RequestKey::add_domain(const MetBuild::Grid *grid,
+                            const Meteorology::SOURCE source,
+                            const MetBuild::GriddedDataTypes::TYPE type,
+                            const bool backfill, const int epsg_output) {
+  m_domains.push_back(
+      {grid->fingerprint(), false, source, type, backfill, epsg_output, {}});
+}
+
+/**
+ * @brief Adds a domain gridded from a storm track with the parametric
+ * vortex. The track files are added next with add_file
+ * @param grid output grid
+ */
+void RequestKey::add_vortex_domain(const MetBuild::Grid *grid) {
+  m_domains.push_back({grid->fingerprint(), true, Meteorology::GFS,
+                       GriddedDataTypes::WIND_PRESSURE, false, 4326, {}});
+}
+
+/**
+ * @brief Adds a source file of the last domain added
+ * @param name archive path of the file, or any name unique to its contents
+ * @param time time of the file
+ */
+void RequestKey::add_file(const std::string &name,
+                          const MetBuild::Date &time) {
+  if (m_domains.empty()) {
+    metbuild_throw_exception("A domain must be added before its files");
+  }
+  m_domains.back().files.emplace_back(time.toSeconds(), name);
+}
+
+/**
+ * @brief Adds a setting of the request which changes its output
+ * @param name name of the setting
+ * @param value value of the setting, written out in a canonical form
+ */
+void RequestKey::add_option(const std::string &name,
+                            const std::string &value) {
+  m_options.emplace_back(name, value);
+}
+
+/**
+ * @brief Generates the key of the request
+ * @return key
+ */
+std::string RequestKey::key() const {
+  Hash h;
+  h.add(c_version);
+  h.add(m_start_date.toSeconds()).add(m_end_date.toSeconds()).add(m_time_step);
+  h.add(m_format).add(m_filename).add(m_compression);
+
+  auto options = m_options;
+  std::sort(options.begin(), options.end());
+  h.add(options.size());
+  for (const auto &o : options) {
+    h.add(o.first).add(o.second);
+  }
+
+  h.add(m_domains.size());
+  for (const auto &d : m_domains) {
+    h.add(d.grid).add(d.vortex);
+    h.add(static_cast<int>(d.source)).add(static_cast<int>(d.type));
+    h.add(d.backfill).add(d.epsg_output);
+    auto files = d.files;
+    std::sort(files.begin(), files.end());
+    h.add(files.size());
+    for (const auto &f : files) {
+      h.add(f.first).add(f.second);
+    }
+  }
+  return h.hex();
+}
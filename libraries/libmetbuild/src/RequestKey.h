@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_REQUESTKEY_H_
+#define METBUILD_SRC_REQUESTKEY_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "Date.h"
+#include "Grid.h"
+#include "MetBuild_Global.h"
+#include "Meteorology.h"
+#include "data_sources/GriddedDataTypes.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Canonical key of a request, identical for every request that
+ * produces the same output, so a build can return the output of an earlier
+ * one instead of running again
+ *
+ * The request is described as it is to BuildRequest, each domain followed
+ * by the source files resolved for it. Files are named by their archive
+ * path rather than the local copy, so builds on different hosts agree. Grids
+ * enter the key by their fingerprint, so a grid given by its extent or by
+ * its corners keys the same way. Anything else that changes the output, e.g.
+ * the interpolation method, is added as a named option. Files and options
+ * are sorted before they are hashed, so the order they are added in does not
+ * matter
+ */
+class RequestKey {
+ public:
+  METBUILD_EXPORT RequestKey(const MetBuild::Date &start_date,
+                             const MetBuild::Date &end_date, int time_step,
+                             const std::string &format,
+                             const std::string &filename,
+                             const std::string &compression = "none");
+
+  void METBUILD_EXPORT add_domain(const MetBuild::Grid *grid,
+                                  Meteorology::SOURCE source,
+                                  MetBuild::GriddedDataTypes::TYPE type,
+                                  bool backfill = false,
+                                  int epsg_output = 4326);
+
+  void METBUILD_EXPORT add_vortex_domain(const MetBuild::Grid *grid);
+
+  void METBUILD_EXPORT add_file(const std::string &name,
+                                const MetBuild::Date &time);
+
+  void METBUILD_EXPORT add_option(const std::string &name,
+                                  const std::string &value);
+
+  NODISCARD std::string METBUILD_EXPORT key() const;
+
+ private:
+  struct Domain {
+    GridFingerprint grid;
+    bool vortex;
+    Meteorology::SOURCE source;
+    MetBuild::GriddedDataTypes::TYPE type;
+    bool backfill;
+    int epsg_output;
+    std::vector<std::pair<long, std::string>> files;
+  };
+
+  MetBuild::Date m_start_date;
+  MetBuild::Date m_end_date;
+  int m_time_step;
+  std::string m_format;
+  std::string m_filename;
+  std::string m_compression;
+  std::vector<std::pair<std::string, std::string>> m_options;
+  std::vector<Domain> m_domains;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_REQUESTKEY_H_
@@ -0,0 +1,199 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "ResourceLimits.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+#include "fmt/core.h"
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+using namespace MetBuild;
+
+namespace {
+#ifdef __linux__
+/**
+ * @brief Reads a cgroup value that is either a number or "max". The
+ * unlimited values of cgroup v1 are -1 or the largest page aligned number
+ * @return value, or 0 when the file is missing or holds no limit
+ */
+unsigned long long read_cgroup_value(const std::string &filename) {
+  std::ifstream f(filename);
+  std::string value;
+  if (!(f >> value) || value == "max") return 0;
+  try {
+    const auto v = std::stoll(value);
+    return v > 0 ? static_cast<unsigned long long>(v) : 0;
+  } catch (const std::exception &) {
+    return 0;
+  }
+}
+
+double read_cpu_quota() {
+  //...cgroup v2 writes the quota as "<quota> <period>" or "max <period>"
+  std::ifstream cpu_max("/sys/fs/cgroup/cpu.max");
+  std::string quota;
+  long period = 0;
+  if (cpu_max >> quota >> period) {
+    if (quota == "max" || period <= 0) return 0.0;
+    try {
+      const long q = std::stol(quota);
+      return q > 0 ? static_cast<double>(q) / period : 0.0;
+    } catch (const std::exception &) {
+      return 0.0;
+    }
+  }
+  //...cgroup v1 mounts the cpu controller on its own or joined with cpuacct
+  for (const std::string dir :
+       {"/sys/fs/cgroup/cpu/", "/sys/fs/cgroup/cpu,cpuacct/"}) {
+    const auto q = read_cgroup_value(dir + "cpu.cfs_quota_us");
+    const auto p = read_cgroup_value(dir + "cpu.cfs_period_us");
+    if (q > 0 && p > 0) return static_cast<double>(q) / p;
+  }
+  return 0.0;
+}
+
+size_t read_memory_limit() {
+  auto limit = read_cgroup_value("/sys/fs/cgroup/memory.max");
+  if (limit == 0) {
+    limit = read_cgroup_value("/sys/fs/cgroup/memory/memory.limit_in_bytes");
+  }
+  if (limit == 0) return 0;
+  //...A limit at or above the memory of the node does not bound anything
+  const long pages = sysconf(_SC_PHYS_PAGES);
+  const long page_size = sysconf(_SC_PAGE_SIZE);
+  if (pages > 0 && page_size > 0 &&
+      limit >= static_cast<unsigned long long>(pages) * page_size) {
+    return 0;
+  }
+  return static_cast<size_t>(limit);
+}
+#endif
+
+size_t environment_memory_budget() {
+  const char *env = std::getenv("METBUILD_MEMORY_BUDGET");
+  if (env != nullptr) return std::strtoull(env, nullptr, 10);
+  //...Half of the limit is left for the source data, the records held by the
+  // output writers and the caches
+  return ResourceLimits::memoryLimit() / 2;
+}
+
+std::atomic<size_t> s_default_memory_budget(environment_memory_budget());
+}  // namespace
+
+/**
+ * @brief Number of processors the process may run on: the hardware
+ * concurrency, bounded by the cpu affinity mask and the cgroup cpu quota
+ * rounded up. Read once per process
+ */
+size_t ResourceLimits::processors() {
+  static const size_t n = []() {
+    size_t n = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0) {
+      n = std::min<size_t>(n, CPU_COUNT(&set));
+    }
+#endif
+    const auto quota = ResourceLimits::cpuQuota();
+    if (quota > 0.0) {
+      n = std::min<size_t>(
+          n, std::max<size_t>(static_cast<size_t>(std::ceil(quota)), 1));
+    }
+    return n;
+  }();
+  return n;
+}
+
+/**
+ * @brief Processors worth of time the cgroup cpu quota allows per period
+ * @return quota, or 0 when the process has none
+ */
+double ResourceLimits::cpuQuota() {
+#ifdef __linux__
+  static const double quota = read_cpu_quota();
+  return quota;
+#else
+  return 0.0;
+#endif
+}
+
+/**
+ * @brief Memory limit of the cgroup of the process
+ * @return limit in bytes, or 0 when the process has none below the memory of
+ * the node
+ */
+size_t ResourceLimits::memoryLimit() {
+#ifdef __linux__
+  static const size_t limit = read_memory_limit();
+  return limit;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * @brief Sets the memory budget taken by a BuildRequest that has none of its
+ * own and would not fit in it otherwise. The default is taken from the
+ * METBUILD_MEMORY_BUDGET environment variable or half of the memory limit
+ * @param bytes memory budget, or 0 to never fall back to one
+ */
+void ResourceLimits::setDefaultMemoryBudget(const size_t bytes) {
+  s_default_memory_budget = bytes;
+}
+
+size_t ResourceLimits::defaultMemoryBudget() {
+  return s_default_memory_budget;
+}
+
+/**
+ * @brief Summary of the limits and the sizes chosen from them, for the log
+ */
+std::string ResourceLimits::describe() {
+  const auto mib = [](size_t bytes) {
+    return bytes == 0 ? std::string("none")
+                      : fmt::format("{:.0f} MiB", bytes / 1048576.0);
+  };
+  const auto quota = cpuQuota();
+  return fmt::format(
+      "{} processors available (cpu quota {}), memory limit {}, default "
+      "memory budget {}",
+      processors(), quota > 0.0 ? fmt::format("{:.2f}", quota) : "none",
+      mib(memoryLimit()), mib(defaultMemoryBudget()));
+}
@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_RESOURCELIMITS_H_
+#define METBUILD_SRC_RESOURCELIMITS_H_
+
+#include <cstddef>
+#include <string>
+
+#include "CppAttributes.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Processor and memory limits of the process
+ *
+ * A container sees every core and all of the memory of its node through the
+ * usual system calls, so the cpu affinity mask and the cgroup v1 or v2 cpu
+ * quota and memory limit are read as well. The global thread pool is sized
+ * from processors() and a BuildRequest without a memory budget of its own
+ * falls back to defaultMemoryBudget() when it would not fit in the limit
+ */
+class ResourceLimits {
+ public:
+  NODISCARD static size_t processors();
+
+  NODISCARD static double cpuQuota();
+
+  NODISCARD static size_t memoryLimit();
+
+  static void setDefaultMemoryBudget(size_t bytes);
+
+  NODISCARD static size_t defaultMemoryBudget();
+
+  NODISCARD static std::string describe();
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_RESOURCELIMITS_H_
@@ -0,0 +1,146 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_SHAREDCACHE_H_
+#define METBUILD_SRC_SHAREDCACHE_H_
+
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "CancelToken.h"
+#include "WarmCache.h"
+
+namespace MetBuild {
+
+/**
+ * @brief In-memory registry of objects in use, keyed by string
+ *
+ * The registry only holds weak references, so an object lives as long as
+ * one of its users does. Users asking for a key that is being built wait for
+ * that build instead of starting their own. When the build they wait for is
+ * cancelled they build the object themselves
+ *
+ * A registry given a name and a size estimate also hands the objects it
+ * returns to the WarmCache, which keeps the most recently used ones alive
+ * between requests when it is enabled
+ */
+template <typename T>
+class SharedCache {
+ public:
+  SharedCache() = default;
+
+  /**
+   * @param name prefix of the keys of the registry in the WarmCache
+   * @param bytes estimated memory held by an object
+   */
+  SharedCache(std::string name, std::function<size_t(const T &)> bytes)
+      : m_name(std::move(name)), m_bytes(std::move(bytes)) {}
+
+  /**
+   * @brief Returns the object held for a key, building it when no user holds
+   * it
+   * @param key key of the object
+   * @param build generates the object when it is not held
+   * @return shared object
+   */
+  std::shared_ptr<T> acquire(const std::string &key,
+                             const std::function<std::shared_ptr<T>()> &build) {
+    std::promise<std::shared_ptr<T>> promise;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      auto it = m_held.find(key);
+      if (it != m_held.end()) {
+        if (auto held = it->second.lock()) {
+          lock.unlock();
+          this->keep_warm(key, held);
+          return held;
+        }
+        m_held.erase(it);
+      }
+      auto pending = m_building.find(key);
+      if (pending != m_building.end()) {
+        auto future = pending->second;
+        lock.unlock();
+        try {
+          return future.get();
+        } catch (const MetBuild::Cancelled &) {
+          return this->acquire(key, build);
+        }
+      }
+      m_building.emplace(key, promise.get_future().share());
+    }
+
+    std::shared_ptr<T> object;
+    try {
+      object = build();
+    } catch (...) {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_building.erase(key);
+      }
+      promise.set_exception(std::current_exception());
+      throw;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for (auto it = m_held.begin(); it != m_held.end();) {
+        it = it->second.expired() ? m_held.erase(it) : std::next(it);
+      }
+      m_held[key] = object;
+      m_building.erase(key);
+    }
+    promise.set_value(object);
+    this->keep_warm(key, object);
+    return object;
+  }
+
+ private:
+  void keep_warm(const std::string &key, const std::shared_ptr<T> &object) {
+    if (!m_bytes || !object || !WarmCache::enabled()) return;
+    WarmCache::retain(m_name + ":" + key, object, m_bytes(*object));
+  }
+
+  const std::string m_name;
+  const std::function<size_t(const T &)> m_bytes;
+  std::mutex m_mutex;
+  std::unordered_map<std::string, std::weak_ptr<T>> m_held;
+  std::unordered_map<std::string, std::shared_future<std::shared_ptr<T>>>
+      m_building;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_SHAREDCACHE_H_
@@ -0,0 +1,341 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "SharedFieldStore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "Hash.h"
+#include "Instrumentation.h"
+#include "Logging.h"
+#include "boost/filesystem.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace MetBuild;
+
+namespace {
+constexpr char c_magic[4] = {'M', 'B', 'S', 'F'};
+constexpr uint32_t c_version = 1;
+
+//...tmpfs backing POSIX shared memory objects
+constexpr char c_directory[] = "/dev/shm";
+
+struct FieldHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t value_size;
+  uint32_t reserved;
+  uint64_t size;
+};
+
+std::mutex s_name_mutex;
+std::string s_name = []() {
+  const char *env = std::getenv("METBUILD_SHARED_FIELDS");
+  return env ? std::string(env) : std::string();
+}();
+std::atomic<uint64_t> s_budget = []() -> uint64_t {
+  const char *env = std::getenv("METBUILD_SHARED_FIELDS_SIZE");
+  return env ? std::strtoull(env, nullptr, 10) : 0;
+}();
+std::atomic<uint64_t> s_sequence{0};
+
+bool valid_name(const std::string &name) {
+  return std::all_of(name.begin(), name.end(), [](const unsigned char c) {
+    return std::isalnum(c) || c == '-' || c == '_';
+  });
+}
+
+/**
+ * @brief Objects of the store, including the temporaries of fields being
+ * written, by time of last use
+ * @param prefix prefix of the object names
+ * @return time, size and path of each object
+ */
+std::vector<std::tuple<std::time_t, uint64_t, boost::filesystem::path>>
+store_objects(const std::string &prefix) {
+  std::vector<std::tuple<std::time_t, uint64_t, boost::filesystem::path>>
+      objects;
+  boost::system::error_code ec;
+  for (boost::filesystem::directory_iterator it(c_directory, ec), end;
+       !ec && it != end; it.increment(ec)) {
+    const auto &path = it->path();
+    if (path.filename().string().rfind(prefix, 0) != 0) continue;
+    boost::system::error_code file_ec;
+    const auto size = boost::filesystem::file_size(path, file_ec);
+    const auto time = boost::filesystem::last_write_time(path, file_ec);
+    if (file_ec) continue;
+    objects.emplace_back(time, size, path);
+  }
+  std::sort(objects.begin(), objects.end());
+  return objects;
+}
+}  // namespace
+
+SharedFieldStore::Field::Field(const unsigned char *mapping, size_t bytes)
+    : m_mapping(mapping), m_bytes(bytes) {}
+
+SharedFieldStore::Field::~Field() {
+#ifdef __linux__
+  munmap(const_cast<unsigned char *>(m_mapping), m_bytes);
+#endif
+}
+
+const SourceDataType *SharedFieldStore::Field::data() const {
+  return reinterpret_cast<const SourceDataType *>(m_mapping +
+                                                  sizeof(FieldHeader));
+}
+
+size_t SharedFieldStore::Field::size() const {
+  return (m_bytes - sizeof(FieldHeader)) / sizeof(SourceDataType);
+}
+
+/**
+ * @brief Sets the name of the store. Processes using the same name share
+ * their fields, an empty name disables the store
+ * @param name letters, digits, '-' and '_'
+ */
+void SharedFieldStore::setName(const std::string &name) {
+  if (!valid_name(name)) {
+    metbuild_throw_exception("Invalid shared field store name: " + name);
+  }
+  std::lock_guard<std::mutex> lock(s_name_mutex);
+  s_name = name;
+}
+
+std::string SharedFieldStore::name() {
+  std::lock_guard<std::mutex> lock(s_name_mutex);
+  return s_name;
+}
+
+bool SharedFieldStore::enabled() {
+#ifdef __linux__
+  return !name().empty();
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Sets the size, in bytes, the store is trimmed to before each
+ * field is published. Zero leaves the store bounded only by /dev/shm
+ * @param bytes byte budget
+ */
+void SharedFieldStore::setBudget(uint64_t bytes) { s_budget = bytes; }
+
+uint64_t SharedFieldStore::budget() { return s_budget; }
+
+/**
+ * @brief Bytes held by the store, by every process using its name
+ */
+uint64_t SharedFieldStore::size() {
+  if (!enabled()) return 0;
+  uint64_t total = 0;
+  for (const auto &o : store_objects(name() + "_")) {
+    total += std::get<1>(o);
+  }
+  return total;
+}
+
+/**
+ * @brief Generates the key of a decoded field
+ * @param message the encoded grib message
+ * @param length length of the message in bytes
+ * @param decode_window identity of the crop window the message is decoded
+ * with, zero when it is decoded whole
+ * @param size number of values decoded
+ * @return key
+ */
+std::string SharedFieldStore::key(const void *message, const size_t length,
+                                  const uint64_t decode_window,
+                                  const size_t size) {
+  Hash h;
+  h.add(c_version).add(sizeof(SourceDataType)).add(decode_window).add(size);
+  h.add(length).add(message, length);
+  return h.hex();
+}
+
+std::string SharedFieldStore::path(const std::string &key) {
+  return (boost::filesystem::path(c_directory) / (name() + "_" + key))
+      .string();
+}
+
+/**
+ * @brief Maps a field published by any process on the node
+ * @param key key generated by SharedFieldStore::key
+ * @return field, or nullptr if it is not in the store or is unusable
+ */
+std::shared_ptr<const SharedFieldStore::Field> SharedFieldStore::attach(
+    const std::string &key) {
+#ifdef __linux__
+  if (!enabled()) return nullptr;
+  const auto fn = path(key);
+  const int fd = open(fn.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+  struct stat st {};
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(FieldHeader)) {
+    close(fd);
+    return nullptr;
+  }
+  const auto bytes = static_cast<size_t>(st.st_size);
+  void *ptr = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED) return nullptr;
+  auto field = std::make_shared<const Field>(
+      static_cast<const unsigned char *>(ptr), bytes);
+
+  FieldHeader header{};
+  std::memcpy(&header, ptr, sizeof(FieldHeader));
+  if (std::memcmp(header.magic, c_magic, sizeof(c_magic)) != 0 ||
+      header.version != c_version ||
+      header.value_size != sizeof(SourceDataType) ||
+      bytes != sizeof(FieldHeader) + header.size * sizeof(SourceDataType)) {
+    Logging::warning("Ignoring invalid shared field " + fn);
+    return nullptr;
+  }
+
+  //...Marks the field as recently used so it is evicted last
+  boost::system::error_code ec;
+  boost::filesystem::last_write_time(fn, std::time(nullptr), ec);
+  Instrumentation::count_event(Instrumentation::SHARED_FIELD_ATTACHED);
+  return field;
+#else
+  return nullptr;
+#endif
+}
+
+/**
+ * @brief Publishes a decoded field to the other processes on the node. The
+ * field is written under a temporary name and renamed, so it is never
+ * attached while partial
+ * @param key key generated by SharedFieldStore::key
+ * @param values decoded values
+ * @param size number of values
+ * @return true if the field is in the store
+ */
+bool SharedFieldStore::publish(const std::string &key,
+                               const SourceDataType *values,
+                               const size_t size) {
+#ifdef __linux__
+  if (!enabled()) return false;
+  const auto fn = path(key);
+  boost::system::error_code ec;
+  if (boost::filesystem::exists(fn, ec)) return true;
+
+  const uint64_t bytes = sizeof(FieldHeader) + size * sizeof(SourceDataType);
+  if (budget() != 0) evict(bytes, budget());
+
+  const auto tmp = fn + "." + std::to_string(getpid()) + "." +
+                   std::to_string(s_sequence++);
+  const int fd = open(tmp.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) return false;
+
+  //...Reserving the pages first turns a full /dev/shm into an error instead
+  // of a fault on the first write to a missing page
+  int err = posix_fallocate(fd, 0, static_cast<off_t>(bytes));
+  if (err == ENOSPC) {
+    evict(bytes, SharedFieldStore::size());
+    err = posix_fallocate(fd, 0, static_cast<off_t>(bytes));
+  }
+  void *ptr = err == 0 ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fd, 0)
+                       : MAP_FAILED;
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    boost::filesystem::remove(tmp, ec);
+    return false;
+  }
+
+  FieldHeader header{};
+  std::memcpy(header.magic, c_magic, sizeof(c_magic));
+  header.version = c_version;
+  header.value_size = sizeof(SourceDataType);
+  header.size = size;
+  auto *data = static_cast<unsigned char *>(ptr);
+  std::memcpy(data, &header, sizeof(FieldHeader));
+  std::memcpy(data + sizeof(FieldHeader), values,
+              size * sizeof(SourceDataType));
+  munmap(ptr, bytes);
+
+  boost::filesystem::rename(tmp, fn, ec);
+  if (ec) {
+    boost::filesystem::remove(tmp, ec);
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Removes every field of the store. Processes holding a field keep
+ * their mapping
+ */
+void SharedFieldStore::clear() {
+  if (!enabled()) return;
+  boost::system::error_code ec;
+  for (const auto &o : store_objects(name() + "_")) {
+    boost::filesystem::remove(std::get<2>(o), ec);
+  }
+}
+
+/**
+ * @brief Unlinks the least recently used fields until a new field fits in
+ * a number of bytes
+ * @param incoming size of the new field
+ * @param limit bytes the store may hold with the new field
+ */
+void SharedFieldStore::evict(const uint64_t incoming, const uint64_t limit) {
+  auto objects = store_objects(name() + "_");
+  uint64_t total = incoming;
+  for (const auto &o : objects) {
+    total += std::get<1>(o);
+  }
+  boost::system::error_code ec;
+  for (const auto &o : objects) {
+    if (total <= limit) break;
+    boost::filesystem::remove(std::get<2>(o), ec);
+    total -= std::get<1>(o);
+  }
+}
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_SHAREDFIELDSTORE_H_
+#define METBUILD_SRC_SHAREDFIELDSTORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "CppAttributes.h"
+#include "MeteorologicalData.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Decoded source fields shared by every process on a node through
+ * POSIX shared memory
+ *
+ * Each field is one object in /dev/shm, keyed by a hash of its grib message,
+ * the crop window it was decoded with and the source precision, so processes
+ * reading the same cycle, such as several build pods on one node, decode
+ * each message once. A field is written under a temporary name and renamed
+ * into place, and attached read-only by mapping it, so readers never see a
+ * partial field and share its pages
+ *
+ * The kernel counts the mappings of each object. A field evicted while it is
+ * attached is only unlinked, and its pages stay valid until the last
+ * process unmaps them. When a byte budget is set, with setBudget() or with
+ * METBUILD_SHARED_FIELDS_SIZE, the least recently attached fields are
+ * evicted once the store grows past it. Fields are also evicted when
+ * /dev/shm has no room for a new one. The values are stored as decoded,
+ * unit conversions are applied by each reader
+ *
+ * The store is disabled unless it is given a name, either with setName() or
+ * with the METBUILD_SHARED_FIELDS environment variable. Processes using the
+ * same name share their fields. It is only available on Linux
+ */
+class SharedFieldStore {
+ public:
+  /**
+   * @brief Read-only mapping of a field of the store
+   */
+  class Field {
+   public:
+    Field(const unsigned char *mapping, size_t bytes);
+
+    ~Field();
+
+    Field(const Field &) = delete;
+    Field &operator=(const Field &) = delete;
+
+    NODISCARD const MetBuild::SourceDataType *data() const;
+
+    NODISCARD size_t size() const;
+
+   private:
+    const unsigned char *m_mapping;
+    size_t m_bytes;
+  };
+
+  static void setName(const std::string &name);
+
+  NODISCARD static std::string name();
+
+  NODISCARD static bool enabled();
+
+  static void setBudget(uint64_t bytes);
+
+  NODISCARD static uint64_t budget();
+
+  NODISCARD static uint64_t size();
+
+  NODISCARD static std::string key(const void *message, size_t length,
+                                   uint64_t decode_window, size_t size);
+
+  NODISCARD static std::shared_ptr<const Field> attach(const std::string &key);
+
+  static bool publish(const std::string &key,
+                      const MetBuild::SourceDataType *values, size_t size);
+
+  static void clear();
+
+ private:
+  static std::string path(const std::string &key);
+
+  static void evict(uint64_t incoming, uint64_t limit);
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_SHAREDFIELDSTORE_H_
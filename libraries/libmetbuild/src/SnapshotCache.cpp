@@ -0,0 +1,353 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "SnapshotCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <tuple>
+
+#include "GribIndex.h"
+#include "Hash.h"
+#include "Logging.h"
+#include "MappedFile.h"
+#include "Utilities.h"
+#include "boost/filesystem.hpp"
+
+using namespace MetBuild;
+
+namespace {
+constexpr char c_magic[4] = {'M', 'B', 'S', 'C'};
+constexpr uint32_t c_version = 1;
+
+struct CacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t ni;
+  uint64_t nj;
+  uint32_t n_fields;
+  uint32_t value_size;
+};
+
+struct FieldHeader {
+  int32_t type;
+  int32_t parameter;
+};
+
+std::mutex s_directory_mutex;
+std::string s_directory = []() {
+  const char *env = std::getenv("METBUILD_SNAPSHOT_CACHE");
+  return env ? std::string(env) : std::string();
+}();
+std::atomic<uint64_t> s_budget = []() -> uint64_t {
+  const char *env = std::getenv("METBUILD_SNAPSHOT_CACHE_SIZE");
+  return env ? std::strtoull(env, nullptr, 10) : 0;
+}();
+}  // namespace
+
+void SnapshotCache::setDirectory(const std::string &directory) {
+  std::lock_guard<std::mutex> lock(s_directory_mutex);
+  s_directory = directory;
+}
+
+std::string SnapshotCache::directory() {
+  std::lock_guard<std::mutex> lock(s_directory_mutex);
+  return s_directory;
+}
+
+bool SnapshotCache::enabled() {
+  return !directory().empty() || SnapshotStore::enabled();
+}
+
+/**
+ * @brief Sets the size, in bytes, the cache directory is trimmed to after
+ * each store. Zero leaves the cache unbounded
+ * @param bytes byte budget
+ */
+void SnapshotCache::setBudget(uint64_t bytes) { s_budget = bytes; }
+
+uint64_t SnapshotCache::budget() { return s_budget; }
+
+/**
+ * @brief Generates the key of a snapshot
+ * @param filenames files making up the snapshot. Their contents, not their
+ * names, are hashed so a file downloaded again under another name still hits.
+ * Remote urls are hashed by name since they are not read in full
+ * @param grid fingerprint of the output grid positions
+ * @param settings hash of the settings that change the interpolated values
+ * @return key
+ */
+std::string SnapshotCache::key(const std::vector<std::string> &filenames,
+                               const GridFingerprint grid,
+                               uint64_t settings) {
+  Hash h;
+  h.add(settings).add(filenames.size());
+  for (const auto &f : filenames) {
+    //...Every step of a multi-step grib file is a snapshot of its own
+    const auto reference = GribIndex::splitReference(f);
+    if (Utilities::is_url(reference.first)) {
+      //...Remote files are read in part, so they are keyed by their url
+      // without the query string, which changes with each presigned url
+      h.add(reference.first.substr(0, reference.first.find('?')));
+    } else {
+      const auto file = MappedFile::get(reference.first);
+      h.add(file->size()).add(file->data(), file->size());
+    }
+    if (reference.second >= 0) h.add(reference.second);
+  }
+  h.add(grid);
+  return h.hex();
+}
+
+std::string SnapshotCache::filename(const std::string &key) {
+  return (boost::filesystem::path(directory()) / ("snapshot_" + key + ".bin"))
+      .string();
+}
+
+/**
+ * @brief Loads a snapshot from the cache, from the SnapshotStore first and
+ * then from the directory. Snapshots read from the directory are added to
+ * the store as the most recently used
+ * @param key key generated by SnapshotCache::key
+ * @return snapshot, or nullptr if none is cached or the file is unusable
+ */
+std::unique_ptr<SnapshotCache::Entry> SnapshotCache::load(
+    const std::string &key) {
+  if (!enabled()) return nullptr;
+  SnapshotStore::Spilled spilled;
+  if (const auto blob = SnapshotStore::get(key, &spilled)) {
+    spill(spilled);
+    return parse(reinterpret_cast<const unsigned char *>(blob->data()),
+                 blob->size(), "in-memory snapshot " + key);
+  }
+  if (directory().empty()) return nullptr;
+  const auto fn = filename(key);
+  if (!Utilities::exists(fn)) return nullptr;
+
+  //...Mark the snapshot as recently used for the eviction order
+  boost::system::error_code ec;
+  boost::filesystem::last_write_time(fn, std::time(nullptr), ec);
+
+  auto file = MappedFile(fn);
+  auto entry = parse(file.data(), file.size(), fn);
+  if (entry && SnapshotStore::enabled()) {
+    SnapshotStore::put(
+        key,
+        std::string(reinterpret_cast<const char *>(file.data()), file.size()),
+        &spilled);
+    spill(spilled);
+  }
+  return entry;
+}
+
+/**
+ * @brief Reads a serialized snapshot
+ * @param data serialized snapshot
+ * @param size number of bytes in data
+ * @param name name of the snapshot used in warnings
+ * @return snapshot, or nullptr if the data is unusable
+ */
+std::unique_ptr<SnapshotCache::Entry> SnapshotCache::parse(
+    const unsigned char *data, size_t size, const std::string &name) {
+  if (size < sizeof(CacheHeader)) return nullptr;
+
+  CacheHeader header{};
+  std::memcpy(&header, data, sizeof(CacheHeader));
+  if (std::memcmp(header.magic, c_magic, sizeof(c_magic)) != 0 ||
+      header.version != c_version || header.ni == 0 || header.nj == 0 ||
+      header.value_size != sizeof(MeteorologicalDataType)) {
+    Logging::warning("Ignoring invalid snapshot cache file " + name);
+    return nullptr;
+  }
+  const size_t n = header.ni * header.nj;
+  const size_t mask_words = (n + 63) / 64;
+  const size_t expected =
+      sizeof(CacheHeader) + mask_words * sizeof(uint64_t) +
+      header.n_fields * (sizeof(FieldHeader) + n * header.value_size);
+  if (size != expected) {
+    Logging::warning("Ignoring truncated snapshot cache file " + name);
+    return nullptr;
+  }
+
+  auto entry = std::make_unique<Entry>();
+  entry->weights = std::make_unique<InterpolationWeights>(header.ni, header.nj);
+  const auto *ptr = data + sizeof(CacheHeader);
+  std::memcpy(entry->weights->mask(), ptr, mask_words * sizeof(uint64_t));
+  ptr += mask_words * sizeof(uint64_t);
+
+  entry->fields.resize(header.n_fields);
+  for (auto &field : entry->fields) {
+    FieldHeader fh{};
+    std::memcpy(&fh, ptr, sizeof(FieldHeader));
+    ptr += sizeof(FieldHeader);
+    field.type = fh.type;
+    field.parameter = fh.parameter;
+    field.values.resize(n);
+    std::memcpy(field.values.data(), ptr, n * header.value_size);
+    ptr += n * header.value_size;
+  }
+  return entry;
+}
+
+/**
+ * @brief Writes a snapshot to the cache. With the SnapshotStore enabled the
+ * snapshot is kept in memory and only written to the directory once it is
+ * spilled from the store
+ * @param key key generated by SnapshotCache::key
+ * @param weights weights of the snapshot, of which only the mask is stored
+ * @param fields interpolated planes
+ */
+void SnapshotCache::store(const std::string &key,
+                          const InterpolationWeights &weights,
+                          const std::vector<Field> &fields) {
+  if (!enabled()) return;
+  const size_t n = weights.size();
+  for (const auto &field : fields) {
+    if (field.values.size() != n) {
+      metbuild_throw_exception("Snapshot field does not match the grid size");
+    }
+  }
+
+  std::string bytes;
+  bytes.reserve(sizeof(CacheHeader) + weights.mask_size() * sizeof(uint64_t) +
+                fields.size() *
+                    (sizeof(FieldHeader) + n * sizeof(MeteorologicalDataType)));
+  auto append = [&](const void *data, size_t size) {
+    bytes.append(reinterpret_cast<const char *>(data), size);
+  };
+  CacheHeader header{};
+  std::memcpy(header.magic, c_magic, sizeof(c_magic));
+  header.version = c_version;
+  header.ni = weights.ni();
+  header.nj = weights.nj();
+  header.n_fields = static_cast<uint32_t>(fields.size());
+  header.value_size = sizeof(MeteorologicalDataType);
+  append(&header, sizeof(CacheHeader));
+  append(weights.mask(), weights.mask_size() * sizeof(uint64_t));
+  for (const auto &field : fields) {
+    const FieldHeader fh{field.type, field.parameter};
+    append(&fh, sizeof(FieldHeader));
+    append(field.values.data(), n * sizeof(MeteorologicalDataType));
+  }
+
+  if (SnapshotStore::enabled()) {
+    SnapshotStore::Spilled spilled;
+    SnapshotStore::put(key, std::move(bytes), &spilled);
+    spill(spilled);
+  } else if (!directory().empty()) {
+    write(key, bytes);
+  }
+}
+
+/**
+ * @brief Writes the snapshots spilled from the SnapshotStore to the
+ * directory. Snapshots already there are only marked as recently used
+ * @param spilled snapshots dropped from the store
+ */
+void SnapshotCache::spill(const SnapshotStore::Spilled &spilled) {
+  if (spilled.empty() || directory().empty()) return;
+  for (const auto &s : spilled) {
+    const auto fn = filename(s.first);
+    if (Utilities::exists(fn)) {
+      boost::system::error_code ec;
+      boost::filesystem::last_write_time(fn, std::time(nullptr), ec);
+    } else {
+      write(s.first, *s.second);
+    }
+  }
+}
+
+/**
+ * @brief Writes a serialized snapshot to the directory. The file is written
+ * under a temporary name and renamed so that concurrent readers never see a
+ * partial file
+ * @param key key generated by SnapshotCache::key
+ * @param bytes serialized snapshot
+ */
+void SnapshotCache::write(const std::string &key, const std::string &bytes) {
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(directory(), ec);
+
+  const auto fn = filename(key);
+  const auto tmp = fn + "." + boost::filesystem::unique_path().string();
+  {
+    std::ofstream f(tmp, std::ios::binary);
+    if (!f.is_open()) {
+      Logging::warning("Could not write snapshot cache file " + fn);
+      return;
+    }
+    f.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  }
+  boost::filesystem::rename(tmp, fn, ec);
+  if (ec) {
+    boost::filesystem::remove(tmp, ec);
+  }
+  evict();
+}
+
+/**
+ * @brief Removes the least recently used snapshots until the cache fits in
+ * its budget. Other processes may remove the same files or still have them
+ * mapped, neither of which is an error
+ */
+void SnapshotCache::evict() {
+  const uint64_t limit = budget();
+  if (limit == 0) return;
+
+  std::vector<std::tuple<std::time_t, uint64_t, boost::filesystem::path>>
+      snapshots;
+  uint64_t total = 0;
+  boost::system::error_code ec;
+  for (boost::filesystem::directory_iterator it(directory(), ec), end;
+       !ec && it != end; it.increment(ec)) {
+    const auto &path = it->path();
+    const auto name = path.filename().string();
+    if (name.rfind("snapshot_", 0) != 0 || path.extension() != ".bin") {
+      continue;
+    }
+    boost::system::error_code file_ec;
+    const auto size = boost::filesystem::file_size(path, file_ec);
+    const auto time = boost::filesystem::last_write_time(path, file_ec);
+    if (file_ec) continue;
+    snapshots.emplace_back(time, size, path);
+    total += size;
+  }
+  if (total <= limit) return;
+
+  std::sort(snapshots.begin(), snapshots.end());
+  for (const auto &s : snapshots) {
+    if (total <= limit) break;
+    boost::filesystem::remove(std::get<2>(s), ec);
+    total -= std::get<1>(s);
+  }
+}
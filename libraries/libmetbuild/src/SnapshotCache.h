@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_SNAPSHOTCACHE_H_
+#define METBUILD_SRC_SNAPSHOTCACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "GridFingerprint.h"
+#include "InterpolationWeights.h"
+#include "MeteorologicalData.h"
+#include "SnapshotStore.h"
+
+namespace MetBuild {
+
+/**
+ * @brief On-disk cache of source snapshots already interpolated onto an
+ * output grid
+ *
+ * Entries are keyed by a hash of the contents of the source files, the output
+ * grid positions and the settings that change the interpolated values, so a
+ * later forecast cycle that reads the same files onto the same grid skips
+ * decoding and interpolation entirely. The cache is disabled unless a
+ * directory is set, either with setDirectory() or with the
+ * METBUILD_SNAPSHOT_CACHE environment variable. The directory may be shared
+ * by several processes. When a byte budget is set, with setBudget() or with
+ * METBUILD_SNAPSHOT_CACHE_SIZE, the least recently used snapshots are removed
+ * once the cache grows past it
+ *
+ * With the SnapshotStore enabled, snapshots are held in memory first and
+ * the directory only receives the snapshots the store spills
+ */
+class SnapshotCache {
+ public:
+  /**
+   * @brief One interpolated plane, tagged by the data type it belongs to and
+   * its parameter index within that type
+   */
+  struct Field {
+    int type;
+    int parameter;
+    std::vector<MetBuild::MeteorologicalDataType> values;
+  };
+
+  /**
+   * @brief A cached snapshot. The weights only carry the mask of the cells
+   * covered by the source
+   */
+  struct Entry {
+    std::unique_ptr<InterpolationWeights> weights;
+    std::vector<Field> fields;
+  };
+
+  static void setDirectory(const std::string &directory);
+
+  NODISCARD static std::string directory();
+
+  NODISCARD static bool enabled();
+
+  static void setBudget(uint64_t bytes);
+
+  NODISCARD static uint64_t budget();
+
+  NODISCARD static std::string key(const std::vector<std::string> &filenames,
+                                   MetBuild::GridFingerprint grid,
+                                   uint64_t settings);
+
+  NODISCARD static std::unique_ptr<Entry> load(const std::string &key);
+
+  static void store(const std::string &key,
+                    const InterpolationWeights &weights,
+                    const std::vector<Field> &fields);
+
+ private:
+  static std::string filename(const std::string &key);
+
+  static std::unique_ptr<Entry> parse(const unsigned char *data, size_t size,
+                                      const std::string &name);
+
+  static void spill(const SnapshotStore::Spilled &spilled);
+
+  static void write(const std::string &key, const std::string &bytes);
+
+  static void evict();
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_SNAPSHOTCACHE_H_
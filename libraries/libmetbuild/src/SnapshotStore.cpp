@@ -0,0 +1,335 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "SnapshotStore.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "Instrumentation.h"
+#include "MeteorologicalData.h"
+#include "output/StreamCompression.h"
+
+using namespace MetBuild;
+
+namespace {
+
+//...Share of the budget holding snapshots as written
+constexpr double c_hot_fraction = 0.5;
+
+struct Item {
+  std::string key;
+  SnapshotStore::Blob data;
+  StreamCompression::Codec codec = StreamCompression::NONE;
+  size_t raw_size = 0;
+  bool hot = true;
+  Instrumentation::MemoryTracker memory{Instrumentation::SNAPSHOT_MEMORY};
+};
+
+struct State {
+  std::mutex mutex;
+  size_t budget = 0;
+  size_t hot_bytes = 0;
+  size_t warm_bytes = 0;
+  size_t warm_count = 0;
+  std::list<Item> items;  // most recently used first
+  std::unordered_map<std::string, std::list<Item>::iterator> index;
+};
+
+State &state() {
+  static auto *s = []() {
+    auto *state = new State;
+    const char *env = std::getenv("METBUILD_SNAPSHOT_MEMORY");
+    if (env != nullptr) {
+      state->budget = static_cast<size_t>(std::strtoull(env, nullptr, 10))
+                      << 20;
+    }
+    return state;
+  }();
+  return *s;
+}
+
+/**
+ * @brief Fastest codec the library was built with
+ */
+StreamCompression::Codec codec() {
+  if (StreamCompression::available(StreamCompression::LZ4)) {
+    return StreamCompression::LZ4;
+  } else if (StreamCompression::available(StreamCompression::ZSTD)) {
+    return StreamCompression::ZSTD;
+  }
+  return StreamCompression::GZIP;
+}
+
+/**
+ * @brief Groups the bytes of the values by their position in each value, so
+ * the slowly varying sign and exponent bytes compress together
+ */
+std::string shuffle(const std::string &bytes) {
+  constexpr size_t width = sizeof(MeteorologicalDataType);
+  const size_t n = bytes.size() / width;
+  std::string out(bytes.size(), '\0');
+  for (size_t b = 0; b < width; ++b) {
+    for (size_t k = 0; k < n; ++k) out[b * n + k] = bytes[k * width + b];
+  }
+  std::copy(bytes.begin() + n * width, bytes.end(), out.begin() + n * width);
+  return out;
+}
+
+std::string unshuffle(const std::string &bytes) {
+  constexpr size_t width = sizeof(MeteorologicalDataType);
+  const size_t n = bytes.size() / width;
+  std::string out(bytes.size(), '\0');
+  for (size_t b = 0; b < width; ++b) {
+    for (size_t k = 0; k < n; ++k) out[k * width + b] = bytes[b * n + k];
+  }
+  std::copy(bytes.begin() + n * width, bytes.end(), out.begin() + n * width);
+  return out;
+}
+
+SnapshotStore::Blob unpack(const Item &item) {
+  if (item.codec == StreamCompression::NONE) return item.data;
+  return std::make_shared<const std::string>(
+      unshuffle(StreamCompression::decompress(item.codec, item.data->data(),
+                                              item.data->size(),
+                                              item.raw_size)));
+}
+
+/**
+ * @brief Replaces the data of an item and moves it between the tiers
+ */
+void assign(State *s, Item &item, SnapshotStore::Blob data,
+            StreamCompression::Codec codec, bool hot) {
+  if (item.data) {
+    (item.hot ? s->hot_bytes : s->warm_bytes) -= item.data->size();
+    if (!item.hot) s->warm_count--;
+  }
+  item.data = std::move(data);
+  item.codec = codec;
+  item.hot = hot;
+  (hot ? s->hot_bytes : s->warm_bytes) += item.data->size();
+  if (!hot) s->warm_count++;
+  item.memory.set(item.data->size());
+}
+
+/**
+ * @brief Compresses the least recently used snapshots kept as written until
+ * they fit their share of the budget, then drops the least recently used
+ * snapshots until the store fits the budget. Compression runs without the
+ * mutex held, so an item changed meanwhile is left as it is
+ * @param spilled receives the dropped snapshots as written, may be null
+ */
+void rebalance(SnapshotStore::Spilled *spilled) {
+  auto &s = state();
+  const auto target = codec();
+  while (true) {
+    std::string key;
+    SnapshotStore::Blob raw;
+    {
+      std::lock_guard<std::mutex> lock(s.mutex);
+      const auto limit = static_cast<size_t>(c_hot_fraction * s.budget);
+      if (s.hot_bytes <= limit || s.items.size() < 2) break;
+      for (auto it = std::prev(s.items.end()); it != s.items.begin(); --it) {
+        if (it->hot) {
+          key = it->key;
+          raw = it->data;
+          break;
+        }
+      }
+    }
+    if (!raw) break;
+
+    auto frame = std::make_shared<const std::string>(
+        StreamCompression::compress(target, shuffle(*raw).data(), raw->size(),
+                                    StreamCompression::defaultLevel(target)));
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.index.find(key);
+    if (it == s.index.end() || it->second->data != raw) continue;
+    //...Snapshots which do not compress stay as written in the warm tier
+    if (frame->size() < raw->size()) {
+      assign(&s, *it->second, std::move(frame), target, false);
+    } else {
+      assign(&s, *it->second, raw, StreamCompression::NONE, false);
+    }
+  }
+
+  std::list<Item> dropped;
+  {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    while (s.hot_bytes + s.warm_bytes > s.budget && !s.items.empty()) {
+      auto &last = s.items.back();
+      (last.hot ? s.hot_bytes : s.warm_bytes) -= last.data->size();
+      if (!last.hot) s.warm_count--;
+      s.index.erase(last.key);
+      dropped.splice(dropped.end(), s.items, std::prev(s.items.end()));
+    }
+  }
+  if (!spilled) return;
+  for (const auto &item : dropped) {
+    spilled->emplace_back(item.key, unpack(item));
+  }
+}
+
+}  // namespace
+
+/**
+ * @brief Sets the memory held by the store. Snapshots over a lower budget
+ * are dropped without being spilled, and a budget of zero disables the store
+ * @param bytes budget in bytes
+ */
+void SnapshotStore::setBudget(const size_t bytes) {
+  {
+    auto &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.budget = bytes;
+  }
+  rebalance(nullptr);
+}
+
+size_t SnapshotStore::budget() {
+  auto &s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  return s.budget;
+}
+
+bool SnapshotStore::enabled() { return budget() > 0; }
+
+/**
+ * @brief Memory held by the store in bytes, as written and compressed
+ */
+size_t SnapshotStore::size() {
+  auto &s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  return s.hot_bytes + s.warm_bytes;
+}
+
+/**
+ * @brief Number of snapshots held by the store
+ */
+size_t SnapshotStore::count() {
+  auto &s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  return s.items.size();
+}
+
+/**
+ * @brief Number of snapshots held in the compressed tier
+ */
+size_t SnapshotStore::compressedCount() {
+  auto &s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  return s.warm_count;
+}
+
+/**
+ * @brief Returns a snapshot as written and marks it as the most recently
+ * used. A compressed snapshot is decompressed and kept as written again
+ * @param key key of the snapshot
+ * @param spilled receives the snapshots dropped to make room, may be null
+ * @return serialized snapshot, null when the store does not hold it
+ */
+SnapshotStore::Blob SnapshotStore::get(const std::string &key,
+                                       Spilled *spilled) {
+  auto &s = state();
+  Item item;
+  {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.index.find(key);
+    if (it == s.index.end()) return nullptr;
+    s.items.splice(s.items.begin(), s.items, it->second);
+    if (it->second->hot) return it->second->data;
+    item.data = it->second->data;
+    item.codec = it->second->codec;
+    item.raw_size = it->second->raw_size;
+  }
+
+  auto raw = unpack(item);
+  {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.index.find(key);
+    if (it != s.index.end() && it->second->data == item.data) {
+      assign(&s, *it->second, raw, StreamCompression::NONE, true);
+    }
+  }
+  rebalance(spilled);
+  return raw;
+}
+
+/**
+ * @brief Adds a snapshot as the most recently used, replacing any held
+ * under the same key. A snapshot larger than the whole budget is handed
+ * straight back to be spilled
+ * @param key key of the snapshot
+ * @param bytes serialized snapshot
+ * @param spilled receives the snapshots dropped to make room, may be null
+ */
+void SnapshotStore::put(const std::string &key, std::string bytes,
+                        Spilled *spilled) {
+  auto data = std::make_shared<const std::string>(std::move(bytes));
+  auto &s = state();
+  {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (s.budget == 0) return;
+    if (data->size() > s.budget) {
+      if (spilled) spilled->emplace_back(key, std::move(data));
+      return;
+    }
+    auto it = s.index.find(key);
+    if (it == s.index.end()) {
+      s.items.emplace_front();
+      s.items.front().key = key;
+      s.index.emplace(key, s.items.begin());
+    } else {
+      s.items.splice(s.items.begin(), s.items, it->second);
+    }
+    auto &item = s.items.front();
+    item.raw_size = data->size();
+    assign(&s, item, std::move(data), StreamCompression::NONE, true);
+  }
+  rebalance(spilled);
+}
+
+/**
+ * @brief Drops every snapshot held by the store. The budget is kept
+ */
+void SnapshotStore::clear() {
+  std::list<Item> released;
+  {
+    auto &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    released.swap(s.items);
+    s.index.clear();
+    s.hot_bytes = 0;
+    s.warm_bytes = 0;
+    s.warm_count = 0;
+  }
+}
@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_SNAPSHOTSTORE_H_
+#define METBUILD_SRC_SNAPSHOTSTORE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CppAttributes.h"
+
+namespace MetBuild {
+
+/**
+ * @brief In-memory tiers of the SnapshotCache
+ *
+ * Serialized snapshots are held in one byte budget. The most recently used
+ * are kept as written, up to half of the budget, and older ones are
+ * compressed in memory with the fastest codec the library was built with.
+ * Once the budget is exceeded the least recently used snapshots leave the
+ * store and are handed back to the SnapshotCache, which spills them to its
+ * directory when one is set. Reading a compressed snapshot decompresses it
+ * and makes it the most recently used again
+ *
+ * The store is disabled unless a budget is set, either with setBudget() or
+ * with the METBUILD_SNAPSHOT_MEMORY environment variable, in megabytes
+ */
+class SnapshotStore {
+ public:
+  using Blob = std::shared_ptr<const std::string>;
+  using Spilled = std::vector<std::pair<std::string, Blob>>;
+
+  static void setBudget(size_t bytes);
+
+  NODISCARD static size_t budget();
+
+  NODISCARD static bool enabled();
+
+  NODISCARD static size_t size();
+
+  NODISCARD static size_t count();
+
+  NODISCARD static size_t compressedCount();
+
+  NODISCARD static Blob get(const std::string &key,
+                            Spilled *spilled = nullptr);
+
+  static void put(const std::string &key, std::string bytes,
+                  Spilled *spilled = nullptr);
+
+  static void clear();
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_SNAPSHOTSTORE_H_
@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_SPAN_H_
+#define METBUILD_SRC_SPAN_H_
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+namespace MetBuild {
+
+/**
+ * @brief Non-owning view of a contiguous run of values
+ */
+template <typename T>
+class Span {
+ public:
+  using value_type = std::remove_cv_t<T>;
+  using iterator = T *;
+
+  constexpr Span() noexcept : m_data(nullptr), m_size(0) {}
+
+  constexpr Span(T *data, size_t size) noexcept : m_data(data), m_size(size) {}
+
+  template <typename U, typename = std::enable_if_t<
+                            std::is_convertible<U (*)[], T (*)[]>::value>>
+  constexpr Span(const Span<U> &other) noexcept
+      : m_data(other.data()), m_size(other.size()) {}
+
+  constexpr T *data() const noexcept { return m_data; }
+
+  constexpr size_t size() const noexcept { return m_size; }
+
+  constexpr bool empty() const noexcept { return m_size == 0; }
+
+  constexpr T *begin() const noexcept { return m_data; }
+
+  constexpr T *end() const noexcept { return m_data + m_size; }
+
+  T &operator[](size_t index) const {
+    assert(index < m_size);
+    return m_data[index];
+  }
+
+ private:
+  T *m_data;
+  size_t m_size;
+};
+
+/**
+ * @brief Non-owning view of a row-major two dimensional field. Indexing
+ * returns a Span over one row
+ */
+template <typename T>
+class Span2d {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Span<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Span<T>;
+
+    iterator(T *row, size_t ni) : m_row(row), m_ni(ni) {}
+
+    Span<T> operator*() const { return {m_row, m_ni}; }
+
+    iterator &operator++() {
+      m_row += m_ni;
+      return *this;
+    }
+
+    bool operator==(const iterator &other) const {
+      return m_row == other.m_row;
+    }
+
+    bool operator!=(const iterator &other) const {
+      return m_row != other.m_row;
+    }
+
+   private:
+    T *m_row;
+    size_t m_ni;
+  };
+
+  constexpr Span2d() noexcept : m_data(nullptr), m_ni(0), m_nj(0) {}
+
+  constexpr Span2d(T *data, size_t ni, size_t nj) noexcept
+      : m_data(data), m_ni(ni), m_nj(nj) {}
+
+  template <typename U, typename = std::enable_if_t<
+                            std::is_convertible<U (*)[], T (*)[]>::value>>
+  constexpr Span2d(const Span2d<U> &other) noexcept
+      : m_data(other.data()), m_ni(other.ni()), m_nj(other.nj()) {}
+
+  constexpr T *data() const noexcept { return m_data; }
+
+  constexpr size_t ni() const noexcept { return m_ni; }
+
+  constexpr size_t nj() const noexcept { return m_nj; }
+
+  constexpr size_t size() const noexcept { return m_nj; }
+
+  Span<T> values() const { return {m_data, m_ni * m_nj}; }
+
+  Span<T> operator[](size_t j) const {
+    assert(j < m_nj);
+    return {m_data + j * m_ni, m_ni};
+  }
+
+  iterator begin() const { return {m_data, m_ni}; }
+
+  iterator end() const { return {m_data + m_ni * m_nj, m_ni}; }
+
+ private:
+  T *m_data;
+  size_t m_ni;
+  size_t m_nj;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_SPAN_H_
@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "SparseWeights.h"
+
+#include <algorithm>
+#include <array>
+
+#include "InterpolationKernel.h"
+#include "ThreadPool.h"
+
+using namespace MetBuild;
+
+namespace {
+//...Rows are handed to the threads in blocks large enough to amortize the
+// scheduling and small enough to balance uneven row lengths
+constexpr size_t c_block_rows = 4096;
+}  // namespace
+
+/**
+ * @brief Converts three point barycentric weights to sparse rows
+ * @param weights weights of every output cell
+ * @return sparse weights with one row per cell
+ */
+SparseWeights SparseWeights::from(const InterpolationWeights &weights) {
+  SparseWeights sparse;
+  sparse.reserve(weights.size(), 3 * weights.size());
+  for (size_t c = 0; c < weights.size(); ++c) {
+    if (!weights.valid(c)) {
+      sparse.append_row(nullptr, nullptr, 0);
+      continue;
+    }
+    const std::array<index_type, 3> index{
+        weights.index(0)[c], weights.index(1)[c], weights.index(2)[c]};
+    const std::array<weight_type, 3> weight{
+        weights.weight(0)[c], weights.weight(1)[c], weights.weight(2)[c]};
+    sparse.append_row(index.data(), weight.data(), 3);
+  }
+  return sparse;
+}
+
+void SparseWeights::reserve(size_t rows, size_t entries) {
+  m_offset.reserve(rows + 1);
+  m_index.reserve(entries);
+  m_weight.reserve(entries);
+}
+
+/**
+ * @brief Appends the weights of the next output cell
+ * @param index source indices of the row
+ * @param weight weight of each source index
+ * @param n number of entries, zero for a cell without a valid weight
+ */
+void SparseWeights::append_row(const index_type *index,
+                               const weight_type *weight, size_t n) {
+  m_index.insert(m_index.end(), index, index + n);
+  m_weight.insert(m_weight.end(), weight, weight + n);
+  m_offset.push_back(m_index.size());
+}
+
+/**
+ * @brief Applies the weights to several source fields at once, spreading
+ * blocks of rows over the global thread pool
+ * @param fields source fields, m of them
+ * @param m number of fields
+ * @param fill value used for cells without a valid weight, one per field
+ * @param out output values for every row, one pointer per field
+ */
+void SparseWeights::apply(const Kernel::SourceField *fields, size_t m,
+                          const MeteorologicalDataType *fill,
+                          MeteorologicalDataType *const *out) const {
+  const size_t n_blocks = (this->rows() + c_block_rows - 1) / c_block_rows;
+  ThreadPool::global().parallel_for(0, n_blocks, [&](size_t b) {
+    const size_t row = b * c_block_rows;
+    const size_t n = std::min(c_block_rows, this->rows() - row);
+    std::vector<MeteorologicalDataType *> block_out(m);
+    for (size_t f = 0; f < m; ++f) block_out[f] = out[f] + row;
+    Kernel::interpolate_sparse(row, n, *this, fields, m, fill,
+                               block_out.data());
+  });
+}
@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_SPARSEWEIGHTS_H_
+#define METBUILD_SRC_SPARSEWEIGHTS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "InterpolationWeights.h"
+#include "MeteorologicalData.h"
+
+namespace MetBuild {
+
+namespace Kernel {
+struct SourceField;
+}
+
+/**
+ * @brief Remapping weights stored as a compressed sparse row matrix
+ *
+ * Each row is an output cell and holds any number of source indices and
+ * weights, so schemes that are not three point barycentric, such as
+ * bilinear, k nearest neighbour or conservative remapping, share one
+ * storage and one kernel. Rows without entries are cells without a valid
+ * weight. Rows are appended in cell order
+ */
+class SparseWeights {
+ public:
+  using index_type = InterpolationWeights::index_type;
+  using weight_type = InterpolationWeights::weight_type;
+
+  SparseWeights() = default;
+
+  static SparseWeights from(const InterpolationWeights &weights);
+
+  void reserve(size_t rows, size_t entries);
+
+  void append_row(const index_type *index, const weight_type *weight,
+                  size_t n);
+
+  [[nodiscard]] size_t rows() const { return m_offset.size() - 1; }
+
+  [[nodiscard]] size_t entries() const { return m_index.size(); }
+
+  [[nodiscard]] bool valid(size_t row) const {
+    return m_offset[row + 1] > m_offset[row];
+  }
+
+  [[nodiscard]] const size_t *offset() const { return m_offset.data(); }
+
+  [[nodiscard]] const index_type *index() const { return m_index.data(); }
+
+  [[nodiscard]] const weight_type *weight() const { return m_weight.data(); }
+
+  void apply(const Kernel::SourceField *fields, size_t m,
+             const MeteorologicalDataType *fill,
+             MeteorologicalDataType *const *out) const;
+
+ private:
+  std::vector<size_t> m_offset{0};
+  std::vector<index_type> m_index;
+  std::vector<weight_type> m_weight;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_SPARSEWEIGHTS_H_
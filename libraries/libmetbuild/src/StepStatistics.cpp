@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "StepStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Logging.h"
+
+using namespace MetBuild;
+
+/**
+ * @brief Adds a partial sum with Neumaier's compensation
+ * @param partial_sum sum of a block of values
+ */
+void FieldStatistics::add(const double partial_sum) {
+  const double t = sum + partial_sum;
+  if (std::abs(sum) >= std::abs(partial_sum)) {
+    compensation += (sum - t) + partial_sum;
+  } else {
+    compensation += (partial_sum - t) + sum;
+  }
+  sum = t;
+}
+
+/**
+ * @brief Combines the statistics of another part of the same field
+ */
+void FieldStatistics::merge(const FieldStatistics &other) {
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+  this->add(other.sum);
+  compensation += other.compensation;
+  valid += other.valid;
+  invalid += other.invalid;
+}
+
+/**
+ * @brief Mean of the valid cells, NaN when there are none
+ */
+double FieldStatistics::mean() const {
+  if (valid == 0) return std::numeric_limits<double>::quiet_NaN();
+  return (sum + compensation) / static_cast<double>(valid);
+}
+
+/**
+ * @brief Fraction of the cells of the field which have no value
+ */
+double FieldStatistics::invalid_fraction() const {
+  const auto cells = valid + invalid;
+  if (cells == 0) return 0.0;
+  return static_cast<double>(invalid) / static_cast<double>(cells);
+}
+
+/**
+ * @brief Statistics of a field by name
+ * @param name field name, i.e. wind_u or mslp
+ */
+const FieldStatistics &StepStatistics::field(const std::string &name) const {
+  const auto it = std::find(names.begin(), names.end(), name);
+  if (it == names.end()) {
+    metbuild_throw_exception("No statistics for field " + name);
+  }
+  return fields[std::distance(names.begin(), it)];
+}
+
+/**
+ * @brief Combines the statistics of another part of the same step, i.e. a
+ * band of rows of the same grid
+ */
+void StepStatistics::merge(const StepStatistics &other) {
+  if (other.names != names) {
+    metbuild_throw_exception("Cannot merge statistics of different fields");
+  }
+  for (size_t k = 0; k < fields.size(); ++k) fields[k].merge(other.fields[k]);
+}
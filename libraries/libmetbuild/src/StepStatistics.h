@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_STEPSTATISTICS_H_
+#define METBUILD_SRC_STEPSTATISTICS_H_
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "Date.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Minimum, maximum and mean of the valid cells of one output field,
+ * along with the number of cells without a value
+ *
+ * The sum is accumulated with a running compensation, so the mean of a
+ * large grid keeps the precision of the values
+ */
+struct FieldStatistics {
+  double min = std::numeric_limits<double>::infinity();
+  double max = -std::numeric_limits<double>::infinity();
+  double sum = 0.0;
+  double compensation = 0.0;
+  size_t valid = 0;
+  size_t invalid = 0;
+
+  void add(double partial_sum);
+
+  void merge(const FieldStatistics &other);
+
+  NODISCARD double mean() const;
+
+  NODISCARD double invalid_fraction() const;
+};
+
+/**
+ * @brief Statistics of every field of one output time step
+ */
+struct StepStatistics {
+  MetBuild::Date time;
+  std::vector<std::string> names;
+  std::vector<FieldStatistics> fields;
+
+  NODISCARD size_t size() const { return fields.size(); }
+
+  NODISCARD const FieldStatistics &field(const std::string &name) const;
+
+  void merge(const StepStatistics &other);
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_STEPSTATISTICS_H_
@@ -0,0 +1,160 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "StructuredLocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "Logging.h"
+#include "Triangulation.h"
+
+using namespace MetBuild::Private;
+
+namespace {
+constexpr double c_tolerance = 1e-6;
+}
+
+StructuredLocator::StructuredLocator(const std::vector<double> &x,
+                                     const std::vector<double> &y, size_t ni,
+                                     size_t nj)
+    : m_ni(ni) {
+  if (!StructuredLocator::isRectilinear(x, y, ni, nj)) {
+    metbuild_throw_exception(
+        "The source grid is not rectilinear and cannot use the structured "
+        "locator");
+  }
+
+  std::vector<double> xaxis(x.begin(), x.begin() + ni);
+  std::vector<double> yaxis(nj);
+  for (size_t j = 0; j < nj; ++j) {
+    yaxis[j] = y[j * ni];
+  }
+  m_x = StructuredLocator::make_axis(xaxis);
+  m_y = StructuredLocator::make_axis(yaxis);
+}
+
+bool StructuredLocator::isRectilinear(const std::vector<double> &x,
+                                      const std::vector<double> &y, size_t ni,
+                                      size_t nj) {
+  if (ni < 2 || nj < 2 || x.size() != ni * nj || y.size() != ni * nj) {
+    return false;
+  }
+  for (size_t j = 0; j < nj; ++j) {
+    for (size_t i = 0; i < ni; ++i) {
+      const auto k = j * ni + i;
+      if (std::abs(x[k] - x[i]) > c_tolerance ||
+          std::abs(y[k] - y[j * ni]) > c_tolerance) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+StructuredLocator::Axis StructuredLocator::make_axis(
+    const std::vector<double> &values) {
+  Axis axis;
+  axis.index.resize(values.size());
+  std::iota(axis.index.begin(), axis.index.end(), 0);
+  std::sort(axis.index.begin(), axis.index.end(),
+            [&](size_t a, size_t b) { return values[a] < values[b]; });
+  axis.position.reserve(values.size());
+  for (const auto &idx : axis.index) {
+    axis.position.push_back(values[idx]);
+  }
+
+  axis.step = (axis.position.back() - axis.position.front()) /
+              static_cast<double>(axis.position.size() - 1);
+  axis.uniform = axis.step > 0.0;
+  for (size_t k = 1; k < axis.position.size() && axis.uniform; ++k) {
+    const auto d = axis.position[k] - axis.position[k - 1];
+    if (std::abs(d - axis.step) > c_tolerance * axis.step) {
+      axis.uniform = false;
+    }
+  }
+  return axis;
+}
+
+bool StructuredLocator::Axis::locate(double v, size_t &cell,
+                                     double &fraction) const {
+  const auto n = position.size();
+  if (v < position.front() || v > position.back()) return false;
+
+  if (uniform) {
+    cell = std::min(static_cast<size_t>((v - position.front()) / step), n - 2);
+    //...Guard against the rounding of the analytic estimate
+    if (v < position[cell] && cell > 0) cell--;
+    if (v > position[cell + 1] && cell < n - 2) cell++;
+  } else {
+    auto it = std::upper_bound(position.begin(), position.end(), v);
+    cell = std::min(
+        static_cast<size_t>(std::max<std::ptrdiff_t>(
+            std::distance(position.begin(), it) - 1, 0)),
+        n - 2);
+  }
+
+  const auto width = position[cell + 1] - position[cell];
+  fraction = width > 0.0 ? (v - position[cell]) / width : 0.0;
+  fraction = std::min(std::max(fraction, 0.0), 1.0);
+  return true;
+}
+
+std::unique_ptr<PointLocator> StructuredLocator::clone() const {
+  return std::make_unique<StructuredLocator>(*this);
+}
+
+MetBuild::InterpolationWeight StructuredLocator::getInterpolationFactors(
+    double x, double y) const {
+  size_t ci = 0;
+  size_t cj = 0;
+  double fx = 0.0;
+  double fy = 0.0;
+  if (!m_x.locate(x, ci, fx) || !m_y.locate(y, cj, fy)) {
+    return {{Triangulation::invalid_point(), Triangulation::invalid_point(),
+             Triangulation::invalid_point()},
+            {0.0, 0.0, 0.0}};
+  }
+
+  const auto i0 = m_x.index[ci];
+  const auto i1 = m_x.index[ci + 1];
+  const auto j0 = m_y.index[cj];
+  const auto j1 = m_y.index[cj + 1];
+
+  const auto n00 = j0 * m_ni + i0;
+  const auto n10 = j0 * m_ni + i1;
+  const auto n01 = j1 * m_ni + i0;
+  const auto n11 = j1 * m_ni + i1;
+
+  if (fx >= fy) {
+    return {{n00, n10, n11}, {1.0 - fx, fx - fy, fy}};
+  } else {
+    return {{n00, n11, n01}, {1.0 - fy, fx, fy - fx}};
+  }
+}
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_STRUCTUREDLOCATOR_H_
+#define METBUILD_SRC_STRUCTUREDLOCATOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "PointLocator.h"
+
+namespace MetBuild::Private {
+
+/**
+ * @brief Analytic point locator for rectilinear source grids
+ *
+ * The source points must form a tensor product of a longitude axis and a
+ * latitude axis, stored with the i index varying fastest. Each cell is split
+ * along its diagonal into two triangles and the barycentric weights are
+ * computed directly from the axis positions
+ */
+class StructuredLocator : public PointLocator {
+ public:
+  StructuredLocator(const std::vector<double> &x, const std::vector<double> &y,
+                    size_t ni, size_t nj);
+
+  static bool isRectilinear(const std::vector<double> &x,
+                            const std::vector<double> &y, size_t ni,
+                            size_t nj);
+
+  using PointLocator::getInterpolationFactors;
+
+  [[nodiscard]] std::unique_ptr<PointLocator> clone() const override;
+
+  [[nodiscard]] MetBuild::InterpolationWeight getInterpolationFactors(
+      double x, double y) const override;
+
+ private:
+  struct Axis {
+    std::vector<double> position;
+    std::vector<size_t> index;
+    double step = 0.0;
+    bool uniform = false;
+
+    [[nodiscard]] bool locate(double v, size_t &cell, double &fraction) const;
+  };
+
+  static Axis make_axis(const std::vector<double> &values);
+
+  size_t m_ni;
+  Axis m_x;
+  Axis m_y;
+};
+
+}  // namespace MetBuild::Private
+
+#endif  // METBUILD_SRC_STRUCTUREDLOCATOR_H_
@@ -0,0 +1,192 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "TemporalEnvelope.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Logging.h"
+#include "ThreadPool.h"
+
+using namespace MetBuild;
+
+namespace {
+//...Rows handed to a thread at once when folding in a record
+constexpr size_t c_row_grain = 16;
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param ni number of columns of the output grid
+ * @param nj number of rows of the output grid
+ * @param parameters parameters of each record, three for wind and pressure
+ * or one for a scalar
+ * @param origin date the times of the extremes are counted from
+ * @param time_step seconds between records, the period each scalar record
+ * is accumulated over
+ */
+TemporalEnvelope::TemporalEnvelope(const size_t ni, const size_t nj,
+                                   const unsigned parameters,
+                                   const Date &origin,
+                                   const unsigned time_step)
+    : m_ni(ni),
+      m_nj(nj),
+      m_parameters(parameters),
+      m_origin(origin),
+      m_step_hours(static_cast<double>(time_step) / 3600.0),
+      m_records(0) {
+  if (parameters != 1 && parameters != 3) {
+    metbuild_throw_exception("Envelope records have one or three parameters");
+  }
+  this->reset();
+}
+
+/**
+ * @brief Clears the records folded in so far
+ */
+void TemporalEnvelope::reset() {
+  const size_t n = m_ni * m_nj;
+  m_records = 0;
+  m_count.assign(n, 0);
+  m_max.assign(n, -std::numeric_limits<double>::infinity());
+  m_min.assign(n, std::numeric_limits<double>::infinity());
+  m_time_max.assign(n, 0.0);
+  m_time_min.assign(n, 0.0);
+  m_sum.assign(m_parameters == 1 ? n : 0, 0.0);
+}
+
+/**
+ * @brief Folds in a wind and pressure record
+ * @param date time of the record
+ * @param record wind components and pressure
+ */
+void TemporalEnvelope::add(
+    const Date &date,
+    const MeteorologicalData<3, MeteorologicalDataType> &record) {
+  if (m_parameters != 3 || record.ni() != m_ni || record.nj() != m_nj) {
+    metbuild_throw_exception("The record does not match the envelope");
+  }
+  this->accumulate(date,
+                   {record.parameter(0).data(), record.parameter(1).data(),
+                    record.parameter(2).data()});
+}
+
+/**
+ * @brief Folds in a scalar record
+ * @param date time of the record
+ * @param record values of the record
+ */
+void TemporalEnvelope::add(
+    const Date &date,
+    const MeteorologicalData<1, MeteorologicalDataType> &record) {
+  if (m_parameters != 1 || record.ni() != m_ni || record.nj() != m_nj) {
+    metbuild_throw_exception("The record does not match the envelope");
+  }
+  this->accumulate(date, {record.parameter(0).data()});
+}
+
+void TemporalEnvelope::accumulate(
+    const Date &date,
+    const std::vector<const MeteorologicalDataType *> &planes) {
+  constexpr auto flag = MeteorologicalData<1>::flag_value();
+  const double minutes =
+      static_cast<double>(date.toSeconds() - m_origin.toSeconds()) / 60.0;
+  ThreadPool::global().parallel_for(
+      0, m_nj,
+      [&](const size_t j) {
+        for (size_t c = j * m_ni; c < (j + 1) * m_ni; ++c) {
+          bool valid = true;
+          for (unsigned p = 0; p < m_parameters; ++p) {
+            valid = valid && planes[p][c] != flag;
+          }
+          if (!valid) continue;
+          m_count[c]++;
+
+          //...The first record wins ties so the time is the onset of the peak
+          const double high =
+              m_parameters == 3 ? std::hypot(static_cast<double>(planes[0][c]),
+                                             static_cast<double>(planes[1][c]))
+                                : static_cast<double>(planes[0][c]);
+          const double low = static_cast<double>(planes[m_parameters - 1][c]);
+          if (high > m_max[c]) {
+            m_max[c] = high;
+            m_time_max[c] = minutes;
+          }
+          if (low < m_min[c]) {
+            m_min[c] = low;
+            m_time_min[c] = minutes;
+          }
+          if (m_parameters == 1) m_sum[c] += low * m_step_hours;
+        }
+      },
+      c_row_grain);
+  m_records++;
+}
+
+/**
+ * @brief One field of the envelope. Times are in minutes since the origin
+ * and cells no record has a value for are set to the flag value
+ * @param field field of the envelope. The accumulated total is only kept
+ * for scalar records
+ * @param out values of the grid in row-major order
+ */
+void TemporalEnvelope::get(const FIELD field,
+                           const Span<MeteorologicalDataType> out) const {
+  if (out.size() != m_ni * m_nj) {
+    metbuild_throw_exception("The output does not match the envelope grid");
+  }
+  if (field == ACCUMULATED && m_parameters != 1) {
+    metbuild_throw_exception("Only scalar envelopes are accumulated");
+  }
+  const std::vector<double> *values = nullptr;
+  switch (field) {
+    case MAXIMUM:
+      values = &m_max;
+      break;
+    case TIME_OF_MAXIMUM:
+      values = &m_time_max;
+      break;
+    case MINIMUM:
+      values = &m_min;
+      break;
+    case TIME_OF_MINIMUM:
+      values = &m_time_min;
+      break;
+    case ACCUMULATED:
+    default:
+      values = &m_sum;
+      break;
+  }
+  for (size_t c = 0; c < out.size(); ++c) {
+    out[c] = m_count[c] == 0
+                 ? MeteorologicalData<1>::flag_value()
+                 : static_cast<MeteorologicalDataType>((*values)[c]);
+  }
+}
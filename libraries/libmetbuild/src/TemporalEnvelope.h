@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_TEMPORALENVELOPE_H_
+#define METBUILD_SRC_TEMPORALENVELOPE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "Date.h"
+#include "MetBuild_Global.h"
+#include "MeteorologicalData.h"
+#include "Span.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Reduces the records of an output on one grid to their per-cell
+ * extremes and totals, one record at a time
+ *
+ * For wind and pressure records the maximum and its time are taken on the
+ * wind speed and the minimum and its time on the pressure. For scalar
+ * records both are taken on the value, which is also accumulated over the
+ * time step so that a rate per hour, such as rainfall in mm/hr, gives the
+ * event total. Cells where a record has no value, any of its parameters at
+ * the flag value, do not count that record
+ */
+class TemporalEnvelope {
+ public:
+  enum FIELD {
+    MAXIMUM,
+    TIME_OF_MAXIMUM,
+    MINIMUM,
+    TIME_OF_MINIMUM,
+    ACCUMULATED
+  };
+
+  METBUILD_EXPORT TemporalEnvelope(size_t ni, size_t nj, unsigned parameters,
+                                   const MetBuild::Date &origin,
+                                   unsigned time_step);
+
+  void METBUILD_EXPORT reset();
+
+  void METBUILD_EXPORT
+  add(const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+          &record);
+
+  void METBUILD_EXPORT
+  add(const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+          &record);
+
+  NODISCARD size_t METBUILD_EXPORT records() const { return m_records; }
+
+  NODISCARD unsigned METBUILD_EXPORT parameters() const {
+    return m_parameters;
+  }
+
+  NODISCARD MetBuild::Date METBUILD_EXPORT origin() const { return m_origin; }
+
+  void METBUILD_EXPORT get(FIELD field,
+                           MetBuild::Span<MeteorologicalDataType> out) const;
+
+ private:
+  void accumulate(const MetBuild::Date &date,
+                  const std::vector<const MeteorologicalDataType *> &planes);
+
+  const size_t m_ni;
+  const size_t m_nj;
+  const unsigned m_parameters;
+  const MetBuild::Date m_origin;
+  const double m_step_hours;
+  size_t m_records;
+  std::vector<uint32_t> m_count;
+  std::vector<double> m_max;
+  std::vector<double> m_min;
+  std::vector<double> m_time_max;
+  std::vector<double> m_time_min;
+  std::vector<double> m_sum;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_TEMPORALENVELOPE_H_
@@ -0,0 +1,208 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "ThreadPool.h"
+
+#include <cstdlib>
+#include <string>
+
+#include "Logging.h"
+#include "ResourceLimits.h"
+
+using namespace MetBuild;
+
+namespace {
+size_t environment_thread_count() {
+  const char *env = std::getenv("METBUILD_NUM_THREADS");
+  if (env != nullptr) {
+    try {
+      const auto n = std::stoul(env);
+      if (n > 0) return n;
+    } catch (const std::exception &) {
+    }
+  }
+  return ResourceLimits::processors();
+}
+
+std::atomic<size_t> s_default_thread_count(environment_thread_count());
+
+//...Identifies the pool and queue of the worker running on this thread, if
+// any, so that tasks it submits stay on its own queue
+thread_local const ThreadPool *t_pool = nullptr;
+thread_local size_t t_queue = 0;
+}  // namespace
+
+ThreadPool::ThreadPool(size_t nthreads) : m_pending(0), m_stop(false) {
+  //...The calling thread always takes part in the work, so a pool of n
+  // threads starts n - 1 workers
+  for (size_t i = 1; i < nthreads; ++i) {
+    m_queues.push_back(std::make_unique<WorkerQueue>());
+  }
+  for (size_t i = 0; i < m_queues.size(); ++i) {
+    m_threads.emplace_back(&ThreadPool::worker, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_condition.notify_all();
+  for (auto &t : m_threads) {
+    t.join();
+  }
+}
+
+/**
+ * @brief Returns the process-wide pool, created on first use with
+ * defaultThreadCount() threads
+ */
+ThreadPool &ThreadPool::global() {
+  static ThreadPool pool = []() -> ThreadPool {
+    Logging::log("Starting " + std::to_string(defaultThreadCount()) +
+                 " threads, " + ResourceLimits::describe());
+    return ThreadPool(defaultThreadCount());
+  }();
+  return pool;
+}
+
+/**
+ * @brief Sets the number of threads used by the global pool. This must be
+ * called before the pool is first used. The default is taken from the
+ * METBUILD_NUM_THREADS environment variable or the number of processors
+ * available to the process
+ * @param nthreads number of threads, including the calling thread
+ */
+void ThreadPool::setDefaultThreadCount(size_t nthreads) {
+  s_default_thread_count = std::max<size_t>(nthreads, 1);
+}
+
+size_t ThreadPool::defaultThreadCount() { return s_default_thread_count; }
+
+size_t ThreadPool::size() const { return m_threads.size() + 1; }
+
+void ThreadPool::submit(std::function<void()> task) {
+  //...Counted under the pool lock before the task is queued so a worker
+  // about to sleep cannot miss it
+  if (t_pool == this) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_pending++;
+    }
+    auto &queue = *m_queues[t_queue];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  } else {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending++;
+    m_tasks.push_back(std::move(task));
+  }
+  m_condition.notify_one();
+}
+
+void ThreadPool::run_loop(LoopState &state) {
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.active++;
+  }
+  try {
+    while (true) {
+      const size_t start = state.next.fetch_add(state.grain);
+      if (start >= state.end) break;
+      const size_t stop = std::min(start + state.grain, state.end);
+      for (size_t i = start; i < stop; ++i) {
+        state.body(i);
+      }
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (!state.error) state.error = std::current_exception();
+    state.next = state.end;
+  }
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.active--;
+  }
+  state.done.notify_all();
+}
+
+/**
+ * @brief Finds the next task for a worker: the newest task of its own
+ * queue, then the oldest task submitted from outside the pool, then the
+ * oldest task of another worker
+ * @param index queue of the worker
+ * @param task set to the task found
+ * @return true if a task was found
+ */
+bool ThreadPool::take(size_t index, std::function<void()> &task) {
+  {
+    auto &own = *m_queues[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_tasks.empty()) {
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+      return true;
+    }
+  }
+  for (size_t k = 1; k < m_queues.size(); ++k) {
+    auto &victim = *m_queues[(index + k) % m_queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::worker(size_t index) {
+  t_pool = this;
+  t_queue = index;
+  std::function<void()> task;
+  while (true) {
+    if (this->take(index, task)) {
+      m_pending--;
+      task();
+      task = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]() { return m_stop || m_pending > 0; });
+    if (m_stop && m_pending == 0) return;
+  }
+}
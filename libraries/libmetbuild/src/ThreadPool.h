@@ -0,0 +1,177 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_THREADPOOL_H_
+#define METBUILD_SRC_THREADPOOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "CppAttributes.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Fixed size pool of worker threads shared by the library
+ *
+ * Every parallel stage of the library (decoding, weight generation,
+ * interpolation and output) runs on the one global pool, so the process
+ * never uses more threads than its budget however many stages are active.
+ *
+ * Work is submitted as loops through parallel_for or as single tasks through
+ * submit and async. The calling thread also works on a loop, so nested loops
+ * and loops issued from inside a worker cannot deadlock waiting for a free
+ * thread.
+ *
+ * Each worker keeps its own queue. Tasks submitted from a worker go to the
+ * back of its queue and are taken back newest first, while idle workers
+ * steal the oldest tasks of the others. Tasks submitted from outside the
+ * pool are shared and run in the order they were submitted
+ */
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t nthreads);
+
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  static ThreadPool &global();
+
+  static void setDefaultThreadCount(size_t nthreads);
+
+  NODISCARD static size_t defaultThreadCount();
+
+  NODISCARD size_t size() const;
+
+  void submit(std::function<void()> task);
+
+  /**
+   * @brief Runs f on the pool
+   *
+   * With no workers f is run by the caller before returning, so a pool of one
+   * thread never runs work in the background
+   *
+   * @param f function to run
+   * @return future holding the result of f or the exception it threw
+   */
+  template <typename F>
+  std::future<std::invoke_result_t<std::decay_t<F>>> async(F &&f) {
+    using Result = std::invoke_result_t<std::decay_t<F>>;
+    auto task = std::make_shared<std::packaged_task<Result()>>(
+        std::forward<F>(f));
+    auto future = task->get_future();
+    if (m_threads.empty()) {
+      (*task)();
+    } else {
+      this->submit([task]() { (*task)(); });
+    }
+    return future;
+  }
+
+  /**
+   * @brief Runs f(index) for every index in [begin, end)
+   * @param begin first index
+   * @param end one past the last index
+   * @param f function to run
+   * @param grain number of consecutive indices handed out at once
+   */
+  template <typename F>
+  void parallel_for(size_t begin, size_t end, F &&f, size_t grain = 1) {
+    if (end <= begin) return;
+    grain = std::max<size_t>(grain, 1);
+    const size_t nchunks = (end - begin + grain - 1) / grain;
+    if (m_threads.empty() || nchunks == 1) {
+      for (size_t i = begin; i < end; ++i) f(i);
+      return;
+    }
+
+    auto state = std::make_shared<LoopState>();
+    state->next = begin;
+    state->end = end;
+    state->grain = grain;
+    state->body = [&f](size_t i) { f(i); };
+
+    const size_t helpers = std::min(m_threads.size(), nchunks - 1);
+    for (size_t h = 0; h < helpers; ++h) {
+      this->submit([state]() { ThreadPool::run_loop(*state); });
+    }
+    ThreadPool::run_loop(*state);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&]() { return state->active == 0; });
+    if (state->error) std::rethrow_exception(state->error);
+  }
+
+ private:
+  struct LoopState {
+    std::atomic<size_t> next{0};
+    size_t end = 0;
+    size_t grain = 1;
+    std::function<void(size_t)> body;
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t active = 0;
+    std::exception_ptr error;
+  };
+
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  static void run_loop(LoopState &state);
+
+  bool take(size_t index, std::function<void()> &task);
+
+  void worker(size_t index);
+
+  std::vector<std::thread> m_threads;
+  std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+  std::deque<std::function<void()>> m_tasks;
+  std::atomic<size_t> m_pending;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_stop;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_THREADPOOL_H_
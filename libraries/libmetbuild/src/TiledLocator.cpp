@@ -0,0 +1,261 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "TiledLocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "CroppedLocator.h"
+#include "Logging.h"
+#include "ThreadPool.h"
+#include "Triangulation.h"
+#include "TriangulationPrivate.h"
+
+using namespace MetBuild::Private;
+
+namespace {
+//...Tiles are widened by the larger of a number of average point spacings
+// and a fraction of the tile size
+constexpr double c_margin_spacings = 8.0;
+constexpr double c_margin_fraction = 0.1;
+
+//...METBUILD_TRIANGULATION_TILE_POINTS sets the number of source points per
+// tile, zero triangulating every source in one piece
+size_t tilePointsDefault() {
+  const char *env = std::getenv("METBUILD_TRIANGULATION_TILE_POINTS");
+  return env ? std::strtoull(env, nullptr, 10) : 500000;
+}
+std::atomic<size_t> s_tile_points(tilePointsDefault());
+
+/**
+ * @brief Position of every bounding region point in the source arrays
+ * @param x source longitudes
+ * @param y source latitudes
+ * @param bounding_region boundary of the source
+ * @return indices, empty if a boundary point is not a source point
+ */
+std::vector<size_t> boundary_index(
+    const std::vector<double> &x, const std::vector<double> &y,
+    const std::vector<MetBuild::Point> &bounding_region) {
+  std::map<std::pair<double, double>, size_t> lookup;
+  for (const auto &p : bounding_region) {
+    lookup.emplace(std::make_pair(p.x(), p.y()),
+                   MetBuild::Triangulation::invalid_point());
+  }
+  for (size_t k = 0; k < x.size(); ++k) {
+    auto it = lookup.find(std::make_pair(x[k], y[k]));
+    if (it != lookup.end()) it->second = k;
+  }
+
+  std::vector<size_t> index;
+  index.reserve(lookup.size());
+  for (const auto &l : lookup) {
+    if (l.second == MetBuild::Triangulation::invalid_point()) return {};
+    index.push_back(l.second);
+  }
+  return index;
+}
+}  // namespace
+
+TiledLocator::TiledLocator(double xmin, double ymin, double dx, double dy,
+                           size_t nx, size_t ny)
+    : m_xmin(xmin),
+      m_ymin(ymin),
+      m_dx(dx),
+      m_dy(dy),
+      m_nx(nx),
+      m_ny(ny),
+      m_tiles(nx * ny) {}
+
+TiledLocator::TiledLocator(const TiledLocator &other)
+    : PointLocator(other),
+      m_xmin(other.m_xmin),
+      m_ymin(other.m_ymin),
+      m_dx(other.m_dx),
+      m_dy(other.m_dy),
+      m_nx(other.m_nx),
+      m_ny(other.m_ny) {
+  m_tiles.reserve(other.m_tiles.size());
+  for (const auto &t : other.m_tiles) {
+    m_tiles.push_back(t->clone());
+  }
+}
+
+/**
+ * @brief Generates the locator of a scattered source, split into tiles when
+ * it holds more than tilePoints() points
+ *
+ * Sources which are too small to split, or whose bounding region is not
+ * made of source points, are triangulated in one piece
+ *
+ * @param x source longitudes
+ * @param y source latitudes
+ * @param bounding_region boundary of the source
+ * @return locator object
+ */
+std::unique_ptr<PointLocator> TiledLocator::create(
+    const std::vector<double> &x, const std::vector<double> &y,
+    const std::vector<MetBuild::Point> &bounding_region) {
+  const size_t n = x.size();
+  const size_t per_tile = tilePoints();
+  if (per_tile == 0 || n <= per_tile || y.size() != n) {
+    return std::make_unique<TriangulationPrivate>(x, y, bounding_region);
+  }
+
+  const auto [x0, x1] = std::minmax_element(x.begin(), x.end());
+  const auto [y0, y1] = std::minmax_element(y.begin(), y.end());
+  const double width = *x1 - *x0;
+  const double height = *y1 - *y0;
+  auto boundary = boundary_index(x, y, bounding_region);
+  if (width <= 0.0 || height <= 0.0 || boundary.empty()) {
+    return std::make_unique<TriangulationPrivate>(x, y, bounding_region);
+  }
+
+  const size_t count = (n + per_tile - 1) / per_tile;
+  const auto nx = std::max<size_t>(
+      1, static_cast<size_t>(std::lround(
+             std::sqrt(static_cast<double>(count) * width / height))));
+  const size_t ny = (count + nx - 1) / nx;
+  const double dx = width / static_cast<double>(nx);
+  const double dy = height / static_cast<double>(ny);
+  const double spacing = std::sqrt(width * height / static_cast<double>(n));
+  const double margin = std::max(c_margin_spacings * spacing,
+                                 c_margin_fraction * std::min(dx, dy));
+
+  //...Every point goes to each tile whose widened box holds it
+  auto range = [](double v, double origin, double step, size_t count) {
+    const double f = std::floor((v - origin) / step);
+    if (f <= 0.0) return size_t(0);
+    return std::min(static_cast<size_t>(f), count - 1);
+  };
+  std::vector<std::vector<size_t>> subsets(nx * ny);
+  for (size_t k = 0; k < n; ++k) {
+    const auto i0 = range(x[k] - margin, *x0, dx, nx);
+    const auto i1 = range(x[k] + margin, *x0, dx, nx);
+    const auto j0 = range(y[k] - margin, *y0, dy, ny);
+    const auto j1 = range(y[k] + margin, *y0, dy, ny);
+    for (size_t j = j0; j <= j1; ++j) {
+      for (size_t i = i0; i <= i1; ++i) {
+        subsets[j * nx + i].push_back(k);
+      }
+    }
+  }
+
+  Logging::debug("Triangulating " + std::to_string(n) + " source points in " +
+                 std::to_string(nx * ny) + " tiles");
+
+  auto locator = std::unique_ptr<TiledLocator>(
+      new TiledLocator(*x0, *y0, dx, dy, nx, ny));
+  ThreadPool::global().parallel_for(0, subsets.size(), [&](const size_t t) {
+    auto &index = subsets[t];
+    index.insert(index.end(), boundary.begin(), boundary.end());
+    std::sort(index.begin(), index.end());
+    index.erase(std::unique(index.begin(), index.end()), index.end());
+
+    std::vector<MetBuild::Point> points;
+    points.reserve(index.size());
+    for (const auto k : index) points.emplace_back(x[k], y[k]);
+    locator->m_tiles[t] = std::make_unique<CroppedLocator>(
+        std::make_unique<TriangulationPrivate>(std::move(points),
+                                               bounding_region),
+        std::move(index));
+  });
+  return locator;
+}
+
+std::unique_ptr<PointLocator> TiledLocator::clone() const {
+  return std::make_unique<TiledLocator>(*this);
+}
+
+/**
+ * @brief Index of the tile owning a point. Points outside the tile grid
+ * belong to the nearest tile
+ * @param x longitude
+ * @param y latitude
+ * @return tile index
+ */
+size_t TiledLocator::owner(double x, double y) const {
+  auto cell = [](double v, double origin, double step, size_t count) {
+    const double f = (v - origin) / step;
+    if (!(f > 0.0)) return size_t(0);
+    if (f >= static_cast<double>(count)) return count - 1;
+    return static_cast<size_t>(f);
+  };
+  return cell(y, m_ymin, m_dy, m_ny) * m_nx + cell(x, m_xmin, m_dx, m_nx);
+}
+
+MetBuild::InterpolationWeight TiledLocator::getInterpolationFactors(
+    double x, double y) const {
+  return m_tiles[this->owner(x, y)]->getInterpolationFactors(x, y);
+}
+
+/**
+ * @brief Locates a sequence of points, handing each run of consecutive
+ * points in the same tile to that tile together
+ * @param points points to locate
+ * @param weights output weights, one per point
+ */
+void TiledLocator::getInterpolationFactors(
+    const std::vector<MetBuild::Point> &points,
+    std::vector<MetBuild::InterpolationWeight> &weights) const {
+  weights.resize(points.size());
+  std::vector<MetBuild::Point> run;
+  std::vector<MetBuild::InterpolationWeight> run_weights;
+  size_t begin = 0;
+  while (begin < points.size()) {
+    const auto tile = this->owner(points[begin].x(), points[begin].y());
+    size_t end = begin + 1;
+    while (end < points.size() &&
+           this->owner(points[end].x(), points[end].y()) == tile) {
+      ++end;
+    }
+    run.assign(points.begin() + static_cast<std::ptrdiff_t>(begin),
+               points.begin() + static_cast<std::ptrdiff_t>(end));
+    m_tiles[tile]->getInterpolationFactors(run, run_weights);
+    std::copy(run_weights.begin(), run_weights.end(),
+              weights.begin() + static_cast<std::ptrdiff_t>(begin));
+    begin = end;
+  }
+}
+
+/**
+ * @brief Sets the number of source points per tile of the triangulations
+ * built from here on. Sources with fewer points, or a value of zero, build
+ * a single triangulation. The default is taken from the
+ * METBUILD_TRIANGULATION_TILE_POINTS environment variable
+ * @param value points per tile
+ */
+void TiledLocator::setTilePoints(size_t value) { s_tile_points = value; }
+
+size_t TiledLocator::tilePoints() { return s_tile_points; }
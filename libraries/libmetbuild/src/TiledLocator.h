@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_TILEDLOCATOR_H_
+#define METBUILD_SRC_TILEDLOCATOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "Point.h"
+#include "PointLocator.h"
+
+namespace MetBuild::Private {
+
+/**
+ * @brief Locator for very large scattered sources, built as a grid of
+ * overlapping tiles which are triangulated in parallel
+ *
+ * Each tile triangulates the source points inside it, widened by a margin,
+ * together with the whole bounding region so that the domain is trimmed as
+ * it is in a single triangulation. Points are located in the tile owning
+ * them, where the margin keeps the triangles the same as those of the full
+ * triangulation away from the tile edges
+ */
+class TiledLocator : public PointLocator {
+ public:
+  [[nodiscard]] static std::unique_ptr<PointLocator> create(
+      const std::vector<double> &x, const std::vector<double> &y,
+      const std::vector<MetBuild::Point> &bounding_region);
+
+  TiledLocator(const TiledLocator &other);
+
+  [[nodiscard]] std::unique_ptr<PointLocator> clone() const override;
+
+  [[nodiscard]] MetBuild::InterpolationWeight getInterpolationFactors(
+      double x, double y) const override;
+
+  void getInterpolationFactors(
+      const std::vector<MetBuild::Point> &points,
+      std::vector<MetBuild::InterpolationWeight> &weights) const override;
+
+  static void setTilePoints(size_t value);
+
+  [[nodiscard]] static size_t tilePoints();
+
+ private:
+  TiledLocator(double xmin, double ymin, double dx, double dy, size_t nx,
+               size_t ny);
+
+  [[nodiscard]] size_t owner(double x, double y) const;
+
+  double m_xmin;
+  double m_ymin;
+  double m_dx;
+  double m_dy;
+  size_t m_nx;
+  size_t m_ny;
+  std::vector<std::unique_ptr<PointLocator>> m_tiles;
+};
+
+}  // namespace MetBuild::Private
+
+#endif  // METBUILD_SRC_TILEDLOCATOR_H_
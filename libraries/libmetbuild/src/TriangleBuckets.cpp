@@ -0,0 +1,174 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "TriangleBuckets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "Logging.h"
+
+using namespace MetBuild::Private;
+
+namespace {
+//...Points this far outside a triangle, relative to its area, still count as
+// inside so that points on shared edges are never lost to rounding
+constexpr double c_edge_tolerance = 1e-12;
+
+size_t clamp_bucket(double position, size_t n) {
+  if (position <= 0.0) return 0;
+  return std::min(static_cast<size_t>(position), n - 1);
+}
+}  // namespace
+
+/**
+ * @brief Bins the bounding boxes of a set of triangles into buckets
+ *
+ * The grid covers the bounding box of the triangles with roughly one bucket
+ * per triangle, shaped to the aspect ratio of the box
+ *
+ * @param triangles triangles with the source index and position of each
+ * vertex
+ */
+TriangleBuckets::TriangleBuckets(std::vector<Triangle> triangles)
+    : m_triangles(std::move(triangles)) {
+  if (m_triangles.size() >= std::numeric_limits<uint32_t>::max()) {
+    metbuild_throw_exception("Too many triangles for the bucket grid");
+  }
+  if (m_triangles.empty()) return;
+
+  double xmin = std::numeric_limits<double>::max();
+  double ymin = std::numeric_limits<double>::max();
+  double xmax = std::numeric_limits<double>::lowest();
+  double ymax = std::numeric_limits<double>::lowest();
+  for (const auto &t : m_triangles) {
+    for (size_t k = 0; k < 3; ++k) {
+      xmin = std::min(xmin, t.x[k]);
+      xmax = std::max(xmax, t.x[k]);
+      ymin = std::min(ymin, t.y[k]);
+      ymax = std::max(ymax, t.y[k]);
+    }
+  }
+
+  const double width = std::max(xmax - xmin, 1e-12);
+  const double height = std::max(ymax - ymin, 1e-12);
+  const auto n = static_cast<double>(m_triangles.size());
+  m_nx = std::max<size_t>(
+      1, static_cast<size_t>(std::ceil(std::sqrt(n * width / height))));
+  m_ny = std::max<size_t>(1, static_cast<size_t>(std::ceil(n / m_nx)));
+  m_x0 = xmin;
+  m_y0 = ymin;
+  m_dx = width / static_cast<double>(m_nx);
+  m_dy = height / static_cast<double>(m_ny);
+
+  //...Two passes over the triangles, counting and then filling, give a
+  // compact list of members per bucket
+  const auto range = [&](const Triangle &t, size_t &i0, size_t &i1,
+                         size_t &j0, size_t &j1) {
+    const auto [x_lo, x_hi] = std::minmax({t.x[0], t.x[1], t.x[2]});
+    const auto [y_lo, y_hi] = std::minmax({t.y[0], t.y[1], t.y[2]});
+    i0 = clamp_bucket((x_lo - m_x0) / m_dx, m_nx);
+    i1 = clamp_bucket((x_hi - m_x0) / m_dx, m_nx);
+    j0 = clamp_bucket((y_lo - m_y0) / m_dy, m_ny);
+    j1 = clamp_bucket((y_hi - m_y0) / m_dy, m_ny);
+  };
+
+  m_start.assign(m_nx * m_ny + 1, 0);
+  for (const auto &t : m_triangles) {
+    size_t i0, i1, j0, j1;
+    range(t, i0, i1, j0, j1);
+    for (size_t j = j0; j <= j1; ++j) {
+      for (size_t i = i0; i <= i1; ++i) {
+        m_start[j * m_nx + i + 1]++;
+      }
+    }
+  }
+  for (size_t b = 1; b < m_start.size(); ++b) {
+    m_start[b] += m_start[b - 1];
+  }
+
+  m_members.resize(m_start.back());
+  std::vector<uint32_t> fill(m_start.begin(), m_start.end() - 1);
+  for (uint32_t k = 0; k < m_triangles.size(); ++k) {
+    size_t i0, i1, j0, j1;
+    range(m_triangles[k], i0, i1, j0, j1);
+    for (size_t j = j0; j <= j1; ++j) {
+      for (size_t i = i0; i <= i1; ++i) {
+        m_members[fill[j * m_nx + i]++] = k;
+      }
+    }
+  }
+  m_memory.set(m_triangles.capacity() * sizeof(m_triangles[0]) +
+               m_start.capacity() * sizeof(m_start[0]) +
+               m_members.capacity() * sizeof(m_members[0]));
+}
+
+/**
+ * @brief Generates the barycentric weights of the triangle holding a point
+ * @param x point longitude
+ * @param y point latitude
+ * @return weights, invalid when no triangle holds the point
+ */
+MetBuild::InterpolationWeight TriangleBuckets::locate(double x,
+                                                      double y) const {
+  constexpr auto invalid = std::numeric_limits<size_t>::max();
+  const MetBuild::InterpolationWeight outside{{invalid, invalid, invalid},
+                                              {0.0, 0.0, 0.0}};
+  if (m_triangles.empty()) return outside;
+
+  const double px = (x - m_x0) / m_dx;
+  const double py = (y - m_y0) / m_dy;
+  const double slack = 1e-9;
+  if (px < -slack || py < -slack || px > m_nx + slack || py > m_ny + slack) {
+    return outside;
+  }
+
+  const auto bucket = clamp_bucket(py, m_ny) * m_nx + clamp_bucket(px, m_nx);
+  for (auto m = m_start[bucket]; m < m_start[bucket + 1]; ++m) {
+    const auto &t = m_triangles[m_members[m]];
+    const double area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) -
+                        (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+    if (area == 0.0) continue;
+    const double w0 = ((t.x[1] - x) * (t.y[2] - y) -
+                       (t.x[2] - x) * (t.y[1] - y)) /
+                      area;
+    const double w1 = ((t.x[2] - x) * (t.y[0] - y) -
+                       (t.x[0] - x) * (t.y[2] - y)) /
+                      area;
+    const double w2 = 1.0 - w0 - w1;
+    if (w0 >= -c_edge_tolerance && w1 >= -c_edge_tolerance &&
+        w2 >= -c_edge_tolerance) {
+      return {t.index, {w0, w1, w2}};
+    }
+  }
+  return outside;
+}
+
+size_t TriangleBuckets::size() const { return m_triangles.size(); }
@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_TRIANGLEBUCKETS_H_
+#define METBUILD_SRC_TRIANGLEBUCKETS_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Instrumentation.h"
+#include "InterpolationWeight.h"
+
+namespace MetBuild::Private {
+
+/**
+ * @brief Uniform grid of buckets over the triangles of a mesh
+ *
+ * Each bucket lists the triangles whose bounding box overlaps it, so a point
+ * is located by testing the few triangles of its bucket instead of walking
+ * the mesh. The structure is read only once built and may be queried from
+ * any number of threads
+ */
+class TriangleBuckets {
+ public:
+  struct Triangle {
+    std::array<size_t, 3> index;
+    std::array<double, 3> x;
+    std::array<double, 3> y;
+  };
+
+  explicit TriangleBuckets(std::vector<Triangle> triangles);
+
+  [[nodiscard]] MetBuild::InterpolationWeight locate(double x, double y) const;
+
+  [[nodiscard]] size_t size() const;
+
+ private:
+  std::vector<Triangle> m_triangles;
+  std::vector<uint32_t> m_start;
+  std::vector<uint32_t> m_members;
+  double m_x0 = 0.0;
+  double m_y0 = 0.0;
+  double m_dx = 1.0;
+  double m_dy = 1.0;
+  size_t m_nx = 0;
+  size_t m_ny = 0;
+  Instrumentation::MemoryTracker m_memory{
+      Instrumentation::TRIANGULATION_MEMORY};
+};
+
+}  // namespace MetBuild::Private
+
+#endif  // METBUILD_SRC_TRIANGLEBUCKETS_H_
@@ -28,23 +28,482 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "Triangulation.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "ConnectivityLocator.h"
+#include "CroppedLocator.h"
+#include "CurvilinearLocator.h"
+#include "InverseDistanceLocator.h"
+#include "NearestLocator.h"
+#include "NestLocator.h"
+#include "StructuredLocator.h"
+#include "TiledLocator.h"
 #include "TriangulationPrivate.h"
 
 using namespace MetBuild;
 
+namespace {
+constexpr double c_translation_tolerance = 1e-6;
+
+//...METBUILD_FAST_LOCATORS=0 selects the reference triangulation for every
+// source
+bool fastLocatorsDefault() {
+  const char *env = std::getenv("METBUILD_FAST_LOCATORS");
+  return env == nullptr || std::strcmp(env, "0") != 0;
+}
+std::atomic<bool> s_use_fast_locators(fastLocatorsDefault());
+
+/**
+ * @brief Whole-step offset between two uniform axes of the same length and
+ * spacing, such that b[k] = a[k + offset]
+ * @param a value of the first axis at a position
+ * @param b value of the second axis at a position
+ * @param n axis length
+ * @return offset, if both axes are uniform with the same step
+ */
+template <typename AxisA, typename AxisB>
+std::optional<long> axis_offset(const AxisA &a, const AxisB &b, size_t n) {
+  const double step = a(1) - a(0);
+  if (step == 0.0) return std::nullopt;
+  const double tolerance = c_translation_tolerance * std::abs(step);
+  for (size_t k = 1; k < n; ++k) {
+    const double expected = static_cast<double>(k) * step;
+    if (std::abs(a(k) - a(0) - expected) > tolerance ||
+        std::abs(b(k) - b(0) - expected) > tolerance) {
+      return std::nullopt;
+    }
+  }
+  const double shift = (b(0) - a(0)) / step;
+  const long offset = std::lround(shift);
+  if (std::abs(shift - static_cast<double>(offset)) > c_translation_tolerance ||
+      std::abs(offset) >= static_cast<long>(n)) {
+    return std::nullopt;
+  }
+  return offset;
+}
+}  // namespace
+
 MetBuild::Triangulation::Triangulation(
     const std::vector<double>& x, const std::vector<double>& y,
     const std::vector<MetBuild::Point>& bounding_region)
-    : m_ptr(std::make_unique<Private::TriangulationPrivate>(x, y,
-                                                            bounding_region)) {}
+    : m_ptr(Private::TiledLocator::create(x, y, bounding_region)) {}
 
 Triangulation::~Triangulation() = default;
 
-Triangulation::Triangulation(const Triangulation& t) {
-  m_ptr = std::make_unique<Private::TriangulationPrivate>(*t.m_ptr);
+Triangulation::Triangulation(std::unique_ptr<Private::PointLocator> locator)
+    : m_ptr(std::move(locator)) {}
+
+Triangulation::Triangulation(const Triangulation& t) : m_ptr(t.m_ptr->clone()) {}
+
+/**
+ * @brief Generates an analytic locator for a rectilinear source grid
+ * without constructing a triangulation
+ * @param x source longitudes, i varying fastest
+ * @param y source latitudes, i varying fastest
+ * @param ni number of points in the i direction
+ * @param nj number of points in the j direction
+ * @return locator object
+ */
+Triangulation Triangulation::structured(const std::vector<double>& x,
+                                        const std::vector<double>& y,
+                                        size_t ni, size_t nj) {
+  return Triangulation(
+      std::make_unique<Private::StructuredLocator>(x, y, ni, nj));
+}
+
+/**
+ * @brief Generates a locator for a grid which is regular in a map projection
+ * @param x source longitudes, i varying fastest
+ * @param y source latitudes, i varying fastest
+ * @param ni number of points in the i direction
+ * @param nj number of points in the j direction
+ * @param geographic_crs proj definition of the source geographic system
+ * @param projected_crs proj definition of the native grid projection
+ * @return locator object
+ */
+Triangulation Triangulation::curvilinear(const std::vector<double>& x,
+                                         const std::vector<double>& y,
+                                         size_t ni, size_t nj,
+                                         const std::string& geographic_crs,
+                                         const std::string& projected_crs) {
+  return Triangulation(std::make_unique<Private::CurvilinearLocator>(
+      x, y, ni, nj, geographic_crs, projected_crs));
+}
+
+/**
+ * @brief Index window of the source points needed to locate every point of
+ * an extent
+ *
+ * The window holds every source point inside the extent, widened by a few
+ * cells so that cells straddling its edge are kept. No window is returned
+ * when nothing is inside or when the window holds most of the grid, since
+ * cropping would not save anything
+ *
+ * @param x source longitudes, i varying fastest
+ * @param y source latitudes, i varying fastest
+ * @param ni number of points in the i direction
+ * @param nj number of points in the j direction
+ * @param extent box holding every point that will be located
+ * @return index window, if cropping is worthwhile
+ */
+std::optional<Triangulation::Window> Triangulation::crop_window(
+    const std::vector<double>& x, const std::vector<double>& y, size_t ni,
+    size_t nj, const Extent& extent) {
+  constexpr size_t halo = 2;
+
+  size_t i0 = ni;
+  size_t i1 = 0;
+  size_t j0 = nj;
+  size_t j1 = 0;
+  for (size_t j = 0; j < nj; ++j) {
+    for (size_t i = 0; i < ni; ++i) {
+      const auto k = j * ni + i;
+      if (x[k] >= extent.xmin && x[k] <= extent.xmax && y[k] >= extent.ymin &&
+          y[k] <= extent.ymax) {
+        i0 = std::min(i0, i);
+        i1 = std::max(i1, i);
+        j0 = std::min(j0, j);
+        j1 = std::max(j1, j);
+      }
+    }
+  }
+  if (i0 > i1 || j0 > j1) return std::nullopt;
+
+  i0 = i0 > halo ? i0 - halo : 0;
+  j0 = j0 > halo ? j0 - halo : 0;
+  i1 = std::min(i1 + halo, ni - 1);
+  j1 = std::min(j1 + halo, nj - 1);
+  const Window window{i0, j0, i1 - i0 + 1, j1 - j0 + 1};
+  if (window.ni < 2 || window.nj < 2 || 2 * window.ni * window.nj > ni * nj) {
+    return std::nullopt;
+  }
+  return window;
 }
 
+/**
+ * @brief Triangulates only the part of a logically structured source grid
+ * around an extent, keeping the indices of the full grid
+ *
+ * The subset is the crop_window of the extent and its boundary is traced
+ * along the window edges. When no window is worthwhile the full grid is
+ * triangulated
+ *
+ * @param x source longitudes, i varying fastest
+ * @param y source latitudes, i varying fastest
+ * @param ni number of points in the i direction
+ * @param nj number of points in the j direction
+ * @param bounding_region boundary of the full grid
+ * @param extent box holding every point that will be located
+ * @return locator object
+ */
+Triangulation Triangulation::cropped(
+    const std::vector<double>& x, const std::vector<double>& y, size_t ni,
+    size_t nj, const std::vector<MetBuild::Point>& bounding_region,
+    const Extent& extent) {
+  const auto window = Triangulation::crop_window(x, y, ni, nj, extent);
+  if (!window) return {x, y, bounding_region};
+  const size_t sni = window->ni;
+  const size_t snj = window->nj;
+
+  std::vector<double> sx;
+  std::vector<double> sy;
+  std::vector<size_t> index;
+  sx.reserve(sni * snj);
+  sy.reserve(sni * snj);
+  index.reserve(sni * snj);
+  for (size_t j = window->j0; j < window->j0 + snj; ++j) {
+    for (size_t i = window->i0; i < window->i0 + sni; ++i) {
+      index.push_back(j * ni + i);
+      sx.push_back(x[index.back()]);
+      sy.push_back(y[index.back()]);
+    }
+  }
+
+  std::vector<MetBuild::Point> region;
+  for (size_t i = 0; i < sni; ++i) region.emplace_back(sx[i], sy[i]);
+  for (size_t j = 1; j < snj; ++j) {
+    region.emplace_back(sx[j * sni + sni - 1], sy[j * sni + sni - 1]);
+  }
+  for (size_t i = 1; i < sni; ++i) {
+    region.emplace_back(sx[snj * sni - 1 - i], sy[snj * sni - 1 - i]);
+  }
+  for (size_t j = snj - 2; j > 0; --j) {
+    region.emplace_back(sx[j * sni], sy[j * sni]);
+  }
+
+  return Triangulation(std::make_unique<Private::CroppedLocator>(
+      std::make_unique<Private::TriangulationPrivate>(sx, sy, region),
+      std::move(index)));
+}
+
+/**
+ * @brief Generates a locator for a logically rectangular source grid from
+ * its index space, splitting each cell into two triangles instead of
+ * triangulating the points
+ *
+ * Only the crop_window of the extent is meshed when cropping is worthwhile.
+ * Grids spanning the globe in longitude are closed across the seam
+ *
+ * @param x source longitudes, i varying fastest
+ * @param y source latitudes, i varying fastest
+ * @param ni number of points in the i direction
+ * @param nj number of points in the j direction
+ * @param extent box holding every point that will be located
+ * @return locator object
+ */
+Triangulation Triangulation::connected(const std::vector<double>& x,
+                                       const std::vector<double>& y,
+                                       size_t ni, size_t nj,
+                                       const Extent& extent) {
+  const auto window = Triangulation::crop_window(x, y, ni, nj, extent)
+                          .value_or(Window{0, 0, ni, nj});
+  return Triangulation(std::make_unique<Private::ConnectivityLocator>(
+      x, y, ni, nj, window.i0, window.j0, window.ni, window.nj));
+}
+
+/**
+ * @brief Generates a locator for a source made of nested regular grids
+ *
+ * Every nest is located analytically and only the points within a few cells
+ * of the seams between nests are triangulated, along with the corners of
+ * the outer nest which close the constraint polygon. The full triangulation
+ * is built instead when a nest is not rectilinear
+ *
+ * @param nests nests of the source, the first holding all the others
+ * @param x source longitudes of the points kept
+ * @param y source latitudes of the points kept
+ * @param bounding_region boundary of the outer nest
+ * @return locator object
+ */
+Triangulation Triangulation::nested(
+    const std::vector<Nest>& nests, const std::vector<double>& x,
+    const std::vector<double>& y,
+    const std::vector<MetBuild::Point>& bounding_region) {
+  constexpr long halo = 2;
+  const bool structured =
+      !nests.empty() &&
+      std::all_of(nests.begin(), nests.end(), [](const Nest& n) {
+        return n.index.size() == n.ni * n.nj &&
+               Triangulation::isRectilinear(n.x, n.y, n.ni, n.nj);
+      });
+  if (!structured) return {x, y, bounding_region};
+
+  //...Points near a dropped point of their own nest, or near the edge of an
+  // inner nest, are on a seam
+  std::vector<char> on_seam(x.size(), 0);
+  bool dropped = false;
+  for (size_t k = 0; k < nests.size(); ++k) {
+    const auto& n = nests[k];
+    const auto ni = static_cast<long>(n.ni);
+    const auto nj = static_cast<long>(n.nj);
+    for (long j = 0; j < nj; ++j) {
+      for (long i = 0; i < ni; ++i) {
+        const auto p = n.index[j * ni + i];
+        if (p == invalid_point()) {
+          dropped = true;
+          continue;
+        }
+        bool seam = k > 0 && (i < halo || j < halo || i >= ni - halo ||
+                              j >= nj - halo);
+        for (long jj = std::max(0L, j - halo);
+             !seam && jj <= std::min(nj - 1, j + halo); ++jj) {
+          for (long ii = std::max(0L, i - halo);
+               !seam && ii <= std::min(ni - 1, i + halo); ++ii) {
+            seam = n.index[jj * ni + ii] == invalid_point();
+          }
+        }
+        if (seam) on_seam[p] = 1;
+      }
+    }
+  }
+
+  const auto& outer = nests.front();
+  const std::array<size_t, 4> corners = {
+      outer.index[0], outer.index[outer.ni - 1],
+      outer.index[outer.ni * outer.nj - 1],
+      outer.index[outer.ni * (outer.nj - 1)]};
+  if (std::any_of(corners.begin(), corners.end(),
+                  [](const size_t p) { return p == invalid_point(); })) {
+    return {x, y, bounding_region};
+  }
+
+  std::unique_ptr<Private::PointLocator> seam;
+  if (dropped) {
+    std::vector<MetBuild::Point> region;
+    for (const auto p : corners) {
+      on_seam[p] = 1;
+      region.emplace_back(x[p], y[p]);
+    }
+    std::vector<double> sx;
+    std::vector<double> sy;
+    std::vector<size_t> index;
+    for (size_t p = 0; p < on_seam.size(); ++p) {
+      if (!on_seam[p]) continue;
+      index.push_back(p);
+      sx.push_back(x[p]);
+      sy.push_back(y[p]);
+    }
+    seam = std::make_unique<Private::CroppedLocator>(
+        std::make_unique<Private::TriangulationPrivate>(sx, sy, region),
+        std::move(index));
+  }
+
+  //...Finest nest first, inner nests first among nests of the same spacing
+  std::vector<size_t> order(nests.size());
+  for (size_t k = 0; k < order.size(); ++k) order[k] = nests.size() - 1 - k;
+  auto cell_area = [&](const size_t k) {
+    const auto& n = nests[k];
+    return std::abs((n.x[1] - n.x[0]) * (n.y[n.ni] - n.y[0]));
+  };
+  std::stable_sort(order.begin(), order.end(),
+                   [&](const size_t a, const size_t b) {
+                     return cell_area(a) < cell_area(b);
+                   });
+
+  std::vector<Private::NestLocator::Nest> locators;
+  for (const auto k : order) {
+    const auto& n = nests[k];
+    locators.push_back(
+        {std::make_unique<Private::StructuredLocator>(n.x, n.y, n.ni, n.nj),
+         n.index});
+  }
+  return Triangulation(std::make_unique<Private::NestLocator>(
+      std::move(locators), std::move(seam)));
+}
+
+/**
+ * @brief Generates a locator weighting the nearest source points by inverse
+ * distance, for scattered sources with no usable connectivity
+ * @param x source longitudes
+ * @param y source latitudes
+ * @param radius largest distance to a source point, in source coordinates
+ * @return locator object
+ */
+Triangulation Triangulation::inverse_distance(const std::vector<double>& x,
+                                              const std::vector<double>& y,
+                                              double radius) {
+  return Triangulation(
+      std::make_unique<Private::InverseDistanceLocator>(x, y, radius));
+}
+
+/**
+ * @brief Generates a locator which falls back to inverse distance weighting
+ * of the nearest source points where another locator finds no triangle,
+ * such as just outside the hull of the source grid
+ * @param primary locator tried first
+ * @param x source longitudes
+ * @param y source latitudes
+ * @param radius largest distance to a source point, in source coordinates
+ * @return locator object
+ */
+Triangulation Triangulation::with_fallback(const Triangulation& primary,
+                                           const std::vector<double>& x,
+                                           const std::vector<double>& y,
+                                           double radius) {
+  return Triangulation(std::make_unique<Private::InverseDistanceLocator>(
+      x, y, radius, primary.m_ptr->clone()));
+}
+
+/**
+ * @brief Generates a locator giving each point the value of the nearest
+ * corner of the triangle another locator finds around it
+ * @param primary locator finding the triangles
+ * @return locator object
+ */
+Triangulation Triangulation::nearest(const Triangulation& primary) {
+  return Triangulation(
+      std::make_unique<Private::NearestLocator>(primary.m_ptr->clone()));
+}
+
+bool Triangulation::isRectilinear(const std::vector<double>& x,
+                                  const std::vector<double>& y, size_t ni,
+                                  size_t nj) {
+  return Private::StructuredLocator::isRectilinear(x, y, ni, nj);
+}
+
+/**
+ * @brief Detects a rigid whole-cell translation between two uniform
+ * rectilinear grids of the same shape, as produced by a moving nest
+ *
+ * A point of the second grid at (i, j) lies at the position of point
+ * (i + di, j + dj) of the first, so weights located on the first grid carry
+ * over to the second by subtracting the offset from their source indices
+ *
+ * @param x0 longitudes of the first grid, i varying fastest
+ * @param y0 latitudes of the first grid, i varying fastest
+ * @param x1 longitudes of the second grid, i varying fastest
+ * @param y1 latitudes of the second grid, i varying fastest
+ * @param ni number of points in the i direction
+ * @param nj number of points in the j direction
+ * @return offset, if the second grid is a translation of the first
+ */
+std::optional<Triangulation::Offset> Triangulation::translation(
+    const std::vector<double>& x0, const std::vector<double>& y0,
+    const std::vector<double>& x1, const std::vector<double>& y1, size_t ni,
+    size_t nj) {
+  if (!Triangulation::isRectilinear(x0, y0, ni, nj) ||
+      !Triangulation::isRectilinear(x1, y1, ni, nj)) {
+    return std::nullopt;
+  }
+  const auto di = axis_offset([&](size_t i) { return x0[i]; },
+                              [&](size_t i) { return x1[i]; }, ni);
+  const auto dj = axis_offset([&](size_t j) { return y0[j * ni]; },
+                              [&](size_t j) { return y1[j * ni]; }, nj);
+  if (!di || !dj) return std::nullopt;
+  return Offset{*di, *dj};
+}
+
+/**
+ * @brief Selects whether triangulations built from here on locate points
+ * through a bucket grid of their triangles instead of walking the mesh
+ * @param value true to build the bucket grid
+ */
+void Triangulation::setUseBuckets(bool value) {
+  Private::TriangulationPrivate::setUseBuckets(value);
+}
+
+bool Triangulation::useBuckets() {
+  return Private::TriangulationPrivate::useBuckets();
+}
+
+/**
+ * @brief Sets the number of points per tile above which scattered sources
+ * are triangulated as a set of overlapping tiles built in parallel
+ * @param value points per tile, zero to always build one triangulation
+ */
+void Triangulation::setTilePoints(size_t value) {
+  Private::TiledLocator::setTilePoints(value);
+}
+
+size_t Triangulation::tilePoints() {
+  return Private::TiledLocator::tilePoints();
+}
+
+/**
+ * @brief Selects whether sources build their own locators, such as the
+ * analytic locators of structured grids, or the reference Delaunay
+ * triangulation of their points and bounding region. The reference is
+ * slower and is kept to check the results of the others against
+ * @param value true to let sources choose their locator
+ */
+void Triangulation::setUseFastLocators(bool value) {
+  s_use_fast_locators = value;
+}
+
+bool Triangulation::useFastLocators() { return s_use_fast_locators; }
+
 MetBuild::InterpolationWeight Triangulation::getInterpolationFactors(
     double x, double y) const {
   return m_ptr->getInterpolationFactors(x, y);
 }
+
+void Triangulation::getInterpolationFactors(
+    const std::vector<MetBuild::Point>& points,
+    std::vector<MetBuild::InterpolationWeight>& weights) const {
+  m_ptr->getInterpolationFactors(points, weights);
+}
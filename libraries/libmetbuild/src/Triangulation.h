@@ -31,6 +31,8 @@
 
 #include <limits>
 #include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
 #include "InterpolationWeight.h"
@@ -38,10 +40,51 @@
 
 namespace MetBuild {
 namespace Private {
-class TriangulationPrivate;
+class PointLocator;
 }
 class Triangulation {
  public:
+  /**
+   * @brief Box holding every point weights will be requested for
+   */
+  struct Extent {
+    double xmin;
+    double ymin;
+    double xmax;
+    double ymax;
+  };
+
+  /**
+   * @brief Index window of a logically structured grid
+   */
+  struct Window {
+    size_t i0;
+    size_t j0;
+    size_t ni;
+    size_t nj;
+  };
+
+  /**
+   * @brief Regular nest of a nested source grid. Points are stored with i
+   * varying fastest and index holds the position of each in the source
+   * arrays, invalid_point() for the points covered by an inner nest
+   */
+  struct Nest {
+    std::vector<double> x;
+    std::vector<double> y;
+    size_t ni;
+    size_t nj;
+    std::vector<size_t> index;
+  };
+
+  /**
+   * @brief Whole-cell offset between two logically structured grids
+   */
+  struct Offset {
+    long di;
+    long dj;
+  };
+
   Triangulation(const std::vector<double> &x, const std::vector<double> &y,
                 const std::vector<MetBuild::Point> &bounding_region);
 
@@ -49,6 +92,67 @@ class Triangulation {
 
   Triangulation(const Triangulation &t);
 
+  static Triangulation structured(const std::vector<double> &x,
+                                  const std::vector<double> &y, size_t ni,
+                                  size_t nj);
+
+  static Triangulation curvilinear(const std::vector<double> &x,
+                                   const std::vector<double> &y, size_t ni,
+                                   size_t nj, const std::string &geographic_crs,
+                                   const std::string &projected_crs);
+
+  static Triangulation cropped(
+      const std::vector<double> &x, const std::vector<double> &y, size_t ni,
+      size_t nj, const std::vector<MetBuild::Point> &bounding_region,
+      const Extent &extent);
+
+  static Triangulation connected(const std::vector<double> &x,
+                                 const std::vector<double> &y, size_t ni,
+                                 size_t nj, const Extent &extent);
+
+  static Triangulation nested(
+      const std::vector<Nest> &nests, const std::vector<double> &x,
+      const std::vector<double> &y,
+      const std::vector<MetBuild::Point> &bounding_region);
+
+  static Triangulation inverse_distance(const std::vector<double> &x,
+                                        const std::vector<double> &y,
+                                        double radius);
+
+  static Triangulation with_fallback(const Triangulation &primary,
+                                     const std::vector<double> &x,
+                                     const std::vector<double> &y,
+                                     double radius);
+
+  static Triangulation nearest(const Triangulation &primary);
+
+  static std::optional<Window> crop_window(const std::vector<double> &x,
+                                           const std::vector<double> &y,
+                                           size_t ni, size_t nj,
+                                           const Extent &extent);
+
+  static bool isRectilinear(const std::vector<double> &x,
+                            const std::vector<double> &y, size_t ni,
+                            size_t nj);
+
+  static std::optional<Offset> translation(const std::vector<double> &x0,
+                                           const std::vector<double> &y0,
+                                           const std::vector<double> &x1,
+                                           const std::vector<double> &y1,
+                                           size_t ni, size_t nj);
+
+  static void setUseBuckets(bool value);
+
+  static bool useBuckets();
+
+  static void setTilePoints(size_t value);
+
+  static size_t tilePoints();
+
+  static void setUseFastLocators(bool value);
+
+  static bool useFastLocators();
+
   static constexpr size_t invalid_point() {
     return std::numeric_limits<size_t>::max();
   }
@@ -56,8 +160,14 @@ class Triangulation {
   [[nodiscard]] MetBuild::InterpolationWeight getInterpolationFactors(
       double x, double y) const;
 
+  void getInterpolationFactors(
+      const std::vector<MetBuild::Point> &points,
+      std::vector<MetBuild::InterpolationWeight> &weights) const;
+
  private:
-  std::unique_ptr<Private::TriangulationPrivate> m_ptr;
+  explicit Triangulation(std::unique_ptr<Private::PointLocator> locator);
+
+  std::unique_ptr<Private::PointLocator> m_ptr;
 };
 
 }  // namespace MetBuild
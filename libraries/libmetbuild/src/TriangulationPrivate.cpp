@@ -28,17 +28,30 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "TriangulationPrivate.h"
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
 #include <fstream>
 #include <limits>
 #include <utility>
 
 #define FMT_HEADER_ONLY
 
+#include "LocatorCache.h"
 #include "Logging.h"
 #include "fmt/core.h"
 
 using namespace MetBuild::Private;
 
+namespace {
+bool bucketsDefault() {
+  const char *env = std::getenv("METBUILD_BUCKET_LOCATOR");
+  return env != nullptr && std::strcmp(env, "0") != 0;
+}
+std::atomic<bool> s_use_buckets(bucketsDefault());
+}  // namespace
+
 TriangulationPrivate::TriangulationPrivate(
     const std::vector<double> &x, const std::vector<double> &y,
     const std::vector<MetBuild::Point> &bounding_region)
@@ -49,32 +62,132 @@ TriangulationPrivate::TriangulationPrivate(
     m_points.emplace_back(x[i], y[i]);
   }
 
-  const auto boundary_polygon =
-      MetBuild::Private::TriangulationPrivate::construct_boundary_polygon(
-          bounding_region);
-  this->construct_triangulation(boundary_polygon);
-  // this->write("triangulation.14");
+  this->build();
 }
 
 TriangulationPrivate::TriangulationPrivate(
     std::vector<MetBuild::Point> p,
     const std::vector<MetBuild::Point> &bounding_region)
     : m_points(std::move(p)), m_bounding_region(bounding_region) {
+  this->build();
+}
+
+/**
+ * @brief Triangulates the points within the bounding region, or takes the
+ * triangles from the locator cache when it holds them
+ */
+void TriangulationPrivate::build() {
+  const auto key = LocatorCache::enabled()
+                       ? LocatorCache::key(m_points, m_bounding_region)
+                       : std::string();
+  if (!key.empty() && this->load_cached(key)) return;
   const auto boundary_polygon =
       MetBuild::Private::TriangulationPrivate::construct_boundary_polygon(
-          bounding_region);
+          m_bounding_region);
   this->construct_triangulation(boundary_polygon);
+  if (!key.empty()) this->store_cached(key);
   // this->write("triangulation.14");
 }
 
+/**
+ * @brief Takes the triangles of the triangulation from the locator cache,
+ * without triangulating. Points are then located through the bucket grid
+ * @param key key generated by LocatorCache::key
+ * @return false if the cache does not hold the triangulation
+ */
+bool TriangulationPrivate::load_cached(const std::string &key) {
+  const auto cached = LocatorCache::load(key, m_points.size());
+  if (!cached) return false;
+  std::vector<TriangleBuckets::Triangle> triangles;
+  triangles.reserve(cached->size());
+  for (const auto &c : *cached) {
+    TriangleBuckets::Triangle t{};
+    for (size_t k = 0; k < 3; ++k) {
+      t.index[k] = c[k];
+      t.x[k] = m_points[c[k]].x();
+      t.y[k] = m_points[c[k]].y();
+    }
+    triangles.push_back(t);
+  }
+  m_buckets = std::make_shared<const TriangleBuckets>(std::move(triangles));
+  this->track_memory(m_points.capacity() * sizeof(Point) +
+                     m_bounding_region.capacity() * sizeof(Point));
+  return true;
+}
+
+/**
+ * @brief Writes the triangles inside the domain to the locator cache. They
+ * are stored by point index, so a triangulation whose vertices are not
+ * exactly the source points is not cached
+ * @param key key generated by LocatorCache::key
+ */
+void TriangulationPrivate::store_cached(const std::string &key) const {
+  if (m_points.size() >= std::numeric_limits<uint32_t>::max()) return;
+  LocatorCache::Triangles triangles;
+  for (const auto &t : this->domain_triangles()) {
+    std::array<uint32_t, 3> c{};
+    for (size_t k = 0; k < 3; ++k) {
+      if (t.index[k] >= m_points.size() ||
+          m_points[t.index[k]].x() != t.x[k] ||
+          m_points[t.index[k]].y() != t.y[k]) {
+        return;
+      }
+      c[k] = static_cast<uint32_t>(t.index[k]);
+    }
+    triangles.push_back(c);
+  }
+  LocatorCache::store(key, m_points.size(), triangles);
+}
+
+/**
+ * @brief Builds the constraint polygon from the boundary of a source grid
+ *
+ * Sources trace their boundary through every grid point along its edges, so
+ * runs of points on one straight line are merged and only the corners are
+ * kept. The tests are exact, so the polygon encloses the same region and the
+ * source points on the merged edges split them again when inserted
+ *
+ * @param bounding_region boundary points of the source grid
+ * @return constraint polygon
+ */
 TriangulationPrivate::Polygon_t
 TriangulationPrivate::construct_boundary_polygon(
     const std::vector<MetBuild::Point> &bounding_region) {
-  Polygon_t poly;
+  auto between = [](const Point_t &a, const Point_t &b, const Point_t &c) {
+    return CGAL::collinear(a, b, c) &&
+           CGAL::collinear_are_ordered_along_line(a, b, c);
+  };
+
+  std::vector<Point_t> corners;
+  corners.reserve(bounding_region.size());
   for (const auto &p : bounding_region) {
-    poly.push_back(Point_t(p.x(), p.y()));
+    const Point_t point(p.x(), p.y());
+    if (!corners.empty() && corners.back() == point) continue;
+    while (corners.size() > 1 &&
+           between(corners[corners.size() - 2], corners.back(), point)) {
+      corners.pop_back();
+    }
+    corners.push_back(point);
+  }
+  while (corners.size() > 1 && corners.back() == corners.front()) {
+    corners.pop_back();
+  }
+
+  //...Runs which continue across the start of the list
+  size_t first = 0;
+  while (corners.size() - first > 3) {
+    const auto n = corners.size();
+    if (between(corners[n - 2], corners[n - 1], corners[first])) {
+      corners.pop_back();
+    } else if (between(corners[n - 1], corners[first], corners[first + 1])) {
+      ++first;
+    } else {
+      break;
+    }
   }
-  return poly;
+
+  return {corners.begin() + static_cast<std::ptrdiff_t>(first),
+          corners.end()};
 }
 
 //...Algorithm copied from CGAL example
@@ -146,10 +259,89 @@ void TriangulationPrivate::construct_triangulation(const Polygon_t &polygon) {
         "The domain appears to contain duplicated points. This error is "
         "internal and fatal.");
   }
+
+  if (s_use_buckets) this->build_buckets();
+  this->track_memory(
+      m_points.capacity() * sizeof(Point) +
+      m_bounding_region.capacity() * sizeof(Point) +
+      m_triangulation.number_of_vertices() *
+          sizeof(DelaunayTriangulation_t::Vertex) +
+      m_triangulation.number_of_faces() *
+          sizeof(DelaunayTriangulation_t::Face));
+}
+
+/**
+ * @brief Bins the triangles inside the domain into a bucket grid used to
+ * locate points in place of walking the triangulation
+ */
+void TriangulationPrivate::build_buckets() {
+  m_buckets = std::make_shared<const TriangleBuckets>(this->domain_triangles());
+}
+
+/**
+ * @brief Triangles of the triangulation which are inside the domain
+ */
+std::vector<TriangleBuckets::Triangle> TriangulationPrivate::domain_triangles()
+    const {
+  std::vector<TriangleBuckets::Triangle> triangles;
+  triangles.reserve(m_triangulation.number_of_faces());
+  for (const auto &f : m_triangulation.finite_face_handles()) {
+    if (!f->info().in_domain()) continue;
+    TriangleBuckets::Triangle t{};
+    for (int k = 0; k < 3; ++k) {
+      t.index[k] = f->vertex(k)->info();
+      t.x[k] = f->vertex(k)->point().x();
+      t.y[k] = f->vertex(k)->point().y();
+    }
+    triangles.push_back(t);
+  }
+  return triangles;
+}
+
+/**
+ * @brief Selects whether new triangulations build a bucket grid to locate
+ * points. The default is taken from the METBUILD_BUCKET_LOCATOR environment
+ * variable
+ * @param value true to locate points through the bucket grid
+ */
+void TriangulationPrivate::setUseBuckets(bool value) { s_use_buckets = value; }
+
+bool TriangulationPrivate::useBuckets() { return s_use_buckets; }
+
+std::unique_ptr<PointLocator> TriangulationPrivate::clone() const {
+  return std::make_unique<TriangulationPrivate>(*this);
 }
 
 MetBuild::InterpolationWeight TriangulationPrivate::getInterpolationFactors(
     double x, double y) const {
+  if (m_buckets) return m_buckets->locate(x, y);
+  DelaunayTriangulation_t::Face_handle hint;
+  return this->locate(x, y, hint);
+}
+
+void TriangulationPrivate::getInterpolationFactors(
+    const std::vector<MetBuild::Point> &points,
+    std::vector<MetBuild::InterpolationWeight> &weights) const {
+  weights.resize(points.size());
+  if (m_buckets) {
+    for (size_t i = 0; i < points.size(); ++i) {
+      weights[i] = m_buckets->locate(points[i].x(), points[i].y());
+    }
+    return;
+  }
+  DelaunayTriangulation_t::Face_handle hint;
+  for (size_t i = 0; i < points.size(); ++i) {
+    weights[i] = this->locate(points[i].x(), points[i].y(), hint);
+  }
+}
+
+/**
+ * @brief Locates a point, starting the walk from the hint face when one is
+ * given. On return the hint holds the face containing the point so that it
+ * can seed the next search
+ */
+MetBuild::InterpolationWeight TriangulationPrivate::locate(
+    double x, double y, DelaunayTriangulation_t::Face_handle &hint) const {
   const Point_t pt(x, y);
 
   using CartesianKernel = CGAL::Simple_cartesian<double>;
@@ -159,7 +351,8 @@ MetBuild::InterpolationWeight TriangulationPrivate::getInterpolationFactors(
   DelaunayTriangulation_t::Locate_type locate_type =
       DelaunayTriangulation_t::OUTSIDE_AFFINE_HULL;
   int dmy_int = 0;
-  const auto fh = m_triangulation.locate(pt, locate_type, dmy_int);
+  const auto fh = m_triangulation.locate(pt, locate_type, dmy_int, hint);
+  if (!m_triangulation.is_infinite(fh)) hint = fh;
   if (fh->info().in_domain() &&
       (locate_type == DelaunayTriangulation_t::FACE ||
        locate_type == DelaunayTriangulation_t::EDGE ||
@@ -170,11 +363,10 @@ MetBuild::InterpolationWeight TriangulationPrivate::getInterpolationFactors(
     const Point_2 p1(fh->vertex(1)->point().x(), fh->vertex(1)->point().y());
     const Point_2 p2(fh->vertex(2)->point().x(), fh->vertex(2)->point().y());
 
-    std::vector<FT> result;
-    result.reserve(3);
-
-    CGAL::Barycentric_coordinates::triangle_coordinates_2(
-        p0, p1, p2, p_query, std::back_inserter(result));
+    //...Written in place, so locating a point never allocates
+    std::array<FT, 3> result{};
+    CGAL::Barycentric_coordinates::triangle_coordinates_2(p0, p1, p2, p_query,
+                                                          result.begin());
 
     std::array<size_t, 3> n = {fh->vertex(0)->info(), fh->vertex(1)->info(),
                                fh->vertex(2)->info()};
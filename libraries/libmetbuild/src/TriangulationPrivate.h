@@ -32,6 +32,7 @@
 #include <cstdlib>
 #include <limits>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "CGAL/Barycentric_coordinates_2/triangle_coordinates_2.h"
@@ -43,10 +44,12 @@
 #include "CGAL/Triangulation_vertex_base_with_info_2.h"
 #include "InterpolationWeight.h"
 #include "Point.h"
+#include "PointLocator.h"
+#include "TriangleBuckets.h"
 
 namespace MetBuild::Private {
 
-class TriangulationPrivate {
+class TriangulationPrivate : public PointLocator {
   struct FaceInfo2 {
     FaceInfo2() : nesting_level(-1) {}
     int nesting_level;
@@ -82,20 +85,43 @@ class TriangulationPrivate {
     return std::numeric_limits<size_t>::max();
   }
 
+  [[nodiscard]] std::unique_ptr<PointLocator> clone() const override;
+
   [[nodiscard]] MetBuild::InterpolationWeight getInterpolationFactors(
-      double x, double y) const;
+      double x, double y) const override;
+
+  void getInterpolationFactors(
+      const std::vector<MetBuild::Point> &points,
+      std::vector<MetBuild::InterpolationWeight> &weights) const override;
 
   std::vector<MetBuild::Point> points() const;
 
   std::vector<MetBuild::Point> bounding_region() const;
 
+  static void setUseBuckets(bool value);
+
+  static bool useBuckets();
+
  private:
   void write(const std::string &filename) const;
 
+  MetBuild::InterpolationWeight locate(
+      double x, double y, DelaunayTriangulation_t::Face_handle &hint) const;
+
   void construct_triangulation(const Polygon_t &polygon);
 
   void trim_mesh();
 
+  void build_buckets();
+
+  void build();
+
+  bool load_cached(const std::string &key);
+
+  void store_cached(const std::string &key) const;
+
+  std::vector<TriangleBuckets::Triangle> domain_triangles() const;
+
   void mark_domains(DelaunayTriangulation_t::Face_handle start, int index,
                     std::list<DelaunayTriangulation_t::Edge> &border);
 
@@ -105,6 +131,7 @@ class TriangulationPrivate {
   std::vector<Point> m_points;
   std::vector<Point> m_bounding_region;
   DelaunayTriangulation_t m_triangulation;
+  std::shared_ptr<const TriangleBuckets> m_buckets;
 };
 }  // namespace MetBuild::Private
 
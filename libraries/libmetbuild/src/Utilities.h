@@ -61,6 +61,10 @@ inline bool exists(const std::string &file) {
   return boost::filesystem::exists(file);
 }
 
+inline bool is_url(const std::string &file) {
+  return file.rfind("http://", 0) == 0 || file.rfind("https://", 0) == 0;
+}
+
 template <typename T, typename std::enable_if<
                           std::is_floating_point<T>::value>::type * = nullptr>
 constexpr bool equal(const T v1, const T v2) {
@@ -0,0 +1,198 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "WarmCache.h"
+
+#include <cstdlib>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace MetBuild;
+
+namespace {
+
+struct Entry {
+  std::string key;
+  std::shared_ptr<const void> object;
+  size_t bytes;
+};
+
+struct State {
+  std::mutex mutex;
+  size_t budget = 0;
+  size_t bytes = 0;
+  std::list<Entry> entries;  // most recently used first
+  std::unordered_map<std::string, std::list<Entry>::iterator> index;
+};
+
+/**
+ * @brief State of the cache. It is never destroyed so that objects still
+ * retained at exit are not released after the registries they belong to
+ */
+State &state() {
+  static auto *s = []() {
+    auto *state = new State;
+    const char *env = std::getenv("METBUILD_WARM_CACHE");
+    if (env != nullptr) {
+      state->budget = static_cast<size_t>(std::strtoull(env, nullptr, 10))
+                      << 20;
+    }
+    return state;
+  }();
+  return *s;
+}
+
+/**
+ * @brief Drops the least recently used entries until the cache fits its
+ * budget. The objects are handed back so they are released once the mutex
+ * is no longer held
+ */
+std::vector<std::shared_ptr<const void>> evict(State *s) {
+  std::vector<std::shared_ptr<const void>> released;
+  while (s->bytes > s->budget && !s->entries.empty()) {
+    auto &last = s->entries.back();
+    s->bytes -= last.bytes;
+    released.push_back(std::move(last.object));
+    s->index.erase(last.key);
+    s->entries.pop_back();
+  }
+  return released;
+}
+
+}  // namespace
+
+/**
+ * @brief Sets the memory kept warm. A budget of zero disables the cache and
+ * releases everything it holds
+ * @param bytes budget in bytes
+ */
+void WarmCache::setBudget(const size_t bytes) {
+  std::vector<std::shared_ptr<const void>> released;
+  {
+    auto &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.budget = bytes;
+    released = evict(&s);
+  }
+}
+
+size_t WarmCache::budget() {
+  auto &s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  return s.budget;
+}
+
+bool WarmCache::enabled() { return budget() > 0; }
+
+/**
+ * @brief Estimated memory held by the cache in bytes
+ */
+size_t WarmCache::size() {
+  auto &s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  return s.bytes;
+}
+
+/**
+ * @brief Number of objects held by the cache
+ */
+size_t WarmCache::count() {
+  auto &s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  return s.entries.size();
+}
+
+/**
+ * @brief Keeps an object alive and marks it as the most recently used. An
+ * object larger than the whole budget is not kept
+ * @param key key of the object, unique across the registries using the cache
+ * @param object object kept
+ * @param bytes estimated memory held by the object
+ */
+void WarmCache::retain(const std::string &key,
+                       std::shared_ptr<const void> object,
+                       const size_t bytes) {
+  std::vector<std::shared_ptr<const void>> released;
+  {
+    auto &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (s.budget == 0) return;
+    auto it = s.index.find(key);
+    if (it != s.index.end()) {
+      auto entry = it->second;
+      s.bytes -= entry->bytes;
+      released.push_back(std::move(entry->object));
+      entry->object = std::move(object);
+      entry->bytes = bytes;
+      s.entries.splice(s.entries.begin(), s.entries, entry);
+    } else {
+      s.entries.push_front({key, std::move(object), bytes});
+      s.index.emplace(key, s.entries.begin());
+    }
+    s.bytes += bytes;
+    auto evicted = evict(&s);
+    std::move(evicted.begin(), evicted.end(), std::back_inserter(released));
+  }
+}
+
+/**
+ * @brief Stops keeping an object, e.g. a mapping of a file about to be
+ * deleted
+ * @param key key of the object
+ */
+void WarmCache::erase(const std::string &key) {
+  std::shared_ptr<const void> released;
+  {
+    auto &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.index.find(key);
+    if (it == s.index.end()) return;
+    s.bytes -= it->second->bytes;
+    released = std::move(it->second->object);
+    s.entries.erase(it->second);
+    s.index.erase(it);
+  }
+}
+
+/**
+ * @brief Releases every object held by the cache. The budget is kept
+ */
+void WarmCache::clear() {
+  std::list<Entry> released;
+  {
+    auto &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    released.swap(s.entries);
+    s.index.clear();
+    s.bytes = 0;
+  }
+}
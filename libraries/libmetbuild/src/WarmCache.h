@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_WARMCACHE_H_
+#define METBUILD_SRC_WARMCACHE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "CppAttributes.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Keeps recently used shared objects alive after their last user
+ * releases them, up to a memory budget
+ *
+ * The in-memory registries (SharedCache, MappedFile) only hold weak
+ * references, so in a process that builds one request and exits nothing is
+ * kept longer than needed. A resident build process handling many requests
+ * sets a budget and the grid definitions, interpolation weights and file
+ * mappings of one request stay warm for the next. The least recently used
+ * objects are dropped first when the budget is exceeded
+ *
+ * The cache is disabled unless a budget is set, either with setBudget() or
+ * with the METBUILD_WARM_CACHE environment variable, in megabytes
+ */
+class WarmCache {
+ public:
+  static void setBudget(size_t bytes);
+
+  NODISCARD static size_t budget();
+
+  NODISCARD static bool enabled();
+
+  NODISCARD static size_t size();
+
+  NODISCARD static size_t count();
+
+  static void retain(const std::string &key,
+                     std::shared_ptr<const void> object, size_t bytes);
+
+  static void erase(const std::string &key);
+
+  static void clear();
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_WARMCACHE_H_
@@ -0,0 +1,464 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "WeightFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+#include "Logging.h"
+#include "ThreadPool.h"
+
+using namespace MetBuild;
+
+namespace {
+constexpr char c_magic[4] = {'M', 'B', 'W', 'C'};
+constexpr uint32_t c_version = 3;
+
+using weight_type = InterpolationWeights::weight_type;
+
+void put_varint(std::string &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+bool get_varint(const unsigned char *&p, const unsigned char *end,
+                uint64_t &value) {
+  value = 0;
+  for (unsigned shift = 0; shift < 64 && p < end; shift += 7) {
+    const unsigned char byte = *p++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+//...Deltas along a row are small and of either sign, so they are zigzag
+// mapped onto small unsigned values before the variable length encoding
+uint64_t zigzag(const int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(const uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+double levels(const unsigned bits) {
+  return static_cast<double>((uint64_t(1) << bits) - 1);
+}
+
+weight_type dequantize(const double lo, const double step, const uint64_t q) {
+  return static_cast<weight_type>(lo + static_cast<double>(q) * step);
+}
+
+template <typename T>
+void put_value(std::string &out, const T value) {
+  out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+T get_value(const unsigned char *p) {
+  T value;
+  std::memcpy(&value, p, sizeof(T));
+  return value;
+}
+}  // namespace
+
+WeightFile::WeightFile(std::shared_ptr<const MappedFile> file,
+                       const Header &header)
+    : m_file(std::move(file)), m_header(header) {}
+
+uint32_t WeightFile::version() { return c_version; }
+
+/**
+ * @brief Encodes the cells of a band of rows
+ * @param weights weights to encode
+ * @param j0 first row of the band
+ * @param j1 one past the last row of the band
+ * @param bits quantization of the weights, zero to keep them exactly
+ * @param band receives the quantization range of the band
+ * @param error receives the largest difference between a weight and the
+ * value it is decoded to
+ * @return uncompressed block
+ */
+std::string WeightFile::encode(const InterpolationWeights &weights,
+                               const size_t j0, const size_t j1,
+                               const unsigned bits, Band &band,
+                               double &error) {
+  const size_t ni = weights.ni();
+  const size_t c0 = j0 * ni;
+  const size_t c1 = j1 * ni;
+  std::string out;
+
+  for (size_t k = 0; k < 3; ++k) {
+    const auto *index = weights.index(k);
+    for (size_t j = j0; j < j1; ++j) {
+      int64_t previous = 0;
+      for (size_t c = j * ni; c < (j + 1) * ni; ++c) {
+        if (!weights.valid(c)) continue;
+        const auto value = static_cast<int64_t>(index[c]);
+        put_varint(out, zigzag(value - previous));
+        previous = value;
+      }
+    }
+  }
+
+  band.lo = 0.0;
+  band.step = 0.0;
+  error = 0.0;
+  if (bits == 0) {
+    for (size_t k = 0; k < 3; ++k) {
+      for (size_t c = c0; c < c1; ++c) {
+        if (weights.valid(c)) put_value(out, weights.weight(k)[c]);
+      }
+    }
+    return out;
+  }
+
+  double lo = std::numeric_limits<double>::max();
+  double hi = std::numeric_limits<double>::lowest();
+  for (size_t k = 0; k < 3; ++k) {
+    for (size_t c = c0; c < c1; ++c) {
+      if (!weights.valid(c)) continue;
+      lo = std::min(lo, static_cast<double>(weights.weight(k)[c]));
+      hi = std::max(hi, static_cast<double>(weights.weight(k)[c]));
+    }
+  }
+  if (lo > hi) return out;
+
+  band.lo = lo;
+  band.step = hi > lo ? (hi - lo) / levels(bits) : 0.0;
+  for (size_t k = 0; k < 3; ++k) {
+    for (size_t c = c0; c < c1; ++c) {
+      if (!weights.valid(c)) continue;
+      const double w = weights.weight(k)[c];
+      const auto q = band.step > 0.0
+                         ? static_cast<uint64_t>(std::min(
+                               std::round((w - lo) / band.step), levels(bits)))
+                         : uint64_t(0);
+      error = std::max(
+          error, std::abs(static_cast<double>(
+                              dequantize(band.lo, band.step, q)) -
+                          w));
+      if (bits == 16) {
+        put_value(out, static_cast<uint16_t>(q));
+      } else {
+        put_value(out, static_cast<uint32_t>(q));
+      }
+    }
+  }
+  return out;
+}
+
+/**
+ * @brief Writes a set of interpolation weights. Bands are encoded and
+ * compressed in parallel
+ * @param filename file to write
+ * @param weights weights to write
+ * @param key cache key of the weights, checked by readers
+ * @param identity grids and method the weights were built for
+ * @param options encoding of the weights. A codec that is not available in
+ * this build leaves the blocks uncompressed
+ * @return true if the file was written
+ */
+bool WeightFile::write(const std::string &filename,
+                       const InterpolationWeights &weights, const uint64_t key,
+                       const Identity &identity, const Options &options) {
+  const unsigned bits = options.weight_bits;
+  if (bits != 0 && bits != 16 && bits != 32) {
+    metbuild_throw_exception("Weights can only be quantized to 16 or 32 bits");
+  }
+  const auto codec = StreamCompression::available(options.codec)
+                         ? options.codec
+                         : StreamCompression::NONE;
+  const size_t ni = weights.ni();
+  const size_t nj = weights.nj();
+  const size_t band_rows =
+      std::clamp<size_t>(options.band_cells / ni, 1, nj);
+  const size_t nbands = (nj + band_rows - 1) / band_rows;
+
+  std::vector<Band> table(nbands);
+  std::vector<std::string> blocks(nbands);
+  std::vector<double> errors(nbands, 0.0);
+  ThreadPool::global().parallel_for(0, nbands, [&](const size_t b) {
+    const size_t j0 = b * band_rows;
+    const size_t j1 = std::min(nj, j0 + band_rows);
+    auto raw = encode(weights, j0, j1, bits, table[b], errors[b]);
+    table[b].raw_size = raw.size();
+    blocks[b] = codec == StreamCompression::NONE
+                    ? std::move(raw)
+                    : StreamCompression::compress(
+                          codec, raw.data(), raw.size(),
+                          StreamCompression::defaultLevel(codec));
+    table[b].size = blocks[b].size();
+  });
+
+  Header header{};
+  std::memcpy(header.magic, c_magic, sizeof(c_magic));
+  header.version = c_version;
+  header.key = key;
+  header.source = identity.source;
+  header.grid = identity.grid;
+  header.method = identity.method;
+  header.ni = ni;
+  header.nj = nj;
+  header.band_rows = static_cast<uint32_t>(band_rows);
+  header.bands = static_cast<uint32_t>(nbands);
+  header.weight_bits = bits;
+  header.weight_size = sizeof(weight_type);
+  header.codec = static_cast<uint32_t>(codec);
+  header.max_error = *std::max_element(errors.begin(), errors.end());
+
+  uint64_t offset = sizeof(Header) + nbands * sizeof(Band) +
+                    weights.mask_size() * sizeof(uint64_t);
+  for (auto &band : table) {
+    band.offset = offset;
+    offset += band.size;
+  }
+
+  std::ofstream f(filename, std::ios::binary);
+  if (!f.is_open()) return false;
+  f.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+  f.write(reinterpret_cast<const char *>(table.data()),
+          nbands * sizeof(Band));
+  f.write(reinterpret_cast<const char *>(weights.mask()),
+          weights.mask_size() * sizeof(uint64_t));
+  for (const auto &block : blocks) {
+    f.write(block.data(), block.size());
+  }
+  return f.good();
+}
+
+/**
+ * @brief Maps a file of interpolation weights and checks its header and
+ * layout. The blocks are only read when they are decoded
+ * @param filename file to open
+ * @return file, or nullptr if the file is unusable
+ */
+std::unique_ptr<WeightFile> WeightFile::open(const std::string &filename) {
+  auto file = std::make_shared<const MappedFile>(filename);
+  if (file->size() < sizeof(Header)) {
+    Logging::warning("Ignoring truncated interpolation cache file " +
+                     filename);
+    return nullptr;
+  }
+
+  Header header{};
+  std::memcpy(&header, file->data(), sizeof(Header));
+  const auto bits = header.weight_bits;
+  if (std::memcmp(header.magic, c_magic, sizeof(c_magic)) != 0 ||
+      header.version != c_version || header.ni == 0 || header.nj == 0 ||
+      header.band_rows == 0 ||
+      header.bands != (header.nj + header.band_rows - 1) / header.band_rows ||
+      header.weight_size != sizeof(weight_type) ||
+      (bits != 0 && bits != 16 && bits != 32) ||
+      header.codec > StreamCompression::LZ4) {
+    Logging::warning("Ignoring invalid interpolation cache file " + filename);
+    return nullptr;
+  }
+  const auto codec = static_cast<StreamCompression::Codec>(header.codec);
+  if (!StreamCompression::available(codec)) {
+    Logging::warning("Ignoring interpolation cache file " + filename +
+                     " compressed with " + StreamCompression::name(codec) +
+                     ", which this build does not support");
+    return nullptr;
+  }
+
+  auto weights = std::unique_ptr<WeightFile>(
+      new WeightFile(std::move(file), header));
+  const size_t n = header.ni * header.nj;
+  const size_t payload = sizeof(Header) + header.bands * sizeof(Band) +
+                         (n + 63) / 64 * sizeof(uint64_t);
+  bool complete = weights->m_file->size() >= payload;
+  for (size_t b = 0; complete && b < weights->bands(); ++b) {
+    const auto band = weights->band(b);
+    complete = band.offset >= payload &&
+               band.offset + band.size <= weights->m_file->size();
+  }
+  if (!complete) {
+    Logging::warning("Ignoring truncated interpolation cache file " +
+                     filename);
+    return nullptr;
+  }
+  return weights;
+}
+
+uint64_t WeightFile::key() const { return m_header.key; }
+
+WeightFile::Identity WeightFile::identity() const {
+  return {m_header.source, m_header.grid, m_header.method};
+}
+
+size_t WeightFile::ni() const { return m_header.ni; }
+
+size_t WeightFile::nj() const { return m_header.nj; }
+
+size_t WeightFile::bands() const { return m_header.bands; }
+
+/**
+ * @brief Rows held by a band
+ * @param band band index
+ * @return first row and one past the last row of the band
+ */
+std::pair<size_t, size_t> WeightFile::rows(const size_t band) const {
+  const size_t j0 = band * m_header.band_rows;
+  return {j0, std::min<size_t>(m_header.nj, j0 + m_header.band_rows)};
+}
+
+unsigned WeightFile::weight_bits() const { return m_header.weight_bits; }
+
+StreamCompression::Codec WeightFile::codec() const {
+  return static_cast<StreamCompression::Codec>(m_header.codec);
+}
+
+/**
+ * @brief Largest difference between a weight and the value it is decoded
+ * to, zero when the weights are kept exactly
+ */
+double WeightFile::max_error() const { return m_header.max_error; }
+
+WeightFile::Band WeightFile::band(const size_t b) const {
+  return get_value<Band>(m_file->data() + sizeof(Header) + b * sizeof(Band));
+}
+
+const unsigned char *WeightFile::mask_data() const {
+  return m_file->data() + sizeof(Header) + m_header.bands * sizeof(Band);
+}
+
+bool WeightFile::valid(const size_t cell) const {
+  const auto word =
+      get_value<uint64_t>(this->mask_data() + (cell >> 6) * sizeof(uint64_t));
+  return (word >> (cell & 63)) & 1U;
+}
+
+/**
+ * @brief Copies the validity mask of every cell
+ * @param weights weights on the grid of the file
+ */
+void WeightFile::read_mask(InterpolationWeights &weights) const {
+  std::memcpy(weights.mask(), this->mask_data(),
+              weights.mask_size() * sizeof(uint64_t));
+}
+
+/**
+ * @brief Decodes the indices and weights of the cells of one band. Bands
+ * touch disjoint cells, so they may be decoded concurrently into the same
+ * weights
+ * @param band band index
+ * @param weights weights on the grid of the file
+ * @return false if the block is damaged
+ */
+bool WeightFile::decode(const size_t band,
+                        InterpolationWeights &weights) const {
+  if (band >= this->bands() || weights.ni() != this->ni() ||
+      weights.nj() != this->nj()) {
+    return false;
+  }
+  const auto entry = this->band(band);
+  const auto [j0, j1] = this->rows(band);
+  const size_t ni = this->ni();
+
+  const unsigned char *p = m_file->data() + entry.offset;
+  const unsigned char *end = p + entry.size;
+  std::string block;
+  if (this->codec() != StreamCompression::NONE) {
+    try {
+      block = StreamCompression::decompress(
+          this->codec(), reinterpret_cast<const char *>(p), entry.size,
+          entry.raw_size);
+    } catch (const std::exception &) {
+      return false;
+    }
+    p = reinterpret_cast<const unsigned char *>(block.data());
+    end = p + block.size();
+  }
+  if (static_cast<size_t>(end - p) != entry.raw_size) return false;
+
+  for (size_t k = 0; k < 3; ++k) {
+    auto *index = weights.index(k);
+    for (size_t j = j0; j < j1; ++j) {
+      int64_t previous = 0;
+      for (size_t c = j * ni; c < (j + 1) * ni; ++c) {
+        if (!this->valid(c)) continue;
+        uint64_t delta;
+        if (!get_varint(p, end, delta)) return false;
+        const int64_t value = previous + unzigzag(delta);
+        if (value < 0 ||
+            value > static_cast<int64_t>(
+                        InterpolationWeights::invalid_index())) {
+          return false;
+        }
+        index[c] = static_cast<InterpolationWeights::index_type>(value);
+        previous = value;
+      }
+    }
+  }
+
+  const unsigned bits = this->weight_bits();
+  const size_t width = bits == 0 ? sizeof(weight_type) : bits / 8;
+  for (size_t k = 0; k < 3; ++k) {
+    auto *weight = weights.weight(k);
+    for (size_t c = j0 * ni; c < j1 * ni; ++c) {
+      if (!this->valid(c)) continue;
+      if (static_cast<size_t>(end - p) < width) return false;
+      if (bits == 0) {
+        weight[c] = get_value<weight_type>(p);
+      } else if (bits == 16) {
+        weight[c] = dequantize(entry.lo, entry.step, get_value<uint16_t>(p));
+      } else {
+        weight[c] = dequantize(entry.lo, entry.step, get_value<uint32_t>(p));
+      }
+      p += width;
+    }
+  }
+  return p == end;
+}
+
+/**
+ * @brief Decodes every band in parallel
+ * @return weights, or nullptr if any block is damaged
+ */
+std::unique_ptr<InterpolationWeights> WeightFile::read() const {
+  auto weights = std::make_unique<InterpolationWeights>(this->ni(), this->nj());
+  this->read_mask(*weights);
+  std::atomic<bool> intact{true};
+  ThreadPool::global().parallel_for(0, this->bands(), [&](const size_t b) {
+    if (!this->decode(b, *weights)) intact = false;
+  });
+  if (!intact) return nullptr;
+  return weights;
+}
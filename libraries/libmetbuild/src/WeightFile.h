@@ -0,0 +1,149 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_WEIGHTFILE_H_
+#define METBUILD_SRC_WEIGHTFILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "CppAttributes.h"
+#include "GridFingerprint.h"
+#include "InterpolationWeights.h"
+#include "MappedFile.h"
+#include "output/StreamCompression.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Versioned binary file of interpolation weights
+ *
+ * The file holds a header identifying the weights, a table of row bands, the
+ * validity mask of every cell and one block per band. A block stores the
+ * source indices of the valid cells delta encoded along each row as
+ * variable length integers, followed by their weights either in the source
+ * precision or quantized to 16 or 32 bits within the range of the band.
+ * Blocks may be compressed with any codec of StreamCompression
+ *
+ * Files are memory mapped and each band is decoded on its own, so readers
+ * may decode every band in parallel or only those they need
+ */
+class WeightFile {
+ public:
+  /**
+   * @brief Grids and method the weights were built for, recorded in the
+   * header. Zero when unknown
+   */
+  struct Identity {
+    GridFingerprint source = 0;
+    GridFingerprint grid = 0;
+    uint64_t method = 0;
+  };
+
+  /**
+   * @brief Encoding of the weights. A weight_bits of zero keeps the weights
+   * exactly in the source precision
+   */
+  struct Options {
+    unsigned weight_bits = 0;
+    StreamCompression::Codec codec = StreamCompression::NONE;
+    size_t band_cells = 65536;
+  };
+
+  static uint32_t version();
+
+  static bool write(const std::string &filename,
+                    const InterpolationWeights &weights, uint64_t key,
+                    const Identity &identity, const Options &options);
+
+  NODISCARD static std::unique_ptr<WeightFile> open(
+      const std::string &filename);
+
+  NODISCARD uint64_t key() const;
+  NODISCARD Identity identity() const;
+  NODISCARD size_t ni() const;
+  NODISCARD size_t nj() const;
+  NODISCARD size_t bands() const;
+  NODISCARD std::pair<size_t, size_t> rows(size_t band) const;
+  NODISCARD unsigned weight_bits() const;
+  NODISCARD StreamCompression::Codec codec() const;
+  NODISCARD double max_error() const;
+
+  void read_mask(InterpolationWeights &weights) const;
+
+  NODISCARD bool decode(size_t band, InterpolationWeights &weights) const;
+
+  NODISCARD std::unique_ptr<InterpolationWeights> read() const;
+
+ private:
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t source;
+    uint64_t grid;
+    uint64_t method;
+    uint64_t ni;
+    uint64_t nj;
+    uint32_t band_rows;
+    uint32_t bands;
+    uint32_t weight_bits;
+    uint32_t weight_size;
+    uint32_t codec;
+    uint32_t reserved;
+    double max_error;
+  };
+
+  struct Band {
+    uint64_t offset;
+    uint64_t size;
+    uint64_t raw_size;
+    double lo;
+    double step;
+  };
+
+  WeightFile(std::shared_ptr<const MappedFile> file, const Header &header);
+
+  NODISCARD Band band(size_t b) const;
+  NODISCARD bool valid(size_t cell) const;
+  NODISCARD const unsigned char *mask_data() const;
+
+  static std::string encode(const InterpolationWeights &weights, size_t j0,
+                            size_t j1, unsigned bits, Band &band,
+                            double &error);
+
+  std::shared_ptr<const MappedFile> m_file;
+  Header m_header;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_WEIGHTFILE_H_
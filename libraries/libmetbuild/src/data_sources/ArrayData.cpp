@@ -0,0 +1,311 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "ArrayData.h"
+
+#include <atomic>
+#include <mutex>
+#include <utility>
+
+#include "Geometry.h"
+#include "Hash.h"
+#include "Instrumentation.h"
+#include "Logging.h"
+#include "SharedCache.h"
+#include "Triangulation.h"
+
+using namespace MetBuild;
+
+namespace {
+//...Fields are registered by variable, so generic names stand in for the
+// names of a source file
+const VariableNames c_names("longitude", "latitude", "pressure", "u10", "v10",
+                            "precipitation", "humidity", "temperature", "ice");
+
+/**
+ * @brief Arrays registered under a name, with the generation telling apart
+ * arrays registered again under the same name
+ */
+struct Registration {
+  std::shared_ptr<const ArrayData::Arrays> arrays;
+  uint64_t generation = 0;
+};
+
+std::mutex s_registry_mutex;
+std::unordered_map<std::string, Registration> s_registry;
+std::atomic<uint64_t> s_generation{0};
+
+std::shared_ptr<const ArrayData::Arrays> lookup(const std::string &name) {
+  std::lock_guard<std::mutex> lock(s_registry_mutex);
+  auto it = s_registry.find(name);
+  if (it == s_registry.end()) {
+    metbuild_throw_exception("No arrays are registered under the name '" +
+                             name + "'");
+  }
+  return it->second.arrays;
+}
+
+template <typename T>
+void convert(const ArrayData::Arrays::Field &field, const size_t n,
+             const double scale, std::vector<T> &out) {
+  out.resize(n);
+  if (field.single_precision) {
+    const auto *v = static_cast<const float *>(field.data);
+    for (size_t i = 0; i < n; ++i) out[i] = static_cast<T>(v[i] * scale);
+  } else {
+    const auto *v = static_cast<const double *>(field.data);
+    for (size_t i = 0; i < n; ++i) out[i] = static_cast<T>(v[i] * scale);
+  }
+}
+
+std::vector<std::vector<double>> map_to_2d(const std::vector<double> &v,
+                                           size_t ni, size_t nj) {
+  std::vector<std::vector<double>> arr2d(nj, std::vector<double>(ni, 0.0));
+  for (size_t i = 0; i < v.size(); ++i) {
+    arr2d[i / ni][i % ni] = v[i];
+  }
+  return arr2d;
+}
+}  // namespace
+
+ArrayData::ArrayData(const std::string &name)
+    : ArrayData(name, lookup(name)) {}
+
+ArrayData::ArrayData(const std::string &name,
+                     std::shared_ptr<const Arrays> arrays)
+    : GriddedData(name, c_names, VariableUnits(), arrays->convention),
+      m_arrays(std::move(arrays)) {
+  const auto ni = m_arrays->ni;
+  const auto nj = m_arrays->nj;
+  const size_t n = ni * nj;
+  this->setNi(ni);
+  this->setNj(nj);
+  this->setSize(n);
+  this->setSourceSubtype(GriddedDataTypes::SOURCE_SUBTYPE::GRIB);
+
+  const auto grid_key = Hash()
+                            .add(ni)
+                            .add(nj)
+                            .add(static_cast<int>(m_arrays->convention))
+                            .add(m_arrays->longitude, n * sizeof(double))
+                            .add(m_arrays->latitude, n * sizeof(double))
+                            .value();
+
+  static SharedCache<const GridDefinition> s_grids(
+      "array_grid", [](const GridDefinition &g) {
+        return (g.latitude.size() + g.longitude.size()) * sizeof(double);
+      });
+  m_grid = s_grids.acquire(std::to_string(grid_key), [&]() {
+    auto g = std::make_shared<GridDefinition>();
+    const auto *x = m_arrays->longitude;
+    const auto *y = m_arrays->latitude;
+    g->longitude.assign(x, x + n);
+    g->latitude.assign(y, y + n);
+
+    const auto point = [&](const size_t i, const size_t j) {
+      return Point(x[j * ni + i], y[j * ni + i]);
+    };
+    g->corners = {point(0, 0), point(ni - 1, 0), point(ni - 1, nj - 1),
+                  point(0, nj - 1)};
+
+    //...The outline walks the edges of the grid anticlockwise from the
+    // first point, so curvilinear grids are followed closely
+    std::vector<Point> region;
+    region.reserve(2 * (ni + nj));
+    for (size_t i = 0; i < ni; ++i) region.push_back(point(i, 0));
+    for (size_t j = 1; j < nj; ++j) region.push_back(point(ni - 1, j));
+    for (size_t i = ni - 1; i-- > 0;) region.push_back(point(i, nj - 1));
+    for (size_t j = nj - 1; j-- > 1;) region.push_back(point(0, j));
+    g->geometry = std::make_shared<const Geometry>(region);
+    g->outline = std::make_shared<const std::vector<Point>>(std::move(region));
+    return std::shared_ptr<const GridDefinition>(std::move(g));
+  });
+  this->setFingerprint(grid_key);
+  this->findCorners();
+  this->set_bounding_region(m_grid->outline, m_grid->geometry);
+}
+
+ArrayData::~ArrayData() = default;
+
+const std::vector<double> &ArrayData::latitude1d() const {
+  return m_grid->latitude;
+}
+
+const std::vector<double> &ArrayData::longitude1d() const {
+  return m_grid->longitude;
+}
+
+std::vector<std::vector<double>> ArrayData::latitude2d() {
+  return map_to_2d(this->latitude1d(), ni(), nj());
+}
+
+std::vector<std::vector<double>> ArrayData::longitude2d() {
+  return map_to_2d(this->longitude1d(), ni(), nj());
+}
+
+void ArrayData::findCorners() { this->setCorners(m_grid->corners); }
+
+const ArrayData::Arrays::Field &ArrayData::field(
+    const std::string &name) const {
+  const Arrays::Field *found = nullptr;
+  for (const auto &f : m_arrays->fields) {
+    if (c_names.find_variable(
+            static_cast<GriddedDataTypes::VARIABLES>(f.first)) == name) {
+      found = &f.second;
+    }
+  }
+  if (found == nullptr) {
+    metbuild_throw_exception("The arrays registered as '" +
+                             this->filenames()[0] +
+                             "' do not contain the variable: '" + name + "'");
+  }
+  return *found;
+}
+
+std::vector<double> ArrayData::getArray1d(const std::string &name) {
+  const auto &f = this->field(name);
+  Instrumentation::ScopedTimer timer(Instrumentation::DECODE, size());
+  auto values = this->acquireBuffer();
+  convert(f, size(), 1.0, values);
+  return values;
+}
+
+std::vector<std::vector<double>> ArrayData::getArray2d(
+    const std::string &name) {
+  return map_to_2d(this->getArray1d(name), ni(), nj());
+}
+
+/**
+ * @brief Reads a field from the caller buffer straight into the source
+ * precision, without the double precision copy of getArray1d
+ */
+std::vector<SourceDataType> ArrayData::releaseSourceArray1d(
+    const std::string &name, const double unit_conversion) {
+  const auto &f = this->field(name);
+  Instrumentation::ScopedTimer timer(Instrumentation::DECODE, size());
+  auto values = this->acquireBuffer<SourceDataType>();
+  convert(f, size(), unit_conversion, values);
+  return values;
+}
+
+Triangulation ArrayData::generate_triangulation(
+    const Triangulation::Extent &extent) const {
+  if (Triangulation::isRectilinear(this->longitude1d(), this->latitude1d(),
+                                   ni(), nj())) {
+    return Triangulation::structured(this->longitude1d(), this->latitude1d(),
+                                     ni(), nj());
+  }
+  return Triangulation::connected(this->longitude1d(), this->latitude1d(),
+                                  ni(), nj(), extent);
+}
+
+/**
+ * @brief Registers caller owned arrays under a name, which is then read as
+ * a source file of that name. Arrays already registered under the name are
+ * replaced, and sources still reading them keep the previous arrays
+ * @param name name standing in for a source file
+ * @param arrays coordinates and fields of the snapshot
+ */
+void ArrayData::add(const std::string &name, Arrays arrays) {
+  if (arrays.ni < 2 || arrays.nj < 2) {
+    metbuild_throw_exception("Registered arrays need at least 2 x 2 points");
+  }
+  if (arrays.longitude == nullptr || arrays.latitude == nullptr) {
+    metbuild_throw_exception("Registered arrays need both coordinates");
+  }
+  for (const auto &f : arrays.fields) {
+    if (f.second.data == nullptr) {
+      metbuild_throw_exception("Registered arrays may not hold null fields");
+    }
+  }
+  auto ptr = std::make_shared<const Arrays>(std::move(arrays));
+  std::lock_guard<std::mutex> lock(s_registry_mutex);
+  s_registry[name] = {std::move(ptr), ++s_generation};
+}
+
+void ArrayData::remove(const std::string &name) {
+  std::lock_guard<std::mutex> lock(s_registry_mutex);
+  s_registry.erase(name);
+}
+
+void ArrayData::clear() {
+  std::lock_guard<std::mutex> lock(s_registry_mutex);
+  s_registry.clear();
+}
+
+bool ArrayData::contains(const std::string &name) {
+  std::lock_guard<std::mutex> lock(s_registry_mutex);
+  return s_registry.find(name) != s_registry.end();
+}
+
+/**
+ * @brief Generation of the arrays registered under a name, which changes
+ * each time arrays are registered so that sources decoded from earlier
+ * arrays of the same name are not reused
+ * @param name registered name
+ * @return generation, zero when nothing is registered under the name
+ */
+uint64_t ArrayData::generation(const std::string &name) {
+  std::lock_guard<std::mutex> lock(s_registry_mutex);
+  auto it = s_registry.find(name);
+  return it == s_registry.end() ? 0 : it->second.generation;
+}
+
+/**
+ * @brief Describes registered arrays in the same terms as a source file
+ * @param name registered name
+ * @return description of the arrays
+ */
+SourceProbe ArrayData::probe(const std::string &name) {
+  const auto arrays = lookup(name);
+  const auto *x = arrays->longitude;
+  const auto *y = arrays->latitude;
+  const size_t n = arrays->ni * arrays->nj;
+
+  SourceProbe probe;
+  probe.ni = arrays->ni;
+  probe.nj = arrays->nj;
+  probe.size = n;
+  probe.firstLongitude = x[0];
+  probe.firstLatitude = y[0];
+  probe.lastLongitude = x[n - 1];
+  probe.lastLatitude = y[n - 1];
+  probe.dx = x[1] - x[0];
+  probe.dy = y[arrays->ni] - y[0];
+  probe.addVariables(c_names, [&](const std::string &variable) {
+    for (const auto &f : arrays->fields) {
+      if (c_names.find_variable(static_cast<GriddedDataTypes::VARIABLES>(
+              f.first)) == variable) {
+        probe.fields.push_back(variable);
+        return true;
+      }
+    }
+    return false;
+  });
+  return probe;
+}
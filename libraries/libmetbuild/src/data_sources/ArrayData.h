@@ -0,0 +1,150 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_ARRAYDATA_H_
+#define METBUILD_SRC_ARRAYDATA_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GriddedData.h"
+#include "SourceProbe.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Source read from arrays held in memory by the caller, such as the
+ * fields of a model coupled to MetGet or arrays built in Python
+ *
+ * Arrays registered with add stand in for a source file of the same name,
+ * so the name can be passed anywhere a file is, and every interpolation and
+ * output path reads them without writing a file first. The values are read
+ * from the caller buffers when a source is decoded, straight into the
+ * source precision, and the coordinates are copied once for each grid since
+ * the locators are built over vectors. Arrays are not copied on
+ * registration, so the caller keeps the buffers alive, and unchanged, until
+ * the name is removed and no request is still reading it
+ *
+ * Every array holds ni * nj values, nj rows of ni values as in the grib
+ * sources. Values are in the units of the grib sources, with pressure in Pa
+ * and rainfall as a rate in mm/hr
+ */
+class ArrayData : public GriddedData {
+ public:
+  /**
+   * @brief Caller owned arrays making up one snapshot
+   */
+  struct Arrays {
+    /**
+     * @brief One caller owned field, in single or double precision
+     */
+    struct Field {
+      const void *data = nullptr;
+      bool single_precision = false;
+    };
+
+    size_t ni = 0;
+    size_t nj = 0;
+    const double *longitude = nullptr;
+    const double *latitude = nullptr;
+    COORDINATE_CONVENTION convention = CONVENTION_180;
+    std::unordered_map<int, Field> fields;
+
+    //...Optional handle on whatever owns the buffers, released with the
+    // last source reading them
+    std::shared_ptr<const void> owner;
+
+    void set(GriddedDataTypes::VARIABLES v, const double *values) {
+      fields[static_cast<int>(v)] = {values, false};
+    }
+
+    void set(GriddedDataTypes::VARIABLES v, const float *values) {
+      fields[static_cast<int>(v)] = {values, true};
+    }
+  };
+
+  explicit ArrayData(const std::string &name);
+
+  ~ArrayData() override;
+
+  std::vector<std::vector<double>> latitude2d() override;
+  const std::vector<double> &latitude1d() const override;
+
+  std::vector<std::vector<double>> longitude2d() override;
+  const std::vector<double> &longitude1d() const override;
+
+  MetBuild::Triangulation generate_triangulation(
+      const MetBuild::Triangulation::Extent &extent) const override;
+
+  static void add(const std::string &name, Arrays arrays);
+
+  static void remove(const std::string &name);
+
+  static void clear();
+
+  NODISCARD static bool contains(const std::string &name);
+
+  NODISCARD static uint64_t generation(const std::string &name);
+
+  NODISCARD static MetBuild::SourceProbe probe(const std::string &name);
+
+ private:
+  void findCorners() override;
+
+  std::vector<double> getArray1d(const std::string &name) override;
+  std::vector<std::vector<double>> getArray2d(const std::string &name) override;
+
+  std::vector<MetBuild::SourceDataType> releaseSourceArray1d(
+      const std::string &name, double unit_conversion) override;
+
+  ArrayData(const std::string &name, std::shared_ptr<const Arrays> arrays);
+
+  const Arrays::Field &field(const std::string &name) const;
+
+  /**
+   * @brief Coordinates and outline of a grid, shared by every snapshot on
+   * the same grid
+   */
+  struct GridDefinition {
+    std::vector<double> longitude;
+    std::vector<double> latitude;
+    std::array<MetBuild::Point, 4> corners;
+    std::shared_ptr<const std::vector<MetBuild::Point>> outline;
+    std::shared_ptr<const MetBuild::Geometry> geometry;
+  };
+
+  std::shared_ptr<const Arrays> m_arrays;
+  std::shared_ptr<const GridDefinition> m_grid;
+};
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_ARRAYDATA_H_
@@ -28,49 +28,203 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "CoampsData.h"
 
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <utility>
 
+#include "Hash.h"
+#include "Logging.h"
+#include "SharedCache.h"
+#include "ThreadPool.h"
 #include "Triangulation.h"
+#include "netcdf.h"
 
 using namespace MetBuild;
 
+namespace {
+/**
+ * @brief Bounding box of an inner domain
+ */
+struct Rectangle {
+  double xmin;
+  double ymin;
+  double xmax;
+  double ymax;
+
+  NODISCARD bool contains(const double x, const double y) const {
+    return x >= xmin && x <= xmax && y >= ymin && y <= ymax;
+  }
+
+  NODISCARD bool contains(const Rectangle &r) const {
+    return r.xmin >= xmin && r.xmax <= xmax && r.ymin >= ymin &&
+           r.ymax <= ymax;
+  }
+};
+}  // namespace
+
 CoampsData::CoampsData(std::vector<std::string> filenames)
-    : GriddedData(std::move(filenames),
-                  VariableNames("lon", "lat", "slpres", "uuwind", "vvwind",
-                                "precip", "relhum", "airtmp", ""),
+    : GriddedData(std::move(filenames), CoampsData::sourceVariables(),
                   VariableUnits(1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0)) {
   this->initialize();
   this->setSourceSubtype(MetBuild::GriddedDataTypes::SOURCE_SUBTYPE::COAMPS);
 }
 
+/**
+ * @brief Names of the source variables in the COAMPS netCDF files
+ */
+VariableNames CoampsData::sourceVariables() {
+  return {"lon",    "lat",    "slpres", "uuwind", "vvwind",
+          "precip", "relhum", "airtmp", ""};
+}
+
+/**
+ * @brief Describes one COAMPS domain from its dimensions, variables and the
+ * coordinates at its corners, without reading the full coordinate arrays
+ * @param filename netCDF file of the domain
+ * @return description of the domain
+ */
+SourceProbe CoampsData::probe(const std::string& filename) {
+  auto file = NetcdfFile::open(filename);
+  std::lock_guard<std::mutex> lock(file->mutex());
+
+  SourceProbe probe;
+  probe.ni = file->getDimensionSize(file->getDimid("lon"));
+  probe.nj = file->getDimensionSize(file->getDimid("lat"));
+  probe.size = probe.ni * probe.nj;
+
+  int nvars = 0;
+  if (nc_inq_nvars(file->ncid(), &nvars) != NC_NOERR) {
+    Logging::throwError("Could not read the variables of " + filename);
+  }
+  for (int i = 0; i < nvars; ++i) {
+    char name[NC_MAX_NAME + 1];
+    if (nc_inq_varname(file->ncid(), i, name) == NC_NOERR) {
+      probe.fields.emplace_back(name);
+    }
+  }
+  probe.addVariables(CoampsData::sourceVariables(),
+                     [&](const std::string& name) {
+                       int varid = 0;
+                       return nc_inq_varid(file->ncid(), name.c_str(),
+                                           &varid) == NC_NOERR;
+                     });
+
+  if (probe.size == 0) return probe;
+
+  auto value = [&](const int varid, const size_t j, const size_t i) {
+    const size_t index[2] = {j, i};
+    double v = 0.0;
+    if (nc_get_var1_double(file->ncid(), varid, index, &v) != NC_NOERR) {
+      Logging::throwError("Could not read coordinates from COAMPS file");
+    }
+    return v;
+  };
+
+  const int varid_lon = file->getVarid("lon");
+  const int varid_lat = file->getVarid("lat");
+  probe.firstLongitude = value(varid_lon, 0, 0);
+  probe.firstLatitude = value(varid_lat, 0, 0);
+  probe.lastLongitude = value(varid_lon, probe.nj - 1, probe.ni - 1);
+  probe.lastLatitude = value(varid_lat, probe.nj - 1, probe.ni - 1);
+  if (probe.ni > 1) {
+    probe.dx = (probe.lastLongitude - probe.firstLongitude) /
+               static_cast<double>(probe.ni - 1);
+  }
+  if (probe.nj > 1) {
+    probe.dy = (probe.lastLatitude - probe.firstLatitude) /
+               static_cast<double>(probe.nj - 1);
+  }
+  return probe;
+}
+
+/**
+ * @brief Opens the domains and sets their coordinates and masks. The nests
+ * of a cycle usually stay in place for several forecast periods, so the
+ * geometry is shared by every file set whose domains have the same
+ * fingerprints and only the field variables are read for the later ones
+ */
 void CoampsData::initialize() {
+  static SharedCache<const CycleGeometry> s_geometry(
+      "coamps_grid", [](const CycleGeometry& g) {
+        size_t bytes =
+            (g.longitude.size() + g.latitude.size()) * sizeof(double);
+        for (size_t d = 0; d < g.coordinates.size(); ++d) {
+          bytes += 2 * g.coordinates[d]->longitude.size() * sizeof(double) +
+                   g.masks[d].size();
+        }
+        return bytes;
+      });
+
   for (const auto& f : this->filenames()) {
     m_domains.emplace_back(f);
   }
-  this->computeMasking();
-  this->computeCoordinates();
-  this->set_bounding_region(m_domains[0].get_bounding_region());
+
+  Hash h;
+  h.add(static_cast<int>(this->convention())).add(m_domains.size());
+  for (const auto& d : m_domains) {
+    h.add(d.fingerprint());
+  }
+  const auto key = h.value();
+
+  m_geometry = s_geometry.acquire(std::to_string(key),
+                                  [this]() { return this->buildGeometry(); });
+  for (size_t d = 0; d < m_domains.size(); ++d) {
+    m_domains[d].setCoordinates(m_geometry->coordinates[d]);
+    m_domains[d].setMask(m_geometry->masks[d]);
+  }
+
+  //...The fingerprint stands in for the hash of the merged coordinates, so
+  //   the interpolation weights are found without rehashing them
+  this->setFingerprint(key);
+  this->setSize(m_geometry->longitude.size());
+  this->setNi(0);
+  this->setNj(0);
+  this->set_bounding_region(m_geometry->region, m_geometry->region_geometry);
 }
 
 std::vector<std::vector<double>> CoampsData::latitude2d() { return {}; }
 
-const std::vector<double>& CoampsData::latitude1d() const { return m_latitude; }
+const std::vector<double>& CoampsData::latitude1d() const {
+  return m_geometry->latitude;
+}
 
 std::vector<std::vector<double>> CoampsData::longitude2d() { return {}; }
 
 const std::vector<double>& CoampsData::longitude1d() const {
-  return m_longitude;
+  return m_geometry->longitude;
 }
 
 void CoampsData::findCorners() { return; }
 
+/**
+ * @brief Reads a variable from every domain into one buffer, skipping the
+ * masked points
+ *
+ * netCDF is not thread safe, so the files are read in turn and only the
+ * gather of each domain into its part of the buffer runs in parallel
+ *
+ * @param variable variable name
+ * @return unmasked values of every domain, in domain order
+ */
 std::vector<double> CoampsData::getArray1d(const std::string& variable) {
-  std::vector<double> result;
-  for (const auto& d : m_domains) {
-    const auto values = d.get(variable);
-    result.reserve(result.size() + values.size());
-    result.insert(result.end(), values.begin(), values.end());
+  std::vector<size_t> offset(m_domains.size() + 1, 0);
+  for (size_t d = 0; d < m_domains.size(); ++d) {
+    offset[d + 1] = offset[d] + m_domains[d].n_unmasked_points();
   }
+
+  std::vector<std::vector<float>> raw(m_domains.size());
+  for (size_t d = 0; d < m_domains.size(); ++d) {
+    raw[d].resize(m_domains[d].size());
+    m_domains[d].read(variable, raw[d].data());
+  }
+
+  auto result = this->acquireBuffer();
+  result.resize(offset.back());
+  ThreadPool::global().parallel_for(0, m_domains.size(), [&](const size_t d) {
+    m_domains[d].gather(raw[d].data(), result.data() + offset[d]);
+  });
   return result;
 }
 
@@ -79,37 +233,112 @@ std::vector<std::vector<double>> CoampsData::getArray2d(
   return {};
 }
 
-void CoampsData::computeMasking() {
-  size_t nmask = 0;
-  for (size_t dom = 0; dom < m_domains.size() - 1; ++dom) {
-    for (size_t p = 0; p < m_domains[dom].size(); ++p) {
-      const auto point =
-          Point(m_domains[dom].longitude(p), m_domains[dom].latitude(p));
-      for (auto inner_dom = dom + 1; inner_dom < m_domains.size();
-           ++inner_dom) {
-        if (point.x() >= m_domains[inner_dom].point_ll().x() &&
-            point.x() <= m_domains[inner_dom].point_ur().x() &&
-            point.y() >= m_domains[inner_dom].point_ll().y() &&
-            point.y() <= m_domains[inner_dom].point_ur().y()) {
-          m_domains[dom].setMask(p, true);
-          nmask++;
-        }
-      }
+/**
+ * @brief Reads the coordinates of every domain and masks the points of each
+ * domain covered by any domain nested inside it
+ * @return geometry of the domains
+ */
+std::shared_ptr<const CoampsData::CycleGeometry> CoampsData::buildGeometry() {
+  auto g = std::make_shared<CycleGeometry>();
+  for (auto &d : m_domains) {
+    g->coordinates.push_back(d.readCoordinates());
+    d.setCoordinates(g->coordinates.back());
+  }
+
+  if (m_domains.size() < 2) {
+    for (const auto &d : m_domains) {
+      g->masks.emplace_back(d.size(), 0);
     }
+  } else {
+    g->masks = this->generateMasks();
   }
+
+  for (size_t d = 0; d < m_domains.size(); ++d) {
+    const auto &c = *g->coordinates[d];
+    const auto &mask = g->masks[d];
+    for (size_t p = 0; p < mask.size(); ++p) {
+      if (mask[p]) continue;
+      g->longitude.push_back(c.longitude[p]);
+      g->latitude.push_back(c.latitude[p]);
+    }
+  }
+
+  auto region = std::make_shared<const std::vector<Point>>(
+      m_domains[0].get_bounding_region());
+  if (region->size() >= 3) {
+    g->region_geometry = std::make_shared<const Geometry>(*region);
+  }
+  g->region = std::move(region);
+  return g;
 }
 
-void CoampsData::computeCoordinates() {
-  for (auto& d : m_domains) {
-    const auto [lon, lat] = d.getUnmaskedCoordinates();
-    m_longitude.insert(m_longitude.end(), lon.begin(), lon.end());
-    m_latitude.insert(m_latitude.end(), lat.begin(), lat.end());
+/**
+ * @brief Tests every point of each domain once against the boxes of the
+ * domains nested inside it, skipping boxes contained in another one
+ * @return mask of each domain
+ */
+std::vector<std::vector<char>> CoampsData::generateMasks() const {
+  std::vector<std::vector<char>> masks(m_domains.size());
+  for (size_t dom = 0; dom < m_domains.size(); ++dom) {
+    const auto &domain = m_domains[dom];
+    masks[dom].assign(domain.size(), 0);
+
+    std::vector<Rectangle> inner;
+    for (auto inner_dom = dom + 1; inner_dom < m_domains.size();
+         ++inner_dom) {
+      const auto &ll = m_domains[inner_dom].point_ll();
+      const auto &ur = m_domains[inner_dom].point_ur();
+      const Rectangle r{ll.x(), ll.y(), ur.x(), ur.y()};
+      if (std::none_of(inner.begin(), inner.end(),
+                       [&](const Rectangle &o) { return o.contains(r); })) {
+        inner.erase(
+            std::remove_if(inner.begin(), inner.end(),
+                           [&](const Rectangle &o) { return r.contains(o); }),
+            inner.end());
+        inner.push_back(r);
+      }
+    }
+    if (inner.empty()) continue;
+
+    auto *mask = masks[dom].data();
+    ThreadPool::global().parallel_for(
+        0, domain.size(),
+        [&](const size_t p) {
+          const double x = domain.longitude(p);
+          const double y = domain.latitude(p);
+          bool covered = false;
+          for (const auto &r : inner) {
+            covered |= r.contains(x, y);
+          }
+          mask[p] = static_cast<char>(covered);
+        },
+        4096);
   }
-  this->setSize(m_longitude.size());
-  this->setNi(0);
-  this->setNj(0);
+  return masks;
 }
 
-Triangulation CoampsData::generate_triangulation() const {
-  return {m_longitude, m_latitude, this->bounding_region()};
+/**
+ * @brief Locates the output points in each domain through its own regular
+ * grid, finest domain first, triangulating only the points along the seams
+ * between the domains
+ */
+Triangulation CoampsData::generate_triangulation(
+    const Triangulation::Extent & /*extent*/) const {
+  std::vector<Triangulation::Nest> nests;
+  nests.reserve(m_domains.size());
+  size_t offset = 0;
+  for (const auto &d : m_domains) {
+    Triangulation::Nest n{{}, {}, d.nlon(), d.nlat(), {}};
+    n.x.resize(d.size());
+    n.y.resize(d.size());
+    n.index.resize(d.size());
+    for (size_t p = 0; p < d.size(); ++p) {
+      n.x[p] = d.longitude(p);
+      n.y[p] = d.latitude(p);
+      n.index[p] = d.masked(p) ? Triangulation::invalid_point() : offset++;
+    }
+    nests.push_back(std::move(n));
+  }
+  return Triangulation::nested(nests, m_geometry->longitude,
+                               m_geometry->latitude, this->bounding_region());
 }
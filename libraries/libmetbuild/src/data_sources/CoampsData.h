@@ -29,11 +29,14 @@
 #ifndef METGET_SRC_COAMPSDATA_H_
 #define METGET_SRC_COAMPSDATA_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "CoampsDomain.h"
+#include "CppAttributes.h"
 #include "GriddedData.h"
+#include "SourceProbe.h"
 
 namespace MetBuild {
 
@@ -41,6 +44,10 @@ class CoampsData : public GriddedData {
  public:
   explicit CoampsData(std::vector<std::string> filenames);
 
+  static MetBuild::VariableNames sourceVariables();
+
+  static MetBuild::SourceProbe probe(const std::string &filename);
+
   std::vector<std::vector<double>> latitude2d() override;
   const std::vector<double> &latitude1d() const override;
 
@@ -49,22 +56,35 @@ class CoampsData : public GriddedData {
 
   ~CoampsData() override = default;
 
-  MetBuild::Triangulation generate_triangulation() const override;
+  MetBuild::Triangulation generate_triangulation(
+      const MetBuild::Triangulation::Extent &extent) const override;
 
  private:
+  /**
+   * @brief Coordinates, masks and outline of the domains of a forecast
+   * period, shared by the periods in which no domain moves
+   */
+  struct CycleGeometry {
+    std::vector<std::shared_ptr<const CoampsDomain::Coordinates>> coordinates;
+    std::vector<std::vector<char>> masks;
+    std::vector<double> longitude;
+    std::vector<double> latitude;
+    std::shared_ptr<const std::vector<MetBuild::Point>> region;
+    std::shared_ptr<const MetBuild::Geometry> region_geometry;
+  };
+
   void initialize();
 
   void findCorners() override;
 
-  void computeMasking();
-  void computeCoordinates();
+  NODISCARD std::shared_ptr<const CycleGeometry> buildGeometry();
+  NODISCARD std::vector<std::vector<char>> generateMasks() const;
 
   std::vector<double> getArray1d(const std::string &variable) override;
   std::vector<std::vector<double>> getArray2d(
       const std::string &variable) override;
 
-  std::vector<double> m_longitude;
-  std::vector<double> m_latitude;
+  std::shared_ptr<const CycleGeometry> m_geometry;
   std::vector<std::vector<double>> m_variables;
   std::vector<CoampsDomain> m_domains;
 };
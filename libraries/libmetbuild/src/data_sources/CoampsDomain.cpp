@@ -30,7 +30,12 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <mutex>
+#include <utility>
 
+#include "Hash.h"
+#include "Instrumentation.h"
 #include "Logging.h"
 #include "Point.h"
 #include "netcdf.h"
@@ -39,40 +44,110 @@ using namespace MetBuild;
 
 CoampsDomain::CoampsDomain(std::string filename)
     : m_filename(std::move(filename)),
-      m_ncid(std::make_unique<NetcdfFile>(m_filename)),
+      m_ncid(NetcdfFile::open(m_filename)),
       m_dimid_lat(m_ncid->getDimid("lat")),
       m_dimid_lon(m_ncid->getDimid("lon")),
       m_nlon(m_ncid->getDimensionSize(m_dimid_lon)),
       m_nlat(m_ncid->getDimensionSize(m_dimid_lat)),
+      m_mask_count(0),
       m_varid_lat(m_ncid->getVarid("lat")),
-      m_varid_lon(m_ncid->getVarid("lon")) {
-  this->initialize();
+      m_varid_lon(m_ncid->getVarid("lon")),
+      m_fingerprint(this->computeFingerprint()) {
+  m_mask.resize(this->size());
 }
 
-void CoampsDomain::initialize() {
-  size_t start[2] = {0, 0};
-  size_t count[2] = {m_nlat, m_nlon};
+/**
+ * @brief Identity of the domain position, from its dimensions and the
+ * coordinates at its corners and center. A nest that moves between forecast
+ * periods changes all of them, so files with the same fingerprint share
+ * their coordinates without reading the full arrays
+ */
+uint64_t CoampsDomain::fingerprint() const { return m_fingerprint; }
+
+uint64_t CoampsDomain::computeFingerprint() const {
+  Hash h;
+  h.add(m_nlon).add(m_nlat);
+  if (this->size() == 0) return h.value();
+
+  const std::array<std::array<size_t, 2>, 5> points = {
+      {{0, 0},
+       {0, m_nlon - 1},
+       {m_nlat - 1, 0},
+       {m_nlat - 1, m_nlon - 1},
+       {m_nlat / 2, m_nlon / 2}}};
+  std::lock_guard<std::mutex> lock(m_ncid->mutex());
+  for (const auto& index : points) {
+    for (const auto varid : {m_varid_lon, m_varid_lat}) {
+      double v = 0.0;
+      if (nc_get_var1_double(m_ncid->ncid(), varid, index.data(), &v) !=
+          NC_NOERR) {
+        Logging::throwError("Could not read coordinates from COAMPS file");
+      }
+      h.add(v);
+    }
+  }
+  return h.value();
+}
 
-  m_latitude.resize(this->size());
-  m_longitude.resize(this->size());
-  m_mask.resize(this->size());
+/**
+ * @brief Reads the full coordinate arrays of the domain
+ * @return coordinates, with the longitudes normalized to -180/180
+ */
+std::shared_ptr<const CoampsDomain::Coordinates>
+CoampsDomain::readCoordinates() const {
+  const size_t start[2] = {0, 0};
+  const size_t count[2] = {m_nlat, m_nlon};
 
-  int ierr = nc_get_vara_double(m_ncid->ncid(), m_varid_lat, start, count,
-                                m_latitude.data());
-  if (ierr != NC_NOERR) {
-    Logging::throwError("Could not read latitude values from COAMPS file");
-  }
+  auto c = std::make_shared<Coordinates>();
+  c->latitude.resize(this->size());
+  c->longitude.resize(this->size());
 
-  ierr = nc_get_vara_double(m_ncid->ncid(), m_varid_lon, start, count,
-                            m_longitude.data());
-  if (ierr != NC_NOERR) {
-    Logging::throwError("Could not read longitude files from COAMPS file");
+  {
+    std::lock_guard<std::mutex> lock(m_ncid->mutex());
+    int ierr = nc_get_vara_double(m_ncid->ncid(), m_varid_lat, start, count,
+                                  c->latitude.data());
+    if (ierr != NC_NOERR) {
+      Logging::throwError("Could not read latitude values from COAMPS file");
+    }
+
+    ierr = nc_get_vara_double(m_ncid->ncid(), m_varid_lon, start, count,
+                              c->longitude.data());
+    if (ierr != NC_NOERR) {
+      Logging::throwError("Could not read longitude files from COAMPS file");
+    }
   }
 
-  for (auto& v : m_longitude) {
+  for (auto& v : c->longitude) {
     v = CoampsDomain::normalize_longitude(v);
   }
-  this->findCorners();
+
+  const auto& x = c->longitude;
+  const auto& y = c->latitude;
+  const double xtl = x[m_nlon * (m_nlat - 1)];
+  const double xtr = x[m_nlon * m_nlat - 1];
+  const double xll = x[0];
+  const double xlr = x[m_nlon - 1];
+
+  const double ytl = y[m_nlon * (m_nlat - 1)];
+  const double ytr = y[m_nlon * m_nlat - 1];
+  const double yll = y[0];
+  const double ylr = y[m_nlon - 1];
+
+  c->corners = {Point(xll, yll), Point(xlr, ylr), Point(xtr, ytr),
+                Point(xtl, ytl)};
+  c->point_ll = Point(xll, yll);
+  c->point_ur = Point(xtr, ytr);
+  return c;
+}
+
+/**
+ * @brief Sets the coordinates of the domain, read from this file or from an
+ * earlier file with the same fingerprint
+ */
+void CoampsDomain::setCoordinates(
+    std::shared_ptr<const Coordinates> coordinates) {
+  assert(coordinates->longitude.size() == this->size());
+  m_coordinates = std::move(coordinates);
 }
 
 /**
@@ -86,26 +161,11 @@ double CoampsDomain::normalize_longitude(const double longitude) {
   return lon > 180.0 ? lon -= 360.0 : lon;
 }
 
-void CoampsDomain::findCorners() {
-  const double xtl = m_longitude[m_nlon * (m_nlat - 1)];
-  const double xtr = m_longitude[m_nlon * m_nlat - 1];
-  const double xll = m_longitude[0];
-  const double xlr = m_longitude[m_nlon - 1];
-
-  const double ytl = m_latitude[m_nlon * (m_nlat - 1)];
-  const double ytr = m_latitude[m_nlon * m_nlat - 1];
-  const double yll = m_latitude[0];
-  const double ylr = m_latitude[m_nlon - 1];
-
-  m_corners = {Point(xll, yll), Point(xlr, ylr), Point(xtr, ytr),
-               Point(xtl, ytl)};
-  m_point_ll = Point(xll, yll);
-  m_point_ur = Point(xtr, ytr);
-}
-
 NetcdfFile* CoampsDomain::ncid() { return this->m_ncid.get(); }
 
-std::array<Point, 4> CoampsDomain::corners() const { return m_corners; }
+std::array<Point, 4> CoampsDomain::corners() const {
+  return m_coordinates->corners;
+}
 
 size_t CoampsDomain::nlat() const { return m_nlat; }
 
@@ -114,32 +174,45 @@ size_t CoampsDomain::nlon() const { return m_nlon; }
 size_t CoampsDomain::size() const { return m_nlon * m_nlat; }
 
 double CoampsDomain::longitude(size_t index) const {
-  assert(index < m_longitude.size());
-  return m_longitude[index];
+  assert(index < m_coordinates->longitude.size());
+  return m_coordinates->longitude[index];
 }
 
 double CoampsDomain::latitude(size_t index) const {
-  assert(index < m_latitude.size());
-  return m_latitude[index];
+  assert(index < m_coordinates->latitude.size());
+  return m_coordinates->latitude[index];
 }
 
 bool CoampsDomain::masked(size_t index) const {
   assert(index < m_mask.size());
-  return m_mask[index];
+  return m_mask[index] != 0;
 }
 
 void CoampsDomain::setMask(size_t index, bool value) {
   assert(index < m_mask.size());
-  if (m_mask[index] != value) {
+  if (static_cast<bool>(m_mask[index]) != value) {
     if (value) {
       m_mask_count++;
     } else {
       m_mask_count--;
     }
-    m_mask[index] = value;
+    m_mask[index] = static_cast<char>(value);
   }
 }
 
+/**
+ * @brief Replaces the whole mask
+ * @param mask nonzero for each point covered by an inner domain
+ */
+void CoampsDomain::setMask(std::vector<char> mask) {
+  assert(mask.size() == this->size());
+  m_mask_count = static_cast<size_t>(
+      std::count_if(mask.begin(), mask.end(), [](char m) { return m != 0; }));
+  m_mask = std::move(mask);
+}
+
+const std::vector<char>& CoampsDomain::mask() const { return m_mask; }
+
 size_t CoampsDomain::n_masked_points() const { return m_mask_count; }
 
 std::array<std::vector<double>, 2> CoampsDomain::getUnmaskedCoordinates()
@@ -151,62 +224,91 @@ std::array<std::vector<double>, 2> CoampsDomain::getUnmaskedCoordinates()
 
   for (size_t i = 0; i < this->size(); ++i) {
     if (!m_mask[i]) {
-      lon.push_back(m_longitude[i]);
-      lat.push_back(m_latitude[i]);
+      lon.push_back(this->longitude(i));
+      lat.push_back(this->latitude(i));
     }
   }
   return {lon, lat};
 }
 
 std::vector<double> CoampsDomain::get(const std::string& variable) const {
-  const auto variable_id = m_ncid->getVarid(variable);
   std::vector<float> var(this->size());
-  std::vector<double> var_out;
-  var_out.reserve(this->size());
+  this->read(variable, var.data());
+  std::vector<double> var_out(this->n_unmasked_points());
+  this->gather(var.data(), var_out.data());
+  return var_out;
+}
+
+size_t CoampsDomain::n_unmasked_points() const {
+  return this->size() - m_mask_count;
+}
 
+/**
+ * @brief Reads every point of a variable, masked or not
+ * @param variable variable name
+ * @param values destination holding size() values
+ */
+void CoampsDomain::read(const std::string& variable, float* values) const {
+  const auto variable_id = m_ncid->getVarid(variable);
   const size_t start[2] = {0, 0};
   const size_t count[2] = {m_nlat, m_nlon};
+  std::lock_guard<std::mutex> lock(m_ncid->mutex());
+  m_ncid->setChunkCache(variable_id, this->size() * sizeof(float));
+  Instrumentation::ScopedTimer timer(Instrumentation::DECODE, m_nlat * m_nlon);
   int ierr =
-      nc_get_vara_float(m_ncid->ncid(), variable_id, start, count, var.data());
+      nc_get_vara_float(m_ncid->ncid(), variable_id, start, count, values);
   if (ierr != NC_NOERR) {
     Logging::throwError("Could not read variable " + variable +
                         " from COAMPS file");
   }
+}
 
+/**
+ * @brief Writes the unmasked points of a variable read by read()
+ * @param values every point of the variable
+ * @param out destination holding n_unmasked_points() values
+ */
+void CoampsDomain::gather(const float* values, double* out) const {
+  if (m_mask_count == 0) {
+    std::copy(values, values + this->size(), out);
+    return;
+  }
   for (size_t i = 0; i < this->size(); ++i) {
-    if (!m_mask[i]) {
-      var_out.push_back(static_cast<double>(var[i]));
-    }
+    if (!m_mask[i]) *out++ = static_cast<double>(values[i]);
   }
-  return var_out;
 }
 
-const Point& CoampsDomain::point_ll() const { return m_point_ll; }
+const Point& CoampsDomain::point_ll() const {
+  return m_coordinates->point_ll;
+}
 
-const Point& CoampsDomain::point_ur() const { return m_point_ur; }
+const Point& CoampsDomain::point_ur() const {
+  return m_coordinates->point_ur;
+}
 
 std::vector<Point> CoampsDomain::get_bounding_region() const {
+  const auto& lon = m_coordinates->longitude;
+  const auto& lat = m_coordinates->latitude;
   std::vector<Point> region;
 
   // Bottom left --> Bottom right
   for (size_t i = 0; i < m_nlon; ++i) {
-    region.emplace_back(m_longitude[i], m_latitude[i]);
+    region.emplace_back(lon[i], lat[i]);
   }
   // Bottom right --> Top right
   for (size_t i = 1; i < m_nlat; ++i) {
-    region.emplace_back(m_longitude[i * m_nlon - 1],
-                        m_latitude[i * m_nlon - 1]);
+    region.emplace_back(lon[i * m_nlon - 1], lat[i * m_nlon - 1]);
   }
 
   // Top Right --> Top Left
   for (size_t i = 0; i < m_nlon; ++i) {
-    region.emplace_back(m_longitude[m_nlat * m_nlon - 1 - i],
-                        m_latitude[m_nlat * m_nlon - 1 - i]);
+    region.emplace_back(lon[m_nlat * m_nlon - 1 - i],
+                        lat[m_nlat * m_nlon - 1 - i]);
   }
 
   // Top left --> Bottom Left
   for (long i = static_cast<long>(m_nlat) - 1; i > 0; --i) {
-    region.emplace_back(m_longitude[i * m_nlon], m_latitude[i * m_nlon]);
+    region.emplace_back(lon[i * m_nlon], lat[i * m_nlon]);
   }
 
   return region;
@@ -29,6 +29,8 @@
 #ifndef METGET_SRC_DATA_SOURCES_COAMPSDOMAIN_H_
 #define METGET_SRC_DATA_SOURCES_COAMPSDOMAIN_H_
 
+#include <array>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -41,8 +43,26 @@
 namespace MetBuild {
 class CoampsDomain {
  public:
+  /**
+   * @brief Positions of the points of a domain, shared by every forecast
+   * period in which the domain does not move
+   */
+  struct Coordinates {
+    std::vector<double> longitude;
+    std::vector<double> latitude;
+    std::array<MetBuild::Point, 4> corners;
+    MetBuild::Point point_ll;
+    MetBuild::Point point_ur;
+  };
+
   explicit CoampsDomain(std::string filename);
 
+  NODISCARD uint64_t fingerprint() const;
+
+  NODISCARD std::shared_ptr<const Coordinates> readCoordinates() const;
+
+  void setCoordinates(std::shared_ptr<const Coordinates> coordinates);
+
   NetcdfFile *ncid();
 
   size_t size() const;
@@ -67,10 +87,20 @@ class CoampsDomain {
 
   void setMask(size_t index, bool value);
 
+  void setMask(std::vector<char> mask);
+
+  NODISCARD const std::vector<char> &mask() const;
+
   std::array<std::vector<double>, 2> getUnmaskedCoordinates() const;
 
   std::vector<double> get(const std::string &variable) const;
 
+  NODISCARD size_t n_unmasked_points() const;
+
+  void read(const std::string &variable, float *values) const;
+
+  void gather(const float *values, double *out) const;
+
   [[nodiscard]] const MetBuild::Point &point_ll() const;
 
   [[nodiscard]] const MetBuild::Point &point_ur() const;
@@ -78,13 +108,12 @@ class CoampsDomain {
   std::vector<Point> get_bounding_region() const;
 
  private:
-  void initialize();
-  void findCorners();
+  NODISCARD uint64_t computeFingerprint() const;
 
   static double normalize_longitude(double longitude);
 
   std::string m_filename;
-  std::unique_ptr<NetcdfFile> m_ncid;
+  std::shared_ptr<NetcdfFile> m_ncid;
   int m_dimid_lat;
   int m_dimid_lon;
   size_t m_nlon;
@@ -92,16 +121,10 @@ class CoampsDomain {
   size_t m_mask_count;
   int m_varid_lat;
   int m_varid_lon;
-  double m_xll;
-
-  MetBuild::Point m_point_ll;
-  MetBuild::Point m_point_ur;
-
-  std::vector<double> m_longitude;
-  std::vector<double> m_latitude;
-  std::vector<bool> m_mask;
+  uint64_t m_fingerprint;
 
-  std::array<MetBuild::Point, 4> m_corners;
+  std::shared_ptr<const Coordinates> m_coordinates;
+  std::vector<char> m_mask;
 };
 }  // namespace MetBuild
 #endif  // METGET_SRC_DATA_SOURCES_COAMPSDOMAIN_H_
@@ -0,0 +1,514 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "FieldFile.h"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include "Geometry.h"
+#include "Grib.h"
+#include "Hash.h"
+#include "Instrumentation.h"
+#include "Logging.h"
+#include "MappedFile.h"
+#include "SharedCache.h"
+#include "Triangulation.h"
+#include "boost/filesystem.hpp"
+#include "boost/iostreams/device/back_inserter.hpp"
+#include "boost/iostreams/filter/zlib.hpp"
+#include "boost/iostreams/filtering_stream.hpp"
+
+using namespace MetBuild;
+
+namespace {
+constexpr char c_magic[4] = {'M', 'B', 'F', 'F'};
+constexpr uint32_t c_version = 1;
+
+//...Variables are stored under generic names, the grib short names of the
+// source are not needed once the fields are decoded
+const VariableNames c_names("longitude", "latitude", "pressure", "u10", "v10",
+                            "precipitation", "humidity", "temperature", "ice");
+
+constexpr std::array<GriddedDataTypes::VARIABLES, 7> c_variables = {
+    GriddedDataTypes::VAR_PRESSURE,    GriddedDataTypes::VAR_U10,
+    GriddedDataTypes::VAR_V10,         GriddedDataTypes::VAR_RAINFALL,
+    GriddedDataTypes::VAR_HUMIDITY,    GriddedDataTypes::VAR_TEMPERATURE,
+    GriddedDataTypes::VAR_ICE};
+
+/**
+ * Layout of a field file:
+ *   FileHeader
+ *   grid type, geographic crs and projected crs, each a uint32_t length and
+ *   its characters
+ *   four corners and n_region outline points as pairs of doubles
+ *   n_variables int32_t variable ids
+ *   payload, zlib compressed when the compressed flag is set:
+ *     size doubles of longitude, size doubles of latitude, then size floats
+ *     for each variable in the order of the ids
+ */
+struct FileHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t ni;
+  uint64_t nj;
+  uint64_t size;
+  uint64_t grid_key;
+  int32_t convention;
+  int32_t subtype;
+  uint32_t n_variables;
+  uint32_t n_region;
+  uint32_t compressed;
+  uint32_t reserved;
+};
+
+/**
+ * @brief Sequential reader over the metadata of a mapped field file which
+ * throws instead of reading past its end
+ */
+class Reader {
+ public:
+  Reader(const MappedFile &file, std::string filename)
+      : m_ptr(file.data()),
+        m_end(file.data() + file.size()),
+        m_filename(std::move(filename)) {}
+
+  void read(void *out, size_t n) {
+    if (static_cast<size_t>(m_end - m_ptr) < n) {
+      metbuild_throw_exception("The field file '" + m_filename +
+                               "' is truncated");
+    }
+    std::memcpy(out, m_ptr, n);
+    m_ptr += n;
+  }
+
+  template <typename T>
+  T get() {
+    T value;
+    this->read(&value, sizeof(T));
+    return value;
+  }
+
+  std::string string() {
+    std::string s(this->get<uint32_t>(), ' ');
+    this->read(&s[0], s.size());
+    return s;
+  }
+
+  NODISCARD const unsigned char *position() const { return m_ptr; }
+
+  NODISCARD size_t remaining() const { return m_end - m_ptr; }
+
+ private:
+  const unsigned char *m_ptr;
+  const unsigned char *m_end;
+  std::string m_filename;
+};
+
+FileHeader read_header(const MappedFile &file, const std::string &filename) {
+  auto header = Reader(file, filename).get<FileHeader>();
+  if (std::memcmp(header.magic, c_magic, sizeof(c_magic)) != 0 ||
+      header.version != c_version) {
+    metbuild_throw_exception("The file '" + filename +
+                             "' is not a supported field file");
+  }
+  return header;
+}
+
+COORDINATE_CONVENTION read_convention(const std::string &filename) {
+  const auto file = MappedFile::get(filename);
+  return static_cast<COORDINATE_CONVENTION>(
+      read_header(*file, filename).convention);
+}
+
+std::vector<std::vector<double>> map_to_2d(const std::vector<double> &v,
+                                           size_t ni, size_t nj) {
+  std::vector<std::vector<double>> arr2d(ni, std::vector<double>(nj, 0.0));
+  for (size_t i = 0; i < v.size(); ++i) {
+    arr2d[i / nj][i % nj] = v[i];
+  }
+  return arr2d;
+}
+
+template <typename T>
+void append(std::string &out, const T &value) {
+  out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void append_string(std::string &out, const std::string &value) {
+  append(out, static_cast<uint32_t>(value.size()));
+  out.append(value);
+}
+}  // namespace
+
+FieldFile::FieldFile(const std::string &filename)
+    : GriddedData(filename, c_names, VariableUnits(),
+                  read_convention(filename)),
+      m_file(MappedFile::get(filename)) {
+  Reader reader(*m_file, filename);
+  const auto header = reader.get<FileHeader>();
+  this->setNi(header.ni);
+  this->setNj(header.nj);
+  this->setSize(header.size);
+  this->setSourceSubtype(
+      static_cast<GriddedDataTypes::SOURCE_SUBTYPE>(header.subtype));
+
+  m_gridType = reader.string();
+  m_geographic_crs = reader.string();
+  m_projected_crs = reader.string();
+
+  std::array<Point, 4> corners;
+  for (auto &c : corners) {
+    const auto x = reader.get<double>();
+    c = Point(x, reader.get<double>());
+  }
+  this->setCorners(corners);
+
+  std::vector<Point> region(header.n_region);
+  for (auto &p : region) {
+    const auto x = reader.get<double>();
+    p = Point(x, reader.get<double>());
+  }
+
+  for (size_t i = 0; i < header.n_variables; ++i) {
+    const auto v =
+        static_cast<GriddedDataTypes::VARIABLES>(reader.get<int32_t>());
+    m_variables[c_names.find_variable(v)] = i;
+  }
+
+  const size_t payload_size =
+      header.size * (2 * sizeof(double) + header.n_variables * sizeof(float));
+  if (header.compressed != 0) {
+    m_inflated.reserve(payload_size);
+    boost::iostreams::filtering_ostream out;
+    out.push(boost::iostreams::zlib_decompressor());
+    out.push(boost::iostreams::back_inserter(m_inflated));
+    out.write(reinterpret_cast<const char *>(reader.position()),
+              static_cast<std::streamsize>(reader.remaining()));
+    out.reset();
+    m_payload = reinterpret_cast<const unsigned char *>(m_inflated.data());
+    if (m_inflated.size() != payload_size) {
+      metbuild_throw_exception("The field file '" + filename +
+                               "' is truncated");
+    }
+  } else {
+    if (reader.remaining() != payload_size) {
+      metbuild_throw_exception("The field file '" + filename +
+                               "' is truncated");
+    }
+    m_payload = reader.position();
+  }
+
+  static SharedCache<const GridDefinition> s_grids(
+      "field_grid", [](const GridDefinition &g) {
+        return (g.latitude.size() + g.longitude.size()) * sizeof(double);
+      });
+  m_grid = s_grids.acquire(std::to_string(header.grid_key), [&]() {
+    const size_t bytes = header.size * sizeof(double);
+    auto g = std::make_shared<GridDefinition>();
+    g->longitude.resize(header.size);
+    g->latitude.resize(header.size);
+    std::memcpy(g->longitude.data(), m_payload, bytes);
+    std::memcpy(g->latitude.data(), m_payload + bytes, bytes);
+    g->geometry = region.size() >= 3
+                      ? std::make_shared<const Geometry>(region)
+                      : std::make_shared<const Geometry>(corners);
+    g->outline = std::make_shared<const std::vector<Point>>(std::move(region));
+    return std::shared_ptr<const GridDefinition>(std::move(g));
+  });
+  this->set_bounding_region(m_grid->outline, m_grid->geometry);
+  this->setFingerprint(header.grid_key);
+}
+
+FieldFile::~FieldFile() = default;
+
+const std::vector<double> &FieldFile::latitude1d() const {
+  return m_grid->latitude;
+}
+
+const std::vector<double> &FieldFile::longitude1d() const {
+  return m_grid->longitude;
+}
+
+std::vector<std::vector<double>> FieldFile::latitude2d() {
+  return map_to_2d(this->latitude1d(), ni(), nj());
+}
+
+std::vector<std::vector<double>> FieldFile::longitude2d() {
+  return map_to_2d(this->longitude1d(), ni(), nj());
+}
+
+void FieldFile::findCorners() {
+  //...Corners are stored in the file and set on construction
+}
+
+std::vector<double> FieldFile::getArray1d(const std::string &name) {
+  auto it = m_variables.find(name);
+  if (it == m_variables.end()) {
+    metbuild_throw_exception("The field file '" + this->filenames()[0] +
+                             "' does not contain the variable: '" + name +
+                             "'");
+  }
+  const auto *ptr = m_payload + 2 * size() * sizeof(double) +
+                    it->second * size() * sizeof(float);
+  //...The payload may not be aligned for floats, so values are copied out
+  // one at a time into a recycled buffer
+  Instrumentation::ScopedTimer timer(Instrumentation::DECODE, size());
+  auto values = this->acquireBuffer();
+  values.resize(size());
+  for (size_t k = 0; k < size(); ++k) {
+    float v;
+    std::memcpy(&v, ptr + k * sizeof(float), sizeof(float));
+    values[k] = v;
+  }
+  return values;
+}
+
+std::vector<std::vector<double>> FieldFile::getArray2d(
+    const std::string &name) {
+  return map_to_2d(this->getArray1d(name), ni(), nj());
+}
+
+/**
+ * @brief Builds the point locator with the same choice of method as the grib
+ * source the file was written from
+ */
+Triangulation FieldFile::generate_triangulation(
+    const Triangulation::Extent &extent) const {
+  if (m_gridType == "regular_ll" &&
+      Triangulation::isRectilinear(this->longitude1d(), this->latitude1d(),
+                                   ni(), nj())) {
+    return Triangulation::structured(this->longitude1d(), this->latitude1d(),
+                                     ni(), nj());
+  }
+  if (!m_projected_crs.empty()) {
+    return Triangulation::curvilinear(this->longitude1d(), this->latitude1d(),
+                                      ni(), nj(), m_geographic_crs,
+                                      m_projected_crs);
+  }
+  return Triangulation::connected(this->longitude1d(), this->latitude1d(),
+                                  ni(), nj(), extent);
+}
+
+/**
+ * @brief Checks whether a file, or a buffer registered under its name, is a
+ * field file
+ * @param filename file to check
+ * @return true when the file starts with the field file signature
+ */
+bool FieldFile::isFieldFile(const std::string &filename) {
+  char magic[4] = {0};
+  if (auto buffer = MappedFile::buffer(filename)) {
+    if (buffer->size() < sizeof(magic)) return false;
+    std::memcpy(magic, buffer->data(), sizeof(magic));
+  } else {
+    std::ifstream f(filename, std::ios::binary);
+    if (!f.read(magic, sizeof(magic))) return false;
+  }
+  return std::memcmp(magic, c_magic, sizeof(c_magic)) == 0;
+}
+
+/**
+ * @brief Writes the decoded fields of a grib source to a field file. The
+ * file is written under a temporary name and renamed so that readers never
+ * see a partial file
+ * @param source grib source, which is read in full
+ * @param filename field file to write
+ * @param compress compress the arrays with zlib. Compressed files are smaller
+ * but are inflated into memory instead of being read from a mapping
+ * @param crop box, in degrees in the coordinates of the source, around which
+ * the grid is cropped. The full grid is written when the box holds most of
+ * the grid or none of it
+ */
+void FieldFile::write(GriddedData &source, const std::string &filename,
+                      bool compress,
+                      const std::optional<Triangulation::Extent> &crop) {
+  const auto *grib = dynamic_cast<const Grib *>(&source);
+  if (grib == nullptr) {
+    metbuild_throw_exception("Only grib sources can be written to field files");
+  }
+
+  std::vector<GriddedDataTypes::VARIABLES> variables;
+  for (const auto v : c_variables) {
+    const auto name = source.variableNames().find_variable(v);
+    if (!name.empty() && Grib::containsVariable(source.filenames()[0], name)) {
+      variables.push_back(v);
+    }
+  }
+
+  std::optional<Triangulation::Window> window;
+  if (crop) {
+    window = Triangulation::crop_window(source.longitude1d(),
+                                        source.latitude1d(), source.ni(),
+                                        source.nj(), *crop);
+    if (!window) {
+      Logging::warning("The crop region does not reduce the grid of '" +
+                       source.filenames()[0] + "', the full grid is written");
+    }
+  }
+
+  size_t ni = source.ni();
+  size_t nj = source.nj();
+  std::vector<double> cropped_x;
+  std::vector<double> cropped_y;
+  std::vector<Point> region = source.bounding_region();
+  std::array<Point, 4> corners = {source.bottom_left(), source.bottom_right(),
+                                  source.top_right(), source.top_left()};
+
+  //...Positions of the stored points in the source arrays when cropped
+  std::vector<size_t> index;
+  if (window) {
+    ni = window->ni;
+    nj = window->nj;
+    index.reserve(ni * nj);
+    for (size_t j = window->j0; j < window->j0 + nj; ++j) {
+      for (size_t i = window->i0; i < window->i0 + ni; ++i) {
+        index.push_back(j * source.ni() + i);
+      }
+    }
+    cropped_x.reserve(index.size());
+    cropped_y.reserve(index.size());
+    for (const auto k : index) {
+      cropped_x.push_back(source.longitude1d()[k]);
+      cropped_y.push_back(source.latitude1d()[k]);
+    }
+
+    //...The outline walks the edges of the window
+    const auto point = [&](size_t i, size_t j) {
+      return Point(cropped_x[j * ni + i], cropped_y[j * ni + i]);
+    };
+    region.clear();
+    for (size_t i = 0; i < ni; ++i) region.push_back(point(i, 0));
+    for (size_t j = 1; j < nj; ++j) region.push_back(point(ni - 1, j));
+    for (size_t i = ni - 1; i-- > 0;) region.push_back(point(i, nj - 1));
+    for (size_t j = nj - 1; j-- > 1;) region.push_back(point(0, j));
+
+    if (point(0, 0).y() <= point(0, nj - 1).y()) {
+      corners = {point(0, 0), point(ni - 1, 0), point(ni - 1, nj - 1),
+                 point(0, nj - 1)};
+    } else {
+      corners = {point(0, nj - 1), point(ni - 1, nj - 1), point(ni - 1, 0),
+                 point(0, 0)};
+    }
+  }
+  const auto &x = window ? cropped_x : source.longitude1d();
+  const auto &y = window ? cropped_y : source.latitude1d();
+  const size_t n = x.size();
+
+  Hash grid_key;
+  grid_key.add(grib->gridType())
+      .add(grib->projectedCrs())
+      .add(ni)
+      .add(nj)
+      .add(static_cast<int>(source.convention()))
+      .add(x)
+      .add(y)
+      .add(region);
+  if (window) {
+    grid_key.add(source.fingerprint())
+        .add(window->i0)
+        .add(window->j0)
+        .add(window->ni)
+        .add(window->nj);
+  }
+
+  FileHeader header{};
+  std::memcpy(header.magic, c_magic, sizeof(c_magic));
+  header.version = c_version;
+  header.ni = ni;
+  header.nj = nj;
+  header.size = n;
+  header.grid_key = grid_key.value();
+  header.convention = static_cast<int32_t>(source.convention());
+  header.subtype = static_cast<int32_t>(source.sourceSubtype());
+  header.n_variables = static_cast<uint32_t>(variables.size());
+  header.n_region = static_cast<uint32_t>(region.size());
+  header.compressed = compress ? 1 : 0;
+
+  std::string metadata;
+  append(metadata, header);
+  append_string(metadata, grib->gridType());
+  append_string(metadata, grib->geographicCrs());
+  append_string(metadata, grib->projectedCrs());
+  for (const auto &c : corners) {
+    append(metadata, c.x());
+    append(metadata, c.y());
+  }
+  for (const auto &p : region) {
+    append(metadata, p.x());
+    append(metadata, p.y());
+  }
+  for (const auto v : variables) {
+    append(metadata, static_cast<int32_t>(v));
+  }
+
+  std::string payload;
+  payload.reserve(n * (2 * sizeof(double) + variables.size() * sizeof(float)));
+  payload.append(reinterpret_cast<const char *>(x.data()), n * sizeof(double));
+  payload.append(reinterpret_cast<const char *>(y.data()), n * sizeof(double));
+  std::vector<float> stored(n);
+  for (const auto v : variables) {
+    //...Rainfall is stored as the rate the source reads it as. The other
+    // fields are stored in the source units, which the field file scales
+    // back the same way when it is read
+    const auto &values = source.variable1d(v);
+    const double scale = v == GriddedDataTypes::VAR_RAINFALL
+                             ? 1.0
+                             : 1.0 / source.fieldScaling(v);
+    for (size_t i = 0; i < n; ++i) {
+      const auto k = index.empty() ? i : index[i];
+      stored[i] = static_cast<float>(values[k] * scale);
+    }
+    payload.append(reinterpret_cast<const char *>(stored.data()),
+                   n * sizeof(float));
+  }
+
+  if (compress) {
+    std::string deflated;
+    boost::iostreams::filtering_ostream out;
+    out.push(boost::iostreams::zlib_compressor());
+    out.push(boost::iostreams::back_inserter(deflated));
+    out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    out.reset();
+    payload = std::move(deflated);
+  }
+
+  const auto tmp = filename + "." + boost::filesystem::unique_path().string();
+  {
+    std::ofstream f(tmp, std::ios::binary);
+    if (!f.is_open()) {
+      metbuild_throw_exception("Could not write the field file '" + filename +
+                               "'");
+    }
+    f.write(metadata.data(), static_cast<std::streamsize>(metadata.size()));
+    f.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+  }
+  boost::filesystem::rename(tmp, filename);
+}
@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_FIELDFILE_H_
+#define METBUILD_SRC_FIELDFILE_H_
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GriddedData.h"
+
+namespace MetBuild {
+
+class Geometry;
+class MappedFile;
+
+/**
+ * @brief Source read from a MetGet field file, the decoded fields of a grib
+ * file stored as raw single precision arrays
+ *
+ * Field files are written once per grib file, typically when it is
+ * downloaded, so the grib unpacking is not repeated by every request that
+ * reads the file. The values are stored after unit conversion and the
+ * rainfall rate scaling, so the file reads the same as the grib file it was
+ * written from. Uncompressed files are read straight from a memory mapping,
+ * and files on the same grid share their coordinates and outline
+ *
+ * A file may hold only the part of the source grid around a region, so that
+ * a deployment serving one region decodes, triangulates and weights a
+ * fraction of a global grid. The crop window is part of the grid key, which
+ * is also the fingerprint of the source, so cached weights never mix cropped
+ * and full grids
+ */
+class FieldFile : public GriddedData {
+ public:
+  explicit FieldFile(const std::string &filename);
+
+  ~FieldFile() override;
+
+  std::vector<std::vector<double>> latitude2d() override;
+  const std::vector<double> &latitude1d() const override;
+
+  std::vector<std::vector<double>> longitude2d() override;
+  const std::vector<double> &longitude1d() const override;
+
+  MetBuild::Triangulation generate_triangulation(
+      const MetBuild::Triangulation::Extent &extent) const override;
+
+  static bool isFieldFile(const std::string &filename);
+
+  static void write(GriddedData &source, const std::string &filename,
+                    bool compress,
+                    const std::optional<Triangulation::Extent> &crop =
+                        std::nullopt);
+
+ private:
+  void findCorners() override;
+
+  std::vector<double> getArray1d(const std::string &name) override;
+  std::vector<std::vector<double>> getArray2d(const std::string &name) override;
+
+  /**
+   * @brief Parts of a field file which only depend on its grid, shared by
+   * every file on the same grid
+   */
+  struct GridDefinition {
+    std::vector<double> latitude;
+    std::vector<double> longitude;
+    std::shared_ptr<const std::vector<MetBuild::Point>> outline;
+    std::shared_ptr<const MetBuild::Geometry> geometry;
+  };
+
+  std::shared_ptr<const MappedFile> m_file;
+  std::vector<char> m_inflated;
+  const unsigned char *m_payload = nullptr;
+  std::shared_ptr<const GridDefinition> m_grid;
+  std::unordered_map<std::string, size_t> m_variables;
+  std::string m_gridType;
+  std::string m_geographic_crs;
+  std::string m_projected_crs;
+};
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_FIELDFILE_H_
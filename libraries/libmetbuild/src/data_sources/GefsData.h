@@ -29,56 +29,31 @@
 #ifndef METGET_SRC_GEFSDATA_H_
 #define METGET_SRC_GEFSDATA_H_
 
-#include "Grib.h"
+#include <array>
+#include <string>
 
-namespace MetBuild {
-
-class GefsData : public Grib {
- public:
-  explicit GefsData(const std::string &filename)
-      : Grib(filename,
-             {"longitudes", "latitudes", "prmsl", "10u", "10v", "", "r2", "t2",
-              ""},
-             {1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0}) {
-    this->get_bounding_region();
-  }
-
-  ~GefsData() override = default;
-
- private:
-  void get_bounding_region() {
-    const auto x = this->longitude1d();
-    const auto y = this->latitude1d();
-    std::vector<Point> region;
-
-    std::vector<double> top;
-    for (size_t i = 0; i < ni(); ++i) {
-      top.push_back(x[i]);
-    }
-    std::sort(top.begin(), top.end());
-    for (const auto &v : top) {
-      region.emplace_back(v, 90.0);
-    }
+#include "GribSource.h"
 
-    std::vector<double> right;
-    for (size_t i = 0; i < nj(); ++i) {
-      right.push_back(y[i * ni()]);
-    }
-
-    for (const auto &v : right) {
-      region.emplace_back(179.75, v);
-    }
-
-    for (auto it = top.rbegin(); it != top.rend(); ++it) {
-      region.emplace_back(*(it), -90);
-    }
+namespace MetBuild {
 
-    for (auto it = right.rbegin(); it != right.rend(); ++it) {
-      region.emplace_back(-180.0, *(it));
-    }
+/**
+ * @brief GEFS global ensemble forecast
+ */
+struct GefsTraits {
+  static constexpr SourceGrid grid = SourceGrid::GLOBAL_LATLON;
+  static constexpr COORDINATE_CONVENTION convention = CONVENTION_180;
+  static constexpr VariableUnits units{1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0};
+  static constexpr std::array<MessageSelector, 5> messages = {{
+      {GriddedDataTypes::VAR_PRESSURE, "prmsl", "PRMSL", "mean sea level"},
+      {GriddedDataTypes::VAR_U10, "10u", "UGRD", "10 m above ground"},
+      {GriddedDataTypes::VAR_V10, "10v", "VGRD", "10 m above ground"},
+      {GriddedDataTypes::VAR_HUMIDITY, "r2", "RH", "2 m above ground"},
+      {GriddedDataTypes::VAR_TEMPERATURE, "t2", "TMP", "2 m above ground"}}};
+};
 
-    this->set_bounding_region(region);
-  }
+class GefsData : public GribSource<GefsTraits> {
+ public:
+  using GribSource::GribSource;
 };
 }  // namespace MetBuild
 #endif  // METGET_SRC_GEFSDATA_H_
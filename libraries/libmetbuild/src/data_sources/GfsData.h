@@ -29,56 +29,33 @@
 #ifndef METGET_SRC_GFSDATA_H_
 #define METGET_SRC_GFSDATA_H_
 
-#include "Grib.h"
+#include <array>
+#include <string>
 
-namespace MetBuild {
-
-class GfsData : public Grib {
- public:
-  explicit GfsData(const std::string &filename)
-      : Grib(filename,
-             {"longitudes", "latitudes", "prmsl", "10u", "10v", "prate", "r",
-              "t", "ci"},
-             {1.0, 1.0, 1.0, 3600.0, 1.0, 1.0, 1.0}) {
-    this->get_bounding_region();
-  }
-
-  ~GfsData() override = default;
-
- private:
-  void get_bounding_region() {
-    const auto x = this->longitude1d();
-    const auto y = this->latitude1d();
-    std::vector<Point> region;
-
-    std::vector<double> top;
-    for (size_t i = 0; i < ni(); ++i) {
-      top.push_back(x[i]);
-    }
-    std::sort(top.begin(), top.end());
-    for (const auto &v : top) {
-      region.emplace_back(v, 90.0);
-    }
+#include "GribSource.h"
 
-    std::vector<double> right;
-    for (size_t i = 0; i < nj(); ++i) {
-      right.push_back(y[i * ni()]);
-    }
-
-    for (const auto &v : right) {
-      region.emplace_back(179.75, v);
-    }
-
-    for (auto it = top.rbegin(); it != top.rend(); ++it) {
-      region.emplace_back(*(it), -90);
-    }
+namespace MetBuild {
 
-    for (auto it = right.rbegin(); it != right.rend(); ++it) {
-      region.emplace_back(-180.0, *(it));
-    }
+/**
+ * @brief GFS 0.25 degree global forecast
+ */
+struct GfsTraits {
+  static constexpr SourceGrid grid = SourceGrid::GLOBAL_LATLON;
+  static constexpr COORDINATE_CONVENTION convention = CONVENTION_180;
+  static constexpr VariableUnits units{1.0, 1.0, 1.0, 3600.0, 1.0, 1.0, 1.0};
+  static constexpr std::array<MessageSelector, 7> messages = {{
+      {GriddedDataTypes::VAR_PRESSURE, "prmsl", "PRMSL", "mean sea level"},
+      {GriddedDataTypes::VAR_U10, "10u", "UGRD", "10 m above ground"},
+      {GriddedDataTypes::VAR_V10, "10v", "VGRD", "10 m above ground"},
+      {GriddedDataTypes::VAR_RAINFALL, "prate", "PRATE", "surface", "avg"},
+      {GriddedDataTypes::VAR_HUMIDITY, "r", "RH", "30-0 mb above ground"},
+      {GriddedDataTypes::VAR_TEMPERATURE, "t", "TMP", "30-0 mb above ground"},
+      {GriddedDataTypes::VAR_ICE, "ci", "ICEC", "surface"}}};
+};
 
-    this->set_bounding_region(region);
-  }
+class GfsData : public GribSource<GfsTraits> {
+ public:
+  using GribSource::GribSource;
 };
 }  // namespace MetBuild
 #endif  // METGET_SRC_GFSDATA_H_
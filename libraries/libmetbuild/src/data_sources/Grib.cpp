@@ -28,82 +28,240 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "Grib.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <tuple>
 #include <utility>
 
+#include "FileWrapper.h"
 #include "Geometry.h"
 #include "GribHandle.h"
+#include "GribUnpacker.h"
+#include "Hash.h"
+#include "Instrumentation.h"
 #include "Logging.h"
+#include "MemoryPolicy.h"
+#include "Projection.h"
+#include "SharedCache.h"
+#include "SharedFieldStore.h"
+#include "ThreadPool.h"
 #include "Triangulation.h"
 #include "Utilities.h"
 #include "boost/algorithm/string/split.hpp"
 #include "boost/algorithm/string/trim.hpp"
 #include "eccodes.h"
 
+#define FMT_HEADER_ONLY
+#include "fmt/core.h"
+
 using namespace MetBuild;
 
+namespace {
+
+std::atomic<bool> s_generate_coordinates{true};
+
+bool sourceDecimationDefault() {
+  const char *env = std::getenv("METBUILD_SOURCE_DECIMATION");
+  return env != nullptr && std::strcmp(env, "0") != 0;
+}
+std::atomic<bool> s_source_decimation(sourceDecimationDefault());
+
+double convert_longitude(double v, COORDINATE_CONVENTION convention) {
+  if (convention == CONVENTION_180) {
+    return (std::fmod(v + 180.0, 360.0)) - 180.0;
+  }
+  return v;
+}
+
+/**
+ * @brief Length of the accumulation window of a grib step range, e.g. 6 for
+ * "0-6". Instantaneous fields have a single step and a length of 1
+ */
+int parseStepLength(const std::string &stepRange) {
+  std::vector<std::string> result;
+  boost::algorithm::split(result, stepRange, boost::is_any_of("-"),
+                          boost::token_compress_off);
+  for (auto &s : result) {
+    boost::trim_left(s);
+  }
+
+  if (result.size() == 1) {
+    return 1;
+  } else {
+    return std::stoi(result[1]) - std::stoi(result[0]);
+  }
+}
+
+//...eccodes 2.30 added single precision decoding of the values
+#if ECCODES_MAJOR_VERSION > 2 || \
+    (ECCODES_MAJOR_VERSION == 2 && ECCODES_MINOR_VERSION >= 30)
+#define METBUILD_GRIB_FLOAT_DECODE
+#endif
+
+int get_values(codes_handle *handle, double *values, size_t *size) {
+  return codes_get_double_array(handle, "values", values, size);
+}
+
+/**
+ * @brief Decodes the values of a message in single precision. Older eccodes
+ * versions decode in double precision and the values are narrowed
+ */
+int get_values(codes_handle *handle, float *values, size_t *size) {
+#ifdef METBUILD_GRIB_FLOAT_DECODE
+  return codes_get_float_array(handle, "values", values, size);
+#else
+  std::vector<double> decoded(*size);
+  const int err =
+      codes_get_double_array(handle, "values", decoded.data(), size);
+  std::copy(decoded.begin(), decoded.begin() + *size, values);
+  return err;
+#endif
+}
+
+/**
+ * @brief Weights of a box filter as wide as a decimation factor, centred on
+ * a point of the decimated grid. Even factors give half weights to the two
+ * points on the edges of the box, so the weights always sum to the factor
+ * @param factor decimation factor
+ * @return weights of the points from -factor / 2 to factor / 2
+ */
+std::vector<double> box_weights(const size_t factor) {
+  const size_t half = factor / 2;
+  std::vector<double> w(2 * half + 1, 1.0);
+  if (factor % 2 == 0) {
+    w.front() = 0.5;
+    w.back() = 0.5;
+  }
+  return w;
+}
+
+/**
+ * @brief Unpacks the values of a message with the native unpacker when it is
+ * enabled and supports the packing of the message. When validating, the
+ * values are compared with those of eccodes, which are kept on a mismatch
+ * @param handle handle to the message
+ * @param values values, sized to the field
+ * @return false when the values are left to eccodes
+ */
+bool unpack_native(codes_handle *handle, std::vector<SourceDataType> &values) {
+  if (!GribUnpacker::enabled()) return false;
+  const void *message = nullptr;
+  size_t length = 0;
+  if (codes_get_message(handle, &message, &length) != GRIB_SUCCESS ||
+      !GribUnpacker::unpack(static_cast<const unsigned char *>(message),
+                            length, values.data(), values.size())) {
+    return false;
+  }
+  if (!GribUnpacker::validate()) return true;
+
+  std::vector<double> reference(values.size());
+  size_t size = reference.size();
+  CODES_CHECK(codes_get_double_array(handle, "values", reference.data(), &size),
+              nullptr);
+  for (size_t k = 0; k < values.size(); ++k) {
+    if (values[k] != static_cast<SourceDataType>(reference[k])) {
+      Logging::warning(fmt::format(
+          "Native grib unpacking differs from eccodes at point {:d} ({:.17g} "
+          "and {:.17g}), using the eccodes values",
+          k, values[k], reference[k]));
+      std::copy(reference.begin(), reference.end(), values.begin());
+      break;
+    }
+  }
+  return true;
+}
+}  // namespace
+
 Grib::Grib(std::string filename, VariableNames variable_names,
            VariableUnits variable_units, COORDINATE_CONVENTION convention)
     : GriddedData(std::move(filename), std::move(variable_names),
                   variable_units, convention) {
+  //...A step reference reads the messages of one step of the file
+  std::tie(m_grib_file, m_step) =
+      GribIndex::splitReference(this->filenames()[0]);
   this->initialize();
   this->setSourceSubtype(MetBuild::GriddedDataTypes::SOURCE_SUBTYPE::GRIB);
 }
 
-Grib::~Grib() = default;
+Grib::~Grib() {
+  for (auto &v : m_preread_values) {
+    this->releaseBuffer(std::move(v));
+  }
+}
 
-const std::vector<double> &Grib::latitude1d() const { return m_latitude; }
+const std::vector<double> &Grib::latitude1d() const {
+  return m_grid->latitude;
+}
 
-const std::vector<double> &Grib::longitude1d() const { return m_longitude; }
+const std::vector<double> &Grib::longitude1d() const {
+  return m_grid->longitude;
+}
 
 std::vector<std::vector<double>> Grib::longitude2d() {
-  return mapTo2d(m_longitude, ni(), nj());
+  return mapTo2d(this->longitude1d(), ni(), nj());
 }
 
 std::vector<std::vector<double>> Grib::latitude2d() {
-  return mapTo2d(m_latitude, ni(), nj());
+  return mapTo2d(this->latitude1d(), ni(), nj());
 }
 
 int Grib::getStepLength(const std::string &filename,
                         const std::string &parameter) {
-  auto h = GribHandle(filename, parameter);
-  std::string p2name;
-  size_t p2len = 0;
-  CODES_CHECK(codes_get_length(h.ptr(), "stepRange", &p2len), nullptr);
-  p2name.resize(p2len, ' ');
-  CODES_CHECK(codes_get_string(h.ptr(), "stepRange", &p2name[0], &p2len),
-              nullptr);
-  boost::trim_if(p2name, Utilities::isNotAlpha);
-  boost::trim_if(p2name, boost::is_any_of(" "));
-  std::vector<std::string> result;
-  boost::algorithm::split(result, p2name, boost::is_any_of("-"),
-                          boost::token_compress_off);
-  for (auto &s : result) {
-    boost::trim_left(s);
+  const auto reference = GribIndex::splitReference(filename);
+  auto entry =
+      GribIndex::get(reference.first)->find(parameter, reference.second);
+  if (!entry) {
+    metbuild_throw_exception(
+        "Could not generate the eccodes handle for variable: '" + parameter +
+        "'");
   }
+  return parseStepLength(entry->stepRange);
+}
 
-  if (result.size() == 1) {
-    return 1;
-  } else {
-    return std::stoi(result[1]) - std::stoi(result[0]);
-  }
+/**
+ * @brief Accumulation window of the precipitation field, read from the index
+ * when the file is opened so that snapshots need not look the file up again
+ * @return step length, 1 when the file holds no precipitation
+ */
+int Grib::precipitationStepLength() const {
+  return m_precipitation_step_length;
+}
 
-  metbuild_throw_exception("Could not generate the step range");
-  return 0;
+/**
+ * @brief Adds the conversion of accumulated precipitation to a rate over its
+ * accumulation window to the scaling of every grib source
+ */
+double Grib::fieldScaling(const GriddedDataTypes::VARIABLES v) const {
+  if (v == GriddedDataTypes::VAR_RAINFALL) {
+    const auto name = this->variableNames().precipitation();
+    if (name == "apcp" || name == "tp") {
+      return 1.0 / static_cast<double>(m_precipitation_step_length);
+    }
+  }
+  return GriddedData::fieldScaling(v);
 }
 
 void Grib::initialize() {
-  codes_grib_multi_support_on(grib_context_get_default());
+  m_index = GribIndex::get(m_grib_file);
+  if (auto e = m_index->find(this->variableNames().precipitation(), m_step)) {
+    m_precipitation_step_length = parseStepLength(e->stepRange);
+  }
 
-  auto handle = [&](){
-    if(Grib::containsVariable(this->filenames()[0], this->variableNames().pressure())) {    
-      return GribHandle(this->filenames()[0], this->variableNames().pressure().c_str());
-    } else if (Grib::containsVariable(this->filenames()[0], this->variableNames().precipitation())) { 
-      return GribHandle(this->filenames()[0], this->variableNames().precipitation().c_str());
+  auto handle = [&]() {
+    if (auto e = m_index->find(this->variableNames().pressure(), m_step)) {
+      return GribHandle(m_grib_file, *e);
+    } else if (auto e2 = m_index->find(this->variableNames().precipitation(),
+                                       m_step)) {
+      return GribHandle(m_grib_file, *e2);
     } else {
-      metbuild_throw_exception("Could not find a valid variable (tried pressure and precip)");
+      metbuild_throw_exception(
+          "Could not find a valid variable (tried pressure and precip)");
     }
   }();
 
@@ -119,41 +277,235 @@ void Grib::initialize() {
   CODES_CHECK(codes_get_size(handle.ptr(), "values", &size), nullptr);
   this->setSize(size);
 
+  size_t len = 0;
+  if (codes_get_length(handle.ptr(), "gridType", &len) == GRIB_SUCCESS) {
+    m_gridType.resize(len, ' ');
+    CODES_CHECK(codes_get_string(handle.ptr(), "gridType", &m_gridType[0], &len),
+                nullptr);
+    boost::trim_if(m_gridType, Utilities::isNotAlpha);
+  }
+  this->readProjection(handle.ptr());
+
   this->readCoordinates(handle.ptr());
   this->findCorners();
 }
 
 bool Grib::containsVariable(const std::string &filename,
                             const std::string &name) {
-  codes_grib_multi_support_on(grib_context_get_default());
-  auto handle = GribHandle(filename, name, true);
-  if (handle.ptr()) {
-    return true;
+  const auto reference = GribIndex::splitReference(filename);
+  return GribIndex::get(reference.first)->find(name, reference.second) !=
+         nullptr;
+}
+
+/**
+ * @brief Describes a grib file from its index and the grid section of one
+ * message, without decoding values or computing coordinates
+ * @param filename grib file or step reference
+ * @param names names of the source variables
+ * @return description of the file
+ */
+SourceProbe Grib::probe(const std::string &filename,
+                        const VariableNames &names) {
+  const auto reference = GribIndex::splitReference(filename);
+  const auto index = GribIndex::get(reference.first);
+
+  SourceProbe probe;
+  for (const auto &e : index->entries()) {
+    if (std::find(probe.fields.begin(), probe.fields.end(), e.shortName) ==
+        probe.fields.end()) {
+      probe.fields.push_back(e.shortName);
+    }
+  }
+  probe.addVariables(names, [&](const std::string &name) {
+    return index->contains(name);
+  });
+
+  const auto precipitation =
+      index->find(names.precipitation(), reference.second);
+  if (precipitation) {
+    probe.precipitationStepLength = parseStepLength(precipitation->stepRange);
+  }
+
+  const auto entry = [&]() {
+    if (auto e = index->find(names.pressure(), reference.second)) {
+      return e;
+    } else if (precipitation) {
+      return precipitation;
+    } else {
+      metbuild_throw_exception(
+          "Could not find a valid variable (tried pressure and precip)");
+    }
+  }();
+
+  probe.steps = index->steps(entry->shortName);
+
+  auto handle = GribHandle(reference.first, *entry);
+  auto get_long = [&](const char *key) {
+    long v = 0;
+    CODES_CHECK(codes_get_long(handle.ptr(), key, &v), nullptr);
+    return static_cast<size_t>(v);
+  };
+  auto get_double = [&](const char *key, double default_value) {
+    double v = default_value;
+    if (codes_get_double(handle.ptr(), key, &v) != GRIB_SUCCESS) {
+      v = default_value;
+    }
+    return v;
+  };
+
+  probe.ni = get_long("Ni");
+  probe.nj = get_long("Nj");
+  probe.size = get_long("numberOfDataPoints");
+
+  size_t len = 0;
+  if (codes_get_length(handle.ptr(), "gridType", &len) == GRIB_SUCCESS) {
+    probe.gridType.resize(len, ' ');
+    CODES_CHECK(
+        codes_get_string(handle.ptr(), "gridType", &probe.gridType[0], &len),
+        nullptr);
+    boost::trim_if(probe.gridType, Utilities::isNotAlpha);
+  }
+
+  probe.firstLongitude = get_double("longitudeOfFirstGridPointInDegrees", 0.0);
+  probe.firstLatitude = get_double("latitudeOfFirstGridPointInDegrees", 0.0);
+  probe.lastLongitude = get_double("longitudeOfLastGridPointInDegrees", 0.0);
+  probe.lastLatitude = get_double("latitudeOfLastGridPointInDegrees", 0.0);
+  if (probe.gridType == "lambert" || probe.gridType == "polar_stereographic") {
+    probe.dx = get_double("DxInMetres", 0.0);
+    probe.dy = get_double("DyInMetres", 0.0);
   } else {
-    return false;
+    probe.dx = get_double("iDirectionIncrementInDegrees", 0.0);
+    probe.dy = get_double("jDirectionIncrementInDegrees", 0.0);
   }
+  return probe;
 }
 
-std::vector<double> Grib::getArray1d(const std::string &name) {
+/**
+ * @brief Decoded values of a variable in the source precision, decoding the
+ * message the first time the variable is requested
+ * @param name grib short name of the variable
+ */
+std::vector<SourceDataType> &Grib::sourceArray1d(const std::string &name) {
   if (name.empty()) {
     Logging::throwError("Empty variable specified for read.");
   }
   auto pvm = m_preread_value_map.find(name);
   if (pvm == m_preread_value_map.end()) {
-    std::vector<double> arr1d(this->size(), 0.0);
-    size_t s = this->size();
-    auto handle = GribHandle(this->filenames()[0], name);
-    CODES_CHECK(
-        codes_get_double_array(handle.ptr(), "values", arr1d.data(), &s),
-        nullptr);
-    m_preread_values.push_back(arr1d);
+    auto entry = m_index->find(name, m_step);
+    if (!entry) {
+      metbuild_throw_exception(
+          "Could not generate the eccodes handle for variable: '" + name +
+          "'");
+    }
+    m_preread_values.push_back(this->acquireBuffer<SourceDataType>());
+    auto handle = GribHandle(m_grib_file, *entry);
+    this->decodeValues(handle.ptr(), m_preread_values.back());
     m_preread_value_map[name] = m_preread_values.size() - 1;
+    this->trackPrereadMemory();
     return m_preread_values.back();
   } else {
     return m_preread_values[pvm->second];
   }
 }
 
+std::vector<double> Grib::getArray1d(const std::string &name) {
+  const auto &values = this->sourceArray1d(name);
+  return {values.begin(), values.end()};
+}
+
+std::vector<SourceDataType> Grib::releaseSourceArray1d(
+    const std::string &name, const double unit_conversion) {
+  this->sourceArray1d(name);
+  auto pvm = m_preread_value_map.find(name);
+  auto values = std::move(m_preread_values[pvm->second]);
+  m_preread_value_map.erase(pvm);
+  this->trackPrereadMemory();
+  if (unit_conversion != 1.0) {
+    for (auto &v : values) {
+      v = static_cast<SourceDataType>(v * unit_conversion);
+    }
+  }
+  return values;
+}
+
+std::vector<double> Grib::releaseArray1d(const std::string &name) {
+#ifdef METBUILD_SOURCE_FLOAT
+  auto values = this->releaseSourceArray1d(name, 1.0);
+  auto out = this->acquireBuffer();
+  out.assign(values.begin(), values.end());
+  this->releaseBuffer(std::move(values));
+  return out;
+#else
+  return this->releaseSourceArray1d(name, 1.0);
+#endif
+}
+
+/**
+ * @brief Decodes all requested variables that are not yet cached, visiting
+ * the messages in file order. Variables of a mapped file are decoded in
+ * parallel, otherwise a single file handle is used
+ * @param names grib short names of the variables to decode
+ */
+void Grib::preloadArrays(const std::vector<std::string> &names) {
+  std::vector<std::pair<const GribIndex::Entry *, std::string>> pending;
+  for (const auto &name : names) {
+    if (name.empty()) continue;
+    if (m_preread_value_map.find(name) != m_preread_value_map.end()) continue;
+    auto entry = m_index->find(name, m_step);
+    if (!entry) {
+      metbuild_throw_exception(
+          "Could not generate the eccodes handle for variable: '" + name +
+          "'");
+    }
+    pending.emplace_back(entry, name);
+  }
+  if (pending.empty()) return;
+
+  std::sort(pending.begin(), pending.end(), [](const auto &a, const auto &b) {
+    return std::tie(a.first->offset, a.first->field) <
+           std::tie(b.first->offset, b.first->field);
+  });
+
+  const size_t first = m_preread_values.size();
+  for (size_t k = 0; k < pending.size(); ++k) {
+    m_preread_values.push_back(this->acquireBuffer<SourceDataType>());
+  }
+  auto mapping = GribHandle::useMemoryMap()
+                     ? MappedFile::get(m_grib_file)
+                     : MappedFile::buffer(m_grib_file);
+  if (mapping) {
+    //...Handles made from the mapped messages share no file position, so
+    // the variables are decoded at the same time. The crop window is found
+    // first since every decode reads it
+    this->decodeIndex();
+    ThreadPool::global().parallel_for(0, pending.size(), [&](const size_t k) {
+      auto handle = GribHandle(mapping, *pending[k].first);
+      this->decodeValues(handle.ptr(), m_preread_values[first + k]);
+    });
+  } else {
+    auto f = FileWrapper(m_grib_file, "r");
+    for (size_t k = 0; k < pending.size(); ++k) {
+      auto handle = GribHandle(f.ptr(), *pending[k].first);
+      this->decodeValues(handle.ptr(), m_preread_values[first + k]);
+    }
+  }
+  for (size_t k = 0; k < pending.size(); ++k) {
+    m_preread_value_map[pending[k].second] = first + k;
+  }
+  this->trackPrereadMemory();
+}
+
+/**
+ * @brief Counts the decoded values held for later reads as source memory
+ */
+void Grib::trackPrereadMemory() {
+  size_t bytes = 0;
+  for (const auto &v : m_preread_values) {
+    bytes += v.capacity() * sizeof(SourceDataType);
+  }
+  m_preread_memory.set(bytes);
+}
+
 std::vector<std::vector<double>> Grib::getArray2d(const std::string &name) {
   if (name.empty()) {
     Logging::throwError("Empty variable specified for read.");
@@ -174,65 +526,732 @@ std::vector<std::vector<double>> Grib::mapTo2d(const std::vector<double> &v,
   return arr2d;
 }
 
+/**
+ * @brief Key identifying the grid of a message. The grid definition section
+ * is hashed by eccodes; messages without the key fall back to the grid
+ * dimensions, end points and increments
+ */
+std::string Grib::gridKey(codes_handle *handle, const std::string &gridType,
+                          size_t ni, size_t nj, size_t size,
+                          COORDINATE_CONVENTION convention) {
+  const auto prefix = fmt::format("{}:{}:{}:{}:{}:", gridType, ni, nj, size,
+                                  static_cast<int>(convention));
+
+  char md5[64] = {0};
+  size_t len = sizeof(md5);
+  if (codes_get_string(handle, "md5GridSection", md5, &len) == GRIB_SUCCESS) {
+    return prefix + md5;
+  }
+
+  auto get = [&](const char *key) {
+    double v = std::numeric_limits<double>::quiet_NaN();
+    if (codes_get_double(handle, key, &v) != GRIB_SUCCESS) {
+      v = std::numeric_limits<double>::quiet_NaN();
+    }
+    return v;
+  };
+  return prefix +
+         fmt::format("{:.6f}:{:.6f}:{:.6f}:{:.6f}:{:.6f}:{:.6f}:{:.6f}:{:.6f}",
+                     get("latitudeOfFirstGridPointInDegrees"),
+                     get("longitudeOfFirstGridPointInDegrees"),
+                     get("latitudeOfLastGridPointInDegrees"),
+                     get("longitudeOfLastGridPointInDegrees"),
+                     get("iDirectionIncrementInDegrees"),
+                     get("jDirectionIncrementInDegrees"), get("DxInMetres"),
+                     get("DyInMetres"));
+}
+
+/**
+ * @brief Reads the source point positions and corners. These are shared by
+ * every file on the same grid, so they are only decoded the first time a
+ * grid definition is seen while an earlier file on it is still in use or
+ * while the WarmCache keeps it
+ * @param handle handle to a message on the grid
+ */
 void Grib::readCoordinates(codes_handle *handle) {
-  if (m_latitude.empty()) {
-    m_latitude.resize(this->size());
-    size_t s = size();
-    CODES_CHECK(
-        codes_get_double_array(handle, "latitudes", m_latitude.data(), &s),
-        nullptr);
+  m_grid_key = Grib::gridKey(handle, m_gridType, ni(), nj(), size(),
+                             this->convention()) +
+               ":" + m_projected_crs;
+  this->setFingerprint(Hash().add(m_grid_key).value());
+
+  const bool generate = Grib::generateCoordinates();
+  m_grid_key += generate ? ":generated" : "";
+  m_grid = Grib::gridCache().acquire(m_grid_key, [&]() {
+    auto g = std::make_shared<GridDefinition>();
+    if (!generate || !this->computeCoordinates(handle, g.get())) {
+      g->latitude.resize(this->size());
+      size_t s = this->size();
+      CODES_CHECK(
+          codes_get_double_array(handle, "latitudes", g->latitude.data(), &s),
+          nullptr);
+
+      g->longitude.resize(this->size());
+      s = this->size();
+      CODES_CHECK(codes_get_double_array(handle, "longitudes",
+                                         g->longitude.data(), &s),
+                  nullptr);
+      for (auto &v : g->longitude) {
+        v = convert_longitude(v, this->convention());
+      }
+    }
+    Grib::findGridCorners(g.get(), ni());
+    return std::shared_ptr<const GridDefinition>(std::move(g));
+  });
+}
+
+/**
+ * @brief Registry of the grid definitions in use, keyed by grid
+ */
+SharedCache<const Grib::GridDefinition> &Grib::gridCache() {
+  static SharedCache<const GridDefinition> s_grids(
+      "grib_grid", [](const GridDefinition &g) {
+        return (g.latitude.size() + g.longitude.size()) * sizeof(double);
+      });
+  return s_grids;
+}
+
+/**
+ * @brief Finds the corners of a grid from its first and last rows
+ * @param g grid definition holding the point positions
+ * @param ni number of points in a row
+ */
+void Grib::findGridCorners(GridDefinition *g, const size_t ni) {
+  const auto &x = g->longitude;
+  const auto &y = g->latitude;
+  const size_t n = ni;
+  const double xtl = *(std::min_element(x.begin(), x.begin() + n - 1));
+  const double xtr = *(std::max_element(x.begin(), x.begin() + n - 1));
+  const double xll = *(std::min_element(x.end() - n, x.end()));
+  const double xlr = *(std::max_element(x.end() - n, x.end()));
+  const double ytl = *(std::min_element(y.begin(), y.begin() + n - 1));
+  const double ytr = *(std::max_element(y.begin(), y.begin() + n - 1));
+  const double yll = *(std::min_element(y.end() - n, y.end()));
+  const double ylr = *(std::max_element(y.end() - n, y.end()));
+  g->corners = {Point(xll, yll), Point(xlr, ylr), Point(xtr, ytr),
+                Point(xtl, ytl)};
+  g->corner_geometry = std::make_shared<const Geometry>(g->corners);
+}
+
+/**
+ * @brief Computes the point positions from the grid definition rather than
+ * having eccodes iterate over every point
+ *
+ * Regular latitude/longitude grids are built from one row of longitudes and
+ * one column of latitudes, between the first and last grid points as
+ * eccodes does. Lambert conformal and polar stereographic grids step across
+ * the projection plane from the first grid point and transform the whole
+ * plane to geographic coordinates in one call. Longitudes are given in
+ * [0, 360) before the coordinate convention is applied, as eccodes gives them
+ *
+ * @param handle handle to a message on the grid
+ * @param g grid definition receiving the positions
+ * @return false when the grid is not one computed here, in which case eccodes
+ * provides the positions
+ */
+bool Grib::computeCoordinates(codes_handle *handle, GridDefinition *g) const {
+  const size_t n_i = ni();
+  const size_t n_j = nj();
+  if (n_i < 2 || n_j < 2 || n_i * n_j != this->size()) return false;
+
+  auto get_long = [&](const char *key, long &v) {
+    return codes_get_long(handle, key, &v) == GRIB_SUCCESS;
+  };
+  auto get_double = [&](const char *key, double &v) {
+    return codes_get_double(handle, key, &v) == GRIB_SUCCESS;
+  };
+
+  long i_negative = 0;
+  long j_positive = 0;
+  long j_consecutive = 0;
+  long alternative = 0;
+  if (!get_long("iScansNegatively", i_negative) ||
+      !get_long("jScansPositively", j_positive) ||
+      !get_long("jPointsAreConsecutive", j_consecutive)) {
+    return false;
   }
-  if (m_longitude.empty()) {
-    m_longitude.resize(this->size());
-    size_t s = this->size();
-    CODES_CHECK(
-        codes_get_double_array(handle, "longitudes", m_longitude.data(), &s),
-        nullptr);
-    if (this->convention() == CONVENTION_180) {
-      for (auto &v : m_longitude) {
-        v = (std::fmod(v + 180.0, 360.0)) - 180.0;
+  if (get_long("alternativeRowScanning", alternative) && alternative != 0) {
+    return false;
+  }
+  if (j_consecutive != 0) return false;
+
+  double lat1;
+  double lon1;
+  if (!get_double("latitudeOfFirstGridPointInDegrees", lat1) ||
+      !get_double("longitudeOfFirstGridPointInDegrees", lon1)) {
+    return false;
+  }
+
+  g->latitude.resize(this->size());
+  g->longitude.resize(this->size());
+
+  if (m_gridType == "regular_ll") {
+    double lat2;
+    double lon2;
+    if (!get_double("latitudeOfLastGridPointInDegrees", lat2) ||
+        !get_double("longitudeOfLastGridPointInDegrees", lon2)) {
+      return false;
+    }
+    if (i_negative == 0 && lon2 < lon1) lon2 += 360.0;
+    if (i_negative != 0 && lon2 > lon1) lon2 -= 360.0;
+    const double di = (lon2 - lon1) / static_cast<double>(n_i - 1);
+    const double dj = (lat2 - lat1) / static_cast<double>(n_j - 1);
+
+    std::vector<double> row(n_i);
+    for (size_t i = 0; i < n_i; ++i) {
+      row[i] = convert_longitude(lon1 + static_cast<double>(i) * di,
+                                 this->convention());
+    }
+    for (size_t j = 0; j < n_j; ++j) {
+      const double lat = lat1 + static_cast<double>(j) * dj;
+      std::copy(row.begin(), row.end(), g->longitude.begin() + j * n_i);
+      std::fill_n(g->latitude.begin() + j * n_i, n_i, lat);
+    }
+    return true;
+  }
+
+  if (m_projected_crs.empty()) return false;
+  double dx;
+  double dy;
+  if (!get_double("DxInMetres", dx) || !get_double("DyInMetres", dy)) {
+    return false;
+  }
+  if (i_negative != 0) dx = -dx;
+  if (j_positive == 0) dy = -dy;
+
+  auto &x = g->longitude;
+  auto &y = g->latitude;
+  try {
+    double x0 = lon1;
+    double y0 = lat1;
+    Projection::Transformer(m_geographic_crs, m_projected_crs)
+        .transform(x0, y0);
+    if (!std::isfinite(x0) || !std::isfinite(y0)) return false;
+
+    for (size_t j = 0; j < n_j; ++j) {
+      for (size_t i = 0; i < n_i; ++i) {
+        x[j * n_i + i] = x0 + static_cast<double>(i) * dx;
+        y[j * n_i + i] = y0 + static_cast<double>(j) * dy;
+      }
+    }
+    Projection::Transformer(m_projected_crs, m_geographic_crs).transform(x, y);
+  } catch (const std::exception &e) {
+    Logging::warning(e.what());
+    return false;
+  }
+  for (size_t k = 0; k < x.size(); ++k) {
+    if (!std::isfinite(x[k]) || !std::isfinite(y[k])) return false;
+    if (x[k] < 0.0) x[k] += 360.0;
+    x[k] = convert_longitude(x[k], this->convention());
+  }
+  return true;
+}
+
+/**
+ * @brief Whether the coordinates of the grids which allow it are computed
+ * from their grid definition rather than decoded by eccodes. Enabled by
+ * default
+ */
+void Grib::setGenerateCoordinates(bool value) {
+  s_generate_coordinates = value;
+}
+
+bool Grib::generateCoordinates() { return s_generate_coordinates; }
+
+/**
+ * @brief Reads regular global latitude/longitude grids much finer than the
+ * output grid on every factor-th row and column when source decimation is
+ * enabled
+ *
+ * The factor is the largest one no wider than the output spacing which
+ * divides the rows and columns of the grid evenly. Each decoded field is
+ * averaged onto the kept points over a box as wide as the factor, so the
+ * source holds the mean of the cells each output point stands for rather
+ * than samples of them. Rows wrap around the globe, so boxes at either end
+ * of a row take points from the other end, and the first kept column is
+ * repeated at the end of each row so that the grid reaches the dateline. A
+ * source is decimated at most once, before any of its values are read
+ *
+ * @param spacing smallest distance in degrees between output points
+ */
+void Grib::setOutputSpacing(const double spacing) {
+  if (!Grib::sourceDecimation() || m_decimation > 1) return;
+  if (m_gridType != "regular_ll" || !std::isfinite(spacing) || spacing <= 0.0) {
+    return;
+  }
+  const size_t n_i = ni();
+  const size_t n_j = nj();
+  if (n_i < 2 || n_j < 2 || n_i * n_j != this->size()) return;
+
+  const auto &x = this->longitude1d();
+  const auto &y = this->latitude1d();
+  double di = std::fabs(x[1] - x[0]);
+  if (di > 180.0) di = 360.0 - di;
+  const double dj = std::fabs(y[n_i] - y[0]);
+  if (di <= 0.0 || std::fabs(di * static_cast<double>(n_i) - 360.0) > 1e-6) {
+    return;
+  }
+
+  auto factor =
+      static_cast<size_t>(std::floor(spacing / std::max(di, dj) + 1e-6));
+  while (factor >= 2 && (n_i % factor != 0 || (n_j - 1) % factor != 0)) {
+    --factor;
+  }
+  if (factor < 2) return;
+
+  //...The kept columns stop one box short of the dateline, so the column
+  // with the smallest longitude is repeated a full turn later to close it
+  const size_t n_cols = n_i / factor;
+  const size_t c_i = n_cols + 1;
+  const size_t c_j = (n_j - 1) / factor + 1;
+  size_t wrap = 0;
+  for (size_t i = 1; i < n_cols; ++i) {
+    if (x[i * factor] < x[wrap * factor]) wrap = i;
+  }
+  const auto key = fmt::format("{}:decimated:{}", m_grid_key, factor);
+  m_grid = Grib::gridCache().acquire(key, [&]() {
+    auto g = std::make_shared<GridDefinition>();
+    g->latitude.resize(c_i * c_j);
+    g->longitude.resize(c_i * c_j);
+    for (size_t j = 0; j < c_j; ++j) {
+      for (size_t i = 0; i < c_i; ++i) {
+        const size_t k = j * factor * n_i + (i < n_cols ? i : wrap) * factor;
+        g->latitude[j * c_i + i] = y[k];
+        g->longitude[j * c_i + i] = i < n_cols ? x[k] : x[k] + 360.0;
+      }
+    }
+    Grib::findGridCorners(g.get(), c_i);
+    return std::shared_ptr<const GridDefinition>(std::move(g));
+  });
+
+  Logging::debug(fmt::format(
+      "Decimating the {:d}x{:d} source grid by {:d} for an output spacing "
+      "of {:.4f} degrees",
+      n_i, n_j, factor, spacing));
+  m_field_ni = n_i;
+  m_field_nj = n_j;
+  m_decimation = factor;
+  m_wrap_column = wrap * factor;
+  m_grid_key = key;
+  m_decode_index.clear();
+  m_decode_index_ready = false;
+  this->setNi(c_i);
+  this->setNj(c_j);
+  this->setSize(c_i * c_j);
+  this->setFingerprint(Hash().add(key).value());
+  this->findCorners();
+  this->shareBoundingRegion([this]() { return this->globalOutline(); });
+}
+
+/**
+ * @brief Factor the grid of the source is decimated by, 1 when the source
+ * is read on the grid of its messages
+ */
+size_t Grib::decimation() const { return m_decimation; }
+
+/**
+ * @brief Whether regular global sources much finer than the output grid are
+ * block averaged onto a coarser grid before they are interpolated. Disabled
+ * by default, or enabled with the METBUILD_SOURCE_DECIMATION environment
+ * variable
+ */
+void Grib::setSourceDecimation(bool value) { s_source_decimation = value; }
+
+bool Grib::sourceDecimation() { return s_source_decimation; }
+
+/**
+ * @brief Number of points in each message, which differs from the size of
+ * the source when it is decimated
+ */
+size_t Grib::fieldSize() const {
+  return m_decimation > 1 ? m_field_ni * m_field_nj : this->size();
+}
+
+/**
+ * @brief Sets the outline of the source, building it only for the first
+ * file on the grid
+ * @param build generates the outline vertices in order
+ */
+void Grib::shareBoundingRegion(
+    const std::function<std::vector<MetBuild::Point>()> &build) {
+  std::call_once(m_grid->outline_flag, [&]() {
+    auto region = std::make_shared<const std::vector<Point>>(build());
+    if (region->size() >= 3) {
+      m_grid->outline_geometry = std::make_shared<const Geometry>(*region);
+    }
+    m_grid->outline = std::move(region);
+  });
+  this->set_bounding_region(m_grid->outline, m_grid->outline_geometry);
+}
+
+/**
+ * Walk the outside of the GRIB data to create a bounding region
+ * @return bounding region of points in anticlockwise orientation
+ */
+std::vector<Point> Grib::perimeter() const {
+  std::vector<Point> region;
+  const auto &longitude = this->longitude1d();
+  const auto &latitude = this->latitude1d();
+  const auto n_i = static_cast<size_t>(ni());
+  const auto n_j = static_cast<size_t>(nj());
+
+  // Bottom Left --> Bottom Right
+  for (size_t i = 0; i < n_i; ++i) {
+    region.emplace_back(longitude[i], latitude[i]);
+  }
+
+  // Bottom Right --> Top Right
+  for (size_t i = 1; i < n_j; ++i) {
+    region.emplace_back(longitude[i * n_i - 1], latitude[i * n_i - 1]);
+  }
+
+  // Top Right --> Top Left
+  for (size_t i = 0; i < n_i; ++i) {
+    region.emplace_back(longitude[n_j * n_i - 1 - i],
+                        latitude[n_j * n_i - 1 - i]);
+  }
+
+  // Top Left --> Bottom Left (note: skips last point)
+  for (size_t i = n_j - 1; i > 0; --i) {
+    region.emplace_back(longitude[i * n_i], latitude[i * n_i]);
+  }
+
+  return region;
+}
+
+/**
+ * @brief Bounding region of a global latitude and longitude grid, closed
+ * along the poles and the dateline
+ */
+std::vector<Point> Grib::globalOutline() const {
+  const auto &x = this->longitude1d();
+  const auto &y = this->latitude1d();
+  std::vector<Point> region;
+
+  const auto n_i = static_cast<size_t>(ni());
+  const auto n_j = static_cast<size_t>(nj());
+
+  std::vector<double> top;
+  for (size_t i = 0; i < n_i; ++i) {
+    top.push_back(x[i]);
+  }
+  std::sort(top.begin(), top.end());
+  for (const auto &v : top) {
+    region.emplace_back(v, 90.0);
+  }
+
+  std::vector<double> right;
+  for (size_t i = 0; i < n_j; ++i) {
+    right.push_back(y[i * n_i]);
+  }
+
+  for (const auto &v : right) {
+    region.emplace_back(top.back(), v);
+  }
+
+  for (auto it = top.rbegin(); it != top.rend(); ++it) {
+    region.emplace_back(*(it), -90);
+  }
+
+  for (auto it = right.rbegin(); it != right.rend(); ++it) {
+    region.emplace_back(top.front(), *(it));
+  }
+
+  return region;
+}
+
+/**
+ * @brief Indices of the source points inside the crop window of the decode
+ * extent, empty when the whole field is needed
+ */
+const std::vector<int> &Grib::decodeIndex() {
+  if (m_decode_index_ready) return m_decode_index;
+  m_decode_index_ready = true;
+  if (!this->decodeExtent()) return m_decode_index;
+
+  const auto window =
+      Triangulation::crop_window(this->longitude1d(), this->latitude1d(),
+                                 ni(), nj(), *this->decodeExtent());
+  if (!window) return m_decode_index;
+
+  Hash h;
+  h.add(window->i0).add(window->j0).add(window->ni).add(window->nj);
+  size_t n_i = ni();
+  size_t i0 = window->i0;
+  size_t i1 = window->i0 + window->ni;
+  size_t j0 = window->j0;
+  size_t j1 = window->j0 + window->nj;
+  if (m_decimation > 1) {
+    //...The boxes of a decimated grid reach half a box past its points on
+    // the grid of the messages, and wrap around the rows at either end
+    const size_t f = m_decimation;
+    const size_t half = f / 2;
+    h.add(f);
+    n_i = m_field_ni;
+    j0 = j0 * f > half ? j0 * f - half : 0;
+    j1 = std::min(m_field_nj, (j1 - 1) * f + half + 1);
+    if (i0 * f < half || (i1 - 1) * f + half >= m_field_ni) {
+      i0 = 0;
+      i1 = m_field_ni;
+    } else {
+      i0 = i0 * f - half;
+      i1 = (i1 - 1) * f + half + 1;
+    }
+  }
+  m_decode_window = h.value();
+  m_decode_index.reserve((i1 - i0) * (j1 - j0));
+  for (size_t j = j0; j < j1; ++j) {
+    for (size_t i = i0; i < i1; ++i) {
+      m_decode_index.push_back(static_cast<int>(j * n_i + i));
+    }
+  }
+  return m_decode_index;
+}
+
+/**
+ * @brief Decodes the values of a message
+ *
+ * Simply packed fields without a bitmap can be unpacked point by point, so
+ * only the points inside the crop window of the decode extent are decoded
+ * and the rest of the field is left at zero. These points are the only ones
+ * the interpolation weights refer to. Other packings decode the whole field,
+ * with the native GribUnpacker when it is enabled and supports the packing,
+ * otherwise straight to single precision when the source data is single
+ * precision and eccodes supports it
+ *
+ * Decimated sources decode the field on the grid of the message and block
+ * average it onto their own grid
+ *
+ * With the SharedFieldStore enabled, a message already decoded by any
+ * process on the node is copied from shared memory instead, and messages
+ * decoded here are published to it
+ *
+ * @param handle handle to the message
+ * @param values decoded values, one per source point
+ */
+void Grib::decodeValues(codes_handle *handle,
+                        std::vector<SourceDataType> &values) {
+  const auto &index = this->decodeIndex();
+
+  std::string shared_key;
+  if (SharedFieldStore::enabled()) {
+    const void *message = nullptr;
+    size_t length = 0;
+    if (codes_get_message(handle, &message, &length) == GRIB_SUCCESS) {
+      shared_key = SharedFieldStore::key(message, length, m_decode_window,
+                                         this->size());
+      const auto field = SharedFieldStore::attach(shared_key);
+      if (field && field->size() == this->size()) {
+        values.assign(field->data(), field->data() + field->size());
+        return;
       }
     }
   }
+
+  Instrumentation::ScopedTimer timer(
+      Instrumentation::DECODE,
+      index.empty() ? this->fieldSize() : index.size());
+  if (m_decimation > 1) {
+    auto field = this->acquireBuffer<SourceDataType>();
+    this->decodeField(handle, field);
+    this->decimateValues(handle, field, values);
+    this->releaseBuffer(std::move(field));
+  } else {
+    this->decodeField(handle, values);
+  }
+  if (!shared_key.empty()) {
+    SharedFieldStore::publish(shared_key, values.data(), values.size());
+  }
+}
+
+/**
+ * @brief Decodes the values of a message on the grid of the message
+ * @param handle handle to the message
+ * @param values decoded values, one per point of the message
+ */
+void Grib::decodeField(codes_handle *handle,
+                       std::vector<SourceDataType> &values) {
+  const auto &index = this->decodeIndex();
+  const size_t size = this->fieldSize();
+  values.reserve(size);
+  MemoryPolicy::advise(values.data(),
+                       values.capacity() * sizeof(SourceDataType));
+  if (!index.empty()) {
+    char packing[64] = {0};
+    size_t len = sizeof(packing);
+    long bitmap = 1;
+    if (codes_get_string(handle, "packingType", packing, &len) ==
+            GRIB_SUCCESS &&
+        codes_get_long(handle, "bitmapPresent", &bitmap) == GRIB_SUCCESS &&
+        std::string(packing) == "grid_simple" && bitmap == 0) {
+      std::vector<double> subset(index.size());
+      CODES_CHECK(
+          codes_get_double_elements(handle, "values", index.data(),
+                                    static_cast<long>(index.size()),
+                                    subset.data()),
+          nullptr);
+      values.assign(size, 0.0);
+      for (size_t k = 0; k < index.size(); ++k) {
+        values[index[k]] = static_cast<SourceDataType>(subset[k]);
+      }
+      return;
+    }
+  }
+
+  values.resize(size);
+  if (!unpack_native(handle, values)) {
+    size_t s = size;
+    CODES_CHECK(get_values(handle, values.data(), &s), nullptr);
+  }
+}
+
+/**
+ * @brief Block averages a field decoded on the grid of its message onto the
+ * decimated grid of the source. Points flagged as missing by a bitmap are
+ * left out of the averages, and points without any valid value in their box
+ * are given the missing value
+ * @param handle handle to the message
+ * @param field values on the grid of the message
+ * @param values values on the grid of the source
+ */
+void Grib::decimateValues(codes_handle *handle,
+                          const std::vector<SourceDataType> &field,
+                          std::vector<SourceDataType> &values) const {
+  long bitmap = 0;
+  if (codes_get_long(handle, "bitmapPresent", &bitmap) != GRIB_SUCCESS) {
+    bitmap = 0;
+  }
+  double missing = 9999.0;
+  if (bitmap != 0 &&
+      codes_get_double(handle, "missingValue", &missing) != GRIB_SUCCESS) {
+    missing = 9999.0;
+  }
+  const auto flag = static_cast<SourceDataType>(missing);
+
+  const size_t f = m_decimation;
+  const size_t half = f / 2;
+  const auto w = box_weights(f);
+  const size_t n_i = m_field_ni;
+  const size_t n_j = m_field_nj;
+  const size_t c_i = ni();
+  const size_t c_j = nj();
+
+  //...Rows are averaged first, keeping the weight of their valid points
+  // when there is a bitmap so that the columns can leave the others out
+  std::vector<double> rows(n_j * c_i);
+  std::vector<double> row_weights(bitmap != 0 ? n_j * c_i : 0);
+  ThreadPool::global().parallel_for(0, n_j, [&](const size_t j) {
+    const auto *row = field.data() + j * n_i;
+    for (size_t i = 0; i < c_i; ++i) {
+      const size_t centre = i + 1 < c_i ? i * f : m_wrap_column;
+      double sum = 0.0;
+      double weight = 0.0;
+      for (size_t o = 0; o < w.size(); ++o) {
+        const auto v = row[(centre + n_i + o - half) % n_i];
+        if (bitmap != 0 && v == flag) continue;
+        sum += w[o] * v;
+        weight += w[o];
+      }
+      rows[j * c_i + i] = sum;
+      if (bitmap != 0) row_weights[j * c_i + i] = weight;
+    }
+  });
+
+  const double row_weight = static_cast<double>(f);
+  values.resize(c_i * c_j);
+  ThreadPool::global().parallel_for(0, c_j, [&](const size_t j) {
+    for (size_t i = 0; i < c_i; ++i) {
+      double sum = 0.0;
+      double weight = 0.0;
+      for (size_t o = 0; o < w.size(); ++o) {
+        if (j * f + o < half || j * f + o - half >= n_j) continue;
+        const size_t k = (j * f + o - half) * c_i + i;
+        sum += w[o] * rows[k];
+        weight += w[o] * (bitmap != 0 ? row_weights[k] : row_weight);
+      }
+      values[j * c_i + i] =
+          weight > 0.0 ? static_cast<SourceDataType>(sum / weight) : flag;
+    }
+  });
+}
+
+/**
+ * @brief Generates the proj definitions of the native projection for grids
+ * which are regular in a Lambert conformal or polar stereographic projection
+ * @param handle handle to a message on the grid
+ */
+void Grib::readProjection(codes_handle *handle) {
+  auto get = [&](const char *key, double default_value) {
+    double v = default_value;
+    if (codes_get_double(handle, key, &v) != GRIB_SUCCESS) v = default_value;
+    return v;
+  };
+
+  const double radius = get("radius", 6371229.0);
+  const auto earth = fmt::format("+R={:.3f} +units=m +no_defs +type=crs", radius);
+
+  if (m_gridType == "lambert") {
+    m_projected_crs = fmt::format(
+        "+proj=lcc +lat_1={:.9f} +lat_2={:.9f} +lat_0={:.9f} +lon_0={:.9f} {}",
+        get("Latin1InDegrees", 0.0), get("Latin2InDegrees", 0.0),
+        get("LaDInDegrees", 0.0), get("LoVInDegrees", 0.0), earth);
+  } else if (m_gridType == "polar_stereographic") {
+    long centre = 0;
+    if (codes_get_long(handle, "projectionCentreFlag", &centre) !=
+        GRIB_SUCCESS) {
+      centre = 0;
+    }
+    const double pole = (centre & 128) ? -90.0 : 90.0;
+    m_projected_crs = fmt::format(
+        "+proj=stere +lat_0={:.1f} +lat_ts={:.9f} +lon_0={:.9f} {}", pole,
+        get("LaDInDegrees", 60.0), get("orientationOfTheGridInDegrees", 0.0),
+        earth);
+  } else {
+    return;
+  }
+  m_geographic_crs = fmt::format(
+      "+proj=longlat +R={:.3f} +no_defs +type=crs", radius);
 }
 
 void Grib::write_to_ascii(const std::string &filename,
                           const std::string &varname) {
   auto values = this->getArray1d(varname);
   std::ofstream f(filename);
+  const auto &lon = this->longitude1d();
+  const auto &lat = this->latitude1d();
   for (size_t i = 0; i < this->size(); ++i) {
-    f << m_longitude[i] << ", " << m_latitude[i] << ", " << values[i] << "\n";
+    f << lon[i] << ", " << lat[i] << ", " << values[i] << "\n";
   }
   f.close();
 }
 
 void Grib::findCorners() {
-  double xtl = *(std::min_element(this->longitude1d().begin(),
-                                  this->longitude1d().begin() + ni() - 1));
-  double xtr = *(std::max_element(this->longitude1d().begin(),
-                                  this->longitude1d().begin() + ni() - 1));
-  double xll = *(std::min_element(this->longitude1d().end() - ni(),
-                                  this->longitude1d().end()));
-  double xlr = *(std::max_element(this->longitude1d().end() - ni(),
-                                  this->longitude1d().end()));
-
-  double ytl = *(std::min_element(this->latitude1d().begin(),
-                                  this->latitude1d().begin() + ni() - 1));
-  double ytr = *(std::max_element(this->latitude1d().begin(),
-                                  this->latitude1d().begin() + ni() - 1));
-  double yll = *(std::min_element(this->latitude1d().end() - ni(),
-                                  this->latitude1d().end()));
-  double ylr = *(std::max_element(this->latitude1d().end() - ni(),
-                                  this->latitude1d().end()));
-
-  std::array<Point, 4> corners = {Point(xll, yll), Point(xlr, ylr),
-                                  Point(xtr, ytr), Point(xtl, ytl)};
-  this->setCorners(corners);
-
-  auto geometry = std::make_unique<Geometry>(this->corners());
-  this->setGeometry(geometry);
-}
-
-Triangulation Grib::generate_triangulation() const {
-  return {m_longitude, m_latitude, this->bounding_region()};
+  this->setCorners(m_grid->corners);
+  this->setGeometry(m_grid->corner_geometry);
+}
+
+const std::string &Grib::gridType() const { return m_gridType; }
+
+const std::string &Grib::geographicCrs() const { return m_geographic_crs; }
+
+/**
+ * @brief Projection the grid is defined on, empty for grids defined in
+ * geographic coordinates
+ */
+const std::string &Grib::projectedCrs() const { return m_projected_crs; }
+
+Triangulation Grib::generate_triangulation(
+    const Triangulation::Extent &extent) const {
+  if (m_gridType == "regular_ll" &&
+      Triangulation::isRectilinear(this->longitude1d(), this->latitude1d(),
+                                   ni(), nj())) {
+    return Triangulation::structured(this->longitude1d(), this->latitude1d(),
+                                     ni(), nj());
+  }
+  if (!m_projected_crs.empty()) {
+    return Triangulation::curvilinear(this->longitude1d(), this->latitude1d(),
+                                      ni(), nj(), m_geographic_crs,
+                                      m_projected_crs);
+  }
+  return Triangulation::connected(this->longitude1d(), this->latitude1d(),
+                                  ni(), nj(), extent);
 }
@@ -30,15 +30,21 @@
 #define METBUILD_GRIB_H
 
 #include <array>
+#include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "CoordinateConvention.h"
+#include "GribIndex.h"
 #include "GriddedData.h"
+#include "Instrumentation.h"
 #include "Point.h"
+#include "SourceProbe.h"
 #include "VariableNames.h"
 #include "VariableUnits.h"
 
@@ -51,6 +57,9 @@ typedef struct grib_context codes_context;
 
 namespace MetBuild {
 
+template <typename T>
+class SharedCache;
+
 class Grib : public GriddedData {
  public:
   explicit Grib(std::string filename, MetBuild::VariableNames variable_names,
@@ -73,7 +82,42 @@ class Grib : public GriddedData {
   static int getStepLength(const std::string &filename,
                            const std::string &parameter);
 
-  MetBuild::Triangulation generate_triangulation() const override;
+  int precipitationStepLength() const;
+
+  NODISCARD double fieldScaling(
+      MetBuild::GriddedDataTypes::VARIABLES v) const override;
+
+  static MetBuild::SourceProbe probe(const std::string &filename,
+                                     const MetBuild::VariableNames &names);
+
+  MetBuild::Triangulation generate_triangulation(
+      const MetBuild::Triangulation::Extent &extent) const override;
+
+  const std::string &gridType() const;
+
+  const std::string &geographicCrs() const;
+
+  const std::string &projectedCrs() const;
+
+  static void setGenerateCoordinates(bool value);
+
+  NODISCARD static bool generateCoordinates();
+
+  void setOutputSpacing(double spacing) override;
+
+  NODISCARD size_t decimation() const;
+
+  static void setSourceDecimation(bool value);
+
+  NODISCARD static bool sourceDecimation();
+
+ protected:
+  void shareBoundingRegion(
+      const std::function<std::vector<MetBuild::Point>()> &build);
+
+  NODISCARD std::vector<MetBuild::Point> perimeter() const;
+
+  NODISCARD std::vector<MetBuild::Point> globalOutline() const;
 
  private:
   void initialize();
@@ -83,15 +127,82 @@ class Grib : public GriddedData {
   std::vector<double> getArray1d(const std::string &name) override;
   std::vector<std::vector<double>> getArray2d(const std::string &name) override;
 
+  void preloadArrays(const std::vector<std::string> &names) override;
+
+  std::vector<double> releaseArray1d(const std::string &name) override;
+
+  std::vector<MetBuild::SourceDataType> releaseSourceArray1d(
+      const std::string &name, double unit_conversion) override;
+
+  std::vector<MetBuild::SourceDataType> &sourceArray1d(const std::string &name);
+
   void readCoordinates(codes_handle *handle);
+
+  void decodeValues(codes_handle *handle,
+                    std::vector<MetBuild::SourceDataType> &values);
+
+  void decodeField(codes_handle *handle,
+                   std::vector<MetBuild::SourceDataType> &values);
+
+  void decimateValues(codes_handle *handle,
+                      const std::vector<MetBuild::SourceDataType> &field,
+                      std::vector<MetBuild::SourceDataType> &values) const;
+
+  NODISCARD size_t fieldSize() const;
+
+  const std::vector<int> &decodeIndex();
+
+  void trackPrereadMemory();
+
+  void readProjection(codes_handle *handle);
   static std::vector<std::vector<double>> mapTo2d(const std::vector<double> &v,
                                                   size_t ni, size_t nj);
 
-  std::vector<double> m_latitude;
-  std::vector<double> m_longitude;
-  std::vector<std::vector<double>> m_preread_values;
+  /**
+   * @brief Parts of a source which only depend on its grid definition,
+   * shared by every file on the same grid
+   */
+  struct GridDefinition {
+    std::vector<double> latitude;
+    std::vector<double> longitude;
+    std::array<MetBuild::Point, 4> corners;
+    std::shared_ptr<const MetBuild::Geometry> corner_geometry;
+    mutable std::once_flag outline_flag;
+    mutable std::shared_ptr<const std::vector<MetBuild::Point>> outline;
+    mutable std::shared_ptr<const MetBuild::Geometry> outline_geometry;
+  };
+
+  bool computeCoordinates(codes_handle *handle, GridDefinition *g) const;
+
+  static void findGridCorners(GridDefinition *g, size_t ni);
+
+  static SharedCache<const GridDefinition> &gridCache();
+
+  static std::string gridKey(codes_handle *handle, const std::string &gridType,
+                             size_t ni, size_t nj, size_t size,
+                             COORDINATE_CONVENTION convention);
+
+  std::string m_grib_file;
+  std::string m_grid_key;
+  long m_step = -1;
+  std::shared_ptr<const GridDefinition> m_grid;
+  std::vector<int> m_decode_index;
+  bool m_decode_index_ready = false;
+  uint64_t m_decode_window = 0;
+  size_t m_decimation = 1;
+  size_t m_wrap_column = 0;
+  size_t m_field_ni = 0;
+  size_t m_field_nj = 0;
+  std::vector<std::vector<MetBuild::SourceDataType>> m_preread_values;
   std::unordered_map<std::string, size_t> m_preread_value_map;
+  Instrumentation::MemoryTracker m_preread_memory{
+      Instrumentation::SOURCE_MEMORY};
   std::unique_ptr<FILE *> m_file;
+  std::shared_ptr<const GribIndex> m_index;
+  int m_precipitation_step_length = 1;
+  std::string m_gridType;
+  std::string m_geographic_crs;
+  std::string m_projected_crs;
 };
 }  // namespace MetBuild
 #endif  // METBUILD_GRIB_H
@@ -0,0 +1,58 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METGET_SRC_DATA_SOURCES_GRIBMESSAGE_H_
+#define METGET_SRC_DATA_SOURCES_GRIBMESSAGE_H_
+
+#include <string>
+
+#include "GriddedDataTypes.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Selector for one grib message decoded from a source file
+ *
+ * The short name is the ecCodes shortName used to find the message when the
+ * file is read. The parameter, level and step type are the fields of the
+ * message in the wgrib2 inventory (.idx) files published next to the grib
+ * files, so a downloader can fetch exactly the messages that are decoded.
+ * The step type is "instant", "avg" or "accum"
+ */
+struct GribMessage {
+  MetBuild::GriddedDataTypes::VARIABLES variable =
+      MetBuild::GriddedDataTypes::VAR_PRESSURE;
+  std::string shortName;
+  std::string parameter;
+  std::string level;
+  std::string stepType = "instant";
+};
+
+}  // namespace MetBuild
+
+#endif  // METGET_SRC_DATA_SOURCES_GRIBMESSAGE_H_
@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_DATA_SOURCES_GRIBSOURCE_H_
+#define METBUILD_SRC_DATA_SOURCES_GRIBSOURCE_H_
+
+#include <string>
+#include <vector>
+
+#include "Grib.h"
+#include "GribMessage.h"
+#include "SourceTraits.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Grib source generated from its compile time traits
+ *
+ * The names, units, convention and outline of the source are fixed when
+ * the class is instantiated, and its message selectors are checked when it
+ * is compiled
+ */
+template <typename Traits>
+class GribSource : public Grib {
+  static_assert(SourceTraits::valid_messages<Traits>(),
+                "Each variable of a source is read from one named message");
+
+ public:
+  using traits = Traits;
+
+  /**
+   * @brief Names of the source variables in the grib messages
+   */
+  static MetBuild::VariableNames sourceVariables() {
+    return SourceTraits::variable_names<Traits>();
+  }
+
+  /**
+   * @brief Selectors of the grib messages decoded from the source files
+   */
+  static std::vector<MetBuild::GribMessage> sourceMessages() {
+    return SourceTraits::grib_messages<Traits>();
+  }
+
+  explicit GribSource(const std::string &filename)
+      : Grib(filename, sourceVariables(), Traits::units, Traits::convention) {
+    this->shareBoundingRegion([this]() {
+      if constexpr (Traits::grid == SourceGrid::GLOBAL_LATLON) {
+        return this->globalOutline();
+      } else {
+        return this->perimeter();
+      }
+    });
+  }
+
+  ~GribSource() override = default;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_DATA_SOURCES_GRIBSOURCE_H_
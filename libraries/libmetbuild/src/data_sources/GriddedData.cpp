@@ -28,18 +28,52 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "GriddedData.h"
 
+#include <algorithm>
 #include <fstream>
+#include <type_traits>
 #include <utility>
 
 #define FMT_HEADER_ONLY
 #include <fmt/core.h>
 
 #include "Geometry.h"
+#include "Hash.h"
 #include "Logging.h"
 #include "Triangulation.h"
 
 using namespace MetBuild;
 
+namespace {
+
+/**
+ * @brief Converts decoded values to the source precision, applying the unit
+ * conversion in the same pass. The decoded buffer is reused when no
+ * narrowing is needed and otherwise goes back to the pool
+ */
+template <typename T>
+std::vector<T> to_source_data(std::vector<double> values,
+                              const double unit_conversion, BufferPool *pool) {
+  if constexpr (std::is_same_v<T, double>) {
+    if (unit_conversion != 1.0) {
+      for (auto &v : values) {
+        v *= unit_conversion;
+      }
+    }
+    return values;
+  } else {
+    auto out = pool ? pool->acquire<T>() : std::vector<T>();
+    out.resize(values.size());
+    std::transform(values.begin(), values.end(), out.begin(),
+                   [unit_conversion](const double v) {
+                     return static_cast<T>(v * unit_conversion);
+                   });
+    if (pool) pool->release(std::move(values));
+    return out;
+  }
+}
+
+}  // namespace
+
 GriddedData::GriddedData(std::string filename, VariableNames variableNames,
                          VariableUnits variableUnits,
                          COORDINATE_CONVENTION convention)
@@ -63,12 +97,18 @@ GriddedData::GriddedData(std::vector<std::string> filenames,
       m_variableNames(std::move(variableNames)),
       m_variableUnits(variableUnits) {}
 
-GriddedData::~GriddedData() = default;
+//...Cached values go back to the pool for the next snapshot decoded
+GriddedData::~GriddedData() {
+  if (!m_buffer_pool) return;
+  for (auto &v : m_variable_cache) {
+    m_buffer_pool->release(std::move(v.second));
+  }
+}
 
 std::vector<std::string> GriddedData::filenames() const { return m_filenames; }
 
 bool GriddedData::point_inside(const Point &p) const {
-  return this->m_geometry->is_inside(p);
+  return m_geometry && m_geometry->is_inside(p);
 }
 
 void GriddedData::setNi(size_t ni) { m_ni = ni; }
@@ -77,10 +117,75 @@ void GriddedData::setNj(size_t nj) { m_nj = nj; }
 
 void GriddedData::setSize(size_t size) { m_size = size; }
 
+/**
+ * @brief Sets the fingerprint of the source grid, for sources which can
+ * identify their grid without hashing the coordinates. Must be called before
+ * the source is shared between threads
+ */
+void GriddedData::setFingerprint(const GridFingerprint fingerprint) {
+  m_fingerprint = fingerprint;
+}
+
+/**
+ * @brief Identity of the source point positions. Sources that do not set
+ * one hash their coordinates the first time it is requested
+ */
+GridFingerprint GriddedData::fingerprint() const {
+  std::call_once(m_fingerprint_once, [this]() {
+    if (m_fingerprint != 0) return;
+    m_fingerprint = Hash()
+                        .add(static_cast<int>(m_convention))
+                        .add(this->longitude1d())
+                        .add(this->latitude1d())
+                        .value();
+  });
+  return m_fingerprint;
+}
+
 COORDINATE_CONVENTION GriddedData::convention() const { return m_convention; }
 
+/**
+ * @brief Limits the values decoded by later reads to the source points
+ * needed to interpolate onto an extent. Sources which cannot decode part of
+ * a field ignore it
+ * @param extent box holding every point the data will be interpolated to
+ */
+void GriddedData::setDecodeExtent(const Triangulation::Extent &extent) {
+  m_decode_extent = extent;
+}
+
+const std::optional<Triangulation::Extent> &GriddedData::decodeExtent() const {
+  return m_decode_extent;
+}
+
+/**
+ * @brief Gives the spacing of the grid the data will be interpolated to, so
+ * that sources much finer than it may be read on a coarser grid. Must be
+ * called before the coordinates or values are read. Sources which cannot
+ * be coarsened ignore it
+ * @param spacing smallest distance in degrees between output points
+ */
+void GriddedData::setOutputSpacing(double) {}
+
+/**
+ * @brief Sets the pool the value buffers are taken from and returned to
+ * @param pool buffer pool shared by the snapshots of a meteorology object
+ */
+void GriddedData::setBufferPool(std::shared_ptr<BufferPool> pool) {
+  m_buffer_pool = std::move(pool);
+}
+
+/**
+ * @brief Empty buffer for decoded values, recycled from the pool when one is
+ * set
+ */
 std::vector<double> GriddedData::getVariable1d(
     MetBuild::GriddedDataTypes::VARIABLES v) {
+  auto cached = m_variable_cache.find(static_cast<int>(v));
+  if (cached != m_variable_cache.end()) {
+    return {cached->second.begin(), cached->second.end()};
+  }
+
   std::vector<double> vec;
   double unit_conversion = 1.0;
   switch (v) {
@@ -117,6 +222,7 @@ std::vector<double> GriddedData::getVariable1d(
       return {};
   }
 
+  unit_conversion *= this->fieldScaling(v);
   if (unit_conversion != 1.0) {
     for (auto &vv : vec) {
       vv *= unit_conversion;
@@ -126,6 +232,65 @@ std::vector<double> GriddedData::getVariable1d(
   return vec;
 };
 
+/**
+ * @brief Returns a reference to the values of a variable in the output
+ * units, with the unit conversion and the field scaling applied
+ *
+ * The first request for a variable takes ownership of the source's raw
+ * buffer and converts it to the source precision, in place when that is
+ * double, so later requests for the same variable do not copy or rescale the
+ * data and the interpolation kernels only weight the values
+ *
+ * @param v variable to return
+ * @return reference to the cached values, valid for the life of the object
+ */
+const std::vector<SourceDataType> &GriddedData::variable1d(
+    MetBuild::GriddedDataTypes::VARIABLES v) {
+  auto it = m_variable_cache.find(static_cast<int>(v));
+  if (it != m_variable_cache.end()) {
+    return it->second;
+  }
+
+  auto vec = this->releaseSourceArray1d(
+      m_variableNames.find_variable(v),
+      m_variableUnits.find_variable(v) * this->fieldScaling(v));
+  return m_variable_cache.emplace(static_cast<int>(v), std::move(vec))
+      .first->second;
+}
+
+/**
+ * @brief Factor applied after the unit conversion to bring a variable to the
+ * values written to the output, such as grib pressure from Pa to mb. It
+ * only depends on the source, so it is applied once when the variable is
+ * decoded
+ * @param v variable
+ * @return scaling factor
+ */
+double GriddedData::fieldScaling(const GriddedDataTypes::VARIABLES v) const {
+  if (v == GriddedDataTypes::VAR_PRESSURE &&
+      this->sourceSubtype() == GriddedDataTypes::SOURCE_SUBTYPE::GRIB) {
+    return 1.0 / 100.0;
+  }
+  return 1.0;
+}
+
+std::vector<double> GriddedData::releaseArray1d(const std::string &variable) {
+  return this->getArray1d(variable);
+}
+
+/**
+ * @brief Releases the values of a variable in the source precision with the
+ * unit conversion applied. Sources which decode straight to the source
+ * precision override this to skip the double precision copy
+ * @param variable name of the variable in the source
+ * @param unit_conversion factor applied to every value
+ */
+std::vector<SourceDataType> GriddedData::releaseSourceArray1d(
+    const std::string &variable, const double unit_conversion) {
+  return to_source_data<SourceDataType>(this->releaseArray1d(variable),
+                                        unit_conversion, m_buffer_pool.get());
+}
+
 std::vector<std::vector<double>> GriddedData::getVariable2d(
     MetBuild::GriddedDataTypes::VARIABLES v) {
   switch (v) {
@@ -149,6 +314,25 @@ std::vector<std::vector<double>> GriddedData::getVariable2d(
   }
 };
 
+/**
+ * @brief Reads a group of variables together so that sources which can
+ * decode several variables in one pass over their files can do so
+ * @param variables variables to read into the source cache
+ */
+void GriddedData::preloadVariables(
+    const std::vector<MetBuild::GriddedDataTypes::VARIABLES> &variables) {
+  std::vector<std::string> names;
+  names.reserve(variables.size());
+  for (const auto &v : variables) {
+    names.push_back(m_variableNames.find_variable(v));
+  }
+  this->preloadArrays(names);
+}
+
+void GriddedData::preloadArrays(const std::vector<std::string> &) {
+  // Sources without a read cache decode on demand in getArray1d
+}
+
 void GriddedData::setCorners(std::array<MetBuild::Point, 4> corners) {
   m_corners = corners;
 }
@@ -159,6 +343,11 @@ void GriddedData::setGeometry(std::unique_ptr<MetBuild::Geometry> &geometry) {
   m_geometry = std::move(geometry);
 }
 
+void GriddedData::setGeometry(
+    std::shared_ptr<const MetBuild::Geometry> geometry) {
+  m_geometry = std::move(geometry);
+}
+
 // void GriddedData::setTriangulation(
 //     std::unique_ptr<MetBuild::Triangulation> &tri) {
 //   m_triangulation = std::move(tri);
@@ -184,18 +373,40 @@ MetBuild::GriddedDataTypes::SOURCE_SUBTYPE GriddedData::sourceSubtype() const {
   return m_sourceSubtype;
 }
 
-std::vector<MetBuild::Point> GriddedData::bounding_region() const {
-  return m_bounding_region;
+const std::vector<MetBuild::Point> &GriddedData::bounding_region() const {
+  static const std::vector<MetBuild::Point> empty;
+  return m_bounding_region ? *m_bounding_region : empty;
 }
 
+/**
+ * @brief Sets the outline of the source data. The outline also replaces the
+ * corner geometry used by point_inside, since traced outlines follow
+ * curvilinear grids more closely than their corners
+ * @param region outline vertices in order
+ */
 void GriddedData::set_bounding_region(const std::vector<Point> &region) {
-  m_bounding_region = region;
+  m_bounding_region = std::make_shared<const std::vector<Point>>(region);
+  if (region.size() >= 3) {
+    m_geometry = std::make_shared<const Geometry>(region);
+  }
+}
+
+/**
+ * @brief Uses an outline shared with other sources on the same grid
+ * @param region outline vertices in order
+ * @param geometry geometry of the outline, or null to keep the current one
+ */
+void GriddedData::set_bounding_region(
+    std::shared_ptr<const std::vector<Point>> region,
+    std::shared_ptr<const MetBuild::Geometry> geometry) {
+  m_bounding_region = std::move(region);
+  if (geometry) m_geometry = std::move(geometry);
 }
 
 void GriddedData::write_bounding_region(const std::string &filename) {
   auto f = std::ofstream(filename);
   size_t index = 0;
-  for (const auto &p : m_bounding_region) {
+  for (const auto &p : this->bounding_region()) {
     f << fmt::format("{:0.9f},{:0.9f},{:d}\n", p.x(), p.y(), index);
     index++;
   }
@@ -30,22 +30,28 @@
 #define METGET_SRC_GRIDDEDDATA_H_
 
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
+#include "BufferPool.h"
 #include "CoordinateConvention.h"
 #include "CppAttributes.h"
+#include "GridFingerprint.h"
 #include "GriddedDataTypes.h"
 #include "InterpolationWeight.h"
+#include "MeteorologicalData.h"
 #include "Point.h"
+#include "Triangulation.h"
 #include "VariableNames.h"
 #include "VariableUnits.h"
 
 namespace MetBuild {
 
 class Geometry;
-class Triangulation;
 
 class GriddedData {
  public:
@@ -70,6 +76,8 @@ class GriddedData {
 
   std::vector<std::string> filenames() const;
 
+  NODISCARD MetBuild::GridFingerprint fingerprint() const;
+
   bool point_inside(const Point &p) const;
 
   constexpr std::tuple<size_t, size_t> indexToPair(size_t index) const {
@@ -95,9 +103,18 @@ class GriddedData {
 
   std::vector<double> getVariable1d(MetBuild::GriddedDataTypes::VARIABLES v);
 
+  const std::vector<MetBuild::SourceDataType> &variable1d(
+      MetBuild::GriddedDataTypes::VARIABLES v);
+
+  NODISCARD virtual double fieldScaling(
+      MetBuild::GriddedDataTypes::VARIABLES v) const;
+
   std::vector<std::vector<double>> getVariable2d(
       MetBuild::GriddedDataTypes::VARIABLES v);
 
+  void preloadVariables(
+      const std::vector<MetBuild::GriddedDataTypes::VARIABLES> &variables);
+
   // MetBuild::InterpolationWeight interpolationWeight(double x, double y)
   // const;
 
@@ -105,10 +122,25 @@ class GriddedData {
 
   MetBuild::GriddedDataTypes::SOURCE_SUBTYPE sourceSubtype() const;
 
-  virtual Triangulation generate_triangulation() const = 0;
+  /**
+   * @brief Builds the point locator for the source grid
+   * @param extent box holding every point that will be located. Sources may
+   * use it to triangulate only the part of their grid around it
+   * @return locator object
+   */
+  virtual Triangulation generate_triangulation(
+      const Triangulation::Extent &extent) const = 0;
 
   COORDINATE_CONVENTION convention() const;
 
+  const std::vector<MetBuild::Point> &bounding_region() const;
+
+  void setDecodeExtent(const Triangulation::Extent &extent);
+
+  virtual void setOutputSpacing(double spacing);
+
+  void setBufferPool(std::shared_ptr<MetBuild::BufferPool> pool);
+
  protected:
   virtual void findCorners() = 0;
 
@@ -120,6 +152,8 @@ class GriddedData {
 
   void setGeometry(std::unique_ptr<MetBuild::Geometry> &geometry);
 
+  void setGeometry(std::shared_ptr<const MetBuild::Geometry> geometry);
+
   std::array<Point, 4> corners() const;
 
   void setNi(size_t ni);
@@ -128,15 +162,38 @@ class GriddedData {
 
   void setSize(size_t size);
 
+  void setFingerprint(MetBuild::GridFingerprint fingerprint);
+
+  const std::optional<Triangulation::Extent> &decodeExtent() const;
+
+  template <typename T = double>
+  std::vector<T> acquireBuffer() const {
+    return m_buffer_pool ? m_buffer_pool->acquire<T>() : std::vector<T>();
+  }
+
+  template <typename T>
+  void releaseBuffer(std::vector<T> &&buffer) const {
+    if (m_buffer_pool) m_buffer_pool->release(std::move(buffer));
+  }
+
   virtual std::vector<double> getArray1d(const std::string &variable) = 0;
 
   virtual std::vector<std::vector<double>> getArray2d(
       const std::string &variable) = 0;
 
-  std::vector<MetBuild::Point> bounding_region() const;
+  virtual void preloadArrays(const std::vector<std::string> &variables);
+
+  virtual std::vector<double> releaseArray1d(const std::string &variable);
+
+  virtual std::vector<MetBuild::SourceDataType> releaseSourceArray1d(
+      const std::string &variable, double unit_conversion);
 
   void set_bounding_region(const std::vector<Point> &region);
 
+  void set_bounding_region(
+      std::shared_ptr<const std::vector<Point>> region,
+      std::shared_ptr<const MetBuild::Geometry> geometry);
+
   void write_bounding_region(const std::string &filename);
 
  private:
@@ -146,12 +203,18 @@ class GriddedData {
   long m_nj;
   size_t m_size;
   COORDINATE_CONVENTION m_convention;
-  std::unique_ptr<MetBuild::Geometry> m_geometry;
+  std::shared_ptr<const MetBuild::Geometry> m_geometry;
   std::array<MetBuild::Point, 4> m_corners;
   MetBuild::VariableNames m_variableNames;
   MetBuild::VariableUnits m_variableUnits;
-  std::vector<MetBuild::Point> m_bounding_region;
+  std::shared_ptr<const std::vector<MetBuild::Point>> m_bounding_region;
+  std::optional<Triangulation::Extent> m_decode_extent;
   std::vector<std::string> m_filenames;
+  std::shared_ptr<MetBuild::BufferPool> m_buffer_pool;
+  mutable std::once_flag m_fingerprint_once;
+  mutable MetBuild::GridFingerprint m_fingerprint = 0;
+  std::unordered_map<int, std::vector<MetBuild::SourceDataType>>
+      m_variable_cache;
 };
 }  // namespace MetBuild
 
@@ -29,53 +29,34 @@
 #ifndef METGET_SRC_DATA_SOURCES_HRRRALASKADATA_H_
 #define METGET_SRC_DATA_SOURCES_HRRRALASKADATA_H_
 
-#include "Grib.h"
+#include <array>
+#include <string>
+
+#include "GribSource.h"
 
 namespace MetBuild {
 
-class HrrrAlaskaData : public Grib {
+/**
+ * @brief HRRR forecast over Alaska
+ */
+struct HrrrAlaskaTraits {
+  static constexpr SourceGrid grid = SourceGrid::REGIONAL;
+  static constexpr COORDINATE_CONVENTION convention = CONVENTION_360;
+  static constexpr VariableUnits units{1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0};
+  static constexpr std::array<MessageSelector, 7> messages = {{
+      {GriddedDataTypes::VAR_PRESSURE, "mslma", "MSLMA", "mean sea level"},
+      {GriddedDataTypes::VAR_U10, "10u", "UGRD", "10 m above ground"},
+      {GriddedDataTypes::VAR_V10, "10v", "VGRD", "10 m above ground"},
+      {GriddedDataTypes::VAR_RAINFALL, "prate", "PRATE", "surface"},
+      {GriddedDataTypes::VAR_HUMIDITY, "2r", "RH", "2 m above ground"},
+      {GriddedDataTypes::VAR_TEMPERATURE, "2t", "TMP", "2 m above ground"},
+      {GriddedDataTypes::VAR_ICE, "ci", "ICEC", "surface"}}};
+};
+
+class HrrrAlaskaData : public GribSource<HrrrAlaskaTraits> {
  public:
   explicit HrrrAlaskaData(const std::string &filename)
-      : Grib(filename,
-             {"longitudes", "latitudes", "mslma", "10u", "10v", "prate", "2r",
-              "2t", "ci"},
-             {1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0}, CONVENTION_360) {
-    this->get_bounding_region();
-  }
-
-  ~HrrrAlaskaData() override = default;
-
- private:
-  void get_bounding_region() {
-    const auto x = this->longitude1d();
-    const auto y = this->latitude1d();
-    std::vector<Point> region;
-
-    const auto longitude = this->longitude1d();
-    const auto latitude = this->latitude1d();
-
-    // Bottom Left --> Bottom Right
-    for (size_t i = 0; i < ni(); ++i) {
-      region.emplace_back(longitude[i], latitude[i]);
-    }
-
-    // Bottom Right --> Top Right
-    for (size_t i = 1; i < nj(); ++i) {
-      region.emplace_back(longitude[i * ni() - 1], latitude[i * ni() - 1]);
-    }
-
-    // Top Right --> Top Left
-    for (size_t i = 0; i < ni(); ++i) {
-      region.emplace_back(longitude[nj() * ni() - 1 - i],
-                          latitude[nj() * ni() - 1 - i]);
-    }
-
-    // Top Left --> Bottom Left (note: skips last point)
-    for (long i = nj() - 1; i > 0; --i) {
-      region.emplace_back(longitude[i * ni()], latitude[i * ni()]);
-    }
-
-    this->set_bounding_region(region);
+      : GribSource(filename) {
     this->write_bounding_region("hrrr_alaska.txt");
   }
 };
@@ -29,51 +29,32 @@
 #ifndef METGET_SRC_HWRFDATA_H_
 #define METGET_SRC_HWRFDATA_H_
 
-#include "Grib.h"
+#include <array>
+#include <string>
 
-namespace MetBuild {
-
-class HwrfData : public Grib {
- public:
-  explicit HwrfData(const std::string &filename)
-      : Grib(filename,
-             {"longitudes", "latitudes", "prmsl", "10u", "10v", "tp", "2r",
-              "2t", ""},
-             {1.0, 1.0, 1.0, 3600.0, 1.0, 1.0, 1.0}) {
-    this->get_bounding_region();
-    this->generate_triangulation();
-  }
-
- private:
-  void get_bounding_region() {
-    std::vector<Point> region;
-
-    const auto longitude = this->longitude1d();
-    const auto latitude = this->latitude1d();
+#include "GribSource.h"
 
-    // Bottom Left --> Bottom Right
-    for (size_t i = 0; i < ni(); ++i) {
-      region.emplace_back(longitude[i], latitude[i]);
-    }
-
-    // Bottom Right --> Top Right
-    for (size_t i = 1; i < nj(); ++i) {
-      region.emplace_back(longitude[i * ni() - 1], latitude[i * ni() - 1]);
-    }
-
-    // Top Right --> Top Left
-    for (size_t i = 0; i < ni(); ++i) {
-      region.emplace_back(longitude[nj() * ni() - 1 - i],
-                          latitude[nj() * ni() - 1 - i]);
-    }
+namespace MetBuild {
 
-    // Top Left --> Bottom Left (note: skips last point)
-    for (long i = nj() - 1; i > 0; --i) {
-      region.emplace_back(longitude[i * ni()], latitude[i * ni()]);
-    }
+/**
+ * @brief HWRF moving nest forecast
+ */
+struct HwrfTraits {
+  static constexpr SourceGrid grid = SourceGrid::REGIONAL;
+  static constexpr COORDINATE_CONVENTION convention = CONVENTION_180;
+  static constexpr VariableUnits units{1.0, 1.0, 1.0, 3600.0, 1.0, 1.0, 1.0};
+  static constexpr std::array<MessageSelector, 6> messages = {{
+      {GriddedDataTypes::VAR_PRESSURE, "prmsl", "PRMSL", "mean sea level"},
+      {GriddedDataTypes::VAR_U10, "10u", "UGRD", "10 m above ground"},
+      {GriddedDataTypes::VAR_V10, "10v", "VGRD", "10 m above ground"},
+      {GriddedDataTypes::VAR_RAINFALL, "tp", "APCP", "surface", "accum"},
+      {GriddedDataTypes::VAR_HUMIDITY, "2r", "RH", "2 m above ground"},
+      {GriddedDataTypes::VAR_TEMPERATURE, "2t", "TMP", "2 m above ground"}}};
+};
 
-    this->set_bounding_region(region);
-  }
+class HwrfData : public GribSource<HwrfTraits> {
+ public:
+  using GribSource::GribSource;
 };
 }  // namespace MetBuild
 #endif  // METGET_SRC_HWRFDATA_H_
@@ -29,55 +29,33 @@
 #ifndef METGET_SRC_OUTPUT_NAMDATA_H_
 #define METGET_SRC_OUTPUT_NAMDATA_H_
 
-#include "Grib.h"
+#include <array>
+#include <string>
 
-namespace MetBuild {
-
-class NamData : public Grib {
- public:
-  explicit NamData(const std::string &filename)
-      : Grib(filename,
-             {"longitudes", "latitudes", "prmsl", "10u", "10v", "tp", "r", "t",
-              "ci"},
-             {1.0, 1.0, 1.0, 3600.0, 1.0, 1.0, 1.0}) {
-    this->get_bounding_region();
-  };
-
- private:
-  /**
-   * Walk the outside of the GRIB data to create a bounding region
-   * @return bounding region of points in anticlockwise orientation
-   */
-  void get_bounding_region() {
-    std::vector<Point> region;
-
-    const auto longitude = this->longitude1d();
-    const auto latitude = this->latitude1d();
-
-    // Bottom Left --> Bottom Right
-    for (size_t i = 0; i < ni(); ++i) {
-      region.emplace_back(longitude[i], latitude[i]);
-    }
+#include "GribSource.h"
 
-    // Bottom Right --> Top Right
-    for (size_t i = 1; i < nj(); ++i) {
-      region.emplace_back(longitude[i * ni() - 1], latitude[i * ni() - 1]);
-    }
-
-    // Top Right --> Top Left
-    for (size_t i = 0; i < ni(); ++i) {
-      region.emplace_back(longitude[nj() * ni() - 1 - i],
-                          latitude[nj() * ni() - 1 - i]);
-    }
+namespace MetBuild {
 
-    // Top Left --> Bottom Left (note: skips last point)
-    for (long i = nj() - 1; i > 0; --i) {
-      region.emplace_back(longitude[i * ni()], latitude[i * ni()]);
-    }
+/**
+ * @brief NAM regional forecast
+ */
+struct NamTraits {
+  static constexpr SourceGrid grid = SourceGrid::REGIONAL;
+  static constexpr COORDINATE_CONVENTION convention = CONVENTION_180;
+  static constexpr VariableUnits units{1.0, 1.0, 1.0, 3600.0, 1.0, 1.0, 1.0};
+  static constexpr std::array<MessageSelector, 7> messages = {{
+      {GriddedDataTypes::VAR_PRESSURE, "prmsl", "PRMSL", "mean sea level"},
+      {GriddedDataTypes::VAR_U10, "10u", "UGRD", "10 m above ground"},
+      {GriddedDataTypes::VAR_V10, "10v", "VGRD", "10 m above ground"},
+      {GriddedDataTypes::VAR_RAINFALL, "tp", "APCP", "surface", "accum"},
+      {GriddedDataTypes::VAR_HUMIDITY, "r", "RH", "30-0 mb above ground"},
+      {GriddedDataTypes::VAR_TEMPERATURE, "t", "TMP", "30-0 mb above ground"},
+      {GriddedDataTypes::VAR_ICE, "ci", "ICEC", "surface"}}};
+};
 
-    this->set_bounding_region(region);
-  }
+class NamData : public GribSource<NamTraits> {
+ public:
+  using GribSource::GribSource;
 };
 }  // namespace MetBuild
-
 #endif  // METGET_SRC_OUTPUT_NAMDATA_H_
@@ -28,18 +28,170 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "NetcdfFile.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+#include "Instrumentation.h"
 #include "Logging.h"
+#include "Utilities.h"
 #include "netcdf.h"
+#if __has_include("netcdf_meta.h")
+#include "netcdf_meta.h"
+#endif
 
 using namespace MetBuild;
 
-NetcdfFile::NetcdfFile(const std::string& filename) : m_ncid(-1) {
-  int ierr = nc_open(filename.c_str(), NC_NOWRITE, &m_ncid);
+namespace {
+
+//...Handles kept open once released, enough for both slots of a COAMPS
+// request with its nested domains and the file prefetched after them
+constexpr size_t c_default_pool_size = 16;
+
+/**
+ * @brief Identifies the version of a file on disk so a replaced file is not
+ * read through a stale handle
+ */
+struct FileStamp {
+  std::filesystem::file_time_type time;
+  std::uintmax_t size = 0;
+
+  static FileStamp of(const std::string &filename) {
+    std::error_code ec;
+    FileStamp stamp;
+    //...Remote objects are replaced under a new key, never in place
+    if (Utilities::is_url(filename)) return stamp;
+    stamp.time = std::filesystem::last_write_time(filename, ec);
+    stamp.size = std::filesystem::file_size(filename, ec);
+    return stamp;
+  }
+
+  bool operator==(const FileStamp &other) const {
+    return time == other.time && size == other.size;
+  }
+};
+
+class HandlePool {
+ public:
+  static HandlePool &instance() {
+    static HandlePool pool;
+    return pool;
+  }
+
+  std::shared_ptr<NetcdfFile> open(const std::string &filename) {
+    const auto stamp = FileStamp::of(filename);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_open.find(filename);
+    if (it != m_open.end() && it->second.stamp == stamp) {
+      if (auto handle = it->second.handle.lock()) {
+        this->touch(filename, handle);
+        return handle;
+      }
+    }
+    auto handle = std::make_shared<NetcdfFile>(filename);
+    m_open[filename] = {handle, stamp};
+    this->touch(filename, handle);
+    return handle;
+  }
+
+  void resize(const size_t capacity) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_capacity = capacity;
+    this->trim();
+  }
+
+  size_t capacity() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_capacity;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_recent.clear();
+    m_open.clear();
+  }
+
+ private:
+  struct Entry {
+    std::weak_ptr<NetcdfFile> handle;
+    FileStamp stamp;
+  };
+
+  //...Moves a handle to the front of the recently used list
+  void touch(const std::string &filename,
+             const std::shared_ptr<NetcdfFile> &handle) {
+    auto it = std::find_if(m_recent.begin(), m_recent.end(),
+                           [&](const auto &r) { return r.first == filename; });
+    if (it != m_recent.end()) m_recent.erase(it);
+    m_recent.emplace_front(filename, handle);
+    this->trim();
+  }
+
+  void trim() {
+    while (m_recent.size() > m_capacity) m_recent.pop_back();
+    for (auto it = m_open.begin(); it != m_open.end();) {
+      it = it->second.handle.expired() ? m_open.erase(it) : std::next(it);
+    }
+  }
+
+  std::mutex m_mutex;
+  size_t m_capacity = c_default_pool_size;
+  std::list<std::pair<std::string, std::shared_ptr<NetcdfFile>>> m_recent;
+  std::unordered_map<std::string, Entry> m_open;
+};
+
+/**
+ * @brief Per variable chunk cache applied to pooled handles. Reads take
+ * whole variables, so the cache is sized to the variable up to max_bytes and
+ * chunks are evicted freely once read
+ */
+struct ChunkCache {
+  size_t max_bytes = 64 * 1024 * 1024;
+  size_t slots = 1009;
+  float preemption = 1.0f;
+};
+
+ChunkCache s_chunk_cache;
+std::mutex s_chunk_cache_mutex;
+
+/**
+ * @brief Path given to nc_open, selecting the byte range mode for urls which
+ * do not already name a mode
+ */
+std::string open_path(const std::string &filename) {
+  if (!Utilities::is_url(filename) ||
+      filename.find('#') != std::string::npos) {
+    return filename;
+  }
+  return filename + "#mode=bytes";
+}
+
+//...Query strings of presigned urls hold credentials, which are kept out of
+// the log
+std::string printable(const std::string &filename) {
+  return Utilities::is_url(filename) ? filename.substr(0, filename.find('?'))
+                                     : filename;
+}
+
+}  // namespace
+
+NetcdfFile::NetcdfFile(const std::string& filename)
+    : m_filename(filename), m_ncid(-1) {
+  Instrumentation::ScopedTimer timer(Instrumentation::FILE_OPEN, 1);
+  if (Utilities::is_url(filename) && !NetcdfFile::supports_byte_range()) {
+    Logging::throwError(
+        "The netCDF library cannot read remote files by byte range: " +
+        printable(filename));
+  }
+  int ierr = nc_open(open_path(filename).c_str(), NC_NOWRITE, &m_ncid);
   if (ierr != NC_NOERR) {
     if (m_ncid != -1) {
       nc_close(m_ncid);
     }
-    Logging::throwError("Error opening netCDF file: "+filename);
+    Logging::throwError("Error opening netCDF file: " + printable(filename));
   }
 }
 
@@ -52,6 +204,55 @@ NetcdfFile::~NetcdfFile() {
   }
 }
 
+/**
+ * @brief Returns a shared handle to a file, opening it only when no current
+ * handle is held by the pool
+ * @param filename file to open
+ * @return handle
+ */
+std::shared_ptr<NetcdfFile> NetcdfFile::open(const std::string& filename) {
+  return HandlePool::instance().open(filename);
+}
+
+/**
+ * @brief Sets how many released handles the pool keeps open
+ * @param handles number of handles, 0 to close each file with its last reader
+ */
+void NetcdfFile::set_pool_size(const size_t handles) {
+  HandlePool::instance().resize(handles);
+}
+
+size_t NetcdfFile::pool_size() { return HandlePool::instance().capacity(); }
+
+/**
+ * @brief Closes every released handle held by the pool
+ */
+void NetcdfFile::clear_pool() { HandlePool::instance().clear(); }
+
+/**
+ * @brief Whether the netCDF library was built with byte range reads, which
+ * are needed to open http urls in place of files
+ */
+bool NetcdfFile::supports_byte_range() {
+#if defined(NC_HAS_BYTERANGE) && NC_HAS_BYTERANGE
+  return true;
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Sets the chunk cache applied by setChunkCache
+ * @param max_bytes largest cache given to a variable
+ * @param slots number of hash slots of each cache
+ * @param preemption preference for evicting chunks already read, 0 to 1
+ */
+void NetcdfFile::set_chunk_cache(const size_t max_bytes, const size_t slots,
+                                 const float preemption) {
+  std::lock_guard<std::mutex> lock(s_chunk_cache_mutex);
+  s_chunk_cache = {max_bytes, slots, std::clamp(preemption, 0.0f, 1.0f)};
+}
+
 int NetcdfFile::ncid() const { return m_ncid; }
 
 int NetcdfFile::getDimid(const std::string& name) const {
@@ -80,3 +281,35 @@ int NetcdfFile::getVarid(const std::string& name) const {
   }
   return varid;
 }
+
+/**
+ * @brief Sizes the chunk cache of a variable to a read of the given size,
+ * once per variable. Files without chunked storage have no cache and are
+ * left as they are. Called with mutex() held
+ * @param varid variable
+ * @param bytes bytes read from the variable at once
+ */
+void NetcdfFile::setChunkCache(const int varid, const size_t bytes) const {
+  if (std::find(m_cached_vars.begin(), m_cached_vars.end(), varid) !=
+      m_cached_vars.end()) {
+    return;
+  }
+  m_cached_vars.push_back(varid);
+
+  ChunkCache cache;
+  {
+    std::lock_guard<std::mutex> lock(s_chunk_cache_mutex);
+    cache = s_chunk_cache;
+  }
+  const int ierr =
+      nc_set_var_chunk_cache(m_ncid, varid, std::min(bytes, cache.max_bytes),
+                             cache.slots, cache.preemption);
+  if (ierr != NC_NOERR && ierr != NC_ENOTNC4) {
+    Logging::warning("Could not set the chunk cache of " + m_filename);
+  }
+}
+
+/**
+ * @brief Lock serializing reads through a handle shared by several readers
+ */
+std::mutex& NetcdfFile::mutex() const { return m_mutex; }
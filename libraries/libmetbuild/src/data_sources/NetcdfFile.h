@@ -29,16 +29,49 @@
 #ifndef METGET_SRC_NETCDFFILE_H_
 #define METGET_SRC_NETCDFFILE_H_
 
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "CppAttributes.h"
 
+/**
+ * @brief Read only handle to a netCDF file
+ *
+ * Handles taken from open() are shared through a process wide pool keyed by
+ * path. A file in use by several readers, or read again shortly after, is
+ * opened once; the most recently used handles stay open after their last
+ * reader releases them, up to the pool size. A pooled handle is reopened if
+ * the file on disk has been replaced
+ *
+ * Files given as http or https urls, such as presigned S3 urls, are opened in
+ * the byte range mode of netCDF when the library supports it. Only the
+ * metadata and the chunks of the variables read are fetched, so a source is
+ * read without downloading the whole file first
+ */
 class NetcdfFile {
  public:
   explicit NetcdfFile(const std::string &filename);
 
   ~NetcdfFile();
 
+  NetcdfFile(const NetcdfFile &) = delete;
+  NetcdfFile &operator=(const NetcdfFile &) = delete;
+
+  static std::shared_ptr<NetcdfFile> open(const std::string &filename);
+
+  static void set_pool_size(size_t handles);
+
+  NODISCARD static size_t pool_size();
+
+  static void clear_pool();
+
+  NODISCARD static bool supports_byte_range();
+
+  static void set_chunk_cache(size_t max_bytes, size_t slots,
+                              float preemption);
+
   NODISCARD int ncid() const;
 
   NODISCARD int getDimid(const std::string &name) const;
@@ -47,9 +80,15 @@ class NetcdfFile {
 
   NODISCARD int getVarid(const std::string &name) const;
 
+  void setChunkCache(int varid, size_t bytes) const;
+
+  NODISCARD std::mutex &mutex() const;
+
  private:
   std::string m_filename;
   int m_ncid;
+  mutable std::mutex m_mutex;
+  mutable std::vector<int> m_cached_vars;
 };
 
 #endif  // METGET_SRC_NETCDFFILE_H_
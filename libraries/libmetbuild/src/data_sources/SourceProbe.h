@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METGET_SRC_DATA_SOURCES_SOURCEPROBE_H_
+#define METGET_SRC_DATA_SOURCES_SOURCEPROBE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "GriddedDataTypes.h"
+#include "VariableNames.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Description of a source file read from its headers only, without
+ * decoding any values or reading the coordinates of every point
+ *
+ * Grib files are described from the index of their messages and the grid
+ * section of one message. COAMPS files are described from the dimensions of
+ * the domain and the coordinates at its corners. The first and last points
+ * are in degrees as stored in the file, and the spacing is in degrees for
+ * latitude/longitude grids and in metres for projected grids. The grid type
+ * is the grib gridType key and is left empty for netCDF sources. The steps
+ * are the forecast steps in minutes found in a grib file, several for files
+ * such as the HRRR sub-hourly ones which are read one step at a time
+ */
+struct SourceProbe {
+  size_t ni = 0;
+  size_t nj = 0;
+  size_t size = 0;
+  std::string gridType;
+  double firstLongitude = 0.0;
+  double firstLatitude = 0.0;
+  double lastLongitude = 0.0;
+  double lastLatitude = 0.0;
+  double dx = 0.0;
+  double dy = 0.0;
+  int precipitationStepLength = 1;
+  std::vector<long> steps;
+  std::vector<std::string> fields;
+  std::vector<MetBuild::GriddedDataTypes::VARIABLES> variables;
+
+  bool contains(const MetBuild::GriddedDataTypes::VARIABLES variable) const {
+    return std::find(variables.begin(), variables.end(), variable) !=
+           variables.end();
+  }
+
+  /**
+   * @brief Records the source variables which are present in the file
+   * @param names names of the source variables
+   * @param present test for a name in the file
+   */
+  void addVariables(const MetBuild::VariableNames &names,
+                    const std::function<bool(const std::string &)> &present) {
+    using namespace MetBuild::GriddedDataTypes;
+    constexpr std::array<VARIABLES, 7> all = {
+        VAR_PRESSURE, VAR_U10,      VAR_V10, VAR_TEMPERATURE,
+        VAR_HUMIDITY, VAR_RAINFALL, VAR_ICE};
+    for (const auto v : all) {
+      const auto name = names.find_variable(v);
+      if (!name.empty() && present(name)) variables.push_back(v);
+    }
+  }
+};
+
+}  // namespace MetBuild
+
+#endif  // METGET_SRC_DATA_SOURCES_SOURCEPROBE_H_
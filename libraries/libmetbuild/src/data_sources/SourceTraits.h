@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_DATA_SOURCES_SOURCETRAITS_H_
+#define METBUILD_SRC_DATA_SOURCES_SOURCETRAITS_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "CoordinateConvention.h"
+#include "GribMessage.h"
+#include "GriddedDataTypes.h"
+#include "VariableNames.h"
+#include "VariableUnits.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Layout of a source grid, which decides how its outline is traced
+ */
+enum class SourceGrid {
+  //...Global latitude and longitude rows, closed around the poles and the
+  // dateline
+  GLOBAL_LATLON,
+  //...Regional grid of any projection, outlined by walking its edges
+  REGIONAL
+};
+
+/**
+ * @brief Compile time selector of one grib message, the constant form of
+ * GribMessage
+ */
+struct MessageSelector {
+  MetBuild::GriddedDataTypes::VARIABLES variable;
+  const char *shortName;
+  const char *parameter;
+  const char *level;
+  const char *stepType = "instant";
+};
+
+/**
+ * @brief Compile time description of a grib source
+ *
+ * A traits type provides the layout of the source grid, its longitude
+ * convention, the unit factors of its variables and the selectors of the
+ * messages it is decoded from:
+ *
+ *   static constexpr SourceGrid grid;
+ *   static constexpr COORDINATE_CONVENTION convention;
+ *   static constexpr VariableUnits units;
+ *   static constexpr std::array<MessageSelector, N> messages;
+ *
+ * The variable names, the message list and the class of a source are all
+ * generated from these, so each source is described once and checked when
+ * it is compiled
+ */
+namespace SourceTraits {
+
+constexpr bool same_name(const char *a, const char *b) {
+  while (*a != '\0' && *a == *b) {
+    ++a;
+    ++b;
+  }
+  return *a == *b;
+}
+
+/**
+ * @brief Short name of the message of a variable, empty when the source
+ * does not provide it
+ */
+template <typename Traits>
+constexpr const char *short_name(
+    const MetBuild::GriddedDataTypes::VARIABLES variable) {
+  for (const auto &m : Traits::messages) {
+    if (m.variable == variable) return m.shortName;
+  }
+  return "";
+}
+
+/**
+ * @brief True when no variable is selected by more than one message and
+ * every message has a short name
+ */
+template <typename Traits>
+constexpr bool valid_messages() {
+  const auto &m = Traits::messages;
+  for (size_t a = 0; a < m.size(); ++a) {
+    if (same_name(m[a].shortName, "")) return false;
+    for (size_t b = a + 1; b < m.size(); ++b) {
+      if (m[a].variable == m[b].variable) return false;
+    }
+  }
+  return true;
+}
+
+template <typename Traits>
+MetBuild::VariableNames variable_names() {
+  using namespace MetBuild::GriddedDataTypes;
+  return {"longitudes",
+          "latitudes",
+          short_name<Traits>(VAR_PRESSURE),
+          short_name<Traits>(VAR_U10),
+          short_name<Traits>(VAR_V10),
+          short_name<Traits>(VAR_RAINFALL),
+          short_name<Traits>(VAR_HUMIDITY),
+          short_name<Traits>(VAR_TEMPERATURE),
+          short_name<Traits>(VAR_ICE)};
+}
+
+template <typename Traits>
+std::vector<MetBuild::GribMessage> grib_messages() {
+  std::vector<MetBuild::GribMessage> messages;
+  for (const auto &m : Traits::messages) {
+    messages.push_back(
+        {m.variable, m.shortName, m.parameter, m.level, m.stepType});
+  }
+  return messages;
+}
+
+}  // namespace SourceTraits
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_DATA_SOURCES_SOURCETRAITS_H_
@@ -29,54 +29,27 @@
 #ifndef METGET_SRC_DATA_SOURCES_WPCDATA_H_
 #define METGET_SRC_DATA_SOURCES_WPCDATA_H_
 
-#include "Grib.h"
+#include <array>
+#include <string>
 
-namespace MetBuild {
-
-class WpcData : public Grib {
- public:
-  explicit WpcData(const std::string &filename)
-      : Grib(filename,
-             {"longitudes", "latitudes", "", "", "", "tp", "", "",
-              ""},
-             {1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0}) {
-    this->get_bounding_region();
-  }
-
-  ~WpcData() override = default;
-
- private:
-  void get_bounding_region() {
-    const auto x = this->longitude1d();
-    const auto y = this->latitude1d();
-    std::vector<Point> region;
-
-    const auto longitude = this->longitude1d();
-    const auto latitude = this->latitude1d();
+#include "GribSource.h"
 
-    // Bottom Left --> Bottom Right
-    for (size_t i = 0; i < ni(); ++i) {
-      region.emplace_back(longitude[i], latitude[i]);
-    }
-
-    // Bottom Right --> Top Right
-    for (size_t i = 1; i < nj(); ++i) {
-      region.emplace_back(longitude[i * ni() - 1], latitude[i * ni() - 1]);
-    }
-
-    // Top Right --> Top Left
-    for (size_t i = 0; i < ni(); ++i) {
-      region.emplace_back(longitude[nj() * ni() - 1 - i],
-                          latitude[nj() * ni() - 1 - i]);
-    }
+namespace MetBuild {
 
-    // Top Left --> Bottom Left (note: skips last point)
-    for (long i = nj() - 1; i > 0; --i) {
-      region.emplace_back(longitude[i * ni()], latitude[i * ni()]);
-    }
+/**
+ * @brief WPC quantitative precipitation forecast
+ */
+struct WpcTraits {
+  static constexpr SourceGrid grid = SourceGrid::REGIONAL;
+  static constexpr COORDINATE_CONVENTION convention = CONVENTION_180;
+  static constexpr VariableUnits units{1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0};
+  static constexpr std::array<MessageSelector, 1> messages = {{
+      {GriddedDataTypes::VAR_RAINFALL, "tp", "APCP", "surface", "accum"}}};
+};
 
-    this->set_bounding_region(region);
-  }
+class WpcData : public GribSource<WpcTraits> {
+ public:
+  using GribSource::GribSource;
 };
 }  // namespace MetBuild
 #endif  // METGET_SRC_DATA_SOURCES_WPCDATA_H_
@@ -0,0 +1,207 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "AsyncWriter.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "Instrumentation.h"
+#include "Logging.h"
+#include "OutputDomain.h"
+
+using namespace MetBuild;
+
+/**
+ * @brief Constructor
+ * @param domain domain written by the thread. It must outlive the writer
+ * @param queue_depth number of records held before write blocks
+ * @param domain_mutex optional mutex held while writing, shared by writers
+ * whose domains must not be written concurrently
+ * @param written optional function called with the date of each record once
+ * it has been written, while the domain mutex is still held
+ */
+AsyncWriter::AsyncWriter(OutputDomain *domain, size_t queue_depth,
+                         std::mutex *domain_mutex, Callback written)
+    : m_domain(domain),
+      m_domain_mutex(domain_mutex),
+      m_written(std::move(written)),
+      m_queue_depth(std::max<size_t>(queue_depth, 1)),
+      m_primed(false),
+      m_busy(false),
+      m_stop(false) {
+  m_queue.reserve(m_queue_depth);
+  m_free.reserve(m_queue_depth + 2);
+  m_thread = std::thread(&AsyncWriter::run, this);
+}
+
+AsyncWriter::~AsyncWriter() {
+  //...Records already queued are still written, but errors can no longer be
+  // reported to the caller
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_condition.notify_all();
+  if (m_thread.joinable()) m_thread.join();
+  if (m_error) {
+    try {
+      std::rethrow_exception(m_error);
+    } catch (const std::exception &e) {
+      Logging::logError(e.what());
+    }
+  }
+}
+
+void AsyncWriter::write(
+    const MetBuild::Date &date,
+    const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+        &data) {
+  auto record = this->take_record();
+  record.date = date;
+  record.wind = false;
+  record.scalar = data;
+  this->push(std::move(record));
+}
+
+void AsyncWriter::write(
+    const MetBuild::Date &date,
+    const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+        &data) {
+  auto record = this->take_record();
+  record.date = date;
+  record.wind = true;
+  record.vector = data;
+  this->push(std::move(record));
+}
+
+/**
+ * @brief Waits until every queued record has been written
+ *
+ * Rethrows the first error raised by the writer thread
+ */
+void AsyncWriter::flush() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_condition.wait(lock, [this]() {
+    return (m_queue.empty() && !m_busy) || m_error;
+  });
+  if (m_error) {
+    auto error = m_error;
+    m_error = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+/**
+ * @brief Drops the queued records and waits for the one being written, so
+ * that the domain ends on a whole record. Used when a build is cancelled.
+ * Errors of the writer thread are kept for the next call to write or flush
+ */
+void AsyncWriter::discard() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_queue.empty()) {
+    m_free.push_back(std::move(m_queue.front()));
+    m_queue.erase(m_queue.begin());
+  }
+  m_condition.notify_all();
+  m_condition.wait(lock, [this]() { return !m_busy; });
+}
+
+AsyncWriter::Record AsyncWriter::take_record() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_free.empty()) return Record();
+  auto record = std::move(m_free.back());
+  m_free.pop_back();
+  return record;
+}
+
+void AsyncWriter::push(Record record) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_queue.size() >= m_queue_depth && !m_error) {
+    Instrumentation::ScopedTimer timer(Instrumentation::OUTPUT_WAIT);
+    m_condition.wait(lock, [this]() {
+      return m_queue.size() < m_queue_depth || m_error;
+    });
+  }
+  if (m_error) {
+    auto error = m_error;
+    m_error = nullptr;
+    std::rethrow_exception(error);
+  }
+  //...The first record sizes every record that can be in flight: those
+  // queued, the one being written and the one the caller is filling. Later
+  // writes then never allocate, however far the writer thread lags
+  if (!m_primed) {
+    m_primed = true;
+    for (size_t i = 0; i <= m_queue_depth; ++i) m_free.push_back(record);
+  }
+  m_queue.push_back(std::move(record));
+  lock.unlock();
+  m_condition.notify_all();
+}
+
+void AsyncWriter::run() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_condition.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+    if (m_queue.empty()) return;
+
+    auto record = std::move(m_queue.front());
+    m_queue.erase(m_queue.begin());
+    m_busy = true;
+    lock.unlock();
+    m_condition.notify_all();
+
+    std::exception_ptr error;
+    try {
+      std::unique_lock<std::mutex> domain_lock;
+      if (m_domain_mutex) {
+        domain_lock = std::unique_lock<std::mutex>(*m_domain_mutex);
+      }
+      if (record.wind) {
+        m_domain->write(record.date, record.vector);
+      } else {
+        m_domain->write(record.date, record.scalar);
+      }
+      if (m_written) m_written(record.date);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    lock.lock();
+    m_busy = false;
+    if (error) {
+      //...Records after a failure are dropped, the domain is in an unknown
+      // state
+      m_error = error;
+      m_queue.clear();
+    }
+    m_free.push_back(std::move(record));
+    m_condition.notify_all();
+  }
+}
@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_ASYNCWRITER_H_
+#define METBUILD_SRC_OUTPUT_ASYNCWRITER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Date.h"
+#include "MeteorologicalData.h"
+
+namespace MetBuild {
+
+class OutputDomain;
+
+/**
+ * @brief Writes records to an output domain from a dedicated thread
+ *
+ * Fields passed to write are copied into recycled buffers and queued, so the
+ * caller can go on interpolating while the domain formats, compresses and
+ * writes. The queue is bounded and write blocks when it is full. Errors from
+ * the writer thread are rethrown by the next call to write or flush
+ *
+ * An optional callback runs on the writer thread after each record, e.g. to
+ * checkpoint the domain while it is known to be between records
+ */
+class AsyncWriter {
+ public:
+  using Callback = std::function<void(const MetBuild::Date &)>;
+
+  AsyncWriter(MetBuild::OutputDomain *domain, size_t queue_depth,
+              std::mutex *domain_mutex = nullptr, Callback written = nullptr);
+
+  ~AsyncWriter();
+
+  AsyncWriter(const AsyncWriter &) = delete;
+  AsyncWriter &operator=(const AsyncWriter &) = delete;
+
+  void write(
+      const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+          &data);
+
+  void write(
+      const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+          &data);
+
+  void flush();
+
+  void discard();
+
+ private:
+  struct Record {
+    MetBuild::Date date;
+    bool wind = false;
+    MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType> scalar;
+    MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType> vector;
+  };
+
+  Record take_record();
+
+  void push(Record record);
+
+  void run();
+
+  MetBuild::OutputDomain *m_domain;
+  std::mutex *m_domain_mutex;
+  Callback m_written;
+  size_t m_queue_depth;
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  //...A vector rather than a deque, so that the few records queued never
+  // allocate once the writer is warm
+  std::vector<Record> m_queue;
+  std::vector<Record> m_free;
+  std::exception_ptr m_error;
+  bool m_primed;
+  bool m_busy;
+  bool m_stop;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_ASYNCWRITER_H_
@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "Checkpoint.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "Logging.h"
+#include "boost/filesystem.hpp"
+
+using namespace MetBuild;
+
+namespace {
+constexpr char c_magic[] = "METBUILD_CHECKPOINT";
+constexpr int c_version = 1;
+}  // namespace
+
+/**
+ * @brief Records the progress of a domain
+ * @param domain_index domain of the output file
+ * @param point last record written and the length of each file after it
+ */
+void Checkpoint::set(const size_t domain_index, const ResumePoint &point) {
+  if (domain_index >= m_domains.size()) {
+    m_domains.resize(domain_index + 1);
+    m_valid.resize(domain_index + 1, false);
+  }
+  m_domains[domain_index] = point;
+  m_valid[domain_index] = true;
+}
+
+bool Checkpoint::has(const size_t domain_index) const {
+  return domain_index < m_valid.size() && m_valid[domain_index];
+}
+
+const ResumePoint &Checkpoint::domain(const size_t domain_index) const {
+  if (!this->has(domain_index)) {
+    metbuild_throw_exception("No checkpoint for domain " +
+                             std::to_string(domain_index));
+  }
+  return m_domains[domain_index];
+}
+
+/**
+ * @brief Writes the checkpoint to a temporary file and renames it over the
+ * previous one
+ * @param filename checkpoint file
+ */
+void Checkpoint::write(const std::string &filename) const {
+  const auto tmp = filename + "." + boost::filesystem::unique_path().string();
+  {
+    std::ofstream f(tmp);
+    if (!f.is_open()) {
+      metbuild_throw_exception("Could not write checkpoint file " + filename);
+    }
+    f << c_magic << " " << c_version << "\n";
+    for (size_t i = 0; i < m_domains.size(); ++i) {
+      if (!m_valid[i]) continue;
+      f << "domain " << i << " " << m_domains[i].time.toSeconds() << " "
+        << m_domains[i].offsets.size();
+      for (const auto offset : m_domains[i].offsets) f << " " << offset;
+      f << "\n";
+    }
+    f.flush();
+    if (!f.good()) {
+      metbuild_throw_exception("Could not write checkpoint file " + filename);
+    }
+  }
+  boost::system::error_code ec;
+  boost::filesystem::rename(tmp, filename, ec);
+  if (ec) {
+    boost::filesystem::remove(tmp, ec);
+    metbuild_throw_exception("Could not replace checkpoint file " + filename);
+  }
+}
+
+/**
+ * @brief Reads a checkpoint written by write
+ * @param filename checkpoint file
+ * @return checkpoint, empty when the file does not exist
+ */
+Checkpoint Checkpoint::read(const std::string &filename) {
+  Checkpoint checkpoint;
+  std::ifstream f(filename);
+  if (!f.is_open()) return checkpoint;
+
+  std::string magic;
+  int version = 0;
+  f >> magic >> version;
+  if (magic != c_magic || version != c_version) {
+    metbuild_throw_exception("Invalid checkpoint file " + filename);
+  }
+
+  std::string line;
+  std::getline(f, line);
+  while (std::getline(f, line)) {
+    if (line.empty()) continue;
+    std::istringstream s(line);
+    std::string tag;
+    size_t index = 0;
+    long long seconds = 0;
+    size_t n = 0;
+    s >> tag >> index >> seconds >> n;
+    ResumePoint point{MetBuild::Date(seconds), std::vector<uint64_t>(n)};
+    for (auto &offset : point.offsets) s >> offset;
+    if (tag != "domain" || s.fail()) {
+      metbuild_throw_exception("Invalid checkpoint file " + filename);
+    }
+    checkpoint.set(index, point);
+  }
+  return checkpoint;
+}
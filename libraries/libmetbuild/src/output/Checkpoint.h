@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_CHECKPOINT_H_
+#define METBUILD_SRC_OUTPUT_CHECKPOINT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "Date.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Point an output domain can be resumed from: the last record written
+ * and the length of each of its files at the end of that record
+ */
+struct ResumePoint {
+  MetBuild::Date time;
+  std::vector<uint64_t> offsets;
+};
+
+/**
+ * @brief Progress of the domains of an output file, saved while a build runs
+ * so that a build interrupted part way can be resumed
+ *
+ * The checkpoint is a small text file replaced atomically each time it is
+ * written, so a process stopped at any moment leaves either the previous or
+ * the new checkpoint behind
+ */
+class Checkpoint {
+ public:
+  void set(size_t domain_index, const ResumePoint &point);
+
+  NODISCARD bool has(size_t domain_index) const;
+
+  NODISCARD const ResumePoint &domain(size_t domain_index) const;
+
+  NODISCARD size_t size() const { return m_domains.size(); }
+
+  void write(const std::string &filename) const;
+
+  NODISCARD static Checkpoint read(const std::string &filename);
+
+ private:
+  std::vector<bool> m_valid;
+  std::vector<ResumePoint> m_domains;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_CHECKPOINT_H_
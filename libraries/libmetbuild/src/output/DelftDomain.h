@@ -29,11 +29,14 @@
 #ifndef METGET_SRC_OUTPUT_DELFTDOMAIN_H_
 #define METGET_SRC_OUTPUT_DELFTDOMAIN_H_
 
-#include <fstream>
+#include <memory>
 #include <utility>
 
+#include "FileSink.h"
 #include "MeteorologicalData.h"
 #include "OutputDomain.h"
+#include "ParallelCompressionBuffer.h"
+#include "StreamCompression.h"
 
 namespace MetBuild {
 
@@ -42,7 +45,9 @@ class DelftDomain : public OutputDomain {
   DelftDomain(const MetBuild::Grid *grid, const MetBuild::Date &startDate,
               const MetBuild::Date &endDate, unsigned time_step,
               std::string filename, std::vector<std::string> variables,
-              bool use_compression = false);
+              MetBuild::StreamCompression::Codec codec =
+                  MetBuild::StreamCompression::NONE,
+              const MetBuild::ResumePoint *resume = nullptr);
 
   ~DelftDomain() override;
 
@@ -50,6 +55,8 @@ class DelftDomain : public OutputDomain {
 
   void close() override;
 
+  bool checkpoint(std::vector<uint64_t> *offsets) override;
+
   int write(
       const MetBuild::Date &date,
       const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
@@ -72,17 +79,17 @@ class DelftDomain : public OutputDomain {
 
   template <typename T>
   int writeField(std::ostream *stream, const MetBuild::Date &date,
-                 const std::vector<std::vector<T>> &data,
+                 MetBuild::Span2d<const T> data,
                  double multiplier = 1.0);
 
   const std::vector<std::string> m_variables;
   const std::string m_baseFilename;
-  std::vector<std::ofstream> m_ofstreams;
-  std::vector<std::unique_ptr<boost::iostreams::filtering_streambuf<
-      boost::iostreams::output, char, std::char_traits<char>,
-      std::allocator<char>, boost::iostreams::public_>>>
+  std::vector<std::unique_ptr<MetBuild::FileSink>> m_ofstreams;
+  std::vector<std::unique_ptr<MetBuild::ParallelCompressionBuffer>>
       m_compressedio_buffer;
   std::vector<std::unique_ptr<std::ostream>> m_ostreams;
+  std::vector<std::string> m_blocks;
+  const MetBuild::StreamCompression::Codec m_codec;
   const bool m_use_compression;
   const int m_default_compression_level;
 };
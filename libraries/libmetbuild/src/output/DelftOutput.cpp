@@ -40,7 +40,20 @@ DelftOutput::DelftOutput(const MetBuild::Date& date_start,
                          std::string filename, bool use_compression)
     : OutputFile(date_start, date_end, time_step), 
       m_filename(std::move(filename)),
-      m_use_compression(use_compression) {}
+      m_codec(use_compression ? StreamCompression::GZIP
+                              : StreamCompression::NONE) {}
+
+/**
+ * @brief Selects the codec of the domains added afterwards
+ * @param codec codec, which must be available in this build
+ */
+void DelftOutput::set_compression(const StreamCompression::Codec codec) {
+  if (!StreamCompression::available(codec)) {
+    metbuild_throw_exception("The library was built without " +
+                             StreamCompression::name(codec) + " compression");
+  }
+  m_codec = codec;
+}
 
 std::vector<std::string> DelftOutput::filenames() const {
   return m_domains[0]->filenames();
@@ -54,15 +67,15 @@ void DelftOutput::addDomain(const MetBuild::Grid& w,
   }
   this->m_domains.push_back(std::make_unique<DelftDomain>(
       &w, this->startDate(), this->endDate(), this->timeStep(), m_filename,
-      variables, m_use_compression));
+      variables, m_codec, this->resume_point(0)));
 }
 
 int DelftOutput::write(const MetBuild::Date& date, size_t domain_index,
                        const MetBuild::MeteorologicalData<1>& data) {
-  return this->m_domains[0]->write(date, data);
+  return this->write_domain(0, date, data);
 }
 
 int DelftOutput::write(const MetBuild::Date& date, size_t domain_index,
                        const MetBuild::MeteorologicalData<3>& data) {
-  return this->m_domains[0]->write(date, data);
+  return this->write_domain(0, date, data);
 }
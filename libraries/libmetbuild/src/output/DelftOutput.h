@@ -30,6 +30,7 @@
 #define METGET_SRC_OUTPUT_DELFTOUTPUT_H_
 
 #include "OutputFile.h"
+#include "StreamCompression.h"
 
 namespace MetBuild {
 
@@ -46,6 +47,8 @@ class DelftOutput : public OutputFile {
   void addDomain(const MetBuild::Grid &w,
                  const std::vector<std::string> &variables) override;
 
+  void set_compression(MetBuild::StreamCompression::Codec codec);
+
   int write(
       const MetBuild::Date &date, size_t domain_index,
       const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
@@ -58,7 +61,7 @@ class DelftOutput : public OutputFile {
 
  private:
   const std::string m_filename;
-  const bool m_use_compression;
+  MetBuild::StreamCompression::Codec m_codec;
 };
 }  // namespace MetBuild
 
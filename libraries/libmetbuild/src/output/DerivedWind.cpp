@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "DerivedWind.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Logging.h"
+#include "MeteorologicalData.h"
+
+using namespace MetBuild;
+
+namespace {
+//...Drag coefficient of Powell et al. (2003) stops growing near 26 m/s, where
+// the Garratt relation reaches it
+constexpr double c_powell_saturation = 2.5e-3;
+constexpr double c_rad2deg = 180.0 / M_PI;
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param products bitwise or of the products to compute
+ * @param drag drag formula used for the surface stress
+ */
+DerivedWind::DerivedWind(const unsigned products, const Drag drag)
+    : m_products(products), m_drag(drag) {
+  if ((products & ~(SPEED | DIRECTION | STRESS)) != 0) {
+    metbuild_throw_exception("Invalid derived wind product requested");
+  }
+}
+
+/**
+ * @brief Sets the density of air used for the surface stress, in kg/m^3
+ */
+void DerivedWind::setAirDensity(const double density) {
+  if (density <= 0.0) {
+    metbuild_throw_exception("Air density must be positive");
+  }
+  m_air_density = density;
+}
+
+/**
+ * @brief Sets the upper limit of the drag coefficient
+ */
+void DerivedWind::setDragLimit(const double limit) {
+  if (limit <= 0.0) {
+    metbuild_throw_exception("Drag limit must be positive");
+  }
+  m_drag_limit = limit;
+}
+
+/**
+ * @brief Fields written for the selected products, in the order compute
+ * fills them
+ */
+std::vector<DerivedWind::Field> DerivedWind::fields() const {
+  std::vector<Field> f;
+  if (this->has(SPEED)) f.push_back(WIND_SPEED);
+  if (this->has(DIRECTION)) f.push_back(WIND_DIRECTION);
+  if (this->has(STRESS)) {
+    f.push_back(STRESS_U);
+    f.push_back(STRESS_V);
+  }
+  return f;
+}
+
+/**
+ * @brief Name of a drag formula, stored with the stress in the output files
+ */
+std::string DerivedWind::dragName(const Drag drag) {
+  return drag == POWELL ? "powell" : "garratt";
+}
+
+DerivedWind::Drag DerivedWind::dragFromName(const std::string &name) {
+  if (name == "garratt") return GARRATT;
+  if (name == "powell") return POWELL;
+  metbuild_throw_exception("Unknown drag formula: " + name);
+  return GARRATT;
+}
+
+/**
+ * @brief Drag coefficient for a 10 m wind speed
+ * @param speed wind speed in m/s
+ * @return drag coefficient
+ */
+double DerivedWind::dragCoefficient(const double speed) const {
+  const double garratt = (0.75 + 0.067 * speed) * 1e-3;
+  const double limit = m_drag == POWELL
+                           ? std::min(m_drag_limit, c_powell_saturation)
+                           : m_drag_limit;
+  return std::min(garratt, limit);
+}
+
+/**
+ * @brief Computes the selected products for a run of cells
+ * @param n number of cells
+ * @param u eastward wind
+ * @param v northward wind
+ * @param out output arrays of n values, one per entry of fields()
+ */
+template <typename T>
+void DerivedWind::compute(const size_t n, const T *u, const T *v,
+                          T *const *out) const {
+  constexpr T flag = MeteorologicalData<1, T>::flag_value();
+  const bool speed = this->has(SPEED);
+  const bool direction = this->has(DIRECTION);
+  const bool stress = this->has(STRESS);
+
+  T *out_speed = speed ? *out++ : nullptr;
+  T *out_direction = direction ? *out++ : nullptr;
+  T *out_tau_u = stress ? *out++ : nullptr;
+  T *out_tau_v = stress ? *out++ : nullptr;
+
+  for (size_t k = 0; k < n; ++k) {
+    const double uu = u[k];
+    const double vv = v[k];
+    if (u[k] == flag || v[k] == flag) {
+      if (speed) out_speed[k] = flag;
+      if (direction) out_direction[k] = flag;
+      if (stress) out_tau_u[k] = out_tau_v[k] = flag;
+      continue;
+    }
+    const double s = std::sqrt(uu * uu + vv * vv);
+    if (speed) out_speed[k] = static_cast<T>(s);
+    if (direction) {
+      const double d = 270.0 - std::atan2(vv, uu) * c_rad2deg;
+      out_direction[k] = static_cast<T>(d >= 360.0 ? d - 360.0 : d);
+    }
+    if (stress) {
+      const double f = m_air_density * this->dragCoefficient(s) * s;
+      out_tau_u[k] = static_cast<T>(f * uu);
+      out_tau_v[k] = static_cast<T>(f * vv);
+    }
+  }
+}
+
+template void DerivedWind::compute(size_t, const float *, const float *,
+                                   float *const *) const;
+template void DerivedWind::compute(size_t, const double *, const double *,
+                                   double *const *) const;
@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_DERIVEDWIND_H_
+#define METBUILD_SRC_OUTPUT_DERIVEDWIND_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace MetBuild {
+
+/**
+ * @brief Fields derived from the 10 m wind components, written by the netCDF
+ * output formats next to U10 and V10
+ *
+ * Speed is in m/s and direction is the meteorological direction the wind
+ * blows from, in degrees clockwise from north. Surface stress is
+ * rho_air * Cd * |U| * (u, v) in N/m^2, with the drag coefficient taken from
+ * Garratt (1977) or from the same relation saturated at high wind speeds as
+ * reported by Powell et al. (2003). Both are capped at the drag limit.
+ *
+ * Every product is computed in one pass over the two wind components of a
+ * record while they are still in cache. Cells flagged in either component
+ * are flagged in every product
+ */
+class DerivedWind {
+ public:
+  enum Product { SPEED = 1, DIRECTION = 2, STRESS = 4 };
+
+  enum Drag { GARRATT, POWELL };
+
+  enum Field { WIND_SPEED, WIND_DIRECTION, STRESS_U, STRESS_V };
+
+  DerivedWind() = default;
+
+  explicit DerivedWind(unsigned products, Drag drag = GARRATT);
+
+  unsigned products() const { return m_products; }
+  bool has(Product product) const { return (m_products & product) != 0; }
+  bool empty() const { return m_products == 0; }
+  Drag drag() const { return m_drag; }
+  double airDensity() const { return m_air_density; }
+  double dragLimit() const { return m_drag_limit; }
+
+  void setAirDensity(double density);
+
+  void setDragLimit(double limit);
+
+  std::vector<DerivedWind::Field> fields() const;
+
+  static std::string dragName(Drag drag);
+
+  static Drag dragFromName(const std::string &name);
+
+  double dragCoefficient(double speed) const;
+
+  template <typename T>
+  void compute(size_t n, const T *u, const T *v, T *const *out) const;
+
+ private:
+  unsigned m_products = 0;
+  Drag m_drag = GARRATT;
+  double m_air_density = c_default_air_density;
+  double m_drag_limit = c_default_drag_limit;
+
+  static constexpr double c_default_air_density = 1.293;
+  static constexpr double c_default_drag_limit = 0.0035;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_DERIVEDWIND_H_
@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "EnvelopeDomain.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "Logging.h"
+#include "Utilities.h"
+#include "netcdf.h"
+
+using namespace MetBuild;
+using namespace Utilities;
+
+namespace {
+/**
+ * @brief Variable name, units and field of a reduced variable
+ */
+struct EnvelopeVariable {
+  const char *name;
+  const char *long_name;
+  TemporalEnvelope::FIELD field;
+  bool time;
+};
+
+std::vector<EnvelopeVariable> envelope_variables(const unsigned parameters) {
+  if (parameters == 3) {
+    return {{"wind_speed_max", "maximum wind speed", TemporalEnvelope::MAXIMUM,
+             false},
+            {"time_of_wind_speed_max", "time of maximum wind speed",
+             TemporalEnvelope::TIME_OF_MAXIMUM, true},
+            {"pressure_min", "minimum pressure", TemporalEnvelope::MINIMUM,
+             false},
+            {"time_of_pressure_min", "time of minimum pressure",
+             TemporalEnvelope::TIME_OF_MINIMUM, true}};
+  }
+  return {{"max", "maximum", TemporalEnvelope::MAXIMUM, false},
+          {"time_of_max", "time of maximum", TemporalEnvelope::TIME_OF_MAXIMUM,
+           true},
+          {"min", "minimum", TemporalEnvelope::MINIMUM, false},
+          {"time_of_min", "time of minimum", TemporalEnvelope::TIME_OF_MINIMUM,
+           true},
+          {"accumulated", "value accumulated over the time step",
+           TemporalEnvelope::ACCUMULATED, false}};
+}
+
+void put_text(const int ncid, const int varid, const char *name,
+              const std::string &value) {
+  ncCheck(nc_put_att_text(ncid, varid, name, value.size(), value.c_str()));
+}
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param grid output grid
+ * @param startDate first date of the output
+ * @param endDate last date of the output
+ * @param time_step seconds between records
+ * @param name name of the netCDF group the envelope is written to
+ */
+EnvelopeDomain::EnvelopeDomain(const Grid *grid, const Date &startDate,
+                               const Date &endDate, const unsigned time_step,
+                               std::string name)
+    : OutputDomain(grid, startDate, endDate, time_step),
+      m_name(std::move(name)) {}
+
+void EnvelopeDomain::open() { this->set_open(true); }
+
+void EnvelopeDomain::close() { this->set_open(false); }
+
+TemporalEnvelope *EnvelopeDomain::envelope(const unsigned parameters) {
+  if (!m_envelope) {
+    m_envelope = std::make_unique<TemporalEnvelope>(
+        this->grid()->ni(), this->grid()->nj(), parameters,
+        this->startDate(), this->timestep());
+  }
+  return m_envelope.get();
+}
+
+int EnvelopeDomain::write(
+    const Date &date,
+    const MeteorologicalData<1, MeteorologicalDataType> &data) {
+  this->envelope(1)->add(date, data);
+  return 0;
+}
+
+int EnvelopeDomain::write(
+    const Date &date,
+    const MeteorologicalData<3, MeteorologicalDataType> &data) {
+  this->envelope(3)->add(date, data);
+  return 0;
+}
+
+/**
+ * @brief Writes the grid and the reduced fields of the domain as a group of
+ * a netCDF file. The file must be in data mode
+ * @param ncid netCDF file
+ * @param compression compression of the fields
+ */
+void EnvelopeDomain::write_group(const int ncid,
+                                 const NetcdfCompression &compression) {
+  if (!m_envelope) {
+    Logging::warning("No records were written to envelope domain " + m_name);
+    return;
+  }
+  const size_t ni = this->grid()->ni();
+  const size_t nj = this->grid()->nj();
+  const auto variables = envelope_variables(m_envelope->parameters());
+  const std::string time_units =
+      "minutes since " + m_envelope->origin().toString();
+  const bool geographic = this->guessGridUnits() == "deg";
+
+  ncCheck(nc_redef(ncid));
+  int grpid, dimid_xi, dimid_yi, varid_lon, varid_lat;
+  ncCheck(nc_def_grp(ncid, m_name.c_str(), &grpid));
+  ncCheck(nc_def_dim(grpid, "xi", ni, &dimid_xi));
+  ncCheck(nc_def_dim(grpid, "yi", nj, &dimid_yi));
+  const int dim2d[] = {dimid_yi, dimid_xi};
+
+  ncCheck(nc_def_var(grpid, "lon", NC_DOUBLE, 2, dim2d, &varid_lon));
+  ncCheck(nc_def_var(grpid, "lat", NC_DOUBLE, 2, dim2d, &varid_lat));
+  put_text(grpid, varid_lon, "units", geographic ? "degrees_east" : "m");
+  put_text(grpid, varid_lat, "units", geographic ? "degrees_north" : "m");
+  if (geographic) {
+    put_text(grpid, varid_lon, "standard_name", "longitude");
+    put_text(grpid, varid_lat, "standard_name", "latitude");
+  }
+  compression.applyGrid(grpid, varid_lon, nj, ni);
+  compression.applyGrid(grpid, varid_lat, nj, ni);
+
+  constexpr float fill = MeteorologicalData<1>::flag_value();
+  std::vector<int> varids(variables.size());
+  for (size_t k = 0; k < variables.size(); ++k) {
+    const auto &var = variables[k];
+    ncCheck(nc_def_var(grpid, var.name, NC_FLOAT, 2, dim2d, &varids[k]));
+    ncCheck(nc_def_var_fill(grpid, varids[k], 0, &fill));
+    put_text(grpid, varids[k], "long_name", var.long_name);
+    put_text(grpid, varids[k], "coordinates", "lat lon");
+    if (var.time) put_text(grpid, varids[k], "units", time_units);
+    compression.applyGrid(grpid, varids[k], nj, ni);
+  }
+  const auto records = static_cast<long long>(m_envelope->records());
+  ncCheck(nc_put_att_longlong(grpid, NC_GLOBAL, "records", NC_INT64, 1,
+                              &records));
+  ncCheck(nc_enddef(ncid));
+
+  const auto x = this->grid()->x();
+  const auto y = this->grid()->y();
+  ncCheck(nc_put_var_double(grpid, varid_lon, x.data()));
+  ncCheck(nc_put_var_double(grpid, varid_lat, y.data()));
+
+  std::vector<MeteorologicalDataType> field(ni * nj);
+  std::vector<float> values(ni * nj);
+  for (size_t k = 0; k < variables.size(); ++k) {
+    m_envelope->get(variables[k].field,
+                    Span<MeteorologicalDataType>(field.data(), field.size()));
+    std::copy(field.begin(), field.end(), values.begin());
+    ncCheck(nc_put_var_float(grpid, varids[k], values.data()));
+  }
+}
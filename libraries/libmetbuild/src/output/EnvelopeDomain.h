@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METGET_SRC_OUTPUT_ENVELOPEDOMAIN_H_
+#define METGET_SRC_OUTPUT_ENVELOPEDOMAIN_H_
+
+#include <memory>
+#include <string>
+
+#include "MeteorologicalData.h"
+#include "NetcdfCompression.h"
+#include "OutputDomain.h"
+#include "TemporalEnvelope.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Domain of an EnvelopeOutput. Records are only folded into a
+ * TemporalEnvelope as they arrive and the reduced fields are written as a
+ * netCDF group when the output is closed
+ */
+class EnvelopeDomain : public OutputDomain {
+ public:
+  EnvelopeDomain(const MetBuild::Grid *grid, const MetBuild::Date &startDate,
+                 const MetBuild::Date &endDate, unsigned time_step,
+                 std::string name);
+
+  void open() override;
+  void close() override;
+
+  int write(
+      const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  int write(
+      const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  NODISCARD const std::string &name() const { return m_name; }
+
+  NODISCARD const MetBuild::TemporalEnvelope *envelope() const {
+    return m_envelope.get();
+  }
+
+  void write_group(int ncid, const MetBuild::NetcdfCompression &compression);
+
+ private:
+  MetBuild::TemporalEnvelope *envelope(unsigned parameters);
+
+  std::string m_name;
+  std::unique_ptr<MetBuild::TemporalEnvelope> m_envelope;
+};
+
+}  // namespace MetBuild
+#endif  // METGET_SRC_OUTPUT_ENVELOPEDOMAIN_H_
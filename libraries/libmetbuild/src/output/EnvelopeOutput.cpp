@@ -0,0 +1,144 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "EnvelopeOutput.h"
+
+#include <string_view>
+#include <utility>
+
+#include "Logging.h"
+#include "Utilities.h"
+#include "fmt/core.h"
+#include "netcdf.h"
+
+using namespace MetBuild;
+using namespace Utilities;
+
+/**
+ * @brief Constructor
+ * @param date_start first date of the records
+ * @param date_end last date of the records
+ * @param time_step seconds between records
+ * @param filename netCDF file written when the output is closed
+ */
+EnvelopeOutput::EnvelopeOutput(const Date &date_start, const Date &date_end,
+                               const unsigned time_step, std::string filename)
+    : OutputFile(date_start, date_end, time_step),
+      m_filename(std::move(filename)),
+      m_compression(NetcdfCompression::defaults()),
+      m_closed(false) {}
+
+EnvelopeOutput::~EnvelopeOutput() {
+  try {
+    this->close();
+  } catch (const std::exception &e) {
+    Logging::logError(e.what());
+  }
+}
+
+std::vector<std::string> EnvelopeOutput::filenames() const {
+  return {m_filename};
+}
+
+/**
+ * @brief Sets the chunking and compression of the fields written when the
+ * output is closed
+ * @param compression compression policy
+ */
+void EnvelopeOutput::set_compression(const NetcdfCompression &compression) {
+  m_compression = compression;
+}
+
+/**
+ * @brief Adds a domain
+ * @param w output grid
+ * @param names optional name of the netCDF group of the domain, "domain_NN"
+ * by default
+ */
+void EnvelopeOutput::addDomain(const Grid &w,
+                               const std::vector<std::string> &names) {
+  const auto name = names.empty() || names[0].empty()
+                        ? fmt::format("domain_{:02d}", m_domains.size() + 1)
+                        : names[0];
+  auto domain = std::make_unique<EnvelopeDomain>(
+      &w, this->startDate(), this->endDate(), this->timeStep(), name);
+  domain->open();
+  m_envelopes.push_back(domain.get());
+  m_domains.push_back(std::move(domain));
+}
+
+int EnvelopeOutput::write(
+    const Date &date, const size_t domain_index,
+    const MeteorologicalData<1, MeteorologicalDataType> &data) {
+  return this->write_domain(domain_index, date, data);
+}
+
+int EnvelopeOutput::write(
+    const Date &date, const size_t domain_index,
+    const MeteorologicalData<3, MeteorologicalDataType> &data) {
+  return this->write_domain(domain_index, date, data);
+}
+
+/**
+ * @brief Waits for the records still queued and writes the envelopes of
+ * every domain. Called by the destructor if not called before
+ */
+void EnvelopeOutput::close() {
+  if (m_closed) return;
+  m_closed = true;
+  this->flush();
+  this->stop_writers();
+
+  constexpr std::string_view title = "MetGet Forcing, Temporal Envelope";
+  constexpr std::string_view source = "MetGet";
+  const std::string history = "Created " + Date::now().toString();
+  const std::string period = this->startDate().toString() + " to " +
+                             this->endDate().toString();
+
+  int ncid;
+  ncCheck(nc_create(m_filename.c_str(), NC_NETCDF4, &ncid));
+  ncCheck(nc_put_att_text(ncid, NC_GLOBAL, "title", title.size(), &title[0]));
+  ncCheck(nc_put_att_text(ncid, NC_GLOBAL, "source", source.size(),
+                          &source[0]));
+  ncCheck(nc_put_att_text(ncid, NC_GLOBAL, "history", history.size(),
+                          &history[0]));
+  ncCheck(nc_put_att_text(ncid, NC_GLOBAL, "period", period.size(),
+                          &period[0]));
+  ncCheck(nc_enddef(ncid));
+
+  try {
+    for (auto *domain : m_envelopes) {
+      domain->write_group(ncid, m_compression);
+      domain->close();
+    }
+  } catch (...) {
+    nc_close(ncid);
+    throw;
+  }
+  ncCheck(nc_close(ncid));
+}
@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METGET_SRC_OUTPUT_ENVELOPEOUTPUT_H_
+#define METGET_SRC_OUTPUT_ENVELOPEOUTPUT_H_
+
+#include <string>
+#include <vector>
+
+#include "EnvelopeDomain.h"
+#include "NetcdfCompression.h"
+#include "OutputFile.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Output holding only the per-cell extremes and totals of the
+ * records, such as the maximum wind envelope or the event rainfall, instead
+ * of the time series
+ *
+ * The reductions are updated as each record is written and the netCDF file
+ * is written once, with a group per domain, when the output is closed. It
+ * can be built from on its own, or set as the side output of another format
+ * with OutputFile::set_side_output to be produced alongside the series
+ */
+class EnvelopeOutput : public OutputFile {
+ public:
+  EnvelopeOutput(const MetBuild::Date &date_start,
+                 const MetBuild::Date &date_end, unsigned time_step,
+                 std::string filename);
+
+  ~EnvelopeOutput() override;
+
+  std::vector<std::string> filenames() const override;
+
+  void set_compression(const NetcdfCompression &compression);
+
+  void addDomain(const MetBuild::Grid &w,
+                 const std::vector<std::string> &names) override;
+
+  int write(
+      const MetBuild::Date &date, size_t domain_index,
+      const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  int write(
+      const MetBuild::Date &date, size_t domain_index,
+      const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  void close();
+
+ private:
+  std::string m_filename;
+  NetcdfCompression m_compression;
+  std::vector<MetBuild::EnvelopeDomain *> m_envelopes;
+  bool m_closed;
+};
+
+}  // namespace MetBuild
+#endif  // METGET_SRC_OUTPUT_ENVELOPEOUTPUT_H_
@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "FileChecksum.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+using namespace MetBuild;
+
+namespace {
+
+std::atomic<uint64_t> s_part_size{FileChecksums::c_default_part_size};
+
+std::mutex &registry_mutex() {
+  static std::mutex m;
+  return m;
+}
+
+std::unordered_map<std::string, FileChecksum> &registry() {
+  static std::unordered_map<std::string, FileChecksum> r;
+  return r;
+}
+
+uint8_t nibble(char c) {
+  if (c >= 'a') return static_cast<uint8_t>(c - 'a' + 10);
+  if (c >= 'A') return static_cast<uint8_t>(c - 'A' + 10);
+  return static_cast<uint8_t>(c - '0');
+}
+
+}  // namespace
+
+/**
+ * @brief ETag S3 gives the file once uploaded in parts of part_size, the
+ * MD5 of the binary digests of the parts followed by the number of parts.
+ * A file sent in a single part has its MD5 as its ETag
+ */
+std::string FileChecksum::etag() const {
+  if (part_md5.size() < 2) return md5;
+  Md5 parts;
+  for (const auto &p : part_md5) {
+    Md5::Digest d;
+    for (size_t i = 0; i < d.size(); ++i) {
+      d[i] = static_cast<uint8_t>(nibble(p[2 * i]) << 4 | nibble(p[2 * i + 1]));
+    }
+    parts.update(d.data(), d.size());
+  }
+  return parts.hexdigest() + "-" + std::to_string(part_md5.size());
+}
+
+/**
+ * @brief Constructor
+ * @param part_size length of the parts digested on their own, or 0 for none
+ */
+ChecksumAccumulator::ChecksumAccumulator(uint64_t part_size)
+    : m_part_size(part_size), m_part_length(0) {}
+
+void ChecksumAccumulator::update(const void *data, size_t length) {
+  m_file.update(data, length);
+  if (m_part_size == 0) return;
+  const auto *bytes = static_cast<const char *>(data);
+  while (length > 0) {
+    const auto n =
+        static_cast<size_t>(std::min<uint64_t>(m_part_size - m_part_length,
+                                               length));
+    m_part.update(bytes, n);
+    m_part_length += n;
+    bytes += n;
+    length -= n;
+    if (m_part_length == m_part_size) {
+      m_parts.push_back(m_part.hexdigest());
+      m_part = Md5();
+      m_part_length = 0;
+    }
+  }
+}
+
+/**
+ * @brief Checksum of the bytes added so far, the last part holding whatever
+ * follows the last full part
+ */
+FileChecksum ChecksumAccumulator::finish(const std::string &filename) const {
+  FileChecksum checksum;
+  checksum.filename = filename;
+  checksum.size = m_file.length();
+  checksum.md5 = m_file.hexdigest();
+  checksum.part_size = m_part_size;
+  checksum.part_md5 = m_parts;
+  if (m_part_length > 0 || (m_part_size > 0 && m_parts.empty())) {
+    checksum.part_md5.push_back(m_part.hexdigest());
+  }
+  return checksum;
+}
+
+/**
+ * @brief Sets the length of the parts digested for the files opened from
+ * now on, or 0 to only digest whole files
+ */
+void FileChecksums::setPartSize(uint64_t part_size) { s_part_size = part_size; }
+
+uint64_t FileChecksums::partSize() { return s_part_size; }
+
+void FileChecksums::record(const FileChecksum &checksum) {
+  std::lock_guard<std::mutex> lock(registry_mutex());
+  registry()[checksum.filename] = checksum;
+}
+
+void FileChecksums::remove(const std::string &filename) {
+  std::lock_guard<std::mutex> lock(registry_mutex());
+  registry().erase(filename);
+}
+
+/**
+ * @brief Checksum of a closed file, which is not valid when the file was not
+ * written through the checksummed writers
+ */
+FileChecksum FileChecksums::find(const std::string &filename) {
+  std::lock_guard<std::mutex> lock(registry_mutex());
+  const auto it = registry().find(filename);
+  if (it == registry().end()) return {};
+  return it->second;
+}
+
+/**
+ * @brief Same as find, forgetting the checksum
+ */
+FileChecksum FileChecksums::take(const std::string &filename) {
+  std::lock_guard<std::mutex> lock(registry_mutex());
+  const auto it = registry().find(filename);
+  if (it == registry().end()) return {};
+  auto checksum = std::move(it->second);
+  registry().erase(it);
+  return checksum;
+}
+
+void FileChecksums::clear() {
+  std::lock_guard<std::mutex> lock(registry_mutex());
+  registry().clear();
+}
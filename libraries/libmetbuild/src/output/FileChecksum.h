@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_FILECHECKSUM_H_
+#define METBUILD_SRC_OUTPUT_FILECHECKSUM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "Md5.h"
+
+namespace MetBuild {
+
+/**
+ * @brief MD5 of a file written by the outputs and of each part of it sent by
+ * a multipart upload, computed while the file was written
+ *
+ * An empty md5 means no checksum is known for the file
+ */
+struct FileChecksum {
+  std::string filename;
+  uint64_t size = 0;
+  std::string md5;
+  uint64_t part_size = 0;
+  std::vector<std::string> part_md5;
+
+  NODISCARD bool valid() const { return !md5.empty(); }
+
+  NODISCARD std::string etag() const;
+};
+
+/**
+ * @brief Accumulates the checksum of a file from its bytes, in order
+ */
+class ChecksumAccumulator {
+ public:
+  explicit ChecksumAccumulator(uint64_t part_size = 0);
+
+  void update(const void *data, size_t length);
+
+  NODISCARD FileChecksum finish(const std::string &filename) const;
+
+ private:
+  uint64_t m_part_size;
+  uint64_t m_part_length;
+  Md5 m_file;
+  Md5 m_part;
+  std::vector<std::string> m_parts;
+};
+
+/**
+ * @brief Checksums of the files closed by the output writers, kept by file
+ * name until they are taken
+ *
+ * The part size is the one used to upload the files, so that each part can
+ * be sent with its Content-MD5 and the S3 ETag of the whole file is known
+ * before the upload. It defaults to 8 MB, the part size of the uploads
+ */
+class FileChecksums {
+ public:
+  static void setPartSize(uint64_t part_size);
+
+  NODISCARD static uint64_t partSize();
+
+  static void record(const FileChecksum &checksum);
+
+  static void remove(const std::string &filename);
+
+  NODISCARD static FileChecksum find(const std::string &filename);
+
+  NODISCARD static FileChecksum take(const std::string &filename);
+
+  static void clear();
+
+  static constexpr uint64_t c_default_part_size = 8 * 1024 * 1024;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_FILECHECKSUM_H_
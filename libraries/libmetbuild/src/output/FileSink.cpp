@@ -0,0 +1,454 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "FileSink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include "Instrumentation.h"
+#include "Logging.h"
+
+#ifdef _WIN32
+#include "boost/filesystem.hpp"
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace MetBuild;
+
+/**
+ * @brief Constructor
+ * @param block_size bytes gathered before a block is handed to the writer
+ * @param blocks number of blocks allocated, in flight or being filled
+ */
+FileSinkBuffer::FileSinkBuffer(size_t block_size, size_t blocks)
+    : m_block_size(std::max<size_t>(block_size, 4096)),
+      m_max_blocks(std::max<size_t>(blocks, 2)),
+#ifdef _WIN32
+      m_file(nullptr),
+#else
+      m_fd(-1),
+#endif
+      m_checksummed(false),
+      m_allocated(0),
+      m_offset(0),
+      m_busy(false),
+      m_stop(false) {
+}
+
+FileSinkBuffer::~FileSinkBuffer() {
+  try {
+    this->close();
+  } catch (const std::exception &e) {
+    Logging::logError(e.what());
+  }
+}
+
+/**
+ * @brief Creates or truncates a file and starts its writer thread
+ * @param filename file written
+ * @return false if the file could not be opened
+ */
+bool FileSinkBuffer::open(const std::string &filename) {
+  return this->open_file(filename, true, 0);
+}
+
+/**
+ * @brief Reopens an existing file to append from a given length. Anything
+ * past that length, written after the point being resumed, is discarded
+ * @param filename file written
+ * @param length length of the file kept
+ * @return false if the file could not be opened or is shorter than length
+ */
+bool FileSinkBuffer::resume(const std::string &filename,
+                            const uint64_t length) {
+  return this->open_file(filename, false, length);
+}
+
+bool FileSinkBuffer::open_file(const std::string &filename,
+                               const bool truncate, const uint64_t length) {
+  if (this->is_open()) return false;
+#ifdef _WIN32
+  if (truncate) {
+    m_file = std::fopen(filename.c_str(), "wb");
+  } else {
+    boost::system::error_code ec;
+    if (boost::filesystem::file_size(filename, ec) < length || ec) {
+      return false;
+    }
+    boost::filesystem::resize_file(filename, length, ec);
+    if (ec) return false;
+    m_file = std::fopen(filename.c_str(), "r+b");
+    if (m_file != nullptr && _fseeki64(m_file, length, SEEK_SET) != 0) {
+      std::fclose(m_file);
+      m_file = nullptr;
+    }
+  }
+#else
+  m_fd = ::open(filename.c_str(),
+                O_WRONLY | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0),
+                0644);
+  if (m_fd >= 0 && !truncate) {
+    struct stat st {};
+    if (::fstat(m_fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < length ||
+        ::ftruncate(m_fd, static_cast<off_t>(length)) != 0) {
+      ::close(m_fd);
+      m_fd = -1;
+    }
+  }
+#endif
+  if (!this->is_open()) return false;
+
+  m_filename = filename;
+  FileChecksums::remove(filename);
+  this->seed_checksum(filename, length);
+  m_offset = length;
+  m_error = nullptr;
+  m_stop = false;
+  m_thread = std::thread(&FileSinkBuffer::run, this);
+  this->take_block();
+  return true;
+}
+
+bool FileSinkBuffer::is_open() const {
+#ifdef _WIN32
+  return m_file != nullptr;
+#else
+  return m_fd >= 0;
+#endif
+}
+
+/**
+ * @brief Writes everything gathered so far and makes it durable on disk
+ * @return length of the file, which holds everything written
+ */
+uint64_t FileSinkBuffer::commit() {
+  if (!this->is_open()) {
+    metbuild_throw_exception("The output file is not open");
+  }
+  this->submit_block();
+  this->wait_idle();
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_error) std::rethrow_exception(m_error);
+  }
+#ifdef _WIN32
+  const bool synced = std::fflush(m_file) == 0;
+#elif defined(__APPLE__)
+  const bool synced = ::fsync(m_fd) == 0;
+#else
+  const bool synced = ::fdatasync(m_fd) == 0;
+#endif
+  if (!synced) {
+    metbuild_throw_exception("Could not sync output file");
+  }
+  this->take_block();
+  return m_offset;
+}
+
+/**
+ * @brief Writes the remaining data, waits for the writer thread and closes
+ * the file. Errors raised while writing are rethrown here
+ */
+void FileSinkBuffer::close() {
+  if (!this->is_open()) return;
+  this->submit_block();
+  this->setp(nullptr, nullptr);
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_condition.notify_all();
+  m_thread.join();
+
+#ifdef _WIN32
+  const bool closed = std::fclose(m_file) == 0;
+  m_file = nullptr;
+#else
+  const bool closed = ::close(m_fd) == 0;
+  m_fd = -1;
+#endif
+  m_block = Block();
+  m_free.clear();
+  m_queue.clear();
+  m_allocated = 0;
+
+  if (m_error) {
+    auto error = m_error;
+    m_error = nullptr;
+    std::rethrow_exception(error);
+  }
+  if (!closed) {
+    metbuild_throw_exception("Could not close output file");
+  }
+  if (m_checksummed) FileChecksums::record(m_checksum.finish(m_filename));
+}
+
+FileSinkBuffer::int_type FileSinkBuffer::overflow(int_type ch) {
+  if (!this->is_open()) return traits_type::eof();
+  if (!this->submit_block() || !this->take_block()) return traits_type::eof();
+  if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+    *this->pptr() = traits_type::to_char_type(ch);
+    this->pbump(1);
+  }
+  return traits_type::not_eof(ch);
+}
+
+/**
+ * @brief Copies a run of characters into the blocks, handing each block to
+ * the writer as it fills
+ */
+std::streamsize FileSinkBuffer::xsputn(const char *s, std::streamsize n) {
+  if (!this->is_open()) return 0;
+  std::streamsize written = 0;
+  while (written < n) {
+    if (this->pptr() == this->epptr()) {
+      if (!this->submit_block() || !this->take_block()) break;
+    }
+    const auto chunk = std::min<std::streamsize>(
+        this->epptr() - this->pptr(), n - written);
+    std::memcpy(this->pptr(), s + written, static_cast<size_t>(chunk));
+    this->pbump(static_cast<int>(chunk));
+    written += chunk;
+  }
+  return written;
+}
+
+/**
+ * @brief Writes everything gathered so far and waits until it reaches the
+ * file
+ */
+int FileSinkBuffer::sync() {
+  if (!this->is_open()) return 0;
+  if (!this->submit_block()) return -1;
+  this->wait_idle();
+  return this->take_block() ? 0 : -1;
+}
+
+/**
+ * @brief Queues the filled part of the current block at the end of the file
+ * @return false if the writer has failed
+ */
+bool FileSinkBuffer::submit_block() {
+  const auto size = static_cast<size_t>(this->pptr() - this->pbase());
+  if (size == 0) return true;
+  this->setp(nullptr, nullptr);
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_error) return false;
+    m_queue.push_back({std::move(m_block), size, m_offset});
+  }
+  m_offset += size;
+  m_condition.notify_all();
+  return true;
+}
+
+/**
+ * @brief Makes a free block the put area, allocating one while fewer than
+ * the maximum exist and otherwise waiting for the writer to release one
+ * @return false if the writer has failed
+ */
+bool FileSinkBuffer::take_block() {
+  if (!m_block.empty()) {
+    this->setp(m_block.data(), m_block.data() + m_block.size());
+    return true;
+  }
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_free.empty() && m_allocated >= m_max_blocks && !m_error) {
+    Instrumentation::ScopedTimer timer(Instrumentation::OUTPUT_WAIT);
+    m_condition.wait(lock, [this]() { return !m_free.empty() || m_error; });
+  }
+  if (m_error) return false;
+  if (!m_free.empty()) {
+    m_block = std::move(m_free.back());
+    m_free.pop_back();
+  } else {
+    m_block = Block(m_block_size);
+    m_allocated++;
+  }
+  lock.unlock();
+  this->setp(m_block.data(), m_block.data() + m_block.size());
+  return true;
+}
+
+void FileSinkBuffer::wait_idle() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_condition.wait(lock, [this]() { return m_queue.empty() && !m_busy; });
+}
+
+void FileSinkBuffer::run() {
+  for (;;) {
+    Pending pending;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condition.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+      if (m_queue.empty()) return;
+      pending = std::move(m_queue.front());
+      m_queue.pop_front();
+      m_busy = true;
+    }
+
+    std::exception_ptr error;
+    try {
+      this->write_block(pending);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (error && !m_error) m_error = error;
+      m_free.push_back(std::move(pending.block));
+      m_busy = false;
+    }
+    m_condition.notify_all();
+  }
+}
+
+void FileSinkBuffer::write_block(const Pending &pending) {
+  Instrumentation::ScopedTimer timer(Instrumentation::FILE_WRITE, pending.size);
+  const char *data = pending.block.data();
+  size_t remaining = pending.size;
+#ifdef _WIN32
+  //...Blocks are written by one thread in the order they were queued, so
+  // the file position is always the block offset
+  if (std::fwrite(data, 1, remaining, m_file) != remaining) {
+    metbuild_throw_exception("Could not write output file");
+  }
+#else
+  auto offset = static_cast<off_t>(pending.offset);
+  while (remaining > 0) {
+    const auto n = ::pwrite(m_fd, data, remaining, offset);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      metbuild_throw_exception(std::string("Could not write output file: ") +
+                               std::strerror(errno));
+    }
+    data += n;
+    remaining -= static_cast<size_t>(n);
+    offset += n;
+  }
+#endif
+  if (m_checksummed) m_checksum.update(pending.block.data(), pending.size);
+}
+
+/**
+ * @brief Starts the checksum of a file, digesting the part of a resumed file
+ * that is kept. The file has no checksum if that part cannot be read
+ * @param filename file written
+ * @param length length of the file kept
+ */
+void FileSinkBuffer::seed_checksum(const std::string &filename,
+                                   const uint64_t length) {
+  m_checksum = ChecksumAccumulator(FileChecksums::partSize());
+  m_checksummed = true;
+  if (length == 0) return;
+  std::ifstream f(filename, std::ios::binary);
+  std::vector<char> buffer(m_block_size);
+  uint64_t remaining = length;
+  while (f && remaining > 0) {
+    const auto n = static_cast<size_t>(
+        std::min<uint64_t>(buffer.size(), remaining));
+    f.read(buffer.data(), static_cast<std::streamsize>(n));
+    const auto got = static_cast<size_t>(f.gcount());
+    m_checksum.update(buffer.data(), got);
+    remaining -= got;
+  }
+  m_checksummed = remaining == 0;
+}
+
+FileSink::FileSink() : std::ostream(nullptr) { this->rdbuf(&m_buffer); }
+
+FileSink::FileSink(const std::string &filename) : FileSink() {
+  this->open(filename);
+}
+
+FileSink::~FileSink() {
+  try {
+    m_buffer.close();
+  } catch (const std::exception &e) {
+    Logging::logError(e.what());
+  }
+}
+
+/**
+ * @brief Creates or truncates a file. The stream fails if it cannot be
+ * opened, as std::ofstream does
+ * @param filename file written
+ */
+void FileSink::open(const std::string &filename) {
+  if (m_buffer.open(filename)) {
+    this->clear();
+  } else {
+    this->setstate(std::ios_base::failbit);
+  }
+}
+
+/**
+ * @brief Reopens an existing file to append from a given length. The stream
+ * fails if the file cannot be opened or is shorter than length
+ * @param filename file written
+ * @param length length of the file kept
+ */
+void FileSink::resume(const std::string &filename, const uint64_t length) {
+  if (m_buffer.resume(filename, length)) {
+    this->clear();
+  } else {
+    this->setstate(std::ios_base::failbit);
+  }
+}
+
+bool FileSink::is_open() const { return m_buffer.is_open(); }
+
+/**
+ * @brief Makes everything written so far durable on disk
+ * @return length of the file
+ */
+uint64_t FileSink::commit() {
+  this->flush();
+  return m_buffer.commit();
+}
+
+/**
+ * @brief Writes the remaining data and closes the file, rethrowing any error
+ * raised while writing
+ */
+void FileSink::close() {
+  try {
+    m_buffer.close();
+  } catch (...) {
+    this->setstate(std::ios_base::badbit);
+    throw;
+  }
+}
@@ -0,0 +1,176 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_FILESINK_H_
+#define METBUILD_SRC_OUTPUT_FILESINK_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AlignedAllocator.h"
+#include "FileChecksum.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Stream buffer writing a file in large aligned blocks from a
+ * dedicated thread
+ *
+ * Data is gathered into a block, and a full block is handed to the writer
+ * thread, which writes it with pwrite at its offset in the file while the
+ * caller fills the next one. A fixed number of blocks is recycled, so the
+ * caller only blocks on the kernel when every block is still being written.
+ * Errors from the writer thread make the next output fail and are rethrown
+ * by close
+ *
+ * A file can also be reopened to append at a known length, which is how a
+ * build resumes the files of a checkpoint
+ *
+ * The writer thread digests each block after writing it, and the checksum
+ * of a file closed without error is recorded in FileChecksums, so uploads
+ * do not read the file again to check it
+ */
+class FileSinkBuffer : public std::streambuf {
+ public:
+  explicit FileSinkBuffer(size_t block_size = c_default_block_size,
+                          size_t blocks = c_default_blocks);
+
+  ~FileSinkBuffer() override;
+
+  FileSinkBuffer(const FileSinkBuffer &) = delete;
+  FileSinkBuffer &operator=(const FileSinkBuffer &) = delete;
+
+  bool open(const std::string &filename);
+
+  bool resume(const std::string &filename, uint64_t length);
+
+  bool is_open() const;
+
+  uint64_t commit();
+
+  void close();
+
+  static constexpr size_t c_default_block_size = 1 << 22;
+  static constexpr size_t c_default_blocks = 4;
+
+ protected:
+  int_type overflow(int_type ch) override;
+
+  std::streamsize xsputn(const char *s, std::streamsize n) override;
+
+  int sync() override;
+
+ private:
+  using Block = std::vector<char, AlignedAllocator<char, 4096>>;
+
+  struct Pending {
+    Block block;
+    size_t size;
+    uint64_t offset;
+  };
+
+  bool open_file(const std::string &filename, bool truncate, uint64_t length);
+
+  bool submit_block();
+
+  bool take_block();
+
+  void wait_idle();
+
+  void run();
+
+  void write_block(const Pending &pending);
+
+  void seed_checksum(const std::string &filename, uint64_t length);
+
+  const size_t m_block_size;
+  const size_t m_max_blocks;
+#ifdef _WIN32
+  std::FILE *m_file;
+#else
+  int m_fd;
+#endif
+  Block m_block;
+  std::string m_filename;
+  ChecksumAccumulator m_checksum;
+  bool m_checksummed;
+  size_t m_allocated;
+  uint64_t m_offset;
+
+  std::thread m_thread;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::deque<Pending> m_queue;
+  std::vector<Block> m_free;
+  std::exception_ptr m_error;
+  bool m_busy;
+  bool m_stop;
+};
+
+/**
+ * @brief Output file stream writing through a FileSinkBuffer, used by the
+ * text and binary writers in place of std::ofstream
+ */
+class FileSink : public std::ostream {
+ public:
+  FileSink();
+
+  explicit FileSink(const std::string &filename);
+
+  ~FileSink() override;
+
+  FileSink(const FileSink &) = delete;
+  FileSink &operator=(const FileSink &) = delete;
+
+  void open(const std::string &filename);
+
+  void resume(const std::string &filename, uint64_t length);
+
+  bool is_open() const;
+
+  uint64_t commit();
+
+  void close();
+
+ private:
+  FileSinkBuffer m_buffer;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_FILESINK_H_
@@ -0,0 +1,277 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "GribDomain.h"
+
+#include <cmath>
+#include <utility>
+
+#include "GribHandle.h"
+#include "Logging.h"
+#include "eccodes.h"
+
+using namespace MetBuild;
+
+namespace {
+//...Default missing value of the GRIB2 samples, never a valid output value
+constexpr double c_missing_value = 9999.0;
+
+constexpr char c_sample[] = "regular_ll_sfc_grib2";
+
+void set_long(codes_handle *handle, const char *key, const long value) {
+  if (codes_set_long(handle, key, value) != GRIB_SUCCESS) {
+    metbuild_throw_exception(std::string("Could not set the grib key ") +
+                             key);
+  }
+}
+
+void set_double(codes_handle *handle, const char *key, const double value) {
+  if (codes_set_double(handle, key, value) != GRIB_SUCCESS) {
+    metbuild_throw_exception(std::string("Could not set the grib key ") +
+                             key);
+  }
+}
+
+void set_string(codes_handle *handle, const char *key,
+                const std::string &value) {
+  size_t length = value.size();
+  if (codes_set_string(handle, key, value.c_str(), &length) != GRIB_SUCCESS) {
+    metbuild_throw_exception(std::string("Could not set the grib key ") +
+                             key + " to " + value);
+  }
+}
+
+//...GRIB2 longitudes are positive, wrapping past 360 when the grid crosses
+// the prime meridian
+double grib_longitude(const double longitude) {
+  const double x = std::fmod(longitude, 360.0);
+  return x < 0.0 ? x + 360.0 : x;
+}
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param grid output grid, a regular latitude/longitude grid
+ * @param startDate first date of the output, the reference time of every
+ * message
+ * @param endDate last date of the output
+ * @param time_step seconds between records
+ * @param filename GRIB2 file
+ * @param variable scalar variable written by the domain, one of rain,
+ * humidity, temperature or ice. Unused for wind and pressure
+ * @param packing_type eccodes packing type of the values
+ * @param bits_per_value bits each packed value is stored in, or zero for
+ * the default of the packing
+ * @param resume point the file resumes from, or nullptr to start over
+ */
+GribDomain::GribDomain(const Grid *grid, const Date &startDate,
+                       const Date &endDate, const unsigned time_step,
+                       std::string filename, std::string variable,
+                       std::string packing_type, const long bits_per_value,
+                       const ResumePoint *resume)
+    : OutputDomain(grid, startDate, endDate, time_step, resume),
+      m_filename(std::move(filename)),
+      m_variable(std::move(variable)),
+      m_packing_type(std::move(packing_type)),
+      m_bits_per_value(bits_per_value) {
+  if (grid->is_point_list() || grid->epsg() != 4326 ||
+      grid->rotation() != 0.0) {
+    metbuild_throw_exception(
+        "GRIB output requires an unrotated latitude/longitude grid");
+  }
+  if (!m_variable.empty()) GribDomain::product(m_variable);
+  this->m_filenames.push_back(m_filename);
+  this->open();
+}
+
+GribDomain::~GribDomain() {
+  this->delete_handles();
+  if (m_sink.is_open()) m_sink.close();
+}
+
+void GribDomain::open() {
+  if (!m_sink.is_open()) {
+    this->open_sink(&m_sink, m_filename, 0);
+    //...Messages are self contained so a resumed file is only appended to
+    this->clear_resume();
+  }
+  this->set_open(true);
+}
+
+void GribDomain::close() {
+  if (m_sink.is_open()) m_sink.close();
+  this->set_open(false);
+}
+
+/**
+ * @brief Makes the file durable up to the last message written
+ */
+bool GribDomain::checkpoint(std::vector<uint64_t> *offsets) {
+  if (!this->is_open()) return false;
+  offsets->clear();
+  offsets->push_back(m_sink.commit());
+  return true;
+}
+
+GribDomain::Product GribDomain::product(const std::string &variable) {
+  //...discipline, category, number, surface, height, scale, offset
+  if (variable == "wind_u") return {0, 2, 2, 103, 10, 1.0, 0.0};
+  if (variable == "wind_v") return {0, 2, 3, 103, 10, 1.0, 0.0};
+  if (variable == "mslp") return {0, 3, 1, 101, 0, 100.0, 0.0};
+  if (variable == "rain") return {0, 1, 7, 1, 0, 1.0 / 3600.0, 0.0};
+  if (variable == "humidity") return {0, 1, 1, 103, 2, 1.0, 0.0};
+  if (variable == "temperature") return {0, 0, 0, 103, 2, 1.0, 273.15};
+  if (variable == "ice") return {10, 2, 0, 1, 0, 1.0, 0.0};
+  metbuild_throw_exception("No GRIB2 product for variable " + variable);
+  return {};
+}
+
+void GribDomain::create_handles(const std::vector<Product> &products) {
+  codes_handle *base =
+      codes_grib_handle_new_from_samples(GribHandle::context(), c_sample);
+  if (base == nullptr) {
+    metbuild_throw_exception(std::string("Could not load the eccodes sample ") +
+                             c_sample);
+  }
+
+  try {
+    const auto *grid = this->grid();
+    const auto first = grid->position(0, 0);
+    const auto last = grid->position(grid->ni() - 1, grid->nj() - 1);
+    set_long(base, "Ni", static_cast<long>(grid->ni()));
+    set_long(base, "Nj", static_cast<long>(grid->nj()));
+    set_long(base, "iScansNegatively", 0);
+    set_long(base, "jScansPositively", 1);
+    set_double(base, "latitudeOfFirstGridPointInDegrees", first.y());
+    set_double(base, "longitudeOfFirstGridPointInDegrees",
+               grib_longitude(first.x()));
+    set_double(base, "latitudeOfLastGridPointInDegrees", last.y());
+    set_double(base, "longitudeOfLastGridPointInDegrees",
+               grib_longitude(last.x()));
+    set_double(base, "iDirectionIncrementInDegrees", grid->dx());
+    set_double(base, "jDirectionIncrementInDegrees", grid->dy());
+
+    const auto start = this->startDate();
+    set_long(base, "dataDate",
+             start.year() * 10000L + start.month() * 100L + start.day());
+    set_long(base, "dataTime", start.hour() * 100L + start.minute());
+    set_long(base, "indicatorOfUnitOfTimeRange", 0);
+
+    set_string(base, "packingType", m_packing_type);
+    if (m_bits_per_value > 0) {
+      set_long(base, "bitsPerValue", m_bits_per_value);
+    }
+    set_long(base, "bitmapPresent", 1);
+    set_double(base, "missingValue", c_missing_value);
+
+    for (const auto &p : products) {
+      codes_handle *handle = codes_handle_clone(base);
+      if (handle == nullptr) {
+        metbuild_throw_exception("Could not clone the grib sample");
+      }
+      m_handles.push_back(handle);
+      set_long(handle, "discipline", p.discipline);
+      set_long(handle, "parameterCategory", p.category);
+      set_long(handle, "parameterNumber", p.number);
+      set_long(handle, "typeOfFirstFixedSurface", p.surface);
+      set_long(handle, "scaleFactorOfFirstFixedSurface", 0);
+      set_long(handle, "scaledValueOfFirstFixedSurface", p.height);
+    }
+  } catch (...) {
+    codes_handle_delete(base);
+    this->delete_handles();
+    throw;
+  }
+  codes_handle_delete(base);
+  m_products = products;
+  m_buffer.resize(this->grid()->ni() * this->grid()->nj());
+}
+
+void GribDomain::delete_handles() {
+  for (auto *handle : m_handles) codes_handle_delete(handle);
+  m_handles.clear();
+}
+
+void GribDomain::encode(const size_t handle, const long minutes,
+                        const MeteorologicalDataType *values) {
+  constexpr auto flag = MeteorologicalData<1>::flag_value();
+  const auto &p = m_products[handle];
+  for (size_t c = 0; c < m_buffer.size(); ++c) {
+    m_buffer[c] = values[c] == flag
+                      ? c_missing_value
+                      : static_cast<double>(values[c]) * p.scale + p.offset;
+  }
+
+  auto *h = m_handles[handle];
+  set_long(h, "forecastTime", minutes);
+  if (codes_set_double_array(h, "values", m_buffer.data(), m_buffer.size()) !=
+      GRIB_SUCCESS) {
+    metbuild_throw_exception("Could not encode the grib values");
+  }
+
+  const void *message = nullptr;
+  size_t size = 0;
+  if (codes_get_message(h, &message, &size) != GRIB_SUCCESS) {
+    metbuild_throw_exception("Could not encode the grib message");
+  }
+  m_sink.write(static_cast<const char *>(message),
+               static_cast<std::streamsize>(size));
+}
+
+int GribDomain::write(
+    const Date &date,
+    const MeteorologicalData<1, MeteorologicalDataType> &data) {
+  if (m_variable.empty()) {
+    metbuild_throw_exception("A scalar GRIB domain requires a variable");
+  }
+  if (m_handles.empty()) {
+    this->create_handles({GribDomain::product(m_variable)});
+  } else if (m_handles.size() != 1) {
+    metbuild_throw_exception("The record does not match the GRIB domain");
+  }
+  const long minutes = (date.toSeconds() - this->startDate().toSeconds()) / 60;
+  this->encode(0, minutes, data.parameter(0).data());
+  return 0;
+}
+
+int GribDomain::write(
+    const Date &date,
+    const MeteorologicalData<3, MeteorologicalDataType> &data) {
+  if (m_handles.empty()) {
+    this->create_handles({GribDomain::product("wind_u"),
+                          GribDomain::product("wind_v"),
+                          GribDomain::product("mslp")});
+  } else if (m_handles.size() != 3) {
+    metbuild_throw_exception("The record does not match the GRIB domain");
+  }
+  const long minutes = (date.toSeconds() - this->startDate().toSeconds()) / 60;
+  this->encode(0, minutes, data.parameter(0).data());
+  this->encode(1, minutes, data.parameter(1).data());
+  this->encode(2, minutes, data.parameter(2).data());
+  return 0;
+}
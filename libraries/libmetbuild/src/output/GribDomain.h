@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METGET_SRC_OUTPUT_GRIBDOMAIN_H_
+#define METGET_SRC_OUTPUT_GRIBDOMAIN_H_
+
+#include <string>
+#include <vector>
+
+#include "Date.h"
+#include "FileSink.h"
+#include "Grid.h"
+#include "MeteorologicalData.h"
+#include "OutputDomain.h"
+
+struct grib_handle;
+typedef struct grib_handle codes_handle;
+
+namespace MetBuild {
+
+/**
+ * @brief Domain of a GribOutput, one GRIB2 file of the records on a regular
+ * latitude/longitude grid
+ *
+ * A handle per variable is cloned once from the eccodes sample with the
+ * grid, product and packing keys set, so encoding a record only sets the
+ * forecast time and the values of each handle before its message is
+ * appended to the file. Cells at the flag value are written as missing
+ * through the bitmap
+ */
+class GribDomain : public OutputDomain {
+ public:
+  GribDomain(const MetBuild::Grid *grid, const MetBuild::Date &startDate,
+             const MetBuild::Date &endDate, unsigned time_step,
+             std::string filename, std::string variable,
+             std::string packing_type, long bits_per_value,
+             const MetBuild::ResumePoint *resume = nullptr);
+
+  ~GribDomain() override;
+
+  GribDomain(const GribDomain &) = delete;
+  GribDomain &operator=(const GribDomain &) = delete;
+
+  void open() override;
+  void close() override;
+
+  int write(
+      const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  int write(
+      const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  bool checkpoint(std::vector<uint64_t> *offsets) override;
+
+ private:
+  /**
+   * @brief GRIB2 product of a variable and the conversion of its values
+   * from the units of the library
+   */
+  struct Product {
+    long discipline;
+    long category;
+    long number;
+    long surface;
+    long height;
+    double scale;
+    double offset;
+  };
+
+  static Product product(const std::string &variable);
+
+  void create_handles(const std::vector<Product> &products);
+
+  void encode(size_t handle, long minutes,
+              const MeteorologicalDataType *values);
+
+  void delete_handles();
+
+  std::string m_filename;
+  std::string m_variable;
+  std::string m_packing_type;
+  long m_bits_per_value;
+  MetBuild::FileSink m_sink;
+  std::vector<codes_handle *> m_handles;
+  std::vector<Product> m_products;
+  std::vector<double> m_buffer;
+};
+
+}  // namespace MetBuild
+#endif  // METGET_SRC_OUTPUT_GRIBDOMAIN_H_
@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "GribOutput.h"
+
+#include <cassert>
+
+using namespace MetBuild;
+
+GribOutput::GribOutput(const Date &date_start, const Date &date_end,
+                       const unsigned time_step)
+    : OutputFile(date_start, date_end, time_step),
+      m_packing(COMPLEX),
+      m_bits_per_value(16) {}
+
+/**
+ * @brief Selects the packing of the domains added afterwards. CCSDS
+ * packing requires eccodes built with libaec
+ * @param packing packing of the values
+ */
+void GribOutput::set_packing(const PACKING packing) { m_packing = packing; }
+
+/**
+ * @brief Sets the bits each value is packed in for the domains added
+ * afterwards. 16 bits keep pressure to about 1 Pa and wind to about 1 mm/s
+ * over their usual ranges
+ * @param bits_per_value bits per value, 1 to 32, or zero for the default
+ * of the packing
+ */
+void GribOutput::set_precision(const unsigned bits_per_value) {
+  if (bits_per_value > 32) {
+    metbuild_throw_exception("GRIB values are packed in at most 32 bits");
+  }
+  m_bits_per_value = bits_per_value;
+}
+
+std::string GribOutput::packingType(const PACKING packing) {
+  switch (packing) {
+    case SIMPLE:
+      return "grid_simple";
+    case CCSDS:
+      return "grid_ccsds";
+    case COMPLEX:
+    default:
+      return "grid_complex_spatial_differencing";
+  }
+}
+
+/**
+ * @brief Adds a domain
+ * @param w output grid
+ * @param filenames GRIB2 file of the domain, followed for scalar records by
+ * the variable written, one of rain, humidity, temperature or ice
+ */
+void GribOutput::addDomain(const Grid &w,
+                           const std::vector<std::string> &filenames) {
+  if (filenames.empty() || filenames.size() > 2) {
+    metbuild_throw_exception(
+        "Must provide a filename and optional variable for GRIB format");
+  }
+  m_domains.push_back(std::make_unique<GribDomain>(
+      &w, this->startDate(), this->endDate(), this->timeStep(), filenames[0],
+      filenames.size() == 2 ? filenames[1] : std::string(),
+      GribOutput::packingType(m_packing), m_bits_per_value,
+      this->resume_point(m_domains.size())));
+}
+
+int GribOutput::write(
+    const Date &date, const size_t domain_index,
+    const MeteorologicalData<1, MeteorologicalDataType> &data) {
+  assert(domain_index < m_domains.size());
+  return this->write_domain(domain_index, date, data);
+}
+
+int GribOutput::write(
+    const Date &date, const size_t domain_index,
+    const MeteorologicalData<3, MeteorologicalDataType> &data) {
+  assert(domain_index < m_domains.size());
+  return this->write_domain(domain_index, date, data);
+}
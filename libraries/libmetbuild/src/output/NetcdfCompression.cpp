@@ -0,0 +1,257 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "NetcdfCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+#include "Logging.h"
+#include "Utilities.h"
+#include "netcdf.h"
+#if __has_include("netcdf_filter.h")
+#include "netcdf_filter.h"
+#endif
+#if __has_include("netcdf_meta.h")
+#include "netcdf_meta.h"
+#endif
+
+using namespace MetBuild;
+
+namespace {
+std::mutex s_defaults_mutex;
+NetcdfCompression s_defaults;
+
+size_t ceil_div(size_t a, size_t b) { return (a + b - 1) / b; }
+
+/**
+ * @brief Defines quantization on a single precision variable
+ *
+ * BitGroom and GranularBR keep decimal digits. BitRound keeps mantissa bits,
+ * so the digits are converted to the bits needed to resolve them
+ */
+void quantize_variable(int ncid, int varid,
+                       const NetcdfCompression::Quantize mode,
+                       const int digits) {
+#ifdef NC_QUANTIZE_BITGROOM
+  constexpr int max_float_digits = 7;
+  constexpr int max_float_bits = 23;
+  switch (mode) {
+    case NetcdfCompression::BITGROOM:
+      Utilities::ncCheck(nc_def_var_quantize(
+          ncid, varid, NC_QUANTIZE_BITGROOM,
+          std::min(digits, max_float_digits)));
+      return;
+    case NetcdfCompression::GRANULARBR:
+      Utilities::ncCheck(nc_def_var_quantize(
+          ncid, varid, NC_QUANTIZE_GRANULARBR,
+          std::min(digits, max_float_digits)));
+      return;
+    case NetcdfCompression::BITROUND: {
+      const auto bits =
+          static_cast<int>(std::ceil(digits * std::log2(10.0)));
+      Utilities::ncCheck(nc_def_var_quantize(
+          ncid, varid, NC_QUANTIZE_BITROUND, std::min(bits, max_float_bits)));
+      return;
+    }
+    default:
+      return;
+  }
+#else
+  Logging::warning(
+      "The netCDF library does not support quantization, writing full "
+      "precision values");
+#endif
+}
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param codec compression codec
+ * @param level codec level, 1-9 for deflate and 1-22 for zstd
+ * @param shuffle apply the byte shuffle filter before compressing
+ * @param significant_digits decimal digits kept when quantizing floating
+ * point fields, 0 to disable
+ */
+NetcdfCompression::NetcdfCompression(Codec codec, int level, bool shuffle,
+                                     int significant_digits)
+    : m_codec(codec),
+      m_level(level),
+      m_shuffle(shuffle),
+      m_significant_digits(std::max(significant_digits, 0)) {}
+
+/**
+ * @brief Policy used by output files that are not given one explicitly
+ */
+NetcdfCompression NetcdfCompression::defaults() {
+  std::lock_guard<std::mutex> lock(s_defaults_mutex);
+  return s_defaults;
+}
+
+void NetcdfCompression::setDefaults(const NetcdfCompression &compression) {
+  std::lock_guard<std::mutex> lock(s_defaults_mutex);
+  s_defaults = compression;
+}
+
+/**
+ * @brief Sets the compression filter, keeping the level and shuffle
+ * @param codec filter applied to the variables
+ */
+void NetcdfCompression::setCodec(const Codec codec) { m_codec = codec; }
+
+void NetcdfCompression::setMaxChunkCells(size_t cells) {
+  m_max_chunk_cells = std::max<size_t>(cells, 1);
+}
+
+/**
+ * @brief Sets the number of time steps in a field chunk and in the write
+ * buffer of each domain
+ *
+ * Buffering holds steps x variables full grids in memory per domain
+ *
+ * @param steps time steps per chunk, 1 to write every step as it arrives
+ */
+void NetcdfCompression::setTimeSteps(size_t steps) {
+  m_time_steps = std::max<size_t>(steps, 1);
+}
+
+/**
+ * @brief Sets the quantization applied to floating point fields
+ * @param mode quantization algorithm
+ * @param significant_digits decimal digits kept by variables without their
+ * own setting, 0 to disable
+ */
+void NetcdfCompression::setQuantize(Quantize mode, int significant_digits) {
+  m_quantize = mode;
+  m_significant_digits = std::max(significant_digits, 0);
+}
+
+/**
+ * @brief Overrides the significant digits kept for one variable
+ * @param variable netCDF variable name, i.e. PSFC or wind_u
+ * @param significant_digits decimal digits to keep, 0 to store the variable
+ * at full precision
+ */
+void NetcdfCompression::setVariableDigits(const std::string &variable,
+                                          int significant_digits) {
+  m_variable_digits[variable] = std::max(significant_digits, 0);
+}
+
+/**
+ * @brief Significant digits kept for a variable, 0 when it is not quantized
+ */
+int NetcdfCompression::significantDigits(const std::string &variable) const {
+  if (m_quantize == NO_QUANTIZE) return 0;
+  const auto it = m_variable_digits.find(variable);
+  return it == m_variable_digits.end() ? m_significant_digits : it->second;
+}
+
+/**
+ * @brief Chunk shape of one time slice of a field
+ * @param nj number of rows
+ * @param ni number of columns
+ * @return chunk rows and columns
+ */
+std::array<size_t, 2> NetcdfCompression::fieldChunk(size_t nj,
+                                                    size_t ni) const {
+  nj = std::max<size_t>(nj, 1);
+  ni = std::max<size_t>(ni, 1);
+  if (nj * ni <= m_max_chunk_cells) return {nj, ni};
+
+  //...Square tiles keep subset reads of either axis cheap. Tiles are then
+  // evened out so the last row and column of tiles are not slivers
+  const auto side = static_cast<size_t>(
+      std::sqrt(static_cast<double>(m_max_chunk_cells)));
+  const size_t ci = std::min(ni, std::max<size_t>(side, 1));
+  const size_t cj = std::min(nj, std::max<size_t>(m_max_chunk_cells / ci, 1));
+  return {ceil_div(nj, ceil_div(nj, cj)), ceil_div(ni, ceil_div(ni, ci))};
+}
+
+/**
+ * @brief Applies the policy to a (time, y, x) field
+ */
+void NetcdfCompression::applyField(int ncid, int varid, size_t nj, size_t ni,
+                                   bool floating_point) const {
+  const auto chunk = this->fieldChunk(nj, ni);
+  const size_t chunks[] = {m_time_steps, chunk[0], chunk[1]};
+  Utilities::ncCheck(nc_def_var_chunking(ncid, varid, NC_CHUNKED, chunks));
+  this->apply(ncid, varid, floating_point);
+}
+
+/**
+ * @brief Applies the policy to a time independent (y, x) variable
+ */
+void NetcdfCompression::applyGrid(int ncid, int varid, size_t nj,
+                                  size_t ni) const {
+  const auto chunk = this->fieldChunk(nj, ni);
+  const size_t chunks[] = {chunk[0], chunk[1]};
+  Utilities::ncCheck(nc_def_var_chunking(ncid, varid, NC_CHUNKED, chunks));
+  this->apply(ncid, varid, false);
+}
+
+/**
+ * @brief Applies the policy to a one dimensional variable, such as time or
+ * a coordinate column
+ * @param length dimension length, 0 for an unlimited dimension
+ */
+void NetcdfCompression::applySeries(int ncid, int varid,
+                                    size_t length) const {
+  const size_t chunks[] = {length == 0 ? c_series_chunk
+                                       : std::min(length, c_series_chunk)};
+  Utilities::ncCheck(nc_def_var_chunking(ncid, varid, NC_CHUNKED, chunks));
+  this->apply(ncid, varid, false);
+}
+
+void NetcdfCompression::apply(int ncid, int varid, bool floating_point) const {
+  if (floating_point && m_quantize != NO_QUANTIZE) {
+    std::string name(NC_MAX_NAME + 1, '\0');
+    Utilities::ncCheck(nc_inq_varname(ncid, varid, &name[0]));
+    name.resize(name.find('\0'));
+    const int digits = this->significantDigits(name);
+    if (digits > 0) quantize_variable(ncid, varid, m_quantize, digits);
+  }
+
+  if (m_codec == NONE) return;
+
+  if (m_codec == ZSTD) {
+#if defined(NC_HAS_ZSTD) && NC_HAS_ZSTD
+    if (m_shuffle) Utilities::ncCheck(nc_def_var_deflate(ncid, varid, 1, 0, 0));
+    //...The zstd filter is a runtime HDF5 plugin, so it may still be missing
+    if (nc_def_var_zstandard(ncid, varid, m_level) == NC_NOERR) return;
+    Logging::warning("The zstd filter is not available, using deflate");
+#else
+    Logging::warning(
+        "The netCDF library was built without zstd, using deflate");
+#endif
+  }
+
+  const int level = m_codec == ZSTD ? 2 : std::min(std::max(m_level, 1), 9);
+  Utilities::ncCheck(
+      nc_def_var_deflate(ncid, varid, m_shuffle ? 1 : 0, 1, level));
+}
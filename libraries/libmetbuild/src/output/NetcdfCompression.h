@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_NETCDFCOMPRESSION_H_
+#define METBUILD_SRC_OUTPUT_NETCDFCOMPRESSION_H_
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+namespace MetBuild {
+
+/**
+ * @brief Chunking and compression applied to the variables of the netCDF
+ * output formats
+ *
+ * Gridded fields are chunked one time slice at a time. A slice covers the
+ * full grid unless it holds more than max_chunk_cells values, in which case
+ * it is split into tiles of roughly that size. Setting timeSteps above one
+ * makes each chunk span that many time steps, and the writers then buffer
+ * the same number of steps in memory so every chunk is written once.
+ *
+ * Floating point fields may be quantized before compression, keeping a
+ * number of significant digits that can be set per variable. Codecs and
+ * quantization modes that the netCDF library was built without fall back to
+ * deflate and full precision, with a warning
+ */
+class NetcdfCompression {
+ public:
+  enum Codec { NONE, DEFLATE, ZSTD };
+
+  enum Quantize { NO_QUANTIZE, BITGROOM, GRANULARBR, BITROUND };
+
+  NetcdfCompression() = default;
+
+  NetcdfCompression(Codec codec, int level, bool shuffle = true,
+                    int significant_digits = 0);
+
+  static NetcdfCompression defaults();
+
+  static void setDefaults(const NetcdfCompression &compression);
+
+  Codec codec() const { return m_codec; }
+  int level() const { return m_level; }
+  bool shuffle() const { return m_shuffle; }
+  Quantize quantize() const { return m_quantize; }
+  int significantDigits() const { return m_significant_digits; }
+  int significantDigits(const std::string &variable) const;
+  size_t maxChunkCells() const { return m_max_chunk_cells; }
+  size_t timeSteps() const { return m_time_steps; }
+
+  void setCodec(Codec codec);
+
+  void setMaxChunkCells(size_t cells);
+
+  void setTimeSteps(size_t steps);
+
+  void setQuantize(Quantize mode, int significant_digits);
+
+  void setVariableDigits(const std::string &variable, int significant_digits);
+
+  std::array<size_t, 2> fieldChunk(size_t nj, size_t ni) const;
+
+  void applyField(int ncid, int varid, size_t nj, size_t ni,
+                  bool floating_point) const;
+
+  void applyGrid(int ncid, int varid, size_t nj, size_t ni) const;
+
+  void applySeries(int ncid, int varid, size_t length = 0) const;
+
+ private:
+  void apply(int ncid, int varid, bool floating_point) const;
+
+  Codec m_codec = DEFLATE;
+  int m_level = 2;
+  bool m_shuffle = true;
+  Quantize m_quantize = GRANULARBR;
+  int m_significant_digits = 0;
+  std::unordered_map<std::string, int> m_variable_digits;
+  size_t m_max_chunk_cells = c_default_max_chunk_cells;
+  size_t m_time_steps = 1;
+
+  static constexpr size_t c_default_max_chunk_cells = 1 << 20;
+  static constexpr size_t c_series_chunk = 1024;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_NETCDFCOMPRESSION_H_
@@ -0,0 +1,160 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "NetcdfParallel.h"
+
+#include "BuildRequest.h"
+#include "Logging.h"
+#include "Utilities.h"
+#include "netcdf.h"
+
+#ifdef METBUILD_PARALLEL_NETCDF
+#include "netcdf_par.h"
+#endif
+
+using namespace MetBuild;
+
+#ifdef METBUILD_PARALLEL_NETCDF
+/**
+ * @brief Constructor
+ * @param comm communicator of the ranks sharing the file
+ * @param start_date first output time of the whole request
+ * @param end_date last output time of the whole request
+ * @param time_step output time step in seconds
+ */
+NetcdfParallel::NetcdfParallel(MPI_Comm comm, const MetBuild::Date &start_date,
+                               const MetBuild::Date &end_date,
+                               const unsigned time_step)
+    : m_comm(comm),
+      m_rank(0),
+      m_size(1),
+      m_start_date(start_date),
+      m_end_date(end_date),
+      m_time_step(time_step) {
+  MPI_Comm_rank(m_comm, &m_rank);
+  MPI_Comm_size(m_comm, &m_size);
+  if (m_size > static_cast<int>(this->records())) {
+    metbuild_throw_exception("More ranks than records in the request");
+  }
+}
+#endif
+
+/**
+ * @brief First output time written by this rank
+ */
+Date NetcdfParallel::shardStart() const {
+  return BuildRequest::shard_start(m_start_date, m_end_date,
+                                   static_cast<int>(m_time_step), m_rank,
+                                   m_size);
+}
+
+/**
+ * @brief Last output time written by this rank
+ */
+Date NetcdfParallel::shardEnd() const {
+  return BuildRequest::shard_end(m_start_date, m_end_date,
+                                 static_cast<int>(m_time_step), m_rank, m_size);
+}
+
+/**
+ * @brief Length of the time dimension of the shared file
+ */
+size_t NetcdfParallel::records() const {
+  return static_cast<size_t>(
+      (m_end_date.toSeconds() - m_start_date.toSeconds()) / m_time_step + 1);
+}
+
+/**
+ * @brief Index of a date along the time dimension of the shared file
+ * @param date output time
+ * @return record index
+ */
+size_t NetcdfParallel::record(const MetBuild::Date &date) const {
+  const auto offset = date.toSeconds() - m_start_date.toSeconds();
+  if (offset < 0 || offset % m_time_step != 0 ||
+      static_cast<size_t>(offset / m_time_step) >= this->records()) {
+    metbuild_throw_exception("Date " + date.toString() +
+                             " is not on the time axis of the shared file");
+  }
+  return static_cast<size_t>(offset / m_time_step);
+}
+
+/**
+ * @brief Creates the shared file, collectively over the communicator
+ * @param filename file to create
+ * @return netCDF id
+ */
+int NetcdfParallel::create(const std::string &filename) const {
+  int ncid = 0;
+#ifdef METBUILD_PARALLEL_NETCDF
+  Utilities::ncCheck(nc_create_par(filename.c_str(), NC_NETCDF4 | NC_CLOBBER,
+                                   m_comm, MPI_INFO_NULL, &ncid));
+#else
+  metbuild_throw_exception("Library built without parallel netCDF: " +
+                           filename);
+#endif
+  return ncid;
+}
+
+/**
+ * @brief Lets each rank write a variable on its own
+ */
+void NetcdfParallel::independent(const int ncid, const int varid) const {
+#ifdef METBUILD_PARALLEL_NETCDF
+  Utilities::ncCheck(nc_var_par_access(ncid, varid, NC_INDEPENDENT));
+#else
+  (void)ncid;
+  (void)varid;
+#endif
+}
+
+/**
+ * @brief Makes every write to a variable collective, so all ranks must make
+ * the same writes
+ */
+void NetcdfParallel::collective(const int ncid, const int varid) const {
+#ifdef METBUILD_PARALLEL_NETCDF
+  Utilities::ncCheck(nc_var_par_access(ncid, varid, NC_COLLECTIVE));
+#else
+  (void)ncid;
+  (void)varid;
+#endif
+}
+
+/**
+ * @brief Compression policy for the record variables of the shared file,
+ * keeping the chunking and quantization but no compression filter
+ * @param compression policy used for serial files
+ * @return policy without filters
+ */
+NetcdfCompression NetcdfParallel::unfiltered(
+    const NetcdfCompression &compression) const {
+  auto c = compression;
+  c.setCodec(NetcdfCompression::NONE);
+  return c;
+}
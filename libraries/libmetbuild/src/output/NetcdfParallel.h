@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_NETCDFPARALLEL_H_
+#define METBUILD_SRC_OUTPUT_NETCDFPARALLEL_H_
+
+#include <cstddef>
+#include <string>
+
+#include "Date.h"
+#include "NetcdfCompression.h"
+
+#ifdef METBUILD_PARALLEL_NETCDF
+#include <mpi.h>
+#endif
+
+namespace MetBuild {
+
+/**
+ * @brief Ranks of an MPI communicator writing one request into a single
+ * shared netCDF file
+ *
+ * Each rank builds the time shard of the request given by its rank, see
+ * BuildRequest::shard_start, and writes its records straight into the
+ * shared file, which is created collectively with the time dimension sized
+ * to the whole request. Definitions and coordinates are written
+ * collectively. Records are written independently, since the domains of a
+ * rank write as their pipelines finish and the ranks do not issue them in
+ * the same order, and HDF5 only applies filters to collective writes, so
+ * the record variables are written without compression
+ *
+ * Only available when the library is built with
+ * METBUILD_ENABLE_PARALLEL_NETCDF against an MPI enabled netCDF
+ */
+class NetcdfParallel {
+ public:
+  NetcdfParallel() = delete;
+
+#ifdef METBUILD_PARALLEL_NETCDF
+  NetcdfParallel(MPI_Comm comm, const MetBuild::Date &start_date,
+                 const MetBuild::Date &end_date, unsigned time_step);
+#endif
+
+  static constexpr bool available() {
+#ifdef METBUILD_PARALLEL_NETCDF
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  int rank() const { return m_rank; }
+  int size() const { return m_size; }
+  unsigned timeStep() const { return m_time_step; }
+
+  const MetBuild::Date &startDate() const { return m_start_date; }
+
+  MetBuild::Date shardStart() const;
+
+  MetBuild::Date shardEnd() const;
+
+  size_t records() const;
+
+  size_t record(const MetBuild::Date &date) const;
+
+  int create(const std::string &filename) const;
+
+  void independent(int ncid, int varid) const;
+
+  void collective(int ncid, int varid) const;
+
+  NetcdfCompression unfiltered(const NetcdfCompression &compression) const;
+
+ private:
+#ifdef METBUILD_PARALLEL_NETCDF
+  MPI_Comm m_comm;
+#endif
+  int m_rank;
+  int m_size;
+  MetBuild::Date m_start_date;
+  MetBuild::Date m_end_date;
+  unsigned m_time_step;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_NETCDFPARALLEL_H_
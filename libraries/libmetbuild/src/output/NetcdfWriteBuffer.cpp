@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "NetcdfWriteBuffer.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "Instrumentation.h"
+#include "Logging.h"
+#include "Utilities.h"
+#include "netcdf.h"
+
+using namespace MetBuild;
+
+namespace {
+int put_values(int ncid, int varid, const size_t *start, const size_t *count,
+               const float *values) {
+  return nc_put_vara_float(ncid, varid, start, count, values);
+}
+
+int put_values(int ncid, int varid, const size_t *start, const size_t *count,
+               const double *values) {
+  return nc_put_vara_double(ncid, varid, start, count, values);
+}
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param ncid netCDF file or group id holding the variables
+ * @param varid_time id of the time variable
+ * @param varids ids of the (time, y, x) fields, in the order they are passed
+ * to append
+ * @param nj number of rows
+ * @param ni number of columns
+ * @param steps number of time steps collected before writing
+ */
+template <typename T>
+NetcdfWriteBuffer<T>::NetcdfWriteBuffer(int ncid, int varid_time,
+                                        std::vector<int> varids, size_t nj,
+                                        size_t ni, size_t steps)
+    : m_ncid(ncid),
+      m_varid_time(varid_time),
+      m_varids(std::move(varids)),
+      m_nj(nj),
+      m_ni(ni),
+      m_steps(std::max<size_t>(steps, 1)),
+      m_start(0),
+      m_count(0),
+      m_fields(0) {
+  if (m_steps > 1) {
+    m_times.resize(m_steps);
+    m_values.resize(m_varids.size());
+    for (auto &v : m_values) v.resize(m_steps * m_nj * m_ni);
+  }
+}
+
+template <typename T>
+NetcdfWriteBuffer<T>::~NetcdfWriteBuffer() {
+  try {
+    this->flush();
+  } catch (const std::exception &e) {
+    Logging::logError(std::string("Error writing buffered netCDF records: ") +
+                      e.what());
+  }
+}
+
+/**
+ * @brief Adds one time step
+ *
+ * Pending steps are written first when time_index does not follow them or
+ * the number of fields changes, so rewritten or skipped records still land
+ * in the right place
+ *
+ * @param time_index index of the step along the time dimension
+ * @param time value written to the time variable
+ * @param fields one nj x ni array per variable
+ * @param n_fields number of arrays, at most the number of variables
+ */
+template <typename T>
+void NetcdfWriteBuffer<T>::append(size_t time_index, double time,
+                                  const Span<const T> *fields,
+                                  size_t n_fields) {
+  n_fields = std::min(n_fields, m_varids.size());
+  if (m_steps == 1) {
+    this->put(time_index, 1, &time, fields, n_fields);
+    return;
+  }
+
+  if (m_count > 0 && time_index != m_start + m_count) this->flush();
+  if (m_count > 0 && n_fields != m_fields) this->flush();
+  if (m_count == 0) {
+    m_start = time_index;
+    m_fields = n_fields;
+  }
+
+  const size_t cells = m_nj * m_ni;
+  m_times[m_count] = time;
+  for (size_t v = 0; v < n_fields; ++v) {
+    std::copy_n(fields[v].data(), cells, m_values[v].data() + m_count * cells);
+  }
+  m_count++;
+
+  if (m_count == m_steps) this->flush();
+}
+
+/**
+ * @brief Writes the pending time steps
+ */
+template <typename T>
+void NetcdfWriteBuffer<T>::flush() {
+  if (m_count == 0) return;
+  const size_t count = m_count;
+  m_count = 0;
+
+  std::vector<Span<const T>> fields;
+  fields.reserve(m_fields);
+  for (size_t v = 0; v < m_fields; ++v) {
+    fields.emplace_back(m_values[v].data(), count * m_nj * m_ni);
+  }
+  this->put(m_start, count, m_times.data(), fields.data(), fields.size());
+}
+
+template <typename T>
+void NetcdfWriteBuffer<T>::put(size_t start, size_t count, const double *time,
+                               const Span<const T> *fields,
+                               size_t n_fields) const {
+  const size_t start_array[] = {start, 0, 0};
+  const size_t count_array[] = {count, m_nj, m_ni};
+  Instrumentation::ScopedTimer timer(Instrumentation::NETCDF_WRITE,
+                                     n_fields * count * m_nj * m_ni);
+  Utilities::ncCheck(
+      nc_put_vara_double(m_ncid, m_varid_time, &start, &count, time));
+  for (size_t v = 0; v < n_fields; ++v) {
+    Utilities::ncCheck(put_values(m_ncid, m_varids[v], start_array,
+                                  count_array, fields[v].data()));
+  }
+}
+
+template class MetBuild::NetcdfWriteBuffer<float>;
+template class MetBuild::NetcdfWriteBuffer<double>;
@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_NETCDFWRITEBUFFER_H_
+#define METBUILD_SRC_OUTPUT_NETCDFWRITEBUFFER_H_
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "Span.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Collects consecutive time steps of (time, y, x) fields and writes
+ * them to netCDF as one hyperslab per variable
+ *
+ * With the time chunk of the variables set to the same number of steps, each
+ * flush covers whole chunks, so HDF5 compresses and writes every chunk once
+ * instead of rewriting it at each time step. A buffer of one step writes
+ * straight from the caller's arrays without copying
+ */
+template <typename T>
+class NetcdfWriteBuffer {
+ public:
+  NetcdfWriteBuffer(int ncid, int varid_time, std::vector<int> varids,
+                    size_t nj, size_t ni, size_t steps);
+
+  ~NetcdfWriteBuffer();
+
+  NetcdfWriteBuffer(const NetcdfWriteBuffer &) = delete;
+  NetcdfWriteBuffer &operator=(const NetcdfWriteBuffer &) = delete;
+
+  template <size_t N>
+  void append(size_t time_index, double time,
+              const std::array<MetBuild::Span<const T>, N> &fields) {
+    this->append(time_index, time, fields.data(), N);
+  }
+
+  void append(size_t time_index, double time,
+              const MetBuild::Span<const T> *fields, size_t n_fields);
+
+  void flush();
+
+  size_t steps() const { return m_steps; }
+
+ private:
+  void put(size_t start, size_t count, const double *time,
+           const MetBuild::Span<const T> *fields, size_t n_fields) const;
+
+  const int m_ncid;
+  const int m_varid_time;
+  const std::vector<int> m_varids;
+  const size_t m_nj;
+  const size_t m_ni;
+  const size_t m_steps;
+  size_t m_start;
+  size_t m_count;
+  size_t m_fields;
+  std::vector<double> m_times;
+  std::vector<std::vector<T>> m_values;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_NETCDFWRITEBUFFER_H_
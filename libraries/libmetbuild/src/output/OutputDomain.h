@@ -30,34 +30,30 @@
 #define METGET_SRC_OUTPUTDOMAIN_H_
 
 #include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
 
+#include "Checkpoint.h"
 #include "Date.h"
+#include "FileSink.h"
 #include "Grid.h"
 #include "Logging.h"
 
-namespace boost {
-namespace iostreams {
-
-struct public_;
-
-template <typename Mode, typename Ch, typename Tr, typename Alloc,
-          typename Access>
-class filtering_streambuf;
-
-class output;
-}  // namespace iostreams
-}  // namespace boost
-
 namespace MetBuild {
 class OutputDomain {
  public:
   OutputDomain(const MetBuild::Grid *grid, const MetBuild::Date &startDate,
-               const MetBuild::Date &endDate, const unsigned timestep)
+               const MetBuild::Date &endDate, const unsigned timestep,
+               const MetBuild::ResumePoint *resume = nullptr)
       : m_grid(grid),
         m_startDate(startDate),
         m_endDate(endDate),
         m_timestep(timestep),
-        m_isOpen(false) {}
+        m_isOpen(false) {
+    if (resume != nullptr) m_resume = *resume;
+  }
 
   virtual ~OutputDomain() = default;
 
@@ -91,9 +87,53 @@ class OutputDomain {
 
   std::vector<std::string> filenames() const { return m_filenames; }
 
+  /**
+   * @brief Ends the files of the domain on a boundary after the last record
+   * written and makes them durable, so the domain can be resumed from there
+   * @param offsets set to the length of each file, in the order of filenames
+   * @return false when the format cannot be resumed
+   */
+  virtual bool checkpoint(std::vector<uint64_t> * /*offsets*/) {
+    return false;
+  }
+
  protected:
   void set_open(bool status) { m_isOpen = status; }
 
+  /**
+   * @brief Point the domain resumes from when it is first opened, or nullptr
+   * when its files are written from the start
+   */
+  const MetBuild::ResumePoint *resume_point() const {
+    return m_resume ? &*m_resume : nullptr;
+  }
+
+  //...Opening the domain again later starts its files over
+  void clear_resume() { m_resume.reset(); }
+
+  /**
+   * @brief Opens one of the files of the domain, either from the start or
+   * at its length in the resume point
+   * @param sink stream opened
+   * @param filename file name
+   * @param index position of the file in filenames
+   */
+  void open_sink(MetBuild::FileSink *sink, const std::string &filename,
+                 size_t index) const {
+    if (m_resume) {
+      if (index >= m_resume->offsets.size()) {
+        metbuild_throw_exception("The checkpoint does not match the files of "
+                                 "the domain");
+      }
+      sink->resume(filename, m_resume->offsets[index]);
+    } else {
+      sink->open(filename);
+    }
+    if (!sink->is_open()) {
+      metbuild_throw_exception("Could not open output file " + filename);
+    }
+  }
+
   std::string guessGridUnits() {
     auto ul = this->grid()->top_left();
     auto ur = this->grid()->top_right();
@@ -117,6 +157,7 @@ class OutputDomain {
   std::vector<std::string> m_filenames;
 
  private:
+  std::optional<MetBuild::ResumePoint> m_resume;
   const MetBuild::Grid *m_grid;
   const MetBuild::Date m_startDate;
   const MetBuild::Date m_endDate;
@@ -0,0 +1,157 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "OutputFanout.h"
+
+#include <algorithm>
+
+using namespace MetBuild;
+
+OutputFanout::OutputFanout(const Date &date_start, const Date &date_end,
+                           unsigned time_step)
+    : OutputFile(date_start, date_end, time_step) {}
+
+/**
+ * @brief Adds an output written from the records of the fan-out
+ * @param member output, with its domains added, spanning part of the fan-out
+ * at the same time step and on its steps
+ */
+void OutputFanout::add(OutputFile *member) {
+  if (member == nullptr) {
+    metbuild_throw_exception("Invalid output added to the fan-out");
+  }
+  if (member->timeStep() != this->timeStep()) {
+    metbuild_throw_exception(
+        "The outputs of a fan-out must have the same time step");
+  }
+  if (member->startDate() < this->startDate() ||
+      this->endDate() < member->endDate() ||
+      (member->startDate().toSeconds() - this->startDate().toSeconds()) %
+              this->timeStep() !=
+          0) {
+    metbuild_throw_exception(
+        "The output is not on the steps of the fan-out span");
+  }
+  if (!m_members.empty() &&
+      member->domain_count() != m_members.front()->domain_count()) {
+    metbuild_throw_exception(
+        "The outputs of a fan-out must have the same domains");
+  }
+  m_members.push_back(member);
+}
+
+/**
+ * @brief Number of domains of the fan-out, which each member has
+ */
+size_t OutputFanout::size() const {
+  return m_members.empty() ? 0 : m_members.front()->domain_count();
+}
+
+/**
+ * @brief Number of outputs written from the records
+ */
+size_t OutputFanout::members() const { return m_members.size(); }
+
+void OutputFanout::addDomain(const Grid &,
+                             const std::vector<std::string> &) {
+  metbuild_throw_exception(
+      "Domains are added to the members of an output fan-out");
+}
+
+template <unsigned N>
+int OutputFanout::write_members(
+    const Date &date, size_t domain_index,
+    const MeteorologicalData<N, MeteorologicalDataType> &data) {
+  if (domain_index >= this->size()) {
+    metbuild_throw_exception("Domain " + std::to_string(domain_index) +
+                             " is not in the output fan-out");
+  }
+  int status = 0;
+  for (auto *m : m_members) {
+    if (date < m->startDate() || m->endDate() < date) continue;
+    status = std::max(status, m->write(date, domain_index, data));
+  }
+  return status;
+}
+
+int OutputFanout::write(
+    const Date &date, size_t domain_index,
+    const MeteorologicalData<1, MeteorologicalDataType> &data) {
+  return this->write_members(date, domain_index, data);
+}
+
+int OutputFanout::write(
+    const Date &date, size_t domain_index,
+    const MeteorologicalData<3, MeteorologicalDataType> &data) {
+  return this->write_members(date, domain_index, data);
+}
+
+void OutputFanout::set_async(bool value, size_t queue_depth) {
+  for (auto *m : m_members) m->set_async(value, queue_depth);
+}
+
+void OutputFanout::flush() {
+  for (auto *m : m_members) m->flush();
+}
+
+void OutputFanout::discard() {
+  for (auto *m : m_members) m->discard();
+}
+
+/**
+ * @brief Time up to which every member has been published
+ */
+Date OutputFanout::published_through() const {
+  if (m_members.empty()) return this->startDate() - this->timeStep();
+  auto date = m_members.front()->published_through();
+  for (const auto *m : m_members) {
+    date = std::min(date, m->published_through());
+  }
+  return date;
+}
+
+/**
+ * @brief First date that any member still has to write
+ */
+Date OutputFanout::resume_date() const {
+  if (m_members.empty()) return this->startDate();
+  auto date = m_members.front()->resume_date();
+  for (const auto *m : m_members) {
+    date = std::min(date, m->resume_date());
+  }
+  return date;
+}
+
+std::vector<std::string> OutputFanout::filenames() const {
+  std::vector<std::string> files;
+  for (const auto *m : m_members) {
+    const auto f = m->filenames();
+    files.insert(files.end(), f.begin(), f.end());
+  }
+  return files;
+}
@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_OUTPUTFANOUT_H_
+#define METBUILD_SRC_OUTPUT_OUTPUTFANOUT_H_
+
+#include <string>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "OutputFile.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Output handing every record of a build to several outputs of the
+ * same domains, so that one interpolation produces the request in more than
+ * one format, such as OWI ASCII alongside netCDF
+ *
+ * Every member has the same domains, added in the same order, and domain i
+ * of the fan-out is domain i of each member. A record is only handed to a
+ * member when its time is within that member's span. With asynchronous
+ * writing each member formats and compresses its records on its own writer
+ * threads, so the formats are written in parallel. The members are not
+ * owned by the fan-out and must outlive it
+ */
+class OutputFanout : public OutputFile {
+ public:
+  OutputFanout(const MetBuild::Date &date_start,
+               const MetBuild::Date &date_end, unsigned time_step);
+
+  void add(OutputFile *member);
+
+  NODISCARD size_t size() const;
+
+  NODISCARD size_t members() const;
+
+  void addDomain(const MetBuild::Grid &w,
+                 const std::vector<std::string> &filenames) override;
+
+  int write(
+      const MetBuild::Date &date, size_t domain_index,
+      const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  int write(
+      const MetBuild::Date &date, size_t domain_index,
+      const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  void set_async(bool value, size_t queue_depth = 2) override;
+
+  void flush() override;
+
+  void discard() override;
+
+  NODISCARD MetBuild::Date published_through() const override;
+
+  NODISCARD MetBuild::Date resume_date() const override;
+
+  NODISCARD std::vector<std::string> filenames() const override;
+
+ private:
+  template <unsigned N>
+  int write_members(
+      const MetBuild::Date &date, size_t domain_index,
+      const MetBuild::MeteorologicalData<N, MetBuild::MeteorologicalDataType>
+          &data);
+
+  std::vector<OutputFile *> m_members;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_OUTPUTFANOUT_H_
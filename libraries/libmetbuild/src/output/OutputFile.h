@@ -29,13 +29,21 @@
 #ifndef METGET_SRC_OUTPUTFILE_H_
 #define METGET_SRC_OUTPUTFILE_H_
 
+#include <algorithm>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
+#include "AsyncWriter.h"
+#include "Checkpoint.h"
 #include "Date.h"
+#include "ExecutionPolicy.h"
 #include "Logging.h"
 #include "MeteorologicalData.h"
 #include "OutputDomain.h"
+#include "PublicationManifest.h"
 
 namespace MetBuild {
 
@@ -70,10 +78,157 @@ class OutputFile {
 
   unsigned timeStep() const { return m_time_step; }
 
+  /**
+   * @brief Number of domains added to the output so far
+   */
+  size_t domain_count() const { return m_domains.size(); }
+
   MetBuild::Date startDate() const { return m_start_date; }
 
   MetBuild::Date endDate() const { return m_end_date; }
 
+  /**
+   * @brief Hands records to a writer thread per domain instead of writing
+   * them in the calling thread. flush must be called before the output is
+   * used so that write errors are reported
+   * @param value true to write asynchronously
+   * @param queue_depth number of records queued per domain
+   */
+  virtual void set_async(bool value, size_t queue_depth = 2) {
+    this->flush();
+    m_writers.clear();
+    m_async = value;
+    m_queue_depth = queue_depth;
+  }
+
+  bool is_async() const { return m_async; }
+
+  /**
+   * @brief Takes the writer settings of an execution policy, writing
+   * asynchronously unless its output queue depth is zero
+   * @param policy execution policy
+   */
+  void set_execution_policy(const MetBuild::ExecutionPolicy &policy) {
+    this->set_async(policy.output_queue_depth() != 0,
+                    policy.output_queue_depth());
+  }
+
+  /**
+   * @brief Waits for every queued record to be written and rethrows the first
+   * error raised by a writer thread
+   */
+  virtual void flush() {
+    for (auto &w : m_writers) {
+      if (w) w->flush();
+    }
+  }
+
+  /**
+   * @brief Drops the records still queued for the writer threads and waits
+   * for the ones being written, so that every file ends on a whole record.
+   * Used when a build is cancelled. Records written synchronously are
+   * already complete
+   */
+  virtual void discard() {
+    std::lock_guard<std::mutex> lock(m_writers_mutex);
+    for (auto &w : m_writers) {
+      if (w) w->discard();
+    }
+  }
+
+  /**
+   * @brief Saves the progress of the domains to a checkpoint file while the
+   * output is written, so that an interrupted build can be resumed
+   * @param filename checkpoint file, replaced each time it is written
+   * @param interval number of records written by a domain between
+   * checkpoints of that domain
+   */
+  void set_checkpoint(const std::string &filename, size_t interval = 24) {
+    m_checkpoint_file = filename;
+    m_checkpoint_interval = std::max<size_t>(interval, 1);
+  }
+
+  /**
+   * @brief Resumes the output from a checkpoint. Must be called before the
+   * domains are added. Domains found in the checkpoint keep their files up
+   * to the last record checkpointed and records up to that date are skipped
+   * @param filename checkpoint file
+   * @return true if the checkpoint holds at least one domain
+   */
+  bool resume(const std::string &filename) {
+    if (!m_domains.empty()) {
+      metbuild_throw_exception(
+          "An output must be resumed before its domains are added");
+    }
+    m_resumed = MetBuild::Checkpoint::read(filename);
+    m_checkpoint = m_resumed;
+    for (size_t i = 0; i < m_resumed.size(); ++i) {
+      if (m_resumed.has(i)) return true;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Publishes the output in time chunks while it is written, so the
+   * first records can be used before the build finishes. Every interval
+   * records a domain writes, its files are ended on the record boundary and
+   * made durable as for a checkpoint, and the manifest is rewritten with
+   * the length of each file up to that record. Only formats which can be
+   * checkpointed are published
+   * @param manifest manifest file, replaced each time it is written
+   * @param interval number of records written by a domain between
+   * publications of that domain
+   */
+  void set_publication(const std::string &manifest, size_t interval = 24) {
+    std::lock_guard<std::mutex> lock(m_checkpoint_mutex);
+    m_manifest_file = manifest;
+    m_publish_interval = std::max<size_t>(interval, 1);
+  }
+
+  /**
+   * @brief Sets the function called with the time every domain has been
+   * published through each time it advances. It runs on the thread writing
+   * the domain which completed the chunk
+   * @param callback function called, or nullptr to stop
+   */
+  void set_publish_callback(
+      std::function<void(const MetBuild::Date &)> callback) {
+    std::lock_guard<std::mutex> lock(m_checkpoint_mutex);
+    m_publish_callback = std::move(callback);
+  }
+
+  /**
+   * @brief Time up to which every domain has been published, or a step
+   * before the start date until each domain has been published once
+   */
+  virtual MetBuild::Date published_through() const {
+    std::lock_guard<std::mutex> lock(m_checkpoint_mutex);
+    const auto date = m_published.through(m_domains.size());
+    return date ? *date : m_start_date - m_time_step;
+  }
+
+  /**
+   * @brief Also hands every record written to a second output, such as an
+   * EnvelopeOutput reducing the series as it is built. The side output must
+   * have its domains added in the same order and outlive the writes. A
+   * resumed build only hands it the records written after the checkpoint
+   * @param output side output, or nullptr to stop
+   */
+  void set_side_output(OutputFile *output) { m_side_output = output; }
+
+  /**
+   * @brief First date that any domain still has to write
+   */
+  virtual MetBuild::Date resume_date() const {
+    if (m_domains.empty()) return m_start_date;
+    MetBuild::Date date = m_end_date + m_time_step;
+    for (size_t i = 0; i < m_domains.size(); ++i) {
+      if (!m_resumed.has(i)) return m_start_date;
+      date = std::min(date, m_resumed.domain(i).time + m_time_step);
+    }
+    return date;
+  }
+
   virtual std::vector<std::string> filenames() const {
     std::vector<std::string> files;
     for(const auto &d : m_domains) {
@@ -87,12 +242,170 @@ class OutputFile {
       
 
  protected:
+  template <unsigned N>
+  int write_domain(
+      size_t domain_index, const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<N, MetBuild::MeteorologicalDataType>
+          &data) {
+    if (m_side_output) m_side_output->write(date, domain_index, data);
+    //...Records a resumed domain already holds are not written again
+    if (m_resumed.has(domain_index) &&
+        date <= m_resumed.domain(domain_index).time) {
+      return 0;
+    }
+    //...Domains may be written from several threads at once, one per domain
+    if (!m_async) {
+      std::unique_lock<std::mutex> lock(library_mutex(), std::defer_lock);
+      if (this->serialize_domains()) lock.lock();
+      const auto status = m_domains[domain_index]->write(date, data);
+      this->record_written(domain_index, date);
+      return status;
+    }
+    MetBuild::AsyncWriter *writer;
+    {
+      std::lock_guard<std::mutex> lock(m_writers_mutex);
+      if (m_writers.size() < m_domains.size()) {
+        m_writers.resize(m_domains.size());
+      }
+      auto &w = m_writers[domain_index];
+      if (!w) {
+        w = std::make_unique<MetBuild::AsyncWriter>(
+            m_domains[domain_index].get(), m_queue_depth,
+            this->serialize_domains() ? &library_mutex() : nullptr,
+            [this, domain_index](const MetBuild::Date &d) {
+              this->record_written(domain_index, d);
+            });
+      }
+      writer = w.get();
+    }
+    writer->write(date, data);
+    return 0;
+  }
+
+  /**
+   * @brief Drains and stops the writer threads. Derived classes owning
+   * resources used by their domains call this from their destructor
+   */
+  void stop_writers() { m_writers.clear(); }
+
+  /**
+   * @brief Whether the domains share a library that is not thread safe, in
+   * which case the writer threads of this file take turns
+   */
+  virtual bool serialize_domains() const { return false; }
+
+  /**
+   * @brief Mutex the domains of every output which serializes them take
+   * turns on, so that outputs written in the same build, such as the members
+   * of a group or fan-out, do not use the library at the same time
+   */
+  static std::mutex &library_mutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  /**
+   * @brief Point a domain added to a resumed output starts from, or nullptr
+   * when it is written from the start
+   */
+  const MetBuild::ResumePoint *resume_point(size_t domain_index) const {
+    return m_resumed.has(domain_index) ? &m_resumed.domain(domain_index)
+                                       : nullptr;
+  }
+
+  /**
+   * @brief Counts a record written by a domain and checkpoints the domain
+   * every m_checkpoint_interval records and publishes it every
+   * m_publish_interval records. Called on the thread that writes the
+   * domain, right after the record
+   */
+  void record_written(size_t domain_index, const MetBuild::Date &date) {
+    bool checkpoint_due = false;
+    bool publish_due = false;
+    {
+      std::lock_guard<std::mutex> lock(m_checkpoint_mutex);
+      if (m_checkpoint_file.empty() && m_manifest_file.empty()) return;
+      if (m_records.size() < m_domains.size()) {
+        m_records.resize(m_domains.size(), 0);
+        m_publish_records.resize(m_domains.size(), 0);
+      }
+      if (!m_checkpoint_file.empty() &&
+          ++m_records[domain_index] >= m_checkpoint_interval) {
+        m_records[domain_index] = 0;
+        checkpoint_due = true;
+      }
+      if (!m_manifest_file.empty() &&
+          ++m_publish_records[domain_index] >= m_publish_interval) {
+        m_publish_records[domain_index] = 0;
+        publish_due = true;
+      }
+      if (!checkpoint_due && !publish_due) return;
+    }
+
+    MetBuild::ResumePoint point{date, {}};
+    if (!m_domains[domain_index]->checkpoint(&point.offsets)) {
+      std::lock_guard<std::mutex> lock(m_checkpoint_mutex);
+      if (!m_checkpoint_warned) {
+        MetBuild::Logging::warning(
+            "This output format cannot be resumed or published");
+        m_checkpoint_warned = true;
+      }
+      return;
+    }
+
+    std::function<void(const MetBuild::Date &)> callback;
+    MetBuild::Date through;
+    {
+      std::lock_guard<std::mutex> lock(m_checkpoint_mutex);
+      if (checkpoint_due) {
+        m_checkpoint.set(domain_index, point);
+        m_checkpoint.write(m_checkpoint_file);
+      }
+      if (!publish_due) return;
+      const auto before = m_published.through(m_domains.size());
+      m_published.set(domain_index, m_domains[domain_index]->filenames(),
+                      point);
+      m_published.write(m_manifest_file, m_domains.size());
+      const auto after = m_published.through(m_domains.size());
+      if (!after || (before && !(*before < *after))) return;
+      callback = m_publish_callback;
+      through = *after;
+    }
+    if (callback) callback(through);
+  }
+
+  void flush_domain(size_t domain_index) {
+    if (domain_index < m_writers.size() && m_writers[domain_index]) {
+      m_writers[domain_index]->flush();
+    }
+  }
+
   std::vector<std::unique_ptr<MetBuild::OutputDomain>> m_domains;
 
+  //...Declared after the domains so the writers stop before the domains are
+  // destroyed
+  std::vector<std::unique_ptr<MetBuild::AsyncWriter>> m_writers;
+  std::mutex m_writers_mutex;
+
  private:
   unsigned m_time_step;
   MetBuild::Date m_start_date;
   MetBuild::Date m_end_date;
+  bool m_async = false;
+  size_t m_queue_depth = 2;
+  OutputFile *m_side_output = nullptr;
+  std::string m_checkpoint_file;
+  size_t m_checkpoint_interval = 24;
+  MetBuild::Checkpoint m_resumed;
+  MetBuild::Checkpoint m_checkpoint;
+  std::vector<size_t> m_records;
+  std::string m_manifest_file;
+  size_t m_publish_interval = 24;
+  std::function<void(const MetBuild::Date &)> m_publish_callback;
+  MetBuild::PublicationManifest m_published;
+  std::vector<size_t> m_publish_records;
+  mutable std::mutex m_checkpoint_mutex;
+  bool m_checkpoint_warned = false;
 };
 }  // namespace MetBuild
 
@@ -0,0 +1,149 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "OutputGroup.h"
+
+#include <algorithm>
+
+using namespace MetBuild;
+
+OutputGroup::OutputGroup(const Date &date_start, const Date &date_end,
+                         unsigned time_step)
+    : OutputFile(date_start, date_end, time_step) {}
+
+/**
+ * @brief Adds the output of a request to the group
+ * @param member output, with its domains added, spanning part of the group at
+ * the same time step and on its steps
+ * @return index in the group of the first domain of the member
+ */
+size_t OutputGroup::add(OutputFile *member) {
+  if (member == nullptr) {
+    metbuild_throw_exception("Invalid output added to the group");
+  }
+  if (member->timeStep() != this->timeStep()) {
+    metbuild_throw_exception(
+        "The outputs of a group must have the same time step");
+  }
+  if (member->startDate() < this->startDate() ||
+      this->endDate() < member->endDate() ||
+      (member->startDate().toSeconds() - this->startDate().toSeconds()) %
+              this->timeStep() !=
+          0) {
+    metbuild_throw_exception(
+        "The output is not on the steps of the group span");
+  }
+  const size_t offset = m_count;
+  m_members.push_back({member, offset, member->domain_count()});
+  m_count += member->domain_count();
+  return offset;
+}
+
+/**
+ * @brief Number of domains of the members of the group
+ */
+size_t OutputGroup::size() const { return m_count; }
+
+void OutputGroup::addDomain(const Grid &,
+                            const std::vector<std::string> &) {
+  metbuild_throw_exception(
+      "Domains are added to the members of an output group");
+}
+
+const OutputGroup::Member *OutputGroup::member(size_t domain_index) const {
+  for (const auto &m : m_members) {
+    if (domain_index >= m.offset && domain_index < m.offset + m.count) {
+      return &m;
+    }
+  }
+  metbuild_throw_exception("Domain " + std::to_string(domain_index) +
+                           " is not in the output group");
+  return nullptr;
+}
+
+int OutputGroup::write(
+    const Date &date, size_t domain_index,
+    const MeteorologicalData<1, MeteorologicalDataType> &data) {
+  const auto *m = this->member(domain_index);
+  //...Records outside the span of a request are only needed by the others
+  if (date < m->output->startDate() || m->output->endDate() < date) return 0;
+  return m->output->write(date, domain_index - m->offset, data);
+}
+
+int OutputGroup::write(
+    const Date &date, size_t domain_index,
+    const MeteorologicalData<3, MeteorologicalDataType> &data) {
+  const auto *m = this->member(domain_index);
+  if (date < m->output->startDate() || m->output->endDate() < date) return 0;
+  return m->output->write(date, domain_index - m->offset, data);
+}
+
+void OutputGroup::set_async(bool value, size_t queue_depth) {
+  for (auto &m : m_members) m.output->set_async(value, queue_depth);
+}
+
+void OutputGroup::flush() {
+  for (auto &m : m_members) m.output->flush();
+}
+
+void OutputGroup::discard() {
+  for (auto &m : m_members) m.output->discard();
+}
+
+/**
+ * @brief Time up to which every member has been published
+ */
+Date OutputGroup::published_through() const {
+  if (m_members.empty()) return this->startDate() - this->timeStep();
+  auto date = m_members.front().output->published_through();
+  for (const auto &m : m_members) {
+    date = std::min(date, m.output->published_through());
+  }
+  return date;
+}
+
+/**
+ * @brief First date that any member still has to write
+ */
+Date OutputGroup::resume_date() const {
+  if (m_members.empty()) return this->startDate();
+  auto date = m_members.front().output->resume_date();
+  for (const auto &m : m_members) {
+    date = std::min(date, m.output->resume_date());
+  }
+  return date;
+}
+
+std::vector<std::string> OutputGroup::filenames() const {
+  std::vector<std::string> files;
+  for (const auto &m : m_members) {
+    const auto f = m.output->filenames();
+    files.insert(files.end(), f.begin(), f.end());
+  }
+  return files;
+}
@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_OUTPUTGROUP_H_
+#define METBUILD_SRC_OUTPUT_OUTPUTGROUP_H_
+
+#include <string>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "OutputFile.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Output handing the records of one build to the outputs of several
+ * requests, so that requests on the same source files are decoded once
+ *
+ * The group spans the union of the member spans. Each member keeps its own
+ * domains, files and checkpoint, and its domains are numbered in the group
+ * after those of the members added before it, so a member is added once its
+ * own domains are. A record is only handed to a member when its time is
+ * within that member's span. The members are not owned by the group and must
+ * outlive it
+ */
+class OutputGroup : public OutputFile {
+ public:
+  OutputGroup(const MetBuild::Date &date_start, const MetBuild::Date &date_end,
+              unsigned time_step);
+
+  size_t add(OutputFile *member);
+
+  NODISCARD size_t size() const;
+
+  void addDomain(const MetBuild::Grid &w,
+                 const std::vector<std::string> &filenames) override;
+
+  int write(
+      const MetBuild::Date &date, size_t domain_index,
+      const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  int write(
+      const MetBuild::Date &date, size_t domain_index,
+      const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  void set_async(bool value, size_t queue_depth = 2) override;
+
+  void flush() override;
+
+  void discard() override;
+
+  NODISCARD MetBuild::Date published_through() const override;
+
+  NODISCARD MetBuild::Date resume_date() const override;
+
+  NODISCARD std::vector<std::string> filenames() const override;
+
+ private:
+  struct Member {
+    OutputFile *output;
+    size_t offset;
+    size_t count;
+  };
+
+  const Member *member(size_t domain_index) const;
+
+  std::vector<Member> m_members;
+  size_t m_count = 0;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_OUTPUTGROUP_H_
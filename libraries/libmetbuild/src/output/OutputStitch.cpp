@@ -0,0 +1,799 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "OutputStitch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <ostream>
+
+#include "Date.h"
+#include "Logging.h"
+#include "ParallelCompressionBuffer.h"
+#include "Utilities.h"
+#include "boost/iostreams/filter/gzip.hpp"
+#include "boost/iostreams/filtering_stream.hpp"
+#include "netcdf.h"
+
+using namespace MetBuild;
+using namespace Utilities;
+
+namespace {
+
+//...Records are copied in blocks of about this many bytes
+constexpr size_t c_copy_block = 64 * 1024 * 1024;
+
+//...Compression level of stitched gzip files, as written by OwiAsciiDomain
+constexpr int c_gzip_level = 2;
+
+class NcFile {
+ public:
+  NcFile(const std::string &filename, const int mode) {
+    ncCheck(nc_open(filename.c_str(), mode, &m_ncid));
+  }
+  explicit NcFile(const int ncid) : m_ncid(ncid) {}
+  ~NcFile() { nc_close(m_ncid); }
+  NcFile(const NcFile &) = delete;
+  NcFile &operator=(const NcFile &) = delete;
+  int id() const { return m_ncid; }
+
+ private:
+  int m_ncid = 0;
+};
+
+std::string name_from(const char *buffer) { return {buffer}; }
+
+std::string variable_name(const int ncid, const int varid) {
+  char name[NC_MAX_NAME + 1];
+  ncCheck(nc_inq_varname(ncid, varid, name));
+  return name_from(name);
+}
+
+std::string group_path(const int ncid) {
+  size_t length = 0;
+  ncCheck(nc_inq_grpname_full(ncid, &length, nullptr));
+  std::string path(length, '\0');
+  ncCheck(nc_inq_grpname_full(ncid, &length, &path[0]));
+  return path;
+}
+
+std::vector<int> subgroups(const int ncid) {
+  int n = 0;
+  ncCheck(nc_inq_grps(ncid, &n, nullptr));
+  std::vector<int> groups(n);
+  if (n > 0) ncCheck(nc_inq_grps(ncid, &n, groups.data()));
+  return groups;
+}
+
+/**
+ * @brief Copies the attributes of a variable or group. Reserved attributes
+ * other than the fill value are maintained by the library and left out
+ */
+void copy_attributes(const int src, const int src_var, const int dst,
+                     const int dst_var) {
+  int n = 0;
+  if (src_var == NC_GLOBAL) {
+    ncCheck(nc_inq_natts(src, &n));
+  } else {
+    ncCheck(nc_inq_varnatts(src, src_var, &n));
+  }
+  for (int a = 0; a < n; ++a) {
+    char name[NC_MAX_NAME + 1];
+    ncCheck(nc_inq_attname(src, src_var, a, name));
+    if (name[0] == '_' && std::strcmp(name, "_FillValue") != 0) continue;
+    ncCheck(nc_copy_att(src, src_var, name, dst, dst_var));
+  }
+}
+
+//...Lengths given to dimensions of the output, by name, in place of those of
+//   the input
+using DimensionLengths = std::map<std::string, size_t>;
+
+/**
+ * @brief Defines the dimensions, variables, attributes and subgroups of a
+ * group of the first shard in the output, with the same chunking and
+ * compression. Fixed dimensions named in lengths are resized, their chunks
+ * being clamped to the new length
+ */
+void copy_definition(const int src, const int dst,
+                     const DimensionLengths &lengths = DimensionLengths()) {
+  copy_attributes(src, NC_GLOBAL, dst, NC_GLOBAL);
+
+  int n_unlimited = 0;
+  ncCheck(nc_inq_unlimdims(src, &n_unlimited, nullptr));
+  std::vector<int> unlimited(n_unlimited);
+  if (n_unlimited > 0) {
+    ncCheck(nc_inq_unlimdims(src, &n_unlimited, unlimited.data()));
+  }
+
+  int n_dims = 0;
+  ncCheck(nc_inq_dimids(src, &n_dims, nullptr, 0));
+  std::vector<int> dims(n_dims);
+  if (n_dims > 0) ncCheck(nc_inq_dimids(src, &n_dims, dims.data(), 0));
+  for (const auto dim : dims) {
+    char name[NC_MAX_NAME + 1];
+    size_t length = 0;
+    ncCheck(nc_inq_dim(src, dim, name, &length));
+    const bool is_unlimited =
+        std::find(unlimited.begin(), unlimited.end(), dim) != unlimited.end();
+    const auto resized = lengths.find(name);
+    if (resized != lengths.end()) length = resized->second;
+    int dimid = 0;
+    ncCheck(nc_def_dim(dst, name, is_unlimited ? NC_UNLIMITED : length,
+                       &dimid));
+  }
+
+  int n_vars = 0;
+  ncCheck(nc_inq_nvars(src, &n_vars));
+  for (int v = 0; v < n_vars; ++v) {
+    char name[NC_MAX_NAME + 1];
+    nc_type type = 0;
+    int ndims = 0;
+    int var_dims[NC_MAX_VAR_DIMS];
+    ncCheck(nc_inq_var(src, v, name, &type, &ndims, var_dims, nullptr));
+    if (type == NC_STRING || type > NC_MAX_ATOMIC_TYPE) {
+      metbuild_throw_exception("Variable " + name_from(name) +
+                               " has a type which cannot be stitched");
+    }
+
+    //...Dimensions are matched by name, which finds those of parent groups
+    int out_dims[NC_MAX_VAR_DIMS];
+    for (int d = 0; d < ndims; ++d) {
+      char dim_name[NC_MAX_NAME + 1];
+      ncCheck(nc_inq_dimname(src, var_dims[d], dim_name));
+      ncCheck(nc_inq_dimid(dst, dim_name, &out_dims[d]));
+    }
+    int varid = 0;
+    ncCheck(nc_def_var(dst, name, type, ndims, out_dims, &varid));
+
+    if (ndims > 0) {
+      int storage = 0;
+      size_t chunks[NC_MAX_VAR_DIMS];
+      ncCheck(nc_inq_var_chunking(src, v, &storage, chunks));
+      if (storage == NC_CHUNKED) {
+        for (int d = 0; d < ndims; ++d) {
+          size_t length = 0;
+          ncCheck(nc_inq_dimlen(dst, out_dims[d], &length));
+          if (length > 0) chunks[d] = std::min(chunks[d], length);
+        }
+        ncCheck(nc_def_var_chunking(dst, varid, NC_CHUNKED, chunks));
+      }
+      int shuffle = 0;
+      int deflate = 0;
+      int level = 0;
+      ncCheck(nc_inq_var_deflate(src, v, &shuffle, &deflate, &level));
+#if defined(NC_HAS_ZSTD) && NC_HAS_ZSTD
+      int zstd = 0;
+      int zstd_level = 0;
+      if (!deflate &&
+          nc_inq_var_zstandard(src, v, &zstd, &zstd_level) == NC_NOERR &&
+          zstd) {
+        if (shuffle) ncCheck(nc_def_var_deflate(dst, varid, 1, 0, 0));
+        ncCheck(nc_def_var_zstandard(dst, varid, zstd_level));
+        shuffle = 0;
+      }
+#endif
+      if (deflate || shuffle) {
+        ncCheck(nc_def_var_deflate(dst, varid, shuffle, deflate, level));
+      }
+    }
+    copy_attributes(src, v, dst, varid);
+  }
+
+  for (const auto group : subgroups(src)) {
+    char name[NC_MAX_NAME + 1];
+    ncCheck(nc_inq_grpname(group, name));
+    int out = 0;
+    ncCheck(nc_def_grp(dst, name, &out));
+    copy_definition(group, out, lengths);
+  }
+}
+
+/**
+ * @brief Reference date and length in seconds of the unit of a CF time
+ * variable, such as "minutes since 1990-01-01 00:00:00"
+ * @return false if the units are not a CF time
+ */
+bool time_units(const int ncid, const int varid, Date &reference,
+                double &unit) {
+  size_t length = 0;
+  if (nc_inq_attlen(ncid, varid, "units", &length) != NC_NOERR) return false;
+  std::string units(length, '\0');
+  ncCheck(nc_get_att_text(ncid, varid, "units", &units[0]));
+  const auto since = units.find(" since ");
+  if (since == std::string::npos) return false;
+  const auto word = units.substr(0, since);
+  if (word == "seconds") {
+    unit = 1.0;
+  } else if (word == "minutes") {
+    unit = 60.0;
+  } else if (word == "hours") {
+    unit = 3600.0;
+  } else if (word == "days") {
+    unit = 86400.0;
+  } else {
+    return false;
+  }
+  auto date = units.substr(since + 7);
+  std::replace(date.begin(), date.end(), 'T', ' ');
+  reference.fromString(date, "%Y-%m-%d %H:%M:%S");
+  return true;
+}
+
+struct RecordSpan {
+  size_t begin;
+  size_t count;
+};
+
+/**
+ * @brief Copies records [span.begin, span.begin + span.count) of a variable
+ * of a shard to the output, starting at record first
+ */
+void copy_records(const int src, const int src_var, const int dst,
+                  const int dst_var, const RecordSpan span, const size_t first) {
+  nc_type type = 0;
+  int ndims = 0;
+  int dims[NC_MAX_VAR_DIMS];
+  ncCheck(nc_inq_var(dst, dst_var, nullptr, &type, &ndims, dims, nullptr));
+  size_t type_size = 0;
+  ncCheck(nc_inq_type(dst, type, nullptr, &type_size));
+
+  std::vector<size_t> start(ndims, 0);
+  std::vector<size_t> count(ndims, 0);
+  size_t record_bytes = type_size;
+  for (int d = 1; d < ndims; ++d) {
+    ncCheck(nc_inq_dimlen(dst, dims[d], &count[d]));
+    record_bytes *= count[d];
+  }
+  const size_t block = std::max<size_t>(c_copy_block / record_bytes, 1);
+  std::vector<unsigned char> buffer(std::min(block, span.count) *
+                                    record_bytes);
+  for (size_t r = 0; r < span.count; r += block) {
+    count[0] = std::min(block, span.count - r);
+    start[0] = span.begin + r;
+    ncCheck(nc_get_vara(src, src_var, start.data(), count.data(),
+                        buffer.data()));
+    start[0] = first + r;
+    ncCheck(nc_put_vara(dst, dst_var, start.data(), count.data(),
+                        buffer.data()));
+  }
+}
+
+/**
+ * @brief Copies the variables of a group. Variables without a record
+ * dimension are taken from the first shard. Records come from every shard
+ * in turn, the time coordinate being moved to the reference date of the
+ * first shard, and records at a time already written are skipped
+ */
+void copy_data(const std::vector<std::unique_ptr<NcFile>> &shards,
+               const int dst) {
+  const auto path = group_path(dst);
+  std::vector<int> src(shards.size());
+  for (size_t s = 0; s < shards.size(); ++s) {
+    if (nc_inq_grp_full_ncid(shards[s]->id(), path.c_str(), &src[s]) !=
+        NC_NOERR) {
+      metbuild_throw_exception("Shard " + std::to_string(s) +
+                               " does not have group " + path);
+    }
+  }
+
+  int n_unlimited = 0;
+  ncCheck(nc_inq_unlimdims(dst, &n_unlimited, nullptr));
+  if (n_unlimited > 1) {
+    metbuild_throw_exception("Group " + path +
+                             " has more than one record dimension");
+  }
+  int record_dim = -1;
+  if (n_unlimited == 1) ncCheck(nc_inq_unlimdims(dst, nullptr, &record_dim));
+
+  //...Records kept from each shard, and the rebased time coordinate
+  std::vector<RecordSpan> spans(shards.size(), {0, 0});
+  std::vector<double> times;
+  int time_var = -1;
+  if (record_dim >= 0) {
+    char dim_name[NC_MAX_NAME + 1];
+    ncCheck(nc_inq_dimname(dst, record_dim, dim_name));
+    if (nc_inq_varid(dst, dim_name, &time_var) != NC_NOERR) time_var = -1;
+
+    Date reference;
+    double unit = 0.0;
+    const bool cf_time =
+        time_var >= 0 && time_units(src[0], time_var, reference, unit);
+    for (size_t s = 0; s < shards.size(); ++s) {
+      int dimid = 0;
+      size_t length = 0;
+      ncCheck(nc_inq_dimid(src[s], dim_name, &dimid));
+      ncCheck(nc_inq_dimlen(src[s], dimid, &length));
+      if (time_var < 0) {
+        spans[s] = {0, length};
+        continue;
+      }
+
+      int varid = 0;
+      ncCheck(nc_inq_varid(src[s], dim_name, &varid));
+      std::vector<double> t(length);
+      if (length > 0) ncCheck(nc_get_var_double(src[s], varid, t.data()));
+      Date shard_reference;
+      double shard_unit = 0.0;
+      if (cf_time && time_units(src[s], varid, shard_reference, shard_unit)) {
+        const double offset = static_cast<double>(shard_reference.toSeconds() -
+                                                  reference.toSeconds());
+        for (auto &v : t) v = (v * shard_unit + offset) / unit;
+      }
+      size_t begin = 0;
+      while (begin < length && !times.empty() && t[begin] <= times.back()) {
+        ++begin;
+      }
+      spans[s] = {begin, length - begin};
+      times.insert(times.end(), t.begin() + begin, t.end());
+    }
+  }
+
+  int n_vars = 0;
+  ncCheck(nc_inq_nvars(dst, &n_vars));
+  for (int v = 0; v < n_vars; ++v) {
+    const auto name = variable_name(dst, v);
+    int ndims = 0;
+    int dims[NC_MAX_VAR_DIMS];
+    ncCheck(nc_inq_var(dst, v, nullptr, nullptr, &ndims, dims, nullptr));
+    const bool records = ndims > 0 && dims[0] == record_dim;
+    for (int d = 1; d < ndims; ++d) {
+      if (dims[d] == record_dim) {
+        metbuild_throw_exception("Variable " + name +
+                                 " must have the record dimension first");
+      }
+    }
+
+    if (v == time_var) {
+      if (!times.empty()) {
+        const size_t start = 0;
+        const size_t count = times.size();
+        ncCheck(nc_put_vara_double(dst, v, &start, &count, times.data()));
+      }
+      continue;
+    }
+
+    if (!records) {
+      int varid = 0;
+      ncCheck(nc_inq_varid(src[0], name.c_str(), &varid));
+      nc_type type = 0;
+      ncCheck(nc_inq_vartype(dst, v, &type));
+      size_t bytes = 0;
+      ncCheck(nc_inq_type(dst, type, nullptr, &bytes));
+      for (int d = 0; d < ndims; ++d) {
+        size_t length = 0;
+        ncCheck(nc_inq_dimlen(dst, dims[d], &length));
+        bytes *= length;
+      }
+      std::vector<unsigned char> buffer(bytes);
+      ncCheck(nc_get_var(src[0], varid, buffer.data()));
+      ncCheck(nc_put_var(dst, v, buffer.data()));
+      continue;
+    }
+
+    size_t first = 0;
+    for (size_t s = 0; s < shards.size(); ++s) {
+      int varid = 0;
+      if (nc_inq_varid(src[s], name.c_str(), &varid) != NC_NOERR) {
+        metbuild_throw_exception("Shard " + std::to_string(s) +
+                                 " does not have variable " + name);
+      }
+      if (spans[s].count > 0) {
+        copy_records(src[s], varid, dst, v, spans[s], first);
+      }
+      first += spans[s].count;
+    }
+  }
+
+  for (const auto group : subgroups(dst)) copy_data(shards, group);
+}
+
+//...Part of each dimension of the input kept in the output, by name
+using DimensionSpans = std::map<std::string, RecordSpan>;
+
+bool is_x_dimension(const std::string &name) {
+  return name == "xi" || name == "lon" || name == "x";
+}
+
+bool is_y_dimension(const std::string &name) {
+  return name == "yi" || name == "lat" || name == "y";
+}
+
+/**
+ * @brief Finds the groups defining a spatial dimension, as the OWI groups
+ * and the HEC-RAS root group do
+ */
+void spatial_groups(const int ncid, std::vector<int> &groups) {
+  int n_dims = 0;
+  ncCheck(nc_inq_dimids(ncid, &n_dims, nullptr, 0));
+  std::vector<int> dims(n_dims);
+  if (n_dims > 0) ncCheck(nc_inq_dimids(ncid, &n_dims, dims.data(), 0));
+  for (const auto dim : dims) {
+    char name[NC_MAX_NAME + 1];
+    ncCheck(nc_inq_dimname(ncid, dim, name));
+    if (is_x_dimension(name) || is_y_dimension(name)) {
+      groups.push_back(ncid);
+      break;
+    }
+  }
+  for (const auto group : subgroups(ncid)) spatial_groups(group, groups);
+}
+
+/**
+ * @brief Records of a group whose CF time lies in [start, end]. The records
+ * must begin at start and end at end so that the output covers the range
+ */
+RecordSpan time_span(const int ncid, const Date &start, const Date &end) {
+  int dimid = 0;
+  int varid = 0;
+  Date reference;
+  double unit = 0.0;
+  if (nc_inq_dimid(ncid, "time", &dimid) != NC_NOERR ||
+      nc_inq_varid(ncid, "time", &varid) != NC_NOERR ||
+      !time_units(ncid, varid, reference, unit)) {
+    metbuild_throw_exception("Group " + group_path(ncid) +
+                             " does not have a CF time coordinate");
+  }
+  size_t length = 0;
+  ncCheck(nc_inq_dimlen(ncid, dimid, &length));
+  std::vector<double> t(length);
+  if (length > 0) ncCheck(nc_get_var_double(ncid, varid, t.data()));
+
+  //...Times are compared in whole seconds, as dates are held
+  const auto seconds = [&](const double v) {
+    return static_cast<long>(std::llround(v * unit)) + reference.toSeconds();
+  };
+  size_t begin = 0;
+  while (begin < length && seconds(t[begin]) < start.toSeconds()) ++begin;
+  size_t last = begin;
+  while (last < length && seconds(t[last]) <= end.toSeconds()) ++last;
+  if (begin == last || seconds(t[begin]) != start.toSeconds() ||
+      seconds(t[last - 1]) != end.toSeconds()) {
+    metbuild_throw_exception("The records of " + group_path(ncid) +
+                             " do not cover " + start.toString() + " to " +
+                             end.toString());
+  }
+  return {begin, last - begin};
+}
+
+/**
+ * @brief Copies the hyperslab of a variable starting at start with count
+ * elements along each dimension to the whole of a variable of the output,
+ * in blocks along its first dimension
+ */
+void copy_hyperslab(const int src, const int src_var, const int dst,
+                    const int dst_var, std::vector<size_t> start,
+                    std::vector<size_t> count) {
+  nc_type type = 0;
+  ncCheck(nc_inq_vartype(dst, dst_var, &type));
+  size_t type_size = 0;
+  ncCheck(nc_inq_type(dst, type, nullptr, &type_size));
+
+  if (count.empty()) {
+    std::vector<unsigned char> buffer(type_size);
+    ncCheck(nc_get_var(src, src_var, buffer.data()));
+    ncCheck(nc_put_var(dst, dst_var, buffer.data()));
+    return;
+  }
+
+  size_t slice_bytes = type_size;
+  for (size_t d = 1; d < count.size(); ++d) slice_bytes *= count[d];
+  if (count[0] == 0 || slice_bytes == 0) return;
+  const size_t block = std::max<size_t>(c_copy_block / slice_bytes, 1);
+  const size_t total = count[0];
+  const size_t first = start[0];
+  std::vector<unsigned char> buffer(std::min(block, total) * slice_bytes);
+  std::vector<size_t> out_start(count.size(), 0);
+  for (size_t r = 0; r < total; r += block) {
+    count[0] = std::min(block, total - r);
+    start[0] = first + r;
+    out_start[0] = r;
+    ncCheck(nc_get_vara(src, src_var, start.data(), count.data(),
+                        buffer.data()));
+    ncCheck(nc_put_vara(dst, dst_var, out_start.data(), count.data(),
+                        buffer.data()));
+  }
+}
+
+/**
+ * @brief Copies the part of each variable of a group, and of its subgroups,
+ * selected by the spans of its dimensions
+ */
+void copy_window_data(const int src_root, const int dst,
+                      const DimensionSpans &spans) {
+  const auto path = group_path(dst);
+  int src = 0;
+  ncCheck(nc_inq_grp_full_ncid(src_root, path.c_str(), &src));
+
+  int n_vars = 0;
+  ncCheck(nc_inq_nvars(dst, &n_vars));
+  for (int v = 0; v < n_vars; ++v) {
+    const auto name = variable_name(dst, v);
+    int varid = 0;
+    ncCheck(nc_inq_varid(src, name.c_str(), &varid));
+    int ndims = 0;
+    int dims[NC_MAX_VAR_DIMS];
+    ncCheck(nc_inq_var(dst, v, nullptr, nullptr, &ndims, dims, nullptr));
+    std::vector<size_t> start(ndims, 0);
+    std::vector<size_t> count(ndims, 0);
+    for (int d = 0; d < ndims; ++d) {
+      char dim_name[NC_MAX_NAME + 1];
+      ncCheck(nc_inq_dimname(dst, dims[d], dim_name));
+      const auto span = spans.find(dim_name);
+      if (span != spans.end()) {
+        start[d] = span->second.begin;
+        count[d] = span->second.count;
+      } else {
+        ncCheck(nc_inq_dimlen(dst, dims[d], &count[d]));
+      }
+    }
+    copy_hyperslab(src, varid, dst, v, start, count);
+  }
+
+  for (const auto group : subgroups(dst)) {
+    copy_window_data(src_root, group, spans);
+  }
+}
+
+/**
+ * @brief Reads an OWI ASCII file, compressed or not, line by line
+ */
+class LineReader {
+ public:
+  explicit LineReader(const std::string &filename)
+      : m_file(filename, std::ios_base::in | std::ios_base::binary) {
+    if (!m_file.is_open()) {
+      metbuild_throw_exception("Could not open " + filename);
+    }
+    if (m_file.peek() == 0x1f) {
+      m_stream.push(boost::iostreams::gzip_decompressor());
+    }
+    m_stream.push(m_file);
+  }
+
+  bool next(std::string &line) {
+    return static_cast<bool>(std::getline(m_stream, line));
+  }
+
+ private:
+  std::ifstream m_file;
+  boost::iostreams::filtering_istream m_stream;
+};
+
+/**
+ * @brief Valid time of an OWI record header as YYYYMMDDHHmm, which orders
+ * like the dates it stands for
+ */
+std::string record_time(const std::string &header) {
+  const auto position = header.find("DT=");
+  if (position == std::string::npos) {
+    metbuild_throw_exception("Invalid OWI record header: " + header);
+  }
+  return header.substr(position + 3, 12);
+}
+
+}  // namespace
+
+/**
+ * @brief Joins netCDF shards, such as OWI netCDF or HEC-RAS files, along
+ * their record dimension
+ *
+ * The structure, attributes, chunking and compression are those of the
+ * first shard. Records are copied as hyperslabs without conversion
+ *
+ * @param shards shard files in time order
+ * @param output stitched file
+ */
+void OutputStitch::netcdf(const std::vector<std::string> &shards,
+                          const std::string &output) {
+  if (shards.empty()) {
+    metbuild_throw_exception("No shards to stitch");
+  }
+  std::vector<std::unique_ptr<NcFile>> files;
+  files.reserve(shards.size());
+  for (const auto &s : shards) {
+    files.push_back(std::make_unique<NcFile>(s, NC_NOWRITE));
+  }
+
+  int format = 0;
+  ncCheck(nc_inq_format(files.front()->id(), &format));
+  int mode = NC_CLOBBER;
+  if (format == NC_FORMAT_NETCDF4) {
+    mode |= NC_NETCDF4;
+  } else if (format == NC_FORMAT_NETCDF4_CLASSIC) {
+    mode |= NC_NETCDF4 | NC_CLASSIC_MODEL;
+  } else if (format == NC_FORMAT_64BIT_OFFSET) {
+    mode |= NC_64BIT_OFFSET;
+  }
+
+  int ncid = 0;
+  ncCheck(nc_create(output.c_str(), mode, &ncid));
+  NcFile out(ncid);
+  int old_fill = 0;
+  ncCheck(nc_set_fill(ncid, NC_NOFILL, &old_fill));
+  copy_definition(files.front()->id(), ncid);
+  ncCheck(nc_enddef(ncid));
+  copy_data(files, ncid);
+}
+
+/**
+ * @brief Extracts a window and a time range of a netCDF output, such as an
+ * OWI netCDF or HEC-RAS file, into a new file
+ *
+ * The window is given in nodes of the grid of the input, as returned by
+ * Grid::window, so the output holds the values the same request on the
+ * smaller grid would have written. The structure, attributes and compression
+ * are those of the input, and the values are copied as hyperslabs without
+ * conversion. Only files with a single gridded domain can be cut
+ *
+ * @param input netCDF output of a request on a larger grid
+ * @param output file to write
+ * @param window nodes of the input grid to keep
+ * @param start first record to keep
+ * @param end last record to keep
+ */
+void OutputStitch::netcdf_window(const std::string &input,
+                                 const std::string &output,
+                                 const Grid::Window &window, const Date &start,
+                                 const Date &end) {
+  NcFile file(input, NC_NOWRITE);
+
+  std::vector<int> groups;
+  spatial_groups(file.id(), groups);
+  if (groups.size() != 1) {
+    metbuild_throw_exception(input +
+                             " does not have a single gridded domain");
+  }
+  const int group = groups.front();
+
+  DimensionLengths lengths;
+  DimensionSpans spans;
+  int n_dims = 0;
+  ncCheck(nc_inq_dimids(group, &n_dims, nullptr, 0));
+  std::vector<int> dims(n_dims);
+  ncCheck(nc_inq_dimids(group, &n_dims, dims.data(), 0));
+  for (const auto dim : dims) {
+    char name[NC_MAX_NAME + 1];
+    size_t length = 0;
+    ncCheck(nc_inq_dim(group, dim, name, &length));
+    RecordSpan span{0, length};
+    if (is_x_dimension(name)) {
+      span = {window.i0, window.ni};
+    } else if (is_y_dimension(name)) {
+      span = {window.j0, window.nj};
+    } else {
+      continue;
+    }
+    if (span.count == 0 || span.begin + span.count > length) {
+      metbuild_throw_exception("The window does not fit dimension " +
+                               name_from(name) + " of " + input);
+    }
+    lengths[name] = span.count;
+    spans[name] = span;
+  }
+  const auto records = time_span(group, start, end);
+  lengths["time"] = records.count;
+  spans["time"] = records;
+
+  int format = 0;
+  ncCheck(nc_inq_format(file.id(), &format));
+  int mode = NC_CLOBBER;
+  if (format == NC_FORMAT_NETCDF4) {
+    mode |= NC_NETCDF4;
+  } else if (format == NC_FORMAT_NETCDF4_CLASSIC) {
+    mode |= NC_NETCDF4 | NC_CLASSIC_MODEL;
+  } else if (format == NC_FORMAT_64BIT_OFFSET) {
+    mode |= NC_64BIT_OFFSET;
+  }
+
+  int ncid = 0;
+  ncCheck(nc_create(output.c_str(), mode, &ncid));
+  NcFile out(ncid);
+  int old_fill = 0;
+  ncCheck(nc_set_fill(ncid, NC_NOFILL, &old_fill));
+  copy_definition(file.id(), ncid, lengths);
+  ncCheck(nc_enddef(ncid));
+  copy_window_data(file.id(), ncid, spans);
+}
+
+/**
+ * @brief Joins OWI ASCII shards of one file type, pressure or wind
+ *
+ * The file header is regenerated from the start date of the first shard and
+ * the end date of the last. Records are copied line by line. Shards may be
+ * gzip compressed, and the output is compressed when its name ends in .gz
+ *
+ * @param shards shard files in time order
+ * @param output stitched file
+ */
+void OutputStitch::owi_ascii(const std::vector<std::string> &shards,
+                             const std::string &output) {
+  if (shards.empty()) {
+    metbuild_throw_exception("No shards to stitch");
+  }
+
+  //...The header holds the start and end dates as its last two fields
+  std::string header;
+  std::string end_date;
+  for (size_t s = 0; s < shards.size(); ++s) {
+    LineReader reader(shards[s]);
+    std::string line;
+    if (!reader.next(line) || line.rfind("Oceanweather", 0) != 0) {
+      metbuild_throw_exception(shards[s] + " is not an OWI ASCII file");
+    }
+    const auto position = line.find_last_of(' ');
+    if (s == 0) header = line.substr(0, position + 1);
+    end_date = line.substr(position + 1);
+  }
+
+  std::ofstream file(output, std::ios_base::out | std::ios_base::binary);
+  if (!file.is_open()) {
+    metbuild_throw_exception("Could not open " + output);
+  }
+  const bool compress =
+      output.size() > 3 && output.compare(output.size() - 3, 3, ".gz") == 0;
+  std::unique_ptr<ParallelCompressionBuffer> gzip;
+  std::ostream stream(file.rdbuf());
+  if (compress) {
+    gzip = std::make_unique<ParallelCompressionBuffer>(
+        &file, StreamCompression::GZIP, c_gzip_level);
+    stream.rdbuf(gzip.get());
+  }
+  stream << header << end_date << "\n";
+
+  std::string last_time;
+  std::string line;
+  for (const auto &shard : shards) {
+    LineReader reader(shard);
+    reader.next(line);
+    bool copy = false;
+    while (reader.next(line)) {
+      if (line.rfind("iLat=", 0) == 0) {
+        const auto time = record_time(line);
+        copy = last_time.empty() || time > last_time;
+        if (copy) last_time = time;
+      }
+      if (copy) {
+        stream.write(line.data(), static_cast<std::streamsize>(line.size()));
+        stream.put('\n');
+      }
+    }
+  }
+
+  stream.flush();
+  if (gzip) gzip->close();
+  stream.rdbuf(nullptr);
+  file.close();
+  if (!file) {
+    metbuild_throw_exception("Error while writing " + output);
+  }
+}
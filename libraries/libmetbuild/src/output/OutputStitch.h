@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_OUTPUTSTITCH_H_
+#define METBUILD_SRC_OUTPUT_OUTPUTSTITCH_H_
+
+#include <string>
+#include <vector>
+
+#include "Date.h"
+#include "Grid.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Joins the files written by the time shards of a request into the
+ * output of the full request
+ *
+ * The records are copied as they were written, without interpolating or
+ * formatting the values again. Shards are given in time order. A record at a
+ * time already written by an earlier shard is skipped, so shards may overlap.
+ * A netCDF output may also be cut to a smaller grid and time range, to
+ * answer a request from the output of a larger one
+ */
+class OutputStitch {
+ public:
+  static void netcdf(const std::vector<std::string> &shards,
+                     const std::string &output);
+
+  static void owi_ascii(const std::vector<std::string> &shards,
+                        const std::string &output);
+
+  static void netcdf_window(const std::string &input,
+                            const std::string &output,
+                            const MetBuild::Grid::Window &window,
+                            const MetBuild::Date &start,
+                            const MetBuild::Date &end);
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_OUTPUTSTITCH_H_
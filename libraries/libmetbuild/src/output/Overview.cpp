@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "Overview.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "Logging.h"
+#include "ThreadPool.h"
+
+using namespace MetBuild;
+
+size_t Overview::size(const size_t n, const size_t factor) {
+  return (n + factor - 1) / factor;
+}
+
+/**
+ * @brief Grid of a level, with a cell at the center of each full block
+ * @param grid full resolution grid
+ * @param factor decimation factor
+ * @return grid of the level
+ */
+Grid Overview::grid(const MetBuild::Grid &grid, const size_t factor) {
+  if (factor < 2) {
+    metbuild_throw_exception("Overview factors must be at least 2");
+  }
+  if (grid.is_point_list()) {
+    metbuild_throw_exception("Point list grids do not have overviews");
+  }
+  const auto a = grid.position(0, 0);
+  const auto b = grid.position(std::min(factor, grid.ni()) - 1,
+                                std::min(factor, grid.nj()) - 1);
+  return {(a.x() + b.x()) / 2.0,
+          (a.y() + b.y()) / 2.0,
+          Overview::size(grid.ni(), factor),
+          Overview::size(grid.nj(), factor),
+          grid.di() * static_cast<double>(factor),
+          grid.dj() * static_cast<double>(factor),
+          grid.rotation(),
+          grid.epsg()};
+}
+
+/**
+ * @brief Averages the blocks of one field
+ * @param in field of ni x nj cells
+ * @param ni cells per row of the field
+ * @param nj rows of the field
+ * @param factor decimation factor
+ * @param out level of size(ni, factor) x size(nj, factor) cells
+ */
+void Overview::average(const MetBuild::MeteorologicalDataType *in,
+                       const size_t ni, const size_t nj, const size_t factor,
+                       MetBuild::MeteorologicalDataType *out) {
+  constexpr auto flag = MeteorologicalData<1>::flag_value();
+  const size_t oi = Overview::size(ni, factor);
+  const size_t oj = Overview::size(nj, factor);
+  ThreadPool::global().parallel_for(0, oj, [&](const size_t bj) {
+    std::vector<double> sum(oi, 0.0);
+    std::vector<size_t> count(oi, 0);
+    const size_t j1 = std::min(nj, (bj + 1) * factor);
+    for (size_t j = bj * factor; j < j1; ++j) {
+      const auto *row = in + j * ni;
+      for (size_t i = 0; i < ni; ++i) {
+        if (row[i] == flag) continue;
+        sum[i / factor] += row[i];
+        ++count[i / factor];
+      }
+    }
+    auto *o = out + bj * oi;
+    for (size_t bi = 0; bi < oi; ++bi) {
+      o[bi] = count[bi] == 0
+                  ? flag
+                  : static_cast<MeteorologicalDataType>(
+                        sum[bi] / static_cast<double>(count[bi]));
+    }
+  });
+}
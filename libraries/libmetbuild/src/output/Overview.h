@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_OVERVIEW_H_
+#define METBUILD_SRC_OUTPUT_OVERVIEW_H_
+
+#include <cstddef>
+
+#include "Grid.h"
+#include "MeteorologicalData.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Decimated levels of an output grid, written next to the full grid
+ * so that viewers can draw a preview without reading it
+ *
+ * A level of factor f averages each block of f x f cells, ignoring cells
+ * holding the flag value. Blocks without any value hold the flag value.
+ * The last row and column of blocks cover the cells left over, so a level
+ * has ceil(n / f) cells along each side
+ */
+class Overview {
+ public:
+  static size_t size(size_t n, size_t factor);
+
+  static MetBuild::Grid grid(const MetBuild::Grid &grid, size_t factor);
+
+  static void average(const MetBuild::MeteorologicalDataType *in, size_t ni,
+                      size_t nj, size_t factor,
+                      MetBuild::MeteorologicalDataType *out);
+
+  template <unsigned N>
+  static void average(
+      const MetBuild::MeteorologicalData<N, MetBuild::MeteorologicalDataType>
+          &in,
+      size_t factor,
+      MetBuild::MeteorologicalData<N, MetBuild::MeteorologicalDataType> &out) {
+    const auto ni = Overview::size(in.ni(), factor);
+    const auto nj = Overview::size(in.nj(), factor);
+    if (out.ni() != ni || out.nj() != nj) out.resize(ni, nj);
+    for (size_t k = 0; k < N; ++k) {
+      Overview::average(in.parameter(k).data(), in.ni(), in.nj(), factor,
+                        out.parameter(k).data());
+    }
+  }
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_OVERVIEW_H_
@@ -35,18 +35,32 @@ using namespace MetBuild;
 OwiAscii::OwiAscii(const Date& startDate, const Date& endDate,
                    const unsigned time_step, const bool use_compression)
     : OutputFile(startDate, endDate, time_step),
-      m_use_compression(use_compression) {}
+      m_codec(use_compression ? StreamCompression::GZIP
+                              : StreamCompression::NONE) {}
+
+/**
+ * @brief Selects the codec of the domains added afterwards
+ * @param codec codec, which must be available in this build
+ */
+void OwiAscii::set_compression(const StreamCompression::Codec codec) {
+  if (!StreamCompression::available(codec)) {
+    metbuild_throw_exception("The library was built without " +
+                             StreamCompression::name(codec) + " compression");
+  }
+  m_codec = codec;
+}
 
 void OwiAscii::addDomain(const Grid& w,
                          const std::vector<std::string>& filenames) {
   if (filenames.size() == 1) {
     m_domains.push_back(std::make_unique<OwiAsciiDomain>(
         &w, this->startDate(), this->endDate(), this->timeStep(), filenames[0],
-        m_use_compression));
+        m_codec, this->resume_point(m_domains.size())));
   } else if (filenames.size() == 2) {
     m_domains.push_back(std::make_unique<OwiAsciiDomain>(
         &w, this->startDate(), this->endDate(), this->timeStep(), filenames[0],
-        filenames[1], m_use_compression));
+        filenames[1], m_codec,
+        this->resume_point(m_domains.size())));
   } else {
     metbuild_throw_exception("Must provide two filenames for OwiAscii format");
   }
@@ -55,16 +69,17 @@ void OwiAscii::addDomain(const Grid& w,
 int OwiAscii::write(const Date& date, const size_t domain_index,
                     const MeteorologicalData<1, MeteorologicalDataType>& data) {
   assert(domain_index < m_domains.size());
-  return m_domains[domain_index]->write(date, data);
+  return this->write_domain(domain_index, date, data);
 }
 
 int OwiAscii::write(const Date& date, const size_t domain_index,
                     const MeteorologicalData<3, MeteorologicalDataType>& data) {
   assert(domain_index < m_domains.size());
-  return m_domains[domain_index]->write(date, data);
+  return this->write_domain(domain_index, date, data);
 }
 
 void OwiAscii::close_domain(size_t domain) {
   assert(domain < m_domains.size());
+  this->flush_domain(domain);
   this->m_domains[domain]->close();
 }
@@ -46,6 +46,8 @@ class OwiAscii : public OutputFile {
   void addDomain(const MetBuild::Grid &w,
                  const std::vector<std::string> &filenames) override;
 
+  void set_compression(MetBuild::StreamCompression::Codec codec);
+
   int write(
       const MetBuild::Date &date, size_t domain_index,
       const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
@@ -59,7 +61,7 @@ class OwiAscii : public OutputFile {
   void close_domain(size_t domain);
 
  private:
-  const bool m_use_compression;
+  MetBuild::StreamCompression::Codec m_codec;
 };
 }  // namespace MetBuild
 #endif  // METGET_LIBRARY_OWIASCII_H_
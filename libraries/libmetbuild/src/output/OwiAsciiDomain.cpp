@@ -28,11 +28,19 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "OwiAsciiDomain.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
 
+#include "Instrumentation.h"
 #include "Logging.h"
-#include "boost/iostreams/filter/gzip.hpp"
-#include "boost/iostreams/filtering_streambuf.hpp"
+#include "ThreadPool.h"
 
 #define FMT_HEADER_ONLY
 #include "fmt/core.h"
@@ -40,24 +48,73 @@
 
 using namespace MetBuild;
 
+namespace {
+
+constexpr size_t c_field_width = 10;
+constexpr size_t c_max_field_width = 64;
+constexpr size_t c_records_per_line = 8;
+
+//...Lines formatted by one task of the thread pool
+constexpr size_t c_format_block_lines = 4096;
+
+/**
+ * @brief Writes a value in the same form as fmt's "{:10.4f}"
+ *
+ * Single precision values times 1e4 are exact in double precision, so the
+ * rounding is done on the exact value. Ties, values too wide for the field
+ * and non-finite values fall back to fmt
+ *
+ * @param value value to write
+ * @param out destination, at least c_max_field_width characters
+ * @return number of characters written
+ */
+template <typename T>
+size_t format_record_value(const T value, char *out) {
+  if (std::is_same<T, float>::value && std::isfinite(value)) {
+    const double scaled = std::abs(static_cast<double>(value)) * 1e4;
+    if (scaled < 1e8) {
+      auto rounded = static_cast<uint64_t>(scaled);
+      const double remainder = scaled - static_cast<double>(rounded);
+      if (remainder != 0.5) {
+        if (remainder > 0.5) ++rounded;
+        char *p = out + c_field_width;
+        auto fraction = rounded % 10000;
+        for (int k = 0; k < 4; ++k) {
+          *--p = static_cast<char>('0' + fraction % 10);
+          fraction /= 10;
+        }
+        *--p = '.';
+        auto whole = rounded / 10000;
+        do {
+          *--p = static_cast<char>('0' + whole % 10);
+          whole /= 10;
+        } while (whole != 0);
+        if (std::signbit(value)) *--p = '-';
+        std::memset(out, ' ', p - out);
+        return c_field_width;
+      }
+    }
+  }
+  const auto r = fmt::format_to_n(out, c_max_field_width, "{:10.4f}", value);
+  return r.size;
+}
+
+}  // namespace
+
 OwiAsciiDomain::OwiAsciiDomain(const MetBuild::Grid *grid,
                                const Date &startDate, const Date &endDate,
                                const unsigned int time_step,
                                const std::string &pressureFile,
                                const std::string &windFile,
-                               const bool use_compression)
-    : OutputDomain(grid, startDate, endDate, time_step),
+                               const StreamCompression::Codec codec,
+                               const ResumePoint *resume)
+    : OutputDomain(grid, startDate, endDate, time_step, resume),
       m_previousDate(startDate - time_step),
-      m_compressedio_pressure(
-          std::make_unique<boost::iostreams::filtering_streambuf<
-              boost::iostreams::output>>()),
-      m_compressedio_wind(
-          std::make_unique<boost::iostreams::filtering_streambuf<
-              boost::iostreams::output>>()),
-      m_compressed_stream_pressure(m_compressedio_pressure.get()),
-      m_compressed_stream_wind(m_compressedio_wind.get()),
-      m_use_compression(use_compression),
-      m_default_compression_level(2),
+      m_compressed_stream_pressure(nullptr),
+      m_compressed_stream_wind(nullptr),
+      m_codec(codec),
+      m_use_compression(codec != StreamCompression::NONE),
+      m_default_compression_level(StreamCompression::defaultLevel(codec)),
       m_pressureFile(pressureFile),
       m_windFile(windFile) {
   assert(startDate < endDate);
@@ -70,19 +127,15 @@ OwiAsciiDomain::OwiAsciiDomain(const MetBuild::Grid *grid,
                                const Date &startDate, const Date &endDate,
                                const unsigned int time_step,
                                const std::string &outputFile,
-                               const bool use_compression)
-    : OutputDomain(grid, startDate, endDate, time_step),
+                               const StreamCompression::Codec codec,
+                               const ResumePoint *resume)
+    : OutputDomain(grid, startDate, endDate, time_step, resume),
       m_previousDate(startDate - time_step),
-      m_compressedio_pressure(
-          std::make_unique<boost::iostreams::filtering_streambuf<
-              boost::iostreams::output>>()),
-      m_compressedio_wind(
-          std::make_unique<boost::iostreams::filtering_streambuf<
-              boost::iostreams::output>>()),
-      m_compressed_stream_pressure(m_compressedio_pressure.get()),
-      m_compressed_stream_wind(m_compressedio_wind.get()),
-      m_use_compression(use_compression),
-      m_default_compression_level(2),
+      m_compressed_stream_pressure(nullptr),
+      m_compressed_stream_wind(nullptr),
+      m_codec(codec),
+      m_use_compression(codec != StreamCompression::NONE),
+      m_default_compression_level(StreamCompression::defaultLevel(codec)),
       m_pressureFile(outputFile) {
   assert(startDate < endDate);
   this->m_filenames.push_back(outputFile);
@@ -94,46 +147,74 @@ void OwiAsciiDomain::open() { this->_open(); }
 OwiAsciiDomain::~OwiAsciiDomain() { this->_close(); }
 
 void OwiAsciiDomain::_open() {
-  if (m_use_compression) {
-    if (!m_ofstream_pressure.is_open()) {
-      m_ofstream_pressure.open(m_pressureFile,
-                               std::ios_base::out | std::ios_base::binary);
-      m_compressedio_pressure->push(boost::iostreams::gzip_compressor(
-          boost::iostreams::gzip_params(m_default_compression_level)));
-      m_compressedio_pressure->push(m_ofstream_pressure);
+  const auto resume = this->resume_point();
+  if (resume != nullptr &&
+      resume->offsets.size() != this->m_filenames.size()) {
+    metbuild_throw_exception("The checkpoint does not match the files of "
+                             "the domain");
+  }
+  if (!m_ofstream_pressure.is_open()) {
+    this->open_sink(&m_ofstream_pressure, m_pressureFile, 0);
+    if (m_use_compression) {
+      m_compressedio_pressure = std::make_unique<ParallelCompressionBuffer>(
+          &m_ofstream_pressure, m_codec, m_default_compression_level);
+      m_compressed_stream_pressure.rdbuf(m_compressedio_pressure.get());
     }
-    if (!m_windFile.empty()) {
-      if (!m_ofstream_wind.is_open()) {
-        m_ofstream_wind.open(m_windFile,
-                             std::ios_base::out | std::ios_base::binary);
-        m_compressedio_wind->push(boost::iostreams::gzip_compressor(
-            boost::iostreams::gzip_params(m_default_compression_level)));
-        m_compressedio_wind->push(m_ofstream_wind);
+  }
+  if (!m_windFile.empty()) {
+    if (!m_ofstream_wind.is_open()) {
+      this->open_sink(&m_ofstream_wind, m_windFile, 1);
+      if (m_use_compression) {
+        m_compressedio_wind = std::make_unique<ParallelCompressionBuffer>(
+            &m_ofstream_wind, m_codec, m_default_compression_level);
+        m_compressed_stream_wind.rdbuf(m_compressedio_wind.get());
       }
     }
+  }
+  //...A resumed file already has its header and the records up to the
+  // checkpoint, and members are appended after the last one
+  if (resume != nullptr) {
+    m_previousDate = resume->time;
+    this->clear_resume();
   } else {
-    if (!m_ofstream_pressure.is_open()) {
-      m_ofstream_pressure.open(m_pressureFile);
-    }
-    if (!m_windFile.empty()) {
-      if (!m_ofstream_wind.is_open()) {
-        m_ofstream_wind.open(m_windFile);
-      }
-    }
+    this->write_header();
   }
-  this->write_header();
   this->set_open(true);
 }
 
+/**
+ * @brief Ends the compressed streams on a member boundary and makes both
+ * files durable up to the last record written
+ */
+bool OwiAsciiDomain::checkpoint(std::vector<uint64_t> *offsets) {
+  if (!this->is_open()) return false;
+  offsets->clear();
+  if (m_use_compression) {
+    m_compressedio_pressure->end_member();
+    if (m_compressedio_wind) m_compressedio_wind->end_member();
+  }
+  offsets->push_back(m_ofstream_pressure.commit());
+  if (!m_windFile.empty()) offsets->push_back(m_ofstream_wind.commit());
+  return true;
+}
+
 void OwiAsciiDomain::close() { this->_close(); }
 
 void OwiAsciiDomain::_close() {
   if (m_ofstream_pressure.is_open()) {
-    if (m_use_compression) m_compressedio_pressure.reset(nullptr);
+    if (m_use_compression) {
+      m_compressedio_pressure->close();
+      m_compressed_stream_pressure.rdbuf(nullptr);
+      m_compressedio_pressure.reset(nullptr);
+    }
     m_ofstream_pressure.close();
   }
   if (m_ofstream_wind.is_open()) {
-    if (m_use_compression) m_compressedio_wind.reset(nullptr);
+    if (m_use_compression) {
+      m_compressedio_wind->close();
+      m_compressed_stream_wind.rdbuf(nullptr);
+      m_compressedio_wind.reset(nullptr);
+    }
     m_ofstream_wind.close();
   }
   this->set_open(false);
@@ -153,18 +234,13 @@ int OwiAsciiDomain::write(
     metbuild_throw_exception("Attempt to write past file end date");
   }
 
-  auto header = generateRecordHeader(date, this->grid());
-  if (m_use_compression) {
-    m_ofstream_pressure << header;
-  } else {
-    m_ofstream_pressure << header;
-  }
-
-  if (m_use_compression) {
-    OwiAsciiDomain::write_record(&m_compressed_stream_pressure, data[0]);
-  } else {
-    OwiAsciiDomain::write_record(&m_ofstream_pressure, data[0]);
-  }
+  m_pressure_record.clear();
+  appendRecordHeader(date, this->grid(), &m_pressure_record);
+  this->append_field(data, 0, &m_pressure_constants, &m_pressure_record,
+                     &m_pressure_blocks);
+  this->pressure_stream()->write(
+      m_pressure_record.data(),
+      static_cast<std::streamsize>(m_pressure_record.size()));
 
   m_previousDate = date;
 
@@ -185,20 +261,28 @@ int OwiAsciiDomain::write(
     metbuild_throw_exception("Attempt to write past file end date");
   }
 
-  auto header = generateRecordHeader(date, this->grid());
-  if (m_use_compression) {
-    m_compressed_stream_pressure << header;
-    m_compressed_stream_wind << header;
-    OwiAsciiDomain::write_record(&m_compressed_stream_pressure, data[2]);
-    OwiAsciiDomain::write_record(&m_compressed_stream_wind, data[0]);
-    OwiAsciiDomain::write_record(&m_compressed_stream_wind, data[1]);
-  } else {
-    m_ofstream_pressure << header;
-    m_ofstream_wind << header;
-    OwiAsciiDomain::write_record(&m_ofstream_pressure, data[2]);
-    OwiAsciiDomain::write_record(&m_ofstream_wind, data[0]);
-    OwiAsciiDomain::write_record(&m_ofstream_wind, data[1]);
-  }
+  //...The pressure and wind records are formatted at the same time into
+  // their own buffers, then each file receives its snap in one write
+  ThreadPool::global().parallel_for(0, 2, [&](const size_t file) {
+    if (file == 0) {
+      m_pressure_record.clear();
+      appendRecordHeader(date, this->grid(), &m_pressure_record);
+      this->append_field(data, 2, &m_pressure_constants, &m_pressure_record,
+                         &m_pressure_blocks);
+    } else {
+      m_wind_record.clear();
+      appendRecordHeader(date, this->grid(), &m_wind_record);
+      this->append_field(data, 0, &m_wind_constants, &m_wind_record,
+                         &m_wind_blocks);
+      this->append_field(data, 1, &m_wind_constants, &m_wind_record,
+                         &m_wind_blocks);
+    }
+  });
+  this->pressure_stream()->write(
+      m_pressure_record.data(),
+      static_cast<std::streamsize>(m_pressure_record.size()));
+  this->wind_stream()->write(
+      m_wind_record.data(), static_cast<std::streamsize>(m_wind_record.size()));
 
   m_previousDate = date;
 
@@ -239,32 +323,130 @@ std::string OwiAsciiDomain::formatHeaderCoordinates(const float value) {
   }
 }
 
-std::string OwiAsciiDomain::generateRecordHeader(const Date &date,
-                                                 const Grid *grid) {
-  auto lon_string = formatHeaderCoordinates(grid->bottom_left().x());
-  auto lat_string = formatHeaderCoordinates(grid->bottom_left().y());
-  return fmt::format(
+/**
+ * @brief Appends the header line of a record to a buffer. The buffer is
+ * reused between records, so a warm domain formats its headers without
+ * allocating
+ */
+void OwiAsciiDomain::appendRecordHeader(const Date &date, const Grid *grid,
+                                        std::string *buffer) {
+  const auto lon_string = formatHeaderCoordinates(grid->bottom_left().x());
+  const auto lat_string = formatHeaderCoordinates(grid->bottom_left().y());
+  fmt::format_to(
+      std::back_inserter(*buffer),
       "iLat={:4d}iLong={:4d}DX={:6.4f}DY={:6.4f}SWLat={:8s}SWLon={:8s}DT="
       "{:04d}{:02d}{:02d}{:02d}{:02d}\n",
       grid->nj(), grid->ni(), grid->dy(), grid->dx(), lat_string, lon_string,
       date.year(), date.month(), date.day(), date.hour(), date.minute());
 }
 
-void OwiAsciiDomain::write_record(
-    std::ostream *stream,
-    const std::vector<std::vector<MetBuild::MeteorologicalDataType>> &value)
-    const {
-  constexpr size_t num_records_per_line = 8;
-  size_t n = 0;
-  for (size_t j = 0; j < this->grid()->nj(); ++j) {
-    for (size_t i = 0; i < this->grid()->ni(); ++i) {
-      fmt::print(*(stream), "{:10.4f}", value[j][i]);
-      n++;
-      if (n == num_records_per_line) {
-        *(stream) << "\n";
+std::ostream *OwiAsciiDomain::pressure_stream() {
+  if (m_use_compression) return &m_compressed_stream_pressure;
+  return &m_ofstream_pressure;
+}
+
+std::ostream *OwiAsciiDomain::wind_stream() {
+  if (m_use_compression) return &m_compressed_stream_wind;
+  return &m_ofstream_wind;
+}
+
+/**
+ * @brief Appends a record to a buffer, eight values per line
+ *
+ * The record is formatted in blocks of whole lines on the thread pool, each
+ * into its own buffer, and the blocks are then appended in order. Every
+ * block starts on a multiple of eight values, so the lines wrap across the
+ * rows of the grid just as they would if formatted in one pass
+ *
+ * @param value field to format
+ * @param buffer destination, grown as needed
+ * @param blocks scratch buffers, one per block, kept between records
+ */
+void OwiAsciiDomain::format_record(
+    MetBuild::Span2d<const MetBuild::MeteorologicalDataType> value,
+    std::string *buffer, std::vector<std::string> *blocks) const {
+  constexpr size_t max_line = c_max_field_width * c_records_per_line + 1;
+  constexpr size_t block_values = c_format_block_lines * c_records_per_line;
+
+  const size_t ni = this->grid()->ni();
+  const size_t n_values = ni * this->grid()->nj();
+  const size_t n_blocks = (n_values + block_values - 1) / block_values;
+  Instrumentation::ScopedTimer timer(Instrumentation::FORMAT);
+  if (blocks->size() < n_blocks) blocks->resize(n_blocks);
+
+  ThreadPool::global().parallel_for(0, n_blocks, [&](const size_t b) {
+    auto &block = (*blocks)[b];
+    const size_t first = b * block_values;
+    const size_t last = std::min(n_values, first + block_values);
+    block.resize((c_field_width * c_records_per_line + 1) *
+                     ((last - first) / c_records_per_line + 1) +
+                 max_line);
+    size_t pos = 0;
+    size_t n = 0;
+    size_t j = first / ni;
+    size_t i = first % ni;
+    for (size_t k = first; k < last; ++k) {
+      if (n == 0 && block.size() - pos < max_line) {
+        block.resize(2 * block.size() + max_line);
+      }
+      pos += format_record_value(value[j][i], &block[pos]);
+      if (++i == ni) {
+        i = 0;
+        ++j;
+      }
+      if (++n == c_records_per_line) {
+        block[pos++] = '\n';
         n = 0;
       }
     }
+    block.resize(pos);
+  });
+
+  const size_t begin = buffer->size();
+  size_t total = 1;
+  for (size_t b = 0; b < n_blocks; ++b) total += (*blocks)[b].size();
+  buffer->reserve(begin + total);
+  for (size_t b = 0; b < n_blocks; ++b) buffer->append((*blocks)[b]);
+  buffer->push_back('\n');
+  timer.add_items(buffer->size() - begin);
+}
+
+/**
+ * @brief Appends one parameter of a field to a record
+ *
+ * Fields filled with a single value, such as the steps outside the source
+ * coverage, are formatted the first time each value is seen and the cached
+ * body is appended for every later step. The grid of a domain never
+ * changes, so the cached bytes match those format_record would produce
+ *
+ * @param data field to format
+ * @param index parameter of the field
+ * @param constants bodies of the constant fields already formatted for the
+ * file
+ * @param buffer destination, grown as needed
+ * @param blocks scratch buffers, one per block, kept between records
+ */
+template <unsigned N>
+void OwiAsciiDomain::append_field(
+    const MeteorologicalData<N, MeteorologicalDataType> &data,
+    const size_t index, std::vector<ConstantRecord> *constants,
+    std::string *buffer, std::vector<std::string> *blocks) const {
+  if (!data.constant(index) || data.parameter(index).size() == 0) {
+    this->format_record(data[index], buffer, blocks);
+    return;
+  }
+  const auto value = data.parameter(index)[0];
+  //...Compared bitwise so that values printed differently, such as -0.0 and
+  // 0.0, keep their own records
+  auto it = std::find_if(constants->begin(), constants->end(),
+                         [value](const ConstantRecord &r) {
+                           return std::memcmp(&r.value, &value,
+                                              sizeof(value)) == 0;
+                         });
+  if (it == constants->end()) {
+    ConstantRecord record{value, {}};
+    this->format_record(data[index], &record.body, blocks);
+    it = constants->insert(constants->end(), std::move(record));
   }
-  *(stream) << "\n";
+  buffer->append(it->body);
 }
@@ -29,15 +29,18 @@
 #ifndef METGET_LIBRARY_OWIASCIIDOMAIN_H_
 #define METGET_LIBRARY_OWIASCIIDOMAIN_H_
 
-#include <fstream>
 #include <memory>
+#include <ostream>
 #include <string>
 #include <vector>
 
 #include "Date.h"
+#include "FileSink.h"
 #include "Grid.h"
 #include "MeteorologicalData.h"
 #include "OutputDomain.h"
+#include "ParallelCompressionBuffer.h"
+#include "StreamCompression.h"
 
 namespace MetBuild {
 
@@ -46,11 +49,14 @@ class OwiAsciiDomain : public OutputDomain {
   OwiAsciiDomain(const MetBuild::Grid *grid, const MetBuild::Date &startDate,
                  const MetBuild::Date &endDate, unsigned time_step,
                  const std::string &pressureFile, const std::string &windFile,
-                 const bool use_compression);
+                 MetBuild::StreamCompression::Codec codec,
+                 const MetBuild::ResumePoint *resume = nullptr);
 
   OwiAsciiDomain(const MetBuild::Grid *grid, const MetBuild::Date &startDate,
                  const MetBuild::Date &endDate, unsigned time_step,
-                 const std::string &pressureFile, const bool use_compression);
+                 const std::string &pressureFile,
+                 MetBuild::StreamCompression::Codec codec,
+                 const MetBuild::ResumePoint *resume = nullptr);
 
   ~OwiAsciiDomain() override;
 
@@ -68,37 +74,58 @@ class OwiAsciiDomain : public OutputDomain {
 
   void close() override;
 
+  bool checkpoint(std::vector<uint64_t> *offsets) override;
+
  private:
+  /**
+   * @brief Formatted body of a field holding a single value
+   */
+  struct ConstantRecord {
+    MetBuild::MeteorologicalDataType value;
+    std::string body;
+  };
+
   void _open();
   void _close();
   void write_header();
 
   static std::string formatHeaderCoordinates(float value);
   static std::string generateHeaderLine(const Date &date1, const Date &date2);
-  static std::string generateRecordHeader(const Date &date, const Grid *grid);
+  static void appendRecordHeader(const Date &date, const Grid *grid,
+                                 std::string *buffer);
+
+  std::ostream *pressure_stream();
+  std::ostream *wind_stream();
+
+  void format_record(
+      MetBuild::Span2d<const MetBuild::MeteorologicalDataType> value,
+      std::string *buffer, std::vector<std::string> *blocks) const;
 
-  void write_record(
-      std::ostream *stream,
-      const std::vector<std::vector<MetBuild::MeteorologicalDataType>> &value)
-      const;
+  template <unsigned N>
+  void append_field(
+      const MetBuild::MeteorologicalData<N, MetBuild::MeteorologicalDataType>
+          &data,
+      size_t index, std::vector<ConstantRecord> *constants, std::string *buffer,
+      std::vector<std::string> *blocks) const;
 
   Date m_previousDate;
-  std::ofstream m_ofstream_pressure;
-  std::ofstream m_ofstream_wind;
-  std::unique_ptr<boost::iostreams::filtering_streambuf<
-      boost::iostreams::output, char, std::char_traits<char>,
-      std::allocator<char>, boost::iostreams::public_>>
-      m_compressedio_pressure;
-  std::unique_ptr<boost::iostreams::filtering_streambuf<
-      boost::iostreams::output, char, std::char_traits<char>,
-      std::allocator<char>, boost::iostreams::public_>>
-      m_compressedio_wind;
+  MetBuild::FileSink m_ofstream_pressure;
+  MetBuild::FileSink m_ofstream_wind;
+  std::unique_ptr<MetBuild::ParallelCompressionBuffer> m_compressedio_pressure;
+  std::unique_ptr<MetBuild::ParallelCompressionBuffer> m_compressedio_wind;
   std::ostream m_compressed_stream_pressure;
   std::ostream m_compressed_stream_wind;
+  const MetBuild::StreamCompression::Codec m_codec;
   const bool m_use_compression;
   const int m_default_compression_level;
   const std::string m_pressureFile;
   const std::string m_windFile;
+  std::string m_pressure_record;
+  std::string m_wind_record;
+  std::vector<std::string> m_pressure_blocks;
+  std::vector<std::string> m_wind_blocks;
+  std::vector<ConstantRecord> m_pressure_constants;
+  std::vector<ConstantRecord> m_wind_constants;
 };
 }  // namespace MetBuild
 
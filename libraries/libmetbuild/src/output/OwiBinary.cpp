@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "OwiBinary.h"
+
+#include <cassert>
+
+using namespace MetBuild;
+
+OwiBinary::OwiBinary(const Date& startDate, const Date& endDate,
+                     const unsigned time_step, const bool use_compression)
+    : OutputFile(startDate, endDate, time_step),
+      m_codec(use_compression ? StreamCompression::GZIP
+                              : StreamCompression::NONE) {}
+
+/**
+ * @brief Selects the codec of the domains added afterwards
+ * @param codec codec, which must be available in this build
+ */
+void OwiBinary::set_compression(const StreamCompression::Codec codec) {
+  if (!StreamCompression::available(codec)) {
+    metbuild_throw_exception("The library was built without " +
+                             StreamCompression::name(codec) + " compression");
+  }
+  m_codec = codec;
+}
+
+void OwiBinary::addDomain(const Grid& w,
+                          const std::vector<std::string>& filenames) {
+  if (filenames.size() == 1) {
+    m_domains.push_back(std::make_unique<OwiBinaryDomain>(
+        &w, this->startDate(), this->endDate(), this->timeStep(), filenames[0],
+        m_codec, this->resume_point(m_domains.size())));
+  } else if (filenames.size() == 2) {
+    m_domains.push_back(std::make_unique<OwiBinaryDomain>(
+        &w, this->startDate(), this->endDate(), this->timeStep(), filenames[0],
+        filenames[1], m_codec,
+        this->resume_point(m_domains.size())));
+  } else {
+    metbuild_throw_exception(
+        "Must provide two filenames for OwiBinary format");
+  }
+}
+
+int OwiBinary::write(
+    const Date& date, const size_t domain_index,
+    const MeteorologicalData<1, MeteorologicalDataType>& data) {
+  assert(domain_index < m_domains.size());
+  return this->write_domain(domain_index, date, data);
+}
+
+int OwiBinary::write(
+    const Date& date, const size_t domain_index,
+    const MeteorologicalData<3, MeteorologicalDataType>& data) {
+  assert(domain_index < m_domains.size());
+  return this->write_domain(domain_index, date, data);
+}
+
+void OwiBinary::close_domain(size_t domain) {
+  assert(domain < m_domains.size());
+  this->flush_domain(domain);
+  this->m_domains[domain]->close();
+}
@@ -0,0 +1,268 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "OwiBinaryDomain.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <type_traits>
+
+#include "Logging.h"
+
+using namespace MetBuild;
+
+namespace {
+
+bool little_endian() {
+  const uint16_t one = 1;
+  unsigned char first;
+  std::memcpy(&first, &one, 1);
+  return first == 1;
+}
+
+/**
+ * @brief Reverses the bytes of each value in place on big-endian hosts
+ */
+template <typename T>
+void to_little_endian(T *values, const size_t n) {
+  if (little_endian()) return;
+  for (size_t k = 0; k < n; ++k) {
+    auto *bytes = reinterpret_cast<unsigned char *>(values + k);
+    std::reverse(bytes, bytes + sizeof(T));
+  }
+}
+
+template <typename T>
+void write_value(std::ostream *stream, T value) {
+  to_little_endian(&value, 1);
+  stream->write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+int32_t date_hour(const Date &d) {
+  return ((d.year() * 100 + d.month()) * 100 + d.day()) * 100 + d.hour();
+}
+
+int64_t date_minute(const Date &d) {
+  return static_cast<int64_t>(date_hour(d)) * 100 + d.minute();
+}
+
+}  // namespace
+
+OwiBinaryDomain::OwiBinaryDomain(const MetBuild::Grid *grid,
+                                 const Date &startDate, const Date &endDate,
+                                 const unsigned int time_step,
+                                 const std::string &pressureFile,
+                                 const std::string &windFile,
+                                 const StreamCompression::Codec codec,
+                                 const ResumePoint *resume)
+    : OutputDomain(grid, startDate, endDate, time_step, resume),
+      m_previousDate(startDate - time_step),
+      m_codec(codec),
+      m_use_compression(codec != StreamCompression::NONE),
+      m_default_compression_level(StreamCompression::defaultLevel(codec)),
+      m_pressureFile(pressureFile),
+      m_windFile(windFile) {
+  assert(startDate < endDate);
+  this->m_filenames.push_back(pressureFile);
+  this->m_filenames.push_back(windFile);
+  this->open();
+}
+
+OwiBinaryDomain::OwiBinaryDomain(const MetBuild::Grid *grid,
+                                 const Date &startDate, const Date &endDate,
+                                 const unsigned int time_step,
+                                 const std::string &pressureFile,
+                                 const StreamCompression::Codec codec,
+                                 const ResumePoint *resume)
+    : OutputDomain(grid, startDate, endDate, time_step, resume),
+      m_previousDate(startDate - time_step),
+      m_codec(codec),
+      m_use_compression(codec != StreamCompression::NONE),
+      m_default_compression_level(StreamCompression::defaultLevel(codec)),
+      m_pressureFile(pressureFile) {
+  assert(startDate < endDate);
+  this->m_filenames.push_back(pressureFile);
+  this->open();
+}
+
+OwiBinaryDomain::~OwiBinaryDomain() { this->close(); }
+
+void OwiBinaryDomain::open() {
+  if (this->is_open()) return;
+  const auto resume = this->resume_point();
+  if (resume != nullptr &&
+      resume->offsets.size() != this->m_filenames.size()) {
+    metbuild_throw_exception("The checkpoint does not match the files of "
+                             "the domain");
+  }
+  this->open_stream(&m_pressure, m_pressureFile, 1, 0);
+  if (!m_windFile.empty()) this->open_stream(&m_wind, m_windFile, 2, 1);
+  if (resume != nullptr) {
+    m_previousDate = resume->time;
+    this->clear_resume();
+  }
+  this->set_open(true);
+}
+
+void OwiBinaryDomain::close() {
+  close_stream(&m_pressure);
+  close_stream(&m_wind);
+  this->set_open(false);
+}
+
+void OwiBinaryDomain::open_stream(Stream *s, const std::string &filename,
+                                  const uint32_t fields,
+                                  const size_t index) const {
+  this->open_sink(&s->file, filename, index);
+  if (m_use_compression) {
+    s->compressed = std::make_unique<ParallelCompressionBuffer>(
+        &s->file, m_codec, m_default_compression_level);
+    s->stream.rdbuf(s->compressed.get());
+  } else {
+    s->stream.rdbuf(s->file.rdbuf());
+  }
+
+  //...A resumed file already has its header
+  if (this->resume_point() != nullptr) return;
+  s->stream.write("OWIB", 4);
+  write_value(&s->stream, c_version);
+  write_value(&s->stream, fields);
+  write_value(&s->stream, date_hour(this->startDate()));
+  write_value(&s->stream, date_hour(this->endDate()));
+}
+
+void OwiBinaryDomain::close_stream(Stream *s) {
+  if (!s->file.is_open()) return;
+  if (s->compressed) {
+    s->compressed->close();
+    s->compressed.reset(nullptr);
+  }
+  s->stream.rdbuf(nullptr);
+  s->file.close();
+}
+
+/**
+ * @brief Ends the streams on a member boundary and makes the files durable
+ * up to the last record written
+ */
+bool OwiBinaryDomain::checkpoint(std::vector<uint64_t> *offsets) {
+  if (!this->is_open()) return false;
+  offsets->clear();
+  offsets->push_back(commit_stream(&m_pressure));
+  if (!m_windFile.empty()) offsets->push_back(commit_stream(&m_wind));
+  return true;
+}
+
+uint64_t OwiBinaryDomain::commit_stream(Stream *s) {
+  if (s->compressed) s->compressed->end_member();
+  s->stream.flush();
+  return s->file.commit();
+}
+
+void OwiBinaryDomain::check_date(const Date &date) const {
+  if (!this->is_open()) {
+    metbuild_throw_exception("OWI Domain not open");
+  }
+  if (date != m_previousDate + this->timestep()) {
+    metbuild_throw_exception("Non-constant time spacing detected");
+  }
+  if (date > this->endDate()) {
+    metbuild_throw_exception("Attempt to write past file end date");
+  }
+}
+
+int OwiBinaryDomain::write(
+    const Date &date,
+    const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+        &data) {
+  this->check_date(date);
+  this->write_record_header(&m_pressure.stream, date);
+  this->write_field(&m_pressure.stream, data.parameter(0));
+  m_previousDate = date;
+  return 0;
+}
+
+int OwiBinaryDomain::write(
+    const Date &date,
+    const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+        &data) {
+  this->check_date(date);
+  this->write_record_header(&m_pressure.stream, date);
+  this->write_field(&m_pressure.stream, data.parameter(2));
+  this->write_record_header(&m_wind.stream, date);
+  this->write_field(&m_wind.stream, data.parameter(0));
+  this->write_field(&m_wind.stream, data.parameter(1));
+  m_previousDate = date;
+  return 0;
+}
+
+void OwiBinaryDomain::write_record_header(std::ostream *stream,
+                                          const Date &date) const {
+  RecordHeader h{};
+  h.ilat = static_cast<int32_t>(this->grid()->nj());
+  h.ilong = static_cast<int32_t>(this->grid()->ni());
+  h.dx = static_cast<float>(this->grid()->dx());
+  h.dy = static_cast<float>(this->grid()->dy());
+  h.swlat = static_cast<float>(this->grid()->bottom_left().y());
+  h.swlon = static_cast<float>(this->grid()->bottom_left().x());
+  h.dt = date_minute(date);
+
+  to_little_endian(&h.ilat, 1);
+  to_little_endian(&h.ilong, 1);
+  to_little_endian(&h.dx, 1);
+  to_little_endian(&h.dy, 1);
+  to_little_endian(&h.swlat, 1);
+  to_little_endian(&h.swlon, 1);
+  to_little_endian(&h.dt, 1);
+  stream->write(reinterpret_cast<const char *>(&h), sizeof(h));
+}
+
+/**
+ * @brief Writes one field as float32, straight from the grid buffer when it
+ * is already single precision on a little-endian host
+ * @param stream output stream
+ * @param values field to write
+ */
+void OwiBinaryDomain::write_field(
+    std::ostream *stream,
+    MetBuild::Span<const MetBuild::MeteorologicalDataType> values) {
+  if (std::is_same<MeteorologicalDataType, float>::value && little_endian()) {
+    stream->write(reinterpret_cast<const char *>(values.data()),
+                  values.size() * sizeof(float));
+    return;
+  }
+  m_buffer.resize(values.size());
+  std::transform(values.begin(), values.end(), m_buffer.begin(),
+                 [](const MeteorologicalDataType v) {
+                   return static_cast<float>(v);
+                 });
+  to_little_endian(m_buffer.data(), m_buffer.size());
+  stream->write(reinterpret_cast<const char *>(m_buffer.data()),
+                m_buffer.size() * sizeof(float));
+}
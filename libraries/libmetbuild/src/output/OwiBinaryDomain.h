@@ -0,0 +1,146 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METGET_LIBRARY_OWIBINARYDOMAIN_H_
+#define METGET_LIBRARY_OWIBINARYDOMAIN_H_
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Date.h"
+#include "FileSink.h"
+#include "Grid.h"
+#include "MeteorologicalData.h"
+#include "OutputDomain.h"
+#include "ParallelCompressionBuffer.h"
+#include "StreamCompression.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Writes the OWI WIN/PRE content as little-endian binary
+ *
+ * Each file starts with a FileHeader, then has one RecordHeader per snap
+ * followed by fields x nj x ni float32 values, row by row in the same order
+ * as the ASCII records. Pressure (or scalar) files hold one field per snap
+ * and wind files hold u then v. A snap can be read with one fread of the
+ * header and one of the values
+ */
+class OwiBinaryDomain : public OutputDomain {
+ public:
+  static constexpr uint32_t c_version = 1;
+
+#pragma pack(push, 1)
+  struct FileHeader {
+    char magic[4];         // "OWIB"
+    uint32_t version;      // c_version
+    uint32_t fields;       // fields per snap
+    int32_t start;         // YYYYMMDDHH
+    int32_t end;           // YYYYMMDDHH
+  };
+
+  struct RecordHeader {
+    int32_t ilat;          // number of rows
+    int32_t ilong;         // number of columns
+    float dx;
+    float dy;
+    float swlat;
+    float swlon;
+    int64_t dt;            // YYYYMMDDHHMM
+  };
+#pragma pack(pop)
+
+  OwiBinaryDomain(const MetBuild::Grid *grid, const MetBuild::Date &startDate,
+                  const MetBuild::Date &endDate, unsigned time_step,
+                  const std::string &pressureFile, const std::string &windFile,
+                  MetBuild::StreamCompression::Codec codec,
+                  const MetBuild::ResumePoint *resume = nullptr);
+
+  OwiBinaryDomain(const MetBuild::Grid *grid, const MetBuild::Date &startDate,
+                  const MetBuild::Date &endDate, unsigned time_step,
+                  const std::string &pressureFile,
+                  MetBuild::StreamCompression::Codec codec,
+                  const MetBuild::ResumePoint *resume = nullptr);
+
+  ~OwiBinaryDomain() override;
+
+  int write(
+      const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  int write(
+      const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  void open() override;
+
+  void close() override;
+
+  bool checkpoint(std::vector<uint64_t> *offsets) override;
+
+ private:
+  struct Stream {
+    Stream() : stream(nullptr) {}
+    MetBuild::FileSink file;
+    std::unique_ptr<MetBuild::ParallelCompressionBuffer> compressed;
+    std::ostream stream;
+  };
+
+  void open_stream(Stream *s, const std::string &filename, uint32_t fields,
+                   size_t index) const;
+
+  static uint64_t commit_stream(Stream *s);
+  static void close_stream(Stream *s);
+
+  void check_date(const MetBuild::Date &date) const;
+
+  void write_record_header(std::ostream *stream,
+                           const MetBuild::Date &date) const;
+
+  void write_field(
+      std::ostream *stream,
+      MetBuild::Span<const MetBuild::MeteorologicalDataType> values);
+
+  Date m_previousDate;
+  Stream m_pressure;
+  Stream m_wind;
+  std::vector<float> m_buffer;
+  const MetBuild::StreamCompression::Codec m_codec;
+  const bool m_use_compression;
+  const int m_default_compression_level;
+  const std::string m_pressureFile;
+  const std::string m_windFile;
+};
+}  // namespace MetBuild
+
+#endif  // METGET_LIBRARY_OWIBINARYDOMAIN_H_
@@ -28,22 +28,75 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "OwiNcFile.h"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstring>
 #include <stdexcept>
 #include <utility>
 
 #include "Date.h"
+#include "Logging.h"
+#include "boost/filesystem.hpp"
 #include "Utilities.h"
 #include "netcdf.h"
 
 using namespace MetBuild;
 using namespace Utilities;
 
-OwiNcFile::OwiNcFile(std::string filename)
-    : m_filename(std::move(filename)), m_ncid(0) {}
+namespace {
+/**
+ * @brief Variable name and units of a field derived from the wind
+ */
+struct DerivedVariable {
+  const char *name;
+  const char *units;
+};
+
+DerivedVariable derived_variable(const DerivedWind::Field field) {
+  switch (field) {
+    case DerivedWind::WIND_SPEED:
+      return {"WSPD10", "m s-1"};
+    case DerivedWind::WIND_DIRECTION:
+      return {"WDIR10", "degrees"};
+    case DerivedWind::STRESS_U:
+      return {"TAUX", "N m-2"};
+    case DerivedWind::STRESS_V:
+    default:
+      return {"TAUY", "N m-2"};
+  }
+}
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param filename output file
+ * @param append when the file already exists, reopen it and add to or
+ * replace records of its groups instead of starting a new file
+ */
+OwiNcFile::OwiNcFile(std::string filename, const bool append)
+    : m_filename(std::move(filename)),
+      m_append(append),
+      m_ncid(0),
+      m_compression(NetcdfCompression::defaults()) {}
+
+/**
+ * @brief Constructor for a file shared by the ranks of a parallel build,
+ * each writing the records of its own time shard
+ * @param filename output file, created collectively
+ * @param parallel communicator and time span of the whole request
+ */
+OwiNcFile::OwiNcFile(std::string filename, const NetcdfParallel& parallel)
+    : m_filename(std::move(filename)),
+      m_append(false),
+      m_ncid(0),
+      m_compression(NetcdfCompression::defaults()),
+      m_parallel(parallel) {}
 
 OwiNcFile::~OwiNcFile() {
   if (m_ncid != 0) {
+    //...Pending time steps go out before the file is closed
+    m_buffers.clear();
     std::string group_order;
     for (size_t i = 0; i < m_groups.size(); ++i) {
       if (i + 1 < m_groups.size()) {
@@ -63,8 +116,42 @@ int OwiNcFile::ncid() const { return m_ncid; }
 
 std::vector<OwiNcFile::NcGroup>* OwiNcFile::groups() { return &m_groups; }
 
+/**
+ * @brief Communicator the file is shared over, null for a serial file
+ */
+const NetcdfParallel* OwiNcFile::parallel() const {
+  return m_parallel ? &*m_parallel : nullptr;
+}
+
+/**
+ * @brief Sets the chunking and compression of groups added after this call
+ * @param compression compression policy
+ */
+void OwiNcFile::set_compression(const NetcdfCompression& compression) {
+  m_compression = compression;
+}
+
+/**
+ * @brief Selects the fields derived from the wind which are written by the
+ * groups added after this call
+ * @param derived derived fields and drag formula
+ */
+void OwiNcFile::set_derived(const DerivedWind& derived) {
+  m_derived = derived;
+}
+
 void OwiNcFile::initialize() {
-  ncCheck(nc_create(m_filename.c_str(), NC_NETCDF4, &m_ncid));
+  if (m_append && boost::filesystem::exists(m_filename)) {
+    ncCheck(nc_open(m_filename.c_str(), NC_WRITE, &m_ncid));
+    this->load_groups();
+    return;
+  }
+
+  if (m_parallel) {
+    m_ncid = m_parallel->create(m_filename);
+  } else {
+    ncCheck(nc_create(m_filename.c_str(), NC_NETCDF4, &m_ncid));
+  }
   constexpr std::string_view metget = "metget";
   constexpr std::string_view conventions = "CF-1.6 OWI-NWS13";
   const auto now = Date::now().toString();
@@ -77,14 +164,217 @@ void OwiNcFile::initialize() {
   ncCheck(nc_enddef(m_ncid));
 }
 
+/**
+ * @brief Reads the groups of a reopened file along with their time axis
+ */
+void OwiNcFile::load_groups() {
+  int n_groups = 0;
+  ncCheck(nc_inq_grps(m_ncid, &n_groups, nullptr));
+  std::vector<int> ids(n_groups);
+  ncCheck(nc_inq_grps(m_ncid, &n_groups, ids.data()));
+
+  for (const auto id : ids) {
+    OwiNcFile::NcGroup grp;
+    grp.grpid = id;
+    grp.existing = true;
+    size_t len = 0;
+    ncCheck(nc_inq_grpname_len(id, &len));
+    grp.name.resize(len + 1);
+    ncCheck(nc_inq_grpname(id, &grp.name[0]));
+    grp.name.resize(len);
+
+    ncCheck(nc_inq_dimid(id, "time", &grp.dimid_time));
+    ncCheck(nc_inq_dimid(id, "xi", &grp.dimid_xi));
+    ncCheck(nc_inq_dimid(id, "yi", &grp.dimid_yi));
+    ncCheck(nc_inq_dimlen(id, grp.dimid_time, &grp.time_length));
+    ncCheck(nc_inq_dimlen(id, grp.dimid_xi, &grp.ni));
+    ncCheck(nc_inq_dimlen(id, grp.dimid_yi, &grp.nj));
+    ncCheck(nc_inq_varid(id, "time", &grp.varid_time));
+    ncCheck(nc_inq_varid(id, "lat", &grp.varid_lat));
+    ncCheck(nc_inq_varid(id, "lon", &grp.varid_lon));
+    ncCheck(nc_inq_varid(id, "U10", &grp.varid_u));
+    ncCheck(nc_inq_varid(id, "V10", &grp.varid_v));
+    ncCheck(nc_inq_varid(id, "PSFC", &grp.varid_press));
+    this->load_derived(grp);
+
+    if (grp.time_length > 0) {
+      long long times[2] = {0, 0};
+      const size_t start = 0;
+      const size_t count = std::min<size_t>(grp.time_length, 2);
+      ncCheck(nc_get_vara_longlong(id, grp.varid_time, &start, &count, times));
+      grp.time_origin = times[0];
+      if (count == 2) grp.time_step = times[1] - times[0];
+    }
+
+    std::vector<int> varids{grp.varid_u, grp.varid_v, grp.varid_press};
+    varids.insert(varids.end(), grp.varid_derived.begin(),
+                  grp.varid_derived.end());
+    m_derived_values.emplace_back(grp.varid_derived.size() * grp.ni * grp.nj);
+    m_groups.push_back(grp);
+    m_buffers.push_back(std::make_unique<NetcdfWriteBuffer<float>>(
+        grp.grpid, grp.varid_time, std::move(varids), grp.nj, grp.ni, 1));
+  }
+}
+
+/**
+ * @brief Finds the derived fields of a group read from an existing file,
+ * which later records keep writing with the drag formula stored in the file
+ */
+void OwiNcFile::load_derived(NcGroup& grp) {
+  auto find = [&](const DerivedWind::Field field) {
+    int varid = 0;
+    const auto v = derived_variable(field);
+    return nc_inq_varid(grp.grpid, v.name, &varid) == NC_NOERR ? varid : -1;
+  };
+
+  unsigned products = 0;
+  if (find(DerivedWind::WIND_SPEED) >= 0) products |= DerivedWind::SPEED;
+  if (find(DerivedWind::WIND_DIRECTION) >= 0) {
+    products |= DerivedWind::DIRECTION;
+  }
+  const int varid_tau = find(DerivedWind::STRESS_U);
+  auto drag = DerivedWind::GARRATT;
+  if (varid_tau >= 0 && find(DerivedWind::STRESS_V) >= 0) {
+    products |= DerivedWind::STRESS;
+    size_t len = 0;
+    if (nc_inq_attlen(grp.grpid, varid_tau, "drag_formula", &len) ==
+        NC_NOERR) {
+      std::string name(len, ' ');
+      ncCheck(nc_get_att_text(grp.grpid, varid_tau, "drag_formula", &name[0]));
+      drag = DerivedWind::dragFromName(name);
+    }
+  }
+
+  grp.derived = DerivedWind(products, drag);
+  for (const auto f : grp.derived.fields()) {
+    grp.varid_derived.push_back(find(f));
+  }
+}
+
+/**
+ * @brief Defines the variables of the fields derived from the wind in a new
+ * group
+ */
+void OwiNcFile::define_derived(NcGroup& grp, const int* dims,
+                               const NetcdfCompression& compression) {
+  grp.derived = m_derived;
+  constexpr float nan = MeteorologicalData<1>::flag_value();
+  const auto drag = DerivedWind::dragName(m_derived.drag());
+  for (const auto f : m_derived.fields()) {
+    const auto v = derived_variable(f);
+    int varid = 0;
+    ncCheck(nc_def_var(grp.grpid, v.name, NC_FLOAT, 3, dims, &varid));
+    ncCheck(nc_def_var_fill(grp.grpid, varid, 0, &nan));
+    ncCheck(nc_put_att_text(grp.grpid, varid, "units", std::strlen(v.units),
+                            v.units));
+    ncCheck(nc_put_att(grp.grpid, varid, "coordinates", NC_CHAR, 12,
+                       "time lat lon"));
+    if (f == DerivedWind::STRESS_U || f == DerivedWind::STRESS_V) {
+      ncCheck(nc_put_att_text(grp.grpid, varid, "drag_formula", drag.size(),
+                              drag.data()));
+    }
+    compression.applyField(grp.grpid, varid, grp.nj, grp.ni, true);
+    grp.varid_derived.push_back(varid);
+  }
+}
+
+/**
+ * @brief Checks that an existing group was written on the same grid
+ */
+void OwiNcFile::check_group_grid(const NcGroup& grp,
+                                 const MetBuild::Grid* grid) const {
+  if (grp.ni != grid->ni() || grp.nj != grid->nj()) {
+    metbuild_throw_exception("Grid of group " + grp.name +
+                             " does not match the existing file");
+  }
+
+  //...Corner coordinates of a fixed grid must agree as well
+  int ndims = 0;
+  ncCheck(nc_inq_varndims(grp.grpid, grp.varid_lat, &ndims));
+  if (ndims != 2) return;
+  const auto x = grid->x();
+  const auto y = grid->y();
+  const size_t corners[][2] = {{0, 0}, {grp.nj - 1, grp.ni - 1}};
+  for (const auto& c : corners) {
+    double lat = 0.0;
+    double lon = 0.0;
+    ncCheck(nc_get_var1_double(grp.grpid, grp.varid_lat, c, &lat));
+    ncCheck(nc_get_var1_double(grp.grpid, grp.varid_lon, c, &lon));
+    constexpr double tolerance = 1e-4;
+    const auto k = c[0] * grp.ni + c[1];
+    if (std::abs(lat - y[k]) > tolerance || std::abs(lon - x[k]) > tolerance) {
+      metbuild_throw_exception("Grid of group " + grp.name +
+                               " does not match the existing file");
+    }
+  }
+}
+
+/**
+ * @brief Record index for a time value
+ *
+ * New groups are written in sequence. Groups of a reopened file place the
+ * record by its time, so a later run can replace the tail of the file and
+ * extend it, but may not leave a gap past the last record
+ *
+ * @param group_index group
+ * @param time time value written to the time variable
+ * @param time_step spacing of the records in the same units as time
+ * @return index along the time dimension
+ */
+size_t OwiNcFile::time_index(unsigned group_index, long long time,
+                             unsigned time_step) {
+  auto& grp = m_groups[group_index];
+  if (!grp.existing || grp.time_length == 0) return grp.time_length++;
+
+  if (grp.time_step != 0 && grp.time_step != time_step) {
+    metbuild_throw_exception("Time step of group " + grp.name +
+                             " does not match the existing file");
+  }
+  const long long offset = time - grp.time_origin;
+  if (offset < 0 || offset % time_step != 0) {
+    metbuild_throw_exception("Date is not on the time axis of group " +
+                             grp.name);
+  }
+  const auto index = static_cast<size_t>(offset / time_step);
+  if (index > grp.time_length) {
+    metbuild_throw_exception("Appending to group " + grp.name +
+                             " would leave a gap in the time axis");
+  }
+  grp.time_length = std::max(grp.time_length, index + 1);
+  if (grp.time_step == 0 && index == 1) grp.time_step = time_step;
+  return index;
+}
+
+/**
+ * @brief Adds a group for a domain, or returns the group of the same name
+ * when it already exists
+ * @return index of the group
+ */
 int OwiNcFile::addGroup(const std::string& groupName,
                         const MetBuild::Grid* grid, const bool isMovingGrid) {
+  for (size_t i = 0; i < m_groups.size(); ++i) {
+    if (m_groups[i].name == groupName) {
+      if (m_groups[i].existing) this->check_group_grid(m_groups[i], grid);
+      return static_cast<int>(i);
+    }
+  }
+
+  //...A shared file has its whole time axis from the start, so ranks write
+  // their records anywhere along it without extending the dimension
+  if (m_parallel && isMovingGrid) {
+    metbuild_throw_exception(
+        "Moving grids cannot be written to a shared parallel file");
+  }
+  const size_t time_length = m_parallel ? m_parallel->records() : 0;
+  const auto record_compression =
+      m_parallel ? m_parallel->unfiltered(m_compression) : m_compression;
+
   ncCheck(nc_redef(this->ncid()));
 
   OwiNcFile::NcGroup grp;
   grp.name = groupName;
   ncCheck(nc_def_grp(this->ncid(), groupName.c_str(), &grp.grpid));
-  ncCheck(nc_def_dim(grp.grpid, "time", 0, &grp.dimid_time));
+  ncCheck(nc_def_dim(grp.grpid, "time", time_length, &grp.dimid_time));
   ncCheck(nc_def_dim(grp.grpid, "xi", grid->ni(), &grp.dimid_xi));
   ncCheck(nc_def_dim(grp.grpid, "yi", grid->nj(), &grp.dimid_yi));
   grp.ni = grid->ni();
@@ -148,18 +438,45 @@ int OwiNcFile::addGroup(const std::string& groupName,
   ncCheck(nc_put_att(grp.grpid, grp.varid_time, "calendar", NC_CHAR, 19,
                      "proleptic_gregorian"));
 
-  ncCheck(nc_def_var_deflate(grp.grpid, grp.varid_time, 1, 1, 2));
-  ncCheck(nc_def_var_deflate(grp.grpid, grp.varid_lat, 1, 1, 2));
-  ncCheck(nc_def_var_deflate(grp.grpid, grp.varid_lon, 1, 1, 2));
-  ncCheck(nc_def_var_deflate(grp.grpid, grp.varid_u, 1, 1, 2));
-  ncCheck(nc_def_var_deflate(grp.grpid, grp.varid_v, 1, 1, 2));
-  ncCheck(nc_def_var_deflate(grp.grpid, grp.varid_press, 1, 1, 2));
+  const auto nj = grid->nj();
+  const auto ni = grid->ni();
+  record_compression.applySeries(grp.grpid, grp.varid_time);
+  if (isMovingGrid) {
+    m_compression.applyField(grp.grpid, grp.varid_lat, nj, ni, false);
+    m_compression.applyField(grp.grpid, grp.varid_lon, nj, ni, false);
+  } else {
+    m_compression.applyGrid(grp.grpid, grp.varid_lat, nj, ni);
+    m_compression.applyGrid(grp.grpid, grp.varid_lon, nj, ni);
+  }
+  record_compression.applyField(grp.grpid, grp.varid_u, nj, ni, true);
+  record_compression.applyField(grp.grpid, grp.varid_v, nj, ni, true);
+  record_compression.applyField(grp.grpid, grp.varid_press, nj, ni, true);
+  this->define_derived(grp, dim3d, record_compression);
 
+  std::vector<int> varids{grp.varid_u, grp.varid_v, grp.varid_press};
+  varids.insert(varids.end(), grp.varid_derived.begin(),
+                grp.varid_derived.end());
+  m_derived_values.emplace_back(grp.varid_derived.size() * nj * ni);
   this->groups()->push_back(grp);
+  m_buffers.push_back(std::make_unique<NetcdfWriteBuffer<float>>(
+      grp.grpid, grp.varid_time, std::move(varids), nj, ni,
+      m_compression.timeSteps()));
   int rank = static_cast<int>(this->groups()->size());
   ncCheck(nc_put_att_int(grp.grpid, NC_GLOBAL, "rank", NC_INT, 1, &rank));
   ncCheck(nc_enddef(this->ncid()));
 
+  if (m_parallel) {
+    m_parallel->collective(grp.grpid, grp.varid_lat);
+    m_parallel->collective(grp.grpid, grp.varid_lon);
+    for (const auto varid :
+         {grp.varid_time, grp.varid_u, grp.varid_v, grp.varid_press}) {
+      m_parallel->independent(grp.grpid, varid);
+    }
+    for (const auto varid : grp.varid_derived) {
+      m_parallel->independent(grp.grpid, varid);
+    }
+  }
+
   if (!isMovingGrid) {
     const auto x = grid->x();
     const auto y = grid->y();
@@ -171,45 +488,50 @@ int OwiNcFile::addGroup(const std::string& groupName,
         nc_put_vara_double(grp.grpid, grp.varid_lon, start, count, x.data()));
   }
 
-  return 0;
+  return static_cast<int>(m_groups.size() - 1);
 }
 
 int OwiNcFile::write(unsigned group_index, size_t time_index, size_t time,
-                     const std::vector<float>& u, const std::vector<float>& v,
-                     const std::vector<float>& p) {
-  const size_t start[] = {time_index, 0, 0};
-  const size_t count[] = {1, m_groups[group_index].nj,
-                          m_groups[group_index].ni};
-  constexpr size_t one = 1;
-  const auto time_long = static_cast<long long>(time);
-
-  ncCheck(nc_put_vara_longlong(m_groups[group_index].grpid,
-                               m_groups[group_index].varid_time, &time_index,
-                               &one, &time_long));
-  ncCheck(nc_put_vara_float(m_groups[group_index].grpid,
-                            m_groups[group_index].varid_u, start, count,
-                            u.data()));
-  ncCheck(nc_put_vara_float(m_groups[group_index].grpid,
-                            m_groups[group_index].varid_v, start, count,
-                            v.data()));
-  ncCheck(nc_put_vara_float(m_groups[group_index].grpid,
-                            m_groups[group_index].varid_press, start, count,
-                            p.data()));
+                     MetBuild::Span<const float> u,
+                     MetBuild::Span<const float> v,
+                     MetBuild::Span<const float> p) {
+  const auto& grp = m_groups[group_index];
+  if (grp.derived.empty()) {
+    const std::array<Span<const float>, 3> fields = {u, v, p};
+    m_buffers[group_index]->append(time_index, static_cast<double>(time),
+                                   fields);
+    return 0;
+  }
 
+  //...Derived fields are computed from the record about to be written, in
+  // a single pass over the two wind components
+  const size_t cells = grp.ni * grp.nj;
+  auto& values = m_derived_values[group_index];
+  std::vector<float*> out;
+  std::vector<Span<const float>> fields = {u, v, p};
+  for (size_t k = 0; k < grp.varid_derived.size(); ++k) {
+    out.push_back(values.data() + k * cells);
+    fields.emplace_back(out.back(), cells);
+  }
+  grp.derived.compute(cells, u.data(), v.data(), out.data());
+  m_buffers[group_index]->append(time_index, static_cast<double>(time),
+                                 fields.data(), fields.size());
   return 0;
 }
 
 int OwiNcFile::write(unsigned group_index, size_t time_index, size_t time,
-                     const std::vector<float>& x, const std::vector<float>& y,
-                     const std::vector<float>& u, const std::vector<float>& v,
-                     const std::vector<float>& p) {
+                     MetBuild::Span<const float> x,
+                     MetBuild::Span<const float> y,
+                     MetBuild::Span<const float> u,
+                     MetBuild::Span<const float> v,
+                     MetBuild::Span<const float> p) {
+  const auto& grp = m_groups[group_index];
   const size_t start[] = {time_index, 0, 0};
-  const size_t count[] = {1, m_groups[group_index].ni,
-                          m_groups[group_index].nj};
+  const size_t count[] = {1, grp.nj, grp.ni};
 
-  ncCheck(nc_put_vara_float(this->ncid(), m_groups[group_index].varid_lon,
-                            start, count, x.data()));
-  ncCheck(nc_put_vara_float(this->ncid(), m_groups[group_index].varid_lat,
-                            start, count, y.data()));
+  ncCheck(
+      nc_put_vara_float(grp.grpid, grp.varid_lon, start, count, x.data()));
+  ncCheck(
+      nc_put_vara_float(grp.grpid, grp.varid_lat, start, count, y.data()));
   return this->write(group_index, time_index, time, u, v, p);
 }
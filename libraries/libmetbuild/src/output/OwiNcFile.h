@@ -29,11 +29,18 @@
 #ifndef METGET_SRC_OWINCFILE_H_
 #define METGET_SRC_OWINCFILE_H_
 
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "Grid.h"
+#include "DerivedWind.h"
 #include "MeteorologicalData.h"
+#include "NetcdfCompression.h"
+#include "NetcdfParallel.h"
+#include "NetcdfWriteBuffer.h"
+#include "Span.h"
 
 namespace MetBuild {
 
@@ -50,7 +57,13 @@ class OwiNcFile {
           varid_lon(0),
           varid_press(0),
           varid_u(0),
-          varid_v(0) {}
+          varid_v(0),
+          ni(0),
+          nj(0),
+          existing(false),
+          time_length(0),
+          time_origin(0),
+          time_step(0) {}
     int grpid;
     int dimid_time;
     int dimid_xi;
@@ -64,33 +77,64 @@ class OwiNcFile {
     size_t ni;
     size_t nj;
     std::string name;
+    bool existing;         // group was read from an existing file
+    size_t time_length;    // records currently in the group
+    long long time_origin; // first time value of an existing group
+    long long time_step;   // spacing of an existing group, 0 if unknown
+    DerivedWind derived;
+    std::vector<int> varid_derived;
   };
 
-  explicit OwiNcFile(std::string filename);
+  explicit OwiNcFile(std::string filename, bool append = false);
+
+  OwiNcFile(std::string filename, const NetcdfParallel &parallel);
 
   ~OwiNcFile();
 
   int ncid() const;
   std::vector<OwiNcFile::NcGroup> *groups();
+  const NetcdfParallel *parallel() const;
 
   void initialize();
 
+  void set_compression(const NetcdfCompression &compression);
+
+  void set_derived(const DerivedWind &derived);
+
   int addGroup(const std::string &groupName, const MetBuild::Grid *grid,
                bool isMovingGrid = false);
 
+  size_t time_index(unsigned group_index, long long time,
+                    unsigned time_step);
+
   int write(unsigned group_index, size_t time_index, size_t time,
-            const std::vector<float> &u, const std::vector<float> &v,
-            const std::vector<float> &p);
+            MetBuild::Span<const float> u, MetBuild::Span<const float> v,
+            MetBuild::Span<const float> p);
 
   int write(unsigned group_index, size_t time_index, size_t time,
-            const std::vector<float> &x, const std::vector<float> &y,
-            const std::vector<float> &u, const std::vector<float> &v,
-            const std::vector<float> &p);
+            MetBuild::Span<const float> x, MetBuild::Span<const float> y,
+            MetBuild::Span<const float> u, MetBuild::Span<const float> v,
+            MetBuild::Span<const float> p);
 
  private:
+  void load_groups();
+
+  void check_group_grid(const NcGroup &grp, const MetBuild::Grid *grid) const;
+
+  void define_derived(NcGroup &grp, const int *dims,
+                      const NetcdfCompression &compression);
+
+  void load_derived(NcGroup &grp);
+
   std::string m_filename;
+  const bool m_append;
   int m_ncid;
   std::vector<NcGroup> m_groups;
+  std::vector<std::unique_ptr<NetcdfWriteBuffer<float>>> m_buffers;
+  std::vector<std::vector<float>> m_derived_values;
+  NetcdfCompression m_compression;
+  DerivedWind m_derived;
+  std::optional<NetcdfParallel> m_parallel;
 };
 }  // namespace MetBuild
 
@@ -32,21 +32,56 @@ using namespace MetBuild;
 
 OwiNetcdf::OwiNetcdf(const MetBuild::Date &date_start,
                      const MetBuild::Date &date_end, unsigned time_step,
-                     std::string filename)
+                     std::string filename, const bool append)
     : OutputFile(date_start, date_end, time_step),
-      m_ncfile(std::move(filename)) {
+      m_ncfile(filename, append),
+      m_filename(std::move(filename)) {
   this->m_ncfile.initialize();
-  this->m_filename = filename;
+}
+
+/**
+ * @brief Constructor for a file shared by the ranks of a parallel build. The
+ * output covers the time shard of this rank
+ * @param parallel communicator and time span of the whole request
+ * @param filename output file, created collectively
+ */
+OwiNetcdf::OwiNetcdf(const NetcdfParallel &parallel, std::string filename)
+    : OutputFile(parallel.shardStart(), parallel.shardEnd(),
+                 parallel.timeStep()),
+      m_ncfile(filename, parallel),
+      m_filename(std::move(filename)) {
+  this->m_ncfile.initialize();
+}
+
+OwiNetcdf::~OwiNetcdf() {
+  //...The domains write through m_ncfile, which is closed before the base
+  // class members are destroyed
+  this->stop_writers();
 }
 
 std::vector<std::string> OwiNetcdf::filenames() const {
   return {m_filename};
 }
 
+/**
+ * @brief Sets the chunking and compression of domains added after this call
+ * @param compression compression policy
+ */
+void OwiNetcdf::set_compression(const NetcdfCompression &compression) {
+  m_ncfile.set_compression(compression);
+}
+
+/**
+ * @brief Selects the fields derived from the wind which are written by the
+ * domains added after this call
+ * @param derived derived fields and drag formula
+ */
+void OwiNetcdf::set_derived(const DerivedWind &derived) {
+  m_ncfile.set_derived(derived);
+}
+
 void OwiNetcdf::addDomain(const MetBuild::Grid &w,
                           const std::vector<std::string> &groupNames) {
-  //constexpr bool isMovingGrid = false;
-
   if (groupNames.empty()) {
     metbuild_throw_exception(
         "Must provide the name of the group for OwiNetcdf");
@@ -57,8 +92,27 @@ void OwiNetcdf::addDomain(const MetBuild::Grid &w,
       &m_ncfile));
 }
 
+/**
+ * @brief Adds a domain following a storm. Records of the domain are given on
+ * the envelope of the grid and the box at each time is written with its own
+ * coordinates
+ * @param grid moving grid, which must outlive the file
+ * @param groupNames name of the group of the domain
+ */
+void OwiNetcdf::addMovingDomain(const MetBuild::MovingGrid &grid,
+                                const std::vector<std::string> &groupNames) {
+  if (groupNames.empty()) {
+    metbuild_throw_exception(
+        "Must provide the name of the group for OwiNetcdf");
+  }
+
+  this->m_domains.push_back(std::make_unique<MetBuild::OwiNetcdfDomain>(
+      &grid, this->startDate(), this->endDate(), this->timeStep(),
+      groupNames[0], &m_ncfile));
+}
+
 int OwiNetcdf::write(
     const Date &date, size_t domain_index,
     const MeteorologicalData<3, MetBuild::MeteorologicalDataType> &data) {
-  return this->m_domains[domain_index]->write(date, data);
+  return this->write_domain(domain_index, date, data);
 }
@@ -41,18 +41,33 @@ namespace MetBuild {
 class OwiNetcdf : public MetBuild::OutputFile {
  public:
   OwiNetcdf(const MetBuild::Date &date_start, const MetBuild::Date &date_end,
-            unsigned time_step, std::string filename);
+            unsigned time_step, std::string filename,
+            bool append = false);
+
+  OwiNetcdf(const NetcdfParallel &parallel, std::string filename);
+
+  ~OwiNetcdf() override;
 
   void addDomain(const MetBuild::Grid &w,
                  const std::vector<std::string> &groupNames) override;
 
+  void addMovingDomain(const MetBuild::MovingGrid &grid,
+                       const std::vector<std::string> &groupNames);
+
   std::vector<std::string> filenames() const override;
 
+  void set_compression(const NetcdfCompression &compression);
+
+  void set_derived(const DerivedWind &derived);
+
   int write(
       const MetBuild::Date &date, size_t domain_index,
       const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
           &data) override;
 
+ protected:
+  bool serialize_domains() const override { return true; }
+
  private:
   MetBuild::OwiNcFile m_ncfile;
   std::string m_filename;
@@ -28,6 +28,7 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "OwiNetcdfDomain.h"
 
+#include <algorithm>
 #include <utility>
 
 MetBuild::OwiNetcdfDomain::OwiNetcdfDomain(const MetBuild::Grid *grid,
@@ -38,26 +39,67 @@ MetBuild::OwiNetcdfDomain::OwiNetcdfDomain(const MetBuild::Grid *grid,
                                            MetBuild::OwiNcFile *netcdf)
     : OutputDomain(grid, startDate, endDate, time_step),
       m_ncFile(netcdf),
-      m_group(m_ncFile->groups()->size()),
-      m_counter(0),
-      m_groupName(std::move(groupName)) {
-  m_ncFile->addGroup(m_groupName, this->grid());
+      m_group(0),
+      m_groupName(std::move(groupName)),
+      m_moving(nullptr) {
+  m_group = m_ncFile->addGroup(m_groupName, this->grid());
+}
+
+/**
+ * @brief Domain following a storm. Records are given on the envelope of the
+ * moving grid and the box at each time is written with its coordinates
+ */
+MetBuild::OwiNetcdfDomain::OwiNetcdfDomain(const MetBuild::MovingGrid *grid,
+                                           const MetBuild::Date &startDate,
+                                           const MetBuild::Date &endDate,
+                                           unsigned int time_step,
+                                           std::string groupName,
+                                           MetBuild::OwiNcFile *netcdf)
+    : OutputDomain(&grid->envelope(), startDate, endDate, time_step),
+      m_ncFile(netcdf),
+      m_group(0),
+      m_groupName(std::move(groupName)),
+      m_moving(grid),
+      m_x(grid->ni() * grid->nj()),
+      m_y(grid->ni() * grid->nj()) {
+  m_group = m_ncFile->addGroup(m_groupName, &m_moving->box(), true);
 }
 
 int MetBuild::OwiNetcdfDomain::write(
     const MetBuild::Date &date,
     const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
         &data) {
-  auto seconds =
-      date.toSeconds() - MetBuild::Date(1990, 1, 1, 1, 0, 0).toSeconds();
+  static const auto reference = MetBuild::Date(1990, 1, 1, 1, 0, 0).toSeconds();
+  const auto seconds = date.toSeconds() - reference;
+  const auto *parallel = this->m_ncFile->parallel();
+  const auto index =
+      parallel ? parallel->record(date)
+               : this->m_ncFile->time_index(m_group, seconds, this->timestep());
+  if (m_moving) {
+    m_moving->window(date, data, m_window);
+    m_moving->positions(date, m_x.data(), m_y.data());
+    this->m_ncFile->write(m_group, index, seconds,
+                          {m_x.data(), m_x.size()}, {m_y.data(), m_y.size()},
+                          m_window.parameter(0), m_window.parameter(1),
+                          m_window.parameter(2));
+    return 0;
+  }
 #ifdef METBUILD_USE_FLOAT
-  this->m_ncFile->write(m_group, m_counter, seconds, data.toVector(0),
-                        data.toVector(1), data.toVector(2));
+  this->m_ncFile->write(m_group, index, seconds, data.parameter(0),
+                        data.parameter(1), data.parameter(2));
 #else
-  auto data2 = MetBuild::MeteorologicalData<3>::recast<3, double, float>(data);
-  this->m_ncFile->write(m_group, m_counter, seconds, data2.toVector(0),
-                        data2.toVector(1), data2.toVector(3));
+  //...The netCDF variables are single precision, so the values are narrowed
+  // into a buffer that is kept between time steps
+  if (m_scratch.ni() != data.ni() || m_scratch.nj() != data.nj()) {
+    m_scratch.resize(data.ni(), data.nj());
+  }
+  for (size_t k = 0; k < 3; ++k) {
+    const auto in = data.parameter(k);
+    std::transform(in.begin(), in.end(), m_scratch.parameter(k).begin(),
+                   [](const double x) { return static_cast<float>(x); });
+  }
+  this->m_ncFile->write(m_group, index, seconds, m_scratch.parameter(0),
+                        m_scratch.parameter(1), m_scratch.parameter(2));
 #endif
-  m_counter++;
   return 0;
 }
@@ -29,9 +29,12 @@
 #ifndef METGET_SRC_OUTPUT_OWINETCDFDOMAIN_H_
 #define METGET_SRC_OUTPUT_OWINETCDFDOMAIN_H_
 
+#include <vector>
+
 #include "Date.h"
 #include "Grid.h"
 #include "MeteorologicalData.h"
+#include "MovingGrid.h"
 #include "OutputDomain.h"
 #include "OwiNcFile.h"
 
@@ -43,9 +46,18 @@ class OwiNetcdfDomain : public OutputDomain {
                   const MetBuild::Date &endDate, unsigned time_step,
                   std::string groupName, MetBuild::OwiNcFile *netcdf);
 
+  OwiNetcdfDomain(const MetBuild::MovingGrid *grid,
+                  const MetBuild::Date &startDate,
+                  const MetBuild::Date &endDate, unsigned time_step,
+                  std::string groupName, MetBuild::OwiNcFile *netcdf);
+
   ~OwiNetcdfDomain() override = default;
 
-  void open() override { this->m_ncFile->addGroup(m_groupName, this->grid()); }
+  void open() override {
+    m_group = m_moving ? this->m_ncFile->addGroup(m_groupName,
+                                                  &m_moving->box(), true)
+                       : this->m_ncFile->addGroup(m_groupName, this->grid());
+  }
   void close() override {}
 
   int write(
@@ -56,8 +68,14 @@ class OwiNetcdfDomain : public OutputDomain {
  private:
   MetBuild::OwiNcFile *m_ncFile;
   unsigned m_group;
-  size_t m_counter;
   const std::string m_groupName;
+  const MetBuild::MovingGrid *m_moving;
+#ifndef METBUILD_USE_FLOAT
+  MetBuild::MeteorologicalData<3, float> m_scratch;
+#endif
+  MetBuild::MeteorologicalData<3, float> m_window;
+  std::vector<float> m_x;
+  std::vector<float> m_y;
 };
 }  // namespace MetBuild
 #endif  // METGET_SRC_OUTPUT_OWINETCDFDOMAIN_H_
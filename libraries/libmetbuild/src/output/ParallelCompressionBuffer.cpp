@@ -0,0 +1,162 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "ParallelCompressionBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <utility>
+
+#include "Instrumentation.h"
+#include "Logging.h"
+#include "ThreadPool.h"
+
+using namespace MetBuild;
+
+/**
+ * @brief Constructor
+ * @param sink stream receiving the compressed output. It must outlive the
+ * buffer or the call to close
+ * @param codec codec of the members, which must be available
+ * @param level codec specific compression level
+ * @param block_size number of uncompressed bytes in each member
+ */
+ParallelCompressionBuffer::ParallelCompressionBuffer(
+    std::ostream *sink, const StreamCompression::Codec codec, int level,
+    size_t block_size)
+    : m_sink(sink),
+      m_codec(codec),
+      m_level(level),
+      m_block_size(std::max<size_t>(block_size, 1)),
+      m_max_pending(2 * ThreadPool::global().size()),
+      m_block(m_block_size),
+      m_block_memory(Instrumentation::COMPRESSION_MEMORY, m_block_size),
+      m_written(false),
+      m_closed(false) {
+  if (!StreamCompression::available(codec)) {
+    metbuild_throw_exception("The library was built without " +
+                             StreamCompression::name(codec) + " compression");
+  }
+  this->setp(m_block.data(), m_block.data() + m_block.size());
+}
+
+ParallelCompressionBuffer::~ParallelCompressionBuffer() {
+  try {
+    this->close();
+  } catch (const std::exception &e) {
+    Logging::logError(e.what());
+  }
+}
+
+/**
+ * @brief Compresses the remaining data and writes every pending member to
+ * the sink. Nothing may be written afterwards
+ */
+void ParallelCompressionBuffer::close() {
+  if (m_closed) return;
+  m_closed = true;
+  //...An empty file still gets one (empty) member so it is a valid stream
+  if (this->pptr() != this->pbase() || (!m_written && m_pending.empty())) {
+    this->submit_block();
+  }
+  this->setp(nullptr, nullptr);
+  this->write_members(0);
+  m_sink->flush();
+}
+
+/**
+ * @brief Compresses the partial block and writes every pending member, so
+ * the sink ends on a member boundary. The file up to that point is a valid
+ * stream and can be appended to later
+ */
+void ParallelCompressionBuffer::end_member() {
+  if (m_closed) return;
+  if (this->pptr() != this->pbase()) this->submit_block();
+  this->write_members(0);
+  m_sink->flush();
+}
+
+ParallelCompressionBuffer::int_type ParallelCompressionBuffer::overflow(
+    int_type ch) {
+  if (m_closed) return traits_type::eof();
+  this->submit_block();
+  if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+    *this->pptr() = traits_type::to_char_type(ch);
+    this->pbump(1);
+  }
+  return traits_type::not_eof(ch);
+}
+
+/**
+ * @brief Writes the members that have finished compressing. The partial
+ * block is kept so a flush does not produce small members
+ */
+int ParallelCompressionBuffer::sync() {
+  while (!m_pending.empty() &&
+         m_pending.front().wait_for(std::chrono::seconds(0)) ==
+             std::future_status::ready) {
+    const auto member = m_pending.front().get();
+    m_pending.pop_front();
+    m_sink->write(member.data(), member.size());
+    m_written = true;
+  }
+  return m_sink->good() ? 0 : -1;
+}
+
+void ParallelCompressionBuffer::submit_block() {
+  std::vector<char> block(m_block.begin(),
+                          m_block.begin() + (this->pptr() - this->pbase()));
+  this->setp(m_block.data(), m_block.data() + m_block.size());
+
+  //...Blocks in flight are counted until their member is compressed
+  Instrumentation::MemoryTracker memory(Instrumentation::COMPRESSION_MEMORY,
+                                        block.capacity());
+  m_pending.push_back(ThreadPool::global().async(
+      [block = std::move(block), codec = m_codec, level = m_level,
+       memory = std::move(memory)]() {
+        Instrumentation::ScopedTimer timer(Instrumentation::COMPRESS,
+                                           block.size());
+        return StreamCompression::compress(codec, block.data(), block.size(),
+                                           level);
+      }));
+  this->write_members(m_max_pending);
+}
+
+/**
+ * @brief Writes members in order until at most max_pending are in flight
+ * @param max_pending number of members allowed to remain in flight
+ */
+void ParallelCompressionBuffer::write_members(size_t max_pending) {
+  while (m_pending.size() > max_pending) {
+    const auto member = m_pending.front().get();
+    m_pending.pop_front();
+    m_sink->write(member.data(), member.size());
+    m_written = true;
+  }
+}
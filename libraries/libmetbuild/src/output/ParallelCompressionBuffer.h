@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_PARALLELCOMPRESSIONBUFFER_H_
+#define METBUILD_SRC_OUTPUT_PARALLELCOMPRESSIONBUFFER_H_
+
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "Instrumentation.h"
+#include "StreamCompression.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Stream buffer that writes compressed output, compressing fixed
+ * size blocks in parallel on the global thread pool
+ *
+ * Each block becomes an independent member, a gzip member or a zstd or lz4
+ * frame, and members are written to the sink in order. Concatenated members
+ * form a standard file that gzip, zstd and lz4 readers decompress as a
+ * single stream
+ */
+class ParallelCompressionBuffer : public std::streambuf {
+ public:
+  ParallelCompressionBuffer(std::ostream *sink,
+                            StreamCompression::Codec codec, int level,
+                            size_t block_size = c_default_block_size);
+
+  ~ParallelCompressionBuffer() override;
+
+  ParallelCompressionBuffer(const ParallelCompressionBuffer &) = delete;
+  ParallelCompressionBuffer &operator=(const ParallelCompressionBuffer &) =
+      delete;
+
+  void close();
+
+  void end_member();
+
+  static constexpr size_t c_default_block_size = 1 << 20;
+
+ protected:
+  int_type overflow(int_type ch) override;
+
+  int sync() override;
+
+ private:
+  void submit_block();
+
+  void write_members(size_t max_pending);
+
+  std::ostream *m_sink;
+  const StreamCompression::Codec m_codec;
+  const int m_level;
+  const size_t m_block_size;
+  const size_t m_max_pending;
+  std::vector<char> m_block;
+  Instrumentation::MemoryTracker m_block_memory;
+  std::deque<std::future<std::string>> m_pending;
+  bool m_written;
+  bool m_closed;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_PARALLELCOMPRESSIONBUFFER_H_
@@ -0,0 +1,274 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "PointNetcdfDomain.h"
+
+#include <array>
+#include <string_view>
+
+#include "Logging.h"
+#include "Utilities.h"
+#include "netcdf.h"
+
+using namespace MetBuild;
+using namespace Utilities;
+
+PointNetcdfDomain::PointNetcdfDomain(const MetBuild::Grid *grid,
+                                     const MetBuild::Date &startDate,
+                                     const MetBuild::Date &endDate,
+                                     unsigned int time_step, const int &ncid,
+                                     std::vector<std::string> variables,
+                                     NetcdfCompression compression)
+    : OutputDomain(grid, startDate, endDate, time_step),
+      m_counter(0),
+      m_ncid(ncid),
+      m_dimid_node(0),
+      m_dimid_time(0),
+      m_varid_x(0),
+      m_varid_y(0),
+      m_varid_time(0),
+      m_varid_crs(0),
+      m_varid_cell(0),
+      m_variables(std::move(variables)),
+      m_compression(std::move(compression)) {
+  if (const auto *mask = grid->mask()) {
+    for (size_t cell = 0; cell < mask->size(); ++cell) {
+      if ((*mask)[cell] != 0) m_cells.push_back(cell);
+    }
+    if (m_cells.empty()) {
+      metbuild_throw_exception("The grid mask does not include any cell");
+    }
+  }
+  this->initialize();
+}
+
+/**
+ * @brief Offset of a date from the start date in minutes
+ */
+double PointNetcdfDomain::time_offset(const MetBuild::Date &date) const {
+  return static_cast<double>(date.toSeconds() - this->startDate().toSeconds()) /
+         60.0;
+}
+
+/**
+ * @brief Values of the cells written, in output order. Without a mask the
+ * fields are written as they are
+ */
+template <unsigned N>
+std::array<Span<const MeteorologicalDataType>, N> PointNetcdfDomain::gather(
+    const MetBuild::MeteorologicalData<N, MeteorologicalDataType> &data) {
+  std::array<Span<const MeteorologicalDataType>, N> fields;
+  for (unsigned f = 0; f < N; ++f) {
+    const auto values = data.parameter(f);
+    if (m_cells.empty()) {
+      fields[f] = values;
+      continue;
+    }
+    auto &gathered = m_gathered[f];
+    gathered.resize(m_cells.size());
+    for (size_t k = 0; k < m_cells.size(); ++k) {
+      gathered[k] = values[m_cells[k]];
+    }
+    fields[f] = {gathered.data(), gathered.size()};
+  }
+  return fields;
+}
+
+/**
+ * @brief Defines the file. Every cell of the grid is a point of the series,
+ * except that a masked grid only writes the cells masked in, listed by the
+ * cell variable as a CF compression by gathering of the (y, x) grid
+ */
+void PointNetcdfDomain::initialize() {
+  const auto ni = this->grid()->ni();
+  const auto nj = this->grid()->nj();
+  const auto n = m_cells.empty() ? ni * nj : m_cells.size();
+  const auto grid_unit = this->guessGridUnits();
+  const bool degrees = grid_unit == "deg";
+
+  ncCheck(nc_def_dim(m_ncid, "node", n, &m_dimid_node));
+  ncCheck(nc_def_dim(m_ncid, "time", NC_UNLIMITED, &m_dimid_time));
+
+  if (!m_cells.empty()) {
+    int dimid_y = 0;
+    int dimid_x = 0;
+    ncCheck(nc_def_dim(m_ncid, "y", nj, &dimid_y));
+    ncCheck(nc_def_dim(m_ncid, "x", ni, &dimid_x));
+    ncCheck(nc_def_var(m_ncid, "cell", NC_INT64, 1, &m_dimid_node,
+                       &m_varid_cell));
+    constexpr std::string_view long_name = "index of the cell in the grid";
+    ncCheck(nc_put_att_text(m_ncid, m_varid_cell, "long_name",
+                            long_name.size(), &long_name[0]));
+    ncCheck(nc_put_att_text(m_ncid, m_varid_cell, "compress", 3, "y x"));
+    m_compression.applySeries(m_ncid, m_varid_cell, n);
+  }
+
+  const int one[] = {1};
+  const int twod[] = {m_dimid_time, m_dimid_node};
+#ifdef METBUILD_USE_FLOAT
+  const float fill = MeteorologicalData<1>::flag_value();
+#else
+  const double fill = MeteorologicalData<1>::flag_value();
+#endif
+
+  // X
+  ncCheck(nc_def_var(m_ncid, degrees ? "lon" : "x", NC_DOUBLE, 1,
+                     &m_dimid_node, &m_varid_x));
+  if (degrees) {
+    ncCheck(nc_put_att_text(m_ncid, m_varid_x, "standard_name", 9,
+                            "longitude"));
+    ncCheck(nc_put_att_text(m_ncid, m_varid_x, "long_name", 9, "Longitude"));
+    ncCheck(nc_put_att_text(m_ncid, m_varid_x, "units", 12, "degrees_east"));
+  } else {
+    ncCheck(
+        nc_put_att_text(m_ncid, m_varid_x, "long_name", 12, "x coordinate"));
+    ncCheck(nc_put_att_text(m_ncid, m_varid_x, "units", grid_unit.size(),
+                            &grid_unit[0]));
+  }
+  m_compression.applySeries(m_ncid, m_varid_x, n);
+
+  // Y
+  ncCheck(nc_def_var(m_ncid, degrees ? "lat" : "y", NC_DOUBLE, 1,
+                     &m_dimid_node, &m_varid_y));
+  if (degrees) {
+    ncCheck(
+        nc_put_att_text(m_ncid, m_varid_y, "standard_name", 8, "latitude"));
+    ncCheck(nc_put_att_text(m_ncid, m_varid_y, "long_name", 8, "Latitude"));
+    ncCheck(nc_put_att_text(m_ncid, m_varid_y, "units", 13, "degrees_north"));
+  } else {
+    ncCheck(
+        nc_put_att_text(m_ncid, m_varid_y, "long_name", 12, "y coordinate"));
+    ncCheck(nc_put_att_text(m_ncid, m_varid_y, "units", grid_unit.size(),
+                            &grid_unit[0]));
+  }
+  m_compression.applySeries(m_ncid, m_varid_y, n);
+
+  // TIME
+  auto referenceTimeString =
+      "minutes since " + this->startDate().toString("%F %T");
+  ncCheck(
+      nc_def_var(m_ncid, "time", NC_DOUBLE, 1, &m_dimid_time, &m_varid_time));
+  ncCheck(nc_put_att_text(m_ncid, m_varid_time, "standard_name", 4, "time"));
+  ncCheck(nc_put_att_text(m_ncid, m_varid_time, "long_name", 4, "time"));
+  ncCheck(nc_put_att_text(m_ncid, m_varid_time, "units",
+                          referenceTimeString.size(), &referenceTimeString[0]));
+  ncCheck(nc_put_att_text(m_ncid, m_varid_time, "axis", 1, "T"));
+  m_compression.applySeries(m_ncid, m_varid_time);
+
+  // CRS
+  if (degrees) {
+    ncCheck(nc_def_var(m_ncid, "crs", NC_INT, 0, one, &m_varid_crs));
+    ncCheck(nc_put_att_text(m_ncid, m_varid_crs, "grid_mapping_name", 18,
+                            "latitude_longitude"));
+    ncCheck(nc_put_att_text(m_ncid, m_varid_crs, "epsg_code", 9, "EPSG:4326"));
+  }
+
+  const std::string coordinates = degrees ? "time lat lon" : "time y x";
+  this->m_varids.reserve(m_variables.size());
+  for (const auto &v : m_variables) {
+    std::string long_name;
+    std::string units;
+    if (v == "wind_u") {
+      long_name = "e/w wind velocity";
+      units = "m/s";
+    } else if (v == "wind_v") {
+      long_name = "n/s wind velocity";
+      units = "m/s";
+    } else if (v == "mslp") {
+      long_name = "air pressure at sea level";
+      units = "mb";
+    } else if (v == "rain") {
+      long_name = "Total rainfall accumulation over 1 hour";
+      units = "mm";
+    } else if (v == "humidity") {
+      long_name = "relative humidity in air at ground level";
+      units = "percent";
+    } else if (v == "temperature") {
+      long_name = "air temperature at ground level";
+      units = "degC";
+    }
+
+    int varid = 0;
+#ifdef METBUILD_USE_FLOAT
+    ncCheck(nc_def_var(m_ncid, &v[0], NC_FLOAT, 2, twod, &varid));
+    ncCheck(nc_def_var_fill(m_ncid, varid, NC_FILL, &fill));
+#else
+    ncCheck(nc_def_var(m_ncid, &v[0], NC_DOUBLE, 2, twod, &varid));
+    ncCheck(nc_def_var_fill(m_ncid, varid, NC_FILL, &fill));
+#endif
+    ncCheck(nc_put_att_text(m_ncid, varid, "long_name", long_name.size(),
+                            &long_name[0]));
+    ncCheck(nc_put_att_text(m_ncid, varid, "units", units.size(), &units[0]));
+    ncCheck(nc_put_att_text(m_ncid, varid, "coordinates", coordinates.size(),
+                            &coordinates[0]));
+    //...Laid out as a single column of n points, so the first two extents
+    // of the chunk and of each hyperslab below address (time, node)
+    m_compression.applyField(m_ncid, varid, n, 1, true);
+    this->m_varids.push_back(varid);
+  }
+
+  ncCheck(nc_enddef(m_ncid));
+
+  m_buffer = std::make_unique<NetcdfWriteBuffer<MeteorologicalDataType>>(
+      m_ncid, m_varid_time, m_varids, n, 1, m_compression.timeSteps());
+
+  auto x = this->grid()->x();
+  auto y = this->grid()->y();
+  if (!m_cells.empty()) {
+    for (size_t k = 0; k < m_cells.size(); ++k) {
+      x[k] = x[m_cells[k]];
+      y[k] = y[m_cells[k]];
+    }
+    std::vector<long long> cells(m_cells.begin(), m_cells.end());
+    const size_t start[] = {0};
+    ncCheck(
+        nc_put_vara_longlong(m_ncid, m_varid_cell, start, &n, cells.data()));
+  }
+  const size_t start[] = {0};
+  ncCheck(nc_put_vara_double(m_ncid, m_varid_x, start, &n, x.data()));
+  ncCheck(nc_put_vara_double(m_ncid, m_varid_y, start, &n, y.data()));
+}
+
+/**
+ * @brief Writes the time steps still held in the write buffer
+ */
+void PointNetcdfDomain::close() { m_buffer->flush(); }
+
+int PointNetcdfDomain::write(const MetBuild::Date &date,
+                             const MetBuild::MeteorologicalData<1> &data) {
+  m_buffer->append(m_counter, this->time_offset(date), this->gather(data));
+  m_counter++;
+  return 0;
+}
+
+int PointNetcdfDomain::write(const MetBuild::Date &date,
+                             const MetBuild::MeteorologicalData<3> &data) {
+  m_buffer->append(m_counter, this->time_offset(date), this->gather(data));
+  m_counter++;
+  return 0;
+}
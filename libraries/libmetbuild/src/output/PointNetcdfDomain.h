@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METGET_SRC_OUTPUT_POINTNETCDFDOMAIN_H_
+#define METGET_SRC_OUTPUT_POINTNETCDFDOMAIN_H_
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "MeteorologicalData.h"
+#include "NetcdfCompression.h"
+#include "NetcdfWriteBuffer.h"
+#include "OutputDomain.h"
+
+namespace MetBuild {
+
+class PointNetcdfDomain : public OutputDomain {
+ public:
+  PointNetcdfDomain(const MetBuild::Grid *grid,
+                    const MetBuild::Date &startDate,
+                    const MetBuild::Date &endDate, unsigned time_step,
+                    const int &ncid, std::vector<std::string> variables,
+                    NetcdfCompression compression =
+                        NetcdfCompression::defaults());
+
+  ~PointNetcdfDomain() override = default;
+
+  void open() override {}
+
+  void close() override;
+
+  int write(
+      const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  int write(
+      const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+ private:
+  void initialize();
+
+  NODISCARD double time_offset(const MetBuild::Date &date) const;
+
+  template <unsigned N>
+  std::array<Span<const MeteorologicalDataType>, N> gather(
+      const MetBuild::MeteorologicalData<N, MeteorologicalDataType> &data);
+
+  size_t m_counter;
+  const int m_ncid;
+
+  int m_dimid_node;
+  int m_dimid_time;
+  int m_varid_x;
+  int m_varid_y;
+  int m_varid_time;
+  int m_varid_crs;
+  int m_varid_cell;
+
+  //...Cells written when the grid has a mask, empty to write every cell
+  std::vector<size_t> m_cells;
+  std::array<std::vector<MeteorologicalDataType>, 3> m_gathered;
+
+  const std::vector<std::string> m_variables;
+  std::vector<int> m_varids;
+  const NetcdfCompression m_compression;
+  std::unique_ptr<NetcdfWriteBuffer<MeteorologicalDataType>> m_buffer;
+};
+
+}  // namespace MetBuild
+#endif  // METGET_SRC_OUTPUT_POINTNETCDFDOMAIN_H_
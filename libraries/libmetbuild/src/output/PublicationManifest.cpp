@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "PublicationManifest.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "Logging.h"
+#include "boost/filesystem.hpp"
+
+using namespace MetBuild;
+
+namespace {
+std::string json_string(const std::string &value) {
+  std::string s = "\"";
+  for (const char c : value) {
+    if (c == '"' || c == '\\') s += '\\';
+    s += c;
+  }
+  return s + "\"";
+}
+
+std::string json_date(const MetBuild::Date &date) {
+  return json_string(date.toString("%Y-%m-%dT%H:%M:%SZ"));
+}
+}  // namespace
+
+/**
+ * @brief Records the published part of a domain
+ * @param domain_index domain of the output file
+ * @param filenames files of the domain
+ * @param point last record published and the length of each file after it
+ */
+void PublicationManifest::set(const size_t domain_index,
+                              const std::vector<std::string> &filenames,
+                              const ResumePoint &point) {
+  if (domain_index >= m_domains.size()) m_domains.resize(domain_index + 1);
+  m_domains[domain_index] = {true, filenames, point};
+}
+
+/**
+ * @brief Time up to which every domain of the output has been published
+ * @param n_domains number of domains of the output
+ * @return time, if every domain has been published at least once
+ */
+std::optional<MetBuild::Date> PublicationManifest::through(
+    const size_t n_domains) const {
+  if (n_domains == 0 || m_domains.size() < n_domains) return std::nullopt;
+  std::optional<MetBuild::Date> date;
+  for (size_t i = 0; i < n_domains; ++i) {
+    if (!m_domains[i].valid) return std::nullopt;
+    if (!date || m_domains[i].point.time < *date) {
+      date = m_domains[i].point.time;
+    }
+  }
+  return date;
+}
+
+/**
+ * @brief Writes the manifest to a temporary file and renames it over the
+ * previous one
+ * @param filename manifest file
+ * @param n_domains number of domains of the output
+ */
+void PublicationManifest::write(const std::string &filename,
+                                const size_t n_domains) const {
+  const auto tmp = filename + "." + boost::filesystem::unique_path().string();
+  {
+    std::ofstream f(tmp);
+    if (!f.is_open()) {
+      metbuild_throw_exception("Could not write manifest file " + filename);
+    }
+    const auto date = this->through(n_domains);
+    f << "{\n  \"published_through\": "
+      << (date ? json_date(*date) : std::string("null")) << ",\n"
+      << "  \"domains\": [";
+    bool first = true;
+    for (size_t i = 0; i < m_domains.size(); ++i) {
+      const auto &d = m_domains[i];
+      if (!d.valid) continue;
+      f << (first ? "\n" : ",\n") << "    {\"index\": " << i
+        << ", \"time\": " << json_date(d.point.time) << ", \"files\": [";
+      const auto n = std::min(d.filenames.size(), d.point.offsets.size());
+      for (size_t k = 0; k < n; ++k) {
+        f << (k > 0 ? ", " : "") << "{\"name\": " << json_string(d.filenames[k])
+          << ", \"bytes\": " << d.point.offsets[k] << "}";
+      }
+      f << "]}";
+      first = false;
+    }
+    f << (first ? "]\n}\n" : "\n  ]\n}\n");
+    f.flush();
+    if (!f.good()) {
+      metbuild_throw_exception("Could not write manifest file " + filename);
+    }
+  }
+  boost::system::error_code ec;
+  boost::filesystem::rename(tmp, filename, ec);
+  if (ec) {
+    boost::filesystem::remove(tmp, ec);
+    metbuild_throw_exception("Could not replace manifest file " + filename);
+  }
+}
@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_PUBLICATIONMANIFEST_H_
+#define METBUILD_SRC_OUTPUT_PUBLICATIONMANIFEST_H_
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Checkpoint.h"
+#include "CppAttributes.h"
+#include "Date.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Leading part of each file of an output which is complete and may
+ * be handed on while the build still runs
+ *
+ * Each domain is published on a record boundary: every record up to the
+ * time of the domain is in the first bytes of its files. The manifest is
+ * a small JSON file replaced atomically each time it is written, listing the
+ * published time and byte length of the files of each domain and the time
+ * that every domain of the output has reached
+ */
+class PublicationManifest {
+ public:
+  void set(size_t domain_index, const std::vector<std::string> &filenames,
+           const ResumePoint &point);
+
+  NODISCARD std::optional<MetBuild::Date> through(size_t n_domains) const;
+
+  void write(const std::string &filename, size_t n_domains) const;
+
+ private:
+  struct Domain {
+    bool valid = false;
+    std::vector<std::string> filenames;
+    ResumePoint point;
+  };
+
+  std::vector<Domain> m_domains;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_PUBLICATIONMANIFEST_H_
@@ -32,6 +32,7 @@
 #include <utility>
 
 #include "RasNetcdfDomain.h"
+#include "boost/filesystem.hpp"
 #include "Utilities.h"
 #include "netcdf.h"
 
@@ -40,19 +41,60 @@ using namespace Utilities;
 
 RasNetcdf::RasNetcdf(const MetBuild::Date& date_start,
                      const MetBuild::Date& date_end, unsigned int time_step,
-                     std::string filename)
+                     std::string filename, const bool append)
     : OutputFile(date_start, date_end, time_step),
-      m_ncid(0), 
-      m_filename(std::move(filename)) {
+      m_ncid(0),
+      m_filename(std::move(filename)),
+      m_existing(append && boost::filesystem::exists(m_filename)),
+      m_compression(NetcdfCompression::defaults()) {
   this->initialize();
 }
 
-RasNetcdf::~RasNetcdf() { ncCheck(nc_close(this->m_ncid)); }
+/**
+ * @brief Constructor for a file shared by the ranks of a parallel build. The
+ * output covers the time shard of this rank
+ * @param parallel communicator and time span of the whole request
+ * @param filename output file, created collectively
+ */
+RasNetcdf::RasNetcdf(const NetcdfParallel& parallel, std::string filename)
+    : OutputFile(parallel.shardStart(), parallel.shardEnd(),
+                 parallel.timeStep()),
+      m_ncid(0),
+      m_filename(std::move(filename)),
+      m_existing(false),
+      m_compression(NetcdfCompression::defaults()),
+      m_parallel(parallel) {
+  this->initialize();
+}
+
+RasNetcdf::~RasNetcdf() {
+  this->stop_writers();
+  for (auto& domain : m_domains) domain->close();
+  ncCheck(nc_close(this->m_ncid));
+}
 
 std::vector<std::string> RasNetcdf::filenames() const {
   return {m_filename};
 }
 
+/**
+ * @brief Sets the chunking and compression of the domain added after this
+ * call
+ * @param compression compression policy
+ */
+void RasNetcdf::set_compression(const NetcdfCompression& compression) {
+  m_compression = compression;
+}
+
+/**
+ * @brief Selects the fields derived from the wind which are written by the
+ * domain added after this call
+ * @param derived derived fields and drag formula
+ */
+void RasNetcdf::set_derived(const DerivedWind& derived) {
+  m_derived = derived;
+}
+
 void RasNetcdf::addDomain(const Grid& w,
                           const std::vector<std::string>& variables) {
   if (!m_domains.empty()) {
@@ -62,24 +104,32 @@ void RasNetcdf::addDomain(const Grid& w,
 
   this->m_domains.push_back(std::make_unique<RasNetcdfDomain>(
       &w, this->startDate(), this->endDate(), this->timeStep(), this->m_ncid,
-      variables));
+      variables, m_compression, m_existing,
+      m_parallel ? &*m_parallel : nullptr, m_derived));
 }
 
 int RasNetcdf::write(
     const Date& date, size_t domain_index,
     const MeteorologicalData<1, MetBuild::MeteorologicalDataType>& data) {
-  return this->m_domains[0]->write(
-      date, data);  // Always 0, only 1 domain allowed for RAS
+  //...Always 0, only 1 domain allowed for RAS
+  return this->write_domain(0, date, data);
 }
 
 int RasNetcdf::write(
     const Date& date, size_t domain_index,
     const MeteorologicalData<3, MetBuild::MeteorologicalDataType>& data) {
-  return this->m_domains[0]->write(
-      date, data);  // Always 0, only 1 domain allowed for RAS
+  //...Always 0, only 1 domain allowed for RAS
+  return this->write_domain(0, date, data);
 }
 
 void RasNetcdf::initialize() {
+  //...A file written by an earlier run is reopened so its time axis can be
+  // extended. The domain validates the grid when it is added
+  if (m_existing) {
+    ncCheck(nc_open(m_filename.c_str(), NC_WRITE, &m_ncid));
+    return;
+  }
+
   constexpr std::string_view conventions = "CF-1.6,UGRID-0.9";
   constexpr std::string_view title = "MetGet Forcing, HEC-RAS Format";
   constexpr std::string_view institution = "MetGet";
@@ -94,7 +144,11 @@ void RasNetcdf::initialize() {
   constexpr std::string_view summary = "Data generated by MetGet for HEC-RAS";
   const std::string date_created = now.toString();
 
-  ncCheck(nc_create(m_filename.c_str(), NC_NETCDF4, &m_ncid));
+  if (m_parallel) {
+    m_ncid = m_parallel->create(m_filename);
+  } else {
+    ncCheck(nc_create(m_filename.c_str(), NC_NETCDF4, &m_ncid));
+  }
   ncCheck(nc_put_att_text(m_ncid, NC_GLOBAL, "Conventions", conventions.size(),
                           &conventions[0]));
   ncCheck(nc_put_att_text(m_ncid, NC_GLOBAL, "title", title.size(), &title[0]));
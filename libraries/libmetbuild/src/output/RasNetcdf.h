@@ -29,6 +29,11 @@
 #ifndef METGET_SRC_OUTPUT_RASNETCDF_H_
 #define METGET_SRC_OUTPUT_RASNETCDF_H_
 
+#include <optional>
+
+#include "DerivedWind.h"
+#include "NetcdfCompression.h"
+#include "NetcdfParallel.h"
 #include "OutputFile.h"
 
 namespace MetBuild {
@@ -36,12 +41,19 @@ namespace MetBuild {
 class RasNetcdf : public OutputFile {
  public:
   RasNetcdf(const MetBuild::Date &date_start, const MetBuild::Date &date_end,
-            unsigned time_step, std::string filename);
+            unsigned time_step, std::string filename,
+            bool append = false);
+
+  RasNetcdf(const NetcdfParallel &parallel, std::string filename);
 
-  ~RasNetcdf();
+  ~RasNetcdf() override;
 
   std::vector<std::string> filenames() const override;
 
+  void set_compression(const NetcdfCompression &compression);
+
+  void set_derived(const DerivedWind &derived);
+
   void addDomain(const MetBuild::Grid &w,
                  const std::vector<std::string> &variables) override;
 
@@ -55,11 +67,18 @@ class RasNetcdf : public OutputFile {
       const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
           &data) override;
 
+ protected:
+  bool serialize_domains() const override { return true; }
+
  private:
   void initialize();
 
   int m_ncid;
   std::string m_filename;
+  bool m_existing;
+  NetcdfCompression m_compression;
+  DerivedWind m_derived;
+  std::optional<NetcdfParallel> m_parallel;
 };
 
 }  // namespace MetBuild
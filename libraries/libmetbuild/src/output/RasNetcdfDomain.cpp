@@ -28,20 +28,60 @@
 ////////////////////////////////////////////////////////////////////////////////////
 #include "RasNetcdfDomain.h"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <string_view>
+
+#include "Logging.h"
 #include "Utilities.h"
 #include "netcdf.h"
 
 using namespace MetBuild;
 using namespace Utilities;
 
+namespace {
+/**
+ * @brief Variable name and attributes of a field derived from the wind
+ */
+struct DerivedVariable {
+  std::string name;
+  std::string long_name;
+  std::string units;
+};
+
+DerivedVariable derived_variable(const DerivedWind::Field field) {
+  switch (field) {
+    case DerivedWind::WIND_SPEED:
+      return {"wind_speed", "wind speed", "m/s"};
+    case DerivedWind::WIND_DIRECTION:
+      return {"wind_direction", "direction the wind blows from", "degrees"};
+    case DerivedWind::STRESS_U:
+      return {"stress_u", "e/w surface wind stress", "N/m2"};
+    case DerivedWind::STRESS_V:
+    default:
+      return {"stress_v", "n/s surface wind stress", "N/m2"};
+  }
+}
+}  // namespace
+
 RasNetcdfDomain::RasNetcdfDomain(const MetBuild::Grid *grid,
                                  const MetBuild::Date &startDate,
                                  const MetBuild::Date &endDate,
                                  unsigned int time_step, const int &ncid,
-                                 std::vector<std::string> variables)
+                                 std::vector<std::string> variables,
+                                 NetcdfCompression compression,
+                                 const bool existing,
+                                 const NetcdfParallel *parallel,
+                                 DerivedWind derived)
     : OutputDomain(grid, startDate, endDate, time_step),
       m_counter(0),
+      m_existing(existing),
+      m_reference(parallel ? parallel->startDate() : startDate),
+      m_time_length(0),
+      m_file_time_step(0.0),
       m_ncid(ncid),
+      m_parallel(parallel),
       m_dimid_x(0),
       m_dimid_y(0),
       m_dimid_time(0),
@@ -50,8 +90,161 @@ RasNetcdfDomain::RasNetcdfDomain(const MetBuild::Grid *grid,
       m_varid_z(0),
       m_varid_time(0),
       m_varid_crs(0),
-      m_variables(std::move(variables)) {
-  this->initialize();
+      m_variables(std::move(variables)),
+      m_compression(std::move(compression)),
+      m_derived(std::move(derived)) {
+  this->check_derived();
+  if (m_existing) {
+    this->open_existing();
+  } else {
+    this->initialize();
+  }
+}
+
+/**
+ * @brief Checks that derived fields are only requested for a wind domain,
+ * which lists wind_u and wind_v first
+ */
+void RasNetcdfDomain::check_derived() const {
+  if (m_derived.empty()) return;
+  if (m_variables.size() < 2 || m_variables[0] != "wind_u" ||
+      m_variables[1] != "wind_v") {
+    metbuild_throw_exception(
+        "Derived wind fields require the wind_u and wind_v variables");
+  }
+}
+
+/**
+ * @brief Attaches to the variables of a file written by an earlier run
+ *
+ * The grid must match the one in the file, and new records are placed on the
+ * existing time axis, which keeps the reference date of the file
+ */
+void RasNetcdfDomain::open_existing() {
+  const auto nx = this->grid()->ni();
+  const auto ny = this->grid()->nj();
+  const bool degrees = this->guessGridUnits() == "deg";
+
+  ncCheck(nc_inq_dimid(m_ncid, degrees ? "lon" : "x", &m_dimid_x));
+  ncCheck(nc_inq_dimid(m_ncid, degrees ? "lat" : "y", &m_dimid_y));
+  ncCheck(nc_inq_dimid(m_ncid, "time", &m_dimid_time));
+  size_t file_nx = 0;
+  size_t file_ny = 0;
+  ncCheck(nc_inq_dimlen(m_ncid, m_dimid_x, &file_nx));
+  ncCheck(nc_inq_dimlen(m_ncid, m_dimid_y, &file_ny));
+  ncCheck(nc_inq_dimlen(m_ncid, m_dimid_time, &m_time_length));
+  if (file_nx != nx || file_ny != ny) {
+    metbuild_throw_exception("Grid does not match the existing file");
+  }
+
+  ncCheck(nc_inq_varid(m_ncid, degrees ? "lon" : "x", &m_varid_x));
+  ncCheck(nc_inq_varid(m_ncid, degrees ? "lat" : "y", &m_varid_y));
+  ncCheck(nc_inq_varid(m_ncid, "time", &m_varid_time));
+
+  //...Compare the first and last coordinate along each axis
+  const auto x = this->grid()->xcolumn();
+  const auto y = this->grid()->ycolumn();
+  constexpr double tolerance = 1e-6;
+  for (const size_t i : {size_t(0), nx - 1}) {
+    double value = 0.0;
+    ncCheck(nc_get_var1_double(m_ncid, m_varid_x, &i, &value));
+    if (std::abs(value - x[i]) > tolerance) {
+      metbuild_throw_exception("Grid does not match the existing file");
+    }
+  }
+  for (const size_t j : {size_t(0), ny - 1}) {
+    double value = 0.0;
+    ncCheck(nc_get_var1_double(m_ncid, m_varid_y, &j, &value));
+    if (std::abs(value - y[j]) > tolerance) {
+      metbuild_throw_exception("Grid does not match the existing file");
+    }
+  }
+
+  this->m_varids.reserve(m_variables.size());
+  for (const auto &v : m_variables) {
+    int varid = 0;
+    if (nc_inq_varid(m_ncid, v.c_str(), &varid) != NC_NOERR) {
+      metbuild_throw_exception("Variable " + v +
+                               " is not in the existing file");
+    }
+    this->m_varids.push_back(varid);
+  }
+  for (const auto f : m_derived.fields()) {
+    const auto v = derived_variable(f);
+    int varid = 0;
+    if (nc_inq_varid(m_ncid, v.name.c_str(), &varid) != NC_NOERR) {
+      metbuild_throw_exception("Variable " + v.name +
+                               " is not in the existing file");
+    }
+    this->m_varids.push_back(varid);
+    m_derived_values.emplace_back(nx * ny);
+  }
+
+  //...Recover the reference date from the time units
+  size_t units_length = 0;
+  ncCheck(nc_inq_attlen(m_ncid, m_varid_time, "units", &units_length));
+  std::string units(units_length, ' ');
+  ncCheck(nc_get_att_text(m_ncid, m_varid_time, "units", &units[0]));
+  constexpr std::string_view prefix = "minutes since ";
+  if (units.compare(0, prefix.size(), prefix) != 0) {
+    metbuild_throw_exception("Unsupported time units in existing file: " +
+                             units);
+  }
+  m_reference.fromString(units.substr(prefix.size()), "%F %T");
+
+  if (m_time_length > 1) {
+    double times[2] = {0.0, 0.0};
+    const size_t start = 0;
+    const size_t count = 2;
+    ncCheck(nc_get_vara_double(m_ncid, m_varid_time, &start, &count, times));
+    m_file_time_step = times[1] - times[0];
+    if (std::abs(m_file_time_step * 60.0 - this->timestep()) > 1e-6) {
+      metbuild_throw_exception("Time step does not match the existing file");
+    }
+  }
+
+  //...Appended records go in one at a time since they may replace existing
+  // records out of chunk order
+  m_buffer = std::make_unique<NetcdfWriteBuffer<MeteorologicalDataType>>(
+      m_ncid, m_varid_time, m_varids, ny, nx, 1);
+}
+
+/**
+ * @brief Offset of a date from the reference time of the file in minutes
+ */
+double RasNetcdfDomain::time_offset(const MetBuild::Date &date) const {
+  return static_cast<double>(date.toSeconds() - m_reference.toSeconds()) /
+         60.0;
+}
+
+/**
+ * @brief Record index of a date
+ *
+ * New files are written in sequence. In an existing file the record is placed
+ * by its time so that records may be replaced or appended, but a gap past the
+ * last record is refused
+ *
+ * @param date date of the record
+ * @param minutes offset of the date from the reference time
+ * @return index along the time dimension
+ */
+size_t RasNetcdfDomain::time_index(const MetBuild::Date &date,
+                                   const double minutes) {
+  if (m_parallel) return m_parallel->record(date);
+  if (!m_existing) return m_counter;
+  const double step = static_cast<double>(this->timestep()) / 60.0;
+  const double position = minutes / step;
+  if (position < 0.0 || std::abs(position - std::round(position)) > 1e-6) {
+    metbuild_throw_exception("Date " + date.toString() +
+                             " is not on the time axis of the existing file");
+  }
+  const auto index = static_cast<size_t>(std::round(position));
+  if (index > m_time_length) {
+    metbuild_throw_exception("Appending " + date.toString() +
+                             " would leave a gap in the time axis");
+  }
+  m_time_length = std::max(m_time_length, index + 1);
+  return index;
 }
 
 void RasNetcdfDomain::initialize() {
@@ -67,7 +260,13 @@ void RasNetcdfDomain::initialize() {
     ncCheck(nc_def_dim(m_ncid, "x", nx, &m_dimid_x));
     ncCheck(nc_def_dim(m_ncid, "y", ny, &m_dimid_y));
   }
-  ncCheck(nc_def_dim(m_ncid, "time", NC_UNLIMITED, &m_dimid_time));
+  //...A shared file has its whole time axis from the start, so ranks write
+  // their records anywhere along it without extending the dimension
+  ncCheck(nc_def_dim(m_ncid, "time",
+                     m_parallel ? m_parallel->records() : NC_UNLIMITED,
+                     &m_dimid_time));
+  const auto record_compression =
+      m_parallel ? m_parallel->unfiltered(m_compression) : m_compression;
 
   const int one[] = {1};
   const int twod[] = {m_dimid_y, m_dimid_x};
@@ -84,7 +283,7 @@ void RasNetcdfDomain::initialize() {
     ncCheck(nc_put_att_text(m_ncid, m_varid_x, "units", 12, "degrees_east"));
     ncCheck(nc_put_att_text(m_ncid, m_varid_x, "axis", 1, "X"));
     // ncCheck(nc_def_var_fill(m_ncid, m_varid_x, NC_FILL, &double_fill));
-    ncCheck(nc_def_var_deflate(m_ncid, m_varid_x, 1, 1, 2));
+    m_compression.applySeries(m_ncid, m_varid_x, nx);
 
     // Y
     ncCheck(nc_def_var(m_ncid, "lat", NC_DOUBLE, 1, &m_dimid_y, &m_varid_y));
@@ -94,7 +293,7 @@ void RasNetcdfDomain::initialize() {
     ncCheck(nc_put_att_text(m_ncid, m_varid_y, "units", 13, "degrees_north"));
     ncCheck(nc_put_att_text(m_ncid, m_varid_y, "axis", 1, "Y"));
     // ncCheck(nc_def_var_fill(m_ncid, m_varid_y, NC_FILL, &double_fill));
-    ncCheck(nc_def_var_deflate(m_ncid, m_varid_y, 1, 1, 2));
+    m_compression.applySeries(m_ncid, m_varid_y, ny);
   } else {
     // X
     ncCheck(nc_def_var(m_ncid, "x", NC_DOUBLE, 1, &m_dimid_x, &m_varid_x));
@@ -105,7 +304,7 @@ void RasNetcdfDomain::initialize() {
                             &grid_unit[0]));
     ncCheck(nc_put_att_text(m_ncid, m_varid_x, "axis", 1, "X"));
     // ncCheck(nc_def_var_fill(m_ncid, m_varid_x, NC_FILL, &double_fill));
-    ncCheck(nc_def_var_deflate(m_ncid, m_varid_x, 1, 1, 2));
+    m_compression.applySeries(m_ncid, m_varid_x, nx);
 
     // Y
     ncCheck(nc_def_var(m_ncid, "y", NC_DOUBLE, 1, &m_dimid_y, &m_varid_y));
@@ -116,7 +315,7 @@ void RasNetcdfDomain::initialize() {
                             &grid_unit[0]));
     ncCheck(nc_put_att_text(m_ncid, m_varid_y, "axis", 1, "Y"));
     // ncCheck(nc_def_var_fill(m_ncid, m_varid_y, NC_FILL, &double_fill));
-    ncCheck(nc_def_var_deflate(m_ncid, m_varid_y, 1, 1, 2));
+    m_compression.applySeries(m_ncid, m_varid_y, ny);
   }
 
   // Z
@@ -125,11 +324,11 @@ void RasNetcdfDomain::initialize() {
   ncCheck(nc_put_att_text(m_ncid, m_varid_z, "long_name", 27,
                           "height above mean sea level"));
   // ncCheck(nc_def_var_fill(m_ncid, m_varid_z, NC_FILL, &double_fill));
-  ncCheck(nc_def_var_deflate(m_ncid, m_varid_z, 1, 1, 2));
+  m_compression.applyGrid(m_ncid, m_varid_z, ny, nx);
 
   // TIME
   auto referenceTimeString =
-      "minutes since " + this->startDate().toString("%F %T");
+      "minutes since " + m_reference.toString("%F %T");
   ncCheck(
       nc_def_var(m_ncid, "time", NC_DOUBLE, 1, &m_dimid_time, &m_varid_time));
   // ncCheck(nc_put_att_text(m_ncid, m_varid_time, "standard_name", 4, "time"));
@@ -138,7 +337,7 @@ void RasNetcdfDomain::initialize() {
                           referenceTimeString.size(), &referenceTimeString[0]));
   ncCheck(nc_put_att_text(m_ncid, m_varid_time, "axis", 1, "T"));
   // ncCheck(nc_def_var_fill(m_ncid, m_varid_time, NC_FILL, &double_fill));
-  ncCheck(nc_def_var_deflate(m_ncid, m_varid_time, 1, 1, 2));
+  record_compression.applySeries(m_ncid, m_varid_time);
 
   // CRS
   if (grid_unit == "deg") {
@@ -218,12 +417,47 @@ void RasNetcdfDomain::initialize() {
                             &long_name[0]));
     ncCheck(nc_put_att_text(m_ncid, varid, "units", units.size(), &units[0]));
     ncCheck(nc_put_att_text(m_ncid, varid, "grid_mapping", 3, "crs"));
-    ncCheck(nc_def_var_deflate(m_ncid, varid, 1, 1, 2));
+    record_compression.applyField(m_ncid, varid, ny, nx, true);
     this->m_varids.push_back(varid);
   }
 
+  const auto drag = DerivedWind::dragName(m_derived.drag());
+  for (const auto f : m_derived.fields()) {
+    const auto v = derived_variable(f);
+    int varid = 0;
+#ifdef METBUILD_USE_FLOAT
+    ncCheck(nc_def_var(m_ncid, v.name.c_str(), NC_FLOAT, 3, threed, &varid));
+    ncCheck(nc_def_var_fill(m_ncid, varid, NC_FILL, &float_fill));
+#else
+    ncCheck(nc_def_var(m_ncid, v.name.c_str(), NC_DOUBLE, 3, threed, &varid));
+    ncCheck(nc_def_var_fill(m_ncid, varid, NC_FILL, &double_fill));
+#endif
+    ncCheck(nc_put_att_text(m_ncid, varid, "long_name", v.long_name.size(),
+                            &v.long_name[0]));
+    ncCheck(
+        nc_put_att_text(m_ncid, varid, "units", v.units.size(), &v.units[0]));
+    ncCheck(nc_put_att_text(m_ncid, varid, "grid_mapping", 3, "crs"));
+    if (f == DerivedWind::STRESS_U || f == DerivedWind::STRESS_V) {
+      ncCheck(nc_put_att_text(m_ncid, varid, "drag_formula", drag.size(),
+                              &drag[0]));
+    }
+    record_compression.applyField(m_ncid, varid, ny, nx, true);
+    this->m_varids.push_back(varid);
+    m_derived_values.emplace_back(nx * ny);
+  }
+
   ncCheck(nc_enddef(m_ncid));
 
+  if (m_parallel) {
+    m_parallel->collective(m_ncid, m_varid_x);
+    m_parallel->collective(m_ncid, m_varid_y);
+    m_parallel->independent(m_ncid, m_varid_time);
+    for (const auto varid : m_varids) m_parallel->independent(m_ncid, varid);
+  }
+
+  m_buffer = std::make_unique<NetcdfWriteBuffer<MeteorologicalDataType>>(
+      m_ncid, m_varid_time, m_varids, ny, nx, m_compression.timeSteps());
+
   const auto x = this->grid()->xcolumn();
   const auto y = this->grid()->ycolumn();
   const size_t start[] = {0};
@@ -232,56 +466,48 @@ void RasNetcdfDomain::initialize() {
   ncCheck(nc_put_vara(m_ncid, m_varid_y, start, &ny, y.data()));
 }
 
+/**
+ * @brief Writes the time steps still held in the write buffer
+ */
+void RasNetcdfDomain::close() { m_buffer->flush(); }
+
 int RasNetcdfDomain::write(const MetBuild::Date &date,
                            const MetBuild::MeteorologicalData<1> &data) {
-  const double minutes[] = {
-      (static_cast<double>(date.toSeconds() - this->startDate().toSeconds())) /
-      60.0};  // time offset in minutes
-  const size_t start_array[] = {m_counter, 0, 0};
-  const size_t count_array[] = {1, this->grid()->nj(), this->grid()->ni()};
-  const size_t start_scalar[] = {m_counter};
-  const size_t count_scalar[] = {1};
-
-  ncCheck(nc_put_vara_double(m_ncid, m_varid_time, start_scalar, count_scalar,
-                             minutes));
-
-  const auto array = data.toVector(0);
-#ifdef METBUILD_USE_FLOAT
-  ncCheck(nc_put_vara_float(m_ncid, m_varids[0], start_array, count_array,
-                            array.data()));
-#else
-  ncCheck(nc_put_vara_double(m_ncid, m_varids[0], start_array, count_array,
-                             array.data()));
-#endif
-
+  const double minutes = this->time_offset(date);
+  const auto index = this->time_index(date, minutes);
+  const std::array<Span<const MeteorologicalDataType>, 1> fields = {
+      data.parameter(0)};
+  m_buffer->append(index, minutes, fields);
   m_counter++;
   return 0;
 }
 
 int RasNetcdfDomain::write(const MetBuild::Date &date,
                            const MetBuild::MeteorologicalData<3> &data) {
-  const double minutes[] = {
-      (static_cast<double>(date.toSeconds() - this->startDate().toSeconds())) /
-      60.0};  // time offset in minutes
-  const size_t start_array[] = {m_counter, 0, 0};
-  const size_t count_array[] = {1, this->grid()->nj(), this->grid()->ni()};
-  const size_t start_scalar[] = {m_counter};
-  const size_t count_scalar[] = {1};
-
-  ncCheck(nc_put_vara_double(m_ncid, m_varid_time, start_scalar, count_scalar,
-                             minutes));
-
-  for (size_t i = 0; i < m_varids.size(); ++i) {
-    const auto array = data.toVector(i);
-#ifdef METBUILD_USE_FLOAT
-    ncCheck(nc_put_vara_float(m_ncid, m_varids[i], start_array, count_array,
-                              array.data()));
-#else
-    ncCheck(nc_put_vara_double(m_ncid, m_varids[i], start_array, count_array,
-                               array.data()));
-#endif
+  const double minutes = this->time_offset(date);
+  const auto index = this->time_index(date, minutes);
+  if (m_derived.empty()) {
+    const std::array<Span<const MeteorologicalDataType>, 3> fields = {
+        data.parameter(0), data.parameter(1), data.parameter(2)};
+    m_buffer->append(index, minutes, fields);
+    m_counter++;
+    return 0;
   }
 
+  //...Derived fields are computed from the record about to be written, in
+  // a single pass over the two wind components
+  std::vector<Span<const MeteorologicalDataType>> fields;
+  for (size_t k = 0; k < std::min<size_t>(m_variables.size(), 3); ++k) {
+    fields.emplace_back(data.parameter(k));
+  }
+  std::vector<MeteorologicalDataType *> out;
+  for (auto &v : m_derived_values) {
+    out.push_back(v.data());
+    fields.emplace_back(v.data(), v.size());
+  }
+  m_derived.compute(data.ni() * data.nj(), data.parameter(0).data(),
+                    data.parameter(1).data(), out.data());
+  m_buffer->append(index, minutes, fields.data(), fields.size());
   m_counter++;
   return 0;
 }
@@ -29,7 +29,13 @@
 #ifndef METGET_SRC_OUTPUT_RASNETCDFDOMAIN_H_
 #define METGET_SRC_OUTPUT_RASNETCDFDOMAIN_H_
 
+#include <memory>
+
+#include "DerivedWind.h"
 #include "MeteorologicalData.h"
+#include "NetcdfCompression.h"
+#include "NetcdfParallel.h"
+#include "NetcdfWriteBuffer.h"
 #include "OutputDomain.h"
 
 namespace MetBuild {
@@ -38,13 +44,18 @@ class RasNetcdfDomain : public OutputDomain {
  public:
   RasNetcdfDomain(const MetBuild::Grid *grid, const MetBuild::Date &startDate,
                   const MetBuild::Date &endDate, unsigned time_step,
-                  const int &ncid, std::vector<std::string> variables);
+                  const int &ncid, std::vector<std::string> variables,
+                  NetcdfCompression compression =
+                      NetcdfCompression::defaults(),
+                  bool existing = false,
+                  const NetcdfParallel *parallel = nullptr,
+                  DerivedWind derived = DerivedWind());
 
   ~RasNetcdfDomain() override = default;
 
   void open() override {}
 
-  void close() override {}
+  void close() override;
 
   int write(
       const MetBuild::Date &date,
@@ -59,8 +70,21 @@ class RasNetcdfDomain : public OutputDomain {
  private:
   void initialize();
 
+  void open_existing();
+
+  size_t time_index(const MetBuild::Date &date, double minutes);
+
+  void check_derived() const;
+
+  NODISCARD double time_offset(const MetBuild::Date &date) const;
+
   size_t m_counter;
+  const bool m_existing;
+  MetBuild::Date m_reference;
+  size_t m_time_length;
+  double m_file_time_step;
   const int m_ncid;
+  const NetcdfParallel *m_parallel;
 
   int m_dimid_x;
   int m_dimid_y;
@@ -74,6 +98,10 @@ class RasNetcdfDomain : public OutputDomain {
   const std::vector<std::string> m_variables;
   std::vector<int> m_varids;
   std::vector<int> m_dimids;
+  const NetcdfCompression m_compression;
+  const DerivedWind m_derived;
+  std::vector<std::vector<MeteorologicalDataType>> m_derived_values;
+  std::unique_ptr<NetcdfWriteBuffer<MeteorologicalDataType>> m_buffer;
 };
 
 }  // namespace MetBuild
@@ -0,0 +1,491 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "ShardedOutput.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <utility>
+
+#include "DelftOutput.h"
+#include "GribOutput.h"
+#include "Logging.h"
+#include "OwiAscii.h"
+#include "OwiBinary.h"
+#include "OwiNetcdf.h"
+#include "RasNetcdf.h"
+#include "RequestEstimate.h"
+#include "ZarrOutput.h"
+#include "boost/filesystem.hpp"
+
+using namespace MetBuild;
+
+namespace {
+std::string json_string(const std::string &value) {
+  std::string s = "\"";
+  for (const char c : value) {
+    if (c == '"' || c == '\\') s += '\\';
+    s += c;
+  }
+  return s + "\"";
+}
+
+std::string json_date(const MetBuild::Date &date) {
+  return json_string(date.toString("%Y-%m-%dT%H:%M:%SZ"));
+}
+
+bool is_ascii(const std::string &format) {
+  return format == "ascii" || format == "owi-ascii" ||
+         format == "adcirc-ascii";
+}
+
+bool is_binary(const std::string &format) {
+  return format == "owi-binary" || format == "adcirc-binary";
+}
+
+/**
+ * @brief Output of one shard of a format, named as in a request. Formats
+ * writing a single file take the shard name of that file
+ */
+std::unique_ptr<OutputFile> format_shard(
+    const std::string &format, const std::string &filename,
+    const StreamCompression::Codec codec, const Date &start, const Date &end,
+    const unsigned time_step, const size_t shard) {
+  const auto name = ShardedOutput::shard_name(filename, shard);
+  if (is_ascii(format)) {
+    auto owi = std::make_unique<OwiAscii>(start, end, time_step);
+    owi->set_compression(codec);
+    return owi;
+  } else if (is_binary(format)) {
+    auto owi = std::make_unique<OwiBinary>(start, end, time_step);
+    owi->set_compression(codec);
+    return owi;
+  } else if (format == "owi-netcdf" || format == "adcirc-netcdf") {
+    return std::make_unique<OwiNetcdf>(start, end, time_step, name);
+  } else if (format == "hec-netcdf") {
+    return std::make_unique<RasNetcdf>(start, end, time_step, name);
+  } else if (format == "delft3d") {
+    return std::make_unique<DelftOutput>(start, end, time_step, name);
+  } else if (format == "zarr") {
+    return std::make_unique<ZarrOutput>(start, end, time_step, name);
+  } else if (format == "grib2") {
+    return std::make_unique<GribOutput>(start, end, time_step);
+  }
+  metbuild_throw_exception("Invalid output format for sharding: " + format);
+  return nullptr;
+}
+
+/**
+ * @brief Domain names of one shard of a format. The file per domain formats
+ * are given file names, of which a grib2 domain only has the first, while
+ * the others are given group or variable names, which stay the same
+ */
+std::vector<std::string> format_names(const std::string &format,
+                                      std::vector<std::string> filenames,
+                                      const size_t shard) {
+  if (is_ascii(format) || is_binary(format)) {
+    for (auto &f : filenames) f = ShardedOutput::shard_name(f, shard);
+  } else if (format == "grib2" && !filenames.empty()) {
+    filenames[0] = ShardedOutput::shard_name(filenames[0], shard);
+  }
+  return filenames;
+}
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param date_start start date of the output
+ * @param date_end end date of the output
+ * @param time_step seconds between records
+ * @param factory creates the output of each shard
+ * @param namer gives the names of the domains of each shard
+ */
+ShardedOutput::ShardedOutput(const Date &date_start, const Date &date_end,
+                             const unsigned time_step, Factory factory,
+                             Namer namer)
+    : OutputFile(date_start, date_end, time_step),
+      m_factory(std::move(factory)),
+      m_namer(std::move(namer)),
+      m_compression(false),
+      m_shard_hours(0.0),
+      m_shard_bytes(0),
+      m_shard_records(0),
+      m_queue_depth(2) {}
+
+/**
+ * @brief Constructor for the output formats of a request
+ * @param date_start start date of the output
+ * @param date_end end date of the output
+ * @param time_step seconds between records
+ * @param format output format, named as in a request
+ * @param filename output file of the formats writing a single file
+ * @param codec compression of the ascii and binary formats
+ */
+ShardedOutput::ShardedOutput(const Date &date_start, const Date &date_end,
+                             const unsigned time_step,
+                             const std::string &format,
+                             const std::string &filename,
+                             const StreamCompression::Codec codec)
+    : ShardedOutput(
+          date_start, date_end, time_step,
+          [format, filename, codec](const Date &start, const Date &end,
+                                    unsigned step, size_t shard) {
+            return format_shard(format, filename, codec, start, end, step,
+                                shard);
+          },
+          [format](const std::vector<std::string> &filenames, size_t shard) {
+            return format_names(format, filenames, shard);
+          }) {
+  m_format = format;
+  m_compression = codec != StreamCompression::NONE;
+  if (format == "raw") {
+    metbuild_throw_exception("Invalid output format for sharding: " + format);
+  }
+}
+
+ShardedOutput::~ShardedOutput() {
+  std::vector<std::shared_ptr<OutputFile>> outputs;
+  for (auto &s : m_shards) {
+    if (s.second.output) outputs.push_back(std::move(s.second.output));
+  }
+  outputs.clear();
+  if (!m_manifest.empty()) {
+    try {
+      this->write_manifest();
+    } catch (const std::exception &e) {
+      Logging::warning(e.what());
+    }
+  }
+}
+
+/**
+ * @brief Starts a new shard every number of hours
+ * @param hours span of each shard, rounded to a whole number of records
+ */
+void ShardedOutput::set_shard_hours(const double hours) {
+  if (hours <= 0.0) {
+    metbuild_throw_exception("The span of a shard must be positive");
+  }
+  m_shard_hours = hours;
+  m_shard_bytes = 0;
+}
+
+/**
+ * @brief Starts a new shard every number of bytes, as estimated for the
+ * largest domain from its grid and the output format. Only available for
+ * the formats of a request
+ * @param bytes size of each shard
+ */
+void ShardedOutput::set_shard_bytes(const size_t bytes) {
+  if (m_format.empty()) {
+    metbuild_throw_exception(
+        "Shards are only sized in bytes for the formats of a request");
+  }
+  if (bytes == 0) {
+    metbuild_throw_exception("The size of a shard must be positive");
+  }
+  m_shard_bytes = bytes;
+  m_shard_hours = 0.0;
+}
+
+/**
+ * @brief Sets the manifest listing the shards
+ * @param filename manifest file, replaced each time it is written
+ */
+void ShardedOutput::set_manifest(const std::string &filename) {
+  m_manifest = filename;
+}
+
+/**
+ * @brief Number of records in each shard, known once the first record is
+ * written. Zero until then
+ */
+size_t ShardedOutput::shard_records() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_shard_records;
+}
+
+/**
+ * @brief Number of shards started so far
+ */
+size_t ShardedOutput::shard_count() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_shards.size();
+}
+
+/**
+ * @brief Name of a file in a shard. The shard number goes before the
+ * extension, after any compression or binary extension is set aside, so
+ * that "wind.pre.gz" becomes "wind_shard0001.pre.gz"
+ * @param filename file name
+ * @param shard shard number
+ * @return file name in the shard
+ */
+std::string ShardedOutput::shard_name(const std::string &filename,
+                                      const size_t shard) {
+  const auto slash = filename.find_last_of("/\\");
+  const size_t base = slash == std::string::npos ? 0 : slash + 1;
+  size_t end = filename.size();
+  for (const std::string ext : {".gz", ".zst", ".lz4", ".bin"}) {
+    if (end - base > ext.size() &&
+        filename.compare(end - ext.size(), ext.size(), ext) == 0) {
+      end -= ext.size();
+    }
+  }
+  const auto dot = filename.find_last_of('.', end - 1);
+  const size_t at = dot != std::string::npos && dot > base ? dot : end;
+  char suffix[32];
+  std::snprintf(suffix, sizeof(suffix), "_shard%04zu", shard);
+  return filename.substr(0, at) + suffix + filename.substr(at);
+}
+
+void ShardedOutput::addDomain(const Grid &w,
+                              const std::vector<std::string> &filenames) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_shards.empty()) {
+    metbuild_throw_exception(
+        "Domains must be added before the first record is written");
+  }
+  m_domains_added.push_back({&w, filenames});
+  m_domain_shard.push_back(0);
+}
+
+int ShardedOutput::write(
+    const Date &date, const size_t domain_index,
+    const MeteorologicalData<1, MeteorologicalDataType> &data) {
+  return this->write_shard(date, domain_index, data);
+}
+
+int ShardedOutput::write(
+    const Date &date, const size_t domain_index,
+    const MeteorologicalData<3, MeteorologicalDataType> &data) {
+  return this->write_shard(date, domain_index, data);
+}
+
+/**
+ * @brief Writes a record to the shard spanning its date, starting the shard
+ * if need be and closing the shards every domain has written past
+ */
+template <unsigned N>
+int ShardedOutput::write_shard(
+    const Date &date, const size_t domain_index,
+    const MeteorologicalData<N, MeteorologicalDataType> &data) {
+  if (date < this->startDate() || this->endDate() < date) return 0;
+  std::shared_ptr<OutputFile> output;
+  std::vector<std::shared_ptr<OutputFile>> finished;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (domain_index >= m_domains_added.size()) {
+      metbuild_throw_exception("Domain " + std::to_string(domain_index) +
+                               " has not been added to the output");
+    }
+    if (m_shard_records == 0) {
+      if (m_shard_bytes != 0) {
+        m_shard_records = this->records_for_bytes(N);
+      } else if (m_shard_hours > 0.0) {
+        m_shard_records = std::max<size_t>(
+            static_cast<size_t>(
+                std::lround(m_shard_hours * 3600.0 / this->timeStep())),
+            1);
+      } else {
+        metbuild_throw_exception("The span of the shards has not been set");
+      }
+    }
+    const auto record = static_cast<size_t>(
+        (date.toSeconds() - this->startDate().toSeconds()) /
+        this->timeStep());
+    const size_t shard = record / m_shard_records;
+    output = this->open_shard(shard);
+    m_domain_shard[domain_index] = shard;
+    finished = this->take_finished();
+  }
+  this->close(std::move(finished));
+  return output->write(date, domain_index, data);
+}
+
+/**
+ * @brief Records of a shard sized in bytes, from the largest domain
+ * @param variables number of fields of each record
+ */
+size_t ShardedOutput::records_for_bytes(const unsigned variables) const {
+  size_t cells = 0;
+  for (const auto &d : m_domains_added) {
+    cells = std::max(cells, d.grid->ni() * d.grid->nj());
+  }
+  const double record = static_cast<double>(cells) * variables *
+                        RequestEstimate::value_bytes(m_format, m_compression);
+  if (record <= 0.0) return 1;
+  return std::max<size_t>(
+      static_cast<size_t>(static_cast<double>(m_shard_bytes) / record), 1);
+}
+
+/**
+ * @brief Output of a shard, created with the domains of the sharded output
+ * when it is first used. Called with the lock held
+ */
+std::shared_ptr<OutputFile> ShardedOutput::open_shard(const size_t shard) {
+  const auto it = m_shards.find(shard);
+  if (it != m_shards.end()) {
+    if (!it->second.output) {
+      metbuild_throw_exception("Shard " + std::to_string(shard) +
+                               " has already been closed");
+    }
+    return it->second.output;
+  }
+
+  const auto span = static_cast<long>(m_shard_records * this->timeStep());
+  Shard s;
+  s.start = this->startDate() + static_cast<long>(shard) * span;
+  s.end = std::min(this->endDate(), s.start + span - this->timeStep());
+  s.output = std::shared_ptr<OutputFile>(
+      m_factory(s.start, s.end, this->timeStep(), shard));
+  for (const auto &d : m_domains_added) {
+    s.output->addDomain(*d.grid, m_namer(d.filenames, shard));
+  }
+  s.output->set_async(this->is_async(), m_queue_depth);
+  s.filenames = s.output->filenames();
+  auto output = s.output;
+  m_shards.emplace(shard, std::move(s));
+  if (!m_manifest.empty()) this->write_manifest();
+  return output;
+}
+
+/**
+ * @brief Takes the outputs of the shards every domain has written past.
+ * Called with the lock held
+ */
+std::vector<std::shared_ptr<OutputFile>> ShardedOutput::take_finished() {
+  std::vector<std::shared_ptr<OutputFile>> finished;
+  const size_t oldest =
+      *std::min_element(m_domain_shard.begin(), m_domain_shard.end());
+  for (auto &s : m_shards) {
+    if (s.first >= oldest) break;
+    if (s.second.output) finished.push_back(std::move(s.second.output));
+  }
+  return finished;
+}
+
+/**
+ * @brief Flushes and closes the outputs of finished shards outside the lock,
+ * then lists them as complete in the manifest
+ */
+void ShardedOutput::close(std::vector<std::shared_ptr<OutputFile>> outputs) {
+  if (outputs.empty()) return;
+  for (auto &o : outputs) o->flush();
+  outputs.clear();
+  if (m_manifest.empty()) return;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  this->write_manifest();
+}
+
+void ShardedOutput::set_async(const bool value, const size_t queue_depth) {
+  //...Calls flush, so the lock is taken after
+  OutputFile::set_async(value, queue_depth);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_queue_depth = queue_depth;
+  for (auto &s : m_shards) {
+    if (s.second.output) s.second.output->set_async(value, queue_depth);
+  }
+}
+
+void ShardedOutput::flush() {
+  std::vector<std::shared_ptr<OutputFile>> outputs;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &s : m_shards) {
+      if (s.second.output) outputs.push_back(s.second.output);
+    }
+  }
+  for (auto &o : outputs) o->flush();
+}
+
+void ShardedOutput::discard() {
+  std::vector<std::shared_ptr<OutputFile>> outputs;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &s : m_shards) {
+      if (s.second.output) outputs.push_back(s.second.output);
+    }
+  }
+  for (auto &o : outputs) o->discard();
+}
+
+/**
+ * @brief Files of every shard started so far, in time order
+ */
+std::vector<std::string> ShardedOutput::filenames() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<std::string> files;
+  for (const auto &s : m_shards) {
+    files.insert(files.end(), s.second.filenames.begin(),
+                 s.second.filenames.end());
+  }
+  return files;
+}
+
+/**
+ * @brief Writes the manifest to a temporary file and renames it over the
+ * previous one. Called with the lock held
+ */
+void ShardedOutput::write_manifest() const {
+  const auto tmp =
+      m_manifest + "." + boost::filesystem::unique_path().string();
+  {
+    std::ofstream f(tmp);
+    if (!f.is_open()) {
+      metbuild_throw_exception("Could not write manifest file " + m_manifest);
+    }
+    f << "{\n  \"records_per_shard\": " << m_shard_records
+      << ",\n  \"shards\": [";
+    bool first = true;
+    for (const auto &s : m_shards) {
+      f << (first ? "\n" : ",\n") << "    {\"index\": " << s.first
+        << ", \"start\": " << json_date(s.second.start)
+        << ", \"end\": " << json_date(s.second.end) << ", \"complete\": "
+        << (s.second.output ? "false" : "true") << ", \"files\": [";
+      for (size_t k = 0; k < s.second.filenames.size(); ++k) {
+        f << (k > 0 ? ", " : "") << json_string(s.second.filenames[k]);
+      }
+      f << "]}";
+      first = false;
+    }
+    f << (first ? "]\n}\n" : "\n  ]\n}\n");
+    f.flush();
+    if (!f.good()) {
+      metbuild_throw_exception("Could not write manifest file " + m_manifest);
+    }
+  }
+  boost::system::error_code ec;
+  boost::filesystem::rename(tmp, m_manifest, ec);
+  if (ec) {
+    boost::filesystem::remove(tmp, ec);
+    metbuild_throw_exception("Could not replace manifest file " + m_manifest);
+  }
+}
@@ -0,0 +1,165 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_SHARDEDOUTPUT_H_
+#define METBUILD_SRC_OUTPUT_SHARDEDOUTPUT_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "OutputFile.h"
+#include "StreamCompression.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Output split into files covering consecutive spans of time, so
+ * each shard can be uploaded and downloaded on its own and in parallel
+ *
+ * Each shard is an output of its own over its span, created when the first
+ * record in the span is written. It has the domains of the sharded output,
+ * with the shard number added to the file names. A shard is closed once
+ * every domain has written past it. The span of a shard is a number of
+ * hours, or the number of records expected to fill a number of bytes in the
+ * largest domain
+ *
+ * When a manifest is set, it is rewritten each time a shard is started or
+ * closed. It lists the shards in time order with their span, their files
+ * and whether they are complete
+ *
+ * Sharded outputs are neither checkpointed nor published
+ */
+class ShardedOutput : public OutputFile {
+ public:
+  //...Creates the output of a shard over its span
+  using Factory = std::function<std::unique_ptr<OutputFile>(
+      const MetBuild::Date &start, const MetBuild::Date &end,
+      unsigned time_step, size_t shard)>;
+
+  //...Names of the files of a domain in a shard
+  using Namer = std::function<std::vector<std::string>(
+      const std::vector<std::string> &filenames, size_t shard)>;
+
+  ShardedOutput(const MetBuild::Date &date_start,
+                const MetBuild::Date &date_end, unsigned time_step,
+                Factory factory, Namer namer);
+
+  ShardedOutput(const MetBuild::Date &date_start,
+                const MetBuild::Date &date_end, unsigned time_step,
+                const std::string &format, const std::string &filename,
+                MetBuild::StreamCompression::Codec codec =
+                    MetBuild::StreamCompression::NONE);
+
+  ~ShardedOutput() override;
+
+  void set_shard_hours(double hours);
+
+  void set_shard_bytes(size_t bytes);
+
+  void set_manifest(const std::string &filename);
+
+  NODISCARD size_t shard_records() const;
+
+  NODISCARD size_t shard_count() const;
+
+  NODISCARD static std::string shard_name(const std::string &filename,
+                                          size_t shard);
+
+  void addDomain(const MetBuild::Grid &w,
+                 const std::vector<std::string> &filenames) override;
+
+  int write(
+      const MetBuild::Date &date, size_t domain_index,
+      const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  int write(
+      const MetBuild::Date &date, size_t domain_index,
+      const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  void set_async(bool value, size_t queue_depth = 2) override;
+
+  void flush() override;
+
+  void discard() override;
+
+  NODISCARD std::vector<std::string> filenames() const override;
+
+ private:
+  struct Domain {
+    const MetBuild::Grid *grid;
+    std::vector<std::string> filenames;
+  };
+
+  struct Shard {
+    MetBuild::Date start;
+    MetBuild::Date end;
+    std::vector<std::string> filenames;
+    std::shared_ptr<OutputFile> output;
+  };
+
+  template <unsigned N>
+  int write_shard(
+      const MetBuild::Date &date, size_t domain_index,
+      const MetBuild::MeteorologicalData<N, MetBuild::MeteorologicalDataType>
+          &data);
+
+  std::shared_ptr<OutputFile> open_shard(size_t shard);
+
+  std::vector<std::shared_ptr<OutputFile>> take_finished();
+
+  void close(std::vector<std::shared_ptr<OutputFile>> outputs);
+
+  NODISCARD size_t records_for_bytes(unsigned variables) const;
+
+  void write_manifest() const;
+
+  Factory m_factory;
+  Namer m_namer;
+  std::string m_format;
+  bool m_compression;
+  double m_shard_hours;
+  size_t m_shard_bytes;
+  size_t m_shard_records;
+  std::string m_manifest;
+  size_t m_queue_depth;
+  std::vector<Domain> m_domains_added;
+  std::vector<size_t> m_domain_shard;
+  std::map<size_t, Shard> m_shards;
+  mutable std::mutex m_mutex;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_SHARDEDOUTPUT_H_
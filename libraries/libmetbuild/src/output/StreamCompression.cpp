@@ -0,0 +1,289 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "StreamCompression.h"
+
+#include "Logging.h"
+#include "boost/algorithm/string/case_conv.hpp"
+#include "boost/iostreams/device/array.hpp"
+#include "boost/iostreams/device/back_inserter.hpp"
+#include "boost/iostreams/filter/gzip.hpp"
+#include "boost/iostreams/filtering_stream.hpp"
+
+#ifdef METBUILD_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef METBUILD_LZ4
+#include <lz4frame.h>
+#endif
+
+using namespace MetBuild;
+
+namespace {
+std::string gzip_compress(const char *data, size_t size, int level) {
+  std::string frame;
+  boost::iostreams::filtering_ostream stream;
+  stream.push(boost::iostreams::gzip_compressor(
+      boost::iostreams::gzip_params(level)));
+  stream.push(boost::iostreams::back_inserter(frame));
+  stream.write(data, static_cast<std::streamsize>(size));
+  stream.reset();
+  return frame;
+}
+
+std::string gzip_decompress(const char *data, size_t size,
+                            size_t original_size) {
+  std::string out(original_size, '\0');
+  boost::iostreams::filtering_istream stream;
+  stream.push(boost::iostreams::gzip_decompressor());
+  stream.push(boost::iostreams::array_source(data, size));
+  stream.read(&out[0], static_cast<std::streamsize>(original_size));
+  if (static_cast<size_t>(stream.gcount()) != original_size) {
+    metbuild_throw_exception("Gzip frame is shorter than expected");
+  }
+  return out;
+}
+
+#ifdef METBUILD_ZSTD
+std::string zstd_compress(const char *data, size_t size, int level) {
+  std::string frame(ZSTD_compressBound(size), '\0');
+  const auto n = ZSTD_compress(&frame[0], frame.size(), data, size, level);
+  if (ZSTD_isError(n)) {
+    metbuild_throw_exception(std::string("Zstd compression failed: ") +
+                             ZSTD_getErrorName(n));
+  }
+  frame.resize(n);
+  return frame;
+}
+
+std::string zstd_decompress(const char *data, size_t size,
+                            size_t original_size) {
+  std::string out(original_size, '\0');
+  const auto n = ZSTD_decompress(&out[0], original_size, data, size);
+  if (ZSTD_isError(n) || n != original_size) {
+    metbuild_throw_exception("Zstd decompression failed");
+  }
+  return out;
+}
+#endif
+
+#ifdef METBUILD_LZ4
+std::string lz4_compress(const char *data, size_t size, int level) {
+  LZ4F_preferences_t preferences{};
+  preferences.compressionLevel = level;
+  preferences.frameInfo.contentSize = size;
+  std::string frame(LZ4F_compressFrameBound(size, &preferences), '\0');
+  const auto n =
+      LZ4F_compressFrame(&frame[0], frame.size(), data, size, &preferences);
+  if (LZ4F_isError(n)) {
+    metbuild_throw_exception(std::string("Lz4 compression failed: ") +
+                             LZ4F_getErrorName(n));
+  }
+  frame.resize(n);
+  return frame;
+}
+
+std::string lz4_decompress(const char *data, size_t size,
+                           size_t original_size) {
+  LZ4F_dctx *context = nullptr;
+  if (LZ4F_isError(LZ4F_createDecompressionContext(&context, LZ4F_VERSION))) {
+    metbuild_throw_exception("Could not create an lz4 decompression context");
+  }
+  std::string out(original_size, '\0');
+  size_t read = 0;
+  size_t written = 0;
+  size_t status = 1;
+  while (status != 0 && read < size && written < original_size) {
+    size_t in = size - read;
+    size_t produced = original_size - written;
+    status = LZ4F_decompress(context, &out[written], &produced, data + read,
+                             &in, nullptr);
+    if (LZ4F_isError(status)) break;
+    read += in;
+    written += produced;
+  }
+  LZ4F_freeDecompressionContext(context);
+  if (LZ4F_isError(status) || written != original_size) {
+    metbuild_throw_exception("Lz4 decompression failed");
+  }
+  return out;
+}
+#endif
+}  // namespace
+
+/**
+ * @brief Returns true if the library was built with the codec
+ * @param codec codec
+ */
+bool StreamCompression::available(const Codec codec) {
+  switch (codec) {
+    case NONE:
+    case GZIP:
+      return true;
+    case ZSTD:
+#ifdef METBUILD_ZSTD
+      return true;
+#else
+      return false;
+#endif
+    case LZ4:
+#ifdef METBUILD_LZ4
+      return true;
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+/**
+ * @brief Parses a codec name, "none", "gzip", "zstd" or "lz4"
+ * @param name codec name, case insensitive
+ * @return codec
+ */
+StreamCompression::Codec StreamCompression::fromName(const std::string &name) {
+  const auto n = boost::to_lower_copy(name);
+  if (n == "none") return NONE;
+  if (n == "gzip" || n == "gz") return GZIP;
+  if (n == "zstd" || n == "zst") return ZSTD;
+  if (n == "lz4") return LZ4;
+  metbuild_throw_exception("Unknown compression codec: " + name);
+  return NONE;
+}
+
+std::string StreamCompression::name(const Codec codec) {
+  switch (codec) {
+    case GZIP:
+      return "gzip";
+    case ZSTD:
+      return "zstd";
+    case LZ4:
+      return "lz4";
+    default:
+      return "none";
+  }
+}
+
+/**
+ * @brief File extension conventionally appended to files written with the
+ * codec, empty when uncompressed
+ * @param codec codec
+ */
+std::string StreamCompression::extension(const Codec codec) {
+  switch (codec) {
+    case GZIP:
+      return ".gz";
+    case ZSTD:
+      return ".zst";
+    case LZ4:
+      return ".lz4";
+    default:
+      return "";
+  }
+}
+
+/**
+ * @brief Level used for the text outputs. Zstd and lz4 at their fast levels
+ * compress the repetitive columns of the ascii formats about as well as gzip
+ * level 2 at several times the speed
+ * @param codec codec
+ */
+int StreamCompression::defaultLevel(const Codec codec) {
+  switch (codec) {
+    case GZIP:
+      return 2;
+    case ZSTD:
+      return 3;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief Compresses a block of data into one self-contained frame
+ * @param codec codec, which must be available
+ * @param data uncompressed data
+ * @param size number of bytes in data
+ * @param level codec specific compression level
+ * @return compressed frame
+ */
+std::string StreamCompression::compress(const Codec codec, const char *data,
+                                        const size_t size, const int level) {
+  switch (codec) {
+    case NONE:
+      return {data, size};
+    case GZIP:
+      return gzip_compress(data, size, level);
+#ifdef METBUILD_ZSTD
+    case ZSTD:
+      return zstd_compress(data, size, level);
+#endif
+#ifdef METBUILD_LZ4
+    case LZ4:
+      return lz4_compress(data, size, level);
+#endif
+    default:
+      break;
+  }
+  metbuild_throw_exception("The library was built without " + name(codec) +
+                           " compression");
+  return {};
+}
+
+/**
+ * @brief Decompresses one frame written by compress
+ * @param codec codec the frame was written with, which must be available
+ * @param data compressed frame
+ * @param size number of bytes in the frame
+ * @param original_size number of bytes the frame was compressed from
+ * @return uncompressed data
+ */
+std::string StreamCompression::decompress(const Codec codec, const char *data,
+                                          const size_t size,
+                                          const size_t original_size) {
+  switch (codec) {
+    case NONE:
+      return {data, size};
+    case GZIP:
+      return gzip_decompress(data, size, original_size);
+#ifdef METBUILD_ZSTD
+    case ZSTD:
+      return zstd_decompress(data, size, original_size);
+#endif
+#ifdef METBUILD_LZ4
+    case LZ4:
+      return lz4_decompress(data, size, original_size);
+#endif
+    default:
+      break;
+  }
+  metbuild_throw_exception("The library was built without " + name(codec) +
+                           " compression");
+  return {};
+}
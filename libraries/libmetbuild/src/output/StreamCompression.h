@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_OUTPUT_STREAMCOMPRESSION_H_
+#define METBUILD_SRC_OUTPUT_STREAMCOMPRESSION_H_
+
+#include <cstddef>
+#include <string>
+
+namespace MetBuild {
+
+/**
+ * @brief Codecs available to the compressed stream outputs
+ *
+ * Each codec produces self-contained frames that may be concatenated, so a
+ * file written block by block, or appended to after a checkpoint, remains a
+ * single valid stream for gzip, zstd and lz4 readers. Gzip is always
+ * available. Zstd and lz4 are only available when the library is built with
+ * METBUILD_ENABLE_ZSTD or METBUILD_ENABLE_LZ4
+ */
+class StreamCompression {
+ public:
+  enum Codec { NONE, GZIP, ZSTD, LZ4 };
+
+  static bool available(Codec codec);
+
+  static Codec fromName(const std::string &name);
+
+  static std::string name(Codec codec);
+
+  static std::string extension(Codec codec);
+
+  static int defaultLevel(Codec codec);
+
+  static std::string compress(Codec codec, const char *data, size_t size,
+                              int level);
+
+  static std::string decompress(Codec codec, const char *data, size_t size,
+                                size_t original_size);
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_OUTPUT_STREAMCOMPRESSION_H_
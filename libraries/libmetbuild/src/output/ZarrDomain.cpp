@@ -0,0 +1,393 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "ZarrDomain.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include "Instrumentation.h"
+#include "Logging.h"
+#include "Overview.h"
+#include "ThreadPool.h"
+#include "boost/filesystem.hpp"
+#include "boost/iostreams/device/back_inserter.hpp"
+#include "boost/iostreams/filter/zlib.hpp"
+#include "boost/iostreams/filtering_stream.hpp"
+
+#define FMT_HEADER_ONLY
+#include "fmt/core.h"
+
+using namespace MetBuild;
+
+namespace {
+
+/**
+ * @brief Zarr dtype of a value in host byte order, so chunks are written
+ * straight from memory
+ */
+std::string host_dtype(const char kind, const size_t size) {
+  const uint16_t one = 1;
+  unsigned char first;
+  std::memcpy(&first, &one, 1);
+  return fmt::format("{}{}{}", first == 1 ? '<' : '>', kind, size);
+}
+
+std::string zlib_compress(const char *data, const size_t size,
+                          const int level) {
+  MetBuild::Instrumentation::ScopedTimer timer(
+      MetBuild::Instrumentation::COMPRESS, size);
+  std::string out;
+  out.reserve(size / 2);
+  {
+    boost::iostreams::filtering_ostream stream;
+    stream.push(boost::iostreams::zlib_compressor(
+        boost::iostreams::zlib_params(level)));
+    stream.push(boost::iostreams::back_inserter(out));
+    stream.write(data, static_cast<std::streamsize>(size));
+  }
+  return out;
+}
+
+std::string json_list(const std::vector<size_t> &values) {
+  std::string s = "[";
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (i > 0) s += ", ";
+    s += std::to_string(values[i]);
+  }
+  return s + "]";
+}
+
+std::string json_string(const std::string &value) {
+  std::string s = "\"";
+  for (const char c : value) {
+    if (c == '"' || c == '\\') s += '\\';
+    s += c;
+  }
+  return s + "\"";
+}
+
+std::pair<std::string, std::string> variable_description(
+    const std::string &variable) {
+  if (variable == "wind_u") return {"e/w wind velocity", "m/s"};
+  if (variable == "wind_v") return {"n/s wind velocity", "m/s"};
+  if (variable == "mslp") return {"air pressure at sea level", "mb"};
+  if (variable == "rain") return {"rainfall rate", "mm/hr"};
+  if (variable == "humidity") return {"relative humidity", "percent"};
+  if (variable == "temperature") return {"air temperature", "degC"};
+  if (variable == "ice") return {"sea ice concentration", "fraction"};
+  return {variable, ""};
+}
+
+}  // namespace
+
+ZarrDomain::ZarrDomain(const MetBuild::Grid *grid,
+                       const MetBuild::Date &startDate,
+                       const MetBuild::Date &endDate, unsigned int time_step,
+                       std::string path, std::vector<std::string> variables,
+                       bool use_compression, std::vector<size_t> overviews)
+    : OutputDomain(grid, startDate, endDate, time_step),
+      m_path(std::move(path)),
+      m_variables(std::move(variables)),
+      m_use_compression(use_compression),
+      m_default_compression_level(2),
+      m_steps((endDate.toSeconds() - startDate.toSeconds()) / time_step + 1),
+      m_overview_factors(std::move(overviews)) {
+  if (m_variables.empty()) {
+    metbuild_throw_exception("Must provide the variables for Zarr output");
+  }
+  for (const auto factor : m_overview_factors) {
+    m_overview_grids.push_back(
+        std::make_unique<Grid>(Overview::grid(*grid, factor)));
+    m_overviews.push_back(std::make_unique<ZarrDomain>(
+        m_overview_grids.back().get(), startDate, endDate, time_step,
+        fmt::format("{}/overview_{}", m_path, factor), m_variables,
+        m_use_compression));
+  }
+  this->open();
+}
+
+void ZarrDomain::open() {
+  if (this->is_open()) return;
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(m_path, ec);
+  if (ec) {
+    metbuild_throw_exception("Could not create Zarr group " + m_path);
+  }
+
+  this->write_object(".zgroup", "{\n  \"zarr_format\": 2\n}\n");
+  const auto overviews =
+      m_overview_factors.empty()
+          ? std::string()
+          : fmt::format(",\n  \"overviews\": {}",
+                        json_list(m_overview_factors));
+  this->write_object(
+      ".zattrs",
+      fmt::format("{{\n  \"institution\": \"metget\",\n"
+                  "  \"start_date\": {},\n  \"end_date\": {},\n"
+                  "  \"time_step\": {}{}\n}}\n",
+                  json_string(this->startDate().toString()),
+                  json_string(this->endDate().toString()), this->timestep(),
+                  overviews));
+
+  const auto nx = this->grid()->ni();
+  const auto ny = this->grid()->nj();
+  const auto grid_unit = this->guessGridUnits();
+  const bool geographic = grid_unit == "deg";
+  m_x_name = geographic ? "lon" : "x";
+  m_y_name = geographic ? "lat" : "y";
+  const auto f8 = host_dtype('f', sizeof(double));
+
+  const auto x = this->grid()->xcolumn();
+  this->write_array_metadata(
+      m_x_name, {nx}, {nx}, f8, "\"NaN\"",
+      fmt::format("\"units\": {}, \"axis\": \"X\"",
+                  json_string(geographic ? "degrees_east" : grid_unit)),
+      m_use_compression);
+  this->write_chunk(m_x_name, "0", reinterpret_cast<const char *>(x.data()),
+                    x.size() * sizeof(double), m_use_compression);
+
+  const auto y = this->grid()->ycolumn();
+  this->write_array_metadata(
+      m_y_name, {ny}, {ny}, f8, "\"NaN\"",
+      fmt::format("\"units\": {}, \"axis\": \"Y\"",
+                  json_string(geographic ? "degrees_north" : grid_unit)),
+      m_use_compression);
+  this->write_chunk(m_y_name, "0", reinterpret_cast<const char *>(y.data()),
+                    y.size() * sizeof(double), m_use_compression);
+
+  const auto time_units =
+      "minutes since " + this->startDate().toString("%F %T");
+  this->write_array_metadata(
+      "time", {m_steps}, {1}, f8, "\"NaN\"",
+      fmt::format("\"units\": {}, \"calendar\": \"proleptic_gregorian\", "
+                  "\"axis\": \"T\"",
+                  json_string(time_units)),
+      false);
+
+  const auto field_dtype =
+      host_dtype('f', sizeof(MetBuild::MeteorologicalDataType));
+  const auto fill =
+      fmt::format("{:.1f}", MeteorologicalData<1>::flag_value());
+  for (const auto &v : m_variables) {
+    const auto description = variable_description(v);
+    this->write_array_metadata(
+        v, {m_steps, ny, nx}, {1, ny, nx}, field_dtype, fill,
+        fmt::format("\"long_name\": {}, \"units\": {}",
+                    json_string(description.first),
+                    json_string(description.second)),
+        m_use_compression);
+  }
+  this->set_open(true);
+}
+
+void ZarrDomain::close() { this->set_open(false); }
+
+int ZarrDomain::write(
+    const MetBuild::Date &date,
+    const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+        &data) {
+  this->write_fields(date, &data, nullptr);
+  return 0;
+}
+
+int ZarrDomain::write(
+    const MetBuild::Date &date,
+    const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+        &data) {
+  this->write_fields(date, nullptr, &data);
+  return 0;
+}
+
+/**
+ * @brief Every object of the group written so far, as paths on disk
+ */
+std::vector<std::string> ZarrDomain::objects() const {
+  std::vector<std::string> objects;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    objects = m_objects;
+  }
+  for (const auto &o : m_overviews) {
+    const auto child = o->objects();
+    objects.insert(objects.end(), child.begin(), child.end());
+  }
+  return objects;
+}
+
+/**
+ * @brief Objects completed since the previous call, so they can be uploaded
+ * while the rest of the request is being generated
+ */
+std::vector<std::string> ZarrDomain::take_written() {
+  std::vector<std::string> written;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    written.swap(m_written);
+  }
+  for (auto &o : m_overviews) {
+    const auto child = o->take_written();
+    written.insert(written.end(), child.begin(), child.end());
+  }
+  return written;
+}
+
+size_t ZarrDomain::time_index(const MetBuild::Date &date) const {
+  const auto offset = date.toSeconds() - this->startDate().toSeconds();
+  if (offset < 0 || offset % this->timestep() != 0) {
+    metbuild_throw_exception("Date does not fall on a Zarr time step");
+  }
+  const auto index = static_cast<size_t>(offset / this->timestep());
+  if (index >= m_steps) {
+    metbuild_throw_exception("Attempt to write past file end date");
+  }
+  return index;
+}
+
+void ZarrDomain::write_fields(const MetBuild::Date &date,
+                              const MetBuild::MeteorologicalData<1> *scalar,
+                              const MetBuild::MeteorologicalData<3> *vector) {
+  if (!this->is_open()) {
+    metbuild_throw_exception("Zarr domain not open");
+  }
+  const auto index = this->time_index(date);
+  const auto key = fmt::format("{}.0.0", index);
+  const size_t n_fields =
+      std::min<size_t>(m_variables.size(), scalar ? 1 : 3);
+
+  //...Chunks of the variables are compressed and written in parallel
+  ThreadPool::global().parallel_for(0, n_fields, [&](size_t v) {
+    const auto values = scalar ? scalar->parameter(v) : vector->parameter(v);
+    this->write_chunk(m_variables[v], key,
+                      reinterpret_cast<const char *>(values.data()),
+                      values.size() * sizeof(MetBuild::MeteorologicalDataType),
+                      m_use_compression);
+  });
+
+  for (size_t k = 0; k < m_overviews.size(); ++k) {
+    const auto factor = m_overview_factors[k];
+    if (scalar) {
+      MeteorologicalData<1> level;
+      Overview::average(*scalar, factor, level);
+      m_overviews[k]->write(date, level);
+    } else {
+      MeteorologicalData<3> level;
+      Overview::average(*vector, factor, level);
+      m_overviews[k]->write(date, level);
+    }
+  }
+
+  //...The time value goes last, so a reader that finds it can rely on the
+  // fields of the step, overviews included, being complete
+  const double minutes =
+      static_cast<double>(date.toSeconds() - this->startDate().toSeconds()) /
+      60.0;
+  this->write_chunk("time", std::to_string(index),
+                    reinterpret_cast<const char *>(&minutes), sizeof(double),
+                    false);
+}
+
+void ZarrDomain::write_array_metadata(const std::string &name,
+                                      const std::vector<size_t> &shape,
+                                      const std::vector<size_t> &chunks,
+                                      const std::string &dtype,
+                                      const std::string &fill_value,
+                                      const std::string &attributes,
+                                      const bool compressed) {
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(m_path + "/" + name, ec);
+  if (ec) {
+    metbuild_throw_exception("Could not create Zarr array " + name);
+  }
+
+  const auto compressor =
+      compressed
+          ? fmt::format("{{\"id\": \"zlib\", \"level\": {}}}",
+                        m_default_compression_level)
+          : std::string("null");
+  this->write_object(
+      name + "/.zarray",
+      fmt::format("{{\n  \"chunks\": {},\n  \"compressor\": {},\n"
+                  "  \"dimension_separator\": \".\",\n  \"dtype\": {},\n"
+                  "  \"fill_value\": {},\n  \"filters\": null,\n"
+                  "  \"order\": \"C\",\n  \"shape\": {},\n"
+                  "  \"zarr_format\": 2\n}}\n",
+                  json_list(chunks), compressor, json_string(dtype),
+                  fill_value, json_list(shape)));
+
+  std::string dimensions;
+  if (shape.size() == 3) {
+    dimensions = fmt::format("[\"time\", {}, {}]", json_string(m_y_name),
+                             json_string(m_x_name));
+  } else {
+    dimensions = fmt::format("[{}]", json_string(name));
+  }
+  this->write_object(name + "/.zattrs",
+                     fmt::format("{{\n  \"_ARRAY_DIMENSIONS\": {},\n  {}\n}}\n",
+                                 dimensions, attributes));
+}
+
+/**
+ * @brief Writes one chunk of an array. compress must match the compressor
+ * given in the array metadata
+ */
+void ZarrDomain::write_chunk(const std::string &array, const std::string &key,
+                             const char *data, const size_t size,
+                             const bool compress) {
+  if (compress) {
+    this->write_object(array + "/" + key,
+                       zlib_compress(data, size, m_default_compression_level));
+  } else {
+    this->write_object(array + "/" + key, std::string(data, size));
+  }
+}
+
+void ZarrDomain::write_object(const std::string &relative_path,
+                              const std::string &content) {
+  const auto path = m_path + "/" + relative_path;
+  const auto tmp = path + "." + boost::filesystem::unique_path().string();
+  {
+    std::ofstream f(tmp, std::ios::binary);
+    if (!f.is_open()) {
+      metbuild_throw_exception("Could not write Zarr object " + path);
+    }
+    f.write(content.data(), static_cast<std::streamsize>(content.size()));
+  }
+  boost::system::error_code ec;
+  boost::filesystem::rename(tmp, path, ec);
+  if (ec) {
+    boost::filesystem::remove(tmp, ec);
+    metbuild_throw_exception("Could not write Zarr object " + path);
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_object_set.insert(path).second) m_objects.push_back(path);
+  m_written.push_back(path);
+}
@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METGET_SRC_OUTPUT_ZARRDOMAIN_H_
+#define METGET_SRC_OUTPUT_ZARRDOMAIN_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Date.h"
+#include "Grid.h"
+#include "MeteorologicalData.h"
+#include "OutputDomain.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Writes one domain as a group of a Zarr v2 directory store
+ *
+ * The group holds one-dimensional time and coordinate arrays and a (time,
+ * y, x) array per variable, chunked one time slice per object. The array
+ * shapes cover the whole requested period from the start, so each time step
+ * only adds its chunk objects. Chunks are written under a temporary name
+ * and renamed, so a reader or uploader never sees a partial object and
+ * steps that have not been written yet read as the fill value
+ *
+ * Each overview factor adds a subgroup overview_<factor> holding the same
+ * variables block-averaged by that factor, written in the same pass as the
+ * full resolution chunks
+ */
+class ZarrDomain : public OutputDomain {
+ public:
+  ZarrDomain(const MetBuild::Grid *grid, const MetBuild::Date &startDate,
+             const MetBuild::Date &endDate, unsigned time_step,
+             std::string path, std::vector<std::string> variables,
+             bool use_compression, std::vector<size_t> overviews = {});
+
+  ~ZarrDomain() override = default;
+
+  void open() override;
+
+  void close() override;
+
+  int write(
+      const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  int write(
+      const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  std::vector<std::string> objects() const;
+
+  std::vector<std::string> take_written();
+
+ private:
+  size_t time_index(const MetBuild::Date &date) const;
+
+  void write_fields(const MetBuild::Date &date,
+                    const MetBuild::MeteorologicalData<1> *scalar,
+                    const MetBuild::MeteorologicalData<3> *vector);
+
+  void write_array_metadata(const std::string &name,
+                            const std::vector<size_t> &shape,
+                            const std::vector<size_t> &chunks,
+                            const std::string &dtype,
+                            const std::string &fill_value,
+                            const std::string &attributes, bool compressed);
+
+  void write_chunk(const std::string &array, const std::string &key,
+                   const char *data, size_t size, bool compress);
+
+  void write_object(const std::string &relative_path,
+                    const std::string &content);
+
+  const std::string m_path;
+  const std::vector<std::string> m_variables;
+  const bool m_use_compression;
+  const int m_default_compression_level;
+  const size_t m_steps;
+  const std::vector<size_t> m_overview_factors;
+  std::string m_x_name;
+  std::string m_y_name;
+
+  mutable std::mutex m_mutex;
+  std::vector<std::string> m_objects;
+  std::unordered_set<std::string> m_object_set;
+  std::vector<std::string> m_written;
+
+  std::vector<std::unique_ptr<MetBuild::Grid>> m_overview_grids;
+  std::vector<std::unique_ptr<MetBuild::ZarrDomain>> m_overviews;
+};
+
+}  // namespace MetBuild
+#endif  // METGET_SRC_OUTPUT_ZARRDOMAIN_H_
@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "ZarrOutput.h"
+
+#include <fstream>
+#include <memory>
+#include <utility>
+
+#include "ZarrDomain.h"
+#include "boost/filesystem.hpp"
+
+#define FMT_HEADER_ONLY
+#include "fmt/core.h"
+
+using namespace MetBuild;
+
+ZarrOutput::ZarrOutput(const MetBuild::Date& date_start,
+                       const MetBuild::Date& date_end, unsigned time_step,
+                       std::string filename, bool use_compression)
+    : OutputFile(date_start, date_end, time_step),
+      m_filename(std::move(filename)),
+      m_use_compression(use_compression) {
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(m_filename, ec);
+  if (ec) {
+    metbuild_throw_exception("Could not create Zarr store " + m_filename);
+  }
+  const auto root = m_filename + "/.zgroup";
+  std::ofstream f(root, std::ios::binary);
+  if (!f.is_open()) {
+    metbuild_throw_exception("Could not write Zarr object " + root);
+  }
+  f << "{\n  \"zarr_format\": 2\n}\n";
+  m_written.push_back(root);
+}
+
+/**
+ * @brief Every object of the store written so far
+ */
+std::vector<std::string> ZarrOutput::filenames() const {
+  std::vector<std::string> files = {m_filename + "/.zgroup"};
+  for (const auto* d : m_zarr_domains) {
+    const auto objects = d->objects();
+    files.insert(files.end(), objects.begin(), objects.end());
+  }
+  return files;
+}
+
+void ZarrOutput::addDomain(const MetBuild::Grid& w,
+                           const std::vector<std::string>& variables) {
+  const auto group =
+      fmt::format("{}/domain_{:02d}", m_filename, m_domains.size());
+  auto domain = std::make_unique<ZarrDomain>(
+      &w, this->startDate(), this->endDate(), this->timeStep(), group,
+      variables, m_use_compression, m_overviews);
+  m_zarr_domains.push_back(domain.get());
+  m_domains.push_back(std::move(domain));
+}
+
+/**
+ * @brief Sets the factors of the block-averaged overview levels written
+ * next to each domain, e.g. {2, 4, 8}
+ * @param factors decimation factors, each at least 2
+ */
+void ZarrOutput::set_overviews(const std::vector<size_t>& factors) {
+  for (const auto f : factors) {
+    if (f < 2) {
+      metbuild_throw_exception("Overview factors must be at least 2");
+    }
+  }
+  m_overviews = factors;
+}
+
+int ZarrOutput::write(const MetBuild::Date& date, size_t domain_index,
+                      const MetBuild::MeteorologicalData<1>& data) {
+  return this->write_domain(domain_index, date, data);
+}
+
+int ZarrOutput::write(const MetBuild::Date& date, size_t domain_index,
+                      const MetBuild::MeteorologicalData<3>& data) {
+  return this->write_domain(domain_index, date, data);
+}
+
+/**
+ * @brief Objects completed since the previous call. Objects are complete
+ * once listed, but the time steps queued on asynchronous writers may still
+ * be in flight
+ */
+std::vector<std::string> ZarrOutput::take_written() {
+  std::vector<std::string> written;
+  written.swap(m_written);
+  for (auto* d : m_zarr_domains) {
+    const auto objects = d->take_written();
+    written.insert(written.end(), objects.begin(), objects.end());
+  }
+  return written;
+}
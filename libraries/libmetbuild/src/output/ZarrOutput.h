@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METGET_SRC_OUTPUT_ZARROUTPUT_H_
+#define METGET_SRC_OUTPUT_ZARROUTPUT_H_
+
+#include <string>
+#include <vector>
+
+#include "OutputFile.h"
+
+namespace MetBuild {
+
+class ZarrDomain;
+
+/**
+ * @brief Writes a Zarr v2 directory store with a group per domain
+ *
+ * Domains are written to groups named domain_00, domain_01, ... in the
+ * order they are added. take_written hands out the objects completed so
+ * far, so they can be uploaded while later time steps are still being
+ * generated
+ *
+ * Overview factors set with set_overviews apply to the domains added after
+ * the call
+ */
+class ZarrOutput : public OutputFile {
+ public:
+  ZarrOutput(const MetBuild::Date &date_start, const MetBuild::Date &date_end,
+             unsigned time_step, std::string filename,
+             bool use_compression = true);
+
+  std::vector<std::string> filenames() const override;
+
+  void addDomain(const MetBuild::Grid &w,
+                 const std::vector<std::string> &variables) override;
+
+  int write(
+      const MetBuild::Date &date, size_t domain_index,
+      const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  int write(
+      const MetBuild::Date &date, size_t domain_index,
+      const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+          &data) override;
+
+  std::vector<std::string> take_written();
+
+  void set_overviews(const std::vector<size_t> &factors);
+
+ private:
+  const std::string m_filename;
+  const bool m_use_compression;
+  std::vector<size_t> m_overviews;
+  std::vector<MetBuild::ZarrDomain *> m_zarr_domains;
+  std::vector<std::string> m_written;
+};
+}  // namespace MetBuild
+
+#endif  // METGET_SRC_OUTPUT_ZARROUTPUT_H_
@@ -0,0 +1,247 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "AtcfTrack.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include "Logging.h"
+
+using namespace MetBuild;
+
+namespace {
+constexpr double c_knot = 0.514444;
+constexpr double c_nautical_mile = 1852.0;
+constexpr double c_earth_radius = 6378135.0;
+constexpr double c_deg2rad = M_PI / 180.0;
+
+std::string trim(const std::string &s) {
+  const auto first = s.find_first_not_of(' ');
+  if (first == std::string::npos) return {};
+  const auto last = s.find_last_not_of(' ');
+  return s.substr(first, last - first + 1);
+}
+
+/**
+ * @brief Converts an ATCF position in tenths of a degree with a hemisphere
+ * suffix, e.g. 235N or 0804W, to signed degrees
+ */
+double parse_position(const std::string &field) {
+  const auto s = trim(field);
+  if (s.size() < 2) {
+    metbuild_throw_exception("Invalid ATCF position: " + field);
+  }
+  const double value = std::stod(s.substr(0, s.size() - 1)) / 10.0;
+  const char hemisphere = s.back();
+  return (hemisphere == 'S' || hemisphere == 'W') ? -value : value;
+}
+
+double parse_number(const std::vector<std::string> &fields, size_t index) {
+  if (index >= fields.size()) return 0.0;
+  const auto s = trim(fields[index]);
+  return s.empty() ? 0.0 : std::stod(s);
+}
+}  // namespace
+
+/**
+ * @brief Reads a track from an ATCF file
+ * @param filename ATCF file
+ */
+AtcfTrack::AtcfTrack(const std::string &filename) {
+  std::ifstream f(filename);
+  if (!f.is_open()) {
+    metbuild_throw_exception("Could not open track file " + filename);
+  }
+  m_records = AtcfTrack::parse(f);
+  this->validate();
+}
+
+/**
+ * @brief Builds a track from records, for instance a perturbed copy of
+ * another track
+ * @param records storm parameters, which are sorted by time
+ */
+AtcfTrack::AtcfTrack(std::vector<AtcfRecord> records)
+    : m_records(std::move(records)) {
+  std::stable_sort(m_records.begin(), m_records.end(),
+                   [](const AtcfRecord &a, const AtcfRecord &b) {
+                     return a.time < b.time;
+                   });
+  this->validate();
+}
+
+std::vector<AtcfRecord> AtcfTrack::parse(std::istream &stream) {
+  std::vector<AtcfRecord> records;
+  std::string line;
+  while (std::getline(stream, line)) {
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ',')) fields.push_back(field);
+    if (fields.size() < 10) continue;
+
+    AtcfRecord r;
+    r.time.fromString(trim(fields[2]), "%Y%m%d%H");
+    r.time += static_cast<long>(parse_number(fields, 5) * 3600.0);
+    if (!records.empty() && records.back().time == r.time) continue;
+
+    r.latitude = parse_position(fields[6]);
+    r.longitude = parse_position(fields[7]);
+    r.max_wind = parse_number(fields, 8) * c_knot;
+    r.central_pressure = parse_number(fields, 9);
+    r.background_pressure = parse_number(fields, 17);
+    r.radius_max_wind = parse_number(fields, 19) * c_nautical_mile;
+    records.push_back(r);
+  }
+  std::stable_sort(records.begin(), records.end(),
+                   [](const AtcfRecord &a, const AtcfRecord &b) {
+                     return a.time < b.time;
+                   });
+  return records;
+}
+
+/**
+ * @brief Fills parameters missing from the track and drops times that cannot
+ * be used
+ */
+void AtcfTrack::validate() {
+  std::vector<AtcfRecord> records;
+  double last_rmw = AtcfTrack::default_radius_max_wind();
+  for (auto r : m_records) {
+    if (!records.empty() && records.back().time == r.time) continue;
+    if (r.central_pressure <= 0.0) {
+      Logging::warning("Skipping track time " + r.time.toString() +
+                       " without a central pressure");
+      continue;
+    }
+    if (r.radius_max_wind <= 0.0) {
+      r.radius_max_wind = last_rmw;
+    }
+    last_rmw = r.radius_max_wind;
+    if (r.background_pressure <= r.central_pressure) {
+      r.background_pressure = std::max(AtcfTrack::default_background_pressure(),
+                                       r.central_pressure + 1.0);
+    }
+    records.push_back(r);
+  }
+  if (records.empty()) {
+    metbuild_throw_exception("Track does not contain any usable time");
+  }
+
+  //...Longitudes are made continuous so storms crossing the dateline are
+  // interpolated along the short path
+  for (size_t i = 1; i < records.size(); ++i) {
+    const double d = records[i].longitude - records[i - 1].longitude;
+    records[i].longitude -= 360.0 * std::round(d / 360.0);
+  }
+  m_records = std::move(records);
+}
+
+const std::vector<AtcfRecord> &AtcfTrack::records() const {
+  return m_records;
+}
+
+size_t AtcfTrack::size() const { return m_records.size(); }
+
+Date AtcfTrack::start_date() const { return m_records.front().time; }
+
+Date AtcfTrack::end_date() const { return m_records.back().time; }
+
+bool AtcfTrack::contains(const MetBuild::Date &date) const {
+  return this->start_date() <= date && date <= this->end_date();
+}
+
+/**
+ * @brief Index of the record starting the interval containing a date
+ */
+size_t AtcfTrack::segment(const MetBuild::Date &date) const {
+  if (m_records.size() < 2) return 0;
+  const auto it = std::upper_bound(
+      m_records.begin(), m_records.end(), date,
+      [](const Date &d, const AtcfRecord &r) { return d < r.time; });
+  const auto index = static_cast<size_t>(std::distance(m_records.begin(), it));
+  return std::min(index == 0 ? 0 : index - 1, m_records.size() - 2);
+}
+
+/**
+ * @brief Storm parameters at a date, linearly interpolated between the track
+ * times around it. Dates outside the track take the nearest time
+ * @param date date
+ * @return storm parameters
+ */
+AtcfRecord AtcfTrack::at(const MetBuild::Date &date) const {
+  if (m_records.size() == 1 || date <= this->start_date()) {
+    auto r = m_records.front();
+    r.time = date;
+    return r;
+  }
+  if (this->end_date() <= date) {
+    auto r = m_records.back();
+    r.time = date;
+    return r;
+  }
+  const auto k = this->segment(date);
+  const auto &a = m_records[k];
+  const auto &b = m_records[k + 1];
+  const double w =
+      static_cast<double>(date.toSeconds() - a.time.toSeconds()) /
+      static_cast<double>(b.time.toSeconds() - a.time.toSeconds());
+  auto lerp = [w](double x, double y) { return x + w * (y - x); };
+
+  AtcfRecord r;
+  r.time = date;
+  r.latitude = lerp(a.latitude, b.latitude);
+  r.longitude = lerp(a.longitude, b.longitude);
+  r.max_wind = lerp(a.max_wind, b.max_wind);
+  r.central_pressure = lerp(a.central_pressure, b.central_pressure);
+  r.background_pressure = lerp(a.background_pressure, b.background_pressure);
+  r.radius_max_wind = lerp(a.radius_max_wind, b.radius_max_wind);
+  return r;
+}
+
+/**
+ * @brief Storm translation velocity at a date from the track times around it
+ * @param date date
+ * @return eastward and northward speed in m/s
+ */
+std::array<double, 2> AtcfTrack::translation(const MetBuild::Date &date) const {
+  if (m_records.size() < 2) return {0.0, 0.0};
+  const auto k = this->segment(date);
+  const auto &a = m_records[k];
+  const auto &b = m_records[k + 1];
+  const auto dt =
+      static_cast<double>(b.time.toSeconds() - a.time.toSeconds());
+  const double phi = 0.5 * (a.latitude + b.latitude) * c_deg2rad;
+  const double dx = c_earth_radius * std::cos(phi) *
+                    (b.longitude - a.longitude) * c_deg2rad;
+  const double dy = c_earth_radius * (b.latitude - a.latitude) * c_deg2rad;
+  return {dx / dt, dy / dt};
+}
@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_VORTEX_ATCFTRACK_H_
+#define METBUILD_SRC_VORTEX_ATCFTRACK_H_
+
+#include <array>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "CppAttributes.h"
+#include "Date.h"
+
+namespace MetBuild {
+
+/**
+ * @brief Storm parameters of one track time, in SI units except pressure
+ */
+struct AtcfRecord {
+  MetBuild::Date time;
+  double latitude = 0.0;             // degrees north
+  double longitude = 0.0;            // degrees east
+  double max_wind = 0.0;             // m/s, 1 minute sustained at 10 m
+  double central_pressure = 0.0;     // mb
+  double background_pressure = 0.0;  // mb
+  double radius_max_wind = 0.0;      // m
+};
+
+/**
+ * @brief Storm track read from an ATCF (fort.22) best track or forecast file
+ *
+ * Each time appears once, taken from the first line written for it, since
+ * the lines of the other isotach levels repeat the central parameters. The
+ * time of a line is its date plus its forecast period, which covers best
+ * tracks, forecasts and the merged tracks written by the build driver
+ */
+class AtcfTrack {
+ public:
+  explicit AtcfTrack(const std::string &filename);
+
+  explicit AtcfTrack(std::vector<AtcfRecord> records);
+
+  NODISCARD const std::vector<AtcfRecord> &records() const;
+
+  NODISCARD size_t size() const;
+
+  NODISCARD MetBuild::Date start_date() const;
+
+  NODISCARD MetBuild::Date end_date() const;
+
+  NODISCARD bool contains(const MetBuild::Date &date) const;
+
+  NODISCARD AtcfRecord at(const MetBuild::Date &date) const;
+
+  NODISCARD std::array<double, 2> translation(
+      const MetBuild::Date &date) const;
+
+  static constexpr double default_background_pressure() { return 1013.0; }
+
+  static constexpr double default_radius_max_wind() { return 25.0 * 1852.0; }
+
+ private:
+  static std::vector<AtcfRecord> parse(std::istream &stream);
+
+  void validate();
+
+  NODISCARD size_t segment(const MetBuild::Date &date) const;
+
+  std::vector<AtcfRecord> m_records;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_VORTEX_ATCFTRACK_H_
@@ -0,0 +1,212 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include "HollandVortex.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ThreadPool.h"
+#include "output/OutputFile.h"
+
+using namespace MetBuild;
+
+namespace {
+constexpr double c_earth_radius = 6378135.0;
+constexpr double c_omega = 7.292115e-5;
+constexpr double c_deg2rad = M_PI / 180.0;
+
+//...Inflow angle inside the radius of maximum winds and beyond 1.2 times it
+constexpr double c_inflow_inner = 10.0 * c_deg2rad;
+constexpr double c_inflow_outer = 25.0 * c_deg2rad;
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param grid output grid, reprojected to geographic coordinates when it is
+ * defined in another projection
+ * @param track storm track
+ */
+HollandVortex::HollandVortex(const MetBuild::Grid *grid,
+                             MetBuild::AtcfTrack track)
+    : m_grid(grid),
+      m_track(std::move(track)),
+      m_longitude(grid->x()),
+      m_latitude(grid->y()) {
+  if (m_grid->epsg() != 4326) {
+    const auto &g = m_grid->geographic_positions(m_grid->epsg());
+    size_t c = 0;
+    for (const auto &row : g) {
+      for (const auto &p : row) {
+        m_longitude[c] = p.x();
+        m_latitude[c] = p.y();
+        ++c;
+      }
+    }
+  }
+}
+
+const AtcfTrack &HollandVortex::track() const { return m_track; }
+
+/**
+ * @brief Evaluates the vortex at a date into a caller owned buffer, which is
+ * only reallocated when its shape does not match the output grid
+ *
+ * Dates outside the track give calm winds at the background pressure
+ *
+ * @param date date
+ * @param out output buffer receiving u, v and pressure
+ */
+void HollandVortex::evaluate(
+    const MetBuild::Date &date,
+    MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType> &out)
+    const {
+  using M = MeteorologicalData<3, MeteorologicalDataType>;
+  if (out.ni() != m_grid->ni() || out.nj() != m_grid->nj()) {
+    out.resize(m_grid->ni(), m_grid->nj());
+  }
+  if (!m_track.contains(date)) {
+    out.fill_parameter(0, 0.0);
+    out.fill_parameter(1, 0.0);
+    out.fill_parameter(2, M::background_pressure());
+    return;
+  }
+
+  const auto storm = m_track.at(date);
+  const auto translation = m_track.translation(date);
+  const double translation_speed =
+      std::hypot(translation[0], translation[1]);
+
+  const double pc = storm.central_pressure;
+  const double pn = storm.background_pressure;
+  const double dp = (pn - pc) * 100.0;
+  const double vmax_bl =
+      std::max(storm.max_wind - translation_speed, 1.0) /
+      HollandVortex::boundary_layer_adjustment();
+  const double b = std::clamp(rho_air() * M_E * vmax_bl * vmax_bl / dp, 1.0,
+                              2.5);
+  const double f = 2.0 * c_omega * std::sin(std::abs(storm.latitude) *
+                                            c_deg2rad);
+  const double rotation = storm.latitude >= 0.0 ? 1.0 : -1.0;
+  const double rmw = storm.radius_max_wind;
+  const double surface = HollandVortex::boundary_layer_adjustment() *
+                         HollandVortex::one_to_ten_minute();
+  const double lat0 = storm.latitude;
+  const double lon0 = storm.longitude;
+
+  //...Branch free over the cells so the loop vectorizes
+  const size_t n = m_longitude.size();
+  const double *lon = m_longitude.data();
+  const double *lat = m_latitude.data();
+  auto *u = out.parameter(0).data();
+  auto *v = out.parameter(1).data();
+  auto *p = out.parameter(2).data();
+  for (size_t c = 0; c < n; ++c) {
+    double dlon = lon[c] - lon0;
+    dlon -= 360.0 * std::nearbyint(dlon / 360.0);
+    const double phi = 0.5 * (lat[c] + lat0) * c_deg2rad;
+    const double dx = c_earth_radius * std::cos(phi) * dlon * c_deg2rad;
+    const double dy = c_earth_radius * (lat[c] - lat0) * c_deg2rad;
+    const double r = std::max(std::sqrt(dx * dx + dy * dy), 1.0);
+
+    const double ratio = std::pow(rmw / r, b);
+    const double decay = std::exp(-ratio);
+    const double rf = 0.5 * r * f;
+    const double vg =
+        std::sqrt(ratio * b * dp * decay / rho_air() + rf * rf) - rf;
+
+    const double inflow =
+        c_inflow_inner +
+        (c_inflow_outer - c_inflow_inner) *
+            std::clamp((r / rmw - 1.0) / 0.2, 0.0, 1.0);
+    const double ci = std::cos(inflow);
+    const double si = std::sin(inflow);
+
+    //...Tangential direction, counterclockwise in the northern hemisphere,
+    // turned toward the center by the inflow angle
+    const double ex = (-rotation * dy * ci - dx * si) / r;
+    const double ey = (rotation * dx * ci - dy * si) / r;
+
+    const double speed = vg * surface;
+    const double scale = vg / vmax_bl;
+    u[c] = static_cast<MeteorologicalDataType>(speed * ex +
+                                               scale * translation[0]);
+    v[c] = static_cast<MeteorologicalDataType>(speed * ey +
+                                               scale * translation[1]);
+    p[c] = static_cast<MeteorologicalDataType>(pc + (pn - pc) * decay);
+  }
+}
+
+MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+HollandVortex::evaluate(const MetBuild::Date &date) const {
+  MetBuild::MeteorologicalData<3, MeteorologicalDataType> out;
+  this->evaluate(date, out);
+  return out;
+}
+
+/**
+ * @brief Evaluates the vortex for every output time and writes it to a
+ * domain of an output file
+ *
+ * Times are evaluated in parallel in batches and written in order from the
+ * calling thread
+ *
+ * @param output output file
+ * @param domain_index domain of the output file
+ * @param start_date first output time
+ * @param end_date last output time
+ * @param time_step output time step in seconds
+ * @return 0 on success
+ */
+int HollandVortex::write(MetBuild::OutputFile *output, size_t domain_index,
+                         const MetBuild::Date &start_date,
+                         const MetBuild::Date &end_date,
+                         unsigned time_step) const {
+  if (time_step == 0) {
+    metbuild_throw_exception("Time step must be positive");
+  }
+  std::vector<Date> times;
+  for (auto t = start_date; t <= end_date; t += time_step) {
+    times.push_back(t);
+  }
+
+  auto &pool = ThreadPool::global();
+  const size_t batch = 2 * (pool.size() + 1);
+  std::vector<MeteorologicalData<3, MeteorologicalDataType>> fields(
+      std::min(batch, times.size()));
+  for (size_t first = 0; first < times.size(); first += batch) {
+    const size_t count = std::min(batch, times.size() - first);
+    pool.parallel_for(0, count, [&](const size_t k) {
+      this->evaluate(times[first + k], fields[k]);
+    });
+    for (size_t k = 0; k < count; ++k) {
+      output->write(times[first + k], domain_index, fields[k]);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_SRC_VORTEX_HOLLANDVORTEX_H_
+#define METBUILD_SRC_VORTEX_HOLLANDVORTEX_H_
+
+#include <vector>
+
+#include "CppAttributes.h"
+#include "Date.h"
+#include "Grid.h"
+#include "MeteorologicalData.h"
+#include "vortex/AtcfTrack.h"
+
+namespace MetBuild {
+
+class OutputFile;
+
+/**
+ * @brief Holland (1980) parametric vortex evaluated from a storm track onto
+ * an output grid
+ *
+ * The Holland B parameter is derived at each time from the maximum wind,
+ * reduced by the translation speed and taken to the top of the boundary
+ * layer, and the pressure deficit. Surface winds are the gradient winds
+ * reduced to 10 m and 10 minute averages, turned inward by an inflow angle,
+ * with the storm translation added in proportion to the wind speed
+ */
+class HollandVortex {
+ public:
+  HollandVortex(const MetBuild::Grid *grid, MetBuild::AtcfTrack track);
+
+  void evaluate(
+      const MetBuild::Date &date,
+      MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType> &out)
+      const;
+
+  MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType> evaluate(
+      const MetBuild::Date &date) const;
+
+  int write(MetBuild::OutputFile *output, size_t domain_index,
+            const MetBuild::Date &start_date, const MetBuild::Date &end_date,
+            unsigned time_step) const;
+
+  NODISCARD const MetBuild::AtcfTrack &track() const;
+
+  static constexpr double rho_air() { return 1.15; }
+
+  static constexpr double boundary_layer_adjustment() { return 0.9; }
+
+  static constexpr double one_to_ten_minute() { return 0.88; }
+
+ private:
+  const MetBuild::Grid *m_grid;
+  MetBuild::AtcfTrack m_track;
+  std::vector<double> m_longitude;
+  std::vector<double> m_latitude;
+};
+
+}  // namespace MetBuild
+
+#endif  // METBUILD_SRC_VORTEX_HOLLANDVORTEX_H_
@@ -23,7 +23,60 @@
 // Author: Zach Cobell
 // Contact: zcobell@thewaterinstitute.org
 //
-%module pymetbuild
+%module(threads="1") pymetbuild
+
+//...The GIL is only released around the calls that decode, interpolate or
+// write, so Python threads such as S3 transfers run alongside them. These
+// calls never touch Python objects. Everything else keeps the GIL, which is
+// cheaper for short calls and required by the buffer helpers below
+%nothread;
+%thread MetBuild::Meteorology::process_data;
+%thread MetBuild::Meteorology::to_wind_grid;
+%thread MetBuild::Meteorology::to_grid;
+%thread MetBuild::Meteorology::write_debug_file;
+%thread MetBuild::Meteorology::write_field_file;
+%thread MetBuild::Meteorology::write_grib_index;
+%thread MetBuild::MeteorologyPipeline::start;
+%thread MetBuild::MeteorologyPipeline::wait;
+%thread MetBuild::MeteorologyPipeline::next;
+%thread MetBuild::MeteorologyPipeline::~MeteorologyPipeline;
+%thread MetBuild::CompositeMeteorology::to_wind_grid;
+%thread MetBuild::CompositeMeteorology::to_grid;
+%thread MetBuild::HollandVortex::write;
+%thread MetBuild::BuildRequest::run;
+%thread MetBuild::BuildRequest::start;
+%thread MetBuild::BuildRequest::cancel;
+%thread MetBuild::BuildRequest::wait;
+%thread MetBuild::BuildRequest::~BuildRequest;
+%thread MetBuild::PointSeries::extract;
+%thread MetBuild::Coupler::initialize;
+%thread MetBuild::Coupler::update_until;
+%thread MetBuild::Coupler::publish;
+%thread MetBuild::Coupler::finalize;
+%thread MetBuild::Coupler::~Coupler;
+%thread MetBuild::OutputFile::write;
+%thread MetBuild::OutputFile::flush;
+%thread MetBuild::OwiAscii::write;
+%thread MetBuild::OwiBinary::write;
+%thread MetBuild::OwiNetcdf::write;
+%thread MetBuild::RasNetcdf::write;
+%thread MetBuild::PointNetcdf::write;
+%thread MetBuild::OutputStitch::netcdf;
+%thread MetBuild::OutputStitch::owi_ascii;
+%thread MetBuild::OutputStitch::netcdf_window;
+%thread MetBuild::DelftOutput::write;
+%thread MetBuild::ZarrOutput::write;
+%thread MetBuild::EnvelopeOutput::write;
+%thread MetBuild::GribOutput::write;
+%thread MetBuild::OutputGroup::write;
+%thread MetBuild::OutputGroup::flush;
+%thread MetBuild::OutputFanout::write;
+%thread MetBuild::OutputFanout::flush;
+%thread MetBuild::ShardedOutput::write;
+%thread MetBuild::ShardedOutput::flush;
+%thread MetBuild::ShardedOutput::~ShardedOutput;
+%thread MetBuild::EnvelopeOutput::close;
+%thread MetBuild::EnvelopeOutput::~EnvelopeOutput;
 
 %insert("python") %{
     import signal
@@ -35,20 +88,108 @@
 #include "MetBuild_Global.h"
 #include "CppAttributes.h"
 #include "Point.h"
+#include "ExecutionPolicy.h"
 #include "Meteorology.h"
+#include "StepStatistics.h"
+#include "MeteorologyPipeline.h"
+#include "CompositeMeteorology.h"
+#include "EnsembleReduction.h"
+#include "TemporalEnvelope.h"
+#include "CellOrder.h"
+#include "Instrumentation.h"
+#include "BuildRequest.h"
+#include "RequestEstimate.h"
+#include "ExecutionPlan.h"
+#include "RequestKey.h"
+#include "PointSeries.h"
+#include "Coupler.h"
 #include "Grid.h"
+#include "data_sources/GribMessage.h"
 #include "data_sources/GriddedDataTypes.h"
+#include "data_sources/SourceProbe.h"
 #include "MeteorologicalData.h"
 #include "Date.h"
+#include "output/DerivedWind.h"
+#include "output/NetcdfCompression.h"
 #include "output/OutputFile.h"
 #include "output/OwiAscii.h"
+#include "output/StreamCompression.h"
+#include "output/FileChecksum.h"
+#include "output/OwiBinary.h"
 #include "output/OwiNetcdf.h"
 #include "output/RasNetcdf.h"
+#include "output/PointNetcdf.h"
+#include "output/OutputStitch.h"
 #include "output/DelftOutput.h"
+#include "output/ZarrOutput.h"
+#include "output/EnvelopeOutput.h"
+#include "output/OutputGroup.h"
+#include "output/OutputFanout.h"
+#include "output/GribOutput.h"
+#include "output/ShardedOutput.h"
+#include "vortex/AtcfTrack.h"
+#include "vortex/HollandVortex.h"
+#include "MovingGrid.h"
+#include "MappedFile.h"
+#include "data_sources/NetcdfFile.h"
+#include "data_sources/ArrayData.h"
+#include "WarmCache.h"
+#include "SnapshotStore.h"
+#include "SharedFieldStore.h"
+#include "InterpolationCache.h"
+#include "LocatorCache.h"
+#include "Metrics.h"
+#include "ResourceLimits.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+/**
+ * @brief Contiguous buffer of a Python object exposing the buffer protocol,
+ * such as a numpy array, checked against the element type and count of a
+ * MeteorologicalData parameter
+ */
+class PythonBuffer {
+ public:
+  PythonBuffer(PyObject *object, size_t itemsize, size_t count,
+               bool writable) {
+    int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+    if (writable) flags |= PyBUF_WRITABLE;
+    if (PyObject_GetBuffer(object, &m_buffer, flags) != 0) {
+      PyErr_Clear();
+      throw std::runtime_error(
+          writable ? "Output must be a writable, contiguous buffer"
+                   : "Input must be a contiguous buffer");
+    }
+    const char *format = m_buffer.format ? m_buffer.format : "B";
+    if (*format == '<' || *format == '=' || *format == '@') ++format;
+    const char expected = itemsize == sizeof(float) ? 'f' : 'd';
+    if (static_cast<size_t>(m_buffer.itemsize) != itemsize ||
+        *format != expected ||
+        static_cast<size_t>(m_buffer.len) != itemsize * count) {
+      PyBuffer_Release(&m_buffer);
+      throw std::runtime_error(
+          "Buffer must hold ni * nj values of the MeteorologicalData type");
+    }
+  }
+
+  ~PythonBuffer() { PyBuffer_Release(&m_buffer); }
+
+  PythonBuffer(const PythonBuffer &) = delete;
+  PythonBuffer &operator=(const PythonBuffer &) = delete;
+
+  void *data() const { return m_buffer.buf; }
+
+ private:
+  Py_buffer m_buffer{};
+};
+}  // namespace
 %}
 
 
 %include <std_string.i>
+%include <stdint.i>
 %include <exception.i>
 %include <std_vector.i>
 %include <windows.i>
@@ -65,29 +206,464 @@
 
 namespace std {
     %template(IntVector) vector<int>;
+    %template(LongVector) vector<long>;
     %template(SizetVector) vector<size_t>;
     %template(FloatVector) vector<float>;
     %template(DoubleVector) vector<double>;
     %template(DoubleDoubleVector) vector<vector<double>>;
     %template(SizetSizetVector) vector<vector<size_t>>;
     %template(StringVector) vector<string>;
+    %template(StringStringVector) vector<vector<string>>;
 }
 
 
 %include "MetBuild_Global.h"
 %include "Point.h"
 %include "VariableNames.h"
+%include "data_sources/GriddedDataTypes.h"
+
+namespace std {
+    %template(DataTypeVector) vector<MetBuild::GriddedDataTypes::TYPE>;
+    %template(VariableVector) vector<MetBuild::GriddedDataTypes::VARIABLES>;
+}
+
+%ignore MetBuild::SourceProbe::addVariables;
+%include "data_sources/SourceProbe.h"
+%include "data_sources/GribMessage.h"
+
+namespace std {
+    %template(GribMessageVector) vector<MetBuild::GribMessage>;
+}
+
+%ignore MetBuild::Meteorology::set_region;
+%ignore MetBuild::Meteorology::valid_ranges;
+%ignore MetBuild::Meteorology::to_wind_grids;
+%ignore MetBuild::Meteorology::to_grids;
+%ignore MetBuild::Meteorology::set_cancel_token;
+%ignore MetBuild::CompositeMeteorology::blend_weights;
+%include "ExecutionPolicy.h"
 %include "Meteorology.h"
+%include "StepStatistics.h"
+
+namespace std {
+    %template(FieldStatisticsVector) vector<MetBuild::FieldStatistics>;
+    %template(StepStatisticsVector) vector<MetBuild::StepStatistics>;
+}
+
+%include "MeteorologyPipeline.h"
+%include "CompositeMeteorology.h"
+%ignore MetBuild::EnsembleReduction::mean;
+%ignore MetBuild::EnsembleReduction::spread;
+%ignore MetBuild::EnsembleReduction::exceedance;
+%include "EnsembleReduction.h"
+%ignore MetBuild::TemporalEnvelope::get;
+%include "TemporalEnvelope.h"
+%ignore MetBuild::CellOrder::morton;
+%ignore MetBuild::CellOrder::for_each;
+%include "CellOrder.h"
 %include "CppAttributes.h"
+%include "GridFingerprint.h"
+%ignore MetBuild::Grid::Window;
+%ignore MetBuild::Grid::window;
 %include "Grid.h"
-%include "data_sources/GriddedDataTypes.h"
+
+//...Placement of a grid inside another as (i0, j0, ni, nj), or None when it
+// is not aligned with it or not inside it
+%extend MetBuild::Grid {
+  std::vector<size_t> _window(const MetBuild::Grid &sub) const {
+    const auto w = $self->window(sub);
+    if (!w) return {};
+    return {w->i0, w->j0, w->ni, w->nj};
+  }
+
+  %pythoncode %{
+    def window(self, sub):
+        w = self._window(sub)
+        return tuple(w) if len(w) == 4 else None
+  %}
+}
 %include "Date.h"
 %include "MeteorologicalData.h"
+
+//...Zero-copy access to the parameters of MeteorologicalData. array()
+// returns a numpy view sharing memory with the object, which it keeps
+// alive, and copy_parameter/set_parameter move a parameter to or from any
+// contiguous buffer without going through a Python list
+%extend MetBuild::MeteorologicalData {
+  size_t _parameter_address(const size_t index) {
+    if (index >= $self->nParameters()) {
+      throw std::out_of_range("Parameter index out of range");
+    }
+    return reinterpret_cast<size_t>($self->parameter(index).data());
+  }
+
+  size_t _itemsize() const { return sizeof($self->get(0, 0, 0)); }
+
+  void _copy_parameter(const size_t index, PyObject *buffer) const {
+    if (index >= $self->nParameters()) {
+      throw std::out_of_range("Parameter index out of range");
+    }
+    const auto v = $self->parameter(index);
+    const PythonBuffer out(buffer, sizeof(v[0]), v.size(), true);
+    std::memcpy(out.data(), v.data(), sizeof(v[0]) * v.size());
+  }
+
+  void _set_parameter(const size_t index, PyObject *buffer) {
+    if (index >= $self->nParameters()) {
+      throw std::out_of_range("Parameter index out of range");
+    }
+    auto v = $self->parameter(index);
+    const PythonBuffer in(buffer, sizeof(v[0]), v.size(), false);
+    std::memcpy(v.data(), in.data(), sizeof(v[0]) * v.size());
+  }
+
+  %pythoncode %{
+    def array(self, index):
+        """Returns a numpy view of one parameter, shaped (nj, ni), sharing
+        memory with this object"""
+        import numpy
+        return numpy.asarray(_MeteorologicalDataView(self, index))
+
+    def copy_parameter(self, index, out=None):
+        """Copies one parameter into a contiguous (nj, ni) buffer of the
+        data type, allocating a numpy array when none is given"""
+        if out is None:
+            import numpy
+            out = numpy.empty((self.nj(), self.ni()),
+                              dtype="f{:d}".format(self._itemsize()))
+        self._copy_parameter(index, out)
+        return out
+
+    def set_parameter(self, index, values):
+        """Replaces one parameter with the values of a contiguous buffer
+        holding ni * nj values of the data type"""
+        self._set_parameter(index, values)
+  %}
+}
+
+%pythoncode %{
+class _MeteorologicalDataView(object):
+    """Exposes one parameter of a MeteorologicalData object through the numpy
+    array interface, keeping the object alive while the view exists"""
+
+    def __init__(self, owner, index):
+        import sys
+        self._owner = owner
+        byteorder = "<" if sys.byteorder == "little" else ">"
+        self.__array_interface__ = {
+            "shape": (owner.nj(), owner.ni()),
+            "typestr": "{:s}f{:d}".format(byteorder, owner._itemsize()),
+            "data": (owner._parameter_address(index), False),
+            "version": 3,
+        }
+%}
+%ignore MetBuild::NetcdfCompression::fieldChunk;
+%ignore MetBuild::DerivedWind::compute;
+%include "output/DerivedWind.h"
+%include "output/NetcdfCompression.h"
+%ignore MetBuild::StreamCompression::compress;
+%include "output/StreamCompression.h"
+%ignore MetBuild::ChecksumAccumulator;
+%include "output/FileChecksum.h"
+%ignore MetBuild::OutputFile::set_publish_callback;
 %include "output/OutputFile.h"
 %include "output/OwiAscii.h"
+%include "output/OwiBinary.h"
 %include "output/OwiNetcdf.h"
 %include "output/RasNetcdf.h"
+%include "output/PointNetcdf.h"
+%ignore MetBuild::OutputStitch::netcdf_window;
+%include "output/OutputStitch.h"
+%extend MetBuild::OutputStitch {
+  static void netcdf_window(const std::string &input,
+                            const std::string &output,
+                            const std::vector<size_t> &window,
+                            const MetBuild::Date &start,
+                            const MetBuild::Date &end) {
+    if (window.size() != 4) {
+      throw std::runtime_error("The window must be (i0, j0, ni, nj)");
+    }
+    MetBuild::OutputStitch::netcdf_window(
+        input, output, {window[0], window[1], window[2], window[3]}, start,
+        end);
+  }
+}
 %include "output/DelftOutput.h"
+%include "output/ZarrOutput.h"
+%include "output/EnvelopeOutput.h"
+%include "output/GribOutput.h"
+%include "output/OutputGroup.h"
+%include "output/OutputFanout.h"
+%ignore MetBuild::ShardedOutput::ShardedOutput(const MetBuild::Date &,
+                                              const MetBuild::Date &,
+                                              unsigned, Factory, Namer);
+%include "output/ShardedOutput.h"
+%ignore MetBuild::AtcfTrack::AtcfTrack(std::vector<AtcfRecord>);
+%ignore MetBuild::AtcfTrack::records;
+%ignore MetBuild::AtcfTrack::translation;
+%include "vortex/AtcfTrack.h"
+%include "vortex/HollandVortex.h"
+%ignore MetBuild::MovingGrid::window;
+%ignore MetBuild::MovingGrid::positions;
+%ignore MetBuild::MovingGrid::region;
+%include "MovingGrid.h"
+%ignore MetBuild::Instrumentation::ScopedTimer;
+%ignore MetBuild::Instrumentation::record;
+%ignore MetBuild::Instrumentation::trace;
+%ignore MetBuild::Instrumentation::read_counters;
+%ignore MetBuild::Instrumentation::record_counters;
+%ignore MetBuild::Instrumentation::MemoryTracker;
+%ignore MetBuild::Instrumentation::allocate;
+%ignore MetBuild::Instrumentation::release;
+%include "Instrumentation.h"
+%include "BuildRequest.h"
+
+//...Runs a request from asyncio. The request runs on its own thread and the
+// coroutine polls it, so the event loop stays free for uploads and database
+// work while it runs. Cancelling the task cancels the request
+%extend MetBuild::BuildRequest {
+  %pythoncode %{
+    async def run_async(self, progress=None, interval=0.5, publish=None):
+        """Runs the request on a background thread and awaits it, returning
+        the files used by each domain as run does. progress, when given, is
+        called with the fraction done, 0 to 1, every interval seconds and may
+        be a coroutine function. publish, when given, is called the same way
+        with the time every domain has been published through each time it
+        advances, for outputs which publish their records in chunks"""
+        import asyncio
+
+        published = [self.published_through().toSeconds()]
+
+        async def report():
+            if progress is not None:
+                result = progress(self.progress())
+                if asyncio.iscoroutine(result):
+                    await result
+            if publish is not None:
+                through = self.published_through()
+                if through.toSeconds() > published[0]:
+                    published[0] = through.toSeconds()
+                    result = publish(through)
+                    if asyncio.iscoroutine(result):
+                        await result
+
+        def join():
+            try:
+                self.wait()
+            except RuntimeError:
+                pass
+
+        self.start()
+        try:
+            while not self.done():
+                await report()
+                await asyncio.sleep(interval)
+        except asyncio.CancelledError:
+            self.cancel()
+            await asyncio.get_running_loop().run_in_executor(None, join)
+            raise
+        await report()
+        return self.wait()
+  %}
+}
+%include "RequestEstimate.h"
+%include "ExecutionPlan.h"
+%include "RequestKey.h"
+
+namespace std {
+    %template(PointVector) vector<MetBuild::Point>;
+    %template(DateVector) vector<MetBuild::Date>;
+}
+%include "PointSeries.h"
+%ignore MetBuild::Coupler::get_value;
+%ignore MetBuild::Coupler::interpolate;
+%ignore MetBuild::Coupler::publish(MetBuild::CouplingRing *);
+%include "Coupler.h"
+%ignore MetBuild::WarmCache::retain;
+%include "WarmCache.h"
+%ignore MetBuild::SnapshotStore::get;
+%ignore MetBuild::SnapshotStore::put;
+%include "SnapshotStore.h"
+%ignore MetBuild::SharedFieldStore::Field;
+%ignore MetBuild::SharedFieldStore::key;
+%ignore MetBuild::SharedFieldStore::attach;
+%ignore MetBuild::SharedFieldStore::publish;
+%include "SharedFieldStore.h"
+%ignore MetBuild::InterpolationCache::key;
+%ignore MetBuild::InterpolationCache::load;
+%ignore MetBuild::InterpolationCache::store;
+%ignore MetBuild::InterpolationCache::shared;
+%include "InterpolationCache.h"
+%ignore MetBuild::LocatorCache::key;
+%ignore MetBuild::LocatorCache::load;
+%ignore MetBuild::LocatorCache::store;
+%include "LocatorCache.h"
+%ignore MetBuild::Metrics::record_build;
+%include "Metrics.h"
+%include "ResourceLimits.h"
+
+//...Source files held in memory, e.g. grib messages streamed from S3 by byte
+// range. The data is any bytes-like object, or a sequence of them which are
+// joined in order, and stands in for a file of the given name afterwards
+%inline %{
+namespace MetBuild {
+void add_file_buffer(const std::string &name, PyObject *data) {
+  auto to_vector = [](PyObject *object) {
+    Py_buffer view;
+    if (PyObject_GetBuffer(object, &view, PyBUF_SIMPLE) != 0) {
+      PyErr_Clear();
+      throw std::runtime_error("File data must be a bytes-like object");
+    }
+    const auto *begin = static_cast<const unsigned char *>(view.buf);
+    std::vector<unsigned char> v(begin, begin + view.len);
+    PyBuffer_Release(&view);
+    return v;
+  };
+
+  if (PyObject_CheckBuffer(data)) {
+    MetBuild::MappedFile::add_buffer(name, to_vector(data));
+    return;
+  }
+  PyObject *sequence = PySequence_Fast(data, "File data must be bytes");
+  if (sequence == nullptr) {
+    PyErr_Clear();
+    throw std::runtime_error(
+        "File data must be a bytes-like object or a sequence of them");
+  }
+  std::vector<std::vector<unsigned char>> parts;
+  try {
+    const Py_ssize_t n = PySequence_Fast_GET_SIZE(sequence);
+    for (Py_ssize_t i = 0; i < n; ++i) {
+      parts.push_back(to_vector(PySequence_Fast_GET_ITEM(sequence, i)));
+    }
+  } catch (...) {
+    Py_DECREF(sequence);
+    throw;
+  }
+  Py_DECREF(sequence);
+  MetBuild::MappedFile::add_buffer(name, parts);
+}
+
+void remove_file_buffer(const std::string &name) {
+  MetBuild::MappedFile::remove_buffer(name);
+}
+
+void release_file(const std::string &name) {
+  MetBuild::MappedFile::release(name);
+}
+
+void expect_file_buffer(const std::string &name) {
+  MetBuild::MappedFile::expect_buffer(name);
+}
+
+void fail_file_buffer(const std::string &name, const std::string &reason) {
+  MetBuild::MappedFile::fail_buffer(name, reason);
+}
+
+//...Whether netCDF sources such as COAMPS can be given as http urls and read
+// by byte range instead of being downloaded
+bool netcdf_byte_range() { return ::NetcdfFile::supports_byte_range(); }
+}  // namespace MetBuild
+%}
+
+//...Arrays held in memory, e.g. numpy arrays built by a coupled model, read
+// in place as a source file of the given name. The buffers are not copied,
+// so add_array_source keeps a reference to them until the name is removed
+%inline %{
+namespace MetBuild {
+void _add_array_source(const std::string &name, size_t ni, size_t nj,
+                       PyObject *longitude, PyObject *latitude,
+                       const std::vector<int> &variables, PyObject *values,
+                       const std::vector<size_t> &itemsizes, int convention) {
+  const size_t n = ni * nj;
+  MetBuild::ArrayData::Arrays arrays;
+  arrays.ni = ni;
+  arrays.nj = nj;
+  arrays.convention = static_cast<MetBuild::COORDINATE_CONVENTION>(convention);
+  arrays.longitude = static_cast<const double *>(
+      PythonBuffer(longitude, sizeof(double), n, false).data());
+  arrays.latitude = static_cast<const double *>(
+      PythonBuffer(latitude, sizeof(double), n, false).data());
+  if (variables.size() != itemsizes.size() ||
+      PySequence_Size(values) != static_cast<Py_ssize_t>(variables.size())) {
+    throw std::runtime_error("Each variable needs one array of values");
+  }
+  for (size_t i = 0; i < variables.size(); ++i) {
+    PyObject *item = PySequence_GetItem(values, static_cast<Py_ssize_t>(i));
+    if (item == nullptr) {
+      PyErr_Clear();
+      throw std::runtime_error("Could not read the array of a variable");
+    }
+    const void *data = nullptr;
+    try {
+      data = PythonBuffer(item, itemsizes[i], n, false).data();
+    } catch (...) {
+      Py_DECREF(item);
+      throw;
+    }
+    Py_DECREF(item);
+    const auto v = static_cast<MetBuild::GriddedDataTypes::VARIABLES>(
+        variables[i]);
+    if (itemsizes[i] == sizeof(float)) {
+      arrays.set(v, static_cast<const float *>(data));
+    } else {
+      arrays.set(v, static_cast<const double *>(data));
+    }
+  }
+  MetBuild::ArrayData::add(name, std::move(arrays));
+}
+
+void _remove_array_source(const std::string &name) {
+  MetBuild::ArrayData::remove(name);
+}
+}  // namespace MetBuild
+%}
+
+%pythoncode %{
+_array_sources = {}
+
+
+def add_array_source(name, longitude, latitude, fields, convention=0):
+    """Registers arrays shaped (nj, ni) as a source file of the given name,
+    which is then passed in place of a file. fields maps variables such as
+    VAR_PRESSURE to arrays of values, read in place when they are contiguous
+    float32 or float64 arrays and copied once otherwise. convention is 0 for
+    longitudes from -180 to 180 and 1 for 0 to 360. The arrays must not be
+    modified until remove_array_source is called"""
+    import numpy
+
+    longitude = numpy.ascontiguousarray(longitude, dtype=numpy.float64)
+    latitude = numpy.ascontiguousarray(latitude, dtype=numpy.float64)
+    nj, ni = longitude.shape
+    variables, values, itemsizes = [], [], []
+    for variable, array in fields.items():
+        array = numpy.asarray(array)
+        if array.dtype not in (numpy.float32, numpy.float64):
+            array = array.astype(numpy.float64)
+        array = numpy.ascontiguousarray(array)
+        variables.append(int(variable))
+        values.append(array)
+        itemsizes.append(array.itemsize)
+    _add_array_source(
+        name,
+        ni,
+        nj,
+        longitude,
+        latitude,
+        IntVector(variables),
+        values,
+        SizetVector(itemsizes),
+        int(convention),
+    )
+    _array_sources[name] = (longitude, latitude, values)
+
+
+def remove_array_source(name):
+    """Removes arrays registered with add_array_source, releasing the
+    reference held to them"""
+    _remove_array_source(name)
+    _array_sources.pop(name, None)
+%}
 
 namespace MetBuild {
     %template(OneMetVector) MeteorologicalData<1,MeteorologicalDataType>;
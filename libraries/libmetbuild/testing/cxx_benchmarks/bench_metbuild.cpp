@@ -0,0 +1,281 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks for the hot paths of the library. Run from the build directory
+// so the test files resolve, e.g.
+//
+//   ./cxx_testcases/metbuild_bench --benchmark-samples 20
+//   ./cxx_testcases/metbuild_bench "[writer]"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Date.h"
+#include "Grid.h"
+#include "InterpolationData.h"
+#include "MeteorologicalData.h"
+#include "Meteorology.h"
+#include "ThreadPool.h"
+#include "Triangulation.h"
+#include "allocation_counter.h"
+#include "boost/filesystem.hpp"
+#include "catch.hpp"
+#include "data_sources/GfsData.h"
+#include "output/DelftOutput.h"
+#include "output/OwiAscii.h"
+#include "output/OwiBinary.h"
+#include "output/OwiNetcdf.h"
+#include "output/RasNetcdf.h"
+#include "output/ZarrOutput.h"
+
+namespace {
+
+const std::string c_gfs_0 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f000";
+const std::string c_gfs_1 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f001";
+const std::string c_scratch = "metbuild_bench_output";
+
+//...Output grids over the same region at increasing resolution
+const std::vector<double> c_resolutions = {0.25, 0.1, 0.05};
+
+MetBuild::Grid output_grid(const double dx) {
+  return MetBuild::Grid(-98.0, 10.0, -60.0, 40.0, dx, dx);
+}
+
+std::string label(const std::string &name, const double dx) {
+  return name + " dx=" + std::to_string(dx).substr(0, 4);
+}
+
+//...Same box the library triangulates when building weights for a grid
+MetBuild::Triangulation::Extent output_extent(
+    const MetBuild::Grid::grid &grid,
+    const MetBuild::COORDINATE_CONVENTION convention) {
+  constexpr double inf = std::numeric_limits<double>::infinity();
+  MetBuild::Triangulation::Extent extent{inf, inf, -inf, -inf};
+  for (const auto &row : grid) {
+    for (const auto &p : row) {
+      const double x = convention == MetBuild::CONVENTION_180
+                           ? std::fmod(p.x() + 180.0, 360.0) - 180.0
+                           : p.x();
+      extent.xmin = std::min(extent.xmin, x);
+      extent.xmax = std::max(extent.xmax, x);
+      extent.ymin = std::min(extent.ymin, p.y());
+      extent.ymax = std::max(extent.ymax, p.y());
+    }
+  }
+  return extent;
+}
+
+std::unique_ptr<MetBuild::OutputFile> make_writer(
+    const std::string &format, const MetBuild::Date &start,
+    const MetBuild::Date &end, const unsigned step,
+    const MetBuild::Grid &grid) {
+  const std::string base = c_scratch + "/bench";
+  const std::vector<std::string> variables = {"wind_u", "wind_v", "mslp"};
+  std::unique_ptr<MetBuild::OutputFile> writer;
+  if (format == "owi-ascii") {
+    writer = std::make_unique<MetBuild::OwiAscii>(start, end, step);
+    writer->addDomain(grid, {base + ".221", base + ".222"});
+  } else if (format == "owi-binary") {
+    writer = std::make_unique<MetBuild::OwiBinary>(start, end, step);
+    writer->addDomain(grid, {base + ".pre", base + ".wnd"});
+  } else if (format == "owi-netcdf") {
+    writer = std::make_unique<MetBuild::OwiNetcdf>(start, end, step,
+                                                   base + ".nc");
+    writer->addDomain(grid, {"Main"});
+  } else if (format == "ras-netcdf") {
+    writer = std::make_unique<MetBuild::RasNetcdf>(start, end, step,
+                                                   base + ".nc");
+    writer->addDomain(grid, variables);
+  } else if (format == "delft3d") {
+    writer = std::make_unique<MetBuild::DelftOutput>(start, end, step, base);
+    writer->addDomain(grid, variables);
+  } else {
+    writer = std::make_unique<MetBuild::ZarrOutput>(start, end, step,
+                                                    base + ".zarr");
+    writer->addDomain(grid, variables);
+  }
+  return writer;
+}
+
+}  // namespace
+
+//...Decoding does not depend on the output grid, so it is measured once per
+// variable on fresh objects
+TEST_CASE("GRIB open and decode", "[benchmark][grib]") {
+  BENCHMARK_ADVANCED("GRIB open")(Catch::Benchmark::Chronometer meter) {
+    meter.measure([] {
+      MetBuild::GfsData data(c_gfs_0);
+      return data.longitude1d().size();
+    });
+  };
+
+  const std::vector<std::pair<std::string, MetBuild::GriddedDataTypes::VARIABLES>>
+      variables = {{"pressure", MetBuild::GriddedDataTypes::VAR_PRESSURE},
+                   {"u10", MetBuild::GriddedDataTypes::VAR_U10},
+                   {"v10", MetBuild::GriddedDataTypes::VAR_V10},
+                   {"temperature", MetBuild::GriddedDataTypes::VAR_TEMPERATURE}};
+  for (const auto &v : variables) {
+    BENCHMARK_ADVANCED("GRIB decode " + v.first)
+    (Catch::Benchmark::Chronometer meter) {
+      std::vector<std::unique_ptr<MetBuild::GfsData>> files(meter.runs());
+      for (auto &f : files) f = std::make_unique<MetBuild::GfsData>(c_gfs_0);
+      meter.measure([&](const int i) {
+        return files[i]->variable1d(v.second).size();
+      });
+    };
+  }
+}
+
+TEST_CASE("Triangulation and weights", "[benchmark][weights]") {
+  MetBuild::GfsData data(c_gfs_0);
+  const auto grid = output_grid(c_resolutions.front());
+  const auto extent = output_extent(grid.grid_positions(), data.convention());
+
+  BENCHMARK("Triangulation build") {
+    return data.generate_triangulation(extent);
+  };
+
+  const auto triangulation = data.generate_triangulation(extent);
+  for (const auto dx : c_resolutions) {
+    const auto g = output_grid(dx);
+    BENCHMARK(label("Weight generation", dx)) {
+      return MetBuild::InterpolationData(triangulation, g.grid_positions(),
+                                         data.convention());
+    };
+  }
+}
+
+TEST_CASE("Interpolation", "[benchmark][interpolation]") {
+  for (const auto dx : c_resolutions) {
+    const auto grid = output_grid(dx);
+    auto m = MetBuild::Meteorology(
+        &grid, MetBuild::Meteorology::GFS,
+        std::vector<MetBuild::GriddedDataTypes::TYPE>{
+            MetBuild::GriddedDataTypes::WIND_PRESSURE,
+            MetBuild::GriddedDataTypes::TEMPERATURE});
+    m.set_next_file(c_gfs_0);
+    m.set_next_file(c_gfs_1);
+    m.process_data();
+
+    BENCHMARK(label("to_wind_grid", dx)) { return m.to_wind_grid(0.5); };
+
+    MetBuild::MeteorologicalData<1> temperature;
+    BENCHMARK(label("to_grid", dx)) {
+      m.to_grid(MetBuild::GriddedDataTypes::TEMPERATURE, temperature, 0.5);
+      return temperature.ni();
+    };
+  }
+}
+
+//...Each sample writes one more snapshot, so the files are given an end date
+// far enough out for any sample count and are removed after each benchmark
+TEST_CASE("Output writers", "[benchmark][writer]") {
+  const MetBuild::Date start(2020, 1, 1, 0, 0, 0);
+  const MetBuild::Date end(2030, 1, 1, 0, 0, 0);
+  const unsigned step = 900;
+
+  for (const auto dx : c_resolutions) {
+    const auto grid = output_grid(dx);
+    auto m = MetBuild::Meteorology(&grid, MetBuild::Meteorology::GFS,
+                                   MetBuild::GriddedDataTypes::WIND_PRESSURE);
+    m.set_next_file(c_gfs_0);
+    m.set_next_file(c_gfs_1);
+    m.process_data();
+    const auto data = m.to_wind_grid(0.5);
+
+    for (const std::string format : {"owi-ascii", "owi-binary", "owi-netcdf",
+                                     "ras-netcdf", "delft3d", "zarr"}) {
+      boost::filesystem::create_directories(c_scratch);
+      {
+        auto writer = make_writer(format, start, end, step, grid);
+        auto date = start;
+        BENCHMARK(label("write " + format, dx)) {
+          const auto status = writer->write(date, 0, data);
+          date += step;
+          return status;
+        };
+      }
+      boost::filesystem::remove_all(c_scratch);
+    }
+  }
+}
+
+//...Once the buffers are sized, a timestep of interpolation and OWI output
+// must not touch the heap. Counted on a pool of one thread, since the loop
+// bookkeeping of a pool with workers is not part of the guarantee
+TEST_CASE("Steady state allocations", "[benchmark][allocations]") {
+  MetBuild::ThreadPool::setDefaultThreadCount(1);
+  const MetBuild::Date start(2020, 1, 1, 0, 0, 0);
+  const MetBuild::Date end(2020, 1, 2, 0, 0, 0);
+  const unsigned step = 900;
+  constexpr size_t warm = 2;
+
+  const auto grid = output_grid(c_resolutions.front());
+  auto m = MetBuild::Meteorology(&grid, MetBuild::Meteorology::GFS,
+                                 MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  m.set_next_file(c_gfs_0);
+  m.set_next_file(c_gfs_1);
+  m.process_data();
+
+  MetBuild::MeteorologicalData<3> data;
+  std::array<size_t, 8> counts{};
+  for (size_t i = 0; i < counts.size(); ++i) {
+    const MetBuild::Testing::AllocationScope scope;
+    m.to_wind_grid(data, static_cast<double>(i) / counts.size());
+    counts[i] = scope.count();
+  }
+  for (size_t i = warm; i < counts.size(); ++i) {
+    INFO("to_wind_grid step " << i);
+    CHECK(counts[i] == 0);
+  }
+
+  for (const std::string format : {"owi-ascii", "owi-binary"}) {
+    for (const bool async : {false, true}) {
+      boost::filesystem::create_directories(c_scratch);
+      {
+        auto writer = make_writer(format, start, end, step, grid);
+        writer->set_async(async);
+        for (size_t i = 0; i < counts.size(); ++i) {
+          const MetBuild::Testing::AllocationScope scope;
+          writer->write(start + static_cast<int>(i * step), 0, data);
+          counts[i] = scope.count();
+        }
+      }
+      boost::filesystem::remove_all(c_scratch);
+      for (size_t i = warm; i < counts.size(); ++i) {
+        INFO(format << (async ? " async" : "") << " step " << i);
+        CHECK(counts[i] == 0);
+      }
+    }
+  }
+}
@@ -0,0 +1,473 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+// Checks that the fast paths of the library give the same answer as the
+// reference path. Each case is run twice on the bundled test files:
+//
+//   reference  Delaunay triangulation of every source (no structured,
+//              curvilinear or connectivity locators, no bucket grid, no
+//              translated weights) and the portable kernels
+//   optimized  the library defaults, as the build service runs them
+//
+// and the interpolated planes are compared per variable and time step. The
+// OWI ASCII files written by both runs are compared byte for byte. Run from
+// the build directory so the test files resolve, e.g.
+//
+//   ./cxx_testcases/metbuild_equivalence --dx 0.05 --json equivalence.json
+//
+// The on-disk weight and snapshot caches are disabled so both runs compute
+// every value. Single precision builds are compared by running the tool in
+// each build with --keep and comparing the written files
+//
+// Cases:
+//   gfs     GFS f000-f005
+//   coamps  COAMPS d01-d03 tau000-001
+//
+// Options:
+//   --case <name|all>       case to run (default all)
+//   --dx <degrees>          output resolution (default 0.1)
+//   --time-step <seconds>   output time step (default 900)
+//   --tolerance <value>     largest difference allowed between the runs, in
+//                           m/s and mb (default 0.05)
+//   --threads <n>           size of the thread pool (default the library
+//                           default)
+//   --deterministic         run the optimized path --repeat times and
+//                           require every repeat to be bit identical,
+//                           values and files, to the first
+//   --repeat <n>            number of optimized runs in deterministic mode
+//                           (default 3)
+//   --output <directory>    scratch directory (default
+//                           metbuild_equivalence_output)
+//   --json <file>           write the report to a file instead of stdout
+//   --keep                  keep the output files
+//
+// The exit status is non-zero when a case exceeds the tolerance or, in
+// deterministic mode, when a repeat differs
+//
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Date.h"
+#include "Grid.h"
+#include "InterpolationCache.h"
+#include "InterpolationKernel.h"
+#include "MeteorologicalData.h"
+#include "Meteorology.h"
+#include "SnapshotCache.h"
+#include "ThreadPool.h"
+#include "Triangulation.h"
+#include "boost/filesystem.hpp"
+#include "output/OwiAscii.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Fields =
+    MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>;
+
+constexpr std::array<const char *, 3> c_variables = {"u", "v", "pressure"};
+
+struct Options {
+  std::string test_case = "all";
+  double dx = 0.1;
+  int time_step = 900;
+  double tolerance = 0.05;
+  size_t threads = 0;
+  bool deterministic = false;
+  size_t repeat = 3;
+  std::string output = "metbuild_equivalence_output";
+  std::string json;
+  bool keep = false;
+};
+
+struct SourceFile {
+  std::vector<std::string> filenames;
+  MetBuild::Date time;
+};
+
+struct Case {
+  std::string name;
+  MetBuild::Meteorology::SOURCE source;
+  //...Output extent as llx, lly, urx, ury
+  double extent[4];
+  std::vector<SourceFile> files;
+};
+
+struct Run {
+  std::vector<Fields> steps;
+  std::vector<std::string> files;
+  double wall = 0.0;
+};
+
+struct Difference {
+  double max = 0.0;
+  double rms = 0.0;
+};
+
+struct Result {
+  std::string name;
+  size_t cells = 0;
+  double reference_wall = 0.0;
+  double optimized_wall = 0.0;
+  //...Per time step, then per variable
+  std::vector<std::array<Difference, 3>> steps;
+  std::array<Difference, 3> total;
+  size_t files = 0;
+  size_t identical_files = 0;
+  size_t repeats = 0;
+  bool deterministic = true;
+  bool passed = true;
+};
+
+//...The bundled files carry their own dates but only their spacing matters,
+// so they are given nominal times
+std::vector<Case> cases() {
+  const std::string dir = "../testing/test_files/";
+  Case gfs{"gfs", MetBuild::Meteorology::GFS, {-98.0, 10.0, -60.0, 40.0}, {}};
+  for (int h = 0; h < 6; ++h) {
+    gfs.files.push_back({{dir + "gfs.t00z.pgrb2.0p25.f00" + std::to_string(h)},
+                         MetBuild::Date(2020, 1, 1, h, 0, 0)});
+  }
+  Case coamps{
+      "coamps", MetBuild::Meteorology::COAMPS, {-100.0, 10.0, -70.0, 40.0}, {}};
+  for (int tau = 0; tau < 2; ++tau) {
+    SourceFile f{{}, MetBuild::Date(2020, 8, 24, tau, 0, 0)};
+    for (int d = 1; d <= 3; ++d) {
+      f.filenames.push_back(dir + "coamps-tc_d0" + std::to_string(d) +
+                            "_2020082400_tau00" + std::to_string(tau) + ".nc");
+    }
+    coamps.files.push_back(f);
+  }
+  return {gfs, coamps};
+}
+
+/**
+ * @brief Selects the reference or the optimized path for the runs that
+ * follow
+ * @param reference true for the reference path
+ * @param isa instruction set of the optimized kernels
+ * @param buckets bucket setting of the optimized path
+ */
+void select_path(const bool reference, const std::string &isa,
+                 const bool buckets) {
+  MetBuild::Triangulation::setUseFastLocators(!reference);
+  MetBuild::Triangulation::setUseBuckets(!reference && buckets);
+  MetBuild::Kernel::set_instruction_set(
+      reference || isa == "generic" ? "generic" : "avx2");
+}
+
+//...Same time loop as MeteorologyPipeline, run serially
+Run run(const Case &c, const Options &o, const MetBuild::Grid &grid,
+        const std::string &directory) {
+  Run r;
+  boost::filesystem::create_directories(directory);
+  const auto start = c.files.front().time;
+  const auto end = c.files.back().time;
+  const auto t = Clock::now();
+  {
+    MetBuild::OwiAscii output(start, end, o.time_step);
+    output.addDomain(grid, {directory + "/fort.221", directory + "/fort.222"});
+
+    MetBuild::Meteorology m(&grid, c.source,
+                            MetBuild::GriddedDataTypes::WIND_PRESSURE);
+    m.set_next_file(c.files[0].filenames);
+    m.set_next_file(c.files[1].filenames);
+    m.process_data();
+
+    size_t index = 1;
+    for (auto time = start; time <= end; time += o.time_step) {
+      while (time > c.files[index].time) {
+        m.set_next_file(c.files[++index].filenames);
+        m.process_data();
+      }
+      const auto weight = MetBuild::Meteorology::generate_time_weight(
+          c.files[index - 1].time, c.files[index].time, time);
+      Fields data;
+      m.to_wind_grid(data, weight);
+      output.write(time, 0, data);
+      r.steps.push_back(std::move(data));
+    }
+    r.files = output.filenames();
+    //...Closing the files flushes any buffered or asynchronous writes
+  }
+  r.wall = std::chrono::duration<double>(Clock::now() - t).count();
+  return r;
+}
+
+std::array<Difference, 3> compare(const Fields &a, const Fields &b) {
+  std::array<Difference, 3> d;
+  for (size_t k = 0; k < 3; ++k) {
+    const auto x = a.parameter(k);
+    const auto y = b.parameter(k);
+    double sum = 0.0;
+    for (size_t i = 0; i < x.size(); ++i) {
+      const double e =
+          std::abs(static_cast<double>(x[i]) - static_cast<double>(y[i]));
+      d[k].max = std::max(d[k].max, e);
+      sum += e * e;
+    }
+    d[k].rms = x.size() == 0 ? 0.0 : std::sqrt(sum / x.size());
+  }
+  return d;
+}
+
+bool identical(const Fields &a, const Fields &b) {
+  for (size_t k = 0; k < 3; ++k) {
+    const auto x = a.parameter(k);
+    const auto y = b.parameter(k);
+    if (x.size() != y.size() ||
+        !std::equal(x.begin(), x.end(), y.begin(),
+                    [](const MetBuild::MeteorologicalDataType p,
+                       const MetBuild::MeteorologicalDataType q) {
+                      return std::memcmp(&p, &q, sizeof(p)) == 0;
+                    })) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool same_bytes(const std::string &a, const std::string &b) {
+  std::ifstream fa(a, std::ios::binary);
+  std::ifstream fb(b, std::ios::binary);
+  if (!fa.is_open() || !fb.is_open()) return false;
+  return std::equal(std::istreambuf_iterator<char>(fa),
+                    std::istreambuf_iterator<char>(),
+                    std::istreambuf_iterator<char>(fb),
+                    std::istreambuf_iterator<char>());
+}
+
+bool same_files(const Run &a, const Run &b) {
+  if (a.files.size() != b.files.size()) return false;
+  for (size_t i = 0; i < a.files.size(); ++i) {
+    if (!same_bytes(a.files[i], b.files[i])) return false;
+  }
+  return true;
+}
+
+Result run_case(const Case &c, const Options &o, const std::string &isa,
+                const bool buckets) {
+  Result r;
+  r.name = c.name;
+  const MetBuild::Grid grid(c.extent[0], c.extent[1], c.extent[2],
+                            c.extent[3], o.dx, o.dx);
+  r.cells = grid.ni() * grid.nj();
+  const auto base = o.output + "/" + c.name;
+
+  select_path(true, isa, buckets);
+  const auto reference = run(c, o, grid, base + "/reference");
+  select_path(false, isa, buckets);
+  const auto optimized = run(c, o, grid, base + "/optimized");
+  r.reference_wall = reference.wall;
+  r.optimized_wall = optimized.wall;
+
+  std::array<double, 3> sum = {0.0, 0.0, 0.0};
+  for (size_t s = 0; s < reference.steps.size(); ++s) {
+    const auto d = compare(reference.steps[s], optimized.steps[s]);
+    for (size_t k = 0; k < 3; ++k) {
+      r.total[k].max = std::max(r.total[k].max, d[k].max);
+      sum[k] += d[k].rms * d[k].rms;
+      if (d[k].max > o.tolerance) r.passed = false;
+    }
+    r.steps.push_back(d);
+  }
+  for (size_t k = 0; k < 3; ++k) {
+    r.total[k].rms =
+        r.steps.empty() ? 0.0 : std::sqrt(sum[k] / r.steps.size());
+  }
+
+  r.files = reference.files.size();
+  for (size_t i = 0; i < r.files && i < optimized.files.size(); ++i) {
+    if (same_bytes(reference.files[i], optimized.files[i])) {
+      ++r.identical_files;
+    }
+  }
+
+  if (o.deterministic) {
+    for (size_t n = 1; n < o.repeat; ++n) {
+      const auto again =
+          run(c, o, grid, base + "/repeat_" + std::to_string(n));
+      ++r.repeats;
+      bool same = again.steps.size() == optimized.steps.size() &&
+                  same_files(optimized, again);
+      for (size_t s = 0; same && s < again.steps.size(); ++s) {
+        same = identical(optimized.steps[s], again.steps[s]);
+      }
+      if (!same) {
+        r.deterministic = false;
+        r.passed = false;
+      }
+    }
+  }
+  return r;
+}
+
+void write_differences(std::ostream &os,
+                       const std::array<Difference, 3> &d) {
+  os << "{";
+  for (size_t k = 0; k < 3; ++k) {
+    os << (k == 0 ? "" : ", ") << "\"" << c_variables[k]
+       << "\": {\"max\": " << d[k].max << ", \"rms\": " << d[k].rms << "}";
+  }
+  os << "}";
+}
+
+void write_json(std::ostream &os, const Options &o, const std::string &isa,
+                const std::vector<Result> &results) {
+  os << "{\n"
+     << "  \"dx\": " << o.dx << ",\n"
+     << "  \"time_step\": " << o.time_step << ",\n"
+     << "  \"tolerance\": " << o.tolerance << ",\n"
+     << "  \"threads\": " << MetBuild::ThreadPool::defaultThreadCount()
+     << ",\n"
+     << "  \"instruction_set\": \"" << isa << "\",\n"
+     << "  \"source_value_bytes\": " << sizeof(MetBuild::SourceDataType)
+     << ",\n"
+     << "  \"deterministic_mode\": " << (o.deterministic ? "true" : "false")
+     << ",\n"
+     << "  \"cases\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto &r = results[i];
+    os << (i == 0 ? "\n" : ",\n") << "    {\n"
+       << "      \"name\": \"" << r.name << "\",\n"
+       << "      \"cells\": " << r.cells << ",\n"
+       << "      \"reference_wall_seconds\": " << r.reference_wall << ",\n"
+       << "      \"optimized_wall_seconds\": " << r.optimized_wall << ",\n"
+       << "      \"difference\": ";
+    write_differences(os, r.total);
+    os << ",\n      \"steps\": [";
+    for (size_t s = 0; s < r.steps.size(); ++s) {
+      os << (s == 0 ? "\n" : ",\n") << "        ";
+      write_differences(os, r.steps[s]);
+    }
+    os << "\n      ],\n"
+       << "      \"ascii_files\": " << r.files << ",\n"
+       << "      \"ascii_identical\": " << r.identical_files << ",\n";
+    if (o.deterministic) {
+      os << "      \"repeats\": " << r.repeats << ",\n"
+         << "      \"deterministic\": "
+         << (r.deterministic ? "true" : "false") << ",\n";
+    }
+    os << "      \"passed\": " << (r.passed ? "true" : "false") << "\n"
+       << "    }";
+  }
+  os << "\n  ]\n}\n";
+}
+
+Options parse(int argc, char **argv) {
+  Options o;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc) {
+        std::cerr << "[ERROR]: Missing value for " << arg << std::endl;
+        std::exit(1);
+      }
+      return argv[++i];
+    };
+    if (arg == "--case") {
+      o.test_case = value();
+    } else if (arg == "--dx") {
+      o.dx = std::stod(value());
+    } else if (arg == "--time-step") {
+      o.time_step = std::stoi(value());
+    } else if (arg == "--tolerance") {
+      o.tolerance = std::stod(value());
+    } else if (arg == "--threads") {
+      o.threads = std::stoul(value());
+    } else if (arg == "--deterministic") {
+      o.deterministic = true;
+    } else if (arg == "--repeat") {
+      o.repeat = std::stoul(value());
+    } else if (arg == "--output") {
+      o.output = value();
+    } else if (arg == "--json") {
+      o.json = value();
+    } else if (arg == "--keep") {
+      o.keep = true;
+    } else {
+      std::cerr << "[ERROR]: Unknown option " << arg << std::endl;
+      std::exit(1);
+    }
+  }
+  if (o.dx <= 0.0 || o.time_step <= 0 || o.tolerance < 0.0 ||
+      o.repeat < 2) {
+    std::cerr << "[ERROR]: Invalid equivalence options" << std::endl;
+    std::exit(1);
+  }
+  return o;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const auto options = parse(argc, argv);
+  //...Set before anything uses the pool
+  if (options.threads > 0) {
+    MetBuild::ThreadPool::setDefaultThreadCount(options.threads);
+  }
+  MetBuild::InterpolationCache::setDirectory("");
+  MetBuild::SnapshotCache::setDirectory("");
+
+  //...The optimized path is whatever the library selected on its own
+  const std::string isa = MetBuild::Kernel::instruction_set();
+  const bool buckets = MetBuild::Triangulation::useBuckets();
+
+  std::vector<Result> results;
+  for (const auto &c : cases()) {
+    if (options.test_case != "all" && options.test_case != c.name) continue;
+    results.push_back(run_case(c, options, isa, buckets));
+  }
+  if (results.empty()) {
+    std::cerr << "[ERROR]: Unknown case " << options.test_case << std::endl;
+    return 1;
+  }
+  select_path(false, isa, buckets);
+
+  if (options.json.empty()) {
+    write_json(std::cout, options, isa, results);
+  } else {
+    std::ofstream f(options.json);
+    write_json(f, options, isa, results);
+  }
+  if (!options.keep) boost::filesystem::remove_all(options.output);
+
+  const bool passed = std::all_of(results.begin(), results.end(),
+                                  [](const Result &r) { return r.passed; });
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,411 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+// End-to-end replay of full builds from the bundled test files, reported as
+// JSON so throughput can be compared across releases and build flags. Run
+// from the build directory so the test files resolve, e.g.
+//
+//   ./cxx_testcases/metbuild_replay --dx 0.05 --domains 2 --json replay.json
+//
+// Cases:
+//   gfs-owi-ascii      GFS f000-f005 written as OWI ASCII
+//   gfs-owi-netcdf     GFS f000-f005 written as OWI NetCDF
+//   coamps-ras-netcdf  COAMPS d01-d03 tau000-001 written as RAS NetCDF
+//
+// Options:
+//   --case <name|all>          case to run (default all)
+//   --dx <degrees>             resolution of the outer domain (default 0.1)
+//   --time-step <seconds>      output time step (default 900)
+//   --domains <n>              number of nested domains (default 1). Each
+//                              nest halves the extent and the resolution of
+//                              the one before it. RAS output has one domain
+//   --mode <staged|pipeline>   staged runs the build serially and times each
+//                              stage. pipeline runs it through BuildRequest,
+//                              as the build service does, and reports the
+//                              wall time only (default staged)
+//   --output <directory>       scratch directory (default
+//                              metbuild_replay_output)
+//   --json <file>              write the report to a file instead of stdout
+//   --keep                     keep the output files
+//
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BuildRequest.h"
+#include "Date.h"
+#include "Grid.h"
+#include "MeteorologicalData.h"
+#include "Meteorology.h"
+#include "boost/filesystem.hpp"
+#include "output/OwiAscii.h"
+#include "output/OwiNetcdf.h"
+#include "output/RasNetcdf.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string test_case = "all";
+  double dx = 0.1;
+  int time_step = 900;
+  size_t domains = 1;
+  std::string mode = "staged";
+  std::string output = "metbuild_replay_output";
+  std::string json;
+  bool keep = false;
+};
+
+struct SourceFile {
+  std::vector<std::string> filenames;
+  MetBuild::Date time;
+};
+
+struct Case {
+  std::string name;
+  MetBuild::Meteorology::SOURCE source;
+  std::string format;
+  //...Outer domain as llx, lly, urx, ury
+  double extent[4];
+  //...Largest number of domains the format holds, zero when unlimited
+  size_t max_domains;
+  std::vector<SourceFile> files;
+};
+
+struct Result {
+  std::string name;
+  size_t domains = 0;
+  size_t cells = 0;
+  size_t steps = 0;
+  double wall = 0.0;
+  std::map<std::string, double> stages;
+  uintmax_t output_bytes = 0;
+  size_t output_files = 0;
+};
+
+//...The bundled files carry their own dates but only their spacing matters
+// for the replay, so they are given nominal times
+std::vector<Case> cases() {
+  const std::string dir = "../testing/test_files/";
+  Case gfs{"", MetBuild::Meteorology::GFS, "", {-98.0, 10.0, -60.0, 40.0}, 0,
+           {}};
+  for (int h = 0; h < 6; ++h) {
+    gfs.files.push_back({{dir + "gfs.t00z.pgrb2.0p25.f00" + std::to_string(h)},
+                         MetBuild::Date(2020, 1, 1, h, 0, 0)});
+  }
+  auto ascii = gfs;
+  ascii.name = "gfs-owi-ascii";
+  ascii.format = "owi-ascii";
+  auto netcdf = gfs;
+  netcdf.name = "gfs-owi-netcdf";
+  netcdf.format = "owi-netcdf";
+
+  Case coamps{"coamps-ras-netcdf",
+              MetBuild::Meteorology::COAMPS,
+              "ras-netcdf",
+              {-100.0, 10.0, -70.0, 40.0},
+              1,
+              {}};
+  for (int tau = 0; tau < 2; ++tau) {
+    SourceFile f{{}, MetBuild::Date(2020, 8, 24, tau, 0, 0)};
+    for (int d = 1; d <= 3; ++d) {
+      f.filenames.push_back(dir + "coamps-tc_d0" + std::to_string(d) +
+                            "_2020082400_tau00" + std::to_string(tau) + ".nc");
+    }
+    coamps.files.push_back(f);
+  }
+  return {ascii, netcdf, coamps};
+}
+
+std::vector<MetBuild::Grid> domain_grids(const Case &c, const Options &o) {
+  const size_t n = c.max_domains == 0 ? o.domains
+                                      : std::min(o.domains, c.max_domains);
+  std::vector<MetBuild::Grid> grids;
+  double llx = c.extent[0], lly = c.extent[1];
+  double urx = c.extent[2], ury = c.extent[3];
+  double dx = o.dx;
+  for (size_t k = 0; k < n; ++k) {
+    grids.emplace_back(llx, lly, urx, ury, dx, dx);
+    const double cx = 0.5 * (llx + urx), cy = 0.5 * (lly + ury);
+    const double hx = 0.25 * (urx - llx), hy = 0.25 * (ury - lly);
+    llx = cx - hx, urx = cx + hx, lly = cy - hy, ury = cy + hy;
+    dx *= 0.5;
+  }
+  return grids;
+}
+
+std::unique_ptr<MetBuild::OutputFile> make_output(
+    const Case &c, const Options &o, const std::vector<MetBuild::Grid> &grids,
+    const MetBuild::Date &start, const MetBuild::Date &end) {
+  const std::string base = o.output + "/" + c.name;
+  std::unique_ptr<MetBuild::OutputFile> output;
+  if (c.format == "owi-ascii") {
+    output = std::make_unique<MetBuild::OwiAscii>(start, end, o.time_step);
+  } else if (c.format == "owi-netcdf") {
+    output = std::make_unique<MetBuild::OwiNetcdf>(start, end, o.time_step,
+                                                   base + ".nc");
+  } else {
+    output = std::make_unique<MetBuild::RasNetcdf>(start, end, o.time_step,
+                                                   base + ".nc");
+  }
+  for (size_t k = 0; k < grids.size(); ++k) {
+    if (c.format == "owi-ascii") {
+      const auto n = std::to_string(221 + 2 * k);
+      const auto w = std::to_string(222 + 2 * k);
+      output->addDomain(grids[k], {base + "." + n, base + "." + w});
+    } else if (c.format == "owi-netcdf") {
+      output->addDomain(grids[k], {k == 0 ? std::string("Main")
+                                          : "Nest" + std::to_string(k)});
+    } else {
+      output->addDomain(grids[k], {"wind_u", "wind_v", "mslp"});
+    }
+  }
+  return output;
+}
+
+double seconds_since(const Clock::time_point &t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+//...Same time loop as MeteorologyPipeline, run serially with each stage timed
+void run_staged(const Case &c, const Options &o,
+                const std::vector<MetBuild::Grid> &grids,
+                MetBuild::OutputFile *output, Result &r) {
+  const auto start = c.files.front().time;
+  const auto end = c.files.back().time;
+  for (size_t k = 0; k < grids.size(); ++k) {
+    auto t = Clock::now();
+    MetBuild::Meteorology m(&grids[k], c.source,
+                            MetBuild::GriddedDataTypes::WIND_PRESSURE);
+    m.set_next_file(c.files[0].filenames);
+    m.set_next_file(c.files[1].filenames);
+    m.process_data();
+    r.stages["setup"] += seconds_since(t);
+
+    size_t index = 1;
+    MetBuild::MeteorologicalData<3> data;
+    for (auto time = start; time <= end; time += o.time_step) {
+      while (time > c.files[index].time) {
+        t = Clock::now();
+        m.set_next_file(c.files[++index].filenames);
+        m.process_data();
+        r.stages["decode"] += seconds_since(t);
+      }
+
+      t = Clock::now();
+      const auto weight = MetBuild::Meteorology::generate_time_weight(
+          c.files[index - 1].time, c.files[index].time, time);
+      m.to_wind_grid(data, weight);
+      r.stages["interpolate"] += seconds_since(t);
+
+      t = Clock::now();
+      output->write(time, k, data);
+      r.stages["write"] += seconds_since(t);
+      if (k == 0) ++r.steps;
+    }
+  }
+}
+
+void run_pipeline(const Case &c, const Options &o,
+                  const std::vector<MetBuild::Grid> &grids,
+                  MetBuild::OutputFile *output, Result &r) {
+  const auto start = c.files.front().time;
+  const auto end = c.files.back().time;
+  MetBuild::BuildRequest request(output, start, end, o.time_step);
+  for (size_t k = 0; k < grids.size(); ++k) {
+    request.add_domain(k, &grids[k], c.source,
+                       MetBuild::GriddedDataTypes::WIND_PRESSURE);
+    for (const auto &f : c.files) {
+      request.add_file(k, f.filenames, f.time);
+    }
+  }
+  request.run();
+  r.steps = static_cast<size_t>((end.toSeconds() - start.toSeconds()) /
+                                o.time_step) +
+            1;
+}
+
+Result run_case(const Case &c, const Options &o) {
+  Result r;
+  r.name = c.name;
+  const auto grids = domain_grids(c, o);
+  r.domains = grids.size();
+  for (const auto &g : grids) r.cells += g.ni() * g.nj();
+
+  boost::filesystem::create_directories(o.output);
+  const auto t = Clock::now();
+  std::vector<std::string> files;
+  {
+    auto output = make_output(c, o, grids, c.files.front().time,
+                              c.files.back().time);
+    if (o.mode == "pipeline") {
+      run_pipeline(c, o, grids, output.get(), r);
+    } else {
+      run_staged(c, o, grids, output.get(), r);
+    }
+    files = output->filenames();
+    //...Closing the files flushes any buffered or asynchronous writes
+  }
+  r.wall = seconds_since(t);
+
+  for (const auto &f : files) {
+    boost::system::error_code ec;
+    const auto path = boost::filesystem::path(f);
+    if (boost::filesystem::is_directory(path, ec)) {
+      for (const auto &e :
+           boost::filesystem::recursive_directory_iterator(path)) {
+        if (boost::filesystem::is_regular_file(e.path())) {
+          r.output_bytes += boost::filesystem::file_size(e.path());
+          ++r.output_files;
+        }
+      }
+    } else if (boost::filesystem::exists(path, ec)) {
+      r.output_bytes += boost::filesystem::file_size(path);
+      ++r.output_files;
+    }
+  }
+  if (!o.keep) {
+    for (const auto &f : files) boost::filesystem::remove_all(f);
+  }
+  return r;
+}
+
+long peak_rss_bytes() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return usage.ru_maxrss * 1024L;
+#endif
+}
+
+void write_json(std::ostream &os, const Options &o,
+                const std::vector<Result> &results) {
+  os << "{\n"
+     << "  \"mode\": \"" << o.mode << "\",\n"
+     << "  \"dx\": " << o.dx << ",\n"
+     << "  \"time_step\": " << o.time_step << ",\n"
+     << "  \"domains\": " << o.domains << ",\n"
+     << "  \"peak_rss_bytes\": " << peak_rss_bytes() << ",\n"
+     << "  \"cases\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto &r = results[i];
+    os << (i == 0 ? "\n" : ",\n") << "    {\n"
+       << "      \"name\": \"" << r.name << "\",\n"
+       << "      \"domains\": " << r.domains << ",\n"
+       << "      \"cells\": " << r.cells << ",\n"
+       << "      \"steps\": " << r.steps << ",\n"
+       << "      \"wall_seconds\": " << r.wall << ",\n"
+       << "      \"stages\": {";
+    size_t n = 0;
+    for (const auto &s : r.stages) {
+      os << (n++ == 0 ? "" : ", ") << "\"" << s.first << "\": " << s.second;
+    }
+    os << "},\n"
+       << "      \"output_files\": " << r.output_files << ",\n"
+       << "      \"output_bytes\": " << r.output_bytes << "\n"
+       << "    }";
+  }
+  os << "\n  ]\n}\n";
+}
+
+Options parse(int argc, char **argv) {
+  Options o;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc) {
+        std::cerr << "[ERROR]: Missing value for " << arg << std::endl;
+        std::exit(1);
+      }
+      return argv[++i];
+    };
+    if (arg == "--case") {
+      o.test_case = value();
+    } else if (arg == "--dx") {
+      o.dx = std::stod(value());
+    } else if (arg == "--time-step") {
+      o.time_step = std::stoi(value());
+    } else if (arg == "--domains") {
+      o.domains = std::stoul(value());
+    } else if (arg == "--mode") {
+      o.mode = value();
+    } else if (arg == "--output") {
+      o.output = value();
+    } else if (arg == "--json") {
+      o.json = value();
+    } else if (arg == "--keep") {
+      o.keep = true;
+    } else {
+      std::cerr << "[ERROR]: Unknown option " << arg << std::endl;
+      std::exit(1);
+    }
+  }
+  if (o.dx <= 0.0 || o.time_step <= 0 || o.domains == 0 ||
+      (o.mode != "staged" && o.mode != "pipeline")) {
+    std::cerr << "[ERROR]: Invalid replay options" << std::endl;
+    std::exit(1);
+  }
+  return o;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const auto options = parse(argc, argv);
+
+  std::vector<Result> results;
+  for (const auto &c : cases()) {
+    if (options.test_case != "all" && options.test_case != c.name) continue;
+    results.push_back(run_case(c, options));
+  }
+  if (results.empty()) {
+    std::cerr << "[ERROR]: Unknown case " << options.test_case << std::endl;
+    return 1;
+  }
+
+  if (options.json.empty()) {
+    write_json(std::cout, options, results);
+  } else {
+    std::ofstream f(options.json);
+    write_json(f, options, results);
+  }
+  return 0;
+}
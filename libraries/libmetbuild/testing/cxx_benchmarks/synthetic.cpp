@@ -0,0 +1,660 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+// Scaling runs on synthetic sources. The bundled test files are fixed in
+// size, so this writes grib (HWRF style regular lat/lon) or COAMPS style
+// netCDF sources of any resolution and extent holding analytic fields, runs
+// them through the library and checks the result against the analytic
+// answer. Run from the build directory, e.g.
+//
+//   ./cxx_testcases/metbuild_synthetic --source grib --source-dx 0.1,0.02
+//       --dx 0.05,0.01 --threads 1,4 --json scaling.json
+//
+// Fields:
+//   linear   wind and pressure vary linearly in space and time. Triangular
+//            and time interpolation reproduce them exactly, so the maximum
+//            error is checked against --tolerance and the run fails when
+//            it is exceeded
+//   vortex   Holland vortex crossing the extent. The error against the
+//            vortex evaluated on the output grid is reported, not checked
+//
+// The sources cover the output extent with a margin of one degree so every
+// output point is inside them. They are written once per source resolution
+// and reused when they already exist in the scratch directory
+//
+// Options:
+//   --source <grib|coamps>       source format (default grib)
+//   --field <linear|vortex>      analytic field (default linear)
+//   --extent <llx,lly,urx,ury>   output extent (default -90,20,-80,30)
+//   --source-dx <list>           source resolutions in degrees (default 0.1)
+//   --dx <list>                  output resolutions in degrees (default 0.05)
+//   --threads <list>             thread counts (default the library
+//                                default). The pool size is fixed when it
+//                                is first used, so with more than one count
+//                                each one runs in a child process
+//   --hours <n>                  hourly source files to write (default 6)
+//   --time-step <seconds>        output time step (default 900)
+//   --tolerance <value>          largest error of the linear field, in m/s
+//                                and mb (default 1e-3)
+//   --bits <n>                   bits per packed grib value (default 24)
+//   --generate-only              write the sources and stop
+//   --output <directory>         scratch directory (default
+//                                metbuild_synthetic_output)
+//   --json <file>                write the report to a file instead of stdout
+//   --keep                       keep the source files
+//
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Date.h"
+#include "Grid.h"
+#include "MeteorologicalData.h"
+#include "Meteorology.h"
+#include "ThreadPool.h"
+#include "boost/filesystem.hpp"
+#include "eccodes.h"
+#include "netcdf.h"
+#include "vortex/AtcfTrack.h"
+#include "vortex/HollandVortex.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Fields =
+    MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>;
+
+struct Options {
+  std::string source = "grib";
+  std::string field = "linear";
+  std::array<double, 4> extent = {-90.0, 20.0, -80.0, 30.0};
+  std::vector<double> source_dx = {0.1};
+  std::vector<double> dx = {0.05};
+  std::vector<size_t> threads;
+  int hours = 6;
+  int time_step = 900;
+  double tolerance = 1.0e-3;
+  long bits = 24;
+  bool generate_only = false;
+  std::string output = "metbuild_synthetic_output";
+  std::string json;
+  bool keep = false;
+};
+
+struct SourceFile {
+  std::string filename;
+  MetBuild::Date time;
+};
+
+struct Result {
+  double source_dx = 0.0;
+  size_t source_points = 0;
+  double dx = 0.0;
+  size_t cells = 0;
+  size_t steps = 0;
+  double generate = 0.0;
+  double wall = 0.0;
+  std::map<std::string, double> stages;
+  std::array<double, 3> max_error = {0.0, 0.0, 0.0};
+  bool passed = true;
+};
+
+constexpr double c_margin = 1.0;
+
+const MetBuild::Date &start_date() {
+  static const MetBuild::Date d(2020, 8, 24, 0, 0, 0);
+  return d;
+}
+
+double seconds_since(const Clock::time_point &t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+[[noreturn]] void fail(const std::string &message) {
+  std::cerr << "[ERROR]: " << message << std::endl;
+  std::exit(1);
+}
+
+//...Storm crossing the middle of the extent over the length of the run
+MetBuild::AtcfTrack track(const Options &o) {
+  const auto &e = o.extent;
+  const double cx = 0.5 * (e[0] + e[2]), cy = 0.5 * (e[1] + e[3]);
+  const double hx = 0.3 * (e[2] - e[0]), hy = 0.3 * (e[3] - e[1]);
+  auto end = start_date();
+  end += 3600 * o.hours;
+  MetBuild::AtcfRecord first{start_date(), cy - hy, cx - hx, 50.0, 950.0,
+                             MetBuild::AtcfTrack::default_background_pressure(),
+                             MetBuild::AtcfTrack::default_radius_max_wind()};
+  auto last = first;
+  last.time = end;
+  last.latitude = cy + hy;
+  last.longitude = cx + hx;
+  return MetBuild::AtcfTrack({first, last});
+}
+
+/**
+ * @brief Linear field whose interpolated value is exact
+ * @param o options, of which the extent centers the field
+ * @param x longitude
+ * @param y latitude
+ * @param hours time since the start of the run
+ * @return u, v and pressure in m/s and mb
+ */
+std::array<double, 3> linear(const Options &o, const double x, const double y,
+                             const double hours) {
+  const double dx = x - 0.5 * (o.extent[0] + o.extent[2]);
+  const double dy = y - 0.5 * (o.extent[1] + o.extent[3]);
+  return {5.0 + 0.5 * dx - 0.25 * dy + 0.1 * hours,
+          -3.0 + 0.2 * dx + 0.4 * dy - 0.05 * hours,
+          1000.0 + 0.8 * dx + 1.2 * dy + 0.3 * hours};
+}
+
+/**
+ * @brief Evaluates the analytic field on a grid
+ * @param o options
+ * @param grid grid to evaluate on
+ * @param vortex vortex on the same grid, used for the vortex field
+ * @param time time to evaluate at
+ * @param out u, v and pressure in m/s and mb
+ */
+void analytic(const Options &o, const MetBuild::Grid &grid,
+              const MetBuild::HollandVortex &vortex, const MetBuild::Date &time,
+              Fields &out) {
+  if (o.field == "vortex") {
+    vortex.evaluate(time, out);
+    return;
+  }
+  if (out.ni() != grid.ni() || out.nj() != grid.nj()) {
+    out.resize(grid.ni(), grid.nj());
+  }
+  const double hours =
+      static_cast<double>(time.toSeconds() - start_date().toSeconds()) /
+      3600.0;
+  for (size_t j = 0; j < grid.nj(); ++j) {
+    for (size_t i = 0; i < grid.ni(); ++i) {
+      const auto p = grid.position(i, j);
+      const auto v = linear(o, p.x(), p.y(), hours);
+      for (size_t k = 0; k < 3; ++k) {
+        out.set(k, i, j, static_cast<MetBuild::MeteorologicalDataType>(v[k]));
+      }
+    }
+  }
+}
+
+void write_grib(const std::string &filename, const Options &o,
+                const MetBuild::Grid &grid, const MetBuild::Date &time,
+                const Fields &fields) {
+  FILE *f = std::fopen(filename.c_str(), "wb");
+  if (f == nullptr) fail("Could not create " + filename);
+
+  //...Regular lat/lon grib longitudes are written from 0 to 360
+  auto longitude = [](const double x) { return x < 0.0 ? x + 360.0 : x; };
+  const auto ll = grid.corner(0, 0);
+  const auto ur = grid.corner(grid.ni() - 1, grid.nj() - 1);
+
+  struct Message {
+    const char *shortName;
+    const char *typeOfLevel;
+    long level;
+    size_t parameter;
+    double scale;
+  };
+  const Message messages[] = {{"prmsl", "meanSea", 0, 2, 100.0},
+                              {"10u", "heightAboveGround", 10, 0, 1.0},
+                              {"10v", "heightAboveGround", 10, 1, 1.0}};
+
+  std::vector<double> values(grid.ni() * grid.nj());
+  for (const auto &m : messages) {
+    codes_handle *h =
+        codes_grib_handle_new_from_samples(nullptr, "regular_ll_sfc_grib2");
+    if (h == nullptr) fail("Could not load the grib2 sample");
+    CODES_CHECK(codes_set_long(h, "dataDate",
+                               time.year() * 10000 + time.month() * 100 +
+                                   time.day()),
+                nullptr);
+    CODES_CHECK(codes_set_long(h, "dataTime", time.hour() * 100), nullptr);
+    CODES_CHECK(codes_set_long(h, "Ni", grid.ni()), nullptr);
+    CODES_CHECK(codes_set_long(h, "Nj", grid.nj()), nullptr);
+    CODES_CHECK(codes_set_long(h, "iScansNegatively", 0), nullptr);
+    CODES_CHECK(codes_set_long(h, "jScansPositively", 1), nullptr);
+    CODES_CHECK(
+        codes_set_double(h, "latitudeOfFirstGridPointInDegrees", ll.y()),
+        nullptr);
+    CODES_CHECK(codes_set_double(h, "longitudeOfFirstGridPointInDegrees",
+                                 longitude(ll.x())),
+                nullptr);
+    CODES_CHECK(
+        codes_set_double(h, "latitudeOfLastGridPointInDegrees", ur.y()),
+        nullptr);
+    CODES_CHECK(codes_set_double(h, "longitudeOfLastGridPointInDegrees",
+                                 longitude(ur.x())),
+                nullptr);
+    CODES_CHECK(
+        codes_set_double(h, "iDirectionIncrementInDegrees", grid.dx()),
+        nullptr);
+    CODES_CHECK(
+        codes_set_double(h, "jDirectionIncrementInDegrees", grid.dy()),
+        nullptr);
+    CODES_CHECK(codes_set_string(h, "typeOfLevel", m.typeOfLevel, nullptr),
+                nullptr);
+    CODES_CHECK(codes_set_long(h, "level", m.level), nullptr);
+    CODES_CHECK(codes_set_string(h, "shortName", m.shortName, nullptr),
+                nullptr);
+    CODES_CHECK(codes_set_long(h, "bitsPerValue", o.bits), nullptr);
+
+    const auto plane = fields.parameter(m.parameter);
+    for (size_t i = 0; i < values.size(); ++i) {
+      values[i] = static_cast<double>(plane[i]) * m.scale;
+    }
+    CODES_CHECK(codes_set_double_array(h, "values", values.data(),
+                                       values.size()),
+                nullptr);
+
+    const void *buffer = nullptr;
+    size_t size = 0;
+    CODES_CHECK(codes_get_message(h, &buffer, &size), nullptr);
+    if (std::fwrite(buffer, 1, size, f) != size) {
+      fail("Could not write " + filename);
+    }
+    codes_handle_delete(h);
+  }
+  std::fclose(f);
+}
+
+void nc_check(const int ierr, const std::string &filename) {
+  if (ierr != NC_NOERR) {
+    fail("Could not write " + filename + ": " + nc_strerror(ierr));
+  }
+}
+
+void write_coamps(const std::string &filename, const MetBuild::Grid &grid,
+                  const Fields &fields) {
+  int ncid = 0;
+  nc_check(nc_create(filename.c_str(), NC_NETCDF4 | NC_CLOBBER, &ncid),
+           filename);
+  int dims[2];
+  nc_check(nc_def_dim(ncid, "lat", grid.nj(), &dims[0]), filename);
+  nc_check(nc_def_dim(ncid, "lon", grid.ni(), &dims[1]), filename);
+  int varid_lat = 0, varid_lon = 0;
+  nc_check(nc_def_var(ncid, "lat", NC_DOUBLE, 2, dims, &varid_lat), filename);
+  nc_check(nc_def_var(ncid, "lon", NC_DOUBLE, 2, dims, &varid_lon), filename);
+
+  const char *names[] = {"uuwind", "vvwind", "slpres"};
+  const char *units[] = {"m/s", "m/s", "hPa"};
+  int varids[3];
+  for (size_t k = 0; k < 3; ++k) {
+    nc_check(nc_def_var(ncid, names[k], NC_FLOAT, 2, dims, &varids[k]),
+             filename);
+    nc_check(nc_put_att_text(ncid, varids[k], "units",
+                             std::char_traits<char>::length(units[k]),
+                             units[k]),
+             filename);
+  }
+  nc_check(nc_enddef(ncid), filename);
+
+  const auto x = grid.x();
+  const auto y = grid.y();
+  nc_check(nc_put_var_double(ncid, varid_lat, y.data()), filename);
+  nc_check(nc_put_var_double(ncid, varid_lon, x.data()), filename);
+
+  std::vector<float> values(grid.ni() * grid.nj());
+  for (size_t k = 0; k < 3; ++k) {
+    const auto plane = fields.parameter(k);
+    std::copy(plane.begin(), plane.end(), values.begin());
+    nc_check(nc_put_var_float(ncid, varids[k], values.data()), filename);
+  }
+  nc_check(nc_close(ncid), filename);
+}
+
+MetBuild::Grid source_grid(const Options &o, const double dx) {
+  return {o.extent[0] - c_margin, o.extent[1] - c_margin,
+          o.extent[2] + c_margin, o.extent[3] + c_margin, dx, dx};
+}
+
+std::string source_directory(const Options &o, const double dx) {
+  std::ostringstream s;
+  s << o.output << "/" << o.source << "_" << o.field << "_" << dx;
+  return s.str();
+}
+
+/**
+ * @brief Writes the hourly source files of one resolution, unless they were
+ * already written with the same options
+ * @param o options
+ * @param dx source resolution
+ * @param elapsed receives the time taken, zero when the files are reused
+ * @return source files in time order
+ */
+std::vector<SourceFile> generate(const Options &o, const double dx,
+                                 double &elapsed) {
+  const auto t = Clock::now();
+  const auto dir = source_directory(o, dx);
+  boost::filesystem::create_directories(dir);
+
+  const auto grid = source_grid(o, dx);
+  const MetBuild::HollandVortex vortex(&grid, track(o));
+  Fields fields;
+  std::vector<SourceFile> files;
+  bool written = false;
+  for (int h = 0; h <= o.hours; ++h) {
+    auto time = start_date();
+    time += 3600 * h;
+    char name[64];
+    if (o.source == "grib") {
+      std::snprintf(name, sizeof(name), "synthetic.f%03d.grb2", h);
+    } else {
+      std::snprintf(name, sizeof(name), "coamps-tc_d01_synthetic_tau%03d.nc",
+                    h);
+    }
+    const auto filename = dir + "/" + name;
+    files.push_back({filename, time});
+    if (boost::filesystem::exists(filename)) continue;
+
+    analytic(o, grid, vortex, time, fields);
+    if (o.source == "grib") {
+      write_grib(filename, o, grid, time, fields);
+    } else {
+      write_coamps(filename, grid, fields);
+    }
+    written = true;
+  }
+  elapsed = written ? seconds_since(t) : 0.0;
+  return files;
+}
+
+Result run(const Options &o, const std::vector<SourceFile> &files,
+           const double source_dx, const double dx) {
+  Result r;
+  r.source_dx = source_dx;
+  const auto sgrid = source_grid(o, source_dx);
+  r.source_points = sgrid.ni() * sgrid.nj();
+  r.dx = dx;
+  const MetBuild::Grid grid(o.extent[0], o.extent[1], o.extent[2],
+                            o.extent[3], dx, dx);
+  r.cells = grid.ni() * grid.nj();
+  const MetBuild::HollandVortex vortex(&grid, track(o));
+  const auto source = o.source == "grib" ? MetBuild::Meteorology::HWRF
+                                         : MetBuild::Meteorology::COAMPS;
+
+  const auto wall = Clock::now();
+  auto t = wall;
+  MetBuild::Meteorology m(&grid, source,
+                          MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  m.set_next_file(files[0].filename);
+  m.set_next_file(files[1].filename);
+  m.process_data();
+  r.stages["setup"] += seconds_since(t);
+
+  size_t index = 1;
+  Fields data, expected;
+  const auto start = files.front().time;
+  const auto end = files.back().time;
+  for (auto time = start; time <= end; time += o.time_step) {
+    while (time > files[index].time) {
+      t = Clock::now();
+      m.set_next_file(files[++index].filename);
+      m.process_data();
+      r.stages["decode"] += seconds_since(t);
+    }
+
+    t = Clock::now();
+    const auto weight = MetBuild::Meteorology::generate_time_weight(
+        files[index - 1].time, files[index].time, time);
+    m.to_wind_grid(data, weight);
+    r.stages["interpolate"] += seconds_since(t);
+    ++r.steps;
+
+    analytic(o, grid, vortex, time, expected);
+    for (size_t k = 0; k < 3; ++k) {
+      const auto a = data.parameter(k);
+      const auto b = expected.parameter(k);
+      for (size_t i = 0; i < a.size(); ++i) {
+        const double e = std::abs(static_cast<double>(a[i]) - b[i]);
+        r.max_error[k] = std::max(r.max_error[k], e);
+      }
+    }
+  }
+  r.wall = seconds_since(wall);
+  if (o.field == "linear") {
+    r.passed = *std::max_element(r.max_error.begin(), r.max_error.end()) <=
+               o.tolerance;
+  }
+  return r;
+}
+
+long peak_rss_bytes() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return usage.ru_maxrss * 1024L;
+#endif
+}
+
+void write_json(std::ostream &os, const Options &o,
+                const std::vector<Result> &results) {
+  os << "{\n"
+     << "  \"source\": \"" << o.source << "\",\n"
+     << "  \"field\": \"" << o.field << "\",\n"
+     << "  \"threads\": " << MetBuild::ThreadPool::defaultThreadCount()
+     << ",\n"
+     << "  \"time_step\": " << o.time_step << ",\n"
+     << "  \"peak_rss_bytes\": " << peak_rss_bytes() << ",\n"
+     << "  \"runs\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto &r = results[i];
+    os << (i == 0 ? "\n" : ",\n") << "    {\n"
+       << "      \"source_dx\": " << r.source_dx << ",\n"
+       << "      \"source_points\": " << r.source_points << ",\n"
+       << "      \"dx\": " << r.dx << ",\n"
+       << "      \"cells\": " << r.cells << ",\n"
+       << "      \"steps\": " << r.steps << ",\n"
+       << "      \"generate_seconds\": " << r.generate << ",\n"
+       << "      \"wall_seconds\": " << r.wall << ",\n"
+       << "      \"stages\": {";
+    size_t n = 0;
+    for (const auto &s : r.stages) {
+      os << (n++ == 0 ? "" : ", ") << "\"" << s.first << "\": " << s.second;
+    }
+    os << "},\n"
+       << "      \"max_error\": {\"u\": " << r.max_error[0]
+       << ", \"v\": " << r.max_error[1] << ", \"pressure\": " << r.max_error[2]
+       << "},\n"
+       << "      \"passed\": " << (r.passed ? "true" : "false") << "\n"
+       << "    }";
+  }
+  os << "\n  ]\n}\n";
+}
+
+void write_report(const Options &o, const std::string &report) {
+  if (o.json.empty()) {
+    std::cout << report;
+  } else {
+    std::ofstream f(o.json);
+    f << report;
+  }
+}
+
+template <typename T>
+std::vector<T> parse_list(const std::string &value) {
+  std::vector<T> list;
+  std::stringstream s(value);
+  std::string item;
+  while (std::getline(s, item, ',')) {
+    std::stringstream v(item);
+    T x{};
+    if (!(v >> x)) fail("Invalid list " + value);
+    list.push_back(x);
+  }
+  return list;
+}
+
+Options parse(int argc, char **argv) {
+  Options o;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc) fail("Missing value for " + arg);
+      return argv[++i];
+    };
+    if (arg == "--source") {
+      o.source = value();
+    } else if (arg == "--field") {
+      o.field = value();
+    } else if (arg == "--extent") {
+      const auto e = parse_list<double>(value());
+      if (e.size() != 4) fail("The extent needs four values");
+      std::copy(e.begin(), e.end(), o.extent.begin());
+    } else if (arg == "--source-dx") {
+      o.source_dx = parse_list<double>(value());
+    } else if (arg == "--dx") {
+      o.dx = parse_list<double>(value());
+    } else if (arg == "--threads") {
+      o.threads = parse_list<size_t>(value());
+    } else if (arg == "--hours") {
+      o.hours = std::stoi(value());
+    } else if (arg == "--time-step") {
+      o.time_step = std::stoi(value());
+    } else if (arg == "--tolerance") {
+      o.tolerance = std::stod(value());
+    } else if (arg == "--bits") {
+      o.bits = std::stol(value());
+    } else if (arg == "--generate-only") {
+      o.generate_only = true;
+    } else if (arg == "--output") {
+      o.output = value();
+    } else if (arg == "--json") {
+      o.json = value();
+    } else if (arg == "--keep") {
+      o.keep = true;
+    } else {
+      fail("Unknown option " + arg);
+    }
+  }
+  auto positive = [](const std::vector<double> &v) {
+    return !v.empty() && std::all_of(v.begin(), v.end(),
+                                     [](const double x) { return x > 0.0; });
+  };
+  if ((o.source != "grib" && o.source != "coamps") ||
+      (o.field != "linear" && o.field != "vortex") ||
+      o.extent[2] <= o.extent[0] || o.extent[3] <= o.extent[1] ||
+      !positive(o.source_dx) || !positive(o.dx) || o.hours < 1 ||
+      o.time_step <= 0 || o.bits < 1 || o.bits > 32 ||
+      std::find(o.threads.begin(), o.threads.end(), 0) != o.threads.end()) {
+    fail("Invalid synthetic options");
+  }
+  return o;
+}
+
+//...Runs each thread count in a child process, which reuses the sources
+// written by the first, and gathers their reports in one
+int sweep_threads(int argc, char **argv, const Options &o) {
+  std::string base = std::string("'") + argv[0] + "'";
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--threads" || arg == "--json") {
+      ++i;
+      continue;
+    }
+    if (arg != "--keep") base += std::string(" '") + arg + "'";
+  }
+  base += " --keep";
+
+  int status = 0;
+  std::string report = "{\n  \"sweeps\": [";
+  for (size_t k = 0; k < o.threads.size(); ++k) {
+    const auto json =
+        o.output + "/threads_" + std::to_string(o.threads[k]) + ".json";
+    const auto command = base + " --threads " +
+                         std::to_string(o.threads[k]) + " --json '" + json +
+                         "'";
+    const int rc = std::system(command.c_str());
+    if (rc != 0) status = 1;
+    std::ifstream f(json);
+    std::stringstream child;
+    child << f.rdbuf();
+    auto text = child.str();
+    while (!text.empty() && text.back() == '\n') text.pop_back();
+    report += (k == 0 ? "\n" : ",\n") + text;
+    boost::filesystem::remove(json);
+  }
+  report += "\n  ]\n}\n";
+  write_report(o, report);
+  if (!o.keep) boost::filesystem::remove_all(o.output);
+  return status;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const auto options = parse(argc, argv);
+  if (options.threads.size() > 1) {
+    boost::filesystem::create_directories(options.output);
+    return sweep_threads(argc, argv, options);
+  }
+  //...Set before anything uses the pool
+  if (options.threads.size() == 1) {
+    MetBuild::ThreadPool::setDefaultThreadCount(options.threads[0]);
+  }
+
+  std::vector<Result> results;
+  for (const auto sdx : options.source_dx) {
+    double elapsed = 0.0;
+    const auto files = generate(options, sdx, elapsed);
+    if (options.generate_only) continue;
+    for (const auto dx : options.dx) {
+      auto r = run(options, files, sdx, dx);
+      r.generate = elapsed;
+      elapsed = 0.0;
+      results.push_back(r);
+    }
+  }
+  if (options.generate_only) return 0;
+
+  std::ostringstream report;
+  write_json(report, options, results);
+  write_report(options, report.str());
+  if (!options.keep) boost::filesystem::remove_all(options.output);
+
+  const bool passed = std::all_of(results.begin(), results.end(),
+                                  [](const Result &r) { return r.passed; });
+  return passed ? 0 : 1;
+}
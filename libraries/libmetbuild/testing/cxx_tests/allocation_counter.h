@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_TESTING_ALLOCATION_COUNTER_H_
+#define METBUILD_TESTING_ALLOCATION_COUNTER_H_
+
+#include <cstddef>
+
+namespace MetBuild {
+namespace Testing {
+
+/**
+ * @brief Number of heap allocations made so far by the calling thread
+ *
+ * Counted by the replacement global operator new linked into the test and
+ * benchmark targets. Work handed to the thread pool is counted on the
+ * thread that runs it, so steady state checks run on a pool of one thread
+ */
+size_t allocations();
+
+/**
+ * @brief Counts the heap allocations made by the calling thread while it is
+ * in scope
+ */
+class AllocationScope {
+ public:
+  AllocationScope() : m_start(allocations()) {}
+
+  size_t count() const { return allocations() - m_start; }
+
+ private:
+  size_t m_start;
+};
+
+}  // namespace Testing
+}  // namespace MetBuild
+
+#endif  // METBUILD_TESTING_ALLOCATION_COUNTER_H_
@@ -0,0 +1,167 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include "output/AsyncWriter.h"
+#include "output/OutputDomain.h"
+#include "output/OutputFile.h"
+
+namespace {
+class RecordingDomain : public MetBuild::OutputDomain {
+ public:
+  RecordingDomain()
+      : OutputDomain(nullptr, MetBuild::Date(2020, 1, 1, 0, 0, 0),
+                     MetBuild::Date(2020, 1, 2, 0, 0, 0), 3600) {}
+
+  void open() override {}
+  void close() override {}
+
+  int write(
+      const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+          &data) override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    if (data.get(0, 0, 0) < 0.0) throw std::runtime_error("write failed");
+    dates.push_back(date);
+    values.push_back(data.get(0, 0, 0));
+    return 0;
+  }
+
+  int write(
+      const MetBuild::Date &date,
+      const MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType>
+          &data) override {
+    dates.push_back(date);
+    values.push_back(data.get(2, 0, 0));
+    return 0;
+  }
+
+  std::vector<MetBuild::Date> dates;
+  std::vector<MetBuild::MeteorologicalDataType> values;
+};
+
+class RecordingFile : public MetBuild::OutputFile {
+ public:
+  RecordingFile()
+      : OutputFile(MetBuild::Date(2020, 1, 1, 0, 0, 0),
+                   MetBuild::Date(2020, 1, 2, 0, 0, 0), 3600) {}
+
+  void addDomain(const MetBuild::Grid &,
+                 const std::vector<std::string> &) override {
+    this->addRecordingDomain();
+  }
+
+  void addRecordingDomain() {
+    m_domains.push_back(std::make_unique<RecordingDomain>());
+  }
+
+  int write(
+      const MetBuild::Date &date, size_t domain_index,
+      const MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+          &data) override {
+    return this->write_domain(domain_index, date, data);
+  }
+
+  const RecordingDomain &domain(size_t index) const {
+    return static_cast<const RecordingDomain &>(*m_domains[index]);
+  }
+};
+}  // namespace
+
+TEST_CASE("Async writer keeps record order", "[asyncwriter]") {
+  RecordingDomain domain;
+  MetBuild::AsyncWriter writer(&domain, 2);
+
+  const auto start = MetBuild::Date(2020, 1, 1, 0, 0, 0);
+  MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType> scalar(2,
+                                                                          2);
+  MetBuild::MeteorologicalData<3, MetBuild::MeteorologicalDataType> wind(2, 2);
+  for (int i = 0; i < 20; ++i) {
+    //...The buffer is reused immediately, so the writer must hold a copy
+    scalar.set(0, 0, 0, static_cast<float>(i));
+    writer.write(start + i * 3600, scalar);
+  }
+  wind.set(2, 0, 0, 1013.0f);
+  writer.write(start + 20 * 3600, wind);
+  writer.flush();
+
+  REQUIRE(domain.values.size() == 21);
+  for (int i = 0; i < 20; ++i) {
+    REQUIRE((domain.dates[i] == start + i * 3600));
+    REQUIRE(domain.values[i] == static_cast<float>(i));
+  }
+  REQUIRE(domain.values[20] == 1013.0f);
+}
+
+TEST_CASE("Async writer reports errors on flush", "[asyncwriter]") {
+  RecordingDomain domain;
+  MetBuild::AsyncWriter writer(&domain, 4);
+
+  MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType> scalar(1,
+                                                                          1);
+  scalar.set(0, 0, 0, -1.0f);
+  const auto date = MetBuild::Date(2020, 1, 1, 0, 0, 0);
+  writer.write(date, scalar);
+  REQUIRE_THROWS(writer.flush());
+  REQUIRE_NOTHROW(writer.flush());
+}
+
+TEST_CASE("Output domains written from several threads", "[asyncwriter]") {
+  for (const bool async : {false, true}) {
+    RecordingFile file;
+    for (size_t d = 0; d < 3; ++d) file.addRecordingDomain();
+    file.set_async(async);
+
+    const auto start = MetBuild::Date(2020, 1, 1, 0, 0, 0);
+    std::vector<std::thread> threads;
+    for (size_t d = 0; d < 3; ++d) {
+      threads.emplace_back([&file, d, start]() {
+        MetBuild::MeteorologicalData<1, MetBuild::MeteorologicalDataType>
+            scalar(1, 1);
+        for (int i = 0; i < 10; ++i) {
+          scalar.set(0, 0, 0, static_cast<float>(100 * d + i));
+          file.write(start + i * 3600, d, scalar);
+        }
+      });
+    }
+    for (auto &t : threads) t.join();
+    file.flush();
+
+    for (size_t d = 0; d < 3; ++d) {
+      REQUIRE(file.domain(d).values.size() == 10);
+      for (int i = 0; i < 10; ++i) {
+        REQUIRE(file.domain(d).values[i] == static_cast<float>(100 * d + i));
+      }
+    }
+  }
+}
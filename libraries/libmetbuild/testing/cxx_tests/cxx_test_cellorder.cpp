@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <vector>
+
+#include "CellOrder.h"
+#include "InterpolationWeights.h"
+#include "catch.hpp"
+
+TEST_CASE("Morton codes", "[cellorder]") {
+  REQUIRE(MetBuild::CellOrder::morton(0, 0) == 0);
+  REQUIRE(MetBuild::CellOrder::morton(1, 0) == 1);
+  REQUIRE(MetBuild::CellOrder::morton(0, 1) == 2);
+  REQUIRE(MetBuild::CellOrder::morton(1, 1) == 3);
+  REQUIRE(MetBuild::CellOrder::morton(2, 0) == 4);
+  REQUIRE(MetBuild::CellOrder::morton(3, 5) == 39);
+}
+
+TEST_CASE("Tiled cell order", "[cellorder]") {
+  //...Rows wider than a tile, a partial last tile and a band running past
+  // the last row of the grid
+  constexpr size_t ni = 200;
+  constexpr size_t nj = 150;
+  const MetBuild::InterpolationWeights::CellRanges ranges = {
+      {5, 170}, {390, 7000}, {7200, 7201}, {12000, nj * ni}};
+  const size_t band = 100 * ni;
+
+  const auto visit = [&](MetBuild::CellOrder::ORDER order) {
+    MetBuild::CellOrder::setOrder(order);
+    std::vector<int> visits(ni * nj, 0);
+    std::vector<size_t> runs;
+    for (size_t b0 = 0; b0 < ni * nj; b0 += band) {
+      MetBuild::CellOrder::for_each(
+          ranges, ni, b0, b0 + band, [&](size_t begin, size_t count) {
+            REQUIRE(count > 0);
+            REQUIRE(begin + count <= ni * nj);
+            runs.push_back(count);
+            for (size_t c = begin; c < begin + count; ++c) visits[c]++;
+          });
+    }
+    return std::make_pair(visits, runs);
+  };
+
+  const auto rows = visit(MetBuild::CellOrder::ROWS);
+  const auto tiles = visit(MetBuild::CellOrder::TILES);
+  MetBuild::CellOrder::setOrder(MetBuild::CellOrder::ROWS);
+
+  REQUIRE(rows.first == tiles.first);
+  for (size_t c = 0; c < ni * nj; ++c) {
+    bool inside = false;
+    for (const auto &r : ranges) inside = inside || (c >= r.begin && c < r.end);
+    REQUIRE(rows.first[c] == (inside ? 1 : 0));
+  }
+  for (const auto n : tiles.second) {
+    REQUIRE(n <= MetBuild::CellOrder::c_tile_cells);
+  }
+  REQUIRE(tiles.second.size() > rows.second.size());
+}
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <vector>
+
+#include "CompositeMeteorology.h"
+#include "InterpolationWeights.h"
+#include "catch.hpp"
+
+TEST_CASE("Cell range intersection", "[composite]") {
+  using MetBuild::InterpolationWeights;
+  const InterpolationWeights::CellRanges a = {{0, 10}, {20, 30}, {40, 50}};
+  const InterpolationWeights::CellRanges b = {{5, 25}, {28, 45}};
+  const auto c = InterpolationWeights::intersect(a, b);
+  REQUIRE(c.size() == 4);
+  REQUIRE(c[0].begin == 5);
+  REQUIRE(c[0].end == 10);
+  REQUIRE(c[1].begin == 20);
+  REQUIRE(c[1].end == 25);
+  REQUIRE(c[2].begin == 28);
+  REQUIRE(c[2].end == 30);
+  REQUIRE(c[3].begin == 40);
+  REQUIRE(c[3].end == 45);
+  REQUIRE(InterpolationWeights::intersect(a, {}).empty());
+}
+
+TEST_CASE("Composite blend weights", "[composite]") {
+  constexpr size_t ni = 20;
+  constexpr size_t nj = 10;
+
+  //...Source covers columns 5 through 19 of every row
+  MetBuild::InterpolationWeights::CellRanges valid;
+  for (size_t j = 0; j < nj; ++j) {
+    valid.push_back({j * ni + 5, j * ni + ni});
+  }
+
+  const auto sharp =
+      MetBuild::CompositeMeteorology::blend_weights(ni, nj, valid, 0.0);
+  REQUIRE(sharp[3 * ni + 4] == 0.0F);
+  REQUIRE(sharp[3 * ni + 5] == 1.0F);
+
+  const auto ramp =
+      MetBuild::CompositeMeteorology::blend_weights(ni, nj, valid, 4.0);
+  for (size_t j = 0; j < nj; ++j) {
+    REQUIRE(ramp[j * ni + 4] == 0.0F);
+    REQUIRE(ramp[j * ni + 5] == Approx(0.25));
+    REQUIRE(ramp[j * ni + 6] == Approx(0.5));
+    REQUIRE(ramp[j * ni + 8] == Approx(1.0));
+    REQUIRE(ramp[j * ni + 19] == Approx(1.0));
+  }
+
+  //...Full coverage is not tapered at the edge of the grid
+  const auto full = MetBuild::CompositeMeteorology::blend_weights(
+      ni, nj, {{0, ni * nj}}, 4.0);
+  REQUIRE(full.front() == 1.0F);
+  REQUIRE(full.back() == 1.0F);
+}
@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CouplingRing.h"
+#include "catch.hpp"
+
+TEST_CASE("Coupling ring", "[coupling]") {
+  const std::string filename = "coupling_ring_test.ring";
+  const auto start = MetBuild::Date(2020, 1, 1, 0, 0, 0);
+  const size_t n = 3;
+
+  REQUIRE_THROWS(MetBuild::CouplingRing::create(filename, n, {"a"}, 1, start));
+  auto writer =
+      MetBuild::CouplingRing::create(filename, n, {"wind_u", "mslp"}, 2, start);
+  auto reader = MetBuild::CouplingRing::open(filename);
+  REQUIRE(reader->size() == n);
+  REQUIRE(reader->slots() == 2);
+  REQUIRE(reader->names() == std::vector<std::string>{"wind_u", "mslp"});
+  REQUIRE(reader->start_date().toSeconds() == start.toSeconds());
+
+  //...Step k holds k in the first field and 10k in the second, with a
+  // flagged value in the last cell of the third step
+  const auto step = [n](const size_t k) {
+    std::vector<std::vector<MetBuild::MeteorologicalDataType>> v(2);
+    v[0].assign(n, static_cast<MetBuild::MeteorologicalDataType>(k));
+    v[1].assign(n, static_cast<MetBuild::MeteorologicalDataType>(10 * k));
+    if (k == 2) v[0][n - 1] = MetBuild::MeteorologicalData<1>::flag_value();
+    return v;
+  };
+  const auto write = [&](const size_t k) {
+    const auto v = step(k);
+    writer->write(3600.0 * k, {v[0].data(), v[1].data()});
+  };
+
+  std::vector<MetBuild::MeteorologicalDataType> values(n);
+  REQUIRE_FALSE(reader->read(0.0, 0, values.data(), 0.0));
+  write(0);
+  write(1);
+  REQUIRE_THROWS(write(1));
+
+  REQUIRE(reader->read(0.0, 1, values.data(), 0.0));
+  REQUIRE(values[0] == Approx(0.0));
+  REQUIRE(reader->read(900.0, 1, values.data(), 0.0));
+  REQUIRE(values[0] == Approx(2.5));
+
+  //...The ring is full until the reader moves past the first step, so the
+  // writer waits for it
+  std::thread producer([&]() {
+    write(2);
+    write(3);
+    writer->finish();
+  });
+  REQUIRE(reader->read(5400.0, 0, values.data()));
+  REQUIRE(values[0] == Approx(1.5));
+  REQUIRE(values[n - 1] == MetBuild::MeteorologicalData<1>::flag_value());
+  REQUIRE(reader->read(10800.0, 1, values.data()));
+  REQUIRE(values[1] == Approx(30.0));
+  producer.join();
+
+  REQUIRE_THROWS(reader->read(0.0, 0, values.data(), 0.0));
+  REQUIRE_THROWS(reader->read(11000.0, 0, values.data(), 0.0));
+  REQUIRE_THROWS(reader->read(10800.0, 2, values.data(), 0.0));
+
+  writer.reset();
+  REQUIRE_THROWS(MetBuild::CouplingRing::open(filename));
+}
@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <cmath>
+#include <vector>
+
+#include "MeteorologicalData.h"
+#include "catch.hpp"
+#include "output/DerivedWind.h"
+
+TEST_CASE("Derived wind fields", "[derived wind]") {
+  using MetBuild::DerivedWind;
+  const DerivedWind derived(DerivedWind::SPEED | DerivedWind::DIRECTION |
+                            DerivedWind::STRESS);
+  REQUIRE(derived.fields().size() == 4);
+
+  constexpr float flag = MetBuild::MeteorologicalData<1, float>::flag_value();
+  const std::vector<float> u = {3.0f, 0.0f, -10.0f, 0.0f, flag};
+  const std::vector<float> v = {4.0f, -5.0f, 0.0f, 0.0f, 1.0f};
+  std::vector<std::vector<float>> values(4, std::vector<float>(u.size()));
+  std::vector<float *> out;
+  for (auto &f : values) out.push_back(f.data());
+  derived.compute(u.size(), u.data(), v.data(), out.data());
+
+  const auto &speed = values[0];
+  const auto &direction = values[1];
+  REQUIRE(speed[0] == Approx(5.0));
+  REQUIRE(speed[2] == Approx(10.0));
+  REQUIRE(speed[3] == 0.0f);
+
+  //...Direction the wind blows from, clockwise from north
+  REQUIRE(direction[0] == Approx(216.8699));
+  REQUIRE(direction[1] == Approx(0.0).margin(1e-4));
+  REQUIRE(direction[2] == Approx(90.0));
+
+  const double cd = (0.75 + 0.067 * 5.0) * 1e-3;
+  REQUIRE(derived.dragCoefficient(5.0) == Approx(cd));
+  REQUIRE(values[2][0] == Approx(1.293 * cd * 5.0 * 3.0));
+  REQUIRE(values[3][0] == Approx(1.293 * cd * 5.0 * 4.0));
+  REQUIRE(values[2][3] == 0.0f);
+
+  for (const auto &f : values) REQUIRE(f[4] == flag);
+}
+
+TEST_CASE("Derived wind drag", "[derived wind]") {
+  using MetBuild::DerivedWind;
+  const DerivedWind garratt(DerivedWind::STRESS, DerivedWind::GARRATT);
+  const DerivedWind powell(DerivedWind::STRESS, DerivedWind::POWELL);
+  REQUIRE(garratt.fields().size() == 2);
+
+  REQUIRE(garratt.dragCoefficient(10.0) == powell.dragCoefficient(10.0));
+  REQUIRE(garratt.dragCoefficient(60.0) == Approx(0.0035));
+  REQUIRE(powell.dragCoefficient(60.0) == Approx(0.0025));
+
+  REQUIRE(DerivedWind::dragFromName(DerivedWind::dragName(
+              DerivedWind::POWELL)) == DerivedWind::POWELL);
+  REQUIRE_THROWS(DerivedWind(8));
+}
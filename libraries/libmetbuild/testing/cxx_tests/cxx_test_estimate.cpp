@@ -0,0 +1,198 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <chrono>
+
+#include "Date.h"
+#include "ExecutionPlan.h"
+#include "Grid.h"
+#include "Instrumentation.h"
+#include "RequestEstimate.h"
+#include "RequestKey.h"
+#include "catch.hpp"
+
+TEST_CASE("Request estimate", "[estimate]") {
+  using MetBuild::Instrumentation;
+  using MetBuild::RequestEstimate;
+  const MetBuild::Date start(2023, 6, 1, 0, 0, 0);
+  const MetBuild::Date end(2023, 6, 2, 0, 0, 0);
+  const MetBuild::Grid small(-100.0, 20.0, -80.0, 30.0, 0.25, 0.25);
+  const MetBuild::Grid large(-100.0, 20.0, -80.0, 30.0, 0.05, 0.05);
+
+  RequestEstimate a(start, end, 3600, "owi-ascii");
+  a.add_domain(&small, MetBuild::Meteorology::GFS,
+               MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  RequestEstimate b(start, end, 3600, "owi-ascii");
+  b.add_domain(&large, MetBuild::Meteorology::GFS,
+               MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  RequestEstimate c(start, end + 86400, 3600, "owi-ascii");
+  c.add_domain(&small, MetBuild::Meteorology::GFS,
+               MetBuild::GriddedDataTypes::WIND_PRESSURE);
+
+  REQUIRE(a.records() == 25);
+  REQUIRE(c.records() == 49);
+  REQUIRE(b.cpu_seconds() > a.cpu_seconds());
+  REQUIRE(c.cpu_seconds() > a.cpu_seconds());
+  REQUIRE(b.output_bytes() > a.output_bytes());
+  REQUIRE(c.output_bytes() > a.output_bytes());
+  REQUIRE(b.peak_memory() > a.peak_memory());
+  REQUIRE(a.stage_seconds(Instrumentation::NETCDF_WRITE) == 0.0);
+  REQUIRE(a.stage_seconds(Instrumentation::FORMAT) > 0.0);
+
+  //...Compressed text output is smaller and costs the compression
+  RequestEstimate z(start, end, 3600, "owi-ascii", true);
+  z.add_domain(&small, MetBuild::Meteorology::GFS,
+               MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  REQUIRE(z.output_bytes() < a.output_bytes());
+  REQUIRE(z.stage_seconds(Instrumentation::COMPRESS) > 0.0);
+
+  //...A budget bands the grid and runs the domains one at a time
+  b.add_domain(&large, MetBuild::Meteorology::HRRR_CONUS,
+               MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  const auto unbounded = b.peak_memory();
+  b.set_memory_budget(1024 * 1024);
+  REQUIRE(b.peak_memory() < unbounded);
+
+  //...Calibration takes the measured cost of the stages timed
+  const auto before = Instrumentation::report();
+  Instrumentation::record(Instrumentation::INTERPOLATE,
+                          std::chrono::seconds(1), 1000);
+  const auto report = Instrumentation::report().since(before);
+  RequestEstimate d(start, end, 3600, "owi-ascii");
+  d.add_domain(&small, MetBuild::Meteorology::GFS,
+               MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  const auto locate = d.stage_seconds(Instrumentation::LOCATE);
+  d.calibrate(report);
+  REQUIRE(d.stage_seconds(Instrumentation::INTERPOLATE) ==
+          Approx(25.0 * small.ni() * small.nj() * 3 / 1000.0));
+  REQUIRE(d.stage_seconds(Instrumentation::LOCATE) == locate);
+
+  REQUIRE_THROWS(RequestEstimate(start, end, 3600, "unknown"));
+  REQUIRE_THROWS(RequestEstimate(end, start, 3600, "owi-ascii"));
+}
+
+TEST_CASE("Execution plan", "[estimate]") {
+  using MetBuild::ExecutionPlan;
+  using MetBuild::RequestEstimate;
+  const MetBuild::Date start(2023, 6, 1, 0, 0, 0);
+  const MetBuild::Date end(2023, 6, 5, 0, 0, 0);
+  const MetBuild::Grid large(-100.0, 20.0, -80.0, 30.0, 0.01, 0.01);
+
+  RequestEstimate e(start, end, 3600, "owi-netcdf");
+  e.add_domain(&large, MetBuild::Meteorology::GFS,
+               MetBuild::GriddedDataTypes::WIND_PRESSURE);
+
+  MetBuild::ExecutionPolicy policy;
+  policy.set_threads(8);
+  ExecutionPlan plan(e, policy);
+  plan.set_processors(4);
+  plan.set_memory_limit(0);
+  REQUIRE(plan.mode() == ExecutionPlan::IN_MEMORY);
+  REQUIRE(plan.policy().threads() == 4);
+  REQUIRE(plan.policy().memory_budget() == 0);
+  REQUIRE(plan.band_rows() == large.nj());
+  REQUIRE(plan.shards() == 1);
+  REQUIRE(plan.decode_share() + plan.kernel_share() + plan.output_share() <=
+          Approx(1.0));
+
+  //...A limit the request does not fit in bands it under half of it
+  const size_t limit = e.peak_memory() / 2;
+  plan.set_memory_limit(limit);
+  REQUIRE(plan.mode() == ExecutionPlan::BANDED);
+  REQUIRE(plan.policy().memory_budget() <= limit / 2);
+  REQUIRE(plan.band_rows() < large.nj());
+  REQUIRE(plan.policy().ring_depth() == 2);
+  REQUIRE(plan.peak_memory() < e.peak_memory());
+
+  //...Long requests are split over the workers available
+  plan.set_workers(3);
+  plan.set_shard_seconds(plan.wall_seconds() / 10.0);
+  REQUIRE(plan.shards() == 3);
+  plan.set_shard_seconds(plan.wall_seconds() * 2.0);
+  REQUIRE(plan.shards() == 1);
+  REQUIRE_FALSE(plan.describe().empty());
+
+  //...Cached weights leave nothing to locate
+  const auto cpu = e.cpu_seconds();
+  e.set_weights_cached(true);
+  REQUIRE(e.cpu_seconds() < cpu);
+}
+
+TEST_CASE("Request key", "[estimate]") {
+  using MetBuild::RequestKey;
+  const MetBuild::Date start(2023, 6, 1, 0, 0, 0);
+  const MetBuild::Date end(2023, 6, 2, 0, 0, 0);
+  const MetBuild::Grid grid(-100.0, 20.0, -80.0, 30.0, 0.25, 0.25);
+  const MetBuild::Grid same(-100.0, 20.0, -80.0, 30.0, 0.25, 0.25);
+  const MetBuild::Grid other(-100.0, 20.0, -80.0, 30.0, 0.5, 0.5);
+
+  auto request = [&](const MetBuild::Grid *g, bool reversed) {
+    RequestKey k(start, end, 3600, "owi-netcdf", "out.nc");
+    k.add_domain(g, MetBuild::Meteorology::GFS,
+                 MetBuild::GriddedDataTypes::WIND_PRESSURE);
+    if (reversed) {
+      k.add_file("gfs/f003.grib2", end);
+      k.add_file("gfs/f000.grib2", start);
+      k.add_option("nowcast", "true");
+      k.add_option("multiple_forecasts", "false");
+    } else {
+      k.add_file("gfs/f000.grib2", start);
+      k.add_file("gfs/f003.grib2", end);
+      k.add_option("multiple_forecasts", "false");
+      k.add_option("nowcast", "true");
+    }
+    return k;
+  };
+
+  //...Equivalent grids and a different order of files and options agree
+  const auto key = request(&grid, false).key();
+  REQUIRE(key.size() == 16);
+  REQUIRE(request(&same, true).key() == key);
+  REQUIRE(request(&other, false).key() != key);
+
+  auto changed = request(&grid, false);
+  changed.add_option("interpolation", "nearest");
+  REQUIRE(changed.key() != key);
+
+  auto more = request(&grid, false);
+  more.add_file("gfs/f006.grib2", end + 10800);
+  REQUIRE(more.key() != key);
+
+  RequestKey renamed(start, end, 3600, "owi-netcdf", "other.nc");
+  renamed.add_domain(&grid, MetBuild::Meteorology::GFS,
+                     MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  renamed.add_file("gfs/f000.grib2", start);
+  renamed.add_file("gfs/f003.grib2", end);
+  renamed.add_option("multiple_forecasts", "false");
+  renamed.add_option("nowcast", "true");
+  REQUIRE(renamed.key() != key);
+
+  RequestKey empty(start, end, 3600, "owi-netcdf", "out.nc");
+  REQUIRE_THROWS(empty.add_file("gfs/f000.grib2", start));
+  REQUIRE_THROWS(RequestKey(end, start, 3600, "owi-netcdf", "out.nc"));
+}
@@ -0,0 +1,192 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <cstdio>
+#include <string>
+
+#include "catch.hpp"
+#include "Md5.h"
+#include "output/Checkpoint.h"
+#include "output/FileChecksum.h"
+#include "output/FileSink.h"
+#include "test_utilities.h"
+
+using MetBuild::Testing::read_file;
+
+TEST_CASE("File sink", "[filesink]") {
+  const std::string filename = "filesink_test.txt";
+
+  //...Small blocks so that the writes span many blocks and the writer has
+  // to hand blocks back before the caller can go on
+  std::string expected;
+  {
+    MetBuild::FileSinkBuffer buffer(4096, 2);
+    REQUIRE(buffer.open(filename));
+    REQUIRE(buffer.is_open());
+    std::ostream stream(&buffer);
+    for (int i = 0; i < 20000; ++i) {
+      const auto line = std::to_string(i) + " " + std::to_string(i * i) + "\n";
+      stream << line;
+      expected += line;
+    }
+    const std::string large(100000, 'x');
+    stream.write(large.data(), static_cast<std::streamsize>(large.size()));
+    expected += large;
+    stream.flush();
+    REQUIRE(stream.good());
+    REQUIRE(read_file(filename) == expected);
+
+    stream.put('y');
+    expected += 'y';
+    buffer.close();
+    REQUIRE_FALSE(buffer.is_open());
+  }
+  REQUIRE(read_file(filename) == expected);
+
+  //...Reopening truncates the file
+  {
+    MetBuild::FileSink sink(filename);
+    REQUIRE(sink.is_open());
+    sink << "header\n";
+  }
+  REQUIRE(read_file(filename) == "header\n");
+  std::remove(filename.c_str());
+
+  MetBuild::FileSink missing("no_such_directory/filesink_test.txt");
+  REQUIRE_FALSE(missing.is_open());
+  REQUIRE(missing.fail());
+}
+
+TEST_CASE("File sink resume", "[filesink]") {
+  const std::string filename = "filesink_resume_test.txt";
+  uint64_t offset = 0;
+  {
+    MetBuild::FileSink sink(filename);
+    sink << "record 1\n";
+    offset = sink.commit();
+    REQUIRE(offset == 9);
+    REQUIRE(read_file(filename) == "record 1\n");
+    //...Written after the checkpoint and lost when the build stops
+    sink << "partial";
+  }
+
+  //...Resuming drops everything past the checkpoint and appends from there
+  {
+    MetBuild::FileSink sink;
+    sink.resume(filename, offset);
+    REQUIRE(sink.is_open());
+    sink << "record 2\n";
+    REQUIRE(sink.commit() == 18);
+  }
+  REQUIRE(read_file(filename) == "record 1\nrecord 2\n");
+
+  //...A file shorter than the checkpoint cannot be resumed
+  MetBuild::FileSink sink;
+  sink.resume(filename, 1000);
+  REQUIRE_FALSE(sink.is_open());
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("File sink checksums", "[filesink]") {
+  MetBuild::Md5 empty;
+  REQUIRE(empty.hexdigest() == "d41d8cd98f00b204e9800998ecf8427e");
+  const std::string fox = "The quick brown fox jumps over the lazy dog";
+  MetBuild::Md5 md5;
+  md5.update(fox.data(), fox.size());
+  REQUIRE(md5.hexdigest() == "9e107d9d372bb6826bd81d3542a419d6");
+
+  //...Parts split across updates, with a short part at the end
+  MetBuild::ChecksumAccumulator accumulator(4);
+  accumulator.update("abcde", 5);
+  accumulator.update("fghij", 5);
+  const auto parts = accumulator.finish("parts");
+  REQUIRE(parts.size == 10);
+  REQUIRE(parts.md5 == "a925576942e94b2ef57a066101b48876");
+  REQUIRE(parts.part_md5.size() == 3);
+  REQUIRE(parts.part_md5[0] == "e2fc714c4727ee9395f324cd2e7f331f");
+  REQUIRE(parts.part_md5[1] == "1f7690ebdd9b4caf8fab49ca1757bf27");
+  REQUIRE(parts.part_md5[2] == "7bed657a775c37c2570786d0cbeefd88");
+  REQUIRE(parts.etag() == "446feba4c1b5cc7ad93bf4d44a0e36ac-3");
+
+  //...The file written in many small blocks has the digest of its contents
+  const std::string filename = "filesink_checksum_test.txt";
+  std::string expected;
+  {
+    MetBuild::FileSinkBuffer buffer(4096, 2);
+    REQUIRE(buffer.open(filename));
+    std::ostream stream(&buffer);
+    for (int i = 0; i < 20000; ++i) {
+      const auto line = std::to_string(i) + "\n";
+      stream << line;
+      expected += line;
+    }
+    buffer.close();
+  }
+  MetBuild::Md5 contents;
+  contents.update(expected.data(), expected.size());
+  auto checksum = MetBuild::FileChecksums::take(filename);
+  REQUIRE(checksum.valid());
+  REQUIRE(checksum.size == expected.size());
+  REQUIRE(checksum.md5 == contents.hexdigest());
+  REQUIRE(checksum.part_md5.size() == 1);
+  REQUIRE_FALSE(MetBuild::FileChecksums::find(filename).valid());
+
+  //...A resumed file digests the part it keeps
+  {
+    MetBuild::FileSink sink(filename);
+    sink << "record 1\n";
+    const auto offset = sink.commit();
+    sink << "partial";
+    sink.close();
+    sink.resume(filename, offset);
+    sink << "record 2\n";
+  }
+  checksum = MetBuild::FileChecksums::take(filename);
+  REQUIRE(checksum.md5 == "07ee2cda525ea6c430acaf81b2a526de");
+  REQUIRE(checksum.size == 18);
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("Checkpoint", "[filesink]") {
+  const std::string filename = "checkpoint_test.checkpoint";
+  std::remove(filename.c_str());
+  REQUIRE(MetBuild::Checkpoint::read(filename).size() == 0);
+
+  MetBuild::Checkpoint checkpoint;
+  checkpoint.set(1, {MetBuild::Date(2022, 1, 2, 6, 0, 0), {1024, 4096}});
+  checkpoint.write(filename);
+
+  const auto read = MetBuild::Checkpoint::read(filename);
+  REQUIRE(read.size() == 2);
+  REQUIRE_FALSE(read.has(0));
+  REQUIRE(read.has(1));
+  REQUIRE(read.domain(1).time.toSeconds() ==
+          MetBuild::Date(2022, 1, 2, 6, 0, 0).toSeconds());
+  REQUIRE(read.domain(1).offsets == std::vector<uint64_t>{1024, 4096});
+  std::remove(filename.c_str());
+}
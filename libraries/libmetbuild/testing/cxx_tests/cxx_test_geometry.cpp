@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "Geometry.h"
+#include "Grid.h"
+#include "catch.hpp"
+
+TEST_CASE("Rectangle inclusion", "[geometry]") {
+  const MetBuild::Geometry g(std::array<MetBuild::Point, 4>{
+      MetBuild::Point(0.0, 0.0), MetBuild::Point(2.0, 0.0),
+      MetBuild::Point(2.0, 1.0), MetBuild::Point(0.0, 1.0)});
+  REQUIRE(g.is_parallelogram());
+  REQUIRE(g.is_inside({1.0, 0.5}));
+  REQUIRE(g.is_inside({2.0, 1.0}));
+  REQUIRE(g.is_inside({0.0, 0.5}));
+  REQUIRE_FALSE(g.is_inside({2.1, 0.5}));
+  REQUIRE_FALSE(g.is_inside({1.0, -0.1}));
+}
+
+TEST_CASE("Rotated rectangle inclusion", "[geometry]") {
+  const double c = std::cos(M_PI / 6.0);
+  const double s = std::sin(M_PI / 6.0);
+  const MetBuild::Geometry g(std::array<MetBuild::Point, 4>{
+      MetBuild::Point(0.0, 0.0), MetBuild::Point(2.0 * c, 2.0 * s),
+      MetBuild::Point(2.0 * c - s, 2.0 * s + c), MetBuild::Point(-s, c)});
+  REQUIRE(g.is_parallelogram());
+  REQUIRE(g.is_inside({0.5 * c - 0.5 * s, 0.5 * s + 0.5 * c}));
+  REQUIRE(g.is_inside({-s, c}));
+  REQUIRE_FALSE(g.is_inside({1.0, 0.0}));
+  REQUIRE_FALSE(g.is_inside({-s, 0.0}));
+}
+
+TEST_CASE("Grid inclusion", "[geometry]") {
+  const auto wg = MetBuild::Grid(-98.0, 10.0, -60.0, 40.0, 0.25, 0.25);
+  REQUIRE(wg.point_inside(wg.center(50, 25)));
+  REQUIRE(wg.point_inside(wg.corner(0, 0)));
+  REQUIRE_FALSE(wg.point_inside({-98.5, 20.0}));
+  REQUIRE_FALSE(wg.point_inside({-80.0, 40.5}));
+}
+
+TEST_CASE("Polygon inclusion", "[geometry]") {
+  //...Star with alternating inner and outer vertices
+  std::vector<MetBuild::Point> star;
+  for (int k = 0; k < 200; ++k) {
+    const double a = 2.0 * M_PI * k / 200.0;
+    const double r = k % 2 ? 1.0 : 2.0;
+    star.emplace_back(r * std::cos(a), r * std::sin(a));
+  }
+  const MetBuild::Geometry g(star);
+  REQUIRE_FALSE(g.is_parallelogram());
+  REQUIRE(g.is_inside({0.0, 0.0}));
+  REQUIRE(g.is_inside({0.9, 0.0}));
+  REQUIRE(g.is_inside(star[0]));
+  REQUIRE(g.is_inside(star[37]));
+  REQUIRE_FALSE(g.is_inside({2.1, 0.0}));
+  REQUIRE_FALSE(g.is_inside({0.0, 2.5}));
+
+  //...Between two spikes, outside the inner radius
+  const double a = 2.0 * M_PI * 1.0 / 200.0;
+  REQUIRE_FALSE(g.is_inside({1.5 * std::cos(a), 1.5 * std::sin(a)}));
+}
@@ -26,8 +26,28 @@
 // Organization: The Water Institute
 //
 ////////////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BuildRequest.h"
+#include "Coupler.h"
+#include "GribIndex.h"
+#include "Instrumentation.h"
+#include "MappedFile.h"
 #include "MetBuild.h"
+#include "MetBuildCoupling.h"
+#include "Triangulation.h"
 #include "catch.hpp"
+#include "data_sources/FieldFile.h"
+#include "data_sources/GefsData.h"
+#include "data_sources/GfsData.h"
 
 TEST_CASE("Simple read", "[Simple read]") {
   double llx = -98.0;
@@ -61,3 +81,780 @@ TEST_CASE("Simple read", "[Simple read]") {
 
   //REQUIRE(0 == 0);
 }
+
+TEST_CASE("Bundled read", "[Bundled read]") {
+  auto wg = MetBuild::Grid(-98.0, 10.0, -60.0, 40.0, 0.25, 0.25);
+  const std::string f0 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f000";
+  const std::string f1 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f001";
+
+  auto bundle = MetBuild::Meteorology(
+      &wg, MetBuild::Meteorology::GFS,
+      std::vector<MetBuild::GriddedDataTypes::TYPE>{
+          MetBuild::GriddedDataTypes::WIND_PRESSURE,
+          MetBuild::GriddedDataTypes::TEMPERATURE});
+  auto wind = MetBuild::Meteorology(&wg, MetBuild::Meteorology::GFS,
+                                    MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  auto temperature = MetBuild::Meteorology(
+      &wg, MetBuild::Meteorology::GFS, MetBuild::GriddedDataTypes::TEMPERATURE);
+
+  REQUIRE(bundle.type() == MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  REQUIRE(bundle.has_type(MetBuild::GriddedDataTypes::TEMPERATURE));
+  REQUIRE_FALSE(bundle.has_type(MetBuild::GriddedDataTypes::RAINFALL));
+
+  for (auto *m : {&bundle, &wind, &temperature}) {
+    m->set_next_file(f0);
+    m->set_next_file(f1);
+    m->process_data();
+  }
+
+  const double weight = 0.5;
+  const auto w_bundle = bundle.to_wind_grid(weight);
+  const auto w_single = wind.to_wind_grid(weight);
+  auto t_bundle = MetBuild::MeteorologicalData<1>();
+  bundle.to_grid(MetBuild::GriddedDataTypes::TEMPERATURE, t_bundle, weight);
+  const auto t_single = temperature.to_grid(weight);
+
+  for (size_t p = 0; p < 3; ++p) {
+    REQUIRE(w_bundle.toVector(p) == w_single.toVector(p));
+  }
+  REQUIRE(t_bundle.toVector(0) == t_single.toVector(0));
+  REQUIRE_THROWS(
+      bundle.to_grid(MetBuild::GriddedDataTypes::RAINFALL, t_bundle, weight));
+}
+
+TEST_CASE("In-memory read", "[In-memory read]") {
+  auto wg = MetBuild::Grid(-98.0, 10.0, -60.0, 40.0, 0.25, 0.25);
+  const std::string f0 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f000";
+  const std::string f1 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f001";
+
+  auto read = [](const std::string &filename) {
+    std::ifstream f(filename, std::ios::binary);
+    return std::vector<unsigned char>(std::istreambuf_iterator<char>(f),
+                                      std::istreambuf_iterator<char>());
+  };
+
+  //...The second file is registered in two parts to check that separately
+  // downloaded pieces are joined in order
+  auto b1 = read(f1);
+  const auto half = b1.begin() + static_cast<long>(b1.size() / 2);
+  MetBuild::MappedFile::add_buffer("memory/f000", read(f0));
+  MetBuild::MappedFile::add_buffer(
+      "memory/f001", std::vector<std::vector<unsigned char>>{
+                         {b1.begin(), half}, {half, b1.end()}});
+
+  auto disk = MetBuild::Meteorology(&wg, MetBuild::Meteorology::GFS,
+                                    MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  auto memory = MetBuild::Meteorology(&wg, MetBuild::Meteorology::GFS,
+                                      MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  disk.set_next_file(f0);
+  disk.set_next_file(f1);
+  disk.process_data();
+  memory.set_next_file("memory/f000");
+  memory.set_next_file("memory/f001");
+  memory.process_data();
+
+  const auto w_disk = disk.to_wind_grid(0.5);
+  const auto w_memory = memory.to_wind_grid(0.5);
+  for (size_t p = 0; p < 3; ++p) {
+    REQUIRE(w_disk.toVector(p) == w_memory.toVector(p));
+  }
+
+  MetBuild::MappedFile::remove_buffer("memory/f000");
+  MetBuild::MappedFile::remove_buffer("memory/f001");
+  REQUIRE(MetBuild::MappedFile::buffer("memory/f000") == nullptr);
+}
+
+TEST_CASE("Pending in-memory read", "[Pending in-memory read]") {
+  auto wg = MetBuild::Grid(-98.0, 10.0, -60.0, 40.0, 0.25, 0.25);
+  const std::string f0 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f000";
+  const std::string f1 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f001";
+
+  auto read = [](const std::string &filename) {
+    std::ifstream f(filename, std::ios::binary);
+    return std::vector<unsigned char>(std::istreambuf_iterator<char>(f),
+                                      std::istreambuf_iterator<char>());
+  };
+
+  //...The second file arrives after the reader has started, which has to
+  // wait for it instead of looking for it on disk
+  MetBuild::MappedFile::add_buffer("pending/f000", read(f0));
+  MetBuild::MappedFile::expect_buffer("pending/f001");
+  std::thread arrival([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    MetBuild::MappedFile::add_buffer("pending/f001", read(f1));
+  });
+
+  auto disk = MetBuild::Meteorology(&wg, MetBuild::Meteorology::GFS,
+                                    MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  auto memory = MetBuild::Meteorology(&wg, MetBuild::Meteorology::GFS,
+                                      MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  disk.set_next_file(f0);
+  disk.set_next_file(f1);
+  disk.process_data();
+  memory.set_next_file("pending/f000");
+  memory.set_next_file("pending/f001");
+  memory.process_data();
+  arrival.join();
+
+  const auto w_disk = disk.to_wind_grid(0.5);
+  const auto w_memory = memory.to_wind_grid(0.5);
+  for (size_t p = 0; p < 3; ++p) {
+    REQUIRE(w_disk.toVector(p) == w_memory.toVector(p));
+  }
+
+  //...A download that failed is reported to the reader
+  MetBuild::MappedFile::expect_buffer("pending/f002");
+  MetBuild::MappedFile::fail_buffer("pending/f002", "not found");
+  REQUIRE_THROWS(MetBuild::MappedFile::buffer("pending/f002"));
+
+  MetBuild::MappedFile::remove_buffer("pending/f000");
+  MetBuild::MappedFile::remove_buffer("pending/f001");
+  MetBuild::MappedFile::remove_buffer("pending/f002");
+  REQUIRE(MetBuild::MappedFile::buffer("pending/f002") == nullptr);
+}
+
+TEST_CASE("Field file read", "[Field file read]") {
+  auto wg = MetBuild::Grid(-98.0, 10.0, -60.0, 40.0, 0.25, 0.25);
+  const std::vector<std::string> gribs = {
+      "../testing/test_files/gfs.t00z.pgrb2.0p25.f000",
+      "../testing/test_files/gfs.t00z.pgrb2.0p25.f001"};
+
+  auto grib = MetBuild::Meteorology(&wg, MetBuild::Meteorology::GFS,
+                                    MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  for (const auto &f : gribs) grib.set_next_file(f);
+  grib.process_data();
+  const auto w_grib = grib.to_wind_grid(0.5);
+
+  //...The first file is stored compressed and the second read from a mapping
+  const std::vector<std::string> fields = {"gfs_f000.mbf", "gfs_f001.mbf"};
+  for (size_t i = 0; i < gribs.size(); ++i) {
+    MetBuild::Meteorology::write_field_file(
+        gribs[i], MetBuild::Meteorology::GFS, fields[i], i == 0);
+  }
+
+  auto field = MetBuild::Meteorology(&wg, MetBuild::Meteorology::GFS,
+                                     MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  for (const auto &f : fields) field.set_next_file(f);
+  field.process_data();
+  const auto w_field = field.to_wind_grid(0.5);
+
+  //...Fields are stored in single precision
+  for (size_t p = 0; p < 3; ++p) {
+    const auto a = w_grib.toVector(p);
+    const auto b = w_field.toVector(p);
+    REQUIRE(a.size() == b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+      REQUIRE(b[i] == Approx(a[i]).epsilon(1e-5).margin(1e-4));
+    }
+  }
+
+  for (const auto &f : fields) std::remove(f.c_str());
+}
+
+TEST_CASE("Cropped field file", "[Cropped field file]") {
+  auto wg = MetBuild::Grid(-98.0, 10.0, -60.0, 40.0, 0.25, 0.25);
+  const std::vector<std::string> gribs = {
+      "../testing/test_files/gfs.t00z.pgrb2.0p25.f000",
+      "../testing/test_files/gfs.t00z.pgrb2.0p25.f001"};
+
+  auto grib = MetBuild::Meteorology(&wg, MetBuild::Meteorology::GFS,
+                                    MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  for (const auto &f : gribs) grib.set_next_file(f);
+  grib.process_data();
+  const auto w_grib = grib.to_wind_grid(0.5);
+
+  const std::vector<std::string> fields = {"gfs_crop_f000.mbf",
+                                           "gfs_crop_f001.mbf"};
+  for (size_t i = 0; i < gribs.size(); ++i) {
+    MetBuild::Meteorology::write_field_file(gribs[i],
+                                            MetBuild::Meteorology::GFS,
+                                            fields[i], false,
+                                            {-100.0, 5.0, -55.0, 45.0});
+  }
+
+  const auto gfs = MetBuild::GfsData(gribs[0]);
+  const auto cropped = MetBuild::FieldFile(fields[0]);
+  REQUIRE(cropped.size() < gfs.size() / 10);
+  REQUIRE(cropped.size() == cropped.ni() * cropped.nj());
+  REQUIRE(cropped.fingerprint() != gfs.fingerprint());
+
+  auto field = MetBuild::Meteorology(&wg, MetBuild::Meteorology::GFS,
+                                     MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  for (const auto &f : fields) field.set_next_file(f);
+  field.process_data();
+  const auto w_field = field.to_wind_grid(0.5);
+
+  for (size_t p = 0; p < 3; ++p) {
+    const auto a = w_grib.toVector(p);
+    const auto b = w_field.toVector(p);
+    REQUIRE(a.size() == b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+      REQUIRE(b[i] == Approx(a[i]).epsilon(1e-5).margin(1e-4));
+    }
+  }
+
+  REQUIRE_THROWS(MetBuild::Meteorology::write_field_file(
+      gribs[0], MetBuild::Meteorology::GFS, fields[0], false, {0.0, 1.0}));
+
+  for (const auto &f : fields) std::remove(f.c_str());
+}
+
+TEST_CASE("Stage instrumentation", "[Stage instrumentation]") {
+  using Instrumentation = MetBuild::Instrumentation;
+  auto wg = MetBuild::Grid(-98.0, 10.0, -60.0, 40.0, 0.25, 0.25);
+  const auto before = Instrumentation::report();
+
+  auto m = MetBuild::Meteorology(&wg, MetBuild::Meteorology::GFS,
+                                 MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  m.set_next_file("../testing/test_files/gfs.t00z.pgrb2.0p25.f000");
+  m.set_next_file("../testing/test_files/gfs.t00z.pgrb2.0p25.f001");
+  m.process_data();
+  const auto w = m.to_wind_grid(0.5);
+
+  const auto r = Instrumentation::report().since(before);
+  REQUIRE(Instrumentation::names().size() == Instrumentation::N_STAGES);
+  REQUIRE(r.calls(Instrumentation::DECODE) > 0);
+  REQUIRE(r.calls(Instrumentation::INTERPOLATE) == 1);
+  REQUIRE(r.items(Instrumentation::INTERPOLATE) == 3 * wg.ni() * wg.nj());
+  REQUIRE(r.seconds(Instrumentation::DECODE) > 0.0);
+  REQUIRE(r.calls(Instrumentation::NETCDF_WRITE) == 0);
+  REQUIRE_THROWS(r.calls(Instrumentation::N_STAGES));
+}
+
+TEST_CASE("Stage trace", "[Stage trace]") {
+  using Instrumentation = MetBuild::Instrumentation;
+  auto wg = MetBuild::Grid(-98.0, 10.0, -60.0, 40.0, 0.25, 0.25);
+  const std::string trace_file = "gfs_stage_trace.json";
+
+  Instrumentation::start_trace();
+  REQUIRE(Instrumentation::tracing());
+  auto m = MetBuild::Meteorology(&wg, MetBuild::Meteorology::GFS,
+                                 MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  m.set_next_file("../testing/test_files/gfs.t00z.pgrb2.0p25.f000");
+  m.set_next_file("../testing/test_files/gfs.t00z.pgrb2.0p25.f001");
+  m.process_data();
+  const auto w = m.to_wind_grid(0.5);
+  Instrumentation::stop_trace();
+  REQUIRE_FALSE(Instrumentation::tracing());
+  Instrumentation::write_trace(trace_file);
+
+  std::ifstream f(trace_file);
+  const std::string trace((std::istreambuf_iterator<char>(f)),
+                          std::istreambuf_iterator<char>());
+  REQUIRE(trace.find("\"traceEvents\"") != std::string::npos);
+  REQUIRE(trace.find("\"name\": \"decode\"") != std::string::npos);
+  REQUIRE(trace.find("\"name\": \"interpolate\"") != std::string::npos);
+  f.close();
+  std::remove(trace_file.c_str());
+}
+
+TEST_CASE("Probe", "[Probe]") {
+  const std::string f0 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f000";
+  const auto probe =
+      MetBuild::Meteorology::probe(f0, MetBuild::Meteorology::GFS);
+
+  auto gfs = MetBuild::GfsData(f0);
+  REQUIRE(probe.ni == gfs.ni());
+  REQUIRE(probe.nj == gfs.nj());
+  REQUIRE(probe.size == gfs.size());
+  REQUIRE(probe.gridType == gfs.gridType());
+  REQUIRE(probe.precipitationStepLength == gfs.precipitationStepLength());
+  REQUIRE(probe.contains(MetBuild::GriddedDataTypes::VAR_PRESSURE));
+  REQUIRE(probe.contains(MetBuild::GriddedDataTypes::VAR_U10));
+  REQUIRE(probe.contains(MetBuild::GriddedDataTypes::VAR_V10));
+  REQUIRE(std::find(probe.fields.begin(), probe.fields.end(), "prmsl") !=
+          probe.fields.end());
+  REQUIRE(probe.dx > 0.0);
+}
+
+TEST_CASE("Generated coordinates", "[Generated coordinates]") {
+  const std::string f0 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f000";
+
+  MetBuild::Grib::setGenerateCoordinates(false);
+  const auto decoded = MetBuild::GfsData(f0);
+  MetBuild::Grib::setGenerateCoordinates(true);
+  const auto generated = MetBuild::GfsData(f0);
+  REQUIRE(generated.fingerprint() == decoded.fingerprint());
+
+  const auto &x0 = decoded.longitude1d();
+  const auto &y0 = decoded.latitude1d();
+  const auto &x1 = generated.longitude1d();
+  const auto &y1 = generated.latitude1d();
+  REQUIRE(x0.size() == x1.size());
+  REQUIRE(y0.size() == y1.size());
+  for (size_t i = 0; i < x0.size(); ++i) {
+    REQUIRE(x1[i] == Approx(x0[i]).margin(1e-9));
+    REQUIRE(y1[i] == Approx(y0[i]).margin(1e-9));
+  }
+}
+
+TEST_CASE("Grib messages", "[Grib messages]") {
+  using namespace MetBuild::GriddedDataTypes;
+  const auto wind = MetBuild::Meteorology::grib_messages(
+      MetBuild::Meteorology::GFS, WIND_PRESSURE);
+  REQUIRE(wind.size() == 3);
+  REQUIRE(wind[0].parameter == "PRMSL");
+  REQUIRE(wind[1].level == "10 m above ground");
+
+  const auto names = MetBuild::GfsData::sourceVariables();
+  for (const auto type : {WIND_PRESSURE, RAINFALL, HUMIDITY, TEMPERATURE,
+                          ICE}) {
+    for (const auto &m : MetBuild::Meteorology::grib_messages(
+             MetBuild::Meteorology::GFS, type)) {
+      REQUIRE(m.shortName == names.find_variable(m.variable));
+    }
+  }
+  REQUIRE(MetBuild::Meteorology::grib_messages(MetBuild::Meteorology::GFS,
+                                               RAINFALL)[0]
+              .stepType == "avg");
+
+  REQUIRE(MetBuild::Meteorology::grib_messages(MetBuild::Meteorology::GEFS,
+                                               RAINFALL)
+              .empty());
+
+  //...Variable names are generated from the traits of each source
+  static_assert(MetBuild::SourceTraits::same_name(
+      MetBuild::SourceTraits::short_name<MetBuild::GfsTraits>(VAR_RAINFALL),
+      "prate"));
+  const auto gefs = MetBuild::GefsData::sourceVariables();
+  REQUIRE(gefs.pressure() == "prmsl");
+  REQUIRE(gefs.humidity() == "r2");
+  REQUIRE(gefs.precipitation().empty());
+  REQUIRE(gefs.ice().empty());
+  REQUIRE_THROWS(MetBuild::Meteorology::grib_messages(
+      MetBuild::Meteorology::COAMPS, WIND_PRESSURE));
+}
+
+TEST_CASE("Step reference", "[Step reference]") {
+  const std::string f0 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f001";
+  const auto reference = MetBuild::GribIndex::stepReference(f0, 60);
+  REQUIRE(reference == f0 + "#60");
+  REQUIRE(MetBuild::GribIndex::splitReference(reference).first == f0);
+  REQUIRE(MetBuild::GribIndex::splitReference(reference).second == 60);
+  REQUIRE(MetBuild::GribIndex::splitReference(f0).second == -1);
+
+  const auto probe =
+      MetBuild::Meteorology::probe(f0, MetBuild::Meteorology::GFS);
+  REQUIRE(probe.steps.size() == 1);
+  REQUIRE(probe.steps.front() == 60);
+
+  auto whole = MetBuild::GfsData(f0);
+  auto step = MetBuild::GfsData(reference);
+  REQUIRE(step.size() == whole.size());
+  REQUIRE(step.gridType() == whole.gridType());
+}
+
+TEST_CASE("Grib index file", "[Grib index file]") {
+  const std::string f0 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f000";
+  const std::string copy = "gfs_index_test.grb2";
+  const auto index_file = MetBuild::GribIndex::indexFilename(copy);
+  {
+    std::ifstream in(f0, std::ios::binary);
+    std::ofstream out(copy, std::ios::binary);
+    out << in.rdbuf();
+  }
+  std::remove(index_file.c_str());
+
+  const auto scanned = MetBuild::GribIndex(copy);
+  scanned.write(index_file);
+
+  auto same = [](const MetBuild::GribIndex &a, const MetBuild::GribIndex &b) {
+    if (a.entries().size() != b.entries().size()) return false;
+    for (size_t k = 0; k < a.entries().size(); ++k) {
+      const auto &ea = a.entries()[k];
+      const auto &eb = b.entries()[k];
+      if (ea.shortName != eb.shortName || ea.typeOfLevel != eb.typeOfLevel ||
+          ea.level != eb.level || ea.stepRange != eb.stepRange ||
+          ea.step != eb.step || ea.offset != eb.offset ||
+          ea.length != eb.length || ea.field != eb.field) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  const auto loaded = MetBuild::GribIndex(copy);
+  REQUIRE(!loaded.entries().empty());
+  REQUIRE(same(scanned, loaded));
+
+  //...An index file which no longer matches the grib file is ignored
+  {
+    std::ofstream out(copy, std::ios::binary | std::ios::app);
+    out << "7777";
+  }
+  MetBuild::MappedFile::release(copy);
+  const auto rescanned = MetBuild::GribIndex(copy);
+  REQUIRE(same(scanned, rescanned));
+
+  MetBuild::MappedFile::release(copy);
+  std::remove(copy.c_str());
+  std::remove(index_file.c_str());
+}
+
+TEST_CASE("Reference locators", "[Reference locators]") {
+  const std::string f0 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f000";
+  const std::string f1 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f001";
+  auto wg = MetBuild::Grid(-90.0, 20.0, -80.0, 30.0, 0.1, 0.1);
+
+  auto interpolate = [&]() {
+    auto m = MetBuild::Meteorology(&wg, MetBuild::Meteorology::GFS,
+                                   MetBuild::GriddedDataTypes::WIND_PRESSURE);
+    m.set_next_file(f0);
+    m.set_next_file(f1);
+    m.process_data();
+    return m.to_wind_grid(0.5);
+  };
+
+  const bool fast = MetBuild::Triangulation::useFastLocators();
+  MetBuild::Triangulation::setUseFastLocators(true);
+  const auto optimized = interpolate();
+  MetBuild::Triangulation::setUseFastLocators(false);
+  const auto reference = interpolate();
+  MetBuild::Triangulation::setUseFastLocators(fast);
+
+  //...Both paths interpolate linearly within a source cell and may only
+  // differ by the diagonal used to split it
+  const auto flag = decltype(optimized)::flag_value();
+  for (size_t k = 0; k < 3; ++k) {
+    const auto a = optimized.parameter(k);
+    const auto b = reference.parameter(k);
+    REQUIRE(a.size() == b.size());
+    double sum = 0.0;
+    for (size_t i = 0; i < a.size(); ++i) {
+      REQUIRE((a[i] == flag) == (b[i] == flag));
+      sum += (a[i] - b[i]) * (a[i] - b[i]);
+    }
+    REQUIRE(std::sqrt(sum / a.size()) < 0.25);
+  }
+}
+
+TEST_CASE("Batched steps", "[Batched steps]") {
+  auto wg = MetBuild::Grid(-90.0, 20.0, -80.0, 30.0, 0.1, 0.1);
+  auto m = MetBuild::Meteorology(&wg, MetBuild::Meteorology::GFS,
+                                 MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  m.set_next_file("../testing/test_files/gfs.t00z.pgrb2.0p25.f000");
+  m.set_next_file("../testing/test_files/gfs.t00z.pgrb2.0p25.f001");
+  m.process_data();
+
+  const std::vector<double> weights = {-1.0, 0.25, 0.5, 1.0};
+  std::vector<MetBuild::MeteorologicalData<3>> batched(weights.size());
+  std::vector<MetBuild::MeteorologicalData<3> *> w;
+  for (auto &b : batched) w.push_back(&b);
+  m.to_wind_grids(weights, w);
+
+  //...The batch rounds the gathered values to the output precision before
+  // blending them, so it may differ from single steps in the last digit
+  for (size_t s = 0; s < weights.size(); ++s) {
+    const auto single = m.to_wind_grid(weights[s]);
+    for (size_t k = 0; k < 3; ++k) {
+      const auto a = single.parameter(k);
+      const auto b = batched[s].parameter(k);
+      REQUIRE(a.size() == b.size());
+      double error = 0.0;
+      for (size_t i = 0; i < a.size(); ++i) {
+        error = std::max<double>(error, std::abs(a[i] - b[i]));
+      }
+      REQUIRE(error < 1e-3);
+    }
+  }
+}
+
+TEST_CASE("Cancel token", "[Cancel token]") {
+  auto wg = MetBuild::Grid(-90.0, 20.0, -80.0, 30.0, 0.1, 0.1);
+  auto m = MetBuild::Meteorology(&wg, MetBuild::Meteorology::GFS,
+                                 MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  MetBuild::CancelToken token;
+  m.set_cancel_token(&token);
+  m.set_next_file("../testing/test_files/gfs.t00z.pgrb2.0p25.f000");
+  m.set_next_file("../testing/test_files/gfs.t00z.pgrb2.0p25.f001");
+
+  //...Weights are built again after a cancelled build
+  token.cancel();
+  REQUIRE_THROWS_AS(m.process_data(), MetBuild::Cancelled);
+  token.reset();
+  m.process_data();
+  const auto expected = m.to_wind_grid(0.5);
+
+  token.cancel();
+  REQUIRE_THROWS_AS(m.to_wind_grid(0.5), MetBuild::Cancelled);
+  token.reset();
+  const auto result = m.to_wind_grid(0.5);
+  for (size_t k = 0; k < 3; ++k) {
+    const auto a = expected.parameter(k);
+    const auto b = result.parameter(k);
+    REQUIRE(std::equal(a.begin(), a.end(), b.begin()));
+  }
+}
+
+TEST_CASE("Asynchronous request", "[Asynchronous request]") {
+  auto wg = MetBuild::Grid(-90.0, 20.0, -80.0, 30.0, 0.25, 0.25);
+  const auto start = MetBuild::Date(2020, 1, 1, 0, 0, 0);
+  const auto end = start + 3 * 3600;
+
+  for (const bool cancel : {false, true}) {
+    auto owi = MetBuild::OwiAscii(start, end, 900);
+    owi.addDomain(wg, {"async.221", "async.222"});
+    MetBuild::BuildRequest request(&owi, start, end, 900);
+    request.add_domain(0, &wg, MetBuild::Meteorology::GFS,
+                       MetBuild::GriddedDataTypes::WIND_PRESSURE);
+    for (int k = 0; k < 4; ++k) {
+      request.add_file(0,
+                       "../testing/test_files/gfs.t00z.pgrb2.0p25.f00" +
+                           std::to_string(k),
+                       start + k * 3600);
+    }
+    REQUIRE_THROWS(request.wait());
+
+    request.start();
+    REQUIRE_THROWS(request.start());
+    REQUIRE_THROWS(request.run());
+    if (cancel) {
+      request.cancel();
+      REQUIRE(request.cancelled());
+      REQUIRE_THROWS_AS(request.wait(), MetBuild::Cancelled);
+      REQUIRE(request.progress() < 1.0);
+    } else {
+      while (!request.done()) {
+        REQUIRE(request.progress() <= 1.0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      const auto files_used = request.wait();
+      REQUIRE(request.progress() == 1.0);
+      REQUIRE(files_used.size() == 1);
+      REQUIRE(files_used[0].size() == 4);
+    }
+  }
+  std::remove("async.221");
+  std::remove("async.222");
+}
+
+TEST_CASE("Point series", "[Point series]") {
+  const std::vector<MetBuild::Point> points = {{-89.5, 25.0}, {-85.25, 28.5}};
+  const auto start = MetBuild::Date(2020, 1, 1, 0, 0, 0);
+  const auto end = start + 3600;
+
+  MetBuild::PointSeries series(points, MetBuild::Meteorology::GFS,
+                               MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  REQUIRE_THROWS(series.extract(start, end, 900));
+  series.add_file("../testing/test_files/gfs.t00z.pgrb2.0p25.f000", start);
+  series.add_file("../testing/test_files/gfs.t00z.pgrb2.0p25.f001", end);
+  series.extract(start, end, 900);
+
+  REQUIRE(series.size() == 2);
+  REQUIRE(series.times().size() == 5);
+  REQUIRE(series.names().size() == 3);
+
+  const auto grid = MetBuild::Grid::from_points(points);
+  auto m = MetBuild::Meteorology(&grid, MetBuild::Meteorology::GFS,
+                                 MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  m.set_next_file("../testing/test_files/gfs.t00z.pgrb2.0p25.f000");
+  m.set_next_file("../testing/test_files/gfs.t00z.pgrb2.0p25.f001");
+  m.process_data();
+  const auto w = m.to_wind_grid(0.5);
+  for (size_t k = 0; k < 3; ++k) {
+    for (size_t p = 0; p < 2; ++p) {
+      REQUIRE(series.value(k, 2, p) == Approx(w.parameter(k)[p]));
+    }
+  }
+
+  const auto csv = series.to_csv();
+  REQUIRE(std::count(csv.begin(), csv.end(), '\n') == 11);
+  REQUIRE(csv.rfind("time,point,x,y,wind_u,wind_v,mslp\n", 0) == 0);
+  const auto json = series.to_json();
+  REQUIRE(json.find("\"2020-01-01T00:30:00Z\"") != std::string::npos);
+  REQUIRE(json.find("\"mslp\": [[") != std::string::npos);
+}
+
+TEST_CASE("Coupler", "[Coupler]") {
+  const std::vector<MetBuild::Point> points = {{-89.5, 25.0}, {-85.25, 28.5}};
+  const auto start = MetBuild::Date(2020, 1, 1, 0, 0, 0);
+  const auto end = start + 3600;
+  const std::string f0 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f000";
+  const std::string f1 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f001";
+
+  MetBuild::PointSeries series(points, MetBuild::Meteorology::GFS,
+                               MetBuild::GriddedDataTypes::WIND_PRESSURE);
+  series.add_file(f0, start);
+  series.add_file(f1, end);
+  series.extract(start, end, 900);
+
+  MetBuild::Coupler coupler(points, MetBuild::Meteorology::GFS,
+                            MetBuild::GriddedDataTypes::WIND_PRESSURE, 900);
+  REQUIRE_THROWS(coupler.update_until(0.0));
+  coupler.add_file(f0, start);
+  coupler.add_file(f1, end);
+  coupler.initialize(start, end);
+  REQUIRE(coupler.names() == series.names());
+
+  //...On a step and half way between two steps
+  std::vector<MetBuild::MeteorologicalDataType> values(2);
+  coupler.update_until(1800.0);
+  for (size_t k = 0; k < 3; ++k) {
+    coupler.get_value(k, values.data());
+    for (size_t p = 0; p < 2; ++p) {
+      REQUIRE(values[p] == Approx(series.value(k, 2, p)));
+    }
+  }
+  coupler.update_until(2250.0);
+  for (size_t k = 0; k < 3; ++k) {
+    coupler.get_value(k, values.data());
+    for (size_t p = 0; p < 2; ++p) {
+      REQUIRE(values[p] ==
+              Approx(0.5 * (series.value(k, 2, p) + series.value(k, 3, p))));
+    }
+  }
+  REQUIRE_THROWS(coupler.update_until(900.0));
+  REQUIRE_THROWS(coupler.update_until(3601.0));
+
+  //...The same fields through the C interface and a ring read by a second
+  // handle, as a model in another process would
+  const double x[] = {-89.5, -85.25};
+  const double y[] = {25.0, 28.5};
+  metbuild_coupler *c = nullptr;
+  REQUIRE(metbuild_coupler_create(x, y, 2, MetBuild::Meteorology::GFS,
+                                  MetBuild::GriddedDataTypes::WIND_PRESSURE,
+                                  900, 4326, &c) == METBUILD_SUCCESS);
+  REQUIRE(metbuild_coupler_add_file(c, f0.c_str(), start.toSeconds()) ==
+          METBUILD_SUCCESS);
+  REQUIRE(metbuild_coupler_add_file(c, f1.c_str(), end.toSeconds()) ==
+          METBUILD_SUCCESS);
+  REQUIRE(metbuild_coupler_initialize(c, start.toSeconds(),
+                                      end.toSeconds()) == METBUILD_SUCCESS);
+  double pressure[2];
+  REQUIRE(metbuild_coupler_get_value(c, "rain", pressure) ==
+          METBUILD_FAILURE);
+  REQUIRE(std::string(metbuild_last_error()).find("rain") !=
+          std::string::npos);
+  REQUIRE(metbuild_coupler_update_until(c, 1800.0) == METBUILD_SUCCESS);
+  REQUIRE(metbuild_coupler_get_value(c, "mslp", pressure) ==
+          METBUILD_SUCCESS);
+  REQUIRE(pressure[1] == Approx(series.value(2, 2, 1)));
+
+  const std::string ring_file = "coupler_test.ring";
+  REQUIRE(metbuild_coupler_publish(c, ring_file.c_str(), 8) ==
+          METBUILD_SUCCESS);
+  metbuild_ring *ring = nullptr;
+  REQUIRE(metbuild_ring_open(ring_file.c_str(), &ring) == METBUILD_SUCCESS);
+  REQUIRE(metbuild_ring_get_value(ring, "mslp", 2250.0, pressure, 0.0) ==
+          METBUILD_SUCCESS);
+  REQUIRE(pressure[1] ==
+          Approx(0.5 * (series.value(2, 2, 1) + series.value(2, 3, 1))));
+  REQUIRE(metbuild_ring_get_value(ring, "mslp", 3700.0, pressure, 0.0) ==
+          METBUILD_FAILURE);
+  REQUIRE(metbuild_ring_close(ring) == METBUILD_SUCCESS);
+  REQUIRE(metbuild_coupler_finalize(c) == METBUILD_SUCCESS);
+  REQUIRE_FALSE(std::ifstream(ring_file).good());
+}
+
+TEST_CASE("Source decimation", "[Source decimation]") {
+  using MetBuild::GriddedDataTypes::VAR_PRESSURE;
+  const std::string f0 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f000";
+
+  auto full = MetBuild::GfsData(f0);
+  auto fine = MetBuild::GfsData(f0);
+  auto coarse = MetBuild::GfsData(f0);
+  fine.setOutputSpacing(1.0);
+  REQUIRE(fine.decimation() == 1);
+
+  MetBuild::Grib::setSourceDecimation(true);
+  fine.setOutputSpacing(0.3);
+  coarse.setOutputSpacing(1.0);
+  MetBuild::Grib::setSourceDecimation(false);
+  REQUIRE(fine.decimation() == 1);
+  REQUIRE(coarse.decimation() == 4);
+  REQUIRE(coarse.ni() == 361);
+  REQUIRE(coarse.nj() == 181);
+  REQUIRE(coarse.size() == 361 * 181);
+  REQUIRE(coarse.fingerprint() != full.fingerprint());
+
+  const size_t ni = full.ni();
+  const size_t nj = full.nj();
+  const auto values = full.getVariable1d(VAR_PRESSURE);
+  const auto averaged = coarse.getVariable1d(VAR_PRESSURE);
+  REQUIRE(averaged.size() == coarse.size());
+
+  //...Each point holds the mean over a box of 4 cells around it, wrapping
+  // the rows and cut at the poles
+  const std::vector<double> w = {0.5, 1.0, 1.0, 1.0, 0.5};
+  for (const auto &ij : std::vector<std::pair<long, long>>{
+           {0, 0}, {0, 90}, {359, 45}, {123, 180}, {200, 77}}) {
+    const size_t k = ij.second * 361 + ij.first;
+    REQUIRE(coarse.longitude1d()[k] ==
+            full.longitude1d()[ij.second * 4 * ni + ij.first * 4]);
+    REQUIRE(coarse.latitude1d()[k] ==
+            full.latitude1d()[ij.second * 4 * ni + ij.first * 4]);
+
+    double sum = 0.0;
+    double weight = 0.0;
+    for (long dj = -2; dj <= 2; ++dj) {
+      const long j = ij.second * 4 + dj;
+      if (j < 0 || j >= static_cast<long>(nj)) continue;
+      for (long di = -2; di <= 2; ++di) {
+        const long i = (ij.first * 4 + di + ni) % ni;
+        sum += w[dj + 2] * w[di + 2] * values[j * ni + i];
+        weight += w[dj + 2] * w[di + 2];
+      }
+    }
+    REQUIRE(averaged[k] == Approx(sum / weight).epsilon(1e-5));
+  }
+
+  //...The last column repeats the one at -180 on the other side of the
+  // dateline, and the outline reaches it
+  for (size_t j = 0; j < coarse.nj(); j += 45) {
+    const size_t first = j * 361 + 180;
+    const size_t last = j * 361 + 360;
+    REQUIRE(coarse.longitude1d()[first] == -180.0);
+    REQUIRE(coarse.longitude1d()[last] == 180.0);
+    REQUIRE(coarse.latitude1d()[last] == coarse.latitude1d()[first]);
+    REQUIRE(averaged[last] == averaged[first]);
+  }
+  REQUIRE(coarse.point_inside(MetBuild::Point(179.5, 10.0)));
+}
+
+TEST_CASE("Source decimation across the dateline",
+          "[Source decimation across the dateline]") {
+  using MetBuild::GriddedDataTypes::VAR_PRESSURE;
+  const std::string f0 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f000";
+  const std::string f1 = "../testing/test_files/gfs.t00z.pgrb2.0p25.f001";
+
+  //...Points half way between the last kept column and the dateline are
+  // interpolated from both sides of it rather than left at the fill value
+  auto wg = MetBuild::Grid(178.75, 0.0, 179.75, 0.5, 0.5, 0.5);
+  MetBuild::Grib::setSourceDecimation(true);
+  auto coarse = MetBuild::GfsData(f0);
+  coarse.setOutputSpacing(0.5);
+  auto m = MetBuild::Meteorology(&wg, MetBuild::Meteorology::GFS,
+                                 MetBuild::GriddedDataTypes::WIND_PRESSURE,
+                                 true);
+  m.set_next_file(f0);
+  m.set_next_file(f1);
+  m.process_data();
+  const auto v = m.to_wind_grid(0.0);
+  MetBuild::Grib::setSourceDecimation(false);
+  REQUIRE(coarse.decimation() == 2);
+
+  const auto &x = coarse.longitude1d();
+  const auto &y = coarse.latitude1d();
+  const auto p = coarse.getVariable1d(VAR_PRESSURE);
+  auto find = [&](const double lon, const double lat) {
+    for (size_t k = 0; k < x.size(); ++k) {
+      if (std::fabs(x[k] - lon) < 1e-6 && std::fabs(y[k] - lat) < 1e-6) {
+        return p[k];
+      }
+    }
+    FAIL("point not on the decimated grid");
+    return p[0];
+  };
+
+  REQUIRE(v.ni() == wg.ni());
+  REQUIRE(v.nj() == wg.nj());
+  for (size_t j = 0; j < wg.nj(); ++j) {
+    for (size_t i = 0; i < wg.ni(); ++i) {
+      const auto pt = wg.position(i, j);
+      const double expected =
+          0.5 * (find(pt.x() - 0.25, pt.y()) + find(pt.x() + 0.25, pt.y()));
+      REQUIRE(v.get(2, i, j) != MetBuild::MeteorologicalData<1>::flag_value());
+      REQUIRE(v.get(2, i, j) == Approx(expected).epsilon(1e-4));
+    }
+  }
+}
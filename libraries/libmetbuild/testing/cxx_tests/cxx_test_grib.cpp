@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Date.h"
+#include "GribUnpacker.h"
+#include "Grid.h"
+#include "MeteorologicalData.h"
+#include "catch.hpp"
+#include "eccodes.h"
+#include "output/GribOutput.h"
+#include "test_utilities.h"
+
+using MetBuild::Testing::sample;
+
+namespace {
+long get_long(codes_handle *h, const char *key) {
+  long value = 0;
+  REQUIRE(codes_get_long(h, key, &value) == GRIB_SUCCESS);
+  return value;
+}
+}  // namespace
+
+TEST_CASE("GRIB2 output round trip", "[grib]") {
+  const auto grid = MetBuild::Grid(-100.0, 20.0, -90.0, 30.0, 0.5, 0.5);
+  const MetBuild::Date start(2023, 6, 1, 0, 0, 0);
+  const MetBuild::Date end(2023, 6, 1, 1, 0, 0);
+  const std::string filename = "grib_test.grib2";
+  constexpr auto flag = MetBuild::MeteorologicalData<1>::flag_value();
+
+  MetBuild::MeteorologicalData<3> data(grid.ni(), grid.nj());
+  {
+    MetBuild::GribOutput output(start, end, 1800);
+    output.set_packing(MetBuild::GribOutput::SIMPLE);
+    output.set_precision(24);
+    output.addDomain(grid, {filename});
+    for (int snap = 0; snap < 3; ++snap) {
+      for (size_t j = 0; j < grid.nj(); ++j) {
+        for (size_t i = 0; i < grid.ni(); ++i) {
+          for (size_t k = 0; k < 3; ++k) {
+            data.set(k, i, j, sample(snap, k, j, i));
+          }
+        }
+      }
+      data.set(2, 3, 4, flag);
+      output.write(start + snap * 1800, 0, data);
+    }
+  }
+
+  FILE *f = std::fopen(filename.c_str(), "rb");
+  REQUIRE(f != nullptr);
+  const long numbers[] = {2, 3, 1};
+  std::vector<double> values(grid.ni() * grid.nj());
+  for (int snap = 0; snap < 3; ++snap) {
+    for (size_t k = 0; k < 3; ++k) {
+      int err = 0;
+      codes_handle *h = codes_handle_new_from_file(nullptr, f, PRODUCT_GRIB,
+                                                   &err);
+      REQUIRE(h != nullptr);
+      REQUIRE(get_long(h, "parameterNumber") == numbers[k]);
+      REQUIRE(get_long(h, "Ni") == static_cast<long>(grid.ni()));
+      REQUIRE(get_long(h, "Nj") == static_cast<long>(grid.nj()));
+      REQUIRE(get_long(h, "forecastTime") == snap * 30);
+
+      size_t size = values.size();
+      REQUIRE(codes_get_double_array(h, "values", values.data(), &size) ==
+              GRIB_SUCCESS);
+      REQUIRE(size == values.size());
+      double missing = 0;
+      REQUIRE(codes_get_double(h, "missingValue", &missing) == GRIB_SUCCESS);
+      const double scale = k == 2 ? 100.0 : 1.0;
+      for (size_t j = 0; j < grid.nj(); ++j) {
+        for (size_t i = 0; i < grid.ni(); ++i) {
+          const double v = values[j * grid.ni() + i];
+          if (k == 2 && i == 3 && j == 4) {
+            REQUIRE(v == missing);
+          } else {
+            REQUIRE(v == Approx(scale * sample(snap, k, j, i)).margin(0.01));
+          }
+        }
+      }
+      codes_handle_delete(h);
+    }
+  }
+  std::fclose(f);
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("Native grib unpacking", "[grib]") {
+  const auto unpack = [](const std::string &packing, bool bitmap) {
+    codes_handle *h = codes_grib_handle_new_from_samples(nullptr, "GRIB2");
+    REQUIRE(h != nullptr);
+    long n = get_long(h, "numberOfValues");
+    std::vector<double> values(n);
+    for (long k = 0; k < n; ++k) {
+      values[k] = 101325.0 + 250.0 * std::sin(0.05 * static_cast<double>(k));
+    }
+    if (bitmap) {
+      REQUIRE(codes_set_double(h, "missingValue", 9999.0) == GRIB_SUCCESS);
+      REQUIRE(codes_set_long(h, "bitmapPresent", 1) == GRIB_SUCCESS);
+      values[n / 2] = 9999.0;
+    }
+    size_t length = packing.size();
+    REQUIRE(codes_set_string(h, "packingType", packing.c_str(), &length) ==
+            GRIB_SUCCESS);
+    REQUIRE(codes_set_long(h, "bitsPerValue", 16) == GRIB_SUCCESS);
+    REQUIRE(codes_set_double_array(h, "values", values.data(),
+                                   values.size()) == GRIB_SUCCESS);
+
+    size_t size = values.size();
+    REQUIRE(codes_get_double_array(h, "values", values.data(), &size) ==
+            GRIB_SUCCESS);
+    const void *message = nullptr;
+    REQUIRE(codes_get_message(h, &message, &length) == GRIB_SUCCESS);
+    const auto *bytes = static_cast<const unsigned char *>(message);
+
+    std::vector<double> native(values.size(), 0.0);
+    std::vector<float> native_float(values.size(), 0.0f);
+    const bool supported =
+        MetBuild::GribUnpacker::unpack(bytes, length, native.data(),
+                                       native.size()) &&
+        MetBuild::GribUnpacker::unpack(bytes, length, native_float.data(),
+                                       native_float.size());
+    REQUIRE(supported == MetBuild::GribUnpacker::supported(bytes, length));
+    if (supported) {
+      for (size_t k = 0; k < values.size(); ++k) {
+        REQUIRE(native[k] == values[k]);
+        REQUIRE(native_float[k] == static_cast<float>(values[k]));
+      }
+    }
+    codes_handle_delete(h);
+    return supported;
+  };
+
+  REQUIRE(unpack("grid_simple", false));
+  REQUIRE(unpack("grid_complex", false));
+  REQUIRE(unpack("grid_complex_spatial_differencing", false));
+  REQUIRE_FALSE(unpack("grid_simple", true));
+}
@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "boost/iostreams/copy.hpp"
+#include "boost/iostreams/filter/gzip.hpp"
+#include "boost/iostreams/filtering_stream.hpp"
+#include "catch.hpp"
+#include "output/ParallelCompressionBuffer.h"
+#include "output/StreamCompression.h"
+
+namespace {
+std::string decompress(const std::string &compressed) {
+  std::istringstream input(compressed);
+  boost::iostreams::filtering_istream stream;
+  stream.push(boost::iostreams::gzip_decompressor());
+  stream.push(input);
+  std::ostringstream output;
+  boost::iostreams::copy(stream, output);
+  return output.str();
+}
+}  // namespace
+
+TEST_CASE("Parallel gzip round trip", "[gzip]") {
+  std::string text;
+  for (size_t i = 0; i < 100000; ++i) {
+    text += std::to_string(i * 7919 % 100003) + (i % 8 == 7 ? "\n" : " ");
+  }
+
+  for (const size_t block : {size_t(1) << 20, size_t(4096), size_t(1000)}) {
+    std::ostringstream sink;
+    {
+      MetBuild::ParallelCompressionBuffer buffer(
+          &sink, MetBuild::StreamCompression::GZIP, 2, block);
+      std::ostream stream(&buffer);
+      stream << text.substr(0, 12345);
+      stream.flush();
+      stream << text.substr(12345);
+      buffer.close();
+    }
+    const auto compressed = sink.str();
+    REQUIRE(static_cast<unsigned char>(compressed[0]) == 0x1f);
+    REQUIRE(static_cast<unsigned char>(compressed[1]) == 0x8b);
+    REQUIRE(decompress(compressed) == text);
+  }
+}
+
+TEST_CASE("Parallel gzip empty stream", "[gzip]") {
+  std::ostringstream sink;
+  {
+    MetBuild::ParallelCompressionBuffer buffer(
+        &sink, MetBuild::StreamCompression::GZIP, 2);
+  }
+  REQUIRE_FALSE(sink.str().empty());
+  REQUIRE(decompress(sink.str()).empty());
+}
+
+TEST_CASE("Parallel compression codecs", "[gzip]") {
+  using MetBuild::StreamCompression;
+  std::string text;
+  for (size_t i = 0; i < 20000; ++i) {
+    text += std::to_string(i * 7919 % 100003) + (i % 8 == 7 ? "\n" : " ");
+  }
+
+  //...Every codec starts each member with its frame magic number
+  const std::vector<std::pair<StreamCompression::Codec, std::string>> codecs =
+      {{StreamCompression::GZIP, "\x1f\x8b"},
+       {StreamCompression::ZSTD, "\x28\xb5\x2f\xfd"},
+       {StreamCompression::LZ4, "\x04\x22\x4d\x18"}};
+  for (const auto &c : codecs) {
+    const auto codec = c.first;
+    REQUIRE(StreamCompression::fromName(StreamCompression::name(codec)) ==
+            codec);
+    if (!StreamCompression::available(codec)) {
+      std::ostringstream sink;
+      REQUIRE_THROWS(MetBuild::ParallelCompressionBuffer(&sink, codec, 0));
+      continue;
+    }
+    std::ostringstream sink;
+    {
+      MetBuild::ParallelCompressionBuffer buffer(
+          &sink, codec, StreamCompression::defaultLevel(codec), 4096);
+      std::ostream stream(&buffer);
+      stream << text;
+    }
+    const auto compressed = sink.str();
+    REQUIRE(compressed.size() < text.size());
+    REQUIRE(compressed.compare(0, c.second.size(), c.second) == 0);
+  }
+  REQUIRE(StreamCompression::available(StreamCompression::GZIP));
+  REQUIRE(StreamCompression::extension(StreamCompression::ZSTD) == ".zst");
+  REQUIRE_THROWS(StreamCompression::fromName("bzip2"));
+}
@@ -0,0 +1,1305 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "DeviceRemap.h"
+#include "Grid.h"
+#include "Instrumentation.h"
+#include "InterpolationData.h"
+#include "InterpolationKernel.h"
+#include "InterpolationWeights.h"
+#include "LocatorCache.h"
+#include "SparseWeights.h"
+#include "Triangulation.h"
+#include "catch.hpp"
+#include "data_sources/ArrayData.h"
+
+namespace {
+void generate_grid(size_t ni, size_t nj, std::vector<double> &x,
+                   std::vector<double> &y,
+                   std::vector<MetBuild::Point> &boundary) {
+  for (size_t j = 0; j < nj; ++j) {
+    for (size_t i = 0; i < ni; ++i) {
+      x.push_back(-100.0 + 0.25 * static_cast<double>(i));
+      y.push_back(30.0 - 0.25 * static_cast<double>(j));
+    }
+  }
+  for (size_t i = 0; i < ni; ++i) boundary.emplace_back(x[i], y[i]);
+  for (size_t j = 1; j < nj; ++j)
+    boundary.emplace_back(x[j * ni + ni - 1], y[j * ni + ni - 1]);
+  for (size_t i = 1; i < ni; ++i)
+    boundary.emplace_back(x[nj * ni - 1 - i], y[nj * ni - 1 - i]);
+  for (size_t j = nj - 2; j > 0; --j)
+    boundary.emplace_back(x[j * ni], y[j * ni]);
+}
+
+double interpolate(const MetBuild::InterpolationWeight &w,
+                   const std::vector<double> &values) {
+  return MetBuild::InterpolationWeight::interpolate(
+      w.weight(),
+      {values[w.index()[0]], values[w.index()[1]], values[w.index()[2]]});
+}
+}  // namespace
+
+TEST_CASE("Structured locator", "[Structured locator]") {
+  const size_t ni = 21;
+  const size_t nj = 17;
+  std::vector<double> x, y;
+  std::vector<MetBuild::Point> boundary;
+  generate_grid(ni, nj, x, y, boundary);
+
+  REQUIRE(MetBuild::Triangulation::isRectilinear(x, y, ni, nj));
+
+  std::vector<double> values(x.size());
+  for (size_t k = 0; k < x.size(); ++k) {
+    values[k] = 2.0 * x[k] - 3.0 * y[k] + 1.0;
+  }
+
+  const auto structured = MetBuild::Triangulation::structured(x, y, ni, nj);
+  const auto triangulation = MetBuild::Triangulation(x, y, boundary);
+
+  for (double qx = -99.9; qx < -95.1; qx += 0.37) {
+    for (double qy = 26.1; qy < 29.9; qy += 0.29) {
+      const auto w1 = structured.getInterpolationFactors(qx, qy);
+      const auto w2 = triangulation.getInterpolationFactors(qx, qy);
+      REQUIRE(MetBuild::InterpolationWeight::valid(
+          w1, MetBuild::Triangulation::invalid_point()));
+      REQUIRE(MetBuild::InterpolationWeight::valid(
+          w2, MetBuild::Triangulation::invalid_point()));
+      const auto expected = 2.0 * qx - 3.0 * qy + 1.0;
+      REQUIRE(std::abs(interpolate(w1, values) - expected) < 1e-8);
+      REQUIRE(std::abs(interpolate(w2, values) - expected) < 1e-8);
+    }
+  }
+
+  REQUIRE_FALSE(MetBuild::InterpolationWeight::valid(
+      structured.getInterpolationFactors(-101.0, 28.0),
+      MetBuild::Triangulation::invalid_point()));
+  REQUIRE_FALSE(MetBuild::InterpolationWeight::valid(
+      structured.getInterpolationFactors(-98.0, 31.0),
+      MetBuild::Triangulation::invalid_point()));
+}
+
+TEST_CASE("Simplified boundary", "[Simplified boundary]") {
+  const size_t ni = 33;
+  const size_t nj = 25;
+  std::vector<double> x, y;
+  std::vector<MetBuild::Point> boundary;
+  generate_grid(ni, nj, x, y, boundary);
+
+  const std::vector<MetBuild::Point> corners = {
+      {x[0], y[0]},
+      {x[ni - 1], y[ni - 1]},
+      {x[ni * nj - 1], y[ni * nj - 1]},
+      {x[ni * (nj - 1)], y[ni * (nj - 1)]}};
+
+  std::vector<double> values(x.size());
+  for (size_t k = 0; k < x.size(); ++k) {
+    values[k] = 2.0 * x[k] - 3.0 * y[k] + 1.0;
+  }
+
+  const auto traced = MetBuild::Triangulation(x, y, boundary);
+  const auto simple = MetBuild::Triangulation(x, y, corners);
+
+  for (double qx = -100.5; qx < -91.5; qx += 0.31) {
+    for (double qy = 23.5; qy < 30.5; qy += 0.27) {
+      const auto w1 = traced.getInterpolationFactors(qx, qy);
+      const auto w2 = simple.getInterpolationFactors(qx, qy);
+      const auto valid = MetBuild::InterpolationWeight::valid(
+          w1, MetBuild::Triangulation::invalid_point());
+      REQUIRE(valid == MetBuild::InterpolationWeight::valid(
+                           w2, MetBuild::Triangulation::invalid_point()));
+      if (!valid) continue;
+      REQUIRE(std::abs(interpolate(w1, values) - interpolate(w2, values)) <
+              1e-8);
+    }
+  }
+}
+
+TEST_CASE("Bucket locator", "[Bucket locator]") {
+  const size_t ni = 21;
+  const size_t nj = 17;
+  std::vector<double> x, y;
+  std::vector<MetBuild::Point> boundary;
+  generate_grid(ni, nj, x, y, boundary);
+
+  std::vector<double> values(x.size());
+  for (size_t k = 0; k < x.size(); ++k) {
+    values[k] = 2.0 * x[k] - 3.0 * y[k] + 1.0;
+  }
+
+  const bool use_buckets = MetBuild::Triangulation::useBuckets();
+  MetBuild::Triangulation::setUseBuckets(false);
+  const auto walk = MetBuild::Triangulation(x, y, boundary);
+  MetBuild::Triangulation::setUseBuckets(true);
+  const auto buckets = MetBuild::Triangulation(x, y, boundary);
+  MetBuild::Triangulation::setUseBuckets(use_buckets);
+
+  for (double qx = -100.5; qx < -94.5; qx += 0.13) {
+    for (double qy = 25.5; qy < 30.5; qy += 0.11) {
+      const auto a = walk.getInterpolationFactors(qx, qy);
+      const auto b = buckets.getInterpolationFactors(qx, qy);
+      const auto valid = MetBuild::InterpolationWeight::valid(
+          a, MetBuild::Triangulation::invalid_point());
+      REQUIRE(valid == MetBuild::InterpolationWeight::valid(
+                           b, MetBuild::Triangulation::invalid_point()));
+      if (!valid) continue;
+      REQUIRE(std::abs(interpolate(a, values) - interpolate(b, values)) <
+              1e-8);
+    }
+  }
+}
+
+TEST_CASE("Locator cache", "[Locator cache]") {
+  const size_t ni = 21;
+  const size_t nj = 17;
+  std::vector<double> x, y;
+  std::vector<MetBuild::Point> boundary;
+  generate_grid(ni, nj, x, y, boundary);
+
+  std::vector<double> values(x.size());
+  for (size_t k = 0; k < x.size(); ++k) {
+    values[k] = 2.0 * x[k] - 3.0 * y[k] + 1.0;
+  }
+
+  const auto directory = MetBuild::LocatorCache::directory();
+  MetBuild::LocatorCache::setDirectory("locator_cache_test");
+  MetBuild::LocatorCache::clear_used_keys();
+  const auto built = MetBuild::Triangulation(x, y, boundary);
+  const auto keys = MetBuild::LocatorCache::used_keys();
+  REQUIRE(keys.size() == 1);
+
+  const auto before = MetBuild::Instrumentation::report();
+  const auto loaded = MetBuild::Triangulation(x, y, boundary);
+  REQUIRE(MetBuild::Instrumentation::report().since(before).events(
+              MetBuild::Instrumentation::LOCATOR_LOADED) == 1);
+  REQUIRE(MetBuild::LocatorCache::used_keys() == keys);
+
+  for (double qx = -100.5; qx < -94.5; qx += 0.13) {
+    for (double qy = 25.5; qy < 30.5; qy += 0.11) {
+      const auto a = built.getInterpolationFactors(qx, qy);
+      const auto b = loaded.getInterpolationFactors(qx, qy);
+      const auto valid = MetBuild::InterpolationWeight::valid(
+          a, MetBuild::Triangulation::invalid_point());
+      REQUIRE(valid == MetBuild::InterpolationWeight::valid(
+                           b, MetBuild::Triangulation::invalid_point()));
+      if (!valid) continue;
+      REQUIRE(std::abs(interpolate(a, values) - interpolate(b, values)) <
+              1e-8);
+    }
+  }
+
+  //...A file for other points is ignored
+  REQUIRE_FALSE(
+      MetBuild::LocatorCache::load(keys.front(), x.size() + 1).has_value());
+
+  std::remove(MetBuild::LocatorCache::filename(keys.front()).c_str());
+  std::remove("locator_cache_test");
+  MetBuild::LocatorCache::setDirectory(directory);
+  MetBuild::LocatorCache::clear_used_keys();
+}
+
+TEST_CASE("Tiled triangulation", "[Tiled triangulation]") {
+  const size_t ni = 61;
+  const size_t nj = 45;
+  std::vector<double> x, y;
+  std::vector<MetBuild::Point> boundary;
+  generate_grid(ni, nj, x, y, boundary);
+
+  //...Shift the interior points so the source is scattered
+  for (size_t j = 1; j + 1 < nj; ++j) {
+    for (size_t i = 1; i + 1 < ni; ++i) {
+      const auto k = j * ni + i;
+      x[k] += 0.08 * std::sin(static_cast<double>(3 * k));
+      y[k] += 0.08 * std::cos(static_cast<double>(5 * k));
+    }
+  }
+
+  std::vector<double> values(x.size());
+  for (size_t k = 0; k < x.size(); ++k) {
+    values[k] = 2.0 * x[k] - 3.0 * y[k] + 1.0;
+  }
+
+  const size_t tile_points = MetBuild::Triangulation::tilePoints();
+  MetBuild::Triangulation::setTilePoints(0);
+  const auto single = MetBuild::Triangulation(x, y, boundary);
+  MetBuild::Triangulation::setTilePoints(250);
+  const auto tiled = MetBuild::Triangulation(x, y, boundary);
+  MetBuild::Triangulation::setTilePoints(tile_points);
+
+  std::vector<MetBuild::Point> row;
+  for (double qy = 18.5; qy < 30.5; qy += 0.17) {
+    row.clear();
+    for (double qx = -100.5; qx < -84.5; qx += 0.19) {
+      row.emplace_back(qx, qy);
+    }
+    std::vector<MetBuild::InterpolationWeight> weights;
+    tiled.getInterpolationFactors(row, weights);
+    REQUIRE(weights.size() == row.size());
+
+    for (size_t k = 0; k < row.size(); ++k) {
+      const auto a = single.getInterpolationFactors(row[k].x(), row[k].y());
+      const auto b = tiled.getInterpolationFactors(row[k].x(), row[k].y());
+      const auto valid = MetBuild::InterpolationWeight::valid(
+          a, MetBuild::Triangulation::invalid_point());
+      REQUIRE(valid == MetBuild::InterpolationWeight::valid(
+                           b, MetBuild::Triangulation::invalid_point()));
+      REQUIRE(b.index() == weights[k].index());
+      if (!valid) continue;
+      const double expected = 2.0 * row[k].x() - 3.0 * row[k].y() + 1.0;
+      REQUIRE(std::abs(interpolate(a, values) - expected) < 1e-8);
+      REQUIRE(std::abs(interpolate(b, values) - expected) < 1e-8);
+    }
+  }
+}
+
+TEST_CASE("Row located weights", "[Row located weights]") {
+  const size_t ni = 31;
+  const size_t nj = 23;
+  std::vector<double> x, y;
+  std::vector<MetBuild::Point> boundary;
+  generate_grid(ni, nj, x, y, boundary);
+  const auto triangulation = MetBuild::Triangulation(x, y, boundary);
+
+  std::vector<MetBuild::Point> row;
+  for (double qx = -101.0; qx < -92.0; qx += 0.13) {
+    row.emplace_back(qx, 27.3);
+  }
+
+  std::vector<MetBuild::InterpolationWeight> weights;
+  triangulation.getInterpolationFactors(row, weights);
+  REQUIRE(weights.size() == row.size());
+
+  for (size_t k = 0; k < row.size(); ++k) {
+    const auto w = triangulation.getInterpolationFactors(row[k].x(), row[k].y());
+    REQUIRE(w.index() == weights[k].index());
+    for (size_t n = 0; n < 3; ++n) {
+      REQUIRE(std::abs(w.weight()[n] - weights[k].weight()[n]) < 1e-12);
+    }
+  }
+}
+
+TEST_CASE("Interpolation weight storage", "[Interpolation weight storage]") {
+  const size_t ni = 70;
+  const size_t nj = 3;
+  MetBuild::InterpolationWeights weights(ni, nj);
+  const MetBuild::InterpolationWeight invalid = {
+      {MetBuild::Triangulation::invalid_point(),
+       MetBuild::Triangulation::invalid_point(),
+       MetBuild::Triangulation::invalid_point()},
+      {0.0, 0.0, 0.0}};
+
+  for (size_t j = 0; j < nj; ++j) {
+    std::vector<MetBuild::InterpolationWeight> row;
+    for (size_t i = 0; i < ni; ++i) {
+      if ((i + j) % 5 == 0) {
+        row.push_back(invalid);
+      } else {
+        row.emplace_back(std::array<size_t, 3>{i, j, i + j},
+                          std::array<double, 3>{0.5, 0.25, 0.25});
+      }
+    }
+    weights.set_row(j, row);
+  }
+  weights.update_mask();
+
+  for (size_t j = 0; j < nj; ++j) {
+    for (size_t i = 0; i < ni; ++i) {
+      const auto w = weights.get(i, j);
+      REQUIRE(weights.valid(i, j) == ((i + j) % 5 != 0));
+      REQUIRE(MetBuild::InterpolationWeight::valid(
+                  w, MetBuild::Triangulation::invalid_point()) ==
+              weights.valid(i, j));
+      if (weights.valid(i, j)) {
+        REQUIRE(w.index()[2] == i + j);
+        REQUIRE(weights.weight(0)[weights.cell(i, j)] == 0.5);
+      }
+    }
+  }
+
+  weights.set(3, 1, invalid);
+  REQUIRE_FALSE(weights.valid(3, 1));
+
+  const auto ranges =
+      MetBuild::InterpolationWeights::valid_ranges(weights, weights);
+  const auto gaps =
+      MetBuild::InterpolationWeights::complement(ranges, weights.size());
+  std::vector<int> covered(weights.size(), 0);
+  for (const auto &r : ranges) {
+    for (size_t c = r.begin; c < r.end; ++c) {
+      REQUIRE(weights.valid(c));
+      covered[c]++;
+    }
+  }
+  for (const auto &r : gaps) {
+    for (size_t c = r.begin; c < r.end; ++c) {
+      REQUIRE_FALSE(weights.valid(c));
+      covered[c]++;
+    }
+  }
+  for (const auto c : covered) {
+    REQUIRE(c == 1);
+  }
+}
+
+TEST_CASE("Fused interpolation kernel", "[Fused interpolation kernel]") {
+  const size_t ni = 37;
+  const size_t nj = 2;
+  const size_t n_source = 100;
+  MetBuild::InterpolationWeights w1(ni, nj);
+  MetBuild::InterpolationWeights w2(ni, nj);
+  const MetBuild::InterpolationWeight invalid = {
+      {MetBuild::Triangulation::invalid_point(),
+       MetBuild::Triangulation::invalid_point(),
+       MetBuild::Triangulation::invalid_point()},
+      {0.0, 0.0, 0.0}};
+
+  for (size_t j = 0; j < nj; ++j) {
+    for (size_t i = 0; i < ni; ++i) {
+      const size_t c = j * ni + i;
+      const MetBuild::InterpolationWeight a(
+          std::array<size_t, 3>{c % n_source, (c * 7) % n_source,
+                                (c * 13) % n_source},
+          std::array<double, 3>{0.2, 0.3, 0.5});
+      const MetBuild::InterpolationWeight b(
+          std::array<size_t, 3>{(c * 3) % n_source, (c + 1) % n_source,
+                                (c * 11) % n_source},
+          std::array<double, 3>{0.6, 0.1, 0.3});
+      w1.set(i, j, c % 9 == 0 ? invalid : a);
+      w2.set(i, j, c % 11 == 0 ? invalid : b);
+    }
+  }
+
+  using Values = std::vector<MetBuild::SourceDataType>;
+  Values u1(n_source), v1(n_source), p1(n_source);
+  Values u2(n_source), v2(n_source), p2(n_source);
+  for (size_t k = 0; k < n_source; ++k) {
+    const auto d = static_cast<double>(k);
+    u1[k] = std::sin(d);
+    v1[k] = std::cos(d);
+    p1[k] = 100000.0 + d;
+    u2[k] = 2.0 * std::sin(d);
+    v2[k] = 0.5 * std::cos(d);
+    p2[k] = 100500.0 - d;
+  }
+
+  const MetBuild::Kernel::WeightView view1(w1);
+  const MetBuild::Kernel::WeightView view2(w2);
+  const double tw = 0.25;
+
+  for (const bool use_flag : {true, false}) {
+    const MetBuild::MeteorologicalDataType flag = use_flag ? -999.0 : 0.0;
+    const MetBuild::MeteorologicalDataType pressure_fill =
+        use_flag ? -999.0 : 1013.0;
+    std::vector<MetBuild::MeteorologicalDataType> u(ni * nj), v(ni * nj),
+        p(ni * nj), s(ni * nj);
+    const MetBuild::Kernel::WindFields wind{
+        {{{u1.data(), 1.0}, {v1.data(), 1.0}, {p1.data(), 1.0}}},
+        {{{u2.data(), 1.0}, {v2.data(), 1.0}, {p2.data(), 1.0}}},
+        {{u.data(), v.data(), p.data()}},
+        {{flag, flag, pressure_fill}}};
+    const MetBuild::Kernel::ScalarFields rain{{{{p1.data(), 1.0}}},
+                                              {{{p2.data(), 1.0}}},
+                                              {{s.data()}},
+                                              {{-1.0}}};
+    for (size_t j = 0; j < nj; ++j) {
+      MetBuild::Kernel::interpolate_masked(j * ni, ni, view1, view2, wind, tw);
+      MetBuild::Kernel::interpolate_masked(j * ni, ni, view1, view2, rain, tw);
+
+      std::vector<MetBuild::MeteorologicalDataType> a(ni), b(ni), blended(ni);
+      MetBuild::Kernel::interpolate(j * ni, ni, view1, {p1.data(), 0.01}, 0.0,
+                                    a.data());
+      MetBuild::Kernel::interpolate(j * ni, ni, view2, {p2.data(), 0.01}, 0.0,
+                                    b.data());
+      MetBuild::Kernel::blend(j * ni, ni, view1, view2, a.data(), b.data(), tw,
+                              -1.0, blended.data());
+
+      for (size_t i = 0; i < ni; ++i) {
+        const size_t c = j * ni + i;
+        if (!w1.valid(c) || !w2.valid(c)) {
+          REQUIRE(u[c] == (use_flag ? -999.0 : 0.0));
+          REQUIRE(p[c] == (use_flag ? -999.0 : 1013.0));
+          REQUIRE(s[c] == -1.0);
+          REQUIRE(blended[i] == -1.0);
+          continue;
+        }
+        const auto a = w1.get(i, j);
+        const auto b = w2.get(i, j);
+        auto interp = [](const MetBuild::InterpolationWeight &w,
+                         const Values &values) {
+          return w.weight()[0] * values[w.index()[0]] +
+                 w.weight()[1] * values[w.index()[1]] +
+                 w.weight()[2] * values[w.index()[2]];
+        };
+        const double u_ref = (1.0 - tw) * interp(a, u1) + tw * interp(b, u2);
+        const double v_ref = (1.0 - tw) * interp(a, v1) + tw * interp(b, v2);
+        const double p_ref = (1.0 - tw) * interp(a, p1) + tw * interp(b, p2);
+        REQUIRE(u[c] == Approx(u_ref).margin(1e-5));
+        REQUIRE(v[c] == Approx(v_ref).margin(1e-5));
+        REQUIRE(p[c] == Approx(p_ref));
+        REQUIRE(s[c] == Approx(p_ref));
+        REQUIRE(blended[i] == Approx(p_ref * 0.01));
+      }
+    }
+  }
+
+  std::vector<MetBuild::MeteorologicalDataType> u(ni * nj, 0.0f),
+      v(ni * nj, 0.0f), p(ni * nj, 0.0f);
+  std::vector<MetBuild::MeteorologicalDataType> u_ref(ni * nj),
+      v_ref(ni * nj), p_ref(ni * nj);
+  const MetBuild::Kernel::WindFields reference{
+      {{{u1.data(), 1.0}, {v1.data(), 1.0}, {p1.data(), 1.0}}},
+      {{{u2.data(), 1.0}, {v2.data(), 1.0}, {p2.data(), 1.0}}},
+      {{u_ref.data(), v_ref.data(), p_ref.data()}},
+      {{0.0, 0.0, 1013.0}}};
+  MetBuild::Kernel::interpolate_masked(0, ni * nj, view1, view2, reference,
+                                       tw);
+  const MetBuild::Kernel::WindFields valid{
+      reference.first, reference.second, {{u.data(), v.data(), p.data()}},
+      reference.fill};
+  for (const auto &r : MetBuild::InterpolationWeights::valid_ranges(w1, w2)) {
+    MetBuild::Kernel::interpolate_valid(r.begin, r.end - r.begin, view1, view2,
+                                        valid, tw);
+  }
+  for (size_t c = 0; c < ni * nj; ++c) {
+    if (w1.valid(c) && w2.valid(c)) {
+      REQUIRE(u[c] == u_ref[c]);
+      REQUIRE(v[c] == v_ref[c]);
+      REQUIRE(p[c] == p_ref[c]);
+    } else {
+      REQUIRE(p[c] == 0.0f);
+    }
+  }
+}
+
+TEST_CASE("Kernel dispatch", "[Kernel dispatch]") {
+  const size_t n = 203;
+  const size_t n_source = 61;
+  MetBuild::InterpolationWeights w1(n, 1);
+  MetBuild::InterpolationWeights w2(n, 1);
+  const MetBuild::InterpolationWeight invalid = {
+      {MetBuild::Triangulation::invalid_point(),
+       MetBuild::Triangulation::invalid_point(),
+       MetBuild::Triangulation::invalid_point()},
+      {0.0, 0.0, 0.0}};
+  for (size_t c = 0; c < n; ++c) {
+    w1.set(c, 0,
+           c % 7 == 0 ? invalid
+                      : MetBuild::InterpolationWeight(
+                            std::array<size_t, 3>{c % n_source,
+                                                  (c * 5) % n_source,
+                                                  (c * 17) % n_source},
+                            std::array<double, 3>{0.1, 0.7, 0.2}));
+    w2.set(c, 0,
+           c % 5 == 0 ? invalid
+                      : MetBuild::InterpolationWeight(
+                            std::array<size_t, 3>{(c * 3) % n_source,
+                                                  (c + 2) % n_source,
+                                                  (c * 13) % n_source},
+                            std::array<double, 3>{0.4, 0.4, 0.2}));
+  }
+  std::vector<MetBuild::SourceDataType> s1(n_source), s2(n_source);
+  for (size_t k = 0; k < n_source; ++k) {
+    s1[k] = std::sin(static_cast<double>(k));
+    s2[k] = std::cos(static_cast<double>(k));
+  }
+  const MetBuild::Kernel::WeightView view1(w1);
+  const MetBuild::Kernel::WeightView view2(w2);
+
+  //...Every instruction set the host supports gives the portable results
+  const std::string initial = MetBuild::Kernel::instruction_set();
+  auto run = [&]() {
+    std::vector<MetBuild::MeteorologicalDataType> out(n), a(n), b(n),
+        blended(n);
+    const MetBuild::Kernel::ScalarFields fields{
+        {{{s1.data(), 1.0}}}, {{{s2.data(), 1.0}}}, {{out.data()}}, {{-1.0}}};
+    MetBuild::Kernel::interpolate_masked(0, n, view1, view2, fields, 0.3);
+    MetBuild::Kernel::interpolate(0, n, view1, {s1.data(), 1.0}, 0.0,
+                                  a.data());
+    MetBuild::Kernel::interpolate(0, n, view2, {s2.data(), 1.0}, 0.0,
+                                  b.data());
+    MetBuild::Kernel::blend(0, n, view1, view2, a.data(), b.data(), 0.3, -1.0,
+                            blended.data());
+    out.insert(out.end(), blended.begin(), blended.end());
+    return out;
+  };
+
+  REQUIRE(MetBuild::Kernel::set_instruction_set("generic"));
+  REQUIRE(std::string(MetBuild::Kernel::instruction_set()) == "generic");
+  const auto reference = run();
+  if (MetBuild::Kernel::set_instruction_set("avx2")) {
+    REQUIRE(std::string(MetBuild::Kernel::instruction_set()) != "generic");
+    const auto vectorized = run();
+    for (size_t k = 0; k < reference.size(); ++k) {
+      REQUIRE(vectorized[k] == Approx(reference[k]).margin(1e-6));
+    }
+  }
+  REQUIRE_FALSE(MetBuild::Kernel::set_instruction_set("unknown"));
+  REQUIRE(MetBuild::Kernel::set_instruction_set(initial.substr(0, 4) == "avx2"
+                                                    ? "avx2"
+                                                    : "generic"));
+}
+
+TEST_CASE("Batched interpolation kernel", "[Batched interpolation kernel]") {
+  const size_t ni = 41;
+  const size_t nj = 3;
+  const size_t n_source = 64;
+  const size_t n_fields = 5;
+  MetBuild::InterpolationWeights w(ni, nj);
+  for (size_t j = 0; j < nj; ++j) {
+    for (size_t i = 0; i < ni; ++i) {
+      const size_t c = j * ni + i;
+      if (c % 7 == 0) continue;
+      w.set(i, j,
+            MetBuild::InterpolationWeight(
+                std::array<size_t, 3>{c % n_source, (c * 5) % n_source,
+                                      (c * 3 + 1) % n_source},
+                std::array<double, 3>{0.1, 0.6, 0.3}));
+    }
+  }
+  w.update_mask();
+  const MetBuild::Kernel::WeightView view(w);
+
+  std::vector<std::vector<MetBuild::SourceDataType>> values(
+      n_fields, std::vector<MetBuild::SourceDataType>(n_source));
+  std::vector<MetBuild::Kernel::SourceField> sources;
+  std::vector<MetBuild::MeteorologicalDataType> fill;
+  for (size_t f = 0; f < n_fields; ++f) {
+    for (size_t k = 0; k < n_source; ++k) {
+      values[f][k] = std::sin(static_cast<double>(k * (f + 1)));
+    }
+    sources.push_back({values[f].data(), f == 2 ? 0.01 : 1.0});
+    fill.push_back(-static_cast<MetBuild::MeteorologicalDataType>(f));
+  }
+
+  std::vector<std::vector<MetBuild::MeteorologicalDataType>> batch(
+      n_fields, std::vector<MetBuild::MeteorologicalDataType>(ni));
+  std::vector<MetBuild::MeteorologicalDataType *> out;
+  for (auto &b : batch) out.push_back(b.data());
+  std::vector<MetBuild::MeteorologicalDataType> single(ni);
+
+  for (size_t j = 0; j < nj; ++j) {
+    MetBuild::Kernel::interpolate_batch(j * ni, ni, view, sources.data(),
+                                        n_fields, fill.data(), out.data());
+    for (size_t f = 0; f < n_fields; ++f) {
+      MetBuild::Kernel::interpolate(j * ni, ni, view, sources[f], fill[f],
+                                    single.data());
+      for (size_t i = 0; i < ni; ++i) {
+        REQUIRE(batch[f][i] == single[i]);
+      }
+    }
+  }
+}
+
+TEST_CASE("Sparse weights", "[Sparse weights]") {
+  const size_t ni = 41;
+  const size_t nj = 3;
+  const size_t n_source = 64;
+  const size_t n_fields = 5;
+  MetBuild::InterpolationWeights w(ni, nj);
+  for (size_t j = 0; j < nj; ++j) {
+    for (size_t i = 0; i < ni; ++i) {
+      const size_t c = j * ni + i;
+      if (c % 7 == 0) continue;
+      w.set(i, j,
+            MetBuild::InterpolationWeight(
+                std::array<size_t, 3>{c % n_source, (c * 5) % n_source,
+                                      (c * 3 + 1) % n_source},
+                std::array<double, 3>{0.1, 0.6, 0.3}));
+    }
+  }
+  w.update_mask();
+  const MetBuild::Kernel::WeightView view(w);
+  const auto sparse = MetBuild::SparseWeights::from(w);
+  REQUIRE(sparse.rows() == ni * nj);
+
+  std::vector<std::vector<MetBuild::SourceDataType>> values(
+      n_fields, std::vector<MetBuild::SourceDataType>(n_source));
+  std::vector<MetBuild::Kernel::SourceField> sources;
+  std::vector<MetBuild::MeteorologicalDataType> fill;
+  for (size_t f = 0; f < n_fields; ++f) {
+    for (size_t k = 0; k < n_source; ++k) {
+      values[f][k] = std::sin(static_cast<double>(k * (f + 1)));
+    }
+    sources.push_back({values[f].data(), f == 2 ? 0.01 : 1.0});
+    fill.push_back(-static_cast<MetBuild::MeteorologicalDataType>(f));
+  }
+
+  std::vector<std::vector<MetBuild::MeteorologicalDataType>> dense(
+      n_fields, std::vector<MetBuild::MeteorologicalDataType>(ni * nj));
+  std::vector<std::vector<MetBuild::MeteorologicalDataType>> remapped(
+      n_fields, std::vector<MetBuild::MeteorologicalDataType>(ni * nj));
+  std::vector<MetBuild::MeteorologicalDataType *> dense_out;
+  std::vector<MetBuild::MeteorologicalDataType *> remapped_out;
+  for (size_t f = 0; f < n_fields; ++f) {
+    dense_out.push_back(dense[f].data());
+    remapped_out.push_back(remapped[f].data());
+  }
+
+  MetBuild::Kernel::interpolate_batch(0, ni * nj, view, sources.data(),
+                                      n_fields, fill.data(), dense_out.data());
+  sparse.apply(sources.data(), n_fields, fill.data(), remapped_out.data());
+  for (size_t f = 0; f < n_fields; ++f) {
+    for (size_t c = 0; c < ni * nj; ++c) {
+      REQUIRE(std::abs(dense[f][c] - remapped[f][c]) < 1e-6);
+    }
+  }
+
+  //...Rows may hold any number of entries
+  MetBuild::SparseWeights bilinear;
+  const std::array<MetBuild::SparseWeights::index_type, 4> index{0, 1, 8, 9};
+  const std::array<MetBuild::SparseWeights::weight_type, 4> weight{
+      0.25, 0.25, 0.25, 0.25};
+  bilinear.append_row(index.data(), weight.data(), 4);
+  bilinear.append_row(nullptr, nullptr, 0);
+  REQUIRE(bilinear.valid(0));
+  REQUIRE_FALSE(bilinear.valid(1));
+  MetBuild::Kernel::interpolate_sparse(0, 2, bilinear, sources.data(), 1,
+                                       fill.data(), remapped_out.data());
+  const auto expected = 0.25 * (values[0][0] + values[0][1] + values[0][8] +
+                                values[0][9]);
+  REQUIRE(std::abs(remapped[0][0] - expected) < 1e-6);
+  REQUIRE(remapped[0][1] == fill[0]);
+}
+
+TEST_CASE("Device remap", "[Device remap]") {
+  const size_t n_source = 64;
+  const size_t n_cells = 300;
+  MetBuild::InterpolationWeights w(n_cells, 1);
+  for (size_t c = 0; c < n_cells; ++c) {
+    if (c % 11 == 0) continue;
+    w.set(c, 0,
+          MetBuild::InterpolationWeight(
+              std::array<size_t, 3>{c % n_source, (c * 7) % n_source,
+                                    (c * 3 + 2) % n_source},
+              std::array<double, 3>{0.2, 0.5, 0.3}));
+  }
+  w.update_mask();
+  const auto sparse = MetBuild::SparseWeights::from(w);
+  const MetBuild::Kernel::WeightView view(w);
+
+  std::vector<MetBuild::SourceDataType> v1(n_source);
+  std::vector<MetBuild::SourceDataType> v2(n_source);
+  for (size_t k = 0; k < n_source; ++k) {
+    v1[k] = std::sin(static_cast<double>(k));
+    v2[k] = std::cos(static_cast<double>(k));
+  }
+  const MetBuild::Kernel::SourceField f1{v1.data(), 1.0};
+  const MetBuild::Kernel::SourceField f2{v2.data(), 2.0};
+  const MetBuild::MeteorologicalDataType fill = -999.0;
+
+  const MetBuild::DeviceWeights device(sparse);
+  const MetBuild::DeviceField d1(device, f1, n_source);
+  const MetBuild::DeviceField d2(device, f2, n_source);
+
+  std::vector<MetBuild::MeteorologicalDataType> a(n_cells);
+  std::vector<MetBuild::MeteorologicalDataType> b(n_cells);
+  std::vector<MetBuild::MeteorologicalDataType> expected(n_cells);
+  std::vector<MetBuild::MeteorologicalDataType> out(n_cells);
+  MetBuild::Kernel::interpolate(0, n_cells, view, f1, fill, a.data());
+  MetBuild::Kernel::interpolate(0, n_cells, view, f2, fill, b.data());
+  for (const double time_weight : {0.0, 0.25, 1.0}) {
+    MetBuild::Kernel::blend(0, n_cells, view, view, a.data(), b.data(),
+                            time_weight, fill, expected.data());
+    MetBuild::DeviceField::blend(d1, d2, time_weight, fill, out.data());
+    for (size_t c = 0; c < n_cells; ++c) {
+      REQUIRE(std::abs(out[c] - expected[c]) < 1e-6);
+    }
+  }
+}
+
+TEST_CASE("Cropped triangulation", "[Cropped triangulation]") {
+  const size_t ni = 61;
+  const size_t nj = 41;
+  std::vector<double> x, y;
+  std::vector<MetBuild::Point> boundary;
+  generate_grid(ni, nj, x, y, boundary);
+
+  std::vector<double> values(x.size());
+  for (size_t k = 0; k < x.size(); ++k) {
+    values[k] = 2.0 * x[k] - 3.0 * y[k] + 1.0;
+  }
+
+  const MetBuild::Triangulation::Extent extent{-96.0, 24.0, -93.0, 27.0};
+  const auto window =
+      MetBuild::Triangulation::crop_window(x, y, ni, nj, extent);
+  REQUIRE(window.has_value());
+  REQUIRE(window->i0 == 14);
+  REQUIRE(window->j0 == 10);
+  REQUIRE(window->ni == 17);
+  REQUIRE(window->nj == 17);
+
+  const auto cropped =
+      MetBuild::Triangulation::cropped(x, y, ni, nj, boundary, extent);
+
+  std::vector<MetBuild::Point> row;
+  for (double qx = -95.95; qx < -93.0; qx += 0.13) {
+    for (double qy = 24.05; qy < 27.0; qy += 0.11) {
+      const auto w = cropped.getInterpolationFactors(qx, qy);
+      REQUIRE(MetBuild::InterpolationWeight::valid(
+          w, MetBuild::Triangulation::invalid_point()));
+      for (const auto index : w.index()) {
+        REQUIRE(index < x.size());
+      }
+      const auto expected = 2.0 * qx - 3.0 * qy + 1.0;
+      REQUIRE(std::abs(interpolate(w, values) - expected) < 1e-8);
+    }
+    row.emplace_back(qx, 25.5);
+  }
+
+  std::vector<MetBuild::InterpolationWeight> weights;
+  cropped.getInterpolationFactors(row, weights);
+  REQUIRE(weights.size() == row.size());
+  for (size_t k = 0; k < row.size(); ++k) {
+    const auto expected = 2.0 * row[k].x() - 3.0 * row[k].y() + 1.0;
+    REQUIRE(std::abs(interpolate(weights[k], values) - expected) < 1e-8);
+  }
+
+  //...Points well outside the extent are not part of the subset
+  REQUIRE_FALSE(MetBuild::InterpolationWeight::valid(
+      cropped.getInterpolationFactors(-99.0, 29.0),
+      MetBuild::Triangulation::invalid_point()));
+
+  //...Extents covering most of the grid fall back to the full triangulation
+  const auto full = MetBuild::Triangulation::cropped(
+      x, y, ni, nj, boundary, {-101.0, 19.0, -84.0, 31.0});
+  REQUIRE(MetBuild::InterpolationWeight::valid(
+      full.getInterpolationFactors(-99.0, 29.0),
+      MetBuild::Triangulation::invalid_point()));
+}
+
+TEST_CASE("Translated weights", "[Translated weights]") {
+  const size_t ni = 21;
+  const size_t nj = 17;
+  std::vector<double> x0, y0;
+  std::vector<MetBuild::Point> boundary;
+  generate_grid(ni, nj, x0, y0, boundary);
+
+  //...The nest moves three cells east and two cells south
+  std::vector<double> x1(x0.size());
+  std::vector<double> y1(y0.size());
+  for (size_t k = 0; k < x0.size(); ++k) {
+    x1[k] = x0[k] + 0.75;
+    y1[k] = y0[k] - 0.5;
+  }
+
+  const auto offset =
+      MetBuild::Triangulation::translation(x0, y0, x1, y1, ni, nj);
+  REQUIRE(offset.has_value());
+  REQUIRE(offset->di == 3);
+  REQUIRE(offset->dj == 2);
+
+  std::vector<double> shifted(x1);
+  for (auto &v : shifted) v += 0.1;
+  REQUIRE_FALSE(
+      MetBuild::Triangulation::translation(x0, y0, shifted, y1, ni, nj));
+
+  MetBuild::Grid::grid grid;
+  for (double qy = 24.0; qy < 30.5; qy += 0.3) {
+    std::vector<MetBuild::Point> row;
+    for (double qx = -100.5; qx < -94.0; qx += 0.35) row.emplace_back(qx, qy);
+    grid.push_back(row);
+  }
+
+  const auto t0 = MetBuild::Triangulation::structured(x0, y0, ni, nj);
+  const auto t1 = MetBuild::Triangulation::structured(x1, y1, ni, nj);
+  const MetBuild::InterpolationData previous(t0, grid);
+  const MetBuild::InterpolationData fresh(t1, grid);
+  REQUIRE_FALSE(previous.hasTriangulation());
+  REQUIRE_THROWS(previous.triangulation());
+  REQUIRE(MetBuild::InterpolationData(t0, grid, MetBuild::CONVENTION_180, true)
+              .hasTriangulation());
+  const MetBuild::InterpolationData translated(
+      t1, grid,
+      {&previous, *offset, ni, nj,
+       {x1.front(), y1.back(), x1.back(), y1.front()}});
+
+  std::vector<double> values(x1.size());
+  for (size_t k = 0; k < x1.size(); ++k) {
+    values[k] = 2.0 * x1[k] - 3.0 * y1[k] + 1.0;
+  }
+
+  const auto &a = fresh.interpolation();
+  const auto &b = translated.interpolation();
+  for (size_t j = 0; j < grid.size(); ++j) {
+    for (size_t i = 0; i < grid[j].size(); ++i) {
+      REQUIRE(a.valid(i, j) == b.valid(i, j));
+      if (!a.valid(i, j)) continue;
+      REQUIRE(std::abs(interpolate(a.get(i, j), values) -
+                       interpolate(b.get(i, j), values)) < 1e-4);
+    }
+  }
+}
+
+TEST_CASE("Masked weights", "[Masked weights]") {
+  const size_t ni = 21;
+  const size_t nj = 17;
+  std::vector<double> x, y;
+  std::vector<MetBuild::Point> boundary;
+  generate_grid(ni, nj, x, y, boundary);
+  const auto triangulation = MetBuild::Triangulation::structured(x, y, ni, nj);
+
+  auto wg = MetBuild::Grid(-100.5, 24.0, 19, 22, 0.35, 0.3, 0.0);
+  REQUIRE_FALSE(wg.has_mask());
+  REQUIRE(wg.mask_hash() == 0);
+  REQUIRE_THROWS(wg.set_mask(std::vector<uint8_t>(5, 1)));
+
+  //...Keep the cells west of a diagonal, as if the east were land
+  wg.set_mask(std::vector<MetBuild::Point>{
+      {-101.0, 23.0}, {-95.0, 23.0}, {-101.0, 31.0}});
+  REQUIRE(wg.has_mask());
+  REQUIRE(wg.mask_hash() != 0);
+  REQUIRE(MetBuild::Grid(wg).mask_hash() == wg.mask_hash());
+  for (size_t j0 : {size_t(0), size_t(10)}) {
+    const auto band = wg.band(j0, 5);
+    for (size_t j = 0; j < band.nj(); ++j) {
+      for (size_t i = 0; i < band.ni(); ++i) {
+        REQUIRE(band.masked_in(i, j) == wg.masked_in(i, j0 + j));
+      }
+    }
+  }
+
+  const auto &grid = wg.grid_positions();
+  const MetBuild::InterpolationData full(triangulation, grid);
+  const MetBuild::InterpolationData masked(
+      triangulation, grid, MetBuild::CONVENTION_180, false, wg.mask());
+
+  const auto &a = full.interpolation();
+  const auto &b = masked.interpolation();
+  size_t in = 0;
+  size_t out = 0;
+  for (size_t j = 0; j < wg.nj(); ++j) {
+    for (size_t i = 0; i < wg.ni(); ++i) {
+      if (!wg.masked_in(i, j)) {
+        REQUIRE_FALSE(b.valid(i, j));
+        out++;
+        continue;
+      }
+      REQUIRE(a.valid(i, j) == b.valid(i, j));
+      if (!a.valid(i, j)) continue;
+      REQUIRE(a.get(i, j).index() == b.get(i, j).index());
+      in++;
+    }
+  }
+  REQUIRE(in > 0);
+  REQUIRE(out > 0);
+
+  wg.clear_mask();
+  REQUIRE_FALSE(wg.has_mask());
+  REQUIRE(wg.masked_in(18, 21));
+}
+
+TEST_CASE("Aligned weights", "[Aligned weights]") {
+  const size_t ni = 21;
+  const size_t nj = 17;
+  std::vector<double> x, y;
+  std::vector<MetBuild::Point> boundary;
+  generate_grid(ni, nj, x, y, boundary);
+
+  //...Every other source node, starting from the third column and with the
+  // source latitudes running north to south
+  const auto wg = MetBuild::Grid(-99.5, 26.5, 7, 5, 0.5, 0.5, 0.0);
+  const auto &grid = wg.grid_positions();
+  const auto lattice = MetBuild::InterpolationData::aligned(x, y, ni, nj, grid);
+  REQUIRE(lattice.has_value());
+  REQUIRE(lattice->i0 == 2);
+  REQUIRE(lattice->j0 == 14);
+  REQUIRE(lattice->di == 2);
+  REQUIRE(lattice->dj == -2);
+
+  //...Grids between the nodes or leaving the source are not aligned
+  REQUIRE_FALSE(MetBuild::InterpolationData::aligned(
+      x, y, ni, nj,
+      MetBuild::Grid(-99.4, 26.5, 7, 5, 0.5, 0.5, 0.0).grid_positions()));
+  REQUIRE_FALSE(MetBuild::InterpolationData::aligned(
+      x, y, ni, nj,
+      MetBuild::Grid(-99.5, 26.5, 7, 5, 0.6, 0.5, 0.0).grid_positions()));
+  REQUIRE_FALSE(MetBuild::InterpolationData::aligned(
+      x, y, ni, nj,
+      MetBuild::Grid(-99.5, 26.5, 7, 5, 0.5, 1.0, 0.0).grid_positions()));
+
+  const auto triangulation = MetBuild::Triangulation::structured(x, y, ni, nj);
+  const MetBuild::InterpolationData located(triangulation, grid);
+  const MetBuild::InterpolationData aligned(*lattice, grid);
+  REQUIRE(aligned.lattice().has_value());
+  REQUIRE_FALSE(located.lattice().has_value());
+
+  std::vector<MetBuild::SourceDataType> values(x.size());
+  for (size_t k = 0; k < x.size(); ++k) {
+    values[k] = static_cast<MetBuild::SourceDataType>(2.0 * x[k] - 3.0 * y[k]);
+  }
+  const auto &a = located.interpolation();
+  const auto &b = aligned.interpolation();
+  const MetBuild::Kernel::WeightView view(b);
+  const MetBuild::Kernel::SourceField field{values.data(), 2.0};
+  const MetBuild::MeteorologicalDataType fill = -999.0;
+  for (size_t j = 0; j < wg.nj(); ++j) {
+    for (size_t i = 0; i < wg.ni(); ++i) {
+      REQUIRE(b.valid(i, j));
+      const auto w = b.get(i, j);
+      REQUIRE(w.index()[0] == lattice->source(j, i));
+      REQUIRE(w.weight()[0] == 1.0);
+      REQUIRE(std::abs(interpolate(a.get(i, j), x) -
+                       interpolate(w, x)) < 1e-9);
+    }
+
+    //...Copying a row matches gathering it through the weights
+    std::vector<MetBuild::MeteorologicalDataType> gathered(wg.ni());
+    std::vector<MetBuild::MeteorologicalDataType> copied(wg.ni());
+    auto *g = gathered.data();
+    auto *c = copied.data();
+    MetBuild::Kernel::interpolate_batch(j * wg.ni(), wg.ni(), view, &field, 1,
+                                        &fill, &g);
+    MetBuild::Kernel::copy_strided(j * wg.ni(), wg.ni(), view,
+                                   lattice->source(j, 0), lattice->di, &field,
+                                   1, &fill, &c);
+    REQUIRE(gathered == copied);
+  }
+
+  //...Masked out cells keep no weight and are filled by the copy
+  std::vector<uint8_t> mask(wg.ni() * wg.nj(), 1);
+  mask[3] = 0;
+  const MetBuild::InterpolationData masked(*lattice, grid,
+                                           MetBuild::CONVENTION_180, &mask);
+  const MetBuild::Kernel::WeightView masked_view(masked.interpolation());
+  REQUIRE_FALSE(masked.interpolation().valid(3, 0));
+  std::vector<MetBuild::MeteorologicalDataType> row(wg.ni());
+  auto *r = row.data();
+  MetBuild::Kernel::copy_strided(0, wg.ni(), masked_view, lattice->source(0, 0),
+                                 lattice->di, &field, 1, &fill, &r);
+  REQUIRE(row[3] == fill);
+  REQUIRE(row[2] != fill);
+}
+
+TEST_CASE("Connected locator", "[Connected locator]") {
+  //...A sheared grid, logically rectangular but not rectilinear
+  const size_t ni = 61;
+  const size_t nj = 41;
+  std::vector<double> x, y;
+  for (size_t j = 0; j < nj; ++j) {
+    for (size_t i = 0; i < ni; ++i) {
+      const double u = 0.25 * static_cast<double>(i);
+      const double v = 0.25 * static_cast<double>(j);
+      x.push_back(-100.0 + u + 0.1 * v);
+      y.push_back(20.0 + v + 0.05 * u);
+    }
+  }
+
+  std::vector<double> values(x.size());
+  for (size_t k = 0; k < x.size(); ++k) {
+    values[k] = 2.0 * x[k] - 3.0 * y[k] + 1.0;
+  }
+
+  const auto connected = MetBuild::Triangulation::connected(
+      x, y, ni, nj, {-95.0, 24.0, -90.0, 27.0});
+  for (double qx = -95.0; qx < -90.0; qx += 0.13) {
+    for (double qy = 24.0; qy < 27.0; qy += 0.11) {
+      const auto w = connected.getInterpolationFactors(qx, qy);
+      REQUIRE(MetBuild::InterpolationWeight::valid(
+          w, MetBuild::Triangulation::invalid_point()));
+      const auto expected = 2.0 * qx - 3.0 * qy + 1.0;
+      REQUIRE(std::abs(interpolate(w, values) - expected) < 1e-8);
+    }
+  }
+  REQUIRE_FALSE(MetBuild::InterpolationWeight::valid(
+      connected.getInterpolationFactors(-110.0, 25.0),
+      MetBuild::Triangulation::invalid_point()));
+
+  //...Global grids are closed across the longitude seam
+  const size_t gi = 360;
+  const size_t gj = 10;
+  std::vector<double> gx, gy;
+  for (size_t j = 0; j < gj; ++j) {
+    for (size_t i = 0; i < gi; ++i) {
+      gx.push_back(static_cast<double>(i));
+      gy.push_back(static_cast<double>(j));
+    }
+  }
+  const auto global = MetBuild::Triangulation::connected(
+      gx, gy, gi, gj, {0.0, 0.0, 360.0, 9.0});
+  const auto seam = global.getInterpolationFactors(359.5, 4.5);
+  REQUIRE(MetBuild::InterpolationWeight::valid(
+      seam, MetBuild::Triangulation::invalid_point()));
+  for (const auto index : seam.index()) {
+    REQUIRE((index % gi == 0 || index % gi == gi - 1));
+  }
+}
+
+TEST_CASE("Inverse distance locator", "[Inverse distance locator]") {
+  const size_t ni = 21;
+  const size_t nj = 17;
+  std::vector<double> x, y;
+  std::vector<MetBuild::Point> boundary;
+  generate_grid(ni, nj, x, y, boundary);
+
+  std::vector<double> values(x.size());
+  for (size_t k = 0; k < x.size(); ++k) values[k] = 5.0;
+
+  const auto triangulation = MetBuild::Triangulation(x, y, boundary);
+  const auto fallback =
+      MetBuild::Triangulation::with_fallback(triangulation, x, y, 0.5);
+  const auto idw = MetBuild::Triangulation::inverse_distance(x, y, 0.5);
+
+  //...Points inside the mesh keep their triangular weights
+  const auto inside = triangulation.getInterpolationFactors(-97.4, 27.3);
+  const auto kept = fallback.getInterpolationFactors(-97.4, 27.3);
+  REQUIRE(inside.index() == kept.index());
+  REQUIRE(inside.weight() == kept.weight());
+
+  //...Points just outside the hull are weighted by distance, points far
+  // from it are not
+  REQUIRE_FALSE(MetBuild::InterpolationWeight::valid(
+      triangulation.getInterpolationFactors(-100.2, 27.3),
+      MetBuild::Triangulation::invalid_point()));
+  const auto near = fallback.getInterpolationFactors(-100.2, 27.3);
+  REQUIRE(MetBuild::InterpolationWeight::valid(
+      near, MetBuild::Triangulation::invalid_point()));
+  REQUIRE(std::abs(interpolate(near, values) - 5.0) < 1e-12);
+  REQUIRE(near.weight()[0] >= near.weight()[1]);
+  REQUIRE_FALSE(MetBuild::InterpolationWeight::valid(
+      fallback.getInterpolationFactors(-110.0, 27.3),
+      MetBuild::Triangulation::invalid_point()));
+
+  //...A point on a source point takes its value
+  const auto exact = idw.getInterpolationFactors(x[25], y[25]);
+  REQUIRE(exact.index()[0] == 25);
+  REQUIRE(exact.weight()[0] == 1.0);
+}
+
+TEST_CASE("Nearest neighbour locator", "[Nearest neighbour locator]") {
+  const size_t ni = 21;
+  const size_t nj = 17;
+  std::vector<double> x, y;
+  std::vector<MetBuild::Point> boundary;
+  generate_grid(ni, nj, x, y, boundary);
+
+  const auto triangulation = MetBuild::Triangulation(x, y, boundary);
+  const auto nearest = MetBuild::Triangulation::nearest(triangulation);
+
+  //...Every point takes the whole value of the nearest corner
+  for (const auto &p : {MetBuild::Point(-97.4, 27.3),
+                        MetBuild::Point(-98.93, 26.07)}) {
+    const auto w = nearest.getInterpolationFactors(p.x(), p.y());
+    REQUIRE(MetBuild::InterpolationWeight::valid(
+        w, MetBuild::Triangulation::invalid_point()));
+    REQUIRE(w.weight()[0] == 1.0);
+    REQUIRE(w.weight()[1] == 0.0);
+    REQUIRE(w.weight()[2] == 0.0);
+    const auto k = w.index()[0];
+    const double d = std::hypot(x[k] - p.x(), y[k] - p.y());
+    const auto corners = triangulation.getInterpolationFactors(p.x(), p.y());
+    for (const auto c : corners.index()) {
+      REQUIRE(d <= std::hypot(x[c] - p.x(), y[c] - p.y()) + 1e-12);
+    }
+  }
+
+  //...Points outside the source stay invalid, also when located as a row
+  REQUIRE_FALSE(MetBuild::InterpolationWeight::valid(
+      nearest.getInterpolationFactors(-110.0, 27.3),
+      MetBuild::Triangulation::invalid_point()));
+  std::vector<MetBuild::InterpolationWeight> row;
+  nearest.getInterpolationFactors(
+      {MetBuild::Point(-97.4, 27.3), MetBuild::Point(-110.0, 27.3)}, row);
+  REQUIRE(row.size() == 2);
+  REQUIRE(row[0].index() ==
+          nearest.getInterpolationFactors(-97.4, 27.3).index());
+  REQUIRE_FALSE(MetBuild::InterpolationWeight::valid(
+      row[1], MetBuild::Triangulation::invalid_point()));
+}
+
+TEST_CASE("Nested locator", "[Nested locator]") {
+  //...Outer nest at 0.25 degrees holding an inner nest at 0.125 degrees,
+  // with the outer points covered by the inner nest dropped
+  auto make_nest = [](double x0, double y0, double step, size_t n) {
+    MetBuild::Triangulation::Nest nest{{}, {}, n, n, {}};
+    for (size_t j = 0; j < n; ++j) {
+      for (size_t i = 0; i < n; ++i) {
+        nest.x.push_back(x0 + step * static_cast<double>(i));
+        nest.y.push_back(y0 + step * static_cast<double>(j));
+      }
+    }
+    return nest;
+  };
+  std::vector<MetBuild::Triangulation::Nest> nests = {
+      make_nest(-100.0, 25.0, 0.25, 21), make_nest(-98.0, 27.0, 0.125, 9)};
+
+  std::vector<double> x, y;
+  for (auto &n : nests) {
+    const bool outer = &n == &nests.front();
+    for (size_t p = 0; p < n.x.size(); ++p) {
+      const bool covered = outer && n.x[p] >= -98.0 && n.x[p] <= -97.0 &&
+                           n.y[p] >= 27.0 && n.y[p] <= 28.0;
+      if (covered) {
+        n.index.push_back(MetBuild::Triangulation::invalid_point());
+        continue;
+      }
+      n.index.push_back(x.size());
+      x.push_back(n.x[p]);
+      y.push_back(n.y[p]);
+    }
+  }
+  const auto &o = nests.front();
+  std::vector<MetBuild::Point> boundary;
+  for (size_t i = 0; i < o.ni; ++i) boundary.emplace_back(o.x[i], o.y[i]);
+  for (size_t j = 1; j < o.nj; ++j)
+    boundary.emplace_back(o.x[j * o.ni + o.ni - 1], o.y[j * o.ni + o.ni - 1]);
+  for (size_t i = 1; i < o.ni; ++i) {
+    const auto k = o.ni * o.nj - 1 - i;
+    boundary.emplace_back(o.x[k], o.y[k]);
+  }
+  for (size_t j = o.nj - 2; j > 0; --j)
+    boundary.emplace_back(o.x[j * o.ni], o.y[j * o.ni]);
+
+  std::vector<double> values(x.size());
+  for (size_t k = 0; k < x.size(); ++k) {
+    values[k] = 2.0 * x[k] - 3.0 * y[k] + 1.0;
+  }
+
+  const auto nested = MetBuild::Triangulation::nested(nests, x, y, boundary);
+  const auto reference = MetBuild::Triangulation(x, y, boundary);
+  constexpr auto invalid = MetBuild::Triangulation::invalid_point();
+
+  size_t inner = 0;
+  for (double qx = -99.95; qx < -95.0; qx += 0.0731) {
+    for (double qy = 25.05; qy < 30.0; qy += 0.0677) {
+      const auto w = nested.getInterpolationFactors(qx, qy);
+      REQUIRE(MetBuild::InterpolationWeight::valid(w, invalid));
+      REQUIRE(std::abs(interpolate(w, values) - (2.0 * qx - 3.0 * qy + 1.0)) <
+              1e-8);
+      //...Inside the inner nest the weights come from its own points
+      if (qx > -98.0 && qx < -97.0 && qy > 27.0 && qy < 28.0) {
+        const auto r = reference.getInterpolationFactors(qx, qy);
+        for (size_t k = 0; k < 3; ++k) {
+          REQUIRE(x[w.index()[k]] >= -98.0);
+          REQUIRE(x[w.index()[k]] <= -97.0);
+        }
+        REQUIRE(interpolate(w, values) == Approx(interpolate(r, values)));
+        inner++;
+      }
+    }
+  }
+  REQUIRE(inner > 0);
+
+  REQUIRE_FALSE(MetBuild::InterpolationWeight::valid(
+      nested.getInterpolationFactors(-101.0, 27.0), invalid));
+  REQUIRE_FALSE(MetBuild::InterpolationWeight::valid(
+      nested.getInterpolationFactors(-97.5, 31.0), invalid));
+
+  const auto copy = nested;
+  REQUIRE(copy.getInterpolationFactors(-97.51, 27.49).index() ==
+          nested.getInterpolationFactors(-97.51, 27.49).index());
+}
+
+TEST_CASE("Array source", "[Array source]") {
+  using MetBuild::GriddedDataTypes::VAR_PRESSURE;
+  using MetBuild::GriddedDataTypes::VAR_U10;
+  const size_t ni = 9;
+  const size_t nj = 7;
+  std::vector<double> x, y, u;
+  std::vector<float> p;
+  for (size_t j = 0; j < nj; ++j) {
+    for (size_t i = 0; i < ni; ++i) {
+      x.push_back(-90.0 + 0.5 * static_cast<double>(i));
+      y.push_back(25.0 + 0.5 * static_cast<double>(j));
+      p.push_back(101300.0f - static_cast<float>(10 * i));
+      u.push_back(static_cast<double>(j));
+    }
+  }
+
+  const std::string name = "memory://array_source_test";
+  REQUIRE_FALSE(MetBuild::ArrayData::contains(name));
+  REQUIRE(MetBuild::ArrayData::generation(name) == 0);
+  REQUIRE_THROWS(MetBuild::ArrayData(name));
+
+  MetBuild::ArrayData::Arrays arrays;
+  arrays.ni = ni;
+  arrays.nj = nj;
+  arrays.longitude = x.data();
+  arrays.latitude = y.data();
+  arrays.set(VAR_PRESSURE, p.data());
+  arrays.set(VAR_U10, u.data());
+  MetBuild::ArrayData::add(name, arrays);
+  REQUIRE(MetBuild::ArrayData::contains(name));
+  const auto generation = MetBuild::ArrayData::generation(name);
+  REQUIRE(generation != 0);
+
+  MetBuild::ArrayData data(name);
+  REQUIRE(data.ni() == static_cast<long>(ni));
+  REQUIRE(data.nj() == static_cast<long>(nj));
+  REQUIRE(data.size() == ni * nj);
+  REQUIRE(data.longitude1d() == x);
+  REQUIRE(data.latitude1d() == y);
+  REQUIRE(data.bottom_left().x() == Approx(-90.0));
+  REQUIRE(data.top_right().y() == Approx(28.0));
+  REQUIRE(data.bounding_region().size() == 2 * (ni + nj) - 4);
+  REQUIRE(data.point_inside(MetBuild::Point(-88.0, 26.5)));
+  REQUIRE_FALSE(data.point_inside(MetBuild::Point(-80.0, 26.5)));
+
+  //...Values are read from the caller buffers in the source precision,
+  // with pressure scaled from Pa to mb as the grib sources are
+  const auto &pressure = data.variable1d(VAR_PRESSURE);
+  const auto &wind = data.variable1d(VAR_U10);
+  REQUIRE(data.fieldScaling(VAR_PRESSURE) == Approx(0.01));
+  REQUIRE(data.fieldScaling(VAR_U10) == 1.0);
+  for (size_t k = 0; k < ni * nj; ++k) {
+    REQUIRE(pressure[k] == Approx(0.01 * p[k]));
+    REQUIRE(wind[k] == Approx(u[k]));
+  }
+  REQUIRE_THROWS(data.variable1d(MetBuild::GriddedDataTypes::VAR_ICE));
+
+  const auto locator = data.generate_triangulation({-90.0, 25.0, -86.0, 28.0});
+  const auto w = locator.getInterpolationFactors(-88.1, 26.3);
+  double value = 0.0;
+  for (size_t k = 0; k < 3; ++k) {
+    value += w.weight()[k] * u[w.index()[k]];
+  }
+  REQUIRE(value == Approx(2.6));
+
+  const auto probe = MetBuild::ArrayData::probe(name);
+  REQUIRE(probe.ni == ni);
+  REQUIRE(probe.nj == nj);
+  REQUIRE(probe.dx == Approx(0.5));
+  REQUIRE(probe.contains(VAR_PRESSURE));
+  REQUIRE_FALSE(probe.contains(MetBuild::GriddedDataTypes::VAR_V10));
+
+  //...Registering again under the same name is told apart, and sources
+  // already built keep reading the arrays they were built from
+  MetBuild::ArrayData::add(name, arrays);
+  REQUIRE(MetBuild::ArrayData::generation(name) > generation);
+  MetBuild::ArrayData::remove(name);
+  REQUIRE_FALSE(MetBuild::ArrayData::contains(name));
+  REQUIRE(data.variable1d(VAR_U10)[ni] == Approx(1.0));
+
+  arrays.longitude = nullptr;
+  REQUIRE_THROWS(MetBuild::ArrayData::add(name, arrays));
+}
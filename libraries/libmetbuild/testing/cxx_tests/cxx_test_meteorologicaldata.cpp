@@ -0,0 +1,241 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "BufferPool.h"
+#include "Instrumentation.h"
+#include "InterpolationWeights.h"
+#include "MemoryPolicy.h"
+#include "MeteorologicalData.h"
+#include "Metrics.h"
+#include "catch.hpp"
+
+TEST_CASE("Meteorological data indexing", "[Meteorological data]") {
+  const size_t ni = 7;
+  const size_t nj = 3;
+  MetBuild::MeteorologicalData<3> data(ni, nj);
+
+  for (size_t j = 0; j < nj; ++j) {
+    for (size_t i = 0; i < ni; ++i) {
+      data.setPack(i, j, {static_cast<float>(i), static_cast<float>(j),
+                          static_cast<float>(i * j)});
+    }
+  }
+
+  for (size_t j = 0; j < nj; ++j) {
+    const auto row = data.row(2, j);
+    REQUIRE(row.size() == ni);
+    for (size_t i = 0; i < ni; ++i) {
+      REQUIRE(data.get(0, i, j) == static_cast<float>(i));
+      REQUIRE(data.get(1, i, j) == static_cast<float>(j));
+      REQUIRE(data.getPack(i, j)[2] == static_cast<float>(i * j));
+      REQUIRE(row[i] == static_cast<float>(i * j));
+      REQUIRE(data[1][j][i] == static_cast<float>(j));
+    }
+  }
+
+  data.set(1, 2, 1, 42.0);
+  REQUIRE(data.row(1, 1)[2] == 42.0f);
+  REQUIRE(data.get(1, 2, 1) == 42.0f);
+
+  auto row = data.row(0, 1);
+  std::fill(row.begin(), row.end(), 5.0f);
+  REQUIRE(data.get(0, 0, 1) == 5.0f);
+  REQUIRE(data.get(0, ni - 1, 1) == 5.0f);
+  REQUIRE(data.get(0, 0, 0) == 0.0f);
+  REQUIRE(data.toVector(0)[ni] == 5.0f);
+  REQUIRE(data.parameter(0).data() + ni == row.data());
+}
+
+TEST_CASE("Constant fields", "[Meteorological data]") {
+  MetBuild::MeteorologicalData<3> data(4, 3);
+  REQUIRE_FALSE(data.constant(0));
+
+  data.fill_parameter(0, 0.0);
+  data.fill_parameter(2, 1013.0);
+  REQUIRE(data.constant(0));
+  REQUIRE_FALSE(data.constant(1));
+  REQUIRE(data.constant(2));
+
+  auto moved = std::move(data);
+  REQUIRE(moved.constant(0));
+  const auto copy = moved;
+  REQUIRE(copy.constant(2));
+
+  //...Any view that may write the values clears the flag
+  moved.set(0, 1, 1, 5.0);
+  REQUIRE_FALSE(moved.constant(0));
+  REQUIRE(moved.constant(2));
+  (void)moved.row(2, 0);
+  REQUIRE_FALSE(moved.constant(2));
+
+  moved.fill(-999.0);
+  REQUIRE(moved.constant(1));
+  moved.resize(2, 2);
+  REQUIRE_FALSE(moved.constant(1));
+}
+
+TEST_CASE("Buffer pool recycling", "[Meteorological data]") {
+  MetBuild::BufferPool pool(2);
+  REQUIRE(pool.acquire<double>().capacity() == 0);
+
+  std::vector<double> small(100, 1.0);
+  std::vector<double> large(1000, 2.0);
+  const auto *large_data = large.data();
+  pool.release(std::move(small));
+  pool.release(std::move(large));
+  pool.release(std::vector<double>(10));
+  REQUIRE(pool.size<double>() == 2);
+  REQUIRE(pool.size<float>() == 0);
+
+  //...The largest buffer is handed out first, emptied but with its storage
+  auto buffer = pool.acquire<double>();
+  REQUIRE(buffer.empty());
+  REQUIRE(buffer.capacity() >= 1000);
+  buffer.resize(1000);
+  REQUIRE(buffer.data() == large_data);
+  REQUIRE(pool.acquire<double>().capacity() >= 100);
+  REQUIRE(pool.size<double>() == 0);
+
+  pool.release(std::vector<float>(50));
+  REQUIRE(pool.acquire<float>().capacity() >= 50);
+}
+
+TEST_CASE("Memory accounting", "[Meteorological data]") {
+  using MetBuild::Instrumentation;
+  const auto before = Instrumentation::report().bytes(
+      Instrumentation::OUTPUT_MEMORY);
+  {
+    MetBuild::MeteorologicalData<3> data(100, 50);
+    const auto held = Instrumentation::report();
+    REQUIRE(held.bytes(Instrumentation::OUTPUT_MEMORY) ==
+            before + 3 * 100 * 50 * sizeof(MetBuild::MeteorologicalDataType));
+    REQUIRE(held.peak_bytes(Instrumentation::OUTPUT_MEMORY) >=
+            held.bytes(Instrumentation::OUTPUT_MEMORY));
+
+    auto copy = data;
+    REQUIRE(Instrumentation::report().bytes(Instrumentation::OUTPUT_MEMORY) ==
+            before +
+                6 * 100 * 50 * sizeof(MetBuild::MeteorologicalDataType));
+  }
+  const auto after = Instrumentation::report();
+  REQUIRE(after.bytes(Instrumentation::OUTPUT_MEMORY) == before);
+  REQUIRE(after.process_peak_rss() > 0);
+}
+
+TEST_CASE("Hardware counters", "[Meteorological data]") {
+  using MetBuild::Instrumentation;
+  Instrumentation::set_counter_sampling(true);
+  const auto before = Instrumentation::report();
+  volatile double sum = 0.0;
+  {
+    Instrumentation::ScopedTimer timer(Instrumentation::INTERPOLATE);
+    for (int i = 0; i < 1000000; ++i) sum = sum + 0.5 * i;
+  }
+  Instrumentation::set_counter_sampling(false);
+  const auto r = Instrumentation::report().since(before);
+  REQUIRE(Instrumentation::counter_names().size() ==
+          Instrumentation::N_COUNTERS);
+  if (Instrumentation::counters_available()) {
+    REQUIRE(r.counter(Instrumentation::INTERPOLATE, Instrumentation::CYCLES) >
+            0);
+    REQUIRE(r.instructions_per_cycle(Instrumentation::INTERPOLATE) > 0.0);
+  } else {
+    REQUIRE(r.counter(Instrumentation::INTERPOLATE,
+                      Instrumentation::INSTRUCTIONS) == 0);
+  }
+  REQUIRE(r.counter(Instrumentation::DECODE, Instrumentation::CYCLES) == 0);
+}
+
+TEST_CASE("Prometheus metrics", "[Meteorological data]") {
+  using MetBuild::Instrumentation;
+  const auto before = Instrumentation::report();
+  Instrumentation::count_event(Instrumentation::WEIGHT_LOADED, 2);
+  Instrumentation::count(Instrumentation::FILE_WRITE, 4096);
+  REQUIRE(Instrumentation::report().since(before).events(
+              Instrumentation::WEIGHT_LOADED) == 2);
+
+  MetBuild::Metrics::set_gauge("metget_queue_depth", "Requests waiting", 3);
+  MetBuild::Metrics::record_build(Instrumentation::report().since(before),
+                                  2.0);
+  const auto text = MetBuild::Metrics::render();
+  const auto has = [&](const std::string &line) {
+    return text.find(line + "\n") != std::string::npos;
+  };
+  REQUIRE(has("# TYPE metbuild_weight_cache_requests_total counter"));
+  REQUIRE(has("metbuild_weight_cache_requests_total{result=\"loaded\"} " +
+              std::to_string(before.events(Instrumentation::WEIGHT_LOADED) +
+                             2)));
+  REQUIRE(has("metbuild_last_build_output_bytes_per_second 2048"));
+  REQUIRE(has("# TYPE metget_queue_depth gauge"));
+  REQUIRE(has("metget_queue_depth 3"));
+  REQUIRE(text.find("metbuild_stage_items_total{stage=\"decode\"}") !=
+          std::string::npos);
+}
+
+TEST_CASE("Large buffer placement", "[Meteorological data]") {
+  using MetBuild::MemoryPolicy;
+  const auto huge_pages = MemoryPolicy::hugePages();
+  const auto first_touch = MemoryPolicy::firstTouch();
+
+  //...Large buffers are filled the same whichever policy places them
+  for (const auto mode :
+       {MemoryPolicy::HUGE_PAGES_OFF, MemoryPolicy::HUGE_PAGES_TRANSPARENT,
+        MemoryPolicy::HUGE_PAGES_EXPLICIT}) {
+    MemoryPolicy::setHugePages(mode);
+    MemoryPolicy::setFirstTouch(mode != MemoryPolicy::HUGE_PAGES_OFF);
+
+    MetBuild::MeteorologicalData<3> data(1000, 700);
+#ifdef __linux__
+    REQUIRE(reinterpret_cast<uintptr_t>(data.parameter(0).data()) %
+                MemoryPolicy::largeBufferSize() ==
+            0);
+#endif
+    for (size_t p = 0; p < 3; ++p) {
+      const auto v = data.parameter(p);
+      REQUIRE(std::all_of(v.begin(), v.end(), [&](const float value) {
+        return value == data.flag_value();
+      }));
+    }
+    data.fill_all(1.0f);
+    REQUIRE(data.get(2, 999, 699) == 1.0f);
+
+    MetBuild::InterpolationWeights weights(1000, 700);
+    REQUIRE_FALSE(weights.valid(999, 699));
+    REQUIRE(weights.index(2)[weights.size() - 1] ==
+            MetBuild::InterpolationWeights::invalid_index());
+    REQUIRE(weights.weight(1)[weights.size() / 2] == 0);
+  }
+
+  MemoryPolicy::setHugePages(huge_pages);
+  MemoryPolicy::setFirstTouch(first_touch);
+}
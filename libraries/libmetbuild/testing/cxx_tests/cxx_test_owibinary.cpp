@@ -0,0 +1,450 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Date.h"
+#include "Grid.h"
+#include "MeteorologicalData.h"
+#include "RequestEstimate.h"
+#include "ThreadPool.h"
+#include "allocation_counter.h"
+#include "catch.hpp"
+#include "output/OutputFanout.h"
+#include "output/OutputGroup.h"
+#include "output/OwiAscii.h"
+#include "output/OwiBinary.h"
+#include "output/ShardedOutput.h"
+#include "test_utilities.h"
+
+using MetBuild::Testing::sample;
+
+TEST_CASE("OWI binary round trip", "[owibinary]") {
+  using Header = MetBuild::OwiBinaryDomain::FileHeader;
+  using Record = MetBuild::OwiBinaryDomain::RecordHeader;
+
+  const auto grid = MetBuild::Grid(-100.0, 20.0, -90.0, 30.0, 0.5, 0.25);
+  const MetBuild::Date start(2023, 6, 1, 0, 0, 0);
+  const MetBuild::Date end(2023, 6, 1, 2, 0, 0);
+  const std::string pressure_file = "owibinary_test.pre";
+  const std::string wind_file = "owibinary_test.wnd";
+
+  MetBuild::MeteorologicalData<3> data(grid.ni(), grid.nj());
+  {
+    MetBuild::OwiBinary output(start, end, 3600);
+    output.addDomain(grid, {pressure_file, wind_file});
+    for (int snap = 0; snap < 3; ++snap) {
+      for (size_t j = 0; j < grid.nj(); ++j) {
+        for (size_t i = 0; i < grid.ni(); ++i) {
+          for (size_t k = 0; k < 3; ++k) {
+            data.set(k, i, j, sample(snap, k, j, i));
+          }
+        }
+      }
+      output.write(start + snap * 3600, 0, data);
+    }
+  }
+
+  const size_t cells = grid.ni() * grid.nj();
+  for (const auto &file : {pressure_file, wind_file}) {
+    const bool wind = file == wind_file;
+    FILE *f = std::fopen(file.c_str(), "rb");
+    REQUIRE(f != nullptr);
+
+    Header header{};
+    REQUIRE(std::fread(&header, sizeof(header), 1, f) == 1);
+    REQUIRE(std::string(header.magic, 4) == "OWIB");
+    REQUIRE(header.version == MetBuild::OwiBinaryDomain::c_version);
+    REQUIRE(header.fields == (wind ? 2u : 1u));
+    REQUIRE(header.start == 2023060100);
+    REQUIRE(header.end == 2023060102);
+
+    std::vector<float> values(header.fields * cells);
+    for (int snap = 0; snap < 3; ++snap) {
+      Record record{};
+      REQUIRE(std::fread(&record, sizeof(record), 1, f) == 1);
+      REQUIRE(record.ilat == static_cast<int32_t>(grid.nj()));
+      REQUIRE(record.ilong == static_cast<int32_t>(grid.ni()));
+      REQUIRE(record.dx == Approx(0.5));
+      REQUIRE(record.dy == Approx(0.25));
+      REQUIRE(record.swlat == Approx(grid.bottom_left().y()));
+      REQUIRE(record.swlon == Approx(grid.bottom_left().x()));
+      REQUIRE(record.dt == 202306010000 + snap * 100);
+      REQUIRE(std::fread(values.data(), sizeof(float), values.size(), f) ==
+              values.size());
+      for (size_t k = 0; k < header.fields; ++k) {
+        const size_t field = wind ? k : 2;
+        for (size_t c = 0; c < cells; ++c) {
+          REQUIRE(values[k * cells + c] ==
+                  sample(snap, field, c / grid.ni(), c % grid.ni()));
+        }
+      }
+    }
+    char extra;
+    REQUIRE(std::fread(&extra, 1, 1, f) == 0);
+    std::fclose(f);
+    std::remove(file.c_str());
+  }
+}
+
+TEST_CASE("Progressive publication", "[owibinary]") {
+  using Header = MetBuild::OwiBinaryDomain::FileHeader;
+  using Record = MetBuild::OwiBinaryDomain::RecordHeader;
+
+  const auto grid = MetBuild::Grid(-100.0, 20.0, -90.0, 30.0, 0.5, 0.25);
+  const MetBuild::Date start(2023, 6, 1, 0, 0, 0);
+  const MetBuild::Date end(2023, 6, 1, 5, 0, 0);
+  const std::string pressure_file = "owibinary_publish_test.pre";
+  const std::string wind_file = "owibinary_publish_test.wnd";
+  const std::string manifest = "owibinary_publish_test.json";
+
+  std::vector<MetBuild::Date> published;
+  MetBuild::MeteorologicalData<3> data(grid.ni(), grid.nj());
+  {
+    MetBuild::OwiBinary output(start, end, 3600);
+    output.addDomain(grid, {pressure_file, wind_file});
+    output.set_publication(manifest, 2);
+    output.set_publish_callback(
+        [&](const MetBuild::Date &date) { published.push_back(date); });
+    REQUIRE(output.published_through().toSeconds() ==
+            (start - 3600).toSeconds());
+
+    for (int snap = 0; snap < 6; ++snap) {
+      for (size_t j = 0; j < grid.nj(); ++j) {
+        for (size_t i = 0; i < grid.ni(); ++i) {
+          for (size_t k = 0; k < 3; ++k) {
+            data.set(k, i, j, sample(snap, k, j, i));
+          }
+        }
+      }
+      output.write(start + snap * 3600, 0, data);
+    }
+    REQUIRE(output.published_through().toSeconds() ==
+            (start + 5 * 3600).toSeconds());
+  }
+
+  REQUIRE(published.size() == 3);
+  REQUIRE(published[0].toSeconds() == (start + 3600).toSeconds());
+  REQUIRE(published[1].toSeconds() == (start + 3 * 3600).toSeconds());
+  REQUIRE(published[2].toSeconds() == (start + 5 * 3600).toSeconds());
+
+  const size_t cells = grid.ni() * grid.nj();
+  const auto wind_bytes =
+      sizeof(Header) + 6 * (sizeof(Record) + 2 * cells * sizeof(float));
+  std::ifstream f(manifest);
+  const std::string text((std::istreambuf_iterator<char>(f)),
+                         std::istreambuf_iterator<char>());
+  REQUIRE(text.find("\"published_through\": \"2023-06-01T05:00:00Z\"") !=
+          std::string::npos);
+  REQUIRE(text.find("{\"name\": \"" + wind_file +
+                    "\", \"bytes\": " + std::to_string(wind_bytes) + "}") !=
+          std::string::npos);
+
+  std::remove(pressure_file.c_str());
+  std::remove(wind_file.c_str());
+  std::remove(manifest.c_str());
+}
+
+TEST_CASE("Output group", "[owibinary]") {
+  using Header = MetBuild::OwiBinaryDomain::FileHeader;
+  using Record = MetBuild::OwiBinaryDomain::RecordHeader;
+
+  const auto grid = MetBuild::Grid(-100.0, 20.0, -90.0, 30.0, 0.5, 0.25);
+  const MetBuild::Date start(2023, 6, 1, 0, 0, 0);
+  const MetBuild::Date end(2023, 6, 1, 5, 0, 0);
+  const std::vector<std::string> first = {"owibinary_group_a.pre",
+                                          "owibinary_group_a.wnd"};
+  const std::vector<std::string> second = {"owibinary_group_b.pre",
+                                           "owibinary_group_b.wnd"};
+
+  MetBuild::MeteorologicalData<3> data(grid.ni(), grid.nj());
+  {
+    MetBuild::OwiBinary a(start, start + 3 * 3600, 3600);
+    MetBuild::OwiBinary b(start + 2 * 3600, end, 3600);
+    a.addDomain(grid, first);
+    b.addDomain(grid, second);
+
+    MetBuild::OutputGroup group(start, end, 3600);
+    REQUIRE(group.add(&a) == 0);
+    REQUIRE(group.add(&b) == 1);
+    REQUIRE(group.size() == 2);
+    REQUIRE(group.filenames().size() == 4);
+
+    MetBuild::OwiBinary off_step(start + 1800, end, 3600);
+    REQUIRE_THROWS(group.add(&off_step));
+    MetBuild::OwiBinary other_step(start, end, 1800);
+    REQUIRE_THROWS(group.add(&other_step));
+
+    group.set_async(true);
+    for (int snap = 0; snap < 6; ++snap) {
+      for (size_t j = 0; j < grid.nj(); ++j) {
+        for (size_t i = 0; i < grid.ni(); ++i) {
+          for (size_t k = 0; k < 3; ++k) {
+            data.set(k, i, j, sample(snap, k, j, i));
+          }
+        }
+      }
+      for (size_t d = 0; d < group.size(); ++d) {
+        group.write(start + snap * 3600, d, data);
+      }
+    }
+    group.flush();
+  }
+
+  const size_t cells = grid.ni() * grid.nj();
+  const auto wind_bytes = [&](size_t records) {
+    return sizeof(Header) +
+           records * (sizeof(Record) + 2 * cells * sizeof(float));
+  };
+  std::ifstream fa(first[1], std::ios::binary | std::ios::ate);
+  std::ifstream fb(second[1], std::ios::binary | std::ios::ate);
+  REQUIRE(static_cast<size_t>(fa.tellg()) == wind_bytes(4));
+  REQUIRE(static_cast<size_t>(fb.tellg()) == wind_bytes(4));
+
+  for (const auto &f : first) std::remove(f.c_str());
+  for (const auto &f : second) std::remove(f.c_str());
+}
+
+TEST_CASE("Output fan-out", "[owibinary]") {
+  using Header = MetBuild::OwiBinaryDomain::FileHeader;
+  using Record = MetBuild::OwiBinaryDomain::RecordHeader;
+
+  const auto grid = MetBuild::Grid(-100.0, 20.0, -90.0, 30.0, 0.5, 0.25);
+  const MetBuild::Date start(2023, 6, 1, 0, 0, 0);
+  const MetBuild::Date end(2023, 6, 1, 5, 0, 0);
+  const std::vector<std::string> binary = {"owibinary_fanout.pre",
+                                           "owibinary_fanout.wnd"};
+  const std::vector<std::string> ascii = {"owiascii_fanout.pre",
+                                          "owiascii_fanout.wnd"};
+  const std::vector<std::string> late = {"owibinary_fanout_late.pre",
+                                         "owibinary_fanout_late.wnd"};
+
+  MetBuild::MeteorologicalData<3> data(grid.ni(), grid.nj());
+  {
+    MetBuild::OwiBinary a(start, end, 3600);
+    MetBuild::OwiAscii b(start, end, 3600);
+    MetBuild::OwiBinary c(start + 2 * 3600, end, 3600);
+    a.addDomain(grid, binary);
+    b.addDomain(grid, ascii);
+    c.addDomain(grid, late);
+
+    MetBuild::OutputFanout fanout(start, end, 3600);
+    fanout.add(&a);
+    fanout.add(&b);
+    fanout.add(&c);
+    REQUIRE(fanout.size() == 1);
+    REQUIRE(fanout.members() == 3);
+    REQUIRE(fanout.filenames().size() == 6);
+    REQUIRE_THROWS(fanout.addDomain(grid, binary));
+
+    MetBuild::OwiBinary empty(start, end, 3600);
+    REQUIRE_THROWS(fanout.add(&empty));
+    MetBuild::OwiBinary other_step(start, end, 1800);
+    REQUIRE_THROWS(fanout.add(&other_step));
+
+    fanout.set_async(true);
+    for (int snap = 0; snap < 6; ++snap) {
+      for (size_t j = 0; j < grid.nj(); ++j) {
+        for (size_t i = 0; i < grid.ni(); ++i) {
+          for (size_t k = 0; k < 3; ++k) {
+            data.set(k, i, j, sample(snap, k, j, i));
+          }
+        }
+      }
+      fanout.write(start + snap * 3600, 0, data);
+    }
+    REQUIRE_THROWS(fanout.write(start, 1, data));
+    fanout.flush();
+  }
+
+  const size_t cells = grid.ni() * grid.nj();
+  const auto wind_bytes = [&](size_t records) {
+    return sizeof(Header) +
+           records * (sizeof(Record) + 2 * cells * sizeof(float));
+  };
+  std::ifstream fa(binary[1], std::ios::binary | std::ios::ate);
+  std::ifstream fc(late[1], std::ios::binary | std::ios::ate);
+  REQUIRE(static_cast<size_t>(fa.tellg()) == wind_bytes(6));
+  REQUIRE(static_cast<size_t>(fc.tellg()) == wind_bytes(4));
+
+  //...The text output holds a header and a record for each snapshot
+  std::ifstream fb(ascii[1]);
+  const std::string text((std::istreambuf_iterator<char>(fb)),
+                         std::istreambuf_iterator<char>());
+  size_t records = 0;
+  for (size_t p = text.find("iLat="); p != std::string::npos;
+       p = text.find("iLat=", p + 1)) {
+    ++records;
+  }
+  REQUIRE(records == 6);
+
+  for (const auto *files : {&binary, &ascii, &late}) {
+    for (const auto &f : *files) std::remove(f.c_str());
+  }
+}
+
+TEST_CASE("Sharded output", "[owibinary]") {
+  using Header = MetBuild::OwiBinaryDomain::FileHeader;
+  using Record = MetBuild::OwiBinaryDomain::RecordHeader;
+
+  REQUIRE(MetBuild::ShardedOutput::shard_name("a/wind.pre", 1) ==
+          "a/wind_shard0001.pre");
+  REQUIRE(MetBuild::ShardedOutput::shard_name("wind.wnd.bin.gz", 12) ==
+          "wind_shard0012.wnd.bin.gz");
+  REQUIRE(MetBuild::ShardedOutput::shard_name("a.b/wind", 0) ==
+          "a.b/wind_shard0000");
+
+  const auto grid = MetBuild::Grid(-100.0, 20.0, -90.0, 30.0, 0.5, 0.25);
+  const MetBuild::Date start(2023, 6, 1, 0, 0, 0);
+  const MetBuild::Date end(2023, 6, 1, 5, 0, 0);
+  const std::vector<std::string> files = {"owibinary_shard_test.pre",
+                                          "owibinary_shard_test.wnd"};
+  const std::string manifest = "owibinary_shard_test.json";
+  const size_t cells = grid.ni() * grid.nj();
+
+  MetBuild::MeteorologicalData<3> data(grid.ni(), grid.nj());
+  for (const bool by_bytes : {false, true}) {
+    std::vector<std::string> written;
+    {
+      MetBuild::ShardedOutput output(start, end, 3600, "owi-binary", "");
+      if (by_bytes) {
+        output.set_shard_bytes(static_cast<size_t>(
+            2.5 * 3 * cells *
+            MetBuild::RequestEstimate::value_bytes("owi-binary")));
+      } else {
+        output.set_shard_hours(2.0);
+      }
+      output.set_manifest(manifest);
+      output.addDomain(grid, files);
+      output.set_async(true);
+      for (int snap = 0; snap < 6; ++snap) {
+        for (size_t j = 0; j < grid.nj(); ++j) {
+          for (size_t i = 0; i < grid.ni(); ++i) {
+            for (size_t k = 0; k < 3; ++k) {
+              data.set(k, i, j, sample(snap, k, j, i));
+            }
+          }
+        }
+        output.write(start + snap * 3600, 0, data);
+      }
+      output.flush();
+      REQUIRE(output.shard_records() == 2);
+      REQUIRE(output.shard_count() == 3);
+      written = output.filenames();
+    }
+
+    REQUIRE(written.size() == 6);
+    for (size_t s = 0; s < 3; ++s) {
+      const auto wind = MetBuild::ShardedOutput::shard_name(files[1], s);
+      REQUIRE(written[2 * s + 1] == wind);
+      FILE *f = std::fopen(wind.c_str(), "rb");
+      REQUIRE(f != nullptr);
+      Header header{};
+      REQUIRE(std::fread(&header, sizeof(header), 1, f) == 1);
+      REQUIRE(header.start == 2023060100 + 2 * s);
+      REQUIRE(header.end == 2023060101 + 2 * s);
+      Record record{};
+      REQUIRE(std::fread(&record, sizeof(record), 1, f) == 1);
+      REQUIRE(record.dt == 202306010000 + 200 * s);
+      std::fclose(f);
+
+      const auto bytes =
+          sizeof(Header) + 2 * (sizeof(Record) + 2 * cells * sizeof(float));
+      std::ifstream size(wind, std::ios::binary | std::ios::ate);
+      REQUIRE(static_cast<size_t>(size.tellg()) == bytes);
+    }
+
+    std::ifstream f(manifest);
+    const std::string text((std::istreambuf_iterator<char>(f)),
+                           std::istreambuf_iterator<char>());
+    REQUIRE(text.find("\"records_per_shard\": 2") != std::string::npos);
+    REQUIRE(text.find("{\"index\": 2, \"start\": \"2023-06-01T04:00:00Z\", "
+                      "\"end\": \"2023-06-01T05:00:00Z\", \"complete\": true, "
+                      "\"files\": [\"owibinary_shard_test_shard0002.pre\", "
+                      "\"owibinary_shard_test_shard0002.wnd\"]}") !=
+            std::string::npos);
+    REQUIRE(text.find("\"complete\": false") == std::string::npos);
+
+    for (const auto &w : written) std::remove(w.c_str());
+    std::remove(manifest.c_str());
+  }
+}
+
+TEST_CASE("Steady state writes do not allocate", "[owibinary]") {
+  //...Loop bookkeeping of a pool with workers is not part of the guarantee
+  MetBuild::ThreadPool::setDefaultThreadCount(1);
+
+  const auto grid = MetBuild::Grid(-100.0, 20.0, -90.0, 30.0, 0.5, 0.25);
+  const MetBuild::Date start(2023, 6, 1, 0, 0, 0);
+  const MetBuild::Date end(2023, 6, 1, 9, 0, 0);
+  const std::string pressure_file = "owibinary_alloc_test.pre";
+  const std::string wind_file = "owibinary_alloc_test.wnd";
+
+  MetBuild::MeteorologicalData<3> data(grid.ni(), grid.nj());
+  for (size_t j = 0; j < grid.nj(); ++j) {
+    for (size_t i = 0; i < grid.ni(); ++i) {
+      for (size_t k = 0; k < 3; ++k) data.set(k, i, j, sample(0, k, j, i));
+    }
+  }
+
+  //...Counted into an array so that checking does not allocate in the scope
+  const auto check = [&](MetBuild::OutputFile &output) {
+    output.addDomain(grid, {pressure_file, wind_file});
+    std::array<size_t, 10> counts{};
+    for (size_t snap = 0; snap < counts.size(); ++snap) {
+      const MetBuild::Testing::AllocationScope scope;
+      output.write(start + static_cast<int>(snap) * 3600, 0, data);
+      counts[snap] = scope.count();
+    }
+    //...The first writes size the buffers that every later write reuses
+    for (size_t snap = 2; snap < counts.size(); ++snap) {
+      INFO("snap " << snap);
+      REQUIRE(counts[snap] == 0);
+    }
+  };
+
+  for (const bool async : {false, true}) {
+    {
+      MetBuild::OwiBinary output(start, end, 3600);
+      output.set_async(async);
+      check(output);
+    }
+    {
+      MetBuild::OwiAscii output(start, end, 3600);
+      output.set_async(async);
+      check(output);
+    }
+  }
+  std::remove(pressure_file.c_str());
+  std::remove(wind_file.c_str());
+}
@@ -0,0 +1,390 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Grid.h"
+#include "InterpolationCache.h"
+#include "InterpolationWeights.h"
+#include "MappedFile.h"
+#include "SharedFieldStore.h"
+#include "SnapshotCache.h"
+#include "SnapshotStore.h"
+#include "WeightFile.h"
+#include "boost/filesystem.hpp"
+#include "catch.hpp"
+
+TEST_CASE("Snapshot cache round trip", "[snapshotcache]") {
+  const std::string directory = "snapshot_cache_test";
+  const std::string source = "snapshot_cache_source.bin";
+  boost::filesystem::remove_all(directory);
+  {
+    std::ofstream f(source, std::ios::binary);
+    f << "source file contents";
+  }
+
+  const auto grid = MetBuild::Grid(-100.0, 20.0, -90.0, 30.0, 0.5, 0.5);
+  const size_t n = grid.ni() * grid.nj();
+
+  MetBuild::InterpolationWeights weights(grid.ni(), grid.nj());
+  for (size_t i = 0; i < grid.ni(); i += 2) {
+    weights.set(i, 0,
+                MetBuild::InterpolationWeight({0, 1, 2}, {0.5, 0.25, 0.25}));
+  }
+  weights.update_mask();
+
+  std::vector<MetBuild::SnapshotCache::Field> fields;
+  for (int p = 0; p < 3; ++p) {
+    fields.push_back({0, p, std::vector<MetBuild::MeteorologicalDataType>(n)});
+    for (size_t c = 0; c < n; ++c) {
+      fields.back().values[c] = static_cast<float>(p * 1000 + c);
+    }
+  }
+
+  MetBuild::SnapshotCache::setDirectory("");
+  REQUIRE_FALSE(MetBuild::SnapshotCache::enabled());
+  const auto key =
+      MetBuild::SnapshotCache::key({source}, grid.fingerprint(), 1);
+  REQUIRE(MetBuild::SnapshotCache::load(key) == nullptr);
+
+  //...Remote files are keyed by url, without the credentials of the query
+  const std::string url = "https://bucket.s3.amazonaws.com/coamps.nc";
+  REQUIRE(MetBuild::SnapshotCache::key({url + "?X-Amz-Signature=1"},
+                                       grid.fingerprint(), 1) ==
+          MetBuild::SnapshotCache::key({url + "?X-Amz-Signature=2"},
+                                       grid.fingerprint(), 1));
+  REQUIRE(MetBuild::SnapshotCache::key({url}, grid.fingerprint(), 1) != key);
+
+  MetBuild::SnapshotCache::setDirectory(directory);
+  REQUIRE(MetBuild::SnapshotCache::load(key) == nullptr);
+  MetBuild::SnapshotCache::store(key, weights, fields);
+
+  const auto entry = MetBuild::SnapshotCache::load(key);
+  REQUIRE(entry != nullptr);
+  REQUIRE(entry->weights->ni() == grid.ni());
+  REQUIRE(entry->weights->nj() == grid.nj());
+  for (size_t c = 0; c < n; ++c) {
+    REQUIRE(entry->weights->valid(c) == weights.valid(c));
+  }
+  REQUIRE(entry->fields.size() == 3);
+  for (int p = 0; p < 3; ++p) {
+    REQUIRE(entry->fields[p].type == 0);
+    REQUIRE(entry->fields[p].parameter == p);
+    REQUIRE(entry->fields[p].values == fields[p].values);
+  }
+
+  //...The key follows the contents of the source and the settings
+  REQUIRE(MetBuild::SnapshotCache::key({source}, grid.fingerprint(), 2) != key);
+  {
+    std::ofstream f(source, std::ios::binary);
+    f << "changed source file contents";
+  }
+  MetBuild::MappedFile::clear();
+  REQUIRE(MetBuild::SnapshotCache::key({source}, grid.fingerprint(), 1) != key);
+
+  MetBuild::SnapshotCache::setDirectory("");
+  boost::filesystem::remove_all(directory);
+  boost::filesystem::remove(source);
+}
+
+TEST_CASE("Snapshot cache budget", "[snapshotcache]") {
+  const std::string directory = "snapshot_cache_budget_test";
+  boost::filesystem::remove_all(directory);
+  MetBuild::SnapshotCache::setDirectory(directory);
+
+  MetBuild::InterpolationWeights weights(16, 16);
+  weights.update_mask();
+  const std::vector<MetBuild::SnapshotCache::Field> fields = {
+      {0, 0, std::vector<MetBuild::MeteorologicalDataType>(256, 1.0)}};
+
+  auto path = [&](const std::string &key) {
+    return (boost::filesystem::path(directory) / ("snapshot_" + key + ".bin"))
+        .string();
+  };
+  auto age = [&](const std::string &key, std::time_t seconds) {
+    boost::filesystem::last_write_time(path(key),
+                                       std::time(nullptr) - seconds);
+  };
+
+  MetBuild::SnapshotCache::store("first", weights, fields);
+  age("first", 100);
+  MetBuild::SnapshotCache::store("second", weights, fields);
+  age("second", 50);
+  const auto size = boost::filesystem::file_size(path("first"));
+
+  //...Reading the first snapshot makes the second the least recently used,
+  // so it is the one removed when the third goes over the budget
+  REQUIRE(MetBuild::SnapshotCache::load("first") != nullptr);
+  MetBuild::SnapshotCache::setBudget(2 * size + size / 2);
+  MetBuild::SnapshotCache::store("third", weights, fields);
+  REQUIRE(MetBuild::SnapshotCache::load("first") != nullptr);
+  REQUIRE(MetBuild::SnapshotCache::load("second") == nullptr);
+  REQUIRE(MetBuild::SnapshotCache::load("third") != nullptr);
+
+  MetBuild::SnapshotCache::setBudget(0);
+  MetBuild::SnapshotCache::setDirectory("");
+  boost::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Snapshot store tiers", "[snapshotcache]") {
+  const std::string directory = "snapshot_store_test";
+  boost::filesystem::remove_all(directory);
+  MetBuild::SnapshotStore::clear();
+
+  MetBuild::InterpolationWeights weights(16, 16);
+  weights.update_mask();
+  std::vector<MetBuild::SnapshotCache::Field> smooth = {
+      {0, 0, std::vector<MetBuild::MeteorologicalDataType>(256)}};
+  std::vector<MetBuild::SnapshotCache::Field> noisy = smooth;
+  uint32_t state = 12345;
+  for (size_t c = 0; c < 256; ++c) {
+    smooth[0].values[c] = static_cast<float>(1000.0 + 0.01 * c);
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    std::memcpy(&noisy[0].values[c], &state, sizeof(float));
+  }
+  auto path = [&](const std::string &key) {
+    return (boost::filesystem::path(directory) / ("snapshot_" + key + ".bin"))
+        .string();
+  };
+
+  //...The store alone enables the cache, without writing any file
+  MetBuild::SnapshotCache::setDirectory("");
+  MetBuild::SnapshotStore::setBudget(1 << 20);
+  REQUIRE(MetBuild::SnapshotCache::enabled());
+  MetBuild::SnapshotCache::store("first", weights, smooth);
+  const auto size = MetBuild::SnapshotStore::size();
+  REQUIRE(MetBuild::SnapshotStore::count() == 1);
+  REQUIRE(MetBuild::SnapshotStore::compressedCount() == 0);
+
+  //...Past half of the budget the older snapshots are compressed, and
+  // reading one back keeps it uncompressed again
+  MetBuild::SnapshotStore::setBudget(3 * size);
+  MetBuild::SnapshotCache::store("second", weights, smooth);
+  MetBuild::SnapshotCache::store("third", weights, smooth);
+  REQUIRE(MetBuild::SnapshotStore::count() == 3);
+  REQUIRE(MetBuild::SnapshotStore::compressedCount() == 2);
+  REQUIRE(MetBuild::SnapshotStore::size() < 2 * size);
+  for (const auto *key : {"first", "second", "third"}) {
+    const auto entry = MetBuild::SnapshotCache::load(key);
+    REQUIRE(entry != nullptr);
+    REQUIRE(entry->fields.size() == 1);
+    REQUIRE(entry->fields[0].values == smooth[0].values);
+  }
+  REQUIRE(MetBuild::SnapshotStore::compressedCount() == 2);
+
+  //...Over the budget the least recently used snapshots spill to the
+  // directory, from which they are read back
+  MetBuild::SnapshotStore::clear();
+  MetBuild::SnapshotCache::setDirectory(directory);
+  MetBuild::SnapshotStore::setBudget(size + size / 4);
+  MetBuild::SnapshotCache::store("first", weights, noisy);
+  REQUIRE_FALSE(boost::filesystem::exists(path("first")));
+  MetBuild::SnapshotCache::store("second", weights, noisy);
+  REQUIRE(boost::filesystem::exists(path("first")));
+  REQUIRE_FALSE(boost::filesystem::exists(path("second")));
+  REQUIRE(MetBuild::SnapshotStore::count() == 1);
+
+  const auto spilled = MetBuild::SnapshotCache::load("first");
+  REQUIRE(spilled != nullptr);
+  REQUIRE(std::memcmp(spilled->fields[0].values.data(),
+                      noisy[0].values.data(), 256 * sizeof(float)) == 0);
+  REQUIRE(boost::filesystem::exists(path("second")));
+  REQUIRE(MetBuild::SnapshotCache::load("second") != nullptr);
+
+  MetBuild::SnapshotStore::setBudget(0);
+  REQUIRE(MetBuild::SnapshotStore::count() == 0);
+  MetBuild::SnapshotCache::setDirectory("");
+  REQUIRE_FALSE(MetBuild::SnapshotCache::enabled());
+  boost::filesystem::remove_all(directory);
+}
+
+#ifdef __linux__
+TEST_CASE("Shared field store", "[snapshotcache]") {
+  using MetBuild::SharedFieldStore;
+  using MetBuild::SourceDataType;
+  const auto name = SharedFieldStore::name();
+  const auto budget = SharedFieldStore::budget();
+  REQUIRE_THROWS(SharedFieldStore::setName("../escape"));
+  SharedFieldStore::setName("metbuild_shared_field_test");
+  SharedFieldStore::clear();
+  REQUIRE(SharedFieldStore::enabled());
+
+  std::vector<SourceDataType> values(1000);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<SourceDataType>(0.5 * i);
+  }
+  const std::string message = "GRIB message";
+  const auto key =
+      SharedFieldStore::key(message.data(), message.size(), 0, values.size());
+  REQUIRE(SharedFieldStore::key(message.data(), message.size(), 1,
+                                values.size()) != key);
+
+  REQUIRE(SharedFieldStore::attach(key) == nullptr);
+  REQUIRE(SharedFieldStore::publish(key, values.data(), values.size()));
+  const auto field = SharedFieldStore::attach(key);
+  REQUIRE(field != nullptr);
+  REQUIRE(field->size() == values.size());
+  REQUIRE(std::equal(values.begin(), values.end(), field->data()));
+  const auto size = SharedFieldStore::size();
+  REQUIRE(size > values.size() * sizeof(SourceDataType));
+
+  //...Over the budget the oldest field is evicted, while a process
+  // holding it keeps reading its pages
+  const std::string other = "GRIB other";
+  const auto other_key =
+      SharedFieldStore::key(other.data(), other.size(), 0, values.size());
+  SharedFieldStore::setBudget(size + size / 2);
+  REQUIRE(SharedFieldStore::publish(other_key, values.data(), values.size()));
+  REQUIRE(SharedFieldStore::attach(key) == nullptr);
+  REQUIRE(SharedFieldStore::attach(other_key) != nullptr);
+  REQUIRE(SharedFieldStore::size() == size);
+  REQUIRE(std::equal(values.begin(), values.end(), field->data()));
+
+  SharedFieldStore::clear();
+  REQUIRE(SharedFieldStore::size() == 0);
+  SharedFieldStore::setName(name);
+  SharedFieldStore::setBudget(budget);
+}
+#endif
+
+TEST_CASE("Interpolation weight files", "[snapshotcache]") {
+  using MetBuild::InterpolationCache;
+  using MetBuild::WeightFile;
+  const std::string directory = "weight_file_test";
+  boost::filesystem::remove_all(directory);
+  InterpolationCache::setDirectory(directory);
+
+  const size_t ni = 300;
+  const size_t nj = 40;
+  MetBuild::InterpolationWeights weights(ni, nj);
+  for (size_t j = 0; j < nj; ++j) {
+    for (size_t i = 0; i < ni; ++i) {
+      if (i % 7 == 0) continue;
+      const size_t node = j * (ni + 1) + i;
+      const double a = static_cast<double>((i * 37 + j * 11) % 100) / 200.0;
+      const double b = static_cast<double>((i * 13 + j * 29) % 100) / 400.0;
+      weights.set(i, j,
+                  MetBuild::InterpolationWeight({node, node + 1, node + ni + 1},
+                                                {a, b, 1 - a - b}));
+    }
+  }
+
+  auto same = [&](const MetBuild::InterpolationWeights &w, size_t j0,
+                  size_t j1, double tolerance) {
+    for (size_t c = j0 * ni; c < j1 * ni; ++c) {
+      if (w.valid(c) != weights.valid(c)) return false;
+      for (size_t k = 0; k < 3; ++k) {
+        if (w.index(k)[c] != weights.index(k)[c]) return false;
+        if (std::abs(w.weight(k)[c] - weights.weight(k)[c]) > tolerance) {
+          return false;
+        }
+      }
+    }
+    return true;
+  };
+
+  //...By default the cache keeps the weights exactly, in less space than
+  // the planes they are held in
+  REQUIRE(InterpolationCache::weightPrecision() == 0);
+  const auto key = InterpolationCache::key(1, {}, 2,
+                                           MetBuild::CONVENTION_180);
+  InterpolationCache::store(key, weights, {1, 2, 0});
+  const auto loaded = InterpolationCache::load(key);
+  REQUIRE(loaded != nullptr);
+  REQUIRE(same(*loaded, 0, nj, 0.0));
+  const auto fn = InterpolationCache::filename(key);
+  REQUIRE(boost::filesystem::file_size(fn) <
+          3 * ni * nj * (sizeof(uint32_t) + sizeof(MetBuild::SourceDataType)));
+
+  const auto file = WeightFile::open(fn);
+  REQUIRE(file != nullptr);
+  REQUIRE(file->identity().source == 1);
+  REQUIRE(file->identity().grid == 2);
+  REQUIRE(file->weight_bits() == 0);
+  REQUIRE(file->max_error() == 0.0);
+
+  //...A file copied under another key is not used
+  const auto other = InterpolationCache::key(3, {}, 2,
+                                             MetBuild::CONVENTION_180);
+  boost::filesystem::copy_file(fn, InterpolationCache::filename(other));
+  REQUIRE(InterpolationCache::load(other) == nullptr);
+
+  //...Bands are decoded on their own
+  WeightFile::Options options;
+  options.band_cells = 2 * ni;
+  const auto banded = directory + "/banded.bin";
+  REQUIRE(WeightFile::write(banded, weights, 0, {}, options));
+  auto bands = WeightFile::open(banded);
+  REQUIRE(bands != nullptr);
+  REQUIRE(bands->bands() == nj / 2);
+  MetBuild::InterpolationWeights partial(ni, nj);
+  bands->read_mask(partial);
+  REQUIRE(bands->decode(5, partial));
+  REQUIRE(bands->rows(5) == std::make_pair(size_t(10), size_t(12)));
+  REQUIRE(same(partial, 10, 12, 0.0));
+  REQUIRE(partial.index(0)[9 * ni + 1] ==
+          MetBuild::InterpolationWeights::invalid_index());
+
+  //...Quantized weights stay within the recorded error, which is bounded by
+  // half a step of the range of the weights
+  for (const unsigned bits : {16U, 32U}) {
+    options.weight_bits = bits;
+    const auto quantized = directory + "/quantized.bin";
+    REQUIRE(WeightFile::write(quantized, weights, 0, {}, options));
+    const auto q = WeightFile::open(quantized);
+    REQUIRE(q != nullptr);
+    REQUIRE(q->weight_bits() == bits);
+    const double step = 1.0 / static_cast<double>((uint64_t(1) << bits) - 1);
+    REQUIRE(q->max_error() <= 0.5 * step + 1e-7);
+    const auto w = q->read();
+    REQUIRE(w != nullptr);
+    REQUIRE(same(*w, 0, nj, q->max_error()));
+    REQUIRE(boost::filesystem::file_size(quantized) <
+            boost::filesystem::file_size(banded));
+  }
+  REQUIRE_THROWS(InterpolationCache::setWeightPrecision(8));
+
+  //...Truncated files are rejected
+  bands.reset();
+  boost::filesystem::resize_file(banded,
+                                 boost::filesystem::file_size(banded) - 1);
+  REQUIRE(WeightFile::open(banded) == nullptr);
+
+  InterpolationCache::setDirectory("");
+  boost::filesystem::remove_all(directory);
+}
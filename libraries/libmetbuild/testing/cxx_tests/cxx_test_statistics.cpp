@@ -0,0 +1,246 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <cmath>
+#include <vector>
+
+#include "EnsembleReduction.h"
+#include "InterpolationKernel.h"
+#include "MeteorologicalData.h"
+#include "StepStatistics.h"
+#include "TemporalEnvelope.h"
+#include "catch.hpp"
+
+TEST_CASE("Field reduction", "[statistics]") {
+  using T = MetBuild::MeteorologicalDataType;
+  constexpr T flag = MetBuild::MeteorologicalData<1, T>::flag_value();
+
+  //...Long enough to cover several blocks and a partial set of lanes
+  constexpr size_t n = 10007;
+  std::vector<T> values(n);
+  double sum = 0.0;
+  size_t valid = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (i % 10 == 3) {
+      values[i] = flag;
+      continue;
+    }
+    values[i] = static_cast<T>(1000.0 + 0.01 * static_cast<double>(i % 500));
+    sum += values[i];
+    valid++;
+  }
+  values[17] = 950.5;
+  sum += 950.5 - (1000.0 + 0.01 * 17);
+  values[n - 1] = 1050.25;
+  sum += 1050.25 - (1000.0 + 0.01 * ((n - 1) % 500));
+
+  MetBuild::FieldStatistics stats;
+  MetBuild::Kernel::reduce(n, values.data(), flag, stats);
+  REQUIRE(stats.valid == valid);
+  REQUIRE(stats.invalid == n - valid);
+  REQUIRE(stats.min == Approx(950.5));
+  REQUIRE(stats.max == Approx(1050.25));
+  REQUIRE(stats.mean() == Approx(sum / static_cast<double>(valid)));
+  REQUIRE(stats.invalid_fraction() == Approx(0.1).margin(1e-3));
+
+  //...Reducing in two pieces and merging gives the same result
+  MetBuild::FieldStatistics a;
+  MetBuild::FieldStatistics b;
+  MetBuild::Kernel::reduce(4000, values.data(), flag, a);
+  MetBuild::Kernel::reduce(n - 4000, values.data() + 4000, flag, b);
+  a.merge(b);
+  REQUIRE(a.valid == stats.valid);
+  REQUIRE(a.min == stats.min);
+  REQUIRE(a.max == stats.max);
+  REQUIRE(a.mean() == Approx(stats.mean()));
+
+  const std::vector<T> u = {3.0, flag, -6.0};
+  const std::vector<T> v = {4.0, 1.0, 8.0};
+  MetBuild::FieldStatistics speed;
+  MetBuild::Kernel::reduce_speed(u.size(), u.data(), v.data(), flag, speed);
+  REQUIRE(speed.valid == 2);
+  REQUIRE(speed.min == Approx(5.0));
+  REQUIRE(speed.max == Approx(10.0));
+  REQUIRE(speed.mean() == Approx(7.5));
+
+  MetBuild::FieldStatistics empty;
+  REQUIRE(std::isnan(empty.mean()));
+  REQUIRE(empty.invalid_fraction() == 0.0);
+}
+
+TEST_CASE("Step statistics", "[statistics]") {
+  MetBuild::StepStatistics step;
+  step.names = {"wind_u", "mslp"};
+  step.fields.resize(2);
+  step.fields[1].min = 980.0;
+  REQUIRE(step.size() == 2);
+  REQUIRE(step.field("mslp").min == 980.0);
+  REQUIRE_THROWS(step.field("rain"));
+
+  MetBuild::StepStatistics other = step;
+  other.fields[1].min = 970.0;
+  step.merge(other);
+  REQUIRE(step.field("mslp").min == 970.0);
+
+  other.names = {"rain"};
+  other.fields.resize(1);
+  REQUIRE_THROWS(step.merge(other));
+}
+
+TEST_CASE("Ensemble reduction", "[statistics]") {
+  using T = MetBuild::MeteorologicalDataType;
+  constexpr T flag = MetBuild::MeteorologicalData<1, T>::flag_value();
+  constexpr size_t ni = 37;
+  constexpr size_t nj = 23;
+  constexpr size_t members = 31;
+
+  //...Members spread around 20 m/s, member 5 without a value in cell 0
+  MetBuild::EnsembleReduction reduction(ni, nj, 3, {17.49, 25.72});
+  std::vector<std::vector<double>> speeds(ni * nj);
+  MetBuild::MeteorologicalData<3, T> member(ni, nj);
+  for (size_t m = 0; m < members; ++m) {
+    for (size_t c = 0; c < ni * nj; ++c) {
+      const double u = 20.0 + 0.5 * static_cast<double>((m * 7 + c) % 13) -
+                       3.0;
+      const double v = 0.25 * static_cast<double>((m + c) % 5);
+      member.parameter(0)[c] = static_cast<T>(u);
+      member.parameter(1)[c] = static_cast<T>(v);
+      member.parameter(2)[c] = static_cast<T>(1000.0 + m);
+      if (m == 5 && c == 0) {
+        member.parameter(2)[c] = flag;
+        continue;
+      }
+      speeds[c].push_back(std::hypot(static_cast<double>(static_cast<T>(u)),
+                                     static_cast<double>(static_cast<T>(v))));
+    }
+    reduction.add(member);
+  }
+  REQUIRE(reduction.members() == members);
+
+  std::vector<T> mean(ni * nj);
+  std::vector<T> spread(ni * nj);
+  std::vector<T> p34(ni * nj);
+  std::vector<T> p50(ni * nj);
+  reduction.mean(2, {mean.data(), mean.size()});
+  reduction.spread(2, {spread.data(), spread.size()});
+  reduction.exceedance(0, {p34.data(), p34.size()});
+  reduction.exceedance(1, {p50.data(), p50.size()});
+
+  const double all_mean = 1000.0 + 15.0;
+  const double all_spread = std::sqrt(31.0 * 32.0 / 12.0);
+  REQUIRE(mean[1] == Approx(all_mean));
+  REQUIRE(spread[1] == Approx(all_spread));
+  //...Cell 0 misses a member
+  REQUIRE(mean[0] == Approx((all_mean * 31.0 - 1005.0) / 30.0));
+
+  for (size_t c = 0; c < ni * nj; ++c) {
+    const auto &s = speeds[c];
+    size_t above34 = 0;
+    size_t above50 = 0;
+    for (const auto x : s) {
+      if (x > 17.49) above34++;
+      if (x > 25.72) above50++;
+    }
+    REQUIRE(p34[c] == Approx(static_cast<double>(above34) / s.size()));
+    REQUIRE(p50[c] == Approx(static_cast<double>(above50) / s.size()));
+  }
+
+  //...A cell with no member is flagged, one with a single member has no
+  // spread
+  reduction.reset();
+  member.fill_all(5.0);
+  member.parameter(0)[0] = flag;
+  reduction.add(member);
+  reduction.mean(0, {mean.data(), mean.size()});
+  reduction.spread(0, {spread.data(), spread.size()});
+  REQUIRE(mean[0] == flag);
+  REQUIRE(spread[0] == flag);
+  REQUIRE(mean[1] == Approx(5.0));
+  REQUIRE(spread[1] == 0.0);
+
+  MetBuild::MeteorologicalData<1, T> scalar(ni, nj);
+  REQUIRE_THROWS(reduction.add(scalar));
+}
+
+TEST_CASE("Temporal envelope", "[statistics]") {
+  using T = MetBuild::MeteorologicalDataType;
+  constexpr T flag = MetBuild::MeteorologicalData<1, T>::flag_value();
+  constexpr size_t ni = 19;
+  constexpr size_t nj = 11;
+  constexpr size_t steps = 12;
+  const MetBuild::Date origin(2023, 9, 1, 0, 0, 0);
+
+  //...Wind peaks at a step that varies by cell, cell 0 is never valid
+  MetBuild::TemporalEnvelope wind(ni, nj, 3, origin, 3600);
+  MetBuild::MeteorologicalData<3, T> record(ni, nj);
+  for (size_t s = 0; s < steps; ++s) {
+    for (size_t c = 0; c < ni * nj; ++c) {
+      const size_t peak = c % steps;
+      const double distance = std::abs(static_cast<double>(s) -
+                                       static_cast<double>(peak));
+      record.parameter(0)[c] = static_cast<T>(30.0 - distance);
+      record.parameter(1)[c] = 0;
+      record.parameter(2)[c] = static_cast<T>(950.0 + distance);
+      if (c == 0) record.parameter(1)[c] = flag;
+    }
+    wind.add(origin + static_cast<long>(s * 3600), record);
+  }
+  REQUIRE(wind.records() == steps);
+
+  std::vector<T> maximum(ni * nj);
+  std::vector<T> time_of_maximum(ni * nj);
+  std::vector<T> minimum(ni * nj);
+  wind.get(MetBuild::TemporalEnvelope::MAXIMUM,
+           {maximum.data(), maximum.size()});
+  wind.get(MetBuild::TemporalEnvelope::TIME_OF_MAXIMUM,
+           {time_of_maximum.data(), time_of_maximum.size()});
+  wind.get(MetBuild::TemporalEnvelope::MINIMUM,
+           {minimum.data(), minimum.size()});
+  REQUIRE(maximum[0] == flag);
+  REQUIRE(minimum[0] == flag);
+  for (size_t c = 1; c < ni * nj; ++c) {
+    REQUIRE(maximum[c] == Approx(30.0));
+    REQUIRE(minimum[c] == Approx(950.0));
+    REQUIRE(time_of_maximum[c] == Approx(60.0 * (c % steps)));
+  }
+  REQUIRE_THROWS(wind.get(MetBuild::TemporalEnvelope::ACCUMULATED,
+                          {maximum.data(), maximum.size()}));
+
+  //...A constant 2 mm/hr over 12 half hour records totals 12 mm
+  MetBuild::TemporalEnvelope rain(ni, nj, 1, origin, 1800);
+  MetBuild::MeteorologicalData<1, T> rate(ni, nj);
+  rate.fill(2);
+  for (size_t s = 0; s < steps; ++s) {
+    rain.add(origin + static_cast<long>(s * 1800), rate);
+  }
+  std::vector<T> total(ni * nj);
+  rain.get(MetBuild::TemporalEnvelope::ACCUMULATED,
+           {total.data(), total.size()});
+  for (const auto t : total) REQUIRE(t == Approx(12.0));
+  REQUIRE_THROWS(rain.add(origin, record));
+}
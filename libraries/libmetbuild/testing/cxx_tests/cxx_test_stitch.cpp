@@ -0,0 +1,167 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "BuildRequest.h"
+#include "Date.h"
+#include "Grid.h"
+#include "MeteorologicalData.h"
+#include "catch.hpp"
+#include "output/OutputStitch.h"
+#include "output/OwiAscii.h"
+#include "test_utilities.h"
+
+namespace {
+void write_owi_ascii(const MetBuild::Grid &grid, const MetBuild::Date &start,
+                     const MetBuild::Date &end, const std::string &prefix,
+                     const bool compress) {
+  const std::string ext = compress ? ".gz" : "";
+  MetBuild::MeteorologicalData<3> data(grid.ni(), grid.nj());
+  MetBuild::OwiAscii output(start, end, 3600, compress);
+  output.addDomain(grid, {prefix + ".pre" + ext, prefix + ".wnd" + ext});
+  for (auto t = start; t <= end; t += 3600) {
+    const auto hour = static_cast<float>((t.toSeconds() / 3600) % 24);
+    for (size_t j = 0; j < grid.nj(); ++j) {
+      for (size_t i = 0; i < grid.ni(); ++i) {
+        data.set(0, i, j, hour + static_cast<float>(i));
+        data.set(1, i, j, hour - static_cast<float>(j));
+        data.set(2, i, j, 1000.0f + hour + static_cast<float>(i * j));
+      }
+    }
+    output.write(t, 0, data);
+  }
+}
+}  // namespace
+
+using MetBuild::Testing::read_file;
+
+TEST_CASE("Request shards", "[stitch]") {
+  const MetBuild::Date start(2023, 6, 1, 0, 0, 0);
+  const MetBuild::Date end(2023, 6, 1, 10, 0, 0);
+  using MetBuild::BuildRequest;
+
+  //...Eleven records split as 4, 4 and 3
+  REQUIRE(BuildRequest::shard_start(start, end, 3600, 0, 3) == start);
+  REQUIRE(BuildRequest::shard_end(start, end, 3600, 0, 3) == start + 3 * 3600);
+  REQUIRE(BuildRequest::shard_start(start, end, 3600, 1, 3) ==
+          start + 4 * 3600);
+  REQUIRE(BuildRequest::shard_end(start, end, 3600, 1, 3) == start + 7 * 3600);
+  REQUIRE(BuildRequest::shard_start(start, end, 3600, 2, 3) ==
+          start + 8 * 3600);
+  REQUIRE(BuildRequest::shard_end(start, end, 3600, 2, 3) == end);
+  REQUIRE(BuildRequest::shard_end(start, end, 3600, 0, 1) == end);
+
+  REQUIRE_THROWS(BuildRequest::shard_start(start, end, 3600, 3, 3));
+  REQUIRE_THROWS(BuildRequest::shard_end(start, end, 3600, 0, 12));
+  REQUIRE_THROWS(BuildRequest::shard_start(end, start, 3600, 0, 1));
+}
+
+TEST_CASE("OWI ASCII stitching", "[stitch]") {
+  const auto grid = MetBuild::Grid(-100.0, 20.0, -97.0, 22.0, 0.5, 0.25);
+  const MetBuild::Date start(2023, 6, 1, 0, 0, 0);
+  const MetBuild::Date end(2023, 6, 1, 10, 0, 0);
+
+  for (const bool compress : {false, true}) {
+    const std::string ext = compress ? ".gz" : "";
+    write_owi_ascii(grid, start, end, "stitch_full", compress);
+
+    //...The second shard repeats the last record of the first
+    write_owi_ascii(grid, start, start + 4 * 3600, "stitch_0", compress);
+    write_owi_ascii(grid, start + 4 * 3600, end, "stitch_1", compress);
+
+    for (const std::string type : {".pre", ".wnd"}) {
+      const auto output = "stitch_out" + type + ext;
+      MetBuild::OutputStitch::owi_ascii(
+          {"stitch_0" + type + ext, "stitch_1" + type + ext}, output);
+      if (compress) {
+        //...Compressed files are compared through their text
+        MetBuild::OutputStitch::owi_ascii({output}, "stitch_text" + type);
+        MetBuild::OutputStitch::owi_ascii({"stitch_full" + type + ext},
+                                          "stitch_full_text" + type);
+        REQUIRE(read_file("stitch_text" + type) ==
+                read_file("stitch_full_text" + type));
+        std::remove(("stitch_text" + type).c_str());
+        std::remove(("stitch_full_text" + type).c_str());
+      } else {
+        REQUIRE(read_file(output) == read_file("stitch_full" + type));
+      }
+      for (const auto &f : {"stitch_full" + type + ext,
+                            "stitch_0" + type + ext, "stitch_1" + type + ext,
+                            output}) {
+        std::remove(f.c_str());
+      }
+    }
+  }
+
+  REQUIRE_THROWS(MetBuild::OutputStitch::owi_ascii({}, "stitch_none.pre"));
+  REQUIRE_THROWS(
+      MetBuild::OutputStitch::owi_ascii({"missing.pre"}, "stitch_none.pre"));
+}
+
+TEST_CASE("OWI ASCII constant records", "[stitch]") {
+  const auto grid = MetBuild::Grid(-100.0, 20.0, -97.0, 22.0, 0.5, 0.25);
+  const MetBuild::Date start(2023, 6, 1, 0, 0, 0);
+  const MetBuild::Date end(2023, 6, 1, 5, 0, 0);
+
+  //...Filled fields reuse the formatted body, which must match the values
+  // written one by one
+  for (const bool filled : {true, false}) {
+    MetBuild::MeteorologicalData<3> data(grid.ni(), grid.nj());
+    MetBuild::OwiAscii output(start, end, 3600);
+    const std::string prefix = filled ? "constant_fill" : "constant_set";
+    output.addDomain(grid, {prefix + ".pre", prefix + ".wnd"});
+    for (auto t = start; t <= end; t += 3600) {
+      const bool background = t < start + 2 * 3600 || t > start + 3 * 3600;
+      const float u = background ? 0.0f : -999.0f;
+      const float p = background ? 1013.0f : -999.0f;
+      if (filled) {
+        data.fill_parameter(0, u);
+        data.fill_parameter(1, u);
+        data.fill_parameter(2, p);
+        REQUIRE(data.constant(2));
+      } else {
+        for (size_t j = 0; j < grid.nj(); ++j) {
+          for (size_t i = 0; i < grid.ni(); ++i) {
+            data.setPack(i, j, {u, u, p});
+          }
+        }
+      }
+      output.write(t, 0, data);
+    }
+  }
+
+  for (const std::string type : {".pre", ".wnd"}) {
+    REQUIRE(read_file("constant_fill" + type) ==
+            read_file("constant_set" + type));
+    std::remove(("constant_fill" + type).c_str());
+    std::remove(("constant_set" + type).c_str());
+  }
+}
@@ -0,0 +1,136 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ExecutionPolicy.h"
+#include "InterpolationCache.h"
+#include "ResourceLimits.h"
+#include "ThreadPool.h"
+#include "catch.hpp"
+
+TEST_CASE("Nested parallel loops", "[threadpool]") {
+  MetBuild::ThreadPool pool(4);
+  REQUIRE(pool.size() == 4);
+
+  //...Inner loops are issued from the workers and land on their own queues
+  std::vector<std::atomic<size_t>> sums(64);
+  pool.parallel_for(0, sums.size(), [&](const size_t i) {
+    pool.parallel_for(0, 1000, [&](const size_t j) { sums[i] += j; });
+  });
+  for (const auto &s : sums) {
+    REQUIRE(s == 499500);
+  }
+
+  REQUIRE_THROWS_AS(pool.parallel_for(0, 100,
+                                      [](const size_t i) {
+                                        if (i == 57) {
+                                          throw std::runtime_error("fail");
+                                        }
+                                      }),
+                    std::runtime_error);
+}
+
+TEST_CASE("Pool tasks", "[threadpool]") {
+  MetBuild::ThreadPool pool(3);
+
+  std::vector<std::future<size_t>> futures;
+  for (size_t i = 0; i < 100; ++i) {
+    futures.push_back(pool.async([i]() { return i * i; }));
+  }
+  for (size_t i = 0; i < futures.size(); ++i) {
+    REQUIRE(futures[i].get() == i * i);
+  }
+
+  //...Tasks that wait on tasks submitted before them complete in order
+  std::vector<std::shared_future<size_t>> chain;
+  chain.push_back(pool.async([]() { return size_t(1); }).share());
+  for (size_t i = 1; i < 20; ++i) {
+    auto previous = chain.back();
+    chain.push_back(
+        pool.async([previous]() { return previous.get() + 1; }).share());
+  }
+  REQUIRE(chain.back().get() == 20);
+
+  auto failed = pool.async([]() -> int { throw std::runtime_error("fail"); });
+  REQUIRE_THROWS_AS(failed.get(), std::runtime_error);
+
+  //...A pool of one thread runs the task before returning
+  MetBuild::ThreadPool serial(1);
+  const auto caller = std::this_thread::get_id();
+  auto inline_task = serial.async([]() { return std::this_thread::get_id(); });
+  REQUIRE(inline_task.wait_for(std::chrono::seconds(0)) ==
+          std::future_status::ready);
+  REQUIRE(inline_task.get() == caller);
+}
+
+TEST_CASE("Resource limits", "[threadpool]") {
+  const auto n = MetBuild::ResourceLimits::processors();
+  REQUIRE(n >= 1);
+  REQUIRE(n <= std::max<size_t>(std::thread::hardware_concurrency(), 1));
+  const auto quota = MetBuild::ResourceLimits::cpuQuota();
+  if (quota > 0.0) REQUIRE(static_cast<double>(n) <= quota + 1.0);
+
+  const auto budget = MetBuild::ResourceLimits::defaultMemoryBudget();
+  MetBuild::ResourceLimits::setDefaultMemoryBudget(1048576);
+  REQUIRE(MetBuild::ResourceLimits::defaultMemoryBudget() == 1048576);
+  REQUIRE(MetBuild::ResourceLimits::describe().find("1 MiB") !=
+          std::string::npos);
+  MetBuild::ResourceLimits::setDefaultMemoryBudget(budget);
+}
+
+TEST_CASE("Execution policy", "[threadpool]") {
+  MetBuild::ExecutionPolicy policy;
+  REQUIRE(policy.threads() == MetBuild::ThreadPool::defaultThreadCount());
+  REQUIRE(policy.weight_cache() == MetBuild::InterpolationCache::directory());
+  REQUIRE(policy.memory_budget() == 0);
+  REQUIRE(policy.ring_depth() >= 2);
+  REQUIRE(MetBuild::ExecutionPolicy::value_bytes() ==
+          sizeof(MetBuild::MeteorologicalDataType));
+
+  REQUIRE_THROWS(policy.set_threads(0));
+  REQUIRE_THROWS(policy.set_ring_depth(1));
+  REQUIRE_THROWS(policy.set_instruction_set("sse9"));
+  policy.set_ring_depth(5);
+  policy.set_instruction_set("generic");
+  REQUIRE(policy.describe().find("ring depth 5") != std::string::npos);
+
+  //...Applying the policy in effect changes nothing
+  const auto threads = MetBuild::ThreadPool::defaultThreadCount();
+  MetBuild::ExecutionPolicy().apply();
+  REQUIRE(MetBuild::ThreadPool::defaultThreadCount() == threads);
+  REQUIRE(MetBuild::ExecutionPolicy().weight_cache() ==
+          policy.weight_cache());
+}
@@ -0,0 +1,196 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Date.h"
+#include "Grid.h"
+#include "MeteorologicalData.h"
+#include "MovingGrid.h"
+#include "catch.hpp"
+#include "vortex/AtcfTrack.h"
+#include "vortex/HollandVortex.h"
+
+namespace {
+MetBuild::AtcfTrack make_track(const double latitude) {
+  std::vector<MetBuild::AtcfRecord> records(2);
+  records[0].time = MetBuild::Date(2022, 9, 1, 0, 0, 0);
+  records[1].time = MetBuild::Date(2022, 9, 1, 12, 0, 0);
+  for (auto &r : records) {
+    r.latitude = latitude;
+    r.longitude = -80.0;
+    r.max_wind = 50.0;
+    r.central_pressure = 950.0;
+    r.background_pressure = 1013.0;
+    r.radius_max_wind = 30000.0;
+  }
+  return MetBuild::AtcfTrack(records);
+}
+}  // namespace
+
+TEST_CASE("Read ATCF track", "[vortex]") {
+  const std::string filename = "vortex_test_fort.22";
+  {
+    std::ofstream f(filename);
+    f << "AL, 09, 2022092800,   , BEST,   0, 268N,  827W, 135,  940, HU,  "
+         "34, NEQ,  130,  120,   90,  110, 1010,  250,  20\n";
+    f << "AL, 09, 2022092800,   , BEST,   0, 268N,  827W, 135,  940, HU,  "
+         "50, NEQ,   70,   70,   50,   60, 1010,  250,  20\n";
+    f << "AL, 09, 2022092806,   , BEST,   0, 272N,  824W, 130,  945, HU,  "
+         "34, NEQ,  130,  120,   90,  110, 1010,  250,    \n";
+  }
+  const MetBuild::AtcfTrack track(filename);
+  REQUIRE(track.size() == 2);
+  REQUIRE(track.start_date().toSeconds() ==
+          MetBuild::Date(2022, 9, 28, 0, 0, 0).toSeconds());
+  REQUIRE(track.end_date().toSeconds() ==
+          MetBuild::Date(2022, 9, 28, 6, 0, 0).toSeconds());
+
+  const auto &r = track.records();
+  REQUIRE(r[0].latitude == Approx(26.8));
+  REQUIRE(r[0].longitude == Approx(-82.7));
+  REQUIRE(r[0].max_wind == Approx(135.0 * 0.514444));
+  REQUIRE(r[0].central_pressure == Approx(940.0));
+  REQUIRE(r[0].background_pressure == Approx(1010.0));
+  REQUIRE(r[0].radius_max_wind == Approx(20.0 * 1852.0));
+  REQUIRE(r[1].radius_max_wind == Approx(20.0 * 1852.0));
+
+  const auto mid = track.at(MetBuild::Date(2022, 9, 28, 3, 0, 0));
+  REQUIRE(mid.latitude == Approx(27.0));
+  REQUIRE(mid.central_pressure == Approx(942.5));
+  REQUIRE_FALSE(track.contains(MetBuild::Date(2022, 9, 28, 7, 0, 0)));
+
+  const auto t = track.translation(MetBuild::Date(2022, 9, 28, 3, 0, 0));
+  REQUIRE(t[0] > 0.0);
+  REQUIRE(t[1] > 0.0);
+}
+
+TEST_CASE("Holland vortex structure", "[vortex]") {
+  const auto grid = MetBuild::Grid(-85.0, 20.0, -75.0, 30.0, 0.05, 0.05);
+  const MetBuild::HollandVortex vortex(&grid, make_track(25.0));
+  const auto met = vortex.evaluate(MetBuild::Date(2022, 9, 1, 6, 0, 0));
+
+  const size_t ni = grid.ni();
+  const auto ic = static_cast<size_t>(std::lround(5.0 / 0.05));
+  const auto jc = static_cast<size_t>(std::lround(5.0 / 0.05));
+  const auto u = met.parameter(0);
+  const auto v = met.parameter(1);
+  const auto p = met.parameter(2);
+
+  REQUIRE(p[jc * ni + ic] == Approx(950.0).margin(0.5));
+  REQUIRE(p[0] > 1005.0);
+  REQUIRE(p[0] <= 1013.0);
+
+  //...Counterclockwise in the northern hemisphere with inflow
+  const size_t east = jc * ni + ic + 6;
+  const size_t north = (jc + 6) * ni + ic;
+  REQUIRE(v[east] > 0.0);
+  REQUIRE(u[east] < 0.0);
+  REQUIRE(u[north] < 0.0);
+  REQUIRE(v[north] < 0.0);
+
+  //...Peak wind near the radius of maximum winds
+  double peak = 0.0;
+  size_t peak_i = 0;
+  for (size_t i = ic; i < ni; ++i) {
+    const auto s = std::hypot(u[jc * ni + i], v[jc * ni + i]);
+    if (s > peak) {
+      peak = s;
+      peak_i = i;
+    }
+  }
+  const double r_peak = (static_cast<double>(peak_i - ic) * 0.05) * 111000.0 *
+                        std::cos(25.0 * M_PI / 180.0);
+  REQUIRE(r_peak == Approx(30000.0).margin(8000.0));
+  REQUIRE(peak == Approx(50.0).margin(10.0));
+
+  //...Background outside the track
+  const auto before = vortex.evaluate(MetBuild::Date(2022, 8, 31, 0, 0, 0));
+  REQUIRE(before.parameter(0)[east] == 0.0);
+  REQUIRE(before.parameter(2)[east] == Approx(1013.0));
+}
+
+TEST_CASE("Holland vortex southern hemisphere", "[vortex]") {
+  const auto grid = MetBuild::Grid(-85.0, -30.0, -75.0, -20.0, 0.05, 0.05);
+  const MetBuild::HollandVortex vortex(&grid, make_track(-25.0));
+  const auto met = vortex.evaluate(MetBuild::Date(2022, 9, 1, 6, 0, 0));
+  const size_t ni = grid.ni();
+  const size_t east = 100 * ni + 106;
+  REQUIRE(met.parameter(1)[east] < 0.0);
+  REQUIRE(met.parameter(0)[east] < 0.0);
+}
+
+TEST_CASE("Storm-following grid", "[vortex]") {
+  auto track = make_track(25.0);
+  std::vector<MetBuild::AtcfRecord> records = track.records();
+  records[1].latitude = 28.0;
+  records[1].longitude = -75.0;
+  const MetBuild::MovingGrid grid(MetBuild::AtcfTrack(records), 10.0, 10.0,
+                                  0.25, 0.25);
+
+  REQUIRE(grid.ni() == 41);
+  REQUIRE(grid.nj() == 41);
+  REQUIRE(grid.envelope().ni() == 61);
+  REQUIRE(grid.envelope().nj() == 53);
+
+  const auto start = records[0].time;
+  const auto end = records[1].time;
+  REQUIRE(grid.origin(start) == std::array<size_t, 2>{0, 0});
+  REQUIRE(grid.origin(end) == std::array<size_t, 2>{20, 12});
+  REQUIRE(grid.origin(end + 3600) == grid.origin(end));
+
+  const auto region = grid.region(end);
+  REQUIRE(region.size() == grid.nj());
+  REQUIRE(region.front().begin == 12 * 61 + 20);
+  REQUIRE(region.front().end - region.front().begin == grid.ni());
+
+  MetBuild::MeteorologicalData<3> field(61, 53);
+  for (size_t k = 0; k < 3; ++k) {
+    auto p = field.parameter(k);
+    for (size_t i = 0; i < p.size(); ++i) p[i] = static_cast<double>(i);
+  }
+  MetBuild::MeteorologicalData<3, float> window;
+  grid.window(end, field, window);
+  REQUIRE(window.ni() == grid.ni());
+  REQUIRE(window.parameter(2)[0] == Approx(12 * 61 + 20));
+  REQUIRE(window.parameter(2)[grid.ni()] == Approx(13 * 61 + 20));
+
+  std::vector<double> x(grid.ni() * grid.nj());
+  std::vector<double> y(grid.ni() * grid.nj());
+  grid.positions(start, x.data(), y.data());
+  REQUIRE(x.front() == Approx(-85.0));
+  REQUIRE(y.front() == Approx(20.0));
+  grid.positions(end, x.data(), y.data());
+  REQUIRE(x.front() == Approx(-80.0));
+  REQUIRE(y.front() == Approx(23.0));
+  REQUIRE(x.back() == Approx(-70.0));
+}
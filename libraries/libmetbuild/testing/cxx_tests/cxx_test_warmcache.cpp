@@ -0,0 +1,124 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "SharedCache.h"
+#include "WarmCache.h"
+#include "catch.hpp"
+
+TEST_CASE("Warm cache", "[warmcache]") {
+  MetBuild::WarmCache::clear();
+  MetBuild::WarmCache::setBudget(0);
+
+  MetBuild::SharedCache<const std::vector<double>> cache(
+      "test", [](const std::vector<double> &v) {
+        return v.size() * sizeof(double);
+      });
+  int builds = 0;
+  auto build = [&]() {
+    ++builds;
+    return std::make_shared<const std::vector<double>>(100, 1.0);
+  };
+
+  //...Disabled, an object is rebuilt once its last user releases it
+  cache.acquire("a", build).reset();
+  cache.acquire("a", build).reset();
+  REQUIRE(builds == 2);
+  REQUIRE(MetBuild::WarmCache::count() == 0);
+
+  //...Enabled, released objects are kept up to the budget
+  MetBuild::WarmCache::setBudget(2 * 100 * sizeof(double));
+  builds = 0;
+  cache.acquire("a", build).reset();
+  cache.acquire("b", build).reset();
+  cache.acquire("a", build).reset();
+  REQUIRE(builds == 2);
+  REQUIRE(MetBuild::WarmCache::count() == 2);
+  REQUIRE(MetBuild::WarmCache::size() == 2 * 100 * sizeof(double));
+
+  //..."b" is the least recently used and is dropped first
+  cache.acquire("c", build).reset();
+  REQUIRE(builds == 3);
+  cache.acquire("a", build).reset();
+  REQUIRE(builds == 3);
+  cache.acquire("b", build).reset();
+  REQUIRE(builds == 4);
+
+  MetBuild::WarmCache::erase("test:b");
+  REQUIRE(MetBuild::WarmCache::count() == 1);
+  MetBuild::WarmCache::setBudget(0);
+  REQUIRE(MetBuild::WarmCache::count() == 0);
+}
+
+TEST_CASE("Warm file mappings", "[warmcache]") {
+  const std::string filename = "warm_cache_mapping.bin";
+  {
+    std::ofstream f(filename, std::ios::binary);
+    f << "first contents";
+  }
+  MetBuild::WarmCache::setBudget(1 << 20);
+  const std::weak_ptr<const MetBuild::MappedFile> first =
+      MetBuild::MappedFile::get(filename);
+  REQUIRE_FALSE(first.expired());
+  REQUIRE(MetBuild::MappedFile::get(filename) == first.lock());
+
+  //...A file replaced under the same name is mapped again
+  std::remove(filename.c_str());
+  {
+    std::ofstream f(filename, std::ios::binary);
+    f << "second, longer contents";
+  }
+  const auto second = MetBuild::MappedFile::get(filename);
+  REQUIRE(std::string(reinterpret_cast<const char *>(second->data()),
+                      second->size()) == "second, longer contents");
+
+  //...So is one of the same size replaced within the same second
+  const auto identity = MetBuild::MappedFile::identity(filename);
+  const std::string temporary = filename + ".tmp";
+  {
+    std::ofstream f(temporary, std::ios::binary);
+    f << "third, larger contents!";
+  }
+  std::rename(temporary.c_str(), filename.c_str());
+  REQUIRE(MetBuild::MappedFile::identity(filename) != identity);
+  const auto third = MetBuild::MappedFile::get(filename);
+  REQUIRE(third != second);
+  REQUIRE(std::string(reinterpret_cast<const char *>(third->data()),
+                      third->size()) == "third, larger contents!");
+
+  MetBuild::MappedFile::release(filename);
+  REQUIRE(MetBuild::WarmCache::count() == 0);
+  std::remove(filename.c_str());
+  MetBuild::WarmCache::setBudget(0);
+}
@@ -26,6 +26,10 @@
 // Organization: The Water Institute
 //
 ////////////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
 #include "MetBuild.h"
 #include "catch.hpp"
 
@@ -53,3 +57,267 @@ TEST_CASE("Generate wind grid", "[Gen Wind Grid]") {
   REQUIRE(wg.center(5, 2).y() == 10.125);
 }
 
+
+TEST_CASE("Reproject wind grid", "[Gen Wind Grid]") {
+  //...Web Mercator grid over the Gulf of Mexico
+  auto wg = MetBuild::Grid(-10000000.0, 2500000.0, -9000000.0, 3500000.0,
+                           10000.0, 10000.0, 3857);
+  const auto &g = wg.geographic_positions(3857);
+  REQUIRE(&g == &wg.geographic_positions(3857));
+  REQUIRE(g.size() == wg.nj());
+  REQUIRE(g[0].size() == wg.ni());
+
+  for (const auto &[i, j] :
+       std::vector<std::pair<size_t, size_t>>{{0, 0}, {50, 20}, {100, 100}}) {
+    double x = 0.0;
+    double y = 0.0;
+    bool latlon = false;
+    REQUIRE(MetBuild::Projection::transform(3857, 4326, wg.corner(i, j).x(),
+                                            wg.corner(i, j).y(), x, y,
+                                            latlon) == 0);
+    REQUIRE(latlon);
+    REQUIRE(g[j][i].x() == Approx(x));
+    REQUIRE(g[j][i].y() == Approx(y));
+  }
+}
+
+TEST_CASE("Analytic wind grid positions", "[Gen Wind Grid]") {
+  const auto wg = MetBuild::Grid(-90.0, 20.0, 120, 80, 0.1, 0.1, 30.0);
+  const auto &g = wg.grid_positions();
+  REQUIRE(&g == &wg.grid_positions());
+  REQUIRE(g.size() == 80);
+  REQUIRE(g[0].size() == 120);
+
+  const auto x = wg.x();
+  const auto y = wg.y();
+  for (size_t j = 0; j < wg.nj(); ++j) {
+    for (size_t i = 0; i < wg.ni(); ++i) {
+      const auto p = wg.position(i, j);
+      REQUIRE(p.x() == g[j][i].x());
+      REQUIRE(p.y() == g[j][i].y());
+      REQUIRE(x[j * wg.ni() + i] == p.x());
+      REQUIRE(y[j * wg.ni() + i] == p.y());
+    }
+  }
+
+  const auto copy = MetBuild::Grid(wg);
+  REQUIRE(copy.grid_positions().size() == wg.nj());
+  REQUIRE(copy.position(7, 11).x() == Approx(wg.position(7, 11).x()));
+  REQUIRE(copy.position(7, 11).y() == Approx(wg.position(7, 11).y()));
+}
+
+TEST_CASE("Wind grid row bands", "[Gen Wind Grid]") {
+  for (const double rotation : {0.0, 30.0}) {
+    const auto wg = MetBuild::Grid(-90.0, 20.0, 120, 80, 0.1, 0.1, rotation);
+    size_t rows = 0;
+    for (size_t j0 = 0; j0 < wg.nj(); j0 += 30) {
+      const auto band = wg.band(j0, std::min<size_t>(30, wg.nj() - j0));
+      REQUIRE(band.ni() == wg.ni());
+      REQUIRE(band.rotation() == Approx(wg.rotation()));
+      for (size_t j = 0; j < band.nj(); ++j) {
+        for (size_t i = 0; i < band.ni(); i += 7) {
+          REQUIRE(band.position(i, j).x() ==
+                  Approx(wg.position(i, j0 + j).x()));
+          REQUIRE(band.position(i, j).y() ==
+                  Approx(wg.position(i, j0 + j).y()));
+        }
+      }
+      rows += band.nj();
+    }
+    REQUIRE(rows == wg.nj());
+  }
+
+  const auto wg = MetBuild::Grid(-90.0, 20.0, 120, 80, 0.1, 0.1, 0.0);
+  REQUIRE_THROWS(wg.band(60, 21));
+  REQUIRE_THROWS(wg.band(0, 0));
+}
+
+TEST_CASE("Wind grid windows", "[Gen Wind Grid]") {
+  for (const double rotation : {0.0, 30.0}) {
+    const auto wg = MetBuild::Grid(-90.0, 20.0, 120, 80, 0.1, 0.1, rotation);
+    const auto p = wg.position(10, 20);
+    const auto sub = MetBuild::Grid(p.x(), p.y(), 30, 25, 0.1, 0.1, rotation);
+    const auto w = wg.window(sub);
+    REQUIRE(w.has_value());
+    REQUIRE(w->i0 == 10);
+    REQUIRE(w->j0 == 20);
+    REQUIRE(w->ni == 30);
+    REQUIRE(w->nj == 25);
+
+    const auto shifted =
+        MetBuild::Grid(p.x() + 0.05, p.y(), 30, 25, 0.1, 0.1, rotation);
+    REQUIRE_FALSE(wg.window(shifted).has_value());
+    const auto coarse =
+        MetBuild::Grid(p.x(), p.y(), 15, 12, 0.2, 0.2, rotation);
+    REQUIRE_FALSE(wg.window(coarse).has_value());
+    const auto outside =
+        MetBuild::Grid(p.x(), p.y(), 111, 25, 0.1, 0.1, rotation);
+    REQUIRE_FALSE(wg.window(outside).has_value());
+  }
+
+  const auto wg = MetBuild::Grid(-90.0, 20.0, 120, 80, 0.1, 0.1, 0.0);
+  const auto rotated = MetBuild::Grid(-90.0, 20.0, 30, 25, 0.1, 0.1, 30.0);
+  REQUIRE_FALSE(wg.window(rotated).has_value());
+  const auto whole = wg.window(wg);
+  REQUIRE(whole.has_value());
+  REQUIRE(whole->ni == wg.ni());
+}
+
+TEST_CASE("Strided wind grid", "[Gen Wind Grid]") {
+  for (const double rotation : {0.0, 30.0}) {
+    const auto wg = MetBuild::Grid(-90.0, 20.0, 121, 80, 0.1, 0.1, rotation);
+    const auto strided = wg.strided(4);
+    REQUIRE(strided.ni() == 31);
+    REQUIRE(strided.nj() == 20);
+    REQUIRE(strided.rotation() == Approx(wg.rotation()));
+    for (size_t j = 0; j < strided.nj(); j += 3) {
+      for (size_t i = 0; i < strided.ni(); i += 5) {
+        REQUIRE(strided.position(i, j).x() ==
+                Approx(wg.position(4 * i, 4 * j).x()));
+        REQUIRE(strided.position(i, j).y() ==
+                Approx(wg.position(4 * i, 4 * j).y()));
+      }
+    }
+  }
+
+  auto wg = MetBuild::Grid(-90.0, 20.0, 10, 10, 0.1, 0.1, 0.0);
+  std::vector<uint8_t> mask(100, 1);
+  mask[2 * 10 + 4] = 0;
+  wg.set_mask(mask);
+  const auto strided = wg.strided(2);
+  REQUIRE(strided.has_mask());
+  REQUIRE_FALSE(strided.masked_in(2, 1));
+  REQUIRE(strided.masked_in(2, 2));
+  REQUIRE(wg.strided(1).ni() == 10);
+  REQUIRE_THROWS(wg.strided(0));
+
+  const auto points = MetBuild::Grid::from_points(
+      {{-90.0, 25.0}, {-89.5, 25.0}, {-89.5, 25.5}, {-90.0, 26.0}});
+  const auto kept = points.strided(3);
+  REQUIRE(kept.is_point_list());
+  REQUIRE(kept.ni() == 2);
+  REQUIRE(kept.position(1, 0).y() == 26.0);
+}
+
+TEST_CASE("Mesh node point list", "[Gen Wind Grid]") {
+  const std::string filename = "cxx_test_windgrid_fort.14";
+  {
+    std::ofstream f(filename);
+    f << "test mesh\n2 4\n";
+    f << "1 -90.0 25.0 10.0\n2 -89.5 25.0 12.0\n";
+    f << "3 -89.5 25.5 8.0\n4 -90.0 26.0 5.5\n";
+    f << "1 3 1 2 3\n2 3 1 3 4\n";
+  }
+  const auto wg = MetBuild::Grid::from_adcirc_mesh(filename);
+  std::remove(filename.c_str());
+
+  REQUIRE(wg.is_point_list());
+  REQUIRE(wg.ni() == 4);
+  REQUIRE(wg.nj() == 1);
+  REQUIRE(wg.position(2, 0).x() == -89.5);
+  REQUIRE(wg.position(3, 0).y() == 26.0);
+  REQUIRE(wg.bottom_left().x() == Approx(-90.0));
+  REQUIRE(wg.top_right().y() == Approx(26.0));
+  REQUIRE(wg.grid_positions().size() == 1);
+  REQUIRE(wg.grid_positions()[0][1].x() == -89.5);
+  REQUIRE(wg.x()[3] == -90.0);
+
+  const auto copy = MetBuild::Grid(wg);
+  REQUIRE(copy.is_point_list());
+  REQUIRE(copy.position(1, 0).x() == -89.5);
+  REQUIRE(copy.top_right().x() == Approx(-89.5));
+  REQUIRE(wg.band(0, 1).ni() == 4);
+
+  REQUIRE_THROWS(MetBuild::Grid::from_points({}));
+  REQUIRE_THROWS(MetBuild::Grid::from_adcirc_mesh("missing_fort.14"));
+}
+
+TEST_CASE("Wind grid fingerprint", "[Gen Wind Grid]") {
+  const auto wg = MetBuild::Grid(-100.0, 20.0, -90.0, 30.0, 0.25, 0.25);
+  REQUIRE(MetBuild::Grid(wg).fingerprint() == wg.fingerprint());
+  REQUIRE(MetBuild::Grid(-100.0, 20.0, -90.0, 30.0, 0.25, 0.25)
+              .fingerprint() == wg.fingerprint());
+  REQUIRE(MetBuild::Grid(-100.0, 20.0, -90.0, 30.0, 0.5, 0.5).fingerprint() !=
+          wg.fingerprint());
+  REQUIRE(MetBuild::Grid(-100.0, 20.0, -90.0, 30.0, 0.25, 0.25, 3857)
+              .fingerprint() != wg.fingerprint());
+  REQUIRE(wg.band(0, 4).fingerprint() != wg.fingerprint());
+
+  const auto points =
+      MetBuild::Grid::from_points({{-90.0, 25.0}, {-89.5, 25.0}});
+  REQUIRE(MetBuild::Grid(points).fingerprint() == points.fingerprint());
+  REQUIRE(MetBuild::Grid::from_points({{-90.0, 25.0}, {-89.0, 25.0}})
+              .fingerprint() != points.fingerprint());
+}
+
+TEST_CASE("Nested grid alignment", "[Gen Wind Grid]") {
+  const auto fine = MetBuild::Grid(-95.0, 25.0, -90.0, 30.0, 0.25, 0.25);
+  const auto coarse = MetBuild::Grid(-100.0, 20.0, -85.0, 35.0, 0.5, 0.5);
+
+  const auto w = MetBuild::NestedDomain::align(coarse, fine);
+  REQUIRE(w.has_value());
+  REQUIRE(w->si == 2);
+  REQUIRE(w->sj == 2);
+  REQUIRE(w->ci0 == 10);
+  REQUIRE(w->cj0 == 10);
+  REQUIRE(w->ni == 11);
+  REQUIRE(w->nj == 11);
+  REQUIRE(w->fi0 == 0);
+  REQUIRE(w->fj0 == 0);
+  REQUIRE(coarse.position(w->ci0 + 3, w->cj0 + 4).x() ==
+          Approx(fine.position(w->fi0 + 3 * w->si, w->fj0 + 4 * w->sj).x()));
+  REQUIRE(coarse.position(w->ci0 + 3, w->cj0 + 4).y() ==
+          Approx(fine.position(w->fi0 + 3 * w->si, w->fj0 + 4 * w->sj).y()));
+
+  //...Grids offset by a fraction of a cell, coarser than the other or on
+  // another projection are not nested
+  REQUIRE_FALSE(MetBuild::NestedDomain::align(
+      MetBuild::Grid(-100.1, 20.0, -85.1, 35.0, 0.5, 0.5), fine));
+  REQUIRE_FALSE(MetBuild::NestedDomain::align(fine, coarse));
+  REQUIRE_FALSE(MetBuild::NestedDomain::align(coarse, coarse));
+  REQUIRE_FALSE(MetBuild::NestedDomain::align(
+      coarse, MetBuild::Grid(-95.0, 25.0, -90.0, 30.0, 0.25, 0.25, 3857)));
+  REQUIRE_THROWS(MetBuild::NestedDomain(fine, coarse));
+
+  const auto mask = MetBuild::NestedDomain(coarse, fine).remainder_mask();
+  REQUIRE(mask.size() == coarse.ni() * coarse.nj());
+  REQUIRE(mask[0] == 1);
+  REQUIRE(mask[10 * coarse.ni() + 10] == 0);
+  REQUIRE(mask[20 * coarse.ni() + 20] == 0);
+  REQUIRE(mask[21 * coarse.ni() + 20] == 1);
+  REQUIRE(std::count(mask.begin(), mask.end(), 0) == 121);
+}
+
+TEST_CASE("Nested domain step exchange", "[Gen Wind Grid]") {
+  const auto fine = MetBuild::Grid(-95.0, 25.0, -94.0, 26.0, 0.25, 0.25);
+  const auto coarse = MetBuild::Grid(-96.0, 24.0, -93.0, 27.0, 0.5, 0.5);
+  MetBuild::NestedDomain nest(coarse, fine);
+  const auto &w = nest.window();
+  REQUIRE(w.ni == 3);
+  REQUIRE(w.nj == 3);
+
+  std::vector<MetBuild::MeteorologicalDataType> values(fine.ni() * fine.nj());
+  for (size_t k = 0; k < values.size(); ++k) values[k] = k;
+  const MetBuild::Date t(2023, 1, 1, 0, 0, 0);
+  nest.publish(t, {values.data()}, {{0, values.size()}});
+
+  std::vector<MetBuild::MeteorologicalDataType> out(coarse.ni() * coarse.nj(),
+                                                    -1);
+  MetBuild::InterpolationWeights::CellRanges valid;
+  nest.take(t, {out.data()}, valid);
+  for (size_t j = 0; j < w.nj; ++j) {
+    for (size_t i = 0; i < w.ni; ++i) {
+      REQUIRE(out[(w.cj0 + j) * coarse.ni() + w.ci0 + i] ==
+              values[(2 * j) * fine.ni() + 2 * i]);
+    }
+  }
+  REQUIRE(out[0] == -1);
+  REQUIRE(valid.size() == 3);
+  REQUIRE(valid[0].begin == w.cj0 * coarse.ni() + w.ci0);
+  REQUIRE(valid[0].end == valid[0].begin + 3);
+
+  nest.publish(t + 3600, {values.data()}, {});
+  REQUIRE_THROWS(nest.take(t, {out.data()}, valid));
+  nest.close();
+  REQUIRE_THROWS_AS(nest.take(t, {out.data()}, valid), MetBuild::Cancelled);
+}
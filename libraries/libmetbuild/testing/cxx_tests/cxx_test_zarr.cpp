@@ -0,0 +1,153 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Date.h"
+#include "Grid.h"
+#include "MeteorologicalData.h"
+#include "boost/filesystem.hpp"
+#include "boost/iostreams/copy.hpp"
+#include "boost/iostreams/filter/zlib.hpp"
+#include "boost/iostreams/filtering_stream.hpp"
+#include "catch.hpp"
+#include "output/ZarrOutput.h"
+#include "test_utilities.h"
+
+using MetBuild::Testing::read_file;
+
+namespace {
+std::string inflate(const std::string &compressed) {
+  std::istringstream input(compressed);
+  boost::iostreams::filtering_istream stream;
+  stream.push(boost::iostreams::zlib_decompressor());
+  stream.push(input);
+  std::ostringstream output;
+  boost::iostreams::copy(stream, output);
+  return output.str();
+}
+}  // namespace
+
+TEST_CASE("Zarr store layout", "[zarr]") {
+  const std::string store = "zarr_test.zarr";
+  boost::filesystem::remove_all(store);
+
+  const auto grid = MetBuild::Grid(-100.0, 20.0, -90.0, 30.0, 0.5, 0.5);
+  const MetBuild::Date start(2023, 6, 1, 0, 0, 0);
+  const MetBuild::Date end(2023, 6, 1, 3, 0, 0);
+
+  MetBuild::MeteorologicalData<3> data(grid.ni(), grid.nj());
+  for (size_t k = 0; k < 3; ++k) {
+    for (size_t j = 0; j < grid.nj(); ++j) {
+      for (size_t i = 0; i < grid.ni(); ++i) {
+        data.set(k, i, j, static_cast<double>(k * 1000 + j * grid.ni() + i));
+      }
+    }
+  }
+
+  MetBuild::ZarrOutput output(start, end, 3600, store);
+  output.addDomain(grid, {"wind_u", "wind_v", "mslp"});
+  auto written = output.take_written();
+  REQUIRE(written.size() == 17);
+
+  output.write(start + 3600, 0, data);
+  written = output.take_written();
+  REQUIRE(written.size() == 4);
+  REQUIRE(output.take_written().empty());
+
+  const std::string group = store + "/domain_00";
+  const auto zarray = read_file(group + "/mslp/.zarray");
+  REQUIRE(zarray.find("\"shape\": [4, 21, 21]") != std::string::npos);
+  REQUIRE(zarray.find("\"chunks\": [1, 21, 21]") != std::string::npos);
+  REQUIRE(zarray.find("\"id\": \"zlib\"") != std::string::npos);
+  REQUIRE(read_file(group + "/mslp/.zattrs").find("\"lat\", \"lon\"") !=
+          std::string::npos);
+
+  REQUIRE_FALSE(boost::filesystem::exists(group + "/mslp/0.0.0"));
+  const auto chunk = inflate(read_file(group + "/mslp/1.0.0"));
+  REQUIRE(chunk.size() == grid.ni() * grid.nj() * sizeof(float));
+  const auto *values = reinterpret_cast<const float *>(chunk.data());
+  for (size_t c = 0; c < grid.ni() * grid.nj(); ++c) {
+    REQUIRE(values[c] == static_cast<float>(2000 + c));
+  }
+
+  const auto time = read_file(group + "/time/1");
+  REQUIRE(time.size() == sizeof(double));
+  REQUIRE(*reinterpret_cast<const double *>(time.data()) == 60.0);
+
+  REQUIRE_THROWS(output.write(end + 3600, 0, data));
+  REQUIRE(output.filenames().size() == 21);
+  boost::filesystem::remove_all(store);
+}
+
+TEST_CASE("Zarr overview levels", "[zarr]") {
+  const std::string store = "zarr_overview_test.zarr";
+  boost::filesystem::remove_all(store);
+
+  const auto grid = MetBuild::Grid(-100.0, 20.0, -90.0, 30.0, 0.5, 0.5);
+  const MetBuild::Date start(2023, 6, 1, 0, 0, 0);
+  const MetBuild::Date end(2023, 6, 1, 3, 0, 0);
+
+  MetBuild::MeteorologicalData<1> data(grid.ni(), grid.nj());
+  for (size_t j = 0; j < grid.nj(); ++j) {
+    for (size_t i = 0; i < grid.ni(); ++i) {
+      data.set(0, i, j, static_cast<double>(j * grid.ni() + i));
+    }
+  }
+  data.set(0, 20, 20, MetBuild::MeteorologicalData<1>::flag_value());
+
+  MetBuild::ZarrOutput output(start, end, 3600, store, false);
+  REQUIRE_THROWS(output.set_overviews({1}));
+  output.set_overviews({2, 4});
+  output.addDomain(grid, {"mslp"});
+  output.write(start, 0, data);
+
+  const std::string group = store + "/domain_00";
+  REQUIRE(read_file(group + "/.zattrs").find("\"overviews\": [2, 4]") !=
+          std::string::npos);
+  REQUIRE(read_file(group + "/overview_2/mslp/.zarray")
+              .find("\"shape\": [4, 11, 11]") != std::string::npos);
+  REQUIRE(read_file(group + "/overview_4/mslp/.zarray")
+              .find("\"shape\": [4, 6, 6]") != std::string::npos);
+  REQUIRE(boost::filesystem::exists(group + "/overview_4/lat/0"));
+
+  const auto chunk = read_file(group + "/overview_2/mslp/0.0.0");
+  REQUIRE(chunk.size() == 11 * 11 * sizeof(float));
+  const auto *values = reinterpret_cast<const float *>(chunk.data());
+  REQUIRE(values[0] == Approx((0 + 1 + 21 + 22) / 4.0));
+  REQUIRE(values[5] == Approx((10 + 11 + 31 + 32) / 4.0));
+  REQUIRE(values[10] == Approx((20 + 41) / 2.0));
+  REQUIRE(values[120] == MetBuild::MeteorologicalData<1>::flag_value());
+
+  const auto coarse = read_file(group + "/overview_2/lon/0");
+  REQUIRE(reinterpret_cast<const double *>(coarse.data())[0] ==
+          Approx(-99.75));
+  boost::filesystem::remove_all(store);
+}
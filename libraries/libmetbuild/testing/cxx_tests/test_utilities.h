@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////////
+// MIT License
+//
+// Copyright (c) 2023 The Water Institute
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Zachary Cobell
+// Contact: zcobell@thewaterinstitute.org
+// Organization: The Water Institute
+//
+////////////////////////////////////////////////////////////////////////////////////
+#ifndef METBUILD_TESTING_TEST_UTILITIES_H_
+#define METBUILD_TESTING_TEST_UTILITIES_H_
+
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace MetBuild {
+namespace Testing {
+
+/**
+ * @brief Contents of a file, empty when it cannot be read
+ * @param filename file read
+ */
+inline std::string read_file(const std::string &filename) {
+  std::ifstream f(filename, std::ios::binary);
+  std::ostringstream s;
+  s << f.rdbuf();
+  return s.str();
+}
+
+/**
+ * @brief Value written to a field of the OWI test grids, distinct for each
+ * snapshot, field and point
+ * @param snap snapshot index
+ * @param field field index, the pressure being field 2
+ * @param j row of the point
+ * @param i column of the point
+ */
+inline float sample(int snap, size_t field, size_t j, size_t i) {
+  switch (field) {
+    case 0:
+      return static_cast<float>(snap) + static_cast<float>(i);
+    case 1:
+      return static_cast<float>(snap) - static_cast<float>(j);
+    default:
+      return 1000.0f + static_cast<float>(snap) + static_cast<float>(i * j);
+  }
+}
+
+}  // namespace Testing
+}  // namespace MetBuild
+
+#endif  // METBUILD_TESTING_TEST_UTILITIES_H_
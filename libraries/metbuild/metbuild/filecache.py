@@ -0,0 +1,290 @@
+#!/usr/bin/env python3
+###################################################################################################
+# MIT License
+#
+# Copyright (c) 2023 The Water Institute
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+# Author: Zach Cobell
+# Contact: zcobell@thewaterinstitute.org
+# Organization: The Water Institute
+#
+###################################################################################################
+
+import logging
+import os
+from contextlib import contextmanager
+from typing import Callable, List, Union
+
+
+class FileCache:
+    """
+    Node-local cache of downloaded files shared by every build job on the
+    machine. Entries are committed atomically, so concurrent jobs never see
+    a partial file, and a job that finds another one downloading the same
+    file waits for it instead of downloading it again. The least recently
+    used entries are removed once the cache grows past its byte budget.
+
+    The cache is disabled unless the METGET_FILE_CACHE environment variable
+    names a directory. The budget is set with METGET_FILE_CACHE_SIZE, in
+    bytes
+    """
+
+    DEFAULT_SIZE = 50 * 1024 * 1024 * 1024
+
+    def __init__(self, directory: str = None, size: int = None):
+        """
+        Constructor
+
+        Args:
+            directory (str): The cache directory, METGET_FILE_CACHE by default
+            size (int): The byte budget, METGET_FILE_CACHE_SIZE by default
+        """
+        if directory is None:
+            directory = os.environ.get("METGET_FILE_CACHE", "")
+        if size is None:
+            size = int(
+                os.environ.get("METGET_FILE_CACHE_SIZE", FileCache.DEFAULT_SIZE)
+            )
+        self.__directory = directory
+        self.__size = size
+        if self.enabled():
+            os.makedirs(os.path.join(self.__directory, "locks"), exist_ok=True)
+
+    def enabled(self) -> bool:
+        """
+        Returns:
+            bool: True if a cache directory is configured
+        """
+        return len(self.__directory) > 0
+
+    def __entry(self, key: str) -> str:
+        """
+        Returns the path of the cache entry for a key
+
+        Args:
+            key (str): The key of the entry, typically the remote path
+
+        Returns:
+            str: The path of the entry
+        """
+        import hashlib
+
+        digest = hashlib.sha256(key.encode("utf-8")).hexdigest()
+        return os.path.join(self.__directory, "entry_" + digest)
+
+    @contextmanager
+    def __lock(self, name: str):
+        """
+        Holds an exclusive lock shared by every process using the cache
+
+        Args:
+            name (str): The name of the lock
+        """
+        import fcntl
+
+        with open(os.path.join(self.__directory, "locks", name), "a") as f:
+            fcntl.flock(f, fcntl.LOCK_EX)
+            try:
+                yield
+            finally:
+                fcntl.flock(f, fcntl.LOCK_UN)
+
+    @staticmethod
+    def __link(entry: str, local_file: str) -> bool:
+        """
+        Links a cache entry to a local file. The link keeps the data alive
+        if the entry is evicted while the local file is still in use
+
+        Args:
+            entry (str): The cache entry
+            local_file (str): The local file to create
+
+        Returns:
+            bool: True if the entry exists and was linked
+        """
+        import shutil
+
+        if os.path.exists(local_file):
+            os.remove(local_file)
+        try:
+            os.link(entry, local_file)
+        except FileNotFoundError:
+            return False
+        except OSError:
+            # ...The cache lives on another file system
+            try:
+                shutil.copyfile(entry, local_file)
+            except FileNotFoundError:
+                return False
+
+        # ...Mark the entry as recently used for the eviction order
+        os.utime(entry)
+        return True
+
+    def __commit(self, entry: str, fill: Callable[[str], None]) -> None:
+        """
+        Fills a cache entry under a temporary name and renames it into place
+
+        Args:
+            entry (str): The cache entry
+            fill (Callable[[str], None]): Writes the data to the path given
+        """
+        temporary = "{:s}.{:d}.tmp".format(entry, os.getpid())
+        try:
+            fill(temporary)
+            os.replace(temporary, entry)
+        finally:
+            if os.path.exists(temporary):
+                os.remove(temporary)
+
+    def retrieve(
+        self, key: str, local_file: str, fill: Callable[[str], None]
+    ) -> None:
+        """
+        Places the file for a key at a local path, downloading it only if
+        it is not already cached
+
+        Args:
+            key (str): The key of the entry, typically the remote path
+            local_file (str): The local file to create
+            fill (Callable[[str], None]): Downloads the data to the path given
+        """
+        log = logging.getLogger(__name__)
+
+        if not self.enabled():
+            fill(local_file)
+            return
+
+        entry = self.__entry(key)
+        with self.__lock(os.path.basename(entry)):
+            if FileCache.__link(entry, local_file):
+                log.info("Using cached copy of {:s}".format(key))
+                return
+            self.__commit(entry, fill)
+            FileCache.__link(entry, local_file)
+        self.__evict()
+
+    def warm(self, key: str, fill: Callable[[str], None]) -> bool:
+        """
+        Fills the entry for a key ahead of its use, such as for a request
+        still waiting on the queue. Nothing is downloaded if it is already
+        cached
+
+        Args:
+            key (str): The key of the entry, typically the remote path
+            fill (Callable[[str], None]): Downloads the data to the path given
+
+        Returns:
+            bool: True if the entry was downloaded
+        """
+        if not self.enabled():
+            return False
+
+        entry = self.__entry(key)
+        with self.__lock(os.path.basename(entry)):
+            if os.path.exists(entry):
+                return False
+            self.__commit(entry, fill)
+        self.__evict()
+        return True
+
+    def read(self, key: str, fill: Callable[[], List[bytes]]) -> List[bytes]:
+        """
+        Returns the contents for a key, downloading them only if they are
+        not already cached
+
+        Args:
+            key (str): The key of the entry
+            fill (Callable[[], List[bytes]]): Downloads the data
+
+        Returns:
+            List[bytes]: The contents of the entry
+        """
+        if not self.enabled():
+            return fill()
+
+        log = logging.getLogger(__name__)
+
+        def write(path: str) -> None:
+            with open(path, "wb") as f:
+                for part in fill():
+                    f.write(part)
+
+        entry = self.__entry(key)
+        with self.__lock(os.path.basename(entry)):
+            data = FileCache.__read(entry)
+            if data is not None:
+                log.info("Using cached copy of {:s}".format(key))
+                return [data]
+            self.__commit(entry, write)
+            data = FileCache.__read(entry)
+        self.__evict()
+        return [data]
+
+    @staticmethod
+    def __read(entry: str) -> Union[bytes, None]:
+        """
+        Reads a cache entry
+
+        Args:
+            entry (str): The cache entry
+
+        Returns:
+            Union[bytes, None]: The contents, or None if the entry does not exist
+        """
+        try:
+            with open(entry, "rb") as f:
+                data = f.read()
+        except FileNotFoundError:
+            return None
+        os.utime(entry)
+        return data
+
+    def __evict(self) -> None:
+        """
+        Removes the least recently used entries until the cache fits in its
+        byte budget. Files linked from an evicted entry are not affected
+        """
+        with self.__lock("evict"):
+            entries = []
+            total = 0
+            with os.scandir(self.__directory) as it:
+                for e in it:
+                    if not e.is_file() or not e.name.startswith("entry_"):
+                        continue
+                    if e.name.endswith(".tmp"):
+                        continue
+                    try:
+                        st = e.stat()
+                    except FileNotFoundError:
+                        continue
+                    entries.append((st.st_mtime, st.st_size, e.path))
+                    total += st.st_size
+
+            entries.sort()
+            for _, size, path in entries:
+                if total <= self.__size:
+                    break
+                try:
+                    os.remove(path)
+                except FileNotFoundError:
+                    pass
+                total -= size
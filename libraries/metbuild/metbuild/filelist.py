@@ -28,6 +28,10 @@
 #
 ###################################################################################################
 
+import copy
+import os
+import threading
+from collections import OrderedDict
 from sqlalchemy import func
 from datetime import datetime
 from typing import Union
@@ -39,8 +43,20 @@ class Filelist:
     """
     This class is used to generate a list of files that will be used to generate the
     requested forcing data.
+
+    Resolved lists are kept by the process, so requests repeating the selection of
+    an earlier one in the same cycle skip the queries. Each entry is keyed by the
+    generation of the service tables, the range of their ids and the last time a
+    row was written, so the entries are invalidated as soon as the downloader adds
+    or updates a row. The number of entries kept is set with
+    METGET_FILELIST_CACHE_SIZE, and 0 disables the cache
     """
 
+    CACHE_SIZE = int(os.environ.get("METGET_FILELIST_CACHE_SIZE", 256))
+
+    __cache = OrderedDict()
+    __cache_lock = threading.Lock()
+
     def __init__(
         self,
         service: str,
@@ -88,7 +104,7 @@ class Filelist:
         self.__ensemble_member = ensemble_member
         self.__error = []
         self.__valid = False
-        self.__files = self.__query_files()
+        self.__files = self.__cached_query_files()
 
     @staticmethod
     def __rows2dicts(data: list) -> list:
@@ -146,6 +162,111 @@ class Filelist:
 
         return data_single
 
+    @staticmethod
+    def __service_tables(service: str) -> Union[list, None]:
+        """
+        Returns the tables the files of a service are selected from
+
+        Args:
+            service (str): The service
+
+        Returns:
+            list: The tables, or None for an unknown service
+        """
+        from .tables import (
+            GfsTable,
+            NamTable,
+            HwrfTable,
+            CoampsTable,
+            CtcxTable,
+            HrrrTable,
+            HrrrAlaskaTable,
+            GefsTable,
+            WpcTable,
+            NhcBtkTable,
+            NhcFcstTable,
+        )
+
+        return {
+            "gfs-ncep": [GfsTable],
+            "nam-ncep": [NamTable],
+            "hwrf": [HwrfTable],
+            "coamps-tc": [CoampsTable],
+            "coamps-ctcx": [CtcxTable],
+            "hrrr-ncep": [HrrrTable],
+            "hrrr-alaska-ncep": [HrrrAlaskaTable],
+            "gefs-ncep": [GefsTable],
+            "wpc-ncep": [WpcTable],
+            "nhc": [NhcBtkTable, NhcFcstTable],
+        }.get(service)
+
+    @staticmethod
+    def __generation(tables: list) -> tuple:
+        """
+        Returns the generation of a set of tables, which changes whenever a row
+        is added, removed or rewritten
+
+        Args:
+            tables (list): The tables
+
+        Returns:
+            tuple: The generation
+        """
+        generation = []
+        with Database() as db, db.session() as session:
+            for table in tables:
+                generation.extend(
+                    session.query(
+                        func.min(table.index),
+                        func.max(table.index),
+                        func.max(table.accessed),
+                    ).one()
+                )
+        return tuple(generation)
+
+    def __cached_query_files(self) -> Union[list, dict, None]:
+        """
+        Returns the files for the request from the process cache when the same
+        selection was resolved against the current generation of the tables,
+        otherwise queries them
+
+        Returns:
+            list: The list of files that will be used to generate the requested forcing
+        """
+        tables = Filelist.__service_tables(self.__service)
+        if Filelist.CACHE_SIZE <= 0 or tables is None:
+            return self.__query_files()
+
+        key = (
+            self.__service,
+            self.__param,
+            self.__start,
+            self.__end,
+            self.__tau,
+            self.__storm_year,
+            self.__storm,
+            self.__basin,
+            self.__advisory,
+            self.__nowcast,
+            self.__multiple_forecasts,
+            self.__ensemble_member,
+            Filelist.__generation(tables),
+        )
+
+        with Filelist.__cache_lock:
+            if key in Filelist.__cache:
+                Filelist.__cache.move_to_end(key)
+                files, self.__valid = Filelist.__cache[key]
+                return copy.copy(files)
+
+        files = self.__query_files()
+
+        with Filelist.__cache_lock:
+            Filelist.__cache[key] = (copy.copy(files), self.__valid)
+            while len(Filelist.__cache) > Filelist.CACHE_SIZE:
+                Filelist.__cache.popitem(last=False)
+        return files
+
     def __query_files(self) -> Union[list, dict, None]:
         """
         This method is used to query the database for the files that will be used to
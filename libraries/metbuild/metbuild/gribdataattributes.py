@@ -27,6 +27,87 @@
 # Organization: The Water Institute
 #
 ###################################################################################################
+from typing import List, Union
+
+# ...Suffix of the MetGet field file written next to an archived grib file,
+#    holding its decoded fields so that requests do not unpack it again
+FIELD_FILE_SUFFIX = ".mbf"
+
+# ...Suffix of the message index written next to an archived grib file, read
+#    by libmetbuild in place of scanning the messages of the file
+INDEX_FILE_SUFFIX = ".mbi"
+
+
+def field_file_region() -> Union[List[float], None]:
+    """
+    Returns the region field files are cropped to, set in
+    METGET_FIELD_FILE_REGION as "xmin,ymin,xmax,ymax" in degrees, -180 to 180
+
+    Returns:
+        list: The region, or None when field files hold the full grid
+    """
+    import os
+
+    region = os.environ.get("METGET_FIELD_FILE_REGION")
+    if not region:
+        return None
+    values = [float(v) for v in region.split(",")]
+    if len(values) != 4:
+        raise ValueError("METGET_FIELD_FILE_REGION must be xmin,ymin,xmax,ymax")
+    return values
+
+
+# ...Variable types of a request and the libmetbuild data types they read
+VARIABLE_TYPES = {
+    "wind_pressure": "WIND_PRESSURE",
+    "rain": "RAINFALL",
+    "temperature": "TEMPERATURE",
+    "humidity": "HUMIDITY",
+    "ice": "ICE",
+}
+
+# ...Inventory step descriptions of the non-instantaneous step types
+STEP_TYPES = {"avg": " ave", "accum": " acc"}
+
+
+def find_inventory_message(inventory: list, variable: dict) -> Union[dict, None]:
+    """
+    Finds the byte range of a variable in a grib inventory (.idx) file
+
+    Variables from the libmetbuild manifest carry a step type and must match
+    the parameter, level and step type of the message exactly. Variables from
+    the static lists are matched on their long name alone
+
+    Args:
+        inventory (list): The lines of the inventory
+        variable (dict): The variable dictionary
+
+    Returns:
+        dict: The name of the variable and the byte range of its message
+    """
+    step_type = variable.get("step_type")
+    for i in range(len(inventory)):
+        line = inventory[i]
+        if step_type is None:
+            found = variable["long_name"] in line
+        else:
+            fields = line.split(":")
+            step = fields[5] if len(fields) > 5 else ""
+            if step_type in STEP_TYPES:
+                step_match = STEP_TYPES[step_type] in step
+            else:
+                step_match = not any(s in step for s in STEP_TYPES.values())
+            found = ":{}:".format(variable["long_name"]) in line and step_match
+        if found:
+            start_bits = line.split(":")[1]
+            if i + 1 == len(inventory):
+                end_bits = ""
+            else:
+                end_bits = inventory[i + 1].split(":")[1]
+            return {"name": variable["name"], "start": start_bits, "end": end_bits}
+    return None
+
+
 class GribDataAttributes:
     def __init__(
         self,
@@ -36,8 +117,10 @@ class GribDataAttributes:
         variables: dict,
         cycles: list,
         ensemble_members: list = None,
+        source: str = None,
     ):
         self.__name = name
+        self.__source = source
         self.__table = table
         self.__bucket = bucket
         self.__cycles = cycles
@@ -61,8 +144,79 @@ class GribDataAttributes:
     def bucket(self) -> str:
         return self.__bucket
 
-    def variables(self) -> dict:
-        return self.__variables
+    def source(self) -> str:
+        return self.__source
+
+    def variables(self, variable_type: str = "all") -> List[dict]:
+        """
+        Returns the variables to download. When pymetbuild is available these
+        are the messages libmetbuild decodes for the variable type, so nothing
+        else is fetched. Otherwise the static list of the source is returned
+        and the caller selects the variables for the type
+
+        Args:
+            variable_type (str): The variable type, or "all" for every type
+
+        Returns:
+            list: The variables to download
+        """
+        messages = self.__manifest(variable_type)
+        if messages is None:
+            return self.__variables
+        return messages
+
+    def __manifest(self, variable_type: str) -> Union[List[dict], None]:
+        """
+        Generates the variable list from the grib messages libmetbuild decodes
+
+        Args:
+            variable_type (str): The variable type, or "all" for every type
+
+        Returns:
+            list: The variables to download, or None without pymetbuild
+        """
+        if self.__source is None:
+            return None
+        try:
+            import pymetbuild
+        except ImportError:
+            return None
+
+        names = {
+            pymetbuild.VAR_PRESSURE: "press",
+            pymetbuild.VAR_U10: "uvel",
+            pymetbuild.VAR_V10: "vvel",
+            pymetbuild.VAR_TEMPERATURE: "temperature",
+            pymetbuild.VAR_HUMIDITY: "humidity",
+            pymetbuild.VAR_ICE: "ice",
+        }
+
+        if variable_type == "all":
+            types = VARIABLE_TYPES.values()
+        else:
+            types = [VARIABLE_TYPES[variable_type]]
+
+        source = getattr(pymetbuild.Meteorology, self.__source)
+        variables = []
+        for t in types:
+            for m in pymetbuild.Meteorology.grib_messages(
+                source, getattr(pymetbuild, t)
+            ):
+                if m.variable == pymetbuild.VAR_RAINFALL:
+                    if m.stepType == "accum":
+                        name = "accumulated_precip"
+                    else:
+                        name = "precip_rate"
+                else:
+                    name = names[m.variable]
+                variables.append(
+                    {
+                        "name": name,
+                        "long_name": "{}:{}".format(m.parameter, m.level),
+                        "step_type": m.stepType,
+                    }
+                )
+        return variables
 
     def cycles(self) -> list:
         return self.__cycles
@@ -85,6 +239,7 @@ NCEP_GFS = GribDataAttributes(
         "temperature": "TMP:30-0 mb above ground",
     },
     [0, 6, 12, 18],
+    source="GFS",
 )
 
 NCEP_NAM = GribDataAttributes(
@@ -100,6 +255,7 @@ NCEP_NAM = GribDataAttributes(
         "temperature": "TMP:30-0 mb above ground",
     },
     [0, 6, 12, 18],
+    source="NAM",
 )
 
 NCEP_GEFS = GribDataAttributes(
@@ -122,6 +278,7 @@ NCEP_GEFS = GribDataAttributes(
     #   c00 => control
     #   pXX => perturbation XX (1-30)
     ["avg", "c00", *[f"p{i:02d}" for i in range(1, 31)]],
+    source="GEFS",
 )
 
 NCEP_HRRR = GribDataAttributes(
@@ -138,6 +295,7 @@ NCEP_HRRR = GribDataAttributes(
         "temperature": "TMP:2 m above ground",
     },
     [i for i in range(0, 24)],
+    source="HRRR_CONUS",
 )
 
 NCEP_HRRR_ALASKA = GribDataAttributes(
@@ -154,6 +312,7 @@ NCEP_HRRR_ALASKA = GribDataAttributes(
         "temperature": "TMP:2 m above ground",
     },
     [i for i in range(0, 24)],
+    source="HRRR_ALASKA",
 )
 
 NCEP_HWRF = GribDataAttributes(
@@ -169,6 +328,7 @@ NCEP_HWRF = GribDataAttributes(
         "temperature": "TMP:2 m above ground",
     },
     [0, 6, 12, 18],
+    source="HWRF",
 )
 
 NCEP_WPC = GribDataAttributes(
@@ -179,4 +339,5 @@ NCEP_WPC = GribDataAttributes(
         "accumulated_precip": "APCP",
     },
     [0, 6, 12, 18],
+    source="WPC",
 )
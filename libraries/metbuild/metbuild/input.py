@@ -31,6 +31,11 @@
 from datetime import datetime
 
 VALID_DATA_TYPES = ["wind_pressure", "rain", "ice", "humidity", "temperature"]
+VALID_COMPRESSION_CODECS = ["none", "gzip", "zstd", "lz4"]
+
+# ...Grid and time strides of a preview request given as a flag
+PREVIEW_GRID_STRIDE = 4
+PREVIEW_TIME_STRIDE = 3
 
 
 class Input:
@@ -64,6 +69,11 @@ class Input:
         self.__valid = True
         self.__dry_run = False
         self.__compression = False
+        self.__compression_codec = "none"
+        self.__shard_hours = None
+        self.__shard_bytes = None
+        self.__preview = False
+        self.__preview_stride = 1
         self.__epsg = 4326
         self.__request_id = None
         self.__error = []
@@ -135,6 +145,57 @@ class Input:
         """
         return self.__compression
 
+    def compression_codec(self) -> str:
+        """
+        Returns the codec used to compress the ascii and binary outputs. The
+        compression option may be given as a boolean, which selects gzip, or
+        as the name of a codec
+
+        Returns:
+            one of "none", "gzip", "zstd" or "lz4"
+        """
+        return self.__compression_codec
+
+    def shard_hours(self):
+        """
+        Returns the span, in hours, of each file the output is split into, or
+        None when the output is not split by time
+
+        Returns:
+            span of each shard in hours
+        """
+        return self.__shard_hours
+
+    def shard_bytes(self):
+        """
+        Returns the approximate size, in bytes, of each file the output is
+        split into, or None when the output is not split by size
+
+        Returns:
+            size of each shard in bytes
+        """
+        return self.__shard_bytes
+
+    def preview(self) -> bool:
+        """
+        Returns whether the request is a quick preview, built with nearest
+        neighbour weights on a decimated grid and time step and written to
+        netcdf
+
+        Returns:
+            boolean indicating if the request is a preview
+        """
+        return self.__preview
+
+    def preview_stride(self) -> int:
+        """
+        Returns the step between the grid points kept in a preview
+
+        Returns:
+            grid stride of the preview, 1 when the request is not a preview
+        """
+        return self.__preview_stride
+
     def error(self) -> list:
         """
         Returns the error message
@@ -323,9 +384,27 @@ class Input:
             self.__filename = self.__json["filename"]
             self.__format = self.__json["format"]
 
+            # ...Given either as a flag or as a dict with the strides
+            if "preview" in self.__json.keys() and self.__json["preview"]:
+                preview = self.__json["preview"]
+                if not isinstance(preview, dict):
+                    preview = {}
+                self.__preview = True
+                self.__preview_stride = int(
+                    preview.get("stride", PREVIEW_GRID_STRIDE)
+                )
+                time_stride = int(preview.get("time_stride", PREVIEW_TIME_STRIDE))
+                if self.__preview_stride <= 0 or time_stride <= 0:
+                    raise RuntimeError("Invalid preview stride specified")
+                self.__time_step = self.__time_step * time_stride
+                self.__format = "owi-netcdf"
+
             if self.__format == "owi-netcdf" or self.__format == "hec-netcdf":
                 if not self.__filename[-3:-1] == "nc":
                     self.__filename = self.__filename + ".nc"
+            elif self.__format == "zarr":
+                if not self.__filename.endswith(".zarr"):
+                    self.__filename = self.__filename + ".zarr"
 
             if "data_type" in self.__json.keys():
                 self.__data_type = self.__json["data_type"]
@@ -336,7 +415,28 @@ class Input:
                 self.__dry_run = self.__json["dry_run"]
 
             if "compression" in self.__json.keys():
-                self.__compression = self.__json["compression"]
+                compression = self.__json["compression"]
+                if isinstance(compression, str):
+                    codec = compression.lower()
+                    if codec not in VALID_COMPRESSION_CODECS:
+                        raise RuntimeError("Invalid compression codec specified")
+                else:
+                    codec = "gzip" if compression else "none"
+                self.__compression_codec = codec
+                self.__compression = codec != "none"
+
+            if "shard_hours" in self.__json.keys():
+                self.__shard_hours = float(self.__json["shard_hours"])
+                if self.__shard_hours <= 0:
+                    raise RuntimeError("Invalid shard span specified")
+
+            if "shard_bytes" in self.__json.keys():
+                self.__shard_bytes = int(self.__json["shard_bytes"])
+                if self.__shard_bytes <= 0:
+                    raise RuntimeError("Invalid shard size specified")
+
+            if self.__shard_hours is not None and self.__shard_bytes is not None:
+                raise RuntimeError("Only one of shard_hours and shard_bytes may be set")
 
             if "backfill" in self.__json.keys():
                 self.__backfill = self.__json["backfill"]
@@ -368,6 +468,8 @@ class Input:
                     name, service, self.__json["domains"][i], self.__no_construct
                 )
                 if d.valid():
+                    if self.__preview and d.service() != "nhc":
+                        d.grid().decimate(self.__preview_stride)
                     self.__domains.append(d)
                 else:
                     self.__valid = False
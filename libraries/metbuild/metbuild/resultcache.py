@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+###################################################################################################
+# MIT License
+#
+# Copyright (c) 2023 The Water Institute
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+# Author: Zach Cobell
+# Contact: zcobell@thewaterinstitute.org
+# Organization: The Water Institute
+#
+###################################################################################################
+
+import json
+import logging
+from concurrent.futures import ThreadPoolExecutor
+
+import boto3
+from botocore.exceptions import BotoCoreError, ClientError
+
+
+class ResultCache:
+    """
+    Index of the outputs of earlier requests, so a request identical to one
+    already built, e.g. retried by a client or submitted by several users, is
+    answered with a copy of its output instead of a new build.
+
+    Requests are keyed with pymetbuild.RequestKey over the normalized request
+    and the files resolved for each domain, so a request made after new data
+    arrived is built again. The entry of a key, <prefix>/<request key>.json,
+    holds the id of the request that was built and its output files, which
+    are copied within the bucket to the prefix of the new request. An entry
+    whose files have expired is replaced by the next build
+
+    Builds are also indexed by family, the settings of a request other than
+    its grid, dates and filename, in <prefix>/family/<family key>.json, so a
+    request on a window and time range of a larger build can be cut from its
+    output
+    """
+
+    PREFIX = "result_index"
+
+    # ...Number of builds kept in the index of a family, newest first
+    FAMILY_SIZE = 16
+
+    # ...Number of output files copied at the same time
+    COPY_THREADS = 8
+
+    def __init__(self, bucket: str):
+        """
+        Constructor
+
+        Args:
+            bucket (str): Name of the S3 bucket the outputs are uploaded to
+        """
+        self.__bucket = bucket
+        self.__client = boto3.client("s3")
+
+    def lookup(self, key: str):
+        """
+        Finds the request built earlier with the same key
+
+        Args:
+            key (str): Key generated by pymetbuild.RequestKey
+
+        Returns:
+            dict: The request_id and output_files of the request, or None
+        """
+        try:
+            response = self.__client.get_object(
+                Bucket=self.__bucket, Key=self.__entry_file(key)
+            )
+            entry = json.loads(response["Body"].read())
+            if entry["request_id"] and entry["output_files"]:
+                return entry
+        except (BotoCoreError, ClientError):
+            pass
+        except (ValueError, KeyError, TypeError):
+            logging.getLogger(__name__).warning(
+                "Ignoring invalid result index entry " + key
+            )
+        return None
+
+    def reuse(self, entry: dict, request_id: str) -> bool:
+        """
+        Copies the output of an earlier request to the prefix of a request
+
+        Args:
+            entry (dict): Entry returned by lookup
+            request_id (str): The request the output is copied to
+
+        Returns:
+            bool: False if any file could not be copied, e.g. it has expired
+        """
+
+        def copy(f: str) -> None:
+            self.__client.copy_object(
+                Bucket=self.__bucket,
+                Key="{:s}/{:s}".format(request_id, f),
+                CopySource={
+                    "Bucket": self.__bucket,
+                    "Key": "{:s}/{:s}".format(entry["request_id"], f),
+                },
+            )
+
+        try:
+            with ThreadPoolExecutor(max_workers=ResultCache.COPY_THREADS) as pool:
+                for c in [pool.submit(copy, f) for f in entry["output_files"]]:
+                    c.result()
+        except (BotoCoreError, ClientError) as e:
+            logging.getLogger(__name__).warning(
+                "Could not reuse the output of request {:s}: {:s}".format(
+                    entry["request_id"], str(e)
+                )
+            )
+            return False
+        return True
+
+    def record(self, key: str, request_id: str, output_files: list) -> None:
+        """
+        Records the output of a request that was built
+
+        Args:
+            key (str): Key generated by pymetbuild.RequestKey
+            request_id (str): The request
+            output_files (list): Files uploaded to the prefix of the request
+        """
+        try:
+            self.__client.put_object(
+                Bucket=self.__bucket,
+                Key=self.__entry_file(key),
+                Body=json.dumps(
+                    {"request_id": request_id, "output_files": output_files}
+                ).encode(),
+            )
+        except (BotoCoreError, ClientError) as e:
+            logging.getLogger(__name__).warning(
+                "Could not record the result of request {:s}: {:s}".format(
+                    request_id, str(e)
+                )
+            )
+
+    def builds(self, family: str) -> list:
+        """
+        Finds the builds of a family of requests
+
+        Args:
+            family (str): Key of the family, see record_build
+
+        Returns:
+            list: The builds recorded by record_build, newest first
+        """
+        try:
+            response = self.__client.get_object(
+                Bucket=self.__bucket, Key=self.__family_file(family)
+            )
+            builds = json.loads(response["Body"].read())
+            if isinstance(builds, list):
+                return builds
+        except (BotoCoreError, ClientError, ValueError, TypeError):
+            pass
+        return []
+
+    def record_build(self, family: str, build: dict) -> None:
+        """
+        Adds a build to the index of its family, replacing an earlier build
+        of the same request. Only the newest FAMILY_SIZE builds are kept
+
+        Args:
+            family (str): Key of the family
+            build (dict): The request_id of the build, its output_files and
+                whatever the caller needs to match a request against it
+        """
+        builds = [
+            b
+            for b in self.builds(family)
+            if b.get("request_id") != build["request_id"]
+        ]
+        builds.insert(0, build)
+        try:
+            self.__client.put_object(
+                Bucket=self.__bucket,
+                Key=self.__family_file(family),
+                Body=json.dumps(builds[: ResultCache.FAMILY_SIZE]).encode(),
+            )
+        except (BotoCoreError, ClientError) as e:
+            logging.getLogger(__name__).warning(
+                "Could not record the build of request {:s}: {:s}".format(
+                    build["request_id"], str(e)
+                )
+            )
+
+    @staticmethod
+    def __entry_file(key: str) -> str:
+        return "{:s}/{:s}.json".format(ResultCache.PREFIX, key)
+
+    @staticmethod
+    def __family_file(family: str) -> str:
+        return "{:s}/family/{:s}.json".format(ResultCache.PREFIX, family)
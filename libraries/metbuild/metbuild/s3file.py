@@ -28,18 +28,30 @@
 #
 ###################################################################################################
 
+import base64
 import boto3
 import botocore
 from botocore.exceptions import ClientError
+import hashlib
 import logging
+import os
+import threading
 from datetime import datetime
 
+from .filecache import FileCache
+
 
 class S3file:
     """
     Class to handle S3 file operations
     """
 
+    # ...Presigned urls handed out by remote_url, reused while more than half
+    # of their lifetime remains so that requests built in the same process
+    # read a file through the same url
+    __urls = {}
+    __urls_lock = threading.Lock()
+
     def __init__(self, bucket_name: str):
         """
         Constructor
@@ -50,14 +62,18 @@ class S3file:
         self.__bucket = bucket_name
         self.__client = boto3.client("s3")
         self.__resource = boto3.resource("s3")
+        self.__cache = FileCache()
 
-    def upload_file(self, local_file, remote_path) -> bool:
+    def upload_file(self, local_file, remote_path, checksum: dict = None) -> bool:
         """
         Upload a file to an S3 bucket
 
         Args:
             local_file (str): local path to file for upload
             remote_path (str): desired path to the remote file
+            checksum (dict): MD5 of the file and of each of its parts, as
+                taken from pymetbuild.FileChecksums when it was written. When
+                given, S3 checks every part it receives against it
 
         Returns:
             bool: True if file was uploaded, else False
@@ -69,13 +85,83 @@ class S3file:
                     local_file, self.__bucket, remote_path
                 )
             )
-            response = self.__client.upload_file(local_file, self.__bucket, remote_path)
+            if not self.__upload_checked(local_file, remote_path, checksum):
+                self.__client.upload_file(local_file, self.__bucket, remote_path)
         except ClientError as e:
             log.error(e)
             return False
 
         return True
 
+    def __upload_checked(self, local_file, remote_path, checksum: dict) -> bool:
+        """
+        Uploads a file with the Content-MD5 of each part it is sent in
+
+        Args:
+            local_file (str): local path to file for upload
+            remote_path (str): desired path to the remote file
+            checksum (dict): MD5 of the file and of each of its parts
+
+        Returns:
+            bool: False when the checksum cannot be used for the file, which
+            is then left for a regular upload
+        """
+        if not checksum or os.path.getsize(local_file) != checksum["size"]:
+            return False
+        parts = checksum["part_md5"]
+        if len(parts) < 2:
+            with open(local_file, "rb") as f:
+                self.__client.put_object(
+                    Bucket=self.__bucket,
+                    Key=remote_path,
+                    Body=f,
+                    ContentMD5=content_md5(checksum["md5"]),
+                )
+            return True
+        if checksum["part_size"] < S3UploadStream.MIN_PART_SIZE:
+            return False
+
+        upload_id = self.__client.create_multipart_upload(
+            Bucket=self.__bucket, Key=remote_path
+        )["UploadId"]
+        try:
+            uploaded = []
+            with open(local_file, "rb") as f:
+                for number, md5 in enumerate(parts, start=1):
+                    response = self.__client.upload_part(
+                        Bucket=self.__bucket,
+                        Key=remote_path,
+                        PartNumber=number,
+                        UploadId=upload_id,
+                        Body=f.read(checksum["part_size"]),
+                        ContentMD5=content_md5(md5),
+                    )
+                    uploaded.append({"ETag": response["ETag"], "PartNumber": number})
+            self.__client.complete_multipart_upload(
+                Bucket=self.__bucket,
+                Key=remote_path,
+                UploadId=upload_id,
+                MultipartUpload={"Parts": uploaded},
+            )
+        except (ClientError, OSError):
+            self.__client.abort_multipart_upload(
+                Bucket=self.__bucket, Key=remote_path, UploadId=upload_id
+            )
+            raise
+        return True
+
+    def upload_stream(self, files: dict) -> "S3UploadStream":
+        """
+        Starts uploading files to the S3 bucket while they are being written
+
+        Args:
+            files (dict): Remote path of each local file, keyed by local path
+
+        Returns:
+            S3UploadStream: The running uploads, completed by its finish method
+        """
+        return S3UploadStream(self.__client, self.__bucket, files)
+
     def download(self, remote_path: str, service: str, time: datetime = None) -> str:
         """
         Download a file from Amazon S3
@@ -104,10 +190,60 @@ class S3file:
                 self.__bucket, remote_path, local_path
             )
         )
-        self.__client.download_file(self.__bucket, remote_path, local_path)
+        self.__cache.retrieve(
+            "s3://{:s}/{:s}".format(self.__bucket, remote_path),
+            local_path,
+            lambda path: self.__client.download_file(self.__bucket, remote_path, path),
+        )
 
         return local_path
 
+    def prefetch(self, remote_path: str) -> bool:
+        """
+        Downloads a file into the node-local file cache without placing it
+        anywhere, so a later download of it is served from the cache
+
+        Args:
+            remote_path: remote path to the file
+
+        Returns:
+            bool: True if the file was downloaded, False if it was already
+            cached or the cache is disabled
+        """
+        return self.__cache.warm(
+            "s3://{:s}/{:s}".format(self.__bucket, remote_path),
+            lambda path: self.__client.download_file(self.__bucket, remote_path, path),
+        )
+
+    def remote_url(self, remote_path: str, expires: int = 21600) -> str:
+        """
+        Generates a presigned https url of a file, which sources read by byte
+        range open in the place of a downloaded file
+
+        Args:
+            remote_path (str): remote path to the file
+            expires (int): lifetime of the url in seconds
+
+        Returns:
+            str: The presigned url
+        """
+        import time
+
+        key = (self.__bucket, remote_path)
+        now = time.time()
+        with S3file.__urls_lock:
+            cached = S3file.__urls.get(key)
+            if cached and cached[1] - now > expires / 2:
+                return cached[0]
+        url = self.__client.generate_presigned_url(
+            "get_object",
+            Params={"Bucket": self.__bucket, "Key": remote_path},
+            ExpiresIn=expires,
+        )
+        with S3file.__urls_lock:
+            S3file.__urls[key] = (url, now + expires)
+        return url
+
     def exists(self, path: str) -> bool:
         """
         Check if a file exists in the S3 bucket
@@ -211,3 +347,177 @@ class S3file:
             return True
         else:
             return False
+
+
+def content_md5(md5: str) -> str:
+    """
+    Content-MD5 header of a part from its hexadecimal MD5
+    """
+    return base64.b64encode(bytes.fromhex(md5)).decode("ascii")
+
+
+class S3UploadStream:
+    """
+    Uploads files to an S3 bucket while they are still being written
+
+    Each file is sent with a multipart upload. A background thread checks the
+    size of the files and uploads every full part written so far, so uploads
+    overlap with the generation of the files. Only files written front to
+    back, and never rewritten in place, may be streamed
+    """
+
+    # ...S3 requires every part but the last to be at least 5 MB
+    PART_SIZE = 8 * 1024 * 1024
+    MIN_PART_SIZE = 5 * 1024 * 1024
+    POLL_INTERVAL = 1.0
+
+    def __init__(
+        self,
+        client,
+        bucket_name: str,
+        files: dict,
+        part_size: int = PART_SIZE,
+        interval: float = POLL_INTERVAL,
+    ):
+        """
+        Constructor
+
+        Args:
+            client: boto3 S3 client
+            bucket_name (str): Name of the S3 bucket
+            files (dict): Remote path of each local file, keyed by local path
+            part_size (int): Size of the parts uploaded, in bytes
+            interval (float): Seconds between checks of the file sizes
+        """
+        self.__client = client
+        self.__bucket = bucket_name
+        self.__part_size = max(part_size, S3UploadStream.MIN_PART_SIZE)
+        self.__interval = interval
+        self.__uploads = [
+            {
+                "local": local,
+                "remote": remote,
+                "upload_id": None,
+                "offset": 0,
+                "parts": [],
+                "failed": False,
+            }
+            for local, remote in files.items()
+        ]
+        self.__stop = threading.Event()
+        self.__thread = threading.Thread(target=self.__run, daemon=True)
+        self.__thread.start()
+
+    def finish(self) -> list:
+        """
+        Uploads the remainder of every file and completes the uploads. The
+        files must have been closed
+
+        Returns:
+            list: Local files uploaded. Files too small to have been streamed,
+            or whose upload failed, are left for a regular upload
+        """
+        log = logging.getLogger(__name__)
+        self.__stop_thread()
+        uploaded = []
+        for upload in self.__uploads:
+            if upload["upload_id"] is None:
+                continue
+            self.__send_parts(upload, True)
+            if upload["failed"]:
+                self.__abort_upload(upload)
+                continue
+            try:
+                self.__client.complete_multipart_upload(
+                    Bucket=self.__bucket,
+                    Key=upload["remote"],
+                    UploadId=upload["upload_id"],
+                    MultipartUpload={"Parts": upload["parts"]},
+                )
+            except ClientError as e:
+                log.error(e)
+                self.__abort_upload(upload)
+                continue
+            log.info(
+                "Streamed file {:s} to s3://{:s}/{:s} in {:d} parts".format(
+                    upload["local"],
+                    self.__bucket,
+                    upload["remote"],
+                    len(upload["parts"]),
+                )
+            )
+            uploaded.append(upload["local"])
+        return uploaded
+
+    def abort(self) -> None:
+        """
+        Stops streaming and removes the parts uploaded so far
+        """
+        self.__stop_thread()
+        for upload in self.__uploads:
+            self.__abort_upload(upload)
+
+    def __stop_thread(self) -> None:
+        self.__stop.set()
+        self.__thread.join()
+
+    def __run(self) -> None:
+        while not self.__stop.wait(self.__interval):
+            for upload in self.__uploads:
+                self.__send_parts(upload, False)
+
+    def __send_parts(self, upload: dict, final: bool) -> None:
+        """
+        Uploads the full parts written to a file since the last call, and the
+        partial part at the end of the file when final is set
+
+        Args:
+            upload (dict): State of the upload of the file
+            final (bool): True once the file is complete
+        """
+        if upload["failed"] or not os.path.exists(upload["local"]):
+            return
+        log = logging.getLogger(__name__)
+        try:
+            size = os.path.getsize(upload["local"])
+            with open(upload["local"], "rb") as f:
+                while size > upload["offset"]:
+                    length = min(self.__part_size, size - upload["offset"])
+                    if length < self.__part_size and not final:
+                        break
+                    if upload["upload_id"] is None:
+                        response = self.__client.create_multipart_upload(
+                            Bucket=self.__bucket, Key=upload["remote"]
+                        )
+                        upload["upload_id"] = response["UploadId"]
+                    f.seek(upload["offset"])
+                    data = f.read(length)
+                    part_number = len(upload["parts"]) + 1
+                    response = self.__client.upload_part(
+                        Bucket=self.__bucket,
+                        Key=upload["remote"],
+                        PartNumber=part_number,
+                        UploadId=upload["upload_id"],
+                        Body=data,
+                        ContentMD5=content_md5(hashlib.md5(data).hexdigest()),
+                    )
+                    upload["parts"].append(
+                        {"ETag": response["ETag"], "PartNumber": part_number}
+                    )
+                    upload["offset"] += len(data)
+        except (ClientError, OSError) as e:
+            log.error(e)
+            upload["failed"] = True
+
+    def __abort_upload(self, upload: dict) -> None:
+        if upload["upload_id"] is None:
+            return
+        try:
+            self.__client.abort_multipart_upload(
+                Bucket=self.__bucket,
+                Key=upload["remote"],
+                UploadId=upload["upload_id"],
+            )
+        except ClientError as e:
+            logging.getLogger(__name__).error(e)
+        upload["upload_id"] = None
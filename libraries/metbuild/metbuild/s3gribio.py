@@ -31,6 +31,9 @@
 from typing import Union, List, Tuple
 import logging
 
+from .filecache import FileCache
+from .gribdataattributes import find_inventory_message
+
 
 class S3GribIO:
     """
@@ -51,6 +54,7 @@ class S3GribIO:
         self.__s3_bucket = s3_bucket
         self.__variable_list = variable_list
         self.__s3_client = boto3.client("s3")
+        self.__cache = FileCache()
         self.__s3_resource = boto3.resource("s3")
         # self.__s3_bucket_object = self.__s3_resource.Bucket(self.__s3_bucket)
 
@@ -148,15 +152,7 @@ class S3GribIO:
         Returns:
             dict: The byte list for the variable
         """
-        for i in range(len(inventory_data)):
-            if variable["long_name"] in inventory_data[i]:
-                start_bits = inventory_data[i].split(":")[1]
-                if i + 1 == len(inventory_data):
-                    end_bits = ""
-                else:
-                    end_bits = inventory_data[i + 1].split(":")[1]
-                return {"name": variable["name"], "start": start_bits, "end": end_bits}
-        return None
+        return find_inventory_message(inventory_data, variable)
 
     def __get_grib_inventory(self, s3_file: str) -> Union[None, list]:
         """
@@ -241,23 +237,22 @@ class S3GribIO:
                 out_byte_range.append(b)
         return out_byte_range
 
-    def download(
-        self, s3_file: str, local_file: str, variable_type: str = "all"
-    ) -> Tuple[bool, bool]:
+    def plan(
+        self, s3_file: str, variable_type: str = "all"
+    ) -> Tuple[bool, bool, Union[None, list]]:
         """
-        Downloads the grib file from s3 to the local file path
-        for the variables specified in the variable list
+        Determines the byte ranges of the grib file that need to be
+        downloaded for the variables specified in the variable list
 
         Args:
             s3_file (str): The s3 file to download
-            local_file (str): The local file path to download to
             variable_type (str): The type of variable to download
 
         Returns:
-            bool: True if the download was successful, False otherwise
+            Tuple[bool, bool, Union[None, list]]: Whether the file can be
+            downloaded, whether the failure is fatal, and the byte ranges to
+            download (None when the full file is required)
         """
-        import os
-
         log = logging.getLogger(__name__)
 
         bucket, path = self.__parse_path(s3_file)
@@ -267,45 +262,135 @@ class S3GribIO:
                     bucket, self.__s3_bucket
                 )
             )
-            return False, True
+            return False, True, None
 
         # ...Parses the grib inventory to the byte ranges for each variable
         inventory = self.__get_grib_inventory(path)
 
-        if os.path.exists(local_file):
-            log.warning("File '{}' already exists, removing".format(local_file))
-            os.remove(local_file)
-
         if inventory is None:
-            log.info("Downloading full file for {} to {}".format(s3_file, local_file))
-            obj = self.__try_get_object(path)
-            with open(local_file, "wb") as f:
-                f.write(obj["Body"].read())
+            return True, False, None
 
-            return True, False
+        # ...Select the byte ranges that are actually required to be downloaded
+        inventory_subset = self.__variable_type_to_byte_range(variable_type, inventory)
 
-        else:
-            # ...Select the byte ranges that are actually required to be downloaded
-            inventory_subset = self.__variable_type_to_byte_range(
-                variable_type, inventory
+        if len(inventory_subset) == 0:
+            log.error("No inventory found for file {}".format(path))
+            return False, False, None
+        elif (
+            len(inventory_subset)
+            < S3GribIO.__get_variable_candidates(variable_type)["length"]
+        ):
+            log.error("Inventory length does not match variable list length")
+            return False, False, None
+
+        return True, False, inventory_subset
+
+    def fetch(self, s3_file: str, byte_ranges: Union[None, list]) -> List[bytes]:
+        """
+        Downloads the byte ranges of a grib file produced by plan. The
+        client is thread safe, so several files may be fetched concurrently
+
+        Args:
+            s3_file (str): The s3 file to download
+            byte_ranges (Union[None, list]): The byte ranges to download, or
+                None to download the full file
+
+        Returns:
+            List[bytes]: The contents of each byte range, in order
+        """
+        key, download = self.__fetcher(s3_file, byte_ranges)
+        return self.__cache.read(key, download)
+
+    def prefetch(self, s3_file: str, byte_ranges: Union[None, list]) -> bool:
+        """
+        Downloads the byte ranges of a grib file into the node-local file
+        cache, so that a later fetch of them is served from the cache
+
+        Args:
+            s3_file (str): The s3 file to download
+            byte_ranges (Union[None, list]): The byte ranges to download, or
+                None to download the full file
+
+        Returns:
+            bool: True if the ranges were downloaded, False if they were
+            already cached or the cache is disabled
+        """
+        key, download = self.__fetcher(s3_file, byte_ranges)
+
+        def write(local_path: str) -> None:
+            with open(local_path, "wb") as f:
+                for part in download():
+                    f.write(part)
+
+        return self.__cache.warm(key, write)
+
+    def __fetcher(self, s3_file: str, byte_ranges: Union[None, list]):
+        """
+        Returns the cache key of the byte ranges of a grib file and the
+        function downloading them
+
+        Args:
+            s3_file (str): The s3 file to download
+            byte_ranges (Union[None, list]): The byte ranges to download, or
+                None to download the full file
+        """
+        _, path = self.__parse_path(s3_file)
+
+        def download() -> List[bytes]:
+            if byte_ranges is None:
+                obj = self.__try_get_object(path, allow_fail=False)
+                return [obj["Body"].read()]
+
+            parts = []
+            for var in byte_ranges:
+                byte_range = "bytes={}-{}".format(var["start"], var["end"])
+                obj = self.__try_get_object(path, byte_range, allow_fail=False)
+                parts.append(obj["Body"].read())
+            return parts
+
+        # ...The same subset of a file is requested by every job reading it,
+        # so the cache is keyed by the file and the ranges selected
+        key = s3_file
+        if byte_ranges is not None:
+            key += "?" + ",".join(
+                "{}-{}".format(var["start"], var["end"]) for var in byte_ranges
             )
+        return key, download
 
-            if len(inventory_subset) == 0:
-                log.error("No inventory found for file {}".format(path))
-                return False, False
-            elif (
-                len(inventory_subset)
-                < S3GribIO.__get_variable_candidates(variable_type)["length"]
-            ):
-                log.error("Inventory length does not match variable list length")
-                return False, False
+    def download(
+        self, s3_file: str, local_file: str, variable_type: str = "all"
+    ) -> Tuple[bool, bool]:
+        """
+        Downloads the grib file from s3 to the local file path
+        for the variables specified in the variable list
 
+        Args:
+            s3_file (str): The s3 file to download
+            local_file (str): The local file path to download to
+            variable_type (str): The type of variable to download
+
+        Returns:
+            bool: True if the download was successful, False otherwise
+        """
+        import os
+
+        log = logging.getLogger(__name__)
+
+        success, fatal, byte_ranges = self.plan(s3_file, variable_type)
+        if not success:
+            return False, fatal
+
+        if os.path.exists(local_file):
+            log.warning("File '{}' already exists, removing".format(local_file))
+            os.remove(local_file)
+
+        if byte_ranges is None:
+            log.info("Downloading full file for {} to {}".format(s3_file, local_file))
+        else:
             log.info("Downloading subset for {} to {}".format(s3_file, local_file))
 
-            for var in inventory_subset:
-                byte_range = "bytes={}-{}".format(var["start"], var["end"])
-                obj = self.__try_get_object(path, byte_range)
-                with open(local_file, "ab") as f:
-                    f.write(obj["Body"].read())
+        with open(local_file, "wb") as f:
+            for part in self.fetch(s3_file, byte_ranges):
+                f.write(part)
 
-            return True, False
+        return True, False
@@ -150,6 +150,7 @@ class RequestTable(TableBase):
         message: str,
         credit: int,
         increment_try: bool = False,
+        statistics: dict = None,
     ) -> None:
         """
         This method is used to update a request in the database
@@ -163,6 +164,7 @@ class RequestTable(TableBase):
             message (str): The message for the request
             credit (int): The number of credits used for the request
             increment_try (bool): Whether to increment the try count
+            statistics (dict): Stage timings and counters stored with the message
 
         Returns:
             None
@@ -193,6 +195,111 @@ class RequestTable(TableBase):
                 record.status = request_status
                 record.last_date = datetime.utcnow().strftime("%Y-%m-%d %H:%M:%S")
                 record.message = {"message": message}
+                if statistics:
+                    record.message["statistics"] = statistics
+                session.commit()
+
+
+class RegisteredDomainTable(TableBase):
+    """
+    This class is used to create the table that holds the domains registered
+    for recurring requests. The interpolation weights of each domain are built
+    ahead of time from the latest data of each of its services
+    """
+
+    __tablename__ = "registered_domains"
+
+    index = Column("id", Integer, primary_key=True)
+    api_key = Column(String)
+    name = Column(String)
+    domain = Column(MutableDict.as_mutable(JSONB))
+    services = Column(JSONB)
+    epsg = Column(Integer)
+    registered = Column(DateTime)
+    prepared = Column(DateTime)
+
+    @staticmethod
+    def register(
+        api_key: str, name: str, domain: dict, services: list, epsg: int
+    ) -> int:
+        """
+        This method is used to register a domain for weight precomputation. A
+        domain registered again by the same API key under the same name is
+        replaced
+
+        Args:
+            api_key (str): The API key registering the domain
+            name (str): The name of the domain
+            domain (dict): The domain definition, as given in a request
+            services (list): The services the domain is built from
+            epsg (int): The projection of the output
+
+        Returns:
+            int: The id of the registration
+        """
+        from datetime import datetime
+        from metbuild.database import Database
+
+        with Database() as db, db.session() as session:
+            record = (
+                session.query(RegisteredDomainTable)
+                .where(RegisteredDomainTable.api_key == api_key)
+                .where(RegisteredDomainTable.name == name)
+                .first()
+            )
+            if record is None:
+                record = RegisteredDomainTable(api_key=api_key, name=name)
+                session.add(record)
+            record.domain = domain
+            record.services = services
+            record.epsg = epsg
+            record.registered = datetime.utcnow().strftime("%Y-%m-%d %H:%M:%S")
+            record.prepared = None
+            session.commit()
+            return record.index
+
+    @staticmethod
+    def registered() -> list:
+        """
+        This method is used to list every registered domain
+
+        Returns:
+            list: The registrations, as dictionaries
+        """
+        from metbuild.database import Database
+
+        with Database() as db, db.session() as session:
+            return [
+                {
+                    "id": r.index,
+                    "name": r.name,
+                    "domain": dict(r.domain),
+                    "services": list(r.services),
+                    "epsg": r.epsg,
+                }
+                for r in session.query(RegisteredDomainTable).all()
+            ]
+
+    @staticmethod
+    def set_prepared(index: int) -> None:
+        """
+        This method is used to record that the weights of a registered domain
+        were built
+
+        Args:
+            index (int): The id of the registration
+        """
+        from datetime import datetime
+        from metbuild.database import Database
+
+        with Database() as db, db.session() as session:
+            record = (
+                session.query(RegisteredDomainTable)
+                .where(RegisteredDomainTable.index == index)
+                .first()
+            )
+            if record is not None:
+                record.prepared = datetime.utcnow().strftime("%Y-%m-%d %H:%M:%S")
                 session.commit()
 
 
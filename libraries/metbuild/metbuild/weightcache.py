@@ -0,0 +1,316 @@
+#!/usr/bin/env python3
+###################################################################################################
+# MIT License
+#
+# Copyright (c) 2023 The Water Institute
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+# Author: Zach Cobell
+# Contact: zcobell@thewaterinstitute.org
+# Organization: The Water Institute
+#
+###################################################################################################
+
+import json
+import logging
+import os
+import tempfile
+
+import boto3
+import pymetbuild
+from botocore.exceptions import BotoCoreError, ClientError
+
+
+class WeightCache:
+    """
+    Interpolation weights shared by every build through S3. libmetbuild
+    writes the weights it generates to a local directory in its versioned
+    binary format and memory maps them when they are used again. Before a
+    build, this class fills that directory with the weights earlier builds of
+    the same domain used, on any machine. After the build it publishes the
+    weights that were generated, so only the first build of a domain pays for
+    them.
+
+    Each domain has a manifest, <prefix>/domains/<domain key>.json, listing
+    the weight keys it used most recently. The weights themselves are stored
+    once, under <prefix>/weights/<weight key>.bin, whichever domain produced
+    them. libmetbuild checks the header and size of every file it loads, so
+    a stale or damaged object is recomputed rather than used
+
+    Source triangulations are shared the same way, since they depend only on
+    the source grid. Each service has a manifest,
+    <prefix>/sources/<service>.json, listing the triangulations its builds
+    used, which are stored under <prefix>/locators/<locator key>.bin. A new
+    output grid on a known source then skips triangulating it
+    """
+
+    PREFIX = "weight_cache"
+
+    # ...Keys kept in a domain manifest. Moving sources add a key per grid,
+    # so only the most recent ones are fetched
+    MAX_KEYS = 32
+
+    def __init__(self, bucket: str, directory: str):
+        """
+        Constructor
+
+        Args:
+            bucket (str): Name of the S3 bucket holding the shared weights
+            directory (str): Local weight cache directory, which is enabled
+                in libmetbuild
+        """
+        self.__bucket = bucket
+        self.__directory = directory
+        self.__client = boto3.client("s3")
+        self.__manifests = {}
+        os.makedirs(directory, exist_ok=True)
+        pymetbuild.InterpolationCache.setDirectory(directory)
+        pymetbuild.LocatorCache.setDirectory(os.path.join(directory, "locators"))
+        os.makedirs(pymetbuild.LocatorCache.directory(), exist_ok=True)
+
+    @staticmethod
+    def domain_key(service: str, grid, epsg: int) -> str:
+        """
+        Generates the key of the manifest of a domain
+
+        Args:
+            service (str): Source of the meteorology
+            grid: pymetbuild.Grid the domain is interpolated to
+            epsg (int): Projection of the output
+
+        Returns:
+            str: The key, unique to the source and output grid
+        """
+        return "{:s}_{:016x}_{:d}".format(service, grid.fingerprint(), epsg)
+
+    def fetch(self, domain_key: str) -> int:
+        """
+        Downloads the weights listed in the manifest of a domain which are
+        not in the local cache yet
+
+        Args:
+            domain_key (str): Key generated by domain_key
+
+        Returns:
+            int: Number of weight files downloaded
+        """
+        count = self.__fetch(
+            self.__manifest_file(domain_key),
+            WeightCache.__local_file,
+            WeightCache.__remote_file,
+        )
+        if count > 0:
+            logging.getLogger(__name__).info(
+                "Fetched {:d} shared weight files for domain {:s}".format(
+                    count, domain_key
+                )
+            )
+        return count
+
+    def cached(self, domain_key: str) -> bool:
+        """
+        Whether every weight listed in the manifest of a domain is in the
+        local cache, so the domain is interpolated without locating its
+        source. The manifest is the one read by the last fetch
+
+        Args:
+            domain_key (str): Key generated by domain_key
+
+        Returns:
+            bool: True if the domain has weights and all of them are local
+        """
+        keys = self.__manifests.get(self.__manifest_file(domain_key))
+        if not keys:
+            return False
+        return all(os.path.exists(WeightCache.__local_file(key)) for key in keys)
+
+    def publish(self, domain_key: str, keys: list) -> int:
+        """
+        Uploads the weights a domain used which are not shared yet and
+        records them in its manifest
+
+        Args:
+            domain_key (str): Key generated by domain_key
+            keys (list): Weight keys used by the domain, from
+                BuildRequest.weight_keys
+
+        Returns:
+            int: Number of weight files uploaded
+        """
+        count = self.__publish(
+            self.__manifest_file(domain_key),
+            keys,
+            WeightCache.__local_file,
+            WeightCache.__remote_file,
+        )
+        if count > 0:
+            logging.getLogger(__name__).info(
+                "Published {:d} weight files for domain {:s}".format(
+                    count, domain_key
+                )
+            )
+        return count
+
+    def fetch_locators(self, service: str) -> int:
+        """
+        Downloads the source triangulations listed in the manifest of a
+        service which are not in the local cache yet
+
+        Args:
+            service (str): Source of the meteorology
+
+        Returns:
+            int: Number of triangulation files downloaded
+        """
+        count = self.__fetch(
+            self.__source_manifest_file(service),
+            WeightCache.__local_locator_file,
+            WeightCache.__remote_locator_file,
+        )
+        if count > 0:
+            logging.getLogger(__name__).info(
+                "Fetched {:d} shared triangulations of {:s}".format(count, service)
+            )
+        return count
+
+    def publish_locators(self, service: str, keys: list) -> int:
+        """
+        Uploads the source triangulations a service used which are not shared
+        yet and records them in its manifest
+
+        Args:
+            service (str): Source of the meteorology
+            keys (list): Triangulation keys used, from
+                LocatorCache.used_keys
+
+        Returns:
+            int: Number of triangulation files uploaded
+        """
+        count = self.__publish(
+            self.__source_manifest_file(service),
+            keys,
+            WeightCache.__local_locator_file,
+            WeightCache.__remote_locator_file,
+        )
+        if count > 0:
+            logging.getLogger(__name__).info(
+                "Published {:d} triangulations of {:s}".format(count, service)
+            )
+        return count
+
+    def __fetch(self, manifest_file: str, local_file, remote_file) -> int:
+        log = logging.getLogger(__name__)
+        keys = self.__read_manifest(manifest_file)
+        self.__manifests[manifest_file] = keys
+
+        count = 0
+        for key in keys:
+            local = local_file(key)
+            if os.path.exists(local):
+                continue
+            # ...Downloaded beside the cache file and renamed into place, so
+            # a build never maps a partial file
+            fd, partial = tempfile.mkstemp(
+                dir=os.path.dirname(local) or self.__directory, suffix=".part"
+            )
+            os.close(fd)
+            try:
+                self.__client.download_file(self.__bucket, remote_file(key), partial)
+                os.replace(partial, local)
+                count += 1
+            except (BotoCoreError, ClientError) as e:
+                log.warning("Could not fetch {:s}: {:s}".format(key, str(e)))
+                os.remove(partial)
+        return count
+
+    def __publish(self, manifest_file: str, keys: list, local_file, remote_file) -> int:
+        log = logging.getLogger(__name__)
+        known = self.__manifests.get(manifest_file)
+        if known is None:
+            known = self.__read_manifest(manifest_file)
+
+        count = 0
+        for key in keys:
+            if key in known:
+                continue
+            local = local_file(key)
+            if not os.path.exists(local):
+                continue
+            try:
+                self.__client.upload_file(local, self.__bucket, remote_file(key))
+                count += 1
+            except (BotoCoreError, ClientError) as e:
+                log.warning("Could not publish {:s}: {:s}".format(key, str(e)))
+
+        # ...Keys used by this build go first and the oldest are dropped
+        manifest = list(dict.fromkeys(list(keys) + known))[: WeightCache.MAX_KEYS]
+        if manifest != known:
+            try:
+                self.__client.put_object(
+                    Bucket=self.__bucket,
+                    Key=manifest_file,
+                    Body=json.dumps({"keys": manifest}).encode(),
+                )
+            except (BotoCoreError, ClientError) as e:
+                log.warning(
+                    "Could not update the manifest {:s}: {:s}".format(
+                        manifest_file, str(e)
+                    )
+                )
+        self.__manifests[manifest_file] = manifest
+        return count
+
+    def __read_manifest(self, manifest_file: str) -> list:
+        try:
+            response = self.__client.get_object(
+                Bucket=self.__bucket, Key=manifest_file
+            )
+            return list(json.loads(response["Body"].read())["keys"])
+        except (BotoCoreError, ClientError):
+            return []
+        except (ValueError, KeyError):
+            logging.getLogger(__name__).warning(
+                "Ignoring invalid manifest " + manifest_file
+            )
+            return []
+
+    @staticmethod
+    def __local_file(key: str) -> str:
+        return pymetbuild.InterpolationCache.filename(key)
+
+    @staticmethod
+    def __remote_file(key: str) -> str:
+        return "{:s}/weights/{:s}.bin".format(WeightCache.PREFIX, key)
+
+    @staticmethod
+    def __manifest_file(domain_key: str) -> str:
+        return "{:s}/domains/{:s}.json".format(WeightCache.PREFIX, domain_key)
+
+    @staticmethod
+    def __local_locator_file(key: str) -> str:
+        return pymetbuild.LocatorCache.filename(key)
+
+    @staticmethod
+    def __remote_locator_file(key: str) -> str:
+        return "{:s}/locators/{:s}.bin".format(WeightCache.PREFIX, key)
+
+    @staticmethod
+    def __source_manifest_file(service: str) -> str:
+        return "{:s}/sources/{:s}.json".format(WeightCache.PREFIX, service)
@@ -95,6 +95,21 @@ class WindGrid:
         else:
             return self.__ny
 
+    def decimate(self, stride: int) -> None:
+        """
+        Keeps every stride-th grid point in each direction, as used for
+        preview requests
+
+        Args:
+            stride: The step between the grid points kept
+        """
+        if stride <= 1:
+            return
+        self.__nx = (self.__nx + stride - 1) // stride
+        self.__ny = (self.__ny + stride - 1) // stride
+        if self.__wg:
+            self.__wg = self.__wg.strided(stride)
+
     def bottom_left(self):
         """
         Returns the bottom left corner of the wind grid